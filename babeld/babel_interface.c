@@ -751,6 +751,7 @@ interface_reset(struct interface *ifp)
 
     flush_interface_routes(ifp, 0);
     babel_ifp->buffered = 0;
+    babel_ifp->buffered_update_count = 0;
     babel_ifp->bufsize = 0;
     free(babel_ifp->sendbuf);
     babel_ifp->num_buffered_updates = 0;
@@ -864,6 +865,16 @@ show_babel_interface_sub (struct vty *vty, struct interface *ifp)
   vty_out (vty, "  Hello interval is %u ms\n", babel_ifp->hello_interval);
   vty_out (vty, "  Update interval is %u ms\n", babel_ifp->update_interval);
   vty_out (vty, "  Rxcost multiplier is %u\n", babel_ifp->cost);
+  vty_out (vty, "  Sent %lu updates in %lu packets, %lu duplicates merged\n",
+           babel_ifp->updates_sent, babel_ifp->update_packets,
+           babel_ifp->updates_merged);
+  if (babel_ifp->update_packets && babel_ifp->bufsize)
+    vty_out (vty,
+             "  Packing %.1f updates per packet, %lu%% full, %lu prefix bytes omitted\n",
+             (double)babel_ifp->updates_sent / babel_ifp->update_packets,
+             babel_ifp->update_bytes * 100
+               / (babel_ifp->update_packets * babel_ifp->bufsize),
+             babel_ifp->update_bytes_omitted);
 }
 
 DEFUN (show_babel_interface,
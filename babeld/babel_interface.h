@@ -50,13 +50,23 @@ struct babel_interface {
     char have_buffered_id;
     char have_buffered_nh;
     char have_buffered_prefix;
+    char have_buffered_v4_prefix;
     unsigned char buffered_id[8];
     unsigned char buffered_nh[4];
     unsigned char buffered_prefix[16];
+    unsigned char buffered_v4_prefix[16];
     unsigned char *sendbuf;
     struct buffered_update *buffered_updates;
     int num_buffered_updates;
     int update_bufsize;
+    /* Number of updates in the send buffer, and update packing
+       statistics. */
+    int buffered_update_count;
+    unsigned long update_packets;
+    unsigned long update_bytes;
+    unsigned long updates_sent;
+    unsigned long updates_merged;
+    unsigned long update_bytes_omitted;
     time_t bucket_time;
     unsigned int bucket;
     time_t last_update_time;
@@ -745,6 +745,10 @@ flushbuf(struct interface *ifp)
                             (struct sockaddr*)&sin6, sizeof(sin6));
             if(rc < 0)
                 flog_err(EC_BABEL_PACKET, "send: %s", safe_strerror(errno));
+            else if(babel_ifp->buffered_update_count > 0) {
+                babel_ifp->update_packets++;
+                babel_ifp->update_bytes += babel_ifp->buffered;
+            }
         } else {
             flog_err(EC_BABEL_PACKET,
 		      "Warning: bucket full, dropping packet to %s.",
@@ -757,6 +761,8 @@ flushbuf(struct interface *ifp)
     babel_ifp->have_buffered_id = 0;
     babel_ifp->have_buffered_nh = 0;
     babel_ifp->have_buffered_prefix = 0;
+    babel_ifp->have_buffered_v4_prefix = 0;
+    babel_ifp->buffered_update_count = 0;
     babel_ifp->flush_timeout.tv_sec = 0;
     babel_ifp->flush_timeout.tv_usec = 0;
 }
@@ -1074,6 +1080,16 @@ really_send_update(struct interface *ifp,
 
         real_prefix = prefix + 12;
         real_plen = plen - 96;
+
+        /* The receiver keeps distinct default prefixes for each address
+           family, so IPv4 updates can be compressed too. */
+        if(babel_ifp->have_buffered_v4_prefix) {
+            while(omit < real_plen / 8 &&
+                  babel_ifp->buffered_v4_prefix[12 + omit] == real_prefix[omit])
+                omit++;
+        }
+        if(!babel_ifp->have_buffered_v4_prefix || real_plen >= 24)
+            flags |= 0x80;
     } else {
         if(babel_ifp->have_buffered_prefix) {
             while(omit < plen / 8 &&
@@ -1122,9 +1138,18 @@ really_send_update(struct interface *ifp,
                 channels_size);
 
     if(flags & 0x80) {
-        memcpy(babel_ifp->buffered_prefix, prefix, 16);
-        babel_ifp->have_buffered_prefix = 1;
+        if(v4) {
+            memcpy(babel_ifp->buffered_v4_prefix, prefix, 16);
+            babel_ifp->have_buffered_v4_prefix = 1;
+        } else {
+            memcpy(babel_ifp->buffered_prefix, prefix, 16);
+            babel_ifp->have_buffered_prefix = 1;
+        }
     }
+
+    babel_ifp->buffered_update_count++;
+    babel_ifp->updates_sent++;
+    babel_ifp->update_bytes_omitted += omit;
 }
 
 static int
@@ -1214,8 +1239,10 @@ flushupdates(struct interface *ifp)
 
             if(last_prefix) {
                 if(b[i].plen == last_plen &&
-                   memcmp(b[i].prefix, last_prefix, 16) == 0)
+                   memcmp(b[i].prefix, last_prefix, 16) == 0) {
+                    babel_ifp->updates_merged++;
                     continue;
+                }
             }
 
             xroute = find_xroute(b[i].prefix, b[i].plen);
@@ -1277,6 +1304,8 @@ flushupdates(struct interface *ifp)
                after an xroute has been retracted, so send a retraction. */
                 really_send_update(ifp, myid, b[i].prefix, b[i].plen,
                                    myseqno, INFINITY, NULL, -1);
+                last_prefix = b[i].prefix;
+                last_plen = b[i].plen;
             }
         }
         schedule_flush_now(ifp);
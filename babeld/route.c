@@ -38,8 +38,6 @@ THE SOFTWARE.
 
 static void consider_route(struct babel_route *route);
 
-struct babel_route **routes = NULL;
-static int route_slots = 0, max_route_slots = 0;
 int kernel_metric = 0;
 enum babel_diversity diversity_kind = DIVERSITY_NONE;
 int diversity_factor = BABEL_DEFAULT_DIVERSITY_FACTOR;
@@ -48,58 +46,49 @@ int keep_unfeasible = 0;
 int smoothing_half_life = 0;
 static int two_to_the_one_over_hl = 0; /* 2^(1/hl) * 0x10000 */
 
-/* We maintain a list of "slots", ordered by prefix.  Every slot
+/* We maintain a tree of "slots", ordered by prefix.  Every slot
    contains a linked list of the routes to this prefix, with the
-   installed route, if any, at the head of the list. */
+   installed route, if any, at the head of the list.  Slots are
+   allocated separately, so they stay put while the tree changes. */
+
+PREDECL_RBTREE_UNIQ(route_slots)
+
+struct route_slot {
+    struct route_slots_item item;
+    unsigned char prefix[16];
+    unsigned char plen;
+    struct babel_route *routes;
+};
 
 static int
-route_compare(const unsigned char *prefix, unsigned char plen,
-               struct babel_route *route)
+route_slot_compare(const struct route_slot *a, const struct route_slot *b)
 {
-    int i = memcmp(prefix, route->src->prefix, 16);
+    int i = memcmp(a->prefix, b->prefix, 16);
     if(i != 0)
         return i;
 
-    if(plen < route->src->plen)
-        return -1;
-    else if(plen > route->src->plen)
-        return 1;
-    else
-        return 0;
+    return numcmp(a->plen, b->plen);
 }
 
-/* Performs binary search, returns -1 in case of failure.  In the latter
-   case, new_return is the place where to insert the new element. */
-
-static int
-find_route_slot(const unsigned char *prefix, unsigned char plen,
-                int *new_return)
-{
-    int p, m, g, c;
-
-    if(route_slots < 1) {
-        if(new_return)
-            *new_return = 0;
-        return -1;
-    }
+DECLARE_RBTREE_UNIQ(route_slots, struct route_slot, item, route_slot_compare)
 
-    p = 0; g = route_slots - 1;
+static struct route_slots_head route_slots = INIT_RBTREE_UNIQ(route_slots);
 
-    do {
-        m = (p + g) / 2;
-        c = route_compare(prefix, plen, routes[m]);
-        if(c == 0)
-            return m;
-        else if(c < 0)
-            g = m - 1;
-        else
-            p = m + 1;
-    } while(p <= g);
+static struct route_slot *
+find_route_slot(const unsigned char *prefix, unsigned char plen)
+{
+    struct route_slot key;
 
-    if(new_return)
-        *new_return = p;
+    memcpy(key.prefix, prefix, 16);
+    key.plen = plen;
+    return route_slots_find(&route_slots, &key);
+}
 
-    return -1;
+/* Whether flushing route will also free its slot. */
+static inline int
+route_slot_last(const struct route_slot *slot, const struct babel_route *route)
+{
+    return slot->routes == route && route->next == NULL;
 }
 
 struct babel_route *
@@ -107,12 +96,12 @@ find_route(const unsigned char *prefix, unsigned char plen,
            struct neighbour *neigh, const unsigned char *nexthop)
 {
     struct babel_route *route;
-    int i = find_route_slot(prefix, plen, NULL);
+    struct route_slot *slot = find_route_slot(prefix, plen);
 
-    if(i < 0)
+    if(slot == NULL)
         return NULL;
 
-    route = routes[i];
+    route = slot->routes;
 
     while(route) {
         if(route->neigh == neigh && memcmp(route->nexthop, nexthop, 16) == 0)
@@ -126,10 +115,10 @@ find_route(const unsigned char *prefix, unsigned char plen,
 struct babel_route *
 find_installed_route(const unsigned char *prefix, unsigned char plen)
 {
-    int i = find_route_slot(prefix, plen, NULL);
+    struct route_slot *slot = find_route_slot(prefix, plen);
 
-    if(i >= 0 && routes[i]->installed)
-        return routes[i];
+    if(slot && slot->routes->installed)
+        return slot->routes;
 
     return NULL;
 }
@@ -138,27 +127,7 @@ find_installed_route(const unsigned char *prefix, unsigned char plen)
 int
 installed_routes_estimate(void)
 {
-    return route_slots;
-}
-
-static int
-resize_route_table(int new_slots)
-{
-    struct babel_route **new_routes;
-    assert(new_slots >= route_slots);
-
-    if(new_slots == 0) {
-        new_routes = NULL;
-        free(routes);
-    } else {
-        new_routes = realloc(routes, new_slots * sizeof(struct babel_route*));
-        if(new_routes == NULL)
-            return -1;
-    }
-
-    max_route_slots = new_slots;
-    routes = new_routes;
-    return 1;
+    return route_slots_count(&route_slots);
 }
 
 /* Insert a route into the table.  If successful, retains the route.
@@ -166,31 +135,27 @@ resize_route_table(int new_slots)
 static struct babel_route *
 insert_route(struct babel_route *route)
 {
-    int i, n;
+    struct route_slot *slot;
 
     assert(!route->installed);
 
-    i = find_route_slot(route->src->prefix, route->src->plen, &n);
+    route->next = NULL;
+    slot = find_route_slot(route->src->prefix, route->src->plen);
 
-    if(i < 0) {
-        if(route_slots >= max_route_slots)
-            resize_route_table(max_route_slots < 1 ? 8 : 2 * max_route_slots);
-        if(route_slots >= max_route_slots)
+    if(slot == NULL) {
+        slot = malloc(sizeof(struct route_slot));
+        if(slot == NULL)
             return NULL;
-        assert(routes);
-        route->next = NULL;
-        if(n < route_slots)
-            memmove(routes + n + 1, routes + n,
-                    (route_slots - n) * sizeof(struct babel_route*));
-        route_slots++;
-        routes[n] = route;
+        memcpy(slot->prefix, route->src->prefix, 16);
+        slot->plen = route->src->plen;
+        slot->routes = route;
+        route_slots_add(&route_slots, slot);
     } else {
         struct babel_route *r;
-        r = routes[i];
+        r = slot->routes;
         while(r->next)
             r = r->next;
         r->next = route;
-        route->next = NULL;
     }
 
     return route;
@@ -199,7 +164,7 @@ insert_route(struct babel_route *route)
 void
 flush_route(struct babel_route *route)
 {
-    int i;
+    struct route_slot *slot;
     struct source *src;
     unsigned oldmetric;
     int lost = 0;
@@ -212,34 +177,23 @@ flush_route(struct babel_route *route)
         lost = 1;
     }
 
-    i = find_route_slot(route->src->prefix, route->src->plen, NULL);
-    assert(i >= 0 && i < route_slots);
+    slot = find_route_slot(route->src->prefix, route->src->plen);
+    assert(slot);
 
-    if(route == routes[i]) {
-        routes[i] = route->next;
-        route->next = NULL;
-        free(route);
-
-        if(routes[i] == NULL) {
-            if(i < route_slots - 1)
-                memmove(routes + i, routes + i + 1,
-                        (route_slots - i - 1) * sizeof(struct babel_route*));
-            routes[route_slots - 1] = NULL;
-            route_slots--;
+    if(route == slot->routes) {
+        slot->routes = route->next;
+        if(slot->routes == NULL) {
+            route_slots_del(&route_slots, slot);
+            free(slot);
         }
-
-        if(route_slots == 0)
-            resize_route_table(0);
-        else if(max_route_slots > 8 && route_slots < max_route_slots / 4)
-            resize_route_table(max_route_slots / 2);
     } else {
-        struct babel_route *r = routes[i];
+        struct babel_route *r = slot->routes;
         while(r->next != route)
             r = r->next;
         r->next = route->next;
-        route->next = NULL;
-        free(route);
     }
+    route->next = NULL;
+    free(route);
 
     if(lost)
         route_lost(src, oldmetric);
@@ -250,18 +204,13 @@ flush_route(struct babel_route *route)
 void
 flush_all_routes(void)
 {
-    int i;
+    struct route_slot *slot;
 
-    /* Start from the end, to avoid shifting the table. */
-    i = route_slots - 1;
-    while(i >= 0) {
-        while(i < route_slots) {
+    while((slot = route_slots_first(&route_slots))) {
         /* Uninstall first, to avoid calling route_lost. */
-            if(routes[i]->installed)
-                uninstall_route(routes[i]);
-            flush_route(routes[i]);
-        }
-        i--;
+        if(slot->routes->installed)
+            uninstall_route(slot->routes);
+        flush_route(slot->routes);
     }
 
     check_sources_released();
@@ -270,51 +219,53 @@ flush_all_routes(void)
 void
 flush_neighbour_routes(struct neighbour *neigh)
 {
-    int i;
+    struct route_slot *slot;
 
-    i = 0;
-    while(i < route_slots) {
+    frr_each_safe(route_slots, &route_slots, slot) {
         struct babel_route *r;
-        r = routes[i];
+    again:
+        r = slot->routes;
         while(r) {
             if(r->neigh == neigh) {
+                if(route_slot_last(slot, r)) {
+                    flush_route(r);
+                    break;
+                }
                 flush_route(r);
                 goto again;
             }
             r = r->next;
         }
-        i++;
-    again:
-        ;
     }
 }
 
 void
 flush_interface_routes(struct interface *ifp, int v4only)
 {
-    int i;
+    struct route_slot *slot;
 
-    i = 0;
-    while(i < route_slots) {
+    frr_each_safe(route_slots, &route_slots, slot) {
         struct babel_route *r;
-        r = routes[i];
+    again:
+        r = slot->routes;
         while(r) {
             if(r->neigh->ifp == ifp &&
                (!v4only || v4mapped(r->nexthop))) {
+                if(route_slot_last(slot, r)) {
+                    flush_route(r);
+                    break;
+                }
                 flush_route(r);
                 goto again;
             }
             r = r->next;
         }
-        i++;
-    again:
-        ;
     }
 }
 
 struct route_stream {
     int installed;
-    int index;
+    struct route_slot *slot;
     struct babel_route *next;
 };
 
@@ -329,8 +280,8 @@ route_stream(int installed)
        return NULL;
 
     stream->installed = installed;
-    stream->index = installed ? 0 : -1;
-    stream->next = NULL;
+    stream->slot = route_slots_first(&route_slots);
+    stream->next = stream->slot ? stream->slot->routes : NULL;
 
     return stream;
 }
@@ -338,21 +289,25 @@ route_stream(int installed)
 struct babel_route *
 route_stream_next(struct route_stream *stream)
 {
+    struct route_slot *slot;
+
     if(stream->installed) {
-        while(stream->index < route_slots && !routes[stream->index]->installed)
-            stream->index++;
+        while((slot = stream->slot) && !slot->routes->installed)
+            stream->slot = route_slots_next(&route_slots, slot);
 
-        if(stream->index < route_slots)
-            return routes[stream->index++];
-        else
+        if(slot == NULL)
             return NULL;
+        stream->slot = route_slots_next(&route_slots, slot);
+        return slot->routes;
     } else {
         struct babel_route *next;
         if(!stream->next) {
-            stream->index++;
-            if(stream->index >= route_slots)
+            if(stream->slot == NULL)
+                return NULL;
+            stream->slot = route_slots_next(&route_slots, stream->slot);
+            if(stream->slot == NULL)
                 return NULL;
-            stream->next = routes[stream->index];
+            stream->next = stream->slot->routes;
         }
         next = stream->next;
         stream->next = next->next;
@@ -375,25 +330,26 @@ metric_to_kernel(int metric)
 /* This is used to maintain the invariant that the installed route is at
    the head of the list. */
 static void
-move_installed_route(struct babel_route *route, int i)
+move_installed_route(struct babel_route *route, struct route_slot *slot)
 {
-    assert(i >= 0 && i < route_slots);
+    assert(slot);
     assert(route->installed);
 
-    if(route != routes[i]) {
-        struct babel_route *r = routes[i];
+    if(route != slot->routes) {
+        struct babel_route *r = slot->routes;
         while(r->next != route)
             r = r->next;
         r->next = route->next;
-        route->next = routes[i];
-        routes[i] = route;
+        route->next = slot->routes;
+        slot->routes = route;
     }
 }
 
 void
 install_route(struct babel_route *route)
 {
-    int i, rc;
+    struct route_slot *slot;
+    int rc;
 
     if(route->installed)
         return;
@@ -401,10 +357,10 @@ install_route(struct babel_route *route)
     if(!route_feasible(route))
         flog_err(EC_BABEL_ROUTE, "WARNING: installing unfeasible route (this shouldn't happen).");
 
-    i = find_route_slot(route->src->prefix, route->src->plen, NULL);
-    assert(i >= 0 && i < route_slots);
+    slot = find_route_slot(route->src->prefix, route->src->plen);
+    assert(slot);
 
-    if(routes[i] != route && routes[i]->installed) {
+    if(slot->routes != route && slot->routes->installed) {
         flog_err(EC_BABEL_ROUTE,
 		  "WARNING: attempting to install duplicate route (this shouldn't happen).");
         return;
@@ -422,7 +378,7 @@ install_route(struct babel_route *route)
             return;
     }
     route->installed = 1;
-    move_installed_route(route, i);
+    move_installed_route(route, slot);
 
 }
 
@@ -478,8 +434,8 @@ switch_routes(struct babel_route *old, struct babel_route *new)
 
     old->installed = 0;
     new->installed = 1;
-    move_installed_route(new, find_route_slot(new->src->prefix, new->src->plen,
-                                              NULL));
+    move_installed_route(new, find_route_slot(new->src->prefix,
+                                              new->src->plen));
 }
 
 static void
@@ -691,12 +647,12 @@ find_best_route(const unsigned char *prefix, unsigned char plen, int feasible,
                 struct neighbour *exclude)
 {
     struct babel_route *route = NULL, *r = NULL;
-    int i = find_route_slot(prefix, plen, NULL);
+    struct route_slot *slot = find_route_slot(prefix, plen);
 
-    if(i < 0)
+    if(slot == NULL)
         return NULL;
 
-    route = routes[i];
+    route = slot->routes;
     while(route && !route_acceptable(route, feasible, exclude))
         route = route->next;
 
@@ -748,10 +704,10 @@ update_neighbour_metric(struct neighbour *neigh, int changed)
 {
 
     if(changed) {
-        int i;
+        struct route_slot *slot;
 
-        for(i = 0; i < route_slots; i++) {
-            struct babel_route *r = routes[i];
+        frr_each(route_slots, &route_slots, slot) {
+            struct babel_route *r = slot->routes;
             while(r) {
                 if(r->neigh == neigh)
                     update_route_metric(r);
@@ -764,10 +720,10 @@ update_neighbour_metric(struct neighbour *neigh, int changed)
 void
 update_interface_metric(struct interface *ifp)
 {
-    int i;
+    struct route_slot *slot;
 
-    for(i = 0; i < route_slots; i++) {
-        struct babel_route *r = routes[i];
+    frr_each(route_slots, &route_slots, slot) {
+        struct babel_route *r = slot->routes;
         while(r) {
             if(r->neigh->ifp == ifp)
                 update_route_metric(r);
@@ -984,10 +940,10 @@ consider_route(struct babel_route *route)
 void
 retract_neighbour_routes(struct neighbour *neigh)
 {
-    int i;
+    struct route_slot *slot;
 
-    for(i = 0; i < route_slots; i++) {
-        struct babel_route *r = routes[i];
+    frr_each(route_slots, &route_slots, slot) {
+        struct babel_route *r = slot->routes;
         while(r) {
             if(r->neigh == neigh) {
                 if(r->refmetric != INFINITY) {
@@ -1111,17 +1067,21 @@ route_lost(struct source *src, unsigned oldmetric)
 void
 expire_routes(void)
 {
+    struct route_slot *slot;
     struct babel_route *r;
-    int i;
 
     debugf(BABEL_DEBUG_COMMON,"Expiring old routes.");
 
-    i = 0;
-    while(i < route_slots) {
-        r = routes[i];
+    frr_each_safe(route_slots, &route_slots, slot) {
+    again:
+        r = slot->routes;
         while(r) {
             /* Protect against clock being stepped. */
             if(r->time > babel_now.tv_sec || route_old(r)) {
+                if(route_slot_last(slot, r)) {
+                    flush_route(r);
+                    break;
+                }
                 flush_route(r);
                 goto again;
             }
@@ -1136,8 +1096,5 @@ expire_routes(void)
             }
             r = r->next;
         }
-        i++;
-    again:
-        ;
     }
 }
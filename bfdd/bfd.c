@@ -36,11 +36,17 @@ DEFINE_MTYPE_STATIC(BFDD, BFDD_CONFIG, "long-lived configuration memory")
 DEFINE_MTYPE_STATIC(BFDD, BFDD_PROFILE, "long-lived profile memory")
 DEFINE_MTYPE_STATIC(BFDD, BFDD_SESSION_OBSERVER, "Session observer")
 DEFINE_MTYPE_STATIC(BFDD, BFDD_VRF, "BFD VRF")
+DEFINE_MTYPE_STATIC(BFDD, BFDD_DISC_TABLE, "BFD discriminator table")
+
+/* Low discriminator bits indexing the session table, up to 1M sessions. */
+#define BFD_DISC_INDEX_BITS 20
+#define BFD_DISC_INDEX_MASK ((1U << BFD_DISC_INDEX_BITS) - 1)
 
 /*
  * Prototypes
  */
 static uint32_t ptm_bfd_gen_ID(void);
+static uint32_t bfd_disc_index_alloc(void);
 static void ptm_bfd_echo_xmt_TO(struct bfd_session *bfd);
 static struct bfd_session *bfd_find_disc(struct sockaddr_any *sa,
 					 uint32_t ldisc);
@@ -157,6 +163,9 @@ void bfd_session_apply(struct bfd_session *bs)
 	uint32_t min_tx = bs->timers.desired_min_tx;
 	uint32_t min_rx = bs->timers.required_min_rx;
 
+	/* Changes are applied in software, offload again afterwards. */
+	bfd_offload_release(bs);
+
 	/* Pick the source of configuration. */
 	bp = bs->profile ? bs->profile : &bs->peer_profile;
 
@@ -216,6 +225,12 @@ void bfd_session_apply(struct bfd_session *bs)
 	    && (bs->timers.desired_min_tx != min_tx
 		|| bs->timers.required_min_rx != min_rx))
 		bfd_set_polling(bs);
+
+	/* Multiplier and echo interval are carried by periodic packets. */
+	bfd_tx_update(bs);
+
+	/* Nothing to negotiate: the session can go back to its provider. */
+	bfd_offload_try(bs);
 }
 
 void bfd_profile_remove(struct bfd_session *bs)
@@ -341,6 +356,7 @@ int bfd_session_enable(struct bfd_session *bs)
 		if (bglobal.debug_peer_event)
 			zlog_debug("session-enable: previous socket open");
 
+		bfd_xmttimer_delete(bs);
 		close(bs->sock);
 		bs->sock = -1;
 	}
@@ -383,6 +399,12 @@ int bfd_session_enable(struct bfd_session *bs)
  */
 void bfd_session_disable(struct bfd_session *bs)
 {
+	/* Providers may use the socket too. */
+	bfd_offload_release(bs);
+
+	/* The transmit pthread must be done with the socket. */
+	bfd_xmttimer_delete(bs);
+
 	/* Free up socket resources. */
 	if (bs->sock != -1) {
 		close(bs->sock);
@@ -391,7 +413,6 @@ void bfd_session_disable(struct bfd_session *bs)
 
 	/* Disable all timers. */
 	bfd_recvtimer_delete(bs);
-	bfd_xmttimer_delete(bs);
 	ptm_bfd_echo_stop(bs);
 	bs->vrf = NULL;
 	bs->ifp = NULL;
@@ -402,27 +423,30 @@ void bfd_session_disable(struct bfd_session *bs)
 
 static uint32_t ptm_bfd_gen_ID(void)
 {
-	uint32_t session_id;
+	uint32_t session_id, idx;
+
+	/* The low bits index the discriminator table, see bfd_id_lookup(). */
+	idx = bfd_disc_index_alloc();
+	if (idx == UINT32_MAX)
+		return 0;
 
 	/*
 	 * RFC 5880, Section 6.8.1. recommends that we should generate
-	 * random session identification numbers.
+	 * random session identification numbers: randomize the remaining
+	 * bits.
 	 */
 	do {
-		session_id = ((frr_weak_random() << 16) & 0xFFFF0000)
-			     | (frr_weak_random() & 0x0000FFFF);
-	} while (session_id == 0 || bfd_id_lookup(session_id) != NULL);
+		session_id = frr_weak_random() & ~BFD_DISC_INDEX_MASK;
+	} while (session_id == 0);
 
-	return session_id;
+	return session_id | idx;
 }
 
-void ptm_bfd_start_xmt_timer(struct bfd_session *bfd, bool is_echo)
+/* Also used by the transmit pthread, must not look at any session. */
+uint64_t ptm_bfd_xmt_jitter(uint64_t xmt_TO, uint8_t detect_mult)
 {
-	uint64_t jitter, xmt_TO;
 	int maxpercent;
 
-	xmt_TO = is_echo ? bfd->echo_xmt_TO : bfd->xmt_TO;
-
 	/*
 	 * From section 6.5.2: trasmit interval should be randomly jittered
 	 * between
@@ -430,9 +454,17 @@ void ptm_bfd_start_xmt_timer(struct bfd_session *bfd, bool is_echo)
 	 * be
 	 * between 75% and 90%.
 	 */
-	maxpercent = (bfd->detect_mult == 1) ? 16 : 26;
-	jitter = (xmt_TO * (75 + (frr_weak_random() % maxpercent))) / 100;
+	maxpercent = (detect_mult == 1) ? 16 : 26;
+	return (xmt_TO * (75 + (frr_weak_random() % maxpercent))) / 100;
 	/* XXX remove that division above */
+}
+
+void ptm_bfd_start_xmt_timer(struct bfd_session *bfd, bool is_echo)
+{
+	uint64_t jitter, xmt_TO;
+
+	xmt_TO = is_echo ? bfd->echo_xmt_TO : bfd->xmt_TO;
+	jitter = ptm_bfd_xmt_jitter(xmt_TO, bfd->detect_mult);
 
 	if (is_echo)
 		bfd_echo_xmttimer_update(bfd, jitter);
@@ -449,15 +481,6 @@ static void ptm_bfd_echo_xmt_TO(struct bfd_session *bfd)
 	ptm_bfd_start_xmt_timer(bfd, true);
 }
 
-void ptm_bfd_xmt_TO(struct bfd_session *bfd, int fbit)
-{
-	/* Send the scheduled control packet */
-	ptm_bfd_snd(bfd, fbit);
-
-	/* Restart the timer for next time */
-	ptm_bfd_start_xmt_timer(bfd, false);
-}
-
 void ptm_bfd_echo_stop(struct bfd_session *bfd)
 {
 	bfd->echo_xmt_TO = 0;
@@ -511,6 +534,9 @@ void ptm_bfd_sess_dn(struct bfd_session *bfd, uint8_t diag)
 	bfd->demand_mode = 0;
 	monotime(&bfd->downtime);
 
+	/* Take the session back from its offload provider. */
+	bfd_offload_release(bfd);
+
 	/*
 	 * Only attempt to send if we have a valid socket:
 	 * this function might be called by session disablers and in
@@ -609,15 +635,6 @@ struct bfd_session *ptm_bfd_sess_find(struct bfd_pkt *cp,
 	return bfd_key_lookup(key);
 }
 
-int bfd_xmt_cb(struct thread *t)
-{
-	struct bfd_session *bs = THREAD_ARG(t);
-
-	ptm_bfd_xmt_TO(bs, 0);
-
-	return 0;
-}
-
 int bfd_echo_xmt_cb(struct thread *t)
 {
 	struct bfd_session *bs = THREAD_ARG(t);
@@ -632,10 +649,29 @@ int bfd_echo_xmt_cb(struct thread *t)
 int bfd_recvtimer_cb(struct thread *t)
 {
 	struct bfd_session *bs = THREAD_ARG(t);
+	struct timeval now;
+	int64_t slip;
+
+	/* Keep track of how late the main thread got here. */
+	monotime(&now);
+	slip = now.tv_sec * 1000000LL + now.tv_usec - bs->recvtimer_deadline;
+	if (slip < 0)
+		slip = 0;
+	bs->stats.detect_slip_count++;
+	bs->stats.detect_slip_total += slip;
+	if ((uint64_t)slip > bs->stats.detect_slip_max)
+		bs->stats.detect_slip_max = slip;
 
 	switch (bs->ses_state) {
 	case PTM_BFD_INIT:
 	case PTM_BFD_UP:
+		/*
+		 * If the main thread was busy the packets that would have
+		 * kept this session up may be waiting in the socket.
+		 */
+		if (bfd_recv_drain(bs))
+			break;
+
 		ptm_bfd_sess_dn(bs, BD_CONTROL_EXPIRED);
 		bfd_recvtimer_update(bs);
 		break;
@@ -645,6 +681,7 @@ int bfd_recvtimer_cb(struct thread *t)
 		 * 6.5.1)
 		 */
 		bs->discrs.remote_discr = 0;
+		bfd_tx_update(bs);
 		break;
 	}
 
@@ -731,6 +768,9 @@ int bfd_session_update_label(struct bfd_session *bs, const char *nlabel)
 static void _bfd_session_update(struct bfd_session *bs,
 				struct bfd_peer_cfg *bpc)
 {
+	/* Changes are applied in software, see bfd_session_apply(). */
+	bfd_offload_release(bs);
+
 	if (bpc->bpc_has_txinterval) {
 		bs->timers.desired_min_tx = bpc->bpc_txinterval * 1000;
 		bs->peer_profile.min_tx = bs->timers.desired_min_tx;
@@ -783,6 +823,8 @@ static void _bfd_session_update(struct bfd_session *bs,
 	 */
 	if (bpc->bpc_has_profile)
 		bfd_profile_apply(bpc->bpc_profile, bs);
+
+	bfd_offload_try(bs);
 }
 
 static int bfd_session_update(struct bfd_session *bs, struct bfd_peer_cfg *bpc)
@@ -899,6 +941,12 @@ struct bfd_session *bs_registrate(struct bfd_session *bfd)
 	/* Registrate session into data structures. */
 	bfd_key_insert(bfd);
 	bfd->discrs.my_discr = ptm_bfd_gen_ID();
+	if (bfd->discrs.my_discr == 0) {
+		zlog_err("session-new: no discriminator available for %s",
+			 bs_to_string(bfd));
+		bfd_session_free(bfd);
+		return NULL;
+	}
 	bfd_id_insert(bfd);
 
 	/* Try to enable session and schedule for packet receive/send. */
@@ -958,6 +1006,9 @@ void bfd_set_polling(struct bfd_session *bs)
 	 * RFC 5880, Section 6.8.3.
 	 */
 	bs->polling = 1;
+
+	/* Periodic packets carry the poll bit from now on. */
+	bfd_tx_update(bs);
 }
 
 /*
@@ -1056,6 +1107,9 @@ static void bs_neighbour_admin_down_handler(struct bfd_session *bfd,
 	bfd->demand_mode = 0;
 	monotime(&bfd->downtime);
 
+	/* Take the session back from its offload provider. */
+	bfd_offload_release(bfd);
+
 	/* Slow down the control packets, the connection is down. */
 	bs_set_slow_timers(bfd);
 
@@ -1238,6 +1292,9 @@ void bs_final_handler(struct bfd_session *bs)
 
 	/* Notify watchers about changed timers. */
 	control_notify_config(BCM_NOTIFY_CONFIG_UPDATE, bs);
+
+	/* Timers are negotiated, hand the session to a provider if any. */
+	bfd_offload_try(bs);
 }
 
 void bs_set_slow_timers(struct bfd_session *bs)
@@ -1255,6 +1312,8 @@ void bs_set_slow_timers(struct bfd_session *bs)
 	/* Set the appropriated timeouts for slow connection. */
 	bs->detect_TO = (BFD_DEFDETECTMULT * BFD_DEF_SLOWTX);
 	bs->xmt_TO = BFD_DEF_SLOWTX;
+
+	bfd_tx_update(bs);
 }
 
 void bfd_set_echo(struct bfd_session *bs, bool echo)
@@ -1601,6 +1660,15 @@ void bs_to_bpc(struct bfd_session *bs, struct bfd_peer_cfg *bpc)
 static struct hash *bfd_id_hash;
 static struct hash *bfd_key_hash;
 
+/*
+ * Sessions indexed by the low bits of our discriminator, so received
+ * packets carrying "your discriminator" find their session with an array
+ * access. Indexes are handed out lowest first to keep the table dense.
+ */
+static struct bfd_session **bfd_disc_table;
+static uint32_t bfd_disc_size;
+static uint32_t bfd_disc_hint;
+
 static unsigned int bfd_id_hash_do(const void *p);
 static unsigned int bfd_key_hash_do(const void *p);
 
@@ -1642,14 +1710,49 @@ static bool bfd_key_hash_cmp(const void *n1, const void *n2)
  * Hash public interface / exported functions.
  */
 
+/* Returns a free discriminator table index or UINT32_MAX. */
+static uint32_t bfd_disc_index_alloc(void)
+{
+	uint32_t idx, size;
+
+	for (idx = bfd_disc_hint; idx < bfd_disc_size; idx++) {
+		if (bfd_disc_table[idx] == NULL) {
+			bfd_disc_hint = idx + 1;
+			return idx;
+		}
+	}
+
+	/* Full: grow the table. */
+	if (bfd_disc_size > BFD_DISC_INDEX_MASK)
+		return UINT32_MAX;
+
+	size = bfd_disc_size ? bfd_disc_size * 2 : 64;
+	bfd_disc_table = XREALLOC(MTYPE_BFDD_DISC_TABLE, bfd_disc_table,
+				  size * sizeof(*bfd_disc_table));
+	memset(&bfd_disc_table[bfd_disc_size], 0,
+	       (size - bfd_disc_size) * sizeof(*bfd_disc_table));
+
+	idx = bfd_disc_size;
+	bfd_disc_size = size;
+	bfd_disc_hint = idx + 1;
+
+	return idx;
+}
+
 /* Lookup functions. */
 struct bfd_session *bfd_id_lookup(uint32_t id)
 {
-	struct bfd_session bs;
+	uint32_t idx = id & BFD_DISC_INDEX_MASK;
+	struct bfd_session *bs;
 
-	bs.discrs.my_discr = id;
+	if (idx >= bfd_disc_size)
+		return NULL;
+
+	bs = bfd_disc_table[idx];
+	if (bs == NULL || bs->discrs.my_discr != id)
+		return NULL;
 
-	return hash_lookup(bfd_id_hash, &bs);
+	return bs;
 }
 
 struct bfd_key_walk_partial_lookup {
@@ -1778,6 +1881,13 @@ struct bfd_session *bfd_key_lookup(struct bfd_key key)
 struct bfd_session *bfd_id_delete(uint32_t id)
 {
 	struct bfd_session bs;
+	uint32_t idx = id & BFD_DISC_INDEX_MASK;
+
+	if (bfd_id_lookup(id) != NULL) {
+		bfd_disc_table[idx] = NULL;
+		if (idx < bfd_disc_hint)
+			bfd_disc_hint = idx;
+	}
 
 	bs.discrs.my_discr = id;
 
@@ -1817,7 +1927,16 @@ void bfd_key_iterate(hash_iter_func hif, void *arg)
  */
 bool bfd_id_insert(struct bfd_session *bs)
 {
-	return (hash_get(bfd_id_hash, bs, hash_alloc_intern) == bs);
+	uint32_t idx = bs->discrs.my_discr & BFD_DISC_INDEX_MASK;
+
+	if (hash_get(bfd_id_hash, bs, hash_alloc_intern) != bs)
+		return false;
+
+	/* Index reserved by ptm_bfd_gen_ID(). */
+	assert(idx < bfd_disc_size && bfd_disc_table[idx] == NULL);
+	bfd_disc_table[idx] = bs;
+
+	return true;
 }
 
 bool bfd_key_insert(struct bfd_session *bs)
@@ -1859,6 +1978,9 @@ void bfd_shutdown(void)
 	/* Now free the hashes themselves. */
 	hash_free(bfd_id_hash);
 	hash_free(bfd_key_hash);
+	XFREE(MTYPE_BFDD_DISC_TABLE, bfd_disc_table);
+	bfd_disc_size = 0;
+	bfd_disc_hint = 0;
 
 	/* Free all profile allocations. */
 	while ((bp = TAILQ_FIRST(&bplist)) != NULL)
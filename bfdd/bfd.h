@@ -27,10 +27,12 @@
 #include <stdarg.h>
 #include <stdint.h>
 
+#include "lib/frr_pthread.h"
 #include "lib/hash.h"
 #include "lib/libfrr.h"
 #include "lib/qobj.h"
 #include "lib/queue.h"
+#include "lib/typesafe.h"
 #include "lib/vrf.h"
 
 #include "bfdctl.h"
@@ -191,6 +193,38 @@ struct bfd_session_stats {
 	uint64_t session_up;
 	uint64_t session_down;
 	uint64_t znotification;
+	/* Detection timer expirations and how late they ran (microseconds). */
+	uint64_t detect_slip_count;
+	uint64_t detect_slip_total;
+	uint64_t detect_slip_max;
+};
+
+PREDECL_DLIST(bfd_tx_slot);
+
+/*
+ * Periodic control packet transmission state, used by the transmit
+ * pthread (see event.c). The pthread never looks at the rest of the
+ * session: the main thread keeps a copy of the next packet and of its
+ * destination here. Everything in it is protected by bglobal.bg_tx_mtx.
+ */
+struct bfd_tx {
+	struct bfd_tx_slot_item item;
+	bool armed;
+	/* Timing wheel slot and next transmission (monotonic microseconds) */
+	unsigned int slot;
+	int64_t deadline;
+
+	uint64_t xmt_TO;
+	uint8_t detect_mult;
+	int sock;
+	struct sockaddr_any dst;
+	socklen_t dstlen;
+	struct bfd_pkt pkt;
+
+	/* Transmissions and how late they were sent (microseconds). */
+	uint64_t slip_count;
+	uint64_t slip_total;
+	uint64_t slip_max;
 };
 
 /**
@@ -256,9 +290,11 @@ struct bfd_session {
 	uint64_t detect_TO;
 	struct thread *echo_recvtimer_ev;
 	struct thread *recvtimer_ev;
+	/* When recvtimer_ev is due, monotonic microseconds. */
+	int64_t recvtimer_deadline;
 	uint64_t xmt_TO;
 	uint64_t echo_xmt_TO;
-	struct thread *xmttimer_ev;
+	struct bfd_tx tx;
 	struct thread *echo_xmttimer_ev;
 	uint64_t echo_detect_TO;
 
@@ -287,6 +323,9 @@ struct bfd_session {
 	uint8_t remote_diag;
 	struct bfd_timers remote_timers;
 
+	/* Provider running this session, see bfd_offload.c. */
+	struct bfd_offload_provider *offload;
+
 	uint64_t refcount; /* number of pointers referencing this. */
 };
 
@@ -458,6 +497,19 @@ struct bfd_global {
 	 * - Network system call failures.
 	 */
 	bool debug_network;
+
+	/* Control packet transmit pthread and its timing wheel (event.c). */
+#define BFD_TX_TICK 1000 /* microseconds. */
+#define BFD_TX_SLOTS 1024
+	struct frr_pthread *bg_tx_pth;
+	pthread_mutex_t bg_tx_mtx;
+	struct bfd_tx_slot_head bg_tx_wheel[BFD_TX_SLOTS];
+	size_t bg_tx_count;
+	/* Next tick to process and tick of the next wake up (0: idle). */
+	int64_t bg_tx_tick;
+	int64_t bg_tx_wakeup;
+	struct thread *bg_tx_ev;
+	struct thread *bg_tx_kick;
 };
 
 extern struct bfd_global bglobal;
@@ -519,10 +571,54 @@ int bp_peer_socketv6(const struct bfd_session *bs);
 int bp_echo_socket(const struct vrf *vrf);
 int bp_echov6_socket(const struct vrf *vrf);
 
+void bp_peer_sockaddr(struct bfd_session *bs, uint16_t *port,
+		      struct sockaddr_any *sa, socklen_t *slen);
+void ptm_bfd_pkt_encode(struct bfd_session *bfd, int fbit,
+			struct bfd_pkt *cp);
 void ptm_bfd_snd(struct bfd_session *bfd, int fbit);
 void ptm_bfd_echo_snd(struct bfd_session *bfd);
 
 int bfd_recv_cb(struct thread *t);
+bool bfd_recv_drain(struct bfd_session *bs);
+
+
+/*
+ * bfd_offload.c
+ *
+ * Hands established sessions to offload providers.
+ */
+struct bfd_offload_provider {
+	/* Provider name, shown in the session output. */
+	const char *name;
+	/* Providers with lower values are tried first. */
+	int prio;
+
+	/*
+	 * Take over control packet transmission and failure detection of
+	 * an established session. Returns `true` if the session was
+	 * accepted.
+	 */
+	bool (*install)(struct bfd_offload_provider *prov,
+			struct bfd_session *bs);
+	/* Stop running the session, bfdd takes it back. */
+	void (*uninstall)(struct bfd_offload_provider *prov,
+			  struct bfd_session *bs);
+
+	/* Provider private data. */
+	void *arg;
+
+	TAILQ_ENTRY(bfd_offload_provider) entry;
+};
+
+void bfd_offload_provider_register(struct bfd_offload_provider *prov);
+void bfd_offload_provider_unregister(struct bfd_offload_provider *prov);
+
+/* Called by providers. */
+void bfd_offload_session_down(struct bfd_session *bs, uint8_t diag);
+void bfd_offload_session_return(struct bfd_session *bs);
+
+bool bfd_offload_try(struct bfd_session *bs);
+void bfd_offload_release(struct bfd_session *bs);
 
 
 /*
@@ -547,6 +643,10 @@ void bfd_echo_recvtimer_assign(struct bfd_session *bs, bfd_ev_cb cb, int sd);
 void bfd_xmttimer_assign(struct bfd_session *bs, bfd_ev_cb cb);
 void bfd_echo_xmttimer_assign(struct bfd_session *bs, bfd_ev_cb cb);
 
+void bfd_tx_init(void);
+void bfd_tx_run(void);
+void bfd_tx_update(struct bfd_session *bs);
+
 
 /*
  * bfd.c
@@ -561,7 +661,7 @@ void ptm_bfd_sess_dn(struct bfd_session *bfd, uint8_t diag);
 void ptm_bfd_sess_up(struct bfd_session *bfd);
 void ptm_bfd_echo_stop(struct bfd_session *bfd);
 void ptm_bfd_echo_start(struct bfd_session *bfd);
-void ptm_bfd_xmt_TO(struct bfd_session *bfd, int fbit);
+uint64_t ptm_bfd_xmt_jitter(uint64_t xmt_TO, uint8_t detect_mult);
 void ptm_bfd_start_xmt_timer(struct bfd_session *bfd, bool is_echo);
 struct bfd_session *ptm_bfd_sess_find(struct bfd_pkt *cp,
 				      struct sockaddr_any *peer,
@@ -656,7 +756,6 @@ extern struct thread_master *master;
 
 int bfd_recvtimer_cb(struct thread *t);
 int bfd_echo_recvtimer_cb(struct thread *t);
-int bfd_xmt_cb(struct thread *t);
 int bfd_echo_xmt_cb(struct thread *t);
 
 extern struct in6_addr zero_addr;
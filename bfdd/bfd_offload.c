@@ -0,0 +1,152 @@
+/*
+ * BFD session offload providers.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Offload providers (a NIC, an XDP program, an external agent...) take
+ * over periodic transmission and failure detection of established
+ * sessions, the same way zebra hands routes to dataplane providers.
+ *
+ * bfdd keeps running the state machine: a session is offered to the
+ * providers, in priority order, once it is up and its timers have been
+ * negotiated. While offloaded bfdd neither transmits nor expects control
+ * packets for it. Any local change (configuration, shutdown, session
+ * removal) takes the session back first and offers it again when the
+ * poll sequence that follows completes.
+ *
+ * Providers tell bfdd about failures with bfd_offload_session_down(),
+ * which goes through the regular down path so that clients get the same
+ * notifications as for software sessions, or give a session back with
+ * bfd_offload_session_return().
+ *
+ * Everything here runs in the main thread, providers with their own
+ * threads must schedule their calls into bfdd on `master`.
+ */
+
+#include <zebra.h>
+
+#include "bfd.h"
+
+TAILQ_HEAD(bfd_offload_list, bfd_offload_provider);
+static struct bfd_offload_list bfd_offload_providers =
+	TAILQ_HEAD_INITIALIZER(bfd_offload_providers);
+
+void bfd_offload_provider_register(struct bfd_offload_provider *prov)
+{
+	struct bfd_offload_provider *p;
+
+	TAILQ_FOREACH (p, &bfd_offload_providers, entry) {
+		if (p->prio > prov->prio)
+			break;
+	}
+
+	if (p)
+		TAILQ_INSERT_BEFORE(p, prov, entry);
+	else
+		TAILQ_INSERT_TAIL(&bfd_offload_providers, prov, entry);
+
+	zlog_info("offload: registered provider %s (priority %d)", prov->name,
+		  prov->prio);
+}
+
+static void _bfd_offload_release(struct hash_bucket *hb, void *arg)
+{
+	struct bfd_session *bs = hb->data;
+
+	if (bs->offload == arg)
+		bfd_offload_release(bs);
+}
+
+void bfd_offload_provider_unregister(struct bfd_offload_provider *prov)
+{
+	/* Take its sessions back before it goes away. */
+	bfd_id_iterate(_bfd_offload_release, prov);
+
+	TAILQ_REMOVE(&bfd_offload_providers, prov, entry);
+
+	zlog_info("offload: unregistered provider %s", prov->name);
+}
+
+bool bfd_offload_try(struct bfd_session *bs)
+{
+	struct bfd_offload_provider *prov;
+
+	if (bs->offload || TAILQ_EMPTY(&bfd_offload_providers))
+		return false;
+
+	/* Only established sessions with negotiated timers. */
+	if (bs->ses_state != PTM_BFD_UP || bs->polling)
+		return false;
+
+	/* Echo and demand mode are not offloaded. */
+	if (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_ECHO) || bs->demand_mode)
+		return false;
+
+	TAILQ_FOREACH (prov, &bfd_offload_providers, entry) {
+		if (!prov->install(prov, bs))
+			continue;
+
+		bs->offload = prov;
+
+		/* The provider transmits and detects failures from now on. */
+		bfd_xmttimer_delete(bs);
+		bfd_recvtimer_delete(bs);
+
+		if (bglobal.debug_peer_event)
+			zlog_debug("offload: [%s] installed on %s",
+				   bs_to_string(bs), prov->name);
+
+		return true;
+	}
+
+	return false;
+}
+
+void bfd_offload_release(struct bfd_session *bs)
+{
+	struct bfd_offload_provider *prov = bs->offload;
+
+	if (prov == NULL)
+		return;
+
+	prov->uninstall(prov, bs);
+	bs->offload = NULL;
+
+	if (bglobal.debug_peer_event)
+		zlog_debug("offload: [%s] removed from %s", bs_to_string(bs),
+			   prov->name);
+
+	/* Resume in software, a full detection time from now. */
+	if (bs->ses_state == PTM_BFD_UP) {
+		bfd_recvtimer_update(bs);
+		ptm_bfd_start_xmt_timer(bs, false);
+	}
+}
+
+void bfd_offload_session_down(struct bfd_session *bs, uint8_t diag)
+{
+	if (bs->offload == NULL)
+		return;
+
+	/* Takes the session back from the provider too. */
+	ptm_bfd_sess_dn(bs, diag);
+}
+
+void bfd_offload_session_return(struct bfd_session *bs)
+{
+	bfd_offload_release(bs);
+}
@@ -66,51 +66,52 @@ static void bp_bind_ipv6(int sd, uint16_t port);
 /*
  * Functions
  */
-int _ptm_bfd_send(struct bfd_session *bs, uint16_t *port, const void *data,
-		  size_t datalen)
+/* Fill in where control packets for this session go. */
+void bp_peer_sockaddr(struct bfd_session *bs, uint16_t *port,
+		      struct sockaddr_any *sa, socklen_t *slen)
 {
-	struct sockaddr *sa;
-	struct sockaddr_in sin;
-	struct sockaddr_in6 sin6;
-	socklen_t slen;
-	ssize_t rv;
-	int sd = -1;
-
+	memset(sa, 0, sizeof(*sa));
 	if (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_IPV6)) {
-		memset(&sin6, 0, sizeof(sin6));
-		sin6.sin6_family = AF_INET6;
-		memcpy(&sin6.sin6_addr, &bs->key.peer, sizeof(sin6.sin6_addr));
-		if (bs->ifp && IN6_IS_ADDR_LINKLOCAL(&sin6.sin6_addr))
-			sin6.sin6_scope_id = bs->ifp->ifindex;
+		sa->sa_sin6.sin6_family = AF_INET6;
+		memcpy(&sa->sa_sin6.sin6_addr, &bs->key.peer,
+		       sizeof(sa->sa_sin6.sin6_addr));
+		if (bs->ifp && IN6_IS_ADDR_LINKLOCAL(&sa->sa_sin6.sin6_addr))
+			sa->sa_sin6.sin6_scope_id = bs->ifp->ifindex;
 
-		sin6.sin6_port =
+		sa->sa_sin6.sin6_port =
 			(port) ? *port
 			       : (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_MH))
 					 ? htons(BFD_DEF_MHOP_DEST_PORT)
 					 : htons(BFD_DEFDESTPORT);
 
-		sd = bs->sock;
-		sa = (struct sockaddr *)&sin6;
-		slen = sizeof(sin6);
+		*slen = sizeof(sa->sa_sin6);
 	} else {
-		memset(&sin, 0, sizeof(sin));
-		sin.sin_family = AF_INET;
-		memcpy(&sin.sin_addr, &bs->key.peer, sizeof(sin.sin_addr));
-		sin.sin_port =
+		sa->sa_sin.sin_family = AF_INET;
+		memcpy(&sa->sa_sin.sin_addr, &bs->key.peer,
+		       sizeof(sa->sa_sin.sin_addr));
+		sa->sa_sin.sin_port =
 			(port) ? *port
 			       : (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_MH))
 					 ? htons(BFD_DEF_MHOP_DEST_PORT)
 					 : htons(BFD_DEFDESTPORT);
 
-		sd = bs->sock;
-		sa = (struct sockaddr *)&sin;
-		slen = sizeof(sin);
+		*slen = sizeof(sa->sa_sin);
 	}
 
 #ifdef HAVE_STRUCT_SOCKADDR_SA_LEN
-	sa->sa_len = slen;
+	((struct sockaddr *)sa)->sa_len = *slen;
 #endif /* HAVE_STRUCT_SOCKADDR_SA_LEN */
-	rv = sendto(sd, data, datalen, 0, sa, slen);
+}
+
+int _ptm_bfd_send(struct bfd_session *bs, uint16_t *port, const void *data,
+		  size_t datalen)
+{
+	struct sockaddr_any sa;
+	socklen_t slen;
+	ssize_t rv;
+
+	bp_peer_sockaddr(bs, port, &sa, &slen);
+	rv = sendto(bs->sock, data, datalen, 0, (struct sockaddr *)&sa, slen);
 	if (rv <= 0) {
 		if (bglobal.debug_network)
 			zlog_debug("packet-send: send failure: %s",
@@ -222,38 +223,38 @@ static int ptm_bfd_process_echo_pkt(struct bfd_vrf_global *bvrf, int s)
 	return 0;
 }
 
-void ptm_bfd_snd(struct bfd_session *bfd, int fbit)
+void ptm_bfd_pkt_encode(struct bfd_session *bfd, int fbit, struct bfd_pkt *cp)
 {
-	struct bfd_pkt cp = {};
+	memset(cp, 0, sizeof(*cp));
 
 	/* Set fields according to section 6.5.7 */
-	cp.diag = bfd->local_diag;
-	BFD_SETVER(cp.diag, BFD_VERSION);
-	cp.flags = 0;
-	BFD_SETSTATE(cp.flags, bfd->ses_state);
+	cp->diag = bfd->local_diag;
+	BFD_SETVER(cp->diag, BFD_VERSION);
+	cp->flags = 0;
+	BFD_SETSTATE(cp->flags, bfd->ses_state);
 
 	if (CHECK_FLAG(bfd->flags, BFD_SESS_FLAG_CBIT))
-		BFD_SETCBIT(cp.flags, BFD_CBIT);
+		BFD_SETCBIT(cp->flags, BFD_CBIT);
 
-	BFD_SETDEMANDBIT(cp.flags, BFD_DEF_DEMAND);
+	BFD_SETDEMANDBIT(cp->flags, BFD_DEF_DEMAND);
 
 	/*
 	 * Polling and Final can't be set at the same time.
 	 *
 	 * RFC 5880, Section 6.5.
 	 */
-	BFD_SETFBIT(cp.flags, fbit);
+	BFD_SETFBIT(cp->flags, fbit);
 	if (fbit == 0)
-		BFD_SETPBIT(cp.flags, bfd->polling);
+		BFD_SETPBIT(cp->flags, bfd->polling);
 
-	cp.detect_mult = bfd->detect_mult;
-	cp.len = BFD_PKT_LEN;
-	cp.discrs.my_discr = htonl(bfd->discrs.my_discr);
-	cp.discrs.remote_discr = htonl(bfd->discrs.remote_discr);
+	cp->detect_mult = bfd->detect_mult;
+	cp->len = BFD_PKT_LEN;
+	cp->discrs.my_discr = htonl(bfd->discrs.my_discr);
+	cp->discrs.remote_discr = htonl(bfd->discrs.remote_discr);
 	if (bfd->polling) {
-		cp.timers.desired_min_tx =
+		cp->timers.desired_min_tx =
 			htonl(bfd->timers.desired_min_tx);
-		cp.timers.required_min_rx =
+		cp->timers.required_min_rx =
 			htonl(bfd->timers.required_min_rx);
 	} else {
 		/*
@@ -262,56 +263,48 @@ void ptm_bfd_snd(struct bfd_session *bfd, int fbit)
 		 * the oportunity to learn. See `bs_final_handler` for
 		 * more information.
 		 */
-		cp.timers.desired_min_tx =
+		cp->timers.desired_min_tx =
 			htonl(bfd->cur_timers.desired_min_tx);
-		cp.timers.required_min_rx =
+		cp->timers.required_min_rx =
 			htonl(bfd->cur_timers.required_min_rx);
 	}
-	cp.timers.required_min_echo = htonl(bfd->timers.required_min_echo);
-
-	if (_ptm_bfd_send(bfd, NULL, &cp, BFD_PKT_LEN) != 0)
-		return;
-
-	bfd->stats.tx_ctrl_pkt++;
+	cp->timers.required_min_echo = htonl(bfd->timers.required_min_echo);
 }
 
-ssize_t bfd_recv_ipv4(int sd, uint8_t *msgbuf, size_t msgbuflen, uint8_t *ttl,
-		      ifindex_t *ifindex, struct sockaddr_any *local,
-		      struct sockaddr_any *peer)
+void ptm_bfd_snd(struct bfd_session *bfd, int fbit)
 {
-	struct cmsghdr *cm;
-	ssize_t mlen;
-	struct sockaddr_in msgaddr;
-	struct msghdr msghdr;
-	struct iovec iov[1];
-	uint8_t cmsgbuf[255];
+	struct bfd_pkt cp;
 
-	/* Prepare the recvmsg params. */
-	iov[0].iov_base = msgbuf;
-	iov[0].iov_len = msgbuflen;
+	ptm_bfd_pkt_encode(bfd, fbit, &cp);
 
-	memset(&msghdr, 0, sizeof(msghdr));
-	msghdr.msg_name = &msgaddr;
-	msghdr.msg_namelen = sizeof(msgaddr);
-	msghdr.msg_iov = iov;
-	msghdr.msg_iovlen = 1;
-	msghdr.msg_control = cmsgbuf;
-	msghdr.msg_controllen = sizeof(cmsgbuf);
+	/* Whatever changed also goes into the periodic packets. */
+	bfd_tx_update(bfd);
 
-	mlen = recvmsg(sd, &msghdr, MSG_DONTWAIT);
-	if (mlen == -1) {
-		if (errno != EAGAIN)
-			zlog_err("ipv4-recv: recv failed: %s", strerror(errno));
+	if (_ptm_bfd_send(bfd, NULL, &cp, BFD_PKT_LEN) != 0)
+		return;
 
-		return -1;
+	/* Shared with the transmit pthread. */
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		bfd->stats.tx_ctrl_pkt++;
 	}
+}
+
+/*
+ * Fill in the source, destination, TTL and interface of a received IPv4
+ * packet. Returns -1 if the packet must be dropped.
+ */
+static int bfd_recv_ipv4_cmsg(struct msghdr *msghdr, uint8_t *ttl,
+			      ifindex_t *ifindex, struct sockaddr_any *local,
+			      struct sockaddr_any *peer)
+{
+	struct cmsghdr *cm;
 
 	/* Get source address */
-	peer->sa_sin = *((struct sockaddr_in *)(msghdr.msg_name));
+	peer->sa_sin = *((struct sockaddr_in *)(msghdr->msg_name));
 
 	/* Get and check TTL */
-	for (cm = CMSG_FIRSTHDR(&msghdr); cm != NULL;
-	     cm = CMSG_NXTHDR(&msghdr, cm)) {
+	for (cm = CMSG_FIRSTHDR(msghdr); cm != NULL;
+	     cm = CMSG_NXTHDR(msghdr, cm)) {
 		if (cm->cmsg_level != IPPROTO_IP)
 			continue;
 
@@ -380,50 +373,63 @@ ssize_t bfd_recv_ipv4(int sd, uint8_t *msgbuf, size_t msgbuflen, uint8_t *ttl,
 
 	/* OS agnostic way of getting interface name. */
 	if (*ifindex == IFINDEX_INTERNAL)
-		*ifindex = getsockopt_ifindex(AF_INET, &msghdr);
+		*ifindex = getsockopt_ifindex(AF_INET, msghdr);
 
-	return mlen;
+	return 0;
 }
 
-ssize_t bfd_recv_ipv6(int sd, uint8_t *msgbuf, size_t msgbuflen, uint8_t *ttl,
+
+ssize_t bfd_recv_ipv4(int sd, uint8_t *msgbuf, size_t msgbuflen, uint8_t *ttl,
 		      ifindex_t *ifindex, struct sockaddr_any *local,
 		      struct sockaddr_any *peer)
 {
-	struct cmsghdr *cm;
-	struct in6_pktinfo *pi6 = NULL;
 	ssize_t mlen;
-	uint32_t ttlval;
-	struct sockaddr_in6 msgaddr6;
-	struct msghdr msghdr6;
+	struct sockaddr_in msgaddr;
+	struct msghdr msghdr;
 	struct iovec iov[1];
-	uint8_t cmsgbuf6[255];
+	uint8_t cmsgbuf[255];
 
 	/* Prepare the recvmsg params. */
 	iov[0].iov_base = msgbuf;
 	iov[0].iov_len = msgbuflen;
 
-	memset(&msghdr6, 0, sizeof(msghdr6));
-	msghdr6.msg_name = &msgaddr6;
-	msghdr6.msg_namelen = sizeof(msgaddr6);
-	msghdr6.msg_iov = iov;
-	msghdr6.msg_iovlen = 1;
-	msghdr6.msg_control = cmsgbuf6;
-	msghdr6.msg_controllen = sizeof(cmsgbuf6);
+	memset(&msghdr, 0, sizeof(msghdr));
+	msghdr.msg_name = &msgaddr;
+	msghdr.msg_namelen = sizeof(msgaddr);
+	msghdr.msg_iov = iov;
+	msghdr.msg_iovlen = 1;
+	msghdr.msg_control = cmsgbuf;
+	msghdr.msg_controllen = sizeof(cmsgbuf);
 
-	mlen = recvmsg(sd, &msghdr6, MSG_DONTWAIT);
+	mlen = recvmsg(sd, &msghdr, MSG_DONTWAIT);
 	if (mlen == -1) {
 		if (errno != EAGAIN)
-			zlog_err("ipv6-recv: recv failed: %s", strerror(errno));
+			zlog_err("ipv4-recv: recv failed: %s", strerror(errno));
 
 		return -1;
 	}
 
+	if (bfd_recv_ipv4_cmsg(&msghdr, ttl, ifindex, local, peer) != 0)
+		return -1;
+
+	return mlen;
+}
+
+/* IPv6 version of bfd_recv_ipv4_cmsg(). */
+static int bfd_recv_ipv6_cmsg(struct msghdr *msghdr, uint8_t *ttl,
+			      ifindex_t *ifindex, struct sockaddr_any *local,
+			      struct sockaddr_any *peer)
+{
+	struct cmsghdr *cm;
+	struct in6_pktinfo *pi6 = NULL;
+	uint32_t ttlval;
+
 	/* Get source address */
-	peer->sa_sin6 = *((struct sockaddr_in6 *)(msghdr6.msg_name));
+	peer->sa_sin6 = *((struct sockaddr_in6 *)(msghdr->msg_name));
 
 	/* Get and check TTL */
-	for (cm = CMSG_FIRSTHDR(&msghdr6); cm != NULL;
-	     cm = CMSG_NXTHDR(&msghdr6, cm)) {
+	for (cm = CMSG_FIRSTHDR(msghdr); cm != NULL;
+	     cm = CMSG_NXTHDR(msghdr, cm)) {
 		if (cm->cmsg_level != IPPROTO_IPV6)
 			continue;
 
@@ -459,6 +465,43 @@ ssize_t bfd_recv_ipv6(int sd, uint8_t *msgbuf, size_t msgbuflen, uint8_t *ttl,
 		}
 	}
 
+	return 0;
+}
+
+
+ssize_t bfd_recv_ipv6(int sd, uint8_t *msgbuf, size_t msgbuflen, uint8_t *ttl,
+		      ifindex_t *ifindex, struct sockaddr_any *local,
+		      struct sockaddr_any *peer)
+{
+	ssize_t mlen;
+	struct sockaddr_in6 msgaddr6;
+	struct msghdr msghdr6;
+	struct iovec iov[1];
+	uint8_t cmsgbuf6[255];
+
+	/* Prepare the recvmsg params. */
+	iov[0].iov_base = msgbuf;
+	iov[0].iov_len = msgbuflen;
+
+	memset(&msghdr6, 0, sizeof(msghdr6));
+	msghdr6.msg_name = &msgaddr6;
+	msghdr6.msg_namelen = sizeof(msgaddr6);
+	msghdr6.msg_iov = iov;
+	msghdr6.msg_iovlen = 1;
+	msghdr6.msg_control = cmsgbuf6;
+	msghdr6.msg_controllen = sizeof(cmsgbuf6);
+
+	mlen = recvmsg(sd, &msghdr6, MSG_DONTWAIT);
+	if (mlen == -1) {
+		if (errno != EAGAIN)
+			zlog_err("ipv6-recv: recv failed: %s", strerror(errno));
+
+		return -1;
+	}
+
+	if (bfd_recv_ipv6_cmsg(&msghdr6, ttl, ifindex, local, peer) != 0)
+		return -1;
+
 	return mlen;
 }
 
@@ -531,59 +574,28 @@ static void cp_debug(bool mhop, struct sockaddr_any *peer,
 		   mhop ? "yes" : "no", peerstr, localstr, portstr, vrfstr);
 }
 
-int bfd_recv_cb(struct thread *t)
+/* Process one control packet read from `bvrf` sockets. */
+static void bfd_recv_control_pkt(struct bfd_vrf_global *bvrf, bool is_mhop,
+				 uint8_t *msgbuf, ssize_t mlen, uint8_t ttl,
+				 ifindex_t ifindex, struct sockaddr_any *local,
+				 struct sockaddr_any *peer)
 {
-	int sd = THREAD_FD(t);
 	struct bfd_session *bfd;
 	struct bfd_pkt *cp;
-	bool is_mhop;
-	ssize_t mlen = 0;
-	uint8_t ttl = 0;
-	vrf_id_t vrfid;
-	ifindex_t ifindex = IFINDEX_INTERNAL;
-	struct sockaddr_any local, peer;
-	uint8_t msgbuf[1516];
-	struct bfd_vrf_global *bvrf = THREAD_ARG(t);
-
-	vrfid = bvrf->vrf->vrf_id;
-
-	/* Schedule next read. */
-	bfd_sd_reschedule(bvrf, sd);
-
-	/* Handle echo packets. */
-	if (sd == bvrf->bg_echo || sd == bvrf->bg_echov6) {
-		ptm_bfd_process_echo_pkt(bvrf, sd);
-		return 0;
-	}
-
-	/* Sanitize input/output. */
-	memset(&local, 0, sizeof(local));
-	memset(&peer, 0, sizeof(peer));
-
-	/* Handle control packets. */
-	is_mhop = false;
-	if (sd == bvrf->bg_shop || sd == bvrf->bg_mhop) {
-		is_mhop = sd == bvrf->bg_mhop;
-		mlen = bfd_recv_ipv4(sd, msgbuf, sizeof(msgbuf), &ttl, &ifindex,
-				     &local, &peer);
-	} else if (sd == bvrf->bg_shop6 || sd == bvrf->bg_mhop6) {
-		is_mhop = sd == bvrf->bg_mhop6;
-		mlen = bfd_recv_ipv6(sd, msgbuf, sizeof(msgbuf), &ttl, &ifindex,
-				     &local, &peer);
-	}
+	vrf_id_t vrfid = bvrf->vrf->vrf_id;
 
 	/* Implement RFC 5880 6.8.6 */
 	if (mlen < BFD_PKT_LEN) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "too small (%ld bytes)", mlen);
-		return 0;
+		return;
 	}
 
 	/* Validate single hop packet TTL. */
 	if ((!is_mhop) && (ttl != BFD_TTL_VAL)) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "invalid TTL: %d expected %d", ttl, BFD_TTL_VAL);
-		return 0;
+		return;
 	}
 
 	/*
@@ -595,51 +607,58 @@ int bfd_recv_cb(struct thread *t)
 	 */
 	cp = (struct bfd_pkt *)(msgbuf);
 	if (BFD_GETVER(cp->diag) != BFD_VERSION) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "bad version %d", BFD_GETVER(cp->diag));
-		return 0;
+		return;
 	}
 
 	if (cp->detect_mult == 0) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "detect multiplier set to zero");
-		return 0;
+		return;
 	}
 
 	if ((cp->len < BFD_PKT_LEN) || (cp->len > mlen)) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid, "too small");
-		return 0;
+		cp_debug(is_mhop, peer, local, ifindex, vrfid, "too small");
+		return;
 	}
 
 	if (cp->discrs.my_discr == 0) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "'my discriminator' is zero");
-		return 0;
+		return;
 	}
 
 	/* Find the session that this packet belongs. */
-	bfd = ptm_bfd_sess_find(cp, &peer, &local, ifindex, vrfid, is_mhop);
+	bfd = ptm_bfd_sess_find(cp, peer, local, ifindex, vrfid, is_mhop);
 	if (bfd == NULL) {
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "no session found");
-		return 0;
+		return;
 	}
 
 	bfd->stats.rx_ctrl_pkt++;
 
+	/* The offload provider is running this session. */
+	if (bfd->offload) {
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
+			 "session offloaded to %s", bfd->offload->name);
+		return;
+	}
+
 	/*
 	 * Multi hop: validate packet TTL.
 	 * Single hop: set local address that received the packet.
 	 */
 	if (is_mhop) {
 		if (ttl < bfd->mh_ttl) {
-			cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+			cp_debug(is_mhop, peer, local, ifindex, vrfid,
 				 "exceeded max hop count (expected %d, got %d)",
 				 bfd->mh_ttl, ttl);
-			return 0;
+			return;
 		}
 	} else if (bfd->local_address.sa_sin.sin_family == AF_UNSPEC) {
-		bfd->local_address = local;
+		bfd->local_address = *local;
 	}
 
 	/*
@@ -652,7 +671,7 @@ int bfd_recv_cb(struct thread *t)
 	/* Log remote discriminator changes. */
 	if ((bfd->discrs.remote_discr != 0)
 	    && (bfd->discrs.remote_discr != ntohl(cp->discrs.my_discr)))
-		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
+		cp_debug(is_mhop, peer, local, ifindex, vrfid,
 			 "remote discriminator mismatch (expected %u, got %u)",
 			 bfd->discrs.remote_discr, ntohl(cp->discrs.my_discr));
 
@@ -705,9 +724,177 @@ int bfd_recv_cb(struct thread *t)
 		ptm_bfd_snd(bfd, 1);
 	}
 
+	/* Remote discriminator, state or timers may have changed. */
+	bfd_tx_update(bfd);
+}
+
+#ifdef HAVE_RECVMMSG
+/*
+ * Read up to BFD_RECV_BATCH control packets with a single recvmmsg() and
+ * process them: with many sessions the shared receive sockets usually have
+ * several packets queued per wakeup.
+ */
+#define BFD_RECV_BATCH 32
+
+static void bfd_recv_control(struct bfd_vrf_global *bvrf, int sd)
+{
+	static uint8_t msgbuf[BFD_RECV_BATCH][1516];
+	static uint8_t cmsgbuf[BFD_RECV_BATCH][255];
+	struct mmsghdr msgs[BFD_RECV_BATCH];
+	struct iovec iov[BFD_RECV_BATCH];
+	struct sockaddr_any msgaddr[BFD_RECV_BATCH];
+	struct sockaddr_any local, peer;
+	ifindex_t ifindex;
+	uint8_t ttl;
+	bool is_mhop, is_ipv6;
+	int i, n, rv;
+
+	if (sd == bvrf->bg_shop || sd == bvrf->bg_mhop)
+		is_ipv6 = false;
+	else if (sd == bvrf->bg_shop6 || sd == bvrf->bg_mhop6)
+		is_ipv6 = true;
+	else
+		return;
+	is_mhop = sd == bvrf->bg_mhop || sd == bvrf->bg_mhop6;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < BFD_RECV_BATCH; i++) {
+		iov[i].iov_base = msgbuf[i];
+		iov[i].iov_len = sizeof(msgbuf[i]);
+		msgs[i].msg_hdr.msg_name = &msgaddr[i];
+		msgs[i].msg_hdr.msg_namelen = is_ipv6
+						      ? sizeof(msgaddr[i].sa_sin6)
+						      : sizeof(msgaddr[i].sa_sin);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgbuf[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgbuf[i]);
+	}
+
+	n = recvmmsg(sd, msgs, BFD_RECV_BATCH, MSG_DONTWAIT, NULL);
+	if (n == -1) {
+		if (errno != EAGAIN)
+			zlog_err("control-recv: recv failed: %s",
+				 strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		/* Sanitize input/output. */
+		memset(&local, 0, sizeof(local));
+		memset(&peer, 0, sizeof(peer));
+		ifindex = IFINDEX_INTERNAL;
+		ttl = 0;
+
+		if (is_ipv6)
+			rv = bfd_recv_ipv6_cmsg(&msgs[i].msg_hdr, &ttl,
+						&ifindex, &local, &peer);
+		else
+			rv = bfd_recv_ipv4_cmsg(&msgs[i].msg_hdr, &ttl,
+						&ifindex, &local, &peer);
+		if (rv != 0)
+			continue;
+
+		bfd_recv_control_pkt(bvrf, is_mhop, msgbuf[i],
+				     msgs[i].msg_len, ttl, ifindex, &local,
+				     &peer);
+	}
+}
+#else
+/* Read and process one control packet. */
+static void bfd_recv_control(struct bfd_vrf_global *bvrf, int sd)
+{
+	bool is_mhop;
+	ssize_t mlen = 0;
+	uint8_t ttl = 0;
+	ifindex_t ifindex = IFINDEX_INTERNAL;
+	struct sockaddr_any local, peer;
+	uint8_t msgbuf[1516];
+
+	/* Sanitize input/output. */
+	memset(&local, 0, sizeof(local));
+	memset(&peer, 0, sizeof(peer));
+
+	/* Handle control packets. */
+	is_mhop = false;
+	if (sd == bvrf->bg_shop || sd == bvrf->bg_mhop) {
+		is_mhop = sd == bvrf->bg_mhop;
+		mlen = bfd_recv_ipv4(sd, msgbuf, sizeof(msgbuf), &ttl, &ifindex,
+				     &local, &peer);
+	} else if (sd == bvrf->bg_shop6 || sd == bvrf->bg_mhop6) {
+		is_mhop = sd == bvrf->bg_mhop6;
+		mlen = bfd_recv_ipv6(sd, msgbuf, sizeof(msgbuf), &ttl, &ifindex,
+				     &local, &peer);
+	}
+
+	bfd_recv_control_pkt(bvrf, is_mhop, msgbuf, mlen, ttl, ifindex, &local,
+			     &peer);
+}
+#endif /* HAVE_RECVMMSG */
+
+int bfd_recv_cb(struct thread *t)
+{
+	int sd = THREAD_FD(t);
+	struct bfd_vrf_global *bvrf = THREAD_ARG(t);
+
+	/* Schedule next read. */
+	bfd_sd_reschedule(bvrf, sd);
+
+	/* Handle echo packets. */
+	if (sd == bvrf->bg_echo || sd == bvrf->bg_echov6) {
+		ptm_bfd_process_echo_pkt(bvrf, sd);
+		return 0;
+	}
+
+	bfd_recv_control(bvrf, sd);
+
 	return 0;
 }
 
+/*
+ * Process control packets already queued on the sockets `bs` receives on,
+ * reading at most BFD_RECV_DRAIN_MAX times. Used before declaring a session
+ * down since a busy main thread may not have read them yet.
+ *
+ * Returns true if one of them refreshed the session detection timer.
+ */
+#define BFD_RECV_DRAIN_MAX 64
+
+bool bfd_recv_drain(struct bfd_session *bs)
+{
+	struct bfd_vrf_global *bvrf;
+	struct pollfd pfd = {.events = POLLIN};
+	int count;
+
+	bvrf = bfd_vrf_look_by_session(bs);
+	if (bvrf == NULL)
+		return false;
+
+	if (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_IPV6))
+		pfd.fd = CHECK_FLAG(bs->flags, BFD_SESS_FLAG_MH)
+				 ? bvrf->bg_mhop6
+				 : bvrf->bg_shop6;
+	else
+		pfd.fd = CHECK_FLAG(bs->flags, BFD_SESS_FLAG_MH)
+				 ? bvrf->bg_mhop
+				 : bvrf->bg_shop;
+	if (pfd.fd == -1)
+		return false;
+
+	for (count = 0; count < BFD_RECV_DRAIN_MAX; count++) {
+		if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN))
+			break;
+
+		bfd_recv_control(bvrf, pfd.fd);
+
+		/* The detection timer got re-armed by a packet. */
+		if (bs->recvtimer_ev)
+			return true;
+	}
+
+	return false;
+}
+
 /*
  * bp_bfd_echo_in: proccesses an BFD echo packet. On TTL == BFD_TTL_VAL
  * the packet is looped back or returns the my discriminator ID along
@@ -232,6 +232,9 @@ int main(int argc, char *argv[])
 	/* Initialize BFD data structures. */
 	bfd_initialize();
 
+	/* Control packet transmit pthread, started after daemonizing. */
+	bfd_tx_init();
+
 	bfd_vrf_init();
 
 	access_list_init();
@@ -248,6 +251,8 @@ int main(int argc, char *argv[])
 	/* read configuration file and daemonize  */
 	frr_config_fork();
 
+	bfd_tx_run();
+
 	frr_run(master);
 	/* NOTREACHED */
 
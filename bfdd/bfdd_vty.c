@@ -150,6 +150,8 @@ static void _display_peer(struct vty *vty, struct bfd_session *bs)
 	vty_out(vty, "\t\tRemote diagnostics: %s\n", diag2str(bs->remote_diag));
 	vty_out(vty, "\t\tPeer Type: %s\n",
 		CHECK_FLAG(bs->flags, BFD_SESS_FLAG_CONFIG) ? "configured" : "dynamic");
+	if (bs->offload)
+		vty_out(vty, "\t\tOffloaded to: %s\n", bs->offload->name);
 
 	vty_out(vty, "\t\tLocal timers:\n");
 	vty_out(vty, "\t\t\tDetect-multiplier: %u\n",
@@ -238,6 +240,8 @@ static struct json_object *__display_peer_json(struct bfd_session *bs)
 	}
 
 	json_object_string_add(jo, "diagnostic", diag2str(bs->local_diag));
+	if (bs->offload)
+		json_object_string_add(jo, "offload", bs->offload->name);
 	json_object_string_add(jo, "remote-diagnostic",
 			       diag2str(bs->remote_diag));
 
@@ -344,14 +348,31 @@ static void _display_all_peers(struct vty *vty, char *vrfname, bool use_json)
 	json_object_free(jo);
 }
 
+/* Take a consistent copy of what the transmit pthread updates. */
+static void _peer_tx_stats(struct bfd_session *bs, uint64_t *tx_ctrl_pkt,
+			   uint64_t *slip_avg, uint64_t *slip_max)
+{
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		*tx_ctrl_pkt = bs->stats.tx_ctrl_pkt;
+		*slip_avg = bs->tx.slip_count
+				    ? bs->tx.slip_total / bs->tx.slip_count
+				    : 0;
+		*slip_max = bs->tx.slip_max;
+	}
+}
+
 static void _display_peer_counter(struct vty *vty, struct bfd_session *bs)
 {
+	uint64_t tx_ctrl_pkt, tx_slip_avg, tx_slip_max;
+
+	_peer_tx_stats(bs, &tx_ctrl_pkt, &tx_slip_avg, &tx_slip_max);
+
 	_display_peer_header(vty, bs);
 
 	vty_out(vty, "\t\tControl packet input: %" PRIu64 " packets\n",
 		bs->stats.rx_ctrl_pkt);
 	vty_out(vty, "\t\tControl packet output: %" PRIu64 " packets\n",
-		bs->stats.tx_ctrl_pkt);
+		tx_ctrl_pkt);
 	vty_out(vty, "\t\tEcho packet input: %" PRIu64 " packets\n",
 		bs->stats.rx_echo_pkt);
 	vty_out(vty, "\t\tEcho packet output: %" PRIu64 " packets\n",
@@ -362,20 +383,44 @@ static void _display_peer_counter(struct vty *vty, struct bfd_session *bs)
 		bs->stats.session_down);
 	vty_out(vty, "\t\tZebra notifications: %" PRIu64 "\n",
 		bs->stats.znotification);
+	vty_out(vty,
+		"\t\tTransmit timer slippage: avg %" PRIu64 " max %" PRIu64
+		" usec\n",
+		tx_slip_avg, tx_slip_max);
+	vty_out(vty,
+		"\t\tDetection timer slippage: avg %" PRIu64 " max %" PRIu64
+		" usec\n",
+		bs->stats.detect_slip_count
+			? bs->stats.detect_slip_total
+				  / bs->stats.detect_slip_count
+			: 0,
+		bs->stats.detect_slip_max);
 	vty_out(vty, "\n");
 }
 
 static struct json_object *__display_peer_counters_json(struct bfd_session *bs)
 {
 	struct json_object *jo = _peer_json_header(bs);
+	uint64_t tx_ctrl_pkt, tx_slip_avg, tx_slip_max;
+
+	_peer_tx_stats(bs, &tx_ctrl_pkt, &tx_slip_avg, &tx_slip_max);
 
 	json_object_int_add(jo, "control-packet-input", bs->stats.rx_ctrl_pkt);
-	json_object_int_add(jo, "control-packet-output", bs->stats.tx_ctrl_pkt);
+	json_object_int_add(jo, "control-packet-output", tx_ctrl_pkt);
 	json_object_int_add(jo, "echo-packet-input", bs->stats.rx_echo_pkt);
 	json_object_int_add(jo, "echo-packet-output", bs->stats.tx_echo_pkt);
 	json_object_int_add(jo, "session-up", bs->stats.session_up);
 	json_object_int_add(jo, "session-down", bs->stats.session_down);
 	json_object_int_add(jo, "zebra-notifications", bs->stats.znotification);
+	json_object_int_add(jo, "transmit-slippage-avg", tx_slip_avg);
+	json_object_int_add(jo, "transmit-slippage-max", tx_slip_max);
+	json_object_int_add(jo, "detection-slippage-avg",
+			    bs->stats.detect_slip_count
+				    ? bs->stats.detect_slip_total
+					      / bs->stats.detect_slip_count
+				    : 0);
+	json_object_int_add(jo, "detection-slippage-max",
+			    bs->stats.detect_slip_max);
 
 	return jo;
 }
@@ -458,9 +503,18 @@ static void _clear_peer_counter(struct bfd_session *bs)
 	/* Clear only pkt stats, intention is not to loose system
 	   events counters */
 	bs->stats.rx_ctrl_pkt = 0;
-	bs->stats.tx_ctrl_pkt = 0;
 	bs->stats.rx_echo_pkt = 0;
 	bs->stats.tx_echo_pkt = 0;
+	bs->stats.detect_slip_count = 0;
+	bs->stats.detect_slip_total = 0;
+	bs->stats.detect_slip_max = 0;
+
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		bs->stats.tx_ctrl_pkt = 0;
+		bs->tx.slip_count = 0;
+		bs->tx.slip_total = 0;
+		bs->tx.slip_max = 0;
+	}
 }
 
 static void _display_peer_brief(struct vty *vty, struct bfd_session *bs)
@@ -24,8 +24,12 @@
 
 #include <zebra.h>
 
+#include "lib/frr_pthread.h"
+
 #include "bfd.h"
 
+DECLARE_DLIST(bfd_tx_slot, struct bfd_session, tx.item);
+
 void tv_normalize(struct timeval *tv);
 
 void tv_normalize(struct timeval *tv)
@@ -35,6 +39,14 @@ void tv_normalize(struct timeval *tv)
 	tv->tv_usec = tv->tv_usec % 1000000;
 }
 
+static int64_t bfd_monotime_usec(void)
+{
+	struct timeval tv;
+
+	monotime(&tv);
+	return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
 void bfd_recvtimer_update(struct bfd_session *bs)
 {
 	struct timeval tv = {.tv_sec = 0, .tv_usec = bs->detect_TO};
@@ -42,11 +54,12 @@ void bfd_recvtimer_update(struct bfd_session *bs)
 	/* Remove previous schedule if any. */
 	bfd_recvtimer_delete(bs);
 
-	/* Don't add event if peer is deactivated. */
+	/* Don't add event if peer is deactivated or offloaded. */
 	if (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_SHUTDOWN) ||
-	    bs->sock == -1)
+	    bs->sock == -1 || bs->offload)
 		return;
 
+	bs->recvtimer_deadline = bfd_monotime_usec() + bs->detect_TO;
 	tv_normalize(&tv);
 
 	thread_add_timer_tv(master, bfd_recvtimer_cb, bs, &tv,
@@ -71,21 +84,216 @@ void bfd_echo_recvtimer_update(struct bfd_session *bs)
 			    &bs->echo_recvtimer_ev);
 }
 
+/*
+ * Control packet transmit pthread.
+ *
+ * Periodic control packets are sent from their own pthread so they keep
+ * their pace while the main thread is busy with configuration, show
+ * commands or zebra. Armed sessions sit on a timing wheel of BFD_TX_SLOTS
+ * slots, BFD_TX_TICK microseconds each; deadlines further away than one
+ * rotation simply stay in their slot until their turn comes. The pthread
+ * sleeps until the next non-empty slot, the main thread kicks it when it
+ * arms a session earlier than that.
+ *
+ * Receiving, the state machine and the detection timers stay on the main
+ * thread, which keeps `bs->tx` current through bfd_tx_update().
+ */
+static struct bfd_tx_slot_head *bfd_tx_slot_head(unsigned int slot)
+{
+	return &bglobal.bg_tx_wheel[slot];
+}
+
+/* Called with bg_tx_mtx held. */
+static void bfd_tx_encode(struct bfd_session *bs)
+{
+	ptm_bfd_pkt_encode(bs, 0, &bs->tx.pkt);
+	bp_peer_sockaddr(bs, NULL, &bs->tx.dst, &bs->tx.dstlen);
+	bs->tx.sock = bs->sock;
+	bs->tx.xmt_TO = bs->xmt_TO;
+	bs->tx.detect_mult = bs->detect_mult;
+}
+
+/* Called with bg_tx_mtx held, returns the tick of the slot used. */
+static int64_t bfd_tx_arm(struct bfd_session *bs, int64_t deadline)
+{
+	int64_t tick = deadline / BFD_TX_TICK;
+
+	if (bs->tx.armed)
+		bfd_tx_slot_del(bfd_tx_slot_head(bs->tx.slot), bs);
+	else
+		bglobal.bg_tx_count++;
+
+	/* Never behind the wheel, it would wait a full rotation. */
+	if (tick < bglobal.bg_tx_tick)
+		tick = bglobal.bg_tx_tick;
+
+	bs->tx.armed = true;
+	bs->tx.deadline = deadline;
+	bs->tx.slot = tick % BFD_TX_SLOTS;
+	bfd_tx_slot_add_tail(bfd_tx_slot_head(bs->tx.slot), bs);
+
+	return tick;
+}
+
+/* Called with bg_tx_mtx held. */
+static void bfd_tx_disarm(struct bfd_session *bs)
+{
+	if (!bs->tx.armed)
+		return;
+
+	bfd_tx_slot_del(bfd_tx_slot_head(bs->tx.slot), bs);
+	bs->tx.armed = false;
+	bglobal.bg_tx_count--;
+}
+
+/* Transmit pthread, called with bg_tx_mtx held. */
+static void bfd_tx_send(struct bfd_session *bs, int64_t now)
+{
+	struct bfd_tx *tx = &bs->tx;
+	int64_t slip = now - tx->deadline;
+	ssize_t rv;
+
+	if (slip < 0)
+		slip = 0;
+	tx->slip_count++;
+	tx->slip_total += slip;
+	if ((uint64_t)slip > tx->slip_max)
+		tx->slip_max = slip;
+
+	rv = sendto(tx->sock, &tx->pkt, BFD_PKT_LEN, 0,
+		    (struct sockaddr *)&tx->dst, tx->dstlen);
+	if (rv <= 0) {
+		if (bglobal.debug_network)
+			zlog_debug("packet-send: send failure: %s",
+				   strerror(errno));
+	} else
+		bs->stats.tx_ctrl_pkt++;
+
+	/* Restart the timer for next time */
+	bfd_tx_arm(bs, now + ptm_bfd_xmt_jitter(tx->xmt_TO, tx->detect_mult));
+}
+
+static int bfd_tx_wheel_run(struct thread *t);
+
+/* Transmit pthread, called with bg_tx_mtx held. */
+static void bfd_tx_schedule(int64_t now)
+{
+	struct timeval tv;
+	int64_t tick, delay;
+
+	bglobal.bg_tx_wakeup = 0;
+	if (bglobal.bg_tx_count == 0)
+		return;
+
+	for (tick = bglobal.bg_tx_tick;
+	     tick < bglobal.bg_tx_tick + BFD_TX_SLOTS; tick++)
+		if (bfd_tx_slot_count(bfd_tx_slot_head(tick % BFD_TX_SLOTS)))
+			break;
+
+	bglobal.bg_tx_wakeup = tick;
+	delay = tick * BFD_TX_TICK - now;
+	if (delay < 0)
+		delay = 0;
+	tv.tv_sec = delay / 1000000;
+	tv.tv_usec = delay % 1000000;
+	thread_add_timer_tv(bglobal.bg_tx_pth->master, bfd_tx_wheel_run, NULL,
+			    &tv, &bglobal.bg_tx_ev);
+}
+
+/* Transmit pthread: send everything due and sleep until the next slot. */
+static int bfd_tx_wheel_run(struct thread *t)
+{
+	struct bfd_session *bs;
+	int64_t now, now_tick, tick;
+
+	/* We might have been kicked before the timer expired. */
+	THREAD_OFF(bglobal.bg_tx_ev);
+
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		now = bfd_monotime_usec();
+		now_tick = now / BFD_TX_TICK;
+
+		/* A full rotation covers every slot. */
+		tick = bglobal.bg_tx_tick;
+		if (tick < now_tick - BFD_TX_SLOTS + 1)
+			tick = now_tick - BFD_TX_SLOTS + 1;
+
+		for (; tick <= now_tick; tick++) {
+			frr_each_safe (bfd_tx_slot,
+				       bfd_tx_slot_head(tick % BFD_TX_SLOTS),
+				       bs) {
+				if (bs->tx.deadline / BFD_TX_TICK > now_tick)
+					continue;
+
+				bfd_tx_send(bs, now);
+			}
+		}
+
+		bglobal.bg_tx_tick = now_tick + 1;
+		bfd_tx_schedule(now);
+	}
+
+	return 0;
+}
+
+void bfd_tx_init(void)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+
+	pthread_mutex_init(&bglobal.bg_tx_mtx, NULL);
+	for (unsigned int slot = 0; slot < BFD_TX_SLOTS; slot++)
+		bfd_tx_slot_init(bfd_tx_slot_head(slot));
+	bglobal.bg_tx_tick = bfd_monotime_usec() / BFD_TX_TICK;
+
+	bglobal.bg_tx_pth = frr_pthread_new(&attr, "BFD transmit", "bfdd_tx");
+}
+
+void bfd_tx_run(void)
+{
+	frr_pthread_run(bglobal.bg_tx_pth, NULL);
+
+	/* Wait until thread is ready. */
+	frr_pthread_wait_running(bglobal.bg_tx_pth);
+}
+
+/*
+ * Refresh the packet the transmit pthread sends for `bs`. Must be called
+ * whenever something carried in periodic control packets changes.
+ */
+void bfd_tx_update(struct bfd_session *bs)
+{
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		bfd_tx_encode(bs);
+	}
+}
+
 void bfd_xmttimer_update(struct bfd_session *bs, uint64_t jitter)
 {
-	struct timeval tv = {.tv_sec = 0, .tv_usec = jitter};
+	int64_t tick;
 
 	/* Remove previous schedule if any. */
 	bfd_xmttimer_delete(bs);
 
-	/* Don't add event if peer is deactivated. */
+	/* Don't add event if peer is deactivated or offloaded. */
 	if (CHECK_FLAG(bs->flags, BFD_SESS_FLAG_SHUTDOWN) ||
-	    bs->sock == -1)
+	    bs->sock == -1 || bs->offload)
 		return;
 
-	tv_normalize(&tv);
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		bfd_tx_encode(bs);
+		tick = bfd_tx_arm(bs, bfd_monotime_usec() + jitter);
 
-	thread_add_timer_tv(master, bfd_xmt_cb, bs, &tv, &bs->xmttimer_ev);
+		/* Wake the pthread up if it would sleep past this one. */
+		if (bglobal.bg_tx_wakeup == 0 || tick < bglobal.bg_tx_wakeup) {
+			bglobal.bg_tx_wakeup = tick;
+			thread_add_event(bglobal.bg_tx_pth->master,
+					 bfd_tx_wheel_run, NULL, 0,
+					 &bglobal.bg_tx_kick);
+		}
+	}
 }
 
 void bfd_echo_xmttimer_update(struct bfd_session *bs, uint64_t jitter)
@@ -118,7 +326,9 @@ void bfd_echo_recvtimer_delete(struct bfd_session *bs)
 
 void bfd_xmttimer_delete(struct bfd_session *bs)
 {
-	THREAD_OFF(bs->xmttimer_ev);
+	frr_with_mutex(&bglobal.bg_tx_mtx) {
+		bfd_tx_disarm(bs);
+	}
 }
 
 void bfd_echo_xmttimer_delete(struct bfd_session *bs)
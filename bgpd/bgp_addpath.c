@@ -430,6 +430,7 @@ void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *bn, afi_t afi,
 	int i;
 	struct bgp_path_info *pi;
 	struct id_alloc_pool **pool_ptr;
+	bool has, want, needed;
 
 	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
 		struct id_alloc *alloc =
@@ -439,24 +440,35 @@ void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *bn, afi_t afi,
 		if (bgp->tx_addpath.peercount[afi][safi][i] == 0)
 			continue;
 
-		/* Free Unused IDs back to the pool.*/
+		/*
+		 * Free Unused IDs back to the pool, and see whether any path
+		 * is missing one.  Usually none is, so the paths that keep
+		 * their ID are all that gets looked at.
+		 */
+		needed = false;
 		for (pi = bgp_dest_get_bgp_path_info(bn); pi; pi = pi->next) {
-			if (pi->tx_addpath.addpath_tx_id[i] != IDALLOC_INVALID
-			    && !bgp_addpath_tx_path(i, pi)) {
+			has = pi->tx_addpath.addpath_tx_id[i]
+			      != IDALLOC_INVALID;
+			want = bgp_addpath_tx_path(i, pi);
+
+			if (has && !want) {
 				idalloc_free_to_pool(pool_ptr,
 					pi->tx_addpath.addpath_tx_id[i]);
 				pi->tx_addpath.addpath_tx_id[i] =
 					IDALLOC_INVALID;
-			}
+			} else if (!has && want)
+				needed = true;
 		}
 
 		/* Give IDs to paths that need them (pulling from the pool) */
-		for (pi = bgp_dest_get_bgp_path_info(bn); pi; pi = pi->next) {
+		for (pi = needed ? bgp_dest_get_bgp_path_info(bn) : NULL; pi;
+		     pi = pi->next) {
 			if (pi->tx_addpath.addpath_tx_id[i] == IDALLOC_INVALID
 			    && bgp_addpath_tx_path(i, pi)) {
 				pi->tx_addpath.addpath_tx_id[i] =
 					idalloc_allocate_prefer_pool(
 						alloc, pool_ptr);
+				SET_FLAG(pi->tx_addpath.dirty, 1 << i);
 			}
 		}
 
@@ -464,3 +476,22 @@ void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *bn, afi_t afi,
 		idalloc_drain_pool(alloc, pool_ptr);
 	}
 }
+
+/*
+ * Does the path need to be announced again to addpath peers using strat?
+ * That is when it has just been given an ID for it, came or went (see
+ * bgp_path_info_set_flag()), or when something that goes into the update
+ * changed.  Paths that lost their ID are withdrawn
+ * regardless, as their adj-out no longer matches any path.
+ */
+bool bgp_addpath_path_changed(struct bgp_path_info *pi,
+			      enum bgp_addpath_strat strat)
+{
+	if (CHECK_FLAG(pi->flags, BGP_PATH_ATTR_CHANGED | BGP_PATH_IGP_CHANGED
+					  | BGP_PATH_MULTIPATH_CHG
+					  | BGP_PATH_LINK_BW_CHG))
+		return true;
+
+	return strat < BGP_ADDPATH_MAX
+	       && CHECK_FLAG(pi->tx_addpath.dirty, 1 << strat);
+}
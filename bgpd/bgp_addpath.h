@@ -68,5 +68,8 @@ void bgp_addpath_set_peer_type(struct peer *peer, afi_t afi, safi_t safi,
 void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *dest, afi_t afi,
 			    safi_t safi);
 
+bool bgp_addpath_path_changed(struct bgp_path_info *pi,
+			      enum bgp_addpath_strat strat);
+
 void bgp_addpath_type_changed(struct bgp *bgp);
 #endif
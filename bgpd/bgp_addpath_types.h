@@ -42,6 +42,12 @@ struct bgp_addpath_node_data {
 
 struct bgp_addpath_info_data {
 	uint32_t addpath_tx_id[BGP_ADDPATH_MAX];
+
+	/*
+	 * Strategies (1 << strategy) for which the path got an ID since the
+	 * dest was last processed, see bgp_addpath_path_changed().
+	 */
+	uint8_t dirty;
 };
 
 struct bgp_addpath_strategy_names {
@@ -39,6 +39,7 @@
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_journal.h"
 
 /* BGP advertise attribute is used for pack same attribute update into
    one packet.  To do that we maintain attribute hash in struct
@@ -144,6 +145,106 @@ void bgp_advertise_unintern(struct hash *hash, struct bgp_advertise_attr *baa)
 	}
 }
 
+/* Slots allocated for all dests' adj-out arrays, for "show bgp memory" */
+static size_t adj_out_index_slots;
+
+size_t bgp_adj_out_index_slots(void)
+{
+	return adj_out_index_slots;
+}
+
+/*
+ * Where the adj-out for subgroup and addpath ID is, or would go, in the
+ * dest's array.
+ */
+static uint32_t bgp_adj_out_pos(const struct bgp_dest *dest,
+				const struct update_subgroup *subgrp,
+				uint32_t addpath_tx_id)
+{
+	uint32_t lo = 0, hi = dest->adj_out_count, mid;
+	const struct bgp_adj_out *adj;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		adj = dest->adj_out[mid];
+
+		if (adj->subgroup < subgrp
+		    || (adj->subgroup == subgrp
+			&& adj->addpath_tx_id < addpath_tx_id))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+struct bgp_adj_out *bgp_adj_out_find(struct bgp_dest *dest,
+				     struct update_subgroup *subgrp,
+				     uint32_t addpath_tx_id)
+{
+	struct bgp_adj_out *adj;
+	uint32_t pos;
+
+	pos = bgp_adj_out_pos(dest, subgrp, addpath_tx_id);
+	if (pos == dest->adj_out_count)
+		return NULL;
+
+	adj = dest->adj_out[pos];
+	if (adj->subgroup != subgrp || adj->addpath_tx_id != addpath_tx_id)
+		return NULL;
+
+	return adj;
+}
+
+/*
+ * The array is sized to the power of two at or above the count, so it grows
+ * when a count that is a power of two goes up and shrinks when it comes back
+ * down to one.
+ */
+void bgp_adj_out_link(struct bgp_dest *dest, struct bgp_adj_out *adj)
+{
+	uint32_t count = dest->adj_out_count;
+	uint32_t pos;
+
+	pos = bgp_adj_out_pos(dest, adj->subgroup, adj->addpath_tx_id);
+
+	if (!(count & (count - 1))) {
+		uint32_t slots = count ? count * 2 : 1;
+
+		dest->adj_out = XREALLOC(MTYPE_BGP_ADJ_OUT_INDEX, dest->adj_out,
+					 slots * sizeof(*dest->adj_out));
+		adj_out_index_slots += slots - count;
+	}
+
+	memmove(&dest->adj_out[pos + 1], &dest->adj_out[pos],
+		(count - pos) * sizeof(*dest->adj_out));
+	dest->adj_out[pos] = adj;
+	dest->adj_out_count++;
+}
+
+void bgp_adj_out_unlink(struct bgp_dest *dest, struct bgp_adj_out *adj)
+{
+	uint32_t count = dest->adj_out_count;
+	uint32_t pos;
+
+	pos = bgp_adj_out_pos(dest, adj->subgroup, adj->addpath_tx_id);
+	assert(pos < count && dest->adj_out[pos] == adj);
+
+	memmove(&dest->adj_out[pos], &dest->adj_out[pos + 1],
+		(count - pos - 1) * sizeof(*dest->adj_out));
+	dest->adj_out_count = --count;
+
+	if (!count) {
+		XFREE(MTYPE_BGP_ADJ_OUT_INDEX, dest->adj_out);
+		adj_out_index_slots -= 1;
+	} else if (!(count & (count - 1))) {
+		dest->adj_out = XREALLOC(MTYPE_BGP_ADJ_OUT_INDEX, dest->adj_out,
+					 count * sizeof(*dest->adj_out));
+		adj_out_index_slots -= count;
+	}
+}
+
 bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 			uint32_t addpath_tx_id)
 {
@@ -153,7 +254,7 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 	safi_t safi;
 	int addpath_capable;
 
-	RB_FOREACH (adj, bgp_adj_out_rb, &dest->adj_out)
+	BGP_ADJ_OUT_FOREACH (dest, adj)
 		SUBGRP_FOREACH_PEER (adj->subgroup, paf)
 			if (paf->peer == peer) {
 				afi = SUBGRP_AFI(adj->subgroup);
@@ -178,33 +279,57 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 }
 
 
-void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer, struct attr *attr,
-		    uint32_t addpath_id)
+static void bgp_adj_in_mem_account(struct bgp_dest *dest, struct peer *peer,
+				   int delta)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	if (table->bgp)
+		table->bgp->mem_stats[table->afi][table->safi].adj_in += delta;
+	peer->mem_stats[table->afi][table->safi].adj_in += delta;
+}
+
+struct bgp_adj_in *bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer,
+				  struct attr *attr, uint32_t addpath_id)
 {
 	struct bgp_adj_in *adj;
 
 	for (adj = dest->adj_in; adj; adj = adj->next) {
 		if (adj->peer == peer && adj->addpath_rx_id == addpath_id) {
+			adj->stale = false;
 			if (adj->attr != attr) {
 				bgp_attr_unintern(&adj->attr);
 				adj->attr = bgp_attr_intern(attr);
+				adj->uptime = bgp_clock();
+				bgp_journal_adj_in_set(dest, adj, false);
 			}
-			return;
+			return adj;
 		}
 	}
 	adj = XCALLOC(MTYPE_BGP_ADJ_IN, sizeof(struct bgp_adj_in));
+	bgp_adj_in_mem_account(dest, peer, 1);
 	adj->peer = peer_lock(peer); /* adj_in peer reference */
 	adj->attr = bgp_attr_intern(attr);
 	adj->uptime = bgp_clock();
 	adj->addpath_rx_id = addpath_id;
-	BGP_ADJ_IN_ADD(dest, adj);
+	adj->next = dest->adj_in;
+	dest->adj_in = adj;
 	bgp_dest_lock_node(dest);
+	bgp_journal_adj_in_set(dest, adj, true);
+	return adj;
 }
 
 void bgp_adj_in_remove(struct bgp_dest *dest, struct bgp_adj_in *bai)
 {
+	struct bgp_adj_in **adjp;
+
+	for (adjp = &dest->adj_in; *adjp != bai; adjp = &(*adjp)->next)
+		assert(*adjp);
+	*adjp = bai->next;
+
+	bgp_journal_adj_in_remove(dest, bai);
+	bgp_adj_in_mem_account(dest, bai->peer, -1);
 	bgp_attr_unintern(&bai->attr);
-	BGP_ADJ_IN_DEL(dest, bai);
 	peer_unlock(bai->peer); /* adj_in peer reference */
 	XFREE(MTYPE_BGP_ADJ_IN, bai);
 }
@@ -62,11 +62,15 @@ struct bgp_advertise {
 
 DECLARE_DLIST(bgp_adv_fifo, struct bgp_advertise, fifo)
 
-/* BGP adjacency out.  */
+/* BGP adjacency out.
+ *
+ * There is one of these per dest and subgroup it was advertised to, which
+ * on a route reflector with many subgroups makes up most of the memory.  The
+ * attribute is interned, so shared with every other subgroup that was sent
+ * the same one, and the entries of a dest are found through a sorted array
+ * of pointers on the dest rather than a tree threaded through them.
+ */
 struct bgp_adj_out {
-	/* RB Tree of adjacency entries */
-	RB_ENTRY(bgp_adj_out) adj_entry;
-
 	/* Advertised subgroup.  */
 	struct update_subgroup *subgroup;
 
@@ -76,24 +80,39 @@ struct bgp_adj_out {
 	/* Prefix information.  */
 	struct bgp_dest *dest;
 
-	uint32_t addpath_tx_id;
-
 	/* Advertised attribute.  */
 	struct attr *attr;
 
 	/* Advertisement information.  */
 	struct bgp_advertise *adv;
-};
 
-RB_HEAD(bgp_adj_out_rb, bgp_adj_out);
-RB_PROTOTYPE(bgp_adj_out_rb, bgp_adj_out, adj_entry,
-	     bgp_adj_out_compare);
+	uint32_t addpath_tx_id;
+};
 
-/* BGP adjacency in. */
+/*
+ * Walk the adj-out entries of a dest.  The _SAFE variant goes backwards and
+ * allows removing the current entry.
+ */
+#define BGP_ADJ_OUT_FOREACH(dest, adj)                                         \
+	for (uint32_t adj##_i = 0;                                             \
+	     adj##_i < (dest)->adj_out_count                                   \
+	     && ((adj) = (dest)->adj_out[adj##_i], true);                      \
+	     adj##_i++)
+#define BGP_ADJ_OUT_FOREACH_SAFE(dest, adj)                                    \
+	for (uint32_t adj##_i = (dest)->adj_out_count;                         \
+	     adj##_i-- > 0 && ((adj) = (dest)->adj_out[adj##_i], true);)
+
+/* BGP adjacency in.
+ *
+ * There is one of these per peer and path with soft-reconfiguration inbound,
+ * so they are kept small: the attribute is interned and thus already shared
+ * with every other peer (and the post-policy path, if policy didn't change
+ * it) that sent the same one, and the list is singly linked as lookups walk
+ * it anyway.
+ */
 struct bgp_adj_in {
 	/* Linked list pointer.  */
 	struct bgp_adj_in *next;
-	struct bgp_adj_in *prev;
 
 	/* Received peer.  */
 	struct peer *peer;
@@ -101,11 +120,16 @@ struct bgp_adj_in {
 	/* Received attribute.  */
 	struct attr *attr;
 
-	/* timestamp (monotime) */
-	time_t uptime;
+	/* timestamp (monotime, seconds since startup fit in 32 bits) */
+	uint32_t uptime;
 
 	/* Addpath identifier */
 	uint32_t addpath_rx_id;
+
+	/* Reloaded from the Adj-RIB-In journal and not received from the
+	 * peer since, see bgp_journal_reconcile()
+	 */
+	bool stale;
 };
 
 /* BGP advertisement list.  */
@@ -135,13 +159,16 @@ struct bgp_synchronize {
 			(N)->TYPE = (A)->next;                                 \
 	} while (0)
 
-#define BGP_ADJ_IN_ADD(N, A) BGP_PATH_INFO_ADD(N, A, adj_in)
-#define BGP_ADJ_IN_DEL(N, A) BGP_PATH_INFO_DEL(N, A, adj_in)
-
 /* Prototypes.  */
 extern bool bgp_adj_out_lookup(struct peer *, struct bgp_dest *, uint32_t);
-extern void bgp_adj_in_set(struct bgp_dest *, struct peer *, struct attr *,
-			   uint32_t);
+extern struct bgp_adj_out *bgp_adj_out_find(struct bgp_dest *dest,
+					    struct update_subgroup *subgrp,
+					    uint32_t addpath_tx_id);
+extern void bgp_adj_out_link(struct bgp_dest *dest, struct bgp_adj_out *adj);
+extern void bgp_adj_out_unlink(struct bgp_dest *dest, struct bgp_adj_out *adj);
+extern size_t bgp_adj_out_index_slots(void);
+extern struct bgp_adj_in *bgp_adj_in_set(struct bgp_dest *, struct peer *,
+					 struct attr *, uint32_t);
 extern bool bgp_adj_in_unset(struct bgp_dest *, struct peer *, uint32_t);
 extern void bgp_adj_in_remove(struct bgp_dest *, struct bgp_adj_in *);
 
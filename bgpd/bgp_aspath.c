@@ -36,6 +36,7 @@
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_errors.h"
+#include "bgpd/bgp_intern.h"
 
 /* Attr. Flags and Attr. Type Code. */
 #define AS_HEADER_SIZE 2
@@ -86,7 +87,7 @@ struct assegment_header {
 };
 
 /* Hash for aspath.  This is the top level structure of AS path. */
-static struct hash *ashash;
+static struct bgp_intern ashash;
 
 /* Stream for SNMP. See aspath_snmp_pathseg */
 static struct stream *snmp_stream;
@@ -314,6 +315,7 @@ void aspath_free(struct aspath *aspath)
 	if (aspath->segments)
 		assegment_free_all(aspath->segments);
 	XFREE(MTYPE_AS_STR, aspath->str);
+	XFREE(MTYPE_AS_FILTER_MEMO, aspath->filter_memo);
 
 	if (aspath->json) {
 		json_object_free(aspath->json);
@@ -326,16 +328,9 @@ void aspath_free(struct aspath *aspath)
 /* Unintern aspath from AS path bucket. */
 void aspath_unintern(struct aspath **aspath)
 {
-	struct aspath *ret;
 	struct aspath *asp = *aspath;
 
-	if (asp->refcnt)
-		asp->refcnt--;
-
-	if (asp->refcnt == 0) {
-		/* This aspath must exist in aspath hash table. */
-		ret = hash_release(ashash, asp);
-		assert(ret != NULL);
+	if (bgp_intern_release(&ashash, asp, &asp->refcnt)) {
 		aspath_free(asp);
 		*aspath = NULL;
 	}
@@ -666,19 +661,28 @@ void aspath_str_update(struct aspath *as, bool make_json)
 struct aspath *aspath_intern(struct aspath *aspath)
 {
 	struct aspath *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
 	/* Assert this AS path structure is not interned and has the string
 	   representation built. */
 	assert(aspath->refcnt == 0);
 	assert(aspath->str);
 
+	/* Hash once, for the stripe, the lookup and the release */
+	aspath->hash = aspath_key_make(aspath);
+
 	/* Check AS path hash. */
-	find = hash_get(ashash, aspath, hash_alloc_intern);
+	key = bgp_intern_key(&ashash, aspath);
+	st = bgp_intern_stripe(&ashash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, aspath, key,
+					 hash_alloc_intern);
+		bgp_intern_ref(&find->refcnt);
+	}
 	if (find != aspath)
 		aspath_free(aspath);
 
-	find->refcnt++;
-
 	return find;
 }
 
@@ -726,7 +730,9 @@ static void *aspath_hash_alloc(void *arg)
 	new->segments = aspath->segments;
 	new->str = aspath->str;
 	new->str_len = aspath->str_len;
+	new->hash = aspath->hash;
 	new->json = aspath->json;
+	new->filter_memo = NULL;
 
 	return new;
 }
@@ -838,6 +844,9 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 {
 	struct aspath as;
 	struct aspath *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
+	bool hashed;
 
 	/* If length is odd it's malformed AS path. */
 	/* Nit-picking: if (use32bit == 0) it is malformed if odd,
@@ -853,13 +862,21 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 		return NULL;
 
 	/* If already same aspath exist then return it. */
-	find = hash_get(ashash, &as, aspath_hash_alloc);
+	as.hash = aspath_key_make(&as);
+	key = bgp_intern_key(&ashash, &as);
+	st = bgp_intern_stripe(&ashash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, &as, key, aspath_hash_alloc);
 
-	/* bug! should not happen, let the daemon crash below */
-	assert(find);
+		/* bug! should not happen, let the daemon crash below */
+		assert(find);
+
+		hashed = find->refcnt > 0;
+		bgp_intern_ref(&find->refcnt);
+	}
 
 	/* if the aspath was already hashed free temporary memory. */
-	if (find->refcnt) {
+	if (hashed) {
 		assegment_free_all(as.segments);
 		/* aspath_key_make() always updates the string */
 		XFREE(MTYPE_AS_STR, as.str);
@@ -869,11 +886,28 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 		}
 	}
 
-	find->refcnt++;
-
 	return find;
 }
 
+/* Same as aspath_parse(), but the AS path returned isn't interned yet, so
+   this can be used from any pthread.  aspath_intern() takes it from there. */
+struct aspath *aspath_parse_new(struct stream *s, size_t length, int use32bit)
+{
+	struct aspath *as;
+
+	if (length % AS16_VALUE_SIZE)
+		return NULL;
+
+	as = XCALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
+	if (assegments_parse(s, length, &as->segments, use32bit) < 0) {
+		XFREE(MTYPE_AS_PATH, as);
+		return NULL;
+	}
+
+	aspath_str_update(as, false);
+	return as;
+}
+
 static void assegment_data_put(struct stream *s, as_t *as, int num,
 			       int use32bit)
 {
@@ -1883,7 +1917,7 @@ struct aspath *aspath_empty_get(void)
 
 unsigned long aspath_count(void)
 {
-	return ashash->count;
+	return bgp_intern_count(&ashash);
 }
 
 /*
@@ -2039,6 +2073,9 @@ unsigned int aspath_key_make(const void *p)
 	const struct aspath *aspath = p;
 	unsigned int key = 0;
 
+	if (aspath->hash)
+		return aspath->hash;
+
 	if (!aspath->str)
 		aspath_str_update((struct aspath *)aspath, false);
 
@@ -2050,20 +2087,26 @@ unsigned int aspath_key_make(const void *p)
 /* If two aspath have same value then return 1 else return 0 */
 bool aspath_cmp(const void *arg1, const void *arg2)
 {
-	const struct assegment *seg1 = ((const struct aspath *)arg1)->segments;
-	const struct assegment *seg2 = ((const struct aspath *)arg2)->segments;
+	const struct aspath *as1 = arg1;
+	const struct aspath *as2 = arg2;
+	const struct assegment *seg1 = as1->segments;
+	const struct assegment *seg2 = as2->segments;
+
+	/* Differing hash keys or string lengths settle it early */
+	if (as1->hash && as2->hash && as1->hash != as2->hash)
+		return false;
+	if (as1->str && as2->str && as1->str_len != as2->str_len)
+		return false;
 
 	while (seg1 || seg2) {
-		int i;
 		if ((!seg1 && seg2) || (seg1 && !seg2))
 			return false;
 		if (seg1->type != seg2->type)
 			return false;
 		if (seg1->length != seg2->length)
 			return false;
-		for (i = 0; i < seg1->length; i++)
-			if (seg1->as[i] != seg2->as[i])
-				return false;
+		if (memcmp(seg1->as, seg2->as, seg1->length * sizeof(as_t)))
+			return false;
 		seg1 = seg1->next;
 		seg2 = seg2->next;
 	}
@@ -2073,15 +2116,13 @@ bool aspath_cmp(const void *arg1, const void *arg2)
 /* AS path hash initialize. */
 void aspath_init(void)
 {
-	ashash = hash_create_size(32768, aspath_key_make, aspath_cmp,
-				  "BGP AS Path");
+	bgp_intern_init(&ashash, hash_create_size, 32768, aspath_key_make,
+			aspath_cmp, "BGP AS Path");
 }
 
 void aspath_finish(void)
 {
-	hash_clean(ashash, (void (*)(void *))aspath_free);
-	hash_free(ashash);
-	ashash = NULL;
+	bgp_intern_finish(&ashash, (void (*)(void *))aspath_free);
 
 	if (snmp_stream)
 		stream_free(snmp_stream);
@@ -2113,7 +2154,8 @@ static void aspath_show_all_iterator(struct hash_bucket *bucket,
 
 	as = (struct aspath *)bucket->data;
 
-	vty_out(vty, "[%p:%u] (%ld) ", (void *)bucket, bucket->key, as->refcnt);
+	vty_out(vty, "[%p:%u] (%zu) ", (void *)bucket, bucket->key,
+		(size_t)as->refcnt);
 	vty_out(vty, "%s\n", as->str);
 }
 
@@ -2121,9 +2163,10 @@ static void aspath_show_all_iterator(struct hash_bucket *bucket,
    `show [ip] bgp paths' command. */
 void aspath_print_all_vty(struct vty *vty)
 {
-	hash_iterate(ashash, (void (*)(struct hash_bucket *,
-				       void *))aspath_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(&ashash,
+			   (void (*)(struct hash_bucket *,
+				     void *))aspath_show_all_iterator,
+			   vty);
 }
 
 static struct aspath *bgp_aggr_aspath_lookup(struct bgp_aggregate *aggregate,
@@ -2162,10 +2205,30 @@ void bgp_aggr_aspath_remove(void *arg)
 void bgp_compute_aggregate_aspath(struct bgp_aggregate *aggregate,
 				  struct aspath *aspath)
 {
+	struct aspath *aggr_aspath;
+	struct aspath *new_aspath;
+
+	if ((aggregate == NULL) || (aspath == NULL))
+		return;
+
 	bgp_compute_aggregate_aspath_hash(aggregate, aspath);
 
-	bgp_compute_aggregate_aspath_val(aggregate);
+	/* The aggregate's as-path only changes when an as-path not seen
+	 * before among the aggregated routes shows up; fold just that one
+	 * in instead of recomputing from the whole hash.
+	 */
+	aggr_aspath = bgp_aggr_aspath_lookup(aggregate, aspath);
+	if (!aggr_aspath || aggr_aspath->refcnt > 1)
+		return;
+
+	if (!aggregate->aspath) {
+		bgp_compute_aggregate_aspath_val(aggregate);
+		return;
+	}
 
+	new_aspath = aspath_aggregate(aggregate->aspath, aggr_aspath);
+	aspath_free(aggregate->aspath);
+	aggregate->aspath = new_aspath;
 }
 
 void bgp_compute_aggregate_aspath_hash(struct bgp_aggregate *aggregate,
@@ -60,7 +60,7 @@ struct assegment {
 /* AS path may be include some AsSegments.  */
 struct aspath {
 	/* Reference count to this aspath.  */
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 
 	/* segment data */
 	struct assegment *segments;
@@ -72,6 +72,22 @@ struct aspath {
 	   and AS path regular expression match.  */
 	char *str;
 	unsigned short str_len;
+
+	/* Hash key, set once interned; 0 means not computed. */
+	uint32_t hash;
+
+	/* as-path access-list results, only for interned AS paths */
+	struct aspath_filter_memo *filter_memo;
+};
+
+/* Last few as_list_apply() results, see there. */
+struct aspath_filter_memo {
+	unsigned int next;
+	struct {
+		const struct as_list *list;
+		uint32_t version;
+		uint8_t type;
+	} ent[4];
 };
 
 #define ASPATH_STR_DEFAULT_LEN 32
@@ -80,6 +96,8 @@ struct aspath {
 extern void aspath_init(void);
 extern void aspath_finish(void);
 extern struct aspath *aspath_parse(struct stream *, size_t, int);
+extern struct aspath *aspath_parse_new(struct stream *s, size_t length,
+				       int use32bit);
 extern struct aspath *aspath_dup(struct aspath *);
 extern struct aspath *aspath_aggregate(struct aspath *, struct aspath *);
 extern struct aspath *aspath_prepend(struct aspath *, struct aspath *);
@@ -28,6 +28,7 @@
 #include "log.h"
 #include "hash.h"
 #include "jhash.h"
+#include "fhash.h"
 #include "queue.h"
 #include "table.h"
 #include "filter.h"
@@ -36,6 +37,7 @@
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_community.h"
@@ -47,6 +49,7 @@
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_encap_types.h"
+#include "bgpd/bgp_parse.h"
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
 #include "bgp_encap_types.h"
@@ -96,7 +99,7 @@ static const struct message attr_flag_str[] = {
 	{BGP_ATTR_FLAG_EXTLEN, "Extended Length"},
 	{0}};
 
-static struct hash *cluster_hash;
+static struct bgp_intern cluster_hash;
 
 static void *cluster_hash_alloc(void *p)
 {
@@ -118,16 +121,23 @@ static void *cluster_hash_alloc(void *p)
 }
 
 /* Cluster list related functions. */
-static struct cluster_list *cluster_parse(struct in_addr *pnt, int length)
+struct cluster_list *cluster_parse(struct in_addr *pnt, int length)
 {
 	struct cluster_list tmp = {};
 	struct cluster_list *cluster;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
 	tmp.length = length;
 	tmp.list = length == 0 ? NULL : pnt;
 
-	cluster = hash_get(cluster_hash, &tmp, cluster_hash_alloc);
-	cluster->refcnt++;
+	key = bgp_intern_key(&cluster_hash, &tmp);
+	st = bgp_intern_stripe(&cluster_hash, key);
+	frr_with_mutex (&st->mtx) {
+		cluster = hash_get_with_key(st->hash, &tmp, key,
+					    cluster_hash_alloc);
+		bgp_intern_ref(&cluster->refcnt);
+	}
 	return cluster;
 }
 
@@ -145,7 +155,7 @@ static unsigned int cluster_hash_key_make(const void *p)
 {
 	const struct cluster_list *cluster = p;
 
-	return jhash(cluster->list, cluster->length, 0);
+	return fhash(cluster->list, cluster->length, 0);
 }
 
 static bool cluster_hash_cmp(const void *p1, const void *p2)
@@ -174,21 +184,23 @@ static void cluster_free(struct cluster_list *cluster)
 static struct cluster_list *cluster_intern(struct cluster_list *cluster)
 {
 	struct cluster_list *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
-	find = hash_get(cluster_hash, cluster, cluster_hash_alloc);
-	find->refcnt++;
+	key = bgp_intern_key(&cluster_hash, cluster);
+	st = bgp_intern_stripe(&cluster_hash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, cluster, key,
+					 cluster_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
 
 	return find;
 }
 
 static void cluster_unintern(struct cluster_list **cluster)
 {
-	if ((*cluster)->refcnt)
-		(*cluster)->refcnt--;
-
-	if ((*cluster)->refcnt == 0) {
-		void *p = hash_release(cluster_hash, *cluster);
-		assert(p == *cluster);
+	if (bgp_intern_release(&cluster_hash, *cluster, &(*cluster)->refcnt)) {
 		cluster_free(*cluster);
 		*cluster = NULL;
 	}
@@ -196,23 +208,21 @@ static void cluster_unintern(struct cluster_list **cluster)
 
 static void cluster_init(void)
 {
-	cluster_hash = hash_create(cluster_hash_key_make, cluster_hash_cmp,
-				   "BGP Cluster");
+	bgp_intern_init(&cluster_hash, hash_create_size, HASH_INITIAL_SIZE,
+			cluster_hash_key_make, cluster_hash_cmp, "BGP Cluster");
 }
 
 static void cluster_finish(void)
 {
-	hash_clean(cluster_hash, (void (*)(void *))cluster_free);
-	hash_free(cluster_hash);
-	cluster_hash = NULL;
+	bgp_intern_finish(&cluster_hash, (void (*)(void *))cluster_free);
 }
 
-static struct hash *encap_hash = NULL;
+static struct bgp_intern encap_hash;
 #ifdef ENABLE_BGP_VNC
-static struct hash *vnc_hash = NULL;
+static struct bgp_intern vnc_hash;
 #endif
-static struct hash *srv6_l3vpn_hash;
-static struct hash *srv6_vpn_hash;
+static struct bgp_intern srv6_l3vpn_hash;
+static struct bgp_intern srv6_vpn_hash;
 
 struct bgp_attr_encap_subtlv *encap_tlv_dup(struct bgp_attr_encap_subtlv *orig)
 {
@@ -330,16 +340,23 @@ static struct bgp_attr_encap_subtlv *
 encap_intern(struct bgp_attr_encap_subtlv *encap, encap_subtlv_type type)
 {
 	struct bgp_attr_encap_subtlv *find;
-	struct hash *hash = encap_hash;
+	struct bgp_intern *tab = &encap_hash;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 #ifdef ENABLE_BGP_VNC
 	if (type == VNC_SUBTLV_TYPE)
-		hash = vnc_hash;
+		tab = &vnc_hash;
 #endif
 
-	find = hash_get(hash, encap, encap_hash_alloc);
+	key = bgp_intern_key(tab, encap);
+	st = bgp_intern_stripe(tab, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, encap, key,
+					 encap_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
 	if (find != encap)
 		encap_free(encap);
-	find->refcnt++;
 
 	return find;
 }
@@ -348,16 +365,13 @@ static void encap_unintern(struct bgp_attr_encap_subtlv **encapp,
 			   encap_subtlv_type type)
 {
 	struct bgp_attr_encap_subtlv *encap = *encapp;
-	if (encap->refcnt)
-		encap->refcnt--;
-
-	if (encap->refcnt == 0) {
-		struct hash *hash = encap_hash;
+	struct bgp_intern *tab = &encap_hash;
 #ifdef ENABLE_BGP_VNC
-		if (type == VNC_SUBTLV_TYPE)
-			hash = vnc_hash;
+	if (type == VNC_SUBTLV_TYPE)
+		tab = &vnc_hash;
 #endif
-		hash_release(hash, encap);
+
+	if (bgp_intern_release(tab, encap, &encap->refcnt)) {
 		encap_free(encap);
 		*encapp = NULL;
 	}
@@ -367,7 +381,7 @@ static unsigned int encap_hash_key_make(const void *p)
 {
 	const struct bgp_attr_encap_subtlv *encap = p;
 
-	return jhash(encap->value, encap->length, 0);
+	return fhash(encap->value, encap->length, 0);
 }
 
 static bool encap_hash_cmp(const void *p1, const void *p2)
@@ -378,42 +392,173 @@ static bool encap_hash_cmp(const void *p1, const void *p2)
 
 static void encap_init(void)
 {
-	encap_hash = hash_create(encap_hash_key_make, encap_hash_cmp,
-				 "BGP Encap Hash");
+	bgp_intern_init(&encap_hash, hash_create_size, HASH_INITIAL_SIZE,
+			encap_hash_key_make, encap_hash_cmp, "BGP Encap Hash");
 #ifdef ENABLE_BGP_VNC
-	vnc_hash = hash_create(encap_hash_key_make, encap_hash_cmp,
-			       "BGP VNC Hash");
+	bgp_intern_init(&vnc_hash, hash_create_size, HASH_INITIAL_SIZE,
+			encap_hash_key_make, encap_hash_cmp, "BGP VNC Hash");
 #endif
 }
 
 static void encap_finish(void)
 {
-	hash_clean(encap_hash, (void (*)(void *))encap_free);
-	hash_free(encap_hash);
-	encap_hash = NULL;
+	bgp_intern_finish(&encap_hash, (void (*)(void *))encap_free);
 #ifdef ENABLE_BGP_VNC
-	hash_clean(vnc_hash, (void (*)(void *))encap_free);
-	hash_free(vnc_hash);
-	vnc_hash = NULL;
+	bgp_intern_finish(&vnc_hash, (void (*)(void *))encap_free);
 #endif
 }
 
-static bool overlay_index_same(const struct attr *a1, const struct attr *a2)
+/* EVPN parts of attributes. */
+static struct bgp_intern evpn_hash;
+
+const struct bgp_attr_evpn bgp_attr_evpn_none;
+
+static void *evpn_hash_alloc(void *p)
 {
-	if (!a1 && a2)
-		return false;
-	if (!a2 && a1)
-		return false;
-	if (!a1 && !a2)
+	return p;
+}
+
+static void evpn_free(struct bgp_attr_evpn *evpn)
+{
+	XFREE(MTYPE_BGP_ATTR_EVPN, evpn);
+}
+
+static struct bgp_attr_evpn *evpn_intern(struct bgp_attr_evpn *evpn)
+{
+	struct bgp_attr_evpn *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
+
+	key = bgp_intern_key(&evpn_hash, evpn);
+	st = bgp_intern_stripe(&evpn_hash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, evpn, key, evpn_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
+	if (find != evpn)
+		evpn_free(evpn);
+	return find;
+}
+
+static void evpn_unintern(struct bgp_attr_evpn **evpnp)
+{
+	struct bgp_attr_evpn *evpn = *evpnp;
+
+	if (bgp_intern_release(&evpn_hash, evpn, &evpn->refcnt)) {
+		evpn_free(evpn);
+		*evpnp = NULL;
+	}
+}
+
+static unsigned int evpn_hash_key_make(const void *p)
+{
+	const struct bgp_attr_evpn *evpn = p;
+	uint32_t key = 0;
+
+	key = jhash(&evpn->overlay, sizeof(evpn->overlay), key);
+	key = jhash(&evpn->esi, sizeof(evpn->esi), key);
+	key = jhash(&evpn->rmac, sizeof(evpn->rmac), key);
+	key = jhash_3words(evpn->mm_seqnum, evpn->mm_sync_seqnum,
+			   evpn->df_pref, key);
+	key = jhash_3words(evpn->df_alg | evpn->sticky << 8,
+			   evpn->default_gw | evpn->router_flag << 8,
+			   evpn->es_flags, key);
+	return key;
+}
+
+static bool evpn_hash_cmp(const void *p1, const void *p2)
+{
+	const struct bgp_attr_evpn *evpn1 = p1;
+	const struct bgp_attr_evpn *evpn2 = p2;
+
+	return !memcmp(&evpn1->overlay, &evpn2->overlay,
+		       sizeof(struct bgp_route_evpn))
+	       && !memcmp(&evpn1->esi, &evpn2->esi, sizeof(esi_t))
+	       && !memcmp(&evpn1->rmac, &evpn2->rmac, sizeof(struct ethaddr))
+	       && evpn1->mm_seqnum == evpn2->mm_seqnum
+	       && evpn1->mm_sync_seqnum == evpn2->mm_sync_seqnum
+	       && evpn1->df_pref == evpn2->df_pref
+	       && evpn1->df_alg == evpn2->df_alg
+	       && evpn1->sticky == evpn2->sticky
+	       && evpn1->default_gw == evpn2->default_gw
+	       && evpn1->router_flag == evpn2->router_flag
+	       && evpn1->es_flags == evpn2->es_flags;
+}
+
+/*
+ * What attributes are told apart by; MAC mobility, the router MAC and the
+ * gateway and router flags are derived from the extended communities, which
+ * are compared separately.
+ */
+static bool evpn_same(const struct attr *a1, const struct attr *a2)
+{
+	const struct bgp_attr_evpn *evpn1 = bgp_attr_get_evpn(a1);
+	const struct bgp_attr_evpn *evpn2 = bgp_attr_get_evpn(a2);
+
+	if (evpn1 == evpn2)
 		return true;
 
-	return !memcmp(bgp_attr_get_evpn_overlay(a1),
-		       bgp_attr_get_evpn_overlay(a2),
-		       sizeof(struct bgp_route_evpn));
+	return !memcmp(&evpn1->overlay, &evpn2->overlay,
+		       sizeof(struct bgp_route_evpn))
+	       && !memcmp(&evpn1->esi, &evpn2->esi, sizeof(esi_t))
+	       && evpn1->es_flags == evpn2->es_flags
+	       && evpn1->mm_sync_seqnum == evpn2->mm_sync_seqnum
+	       && evpn1->df_pref == evpn2->df_pref
+	       && evpn1->df_alg == evpn2->df_alg;
+}
+
+struct bgp_attr_evpn *bgp_attr_evpn_modify(struct attr *attr)
+{
+	struct bgp_attr_evpn *evpn = attr->evpn;
+
+	assert(attr->refcnt == 0);
+
+	if (evpn && !evpn->refcnt)
+		return evpn;
+
+	/* shared with other attributes, or not there yet */
+	attr->evpn = XMALLOC(MTYPE_BGP_ATTR_EVPN, sizeof(struct bgp_attr_evpn));
+	*attr->evpn = evpn ? *evpn : bgp_attr_evpn_none;
+	attr->evpn->refcnt = 0;
+
+	return attr->evpn;
+}
+
+void bgp_attr_evpn_set(struct attr *attr, const struct bgp_attr_evpn *evpn)
+{
+	struct bgp_attr_evpn *old = attr->evpn;
+	struct bgp_attr_evpn *new;
+
+	if (evpn_hash_cmp(evpn, bgp_attr_get_evpn(attr)))
+		return;
+
+	new = XMALLOC(MTYPE_BGP_ATTR_EVPN, sizeof(struct bgp_attr_evpn));
+	*new = *evpn;
+	new->refcnt = 0;
+	attr->evpn = evpn_intern(new);
+
+	if (old)
+		evpn_unintern(&old);
+}
+
+unsigned long int attr_evpn_count(void)
+{
+	return bgp_intern_count(&evpn_hash);
+}
+
+static void evpn_init(void)
+{
+	bgp_intern_init(&evpn_hash, hash_create_size, HASH_INITIAL_SIZE,
+			evpn_hash_key_make, evpn_hash_cmp, "BGP EVPN Hash");
+}
+
+static void evpn_finish(void)
+{
+	bgp_intern_finish(&evpn_hash, (void (*)(void *))evpn_free);
 }
 
 /* Unknown transit attribute. */
-static struct hash *transit_hash;
+static struct bgp_intern transit_hash;
 
 static void transit_free(struct transit *transit)
 {
@@ -430,22 +575,25 @@ static void *transit_hash_alloc(void *p)
 static struct transit *transit_intern(struct transit *transit)
 {
 	struct transit *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
-	find = hash_get(transit_hash, transit, transit_hash_alloc);
+	key = bgp_intern_key(&transit_hash, transit);
+	st = bgp_intern_stripe(&transit_hash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, transit, key,
+					 transit_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
 	if (find != transit)
 		transit_free(transit);
-	find->refcnt++;
 
 	return find;
 }
 
 static void transit_unintern(struct transit **transit)
 {
-	if ((*transit)->refcnt)
-		(*transit)->refcnt--;
-
-	if ((*transit)->refcnt == 0) {
-		hash_release(transit_hash, *transit);
+	if (bgp_intern_release(&transit_hash, *transit, &(*transit)->refcnt)) {
 		transit_free(*transit);
 		*transit = NULL;
 	}
@@ -465,11 +613,18 @@ static struct bgp_attr_srv6_l3vpn *
 srv6_l3vpn_intern(struct bgp_attr_srv6_l3vpn *l3vpn)
 {
 	struct bgp_attr_srv6_l3vpn *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
-	find = hash_get(srv6_l3vpn_hash, l3vpn, srv6_l3vpn_hash_alloc);
+	key = bgp_intern_key(&srv6_l3vpn_hash, l3vpn);
+	st = bgp_intern_stripe(&srv6_l3vpn_hash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, l3vpn, key,
+					 srv6_l3vpn_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
 	if (find != l3vpn)
 		srv6_l3vpn_free(l3vpn);
-	find->refcnt++;
 	return find;
 }
 
@@ -477,11 +632,7 @@ static void srv6_l3vpn_unintern(struct bgp_attr_srv6_l3vpn **l3vpnp)
 {
 	struct bgp_attr_srv6_l3vpn *l3vpn = *l3vpnp;
 
-	if (l3vpn->refcnt)
-		l3vpn->refcnt--;
-
-	if (l3vpn->refcnt == 0) {
-		hash_release(srv6_l3vpn_hash, l3vpn);
+	if (bgp_intern_release(&srv6_l3vpn_hash, l3vpn, &l3vpn->refcnt)) {
 		srv6_l3vpn_free(l3vpn);
 		*l3vpnp = NULL;
 	}
@@ -500,11 +651,18 @@ static void srv6_vpn_free(struct bgp_attr_srv6_vpn *vpn)
 static struct bgp_attr_srv6_vpn *srv6_vpn_intern(struct bgp_attr_srv6_vpn *vpn)
 {
 	struct bgp_attr_srv6_vpn *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
-	find = hash_get(srv6_vpn_hash, vpn, srv6_vpn_hash_alloc);
+	key = bgp_intern_key(&srv6_vpn_hash, vpn);
+	st = bgp_intern_stripe(&srv6_vpn_hash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, vpn, key,
+					 srv6_vpn_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
 	if (find != vpn)
 		srv6_vpn_free(vpn);
-	find->refcnt++;
 	return find;
 }
 
@@ -512,11 +670,7 @@ static void srv6_vpn_unintern(struct bgp_attr_srv6_vpn **vpnp)
 {
 	struct bgp_attr_srv6_vpn *vpn = *vpnp;
 
-	if (vpn->refcnt)
-		vpn->refcnt--;
-
-	if (vpn->refcnt == 0) {
-		hash_release(srv6_vpn_hash, vpn);
+	if (bgp_intern_release(&srv6_vpn_hash, vpn, &vpn->refcnt)) {
 		srv6_vpn_free(vpn);
 		*vpnp = NULL;
 	}
@@ -586,28 +740,26 @@ static bool srv6_vpn_same(const struct bgp_attr_srv6_vpn *h1,
 
 static void srv6_init(void)
 {
-	srv6_l3vpn_hash =
-		hash_create(srv6_l3vpn_hash_key_make, srv6_l3vpn_hash_cmp,
-			    "BGP Prefix-SID SRv6-L3VPN-Service-TLV");
-	srv6_vpn_hash = hash_create(srv6_vpn_hash_key_make, srv6_vpn_hash_cmp,
-				    "BGP Prefix-SID SRv6-VPN-Service-TLV");
+	bgp_intern_init(&srv6_l3vpn_hash, hash_create_size, HASH_INITIAL_SIZE,
+			srv6_l3vpn_hash_key_make, srv6_l3vpn_hash_cmp,
+			"BGP Prefix-SID SRv6-L3VPN-Service-TLV");
+	bgp_intern_init(&srv6_vpn_hash, hash_create_size, HASH_INITIAL_SIZE,
+			srv6_vpn_hash_key_make, srv6_vpn_hash_cmp,
+			"BGP Prefix-SID SRv6-VPN-Service-TLV");
 }
 
 static void srv6_finish(void)
 {
-	hash_clean(srv6_l3vpn_hash, (void (*)(void *))srv6_l3vpn_free);
-	hash_free(srv6_l3vpn_hash);
-	srv6_l3vpn_hash = NULL;
-	hash_clean(srv6_vpn_hash, (void (*)(void *))srv6_vpn_free);
-	hash_free(srv6_vpn_hash);
-	srv6_vpn_hash = NULL;
+	bgp_intern_finish(&srv6_l3vpn_hash,
+			  (void (*)(void *))srv6_l3vpn_free);
+	bgp_intern_finish(&srv6_vpn_hash, (void (*)(void *))srv6_vpn_free);
 }
 
 static unsigned int transit_hash_key_make(const void *p)
 {
 	const struct transit *transit = p;
 
-	return jhash(transit->val, transit->length, 0);
+	return fhash(transit->val, transit->length, 0);
 }
 
 static bool transit_hash_cmp(const void *p1, const void *p2)
@@ -621,43 +773,43 @@ static bool transit_hash_cmp(const void *p1, const void *p2)
 
 static void transit_init(void)
 {
-	transit_hash = hash_create(transit_hash_key_make, transit_hash_cmp,
-				   "BGP Transit Hash");
+	bgp_intern_init(&transit_hash, hash_create_size, HASH_INITIAL_SIZE,
+			transit_hash_key_make, transit_hash_cmp,
+			"BGP Transit Hash");
 }
 
 static void transit_finish(void)
 {
-	hash_clean(transit_hash, (void (*)(void *))transit_free);
-	hash_free(transit_hash);
-	transit_hash = NULL;
+	bgp_intern_finish(&transit_hash, (void (*)(void *))transit_free);
 }
 
 /* Attribute hash routines. */
-static struct hash *attrhash;
+static struct bgp_intern attrhash;
 
 unsigned long int attr_count(void)
 {
-	return attrhash->count;
+	return bgp_intern_count(&attrhash);
 }
 
 unsigned long int attr_unknown_count(void)
 {
-	return transit_hash->count;
+	return bgp_intern_count(&transit_hash);
 }
 
 unsigned int attrhash_key_make(const void *p)
 {
 	const struct attr *attr = (struct attr *)p;
-	uint32_t key = 0;
-#define MIX(val)	key = jhash_1word(val, key)
-#define MIX3(a, b, c)	key = jhash_3words((a), (b), (c), key)
-
-	MIX3(attr->origin, attr->nexthop.s_addr, attr->med);
-	MIX3(attr->local_pref, attr->aggregator_as,
-	     attr->aggregator_addr.s_addr);
-	MIX3(attr->weight, attr->mp_nexthop_global_in.s_addr,
-	     attr->originator_id.s_addr);
-	MIX3(attr->tag, attr->label, attr->label_index);
+	struct fhash_state st;
+#define MIX(val)	fhash_add_u32(&st, val)
+#define MIX2(a, b)	fhash_add_u32x2(&st, (a), (b))
+
+	fhash_init(&st, 0);
+	MIX2(attr->origin, attr->nexthop.s_addr);
+	MIX2(attr->med, attr->local_pref);
+	MIX2(attr->aggregator_as, attr->aggregator_addr.s_addr);
+	MIX2(attr->weight, attr->mp_nexthop_global_in.s_addr);
+	MIX2(attr->originator_id.s_addr, attr->tag);
+	MIX2(attr->label, attr->label_index);
 
 	if (attr->aspath)
 		MIX(aspath_key_make(attr->aspath));
@@ -683,12 +835,14 @@ unsigned int attrhash_key_make(const void *p)
 		MIX(encap_hash_key_make(vnc_subtlvs));
 #endif
 	MIX(attr->mp_nexthop_len);
-	key = jhash(attr->mp_nexthop_global.s6_addr, IPV6_MAX_BYTELEN, key);
-	key = jhash(attr->mp_nexthop_local.s6_addr, IPV6_MAX_BYTELEN, key);
-	MIX3(attr->nh_ifindex, attr->nh_lla_ifindex, attr->distance);
-	MIX(attr->rmap_table_id);
-
-	return key;
+	fhash_add(&st, attr->mp_nexthop_global.s6_addr, IPV6_MAX_BYTELEN);
+	fhash_add(&st, attr->mp_nexthop_local.s6_addr, IPV6_MAX_BYTELEN);
+	MIX2(attr->nh_ifindex, attr->nh_lla_ifindex);
+	MIX2(attr->distance, attr->rmap_table_id);
+#undef MIX
+#undef MIX2
+
+	return fhash_final(&st);
 }
 
 bool attrhash_cmp(const void *p1, const void *p2)
@@ -732,12 +886,7 @@ bool attrhash_cmp(const void *p1, const void *p2)
 				      &attr2->mp_nexthop_global_in)
 		    && IPV4_ADDR_SAME(&attr1->originator_id,
 				      &attr2->originator_id)
-		    && overlay_index_same(attr1, attr2)
-		    && !memcmp(&attr1->esi, &attr2->esi, sizeof(esi_t))
-		    && attr1->es_flags == attr2->es_flags
-		    && attr1->mm_sync_seqnum == attr2->mm_sync_seqnum
-		    && attr1->df_pref == attr2->df_pref
-		    && attr1->df_alg == attr2->df_alg
+		    && evpn_same(attr1, attr2)
 		    && attr1->nh_ifindex == attr2->nh_ifindex
 		    && attr1->nh_lla_ifindex == attr2->nh_lla_ifindex
 		    && attr1->distance == attr2->distance
@@ -752,8 +901,9 @@ bool attrhash_cmp(const void *p1, const void *p2)
 
 static void attrhash_init(void)
 {
-	attrhash =
-		hash_create(attrhash_key_make, attrhash_cmp, "BGP Attributes");
+	bgp_intern_init(&attrhash, hash_create_open,
+			BGP_INTERN_STRIPES * HASH_INITIAL_SIZE,
+			attrhash_key_make, attrhash_cmp, "BGP Attributes");
 }
 
 /*
@@ -766,9 +916,7 @@ static void attr_vfree(void *attr)
 
 static void attrhash_finish(void)
 {
-	hash_clean(attrhash, attr_vfree);
-	hash_free(attrhash);
-	attrhash = NULL;
+	bgp_intern_finish(&attrhash, attr_vfree);
 }
 
 static void attr_show_all_iterator(struct hash_bucket *bucket, struct vty *vty)
@@ -776,7 +924,8 @@ static void attr_show_all_iterator(struct hash_bucket *bucket, struct vty *vty)
 	struct attr *attr = bucket->data;
 	char sid_str[BUFSIZ];
 
-	vty_out(vty, "attr[%ld] nexthop %pI4\n", attr->refcnt, &attr->nexthop);
+	vty_out(vty, "attr[%zu] nexthop %pI4\n", (size_t)attr->refcnt,
+		&attr->nexthop);
 
 	sid_str[0] = '\0';
 	if (attr->srv6_l3vpn)
@@ -792,18 +941,23 @@ static void attr_show_all_iterator(struct hash_bucket *bucket, struct vty *vty)
 
 void attr_show_all(struct vty *vty)
 {
-	hash_iterate(attrhash, (void (*)(struct hash_bucket *,
-					 void *))attr_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(&attrhash,
+			   (void (*)(struct hash_bucket *,
+				     void *))attr_show_all_iterator,
+			   vty);
 }
 
 static void *bgp_attr_hash_alloc(void *p)
 {
+	static _Atomic uint64_t intern_id;
 	struct attr *val = (struct attr *)p;
 	struct attr *attr;
 
 	attr = XMALLOC(MTYPE_ATTR, sizeof(struct attr));
 	*attr = *val;
+	attr->intern_id = atomic_fetch_add_explicit(&intern_id, 1,
+						    memory_order_relaxed)
+			  + 1;
 	if (val->encap_subtlvs) {
 		val->encap_subtlvs = NULL;
 	}
@@ -823,10 +977,9 @@ static void *bgp_attr_hash_alloc(void *p)
 	return attr;
 }
 
-/* Internet argument attribute. */
-struct attr *bgp_attr_intern(struct attr *attr)
+/* Intern the structures attr refers to, or reference them if they are. */
+static void bgp_attr_intern_sub(struct attr *attr)
 {
-	struct attr *find;
 	struct ecommunity *ecomm;
 
 	/* Intern referenced strucutre. */
@@ -834,20 +987,20 @@ struct attr *bgp_attr_intern(struct attr *attr)
 		if (!attr->aspath->refcnt)
 			attr->aspath = aspath_intern(attr->aspath);
 		else
-			attr->aspath->refcnt++;
+			bgp_intern_ref(&attr->aspath->refcnt);
 	}
 	if (attr->community) {
 		if (!attr->community->refcnt)
 			attr->community = community_intern(attr->community);
 		else
-			attr->community->refcnt++;
+			bgp_intern_ref(&attr->community->refcnt);
 	}
 
 	if (attr->ecommunity) {
 		if (!attr->ecommunity->refcnt)
 			attr->ecommunity = ecommunity_intern(attr->ecommunity);
 		else
-			attr->ecommunity->refcnt++;
+			bgp_intern_ref(&attr->ecommunity->refcnt);
 	}
 
 	ecomm = bgp_attr_get_ipv6_ecommunity(attr);
@@ -856,14 +1009,14 @@ struct attr *bgp_attr_intern(struct attr *attr)
 			bgp_attr_set_ipv6_ecommunity(attr,
 						     ecommunity_intern(ecomm));
 		else
-			ecomm->refcnt++;
+			bgp_intern_ref(&ecomm->refcnt);
 	}
 
 	if (attr->lcommunity) {
 		if (!attr->lcommunity->refcnt)
 			attr->lcommunity = lcommunity_intern(attr->lcommunity);
 		else
-			attr->lcommunity->refcnt++;
+			bgp_intern_ref(&attr->lcommunity->refcnt);
 	}
 
 	struct cluster_list *cluster = bgp_attr_get_cluster(attr);
@@ -872,7 +1025,7 @@ struct attr *bgp_attr_intern(struct attr *attr)
 		if (!cluster->refcnt)
 			bgp_attr_set_cluster(attr, cluster_intern(cluster));
 		else
-			cluster->refcnt++;
+			bgp_intern_ref(&cluster->refcnt);
 	}
 
 	struct transit *transit = bgp_attr_get_transit(attr);
@@ -881,26 +1034,32 @@ struct attr *bgp_attr_intern(struct attr *attr)
 		if (!transit->refcnt)
 			bgp_attr_set_transit(attr, transit_intern(transit));
 		else
-			transit->refcnt++;
+			bgp_intern_ref(&transit->refcnt);
 	}
 	if (attr->encap_subtlvs) {
 		if (!attr->encap_subtlvs->refcnt)
 			attr->encap_subtlvs = encap_intern(attr->encap_subtlvs,
 							   ENCAP_SUBTLV_TYPE);
 		else
-			attr->encap_subtlvs->refcnt++;
+			bgp_intern_ref(&attr->encap_subtlvs->refcnt);
 	}
 	if (attr->srv6_l3vpn) {
 		if (!attr->srv6_l3vpn->refcnt)
 			attr->srv6_l3vpn = srv6_l3vpn_intern(attr->srv6_l3vpn);
 		else
-			attr->srv6_l3vpn->refcnt++;
+			bgp_intern_ref(&attr->srv6_l3vpn->refcnt);
 	}
 	if (attr->srv6_vpn) {
 		if (!attr->srv6_vpn->refcnt)
 			attr->srv6_vpn = srv6_vpn_intern(attr->srv6_vpn);
 		else
-			attr->srv6_vpn->refcnt++;
+			bgp_intern_ref(&attr->srv6_vpn->refcnt);
+	}
+	if (attr->evpn) {
+		if (!attr->evpn->refcnt)
+			attr->evpn = evpn_intern(attr->evpn);
+		else
+			bgp_intern_ref(&attr->evpn->refcnt);
 	}
 #ifdef ENABLE_BGP_VNC
 	struct bgp_attr_encap_subtlv *vnc_subtlvs =
@@ -912,9 +1071,19 @@ struct attr *bgp_attr_intern(struct attr *attr)
 				attr,
 				encap_intern(vnc_subtlvs, VNC_SUBTLV_TYPE));
 		else
-			vnc_subtlvs->refcnt++;
+			bgp_intern_ref(&vnc_subtlvs->refcnt);
 	}
 #endif
+}
+
+/* Internet argument attribute. */
+struct attr *bgp_attr_intern(struct attr *attr)
+{
+	struct attr *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
+
+	bgp_attr_intern_sub(attr);
 
 	/* At this point, attr only contains intern'd pointers.  that means
 	 * if we find it in attrhash, it has all the same pointers and we
@@ -922,12 +1091,32 @@ struct attr *bgp_attr_intern(struct attr *attr)
 	 * If we don't find it, we need to allocate a one because in all
 	 * cases this returns a new reference to a hashed attr, but the input
 	 * wasn't on hash. */
-	find = (struct attr *)hash_get(attrhash, attr, bgp_attr_hash_alloc);
-	find->refcnt++;
+	key = bgp_intern_key(&attrhash, attr);
+	st = bgp_intern_stripe(&attrhash, key);
+	frr_with_mutex (&st->mtx) {
+		find = hash_get_with_key(st->hash, attr, key,
+					 bgp_attr_hash_alloc);
+		bgp_intern_ref(&find->refcnt);
+	}
 
 	return find;
 }
 
+/*
+ * Another reference to an interned attribute, same as bgp_attr_intern()
+ * returns for it, but without looking it up.  The caller must hold a
+ * reference already.
+ */
+struct attr *bgp_attr_ref(struct attr *attr)
+{
+	assert(attr->refcnt);
+
+	bgp_attr_intern_sub(attr);
+	bgp_intern_ref(&attr->refcnt);
+
+	return attr;
+}
+
 /* Make network statement's attribute. */
 struct attr *bgp_attr_default_set(struct attr *attr, uint8_t origin)
 {
@@ -1116,6 +1305,9 @@ void bgp_attr_unintern_sub(struct attr *attr)
 
 	if (attr->srv6_vpn)
 		srv6_vpn_unintern(&attr->srv6_vpn);
+
+	if (attr->evpn)
+		evpn_unintern(&attr->evpn);
 }
 
 /*
@@ -1141,24 +1333,22 @@ void bgp_attr_undup(struct attr *new, struct attr *old)
 
 	if (new->lcommunity != old->lcommunity)
 		lcommunity_free(&new->lcommunity);
+
+	if (new->evpn != old->evpn && new->evpn && !new->evpn->refcnt)
+		evpn_free(new->evpn);
 }
 
 /* Free bgp attribute and aspath. */
 void bgp_attr_unintern(struct attr **pattr)
 {
 	struct attr *attr = *pattr;
-	struct attr *ret;
 	struct attr tmp;
 
-	/* Decrement attribute reference. */
-	attr->refcnt--;
-
+	/* attr may be gone right after its reference is dropped */
 	tmp = *attr;
 
 	/* If reference becomes zero then free attribute object. */
-	if (attr->refcnt == 0) {
-		ret = hash_release(attrhash, attr);
-		assert(ret != NULL);
+	if (bgp_intern_release(&attrhash, attr, &attr->refcnt)) {
 		XFREE(MTYPE_ATTR, attr);
 		*pattr = NULL;
 	}
@@ -1211,6 +1401,10 @@ void bgp_attr_flush(struct attr *attr)
 		bgp_attr_set_vnc_subtlvs(attr, NULL);
 	}
 #endif
+	if (attr->evpn && !attr->evpn->refcnt) {
+		evpn_free(attr->evpn);
+		attr->evpn = NULL;
+	}
 }
 
 /* Implement draft-scudder-idr-optional-transitive behaviour and
@@ -1377,6 +1571,13 @@ static bool bgp_attr_flag_invalid(struct bgp_attr_parser_args *args)
 	if (attr_flags_values[attr_code] == 0)
 		return false;
 
+	/* Nearly always the flags are exactly the required ones; since those
+	 * never include PARTIAL and always include OPTIONAL or TRANS, none of
+	 * the checks below can fail then.
+	 */
+	if ((flags & ~mask) == attr_flags_values[attr_code])
+		return false;
+
 	/* RFC4271, "For well-known attributes, the Transitive bit MUST be set
 	 * to
 	 * 1."
@@ -1463,6 +1664,21 @@ static bgp_attr_parse_ret_t bgp_attr_origin(struct bgp_attr_parser_args *args)
 	return 0;
 }
 
+/* Whether obj, decoded and interned by the UPDATE parse pthreads from the
+   value starting at at, is the attribute being parsed; skips over the value
+   if so.  The caller takes over the reference. */
+static bool bgp_attr_preparsed(struct bgp_attr_parser_args *args,
+			       const uint8_t *at, const void *obj)
+{
+	struct peer *const peer = args->peer;
+
+	if (!obj || at != stream_pnt(peer->curr))
+		return false;
+
+	stream_forward_getp(peer->curr, args->length);
+	return true;
+}
+
 /* Parse AS path information.  This function is wrapper of
    aspath_parse. */
 static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
@@ -1470,13 +1686,19 @@ static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
 	struct attr *const attr = args->attr;
 	struct peer *const peer = args->peer;
 	const bgp_size_t length = args->length;
+	struct bgp_preparse *pre = peer->curr_pre;
+	bool as4 = !!CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV);
 
 	/*
 	 * peer with AS4 => will get 4Byte ASnums
 	 * otherwise, will get 16 Bit
 	 */
-	attr->aspath = aspath_parse(peer->curr, length,
-				    CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV));
+	if (pre && pre->as4 == as4
+	    && bgp_attr_preparsed(args, pre->aspath_at, pre->aspath)) {
+		attr->aspath = pre->aspath;
+		pre->aspath = NULL;
+	} else
+		attr->aspath = aspath_parse(peer->curr, length, as4);
 
 	/* In case of IBGP, length will be zero. */
 	if (!attr->aspath) {
@@ -1556,8 +1778,13 @@ static int bgp_attr_as4_path(struct bgp_attr_parser_args *args,
 	struct peer *const peer = args->peer;
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
+	struct bgp_preparse *pre = peer->curr_pre;
 
-	*as4_path = aspath_parse(peer->curr, length, 1);
+	if (pre && bgp_attr_preparsed(args, pre->as4_path_at, pre->as4_path)) {
+		*as4_path = pre->as4_path;
+		pre->as4_path = NULL;
+	} else
+		*as4_path = aspath_parse(peer->curr, length, 1);
 
 	/* In case of IBGP, length will be zero. */
 	if (!*as4_path) {
@@ -1701,6 +1928,80 @@ stream_failure:
 				  args->total);
 }
 
+/*
+ * Fast path for the fixed size attributes found in nearly every UPDATE.
+ * The value is decoded straight from the packet; the decoder returns
+ * false if it does not like it, and the attribute then goes through the
+ * regular parser, which does the error handling.
+ */
+static bool bgp_attr_origin_fast(struct peer *peer, struct attr *attr,
+				 const uint8_t *val)
+{
+	if (val[0] > BGP_ORIGIN_INCOMPLETE)
+		return false;
+
+	attr->origin = val[0];
+	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_ORIGIN);
+	return true;
+}
+
+static bool bgp_attr_nexthop_fast(struct peer *peer, struct attr *attr,
+				  const uint8_t *val)
+{
+	memcpy(&attr->nexthop.s_addr, val, 4);
+	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP);
+	return true;
+}
+
+static bool bgp_attr_med_fast(struct peer *peer, struct attr *attr,
+			      const uint8_t *val)
+{
+	ptr_get_be32(val, &attr->med);
+	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_MULTI_EXIT_DISC);
+	return true;
+}
+
+static bool bgp_attr_local_pref_fast(struct peer *peer, struct attr *attr,
+				     const uint8_t *val)
+{
+	/* ignored from external peers, see bgp_attr_local_pref() */
+	if (peer->sort == BGP_PEER_EBGP)
+		return true;
+
+	ptr_get_be32(val, &attr->local_pref);
+	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF);
+	return true;
+}
+
+static const struct bgp_attr_fast {
+	bgp_size_t length;
+	bool (*decode)(struct peer *peer, struct attr *attr,
+		       const uint8_t *val);
+} attr_fast[] = {
+	[BGP_ATTR_ORIGIN] = {1, bgp_attr_origin_fast},
+	[BGP_ATTR_NEXT_HOP] = {4, bgp_attr_nexthop_fast},
+	[BGP_ATTR_MULTI_EXIT_DISC] = {4, bgp_attr_med_fast},
+	[BGP_ATTR_LOCAL_PREF] = {4, bgp_attr_local_pref_fast},
+};
+
+/* Flags, length and value all as expected, and decoded */
+static inline bool bgp_attr_fast_decode(struct peer *peer, struct attr *attr,
+					uint8_t type, uint8_t flag,
+					bgp_size_t length)
+{
+	const struct bgp_attr_fast *fast;
+
+	if (type >= array_size(attr_fast))
+		return false;
+
+	fast = &attr_fast[type];
+	if (!fast->decode || length != fast->length
+	    || (flag & ~BGP_ATTR_FLAG_EXTLEN) != attr_flags_values[type])
+		return false;
+
+	return fast->decode(peer, attr, BGP_INPUT_PNT(peer));
+}
+
 /* Atomic aggregate. */
 static int bgp_attr_atomic(struct bgp_attr_parser_args *args)
 {
@@ -1908,6 +2209,7 @@ bgp_attr_community(struct bgp_attr_parser_args *args)
 	struct peer *const peer = args->peer;
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
+	struct bgp_preparse *pre = peer->curr_pre;
 
 	if (length == 0) {
 		attr->community = NULL;
@@ -1915,11 +2217,17 @@ bgp_attr_community(struct bgp_attr_parser_args *args)
 					  args->total);
 	}
 
-	attr->community =
-		community_parse((uint32_t *)stream_pnt(peer->curr), length);
+	if (pre
+	    && bgp_attr_preparsed(args, pre->community_at, pre->community)) {
+		attr->community = pre->community;
+		pre->community = NULL;
+	} else {
+		attr->community = community_parse(
+			(uint32_t *)stream_pnt(peer->curr), length);
 
-	/* XXX: fix community_parse to use stream API and remove this */
-	stream_forward_getp(peer->curr, length);
+		/* XXX: fix community_parse to use stream API and remove this */
+		stream_forward_getp(peer->curr, length);
+	}
 
 	/* The Community attribute SHALL be considered malformed if its
 	 * length is not a non-zero multiple of 4.
@@ -2247,6 +2555,7 @@ bgp_attr_large_community(struct bgp_attr_parser_args *args)
 	struct peer *const peer = args->peer;
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
+	struct bgp_preparse *pre = peer->curr_pre;
 
 	/*
 	 * Large community follows new attribute format.
@@ -2258,9 +2567,16 @@ bgp_attr_large_community(struct bgp_attr_parser_args *args)
 					  args->total);
 	}
 
-	attr->lcommunity = lcommunity_parse(stream_pnt(peer->curr), length);
-	/* XXX: fix ecommunity_parse to use stream API */
-	stream_forward_getp(peer->curr, length);
+	if (pre
+	    && bgp_attr_preparsed(args, pre->lcommunity_at, pre->lcommunity)) {
+		attr->lcommunity = pre->lcommunity;
+		pre->lcommunity = NULL;
+	} else {
+		attr->lcommunity =
+			lcommunity_parse(stream_pnt(peer->curr), length);
+		/* XXX: fix ecommunity_parse to use stream API */
+		stream_forward_getp(peer->curr, length);
+	}
 
 	if (!attr->lcommunity)
 		return bgp_attr_malformed(args, BGP_NOTIFY_UPDATE_OPT_ATTR_ERR,
@@ -2278,6 +2594,7 @@ bgp_attr_ext_communities(struct bgp_attr_parser_args *args)
 	struct peer *const peer = args->peer;
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
+	struct bgp_attr_evpn evpn;
 	uint8_t sticky = 0;
 	bool proxy = false;
 
@@ -2302,42 +2619,46 @@ bgp_attr_ext_communities(struct bgp_attr_parser_args *args)
 
 	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_EXT_COMMUNITIES);
 
+	evpn = *bgp_attr_get_evpn(attr);
+
 	/* Extract DF election preference and  mobility sequence number */
-	attr->df_pref = bgp_attr_df_pref_from_ec(attr, &attr->df_alg);
+	evpn.df_pref = bgp_attr_df_pref_from_ec(attr, &evpn.df_alg);
 
 	/* Extract MAC mobility sequence number, if any. */
-	attr->mm_seqnum = bgp_attr_mac_mobility_seqnum(attr, &sticky);
-	attr->sticky = sticky;
+	evpn.mm_seqnum = bgp_attr_mac_mobility_seqnum(attr, &sticky);
+	evpn.sticky = sticky;
 
 	/* Check if this is a Gateway MAC-IP advertisement */
-	attr->default_gw = bgp_attr_default_gw(attr);
+	evpn.default_gw = bgp_attr_default_gw(attr);
 
 	/* Handle scenario where router flag ecommunity is not
 	 * set but default gw ext community is present.
 	 * Use default gateway, set and propogate R-bit.
 	 */
-	if (attr->default_gw)
-		attr->router_flag = 1;
+	if (evpn.default_gw)
+		evpn.router_flag = 1;
 
 	/* Check EVPN Neighbor advertisement flags, R-bit */
-	bgp_attr_evpn_na_flag(attr, &attr->router_flag, &proxy);
+	bgp_attr_evpn_na_flag(attr, &evpn.router_flag, &proxy);
 	if (proxy)
-		attr->es_flags |= ATTR_ES_PROXY_ADVERT;
+		evpn.es_flags |= ATTR_ES_PROXY_ADVERT;
 
 	/* Extract the Rmac, if any */
-	if (bgp_attr_rmac(attr, &attr->rmac)) {
+	if (bgp_attr_rmac(attr, &evpn.rmac)) {
 		if (bgp_debug_update(peer, NULL, NULL, 1) &&
-		    bgp_mac_exist(&attr->rmac)) {
+		    bgp_mac_exist(&evpn.rmac)) {
 			char buf1[ETHER_ADDR_STRLEN];
 
 			zlog_debug("%s: router mac %s is self mac",
 				   __func__,
-				   prefix_mac2str(&attr->rmac, buf1,
+				   prefix_mac2str(&evpn.rmac, buf1,
 						  sizeof(buf1)));
 		}
 
 	}
 
+	bgp_attr_evpn_set(attr, &evpn);
+
 	/* Get the tunnel type from encap extended community */
 	bgp_attr_extcom_tunnel_type(attr,
 		(bgp_encap_types *)&attr->encap_tunneltype);
@@ -3005,13 +3326,15 @@ bgp_attr_parse_ret_t bgp_attr_parse(struct peer *peer, struct attr *attr,
 			goto done;
 		}
 
-		/* Fetch attribute flag and type. */
+		/* Fetch attribute flag and type, the length check above
+		 * covers them.
+		 */
 		startp = BGP_INPUT_PNT(peer);
 		/* "The lower-order four bits of the Attribute Flags octet are
 		   unused.  They MUST be zero when sent and MUST be ignored when
 		   received." */
-		flag = 0xF0 & stream_getc(BGP_INPUT(peer));
-		type = stream_getc(BGP_INPUT(peer));
+		flag = 0xF0 & startp[0];
+		type = startp[1];
 
 		/* Check whether Extended-Length applies and is in bounds */
 		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN)
@@ -3030,10 +3353,13 @@ bgp_attr_parse_ret_t bgp_attr_parse(struct peer *peer, struct attr *attr,
 		}
 
 		/* Check extended attribue length bit. */
-		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN))
-			length = stream_getw(BGP_INPUT(peer));
-		else
-			length = stream_getc(BGP_INPUT(peer));
+		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN)) {
+			length = (startp[2] << 8) | startp[3];
+			stream_forward_getp(BGP_INPUT(peer), 4);
+		} else {
+			length = startp[2];
+			stream_forward_getp(BGP_INPUT(peer), 3);
+		}
 
 		/* If any attribute appears more than once in the UPDATE
 		   message, then the Error Subcode is set to Malformed Attribute
@@ -3109,6 +3435,11 @@ bgp_attr_parse_ret_t bgp_attr_parse(struct peer *peer, struct attr *attr,
 			goto done;
 		}
 
+		if (bgp_attr_fast_decode(peer, attr, type, flag, length)) {
+			stream_forward_getp(BGP_INPUT(peer), length);
+			continue;
+		}
+
 		struct bgp_attr_parser_args attr_args = {
 			.peer = peer,
 			.length = length,
@@ -4254,6 +4585,7 @@ void bgp_attr_init(void)
 	transit_init();
 	encap_init();
 	srv6_init();
+	evpn_init();
 }
 
 void bgp_attr_finish(void)
@@ -4267,6 +4599,7 @@ void bgp_attr_finish(void)
 	transit_finish();
 	encap_finish();
 	srv6_finish();
+	evpn_finish();
 }
 
 /* Make attribute packet. */
@@ -21,6 +21,7 @@
 #ifndef _QUAGGA_BGP_ATTR_H
 #define _QUAGGA_BGP_ATTR_H
 
+#include "frratomic.h"
 #include "mpls.h"
 #include "bgp_attr_evpn.h"
 #include "bgpd/bgp_encap_types.h"
@@ -82,7 +83,7 @@
 struct bgp_attr_encap_subtlv {
 	struct bgp_attr_encap_subtlv *next; /* for chaining */
 	/* Reference count of this attribute. */
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 	uint16_t type;
 	uint16_t length;
 	uint8_t value[0]; /* will be extended */
@@ -121,7 +122,7 @@ enum pta_type {
  * draft-dawra-idr-srv6-vpn-04
  */
 struct bgp_attr_srv6_vpn {
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 	uint8_t sid_flags;
 	struct in6_addr sid;
 };
@@ -132,83 +133,45 @@ struct bgp_attr_srv6_vpn {
  * draft-dawra-idr-srv6-vpn-05
  */
 struct bgp_attr_srv6_l3vpn {
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 	uint8_t sid_flags;
 	uint16_t endpoint_behavior;
 	struct in6_addr sid;
 };
 
-/* BGP core attribute structure. */
-struct attr {
-	/* AS Path structure */
-	struct aspath *aspath;
-
-	/* Community structure */
-	struct community *community;
-
+/*
+ * EVPN parts of an attribute.  Most paths don't have any, so these live out
+ * of line and are interned like the other parts: a struct attr either has
+ * none (NULL) or points to one that is shared with every other attribute
+ * that has the same values.  Read them with bgp_attr_get_evpn(), change
+ * them with bgp_attr_evpn_modify().
+ */
+struct bgp_attr_evpn {
 	/* Reference count of this attribute. */
-	unsigned long refcnt;
-
-	/* Flag of attribute is set or not. */
-	uint64_t flag;
-
-	/* Apart from in6_addr, the remaining static attributes */
-	struct in_addr nexthop;
-	uint32_t med;
-	uint32_t local_pref;
-	ifindex_t nh_ifindex;
+	atomic_size_t refcnt;
 
-	/* Path origin attribute */
-	uint8_t origin;
-
-	/* PMSI tunnel type (RFC 6514). */
-	enum pta_type pmsi_tnl_type;
-
-	/* has the route-map changed any attribute?
-	   Used on the peer outbound side. */
-	uint32_t rmap_change_flags;
-
-	/* Multi-Protocol Nexthop, AFI IPv6 */
-	struct in6_addr mp_nexthop_global;
-	struct in6_addr mp_nexthop_local;
-
-	/* ifIndex corresponding to mp_nexthop_local. */
-	ifindex_t nh_lla_ifindex;
-
-	/* Extended Communities attribute. */
-	struct ecommunity *ecommunity;
-
-	/* Extended Communities attribute. */
-	struct ecommunity *ipv6_ecommunity;
-
-	/* Large Communities attribute. */
-	struct lcommunity *lcommunity;
-
-	/* Route-Reflector Cluster attribute */
-	struct cluster_list *cluster1;
-
-	/* Unknown transitive attribute. */
-	struct transit *transit;
-
-	struct in_addr mp_nexthop_global_in;
+	/* EVPN overlay index */
+	struct bgp_route_evpn overlay;
 
-	/* Aggregator Router ID attribute */
-	struct in_addr aggregator_addr;
-
-	/* Route Reflector Originator attribute */
-	struct in_addr originator_id;
-
-	/* Local weight, not actually an attribute */
-	uint32_t weight;
+	/* EVPN ES */
+	esi_t esi;
 
-	/* Aggregator ASN */
-	as_t aggregator_as;
+	/* EVPN local router-mac */
+	struct ethaddr rmac;
 
-	/* MP Nexthop length */
-	uint8_t mp_nexthop_len;
+	/* EVPN MAC Mobility sequence number, if any. */
+	uint32_t mm_seqnum;
+	/* highest MM sequence number rxed in a MAC-IP route from an
+	 * ES peer (this includes both proxy and non-proxy MAC-IP
+	 * advertisements from ES peers).
+	 * This is only applicable to local paths in the VNI routing
+	 * table and derived from other imported/non-best paths.
+	 */
+	uint32_t mm_sync_seqnum;
 
-	/* MP Nexthop preference */
-	uint8_t mp_nexthop_prefer_global;
+	/* EVPN DF preference and algorithm for DF election on local ESs */
+	uint16_t df_pref;
+	uint8_t df_alg;
 
 	/* Static MAC for EVPN */
 	uint8_t sticky;
@@ -242,15 +205,46 @@ struct attr {
 	 * ATTR_ES_PEER_ACTIVE is set
 	 */
 #define ATTR_ES_PEER_ROUTER (1 << 4)
+};
 
-	/* route tag */
-	route_tag_t tag;
+/*
+ * BGP core attribute structure.
+ *
+ * There is one of these for every distinct set of attributes, so fields are
+ * ordered by size to keep padding out; please keep it that way.
+ */
+struct attr {
+	/* AS Path structure */
+	struct aspath *aspath;
 
-	/* Label index */
-	uint32_t label_index;
+	/* Community structure */
+	struct community *community;
 
-	/* MPLS label */
-	mpls_label_t label;
+	/* Reference count of this attribute. */
+	atomic_size_t refcnt;
+
+	/* Never reused, set when interned; copies carry it along, so it only
+	 * identifies an unmodified copy of an interned attribute.
+	 */
+	uint64_t intern_id;
+
+	/* Flag of attribute is set or not. */
+	uint64_t flag;
+
+	/* Extended Communities attribute. */
+	struct ecommunity *ecommunity;
+
+	/* Extended Communities attribute. */
+	struct ecommunity *ipv6_ecommunity;
+
+	/* Large Communities attribute. */
+	struct lcommunity *lcommunity;
+
+	/* Route-Reflector Cluster attribute */
+	struct cluster_list *cluster1;
+
+	/* Unknown transitive attribute. */
+	struct transit *transit;
 
 	/* SRv6 VPN SID */
 	struct bgp_attr_srv6_vpn *srv6_vpn;
@@ -258,30 +252,56 @@ struct attr {
 	/* SRv6 L3VPN SID */
 	struct bgp_attr_srv6_l3vpn *srv6_l3vpn;
 
-	uint16_t encap_tunneltype;		     /* grr */
 	struct bgp_attr_encap_subtlv *encap_subtlvs; /* rfc5512 */
 
 #ifdef ENABLE_BGP_VNC
 	struct bgp_attr_encap_subtlv *vnc_subtlvs; /* VNC-specific */
 #endif
-	/* EVPN */
-	struct bgp_route_evpn evpn_overlay;
+	/* EVPN, NULL if none of it is set */
+	struct bgp_attr_evpn *evpn;
 
-	/* EVPN MAC Mobility sequence number, if any. */
-	uint32_t mm_seqnum;
-	/* highest MM sequence number rxed in a MAC-IP route from an
-	 * ES peer (this includes both proxy and non-proxy MAC-IP
-	 * advertisements from ES peers).
-	 * This is only applicable to local paths in the VNI routing
-	 * table and derived from other imported/non-best paths.
-	 */
-	uint32_t mm_sync_seqnum;
+	/* Multi-Protocol Nexthop, AFI IPv6 */
+	struct in6_addr mp_nexthop_global;
+	struct in6_addr mp_nexthop_local;
 
-	/* EVPN local router-mac */
-	struct ethaddr rmac;
+	/* Apart from in6_addr, the remaining static attributes */
+	struct in_addr nexthop;
+	uint32_t med;
+	uint32_t local_pref;
+	ifindex_t nh_ifindex;
 
-	/* Distance as applied by Route map */
-	uint8_t distance;
+	/* PMSI tunnel type (RFC 6514). */
+	enum pta_type pmsi_tnl_type;
+
+	/* has the route-map changed any attribute?
+	   Used on the peer outbound side. */
+	uint32_t rmap_change_flags;
+
+	/* ifIndex corresponding to mp_nexthop_local. */
+	ifindex_t nh_lla_ifindex;
+
+	struct in_addr mp_nexthop_global_in;
+
+	/* Aggregator Router ID attribute */
+	struct in_addr aggregator_addr;
+
+	/* Route Reflector Originator attribute */
+	struct in_addr originator_id;
+
+	/* Local weight, not actually an attribute */
+	uint32_t weight;
+
+	/* Aggregator ASN */
+	as_t aggregator_as;
+
+	/* route tag */
+	route_tag_t tag;
+
+	/* Label index */
+	uint32_t label_index;
+
+	/* MPLS label */
+	mpls_label_t label;
 
 	/* rmap set table */
 	uint32_t rmap_table_id;
@@ -289,15 +309,22 @@ struct attr {
 	/* Link bandwidth value, if any. */
 	uint32_t link_bw;
 
-	/* EVPN ES */
-	esi_t esi;
-
 	/* SR-TE Color */
 	uint32_t srte_color;
 
-	/* EVPN DF preference and algorithm for DF election on local ESs */
-	uint16_t df_pref;
-	uint8_t df_alg;
+	uint16_t encap_tunneltype;		     /* grr */
+
+	/* Path origin attribute */
+	uint8_t origin;
+
+	/* MP Nexthop length */
+	uint8_t mp_nexthop_len;
+
+	/* MP Nexthop preference */
+	uint8_t mp_nexthop_prefer_global;
+
+	/* Distance as applied by Route map */
+	uint8_t distance;
 };
 
 /* rmap_change_flags definition */
@@ -312,14 +339,14 @@ struct attr {
 
 /* Router Reflector related structure. */
 struct cluster_list {
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 	int length;
 	struct in_addr *list;
 };
 
 /* Unknown transit attribute. */
 struct transit {
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 	int length;
 	uint8_t *val;
 };
@@ -355,6 +382,7 @@ extern bgp_attr_parse_ret_t bgp_attr_parse(struct peer *, struct attr *,
 					   struct bgp_nlri *);
 extern void bgp_attr_undup(struct attr *new, struct attr *old);
 extern struct attr *bgp_attr_intern(struct attr *attr);
+extern struct attr *bgp_attr_ref(struct attr *attr);
 extern void bgp_attr_unintern_sub(struct attr *);
 extern void bgp_attr_unintern(struct attr **);
 extern void bgp_attr_flush(struct attr *);
@@ -377,9 +405,11 @@ extern unsigned int attrhash_key_make(const void *);
 extern void attr_show_all(struct vty *);
 extern unsigned long int attr_count(void);
 extern unsigned long int attr_unknown_count(void);
+extern unsigned long int attr_evpn_count(void);
 
 /* Cluster list prototypes. */
 extern bool cluster_loop_check(struct cluster_list *, struct in_addr);
+extern struct cluster_list *cluster_parse(struct in_addr *pnt, int length);
 
 /* Below exported for unit-test purposes only */
 struct bgp_attr_parser_args {
@@ -453,9 +483,32 @@ static inline int bgp_rmap_nhop_changed(uint32_t out_rmap_flags,
 			: 0);
 }
 
+/* Stands in for the EVPN parts of attributes that don't have any. */
+extern const struct bgp_attr_evpn bgp_attr_evpn_none;
+
+static inline const struct bgp_attr_evpn *
+bgp_attr_get_evpn(const struct attr *attr)
+{
+	return attr->evpn ? attr->evpn : &bgp_attr_evpn_none;
+}
+
+/*
+ * EVPN parts of attr that can be changed; they are copied first if they are
+ * shared.  attr itself must not be interned.
+ */
+extern struct bgp_attr_evpn *bgp_attr_evpn_modify(struct attr *attr);
+
+/*
+ * Same for attributes that hold references to what they point to, like one
+ * that is being parsed: the EVPN parts are replaced by interned ones right
+ * away.  Nothing is allocated if they don't change.
+ */
+extern void bgp_attr_evpn_set(struct attr *attr,
+			      const struct bgp_attr_evpn *evpn);
+
 static inline uint32_t mac_mobility_seqnum(struct attr *attr)
 {
-	return (attr) ? attr->mm_seqnum : 0;
+	return (attr) ? bgp_attr_get_evpn(attr)->mm_seqnum : 0;
 }
 
 static inline enum pta_type bgp_attr_get_pmsi_tnl_type(struct attr *attr)
@@ -506,13 +559,18 @@ static inline void bgp_attr_set_cluster(struct attr *attr,
 static inline const struct bgp_route_evpn *
 bgp_attr_get_evpn_overlay(const struct attr *attr)
 {
-	return &attr->evpn_overlay;
+	return &bgp_attr_get_evpn(attr)->overlay;
 }
 
 static inline void bgp_attr_set_evpn_overlay(struct attr *attr,
 					     struct bgp_route_evpn *eo)
 {
-	memcpy(&attr->evpn_overlay, eo, sizeof(struct bgp_route_evpn));
+	if (!memcmp(bgp_attr_get_evpn_overlay(attr), eo,
+		    sizeof(struct bgp_route_evpn)))
+		return;
+
+	memcpy(&bgp_attr_evpn_modify(attr)->overlay, eo,
+	       sizeof(struct bgp_route_evpn));
 }
 
 static inline struct bgp_attr_encap_subtlv *
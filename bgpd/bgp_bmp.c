@@ -298,6 +298,49 @@ static void bmp_per_peer_hdr(struct stream *s, struct peer *peer,
 	}
 }
 
+/* RFC 9069 Loc-RIB instance peer */
+#define BMP_PEER_TYPE_LOC_RIB_INSTANCE 3
+
+#define BMP_PEER_FLAG_F (1 << 7)
+
+static void bmp_locrib_peer_hdr(struct stream *s, struct bgp *bgp,
+				uint8_t flags, const struct timeval *tv)
+{
+	/* Peer Type */
+	stream_putc(s, BMP_PEER_TYPE_LOC_RIB_INSTANCE);
+
+	/* Peer Flags */
+	stream_putc(s, flags);
+
+	/* Peer Distinguisher, locally unique value for non-default VRFs */
+	stream_putl(s, 0);
+	if (bgp->inst_type == BGP_INSTANCE_TYPE_VRF)
+		stream_putl(s, bgp->vrf_id);
+	else
+		stream_putl(s, 0);
+
+	/* Peer Address */
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+
+	/* Peer AS */
+	stream_putl(s, bgp->as);
+
+	/* Peer BGP ID */
+	stream_put_in_addr(s, &bgp->router_id);
+
+	/* Timestamp */
+	if (tv) {
+		stream_putl(s, tv->tv_sec);
+		stream_putl(s, tv->tv_usec);
+	} else {
+		stream_putl(s, 0);
+		stream_putl(s, 0);
+	}
+}
+
 static void bmp_put_info_tlv(struct stream *s, uint16_t type,
 		const char *string)
 {
@@ -311,7 +354,7 @@ static int bmp_send_initiation(struct bmp *bmp)
 {
 	int len;
 	struct stream *s;
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 	bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_INITIATION);
 
 #define BMP_INFO_TYPE_SYSDESCR	1
@@ -350,6 +393,12 @@ static void bmp_notify_put(struct stream *s, struct bgp_notify *nfy)
 			+ sizeof(marker));
 }
 
+static const uint8_t bmp_dummy_open[] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x13, 0x01,
+};
+
 static struct stream *bmp_peerstate(struct peer *peer, bool down)
 {
 	struct stream *s;
@@ -390,25 +439,19 @@ static struct stream *bmp_peerstate(struct peer *peer, bool down)
 		else if (peer->su_remote->sa.sa_family == AF_INET)
 			stream_putw(s, peer->su_remote->sin.sin_port);
 
-		static const uint8_t dummy_open[] = {
-			0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-			0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-			0x00, 0x13, 0x01,
-		};
-
 		bbpeer = bmp_bgp_peer_find(peer->qobj_node.nid);
 
 		if (bbpeer && bbpeer->open_tx)
 			stream_put(s, bbpeer->open_tx, bbpeer->open_tx_len);
 		else {
-			stream_put(s, dummy_open, sizeof(dummy_open));
+			stream_put(s, bmp_dummy_open, sizeof(bmp_dummy_open));
 			zlog_warn("bmp: missing TX OPEN message for peer %s",
 				  peer->host);
 		}
 		if (bbpeer && bbpeer->open_rx)
 			stream_put(s, bbpeer->open_rx, bbpeer->open_rx_len);
 		else {
-			stream_put(s, dummy_open, sizeof(dummy_open));
+			stream_put(s, bmp_dummy_open, sizeof(bmp_dummy_open));
 			zlog_warn("bmp: missing RX OPEN message for peer %s",
 				  peer->host);
 		}
@@ -449,6 +492,50 @@ static struct stream *bmp_peerstate(struct peer *peer, bool down)
 }
 
 
+static bool bmp_targets_locrib(struct bmp_targets *bt)
+{
+	afi_t afi;
+	safi_t safi;
+
+	FOREACH_AFI_SAFI (afi, safi)
+		if (bt->afimon[afi][safi] & BMP_MON_LOC_RIB)
+			return true;
+	return false;
+}
+
+#define BMP_INFO_TYPE_VRFNAME	3
+
+static struct stream *bmp_locrib_peerup(struct bgp *bgp)
+{
+	struct stream *s;
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+
+	s = stream_new(BGP_MAX_PACKET_SIZE);
+
+	bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_PEER_UP_NOTIFICATION);
+	bmp_locrib_peer_hdr(s, bgp, 0, &now);
+
+	/* Local Address (16 bytes), Local Port, Remote Port */
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putw(s, 0);
+	stream_putw(s, 0);
+
+	/* there is no session, both OPENs are fabricated */
+	stream_put(s, bmp_dummy_open, sizeof(bmp_dummy_open));
+	stream_put(s, bmp_dummy_open, sizeof(bmp_dummy_open));
+
+	bmp_put_info_tlv(s, BMP_INFO_TYPE_VRFNAME,
+			 bgp->name ? bgp->name : VRF_DEFAULT_NAME);
+
+	stream_putl_at(s, BMP_LENGTH_POS, stream_get_endp(s));
+	return s;
+}
+
 static int bmp_send_peerup(struct bmp *bmp)
 {
 	struct peer *peer;
@@ -462,6 +549,12 @@ static int bmp_send_peerup(struct bmp *bmp)
 		stream_free(s);
 	}
 
+	if (bmp_targets_locrib(bmp->targets)) {
+		s = bmp_locrib_peerup(bmp->targets->bgp);
+		pullwr_write_stream(bmp->pullwr, s);
+		stream_free(s);
+	}
+
 	return 0;
 }
 
@@ -487,6 +580,12 @@ static void bmp_send_all(struct bmp_bgp *bmpbgp, struct stream *s)
 #define BMP_MIRROR_INFO_CODE_ERRORPDU   0
 #define BMP_MIRROR_INFO_CODE_LOSTMSGS   1
 
+static void bmp_mirrorq_free(struct bmp_mirrorq *bmq)
+{
+	stream_free(bmq->s);
+	XFREE(MTYPE_BMP_MIRRORQ, bmq);
+}
+
 static struct bmp_mirrorq *bmp_pull_mirror(struct bmp *bmp)
 {
 	struct bmp_mirrorq *bmq;
@@ -523,8 +622,7 @@ static void bmp_mirror_cull(struct bmp_bgp *bmpbgp)
 
 				while ((inner = bmp_pull_mirror(bmp))) {
 					if (!inner->refcount)
-						XFREE(MTYPE_BMP_MIRRORQ,
-								inner);
+						bmp_mirrorq_free(inner);
 				}
 
 				zlog_warn("bmp[%s] lost mirror messages due to buffer size limit",
@@ -560,11 +658,11 @@ static int bmp_mirror_packet(struct peer *peer, uint8_t type, bgp_size_t size,
 	if (!bmpbgp)
 		return 0;
 
-	qitem = XCALLOC(MTYPE_BMP_MIRRORQ, sizeof(*qitem) + size);
+	qitem = XCALLOC(MTYPE_BMP_MIRRORQ, sizeof(*qitem));
 	qitem->peerid = peer->qobj_node.nid;
 	qitem->tv = tv;
 	qitem->len = size;
-	memcpy(qitem->data, packet->data, size);
+	qitem->s = stream_slice(packet, 0, size);
 
 	frr_each(bmp_targets, &bmpbgp->targets, bt) {
 		if (!bt->mirror)
@@ -577,7 +675,7 @@ static int bmp_mirror_packet(struct peer *peer, uint8_t type, bgp_size_t size,
 		}
 	}
 	if (qitem->refcount == 0)
-		XFREE(MTYPE_BMP_MIRRORQ, qitem);
+		bmp_mirrorq_free(qitem);
 	else {
 		bmpbgp->mirror_qsize += sizeof(*qitem) + size;
 		bmp_mirrorq_add_tail(&bmpbgp->mirrorq, qitem);
@@ -597,7 +695,7 @@ static void bmp_wrmirror_lost(struct bmp *bmp, struct pullwr *pullwr)
 
 	gettimeofday(&tv, NULL);
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_ROUTE_MIRRORING);
 	bmp_per_peer_hdr(s, bmp->targets->bgp->peer_self, 0, &tv);
@@ -635,7 +733,7 @@ static bool bmp_wrmirror(struct bmp *bmp, struct pullwr *pullwr)
 	}
 
 	struct stream *s;
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_ROUTE_MIRRORING);
 	bmp_per_peer_hdr(s, peer, 0, &bmq->tv);
@@ -647,14 +745,14 @@ static bool bmp_wrmirror(struct bmp *bmp, struct pullwr *pullwr)
 
 	bmp->cnt_mirror++;
 	pullwr_write_stream(bmp->pullwr, s);
-	pullwr_write(bmp->pullwr, bmq->data, bmq->len);
+	pullwr_write(bmp->pullwr, STREAM_DATA(bmq->s), bmq->len);
 
 	stream_free(s);
 	written = true;
 
 out:
 	if (!bmq->refcount)
-		XFREE(MTYPE_BMP_MIRRORQ, bmq);
+		bmp_mirrorq_free(bmq);
 	return written;
 }
 
@@ -727,15 +825,13 @@ static int bmp_peer_backward(struct peer *peer)
 	return 0;
 }
 
-static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
+static struct stream *bmp_eor_update(afi_t afi, safi_t safi)
 {
-	struct peer *peer;
-	struct listnode *node;
-	struct stream *s, *s2;
+	struct stream *s;
 	iana_afi_t pkt_afi;
 	iana_safi_t pkt_safi;
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
 	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
@@ -760,12 +856,22 @@ static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
 	}
 
 	bgp_packet_set_size(s);
+	return s;
+}
+
+static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
+{
+	struct peer *peer;
+	struct listnode *node;
+	struct stream *s, *s2;
+
+	s = bmp_eor_update(afi, safi);
 
 	for (ALL_LIST_ELEMENTS_RO(bmp->targets->bgp->peer, node, peer)) {
 		if (!peer->afc_nego[afi][safi])
 			continue;
 
-		s2 = stream_new(BGP_MAX_PACKET_SIZE);
+		s2 = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 		bmp_common_hdr(s2, BMP_VERSION_3,
 				BMP_TYPE_ROUTE_MONITORING);
@@ -782,6 +888,26 @@ static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
 	stream_free(s);
 }
 
+static void bmp_eor_locrib(struct bmp *bmp, afi_t afi, safi_t safi)
+{
+	struct stream *s, *s2;
+
+	s = bmp_eor_update(afi, safi);
+
+	s2 = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
+	bmp_common_hdr(s2, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
+	bmp_locrib_peer_hdr(s2, bmp->targets->bgp, 0, NULL);
+
+	stream_putl_at(s2, BMP_LENGTH_POS,
+			stream_get_endp(s) + stream_get_endp(s2));
+
+	bmp->cnt_update++;
+	pullwr_write_stream(bmp->pullwr, s2);
+	pullwr_write_stream(bmp->pullwr, s);
+	stream_free(s2);
+	stream_free(s);
+}
+
 static struct stream *bmp_update(const struct prefix *p, struct prefix_rd *prd,
 				 struct peer *peer, struct attr *attr,
 				 afi_t afi, safi_t safi)
@@ -840,7 +966,7 @@ static struct stream *bmp_withdraw(const struct prefix *p,
 	bgp_size_t total_attr_len = 0;
 	bgp_size_t unfeasible_len;
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
 	stream_putw(s, 0);
@@ -872,12 +998,17 @@ static struct stream *bmp_withdraw(const struct prefix *p,
 	return s;
 }
 
-static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
-			const struct prefix *p, struct prefix_rd *prd,
-			struct attr *attr, afi_t afi, safi_t safi,
-			time_t uptime)
-{
-	struct stream *hdr, *msg;
+/* encode a complete Route Monitoring message (common header, per-peer
+ * header and BGP UPDATE) into a single exact-size stream
+ */
+static struct stream *bmp_monitor_encode(struct bgp *bgp, struct peer *peer,
+					 bool locrib, uint8_t flags,
+					 const struct prefix *p,
+					 struct prefix_rd *prd,
+					 struct attr *attr, afi_t afi,
+					 safi_t safi, time_t uptime)
+{
+	struct stream *hdr, *msg, *s;
 	struct timeval tv = { .tv_sec = uptime, .tv_usec = 0 };
 	struct timeval uptime_real;
 
@@ -887,18 +1018,51 @@ static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
 	else
 		msg = bmp_withdraw(p, prd, afi, safi);
 
-	hdr = stream_new(BGP_MAX_PACKET_SIZE);
+	hdr = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 	bmp_common_hdr(hdr, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
-	bmp_per_peer_hdr(hdr, peer, flags, &uptime_real);
+	if (locrib)
+		bmp_locrib_peer_hdr(hdr, bgp, flags, &uptime_real);
+	else
+		bmp_per_peer_hdr(hdr, peer, flags, &uptime_real);
 
 	stream_putl_at(hdr, BMP_LENGTH_POS,
 			stream_get_endp(hdr) + stream_get_endp(msg));
 
-	bmp->cnt_update++;
-	pullwr_write_stream(bmp->pullwr, hdr);
-	pullwr_write_stream(bmp->pullwr, msg);
+	s = stream_dupcat(hdr, msg, stream_get_endp(hdr));
 	stream_free(hdr);
 	stream_free(msg);
+	return s;
+}
+
+static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
+			const struct prefix *p, struct prefix_rd *prd,
+			struct attr *attr, afi_t afi, safi_t safi,
+			time_t uptime)
+{
+	struct stream *s;
+
+	s = bmp_monitor_encode(peer->bgp, peer, false, flags, p, prd, attr, afi,
+			       safi, uptime);
+
+	bmp->cnt_update++;
+	pullwr_write_stream(bmp->pullwr, s);
+	stream_free(s);
+}
+
+/* bpi is the selected path, NULL to withdraw */
+static void bmp_monitor_locrib(struct bmp *bmp, struct bgp_path_info *bpi,
+			       const struct prefix *p, struct prefix_rd *prd,
+			       afi_t afi, safi_t safi)
+{
+	struct stream *s;
+
+	s = bmp_monitor_encode(bmp->targets->bgp, bpi ? bpi->peer : NULL, true,
+			       0, p, prd, bpi ? bpi->attr : NULL, afi, safi,
+			       bpi ? bpi->uptime : monotime(NULL));
+
+	bmp->cnt_update++;
+	pullwr_write_stream(bmp->pullwr, s);
+	stream_free(s);
 }
 
 static bool bmp_wrsync(struct bmp *bmp, struct pullwr *pullwr)
@@ -916,6 +1080,7 @@ static bool bmp_wrsync(struct bmp *bmp, struct pullwr *pullwr)
 			bmp->syncafi = afi;
 			bmp->syncsafi = safi;
 			bmp->syncpeerid = 0;
+			bmp->synclocrib = false;
 			memset(&bmp->syncpos, 0, sizeof(bmp->syncpos));
 			bmp->syncpos.family = afi2family(afi);
 			bmp->syncrdpos = NULL;
@@ -981,6 +1146,7 @@ afibreak:
 					memset(&bmp->syncpos, 0,
 					       sizeof(bmp->syncpos));
 					bmp->syncpos.family = afi2family(afi);
+					bmp->synclocrib = false;
 					/* check whethere there is a valid
 					 * next mid-layer table, otherwise
 					 * declare table completed (eor)
@@ -1000,6 +1166,9 @@ afibreak:
 						safi2str(safi));
 				bmp_eor(bmp, afi, safi, BMP_PEER_FLAG_L);
 				bmp_eor(bmp, afi, safi, 0);
+				if (bmp->targets->afimon[afi][safi]
+				    & BMP_MON_LOC_RIB)
+					bmp_eor_locrib(bmp, afi, safi);
 
 				bmp->afistate[afi][safi] = BMP_AFI_LIVE;
 				bmp->syncafi = AFI_MAX;
@@ -1007,9 +1176,36 @@ afibreak:
 				return true;
 			}
 			bmp->syncpeerid = 0;
+			bmp->synclocrib = false;
 			prefix_copy(&bmp->syncpos, bgp_dest_get_prefix(bn));
 		}
 
+		/* Loc-RIB goes first for each prefix */
+		if ((bmp->targets->afimon[afi][safi] & BMP_MON_LOC_RIB)
+		    && !bmp->synclocrib) {
+			bmp->synclocrib = true;
+
+			for (bpiter = bgp_dest_get_bgp_path_info(bn); bpiter;
+			     bpiter = bpiter->next)
+				if (CHECK_FLAG(bpiter->flags,
+					       BGP_PATH_SELECTED))
+					break;
+
+			if (bpiter) {
+				struct prefix_rd *prd = NULL;
+
+				if (afi == AFI_L2VPN && safi == SAFI_EVPN)
+					prd = (struct prefix_rd *)
+						bgp_dest_get_prefix(
+							bmp->syncrdpos);
+
+				bmp_monitor_locrib(bmp, bpiter,
+						   bgp_dest_get_prefix(bn), prd,
+						   afi, safi);
+				return true;
+			}
+		}
+
 		if (bmp->targets->afimon[afi][safi] & BMP_MON_POSTPOLICY) {
 			for (bpiter = bgp_dest_get_bgp_path_info(bn); bpiter;
 			     bpiter = bpiter->next) {
@@ -1071,6 +1267,29 @@ afibreak:
 	return true;
 }
 
+static void bmp_qentry_flush(struct bmp_targets *bt,
+			     struct bmp_queue_entry *bqe)
+{
+	size_t i;
+
+	for (i = 0; i < array_size(bqe->msg); i++) {
+		if (!bqe->msg[i])
+			continue;
+		bt->queue_size -= sizeof(*bqe->msg[i])
+				  + stream_get_endp(bqe->msg[i]);
+		stream_free(bqe->msg[i]);
+		bqe->msg[i] = NULL;
+	}
+}
+
+static void bmp_qentry_free(struct bmp_targets *bt,
+			    struct bmp_queue_entry *bqe)
+{
+	bmp_qentry_flush(bt, bqe);
+	bt->queue_size -= sizeof(*bqe);
+	XFREE(MTYPE_BMP_QUEUE, bqe);
+}
+
 static struct bmp_queue_entry *bmp_pull(struct bmp *bmp)
 {
 	struct bmp_queue_entry *bqe;
@@ -1089,6 +1308,78 @@ static struct bmp_queue_entry *bmp_pull(struct bmp *bmp)
 	return bqe;
 }
 
+/* the queue is over its size limit.  Sessions holding on to the oldest
+ * entries lose their pending updates and go back to a full table sync for
+ * all monitored AFI/SAFIs; this is the only way to get their view back
+ * into a consistent state.
+ */
+static void bmp_queue_cull(struct bmp_targets *bt)
+{
+	while (bt->queue_size > bt->queue_sizelimit) {
+		struct bmp_queue_entry *bqe, *inner;
+		struct bmp *bmp;
+		bool culled = false;
+		afi_t afi;
+		safi_t safi;
+
+		bqe = bmp_qlist_first(&bt->updlist);
+		if (!bqe)
+			break;
+
+		frr_each (bmp_session, &bt->sessions, bmp) {
+			if (bmp->queuepos != bqe)
+				continue;
+
+			while ((inner = bmp_pull(bmp))) {
+				if (!inner->refcount)
+					bmp_qentry_free(bt, inner);
+			}
+
+			FOREACH_AFI_SAFI (afi, safi) {
+				if (!bt->afimon[afi][safi])
+					continue;
+				bmp->afistate[afi][safi] = BMP_AFI_NEEDSYNC;
+			}
+			bmp->syncafi = AFI_MAX;
+			bmp->syncsafi = SAFI_MAX;
+
+			zlog_warn("bmp[%s] lost route monitoring updates due to buffer size limit, resyncing",
+				  bmp->remote);
+			bmp->cnt_queue_overruns++;
+			pullwr_bump(bmp->pullwr);
+			culled = true;
+		}
+
+		if (!culled)
+			break;
+	}
+}
+
+/* encoded messages are cached on the queue entry so every session pulling
+ * it shares a single encoding;  the cache is dropped whenever the entry is
+ * requeued due to a new change.
+ */
+static void bmp_monitor_queued(struct bmp *bmp, struct bmp_queue_entry *bqe,
+			       size_t idx, struct peer *peer,
+			       struct prefix_rd *prd, struct attr *attr,
+			       time_t uptime)
+{
+	struct bmp_targets *bt = bmp->targets;
+
+	if (!bqe->msg[idx]) {
+		bqe->msg[idx] = bmp_monitor_encode(
+			bt->bgp, peer, bqe->locrib,
+			bqe->locrib ? 0 : BMP_PEER_FLAG_L, &bqe->p, prd, attr,
+			bqe->afi, bqe->safi, uptime);
+		bt->queue_size += sizeof(*bqe->msg[idx])
+				  + stream_get_endp(bqe->msg[idx]);
+		bt->queue_sizemax = MAX(bt->queue_sizemax, bt->queue_size);
+	}
+
+	bmp->cnt_update++;
+	pullwr_write_stream(bmp->pullwr, bqe->msg[idx]);
+}
+
 static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 {
 	struct bmp_queue_entry *bqe;
@@ -1120,6 +1411,30 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 		break;
 	}
 
+	if (bqe->locrib) {
+		struct bgp_path_info *bpi;
+		struct prefix_rd *prd = NULL;
+
+		if (afi == AFI_L2VPN && safi == SAFI_EVPN)
+			prd = &bqe->rd;
+
+		bn = bgp_node_lookup(bmp->targets->bgp->rib[afi][safi],
+				     &bqe->p);
+		for (bpi = bn ? bgp_dest_get_bgp_path_info(bn) : NULL; bpi;
+		     bpi = bpi->next)
+			if (CHECK_FLAG(bpi->flags, BGP_PATH_SELECTED))
+				break;
+
+		bmp_monitor_queued(bmp, bqe, BMP_QMSG_LOCRIB,
+				   bpi ? bpi->peer : NULL, prd,
+				   bpi ? bpi->attr : NULL,
+				   bpi ? bpi->uptime : monotime(NULL));
+		if (bn)
+			bgp_dest_unlock_node(bn);
+		written = true;
+		goto out;
+	}
+
 	peer = QOBJ_GET_TYPESAFE(bqe->peerid, peer);
 	if (!peer) {
 		zlog_info("bmp: skipping queued item for deleted peer");
@@ -1144,9 +1459,9 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 				break;
 		}
 
-		bmp_monitor(bmp, peer, BMP_PEER_FLAG_L, &bqe->p, prd,
-			    bpi ? bpi->attr : NULL, afi, safi,
-			    bpi ? bpi->uptime : monotime(NULL));
+		bmp_monitor_queued(bmp, bqe, BMP_QMSG_POSTPOLICY, peer, prd,
+				   bpi ? bpi->attr : NULL,
+				   bpi ? bpi->uptime : monotime(NULL));
 		written = true;
 	}
 
@@ -1158,15 +1473,15 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 			if (adjin->peer == peer)
 				break;
 		}
-		bmp_monitor(bmp, peer, BMP_PEER_FLAG_L, &bqe->p, prd,
-			    adjin ? adjin->attr : NULL, afi, safi,
-			    adjin ? adjin->uptime : monotime(NULL));
+		bmp_monitor_queued(bmp, bqe, BMP_QMSG_PREPOLICY, peer, prd,
+				   adjin ? adjin->attr : NULL,
+				   adjin ? adjin->uptime : monotime(NULL));
 		written = true;
 	}
 
 out:
 	if (!bqe->refcount)
-		XFREE(MTYPE_BMP_QUEUE, bqe);
+		bmp_qentry_free(bmp->targets, bqe);
 	return written;
 }
 
@@ -1202,7 +1517,8 @@ static void bmp_wrerr(struct bmp *bmp, struct pullwr *pullwr, bool eof)
 }
 
 static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
-			    safi_t safi, struct bgp_dest *bn, struct peer *peer)
+			    safi_t safi, struct bgp_dest *bn, struct peer *peer,
+			    bool locrib)
 {
 	struct bmp *bmp;
 	struct bmp_queue_entry *bqe, bqeref;
@@ -1214,9 +1530,10 @@ static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
 
 	memset(&bqeref, 0, sizeof(bqeref));
 	prefix_copy(&bqeref.p, bgp_dest_get_prefix(bn));
-	bqeref.peerid = peer->qobj_node.nid;
+	bqeref.peerid = locrib ? 0 : peer->qobj_node.nid;
 	bqeref.afi = afi;
 	bqeref.safi = safi;
+	bqeref.locrib = locrib;
 
 	if (afi == AFI_L2VPN && safi == SAFI_EVPN && bn->pdest)
 		prefix_copy(&bqeref.rd,
@@ -1224,6 +1541,9 @@ static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
 
 	bqe = bmp_qhash_find(&bt->updhash, &bqeref);
 	if (bqe) {
+		/* state changed, previously encoded messages are stale */
+		bmp_qentry_flush(bt, bqe);
+
 		if (bqe->refcount >= refcount)
 			/* nothing to do here */
 			return;
@@ -1234,6 +1554,8 @@ static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
 		memcpy(bqe, &bqeref, sizeof(*bqe));
 
 		bmp_qhash_add(&bt->updhash, bqe);
+		bt->queue_size += sizeof(*bqe);
+		bt->queue_sizemax = MAX(bt->queue_sizemax, bt->queue_size);
 	}
 
 	bqe->refcount = refcount;
@@ -1242,6 +1564,8 @@ static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
 	frr_each (bmp_session, &bt->sessions, bmp)
 		if (!bmp->queuepos)
 			bmp->queuepos = bqe;
+
+	bmp_queue_cull(bt);
 }
 
 static int bmp_process(struct bgp *bgp, afi_t afi, safi_t safi,
@@ -1255,10 +1579,36 @@ static int bmp_process(struct bgp *bgp, afi_t afi, safi_t safi,
 		return 0;
 
 	frr_each(bmp_targets, &bmpbgp->targets, bt) {
-		if (!bt->afimon[afi][safi])
+		if (!(bt->afimon[afi][safi]
+		      & (BMP_MON_PREPOLICY | BMP_MON_POSTPOLICY)))
 			continue;
 
-		bmp_process_one(bt, bgp, afi, safi, bn, peer);
+		bmp_process_one(bt, bgp, afi, safi, bn, peer, false);
+
+		frr_each(bmp_session, &bt->sessions, bmp) {
+			pullwr_bump(bmp->pullwr);
+		}
+	}
+	return 0;
+}
+
+static int bmp_route_update(struct bgp *bgp, afi_t afi, safi_t safi,
+			    struct bgp_dest *bn,
+			    struct bgp_path_info *old_route,
+			    struct bgp_path_info *new_route)
+{
+	struct bmp_bgp *bmpbgp = bmp_bgp_find(bgp);
+	struct bmp_targets *bt;
+	struct bmp *bmp;
+
+	if (!bmpbgp)
+		return 0;
+
+	frr_each(bmp_targets, &bmpbgp->targets, bt) {
+		if (!(bt->afimon[afi][safi] & BMP_MON_LOC_RIB))
+			continue;
+
+		bmp_process_one(bt, bgp, afi, safi, bn, NULL, true);
 
 		frr_each(bmp_session, &bt->sessions, bmp) {
 			pullwr_bump(bmp->pullwr);
@@ -1297,7 +1647,7 @@ static int bmp_stats(struct thread *thread)
 		if (peer->status != Established)
 			continue;
 
-		s = stream_new(BGP_MAX_PACKET_SIZE);
+		s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 		bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_STATISTICS_REPORT);
 		bmp_per_peer_hdr(s, peer, 0, &tv);
 
@@ -1469,10 +1819,10 @@ static void bmp_close(struct bmp *bmp)
 
 	while ((bmq = bmp_pull_mirror(bmp)))
 		if (!bmq->refcount)
-			XFREE(MTYPE_BMP_MIRRORQ, bmq);
+			bmp_mirrorq_free(bmq);
 	while ((bqe = bmp_pull(bmp)))
 		if (!bqe->refcount)
-			XFREE(MTYPE_BMP_QUEUE, bqe);
+			bmp_qentry_free(bmp->targets, bqe);
 
 	THREAD_OFF(bmp->t_read);
 	pullwr_del(bmp->pullwr);
@@ -1571,6 +1921,7 @@ static struct bmp_targets *bmp_targets_get(struct bgp *bgp, const char *name)
 	bmp_session_init(&bt->sessions);
 	bmp_qhash_init(&bt->updhash);
 	bmp_qlist_init(&bt->updlist);
+	bt->queue_sizelimit = ~0UL;
 	bmp_actives_init(&bt->actives);
 	bmp_listeners_init(&bt->listeners);
 
@@ -2066,17 +2417,19 @@ DEFPY(bmp_stats_cfg,
 
 DEFPY(bmp_monitor_cfg,
       bmp_monitor_cmd,
-      "[no] bmp monitor <ipv4|ipv6|l2vpn> <unicast|multicast|evpn> <pre-policy|post-policy>$policy",
+      "[no] bmp monitor <ipv4|ipv6|l2vpn> <unicast|multicast|evpn> <pre-policy|post-policy|loc-rib>$policy",
       NO_STR
       BMP_STR
       "Send BMP route monitoring messages\n"
       "Address Family\nAddress Family\nAddress Family\n"
       "Address Family\nAddress Family\nAddress Family\n"
       "Send state before policy and filter processing\n"
-      "Send state with policy and filters applied\n")
+      "Send state with policy and filters applied\n"
+      "Send state of the local RIB after best path selection\n")
 {
 	int index = 0;
 	uint8_t flag, prev;
+	bool had_locrib;
 	afi_t afi;
 	safi_t safi;
 
@@ -2086,11 +2439,14 @@ DEFPY(bmp_monitor_cfg,
 	argv_find_and_parse_afi(argv, argc, &index, &afi);
 	argv_find_and_parse_safi(argv, argc, &index, &safi);
 
-	if (policy[1] == 'r')
+	if (policy[0] == 'l')
+		flag = BMP_MON_LOC_RIB;
+	else if (policy[1] == 'r')
 		flag = BMP_MON_PREPOLICY;
 	else
 		flag = BMP_MON_POSTPOLICY;
 
+	had_locrib = bmp_targets_locrib(bt);
 	prev = bt->afimon[afi][safi];
 	if (no)
 		bt->afimon[afi][safi] &= ~flag;
@@ -2112,11 +2468,55 @@ DEFPY(bmp_monitor_cfg,
 		}
 
 		bmp->afistate[afi][safi] = BMP_AFI_NEEDSYNC;
+
+		/* sessions already past the initial peer up messages need
+		 * to learn about the Loc-RIB instance now
+		 */
+		if (!had_locrib && bmp_targets_locrib(bt)
+		    && bmp->state == BMP_Run) {
+			struct stream *s;
+
+			s = bmp_locrib_peerup(bt->bgp);
+			pullwr_write_stream(bmp->pullwr, s);
+			stream_free(s);
+		}
 	}
 
 	return CMD_SUCCESS;
 }
 
+DEFPY(bmp_monitor_limit_cfg,
+      bmp_monitor_limit_cmd,
+      "bmp monitor buffer-limit (0-4294967294)",
+      BMP_STR
+      "Send BMP route monitoring messages\n"
+      "Configure maximum memory used for queued route monitoring updates\n"
+      "Limit in bytes\n")
+{
+	VTY_DECLVAR_CONTEXT_SUB(bmp_targets, bt);
+
+	bt->queue_sizelimit = buffer_limit;
+	bmp_queue_cull(bt);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY(no_bmp_monitor_limit_cfg,
+      no_bmp_monitor_limit_cmd,
+      "no bmp monitor buffer-limit [(0-4294967294)]",
+      NO_STR
+      BMP_STR
+      "Send BMP route monitoring messages\n"
+      "Configure maximum memory used for queued route monitoring updates\n"
+      "Limit in bytes\n")
+{
+	VTY_DECLVAR_CONTEXT_SUB(bmp_targets, bt);
+
+	bt->queue_sizelimit = ~0UL;
+
+	return CMD_SUCCESS;
+}
+
 DEFPY(bmp_mirror_cfg,
       bmp_mirror_cmd,
       "[no] bmp mirror",
@@ -2139,7 +2539,7 @@ DEFPY(bmp_mirror_cfg,
 
 		while ((bmq = bmp_pull_mirror(bmp)))
 			if (!bmq->refcount)
-				XFREE(MTYPE_BMP_MIRRORQ, bmq);
+				bmp_mirrorq_free(bmq);
 	}
 	return CMD_SUCCESS;
 }
@@ -2213,6 +2613,14 @@ DEFPY(show_bmp,
 			vty_out(vty, "  Targets \"%s\":\n", bt->name);
 			vty_out(vty, "    Route Mirroring %sabled\n",
 				bt->mirror ? "en" : "dis");
+			vty_out(vty, "    Route Monitoring %9zu bytes (%zu messages) pending\n",
+				bt->queue_size,
+				bmp_qlist_count(&bt->updlist));
+			vty_out(vty, "                     %9zu bytes maximum buffer used\n",
+				bt->queue_sizemax);
+			if (bt->queue_sizelimit != ~0UL)
+				vty_out(vty, "                     %9zu bytes buffer size limit\n",
+					bt->queue_sizelimit);
 
 			afi_t afi;
 			safi_t safi;
@@ -2220,7 +2628,9 @@ DEFPY(show_bmp,
 			FOREACH_AFI_SAFI (afi, safi) {
 				const char *str = NULL;
 
-				switch (bt->afimon[afi][safi]) {
+				switch (bt->afimon[afi][safi]
+					& (BMP_MON_PREPOLICY
+					   | BMP_MON_POSTPOLICY)) {
 				case BMP_MON_PREPOLICY:
 					str = "pre-policy";
 					break;
@@ -2231,10 +2641,13 @@ DEFPY(show_bmp,
 					str = "pre-policy and post-policy";
 					break;
 				}
-				if (!str)
-					continue;
-				vty_out(vty, "    Route Monitoring %s %s %s\n",
-					afi2str(afi), safi2str(safi), str);
+				if (str)
+					vty_out(vty, "    Route Monitoring %s %s %s\n",
+						afi2str(afi), safi2str(safi),
+						str);
+				if (bt->afimon[afi][safi] & BMP_MON_LOC_RIB)
+					vty_out(vty, "    Route Monitoring %s %s loc-rib\n",
+						afi2str(afi), safi2str(safi));
 			}
 
 			vty_out(vty, "    Listeners:\n");
@@ -2291,7 +2704,7 @@ DEFPY(show_bmp,
 			vty_out(vty, "\n    %zu connected clients:\n",
 					bmp_session_count(&bt->sessions));
 			tt = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
-			ttable_add_row(tt, "remote|uptime|MonSent|MirrSent|MirrLost|ByteSent|ByteQ|ByteQKernel");
+			ttable_add_row(tt, "remote|uptime|MonSent|MonLost|MirrSent|MirrLost|ByteSent|ByteQ|ByteQKernel");
 			ttable_rowseps(tt, 0, BOTTOM, true, '-');
 
 			frr_each (bmp_session, &bt->sessions, bmp) {
@@ -2303,9 +2716,10 @@ DEFPY(show_bmp,
 				peer_uptime(bmp->t_up.tv_sec, uptime,
 					    sizeof(uptime), false, NULL);
 
-				ttable_add_row(tt, "%s|%s|%Lu|%Lu|%Lu|%Lu|%zu|%zu",
+				ttable_add_row(tt, "%s|%s|%Lu|%Lu|%Lu|%Lu|%Lu|%zu|%zu",
 					       bmp->remote, uptime,
 					       bmp->cnt_update,
+					       bmp->cnt_queue_overruns,
 					       bmp->cnt_mirror,
 					       bmp->cnt_mirror_overruns,
 					       total, q, kq);
@@ -2353,6 +2767,10 @@ static int bmp_config_write(struct bgp *bgp, struct vty *vty)
 		if (bt->mirror)
 			vty_out(vty, "  bmp mirror\n");
 
+		if (bt->queue_sizelimit != ~0UL)
+			vty_out(vty, "  bmp monitor buffer-limit %zu\n",
+				bt->queue_sizelimit);
+
 		FOREACH_AFI_SAFI (afi, safi) {
 			const char *afi_str = (afi == AFI_IP) ? "ipv4" : "ipv6";
 
@@ -2362,6 +2780,9 @@ static int bmp_config_write(struct bgp *bgp, struct vty *vty)
 			if (bt->afimon[afi][safi] & BMP_MON_POSTPOLICY)
 				vty_out(vty, "  bmp monitor %s %s post-policy\n",
 					afi_str, safi2str(safi));
+			if (bt->afimon[afi][safi] & BMP_MON_LOC_RIB)
+				vty_out(vty, "  bmp monitor %s %s loc-rib\n",
+					afi_str, safi2str(safi));
 		}
 		frr_each (bmp_listeners, &bt->listeners, bl)
 			vty_out(vty, " \n  bmp listener %s port %d\n",
@@ -2389,6 +2810,8 @@ static int bgp_bmp_init(struct thread_master *tm)
 	install_element(BMP_NODE, &bmp_acl_cmd);
 	install_element(BMP_NODE, &bmp_stats_cmd);
 	install_element(BMP_NODE, &bmp_monitor_cmd);
+	install_element(BMP_NODE, &bmp_monitor_limit_cmd);
+	install_element(BMP_NODE, &no_bmp_monitor_limit_cmd);
 	install_element(BMP_NODE, &bmp_mirror_cmd);
 
 	install_element(BGP_NODE, &bmp_mirror_limit_cmd);
@@ -2407,6 +2830,7 @@ static int bgp_bmp_module_init(void)
 	hook_register(peer_status_changed, bmp_peer_established);
 	hook_register(peer_backward_transition, bmp_peer_backward);
 	hook_register(bgp_process, bmp_process);
+	hook_register(bgp_route_update, bmp_route_update);
 	hook_register(bgp_inst_config_write, bmp_config_write);
 	hook_register(bgp_inst_delete, bmp_bgp_del);
 	hook_register(frr_late_init, bgp_bmp_init);
@@ -77,11 +77,21 @@ struct bmp_queue_entry {
 	uint64_t peerid;
 	afi_t afi;
 	safi_t safi;
+	/* Loc-RIB entry, peerid is 0 */
+	bool locrib;
 
 	size_t refcount;
 
 	/* initialized only for L2VPN/EVPN (S)AFIs */
 	struct prefix_rd rd;
+
+	/* encoded Route Monitoring messages, shared by all sessions pulling
+	 * this entry.  Dropped when the entry is requeued.
+	 */
+#define BMP_QMSG_PREPOLICY	0
+#define BMP_QMSG_POSTPOLICY	1
+#define BMP_QMSG_LOCRIB		0
+	struct stream *msg[2];
 };
 
 /* This is for BMP Route Mirroring, which feeds fully raw BGP PDUs out to BMP
@@ -102,7 +112,8 @@ struct bmp_mirrorq {
 	struct timeval tv;
 
 	size_t len;
-	uint8_t data[0];
+	/* shares the received packet's data */
+	struct stream *s;
 };
 
 enum {
@@ -150,6 +161,10 @@ struct bmp {
 	 * mirror queue
 	 */
 	uint64_t cnt_mirror_overruns;
+	/* number of times this peer wasn't fast enough in consuming the
+	 * route monitoring queue and had to resync
+	 */
+	uint64_t cnt_queue_overruns;
 	struct timeval t_up;
 
 	/* synchronization / startup works by repeatedly finding the next
@@ -158,6 +173,8 @@ struct bmp {
 	struct prefix syncpos;
 	struct bgp_dest *syncrdpos;
 	uint64_t syncpeerid;
+	/* Loc-RIB route for syncpos already sent */
+	bool synclocrib;
 	afi_t syncafi;
 	safi_t syncsafi;
 };
@@ -232,6 +249,7 @@ struct bmp_targets {
 	 */
 #define BMP_MON_PREPOLICY	(1 << 0)
 #define BMP_MON_POSTPOLICY	(1 << 1)
+#define BMP_MON_LOC_RIB		(1 << 2)
 	uint8_t afimon[AFI_MAX][SAFI_MAX];
 	bool mirror;
 
@@ -242,6 +260,9 @@ struct bmp_targets {
 
 	struct bmp_qhash_head updhash;
 	struct bmp_qlist_head updlist;
+	size_t queue_size, queue_sizemax;
+
+	size_t queue_sizelimit;
 
 	uint64_t cnt_accept, cnt_aclrefused;
 
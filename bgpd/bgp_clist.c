@@ -37,6 +37,114 @@
 #include "bgpd/bgp_regex.h"
 #include "bgpd/bgp_clist.h"
 
+/*
+ * Compiled form of a community-list, built on first use after the list
+ * changes.  Entries are numbered in list order.  Standard entries are
+ * indexed by community value, so a path costs one lookup per community
+ * instead of a walk over every entry, and the lowest numbered entry that
+ * applies still wins.  Runs of expanded entries with the same action are
+ * joined into one regular expression.
+ */
+struct community_list_val {
+	uint8_t val[LCOMMUNITY_SIZE];
+	uint8_t len;
+
+	/* First entry of exactly this one value. */
+	uint32_t pos_single;
+	/* First entry that has this value among others. */
+	uint32_t pos_any;
+};
+
+enum community_list_item_type {
+	CLIST_ITEM_ANY,
+	CLIST_ITEM_SET,
+	CLIST_ITEM_REGEX,
+};
+
+/* Entries that still have to be tried one by one, in list order. */
+struct community_list_item {
+	enum community_list_item_type type;
+	uint32_t pos;
+	struct community_entry *entry;
+
+	/* Covered by pos_single / pos_any of the value index. */
+	bool single;
+	bool indexed;
+
+	/* Joined expression if reg_owned, entry->reg otherwise. */
+	regex_t *reg;
+	bool reg_owned;
+};
+
+struct community_list_compiled {
+	int master;
+	unsigned int unit;
+	struct hash *vals;
+
+	struct community_entry **entries;
+	struct community_list_item *items;
+	unsigned int nitems;
+};
+
+/* Memo flags, a known and a result bit for each kind of match. */
+#define CLIST_MEMO_MATCH 0
+#define CLIST_MEMO_EXACT 2
+
+static uint32_t community_list_version;
+
+static unsigned int community_list_val_hash_key(const void *arg)
+{
+	const struct community_list_val *cv = arg;
+
+	return jhash(cv->val, cv->len, 0x436c6973);
+}
+
+static bool community_list_val_hash_cmp(const void *arg1, const void *arg2)
+{
+	const struct community_list_val *cv1 = arg1;
+	const struct community_list_val *cv2 = arg2;
+
+	return cv1->len == cv2->len && !memcmp(cv1->val, cv2->val, cv1->len);
+}
+
+static void *community_list_val_hash_alloc(void *arg)
+{
+	struct community_list_val *cv;
+
+	cv = XMALLOC(MTYPE_COMMUNITY_LIST_COMPILED, sizeof(*cv));
+	memcpy(cv, arg, sizeof(*cv));
+	cv->pos_single = cv->pos_any = UINT32_MAX;
+	return cv;
+}
+
+static void community_list_val_hash_free(void *arg)
+{
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, arg);
+}
+
+static void community_list_compiled_free(struct community_list_compiled *clc)
+{
+	for (unsigned int i = 0; i < clc->nitems; i++)
+		if (clc->items[i].reg_owned)
+			bgp_regex_free(clc->items[i].reg);
+
+	hash_clean(clc->vals, community_list_val_hash_free);
+	hash_free(clc->vals);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, clc->items);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, clc->entries);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, clc);
+}
+
+/* Drop compiled state and memoized results after the list changed. */
+static void community_list_changed(struct community_list *list)
+{
+	if (list->compiled) {
+		community_list_compiled_free(list->compiled);
+		list->compiled = NULL;
+	}
+	list->version = ++community_list_version;
+}
+
 /* Calculate new sequential number. */
 static int64_t bgp_clist_new_seq_get(struct community_list *list)
 {
@@ -157,6 +265,8 @@ static struct community_list *community_list_new(void)
 /* Free community-list.  */
 static void community_list_free(struct community_list *list)
 {
+	if (list->compiled)
+		community_list_compiled_free(list->compiled);
 	XFREE(MTYPE_COMMUNITY_LIST_NAME, list->name);
 	XFREE(MTYPE_COMMUNITY_LIST, list);
 }
@@ -181,6 +291,7 @@ community_list_insert(struct community_list_handler *ch, const char *name,
 	new = community_list_new();
 	new->name = XSTRDUP(MTYPE_COMMUNITY_LIST_NAME, name);
 	new->name_hash = bgp_clist_hash_key_community_list(new);
+	new->version = ++community_list_version;
 
 	/* Save for later */
 	hash_get(cm->hash, new, hash_alloc_intern);
@@ -332,6 +443,7 @@ static void community_list_entry_delete(struct community_list_master *cm,
 		list->head = entry->next;
 
 	community_entry_free(entry);
+	community_list_changed(list);
 
 	if (community_list_empty_p(list))
 		community_list_delete(cm, list);
@@ -373,6 +485,8 @@ static void community_list_entry_add(struct community_list *list,
 	struct community_entry *replace;
 	struct community_entry *point;
 
+	community_list_changed(list);
+
 	/* Automatic assignment of seq no. */
 	if (entry->seq == COMMUNITY_SEQ_NUMBER_AUTO)
 		entry->seq = bgp_clist_new_seq_get(list);
@@ -734,77 +848,451 @@ community_regexp_delete (struct community *com, regex_t * reg)
 }
 #endif
 
-/* When given community attribute matches to the community-list return
-   1 else return 0.  */
-bool community_list_match(struct community *com, struct community_list *list)
+static int community_list_style_master(uint8_t style)
 {
-	struct community_entry *entry;
+	switch (style) {
+	case EXTCOMMUNITY_LIST_STANDARD:
+	case EXTCOMMUNITY_LIST_EXPANDED:
+		return EXTCOMMUNITY_LIST_MASTER;
+	case LARGE_COMMUNITY_LIST_STANDARD:
+	case LARGE_COMMUNITY_LIST_EXPANDED:
+		return LARGE_COMMUNITY_LIST_MASTER;
+	default:
+		return COMMUNITY_LIST_MASTER;
+	}
+}
 
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
+static unsigned int community_list_master_unit(int master)
+{
+	switch (master) {
+	case EXTCOMMUNITY_LIST_MASTER:
+		return ECOMMUNITY_SIZE;
+	case LARGE_COMMUNITY_LIST_MASTER:
+		return LCOMMUNITY_SIZE;
+	default:
+		return COMMUNITY_SIZE;
+	}
+}
 
-		if (entry->style == COMMUNITY_LIST_STANDARD) {
-			if (community_include(entry->u.com, COMMUNITY_INTERNET))
-				return entry->direct == COMMUNITY_PERMIT;
+/* Values of a community, large community or extended community. */
+static void community_list_object_vals(int master, void *object,
+				       const uint8_t **val, int *size,
+				       unsigned int *unit)
+{
+	struct community *com = object;
+	struct ecommunity *ecom = object;
+	struct lcommunity *lcom = object;
 
-			if (community_match(com, entry->u.com))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == COMMUNITY_LIST_EXPANDED) {
-			if (community_regexp_match(com, entry->reg))
-				return entry->direct == COMMUNITY_PERMIT;
-		}
+	*val = NULL;
+	*size = 0;
+	*unit = community_list_master_unit(master);
+
+	if (!object)
+		return;
+
+	switch (master) {
+	case COMMUNITY_LIST_MASTER:
+		*val = (const uint8_t *)com->val;
+		*size = com->size;
+		break;
+	case EXTCOMMUNITY_LIST_MASTER:
+		*val = ecom->val;
+		*size = ecom->size;
+		*unit = ecom->unit_size;
+		break;
+	case LARGE_COMMUNITY_LIST_MASTER:
+		*val = lcom->val;
+		*size = lcom->size;
+		break;
 	}
+}
+
+static struct community_list_val *
+community_list_val_lookup(struct community_list_compiled *clc,
+			  const uint8_t *val, unsigned int unit)
+{
+	struct community_list_val key;
+
+	if (unit != clc->unit)
+		return NULL;
+
+	key.len = unit;
+	memcpy(key.val, val, unit);
+	return hash_lookup(clc->vals, &key);
+}
+
+static void community_list_index(struct community_list_compiled *clc,
+				 struct community_list_item *item)
+{
+	const uint8_t *val;
+	unsigned int unit;
+	int size;
+
+	community_list_object_vals(clc->master, item->entry->u.com, &val,
+				   &size, &unit);
+	if (unit != clc->unit || size == 0)
+		return;
+
+	item->indexed = true;
+	item->single = size == 1;
+
+	for (int i = 0; i < size; i++) {
+		struct community_list_val key, *cv;
+
+		key.len = unit;
+		memcpy(key.val, val + i * unit, unit);
+		cv = hash_get(clc->vals, &key, community_list_val_hash_alloc);
+		cv->pos_any = MIN(cv->pos_any, item->pos);
+		if (item->single)
+			cv->pos_single = MIN(cv->pos_single, item->pos);
+	}
+}
+
+/* Back-references would be renumbered when joined with others. */
+static bool community_list_backref(const char *config)
+{
+	for (const char *p = config; (p = strchr(p, '\\')); p++)
+		if (isdigit((unsigned char)p[1]))
+			return true;
 	return false;
 }
 
-bool lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
+static bool community_list_joinable(struct community_list_item *a,
+				    struct community_list_item *b)
+{
+	return a->type == CLIST_ITEM_REGEX && b->type == CLIST_ITEM_REGEX
+	       && a->entry->direct == b->entry->direct && b->pos == a->pos + 1
+	       && !community_list_backref(a->entry->config)
+	       && !community_list_backref(b->entry->config);
+}
+
+/* Join runs of expanded entries with the same action into one regex. */
+static void community_list_join(struct community_list_compiled *clc)
 {
+	struct community_list_item *items = clc->items;
+	unsigned int i, j, k, w = 0;
+
+	for (i = 0; i < clc->nitems; i = j) {
+		size_t len = 1;
+		char *str, *p;
+		regex_t *reg;
+
+		for (j = i + 1; j < clc->nitems
+				&& community_list_joinable(&items[j - 1],
+							   &items[j]);
+		     j++)
+			;
+
+		items[w++] = items[i];
+		if (j == i + 1)
+			continue;
+
+		for (k = i; k < j; k++)
+			len += strlen(items[k].entry->config) + 3;
+
+		str = p = XMALLOC(MTYPE_TMP, len);
+		for (k = i; k < j; k++)
+			p += snprintf(p, len - (p - str), "%s(%s)",
+				      k == i ? "" : "|", items[k].entry->config);
+
+		reg = bgp_regcomp(str);
+		XFREE(MTYPE_TMP, str);
+
+		if (!reg) {
+			for (k = i + 1; k < j; k++)
+				items[w++] = items[k];
+			continue;
+		}
+
+		items[w - 1].reg = reg;
+		items[w - 1].reg_owned = true;
+	}
+	clc->nitems = w;
+}
+
+static struct community_list_compiled *
+community_list_compile(struct community_list *list)
+{
+	struct community_list_compiled *clc;
+	struct community_list_item *item;
 	struct community_entry *entry;
+	unsigned int count = 0, pos;
 
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
+	if (list->compiled)
+		return list->compiled;
 
-		if (entry->style == LARGE_COMMUNITY_LIST_STANDARD) {
-			if (lcommunity_match(lcom, entry->u.lcom))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == LARGE_COMMUNITY_LIST_EXPANDED) {
-			if (lcommunity_regexp_match(lcom, entry->reg))
-				return entry->direct == COMMUNITY_PERMIT;
+	for (entry = list->head; entry; entry = entry->next)
+		count++;
+
+	clc = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED, sizeof(*clc));
+	clc->master = list->head
+			      ? community_list_style_master(list->head->style)
+			      : COMMUNITY_LIST_MASTER;
+	clc->unit = community_list_master_unit(clc->master);
+	clc->vals = hash_create_size(32, community_list_val_hash_key,
+				     community_list_val_hash_cmp,
+				     "Community List Values");
+	clc->entries = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED,
+			       (count + 1) * sizeof(*clc->entries));
+	clc->items = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED,
+			     (count + 1) * sizeof(*clc->items));
+
+	for (pos = 0, entry = list->head; entry; entry = entry->next, pos++) {
+		clc->entries[pos] = entry;
+
+		item = &clc->items[clc->nitems];
+		item->pos = pos;
+		item->entry = entry;
+
+		if (entry->any
+		    || (entry->style == COMMUNITY_LIST_STANDARD
+			&& community_include(entry->u.com, COMMUNITY_INTERNET)))
+			item->type = CLIST_ITEM_ANY;
+		else if (entry->reg) {
+			item->type = CLIST_ITEM_REGEX;
+			item->reg = entry->reg;
+		} else {
+			item->type = CLIST_ITEM_SET;
+			community_list_index(clc, item);
+
+			/* found through the index */
+			if (item->single) {
+				memset(item, 0, sizeof(*item));
+				continue;
+			}
+		}
+		clc->nitems++;
+	}
+
+	community_list_join(clc);
+
+	list->compiled = clc;
+	return clc;
+}
+
+static bool community_list_item_match(struct community_list_item *item,
+				      void *object, bool exact)
+{
+	struct community_entry *entry = item->entry;
+
+	switch (item->type) {
+	case CLIST_ITEM_ANY:
+		return true;
+	case CLIST_ITEM_SET:
+		switch (entry->style) {
+		case COMMUNITY_LIST_STANDARD:
+			return exact ? community_cmp(object, entry->u.com)
+				     : community_match(object, entry->u.com);
+		case LARGE_COMMUNITY_LIST_STANDARD:
+			return exact ? lcommunity_cmp(object, entry->u.lcom)
+				     : lcommunity_match(object, entry->u.lcom);
+		case EXTCOMMUNITY_LIST_STANDARD:
+			return ecommunity_match(object, entry->u.ecom);
+		}
+		break;
+	case CLIST_ITEM_REGEX:
+		switch (entry->style) {
+		case COMMUNITY_LIST_EXPANDED:
+			return community_regexp_match(object, item->reg);
+		case LARGE_COMMUNITY_LIST_EXPANDED:
+			return lcommunity_regexp_match(object, item->reg);
+		case EXTCOMMUNITY_LIST_EXPANDED:
+			return ecommunity_regexp_match(object, item->reg);
 		}
+		break;
 	}
 	return false;
 }
 
+/* First entry matching the whole attribute, or NULL. */
+static struct community_entry *
+community_list_compiled_match(struct community_list_compiled *clc,
+			      void *object, bool exact)
+{
+	struct community_list_val *cv;
+	uint32_t best = UINT32_MAX;
+	const uint8_t *val;
+	unsigned int unit, i;
+	int size;
+
+	community_list_object_vals(clc->master, object, &val, &size, &unit);
+
+	/* only a single value can be equal to a single-value entry */
+	if (!exact || size == 1)
+		for (int n = 0; n < size; n++) {
+			cv = community_list_val_lookup(clc, val + n * unit,
+						       unit);
+			if (cv)
+				best = MIN(best, cv->pos_single);
+		}
 
-/* Perform exact matching.  In case of expanded large-community-list, do
- * same thing as lcommunity_list_match().
+	for (i = 0; i < clc->nitems && clc->items[i].pos < best; i++)
+		if (community_list_item_match(&clc->items[i], object, exact))
+			return clc->items[i].entry;
+
+	return best == UINT32_MAX ? NULL : clc->entries[best];
+}
+
+/* First entry matching the n-th value of the attribute, or NULL. */
+static struct community_entry *
+community_list_compiled_match_val(struct community_list_compiled *clc,
+				  void *object, int n)
+{
+	struct community_list_item *item;
+	struct community_list_val *cv;
+	uint32_t best = UINT32_MAX;
+	const uint8_t *val;
+	unsigned int unit, i;
+	int size;
+
+	community_list_object_vals(clc->master, object, &val, &size, &unit);
+
+	cv = community_list_val_lookup(clc, val + n * unit, unit);
+	if (cv)
+		best = cv->pos_any;
+
+	for (i = 0; i < clc->nitems && clc->items[i].pos < best; i++) {
+		item = &clc->items[i];
+
+		switch (item->type) {
+		case CLIST_ITEM_ANY:
+			return item->entry;
+		case CLIST_ITEM_SET:
+			/* covered by the index */
+			if (item->indexed)
+				break;
+			if (item->entry->style == LARGE_COMMUNITY_LIST_STANDARD
+			    && lcommunity_include(item->entry->u.lcom,
+						  (uint8_t *)val + n * unit))
+				return item->entry;
+			if (item->entry->style == COMMUNITY_LIST_STANDARD
+			    && community_include(item->entry->u.com,
+						 community_val_get(object, n)))
+				return item->entry;
+			break;
+		case CLIST_ITEM_REGEX:
+			if (item->entry->style == COMMUNITY_LIST_EXPANDED
+			    && community_regexp_include(item->reg, object, n))
+				return item->entry;
+			if (item->entry->style == LARGE_COMMUNITY_LIST_EXPANDED
+			    && lcommunity_regexp_include(item->reg, object, n))
+				return item->entry;
+			break;
+		}
+	}
+
+	return best == UINT32_MAX ? NULL : clc->entries[best];
+}
+
+static int community_list_memo_get(struct community_list_memo *memo,
+				   const struct community_list *list, int kind)
+{
+	for (unsigned int i = 0; memo && i < array_size(memo->ent); i++) {
+		if (memo->ent[i].list != list
+		    || memo->ent[i].version != list->version)
+			continue;
+		if (!(memo->ent[i].flags & (1 << kind)))
+			return -1;
+		return !!(memo->ent[i].flags & (2 << kind));
+	}
+	return -1;
+}
+
+static void community_list_memo_set(struct community_list_memo **memop,
+				    const struct community_list *list,
+				    int kind, bool result)
+{
+	struct community_list_memo *memo = *memop;
+	unsigned int i;
+
+	for (i = 0; memo && i < array_size(memo->ent); i++)
+		if (memo->ent[i].list == list
+		    && memo->ent[i].version == list->version)
+			break;
+
+	if (!memo)
+		memo = *memop = XCALLOC(MTYPE_COMMUNITY_LIST_MEMO,
+					sizeof(*memo));
+	if (i == array_size(memo->ent)) {
+		i = memo->next++ % array_size(memo->ent);
+		memo->ent[i].list = list;
+		memo->ent[i].version = list->version;
+		memo->ent[i].flags = 0;
+	}
+	memo->ent[i].flags |= (1 << kind) | (result ? 2 << kind : 0);
+}
+
+/*
+ * Match an attribute against the list.  Interned attributes are shared by
+ * many routes and don't change, so the results for them are remembered on
+ * the attribute until the list changes.
  */
-bool lcommunity_list_exact_match(struct lcommunity *lcom,
-				 struct community_list *list)
+static bool community_list_apply(struct community_list *list, void *object,
+				 atomic_size_t *refcnt,
+				 struct community_list_memo **memop, int kind)
 {
 	struct community_entry *entry;
+	bool result;
+	int memo;
 
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
+	if (!object || !atomic_load_explicit(refcnt, memory_order_relaxed))
+		memop = NULL;
 
-		if (entry->style == LARGE_COMMUNITY_LIST_STANDARD) {
-			if (lcommunity_cmp(lcom, entry->u.com))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == LARGE_COMMUNITY_LIST_EXPANDED) {
-			if (lcommunity_regexp_match(lcom, entry->reg))
-				return entry->direct == COMMUNITY_PERMIT;
-		}
+	if (memop) {
+		memo = community_list_memo_get(*memop, list, kind);
+		if (memo >= 0)
+			return memo;
 	}
-	return false;
+
+	entry = community_list_compiled_match(community_list_compile(list),
+					      object, kind == CLIST_MEMO_EXACT);
+	result = entry && entry->direct == COMMUNITY_PERMIT;
+
+	if (memop)
+		community_list_memo_set(memop, list, kind, result);
+
+	return result;
+}
+
+/* When given community attribute matches to the community-list return
+   1 else return 0.  */
+bool community_list_match(struct community *com, struct community_list *list)
+{
+	return community_list_apply(list, com, com ? &com->refcnt : NULL,
+				    com ? &com->clist_memo : NULL,
+				    CLIST_MEMO_MATCH);
+}
+
+bool lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
+{
+	return community_list_apply(list, lcom, lcom ? &lcom->refcnt : NULL,
+				    lcom ? &lcom->clist_memo : NULL,
+				    CLIST_MEMO_MATCH);
+}
+
+
+/* Perform exact matching.  In case of expanded large-community-list, do
+ * same thing as lcommunity_list_match().
+ */
+bool lcommunity_list_exact_match(struct lcommunity *lcom,
+				 struct community_list *list)
+{
+	return community_list_apply(list, lcom, lcom ? &lcom->refcnt : NULL,
+				    lcom ? &lcom->clist_memo : NULL,
+				    CLIST_MEMO_EXACT);
 }
 
 bool ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
 {
 	struct community_entry *entry;
 
+	if (!ecom || ecom->unit_size == ECOMMUNITY_SIZE)
+		return community_list_apply(list, ecom,
+					    ecom ? &ecom->refcnt : NULL,
+					    ecom ? &ecom->clist_memo : NULL,
+					    CLIST_MEMO_MATCH);
+
+	/* The value index only holds ECOMMUNITY_SIZE values. */
 	for (entry = list->head; entry; entry = entry->next) {
 		if (entry->any)
 			return entry->direct == COMMUNITY_PERMIT;
@@ -825,72 +1313,33 @@ bool ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
 bool community_list_exact_match(struct community *com,
 				struct community_list *list)
 {
-	struct community_entry *entry;
-
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
-
-		if (entry->style == COMMUNITY_LIST_STANDARD) {
-			if (community_include(entry->u.com, COMMUNITY_INTERNET))
-				return entry->direct == COMMUNITY_PERMIT;
-
-			if (community_cmp(com, entry->u.com))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == COMMUNITY_LIST_EXPANDED) {
-			if (community_regexp_match(com, entry->reg))
-				return entry->direct == COMMUNITY_PERMIT;
-		}
-	}
-	return false;
+	return community_list_apply(list, com, com ? &com->refcnt : NULL,
+				    com ? &com->clist_memo : NULL,
+				    CLIST_MEMO_EXACT);
 }
 
 /* Delete all permitted communities in the list from com.  */
 struct community *community_list_match_delete(struct community *com,
 					      struct community_list *list)
 {
+	struct community_list_compiled *clc;
 	struct community_entry *entry;
 	uint32_t val;
 	uint32_t com_index_to_delete[com->size];
 	int delete_index = 0;
 	int i;
 
+	clc = community_list_compile(list);
+
 	/* Loop over each community value and evaluate each against the
 	 * community-list.  If we need to delete a community value add its index
 	 * to com_index_to_delete.
 	 */
 	for (i = 0; i < com->size; i++) {
-		val = community_val_get(com, i);
-
-		for (entry = list->head; entry; entry = entry->next) {
-			if (entry->any) {
-				if (entry->direct == COMMUNITY_PERMIT) {
-					com_index_to_delete[delete_index] = i;
-					delete_index++;
-				}
-				break;
-			}
-
-			else if ((entry->style == COMMUNITY_LIST_STANDARD)
-				 && (community_include(entry->u.com,
-						       COMMUNITY_INTERNET)
-				     || community_include(entry->u.com, val))) {
-				if (entry->direct == COMMUNITY_PERMIT) {
-					com_index_to_delete[delete_index] = i;
-					delete_index++;
-				}
-				break;
-			}
-
-			else if ((entry->style == COMMUNITY_LIST_EXPANDED)
-				 && community_regexp_include(entry->reg, com,
-							     i)) {
-				if (entry->direct == COMMUNITY_PERMIT) {
-					com_index_to_delete[delete_index] = i;
-					delete_index++;
-				}
-				break;
-			}
+		entry = community_list_compiled_match_val(clc, com, i);
+		if (entry && entry->direct == COMMUNITY_PERMIT) {
+			com_index_to_delete[delete_index] = i;
+			delete_index++;
 		}
 	}
 
@@ -1058,45 +1507,24 @@ int community_list_unset(struct community_list_handler *ch, const char *name,
 struct lcommunity *lcommunity_list_match_delete(struct lcommunity *lcom,
 						struct community_list *list)
 {
+	struct community_list_compiled *clc;
 	struct community_entry *entry;
 	uint32_t com_index_to_delete[lcom->size];
 	uint8_t *ptr;
 	int delete_index = 0;
 	int i;
 
+	clc = community_list_compile(list);
+
 	/* Loop over each lcommunity value and evaluate each against the
 	 * community-list.  If we need to delete a community value add its index
 	 * to com_index_to_delete.
 	 */
 	for (i = 0; i < lcom->size; i++) {
-		ptr = lcom->val + (i * LCOMMUNITY_SIZE);
-		for (entry = list->head; entry; entry = entry->next) {
-			if (entry->any) {
-				if (entry->direct == COMMUNITY_PERMIT) {
-					com_index_to_delete[delete_index] = i;
-					delete_index++;
-				}
-				break;
-			}
-
-			else if ((entry->style == LARGE_COMMUNITY_LIST_STANDARD)
-				 && lcommunity_include(entry->u.lcom, ptr)) {
-				if (entry->direct == COMMUNITY_PERMIT) {
-					com_index_to_delete[delete_index] = i;
-					delete_index++;
-				}
-				break;
-			}
-
-			else if ((entry->style == LARGE_COMMUNITY_LIST_EXPANDED)
-				 && lcommunity_regexp_include(entry->reg, lcom,
-							      i)) {
-				if (entry->direct == COMMUNITY_PERMIT) {
-					com_index_to_delete[delete_index] = i;
-					delete_index++;
-				}
-				break;
-			}
+		entry = community_list_compiled_match_val(clc, lcom, i);
+		if (entry && entry->direct == COMMUNITY_PERMIT) {
+			com_index_to_delete[delete_index] = i;
+			delete_index++;
 		}
 	}
 
@@ -67,6 +67,24 @@ struct community_list {
 	/* Community-list entry in this community-list.  */
 	struct community_entry *head;
 	struct community_entry *tail;
+
+	/* Bumped on every change, results memoized on communities are
+	   only valid for this version.  */
+	uint32_t version;
+
+	/* Built from the entries on first use, see community_list_compile().
+	 */
+	struct community_list_compiled *compiled;
+};
+
+/* Last few community-list results for an interned (e|l)community.  */
+struct community_list_memo {
+	unsigned int next;
+	struct {
+		const struct community_list *list;
+		uint32_t version;
+		uint8_t flags;
+	} ent[4];
 };
 
 /* Each entry in community-list.  */
@@ -27,9 +27,10 @@
 
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_community.h"
+#include "bgpd/bgp_intern.h"
 
 /* Hash of community attribute. */
-static struct hash *comhash;
+static struct bgp_intern comhash;
 
 /* Allocate a new communities value.  */
 static struct community *community_new(void)
@@ -45,6 +46,7 @@ void community_free(struct community **com)
 
 	XFREE(MTYPE_COMMUNITY_VAL, (*com)->val);
 	XFREE(MTYPE_COMMUNITY_STR, (*com)->str);
+	XFREE(MTYPE_COMMUNITY_LIST_MEMO, (*com)->clist_memo);
 
 	if ((*com)->json) {
 		json_object_free((*com)->json);
@@ -470,44 +472,44 @@ static void set_community_string(struct community *com, bool make_json)
 struct community *community_intern(struct community *com)
 {
 	struct community *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
 	/* Assert this community structure is not interned. */
 	assert(com->refcnt == 0);
 
+	/* Hash once, for the stripe, the lookup and the release */
+	com->hash = community_hash_make(com);
+
 	/* Lookup community hash. */
-	find = (struct community *)hash_get(comhash, com, hash_alloc_intern);
+	key = bgp_intern_key(&comhash, com);
+	st = bgp_intern_stripe(&comhash, key);
+	frr_with_mutex (&st->mtx) {
+		find = (struct community *)hash_get_with_key(
+			st->hash, com, key, hash_alloc_intern);
+
+		/* Increment refrence counter.  */
+		bgp_intern_ref(&find->refcnt);
+
+		/* Make string, before anyone else can see it.  */
+		if (!find->str)
+			set_community_string(find, false);
+	}
 
 	/* Arguemnt com is allocated temporary.  So when it is not used in
 	   hash, it should be freed.  */
 	if (find != com)
 		community_free(&com);
 
-	/* Increment refrence counter.  */
-	find->refcnt++;
-
-	/* Make string.  */
-	if (!find->str)
-		set_community_string(find, false);
-
 	return find;
 }
 
 /* Free community attribute. */
 void community_unintern(struct community **com)
 {
-	struct community *ret;
-
-	if ((*com)->refcnt)
-		(*com)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*com)->refcnt == 0) {
-		/* Community value com must exist in hash. */
-		ret = (struct community *)hash_release(comhash, *com);
-		assert(ret != NULL);
-
+	/* Pull off from hash on the last reference.  */
+	if (bgp_intern_release(&comhash, *com, &(*com)->refcnt))
 		community_free(com);
-	}
 }
 
 /* Create new community attribute. */
@@ -564,6 +566,9 @@ unsigned int community_hash_make(const struct community *com)
 {
 	uint32_t *pnt = com->val;
 
+	if (com->hash)
+		return com->hash;
+
 	return jhash2(pnt, com->size, 0x43ea96c1);
 }
 
@@ -603,6 +608,10 @@ bool community_cmp(const struct community *com1, const struct community *com2)
 	if (com1 == NULL || com2 == NULL)
 		return false;
 
+	/* Differing hash keys settle it without looking at the values */
+	if (com1->hash && com2->hash && com1->hash != com2->hash)
+		return false;
+
 	if (com1->size == com2->size)
 		if (memcmp(com1->val, com2->val, com1->size * COMMUNITY_SIZE)
 		    == 0)
@@ -872,28 +881,28 @@ struct community *community_str2com(const char *str)
 /* Return communities hash entry count.  */
 unsigned long community_count(void)
 {
-	return comhash->count;
+	return bgp_intern_count(&comhash);
 }
 
 /* Return communities hash.  */
-struct hash *community_hash(void)
+struct bgp_intern *community_hash(void)
 {
-	return comhash;
+	return &comhash;
 }
 
 /* Initialize comminity related hash. */
 void community_init(void)
 {
-	comhash =
-		hash_create((unsigned int (*)(const void *))community_hash_make,
-			    (bool (*)(const void *, const void *))community_cmp,
-			    "BGP Community Hash");
+	bgp_intern_init(
+		&comhash, hash_create_size, HASH_INITIAL_SIZE,
+		(unsigned int (*)(const void *))community_hash_make,
+		(bool (*)(const void *, const void *))community_cmp,
+		"BGP Community Hash");
 }
 
 void community_finish(void)
 {
-	hash_free(comhash);
-	comhash = NULL;
+	bgp_intern_finish(&comhash, NULL);
 }
 
 static struct community *bgp_aggr_community_lookup(
@@ -934,8 +943,29 @@ void bgp_aggr_community_remove(void *arg)
 void bgp_compute_aggregate_community(struct bgp_aggregate *aggregate,
 				     struct community *community)
 {
+	struct community *aggr_community;
+	struct community *commerge;
+
+	if ((aggregate == NULL) || (community == NULL))
+		return;
+
 	bgp_compute_aggregate_community_hash(aggregate, community);
-	bgp_compute_aggregate_community_val(aggregate);
+
+	/* Only a community not seen before among the aggregated routes
+	 * changes the union; merge just that one in.
+	 */
+	aggr_community = bgp_aggr_community_lookup(aggregate, community);
+	if (!aggr_community || aggr_community->refcnt > 1)
+		return;
+
+	if (!aggregate->community) {
+		bgp_compute_aggregate_community_val(aggregate);
+		return;
+	}
+
+	commerge = community_merge(aggregate->community, aggr_community);
+	aggregate->community = community_uniq_sort(commerge);
+	community_free(&commerge);
 }
 
 
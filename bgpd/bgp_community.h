@@ -24,14 +24,19 @@
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 
+struct bgp_intern;
+
 /* Communities attribute.  */
 struct community {
 	/* Reference count of communities value.  */
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 
 	/* Communities value size.  */
 	int size;
 
+	/* Hash key, set once interned; 0 means not computed. */
+	uint32_t hash;
+
 	/* Communities value.  */
 	uint32_t *val;
 
@@ -41,6 +46,9 @@ struct community {
 	/* String of community attribute.  This sring is used by vty output
 	   and expanded community-list for regular expression match.  */
 	char *str;
+
+	/* community-list results, only for interned values */
+	struct community_list_memo *clist_memo;
 };
 
 /* Well-known communities value.  */
@@ -90,7 +98,7 @@ extern struct community *community_dup(struct community *);
 extern bool community_include(struct community *, uint32_t);
 extern void community_del_val(struct community *, uint32_t *);
 extern unsigned long community_count(void);
-extern struct hash *community_hash(void);
+extern struct bgp_intern *community_hash(void);
 extern uint32_t community_val_get(struct community *com, int i);
 extern void bgp_compute_aggregate_community(struct bgp_aggregate *aggregate,
 					    struct community *community);
@@ -22,51 +22,66 @@
 
 const char *get_afi_safi_str(afi_t afi, safi_t safi, bool for_json);
 
-static route_map_result_t
-bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
-				     struct route_map *rmap)
+/* Check whether any path of the dest matches the condition-map */
+static bool bgp_conditional_adv_dest_match(struct bgp_dest *dest,
+					   struct route_map *rmap)
 {
 	struct attr dummy_attr = {0};
-	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
 	struct bgp_path_info path = {0};
 	struct bgp_path_info_extra path_extra = {0};
-	const struct prefix *dest_p;
-	route_map_result_t ret = RMAP_DENYMATCH;
+	const struct prefix *dest_p = bgp_dest_get_prefix(dest);
+	route_map_result_t ret;
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		dest_p = bgp_dest_get_prefix(dest);
-		assert(dest_p);
+	assert(dest_p);
 
-		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
-			dummy_attr = *pi->attr;
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+			continue;
 
-			/* Fill temp path_info */
-			prep_for_rmap_apply(&path, &path_extra, dest, pi,
-					    pi->peer, &dummy_attr);
+		dummy_attr = *pi->attr;
 
-			RESET_FLAG(dummy_attr.rmap_change_flags);
+		/* Fill temp path_info */
+		prep_for_rmap_apply(&path, &path_extra, dest, pi, pi->peer,
+				    &dummy_attr);
 
-			ret = route_map_apply(rmap, dest_p, &path);
-			if (ret != RMAP_PERMITMATCH)
-				bgp_attr_flush(&dummy_attr);
-			else {
-				bgp_dest_unlock_node(dest);
-				if (BGP_DEBUG(update, UPDATE_OUT))
-					zlog_debug(
-						"%s: Condition map routes present in BGP table",
-						__func__);
+		RESET_FLAG(dummy_attr.rmap_change_flags);
 
-				return ret;
-			}
-		}
+		ret = route_map_apply(rmap, dest_p, &path);
+		bgp_attr_flush(&dummy_attr);
+		if (ret == RMAP_PERMITMATCH)
+			return true;
+	}
+
+	return false;
+}
+
+static route_map_result_t
+bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
+				     struct route_map *rmap,
+				     struct prefix *witness)
+{
+	struct bgp_dest *dest;
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		if (!bgp_conditional_adv_dest_match(dest, rmap))
+			continue;
+
+		prefix_copy(witness, bgp_dest_get_prefix(dest));
+		bgp_dest_unlock_node(dest);
+		if (BGP_DEBUG(update, UPDATE_OUT))
+			zlog_debug(
+				"%s: Condition map routes present in BGP table",
+				__func__);
+
+		return RMAP_PERMITMATCH;
 	}
 
 	if (BGP_DEBUG(update, UPDATE_OUT))
 		zlog_debug("%s: Condition map routes not present in BGP table",
 			   __func__);
 
-	return ret;
+	return RMAP_DENYMATCH;
 }
 
 static void bgp_conditional_adv_routes(struct peer *peer, afi_t afi,
@@ -177,6 +192,7 @@ static int bgp_conditional_adv_timer(struct thread *t)
 	struct bgp_filter *filter = NULL;
 	struct listnode *node, *nnode = NULL;
 	struct update_subgroup *subgrp = NULL;
+	enum update_type update_type;
 	route_map_result_t ret;
 
 	bgp = THREAD_ARG(t);
@@ -224,11 +240,11 @@ static int bgp_conditional_adv_timer(struct thread *t)
 				continue;
 
 			if (!peer->advmap_config_change[afi][safi]
-			    && !peer->advmap_table_change)
+			    && !peer->advmap_table_change[afi][safi])
 				continue;
 
 			if (BGP_DEBUG(update, UPDATE_OUT)) {
-				if (peer->advmap_table_change)
+				if (peer->advmap_table_change[afi][safi])
 					zlog_debug(
 						"%s: %s - routes changed in BGP table.",
 						__func__, peer->host);
@@ -244,20 +260,33 @@ static int bgp_conditional_adv_timer(struct thread *t)
 			 * non-exist-map) map validation
 			 */
 			ret = bgp_check_rmap_prefixes_in_bgp_table(
-				table, filter->advmap.cmap);
+				table, filter->advmap.cmap,
+				&filter->advmap.cmap_witness);
+			filter->advmap.cmap_present = (ret == RMAP_PERMITMATCH);
+			peer->advmap_table_change[afi][safi] = false;
 
 			/* Derive conditional advertisement status from
 			 * condition and return value of condition-map
 			 * validation.
 			 */
 			if (filter->advmap.condition == CONDITION_EXIST)
-				filter->advmap.update_type =
-					(ret == RMAP_PERMITMATCH) ? ADVERTISE
-								  : WITHDRAW;
+				update_type = (ret == RMAP_PERMITMATCH)
+						      ? ADVERTISE
+						      : WITHDRAW;
 			else
-				filter->advmap.update_type =
-					(ret == RMAP_PERMITMATCH) ? WITHDRAW
-								  : ADVERTISE;
+				update_type = (ret == RMAP_PERMITMATCH)
+						      ? WITHDRAW
+						      : ADVERTISE;
+
+			/* Routes in the advertise-map that change while the
+			 * status is unchanged are handled by the regular
+			 * update path, so only walk the table on a flip.
+			 */
+			if (!peer->advmap_config_change[afi][safi]
+			    && update_type == filter->advmap.update_type)
+				continue;
+
+			filter->advmap.update_type = update_type;
 
 			/* Send regular update as per the existing policy.
 			 * There is a change in route-map, match-rule, ACLs,
@@ -288,11 +317,107 @@ static int bgp_conditional_adv_timer(struct thread *t)
 						   filter->advmap.amap,
 						   filter->advmap.update_type);
 		}
-		peer->advmap_table_change = false;
 	}
 	return 0;
 }
 
+/* Re-evaluate the condition-map of one peer/AFI/SAFI against a single
+ * changed prefix. Returns true if the peer needs to be looked at by the
+ * conditional advertisement timer.
+ */
+static bool bgp_conditional_adv_peer_dest(struct peer *peer, afi_t afi,
+					  safi_t safi, struct bgp_dest *dest)
+{
+	struct bgp_filter *filter = &peer->filter[afi][safi];
+	bool match;
+
+	if (!filter->advmap.amap || !filter->advmap.cmap)
+		return false;
+
+	if (!peer->afc_nego[afi][safi])
+		return false;
+
+	/* A full evaluation is already pending */
+	if (peer->advmap_config_change[afi][safi]
+	    || peer->advmap_table_change[afi][safi])
+		return true;
+
+	match = bgp_conditional_adv_dest_match(dest, filter->advmap.cmap);
+
+	/* Condition state can only change if this prefix now matches while
+	 * nothing did before, or if the prefix that satisfied the condition
+	 * no longer does.
+	 */
+	if (match) {
+		if (filter->advmap.cmap_present)
+			return false;
+	} else {
+		if (!filter->advmap.cmap_present
+		    || !prefix_same(&filter->advmap.cmap_witness,
+				    bgp_dest_get_prefix(dest)))
+			return false;
+	}
+
+	if (BGP_DEBUG(update, UPDATE_OUT))
+		zlog_debug("%s: %s for %s - condition map prefix %pBD changed",
+			   __func__, peer->host,
+			   get_afi_safi_str(afi, safi, false), dest);
+
+	peer->advmap_table_change[afi][safi] = true;
+	return true;
+}
+
+/* Called from route processing for every prefix whose paths changed. */
+void bgp_conditional_adv_dest_changed(struct bgp *bgp, afi_t afi, safi_t safi,
+				      struct bgp_dest *dest)
+{
+	struct peer *peer;
+	struct listnode *node;
+	bool changed = false;
+
+	if (!bgp->condition_filter_count)
+		return;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
+			continue;
+
+		if (peer->status != Established)
+			continue;
+
+		if (bgp_conditional_adv_peer_dest(peer, afi, safi, dest))
+			changed = true;
+
+		/* labeled-unicast routes are installed in the unicast table */
+		if (safi == SAFI_UNICAST
+		    && bgp_conditional_adv_peer_dest(
+			    peer, afi, SAFI_LABELED_UNICAST, dest))
+			changed = true;
+	}
+
+	if (changed)
+		bgp_conditional_adv_schedule(bgp);
+}
+
+/* Run the conditional advertisement timer shortly, coalescing bursts of
+ * changes into a single evaluation.
+ */
+void bgp_conditional_adv_schedule(struct bgp *bgp)
+{
+	if (!bgp->condition_filter_count)
+		return;
+
+	if (bgp->t_condition_check
+	    && thread_timer_remain_msec(bgp->t_condition_check)
+		       <= CONDITIONAL_ROUTES_EVENT_DELAY)
+		return;
+
+	THREAD_OFF(bgp->t_condition_check);
+	thread_add_timer_msec(bm->master, bgp_conditional_adv_timer, bgp,
+			      CONDITIONAL_ROUTES_EVENT_DELAY,
+			      &bgp->t_condition_check);
+}
+
 void bgp_conditional_adv_enable(struct peer *peer, afi_t afi, safi_t safi)
 {
 	struct bgp *bgp = peer->bgp;
@@ -313,12 +438,14 @@ void bgp_conditional_adv_enable(struct peer *peer, afi_t afi, safi_t safi)
 			zlog_debug("%s: condition_filter_count %d", __func__,
 				   bgp->condition_filter_count);
 
+		bgp_conditional_adv_schedule(bgp);
 		return;
 	}
 
-	/* Register for conditional routes polling timer */
-	thread_add_timer(bm->master, bgp_conditional_adv_timer, bgp,
-			 CONDITIONAL_ROUTES_POLL_TIME, &bgp->t_condition_check);
+	/* Evaluate the new condition shortly; the timer re-arms itself as a
+	 * fallback poll afterwards.
+	 */
+	bgp_conditional_adv_schedule(bgp);
 }
 
 void bgp_conditional_adv_disable(struct peer *peer, afi_t afi, safi_t safi)
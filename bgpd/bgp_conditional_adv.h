@@ -33,13 +33,23 @@
 extern "C" {
 #endif
 
-/* Polling time for monitoring condition-map routes in route table */
+/* Fallback polling time for monitoring condition-map routes in route table.
+ * Changes to condition-map routes are normally picked up as the prefixes are
+ * processed, see bgp_conditional_adv_dest_changed().
+ */
 #define CONDITIONAL_ROUTES_POLL_TIME 60
 
+/* Delay (msec) used to coalesce condition changes before re-evaluating */
+#define CONDITIONAL_ROUTES_EVENT_DELAY 100
+
 extern void bgp_conditional_adv_enable(struct peer *peer, afi_t afi,
 				       safi_t safi);
 extern void bgp_conditional_adv_disable(struct peer *peer, afi_t afi,
 					safi_t safi);
+extern void bgp_conditional_adv_schedule(struct bgp *bgp);
+extern void bgp_conditional_adv_dest_changed(struct bgp *bgp, afi_t afi,
+					     safi_t safi,
+					     struct bgp_dest *dest);
 #ifdef __cplusplus
 }
 #endif
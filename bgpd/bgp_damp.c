@@ -28,6 +28,7 @@
 #include "thread.h"
 #include "queue.h"
 #include "filter.h"
+#include "lib_vty.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_damp.h"
@@ -41,145 +42,195 @@ const char *get_afi_safi_str(afi_t afi, safi_t safi, bool for_json);
 /* Global variable to access damping configuration */
 static struct bgp_damp_config damp[AFI_MAX][SAFI_MAX];
 
-/* Utility macro to add and delete BGP dampening information to no
-   used list.  */
-#define BGP_DAMP_LIST_ADD(N, A) BGP_PATH_INFO_ADD(N, A, no_reuse_list)
-#define BGP_DAMP_LIST_DEL(N, A) BGP_PATH_INFO_DEL(N, A, no_reuse_list)
-
-/* Calculate reuse list index by penalty value.  */
-static int bgp_reuse_index(int penalty, struct bgp_damp_config *bdc)
+/* Return decayed penalty value.  */
+int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
 {
 	unsigned int i;
-	int index;
 
-	/*
-	 * reuse_limit can't be zero, this is for Coverity
-	 * to bypass division by zero test.
-	 */
-	assert(bdc->reuse_limit);
+	i = (int)((double)tdiff / DELTA_T);
 
-	i = (int)(((double)penalty / bdc->reuse_limit - 1.0)
-		  * bdc->scale_factor);
+	if (i == 0)
+		return penalty;
 
-	if (i >= bdc->reuse_index_size)
-		i = bdc->reuse_index_size - 1;
+	if (i >= bdc->decay_array_size)
+		return 0;
 
-	index = bdc->reuse_index[i] - bdc->reuse_index[0];
+	return (int)(penalty * bdc->decay_array[i]);
+}
 
-	return (bdc->reuse_offset + index) % bdc->reuse_list_size;
+/* Penalty at t_now; it is only stored when a flap adds to it. */
+static unsigned int bgp_damp_penalty(struct bgp_damp_info *bdi,
+				     struct bgp_damp_config *bdc, time_t t_now)
+{
+	return bgp_damp_decay(t_now - bdi->t_updated, bdi->penalty, bdc);
 }
 
-/* Add BGP dampening information to reuse list.  */
+/*
+ * When the penalty will have decayed below the reuse limit if the route
+ * is suppressed, or below half of it (and can be forgotten) otherwise.
+ */
+static time_t bgp_damp_due(struct bgp_damp_info *bdi,
+			   struct bgp_damp_config *bdc)
+{
+	double limit = bdc->reuse_limit;
+	double steps;
+
+	if (!CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED))
+		limit /= 2.0;
+
+	if (bdi->penalty < limit)
+		return bdi->t_updated;
+
+	steps = floor(log(limit / bdi->penalty) / log(bdc->decay_array[1]));
+	if (steps >= bdc->decay_array_size)
+		steps = bdc->decay_array_size;
+
+	return bdi->t_updated + ((time_t)steps + 1) * DELTA_T;
+}
+
+/* Put BGP dampening information in the reuse_list slot for t_due.  */
 static void bgp_reuse_list_add(struct bgp_damp_info *bdi,
 			       struct bgp_damp_config *bdc)
 {
-	int index;
+	time_t tick = bdi->t_due / DELTA_REUSE;
 
-	index = bdi->index = bgp_reuse_index(bdi->penalty, bdc);
+	/* Anything past the end of the wheel goes round again */
+	if (tick < bdc->reuse_tick)
+		tick = bdc->reuse_tick;
+	else if (tick >= bdc->reuse_tick + bdc->reuse_list_size)
+		tick = bdc->reuse_tick + bdc->reuse_list_size - 1;
 
-	bdi->prev = NULL;
-	bdi->next = bdc->reuse_list[index];
-	if (bdc->reuse_list[index])
-		bdc->reuse_list[index]->prev = bdi;
-	bdc->reuse_list[index] = bdi;
+	bdi->index = tick % bdc->reuse_list_size;
+	bgp_damp_wheel_add_tail(&bdc->reuse_list[bdi->index], bdi);
 }
 
 /* Delete BGP dampening information from reuse list.  */
 static void bgp_reuse_list_delete(struct bgp_damp_info *bdi,
 				  struct bgp_damp_config *bdc)
 {
-	if (bdi->next)
-		bdi->next->prev = bdi->prev;
-	if (bdi->prev)
-		bdi->prev->next = bdi->next;
-	else
-		bdc->reuse_list[bdi->index] = bdi->next;
+	if (bdi->index < 0)
+		return;
+
+	bgp_damp_wheel_del(&bdc->reuse_list[bdi->index], bdi);
+	bdi->index = -1;
 }
 
-/* Return decayed penalty value.  */
-int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
+static void bgp_reuse_list_update(struct bgp_damp_info *bdi,
+				  struct bgp_damp_config *bdc)
 {
-	unsigned int i;
+	bgp_reuse_list_delete(bdi, bdc);
+	bdi->t_due = bgp_damp_due(bdi, bdc);
+	bgp_reuse_list_add(bdi, bdc);
+}
 
-	i = (int)((double)tdiff / DELTA_T);
+static int bgp_reuse_timer(struct thread *t);
 
-	if (i == 0)
-		return penalty;
+static void bgp_reuse_timer_start(struct bgp_damp_config *bdc)
+{
+	/* An idle wheel restarts at the current time */
+	if (!bdc->t_reuse && !bdc->count)
+		bdc->reuse_tick = bgp_clock() / DELTA_REUSE;
 
-	if (i >= bdc->decay_array_size)
-		return 0;
+	thread_add_timer(bm->master, bgp_reuse_timer, bdc, DELTA_REUSE,
+			 &bdc->t_reuse);
+}
 
-	return (int)(penalty * bdc->decay_array[i]);
+/* Reuse a suppressed route (RFC2439 Section 4.8.7).  */
+static void bgp_damp_reuse(struct bgp_damp_info *bdi,
+			   struct bgp_damp_config *bdc)
+{
+	struct bgp *bgp = bdi->path->peer->bgp;
+
+	bgp_path_info_unset_flag(bdi->dest, bdi->path, BGP_PATH_DAMPED);
+	bdi->suppress_time = 0;
+	bdc->suppressed--;
+
+	if (bdi->lastrecord == BGP_RECORD_UPDATE) {
+		bgp_path_info_unset_flag(bdi->dest, bdi->path,
+					 BGP_PATH_HISTORY);
+		bgp_aggregate_increment(bgp, bgp_dest_get_prefix(bdi->dest),
+					bdi->path, bdi->afi, bdi->safi);
+		bgp_process(bgp, bdi->dest, bdi->afi, bdi->safi);
+	}
 }
 
-/* Handler of reuse timer event.  Each route in the current reuse-list
-   is evaluated.  RFC2439 Section 4.8.7.  */
+/* Handler of reuse timer event.  Each route in the slots that came due
+   is evaluated.  Routes whose penalty decayed enough are reused, or
+   forgotten once it is below half the reuse limit.  */
 static int bgp_reuse_timer(struct thread *t)
 {
 	struct bgp_damp_info *bdi;
-	struct bgp_damp_info *next;
-	time_t t_now, t_diff;
+	struct bgp_damp_wheel_head due;
+	time_t t_now, now_tick;
+	unsigned int penalty;
+	unsigned int slots;
 
 	struct bgp_damp_config *bdc = THREAD_ARG(t);
 
-	bdc->t_reuse = NULL;
-	thread_add_timer(bm->master, bgp_reuse_timer, bdc, DELTA_REUSE,
-			 &bdc->t_reuse);
-
 	t_now = bgp_clock();
+	now_tick = t_now / DELTA_REUSE;
 
-	/* 1.  save a pointer to the current zeroth queue head and zero the
-	   list head entry.  */
-	bdi = bdc->reuse_list[bdc->reuse_offset];
-	bdc->reuse_list[bdc->reuse_offset] = NULL;
+	bgp_damp_wheel_init(&due);
 
-	/* 2.  set offset = modulo reuse-list-size ( offset + 1 ), thereby
-	   rotating the circular queue of list-heads.  */
-	bdc->reuse_offset = (bdc->reuse_offset + 1) % bdc->reuse_list_size;
+	/* Catch up on the ticks since the last run, at most one turn. */
+	for (slots = 0; bdc->reuse_tick <= now_tick; bdc->reuse_tick++) {
+		struct bgp_damp_wheel_head *slot;
 
-	/* 3. if ( the saved list head pointer is non-empty ) */
-	for (; bdi; bdi = next) {
-		struct bgp *bgp = bdi->path->peer->bgp;
+		if (slots++ >= bdc->reuse_list_size) {
+			bdc->reuse_tick = now_tick + 1;
+			break;
+		}
 
-		next = bdi->next;
+		slot = &bdc->reuse_list[bdc->reuse_tick % bdc->reuse_list_size];
+		while ((bdi = bgp_damp_wheel_pop(slot)))
+			bgp_damp_wheel_add_tail(&due, bdi);
+	}
 
-		/* Set t-diff = t-now - t-updated.  */
-		t_diff = t_now - bdi->t_updated;
+	while ((bdi = bgp_damp_wheel_pop(&due))) {
+		bdi->index = -1;
 
-		/* Set figure-of-merit = figure-of-merit * decay-array-ok
-		 * [t-diff] */
-		bdi->penalty = bgp_damp_decay(t_diff, bdi->penalty, bdc);
+		/* Parked at the end of the wheel, or not quite there yet */
+		if (bdi->t_due > t_now) {
+			bgp_reuse_list_add(bdi, bdc);
+			continue;
+		}
 
-		/* Set t-updated = t-now.  */
-		bdi->t_updated = t_now;
+		penalty = bgp_damp_penalty(bdi, bdc, t_now);
 
-		/* if (figure-of-merit < reuse).  */
-		if (bdi->penalty < bdc->reuse_limit) {
-			/* Reuse the route.  */
-			bgp_path_info_unset_flag(bdi->dest, bdi->path,
-						 BGP_PATH_DAMPED);
-			bdi->suppress_time = 0;
-
-			if (bdi->lastrecord == BGP_RECORD_UPDATE) {
-				bgp_path_info_unset_flag(bdi->dest, bdi->path,
-							 BGP_PATH_HISTORY);
-				bgp_aggregate_increment(
-					bgp, bgp_dest_get_prefix(bdi->dest),
-					bdi->path, bdi->afi, bdi->safi);
-				bgp_process(bgp, bdi->dest, bdi->afi,
-					    bdi->safi);
+		if (CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)) {
+			if (penalty >= bdc->reuse_limit) {
+				bdi->t_due = t_now + DELTA_REUSE;
+				bgp_reuse_list_add(bdi, bdc);
+				continue;
 			}
 
-			if (bdi->penalty <= bdc->reuse_limit / 2.0)
-				bgp_damp_info_free(bdi, 1, bdc->afi, bdc->safi);
-			else
-				BGP_DAMP_LIST_ADD(bdc, bdi);
-		} else
-			/* Re-insert into another list (See RFC2439 Section
-			 * 4.8.6).  */
+			bgp_damp_reuse(bdi, bdc);
+		}
+
+		if (penalty <= bdc->reuse_limit / 2.0) {
+			struct bgp *bgp = bdi->path->peer->bgp;
+			struct bgp_dest *dest = bdi->dest;
+			bool history = bdi->lastrecord == BGP_RECORD_WITHDRAW;
+			afi_t afi = bdi->afi;
+			safi_t safi = bdi->safi;
+
+			bgp_damp_info_free(bdi, 1, afi, safi);
+			if (history)
+				bgp_process(bgp, dest, afi, safi);
+		} else {
+			bdi->t_due = bgp_damp_due(bdi, bdc);
+			if (bdi->t_due <= t_now)
+				bdi->t_due = t_now + DELTA_REUSE;
 			bgp_reuse_list_add(bdi, bdc);
+		}
 	}
 
+	bgp_damp_wheel_fini(&due);
+
+	if (bdc->count)
+		thread_add_timer(bm->master, bgp_reuse_timer, bdc,
+				 DELTA_REUSE, &bdc->t_reuse);
+
 	return 0;
 }
 
@@ -189,7 +240,6 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 {
 	time_t t_now;
 	struct bgp_damp_info *bdi = NULL;
-	unsigned int last_penalty = 0;
 	struct bgp_damp_config *bdc = &damp[afi][safi];
 
 	t_now = bgp_clock();
@@ -206,6 +256,8 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		   2. set figure-of-merit = 1.
 		   3. withdraw the route.  */
 
+		bgp_reuse_timer_start(bdc);
+
 		bdi = XCALLOC(MTYPE_BGP_DAMP_INFO,
 			      sizeof(struct bgp_damp_info));
 		bdi->path = path;
@@ -219,13 +271,10 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		bdi->afi = afi;
 		bdi->safi = safi;
 		(bgp_path_info_extra_get(path))->damp_info = bdi;
-		BGP_DAMP_LIST_ADD(bdc, bdi);
+		bdc->count++;
 	} else {
-		last_penalty = bdi->penalty;
-
 		/* 1. Set t-diff = t-now - t-updated.  */
-		bdi->penalty = (bgp_damp_decay(t_now - bdi->t_updated,
-					       bdi->penalty, bdc)
+		bdi->penalty = (bgp_damp_penalty(bdi, bdc, t_now)
 				+ (attr_change ? DEFAULT_PENALTY / 2
 					       : DEFAULT_PENALTY));
 
@@ -243,13 +292,9 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 	/* Make this route as historical status.  */
 	bgp_path_info_set_flag(dest, path, BGP_PATH_HISTORY);
 
-	/* Remove the route from a reuse list if it is on one.  */
+	/* Move the route to the slot its new penalty decays in.  */
 	if (CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)) {
-		/* If decay rate isn't equal to 0, reinsert brn. */
-		if (bdi->penalty != last_penalty && bdi->index >= 0) {
-			bgp_reuse_list_delete(bdi, bdc);
-			bgp_reuse_list_add(bdi, bdc);
-		}
+		bgp_reuse_list_update(bdi, bdc);
 		return BGP_DAMP_SUPPRESSED;
 	}
 
@@ -258,10 +303,11 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 	if (bdi->penalty >= bdc->suppress_value) {
 		bgp_path_info_set_flag(dest, path, BGP_PATH_DAMPED);
 		bdi->suppress_time = t_now;
-		BGP_DAMP_LIST_DEL(bdc, bdi);
-		bgp_reuse_list_add(bdi, bdc);
+		bdc->suppressed++;
 	}
 
+	bgp_reuse_list_update(bdi, bdc);
+
 	return BGP_DAMP_USED;
 }
 
@@ -280,8 +326,7 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 	bgp_path_info_unset_flag(dest, path, BGP_PATH_HISTORY);
 
 	bdi->lastrecord = BGP_RECORD_UPDATE;
-	bdi->penalty =
-		bgp_damp_decay(t_now - bdi->t_updated, bdi->penalty, bdc);
+	bdi->penalty = bgp_damp_penalty(bdi, bdc, t_now);
 
 	if (!CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)
 	    && (bdi->penalty < bdc->suppress_value))
@@ -289,16 +334,16 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 	else if (CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)
 		 && (bdi->penalty < bdc->reuse_limit)) {
 		bgp_path_info_unset_flag(dest, path, BGP_PATH_DAMPED);
-		bgp_reuse_list_delete(bdi, bdc);
-		BGP_DAMP_LIST_ADD(bdc, bdi);
 		bdi->suppress_time = 0;
+		bdc->suppressed--;
 		status = BGP_DAMP_USED;
 	} else
 		status = BGP_DAMP_SUPPRESSED;
 
-	if (bdi->penalty > bdc->reuse_limit / 2.0)
+	if (bdi->penalty > bdc->reuse_limit / 2.0) {
 		bdi->t_updated = t_now;
-	else
+		bgp_reuse_list_update(bdi, bdc);
+	} else
 		bgp_damp_info_free(bdi, 0, afi, safi);
 
 	return status;
@@ -316,10 +361,10 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw, afi_t afi,
 	path = bdi->path;
 	path->extra->damp_info = NULL;
 
+	bgp_reuse_list_delete(bdi, bdc);
+	bdc->count--;
 	if (CHECK_FLAG(path->flags, BGP_PATH_DAMPED))
-		bgp_reuse_list_delete(bdi, bdc);
-	else
-		BGP_DAMP_LIST_DEL(bdc, bdi);
+		bdc->suppressed--;
 
 	bgp_path_info_unset_flag(bdi->dest, path,
 				 BGP_PATH_HISTORY | BGP_PATH_DAMPED);
@@ -333,18 +378,13 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw, afi_t afi,
 static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup,
 				   struct bgp_damp_config *bdc)
 {
-	double reuse_max_ratio;
 	unsigned int i;
-	double j;
 
 	bdc->suppress_value = sup;
 	bdc->half_life = hlife;
 	bdc->reuse_limit = reuse;
 	bdc->max_suppress_time = maxsup;
 
-	/* Initialize params per bgp_damp_config. */
-	bdc->reuse_index_size = REUSE_ARRAY_SIZE;
-
 	bdc->ceiling = (int)(bdc->reuse_limit
 			     * (pow(2, (double)bdc->max_suppress_time
 					       / bdc->half_life)));
@@ -370,29 +410,10 @@ static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup,
 
 	bdc->reuse_list =
 		XCALLOC(MTYPE_BGP_DAMP_ARRAY,
-			bdc->reuse_list_size * sizeof(struct bgp_reuse_node *));
-
-	/* Reuse-array computations */
-	bdc->reuse_index = XCALLOC(MTYPE_BGP_DAMP_ARRAY,
-				   sizeof(int) * bdc->reuse_index_size);
-
-	reuse_max_ratio = (double)bdc->ceiling / bdc->reuse_limit;
-	j = (exp((double)bdc->max_suppress_time / bdc->half_life) * log10(2.0));
-	if (reuse_max_ratio > j && j != 0)
-		reuse_max_ratio = j;
-
-	bdc->scale_factor =
-		(double)bdc->reuse_index_size / (reuse_max_ratio - 1);
-
-	for (i = 0; i < bdc->reuse_index_size; i++) {
-		bdc->reuse_index[i] =
-			(int)(((double)bdc->half_life / DELTA_REUSE)
-			      * log10(1.0
-				      / (bdc->reuse_limit
-					 * (1.0
-					    + ((double)i / bdc->scale_factor))))
-			      / log10(0.5));
-	}
+			bdc->reuse_list_size * sizeof(*bdc->reuse_list));
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		bgp_damp_wheel_init(&bdc->reuse_list[i]);
+	bdc->reuse_tick = bgp_clock() / DELTA_REUSE;
 }
 
 int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
@@ -411,24 +432,22 @@ int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 	SET_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING);
 	bgp_damp_parameter_set(half, reuse, suppress, max, bdc);
 
-	/* Register reuse timer.  */
-	thread_add_timer(bm->master, bgp_reuse_timer, bdc, DELTA_REUSE,
-			 &bdc->t_reuse);
+	/* The reuse timer runs while there is dampening information.  */
 
 	return 0;
 }
 
 static void bgp_damp_config_clean(struct bgp_damp_config *bdc)
 {
+	unsigned int i;
+
 	/* Free decay array */
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->decay_array);
 	bdc->decay_array_size = 0;
 
-	/* Free reuse index array */
-	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->reuse_index);
-	bdc->reuse_index_size = 0;
-
 	/* Free reuse list array. */
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		bgp_damp_wheel_fini(&bdc->reuse_list[i]);
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->reuse_list);
 	bdc->reuse_list_size = 0;
 }
@@ -437,27 +456,12 @@ static void bgp_damp_config_clean(struct bgp_damp_config *bdc)
 void bgp_damp_info_clean(afi_t afi, safi_t safi)
 {
 	unsigned int i;
-	struct bgp_damp_info *bdi, *next;
+	struct bgp_damp_info *bdi;
 	struct bgp_damp_config *bdc = &damp[afi][safi];
 
-	bdc->reuse_offset = 0;
-
-	for (i = 0; i < bdc->reuse_list_size; i++) {
-		if (!bdc->reuse_list[i])
-			continue;
-
-		for (bdi = bdc->reuse_list[i]; bdi; bdi = next) {
-			next = bdi->next;
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		while ((bdi = bgp_damp_wheel_first(&bdc->reuse_list[i])))
 			bgp_damp_info_free(bdi, 1, afi, safi);
-		}
-		bdc->reuse_list[i] = NULL;
-	}
-
-	for (bdi = bdc->no_reuse_list; bdi; bdi = next) {
-		next = bdi->next;
-		bgp_damp_info_free(bdi, 1, afi, safi);
-	}
-	bdc->no_reuse_list = NULL;
 }
 
 int bgp_damp_disable(struct bgp *bgp, afi_t afi, safi_t safi)
@@ -653,9 +657,19 @@ const char *bgp_damp_reuse_time_vty(struct vty *vty, struct bgp_path_info *path,
 				  json);
 }
 
+/* Memory held for dampening in one afi/safi */
+static size_t bgp_damp_memory(struct bgp_damp_config *bdc)
+{
+	return bdc->count * sizeof(struct bgp_damp_info)
+	       + bdc->decay_array_size * sizeof(*bdc->decay_array)
+	       + bdc->reuse_list_size * sizeof(*bdc->reuse_list);
+}
+
 static int bgp_print_dampening_parameters(struct bgp *bgp, struct vty *vty,
 					  afi_t afi, safi_t safi)
 {
+	char memstrbuf[MTYPE_MEMSTR_LEN];
+
 	if (CHECK_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING)) {
 		vty_out(vty, "Half-life time: %lld min\n",
 			(long long)damp[afi][safi].half_life / 60);
@@ -667,6 +681,11 @@ static int bgp_print_dampening_parameters(struct bgp *bgp, struct vty *vty,
 			(long long)damp[afi][safi].max_suppress_time / 60);
 		vty_out(vty, "Max suppress penalty: %u\n",
 			damp[afi][safi].ceiling);
+		vty_out(vty,
+			"Dampening entries: %u (%u suppressed), using %s of memory\n",
+			damp[afi][safi].count, damp[afi][safi].suppressed,
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     bgp_damp_memory(&damp[afi][safi])));
 		vty_out(vty, "\n");
 	} else
 		vty_out(vty, "dampening not enabled for %s\n",
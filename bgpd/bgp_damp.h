@@ -21,16 +21,17 @@
 #ifndef _QUAGGA_BGP_DAMP_H
 #define _QUAGGA_BGP_DAMP_H
 
+#include "typesafe.h"
 #include "bgpd/bgp_table.h"
 
+PREDECL_DLIST(bgp_damp_wheel);
+
 /* Structure maintained on a per-route basis. */
 struct bgp_damp_info {
-	/* Doubly linked list.  This information must be linked to
-	   reuse_list or no_reuse_list.  */
-	struct bgp_damp_info *next;
-	struct bgp_damp_info *prev;
+	/* Entry in the reuse_list slot for t_due. */
+	struct bgp_damp_wheel_item wheel_entry;
 
-	/* Figure-of-merit.  */
+	/* Figure-of-merit as of t_updated; it decays from there. */
 	unsigned int penalty;
 
 	/* Number of flapping.  */
@@ -45,13 +46,18 @@ struct bgp_damp_info {
 	/* Time of route start to be suppressed.  */
 	time_t suppress_time;
 
+	/* When the penalty will have decayed below the reuse limit if
+	 * suppressed, or below half of it otherwise.
+	 */
+	time_t t_due;
+
 	/* Back reference to bgp_path_info. */
 	struct bgp_path_info *path;
 
 	/* Back reference to bgp_node. */
 	struct bgp_dest *dest;
 
-	/* Current index in the reuse_list. */
+	/* Current index in the reuse_list, -1 if not on it. */
 	int index;
 
 	/* Last time message type. */
@@ -63,6 +69,8 @@ struct bgp_damp_info {
 	safi_t safi;
 };
 
+DECLARE_DLIST(bgp_damp_wheel, struct bgp_damp_info, wheel_entry);
+
 /* Specified parameter set configuration. */
 struct bgp_damp_config {
 	/* Value over which routes suppressed.  */
@@ -82,7 +90,6 @@ struct bgp_damp_config {
 	 */
 	time_t tmax; /* Max time previous instability retained */
 	unsigned int reuse_list_size;  /* Number of reuse lists */
-	unsigned int reuse_index_size; /* Size of reuse index array */
 
 	/* Non-configurable parameters.  Most of these are calculated from
 	 * the configurable parameters above.
@@ -90,21 +97,21 @@ struct bgp_damp_config {
 	unsigned int ceiling;		  /* Max value a penalty can attain */
 	unsigned int decay_rate_per_tick; /* Calculated from half-life */
 	unsigned int decay_array_size; /* Calculated using config parameters */
-	double scale_factor;
-	unsigned int reuse_scale_factor;
 
 	/* Decay array per-set based. */
 	double *decay_array;
 
-	/* Reuse index array per-set based. */
-	int *reuse_index;
-
-	/* Reuse list array per-set based. */
-	struct bgp_damp_info **reuse_list;
-	int reuse_offset;
+	/*
+	 * Timing wheel of all dampening information, one slot per
+	 * DELTA_REUSE seconds.  reuse_tick is the next tick (time /
+	 * DELTA_REUSE) the reuse timer will look at.
+	 */
+	struct bgp_damp_wheel_head *reuse_list;
+	time_t reuse_tick;
 
-	/* All dampening information which is not on reuse list.  */
-	struct bgp_damp_info *no_reuse_list;
+	/* Dampening information held, and how much of it is suppressed. */
+	unsigned int count;
+	unsigned int suppressed;
 
 	/* Reuse timer thread per-set base. */
 	struct thread *t_reuse;
@@ -130,7 +137,6 @@ struct bgp_damp_config {
 #define DEFAULT_SUPPRESS 	2000
 
 #define REUSE_LIST_SIZE          256
-#define REUSE_ARRAY_SIZE        1024
 
 extern int bgp_damp_enable(struct bgp *, afi_t, safi_t, time_t, unsigned int,
 			   unsigned int, time_t);
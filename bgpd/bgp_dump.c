@@ -30,6 +30,11 @@
 #include "queue.h"
 #include "memory.h"
 #include "filter.h"
+#include "monotime.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "bgpd/bgp_table.h"
 #include "bgpd/bgpd.h"
@@ -85,8 +90,29 @@ struct bgp_dump {
 	char *interval_str;
 
 	struct thread *t_interval;
+
+#ifdef HAVE_ZLIB
+	/* routes-mrt only, set when the file name ends in ".gz" */
+	gzFile gz;
+#endif
+
+	/* routes-mrt table walk, resumed from routes_pos in chunks */
+	struct thread *t_routes;
+	afi_t routes_afi;
+	unsigned int routes_seq;
+	struct prefix routes_pos;
+	bool routes_has_pos;
+
+	/* progress of the running or last completed routes-mrt dump */
+	struct timeval routes_start;
+	unsigned long routes_prefixes;
+	uint64_t routes_bytes;
+	int64_t routes_usec;
 };
 
+/* Number of table entries dumped before yielding */
+#define BGP_DUMP_ROUTES_CHUNK 1000
+
 static int bgp_dump_unset(struct bgp_dump *bgp_dump);
 static int bgp_dump_interval_func(struct thread *);
 
@@ -102,6 +128,20 @@ struct bgp_dump bgp_dump_updates;
 /* BGP dump structure for 'dump bgp routes' */
 struct bgp_dump bgp_dump_routes;
 
+static void bgp_dump_close_file(struct bgp_dump *bgp_dump)
+{
+#ifdef HAVE_ZLIB
+	if (bgp_dump->gz) {
+		gzclose(bgp_dump->gz);
+		bgp_dump->gz = NULL;
+	}
+#endif
+	if (bgp_dump->fp) {
+		fclose(bgp_dump->fp);
+		bgp_dump->fp = NULL;
+	}
+}
+
 static FILE *bgp_dump_open_file(struct bgp_dump *bgp_dump)
 {
 	int ret;
@@ -126,9 +166,7 @@ static FILE *bgp_dump_open_file(struct bgp_dump *bgp_dump)
 		return NULL;
 	}
 
-	if (bgp_dump->fp)
-		fclose(bgp_dump->fp);
-
+	bgp_dump_close_file(bgp_dump);
 
 	oldumask = umask(0777 & ~LOGFILE_MASK);
 	bgp_dump->fp = fopen(realpath, "w");
@@ -141,6 +179,20 @@ static FILE *bgp_dump_open_file(struct bgp_dump *bgp_dump)
 	}
 	umask(oldumask);
 
+#ifdef HAVE_ZLIB
+	if (bgp_dump->type == BGP_DUMP_ROUTES && ret > 3
+	    && strcmp(realpath + ret - 3, ".gz") == 0) {
+		bgp_dump->gz = gzdopen(dup(fileno(bgp_dump->fp)), "wb");
+		if (bgp_dump->gz == NULL) {
+			flog_warn(EC_BGP_DUMP,
+				  "bgp_dump_open_file: %s: gzdopen failed",
+				  realpath);
+			bgp_dump_close_file(bgp_dump);
+			return NULL;
+		}
+	}
+#endif
+
 	return bgp_dump->fp;
 }
 
@@ -217,6 +269,20 @@ static void bgp_dump_set_size(struct stream *s, int type)
 	stream_putl_at(s, 8, stream_get_endp(s) - BGP_DUMP_HEADER_SIZE);
 }
 
+static void bgp_dump_routes_write(struct stream *obuf)
+{
+	size_t len = stream_get_endp(obuf);
+
+#ifdef HAVE_ZLIB
+	if (bgp_dump_routes.gz)
+		gzwrite(bgp_dump_routes.gz, STREAM_DATA(obuf), len);
+	else
+#endif
+		fwrite(STREAM_DATA(obuf), len, 1, bgp_dump_routes.fp);
+
+	bgp_dump_routes.routes_bytes += len;
+}
+
 static void bgp_dump_routes_index_table(struct bgp *bgp)
 {
 	struct peer *peer;
@@ -296,8 +362,7 @@ static void bgp_dump_routes_index_table(struct bgp *bgp)
 
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
 
-	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
-	fflush(bgp_dump_routes.fp);
+	bgp_dump_routes_write(obuf);
 }
 
 
@@ -355,6 +420,11 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	for (; path; path = path->next) {
 		size_t cur_endp;
 
+		/* Peer came up after the index table was written */
+		if (path->peer != path->peer->bgp->peer_self
+		    && !path->peer->table_dump_index)
+			continue;
+
 		/* Peer index */
 		stream_putw(obuf, path->peer->table_dump_index);
 
@@ -380,49 +450,124 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	stream_putw_at(obuf, sizep, entry_count);
 
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
-	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
+	bgp_dump_routes_write(obuf);
 
 	return path;
 }
 
 
-/* Runs under child process. */
-static unsigned int bgp_dump_routes_func(int afi, int first_run,
-					 unsigned int seq)
+/* Dump up to BGP_DUMP_ROUTES_CHUNK entries of the current AFI's table,
+ * returns true once the table is completed.
+ */
+static bool bgp_dump_routes_chunk(struct bgp *bgp)
 {
+	struct bgp_dump *bgp_dump = &bgp_dump_routes;
 	struct bgp_path_info *path;
 	struct bgp_dest *dest;
-	struct bgp *bgp;
 	struct bgp_table *table;
+	unsigned int count = 0;
 
-	bgp = bgp_get_default();
-	if (!bgp)
-		return seq;
-
-	if (bgp_dump_routes.fp == NULL)
-		return seq;
-
-	/* Note that bgp_dump_routes_index_table will do ipv4 and ipv6 peers,
-	   so this should only be done on the first call to
-	   bgp_dump_routes_func.
-	   ( this function will be called once for ipv4 and once for ipv6 ) */
-	if (first_run)
-		bgp_dump_routes_index_table(bgp);
+	table = bgp->rib[bgp_dump->routes_afi][SAFI_UNICAST];
 
-	/* Walk down each BGP route. */
-	table = bgp->rib[afi][SAFI_UNICAST];
+	if (bgp_dump->routes_has_pos)
+		dest = bgp_table_get_next(table, &bgp_dump->routes_pos);
+	else
+		dest = bgp_table_top(table);
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+	for (; dest; dest = bgp_route_next(dest)) {
 		path = bgp_dest_get_bgp_path_info(dest);
+		if (path)
+			bgp_dump->routes_prefixes++;
 		while (path) {
-			path = bgp_dump_route_node_record(afi, dest, path, seq);
-			seq++;
+			path = bgp_dump_route_node_record(
+				bgp_dump->routes_afi, dest, path,
+				bgp_dump->routes_seq);
+			bgp_dump->routes_seq++;
+		}
+
+		prefix_copy(&bgp_dump->routes_pos, bgp_dest_get_prefix(dest));
+		bgp_dump->routes_has_pos = true;
+
+		if (++count >= BGP_DUMP_ROUTES_CHUNK) {
+			bgp_dest_unlock_node(dest);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void bgp_dump_routes_done(bool completed)
+{
+	struct bgp_dump *bgp_dump = &bgp_dump_routes;
+
+	bgp_dump->routes_usec = monotime_since(&bgp_dump->routes_start, NULL);
+
+	if (completed)
+		zlog_info("%s: dumped %lu prefixes, %" PRIu64
+			  " bytes in %" PRId64 " ms",
+			  __func__, bgp_dump->routes_prefixes,
+			  bgp_dump->routes_bytes,
+			  bgp_dump->routes_usec / 1000);
+
+	/* For a RIB dump there's no point in leaving the file open until
+	 * the next scheduled dump starts.
+	 */
+	bgp_dump_close_file(bgp_dump);
+}
+
+static int bgp_dump_routes_run(struct thread *t)
+{
+	struct bgp_dump *bgp_dump = &bgp_dump_routes;
+	struct bgp *bgp;
+
+	bgp = bgp_get_default();
+	if (!bgp || bgp_dump->fp == NULL) {
+		bgp_dump_routes_done(false);
+		return 0;
+	}
+
+	if (bgp_dump_routes_chunk(bgp)) {
+		if (bgp_dump->routes_afi == AFI_IP6) {
+			bgp_dump_routes_done(true);
+			return 0;
 		}
+		bgp_dump->routes_afi = AFI_IP6;
+		bgp_dump->routes_has_pos = false;
 	}
 
-	fflush(bgp_dump_routes.fp);
+	thread_add_event(bm->master, bgp_dump_routes_run, NULL, 0,
+			 &bgp_dump->t_routes);
+	return 0;
+}
 
-	return seq;
+/* The table is written out in chunks so that large tables don't block
+ * bgpd for the whole dump.  Note that the dump is therefore not an atomic
+ * snapshot;  changes made while it runs may or may not be included.
+ */
+static void bgp_dump_routes_start(void)
+{
+	struct bgp_dump *bgp_dump = &bgp_dump_routes;
+	struct bgp *bgp;
+
+	bgp = bgp_get_default();
+	if (!bgp) {
+		bgp_dump_close_file(bgp_dump);
+		return;
+	}
+
+	monotime(&bgp_dump->routes_start);
+	bgp_dump->routes_prefixes = 0;
+	bgp_dump->routes_bytes = 0;
+	bgp_dump->routes_afi = AFI_IP;
+	bgp_dump->routes_seq = 0;
+	bgp_dump->routes_has_pos = false;
+
+	/* Covers both ipv4 and ipv6 peers, so only done once per dump */
+	bgp_dump_routes_index_table(bgp);
+
+	thread_add_event(bm->master, bgp_dump_routes_run, NULL, 0,
+			 &bgp_dump->t_routes);
 }
 
 static int bgp_dump_interval_func(struct thread *t)
@@ -432,18 +577,15 @@ static int bgp_dump_interval_func(struct thread *t)
 	bgp_dump->t_interval = NULL;
 
 	/* Reschedule dump even if file couldn't be opened this time... */
-	if (bgp_dump_open_file(bgp_dump) != NULL) {
+	if (bgp_dump->type == BGP_DUMP_ROUTES && bgp_dump->t_routes) {
+		flog_warn(EC_BGP_DUMP,
+			  "%s: previous routes dump still running, skipping",
+			  __func__);
+	} else if (bgp_dump_open_file(bgp_dump) != NULL) {
 		/* In case of bgp_dump_routes, we need special route dump
 		 * function. */
-		if (bgp_dump->type == BGP_DUMP_ROUTES) {
-			unsigned int seq = bgp_dump_routes_func(AFI_IP, 1, 0);
-			bgp_dump_routes_func(AFI_IP6, 0, seq);
-			/* Close the file now. For a RIB dump there's no point
-			 * in leaving
-			 * it open until the next scheduled dump starts. */
-			fclose(bgp_dump->fp);
-			bgp_dump->fp = NULL;
-		}
+		if (bgp_dump->type == BGP_DUMP_ROUTES)
+			bgp_dump_routes_start();
 	}
 
 	/* if interval is set reschedule */
@@ -547,14 +689,16 @@ static void bgp_dump_packet_func(struct bgp_dump *bgp_dump, struct peer *peer,
 	}
 	bgp_dump_common(obuf, peer, 0);
 
-	/* Packet contents. */
-	stream_put(obuf, STREAM_DATA(packet), stream_get_endp(packet));
+	/* Set length, including the packet written right after. */
+	stream_putl_at(obuf, 8,
+		       stream_get_endp(obuf) + stream_get_endp(packet)
+			       - BGP_DUMP_HEADER_SIZE);
 
-	/* Set length. */
-	bgp_dump_set_size(obuf, MSG_PROTOCOL_BGP4MP);
-
-	/* Write to the stream. */
+	/* Write to the stream; packet contents straight from the packet
+	 * rather than copying them into obuf first.
+	 */
 	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump->fp);
+	fwrite(STREAM_DATA(packet), stream_get_endp(packet), 1, bgp_dump->fp);
 	fflush(bgp_dump->fp);
 }
 
@@ -672,13 +816,11 @@ static int bgp_dump_unset(struct bgp_dump *bgp_dump)
 	XFREE(MTYPE_BGP_DUMP_STR, bgp_dump->filename);
 
 	/* Closing file. */
-	if (bgp_dump->fp) {
-		fclose(bgp_dump->fp);
-		bgp_dump->fp = NULL;
-	}
+	bgp_dump_close_file(bgp_dump);
 
 	/* Removing interval event. */
 	thread_cancel(&bgp_dump->t_interval);
+	thread_cancel(&bgp_dump->t_routes);
 
 	bgp_dump->interval = 0;
 
@@ -775,6 +917,58 @@ DEFUN (no_dump_bgp_all,
 	return bgp_dump_unset(bgp_dump_struct);
 }
 
+static void bgp_dump_show_one(struct vty *vty, struct bgp_dump *bgp_dump,
+			      const char *type_str)
+{
+	if (!bgp_dump->filename)
+		return;
+
+	vty_out(vty, "%s: %s", type_str, bgp_dump->filename);
+	if (bgp_dump->interval_str)
+		vty_out(vty, ", interval %s", bgp_dump->interval_str);
+	vty_out(vty, "\n");
+}
+
+DEFUN (show_dump_bgp,
+       show_dump_bgp_cmd,
+       "show dump bgp",
+       SHOW_STR
+       "Dump packet\n"
+       "BGP packet dump\n")
+{
+	struct bgp_dump *bgp_dump = &bgp_dump_routes;
+	int64_t usec;
+
+	bgp_dump_show_one(vty, &bgp_dump_all,
+			  bgp_dump_all.type == BGP_DUMP_ALL_ET ? "all-et"
+							       : "all");
+	bgp_dump_show_one(vty, &bgp_dump_updates,
+			  bgp_dump_updates.type == BGP_DUMP_UPDATES_ET
+				  ? "updates-et"
+				  : "updates");
+	bgp_dump_show_one(vty, bgp_dump, "routes-mrt");
+
+	if (bgp_dump->t_routes) {
+		usec = monotime_since(&bgp_dump->routes_start, NULL);
+		vty_out(vty,
+			"  In progress (%s): %lu prefixes, %" PRIu64
+			" bytes, %" PRId64 " ms elapsed\n",
+			afi2str(bgp_dump->routes_afi),
+			bgp_dump->routes_prefixes, bgp_dump->routes_bytes,
+			usec / 1000);
+	} else if (bgp_dump->routes_start.tv_sec) {
+		usec = MAX(bgp_dump->routes_usec, 1);
+		vty_out(vty,
+			"  Last dump: %lu prefixes, %" PRIu64
+			" bytes in %" PRId64 " ms (%" PRIu64 " KB/s)\n",
+			bgp_dump->routes_prefixes, bgp_dump->routes_bytes,
+			usec / 1000,
+			bgp_dump->routes_bytes * 1000 / (uint64_t)usec);
+	}
+
+	return CMD_SUCCESS;
+}
+
 static int config_write_bgp_dump(struct vty *vty);
 /* BGP node structure. */
 static struct cmd_node bgp_dump_node = {
@@ -839,6 +1033,7 @@ void bgp_dump_init(void)
 
 	install_element(CONFIG_NODE, &dump_bgp_all_cmd);
 	install_element(CONFIG_NODE, &no_dump_bgp_all_cmd);
+	install_element(VIEW_NODE, &show_dump_bgp_cmd);
 
 	hook_register(bgp_packet_dump, bgp_dump_packet);
 	hook_register(peer_status_changed, bgp_dump_state);
@@ -33,6 +33,7 @@
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_flowspec_private.h"
@@ -45,7 +46,7 @@ union traffic_rate {
 };
 
 /* Hash of community attribute. */
-static struct hash *ecomhash;
+static struct bgp_intern ecomhash;
 
 /* Allocate a new ecommunities.  */
 struct ecommunity *ecommunity_new(void)
@@ -71,6 +72,7 @@ void ecommunity_free(struct ecommunity **ecom)
 
 	XFREE(MTYPE_ECOMMUNITY_VAL, (*ecom)->val);
 	XFREE(MTYPE_ECOMMUNITY_STR, (*ecom)->str);
+	XFREE(MTYPE_COMMUNITY_LIST_MEMO, (*ecom)->clist_memo);
 	XFREE(MTYPE_ECOMMUNITY, *ecom);
 }
 
@@ -307,17 +309,27 @@ struct ecommunity *ecommunity_merge(struct ecommunity *ecom1,
 struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 {
 	struct ecommunity *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
 	assert(ecom->refcnt == 0);
-	find = (struct ecommunity *)hash_get(ecomhash, ecom, hash_alloc_intern);
-	if (find != ecom)
-		ecommunity_free(&ecom);
 
-	find->refcnt++;
+	/* Hash once, for the stripe, the lookup and the release */
+	ecom->hash = ecommunity_hash_make(ecom);
 
-	if (!find->str)
-		find->str =
-			ecommunity_ecom2str(find, ECOMMUNITY_FORMAT_DISPLAY, 0);
+	key = bgp_intern_key(&ecomhash, ecom);
+	st = bgp_intern_stripe(&ecomhash, key);
+	frr_with_mutex (&st->mtx) {
+		find = (struct ecommunity *)hash_get_with_key(
+			st->hash, ecom, key, hash_alloc_intern);
+		bgp_intern_ref(&find->refcnt);
+
+		if (!find->str)
+			find->str = ecommunity_ecom2str(
+				find, ECOMMUNITY_FORMAT_DISPLAY, 0);
+	}
+	if (find != ecom)
+		ecommunity_free(&ecom);
 
 	return find;
 }
@@ -325,22 +337,12 @@ struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 /* Unintern Extended Communities Attribute.  */
 void ecommunity_unintern(struct ecommunity **ecom)
 {
-	struct ecommunity *ret;
-
 	if (!*ecom)
 		return;
 
-	if ((*ecom)->refcnt)
-		(*ecom)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*ecom)->refcnt == 0) {
-		/* Extended community must be in the hash.  */
-		ret = (struct ecommunity *)hash_release(ecomhash, *ecom);
-		assert(ret != NULL);
-
+	/* Pull off from hash on the last reference.  */
+	if (bgp_intern_release(&ecomhash, *ecom, &(*ecom)->refcnt))
 		ecommunity_free(ecom);
-	}
 }
 
 /* Utinity function to make hash key.  */
@@ -349,6 +351,9 @@ unsigned int ecommunity_hash_make(const void *arg)
 	const struct ecommunity *ecom = arg;
 	int size = ecom->size * ecom->unit_size;
 
+	if (ecom->hash)
+		return ecom->hash;
+
 	return jhash(ecom->val, size, 0x564321ab);
 }
 
@@ -367,6 +372,10 @@ bool ecommunity_cmp(const void *arg1, const void *arg2)
 	if (ecom1->unit_size != ecom2->unit_size)
 		return false;
 
+	/* Differing hash keys settle it without looking at the values */
+	if (ecom1->hash && ecom2->hash && ecom1->hash != ecom2->hash)
+		return false;
+
 	return (ecom1->size == ecom2->size
 		&& memcmp(ecom1->val, ecom2->val, ecom1->size *
 			  ecom1->unit_size) == 0);
@@ -375,15 +384,15 @@ bool ecommunity_cmp(const void *arg1, const void *arg2)
 /* Initialize Extended Comminities related hash. */
 void ecommunity_init(void)
 {
-	ecomhash = hash_create(ecommunity_hash_make, ecommunity_cmp,
-			       "BGP ecommunity hash");
+	bgp_intern_init(&ecomhash, hash_create_size, HASH_INITIAL_SIZE,
+			ecommunity_hash_make, ecommunity_cmp,
+			"BGP ecommunity hash");
 }
 
 void ecommunity_finish(void)
 {
-	hash_clean(ecomhash, (void (*)(void *))ecommunity_hash_free);
-	hash_free(ecomhash);
-	ecomhash = NULL;
+	bgp_intern_finish(&ecomhash,
+			  (void (*)(void *))ecommunity_hash_free);
 }
 
 /* Extended Communities token enum. */
@@ -1396,8 +1405,29 @@ void bgp_aggr_ecommunity_remove(void *arg)
 void bgp_compute_aggregate_ecommunity(struct bgp_aggregate *aggregate,
 				      struct ecommunity *ecommunity)
 {
+	struct ecommunity *aggr_ecommunity;
+	struct ecommunity *ecommerge;
+
+	if ((aggregate == NULL) || (ecommunity == NULL))
+		return;
+
 	bgp_compute_aggregate_ecommunity_hash(aggregate, ecommunity);
-	bgp_compute_aggregate_ecommunity_val(aggregate);
+
+	/* Only an ecommunity not seen before among the aggregated routes
+	 * changes the union; merge just that one in.
+	 */
+	aggr_ecommunity = bgp_aggr_ecommunity_lookup(aggregate, ecommunity);
+	if (!aggr_ecommunity || aggr_ecommunity->refcnt > 1)
+		return;
+
+	if (!aggregate->ecommunity) {
+		bgp_compute_aggregate_ecommunity_val(aggregate);
+		return;
+	}
+
+	ecommerge = ecommunity_merge(aggregate->ecommunity, aggr_ecommunity);
+	aggregate->ecommunity = ecommunity_uniq_sort(ecommerge);
+	ecommunity_free(&ecommerge);
 }
 
 
@@ -106,7 +106,7 @@
 /* Extended Communities attribute.  */
 struct ecommunity {
 	/* Reference counter.  */
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 
 	/* Size of Each Unit of Extended Communities attribute.
 	 * to differentiate between IPv6 ext comm and ext comm
@@ -116,11 +116,17 @@ struct ecommunity {
 	/* Size of Extended Communities attribute.  */
 	int size;
 
+	/* Hash key, set once interned; 0 means not computed. */
+	uint32_t hash;
+
 	/* Extended Communities value.  */
 	uint8_t *val;
 
 	/* Human readable format string.  */
 	char *str;
+
+	/* community-list results, only for interned values */
+	struct community_list_memo *clist_memo;
 };
 
 struct ecommunity_as {
@@ -70,12 +70,31 @@ static void bgp_evpn_update_type2_route_entry(struct bgp *bgp,
 					      struct bgp_dest *dest,
 					      struct bgp_path_info *local_pi,
 					      const char *caller);
+static void bgp_evpn_macip_pending_flush(struct bgp *bgp,
+					 struct bgpevpn *vpn);
+static void bgp_evpn_import_mark(struct bgp *bgp, struct bgpevpn *vpn);
+static void bgp_evpn_import_unmark(struct bgp *bgp, struct bgpevpn *vpn);
+static void bgp_evpn_import_run(struct bgp *bgp, int install);
 static struct in_addr zero_vtep_ip;
 
 /*
  * Private functions.
  */
 
+static int bgp_evpn_macip_hash_cmp(const struct bgp_evpn_macip *a,
+				   const struct bgp_evpn_macip *b)
+{
+	return prefix_cmp(&a->p, &b->p);
+}
+
+static uint32_t bgp_evpn_macip_hash_key(const struct bgp_evpn_macip *m)
+{
+	return prefix_hash_key(&m->p);
+}
+
+DECLARE_HASH(bgp_evpn_macip_hash, struct bgp_evpn_macip, hash_item,
+	     bgp_evpn_macip_hash_cmp, bgp_evpn_macip_hash_key)
+
 /*
  * Make vni hash key.
  */
@@ -468,7 +487,9 @@ static void bgp_evpn_get_rmac_nexthop(struct bgpevpn *vpn,
 {
 	struct bgp *bgp_vrf = vpn->bgp_vrf;
 
-	memset(&attr->rmac, 0, sizeof(struct ethaddr));
+	if (!is_zero_mac(&bgp_attr_get_evpn(attr)->rmac))
+		memset(&bgp_attr_evpn_modify(attr)->rmac, 0,
+		       sizeof(struct ethaddr));
 	if (!bgp_vrf)
 		return;
 
@@ -486,13 +507,14 @@ static void bgp_evpn_get_rmac_nexthop(struct bgpevpn *vpn,
 	    && bgp_vrf->evpn_info->advertise_pip &&
 	    bgp_vrf->evpn_info->is_anycast_mac) {
 		/* copy sys rmac */
-		memcpy(&attr->rmac, &bgp_vrf->evpn_info->pip_rmac,
-		       ETH_ALEN);
+		memcpy(&bgp_attr_evpn_modify(attr)->rmac,
+		       &bgp_vrf->evpn_info->pip_rmac, ETH_ALEN);
 		attr->nexthop = bgp_vrf->evpn_info->pip_ip;
 		attr->mp_nexthop_global_in =
 			bgp_vrf->evpn_info->pip_ip;
 	} else
-		memcpy(&attr->rmac, &bgp_vrf->rmac, ETH_ALEN);
+		memcpy(&bgp_attr_evpn_modify(attr)->rmac, &bgp_vrf->rmac,
+		       ETH_ALEN);
 }
 
 /*
@@ -751,8 +773,8 @@ static void build_evpn_type5_route_extcomm(struct bgp *bgp_vrf,
 			ecommunity_merge(attr->ecommunity, ecom);
 
 	/* add the router mac extended community */
-	if (!is_zero_mac(&attr->rmac)) {
-		encode_rmac_extcomm(&eval_rmac, &attr->rmac);
+	if (!is_zero_mac(&bgp_attr_get_evpn(attr)->rmac)) {
+		encode_rmac_extcomm(&eval_rmac, &bgp_attr_get_evpn(attr)->rmac);
 		ecommunity_add_val(attr->ecommunity, &eval_rmac, true, true);
 	}
 
@@ -818,7 +840,7 @@ static void build_evpn_route_extcomm(struct bgpevpn *vpn, struct attr *attr,
 	}
 
 	/* Add MAC mobility (sticky) if needed. */
-	if (attr->sticky) {
+	if (bgp_attr_get_evpn(attr)->sticky) {
 		seqnum = 0;
 		memset(&ecom_sticky, 0, sizeof(ecom_sticky));
 		encode_mac_mobility_extcomm(1, seqnum, &eval_sticky);
@@ -831,12 +853,12 @@ static void build_evpn_route_extcomm(struct bgpevpn *vpn, struct attr *attr,
 
 	/* Add RMAC, if told to. */
 	if (add_l3_ecomm) {
-		encode_rmac_extcomm(&eval_rmac, &attr->rmac);
+		encode_rmac_extcomm(&eval_rmac, &bgp_attr_get_evpn(attr)->rmac);
 		ecommunity_add_val(attr->ecommunity, &eval_rmac, true, true);
 	}
 
 	/* Add default gateway, if needed. */
-	if (attr->default_gw) {
+	if (bgp_attr_get_evpn(attr)->default_gw) {
 		memset(&ecom_default_gw, 0, sizeof(ecom_default_gw));
 		encode_default_gw_extcomm(&eval_default_gw);
 		ecom_default_gw.size = 1;
@@ -846,10 +868,12 @@ static void build_evpn_route_extcomm(struct bgpevpn *vpn, struct attr *attr,
 			ecommunity_merge(attr->ecommunity, &ecom_default_gw);
 	}
 
-	proxy = !!(attr->es_flags & ATTR_ES_PROXY_ADVERT);
-	if (attr->router_flag || proxy) {
+	proxy = !!(bgp_attr_get_evpn(attr)->es_flags & ATTR_ES_PROXY_ADVERT);
+	if (bgp_attr_get_evpn(attr)->router_flag || proxy) {
 		memset(&ecom_na, 0, sizeof(ecom_na));
-		encode_na_flag_extcomm(&eval_na, attr->router_flag, proxy);
+		encode_na_flag_extcomm(&eval_na,
+				       bgp_attr_get_evpn(attr)->router_flag,
+				       proxy);
 		ecom_na.size = 1;
 		ecom_na.unit_size = ECOMMUNITY_SIZE;
 		ecom_na.val = (uint8_t *)eval_na.val;
@@ -931,12 +955,12 @@ static int evpn_zebra_install(struct bgp *bgp, struct bgpevpn *vpn,
 		flags = 0;
 
 		if (pi->sub_type == BGP_ROUTE_IMPORTED) {
-			if (pi->attr->sticky)
+			if (bgp_attr_get_evpn(pi->attr)->sticky)
 				SET_FLAG(flags, ZEBRA_MACIP_TYPE_STICKY);
-			if (pi->attr->default_gw)
+			if (bgp_attr_get_evpn(pi->attr)->default_gw)
 				SET_FLAG(flags, ZEBRA_MACIP_TYPE_GW);
-			if (is_evpn_prefix_ipaddr_v6(p) &&
-					pi->attr->router_flag)
+			if (is_evpn_prefix_ipaddr_v6(p)
+			    && bgp_attr_get_evpn(pi->attr)->router_flag)
 				SET_FLAG(flags, ZEBRA_MACIP_TYPE_ROUTER_FLAG);
 
 			seq = mac_mobility_seqnum(pi->attr);
@@ -964,12 +988,13 @@ static int evpn_zebra_install(struct bgp *bgp, struct bgpevpn *vpn,
 			 * flag set install the local entry as a router entry
 			 */
 			if (is_evpn_prefix_ipaddr_v6(p) &&
-					(pi->attr->es_flags &
+					(bgp_attr_get_evpn(pi->attr)->es_flags &
 					 ATTR_ES_PEER_ROUTER))
 				SET_FLAG(flags,
 						ZEBRA_MACIP_TYPE_ROUTER_FLAG);
 
-			if (!(pi->attr->es_flags & ATTR_ES_PEER_ACTIVE))
+			if (!(bgp_attr_get_evpn(pi->attr)->es_flags
+			      & ATTR_ES_PEER_ACTIVE))
 				SET_FLAG(flags,
 						ZEBRA_MACIP_TYPE_PROXY_ADVERT);
 		}
@@ -1040,9 +1065,10 @@ static void evpn_delete_old_local_route(struct bgp *bgp, struct bgpevpn *vpn,
 			(struct prefix_evpn *)bgp_dest_get_prefix(dest);
 
 		zlog_debug("local path deleted %pFX es %s; new-path-es %s", evp,
-			   esi_to_str(&old_local->attr->esi, esi_buf,
-				      sizeof(esi_buf)),
-			   new_select ? esi_to_str(&new_select->attr->esi,
+			   esi_to_str(bgp_evpn_attr_get_esi(old_local->attr),
+				      esi_buf, sizeof(esi_buf)),
+			   new_select ? esi_to_str(
+						bgp_evpn_attr_get_esi(new_select->attr),
 						   esi_buf2, sizeof(esi_buf2))
 				      : "");
 	}
@@ -1303,10 +1329,12 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 	    (!bgp_vrf->evpn_info->is_anycast_mac)) {
 		attr.nexthop = bgp_vrf->originator_ip;
 		attr.mp_nexthop_global_in = bgp_vrf->originator_ip;
-		memcpy(&attr.rmac, &bgp_vrf->rmac, ETH_ALEN);
+		memcpy(&bgp_attr_evpn_modify(&attr)->rmac, &bgp_vrf->rmac,
+		       ETH_ALEN);
 	} else {
 		/* copy sys rmac */
-		memcpy(&attr.rmac, &bgp_vrf->evpn_info->pip_rmac, ETH_ALEN);
+		memcpy(&bgp_attr_evpn_modify(&attr)->rmac,
+		       &bgp_vrf->evpn_info->pip_rmac, ETH_ALEN);
 		if (bgp_vrf->evpn_info->pip_ip.s_addr != INADDR_ANY) {
 			attr.nexthop = bgp_vrf->evpn_info->pip_ip;
 			attr.mp_nexthop_global_in = bgp_vrf->evpn_info->pip_ip;
@@ -1323,7 +1351,8 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 
 		zlog_debug("VRF %s type-5 route evp %pFX RMAC %s nexthop %s",
 			   vrf_id_to_name(bgp_vrf->vrf_id), evp,
-			   prefix_mac2str(&attr.rmac, buf, sizeof(buf)),
+			   prefix_mac2str(&bgp_attr_get_evpn(&attr)->rmac, buf,
+					  sizeof(buf)),
 			   inet_ntop(AF_INET, &attr.nexthop, buf2,
 				     INET_ADDRSTRLEN));
 	}
@@ -1393,14 +1422,14 @@ static void bgp_evpn_get_sync_info(struct bgp *bgp, esi_t *esi,
 			return;
 
 		/* we have a non-proxy path from the ES peer.  */
-		if (second_best_path->attr->es_flags &
+		if (bgp_attr_get_evpn(second_best_path->attr)->es_flags &
 					ATTR_ES_PROXY_ADVERT) {
 			*proxy_from_peer = true;
 		} else {
 			*active_on_peer = true;
 		}
 
-		if (second_best_path->attr->router_flag)
+		if (bgp_attr_get_evpn(second_best_path->attr)->router_flag)
 			*peer_router = true;
 
 		/* we use both proxy and non-proxy imports to
@@ -1422,6 +1451,7 @@ static void update_evpn_route_entry_sync_info(struct bgp *bgp,
 					      uint32_t loc_seq, bool setup_sync)
 {
 	esi_t *esi;
+	struct bgp_attr_evpn *evpn;
 	struct prefix_evpn *evp =
 		(struct prefix_evpn *)bgp_dest_get_prefix(dest);
 
@@ -1439,19 +1469,20 @@ static void update_evpn_route_entry_sync_info(struct bgp *bgp,
 			bgp_evpn_get_sync_info(bgp, esi, dest, loc_seq,
 					       &max_sync_seq, &active_on_peer,
 					       &peer_router, &proxy_from_peer);
-			attr->mm_sync_seqnum = max_sync_seq;
+			evpn = bgp_attr_evpn_modify(attr);
+			evpn->mm_sync_seqnum = max_sync_seq;
 			if (active_on_peer)
-				attr->es_flags |= ATTR_ES_PEER_ACTIVE;
+				evpn->es_flags |= ATTR_ES_PEER_ACTIVE;
 			else
-				attr->es_flags &= ~ATTR_ES_PEER_ACTIVE;
+				evpn->es_flags &= ~ATTR_ES_PEER_ACTIVE;
 			if (proxy_from_peer)
-				attr->es_flags |= ATTR_ES_PEER_PROXY;
+				evpn->es_flags |= ATTR_ES_PEER_PROXY;
 			else
-				attr->es_flags &= ~ATTR_ES_PEER_PROXY;
+				evpn->es_flags &= ~ATTR_ES_PEER_PROXY;
 			if (peer_router)
-				attr->es_flags |= ATTR_ES_PEER_ROUTER;
+				evpn->es_flags |= ATTR_ES_PEER_ROUTER;
 			else
-				attr->es_flags &= ~ATTR_ES_PEER_ROUTER;
+				evpn->es_flags &= ~ATTR_ES_PEER_ROUTER;
 
 			if (BGP_DEBUG(evpn_mh, EVPN_MH_RT)) {
 				char esi_buf[ESI_STR_LEN];
@@ -1462,21 +1493,24 @@ static void update_evpn_route_entry_sync_info(struct bgp *bgp,
 					esi_to_str(esi, esi_buf,
 						   sizeof(esi_buf)),
 					max_sync_seq,
-					(attr->es_flags & ATTR_ES_PEER_ACTIVE)
+					(evpn->es_flags & ATTR_ES_PEER_ACTIVE)
 						? "peer-active "
 						: "",
-					(attr->es_flags & ATTR_ES_PEER_PROXY)
+					(evpn->es_flags & ATTR_ES_PEER_PROXY)
 						? "peer-proxy "
 						: "",
-					(attr->es_flags & ATTR_ES_PEER_ROUTER)
+					(evpn->es_flags & ATTR_ES_PEER_ROUTER)
 						? "peer-router "
 						: "");
 			}
 		}
-	} else {
-		attr->mm_sync_seqnum = 0;
-		attr->es_flags &= ~ATTR_ES_PEER_ACTIVE;
-		attr->es_flags &= ~ATTR_ES_PEER_PROXY;
+	} else if (bgp_attr_get_evpn(attr)->mm_sync_seqnum
+		   || (bgp_attr_get_evpn(attr)->es_flags
+		       & (ATTR_ES_PEER_ACTIVE | ATTR_ES_PEER_PROXY))) {
+		evpn = bgp_attr_evpn_modify(attr);
+		evpn->mm_sync_seqnum = 0;
+		evpn->es_flags &= ~ATTR_ES_PEER_ACTIVE;
+		evpn->es_flags &= ~ATTR_ES_PEER_PROXY;
 	}
 }
 
@@ -1498,6 +1532,7 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	uint32_t num_labels = 1;
 	int route_change = 1;
 	uint8_t sticky = 0;
+	uint32_t mm_seqnum;
 	const struct prefix_evpn *evp;
 
 	*pi = NULL;
@@ -1526,15 +1561,20 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	if (seq && !CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_GW))
 		add_mac_mobility_to_attr(seq, attr);
 
+	/* Extract MAC mobility sequence number, if any. */
+	mm_seqnum = bgp_attr_mac_mobility_seqnum(attr, &sticky);
+	if (mm_seqnum != bgp_attr_get_evpn(attr)->mm_seqnum
+	    || sticky != bgp_attr_get_evpn(attr)->sticky) {
+		struct bgp_attr_evpn *evpn = bgp_attr_evpn_modify(attr);
+
+		evpn->mm_seqnum = mm_seqnum;
+		evpn->sticky = sticky;
+	}
+
 	if (!local_pi) {
 		/* Add (or update) attribute to hash. */
 		attr_new = bgp_attr_intern(attr);
 
-		/* Extract MAC mobility sequence number, if any. */
-		attr_new->mm_seqnum =
-			bgp_attr_mac_mobility_seqnum(attr_new, &sticky);
-		attr_new->sticky = sticky;
-
 		/* Create new route with its attribute. */
 		tmp_pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_STATIC, 0,
 				   bgp->peer_self, attr_new, dest);
@@ -1596,11 +1636,6 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 			bgp_path_info_set_flag(dest, tmp_pi,
 					       BGP_PATH_ATTR_CHANGED);
 
-			/* Extract MAC mobility sequence number, if any. */
-			attr_new->mm_seqnum =
-				bgp_attr_mac_mobility_seqnum(attr_new, &sticky);
-			attr_new->sticky = sticky;
-
 			/* Restore route, if needed. */
 			if (CHECK_FLAG(tmp_pi->flags, BGP_PATH_REMOVED))
 				bgp_path_info_restore(dest, tmp_pi);
@@ -1690,6 +1725,7 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 	struct bgp_dest *dest;
 	struct attr attr;
 	struct attr *attr_new;
+	struct bgp_attr_evpn *evpn;
 	int add_l3_ecomm = 0;
 	struct bgp_path_info *pi;
 	afi_t afi = AFI_L2VPN;
@@ -1704,16 +1740,17 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 	attr.nexthop = vpn->originator_ip;
 	attr.mp_nexthop_global_in = vpn->originator_ip;
 	attr.mp_nexthop_len = BGP_ATTR_NHLEN_IPV4;
-	attr.sticky = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_STICKY) ? 1 : 0;
-	attr.default_gw = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_GW) ? 1 : 0;
-	attr.router_flag = CHECK_FLAG(flags,
+	evpn = bgp_attr_evpn_modify(&attr);
+	evpn->sticky = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_STICKY) ? 1 : 0;
+	evpn->default_gw = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_GW) ? 1 : 0;
+	evpn->router_flag = CHECK_FLAG(flags,
 				      ZEBRA_MACIP_TYPE_ROUTER_FLAG) ? 1 : 0;
 	if (CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_PROXY_ADVERT))
-		attr.es_flags |= ATTR_ES_PROXY_ADVERT;
+		evpn->es_flags |= ATTR_ES_PROXY_ADVERT;
 
 	if (esi && bgp_evpn_is_esi_valid(esi)) {
-		memcpy(&attr.esi, esi, sizeof(esi_t));
-		attr.es_flags |= ATTR_ES_IS_LOCAL;
+		memcpy(&evpn->esi, esi, sizeof(esi_t));
+		evpn->es_flags |= ATTR_ES_IS_LOCAL;
 	}
 
 	/* PMSI is only needed for type-3 routes */
@@ -1731,7 +1768,8 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 			vpn->bgp_vrf ? vrf_id_to_name(vpn->bgp_vrf->vrf_id)
 				     : " ",
 			vpn->vni, p,
-			prefix_mac2str(&attr.rmac, buf, sizeof(buf)),
+			prefix_mac2str(&bgp_attr_get_evpn(&attr)->rmac, buf,
+				       sizeof(buf)),
 			&attr.mp_nexthop_global_in,
 			esi_to_str(esi, buf3, sizeof(buf3)));
 	}
@@ -1960,6 +1998,8 @@ static void bgp_evpn_update_type2_route_entry(struct bgp *bgp,
 	struct bgp_path_info *global_pi;
 	struct prefix_evpn *evp =
 		(struct prefix_evpn *)bgp_dest_get_prefix(dest);
+	const struct bgp_attr_evpn *local_evpn;
+	struct bgp_attr_evpn *evpn;
 	int route_change;
 	bool old_is_sync = false;
 
@@ -1975,15 +2015,17 @@ static void bgp_evpn_update_type2_route_entry(struct bgp *bgp,
 	attr.nexthop = vpn->originator_ip;
 	attr.mp_nexthop_global_in = vpn->originator_ip;
 	attr.mp_nexthop_len = BGP_ATTR_NHLEN_IPV4;
-	attr.sticky = (local_pi->attr->sticky) ? 1 : 0;
-	attr.router_flag = (local_pi->attr->router_flag) ? 1 : 0;
-	attr.es_flags = local_pi->attr->es_flags;
-	if (local_pi->attr->default_gw) {
-		attr.default_gw = 1;
+	local_evpn = bgp_attr_get_evpn(local_pi->attr);
+	evpn = bgp_attr_evpn_modify(&attr);
+	evpn->sticky = (local_evpn->sticky) ? 1 : 0;
+	evpn->router_flag = (local_evpn->router_flag) ? 1 : 0;
+	evpn->es_flags = local_evpn->es_flags;
+	if (local_evpn->default_gw) {
+		evpn->default_gw = 1;
 		if (is_evpn_prefix_ipaddr_v6(evp))
-			attr.router_flag = 1;
+			evpn->router_flag = 1;
 	}
-	memcpy(&attr.esi, &local_pi->attr->esi, sizeof(esi_t));
+	memcpy(&evpn->esi, &local_evpn->esi, sizeof(esi_t));
 	bgp_evpn_get_rmac_nexthop(vpn, evp, &attr,
 			local_pi->extra->af_flags);
 	vni2label(vpn->vni, &(attr.label));
@@ -2010,10 +2052,10 @@ static void bgp_evpn_update_type2_route_entry(struct bgp *bgp,
 			vpn->bgp_vrf ? vrf_id_to_name(vpn->bgp_vrf->vrf_id)
 				     : " ",
 			vpn->vni, evp,
-			prefix_mac2str(&attr.rmac, buf, sizeof(buf)),
+			prefix_mac2str(&evpn->rmac, buf, sizeof(buf)),
 			&attr.mp_nexthop_global_in,
-			esi_to_str(&attr.esi, buf3, sizeof(buf3)),
-			attr.es_flags, caller);
+			esi_to_str(&evpn->esi, buf3, sizeof(buf3)),
+			evpn->es_flags, caller);
 	}
 
 	/* Update the route entry. */
@@ -2848,7 +2890,8 @@ static int bgp_evpn_route_rmac_self_check(struct bgp *bgp_vrf,
 	 * SVI comes up with MAC and stored in hash, triggers
 	 * bgp_mac_rescan_all_evpn_tables.
 	 */
-	if (memcmp(&bgp_vrf->rmac, &pi->attr->rmac, ETH_ALEN) == 0) {
+	if (memcmp(&bgp_vrf->rmac, &bgp_attr_get_evpn(pi->attr)->rmac, ETH_ALEN)
+	    == 0) {
 		if (bgp_debug_update(pi->peer, NULL, NULL, 1)) {
 			char attr_str[BUFSIZ] = {0};
 
@@ -3127,6 +3170,126 @@ static int install_routes_for_vni(struct bgp *bgp, struct bgpevpn *vpn)
 						1);
 }
 
+/*
+ * Install or uninstall a route in those VNIs on the RT's list that are
+ * marked for the current batch.
+ */
+static void install_uninstall_route_in_marked_vnis(struct bgp *bgp,
+						   const struct prefix_evpn *evp,
+						   struct bgp_path_info *pi,
+						   struct list *vnis,
+						   int install)
+{
+	struct bgpevpn *vpn;
+	struct listnode *node, *nnode;
+	int ret;
+
+	for (ALL_LIST_ELEMENTS(vnis, node, nnode, vpn)) {
+		if (!CHECK_FLAG(vpn->flags, VNI_FLAG_IMPORT_PENDING)
+		    || !is_vni_live(vpn))
+			continue;
+
+		if (install)
+			ret = install_evpn_route_entry(bgp, vpn, evp, pi);
+		else
+			ret = uninstall_evpn_route_entry(bgp, vpn, evp, pi);
+
+		if (ret)
+			flog_err(EC_BGP_EVPN_FAIL,
+				 "%u: Failed to %s EVPN route %pFX in VNI %u",
+				 bgp->vrf_id, install ? "install" : "uninstall",
+				 evp, vpn->vni);
+	}
+}
+
+/*
+ * Same as install_uninstall_routes_for_vni(), but for all VNIs marked
+ * VNI_FLAG_IMPORT_PENDING at once.  Rather than checking every route
+ * against every VNI, each route's RTs are looked up in the import RT hash
+ * to find the VNIs it goes into, so the cost doesn't depend on the number
+ * of VNIs in the batch.
+ */
+static void install_uninstall_routes_for_vnis(struct bgp *bgp,
+					      bgp_evpn_route_type rtype,
+					      int install)
+{
+	afi_t afi = AFI_L2VPN;
+	safi_t safi = SAFI_EVPN;
+	struct bgp_dest *rd_dest, *dest;
+	struct bgp_table *table;
+	struct bgp_path_info *pi;
+
+	for (rd_dest = bgp_table_top(bgp->rib[afi][safi]); rd_dest;
+	     rd_dest = bgp_route_next(rd_dest)) {
+		table = bgp_dest_get_bgp_table_info(rd_dest);
+		if (!table)
+			continue;
+
+		for (dest = bgp_table_top(table); dest;
+		     dest = bgp_route_next(dest)) {
+			const struct prefix_evpn *evp =
+				(const struct prefix_evpn *)bgp_dest_get_prefix(
+					dest);
+
+			if (evp->prefix.route_type != rtype)
+				continue;
+
+			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
+			     pi = pi->next) {
+				struct ecommunity *ecom = pi->attr->ecommunity;
+				int i;
+
+				if (!(CHECK_FLAG(pi->flags, BGP_PATH_VALID)
+				      && pi->type == ZEBRA_ROUTE_BGP
+				      && pi->sub_type == BGP_ROUTE_NORMAL))
+					continue;
+
+				if (!(pi->attr->flag
+				      & ATTR_FLAG_BIT(BGP_ATTR_EXT_COMMUNITIES))
+				    || !ecom)
+					continue;
+
+				for (i = 0; i < ecom->size; i++) {
+					struct ecommunity_val *eval;
+					struct ecommunity_val eval_tmp;
+					struct irt_node *irt;
+					uint8_t type;
+
+					eval = (struct ecommunity_val
+							*)(ecom->val
+							   + (i * ecom->unit_size));
+					type = eval->val[0];
+					if (eval->val[1] != ECOMMUNITY_ROUTE_TARGET)
+						continue;
+
+					irt = lookup_import_rt(bgp, eval);
+					if (irt)
+						install_uninstall_route_in_marked_vnis(
+							bgp, evp, pi, irt->vnis,
+							install);
+
+					/* non-exact match on the local-admin
+					 * field, see is_route_matching_for_vni
+					 */
+					if (type != ECOMMUNITY_ENCODE_AS
+					    && type != ECOMMUNITY_ENCODE_AS4
+					    && type != ECOMMUNITY_ENCODE_IP)
+						continue;
+
+					memcpy(&eval_tmp, eval,
+					       ecom->unit_size);
+					mask_ecom_global_admin(&eval_tmp, eval);
+					irt = lookup_import_rt(bgp, &eval_tmp);
+					if (irt)
+						install_uninstall_route_in_marked_vnis(
+							bgp, evp, pi, irt->vnis,
+							install);
+				}
+			}
+		}
+	}
+}
+
 /* uninstall routes from l3vni vrf. */
 static int uninstall_routes_for_vrf(struct bgp *bgp_vrf)
 {
@@ -3735,12 +3898,15 @@ static int process_type2_route(struct peer *peer, afi_t afi, safi_t safi,
 
 	/* Copy Ethernet Seg Identifier */
 	if (attr) {
-		STREAM_GET(&attr->esi, pkt, sizeof(esi_t));
+		struct bgp_attr_evpn attr_evpn = *bgp_attr_get_evpn(attr);
 
-		if (bgp_evpn_is_esi_local(&attr->esi))
-			attr->es_flags |= ATTR_ES_IS_LOCAL;
+		STREAM_GET(&attr_evpn.esi, pkt, sizeof(esi_t));
+
+		if (bgp_evpn_is_esi_local(&attr_evpn.esi))
+			attr_evpn.es_flags |= ATTR_ES_IS_LOCAL;
 		else
-			attr->es_flags &= ~ATTR_ES_IS_LOCAL;
+			attr_evpn.es_flags &= ~ATTR_ES_IS_LOCAL;
+		bgp_attr_evpn_set(attr, &attr_evpn);
 	} else {
 		STREAM_FORWARD_GETP(pkt, sizeof(esi_t));
 	}
@@ -3943,8 +4109,12 @@ static int process_type5_route(struct peer *peer, afi_t afi, safi_t safi,
 	memset(&evpn, 0, sizeof(evpn));
 
 	/* Fetch ESI */
-	if (attr)
-		memcpy(&attr->esi, pfx, sizeof(esi_t));
+	if (attr) {
+		struct bgp_attr_evpn attr_evpn = *bgp_attr_get_evpn(attr);
+
+		memcpy(&attr_evpn.esi, pfx, sizeof(esi_t));
+		bgp_attr_evpn_set(attr, &attr_evpn);
+	}
 	pfx += ESI_BYTES;
 
 	/* Fetch Ethernet Tag. */
@@ -3995,11 +4165,12 @@ static int process_type5_route(struct peer *peer, afi_t afi, safi_t safi,
 
 	if (attr) {
 		is_valid_update = true;
-		if (is_zero_mac(&attr->rmac) &&
+		if (is_zero_mac(&bgp_attr_get_evpn(attr)->rmac) &&
 		    is_zero_gw_ip(&evpn.gw_ip, gw_afi))
 			is_valid_update = false;
 
-		if (is_mcast_mac(&attr->rmac) || is_bcast_mac(&attr->rmac))
+		if (is_mcast_mac(&bgp_attr_get_evpn(attr)->rmac)
+		    || is_bcast_mac(&bgp_attr_get_evpn(attr)->rmac))
 			is_valid_update = false;
 	}
 
@@ -4041,7 +4212,7 @@ static void evpn_mpattr_encode_type5(struct stream *s, const struct prefix *p,
 	stream_putc(s, 8 + 10 + 4 + 1 + len + 3);
 	stream_put(s, prd->val, 8);
 	if (attr)
-		stream_put(s, &attr->esi, sizeof(esi_t));
+		stream_put(s, &bgp_attr_get_evpn(attr)->esi, sizeof(esi_t));
 	else
 		stream_put(s, 0, sizeof(esi_t));
 	stream_putl(s, p_evpn_p->prefix_addr.eth_tag);
@@ -4078,6 +4249,9 @@ static void cleanup_vni_on_disable(struct hash_bucket *bucket, struct bgp *bgp)
 {
 	struct bgpevpn *vpn = (struct bgpevpn *)bucket->data;
 
+	bgp_evpn_macip_pending_flush(bgp, vpn);
+	bgp_evpn_import_unmark(bgp, vpn);
+
 	/* Remove EVPN routes and schedule for processing. */
 	delete_routes_for_vni(bgp, vpn);
 
@@ -4164,14 +4338,16 @@ static void bgp_evpn_handle_export_rt_change_for_vrf(struct bgp *bgp_vrf)
 static void update_autort_vni(struct hash_bucket *bucket, struct bgp *bgp)
 {
 	struct bgpevpn *vpn = bucket->data;
+	/* with evpn_info, (un)installing is batched by the caller */
+	bool batch = !!bgp->evpn_info;
 
 	if (!is_import_rt_configured(vpn)) {
-		if (is_vni_live(vpn))
+		if (is_vni_live(vpn) && !batch)
 			bgp_evpn_uninstall_routes(bgp, vpn);
 		bgp_evpn_unmap_vni_from_its_rts(bgp, vpn);
 		list_delete_all_node(vpn->import_rtl);
 		bgp_evpn_derive_auto_rt_import(bgp, vpn);
-		if (is_vni_live(vpn))
+		if (is_vni_live(vpn) && !batch)
 			bgp_evpn_install_routes(bgp, vpn);
 	}
 	if (!is_export_rt_configured(vpn)) {
@@ -4545,15 +4721,36 @@ void bgp_evpn_handle_router_id_update(struct bgp *bgp, int withdraw)
 	}
 }
 
+static void mark_autort_vni(struct hash_bucket *bucket, struct bgp *bgp)
+{
+	struct bgpevpn *vpn = bucket->data;
+
+	if (!is_import_rt_configured(vpn) && is_vni_live(vpn))
+		bgp_evpn_import_mark(bgp, vpn);
+}
+
 /*
  * Handle change to auto-RT algorithm - update and advertise local routes.
+ * This affects all VNIs with auto import RTs, so their routes are
+ * uninstalled and reinstalled in one pass over the EVPN table each.
  */
 void bgp_evpn_handle_autort_change(struct bgp *bgp)
 {
+	if (bgp->evpn_info) {
+		hash_iterate(bgp->vnihash,
+			     (void (*)(struct hash_bucket *,
+				       void *))mark_autort_vni,
+			     bgp);
+		bgp_evpn_import_run(bgp, 0);
+	}
+
 	hash_iterate(bgp->vnihash,
 		     (void (*)(struct hash_bucket *,
 			       void*))update_autort_vni,
 		     bgp);
+
+	if (bgp->evpn_info)
+		bgp_evpn_import_run(bgp, 1);
 }
 
 /*
@@ -4717,7 +4914,7 @@ void bgp_evpn_encode_prefix(struct stream *s, const struct prefix *p,
 		stream_putc(s, len);
 		stream_put(s, prd->val, 8);   /* RD */
 		if (attr)
-			stream_put(s, &attr->esi, ESI_BYTES);
+			stream_put(s, &bgp_attr_get_evpn(attr)->esi, ESI_BYTES);
 		else
 			stream_put(s, 0, 10);
 		stream_putl(s, evp->prefix.macip_addr.eth_tag);	/* Ethernet Tag ID */
@@ -5135,6 +5332,9 @@ struct bgpevpn *bgp_evpn_new(struct bgp *bgp, vni_t vni,
 
 	bgp_evpn_vni_es_init(vpn);
 
+	bgp_evpn_macip_fifo_init(&vpn->macip_fifo);
+	bgp_evpn_macip_hash_init(&vpn->macip_hash);
+
 	QOBJ_REG(vpn, bgpevpn);
 	return vpn;
 }
@@ -5147,6 +5347,10 @@ struct bgpevpn *bgp_evpn_new(struct bgp *bgp, vni_t vni,
  */
 void bgp_evpn_free(struct bgp *bgp, struct bgpevpn *vpn)
 {
+	bgp_evpn_macip_pending_flush(bgp, vpn);
+	bgp_evpn_import_unmark(bgp, vpn);
+	bgp_evpn_macip_hash_fini(&vpn->macip_hash);
+	bgp_evpn_macip_fifo_fini(&vpn->macip_fifo);
 	bgp_evpn_vni_es_cleanup(vpn);
 	bgpevpn_unlink_from_l3vni(vpn);
 	bgp_table_unlock(vpn->route_table);
@@ -5316,6 +5520,209 @@ int bgp_evpn_local_macip_add(struct bgp *bgp, vni_t vni, struct ethaddr *mac,
 	return 0;
 }
 
+/*
+ * Drop the local MAC-IP updates queued against a VNI; used when the VNI
+ * goes away and its local routes are deleted anyway.
+ */
+static void bgp_evpn_macip_pending_flush(struct bgp *bgp, struct bgpevpn *vpn)
+{
+	struct bgp_evpn_macip *m;
+
+	if (!bgp_evpn_macip_fifo_count(&vpn->macip_fifo))
+		return;
+
+	while ((m = bgp_evpn_macip_fifo_pop(&vpn->macip_fifo))) {
+		bgp_evpn_macip_hash_del(&vpn->macip_hash, m);
+		XFREE(MTYPE_BGP_EVPN_MACIP, m);
+	}
+
+	if (bgp->evpn_info)
+		bgp_evpn_macip_vnis_del(&bgp->evpn_info->macip_vnis, vpn);
+}
+
+/*
+ * Batched import of remote routes into VNIs.  VNIs are marked and put on
+ * evpn_info->import_vnis, then bgp_evpn_import_run() walks the EVPN table
+ * once per route type for all of them.
+ */
+static void bgp_evpn_import_mark(struct bgp *bgp, struct bgpevpn *vpn)
+{
+	if (CHECK_FLAG(vpn->flags, VNI_FLAG_IMPORT_PENDING))
+		return;
+
+	SET_FLAG(vpn->flags, VNI_FLAG_IMPORT_PENDING);
+	bgp_evpn_import_vnis_add_tail(&bgp->evpn_info->import_vnis, vpn);
+}
+
+static void bgp_evpn_import_unmark(struct bgp *bgp, struct bgpevpn *vpn)
+{
+	if (!CHECK_FLAG(vpn->flags, VNI_FLAG_IMPORT_PENDING))
+		return;
+
+	UNSET_FLAG(vpn->flags, VNI_FLAG_IMPORT_PENDING);
+	bgp_evpn_import_vnis_del(&bgp->evpn_info->import_vnis, vpn);
+}
+
+/*
+ * (Un)install remote routes for all marked VNIs.  Installing completes the
+ * batch and unmarks them; uninstalling leaves them marked for a following
+ * install (e.g. after the import RTs changed.)
+ */
+static void bgp_evpn_import_run(struct bgp *bgp, int install)
+{
+	struct bgp_evpn_info *evpn_info = bgp->evpn_info;
+	struct bgpevpn *vpn;
+
+	if (!bgp_evpn_import_vnis_count(&evpn_info->import_vnis))
+		return;
+
+	if (install) {
+		install_uninstall_routes_for_vnis(bgp, BGP_EVPN_IMET_ROUTE, 1);
+		install_uninstall_routes_for_vnis(bgp, BGP_EVPN_AD_ROUTE, 1);
+		install_uninstall_routes_for_vnis(bgp, BGP_EVPN_MAC_IP_ROUTE,
+						  1);
+	} else {
+		install_uninstall_routes_for_vnis(bgp, BGP_EVPN_MAC_IP_ROUTE,
+						  0);
+		install_uninstall_routes_for_vnis(bgp, BGP_EVPN_AD_ROUTE, 0);
+		install_uninstall_routes_for_vnis(bgp, BGP_EVPN_IMET_ROUTE, 0);
+		return;
+	}
+
+	THREAD_OFF(evpn_info->t_import);
+	while ((vpn = bgp_evpn_import_vnis_pop(&evpn_info->import_vnis)))
+		UNSET_FLAG(vpn->flags, VNI_FLAG_IMPORT_PENDING);
+}
+
+static int bgp_evpn_import_process(struct thread *t)
+{
+	bgp_evpn_import_run(THREAD_ARG(t), 1);
+	return 0;
+}
+
+/* Schedule installing remote routes into a VNI that just became live. */
+static void bgp_evpn_import_queue(struct bgp *bgp, struct bgpevpn *vpn)
+{
+	if (!bgp->evpn_info) {
+		install_routes_for_vni(bgp, vpn);
+		return;
+	}
+
+	bgp_evpn_import_mark(bgp, vpn);
+	thread_add_event(bm->master, bgp_evpn_import_process, bgp, 0,
+			 &bgp->evpn_info->t_import);
+}
+
+/*
+ * Apply queued local MAC-IP updates.  VNIs are served round-robin and at
+ * most BGP_EVPN_MACIP_BATCH updates are applied per run so a large burst
+ * from zebra doesn't starve the other tasks.
+ */
+static int bgp_evpn_macip_process(struct thread *t)
+{
+	struct bgp *bgp = THREAD_ARG(t);
+	struct bgp_evpn_info *evpn_info = bgp->evpn_info;
+	struct bgpevpn *vpn;
+	struct bgp_evpn_macip *m;
+	unsigned int budget = BGP_EVPN_MACIP_BATCH;
+
+	while (budget
+	       && (vpn = bgp_evpn_macip_vnis_pop(&evpn_info->macip_vnis))) {
+		while (budget
+		       && (m = bgp_evpn_macip_fifo_pop(&vpn->macip_fifo))) {
+			bgp_evpn_macip_hash_del(&vpn->macip_hash, m);
+			budget--;
+
+			if (m->add)
+				bgp_evpn_local_macip_add(
+					bgp, vpn->vni,
+					&m->p.prefix.macip_addr.mac,
+					&m->p.prefix.macip_addr.ip, m->flags,
+					m->seq, &m->esi);
+			else
+				bgp_evpn_local_macip_del(
+					bgp, vpn->vni,
+					&m->p.prefix.macip_addr.mac,
+					&m->p.prefix.macip_addr.ip, m->state);
+
+			XFREE(MTYPE_BGP_EVPN_MACIP, m);
+		}
+
+		if (bgp_evpn_macip_fifo_count(&vpn->macip_fifo))
+			bgp_evpn_macip_vnis_add_tail(&evpn_info->macip_vnis,
+						     vpn);
+	}
+
+	if (bgp_evpn_macip_vnis_count(&evpn_info->macip_vnis))
+		thread_add_event(bm->master, bgp_evpn_macip_process, bgp, 0,
+				 &evpn_info->t_macip);
+
+	return 0;
+}
+
+/*
+ * Queue a local MAC-IP add or del received from zebra.  The update is
+ * applied from bgp_evpn_macip_process(); if an update for the same MAC-IP
+ * is already queued it is overwritten in place.
+ */
+int bgp_evpn_local_macip_queue(struct bgp *bgp, vni_t vni, bool add,
+			       struct ethaddr *mac, struct ipaddr *ip,
+			       uint8_t flags, uint32_t seq, esi_t *esi,
+			       int state)
+{
+	struct bgp_evpn_info *evpn_info = bgp->evpn_info;
+	struct bgpevpn *vpn;
+	struct bgp_evpn_macip ref, *m;
+
+	if (!evpn_info) {
+		if (add)
+			return bgp_evpn_local_macip_add(bgp, vni, mac, ip,
+							flags, seq, esi);
+		return bgp_evpn_local_macip_del(bgp, vni, mac, ip, state);
+	}
+
+	/* Lookup VNI hash - should exist. */
+	vpn = bgp_evpn_lookup_vni(bgp, vni);
+	if (!vpn || !is_vni_live(vpn)) {
+		flog_warn(EC_BGP_EVPN_VPN_VNI,
+			  "%u: VNI hash entry for VNI %u %s at MACIP %s",
+			  bgp->vrf_id, vni, vpn ? "not live" : "not found",
+			  add ? "ADD" : "DEL");
+		return -1;
+	}
+
+	evpn_info->macip_rcvd++;
+
+	memset(&ref, 0, sizeof(ref));
+	build_evpn_type2_prefix(&ref.p, mac, ip);
+
+	m = bgp_evpn_macip_hash_find(&vpn->macip_hash, &ref);
+	if (m) {
+		evpn_info->macip_coalesced++;
+	} else {
+		m = XCALLOC(MTYPE_BGP_EVPN_MACIP, sizeof(*m));
+		m->p = ref.p;
+		bgp_evpn_macip_hash_add(&vpn->macip_hash, m);
+		if (!bgp_evpn_macip_fifo_count(&vpn->macip_fifo))
+			bgp_evpn_macip_vnis_add_tail(&evpn_info->macip_vnis,
+						     vpn);
+		bgp_evpn_macip_fifo_add_tail(&vpn->macip_fifo, m);
+	}
+
+	m->add = add;
+	m->flags = flags;
+	m->seq = seq;
+	if (esi)
+		memcpy(&m->esi, esi, sizeof(m->esi));
+	else
+		memset(&m->esi, 0, sizeof(m->esi));
+	m->state = state;
+
+	thread_add_timer_msec(bm->master, bgp_evpn_macip_process, bgp,
+			      BGP_EVPN_MACIP_DELAY_MSEC, &evpn_info->t_macip);
+	return 0;
+}
+
 static void link_l2vni_hash_to_l3vni(struct hash_bucket *bucket,
 				     struct bgp *bgp_vrf)
 {
@@ -5570,6 +5977,10 @@ int bgp_evpn_local_vni_del(struct bgp *bgp, vni_t vni)
 		return 0;
 	}
 
+	/* Updates still queued from zebra are moot now */
+	bgp_evpn_macip_pending_flush(bgp, vpn);
+	bgp_evpn_import_unmark(bgp, vpn);
+
 	/* Remove all local EVPN routes and schedule for processing (to
 	 * withdraw from peers).
 	 */
@@ -5679,9 +6090,10 @@ int bgp_evpn_local_vni_add(struct bgp *bgp, vni_t vni,
 
 	/* If we have learnt and retained remote routes (VTEPs, MACs) for this
 	 * VNI,
-	 * install them.
+	 * install them.  This is deferred so that when zebra sends a lot of
+	 * VNIs (e.g. at startup) they are all served by one table walk.
 	 */
-	install_routes_for_vni(bgp, vpn);
+	bgp_evpn_import_queue(bgp, vpn);
 
 	/* If we are advertising gateway mac-ip
 	   It needs to be conveyed again to zebra */
@@ -5730,10 +6142,20 @@ void bgp_evpn_cleanup_on_disable(struct bgp *bgp)
  */
 void bgp_evpn_cleanup(struct bgp *bgp)
 {
+	if (bgp->evpn_info) {
+		THREAD_OFF(bgp->evpn_info->t_macip);
+		THREAD_OFF(bgp->evpn_info->t_import);
+	}
+
 	hash_iterate(bgp->vnihash,
 		     (void (*)(struct hash_bucket *, void *))free_vni_entry,
 		     bgp);
 
+	if (bgp->evpn_info) {
+		bgp_evpn_macip_vnis_fini(&bgp->evpn_info->macip_vnis);
+		bgp_evpn_import_vnis_fini(&bgp->evpn_info->import_vnis);
+	}
+
 	hash_free(bgp->import_rt_hash);
 	bgp->import_rt_hash = NULL;
 
@@ -5781,6 +6203,8 @@ void bgp_evpn_init(struct bgp *bgp)
 	 * and freeze time (auto-recovery) is disabled.
 	 */
 	if (bgp->evpn_info) {
+		bgp_evpn_macip_vnis_init(&bgp->evpn_info->macip_vnis);
+		bgp_evpn_import_vnis_init(&bgp->evpn_info->import_vnis);
 		bgp->evpn_info->dup_addr_detect = true;
 		bgp->evpn_info->dad_time = EVPN_DAD_DEFAULT_TIME;
 		bgp->evpn_info->dad_max_moves = EVPN_DAD_DEFAULT_MAX_MOVES;
@@ -104,6 +104,7 @@ static int bgp_evpn_es_route_select_install(struct bgp *bgp,
 	struct bgp_path_info *old_select; /* old best */
 	struct bgp_path_info *new_select; /* new best */
 	struct bgp_path_info_pair old_and_new;
+	const struct bgp_attr_evpn *evpn;
 
 	/* Compute the best path. */
 	bgp_best_selection(bgp, dest, &bgp->maxpaths[afi][safi], &old_and_new,
@@ -122,10 +123,10 @@ static int bgp_evpn_es_route_select_install(struct bgp *bgp,
 	    && !CHECK_FLAG(old_select->flags, BGP_PATH_ATTR_CHANGED)
 	    && !bgp_addpath_is_addpath_used(&bgp->tx_addpath, afi, safi)) {
 		if (bgp_zebra_has_route_changed(old_select)) {
+			evpn = bgp_attr_get_evpn(old_select->attr);
 			bgp_evpn_es_vtep_add(bgp, es, old_select->attr->nexthop,
-					     true /*esr*/,
-					     old_select->attr->df_alg,
-					     old_select->attr->df_pref);
+					     true /*esr*/, evpn->df_alg,
+					     evpn->df_pref);
 		}
 		UNSET_FLAG(old_select->flags, BGP_PATH_MULTIPATH_CHG);
 		bgp_zebra_clear_route_change_flags(dest);
@@ -152,9 +153,10 @@ static int bgp_evpn_es_route_select_install(struct bgp *bgp,
 
 	if (new_select && new_select->type == ZEBRA_ROUTE_BGP
 			&& new_select->sub_type == BGP_ROUTE_IMPORTED) {
+		evpn = bgp_attr_get_evpn(new_select->attr);
 		bgp_evpn_es_vtep_add(bgp, es, new_select->attr->nexthop,
-				     true /*esr */, new_select->attr->df_alg,
-				     new_select->attr->df_pref);
+				     true /*esr */, evpn->df_alg,
+				     evpn->df_pref);
 	} else {
 		if (old_select && old_select->type == ZEBRA_ROUTE_BGP
 				&& old_select->sub_type == BGP_ROUTE_IMPORTED)
@@ -1415,6 +1417,13 @@ void bgp_evpn_path_es_link(struct bgp_path_info *pi, vni_t vni, esi_t *esi)
 	if (!bgp_evpn)
 		return;
 
+	/* the path is usually re-linked to the ES it is already on; skip
+	 * the ES lookup in that case
+	 */
+	if (es_info && es_info->es
+	    && !memcmp(&es_info->es->esi, esi, sizeof(*esi)))
+		return;
+
 	/* setup es_info against the path if it doesn't aleady exist */
 	if (!es_info)
 		es_info = bgp_evpn_path_es_info_new(pi, vni);
@@ -1721,7 +1730,7 @@ static void bgp_evpn_local_es_do_del(struct bgp *bgp, struct bgp_evpn_es *es)
 	bgp_evpn_es_local_info_clear(es);
 }
 
-bool bgp_evpn_is_esi_local(esi_t *esi)
+bool bgp_evpn_is_esi_local(const esi_t *esi)
 {
 	struct bgp_evpn_es *es = NULL;
 
@@ -277,45 +277,50 @@ static inline bool bgp_evpn_is_esi_valid(esi_t *esi)
 
 static inline esi_t *bgp_evpn_attr_get_esi(struct attr *attr)
 {
-	return attr ? &attr->esi : zero_esi;
+	return attr ? (esi_t *)&bgp_attr_get_evpn(attr)->esi : zero_esi;
 }
 
 static inline bool bgp_evpn_attr_is_sync(struct attr *attr)
 {
-	return attr ? !!(attr->es_flags &
+	return attr ? !!(bgp_attr_get_evpn(attr)->es_flags &
 		(ATTR_ES_PEER_PROXY | ATTR_ES_PEER_ACTIVE)) : false;
 }
 
 static inline uint32_t bgp_evpn_attr_get_sync_seq(struct attr *attr)
 {
-	return attr ?  attr->mm_sync_seqnum : 0;
+	return attr ?  bgp_attr_get_evpn(attr)->mm_sync_seqnum : 0;
 }
 
 static inline bool bgp_evpn_attr_is_active_on_peer(struct attr *attr)
 {
 	return attr ?
-		!!(attr->es_flags & ATTR_ES_PEER_ACTIVE) : false;
+		!!(bgp_attr_get_evpn(attr)->es_flags & ATTR_ES_PEER_ACTIVE) :
+		false;
 }
 
 static inline bool bgp_evpn_attr_is_router_on_peer(struct attr *attr)
 {
 	return attr ?
-		!!(attr->es_flags & ATTR_ES_PEER_ROUTER) : false;
+		!!(bgp_attr_get_evpn(attr)->es_flags & ATTR_ES_PEER_ROUTER) :
+		false;
 }
 
 static inline bool bgp_evpn_attr_is_proxy(struct attr *attr)
 {
-	return attr ? !!(attr->es_flags & ATTR_ES_PROXY_ADVERT) : false;
+	return attr ? !!(bgp_attr_get_evpn(attr)->es_flags
+			 & ATTR_ES_PROXY_ADVERT)
+		    : false;
 }
 
 static inline bool bgp_evpn_attr_is_local_es(struct attr *attr)
 {
-	return attr ? !!(attr->es_flags & ATTR_ES_IS_LOCAL) : false;
+	return attr ? !!(bgp_attr_get_evpn(attr)->es_flags & ATTR_ES_IS_LOCAL)
+		    : false;
 }
 
 static inline uint32_t bgp_evpn_attr_get_df_pref(struct attr *attr)
 {
-	return (attr) ? attr->df_pref : 0;
+	return (attr) ? bgp_attr_get_evpn(attr)->df_pref : 0;
 }
 
 /****************************************************************************/
@@ -349,7 +354,7 @@ void bgp_evpn_es_evi_show_vni(struct vty *vty, vni_t vni,
 		bool uj, bool detail);
 void bgp_evpn_es_evi_show(struct vty *vty, bool uj, bool detail);
 struct bgp_evpn_es *bgp_evpn_es_find(const esi_t *esi);
-extern bool bgp_evpn_is_esi_local(esi_t *esi);
+extern bool bgp_evpn_is_esi_local(const esi_t *esi);
 extern void bgp_evpn_vrf_es_init(struct bgp *bgp_vrf);
 extern void bgp_evpn_es_vrf_deref(struct bgp_evpn_es_evi *es_evi);
 extern void bgp_evpn_es_vrf_ref(struct bgp_evpn_es_evi *es_evi,
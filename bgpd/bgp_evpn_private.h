@@ -24,6 +24,7 @@
 
 #include "vxlan.h"
 #include "zebra.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_ecommunity.h"
@@ -51,6 +52,42 @@
 RB_HEAD(bgp_es_evi_rb_head, bgp_evpn_es_evi);
 RB_PROTOTYPE(bgp_es_evi_rb_head, bgp_evpn_es_evi, rb_node,
 		bgp_es_evi_rb_cmp);
+
+/* Local MAC-IP updates from zebra are not applied one by one but queued
+ * against their VNI and processed in batches from a timer.  A newer update
+ * for the same MAC-IP replaces a queued one, so a flapping neighbor only
+ * results in one route update.
+ */
+PREDECL_DLIST(bgp_evpn_macip_fifo)
+PREDECL_HASH(bgp_evpn_macip_hash)
+PREDECL_DLIST(bgp_evpn_macip_vnis)
+
+/* VNIs waiting for remote routes to be imported (VNI_FLAG_IMPORT_PENDING.)
+ * They are served together by a single walk of the EVPN table.
+ */
+PREDECL_DLIST(bgp_evpn_import_vnis)
+
+struct bgp_evpn_macip {
+	struct bgp_evpn_macip_fifo_item fifo_item;
+	struct bgp_evpn_macip_hash_item hash_item;
+
+	/* type-2 prefix built from the MAC and IP */
+	struct prefix_evpn p;
+
+	bool add;
+	/* add */
+	uint8_t flags;
+	uint32_t seq;
+	esi_t esi;
+	/* del */
+	int state;
+};
+DECLARE_DLIST(bgp_evpn_macip_fifo, struct bgp_evpn_macip, fifo_item)
+
+/* Max local MAC-IP updates applied per run of the pending queue */
+#define BGP_EVPN_MACIP_BATCH 2000
+/* How long updates are collected before the queue is run */
+#define BGP_EVPN_MACIP_DELAY_MSEC 10
 /*
  * Hash table of EVIs. Right now, the only type of EVI supported is with
  * VxLAN encapsulation, hence each EVI corresponds to a L2 VNI.
@@ -70,6 +107,7 @@ struct bgpevpn {
 #define VNI_FLAG_EXPRT_CFGD        0x10 /* Export RT is user configured */
 #define VNI_FLAG_USE_TWO_LABELS    0x20 /* Attach both L2-VNI and L3-VNI if
 					   needed for this VPN */
+#define VNI_FLAG_IMPORT_PENDING    0x40 /* On evpn_info->import_vnis */
 
 	struct bgp *bgp_vrf; /* back pointer to the vrf instance */
 
@@ -112,10 +150,21 @@ struct bgpevpn {
 	/* List of local ESs */
 	struct list *local_es_evi_list;
 
+	/* Local MAC-IP updates not yet applied; the VNI is on
+	 * bgp->evpn_info->macip_vnis while the fifo is non-empty.
+	 */
+	struct bgp_evpn_macip_fifo_head macip_fifo;
+	struct bgp_evpn_macip_hash_head macip_hash;
+	struct bgp_evpn_macip_vnis_item macip_vnis_item;
+
+	struct bgp_evpn_import_vnis_item import_vnis_item;
+
 	QOBJ_FIELDS
 };
 
 DECLARE_QOBJ_TYPE(bgpevpn)
+DECLARE_DLIST(bgp_evpn_macip_vnis, struct bgpevpn, macip_vnis_item)
+DECLARE_DLIST(bgp_evpn_import_vnis, struct bgpevpn, import_vnis_item)
 
 /* Mapping of Import RT to VNIs.
  * The Import RTs of all VNIs are maintained in a hash table with each
@@ -176,6 +225,16 @@ struct bgp_evpn_info {
 	struct ethaddr pip_rmac_static;
 	struct ethaddr pip_rmac_zebra;
 	bool is_anycast_mac;
+
+	/* VNIs with local MAC-IP updates pending */
+	struct bgp_evpn_macip_vnis_head macip_vnis;
+	struct thread *t_macip;
+	uint64_t macip_rcvd;
+	uint64_t macip_coalesced;
+
+	/* VNIs with remote route import pending */
+	struct bgp_evpn_import_vnis_head import_vnis;
+	struct thread *t_import;
 };
 
 static inline int is_vrf_rd_configured(struct bgp *bgp_vrf)
@@ -337,7 +396,7 @@ static inline void encode_esi_label_extcomm(struct ecommunity_val *eval,
 }
 
 static inline void encode_rmac_extcomm(struct ecommunity_val *eval,
-				       struct ethaddr *rmac)
+				       const struct ethaddr *rmac)
 {
 	memset(eval, 0, sizeof(*eval));
 	eval->val[0] = ECOMMUNITY_ENCODE_EVPN;
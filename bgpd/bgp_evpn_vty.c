@@ -520,6 +520,9 @@ static void display_vni(struct vty *vty, struct bgpevpn *vpn, json_object *json)
 		else
 			json_object_string_add(json, "advertiseSviMacIp",
 					       "Disabled");
+		json_object_int_add(
+			json, "macIpPending",
+			bgp_evpn_macip_fifo_count(&vpn->macip_fifo));
 	} else {
 		vty_out(vty, "VNI: %d", vpn->vni);
 		if (is_vni_live(vpn))
@@ -553,6 +556,9 @@ static void display_vni(struct vty *vty, struct bgpevpn *vpn, json_object *json)
 		else
 			vty_out(vty, "  Advertise-svi-macip : %s\n",
 				"Disabled");
+		if (bgp_evpn_macip_fifo_count(&vpn->macip_fifo))
+			vty_out(vty, "  Pending local MAC-IP updates: %zu\n",
+				bgp_evpn_macip_fifo_count(&vpn->macip_fifo));
 	}
 
 	if (!json)
@@ -3962,6 +3968,11 @@ DEFUN(show_bgp_l2vpn_evpn_vni,
 			json_object_int_add(json, "numVnis", num_vnis);
 			json_object_int_add(json, "numL2Vnis", num_l2vnis);
 			json_object_int_add(json, "numL3Vnis", num_l3vnis);
+			json_object_int_add(json, "macIpUpdates",
+					    bgp_evpn->evpn_info->macip_rcvd);
+			json_object_int_add(
+				json, "macIpUpdatesCoalesced",
+				bgp_evpn->evpn_info->macip_coalesced);
 		} else {
 			vty_out(vty, "Advertise Gateway Macip: %s\n",
 				bgp_evpn->advertise_gw_macip ? "Enabled"
@@ -3978,6 +3989,11 @@ DEFUN(show_bgp_l2vpn_evpn_vni,
 					: "Disabled");
 			vty_out(vty, "Number of L2 VNIs: %u\n", num_l2vnis);
 			vty_out(vty, "Number of L3 VNIs: %u\n", num_l3vnis);
+			vty_out(vty,
+				"Local MAC-IP updates: %" PRIu64
+				" (%" PRIu64 " coalesced)\n",
+				bgp_evpn->evpn_info->macip_rcvd,
+				bgp_evpn->evpn_info->macip_coalesced);
 		}
 		evpn_show_all_vnis(vty, bgp_evpn, json);
 	} else {
@@ -62,6 +62,9 @@ struct as_filter {
 
 	regex_t *reg;
 	char *reg_str;
+
+	/* used instead of reg if the expression could be compiled to a DFA */
+	struct bgp_dfa *dfa;
 };
 
 /* AS path filter list. */
@@ -75,8 +78,14 @@ struct as_list {
 
 	struct as_filter *head;
 	struct as_filter *tail;
+
+	/* results memoized on AS paths are only valid for this version */
+	uint32_t version;
 };
 
+/* Bumped on every change to an as-path access-list. */
+static uint32_t as_list_version;
+
 /* as-path access-list 10 permit AS1. */
 
 static struct as_list_master as_list_master = {{NULL, NULL},
@@ -95,6 +104,8 @@ static void as_filter_free(struct as_filter *asfilter)
 {
 	if (asfilter->reg)
 		bgp_regex_free(asfilter->reg);
+	if (asfilter->dfa)
+		bgp_dfa_free(asfilter->dfa);
 	XFREE(MTYPE_AS_FILTER_STR, asfilter->reg_str);
 	XFREE(MTYPE_AS_FILTER, asfilter);
 }
@@ -109,6 +120,7 @@ static struct as_filter *as_filter_make(regex_t *reg, const char *reg_str,
 	asfilter->reg = reg;
 	asfilter->type = type;
 	asfilter->reg_str = XSTRDUP(MTYPE_AS_FILTER_STR, reg_str);
+	asfilter->dfa = bgp_dfa_compile(reg_str);
 
 	return asfilter;
 }
@@ -136,6 +148,7 @@ static void as_list_filter_add(struct as_list *aslist,
 	else
 		aslist->head = asfilter;
 	aslist->tail = asfilter;
+	aslist->version = ++as_list_version;
 
 	/* Run hook function. */
 	if (as_list_master.add_hook)
@@ -185,6 +198,7 @@ static struct as_list *as_list_insert(const char *name)
 	/* Allocate new access_list and copy given name. */
 	aslist = as_list_new();
 	aslist->name = XSTRDUP(MTYPE_AS_STR, name);
+	aslist->version = ++as_list_version;
 	assert(aslist->name);
 
 	/* If name is made by all digit character.  We treat it as
@@ -323,6 +337,7 @@ static void as_list_filter_delete(struct as_list *aslist,
 		aslist->head = asfilter->next;
 
 	as_filter_free(asfilter);
+	aslist->version = ++as_list_version;
 
 	/* If access_list becomes empty delete it from access_master. */
 	if (as_list_empty(aslist))
@@ -336,25 +351,60 @@ static void as_list_filter_delete(struct as_list *aslist,
 
 static bool as_filter_match(struct as_filter *asfilter, struct aspath *aspath)
 {
+	if (asfilter->dfa)
+		return bgp_dfa_exec(asfilter->dfa, aspath->str);
 	return bgp_regexec(asfilter->reg, aspath) != REG_NOMATCH;
 }
 
-/* Apply AS path filter to AS. */
-enum as_filter_type as_list_apply(struct as_list *aslist, void *object)
+static enum as_filter_type as_list_match(struct as_list *aslist,
+					 struct aspath *aspath)
 {
 	struct as_filter *asfilter;
+
+	for (asfilter = aslist->head; asfilter; asfilter = asfilter->next) {
+		if (as_filter_match(asfilter, aspath))
+			return asfilter->type;
+	}
+	return AS_FILTER_DENY;
+}
+
+/*
+ * Apply AS path filter to AS.  Interned AS paths are shared by many routes
+ * and don't change, so the results for them are remembered on the AS path
+ * until the access-list changes.
+ */
+enum as_filter_type as_list_apply(struct as_list *aslist, void *object)
+{
+	struct aspath_filter_memo *memo;
 	struct aspath *aspath;
+	enum as_filter_type type;
+	unsigned int i;
 
 	aspath = (struct aspath *)object;
 
 	if (aslist == NULL)
 		return AS_FILTER_DENY;
 
-	for (asfilter = aslist->head; asfilter; asfilter = asfilter->next) {
-		if (as_filter_match(asfilter, aspath))
-			return asfilter->type;
-	}
-	return AS_FILTER_DENY;
+	if (!atomic_load_explicit(&aspath->refcnt, memory_order_relaxed))
+		return as_list_match(aslist, aspath);
+
+	memo = aspath->filter_memo;
+	for (i = 0; memo && i < array_size(memo->ent); i++)
+		if (memo->ent[i].list == aslist
+		    && memo->ent[i].version == aslist->version)
+			return memo->ent[i].type;
+
+	type = as_list_match(aslist, aspath);
+
+	if (!memo)
+		memo = aspath->filter_memo =
+			XCALLOC(MTYPE_AS_FILTER_MEMO, sizeof(*memo));
+	i = memo->next++ % array_size(memo->ent);
+	memo->ent[i].list = aslist;
+	memo->ent[i].version = aslist->version;
+	memo->ent[i].type = type;
+
+	return type;
 }
 
 /* Add hook function. */
@@ -54,6 +54,7 @@
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_zebra.h"
 
 DEFINE_HOOK(peer_backward_transition, (struct peer * peer), (peer))
@@ -127,6 +128,7 @@ static void peer_xfer_stats(struct peer *peer_dst, struct peer *peer_src)
 static struct peer *peer_xfer_conn(struct peer *from_peer)
 {
 	struct peer *peer;
+	struct bgp_preparse *pre;
 	afi_t afi;
 	safi_t safi;
 	int fd;
@@ -194,6 +196,7 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 
 		stream_fifo_clean(peer->ibuf);
 		stream_fifo_clean(peer->obuf);
+		bgp_preparse_clean(peer);
 
 		/*
 		 * this should never happen, since bgp_process_packet() is the
@@ -212,6 +215,8 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 			 */
 			stream_free(peer->curr);
 			peer->curr = NULL;
+			bgp_preparse_free(peer->curr_pre);
+			peer->curr_pre = NULL;
 		}
 
 		// copy each packet from old peer's output queue to new peer
@@ -223,6 +228,14 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 		while (from_peer->ibuf->head)
 			stream_fifo_push(peer->ibuf,
 					 stream_fifo_pop(from_peer->ibuf));
+		while ((pre = bgp_preparse_pop(&from_peer->ibuf_pre)))
+			bgp_preparse_add_tail(&peer->ibuf_pre, pre);
+
+		// packets not pre-parsed yet just get parsed the regular way
+		while (from_peer->ibuf_parse->head)
+			stream_fifo_push(
+				peer->ibuf,
+				stream_fifo_pop(from_peer->ibuf_parse));
 
 		ringbuf_wipe(peer->ibuf_work);
 		ringbuf_copy(peer->ibuf_work, from_peer->ibuf_work,
@@ -235,6 +248,7 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 	peer->v_routeadv = from_peer->v_routeadv;
 	peer->v_gr_restart = from_peer->v_gr_restart;
 	peer->cap = from_peer->cap;
+	peer->max_packet_size = from_peer->max_packet_size;
 	status = peer->status;
 	pstatus = peer->ostatus;
 	last_evt = peer->last_event;
@@ -1182,6 +1196,8 @@ int bgp_stop(struct peer *peer)
 		return -1;
 	}
 
+	bgp_soft_reconfig_in_cancel(peer);
+
 	/* Can't do this in Clearing; events are used for state transitions */
 	if (peer->status != Clearing) {
 		/* Delete all existing events of the peer */
@@ -1306,6 +1322,7 @@ int bgp_stop(struct peer *peer)
 			stream_fifo_clean(peer->ibuf);
 		if (peer->obuf)
 			stream_fifo_clean(peer->obuf);
+		bgp_preparse_clean(peer);
 
 		if (peer->ibuf_work)
 			ringbuf_wipe(peer->ibuf_work);
@@ -1316,6 +1333,8 @@ int bgp_stop(struct peer *peer)
 			stream_free(peer->curr);
 			peer->curr = NULL;
 		}
+		bgp_preparse_free(peer->curr_pre);
+		peer->curr_pre = NULL;
 	}
 
 	/* Close of file descriptor. */
@@ -1584,6 +1603,7 @@ int bgp_start(struct peer *peer)
 
 	/* Clear peer capability flag. */
 	peer->cap = 0;
+	peer->max_packet_size = BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE;
 
 	/* If the peer is passive mode, force to move to Active mode. */
 	if (CHECK_FLAG(peer->flags, PEER_FLAG_PASSIVE)) {
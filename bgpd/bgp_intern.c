@@ -0,0 +1,101 @@
+/* BGP lock-striped intern tables
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "hash.h"
+
+#include "bgpd/bgp_intern.h"
+
+void bgp_intern_init(struct bgp_intern *tab,
+		     struct hash *(*create)(
+			     unsigned int size,
+			     unsigned int (*hash_key)(const void *),
+			     bool (*hash_cmp)(const void *, const void *),
+			     const char *name),
+		     unsigned int size, unsigned int (*hash_key)(const void *),
+		     bool (*hash_cmp)(const void *, const void *),
+		     const char *name)
+{
+	tab->hash_key = hash_key;
+
+	size = MAX(size / BGP_INTERN_STRIPES, HASH_INITIAL_SIZE);
+	for (unsigned int i = 0; i < BGP_INTERN_STRIPES; i++) {
+		pthread_mutex_init(&tab->stripes[i].mtx, NULL);
+		tab->stripes[i].hash = create(size, hash_key, hash_cmp, name);
+	}
+}
+
+void bgp_intern_finish(struct bgp_intern *tab, void (*free_func)(void *))
+{
+	for (unsigned int i = 0; i < BGP_INTERN_STRIPES; i++) {
+		hash_clean(tab->stripes[i].hash, free_func);
+		hash_free(tab->stripes[i].hash);
+		tab->stripes[i].hash = NULL;
+		pthread_mutex_destroy(&tab->stripes[i].mtx);
+	}
+}
+
+bool bgp_intern_release(struct bgp_intern *tab, void *data,
+			atomic_size_t *refcnt)
+{
+	struct bgp_intern_stripe *st;
+	unsigned int key;
+	size_t cur = atomic_load_explicit(refcnt, memory_order_relaxed);
+
+	/* not the last reference, the object stays on the table */
+	while (cur > 1)
+		if (atomic_compare_exchange_weak_explicit(
+			    refcnt, &cur, cur - 1, memory_order_release,
+			    memory_order_relaxed))
+			return false;
+
+	key = bgp_intern_key(tab, data);
+	st = bgp_intern_stripe(tab, key);
+	frr_with_mutex (&st->mtx) {
+		/* it may have been looked up again in the meantime */
+		if (atomic_load_explicit(refcnt, memory_order_relaxed)
+		    && atomic_fetch_sub_explicit(refcnt, 1,
+						 memory_order_acq_rel)
+			       > 1)
+			return false;
+
+		hash_release_with_key(st->hash, data, key);
+	}
+	return true;
+}
+
+unsigned long bgp_intern_count(struct bgp_intern *tab)
+{
+	unsigned long count = 0;
+
+	for (unsigned int i = 0; i < BGP_INTERN_STRIPES; i++)
+		frr_with_mutex (&tab->stripes[i].mtx) {
+			count += tab->stripes[i].hash->count;
+		}
+	return count;
+}
+
+void bgp_intern_iterate(struct bgp_intern *tab,
+			void (*func)(struct hash_bucket *, void *), void *arg)
+{
+	for (unsigned int i = 0; i < BGP_INTERN_STRIPES; i++)
+		frr_with_mutex (&tab->stripes[i].mtx) {
+			hash_iterate(tab->stripes[i].hash, func, arg);
+		}
+}
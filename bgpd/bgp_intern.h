@@ -0,0 +1,108 @@
+/* BGP lock-striped intern tables
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_INTERN_H
+#define _FRR_BGP_INTERN_H
+
+#include "frratomic.h"
+#include "frr_pthread.h"
+#include "hash.h"
+
+/*
+ * The tables attributes and their parts (AS paths, communities, ...) are
+ * interned in are split into stripes, each a hash with its own mutex, so
+ * that interning can happen from any pthread.
+ *
+ * Reference counts are atomic.  Taking a reference to something that is
+ * interned already, or dropping one that isn't the last, doesn't need the
+ * lock; looking something up or inserting it does, and so does dropping the
+ * last reference, which takes the object off its table.  That way, lookups
+ * never find an object whose count just dropped to zero.
+ */
+
+#define BGP_INTERN_STRIPE_BITS 4
+#define BGP_INTERN_STRIPES (1U << BGP_INTERN_STRIPE_BITS)
+
+struct bgp_intern_stripe {
+	pthread_mutex_t mtx;
+	struct hash *hash;
+};
+
+struct bgp_intern {
+	unsigned int (*hash_key)(const void *);
+	struct bgp_intern_stripe stripes[BGP_INTERN_STRIPES];
+};
+
+/*
+ * create is hash_create_size() or hash_create_open(), size is for the whole
+ * table.
+ */
+extern void bgp_intern_init(struct bgp_intern *tab,
+			    struct hash *(*create)(
+				    unsigned int size,
+				    unsigned int (*hash_key)(const void *),
+				    bool (*hash_cmp)(const void *,
+						     const void *),
+				    const char *name),
+			    unsigned int size,
+			    unsigned int (*hash_key)(const void *),
+			    bool (*hash_cmp)(const void *, const void *),
+			    const char *name);
+extern void bgp_intern_finish(struct bgp_intern *tab,
+			      void (*free_func)(void *));
+
+/*
+ * Hash key of data.  It picks the stripe and is passed on to
+ * hash_get_with_key() / hash_release_with_key(), so data is hashed once.
+ */
+static inline unsigned int bgp_intern_key(struct bgp_intern *tab,
+					  const void *data)
+{
+	return tab->hash_key(data);
+}
+
+/* Stripe for key; lock its mtx around anything done with its hash. */
+static inline struct bgp_intern_stripe *
+bgp_intern_stripe(struct bgp_intern *tab, unsigned int key)
+{
+	/* hash tables index by the low bits, stripes use the high ones */
+	uint32_t mix = key * 0x9e3779b1U;
+
+	return &tab->stripes[mix >> (32 - BGP_INTERN_STRIPE_BITS)];
+}
+
+static inline void bgp_intern_ref(atomic_size_t *refcnt)
+{
+	atomic_fetch_add_explicit(refcnt, 1, memory_order_relaxed);
+}
+
+/*
+ * Drop a reference to data.  Returns true if that was the last one, in which
+ * case data has been taken off the table and the caller has to free it.
+ */
+extern bool bgp_intern_release(struct bgp_intern *tab, void *data,
+			       atomic_size_t *refcnt);
+
+extern unsigned long bgp_intern_count(struct bgp_intern *tab);
+
+/* Each stripe is locked while it is walked, so func must not intern. */
+extern void bgp_intern_iterate(struct bgp_intern *tab,
+			       void (*func)(struct hash_bucket *, void *),
+			       void *arg);
+
+#endif /* _FRR_BGP_INTERN_H */
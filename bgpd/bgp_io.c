@@ -23,14 +23,19 @@
 #include <zebra.h>
 #include <pthread.h>		// for pthread_mutex_unlock, pthread_mutex_lock
 #include <sys/uio.h>		// for writev
+#ifdef HAVE_LIBURING
+#include <liburing.h>		// for io_uring_submit_and_wait, io_uring_...
+#endif
 
 #include "frr_pthread.h"
 #include "linklist.h"		// for list_delete, list_delete_all_node, lis...
+#include "lib_errors.h"		// for EC_LIB_SYSTEM_CALL
 #include "log.h"		// for zlog_debug, safe_strerror, zlog_err
 #include "memory.h"		// for MTYPE_TMP, XCALLOC, XFREE
 #include "network.h"		// for ERRNO_IO_RETRY
 #include "stream.h"		// for stream_get_endp, stream_getw_from, str...
 #include "ringbuf.h"		// for ringbuf_remain, ringbuf_peek, ringbuf_...
+#include "sockopt.h"		// for sockopt_tcp_send_space
 #include "thread.h"		// for THREAD_OFF, THREAD_ARG, thread...
 #include "zassert.h"		// for assert
 
@@ -38,7 +43,9 @@
 #include "bgpd/bgp_debug.h"	// for bgp_debug_neighbor_events, bgp_type_str
 #include "bgpd/bgp_errors.h"	// for expanded error reference information
 #include "bgpd/bgp_fsm.h"	// for BGP_EVENT_ADD, bgp_event
+#include "bgpd/bgp_memory.h"	// for MTYPE_BGP_IO_URING
 #include "bgpd/bgp_packet.h"	// for bgp_notify_send_with_data, bgp_notify...
+#include "bgpd/bgp_parse.h"	// for bgp_parse_enabled, bgp_parse_schedule
 #include "bgpd/bgp_trace.h"	// for frrtraces
 #include "bgpd/bgpd.h"		// for peer, BGP_MARKER_SIZE, bgp_master, bm
 /* clang-format on */
@@ -48,12 +55,74 @@ static uint16_t bgp_write(struct peer *);
 static uint16_t bgp_read(struct peer *);
 static int bgp_process_writes(struct thread *);
 static int bgp_process_reads(struct thread *);
+static void bgp_writes_done(struct peer *, uint16_t, bool);
+static void bgp_reads_done(struct peer *, uint16_t);
+static uint16_t bgp_read_done(struct peer *, uint8_t *, ssize_t);
 static bool validate_header(struct peer *);
 
 /* generic i/o status codes */
 #define BGP_IO_TRANS_ERR (1 << 0) // EAGAIN or similar occurred
 #define BGP_IO_FATAL_ERR (1 << 1) // some kind of fatal TCP error
 
+#ifdef HAVE_LIBURING
+/*
+ * io_uring backend, used if the kernel supports it.
+ *
+ * Peer sockets are still polled by the I/O pthread's event loop, but the
+ * tasks run for sockets that are ready only queue their peer.  An event,
+ * which runs once all of those tasks have, then hands the reads and writes
+ * of all queued peers to the kernel in one io_uring_enter() per
+ * BGP_IO_URING_DEPTH of them, instead of one read() or writev() each.
+ *
+ * Everything is done with MSG_DONTWAIT and completes right away, with
+ * -EAGAIN if need be, so there's nothing in flight once the event returns;
+ * buffers and peers are handled exactly as with the syscalls.  Peers are
+ * taken off the queue by bgp_reads_off() and bgp_writes_off(), which
+ * synchronize with the event through mtx.
+ */
+#define BGP_IO_URING_DEPTH 32U
+#define BGP_IO_URING_READ_SIZE                                                 \
+	(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE * BGP_READ_PACKET_MAX)
+
+struct bgp_io_uring_req {
+	struct peer *peer;
+	bool write;
+};
+
+struct bgp_io_uring_slot {
+	struct peer *peer;
+	bool write;
+	int res;
+
+	/* writes */
+	unsigned int count;
+	struct stream *streams[BGP_WRITE_PACKET_MAX];
+	struct iovec iov[BGP_WRITE_PACKET_MAX];
+	struct msghdr msg;
+
+	/* reads */
+	uint8_t buf[BGP_IO_URING_READ_SIZE];
+};
+
+static struct bgp_io_uring {
+	bool enabled;
+	struct io_uring ring;
+	struct bgp_io_uring_slot *slots;
+
+	/* held while the queue is submitted, and to take peers off it */
+	pthread_mutex_t mtx;
+	struct bgp_io_uring_req *queue;
+	unsigned int count;
+	unsigned int size;
+	struct thread *t_submit;
+} bgp_io_uring = {
+	.mtx = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void bgp_io_uring_queue(struct peer *peer, bool write);
+static void bgp_io_uring_dequeue(struct peer *peer, bool write);
+#endif
+
 /* Thread external API ----------------------------------------------------- */
 
 void bgp_writes_on(struct peer *peer)
@@ -69,9 +138,10 @@ void bgp_writes_on(struct peer *peer)
 	assert(!peer->t_connect_check_w);
 	assert(peer->fd);
 
+	/* set first, bgp_io_uring_queue() drops peers that are off */
+	SET_FLAG(peer->thread_flags, PEER_THREAD_WRITES_ON);
 	thread_add_write(fpt->master, bgp_process_writes, peer, peer->fd,
 			 &peer->t_write);
-	SET_FLAG(peer->thread_flags, PEER_THREAD_WRITES_ON);
 }
 
 void bgp_writes_off(struct peer *peer)
@@ -79,6 +149,9 @@ void bgp_writes_off(struct peer *peer)
 	struct frr_pthread *fpt = bgp_pth_io;
 	assert(fpt->running);
 
+#ifdef HAVE_LIBURING
+	bgp_io_uring_dequeue(peer, true);
+#endif
 	thread_cancel_async(fpt->master, &peer->t_write, NULL);
 	THREAD_OFF(peer->t_generate_updgrp_packets);
 
@@ -99,10 +172,9 @@ void bgp_reads_on(struct peer *peer)
 	assert(!peer->t_connect_check_w);
 	assert(peer->fd);
 
+	SET_FLAG(peer->thread_flags, PEER_THREAD_READS_ON);
 	thread_add_read(fpt->master, bgp_process_reads, peer, peer->fd,
 			&peer->t_read);
-
-	SET_FLAG(peer->thread_flags, PEER_THREAD_READS_ON);
 }
 
 void bgp_reads_off(struct peer *peer)
@@ -110,7 +182,11 @@ void bgp_reads_off(struct peer *peer)
 	struct frr_pthread *fpt = bgp_pth_io;
 	assert(fpt->running);
 
+#ifdef HAVE_LIBURING
+	bgp_io_uring_dequeue(peer, false);
+#endif
 	thread_cancel_async(fpt->master, &peer->t_read, NULL);
+	bgp_parse_off(peer);
 	THREAD_OFF(peer->t_process_packet);
 
 	UNSET_FLAG(peer->thread_flags, PEER_THREAD_READS_ON);
@@ -127,18 +203,33 @@ static int bgp_process_writes(struct thread *thread)
 	peer = THREAD_ARG(thread);
 	uint16_t status;
 	bool reschedule;
-	bool fatal = false;
 
 	if (peer->fd < 0)
 		return -1;
 
-	struct frr_pthread *fpt = bgp_pth_io;
+#ifdef HAVE_LIBURING
+	if (bgp_io_uring.enabled) {
+		bgp_io_uring_queue(peer, true);
+		return 0;
+	}
+#endif
 
 	frr_with_mutex(&peer->io_mtx) {
 		status = bgp_write(peer);
 		reschedule = (stream_fifo_head(peer->obuf) != NULL);
 	}
 
+	bgp_writes_done(peer, status, reschedule);
+	return 0;
+}
+
+/* Reschedules writes, or update-group packet generation, after bgp_write(). */
+static void bgp_writes_done(struct peer *peer, uint16_t status,
+			    bool reschedule)
+{
+	struct frr_pthread *fpt = bgp_pth_io;
+	bool fatal = false;
+
 	/* no problem */
 	if (CHECK_FLAG(status, BGP_IO_TRANS_ERR)) {
 	}
@@ -161,8 +252,6 @@ static int bgp_process_writes(struct thread *thread)
 		BGP_UPDATE_GROUP_TIMER_ON(&peer->t_generate_updgrp_packets,
 					  bgp_generate_updgrp_packets);
 	}
-
-	return 0;
 }
 
 /*
@@ -177,9 +266,6 @@ static int bgp_process_reads(struct thread *thread)
 	/* clang-format off */
 	static struct peer *peer;	// peer to read from
 	uint16_t status;		// bgp_read status code
-	bool more = true;		// whether we got more data
-	bool fatal = false;		// whether fatal error occurred
-	bool added_pkt = false;		// whether we pushed onto ->ibuf
 	/* clang-format on */
 
 	peer = THREAD_ARG(thread);
@@ -187,12 +273,35 @@ static int bgp_process_reads(struct thread *thread)
 	if (peer->fd < 0 || bm->terminating)
 		return -1;
 
-	struct frr_pthread *fpt = bgp_pth_io;
+#ifdef HAVE_LIBURING
+	if (bgp_io_uring.enabled) {
+		bgp_io_uring_queue(peer, false);
+		return 0;
+	}
+#endif
 
 	frr_with_mutex(&peer->io_mtx) {
 		status = bgp_read(peer);
 	}
 
+	bgp_reads_done(peer, status);
+	return 0;
+}
+
+/*
+ * Splits what bgp_read() got into packets and hands them on, then reschedules
+ * reads.
+ */
+static void bgp_reads_done(struct peer *peer, uint16_t status)
+{
+	/* clang-format off */
+	bool more = true;		// whether we got more data
+	bool fatal = false;		// whether fatal error occurred
+	bool added_pkt = false;		// whether we pushed onto ->ibuf
+	bool parse = bgp_parse_enabled(); // whether to use ->ibuf_parse instead
+	/* clang-format on */
+	struct frr_pthread *fpt = bgp_pth_io;
+
 	/* error checking phase */
 	if (CHECK_FLAG(status, BGP_IO_TRANS_ERR)) {
 		/* no problem; just don't process packets */
@@ -228,7 +337,7 @@ static int bgp_process_reads(struct thread *thread)
 		pktsize = ntohs(pktsize);
 
 		/* if this fails we are seriously screwed */
-		assert(pktsize <= BGP_MAX_PACKET_SIZE);
+		assert(pktsize <= peer->max_packet_size);
 
 		/*
 		 * If we have that much data, chuck it into its own
@@ -242,7 +351,9 @@ static int bgp_process_reads(struct thread *thread)
 
 			frrtrace(2, frr_bgp, packet_read, peer, pkt);
 			frr_with_mutex(&peer->io_mtx) {
-				stream_fifo_push(peer->ibuf, pkt);
+				stream_fifo_push(parse ? peer->ibuf_parse
+						       : peer->ibuf,
+						 pkt);
 			}
 
 			added_pkt = true;
@@ -259,120 +370,147 @@ static int bgp_process_reads(struct thread *thread)
 
 		thread_add_read(fpt->master, bgp_process_reads, peer, peer->fd,
 				&peer->t_read);
-		if (added_pkt)
+		if (added_pkt && parse)
+			bgp_parse_schedule(peer);
+		else if (added_pkt)
 			thread_add_timer_msec(bm->master, bgp_process_packet,
 					      peer, 0, &peer->t_process_packet);
 	}
-
-	return 0;
 }
 
 /*
- * Flush peer output buffer.
- *
- * This function pops packets off of peer->obuf and writes them to peer->fd.
- * The amount of packets written is equal to the minimum of peer->wpkt_quanta
- * and the number of packets on the output buffer, unless an error occurs.
- *
- * If write() returns an error, the appropriate FSM event is generated.
+ * Peers share the I/O pthread deficit round robin: each time a peer's socket
+ * is writable it is credited a quantum of bytes and writes whole packets for
+ * as long as its credit lasts, keeping what's left for its next turn.
  *
- * The return value is equal to the number of packets written
- * (which may be zero).
+ * The quantum is what the socket takes without blocking right now, which
+ * follows from how fast the receiver drains it, capped by wpkt_quanta
+ * maximum-size packets.  That way a peer whose receiver keeps up doesn't
+ * spend the pthread's time on writes that only pile up in the kernel, and one
+ * that doesn't still gets a packet out every turn.
  */
-static uint16_t bgp_write(struct peer *peer)
+static uint32_t bgp_write_quantum(struct peer *peer, uint32_t wpkt_quanta)
 {
-	uint8_t type;
-	struct stream *s;
-	int update_last_write = 0;
-	unsigned int count;
-	uint32_t uo = 0;
-	uint16_t status = 0;
-	uint32_t wpkt_quanta_old;
+	uint32_t quantum = wpkt_quanta * peer->max_packet_size;
+	int space = sockopt_tcp_send_space(peer->fd);
 
-	int writenum = 0;
-	int num;
-	unsigned int iovsz;
-	unsigned int strmsz;
-	unsigned int total_written;
+	if (space >= 0)
+		quantum = MIN(quantum, (uint32_t)space);
 
-	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
-					       memory_order_relaxed);
-	struct stream *ostreams[wpkt_quanta_old];
-	struct stream **streams = ostreams;
-	struct iovec iov[wpkt_quanta_old];
+	return MAX(quantum, peer->max_packet_size);
+}
 
-	s = stream_fifo_head(peer->obuf);
+/* Smoothed bytes per second written, for show commands. */
+static void bgp_write_rate_update(struct peer *peer, unsigned int written)
+{
+	time_t now = monotime(NULL);
+	time_t elapsed = now - peer->obuf_rate_time;
+	uint32_t rate;
+
+	peer->obuf_rate_bytes += written;
+	if (elapsed < 1)
+		return;
 
-	if (!s)
-		goto done;
+	rate = atomic_load_explicit(&peer->obuf_rate, memory_order_relaxed);
+	rate = (rate * 3 + peer->obuf_rate_bytes / elapsed) / 4;
+	atomic_store_explicit(&peer->obuf_rate, rate, memory_order_relaxed);
+
+	peer->obuf_rate_bytes = 0;
+	peer->obuf_rate_time = now;
+}
+
+/*
+ * Sets up iov with as many packets off the head of peer->obuf as the peer's
+ * credit and wpkt_quanta allow, and streams with the streams they come from.
+ *
+ * Returns the number of packets, zero if there is nothing to send.
+ */
+static unsigned int bgp_write_iov(struct peer *peer, uint32_t wpkt_quanta,
+				  struct stream **streams, struct iovec *iov)
+{
+	struct stream *s = stream_fifo_head(peer->obuf);
+	unsigned int count = 0;
+	size_t writenum = 0;
+	uint32_t quantum;
+
+	if (!s) {
+		/* credit doesn't build up while there's nothing to send */
+		peer->wpkt_deficit = 0;
+		return 0;
+	}
 
-	count = iovsz = 0;
-	while (count < wpkt_quanta_old && iovsz < array_size(iov) && s) {
-		ostreams[iovsz] = s;
-		iov[iovsz].iov_base = stream_pnt(s);
-		iov[iovsz].iov_len = STREAM_READABLE(s);
+	quantum = bgp_write_quantum(peer, wpkt_quanta);
+	atomic_store_explicit(&peer->wpkt_quantum, quantum,
+			      memory_order_relaxed);
+	peer->wpkt_deficit = MIN(peer->wpkt_deficit + quantum, 2 * quantum);
+
+	while (count < wpkt_quanta && s
+	       && (count == 0
+		   || writenum + STREAM_READABLE(s) <= peer->wpkt_deficit)) {
+		streams[count] = s;
+		iov[count].iov_base = stream_pnt(s);
+		iov[count].iov_len = STREAM_READABLE(s);
 		writenum += STREAM_READABLE(s);
 		s = s->next;
-		++iovsz;
 		++count;
 	}
 
-	strmsz = iovsz;
-	total_written = 0;
-
-	do {
-		num = writev(peer->fd, iov, iovsz);
-
-		if (num < 0) {
-			if (!ERRNO_IO_RETRY(errno)) {
-				BGP_EVENT_ADD(peer, TCP_fatal_error);
-				SET_FLAG(status, BGP_IO_FATAL_ERR);
-			} else {
-				SET_FLAG(status, BGP_IO_TRANS_ERR);
-			}
-
-			break;
-		} else if (num != writenum) {
-			unsigned int msg_written = 0;
-			unsigned int ic = iovsz;
-
-			for (unsigned int i = 0; i < ic; i++) {
-				size_t ss = iov[i].iov_len;
+	return count;
+}
 
-				if (ss > (unsigned int) num)
-					break;
+/*
+ * Accounts for num bytes of iov having been written.  A packet that only got
+ * out partially has its stream and iov entry moved past what did.
+ *
+ * Returns the number of packets that got out completely.
+ */
+static unsigned int bgp_write_advance(struct stream **streams,
+				      struct iovec *iov, unsigned int count,
+				      size_t num)
+{
+	unsigned int i;
 
-				msg_written++;
-				iovsz--;
-				writenum -= ss;
-				num -= ss;
-			}
+	for (i = 0; i < count && iov[i].iov_len <= num; i++)
+		num -= iov[i].iov_len;
 
-			total_written += msg_written;
+	if (i < count && num) {
+		stream_forward_getp(streams[i], num);
+		iov[i].iov_base = stream_pnt(streams[i]);
+		iov[i].iov_len = STREAM_READABLE(streams[i]);
+	}
 
-			assert(total_written < count);
+	return i;
+}
 
-			memmove(&iov, &iov[msg_written],
-				sizeof(iov[0]) * iovsz);
-			streams = &streams[msg_written];
-			stream_forward_getp(streams[0], num);
-			iov[0].iov_base = stream_pnt(streams[0]);
-			iov[0].iov_len = STREAM_READABLE(streams[0]);
+/* Status for a failed write, errno is what it failed with. */
+static uint16_t bgp_write_error(struct peer *peer)
+{
+	if (!ERRNO_IO_RETRY(errno)) {
+		BGP_EVENT_ADD(peer, TCP_fatal_error);
+		return BGP_IO_FATAL_ERR;
+	}
 
-			writenum -= num;
-			num = 0;
-			assert(writenum > 0);
-		} else {
-			total_written = strmsz;
-		}
+	return BGP_IO_TRANS_ERR;
+}
 
-	} while (num != writenum);
+/*
+ * Takes the first total_written packets, which have been written, off
+ * peer->obuf and updates statistics.
+ */
+static void bgp_write_done(struct peer *peer, struct stream **streams,
+			   unsigned int total_written,
+			   unsigned int bytes_written)
+{
+	uint8_t type;
+	struct stream *s;
+	int update_last_write = 0;
+	uint32_t uo = 0;
 
 	/* Handle statistics */
 	for (unsigned int i = 0; i < total_written; i++) {
 		s = stream_fifo_pop(peer->obuf);
 
-		assert(s == ostreams[i]);
+		assert(s == streams[i]);
 
 		/* Retrieve BGP packet type. */
 		stream_set_getp(s, BGP_MARKER_SIZE + 2);
@@ -421,11 +559,16 @@ static uint16_t bgp_write(struct peer *peer)
 		}
 
 		stream_free(s);
-		ostreams[i] = NULL;
+		streams[i] = NULL;
 		update_last_write = 1;
 	}
 
 done : {
+	if (bytes_written) {
+		peer->wpkt_deficit -= MIN(peer->wpkt_deficit, bytes_written);
+		bgp_write_rate_update(peer, bytes_written);
+	}
+
 	/*
 	 * Update last_update if UPDATEs were written.
 	 * Note: that these are only updated at end,
@@ -440,6 +583,52 @@ done : {
 		atomic_store_explicit(&peer->last_write, bgp_clock(),
 				      memory_order_relaxed);
 }
+}
+
+/*
+ * Flush peer output buffer.
+ *
+ * This function pops packets off of peer->obuf and writes them to peer->fd.
+ * The amount of packets written is bounded by peer->wpkt_quanta and the
+ * peer's credit (see bgp_write_quantum()), unless an error occurs.
+ *
+ * If write() returns an error, the appropriate FSM event is generated.
+ *
+ * The return value is equal to the number of packets written
+ * (which may be zero).
+ */
+static uint16_t bgp_write(struct peer *peer)
+{
+	uint16_t status = 0;
+	uint32_t wpkt_quanta_old;
+	unsigned int count;
+	unsigned int total_written = 0;
+	unsigned int bytes_written = 0;
+	ssize_t num;
+
+	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
+					       memory_order_relaxed);
+	struct stream *ostreams[wpkt_quanta_old];
+	struct iovec iov[wpkt_quanta_old];
+
+	count = bgp_write_iov(peer, wpkt_quanta_old, ostreams, iov);
+
+	while (total_written < count) {
+		num = writev(peer->fd, &iov[total_written],
+			     count - total_written);
+
+		if (num < 0) {
+			status = bgp_write_error(peer);
+			break;
+		}
+
+		bytes_written += num;
+		total_written += bgp_write_advance(&ostreams[total_written],
+						   &iov[total_written],
+						   count - total_written, num);
+	}
+
+	bgp_write_done(peer, ostreams, total_written, bytes_written);
 
 	return status;
 }
@@ -453,12 +642,24 @@ static uint16_t bgp_read(struct peer *peer)
 {
 	size_t readsize; // how many bytes we want to read
 	ssize_t nbytes;  // how many bytes we actually read
-	uint16_t status = 0;
-	static uint8_t ibw[BGP_MAX_PACKET_SIZE * BGP_READ_PACKET_MAX];
+	static uint8_t ibw[BGP_IBUF_WORK_SIZE];
 
 	readsize = MIN(ringbuf_space(peer->ibuf_work), sizeof(ibw));
 	nbytes = read(peer->fd, ibw, readsize);
 
+	return bgp_read_done(peer, ibw, nbytes);
+}
+
+/*
+ * Handles the result of reading nbytes into ibw, errno is what the read
+ * failed with if nbytes < 0.
+ *
+ * @return status flag (see top-of-file)
+ */
+static uint16_t bgp_read_done(struct peer *peer, uint8_t *ibw, ssize_t nbytes)
+{
+	uint16_t status = 0;
+
 	/* EAGAIN or EWOULDBLOCK; come back later */
 	if (nbytes < 0 && ERRNO_IO_RETRY(errno)) {
 		SET_FLAG(status, BGP_IO_TRANS_ERR);
@@ -557,9 +758,15 @@ static bool validate_header(struct peer *peer)
 		return false;
 	}
 
-	/* Minimum packet length check. */
-	if ((size < BGP_HEADER_SIZE) || (size > BGP_MAX_PACKET_SIZE)
+	/*
+	 * Minimum packet length check.  The maximum is only raised once an
+	 * OPEN with the extended message capability has been processed, and
+	 * never for OPENs (RFC 8654).
+	 */
+	if ((size < BGP_HEADER_SIZE) || (size > peer->max_packet_size)
 	    || (type == BGP_MSG_OPEN && size < BGP_MSG_OPEN_MIN_SIZE)
+	    || (type == BGP_MSG_OPEN
+		&& size > BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE)
 	    || (type == BGP_MSG_UPDATE && size < BGP_MSG_UPDATE_MIN_SIZE)
 	    || (type == BGP_MSG_NOTIFY && size < BGP_MSG_NOTIFY_MIN_SIZE)
 	    || (type == BGP_MSG_KEEPALIVE && size != BGP_MSG_KEEPALIVE_MIN_SIZE)
@@ -586,3 +793,301 @@ static bool validate_header(struct peer *peer)
 
 	return true;
 }
+
+#ifdef HAVE_LIBURING
+/* io_uring backend -------------------------------------------------------- */
+
+static int bgp_io_uring_submit(struct thread *thread);
+
+#define BGP_IO_URING_FLAG(write)                                               \
+	((write) ? PEER_THREAD_WRITES_ON : PEER_THREAD_READS_ON)
+
+/*
+ * Called from the I/O tasks of peers whose socket is ready.  The task may
+ * already have been running when bgp_*_off() dequeued the peer, so the
+ * thread flag is checked under u->mtx.
+ */
+static void bgp_io_uring_queue(struct peer *peer, bool write)
+{
+	struct bgp_io_uring *u = &bgp_io_uring;
+
+	frr_with_mutex(&u->mtx) {
+		if (!CHECK_FLAG(peer->thread_flags, BGP_IO_URING_FLAG(write)))
+			return;
+		if (u->count == u->size) {
+			u->size = MAX(u->size * 2, BGP_IO_URING_DEPTH);
+			u->queue = XREALLOC(MTYPE_BGP_IO_URING, u->queue,
+					    u->size * sizeof(*u->queue));
+		}
+		u->queue[u->count].peer = peer;
+		u->queue[u->count].write = write;
+		u->count++;
+	}
+
+	thread_add_event(bgp_pth_io->master, bgp_io_uring_submit, NULL, 0,
+			 &u->t_submit);
+}
+
+/*
+ * Called from the main pthread before the peer's I/O task is cancelled.
+ * Taking u->mtx waits out a submit in progress; clearing the thread flag
+ * under it keeps the peer from being queued again, and completions from
+ * rescheduling the task after it was cancelled.
+ */
+static void bgp_io_uring_dequeue(struct peer *peer, bool write)
+{
+	struct bgp_io_uring *u = &bgp_io_uring;
+
+	if (!u->enabled)
+		return;
+
+	frr_with_mutex(&u->mtx) {
+		UNSET_FLAG(peer->thread_flags, BGP_IO_URING_FLAG(write));
+
+		for (unsigned int i = 0; i < u->count;) {
+			if (u->queue[i].peer != peer
+			    || u->queue[i].write != write) {
+				i++;
+				continue;
+			}
+
+			u->count--;
+			memmove(&u->queue[i], &u->queue[i + 1],
+				(u->count - i) * sizeof(*u->queue));
+		}
+	}
+}
+
+/* Sets up slot's read as bgp_read() would. */
+static void bgp_io_uring_prep_read(struct bgp_io_uring_slot *slot,
+				   struct io_uring_sqe *sqe)
+{
+	struct peer *peer = slot->peer;
+	size_t readsize;
+
+	frr_with_mutex(&peer->io_mtx) {
+		readsize = MIN(ringbuf_space(peer->ibuf_work),
+			       sizeof(slot->buf));
+	}
+
+	io_uring_prep_recv(sqe, peer->fd, slot->buf, readsize, MSG_DONTWAIT);
+	io_uring_sqe_set_data(sqe, slot);
+}
+
+/*
+ * Sets up slot's write as bgp_write() would.  Leaves peer->io_mtx locked
+ * either way, so peer->obuf isn't touched until the write has completed.
+ *
+ * Returns false if there is nothing to write.
+ */
+static bool bgp_io_uring_prep_write(struct bgp_io_uring_slot *slot,
+				    struct io_uring *ring)
+{
+	struct peer *peer = slot->peer;
+	struct io_uring_sqe *sqe;
+	uint32_t wpkt_quanta;
+
+	pthread_mutex_lock(&peer->io_mtx);
+
+	wpkt_quanta = atomic_load_explicit(&peer->bgp->wpkt_quanta,
+					   memory_order_relaxed);
+	slot->count = bgp_write_iov(peer, wpkt_quanta, slot->streams,
+				    slot->iov);
+	if (!slot->count)
+		return false;
+
+	memset(&slot->msg, 0, sizeof(slot->msg));
+	slot->msg.msg_iov = slot->iov;
+	slot->msg.msg_iovlen = slot->count;
+
+	sqe = io_uring_get_sqe(ring);
+	io_uring_prep_sendmsg(sqe, peer->fd, &slot->msg, MSG_DONTWAIT);
+	io_uring_sqe_set_data(sqe, slot);
+	return true;
+}
+
+/* Waits for submitted completions, submitting whatever is still queued. */
+static void bgp_io_uring_reap(struct io_uring *ring, unsigned int submitted)
+{
+	struct io_uring_cqe *cqe;
+	struct bgp_io_uring_slot *slot;
+	unsigned int head, seen;
+	int ret;
+
+	while (submitted) {
+		ret = io_uring_submit_and_wait(ring, 1);
+		if (ret < 0 && ret != -EINTR && ret != -EAGAIN
+		    && ret != -EBUSY) {
+			flog_err(EC_LIB_SYSTEM_CALL,
+				 "%s: io_uring_submit_and_wait() failed: %s",
+				 __func__, safe_strerror(-ret));
+			/* the I/O pthread can't go on */
+			assert(!"io_uring submission failed");
+		}
+
+		seen = 0;
+		io_uring_for_each_cqe(ring, head, cqe) {
+			slot = io_uring_cqe_get_data(cqe);
+			slot->res = cqe->res;
+			seen++;
+		}
+		io_uring_cq_advance(ring, seen);
+		submitted -= seen;
+	}
+}
+
+/* Reads from and writes to up to BGP_IO_URING_DEPTH peers at once. */
+static void bgp_io_uring_run(struct bgp_io_uring_req *reqs, unsigned int n)
+{
+	struct bgp_io_uring *u = &bgp_io_uring;
+	struct bgp_io_uring_slot *slot;
+	unsigned int submitted = 0;
+	unsigned int total_written;
+	uint16_t status[BGP_IO_URING_DEPTH];
+	bool reschedule[BGP_IO_URING_DEPTH];
+
+	for (unsigned int i = 0; i < n; i++) {
+		slot = &u->slots[i];
+		slot->peer = reqs[i].peer;
+		slot->write = reqs[i].write;
+		slot->res = 0;
+		slot->count = 0;
+	}
+
+	/*
+	 * Reads are set up first: they take peer->io_mtx for a moment, and a
+	 * write to the same peer keeps it locked.
+	 */
+	for (unsigned int i = 0; i < n; i++) {
+		if (u->slots[i].write)
+			continue;
+		bgp_io_uring_prep_read(&u->slots[i],
+				       io_uring_get_sqe(&u->ring));
+		submitted++;
+	}
+	for (unsigned int i = 0; i < n; i++)
+		if (u->slots[i].write
+		    && bgp_io_uring_prep_write(&u->slots[i], &u->ring))
+			submitted++;
+
+	bgp_io_uring_reap(&u->ring, submitted);
+
+	/* writes complete first, so peer->io_mtx is unlocked for reads */
+	for (unsigned int i = 0; i < n; i++) {
+		slot = &u->slots[i];
+		if (!slot->write)
+			continue;
+
+		status[i] = 0;
+		total_written = 0;
+		if (slot->res < 0) {
+			errno = -slot->res;
+			status[i] = bgp_write_error(slot->peer);
+		} else if (slot->count)
+			total_written = bgp_write_advance(
+				slot->streams, slot->iov, slot->count,
+				slot->res);
+
+		bgp_write_done(slot->peer, slot->streams, total_written,
+			       slot->res > 0 ? slot->res : 0);
+		reschedule[i] = (stream_fifo_head(slot->peer->obuf) != NULL);
+		pthread_mutex_unlock(&slot->peer->io_mtx);
+	}
+
+	for (unsigned int i = 0; i < n; i++) {
+		slot = &u->slots[i];
+		if (slot->write)
+			continue;
+
+		if (slot->res < 0)
+			errno = -slot->res;
+		frr_with_mutex(&slot->peer->io_mtx) {
+			status[i] = bgp_read_done(slot->peer, slot->buf,
+						  slot->res < 0 ? -1 : slot->res);
+		}
+	}
+
+	/* don't reschedule I/O tasks of peers that were turned off */
+	for (unsigned int i = 0; i < n; i++) {
+		slot = &u->slots[i];
+		if (!CHECK_FLAG(slot->peer->thread_flags,
+				BGP_IO_URING_FLAG(slot->write)))
+			continue;
+		if (slot->write)
+			bgp_writes_done(slot->peer, status[i], reschedule[i]);
+		else
+			bgp_reads_done(slot->peer, status[i]);
+	}
+}
+
+static int bgp_io_uring_submit(struct thread *thread)
+{
+	struct bgp_io_uring *u = &bgp_io_uring;
+
+	frr_with_mutex(&u->mtx) {
+		for (unsigned int i = 0; i < u->count; i += BGP_IO_URING_DEPTH)
+			bgp_io_uring_run(&u->queue[i],
+					 MIN(u->count - i, BGP_IO_URING_DEPTH));
+		u->count = 0;
+	}
+
+	return 0;
+}
+
+static void bgp_io_uring_init(void)
+{
+	struct bgp_io_uring *u = &bgp_io_uring;
+	struct io_uring_probe *probe;
+	int ret;
+
+	ret = io_uring_queue_init(BGP_IO_URING_DEPTH, &u->ring, 0);
+	if (ret < 0) {
+		zlog_info("io_uring is not available (%s), using plain syscalls for BGP I/O",
+			  safe_strerror(-ret));
+		return;
+	}
+
+	probe = io_uring_get_probe_ring(&u->ring);
+	if (!probe || !io_uring_opcode_supported(probe, IORING_OP_RECV)
+	    || !io_uring_opcode_supported(probe, IORING_OP_SENDMSG)) {
+		zlog_info("io_uring doesn't support socket I/O, using plain syscalls for BGP I/O");
+		if (probe)
+			io_uring_free_probe(probe);
+		io_uring_queue_exit(&u->ring);
+		return;
+	}
+	io_uring_free_probe(probe);
+
+	u->slots = XCALLOC(MTYPE_BGP_IO_URING,
+			   BGP_IO_URING_DEPTH * sizeof(*u->slots));
+	u->enabled = true;
+}
+
+static void bgp_io_uring_finish(void)
+{
+	struct bgp_io_uring *u = &bgp_io_uring;
+
+	if (!u->enabled)
+		return;
+
+	io_uring_queue_exit(&u->ring);
+	XFREE(MTYPE_BGP_IO_URING, u->slots);
+	XFREE(MTYPE_BGP_IO_URING, u->queue);
+	u->count = u->size = 0;
+	u->enabled = false;
+}
+#endif /* HAVE_LIBURING */
+
+void bgp_io_init(void)
+{
+#ifdef HAVE_LIBURING
+	bgp_io_uring_init();
+#endif
+}
+
+void bgp_io_finish(void)
+{
+#ifdef HAVE_LIBURING
+	bgp_io_uring_finish();
+#endif
+}
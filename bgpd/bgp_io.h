@@ -25,9 +25,30 @@
 #define BGP_WRITE_PACKET_MAX 64U
 #define BGP_READ_PACKET_MAX  10U
 
+/*
+ * Size of peer->ibuf_work: room for BGP_READ_PACKET_MAX standard messages,
+ * and always for one more message of any size after the partial one left
+ * over from the last read.
+ */
+#define BGP_IBUF_WORK_SIZE                                                     \
+	MAX(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE * BGP_READ_PACKET_MAX,        \
+	    BGP_MAX_PACKET_SIZE * 2)
+
 #include "bgpd/bgpd.h"
 #include "frr_pthread.h"
 
+/**
+ * Sets up the io_uring backend, if the kernel supports it.
+ *
+ * Call before the I/O pthread is started.
+ */
+extern void bgp_io_init(void);
+
+/**
+ * Tears down what bgp_io_init() set up, once the I/O pthread has stopped.
+ */
+extern void bgp_io_finish(void);
+
 /**
  * Start function for write thread.
  *
@@ -74,7 +95,8 @@ extern void bgp_writes_off(struct peer *peer);
  * Turns on packet reading for a peer.
  *
  * After this function is called, any packets received on peer->fd will be read
- * and copied into the FIFO queue peer->ibuf.
+ * and copied into the FIFO queue peer->ibuf, going through the UPDATE parse
+ * pthreads first if there are any (see bgp_parse.h).
  *
  * Additionally, it becomes unsafe to perform socket actions on peer->fd.
  *
@@ -0,0 +1,815 @@
+/* BGP Adj-RIB-In journal for warm restart
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "lib_errors.h"
+#include "linklist.h"
+#include "log.h"
+#include "network.h"
+#include "prefix.h"
+#include "sockunion.h"
+#include "stream.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_dump.h"
+#include "bgpd/bgp_journal.h"
+
+/* How a record identifies the peer */
+#define BGP_JOURNAL_PEER_IPV4   1
+#define BGP_JOURNAL_PEER_IPV6   2
+#define BGP_JOURNAL_PEER_IFNAME 3
+
+/* Attributes the record header carries, outside of the attribute blob */
+#define BGP_JOURNAL_NH_NEXT_HOP (1 << 0)
+#define BGP_JOURNAL_NH_MP_REACH (1 << 1)
+
+#define BGP_JOURNAL_BUFSIZE (1024 * 1024)
+#define BGP_JOURNAL_RECSIZE (2 * BGP_MAX_PACKET_SIZE + 1024)
+
+const char *bgp_journal_path;
+
+static struct bgp_journal {
+	int fd;
+
+	/* records not written to the file yet */
+	struct stream *obuf;
+	/* record being built or replayed */
+	struct stream *rec;
+
+	struct thread *t_flush;
+	struct thread *t_compact;
+	struct thread *t_stale;
+
+	/* records in the file vs. routes they describe */
+	uint64_t records;
+	uint64_t routes;
+
+	bool loaded;
+	bool loading;
+} journal = {.fd = -1};
+
+static bool bgp_journal_table(const struct bgp_table *table)
+{
+	return (table->afi == AFI_IP || table->afi == AFI_IP6)
+	       && (table->safi == SAFI_UNICAST
+		   || table->safi == SAFI_MULTICAST);
+}
+
+static bool bgp_journal_peer(struct peer *peer, afi_t afi, safi_t safi)
+{
+	return CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG)
+	       && peer != peer->bgp->peer_self;
+}
+
+/*
+ * MRT TABLE_DUMP_V2 attributes, plus the ones that matter for routes
+ * received over iBGP.  The next hops are kept in the record header.
+ */
+static void bgp_journal_attr_put(struct stream *s, struct attr *attr)
+{
+	struct cluster_list *cluster = bgp_attr_get_cluster(attr);
+	size_t start = stream_get_endp(s);
+
+	bgp_dump_routes_attr(s, attr, NULL);
+
+	if (CHECK_FLAG(attr->flag, ATTR_FLAG_BIT(BGP_ATTR_EXT_COMMUNITIES))
+	    && attr->ecommunity) {
+		stream_putc(s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS
+				       | BGP_ATTR_FLAG_EXTLEN);
+		stream_putc(s, BGP_ATTR_EXT_COMMUNITIES);
+		stream_putw(s, attr->ecommunity->size * ECOMMUNITY_SIZE);
+		stream_put(s, attr->ecommunity->val,
+			   attr->ecommunity->size * ECOMMUNITY_SIZE);
+	}
+
+	if (CHECK_FLAG(attr->flag, ATTR_FLAG_BIT(BGP_ATTR_ORIGINATOR_ID))) {
+		stream_putc(s, BGP_ATTR_FLAG_OPTIONAL);
+		stream_putc(s, BGP_ATTR_ORIGINATOR_ID);
+		stream_putc(s, IPV4_MAX_BYTELEN);
+		stream_put_in_addr(s, &attr->originator_id);
+	}
+
+	if (CHECK_FLAG(attr->flag, ATTR_FLAG_BIT(BGP_ATTR_CLUSTER_LIST))
+	    && cluster) {
+		stream_putc(s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_EXTLEN);
+		stream_putc(s, BGP_ATTR_CLUSTER_LIST);
+		stream_putw(s, cluster->length);
+		stream_put(s, cluster->list, cluster->length);
+	}
+
+	stream_putw_at(s, start, stream_get_endp(s) - start - 2);
+}
+
+static void bgp_journal_encode(struct stream *s, uint16_t subtype,
+			       struct peer *peer, afi_t afi, safi_t safi,
+			       const struct prefix *p, uint32_t addpath_id,
+			       struct attr *attr)
+{
+	const char *name = peer->bgp->name ? peer->bgp->name : "";
+	uint8_t nh_flags = 0;
+
+	stream_reset(s);
+
+	/* MRT common header, the length is filled in at the end */
+	stream_putl(s, time(NULL));
+	stream_putw(s, BGP_JOURNAL_MRT_TYPE);
+	stream_putw(s, subtype);
+	stream_putl(s, 0);
+
+	stream_putc(s, strlen(name));
+	stream_put(s, name, strlen(name));
+
+	if (peer->conf_if) {
+		stream_putc(s, BGP_JOURNAL_PEER_IFNAME);
+		stream_putc(s, strlen(peer->conf_if));
+		stream_put(s, peer->conf_if, strlen(peer->conf_if));
+	} else if (sockunion_family(&peer->su) == AF_INET) {
+		stream_putc(s, BGP_JOURNAL_PEER_IPV4);
+		stream_put_in_addr(s, &peer->su.sin.sin_addr);
+	} else {
+		stream_putc(s, BGP_JOURNAL_PEER_IPV6);
+		stream_put(s, &peer->su.sin6.sin6_addr, IPV6_MAX_BYTELEN);
+	}
+
+	stream_putw(s, afi);
+	stream_putc(s, safi);
+	stream_putl(s, addpath_id);
+	stream_putc(s, p->prefixlen);
+	stream_put(s, &p->u.prefix, PSIZE(p->prefixlen));
+
+	if (subtype == BGP_JOURNAL_ADD) {
+		if (CHECK_FLAG(attr->flag, ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP)))
+			nh_flags |= BGP_JOURNAL_NH_NEXT_HOP;
+		if (CHECK_FLAG(attr->flag,
+			       ATTR_FLAG_BIT(BGP_ATTR_MP_REACH_NLRI)))
+			nh_flags |= BGP_JOURNAL_NH_MP_REACH;
+
+		stream_putc(s, nh_flags);
+		stream_putc(s, attr->mp_nexthop_len);
+		stream_put_in_addr(s, &attr->nexthop);
+		stream_put_in_addr(s, &attr->mp_nexthop_global_in);
+		stream_put(s, &attr->mp_nexthop_global, IPV6_MAX_BYTELEN);
+		stream_put(s, &attr->mp_nexthop_local, IPV6_MAX_BYTELEN);
+		bgp_journal_attr_put(s, attr);
+	}
+
+	stream_putl_at(s, 8, stream_get_endp(s) - BGP_DUMP_HEADER_SIZE);
+}
+
+static bool bgp_journal_write(int fd, struct stream *s)
+{
+	size_t off = 0, len = stream_get_endp(s);
+	ssize_t ret;
+
+	while (off < len) {
+		ret = write(fd, STREAM_DATA(s) + off, len - off);
+		if (ret < 0 && ERRNO_IO_RETRY(errno))
+			continue;
+		if (ret <= 0) {
+			flog_err_sys(EC_LIB_SYSTEM_CALL,
+				     "Adj-RIB-In journal: write failed: %s",
+				     safe_strerror(errno));
+			return false;
+		}
+		off += ret;
+	}
+
+	stream_reset(s);
+	return true;
+}
+
+static void bgp_journal_close(void)
+{
+	if (journal.fd >= 0)
+		close(journal.fd);
+	journal.fd = -1;
+
+	thread_cancel(&journal.t_flush);
+	thread_cancel(&journal.t_compact);
+}
+
+static void bgp_journal_flush(void)
+{
+	if (journal.fd < 0 || !stream_get_endp(journal.obuf))
+		return;
+
+	if (!bgp_journal_write(journal.fd, journal.obuf)) {
+		zlog_warn("Adj-RIB-In journal %s disabled", bgp_journal_path);
+		bgp_journal_close();
+	}
+}
+
+static int bgp_journal_flush_timer(struct thread *t)
+{
+	bgp_journal_flush();
+	return 0;
+}
+
+/*
+ * Rewrite the journal from the Adj-RIB-In.  The new file replaces the old
+ * one only once it is complete.
+ */
+static int bgp_journal_compact(struct thread *t)
+{
+	char tmp[MAXPATHLEN];
+	struct listnode *node;
+	struct bgp *bgp;
+	struct bgp_dest *dest;
+	struct bgp_adj_in *adj;
+	uint64_t routes = 0;
+	afi_t afi;
+	safi_t safi;
+	int fd;
+
+	bgp_journal_flush();
+	if (t && journal.fd < 0)
+		return 0;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", bgp_journal_path);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "Adj-RIB-In journal: can't create %s: %s", tmp,
+			     safe_strerror(errno));
+		bgp_journal_close();
+		return 0;
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		FOREACH_AFI_SAFI (afi, safi) {
+			if (!bgp->rib[afi][safi]
+			    || !bgp_journal_table(bgp->rib[afi][safi]))
+				continue;
+
+			for (dest = bgp_table_top(bgp->rib[afi][safi]); dest;
+			     dest = bgp_route_next(dest)) {
+				for (adj = dest->adj_in; adj; adj = adj->next) {
+					if (!bgp_journal_peer(adj->peer, afi,
+							      safi))
+						continue;
+
+					bgp_journal_encode(
+						journal.rec, BGP_JOURNAL_ADD,
+						adj->peer, afi, safi,
+						bgp_dest_get_prefix(dest),
+						adj->addpath_rx_id, adj->attr);
+					if (STREAM_WRITEABLE(journal.obuf)
+						    < stream_get_endp(journal.rec)
+					    && !bgp_journal_write(fd,
+								  journal.obuf))
+						goto fail;
+					stream_put(journal.obuf,
+						   STREAM_DATA(journal.rec),
+						   stream_get_endp(journal.rec));
+					routes++;
+				}
+			}
+		}
+	}
+
+	if (!bgp_journal_write(fd, journal.obuf))
+		goto fail;
+
+	if (rename(tmp, bgp_journal_path) < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "Adj-RIB-In journal: can't rename %s: %s", tmp,
+			     safe_strerror(errno));
+		goto fail;
+	}
+
+	if (journal.fd >= 0)
+		close(journal.fd);
+	journal.fd = fd;
+	journal.records = journal.routes = routes;
+
+	zlog_info("Adj-RIB-In journal %s: rewritten with %" PRIu64 " routes",
+		  bgp_journal_path, routes);
+	return 0;
+
+fail:
+	close(fd);
+	unlink(tmp);
+	stream_reset(journal.obuf);
+	bgp_journal_close();
+	return 0;
+}
+
+static void bgp_journal_append(void)
+{
+	if (STREAM_WRITEABLE(journal.obuf) < stream_get_endp(journal.rec)) {
+		bgp_journal_flush();
+		if (journal.fd < 0)
+			return;
+	}
+
+	stream_put(journal.obuf, STREAM_DATA(journal.rec),
+		   stream_get_endp(journal.rec));
+	journal.records++;
+
+	thread_add_timer_msec(bm->master, bgp_journal_flush_timer, NULL,
+			      BGP_JOURNAL_FLUSH_MSEC, &journal.t_flush);
+
+	if (journal.records > 2 * journal.routes + BGP_JOURNAL_SLACK)
+		thread_add_event(bm->master, bgp_journal_compact, NULL, 0,
+				 &journal.t_compact);
+}
+
+static bool bgp_journal_active(struct bgp_dest *dest, struct peer *peer)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	if (journal.fd < 0 || journal.loading || bm->terminating)
+		return false;
+
+	return bgp_journal_table(table)
+	       && bgp_journal_peer(peer, table->afi, table->safi);
+}
+
+void bgp_journal_adj_in_set(struct bgp_dest *dest, struct bgp_adj_in *adj,
+			    bool new)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	if (!bgp_journal_active(dest, adj->peer))
+		return;
+
+	if (new)
+		journal.routes++;
+
+	bgp_journal_encode(journal.rec, BGP_JOURNAL_ADD, adj->peer,
+			   table->afi, table->safi, bgp_dest_get_prefix(dest),
+			   adj->addpath_rx_id, adj->attr);
+	bgp_journal_append();
+}
+
+void bgp_journal_adj_in_remove(struct bgp_dest *dest, struct bgp_adj_in *adj)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	if (!bgp_journal_active(dest, adj->peer))
+		return;
+
+	if (journal.routes)
+		journal.routes--;
+
+	bgp_journal_encode(journal.rec, BGP_JOURNAL_DEL, adj->peer,
+			   table->afi, table->safi, bgp_dest_get_prefix(dest),
+			   adj->addpath_rx_id, NULL);
+	bgp_journal_append();
+}
+
+/* Decode what bgp_journal_attr_put() wrote, false if it is damaged. */
+static bool bgp_journal_attr_get(struct stream *s, size_t len,
+				 struct attr *attr)
+{
+	size_t end = stream_get_getp(s) + len;
+	size_t alen, next;
+	uint8_t flags, type;
+
+	if (end > stream_get_endp(s))
+		return false;
+
+	while (stream_get_getp(s) < end) {
+		STREAM_GETC(s, flags);
+		STREAM_GETC(s, type);
+		if (CHECK_FLAG(flags, BGP_ATTR_FLAG_EXTLEN))
+			STREAM_GETW(s, alen);
+		else
+			STREAM_GETC(s, alen);
+
+		next = stream_get_getp(s) + alen;
+		if (next > end)
+			return false;
+
+		switch (type) {
+		case BGP_ATTR_ORIGIN:
+			if (alen != 1)
+				return false;
+			attr->origin = stream_getc(s);
+			break;
+		case BGP_ATTR_AS_PATH:
+			if (attr->aspath)
+				return false;
+			attr->aspath = aspath_parse(s, alen, 1);
+			if (!attr->aspath)
+				return false;
+			break;
+		case BGP_ATTR_MULTI_EXIT_DISC:
+			if (alen != 4)
+				return false;
+			attr->med = stream_getl(s);
+			break;
+		case BGP_ATTR_LOCAL_PREF:
+			if (alen != 4)
+				return false;
+			attr->local_pref = stream_getl(s);
+			break;
+		case BGP_ATTR_ATOMIC_AGGREGATE:
+			break;
+		case BGP_ATTR_AGGREGATOR:
+			if (alen != 8)
+				return false;
+			attr->aggregator_as = stream_getl(s);
+			attr->aggregator_addr.s_addr = stream_get_ipv4(s);
+			break;
+		case BGP_ATTR_COMMUNITIES:
+			if (attr->community)
+				return false;
+			attr->community =
+				community_parse((uint32_t *)stream_pnt(s), alen);
+			if (!attr->community)
+				return false;
+			break;
+		case BGP_ATTR_LARGE_COMMUNITIES:
+			if (attr->lcommunity)
+				return false;
+			attr->lcommunity = lcommunity_parse(stream_pnt(s), alen);
+			if (!attr->lcommunity)
+				return false;
+			break;
+		case BGP_ATTR_EXT_COMMUNITIES:
+			if (attr->ecommunity)
+				return false;
+			attr->ecommunity = ecommunity_parse(stream_pnt(s), alen);
+			if (!attr->ecommunity)
+				return false;
+			break;
+		case BGP_ATTR_ORIGINATOR_ID:
+			if (alen != 4)
+				return false;
+			attr->originator_id.s_addr = stream_get_ipv4(s);
+			break;
+		case BGP_ATTR_CLUSTER_LIST:
+			if (bgp_attr_get_cluster(attr) || alen % 4)
+				return false;
+			bgp_attr_set_cluster(
+				attr, cluster_parse((struct in_addr *)stream_pnt(s),
+						    alen));
+			break;
+		default:
+			/* not needed to rebuild a received route */
+			stream_set_getp(s, next);
+			continue;
+		}
+
+		/* ATTR_FLAG_BIT() needs a constant, all types above fit */
+		attr->flag |= 1ULL << (type - 1);
+		stream_set_getp(s, next);
+	}
+
+	return true;
+
+stream_failure:
+	return false;
+}
+
+static struct peer *bgp_journal_replay_peer(struct stream *s, afi_t *afi,
+					    safi_t *safi)
+{
+	char name[256], ifname[256];
+	union sockunion su;
+	struct bgp *bgp;
+	struct peer *peer;
+	uint8_t len, key;
+	uint16_t rec_afi;
+	uint8_t rec_safi;
+
+	memset(&su, 0, sizeof(su));
+
+	STREAM_GETC(s, len);
+	STREAM_GET(name, s, len);
+	name[len] = '\0';
+
+	STREAM_GETC(s, key);
+	switch (key) {
+	case BGP_JOURNAL_PEER_IPV4:
+		su.sin.sin_family = AF_INET;
+		STREAM_GET(&su.sin.sin_addr, s, IPV4_MAX_BYTELEN);
+		break;
+	case BGP_JOURNAL_PEER_IPV6:
+		su.sin6.sin6_family = AF_INET6;
+		STREAM_GET(&su.sin6.sin6_addr, s, IPV6_MAX_BYTELEN);
+		break;
+	case BGP_JOURNAL_PEER_IFNAME:
+		STREAM_GETC(s, len);
+		STREAM_GET(ifname, s, len);
+		ifname[len] = '\0';
+		break;
+	default:
+		return NULL;
+	}
+
+	STREAM_GETW(s, rec_afi);
+	STREAM_GETC(s, rec_safi);
+	if ((rec_afi != AFI_IP && rec_afi != AFI_IP6)
+	    || (rec_safi != SAFI_UNICAST && rec_safi != SAFI_MULTICAST))
+		return NULL;
+	*afi = rec_afi;
+	*safi = rec_safi;
+
+	bgp = name[0] ? bgp_lookup_by_name(name) : bgp_get_default();
+	if (!bgp)
+		return NULL;
+
+	if (key == BGP_JOURNAL_PEER_IFNAME)
+		peer = peer_lookup_by_conf_if(bgp, ifname);
+	else
+		peer = peer_lookup(bgp, &su);
+
+	/* a session that is already up has told us the truth by now */
+	if (!peer || !peer->afc[*afi][*safi] || peer_established(peer)
+	    || !bgp_journal_peer(peer, *afi, *safi))
+		return NULL;
+
+	return peer;
+
+stream_failure:
+	return NULL;
+}
+
+static void bgp_journal_replay_rec(struct stream *s, uint16_t subtype)
+{
+	struct peer *peer;
+	struct prefix p;
+	struct attr attr;
+	afi_t afi;
+	safi_t safi;
+	uint32_t addpath_id;
+	uint8_t nh_flags;
+	uint16_t attr_len;
+
+	peer = bgp_journal_replay_peer(s, &afi, &safi);
+	if (!peer)
+		return;
+
+	memset(&p, 0, sizeof(p));
+	p.family = afi2family(afi);
+	STREAM_GETL(s, addpath_id);
+	STREAM_GETC(s, p.prefixlen);
+	if (p.prefixlen > prefix_blen(&p) * 8)
+		return;
+	STREAM_GET(&p.u.prefix, s, PSIZE(p.prefixlen));
+
+	if (subtype == BGP_JOURNAL_DEL) {
+		bgp_withdraw(peer, &p, addpath_id, NULL, afi, safi,
+			     ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL, 0,
+			     NULL);
+		return;
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.label_index = BGP_INVALID_LABEL_INDEX;
+	attr.label = MPLS_INVALID_LABEL;
+
+	STREAM_GETC(s, nh_flags);
+	STREAM_GETC(s, attr.mp_nexthop_len);
+	STREAM_GET(&attr.nexthop, s, IPV4_MAX_BYTELEN);
+	STREAM_GET(&attr.mp_nexthop_global_in, s, IPV4_MAX_BYTELEN);
+	STREAM_GET(&attr.mp_nexthop_global, s, IPV6_MAX_BYTELEN);
+	STREAM_GET(&attr.mp_nexthop_local, s, IPV6_MAX_BYTELEN);
+	if (CHECK_FLAG(nh_flags, BGP_JOURNAL_NH_NEXT_HOP))
+		attr.flag |= ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP);
+	if (CHECK_FLAG(nh_flags, BGP_JOURNAL_NH_MP_REACH))
+		attr.flag |= ATTR_FLAG_BIT(BGP_ATTR_MP_REACH_NLRI);
+
+	STREAM_GETW(s, attr_len);
+	if (bgp_journal_attr_get(s, attr_len, &attr) && attr.aspath) {
+		bgp_update(peer, &p, addpath_id, &attr, afi, safi,
+			   ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL, 0, 0,
+			   NULL);
+		peer->adj_in_stale[afi][safi] = true;
+	}
+
+	bgp_attr_unintern_sub(&attr);
+	return;
+
+stream_failure:
+	return;
+}
+
+static unsigned int bgp_journal_replay(FILE *fp)
+{
+	struct stream *s = journal.rec;
+	uint32_t timestamp, len;
+	uint16_t type, subtype;
+	unsigned int count = 0;
+
+	while (true) {
+		stream_reset(s);
+		if (fread(STREAM_DATA(s), 1, BGP_DUMP_HEADER_SIZE, fp)
+		    != BGP_DUMP_HEADER_SIZE)
+			break;
+		stream_set_endp(s, BGP_DUMP_HEADER_SIZE);
+
+		STREAM_GETL(s, timestamp);
+		STREAM_GETW(s, type);
+		STREAM_GETW(s, subtype);
+		STREAM_GETL(s, len);
+		(void)timestamp;
+
+		/* a torn record at the end is where the journal stops */
+		if (type != BGP_JOURNAL_MRT_TYPE
+		    || len > STREAM_SIZE(s) - BGP_DUMP_HEADER_SIZE)
+			break;
+		if (fread(STREAM_DATA(s) + BGP_DUMP_HEADER_SIZE, 1, len, fp)
+		    != len)
+			break;
+		stream_set_endp(s, BGP_DUMP_HEADER_SIZE + len);
+
+		bgp_journal_replay_rec(s, subtype);
+		count++;
+	}
+
+stream_failure:
+	return count;
+}
+
+static void bgp_journal_reconcile_all(void)
+{
+	struct listnode *node, *pnode;
+	struct bgp *bgp;
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		for (ALL_LIST_ELEMENTS_RO(bgp->peer, pnode, peer))
+			FOREACH_AFI_SAFI (afi, safi)
+				bgp_journal_reconcile(peer, afi, safi);
+}
+
+static int bgp_journal_stale_timer(struct thread *t)
+{
+	zlog_info("Adj-RIB-In journal: stale-path time expired");
+	bgp_journal_reconcile_all();
+	return 0;
+}
+
+/*
+ * Mark everything the replay created as stale: the paths, and the
+ * Adj-RIB-In entries (bgp_adj_in_set() clears that again when the peer
+ * sends the route, changed or not).
+ */
+static uint32_t bgp_journal_mark_stale(void)
+{
+	struct listnode *node, *pnode;
+	struct bgp *bgp;
+	struct peer *peer;
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct bgp_adj_in *adj;
+	uint32_t stalepath_time = 0;
+	afi_t afi;
+	safi_t safi;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		FOREACH_AFI_SAFI (afi, safi) {
+			bool stale = false;
+
+			for (ALL_LIST_ELEMENTS_RO(bgp->peer, pnode, peer)) {
+				if (!peer->adj_in_stale[afi][safi])
+					continue;
+
+				stale = true;
+				frr_each (bgp_peer_paths,
+					  &peer->paths[afi][safi], pi)
+					if (!CHECK_FLAG(pi->flags,
+							BGP_PATH_REMOVED))
+						bgp_path_info_set_flag(
+							pi->net, pi,
+							BGP_PATH_STALE);
+			}
+
+			if (!stale)
+				continue;
+
+			stalepath_time = MAX(stalepath_time,
+					     bgp->stalepath_time);
+
+			for (dest = bgp_table_top(bgp->rib[afi][safi]); dest;
+			     dest = bgp_route_next(dest))
+				for (adj = dest->adj_in; adj; adj = adj->next)
+					if (adj->peer->adj_in_stale[afi][safi])
+						adj->stale = true;
+		}
+	}
+
+	return stalepath_time;
+}
+
+void bgp_journal_reconcile(struct peer *peer, afi_t afi, safi_t safi)
+{
+	struct bgp_table *table = peer->bgp->rib[afi][safi];
+	struct bgp_dest *dest;
+	struct bgp_adj_in *adj, *next;
+	unsigned long count = 0;
+
+	if (!peer->adj_in_stale[afi][safi])
+		return;
+	peer->adj_in_stale[afi][safi] = false;
+
+	bgp_clear_stale_route(peer, afi, safi);
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		for (adj = dest->adj_in; adj; adj = next) {
+			next = adj->next;
+
+			if (adj->peer != peer || !adj->stale)
+				continue;
+
+			bgp_adj_in_remove(dest, adj);
+			bgp_dest_unlock_node(dest);
+			count++;
+		}
+
+	if (bgp_debug_neighbor_events(peer))
+		zlog_debug("%s: %lu reloaded %s routes not refreshed",
+			   peer->host, count, get_afi_safi_str(afi, safi, false));
+}
+
+void bgp_journal_load(void)
+{
+	uint32_t stalepath_time;
+	unsigned int count = 0;
+	FILE *fp;
+
+	if (!bgp_journal_path || journal.loaded)
+		return;
+
+	/* the configuration is not there yet (vtysh -b) */
+	if (!listcount(bm->bgp))
+		return;
+
+	journal.loaded = true;
+
+	fp = fopen(bgp_journal_path, "r");
+	if (fp) {
+		journal.loading = true;
+		count = bgp_journal_replay(fp);
+		journal.loading = false;
+		fclose(fp);
+	} else if (errno != ENOENT)
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "Adj-RIB-In journal: can't read %s: %s",
+			     bgp_journal_path, safe_strerror(errno));
+
+	stalepath_time = bgp_journal_mark_stale();
+	if (stalepath_time)
+		thread_add_timer(bm->master, bgp_journal_stale_timer, NULL,
+				 stalepath_time, &journal.t_stale);
+
+	zlog_info("Adj-RIB-In journal %s: replayed %u records",
+		  bgp_journal_path, count);
+
+	/* start over from what is in the Adj-RIB-In now */
+	bgp_journal_compact(NULL);
+}
+
+void bgp_journal_init(void)
+{
+	if (!bgp_journal_path)
+		return;
+
+	journal.obuf = stream_new(BGP_JOURNAL_BUFSIZE);
+	journal.rec = stream_new(BGP_JOURNAL_RECSIZE);
+}
+
+void bgp_journal_finish(void)
+{
+	if (!bgp_journal_path)
+		return;
+
+	bgp_journal_flush();
+	bgp_journal_close();
+	thread_cancel(&journal.t_stale);
+
+	stream_free(journal.obuf);
+	stream_free(journal.rec);
+	journal.obuf = journal.rec = NULL;
+}
@@ -0,0 +1,75 @@
+/* BGP Adj-RIB-In journal for warm restart
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_JOURNAL_H
+#define _FRR_BGP_JOURNAL_H
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_advertise.h"
+
+/*
+ * With --adj-rib-in-journal, every change to the Adj-RIB-In of peers with
+ * soft-reconfiguration inbound is appended to a file, using MRT framing
+ * and MRT TABLE_DUMP_V2 attribute encoding.  Once the configuration has
+ * been read at the next start, the file is replayed through bgp_update(),
+ * so inbound policy applies as usual, and the resulting paths are marked
+ * stale.  They take part in best path selection right away and are
+ * reconciled when the peer sends End-of-RIB (or the stale-path timer
+ * expires): whatever the peer did not announce again is removed.
+ *
+ * The file is rewritten from the Adj-RIB-In when it holds a lot more
+ * records than routes.
+ */
+
+/* MRT type of journal records, not assigned by RFC 6396 */
+#define BGP_JOURNAL_MRT_TYPE 0xfe00
+
+/* MRT subtypes */
+#define BGP_JOURNAL_ADD 1
+#define BGP_JOURNAL_DEL 2
+
+/* buffered records are written out after this long at the latest */
+#define BGP_JOURNAL_FLUSH_MSEC 100
+
+/* compaction starts once the file has this many more records than routes */
+#define BGP_JOURNAL_SLACK 100000
+
+/* Path given on the command line, NULL if disabled */
+extern const char *bgp_journal_path;
+
+extern void bgp_journal_init(void);
+extern void bgp_journal_finish(void);
+
+/*
+ * Replay the journal and start writing it.  Runs once, when the
+ * configuration has been applied.
+ */
+extern void bgp_journal_load(void);
+
+/* Adj-RIB-In entry added or changed / about to be removed */
+extern void bgp_journal_adj_in_set(struct bgp_dest *dest,
+				   struct bgp_adj_in *adj, bool new);
+extern void bgp_journal_adj_in_remove(struct bgp_dest *dest,
+				      struct bgp_adj_in *adj);
+
+/*
+ * Remove the reloaded routes of `peer` it did not refresh.  Called on
+ * End-of-RIB.
+ */
+extern void bgp_journal_reconcile(struct peer *peer, afi_t afi, safi_t safi);
+
+#endif /* _FRR_BGP_JOURNAL_H */
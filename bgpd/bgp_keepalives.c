@@ -29,6 +29,7 @@
 #include "log.h"		// for zlog_debug
 #include "memory.h"		// for MTYPE_TMP, XFREE, XCALLOC, XMALLOC
 #include "monotime.h"		// for monotime, monotime_since
+#include "typesafe.h"		// for PREDECL_HEAP, DECLARE_HEAP
 
 #include "bgpd/bgpd.h"          // for peer, PEER_THREAD_KEEPALIVES_ON, peer...
 #include "bgpd/bgp_debug.h"	// for bgp_debug_neighbor_events
@@ -39,24 +40,63 @@
 /*
  * Peer KeepAlive Timer.
  * Associates a peer with the time of its last keepalive.
+ *
+ * Besides the hash used to look them up, pkats are kept on a heap ordered by
+ * when they are due next, so that each tick only touches the peers that are
+ * due instead of all of them.
  */
+PREDECL_HEAP(pkat_heap)
+
 struct pkat {
 	/* the peer to send keepalives to */
 	struct peer *peer;
 	/* absolute time of last keepalive sent */
 	struct timeval last;
+	/* absolute time the peer is looked at next */
+	struct timeval next;
+
+	struct pkat_heap_item heapitem;
 };
 
+static int pkat_cmp(const struct pkat *a, const struct pkat *b)
+{
+	if (timercmp(&a->next, &b->next, <))
+		return -1;
+	if (timercmp(&a->next, &b->next, >))
+		return 1;
+	return 0;
+}
+
+DECLARE_HEAP(pkat_heap, struct pkat, heapitem, pkat_cmp)
+
+/* peers without a keepalive timer are looked at again this often */
+static const struct timeval pkat_recheck = {1, 0};
+
+/* see peer_process() */
+static const struct timeval tolerance = {0, 100000};
+
 /* List of peers we are sending keepalives for, and associated mutex. */
 static pthread_mutex_t *peerhash_mtx;
 static pthread_cond_t *peerhash_cond;
 static struct hash *peerhash;
+static struct pkat_heap_head peerheap;
+
+/* When the peer's next keepalive is due, given the one last sent. */
+static void pkat_schedule(struct pkat *pkat)
+{
+	uint32_t v_ka = atomic_load_explicit(&pkat->peer->v_keepalive,
+					     memory_order_relaxed);
+	struct timeval ka = {v_ka, 0};
+
+	timeradd(&pkat->last, v_ka ? &ka : &pkat_recheck, &pkat->next);
+}
 
 static struct pkat *pkat_new(struct peer *peer)
 {
 	struct pkat *pkat = XMALLOC(MTYPE_TMP, sizeof(struct pkat));
 	pkat->peer = peer;
 	monotime(&pkat->last);
+	pkat_schedule(pkat);
 	return pkat;
 }
 
@@ -67,67 +107,59 @@ static void pkat_del(void *pkat)
 
 
 /*
- * Callback for hash_iterate. Determines if a peer needs a keepalive and if so,
- * generates and sends it.
- *
- * For any given peer, if the elapsed time since its last keepalive exceeds its
- * configured keepalive timer, a keepalive is sent to the peer and its
- * last-sent time is reset. Additionally, If the elapsed time does not exceed
- * the configured keepalive timer, but the time until the next keepalive is due
- * is within a hardcoded tolerance, a keepalive is sent as if the configured
- * timer was exceeded. Doing this helps alleviate nanosecond sleeps between
- * ticks by grouping together peers who are due for keepalives at roughly the
- * same time. This tolerance value is arbitrarily chosen to be 100ms.
+ * Called for a peer that is due at now.  Sends it a keepalive if its
+ * configured keepalive timer has run out since the last one, and works out
+ * when it is due next.
  *
- * In addition, this function calculates the maximum amount of time that the
- * keepalive thread can sleep before another tick needs to take place. This is
- * equivalent to shortest time until a keepalive is due for any one peer.
+ * Peers whose keepalive is due within a hardcoded tolerance are considered
+ * due already.  Doing this helps alleviate nanosecond sleeps between ticks by
+ * grouping together peers who are due for keepalives at roughly the same
+ * time.  This tolerance value is arbitrarily chosen to be 100ms.
  *
- * @return maximum time to wait until next update (0 if infinity)
+ * How late a keepalive goes out after it was due is tracked in
+ * peer->v_keepalive_drift, which keeps the worst seen.
  */
-static void peer_process(struct hash_bucket *hb, void *arg)
+static void peer_process(struct pkat *pkat, const struct timeval *now)
 {
-	struct pkat *pkat = hb->data;
-
-	struct timeval *next_update = arg;
-
-	static struct timeval elapsed;  // elapsed time since keepalive
-	static struct timeval ka = {0}; // peer->v_keepalive as a timeval
-	static struct timeval diff;     // ka - elapsed
-
-	static const struct timeval tolerance = {0, 100000};
-
+	struct timeval due, limit, drift;
 	uint32_t v_ka = atomic_load_explicit(&pkat->peer->v_keepalive,
 					     memory_order_relaxed);
+	uint32_t drift_us;
 
 	/* 0 keepalive timer means no keepalives */
-	if (v_ka == 0)
+	if (v_ka == 0) {
+		timeradd(now, &pkat_recheck, &pkat->next);
 		return;
+	}
 
-	/* calculate elapsed time since last keepalive */
-	monotime_since(&pkat->last, &elapsed);
-
-	/* calculate difference between elapsed time and configured time */
-	ka.tv_sec = v_ka;
-	timersub(&ka, &elapsed, &diff);
-
-	int send_keepalive =
-		elapsed.tv_sec >= ka.tv_sec || timercmp(&diff, &tolerance, <);
-
-	if (send_keepalive) {
-		if (bgp_debug_neighbor_events(pkat->peer))
-			zlog_debug("%s [FSM] Timer (keepalive timer expire)",
-				   pkat->peer->host);
+	/* the timer may have changed since the peer was scheduled */
+	due.tv_sec = pkat->last.tv_sec + v_ka;
+	due.tv_usec = pkat->last.tv_usec;
+	timeradd(now, &tolerance, &limit);
+	if (timercmp(&due, &limit, >)) {
+		pkat->next = due;
+		return;
+	}
 
-		bgp_keepalive_send(pkat->peer);
-		monotime(&pkat->last);
-		memset(&elapsed, 0x00, sizeof(struct timeval));
-		diff = ka;
+	if (bgp_debug_neighbor_events(pkat->peer))
+		zlog_debug("%s [FSM] Timer (keepalive timer expire)",
+			   pkat->peer->host);
+
+	bgp_keepalive_send(pkat->peer);
+
+	if (timercmp(now, &due, >)) {
+		timersub(now, &due, &drift);
+		drift_us = MIN(drift.tv_sec, UINT32_MAX / 1000000) * 1000000
+			   + drift.tv_usec;
+		if (drift_us > atomic_load_explicit(
+				       &pkat->peer->v_keepalive_drift,
+				       memory_order_relaxed))
+			atomic_store_explicit(&pkat->peer->v_keepalive_drift,
+					      drift_us, memory_order_relaxed);
 	}
 
-	/* if calculated next update for this peer < current delay, use it */
-	if (next_update->tv_sec < 0 || timercmp(&diff, next_update, <))
-		*next_update = diff;
+	pkat->last = *now;
+	pkat_schedule(pkat);
 }
 
 static bool peer_hash_cmp(const void *f, const void *s)
@@ -148,6 +180,9 @@ static unsigned int peer_hash_key(const void *arg)
 static void bgp_keepalives_finish(void *arg)
 {
 	if (peerhash) {
+		while (pkat_heap_pop(&peerheap))
+			;
+		pkat_heap_fini(&peerheap);
 		hash_clean(peerhash, pkat_del);
 		hash_free(peerhash);
 	}
@@ -171,9 +206,9 @@ void *bgp_keepalives_start(void *arg)
 	fpt->master->owner = pthread_self();
 
 	struct timeval currtime = {0, 0};
-	struct timeval aftertime = {0, 0};
-	struct timeval next_update = {0, 0};
+	struct timeval limit;
 	struct timespec next_update_ts = {0, 0};
+	struct pkat *pkat;
 
 	peerhash_mtx = XCALLOC(MTYPE_TMP, sizeof(pthread_mutex_t));
 	peerhash_cond = XCALLOC(MTYPE_TMP, sizeof(pthread_cond_t));
@@ -196,6 +231,7 @@ void *bgp_keepalives_start(void *arg)
 
 	/* initialize peer hashtable */
 	peerhash = hash_create_size(2048, peer_hash_key, peer_hash_cmp, NULL);
+	pkat_heap_init(&peerheap);
 	pthread_mutex_lock(peerhash_mtx);
 
 	/* register cleanup handler */
@@ -215,17 +251,17 @@ void *bgp_keepalives_start(void *arg)
 				pthread_cond_wait(peerhash_cond, peerhash_mtx);
 
 		monotime(&currtime);
+		timeradd(&currtime, &tolerance, &limit);
 
-		next_update.tv_sec = -1;
-
-		hash_iterate(peerhash, peer_process, &next_update);
-		if (next_update.tv_sec == -1)
-			memset(&next_update, 0x00, sizeof(next_update));
-
-		monotime_since(&currtime, &aftertime);
+		while ((pkat = pkat_heap_first(&peerheap))
+		       && timercmp(&pkat->next, &limit, <)) {
+			pkat_heap_pop(&peerheap);
+			peer_process(pkat, &currtime);
+			pkat_heap_add(&peerheap, pkat);
+		}
 
-		timeradd(&currtime, &next_update, &next_update);
-		TIMEVAL_TO_TIMESPEC(&next_update, &next_update_ts);
+		if (pkat)
+			TIMEVAL_TO_TIMESPEC(&pkat->next, &next_update_ts);
 	}
 
 	/* clean up */
@@ -257,6 +293,9 @@ void bgp_keepalives_on(struct peer *peer)
 		if (!hash_lookup(peerhash, &holder)) {
 			struct pkat *pkat = pkat_new(peer);
 			hash_get(peerhash, pkat, hash_alloc_intern);
+			pkat_heap_add(&peerheap, pkat);
+			atomic_store_explicit(&peer->v_keepalive_drift, 0,
+					      memory_order_relaxed);
 			peer_lock(peer);
 		}
 		SET_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON);
@@ -284,6 +323,7 @@ void bgp_keepalives_off(struct peer *peer)
 		holder.peer = peer;
 		struct pkat *res = hash_release(peerhash, &holder);
 		if (res) {
+			pkat_heap_del(&peerheap, res);
 			pkat_del(res);
 			peer_unlock(peer);
 		}
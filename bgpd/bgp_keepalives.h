@@ -64,8 +64,9 @@ extern void bgp_keepalives_init(void);
 /**
  * Entry function for keepalives pthread.
  *
- * This function loops over an internal list of peers, generating keepalives at
- * regular intervals as determined by each peer's keepalive timer.
+ * This function sleeps until the next peer on an internal list is due,
+ * generating keepalives at regular intervals as determined by each peer's
+ * keepalive timer.  Each wakeup only touches the peers that are due.
  *
  * See bgp_keepalives_on() for additional details.
  *
@@ -30,6 +30,8 @@
 #include "workqueue.h"
 #include "zclient.h"
 #include "mpls.h"
+#include "command.h"
+#include "lib/json.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_labelpool.h"
@@ -47,8 +49,18 @@ extern struct zclient *zclient;
  */
 static struct labelpool *lp;
 
-/* request this many labels at a time from zebra */
-#define LP_CHUNK_SIZE	50
+/*
+ * Chunk size requested from zebra. It starts small and doubles each time
+ * a new chunk is needed within LP_CHUNK_GROW_SECS of the previous request,
+ * so that bulk allocations (e.g. per-prefix VPN labels at startup) need
+ * few round trips to the label manager.
+ */
+#define LP_CHUNK_SIZE		50
+#define LP_CHUNK_SIZE_MAX	8192
+#define LP_CHUNK_GROW_SECS	2
+
+/* return fully unused chunks to zebra after this long */
+#define LP_RELEASE_DELAY_SECS	30
 
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_CHUNK, "BGP Label Chunk")
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_FIFO, "BGP Label FIFO item")
@@ -56,10 +68,25 @@ DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_CB, "BGP Dynamic Label Assignment")
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_CBQ, "BGP Dynamic Label Callback")
 
 struct lp_chunk {
+	struct lp_chunks_item	item;		/* lp->chunks */
+	struct lp_avail_item	avail_item;	/* lp->avail if nfree != 0 */
 	uint32_t	first;
 	uint32_t	last;
+	uint32_t	nfree;
+	uint32_t	hint;		/* word to start searching from */
+	uint64_t	*used;		/* bit set = label allocated */
 };
 
+static int lp_chunks_cmp(const struct lp_chunk *a, const struct lp_chunk *b)
+{
+	return numcmp(a->first, b->first);
+}
+
+DECLARE_RBTREE_UNIQ(lp_chunks, struct lp_chunk, item, lp_chunks_cmp)
+DECLARE_DLIST(lp_avail, struct lp_chunk, avail_item)
+
+#define LP_CHUNK_WORDS(chunk) (((chunk)->last - (chunk)->first) / 64 + 1)
+
 /*
  * label control block
  */
@@ -90,6 +117,115 @@ struct lp_cbq_item {
 	bool		allocated;	/* false = lost */
 };
 
+static struct lp_chunk *lp_chunk_new(uint32_t first, uint32_t last)
+{
+	struct lp_chunk *chunk;
+	uint32_t size = last - first + 1;
+
+	chunk = XCALLOC(MTYPE_BGP_LABEL_CHUNK, sizeof(struct lp_chunk));
+	chunk->first = first;
+	chunk->last = last;
+	chunk->nfree = size;
+	chunk->used = XCALLOC(MTYPE_BGP_LABEL_CHUNK,
+			      LP_CHUNK_WORDS(chunk) * sizeof(uint64_t));
+
+	/* bits past the end of the chunk are never handed out */
+	if (size % 64)
+		chunk->used[LP_CHUNK_WORDS(chunk) - 1] = ~0ULL << (size % 64);
+
+	return chunk;
+}
+
+static void lp_chunk_free(struct lp_chunk *chunk)
+{
+	XFREE(MTYPE_BGP_LABEL_CHUNK, chunk->used);
+	XFREE(MTYPE_BGP_LABEL_CHUNK, chunk);
+}
+
+static void lp_chunks_flush(void)
+{
+	struct lp_chunk *chunk;
+
+	while ((chunk = lp_avail_pop(&lp->avail)))
+		;
+	while ((chunk = lp_chunks_pop(&lp->chunks)))
+		lp_chunk_free(chunk);
+	lp->free_count = 0;
+}
+
+/* chunk containing the label, if any */
+static struct lp_chunk *lp_chunk_find(mpls_label_t label)
+{
+	struct lp_chunk ref, *chunk;
+
+	ref.first = label + 1;
+	chunk = lp_chunks_find_lt(&lp->chunks, &ref);
+	if (!chunk || label > chunk->last)
+		return NULL;
+	return chunk;
+}
+
+/*
+ * Give up chunks nobody has allocated from, keeping enough free labels
+ * around for the next burst.  Chunks are returned in one go from a timer
+ * rather than each time a label is released.
+ */
+static int lp_release_idle_chunks(struct thread *thread)
+{
+	struct lp_chunk *chunk;
+	uint32_t size;
+
+	frr_each_safe (lp_chunks, &lp->chunks, chunk) {
+		size = chunk->last - chunk->first + 1;
+		if (chunk->nfree != size)
+			continue;
+		if (lp->free_count - size < lp->next_chunksize)
+			continue;
+		if (!zclient || zclient->sock < 0)
+			break;
+		if (zclient_send_release_label_chunk(zclient, chunk->first,
+						     chunk->last)
+		    == ZCLIENT_SEND_FAILURE)
+			break;
+
+		if (BGP_DEBUG(labelpool, LABELPOOL))
+			zlog_debug("%s: released chunk %u-%u", __func__,
+				   chunk->first, chunk->last);
+
+		lp_avail_del(&lp->avail, chunk);
+		lp_chunks_del(&lp->chunks, chunk);
+		lp->free_count -= size;
+		lp->released_chunks++;
+		lp_chunk_free(chunk);
+	}
+
+	return 0;
+}
+
+/* return a label to its chunk */
+static void lp_label_free(mpls_label_t label)
+{
+	struct lp_chunk *chunk = lp_chunk_find(label);
+	uint32_t bit;
+
+	if (!chunk)
+		return;
+
+	bit = label - chunk->first;
+	if (!(chunk->used[bit / 64] & (1ULL << (bit % 64))))
+		return;
+
+	chunk->used[bit / 64] &= ~(1ULL << (bit % 64));
+	if (!chunk->nfree++)
+		lp_avail_add_tail(&lp->avail, chunk);
+	lp->free_count++;
+
+	if (chunk->nfree == chunk->last - chunk->first + 1
+	    && lp->free_count > 2 * lp->next_chunksize)
+		thread_add_timer(bm->master, lp_release_idle_chunks, NULL,
+				 LP_RELEASE_DELAY_SECS, &lp->t_release);
+}
+
 static wq_item_status lp_cbq_docallback(struct work_queue *wq, void *data)
 {
 	struct lp_cbq_item *lcbq = data;
@@ -141,6 +277,7 @@ static wq_item_status lp_cbq_docallback(struct work_queue *wq, void *data)
 							labelid, NULL);
 				}
 				skiplist_delete(lp->inuse, (void *)lbl, NULL);
+				lp_label_free(lcbq->label);
 			}
 		}
 	}
@@ -158,11 +295,6 @@ static void lp_lcb_free(void *goner)
 	XFREE(MTYPE_BGP_LABEL_CB, goner);
 }
 
-static void lp_chunk_free(void *goner)
-{
-	XFREE(MTYPE_BGP_LABEL_CHUNK, goner);
-}
-
 void bgp_lp_init(struct thread_master *master, struct labelpool *pool)
 {
 	if (BGP_DEBUG(labelpool, LABELPOOL))
@@ -172,8 +304,9 @@ void bgp_lp_init(struct thread_master *master, struct labelpool *pool)
 
 	lp->ledger = skiplist_new(0, NULL, lp_lcb_free);
 	lp->inuse = skiplist_new(0, NULL, NULL);
-	lp->chunks = list_new();
-	lp->chunks->del = lp_chunk_free;
+	lp_chunks_init(&lp->chunks);
+	lp_avail_init(&lp->avail);
+	lp->next_chunksize = LP_CHUNK_SIZE;
 	lp_fifo_init(&lp->requests);
 	lp->callback_q = work_queue_new(master, "label callbacks");
 
@@ -210,7 +343,11 @@ void bgp_lp_finish(void)
 	skiplist_free(lp->inuse);
 	lp->inuse = NULL;
 
-	list_delete(&lp->chunks);
+	THREAD_OFF(lp->t_release);
+
+	lp_chunks_flush();
+	lp_avail_fini(&lp->avail);
+	lp_chunks_fini(&lp->chunks);
 
 	while ((lf = lp_fifo_pop(&lp->requests))) {
 		check_bgp_lu_cb_unlock(&lf->lcb);
@@ -232,34 +369,87 @@ void bgp_lp_finish(void)
 	lp = NULL;
 }
 
+/*
+ * Ask zebra for another chunk.  The size grows while chunks are being
+ * used up quickly; "needed" is the number of labels we know we are short.
+ */
+static void lp_chunk_request(uint32_t needed)
+{
+	time_t now = monotime(NULL);
+	uint32_t size;
+
+	if (!zclient || zclient->sock < 0)
+		return;
+
+	if (lp->last_request && now - lp->last_request < LP_CHUNK_GROW_SECS
+	    && lp->next_chunksize < LP_CHUNK_SIZE_MAX)
+		lp->next_chunksize *= 2;
+	lp->last_request = now;
+
+	size = lp->next_chunksize;
+	while (size < needed)
+		size += lp->next_chunksize;
+
+	if (BGP_DEBUG(labelpool, LABELPOOL))
+		zlog_debug("%s: requesting chunk of %u labels", __func__, size);
+
+	if (zclient_send_get_label_chunk(zclient, 0, size,
+					 MPLS_LABEL_BASE_ANY)
+	    != ZCLIENT_SEND_FAILURE)
+		lp->pending_count += size;
+}
+
+/*
+ * Take a label from the first chunk that has one; chunks without free
+ * labels are not on lp->avail, and the word search starts where the last
+ * allocation in the chunk was made.
+ */
 static mpls_label_t get_label_from_pool(void *labelid)
 {
-	struct listnode *node;
 	struct lp_chunk *chunk;
-	int debug = BGP_DEBUG(labelpool, LABELPOOL);
-
-	/*
-	 * Find a free label
-	 * Linear search is not efficient but should be executed infrequently.
-	 */
-	for (ALL_LIST_ELEMENTS_RO(lp->chunks, node, chunk)) {
-		uintptr_t lbl;
+	uint32_t words, w, i;
+	uint64_t bits;
+	uintptr_t lbl;
+
+	chunk = lp_avail_first(&lp->avail);
+	if (!chunk)
+		return MPLS_LABEL_NONE;
+
+	words = LP_CHUNK_WORDS(chunk);
+	for (i = 0; i < words; i++) {
+		w = (chunk->hint + i) % words;
+		bits = ~chunk->used[w];
+		if (bits)
+			break;
+	}
+	if (i == words) {
+		/* shouldn't happen, nfree is out of sync */
+		flog_err(EC_BGP_LABEL, "%s: chunk %u-%u has no free label",
+			 __func__, chunk->first, chunk->last);
+		lp_avail_del(&lp->avail, chunk);
+		return MPLS_LABEL_NONE;
+	}
 
-		if (debug)
-			zlog_debug("%s: chunk first=%u last=%u",
-				__func__, chunk->first, chunk->last);
+	lbl = chunk->first + w * 64 + __builtin_ctzll(bits);
 
-		for (lbl = chunk->first; lbl <= chunk->last; ++lbl) {
-			/* labelid is key to all-request "ledger" list */
-			if (!skiplist_insert(lp->inuse, (void *)lbl, labelid)) {
-				/*
-				 * Success
-				 */
-				return lbl;
-			}
-		}
+	/* labelid is key to all-request "ledger" list */
+	if (skiplist_insert(lp->inuse, (void *)lbl, labelid)) {
+		flog_err(EC_BGP_LABEL, "%s: label %u already in use", __func__,
+			 (mpls_label_t)lbl);
+		return MPLS_LABEL_NONE;
 	}
-	return MPLS_LABEL_NONE;
+
+	chunk->used[w] |= bits & -bits;
+	chunk->hint = w;
+	if (!--chunk->nfree)
+		lp_avail_del(&lp->avail, chunk);
+	lp->free_count--;
+
+	/* running low: fetch the next chunk before requests have to block */
+	if (!lp->pending_count && lp->free_count < lp->next_chunksize / 4)
+		lp_chunk_request(0);
+
+	return lbl;
 }
 
 /*
@@ -389,14 +579,9 @@ void bgp_lp_get(
 
 	lp_fifo_add_tail(&lp->requests, lf);
 
-	if (lp_fifo_count(&lp->requests) > lp->pending_count) {
-		if (!zclient || zclient->sock < 0)
-			return;
-		if (zclient_send_get_label_chunk(zclient, 0, LP_CHUNK_SIZE,
-						 MPLS_LABEL_BASE_ANY)
-		    == ZCLIENT_SEND_FAILURE)
-			lp->pending_count += LP_CHUNK_SIZE;
-	}
+	if (lp_fifo_count(&lp->requests) > lp->pending_count)
+		lp_chunk_request(lp_fifo_count(&lp->requests)
+				 - lp->pending_count);
 }
 
 void bgp_lp_release(
@@ -411,7 +596,8 @@ void bgp_lp_release(
 			uintptr_t lbl = label;
 
 			/* no longer in use */
-			skiplist_delete(lp->inuse, (void *)lbl, NULL);
+			if (!skiplist_delete(lp->inuse, (void *)lbl, NULL))
+				lp_label_free(label);
 
 			/* no longer requested */
 			skiplist_delete(lp->ledger, labelid, NULL);
@@ -435,14 +621,22 @@ void bgp_lp_event_chunk(uint8_t keep, uint32_t first, uint32_t last)
 		return;
 	}
 
-	chunk = XCALLOC(MTYPE_BGP_LABEL_CHUNK, sizeof(struct lp_chunk));
-
-	chunk->first = first;
-	chunk->last = last;
+	if (lp_chunk_find(first) || lp_chunk_find(last)) {
+		flog_err(EC_BGP_LABEL,
+			 "%s: zebra label chunk overlaps: first=%u, last=%u",
+			 __func__, first, last);
+		return;
+	}
 
-	listnode_add(lp->chunks, chunk);
+	chunk = lp_chunk_new(first, last);
+	lp_chunks_add(&lp->chunks, chunk);
+	lp_avail_add_tail(&lp->avail, chunk);
+	lp->free_count += chunk->nfree;
 
-	lp->pending_count -= (last - first + 1);
+	if (lp->pending_count > last - first + 1)
+		lp->pending_count -= (last - first + 1);
+	else
+		lp->pending_count = 0;
 
 	if (debug) {
 		zlog_debug("%s: %zu pending requests", __func__,
@@ -545,8 +739,8 @@ void bgp_lp_event_zebra_up(void)
 		skiplist_count(lp->inuse);
 
 	/* round up */
-	chunks_needed = (labels_needed / LP_CHUNK_SIZE) + 1;
-	labels_needed = chunks_needed * LP_CHUNK_SIZE;
+	chunks_needed = (labels_needed / lp->next_chunksize) + 1;
+	labels_needed = chunks_needed * lp->next_chunksize;
 
 	lm_init_ok = lm_label_manager_connect(zclient, 1) == 0;
 
@@ -562,7 +756,8 @@ void bgp_lp_event_zebra_up(void)
 	/*
 	 * Invalidate current list of chunks
 	 */
-	list_delete_all_node(lp->chunks);
+	THREAD_OFF(lp->t_release);
+	lp_chunks_flush();
 
 	/*
 	 * Invalidate any existing labels and requeue them as requests
@@ -607,3 +802,61 @@ void bgp_lp_event_zebra_up(void)
 		skiplist_delete_first(lp->inuse);
 	}
 }
+
+DEFUN(show_bgp_labelpool_summary, show_bgp_labelpool_summary_cmd,
+      "show bgp labelpool summary [json]",
+      SHOW_STR BGP_STR
+      "BGP Labelpool information\n"
+      "BGP Labelpool summary\n"
+      JSON_STR)
+{
+	bool uj = use_json(argc, argv);
+	json_object *json = NULL;
+
+	if (!lp) {
+		if (uj)
+			vty_out(vty, "{}\n");
+		else
+			vty_out(vty, "No existing BGP labelpool\n");
+		return CMD_WARNING;
+	}
+
+	if (uj) {
+		json = json_object_new_object();
+		json_object_int_add(json, "ledger", skiplist_count(lp->ledger));
+		json_object_int_add(json, "inUse", skiplist_count(lp->inuse));
+		json_object_int_add(json, "requests",
+				    lp_fifo_count(&lp->requests));
+		json_object_int_add(json, "labelChunks",
+				    lp_chunks_count(&lp->chunks));
+		json_object_int_add(json, "freeLabels", lp->free_count);
+		json_object_int_add(json, "pending", lp->pending_count);
+		json_object_int_add(json, "nextChunkSize", lp->next_chunksize);
+		json_object_int_add(json, "releasedChunks",
+				    lp->released_chunks);
+		vty_out(vty, "%s\n",
+			json_object_to_json_string_ext(
+				json, JSON_C_TO_STRING_PRETTY));
+		json_object_free(json);
+	} else {
+		vty_out(vty, "Labelpool Summary\n");
+		vty_out(vty, "-----------------\n");
+		vty_out(vty, "%-13s %d\n", "Ledger:", skiplist_count(lp->ledger));
+		vty_out(vty, "%-13s %d\n", "InUse:", skiplist_count(lp->inuse));
+		vty_out(vty, "%-13s %zu\n", "Requests:",
+			lp_fifo_count(&lp->requests));
+		vty_out(vty, "%-13s %zu\n", "LabelChunks:",
+			lp_chunks_count(&lp->chunks));
+		vty_out(vty, "%-13s %u\n", "FreeLabels:", lp->free_count);
+		vty_out(vty, "%-13s %u\n", "Pending:", lp->pending_count);
+		vty_out(vty, "%-13s %u\n", "NextChunk:", lp->next_chunksize);
+		vty_out(vty, "%-13s %u\n", "Released:", lp->released_chunks);
+	}
+
+	return CMD_SUCCESS;
+}
+
+void bgp_lp_vty_init(void)
+{
+	install_element(VIEW_NODE, &show_bgp_labelpool_summary_cmd);
+}
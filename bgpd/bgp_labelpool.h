@@ -32,14 +32,22 @@
 #define LP_TYPE_BGP_LU	0x00000002
 
 PREDECL_LIST(lp_fifo)
+PREDECL_RBTREE_UNIQ(lp_chunks)
+PREDECL_DLIST(lp_avail)
 
 struct labelpool {
 	struct skiplist		*ledger;	/* all requests */
 	struct skiplist		*inuse;		/* individual labels */
-	struct list		*chunks;	/* granted by zebra */
+	struct lp_chunks_head	chunks;		/* granted by zebra */
+	struct lp_avail_head	avail;		/* chunks with free labels */
 	struct lp_fifo_head	requests;	/* blocked on zebra */
 	struct work_queue	*callback_q;
 	uint32_t		pending_count;	/* requested from zebra */
+	uint32_t		free_count;	/* unused labels in chunks */
+	uint32_t		next_chunksize;	/* size of next request */
+	time_t			last_request;	/* time of last chunk request */
+	struct thread		*t_release;	/* return idle chunks */
+	uint32_t		released_chunks;
 };
 
 extern void bgp_lp_init(struct thread_master *master, struct labelpool *pool);
@@ -50,5 +58,6 @@ extern void bgp_lp_release(int type, void *labelid, mpls_label_t label);
 extern void bgp_lp_event_chunk(uint8_t keep, uint32_t first, uint32_t last);
 extern void bgp_lp_event_zebra_down(void);
 extern void bgp_lp_event_zebra_up(void);
+extern void bgp_lp_vty_init(void);
 
 #endif /* _FRR_BGP_LABELPOOL_H */
@@ -30,10 +30,11 @@
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_aspath.h"
 
 /* Hash of community attribute. */
-static struct hash *lcomhash;
+static struct bgp_intern lcomhash;
 
 /* Allocate a new lcommunities.  */
 static struct lcommunity *lcommunity_new(void)
@@ -49,6 +50,7 @@ void lcommunity_free(struct lcommunity **lcom)
 
 	XFREE(MTYPE_LCOMMUNITY_VAL, (*lcom)->val);
 	XFREE(MTYPE_LCOMMUNITY_STR, (*lcom)->str);
+	XFREE(MTYPE_COMMUNITY_LIST_MEMO, (*lcom)->clist_memo);
 	if ((*lcom)->json)
 		json_object_free((*lcom)->json);
 	XFREE(MTYPE_LCOMMUNITY, *lcom);
@@ -254,18 +256,27 @@ static void set_lcommunity_string(struct lcommunity *lcom, bool make_json)
 struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 {
 	struct lcommunity *find;
+	struct bgp_intern_stripe *st;
+	unsigned int key;
 
 	assert(lcom->refcnt == 0);
 
-	find = (struct lcommunity *)hash_get(lcomhash, lcom, hash_alloc_intern);
+	/* Hash once, for the stripe, the lookup and the release */
+	lcom->hash = lcommunity_hash_make(lcom);
 
-	if (find != lcom)
-		lcommunity_free(&lcom);
+	key = bgp_intern_key(&lcomhash, lcom);
+	st = bgp_intern_stripe(&lcomhash, key);
+	frr_with_mutex (&st->mtx) {
+		find = (struct lcommunity *)hash_get_with_key(
+			st->hash, lcom, key, hash_alloc_intern);
+		bgp_intern_ref(&find->refcnt);
 
-	find->refcnt++;
+		if (!find->str)
+			set_lcommunity_string(find, false);
+	}
 
-	if (!find->str)
-		set_lcommunity_string(find, false);
+	if (find != lcom)
+		lcommunity_free(&lcom);
 
 	return find;
 }
@@ -273,19 +284,9 @@ struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 /* Unintern Large Communities Attribute.  */
 void lcommunity_unintern(struct lcommunity **lcom)
 {
-	struct lcommunity *ret;
-
-	if ((*lcom)->refcnt)
-		(*lcom)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*lcom)->refcnt == 0) {
-		/* Large community must be in the hash.  */
-		ret = (struct lcommunity *)hash_release(lcomhash, *lcom);
-		assert(ret != NULL);
-
+	/* Pull off from hash on the last reference.  */
+	if (bgp_intern_release(&lcomhash, *lcom, &(*lcom)->refcnt))
 		lcommunity_free(lcom);
-	}
 }
 
 /* Retrun string representation of communities attribute. */
@@ -309,6 +310,9 @@ unsigned int lcommunity_hash_make(const void *arg)
 	const struct lcommunity *lcom = arg;
 	int size = lcom_length(lcom);
 
+	if (lcom->hash)
+		return lcom->hash;
+
 	return jhash(lcom->val, size, 0xab125423);
 }
 
@@ -324,28 +328,32 @@ bool lcommunity_cmp(const void *arg1, const void *arg2)
 	if (lcom1 == NULL || lcom2 == NULL)
 		return false;
 
+	/* Differing hash keys settle it without looking at the values */
+	if (lcom1->hash && lcom2->hash && lcom1->hash != lcom2->hash)
+		return false;
+
 	return (lcom1->size == lcom2->size
 		&& memcmp(lcom1->val, lcom2->val, lcom_length(lcom1)) == 0);
 }
 
 /* Return communities hash.  */
-struct hash *lcommunity_hash(void)
+struct bgp_intern *lcommunity_hash(void)
 {
-	return lcomhash;
+	return &lcomhash;
 }
 
 /* Initialize Large Comminities related hash. */
 void lcommunity_init(void)
 {
-	lcomhash = hash_create(lcommunity_hash_make, lcommunity_cmp,
-			       "BGP lcommunity hash");
+	bgp_intern_init(&lcomhash, hash_create_size, HASH_INITIAL_SIZE,
+			lcommunity_hash_make, lcommunity_cmp,
+			"BGP lcommunity hash");
 }
 
 void lcommunity_finish(void)
 {
-	hash_clean(lcomhash, (void (*)(void *))lcommunity_hash_free);
-	hash_free(lcomhash);
-	lcomhash = NULL;
+	bgp_intern_finish(&lcomhash,
+			  (void (*)(void *))lcommunity_hash_free);
 }
 
 /* Large Communities token enum. */
@@ -577,9 +585,29 @@ void bgp_aggr_lcommunity_remove(void *arg)
 void bgp_compute_aggregate_lcommunity(struct bgp_aggregate *aggregate,
 				      struct lcommunity *lcommunity)
 {
+	struct lcommunity *aggr_lcommunity;
+	struct lcommunity *lcommerge;
+
+	if ((aggregate == NULL) || (lcommunity == NULL))
+		return;
 
 	bgp_compute_aggregate_lcommunity_hash(aggregate, lcommunity);
-	bgp_compute_aggregate_lcommunity_val(aggregate);
+
+	/* Only a large community not seen before among the aggregated
+	 * routes changes the union; merge just that one in.
+	 */
+	aggr_lcommunity = bgp_aggr_lcommunity_lookup(aggregate, lcommunity);
+	if (!aggr_lcommunity || aggr_lcommunity->refcnt > 1)
+		return;
+
+	if (!aggregate->lcommunity) {
+		bgp_compute_aggregate_lcommunity_val(aggregate);
+		return;
+	}
+
+	lcommerge = lcommunity_merge(aggregate->lcommunity, aggr_lcommunity);
+	aggregate->lcommunity = lcommunity_uniq_sort(lcommerge);
+	lcommunity_free(&lcommerge);
 }
 
 void bgp_compute_aggregate_lcommunity_hash(struct bgp_aggregate *aggregate,
@@ -24,17 +24,22 @@
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 
+struct bgp_intern;
+
 /* Large Communities value is twelve octets long.  */
 #define LCOMMUNITY_SIZE                        12
 
 /* Large Communities attribute.  */
 struct lcommunity {
 	/* Reference counter.  */
-	unsigned long refcnt;
+	atomic_size_t refcnt;
 
 	/* Size of Extended Communities attribute.  */
 	int size;
 
+	/* Hash key, set once interned; 0 means not computed. */
+	uint32_t hash;
+
 	/* Large Communities value.  */
 	uint8_t *val;
 
@@ -43,6 +48,9 @@ struct lcommunity {
 
 	/* Human readable format string.  */
 	char *str;
+
+	/* community-list results, only for interned values */
+	struct community_list_memo *clist_memo;
 };
 
 /* Large community value is 12 octets.  */
@@ -64,7 +72,7 @@ extern struct lcommunity *lcommunity_intern(struct lcommunity *);
 extern bool lcommunity_cmp(const void *arg1, const void *arg2);
 extern void lcommunity_unintern(struct lcommunity **);
 extern unsigned int lcommunity_hash_make(const void *);
-extern struct hash *lcommunity_hash(void);
+extern struct bgp_intern *lcommunity_hash(void);
 extern struct lcommunity *lcommunity_str2com(const char *);
 extern bool lcommunity_match(const struct lcommunity *,
 			     const struct lcommunity *);
@@ -59,16 +59,22 @@
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_network.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_select.h"
 #include "bgpd/bgp_errors.h"
 #include "lib/routing_nb.h"
 #include "bgpd/bgp_nb.h"
 #include "bgpd/bgp_evpn_mh.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_journal.h"
 
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/rfapi_backend.h"
 #endif
 
+#define OPTION_ADJ_RIB_IN_JOURNAL 2000
+
 /* bgpd options, we use GNU getopt library. */
 static const struct option longopts[] = {
 	{"bgp_port", required_argument, NULL, 'p'},
@@ -79,6 +85,10 @@ static const struct option longopts[] = {
 	{"int_num", required_argument, NULL, 'I'},
 	{"no_zebra", no_argument, NULL, 'Z'},
 	{"socket_size", required_argument, NULL, 's'},
+	{"parse_threads", required_argument, NULL, 'T'},
+	{"select_threads", required_argument, NULL, 'B'},
+	{"adj-rib-in-journal", required_argument, NULL,
+	 OPTION_ADJ_RIB_IN_JOURNAL},
 	{0}};
 
 /* signal definitions */
@@ -211,10 +221,14 @@ static __attribute__((__noreturn__)) void bgp_exit(int status)
 
 	bgp_evpn_mh_finish();
 	bgp_l3nhg_finish();
+	bgp_mplsvpn_finish();
 
 	/* reverse bgp_dump_init */
 	bgp_dump_finish();
 
+	/* reverse bgp_journal_init */
+	bgp_journal_finish();
+
 	/* reverse bgp_route_init */
 	bgp_route_finish();
 
@@ -410,10 +424,17 @@ int main(int argc, char **argv)
 	int skip_runas = 0;
 	int instance = 0;
 	int buffer_size = BGP_SOCKET_SNDBUF_SIZE;
+	int parse_threads = -1;
+	int select_threads = -1;
+
+	/* allocated and freed millions of times on a peer flap */
+	qmem_slab_enable(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
+	qmem_slab_enable(MTYPE_BGP_ADJ_OUT, sizeof(struct bgp_adj_out));
+	qmem_slab_enable(MTYPE_BGP_ADVERTISE, sizeof(struct bgp_advertise));
 
 	frr_preinit(&bgpd_di, argc, argv);
 	frr_opt_add(
-		"p:l:SnZe:I:s:" DEPRECATED_OPTIONS, longopts,
+		"p:l:SnZe:I:s:T:B:" DEPRECATED_OPTIONS, longopts,
 		"  -p, --bgp_port     Set BGP listen port number (0 means do not listen).\n"
 		"  -l, --listenon     Listen on specified address (implies -n)\n"
 		"  -n, --no_kernel    Do not install route to kernel.\n"
@@ -421,7 +442,10 @@ int main(int argc, char **argv)
 		"  -S, --skip_runas   Skip capabilities checks, and changing user and group IDs.\n"
 		"  -e, --ecmp         Specify ECMP to use.\n"
 		"  -I, --int_num      Set instance number (label-manager)\n"
-		"  -s, --socket_size  Set BGP peer socket send buffer size\n");
+		"  -s, --socket_size  Set BGP peer socket send buffer size\n"
+		"  -T, --parse_threads Number of UPDATE parsing pthreads\n"
+		"  -B, --select_threads Number of best-path selection pthreads\n"
+		"      --adj-rib-in-journal Persist Adj-RIB-In to this file for warm restart\n");
 
 	/* Command line argument treatment. */
 	while (1) {
@@ -484,6 +508,29 @@ int main(int argc, char **argv)
 		case 's':
 			buffer_size = atoi(optarg);
 			break;
+		case 'T':
+			parse_threads = atoi(optarg);
+			if (parse_threads < 0
+			    || parse_threads > BGP_PARSE_THREADS_MAX) {
+				zlog_err(
+					"Number of parse threads must be between 0 and %u",
+					BGP_PARSE_THREADS_MAX);
+				return 1;
+			}
+			break;
+		case 'B':
+			select_threads = atoi(optarg);
+			if (select_threads < 0
+			    || select_threads > BGP_SELECT_THREADS_MAX) {
+				zlog_err(
+					"Number of select threads must be between 0 and %u",
+					BGP_SELECT_THREADS_MAX);
+				return 1;
+			}
+			break;
+		case OPTION_ADJ_RIB_IN_JOURNAL:
+			bgp_journal_path = optarg;
+			break;
 		default:
 			frr_help_exit(1);
 			break;
@@ -498,6 +545,8 @@ int main(int argc, char **argv)
 	if (bgp_port == 0)
 		bgp_option_set(BGP_OPT_NO_LISTEN);
 	bm->address = bgp_address;
+	bm->parse_threads = parse_threads;
+	bm->select_threads = select_threads;
 	if (no_fib_flag || no_zebra_flag)
 		bgp_option_set(BGP_OPT_NO_FIB);
 	if (no_zebra_flag)
@@ -512,6 +561,9 @@ int main(int argc, char **argv)
 
 	/* BGP related initialization.  */
 	bgp_init((unsigned short)instance);
+	bgp_journal_init();
+	/* with vtysh -b, the configuration arrives after the fork */
+	cmd_init_config_callbacks(NULL, bgp_journal_load);
 
 	snprintf(bgpd_di.startinfo, sizeof(bgpd_di.startinfo), ", bgp@%s:%d",
 		 (bm->address ? bm->address : "<all>"), bm->port);
@@ -519,6 +571,7 @@ int main(int argc, char **argv)
 	frr_config_fork();
 	/* must be called after fork() */
 	bgp_gr_apply_running_config();
+	bgp_journal_load();
 	bgp_pthreads_run();
 	frr_run(bm->master);
 
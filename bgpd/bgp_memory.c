@@ -41,6 +41,9 @@ DEFINE_MTYPE(BGPD, PEER_PASSWORD, "Peer password string")
 DEFINE_MTYPE(BGPD, BGP_PEER_AF, "BGP peer af")
 DEFINE_MTYPE(BGPD, BGP_UPDGRP, "BGP update group")
 DEFINE_MTYPE(BGPD, BGP_UPD_SUBGRP, "BGP update subgroup")
+DEFINE_MTYPE(BGPD, BGP_UPDGRP_ATTR_TMPL, "BGP update-group attribute template")
+DEFINE_MTYPE(BGPD, BGP_UPDGRP_EXPORT, "BGP update-group export cache")
+DEFINE_MTYPE(BGPD, BGP_IO_URING, "BGP io_uring state")
 DEFINE_MTYPE(BGPD, BGP_PACKET, "BGP packet")
 DEFINE_MTYPE(BGPD, ATTR, "BGP attribute")
 DEFINE_MTYPE(BGPD, AS_PATH, "BGP aspath")
@@ -59,11 +62,13 @@ DEFINE_MTYPE(BGPD, BGP_ADVERTISE, "BGP adv")
 DEFINE_MTYPE(BGPD, BGP_SYNCHRONISE, "BGP synchronise")
 DEFINE_MTYPE(BGPD, BGP_ADJ_IN, "BGP adj in")
 DEFINE_MTYPE(BGPD, BGP_ADJ_OUT, "BGP adj out")
+DEFINE_MTYPE(BGPD, BGP_ADJ_OUT_INDEX, "BGP adj out index")
 DEFINE_MTYPE(BGPD, BGP_MPATH_INFO, "BGP multipath info")
 
 DEFINE_MTYPE(BGPD, AS_LIST, "BGP AS list")
 DEFINE_MTYPE(BGPD, AS_FILTER, "BGP AS filter")
 DEFINE_MTYPE(BGPD, AS_FILTER_STR, "BGP AS filter str")
+DEFINE_MTYPE(BGPD, AS_FILTER_MEMO, "BGP AS filter results")
 
 DEFINE_MTYPE(BGPD, COMMUNITY, "community")
 DEFINE_MTYPE(BGPD, COMMUNITY_VAL, "community val")
@@ -72,17 +77,22 @@ DEFINE_MTYPE(BGPD, COMMUNITY_STR, "community str")
 DEFINE_MTYPE(BGPD, ECOMMUNITY, "extcommunity")
 DEFINE_MTYPE(BGPD, ECOMMUNITY_VAL, "extcommunity val")
 DEFINE_MTYPE(BGPD, ECOMMUNITY_STR, "extcommunity str")
+DEFINE_MTYPE(BGPD, BGP_VPN_RT_INDEX, "BGP VPN route-target index")
 
 DEFINE_MTYPE(BGPD, COMMUNITY_LIST, "community-list")
 DEFINE_MTYPE(BGPD, COMMUNITY_LIST_NAME, "community-list name")
 DEFINE_MTYPE(BGPD, COMMUNITY_LIST_ENTRY, "community-list entry")
 DEFINE_MTYPE(BGPD, COMMUNITY_LIST_CONFIG, "community-list config")
 DEFINE_MTYPE(BGPD, COMMUNITY_LIST_HANDLER, "community-list handler")
+DEFINE_MTYPE(BGPD, COMMUNITY_LIST_COMPILED, "community-list compiled")
+DEFINE_MTYPE(BGPD, COMMUNITY_LIST_MEMO, "community-list results")
 
 DEFINE_MTYPE(BGPD, CLUSTER, "Cluster list")
 DEFINE_MTYPE(BGPD, CLUSTER_VAL, "Cluster list val")
 
 DEFINE_MTYPE(BGPD, BGP_PROCESS_QUEUE, "BGP Process queue")
+DEFINE_MTYPE(BGPD, BGP_PROCESS_SELECT, "BGP Process selection batch")
+DEFINE_MTYPE(BGPD, BGP_SOFT_RECONFIG, "BGP soft reconfiguration job")
 DEFINE_MTYPE(BGPD, BGP_CLEAR_NODE_QUEUE, "BGP node clear queue")
 
 DEFINE_MTYPE(BGPD, TRANSIT, "BGP transit attr")
@@ -99,7 +109,9 @@ DEFINE_MTYPE(BGPD, PEER_CONF_IF, "BGP peer config interface")
 DEFINE_MTYPE(BGPD, BGP_DAMP_INFO, "Dampening info")
 DEFINE_MTYPE(BGPD, BGP_DAMP_ARRAY, "BGP Dampening array")
 DEFINE_MTYPE(BGPD, BGP_REGEXP, "BGP regexp")
+DEFINE_MTYPE(BGPD, BGP_REGEXP_DFA, "BGP regexp DFA")
 DEFINE_MTYPE(BGPD, BGP_AGGREGATE, "BGP aggregate")
+DEFINE_MTYPE(BGPD, BGP_AGGREGATE_MED, "BGP aggregate MED")
 DEFINE_MTYPE(BGPD, BGP_ADDR, "BGP own address")
 DEFINE_MTYPE(BGPD, TIP_ADDR, "BGP own tunnel-ip address")
 
@@ -136,3 +148,7 @@ DEFINE_MTYPE(BGPD, BGP_FLOWSPEC_INDEX, "BGP flowspec index")
 
 DEFINE_MTYPE(BGPD, BGP_SRV6_L3VPN, "BGP prefix-sid srv6 l3vpn servcie")
 DEFINE_MTYPE(BGPD, BGP_SRV6_VPN, "BGP prefix-sid srv6 vpn service")
+
+DEFINE_MTYPE(BGPD, BGP_ATTR_EVPN, "BGP attribute EVPN fields")
+
+DEFINE_MTYPE(BGPD, BGP_FIB_INTENT, "BGP FIB install intent")
@@ -37,6 +37,9 @@ DECLARE_MTYPE(PEER_PASSWORD)
 DECLARE_MTYPE(BGP_PEER_AF)
 DECLARE_MTYPE(BGP_UPDGRP)
 DECLARE_MTYPE(BGP_UPD_SUBGRP)
+DECLARE_MTYPE(BGP_UPDGRP_ATTR_TMPL)
+DECLARE_MTYPE(BGP_UPDGRP_EXPORT)
+DECLARE_MTYPE(BGP_IO_URING)
 DECLARE_MTYPE(BGP_PACKET)
 DECLARE_MTYPE(ATTR)
 DECLARE_MTYPE(AS_PATH)
@@ -55,11 +58,13 @@ DECLARE_MTYPE(BGP_ADVERTISE)
 DECLARE_MTYPE(BGP_SYNCHRONISE)
 DECLARE_MTYPE(BGP_ADJ_IN)
 DECLARE_MTYPE(BGP_ADJ_OUT)
+DECLARE_MTYPE(BGP_ADJ_OUT_INDEX)
 DECLARE_MTYPE(BGP_MPATH_INFO)
 
 DECLARE_MTYPE(AS_LIST)
 DECLARE_MTYPE(AS_FILTER)
 DECLARE_MTYPE(AS_FILTER_STR)
+DECLARE_MTYPE(AS_FILTER_MEMO)
 
 DECLARE_MTYPE(COMMUNITY)
 DECLARE_MTYPE(COMMUNITY_VAL)
@@ -68,17 +73,22 @@ DECLARE_MTYPE(COMMUNITY_STR)
 DECLARE_MTYPE(ECOMMUNITY)
 DECLARE_MTYPE(ECOMMUNITY_VAL)
 DECLARE_MTYPE(ECOMMUNITY_STR)
+DECLARE_MTYPE(BGP_VPN_RT_INDEX)
 
 DECLARE_MTYPE(COMMUNITY_LIST)
 DECLARE_MTYPE(COMMUNITY_LIST_NAME)
 DECLARE_MTYPE(COMMUNITY_LIST_ENTRY)
 DECLARE_MTYPE(COMMUNITY_LIST_CONFIG)
 DECLARE_MTYPE(COMMUNITY_LIST_HANDLER)
+DECLARE_MTYPE(COMMUNITY_LIST_COMPILED)
+DECLARE_MTYPE(COMMUNITY_LIST_MEMO)
 
 DECLARE_MTYPE(CLUSTER)
 DECLARE_MTYPE(CLUSTER_VAL)
 
 DECLARE_MTYPE(BGP_PROCESS_QUEUE)
+DECLARE_MTYPE(BGP_PROCESS_SELECT)
+DECLARE_MTYPE(BGP_SOFT_RECONFIG)
 DECLARE_MTYPE(BGP_CLEAR_NODE_QUEUE)
 
 DECLARE_MTYPE(TRANSIT)
@@ -95,7 +105,9 @@ DECLARE_MTYPE(PEER_CONF_IF)
 DECLARE_MTYPE(BGP_DAMP_INFO)
 DECLARE_MTYPE(BGP_DAMP_ARRAY)
 DECLARE_MTYPE(BGP_REGEXP)
+DECLARE_MTYPE(BGP_REGEXP_DFA)
 DECLARE_MTYPE(BGP_AGGREGATE)
+DECLARE_MTYPE(BGP_AGGREGATE_MED)
 DECLARE_MTYPE(BGP_ADDR)
 DECLARE_MTYPE(TIP_ADDR)
 
@@ -134,4 +146,8 @@ DECLARE_MTYPE(BGP_FLOWSPEC_INDEX)
 DECLARE_MTYPE(BGP_SRV6_L3VPN)
 DECLARE_MTYPE(BGP_SRV6_VPN)
 
+DECLARE_MTYPE(BGP_ATTR_EVPN)
+
+DECLARE_MTYPE(BGP_FIB_INTENT)
+
 #endif /* _QUAGGA_BGP_MEMORY_H */
@@ -30,6 +30,9 @@
 #include "mpls.h"
 #include "json.h"
 #include "zclient.h"
+#include "hash.h"
+#include "jhash.h"
+#include "thread.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_debug.h"
@@ -437,6 +440,158 @@ static bool ecom_intersect(struct ecommunity *e1, struct ecommunity *e2)
 	return false;
 }
 
+/*
+ * Index from a route-target to the instances importing it from VPN, so
+ * that a VPN route is only offered to the VRFs that can take it.  It is
+ * rebuilt on first use after any import route-target changes.
+ */
+struct vpn_rt_import {
+	uint8_t len;
+	uint8_t val[IPV6_ECOMMUNITY_SIZE];
+
+	/* struct bgp instances importing this RT, per AFI */
+	struct list *vrfs[AFI_MAX];
+};
+
+typedef void (*vpn_rt_import_cb)(struct bgp *bgp_vrf, void *arg);
+
+static struct hash *vpn_rt_index;
+static bool vpn_rt_index_stale = true;
+static uint32_t vpn_rt_index_stamp;
+
+static unsigned int vpn_rt_import_hash_key(const void *p)
+{
+	const struct vpn_rt_import *rti = p;
+
+	return jhash(rti->val, rti->len, 0x5f3759df);
+}
+
+static bool vpn_rt_import_hash_cmp(const void *p1, const void *p2)
+{
+	const struct vpn_rt_import *rti1 = p1;
+	const struct vpn_rt_import *rti2 = p2;
+
+	return rti1->len == rti2->len && !memcmp(rti1->val, rti2->val, rti1->len);
+}
+
+static void *vpn_rt_import_hash_alloc(void *p)
+{
+	const struct vpn_rt_import *key = p;
+	struct vpn_rt_import *rti;
+	afi_t afi;
+
+	rti = XCALLOC(MTYPE_BGP_VPN_RT_INDEX, sizeof(*rti));
+	rti->len = key->len;
+	memcpy(rti->val, key->val, key->len);
+	for (afi = AFI_IP; afi < AFI_MAX; afi++)
+		rti->vrfs[afi] = list_new();
+
+	return rti;
+}
+
+static void vpn_rt_import_free(void *p)
+{
+	struct vpn_rt_import *rti = p;
+	afi_t afi;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++)
+		list_delete(&rti->vrfs[afi]);
+	XFREE(MTYPE_BGP_VPN_RT_INDEX, rti);
+}
+
+void vpn_leak_rt_index_invalidate(void)
+{
+	vpn_rt_index_stale = true;
+}
+
+static void vpn_rt_index_build(void)
+{
+	struct listnode *node;
+	struct bgp *bgp;
+	struct vpn_rt_import key;
+	struct vpn_rt_import *rti;
+	struct ecommunity *ecom;
+	afi_t afi;
+	uint32_t i;
+
+	if (vpn_rt_index)
+		hash_clean(vpn_rt_index, vpn_rt_import_free);
+	else
+		vpn_rt_index = hash_create_size(
+			64, vpn_rt_import_hash_key, vpn_rt_import_hash_cmp,
+			"BGP VPN route-target index");
+
+	vpn_rt_index_stale = false;
+
+	if (!bm->bgp)
+		return;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+			ecom = bgp->vpn_policy[afi]
+				       .rtlist[BGP_VPN_POLICY_DIR_FROMVPN];
+			if (!ecom || ecom->unit_size > sizeof(key.val))
+				continue;
+
+			for (i = 0; i < ecom->size; i++) {
+				key.len = ecom->unit_size;
+				memcpy(key.val, ecom->val + i * ecom->unit_size,
+				       key.len);
+				rti = hash_get(vpn_rt_index, &key,
+					       vpn_rt_import_hash_alloc);
+				if (!listnode_lookup(rti->vrfs[afi], bgp))
+					listnode_add(rti->vrfs[afi], bgp);
+			}
+		}
+	}
+}
+
+/*
+ * Call cb once for each instance importing any of the route-targets in
+ * ecom for afi.  With pending_only, instances not queued for an import
+ * walk are left out.
+ */
+static void vpn_rt_index_walk(struct ecommunity *ecom, afi_t afi,
+			      bool pending_only, vpn_rt_import_cb cb,
+			      void *arg)
+{
+	struct vpn_rt_import key;
+	struct vpn_rt_import *rti;
+	struct listnode *node;
+	struct bgp *bgp;
+	uint32_t stamp;
+	uint32_t i;
+
+	if (!ecom || ecom->unit_size > sizeof(key.val))
+		return;
+
+	if (vpn_rt_index_stale || !vpn_rt_index)
+		vpn_rt_index_build();
+
+	if (++vpn_rt_index_stamp == 0)
+		++vpn_rt_index_stamp;
+	stamp = vpn_rt_index_stamp;
+
+	for (i = 0; i < ecom->size; i++) {
+		key.len = ecom->unit_size;
+		memcpy(key.val, ecom->val + i * ecom->unit_size, key.len);
+		rti = hash_lookup(vpn_rt_index, &key);
+		if (!rti)
+			continue;
+
+		for (ALL_LIST_ELEMENTS_RO(rti->vrfs[afi], node, bgp)) {
+			if (bgp->vpn_policy[afi].rt_index_stamp == stamp)
+				continue;
+			bgp->vpn_policy[afi].rt_index_stamp = stamp;
+
+			if (pending_only && !bgp->vpn_policy[afi].import_pending)
+				continue;
+
+			cb(bgp, arg);
+		}
+	}
+}
+
 static bool labels_same(struct bgp_path_info *bpi, mpls_label_t *label,
 			uint32_t n)
 {
@@ -1275,38 +1430,90 @@ vpn_leak_to_vrf_update_onevrf(struct bgp *bgp_vrf,	    /* to */
 		    src_vrf, &nexthop_orig, nexthop_self_flag, debug);
 }
 
+struct vpn_leak_to_vrf_arg {
+	struct bgp *bgp_vpn;
+	struct bgp_path_info *path_vpn;
+};
+
+static void vpn_leak_to_vrf_update_cb(struct bgp *bgp_vrf, void *arg)
+{
+	struct vpn_leak_to_vrf_arg *lta = arg;
+
+	if (!lta->path_vpn->extra
+	    || lta->path_vpn->extra->bgp_orig != bgp_vrf) /* no loop */
+		vpn_leak_to_vrf_update_onevrf(bgp_vrf, lta->bgp_vpn,
+					      lta->path_vpn);
+}
+
 void vpn_leak_to_vrf_update(struct bgp *bgp_vpn,	    /* from */
 			    struct bgp_path_info *path_vpn) /* route */
 {
-	struct listnode *mnode, *mnnode;
-	struct bgp *bgp;
+	struct vpn_leak_to_vrf_arg lta = {bgp_vpn, path_vpn};
+	afi_t afi;
 
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
 
 	if (debug)
 		zlog_debug("%s: start (path_vpn=%p)", __func__, path_vpn);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
+	if (!path_vpn->net)
+		return;
+
+	afi = family2afi(bgp_dest_get_prefix(path_vpn->net)->family);
+
+	/* Loop over VRFs importing any of the route's RTs */
+	vpn_rt_index_walk(path_vpn->attr->ecommunity, afi, false,
+			  vpn_leak_to_vrf_update_cb, &lta);
+}
+
+static void vpn_leak_to_vrf_withdraw_cb(struct bgp *bgp, void *arg)
+{
+	struct vpn_leak_to_vrf_arg *lta = arg;
+	struct bgp_path_info *path_vpn = lta->path_vpn;
+	const struct prefix *p = bgp_dest_get_prefix(path_vpn->net);
+	afi_t afi = family2afi(p->family);
+	safi_t safi = SAFI_UNICAST;
+	struct bgp_dest *bn;
+	struct bgp_path_info *bpi;
+	const char *debugmsg;
+
+	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
 
-		if (!path_vpn->extra
-		    || path_vpn->extra->bgp_orig != bgp) { /* no loop */
-			vpn_leak_to_vrf_update_onevrf(bgp, bgp_vpn, path_vpn);
+	if (!vpn_leak_from_vpn_active(bgp, afi, &debugmsg)) {
+		if (debug)
+			zlog_debug("%s: skipping: %s", __func__, debugmsg);
+		return;
+	}
+
+	if (debug)
+		zlog_debug("%s: withdrawing from vrf %s", __func__,
+			   bgp->name_pretty);
+
+	bn = bgp_afi_node_get(bgp->rib[afi][safi], afi, safi, p, NULL);
+
+	for (bpi = bgp_dest_get_bgp_path_info(bn); bpi; bpi = bpi->next) {
+		if (bpi->extra
+		    && (struct bgp_path_info *)bpi->extra->parent == path_vpn) {
+			break;
 		}
 	}
+
+	if (bpi) {
+		if (debug)
+			zlog_debug("%s: deleting bpi %p", __func__, bpi);
+		bgp_aggregate_decrement(bgp, p, bpi, afi, safi);
+		bgp_path_info_delete(bn, bpi);
+		bgp_process(bgp, bn, afi, safi);
+	}
+	bgp_dest_unlock_node(bn);
 }
 
 void vpn_leak_to_vrf_withdraw(struct bgp *bgp_vpn,	    /* from */
 			      struct bgp_path_info *path_vpn) /* route */
 {
+	struct vpn_leak_to_vrf_arg lta = {bgp_vpn, path_vpn};
 	const struct prefix *p;
 	afi_t afi;
-	safi_t safi = SAFI_UNICAST;
-	struct bgp *bgp;
-	struct listnode *mnode, *mnnode;
-	struct bgp_dest *bn;
-	struct bgp_path_info *bpi;
-	const char *debugmsg;
 
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
 
@@ -1336,48 +1543,9 @@ void vpn_leak_to_vrf_withdraw(struct bgp *bgp_vpn,	    /* from */
 	p = bgp_dest_get_prefix(path_vpn->net);
 	afi = family2afi(p->family);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
-		if (!vpn_leak_from_vpn_active(bgp, afi, &debugmsg)) {
-			if (debug)
-				zlog_debug("%s: skipping: %s", __func__,
-					   debugmsg);
-			continue;
-		}
-
-		/* Check for intersection of route targets */
-		if (!ecom_intersect(bgp->vpn_policy[afi]
-					    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
-				    path_vpn->attr->ecommunity)) {
-
-			continue;
-		}
-
-		if (debug)
-			zlog_debug("%s: withdrawing from vrf %s", __func__,
-				   bgp->name_pretty);
-
-		bn = bgp_afi_node_get(bgp->rib[afi][safi], afi, safi, p, NULL);
-
-		for (bpi = bgp_dest_get_bgp_path_info(bn); bpi;
-		     bpi = bpi->next) {
-			if (bpi->extra
-			    && (struct bgp_path_info *)bpi->extra->parent
-				       == path_vpn) {
-				break;
-			}
-		}
-
-		if (bpi) {
-			if (debug)
-				zlog_debug("%s: deleting bpi %p", __func__,
-					   bpi);
-			bgp_aggregate_decrement(bgp, p, bpi, afi, safi);
-			bgp_path_info_delete(bn, bpi);
-			bgp_process(bgp, bn, afi, safi);
-		}
-		bgp_dest_unlock_node(bn);
-	}
+	/* Loop over VRFs importing any of the route's RTs */
+	vpn_rt_index_walk(path_vpn->attr->ecommunity, afi, false,
+			  vpn_leak_to_vrf_withdraw_cb, &lta);
 }
 
 void vpn_leak_to_vrf_withdraw_all(struct bgp *bgp_vrf, /* to */
@@ -1414,51 +1582,97 @@ void vpn_leak_to_vrf_withdraw_all(struct bgp *bgp_vrf, /* to */
 	}
 }
 
-void vpn_leak_to_vrf_update_all(struct bgp *bgp_vrf, /* to */
-				struct bgp *bgp_vpn, /* from */
-				afi_t afi)
+/*
+ * VRFs whose import policy changed are queued and picked up by one walk of
+ * the VPN table, so configuring many of them at once (e.g. at startup)
+ * doesn't walk the whole table once per VRF.
+ */
+static struct list *vpn_import_pending;
+static struct thread *t_vpn_import_pending;
+
+static int vpn_leak_to_vrf_import_pending(struct thread *thread)
 {
-	struct prefix_rd prd;
-	struct bgp_dest *pdest;
+	struct bgp *bgp_vpn = bgp_get_default();
+	struct vpn_policy *vpolicy;
+	struct bgp *bgp_vrf;
+	struct listnode *node, *nnode;
+	bool pending[AFI_MAX] = {};
 	safi_t safi = SAFI_MPLS_VPN;
+	afi_t afi;
 
-	assert(bgp_vpn);
-
-	/*
-	 * Walk vpn table
-	 */
-	for (pdest = bgp_table_top(bgp_vpn->rib[afi][safi]); pdest;
-	     pdest = bgp_route_next(pdest)) {
-		const struct prefix *p = bgp_dest_get_prefix(pdest);
-		struct bgp_table *table;
-		struct bgp_dest *bn;
-		struct bgp_path_info *bpi;
-
-		memset(&prd, 0, sizeof(prd));
-		prd.family = AF_UNSPEC;
-		prd.prefixlen = 64;
-		memcpy(prd.val, &p->u.val, 8);
+	for (ALL_LIST_ELEMENTS_RO(vpn_import_pending, node, vpolicy))
+		pending[vpolicy->afi] = true;
 
-		/* This is the per-RD table of prefixes */
-		table = bgp_dest_get_bgp_table_info(pdest);
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		struct bgp_dest *pdest;
 
-		if (!table)
+		if (!pending[afi] || !bgp_vpn || !bgp_vpn->rib[afi][safi])
 			continue;
 
-		for (bn = bgp_table_top(table); bn; bn = bgp_route_next(bn)) {
+		/*
+		 * Walk vpn table
+		 */
+		for (pdest = bgp_table_top(bgp_vpn->rib[afi][safi]); pdest;
+		     pdest = bgp_route_next(pdest)) {
+			struct bgp_table *table;
+			struct bgp_dest *bn;
+			struct bgp_path_info *bpi;
 
-			for (bpi = bgp_dest_get_bgp_path_info(bn); bpi;
-			     bpi = bpi->next) {
+			/* This is the per-RD table of prefixes */
+			table = bgp_dest_get_bgp_table_info(pdest);
 
-				if (bpi->extra
-				    && bpi->extra->bgp_orig == bgp_vrf)
-					continue;
+			if (!table)
+				continue;
 
-				vpn_leak_to_vrf_update_onevrf(bgp_vrf, bgp_vpn,
-							      bpi);
+			for (bn = bgp_table_top(table); bn;
+			     bn = bgp_route_next(bn)) {
+				for (bpi = bgp_dest_get_bgp_path_info(bn); bpi;
+				     bpi = bpi->next) {
+					struct vpn_leak_to_vrf_arg lta = {
+						bgp_vpn, bpi};
+
+					vpn_rt_index_walk(
+						bpi->attr->ecommunity, afi,
+						true,
+						vpn_leak_to_vrf_update_cb,
+						&lta);
+				}
 			}
 		}
 	}
+
+	for (ALL_LIST_ELEMENTS(vpn_import_pending, node, nnode, vpolicy)) {
+		bgp_vrf = vpolicy->bgp;
+		vpolicy->import_pending = false;
+		list_delete_node(vpn_import_pending, node);
+		bgp_unlock(bgp_vrf);
+	}
+
+	return 0;
+}
+
+void vpn_leak_to_vrf_update_all(struct bgp *bgp_vrf, /* to */
+				struct bgp *bgp_vpn, /* from */
+				afi_t afi)
+{
+	struct vpn_policy *vpolicy = &bgp_vrf->vpn_policy[afi];
+
+	assert(bgp_vpn);
+
+	/*
+	 * bgp_vpn is always the default instance, which is looked up again
+	 * when the queue is run.
+	 */
+	if (!vpolicy->import_pending) {
+		if (!vpn_import_pending)
+			vpn_import_pending = list_new();
+		vpolicy->import_pending = true;
+		listnode_add(vpn_import_pending, vpolicy);
+		bgp_lock(bgp_vrf);
+	}
+
+	thread_add_event(bm->master, vpn_leak_to_vrf_import_pending, NULL, 0,
+			 &t_vpn_import_pending);
 }
 
 /*
@@ -1587,6 +1801,7 @@ void vpn_handle_router_id_update(struct bgp *bgp, bool withdraw,
 					(struct ecommunity_val *)ecom->val);
 
 			}
+			vpn_leak_rt_index_invalidate();
 		} else {
 			/*
 			 * Router-id changes that are not explicit config
@@ -1634,6 +1849,7 @@ void vpn_handle_router_id_update(struct bgp *bgp, bool withdraw,
 						= ecommunity_dup(ecom);
 
 			}
+			vpn_leak_rt_index_invalidate();
 
 postchange:
 			/* Update routes to VPN */
@@ -1757,6 +1973,7 @@ void vrf_import_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp,
 	else
 		to_bgp->vpn_policy[afi].rtlist[idir] = ecommunity_dup(ecom);
 	SET_FLAG(to_bgp->af_flags[afi][safi], BGP_CONFIG_VRF_TO_VRF_IMPORT);
+	vpn_leak_rt_index_invalidate();
 
 	if (debug) {
 		const char *from_name;
@@ -1846,6 +2063,7 @@ void vrf_unimport_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp,
 				   BGP_CONFIG_VRF_TO_VRF_IMPORT);
 		if (to_bgp->vpn_policy[afi].rtlist[idir])
 			ecommunity_free(&to_bgp->vpn_policy[afi].rtlist[idir]);
+		vpn_leak_rt_index_invalidate();
 	} else {
 		ecom = from_bgp->vpn_policy[afi].rtlist[edir];
 		if (ecom)
@@ -2492,6 +2710,29 @@ void bgp_mplsvpn_init(void)
 #endif /* KEEP_OLD_VPN_COMMANDS */
 }
 
+void bgp_mplsvpn_finish(void)
+{
+	struct vpn_policy *vpolicy;
+
+	THREAD_OFF(t_vpn_import_pending);
+
+	if (vpn_import_pending) {
+		while ((vpolicy = listnode_head(vpn_import_pending))) {
+			vpolicy->import_pending = false;
+			listnode_delete(vpn_import_pending, vpolicy);
+			bgp_unlock(vpolicy->bgp);
+		}
+		list_delete(&vpn_import_pending);
+	}
+
+	if (vpn_rt_index) {
+		hash_clean(vpn_rt_index, vpn_rt_import_free);
+		hash_free(vpn_rt_index);
+		vpn_rt_index = NULL;
+	}
+	vpn_rt_index_stale = true;
+}
+
 vrf_id_t get_first_vrf_for_redirect_with_rt(struct ecommunity *eckey)
 {
 	struct listnode *mnode, *mnnode;
@@ -2735,6 +2976,7 @@ void bgp_vpn_leak_export(struct bgp *from_bgp)
 						to_vpolicy->rtlist[idir],
 						(struct ecommunity_val *)
 							ecom->val);
+				vpn_leak_rt_index_invalidate();
 				vrf_import_from_vrf(to_bgp, from_bgp,
 						    afi, safi);
 				break;
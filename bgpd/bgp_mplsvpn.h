@@ -42,6 +42,7 @@
 	"   Network          Next Hop      EthTag    Overlay Index   RouterMac\n"
 
 extern void bgp_mplsvpn_init(void);
+extern void bgp_mplsvpn_finish(void);
 extern int bgp_nlri_parse_vpn(struct peer *, struct attr *, struct bgp_nlri *);
 extern uint32_t decode_label(mpls_label_t *);
 extern void encode_label(mpls_label_t, mpls_label_t *);
@@ -69,6 +70,8 @@ extern void vpn_leak_to_vrf_withdraw_all(struct bgp *bgp_vrf, afi_t afi);
 extern void vpn_leak_to_vrf_update_all(struct bgp *bgp_vrf, struct bgp *bgp_vpn,
 				       afi_t afi);
 
+extern void vpn_leak_rt_index_invalidate(void);
+
 extern void vpn_leak_to_vrf_update(struct bgp *bgp_vpn,
 				   struct bgp_path_info *path_vpn);
 
@@ -192,6 +195,9 @@ static inline void vpn_leak_prechange(vpn_policy_direction_t direction,
 	if (!bgp_vpn)
 		return;
 
+	if (direction == BGP_VPN_POLICY_DIR_FROMVPN)
+		vpn_leak_rt_index_invalidate();
+
 	if ((direction == BGP_VPN_POLICY_DIR_FROMVPN) &&
 		vpn_leak_from_vpn_active(bgp_vrf, afi, NULL)) {
 
@@ -212,8 +218,10 @@ static inline void vpn_leak_postchange(vpn_policy_direction_t direction,
 	if (!bgp_vpn)
 		return;
 
-	if (direction == BGP_VPN_POLICY_DIR_FROMVPN)
+	if (direction == BGP_VPN_POLICY_DIR_FROMVPN) {
+		vpn_leak_rt_index_invalidate();
 		vpn_leak_to_vrf_update_all(bgp_vrf, bgp_vpn, afi);
+	}
 	if (direction == BGP_VPN_POLICY_DIR_TOVPN) {
 
 		if (bgp_vrf->vpn_policy[afi].tovpn_label !=
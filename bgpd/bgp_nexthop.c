@@ -99,6 +99,9 @@ bool bnc_existing_for_prefix(struct bgp_nexthop_cache *bnc)
 
 void bnc_free(struct bgp_nexthop_cache *bnc)
 {
+	if (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_EVAL_PENDING))
+		bgp_nht_pending_del(&bnc->bgp->nht_pending, bnc);
+	bgp_nht_nhg_release(bnc);
 	bnc_nexthop_free(bnc);
 	bgp_nexthop_cache_del(bnc->tree, bnc);
 	XFREE(MTYPE_BGP_NEXTHOP_CACHE, bnc);
@@ -990,6 +993,8 @@ void bgp_scan_init(struct bgp *bgp)
 {
 	afi_t afi;
 
+	bgp_nht_pending_init(&bgp->nht_pending);
+
 	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
 		bgp_nexthop_cache_init(&bgp->nexthop_cache_table[afi]);
 		bgp_nexthop_cache_init(&bgp->import_check_table[afi]);
@@ -1009,6 +1014,8 @@ void bgp_scan_finish(struct bgp *bgp)
 {
 	afi_t afi;
 
+	THREAD_OFF(bgp->t_nht_pending);
+
 	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
 		/* Only the current one needs to be reset. */
 		bgp_nexthop_cache_reset(&bgp->nexthop_cache_table[afi]);
@@ -1019,4 +1026,6 @@ void bgp_scan_finish(struct bgp *bgp)
 		bgp_table_unlock(bgp->connected_table[afi]);
 		bgp->connected_table[afi] = NULL;
 	}
+
+	bgp_nht_pending_fini(&bgp->nht_pending);
 }
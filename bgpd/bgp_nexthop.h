@@ -38,6 +38,7 @@
 #define BGP_MP_NEXTHOP_FAMILY NEXTHOP_FAMILY
 
 PREDECL_RBTREE_UNIQ(bgp_nexthop_cache);
+PREDECL_DLIST(bgp_nht_pending);
 
 /* BGP nexthop cache value structure. */
 struct bgp_nexthop_cache {
@@ -60,6 +61,8 @@ struct bgp_nexthop_cache {
 #define BGP_STATIC_ROUTE              (1 << 4)
 #define BGP_STATIC_ROUTE_EXACT_MATCH  (1 << 5)
 #define BGP_NEXTHOP_LABELED_VALID     (1 << 6)
+#define BGP_NEXTHOP_EVAL_PENDING      (1 << 7)
+#define BGP_NEXTHOP_NHG_INSTALLED     (1 << 8)
 
 	uint16_t change_flags;
 
@@ -70,6 +73,14 @@ struct bgp_nexthop_cache {
 	/* Back pointer to the cache tree this entry belongs to. */
 	struct bgp_nexthop_cache_head *tree;
 
+	/* On bgp->nht_pending while BGP_NEXTHOP_EVAL_PENDING is set. */
+	struct bgp_nht_pending_item pending_entry;
+
+	/* L3 NHG holding the resolved nexthops, shared by the routes
+	 * installed through it ("bgp pic").
+	 */
+	uint32_t nhg_id;
+
 	uint32_t srte_color;
 	struct prefix prefix;
 	void *nht_info; /* In BGP, peer session */
@@ -82,6 +93,7 @@ extern int bgp_nexthop_cache_compare(const struct bgp_nexthop_cache *a,
 				     const struct bgp_nexthop_cache *b);
 DECLARE_RBTREE_UNIQ(bgp_nexthop_cache, struct bgp_nexthop_cache, entry,
 		    bgp_nexthop_cache_compare);
+DECLARE_DLIST(bgp_nht_pending, struct bgp_nexthop_cache, pending_entry);
 
 /* Own tunnel-ip address structure */
 struct tip_addr {
@@ -49,11 +49,15 @@
 
 extern struct zclient *zclient;
 
+/* How long nexthop updates are collected before paths are evaluated. */
+#define BGP_NHT_EVAL_DELAY_MSEC 10
+
 static void register_zebra_rnh(struct bgp_nexthop_cache *bnc,
 			       int is_bgp_static_route);
 static void unregister_zebra_rnh(struct bgp_nexthop_cache *bnc,
 				 int is_bgp_static_route);
 static void evaluate_paths(struct bgp_nexthop_cache *bnc);
+static void bgp_nht_eval_schedule(struct bgp_nexthop_cache *bnc);
 static int make_prefix(int afi, struct bgp_path_info *pi, struct prefix *p);
 
 static int bgp_isvalid_nexthop(struct bgp_nexthop_cache *bnc)
@@ -303,6 +307,107 @@ void bgp_delete_connected_nexthop(afi_t afi, struct peer *peer)
 	}
 }
 
+/*
+ * Whether the nexthops zebra resolved this nexthop to can be installed as a
+ * NHG of our own.  Zebra only takes gateways with an interface in those.
+ */
+static bool bgp_nht_nhg_usable(struct bgp_nexthop_cache *bnc)
+{
+	struct nexthop *nh;
+
+	if (!CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID) || !bnc->nexthop_num
+	    || bnc->nexthop_num > MULTIPATH_NUM || bnc->srte_color)
+		return false;
+
+	for (nh = bnc->nexthop; nh; nh = nh->next) {
+		if (nh->type != NEXTHOP_TYPE_IPV4_IFINDEX
+		    && nh->type != NEXTHOP_TYPE_IPV6_IFINDEX)
+			return false;
+		if (!nh->ifindex)
+			return false;
+		if (nh->nh_label && nh->nh_label->num_labels)
+			return false;
+		if (CHECK_FLAG(nh->flags, NEXTHOP_FLAG_HAS_BACKUP))
+			return false;
+	}
+
+	return true;
+}
+
+static void bgp_nht_nhg_send(struct bgp_nexthop_cache *bnc)
+{
+	struct zapi_nhg api_nhg = {};
+	struct nexthop *nh;
+
+	UNSET_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED);
+
+	if (!zclient || zclient->sock < 0)
+		return;
+
+	api_nhg.id = bnc->nhg_id;
+	for (nh = bnc->nexthop; nh; nh = nh->next)
+		zapi_nexthop_from_nexthop(
+			&api_nhg.nexthops[api_nhg.nexthop_num++], nh);
+
+	if (BGP_DEBUG(nht, NHT))
+		zlog_debug("%s: %pFX(%s) nhg %u with %u nexthops to zebra",
+			   __func__, &bnc->prefix, bnc->bgp->name_pretty,
+			   api_nhg.id, api_nhg.nexthop_num);
+
+	if (zclient_nhg_send(zclient, ZEBRA_NHG_ADD, &api_nhg)
+	    != ZCLIENT_SEND_FAILURE)
+		SET_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED);
+}
+
+uint32_t bgp_nht_nhg_id(struct bgp_nexthop_cache *bnc)
+{
+	if (!bgp_nht_nhg_usable(bnc))
+		return 0;
+
+	if (!bnc->nhg_id) {
+		bnc->nhg_id = bgp_l3nhg_id_alloc();
+		if (!bnc->nhg_id)
+			return 0;
+	}
+
+	if (!CHECK_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED))
+		bgp_nht_nhg_send(bnc);
+
+	return CHECK_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED) ? bnc->nhg_id
+								   : 0;
+}
+
+void bgp_nht_nhg_release(struct bgp_nexthop_cache *bnc)
+{
+	struct zapi_nhg api_nhg = {};
+
+	if (!bnc->nhg_id)
+		return;
+
+	if (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED) && zclient
+	    && zclient->sock >= 0) {
+		api_nhg.id = bnc->nhg_id;
+		zclient_nhg_send(zclient, ZEBRA_NHG_DEL, &api_nhg);
+	}
+
+	UNSET_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED);
+	bgp_l3nhg_id_free(bnc->nhg_id);
+	bnc->nhg_id = 0;
+}
+
+/*
+ * Whether the route for dest is installed with this nexthop's NHG, in
+ * which case zebra has already been given the new nexthops.
+ */
+static bool bgp_nht_path_uses_nhg(struct bgp_nexthop_cache *bnc,
+				  struct bgp_dest *dest,
+				  struct bgp_path_info *path)
+{
+	return CHECK_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED)
+	       && CHECK_FLAG(dest->flags, BGP_NODE_FIB_NHG)
+	       && CHECK_FLAG(path->flags, BGP_PATH_SELECTED);
+}
+
 static void bgp_process_nexthop_update(struct bgp_nexthop_cache *bnc,
 				       struct zapi_route *nhr)
 {
@@ -312,8 +417,8 @@ static void bgp_process_nexthop_update(struct bgp_nexthop_cache *bnc,
 	struct nexthop *nhlist_tail = NULL;
 	int i;
 
+	/* change_flags accumulate until the paths are evaluated */
 	bnc->last_update = bgp_clock();
-	bnc->change_flags = 0;
 
 	/* debug print the input */
 	if (BGP_DEBUG(nht, NHT))
@@ -418,7 +523,57 @@ static void bgp_process_nexthop_update(struct bgp_nexthop_cache *bnc,
 		bnc->nexthop = NULL;
 	}
 
-	evaluate_paths(bnc);
+	/*
+	 * Routes installed with the nexthop's NHG follow it as soon as zebra
+	 * has the new contents, so that is not held back with the paths.  If
+	 * it can't be expressed as a NHG any more, the routes are moved off
+	 * it when the paths are evaluated.
+	 */
+	if (bnc->nhg_id) {
+		if (!bgp_nht_nhg_usable(bnc))
+			UNSET_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED);
+		else if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED)
+			 || !CHECK_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED))
+			bgp_nht_nhg_send(bnc);
+	}
+
+	bgp_nht_eval_schedule(bnc);
+}
+
+static int bgp_nht_eval_pending(struct thread *thread)
+{
+	struct bgp *bgp = THREAD_ARG(thread);
+	struct bgp_nexthop_cache *bnc;
+
+	/*
+	 * bnc_free() takes nexthops off the list, so peers going down while
+	 * the paths are evaluated are fine.
+	 */
+	while ((bnc = bgp_nht_pending_pop(&bgp->nht_pending))) {
+		UNSET_FLAG(bnc->flags, BGP_NEXTHOP_EVAL_PENDING);
+		evaluate_paths(bnc);
+	}
+
+	return 0;
+}
+
+/*
+ * Zebra tends to send updates for many nexthops at once when the IGP
+ * converges.  They are collected for a short while so that a destination
+ * whose paths use several of those nexthops is queued for best path
+ * selection once, with all of its paths already updated.
+ */
+static void bgp_nht_eval_schedule(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp *bgp = bnc->bgp;
+
+	if (!CHECK_FLAG(bnc->flags, BGP_NEXTHOP_EVAL_PENDING)) {
+		SET_FLAG(bnc->flags, BGP_NEXTHOP_EVAL_PENDING);
+		bgp_nht_pending_add_tail(&bgp->nht_pending, bnc);
+	}
+
+	thread_add_timer_msec(bm->master, bgp_nht_eval_pending, bgp,
+			      BGP_NHT_EVAL_DELAY_MSEC, &bgp->t_nht_pending);
 }
 
 void bgp_parse_nexthop_update(int command, vrf_id_t vrf_id)
@@ -678,6 +833,30 @@ static void unregister_zebra_rnh(struct bgp_nexthop_cache *bnc,
 		sendmsg_zebra_rnh(bnc, ZEBRA_NEXTHOP_UNREGISTER);
 }
 
+/*
+ * Whether a path whose validity didn't change has to go through best path
+ * selection again.  A new metric only matters if there are other paths to
+ * compare it with, and nothing matters if nothing changed.  New nexthops
+ * don't need a reinstall for routes that use the nexthop's NHG.
+ */
+static bool bgp_nht_path_needs_select(struct bgp_nexthop_cache *bnc,
+				      struct bgp_dest *dest,
+				      struct bgp_path_info *path)
+{
+	if (path->attr->srte_color != 0)
+		return true;
+
+	if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED)
+	    && !bgp_nht_path_uses_nhg(bnc, dest, path))
+		return true;
+
+	if (!CHECK_FLAG(bnc->change_flags,
+			BGP_NEXTHOP_METRIC_CHANGED | BGP_NEXTHOP_CHANGED))
+		return false;
+
+	return bgp_dest_get_bgp_path_info(dest) != path || path->next;
+}
+
 /**
  * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
  * ARGUMENTS:
@@ -788,12 +967,18 @@ static void evaluate_paths(struct bgp_nexthop_cache *bnc)
 		else if (path->extra)
 			path->extra->igpmetric = 0;
 
-		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED)
-		    || CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED)
+		path_valid = !!CHECK_FLAG(path->flags, BGP_PATH_VALID);
+
+		if (path_valid == bnc_is_valid_nexthop
+		    && !bgp_nht_path_needs_select(bnc, dest, path))
+			continue;
+
+		if (((CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED)
+		      || CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED))
+		     && !bgp_nht_path_uses_nhg(bnc, dest, path))
 		    || path->attr->srte_color != 0)
 			SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
 
-		path_valid = !!CHECK_FLAG(path->flags, BGP_PATH_VALID);
 		if (path_valid != bnc_is_valid_nexthop) {
 			if (path_valid) {
 				/* No longer valid, clear flag; also for EVPN
@@ -882,6 +1067,8 @@ void bgp_nht_register_nexthops(struct bgp *bgp)
 
 		frr_each (bgp_nexthop_cache, &bgp->nexthop_cache_table[afi],
 			  bnc) {
+			/* A new zebra doesn't know our NHGs */
+			UNSET_FLAG(bnc->flags, BGP_NEXTHOP_NHG_INSTALLED);
 			register_zebra_rnh(bnc, 0);
 		}
 	}
@@ -90,6 +90,13 @@ extern void bgp_nht_register_nexthops(struct bgp *bgp);
 extern void bgp_nht_reg_enhe_cap_intfs(struct peer *peer);
 extern void bgp_nht_dereg_enhe_cap_intfs(struct peer *peer);
 
+/*
+ * L3 NHG a route resolving over this nexthop can be installed with, 0 if
+ * the nexthop can't be expressed as one.
+ */
+extern uint32_t bgp_nht_nhg_id(struct bgp_nexthop_cache *bnc);
+extern void bgp_nht_nhg_release(struct bgp_nexthop_cache *bnc);
+
 /* APIs for setting up and allocating L3 nexthop group ids */
 extern uint32_t bgp_l3nhg_id_alloc(void);
 extern void bgp_l3nhg_id_free(uint32_t nhg_id);
@@ -61,9 +61,11 @@
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_trace.h"
+#include "bgpd/bgp_journal.h"
 
 DEFINE_HOOK(bgp_packet_dump,
 		(struct peer *peer, uint8_t type, bgp_size_t size,
@@ -144,7 +146,7 @@ static struct stream *bgp_update_packet_eor(struct peer *peer, afi_t afi,
 		zlog_debug("send End-of-RIB for %s to %s",
 			   get_afi_safi_str(afi, safi, false), peer->host);
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
 	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
@@ -506,7 +508,7 @@ void bgp_keepalive_send(struct peer *peer)
 {
 	struct stream *s;
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make keepalive packet. */
 	bgp_packet_set_marker(s, BGP_MSG_KEEPALIVE);
@@ -547,7 +549,7 @@ void bgp_open_send(struct peer *peer)
 	else
 		local_as = peer->local_as;
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make open packet. */
 	bgp_packet_set_marker(s, BGP_MSG_OPEN);
@@ -712,8 +714,9 @@ void bgp_notify_send_with_data(struct peer *peer, uint8_t code,
 	 * who tends to have a plethora of fields nulled out.
 	 */
 	if (peer->curr) {
-		size_t packetsize = stream_get_endp(peer->curr);
-		assert(packetsize <= sizeof(peer->last_reset_cause));
+		size_t packetsize = MIN(stream_get_endp(peer->curr),
+					sizeof(peer->last_reset_cause));
+
 		memcpy(peer->last_reset_cause, peer->curr->data, packetsize);
 		peer->last_reset_cause_size = packetsize;
 	}
@@ -825,7 +828,7 @@ void bgp_route_refresh_send(struct peer *peer, afi_t afi, safi_t safi,
 	/* Convert AFI, SAFI to values for packet. */
 	bgp_map_afi_safi_int2iana(afi, safi, &pkt_afi, &pkt_safi);
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
 	if (CHECK_FLAG(peer->cap, PEER_CAP_REFRESH_NEW_RCV))
@@ -921,7 +924,7 @@ void bgp_capability_send(struct peer *peer, afi_t afi, safi_t safi,
 	/* Convert AFI, SAFI to values for packet. */
 	bgp_map_afi_safi_int2iana(afi, safi, &pkt_afi, &pkt_safi);
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
 	bgp_packet_set_marker(s, BGP_MSG_CAPABILITY);
@@ -1342,6 +1345,13 @@ static int bgp_open_receive(struct peer *peer, bgp_size_t size)
 				   peer->host);
 	}
 
+	/* Extended messages may be used once both sides support them. */
+	if (CHECK_FLAG(peer->cap, PEER_CAP_EXTENDED_MESSAGE_ADV)
+	    && CHECK_FLAG(peer->cap, PEER_CAP_EXTENDED_MESSAGE_RCV))
+		peer->max_packet_size = BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE;
+	else
+		peer->max_packet_size = BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE;
+
 	/*
 	 * Assume that the peer supports the locally configured set of
 	 * AFI/SAFIs if the peer did not send us any Mulitiprotocol
@@ -1474,6 +1484,7 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 	bgp_size_t withdraw_len;
 	bool restart = false;
 
+	/* same order as enum bgp_preparse_nlri_type */
 	enum NLRI_TYPES {
 		NLRI_UPDATE,
 		NLRI_WITHDRAW,
@@ -1482,6 +1493,7 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 		NLRI_TYPE_MAX
 	};
 	struct bgp_nlri nlris[NLRI_TYPE_MAX];
+	struct bgp_preparse_nlri *pnlri;
 
 	/* Status must be Established. */
 	if (peer->status != Established) {
@@ -1656,15 +1668,27 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 		if (nlris[i].length == 0)
 			continue;
 
+		/* Already decoded by the parse pthreads? */
+		pnlri = bgp_preparse_nlri_find(peer, peer->curr_pre, i,
+					       &nlris[i]);
+
 		switch (i) {
 		case NLRI_UPDATE:
 		case NLRI_MP_UPDATE:
-			nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
-						  &nlris[i], 0);
+			if (pnlri)
+				nlri_ret = bgp_nlri_apply_ip(
+					peer, NLRI_ATTR_ARG, pnlri);
+			else
+				nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
+							  &nlris[i], 0);
 			break;
 		case NLRI_WITHDRAW:
 		case NLRI_MP_WITHDRAW:
-			nlri_ret = bgp_nlri_parse(peer, &attr, &nlris[i], 1);
+			if (pnlri)
+				nlri_ret = bgp_nlri_apply_ip(peer, NULL, pnlri);
+			else
+				nlri_ret = bgp_nlri_parse(peer, &attr,
+							  &nlris[i], 1);
 			break;
 		default:
 			nlri_ret = BGP_NLRI_PARSE_ERROR;
@@ -1759,6 +1783,9 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 			if (peer->nsf[afi][safi])
 				bgp_clear_stale_route(peer, afi, safi);
 
+			/* Routes reloaded at startup the peer did not send */
+			bgp_journal_reconcile(peer, afi, safi);
+
                         zlog_info(
                             "%s: rcvd End-of-RIB for %s from %s in vrf %s",
                             __func__, get_afi_safi_str(afi, safi, false),
@@ -1772,9 +1799,6 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 
 	peer->update_time = bgp_clock();
 
-	/* Notify BGP Conditional advertisement scanner process */
-	peer->advmap_table_change = true;
-
 	return Receive_UPDATE_message;
 }
 
@@ -2338,6 +2362,7 @@ int bgp_process_packet(struct thread *thread)
 
 		frr_with_mutex(&peer->io_mtx) {
 			peer->curr = stream_fifo_pop(peer->ibuf);
+			peer->curr_pre = bgp_preparse_get(peer, peer->curr);
 		}
 
 		if (peer->curr == NULL) // no packets to process, hmm...
@@ -2444,6 +2469,8 @@ int bgp_process_packet(struct thread *thread)
 		/* delete processed packet */
 		stream_free(peer->curr);
 		peer->curr = NULL;
+		bgp_preparse_free(peer->curr_pre);
+		peer->curr_pre = NULL;
 		processed++;
 
 		/* Update FSM */
@@ -0,0 +1,446 @@
+/* BGP UPDATE pre-parsing pthreads
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "jhash.h"
+#include "memory.h"
+#include "stream.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_parse.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_PREPARSE, "BGP pre-parsed UPDATE")
+
+/* default pool size is capped, the main pthread is the limit past that */
+#define BGP_PARSE_THREADS_DEFAULT_MAX 4
+
+/* packets taken off peer->ibuf_parse at a time */
+#define BGP_PARSE_PACKET_MAX 64U
+
+static struct frr_pthread *bgp_pth_parse[BGP_PARSE_THREADS_MAX];
+static unsigned int bgp_parse_count;
+
+static struct frr_pthread *bgp_parse_pthread(struct peer *peer)
+{
+	uint32_t key = jhash_1word((uint32_t)(uintptr_t)peer, 0);
+
+	return bgp_pth_parse[key % bgp_parse_count];
+}
+
+/* Decoding ---------------------------------------------------------------- */
+
+static void bgp_preparse_nlri(struct peer *peer, struct bgp_preparse_nlri *n,
+			      const uint8_t *nlri, bgp_size_t length, afi_t afi,
+			      safi_t safi)
+{
+	const uint8_t *pnt, *lim = nlri + length;
+	struct bgp_preparse_prefix *pp;
+	uint8_t family, prefixlen, maxlen;
+	uint32_t id, count = 0;
+	bool addpath;
+	int psize;
+
+	if (!length || (afi != AFI_IP && afi != AFI_IP6)
+	    || (safi != SAFI_UNICAST && safi != SAFI_MULTICAST))
+		return;
+
+	family = afi2family(afi);
+	maxlen = afi == AFI_IP ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN;
+	addpath = bgp_addpath_encode_rx(peer, afi, safi);
+
+	/* Anything bgp_nlri_parse_ip() would complain about is left to it, so
+	 * it can do that properly.
+	 */
+	for (pnt = nlri; pnt < lim; pnt += psize) {
+		if (addpath) {
+			if (pnt + BGP_ADDPATH_ID_LEN >= lim)
+				return;
+			pnt += BGP_ADDPATH_ID_LEN;
+		}
+		prefixlen = *pnt++;
+		if (prefixlen > maxlen)
+			return;
+		psize = PSIZE(prefixlen);
+		if (pnt + psize > lim)
+			return;
+		count++;
+	}
+
+	n->prefixes = XCALLOC(MTYPE_BGP_PREPARSE, count * sizeof(*n->prefixes));
+
+	for (pnt = nlri, pp = n->prefixes; pnt < lim; pnt += psize, pp++) {
+		if (addpath) {
+			memcpy(&id, pnt, BGP_ADDPATH_ID_LEN);
+			pp->addpath_id = ntohl(id);
+			pnt += BGP_ADDPATH_ID_LEN;
+		}
+		pp->p.family = family;
+		pp->p.prefixlen = *pnt++;
+		psize = PSIZE(pp->p.prefixlen);
+		memcpy(pp->p.u.val, pnt, psize);
+	}
+
+	n->nlri = nlri;
+	n->length = length;
+	n->afi = afi;
+	n->safi = safi;
+	n->addpath = addpath;
+	n->count = count;
+}
+
+static void bgp_preparse_mp(struct peer *peer, struct bgp_preparse *pre,
+			    const uint8_t *p, bgp_size_t length, bool reach)
+{
+	struct bgp_preparse_nlri *n;
+	iana_afi_t pkt_afi;
+	afi_t afi;
+	safi_t safi;
+	size_t offset;
+
+	if (length < (reach ? 5 : 3))
+		return;
+
+	pkt_afi = (p[0] << 8) | p[1];
+	if (bgp_map_afi_safi_iana2int(pkt_afi, p[2], &afi, &safi))
+		return;
+
+	if (reach) {
+		/* AFI, SAFI, nexthop length, nexthop, SNPA */
+		n = &pre->nlri[BGP_PREPARSE_MP_UPDATE];
+		offset = 4 + p[3] + 1;
+		if (offset > length)
+			return;
+	} else {
+		n = &pre->nlri[BGP_PREPARSE_MP_WITHDRAW];
+		offset = 3;
+	}
+
+	bgp_preparse_nlri(peer, n, p + offset, length - offset, afi, safi);
+}
+
+static void bgp_preparse_attrs(struct peer *peer, struct bgp_preparse *pre,
+			       struct stream *s, size_t pos, size_t end)
+{
+	uint8_t *data = STREAM_DATA(s);
+	uint8_t flag, type;
+	bgp_size_t length;
+
+	while (end - pos >= BGP_ATTR_MIN_LEN) {
+		flag = data[pos];
+		type = data[pos + 1];
+
+		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN)) {
+			if (end - pos < BGP_ATTR_MIN_LEN + 1)
+				return;
+			length = (data[pos + 2] << 8) | data[pos + 3];
+			pos += 4;
+		} else {
+			length = data[pos + 2];
+			pos += 3;
+		}
+
+		if (length > end - pos)
+			return;
+
+		/* bgp_attr_parse() rejects duplicates, first one is enough */
+		switch (type) {
+		case BGP_ATTR_AS_PATH:
+			if (pre->aspath_at)
+				break;
+			stream_set_getp(s, pos);
+			pre->aspath = aspath_parse_new(s, length, pre->as4);
+			if (pre->aspath)
+				pre->aspath = aspath_intern(pre->aspath);
+			pre->aspath_at = data + pos;
+			break;
+		case BGP_ATTR_AS4_PATH:
+			if (pre->as4_path_at)
+				break;
+			stream_set_getp(s, pos);
+			pre->as4_path = aspath_parse_new(s, length, 1);
+			if (pre->as4_path)
+				pre->as4_path = aspath_intern(pre->as4_path);
+			pre->as4_path_at = data + pos;
+			break;
+		case BGP_ATTR_COMMUNITIES: {
+			struct community com = {
+				.size = length / COMMUNITY_SIZE,
+				.val = (uint32_t *)(data + pos),
+			};
+
+			if (pre->community_at || !length
+			    || length % COMMUNITY_SIZE)
+				break;
+			pre->community =
+				community_intern(community_uniq_sort(&com));
+			pre->community_at = data + pos;
+			break;
+		}
+		case BGP_ATTR_LARGE_COMMUNITIES: {
+			struct lcommunity lcom = {
+				.size = length / LCOMMUNITY_SIZE,
+				.val = data + pos,
+			};
+
+			if (pre->lcommunity_at || !length
+			    || length % LCOMMUNITY_SIZE)
+				break;
+			pre->lcommunity =
+				lcommunity_intern(lcommunity_uniq_sort(&lcom));
+			pre->lcommunity_at = data + pos;
+			break;
+		}
+		case BGP_ATTR_MP_REACH_NLRI:
+			bgp_preparse_mp(peer, pre, data + pos, length, true);
+			break;
+		case BGP_ATTR_MP_UNREACH_NLRI:
+			bgp_preparse_mp(peer, pre, data + pos, length, false);
+			break;
+		}
+
+		pos += length;
+	}
+}
+
+/* Decode what can be decoded of an UPDATE packet, header included. */
+static struct bgp_preparse *bgp_preparse_update(struct peer *peer,
+						 struct stream *s)
+{
+	struct bgp_preparse *pre;
+	size_t pos = BGP_HEADER_SIZE, end = stream_get_endp(s);
+	uint8_t *data = STREAM_DATA(s);
+	uint16_t withdraw_len, attribute_len;
+
+	if (end - pos < 2)
+		return NULL;
+	withdraw_len = stream_getw_from(s, pos);
+	pos += 2;
+	if (end - pos < (size_t)withdraw_len + 2)
+		return NULL;
+
+	pre = XCALLOC(MTYPE_BGP_PREPARSE, sizeof(*pre));
+	pre->pkt = s;
+	pre->as4 = !!CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV);
+
+	bgp_preparse_nlri(peer, &pre->nlri[BGP_PREPARSE_WITHDRAW], data + pos,
+			  withdraw_len, AFI_IP, SAFI_UNICAST);
+	pos += withdraw_len;
+
+	attribute_len = stream_getw_from(s, pos);
+	pos += 2;
+	if (end - pos < attribute_len)
+		goto out;
+
+	bgp_preparse_attrs(peer, pre, s, pos, pos + attribute_len);
+	pos += attribute_len;
+
+	bgp_preparse_nlri(peer, &pre->nlri[BGP_PREPARSE_UPDATE], data + pos,
+			  end - pos, AFI_IP, SAFI_UNICAST);
+
+out:
+	/* bgp_process_packet() starts from the top */
+	stream_set_getp(s, 0);
+	return pre;
+}
+
+/* Pthread side ------------------------------------------------------------ */
+
+static int bgp_parse_packets(struct thread *thread)
+{
+	struct peer *peer = THREAD_ARG(thread);
+	struct stream_fifo pkts;
+	struct bgp_preparse_head pres;
+	struct bgp_preparse *pre;
+	struct stream *pkt;
+	bool more;
+
+	stream_fifo_init(&pkts);
+	bgp_preparse_init(&pres);
+
+	frr_with_mutex(&peer->io_mtx) {
+		while (pkts.count < BGP_PARSE_PACKET_MAX
+		       && (pkt = stream_fifo_pop(peer->ibuf_parse)))
+			stream_fifo_push(&pkts, pkt);
+	}
+
+	for (pkt = pkts.head; pkt; pkt = pkt->next) {
+		if (stream_getc_from(pkt, BGP_MARKER_SIZE + 2)
+		    != BGP_MSG_UPDATE)
+			continue;
+		pre = bgp_preparse_update(peer, pkt);
+		if (pre)
+			bgp_preparse_add_tail(&pres, pre);
+	}
+
+	frr_with_mutex(&peer->io_mtx) {
+		while ((pkt = stream_fifo_pop(&pkts))) {
+			pre = bgp_preparse_first(&pres);
+			if (pre && pre->pkt == pkt) {
+				bgp_preparse_del(&pres, pre);
+				bgp_preparse_add_tail(&peer->ibuf_pre, pre);
+			}
+			stream_fifo_push(peer->ibuf, pkt);
+		}
+		more = peer->ibuf_parse->count > 0;
+	}
+
+	stream_fifo_deinit(&pkts);
+	bgp_preparse_fini(&pres);
+
+	if (more)
+		thread_add_event(thread->master, bgp_parse_packets, peer, 0,
+				 &peer->t_parse);
+	thread_add_timer_msec(bm->master, bgp_process_packet, peer, 0,
+			      &peer->t_process_packet);
+
+	return 0;
+}
+
+/* Public API -------------------------------------------------------------- */
+
+void bgp_parse_pthreads_init(int count)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	char name[32], os_name[OS_THREAD_NAMELEN];
+
+	if (count < 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		/* main and I/O pthreads are busy already */
+		count = MIN(MAX(ncpus - 2, 0), BGP_PARSE_THREADS_DEFAULT_MAX);
+	}
+
+	bgp_parse_count = MIN(count, BGP_PARSE_THREADS_MAX);
+
+	for (unsigned int i = 0; i < bgp_parse_count; i++) {
+		snprintf(name, sizeof(name), "BGP parse thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_parse%u", i);
+		bgp_pth_parse[i] = frr_pthread_new(&attr, name, os_name);
+	}
+}
+
+void bgp_parse_pthreads_run(void)
+{
+	for (unsigned int i = 0; i < bgp_parse_count; i++)
+		frr_pthread_run(bgp_pth_parse[i], NULL);
+	for (unsigned int i = 0; i < bgp_parse_count; i++)
+		frr_pthread_wait_running(bgp_pth_parse[i]);
+}
+
+bool bgp_parse_enabled(void)
+{
+	return bgp_parse_count > 0;
+}
+
+void bgp_parse_schedule(struct peer *peer)
+{
+	struct frr_pthread *fpt = bgp_parse_pthread(peer);
+
+	thread_add_event(fpt->master, bgp_parse_packets, peer, 0,
+			 &peer->t_parse);
+}
+
+void bgp_parse_off(struct peer *peer)
+{
+	struct frr_pthread *fpt;
+
+	if (!bgp_parse_count)
+		return;
+
+	fpt = bgp_parse_pthread(peer);
+	if (!atomic_load_explicit(&fpt->running, memory_order_relaxed))
+		return;
+
+	/* also waits for a bgp_parse_packets() in progress to finish */
+	thread_cancel_async(fpt->master, &peer->t_parse, NULL);
+}
+
+struct bgp_preparse *bgp_preparse_get(struct peer *peer, struct stream *pkt)
+{
+	struct bgp_preparse *pre = bgp_preparse_first(&peer->ibuf_pre);
+
+	if (!pkt || !pre || pre->pkt != pkt)
+		return NULL;
+
+	bgp_preparse_del(&peer->ibuf_pre, pre);
+	return pre;
+}
+
+struct bgp_preparse_nlri *
+bgp_preparse_nlri_find(struct peer *peer, struct bgp_preparse *pre,
+		       enum bgp_preparse_nlri_type type,
+		       const struct bgp_nlri *packet)
+{
+	struct bgp_preparse_nlri *n;
+
+	if (!pre)
+		return NULL;
+
+	n = &pre->nlri[type];
+	if (!n->prefixes || n->nlri != packet->nlri
+	    || n->length != packet->length || n->afi != packet->afi
+	    || n->safi != packet->safi
+	    || n->addpath != !!bgp_addpath_encode_rx(peer, n->afi, n->safi))
+		return NULL;
+
+	return n;
+}
+
+void bgp_preparse_free(struct bgp_preparse *pre)
+{
+	if (!pre)
+		return;
+
+	/* whatever bgp_attr_parse() didn't take over */
+	if (pre->aspath)
+		aspath_unintern(&pre->aspath);
+	if (pre->as4_path)
+		aspath_unintern(&pre->as4_path);
+	if (pre->community)
+		community_unintern(&pre->community);
+	if (pre->lcommunity)
+		lcommunity_unintern(&pre->lcommunity);
+
+	for (int i = 0; i < BGP_PREPARSE_NLRI_MAX; i++)
+		XFREE(MTYPE_BGP_PREPARSE, pre->nlri[i].prefixes);
+
+	XFREE(MTYPE_BGP_PREPARSE, pre);
+}
+
+void bgp_preparse_clean(struct peer *peer)
+{
+	struct bgp_preparse *pre;
+
+	while ((pre = bgp_preparse_pop(&peer->ibuf_pre)))
+		bgp_preparse_free(pre);
+
+	if (peer->ibuf_parse)
+		stream_fifo_clean(peer->ibuf_parse);
+}
@@ -0,0 +1,138 @@
+/* BGP UPDATE pre-parsing pthreads
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_PARSE_H
+#define _FRR_BGP_PARSE_H
+
+#include "bgpd/bgpd.h"
+
+/*
+ * UPDATE parsing is split in two.  Everything that only depends on the
+ * packet bytes is done on a pool of pthreads between the I/O pthread and
+ * the main pthread:
+ *
+ * - the AS_PATH, AS4_PATH, COMMUNITIES and LARGE_COMMUNITIES attributes are
+ *   decoded into objects that only need to be interned;
+ *
+ * - unicast and multicast IPv4/IPv6 NLRI are decoded into prefix lists.
+ *
+ * The main pthread still runs bgp_update_receive() and bgp_attr_parse() as
+ * before, since those need the peer and the interning hashes, but picks up
+ * the pre-decoded pieces instead of decoding them again.  Pieces are matched
+ * by their position in the packet, so anything unusual (malformed data,
+ * capabilities changed in between, ...) simply goes through the regular
+ * parsers, which keep all the error handling.
+ *
+ * All packets of a peer go through the same pthread, in order, so the order
+ * in which they show up on peer->ibuf is unchanged.
+ */
+
+#define BGP_PARSE_THREADS_MAX 16
+
+/* One decoded NLRI section. */
+struct bgp_preparse_nlri {
+	/* section as bgp_update_receive() is expected to find it */
+	const uint8_t *nlri;
+	bgp_size_t length;
+	afi_t afi;
+	safi_t safi;
+	bool addpath;
+
+	uint32_t count;
+	struct bgp_preparse_prefix {
+		struct prefix p;
+		uint32_t addpath_id;
+	} *prefixes;
+};
+
+enum bgp_preparse_nlri_type {
+	BGP_PREPARSE_UPDATE,
+	BGP_PREPARSE_WITHDRAW,
+	BGP_PREPARSE_MP_UPDATE,
+	BGP_PREPARSE_MP_WITHDRAW,
+	BGP_PREPARSE_NLRI_MAX,
+};
+
+struct bgp_preparse {
+	struct bgp_preparse_item item;
+
+	/* packet this belongs to */
+	struct stream *pkt;
+
+	/* decoded and interned attributes, and where their value starts */
+	bool as4;
+	const uint8_t *aspath_at;
+	struct aspath *aspath;
+	const uint8_t *as4_path_at;
+	struct aspath *as4_path;
+	const uint8_t *community_at;
+	struct community *community;
+	const uint8_t *lcommunity_at;
+	struct lcommunity *lcommunity;
+
+	struct bgp_preparse_nlri nlri[BGP_PREPARSE_NLRI_MAX];
+};
+
+DECLARE_LIST(bgp_preparse, struct bgp_preparse, item)
+
+/* count < 0 picks a number based on the CPUs available, 0 disables this. */
+extern void bgp_parse_pthreads_init(int count);
+extern void bgp_parse_pthreads_run(void);
+
+/*
+ * Whether the I/O pthread should put packets on peer->ibuf_parse rather than
+ * on peer->ibuf.
+ */
+extern bool bgp_parse_enabled(void);
+
+/*
+ * Called from the I/O pthread after adding packets to peer->ibuf_parse.  They
+ * are moved to peer->ibuf once pre-parsed, and bgp_process_packet() is
+ * scheduled from there.
+ */
+extern void bgp_parse_schedule(struct peer *peer);
+
+/*
+ * Stop pre-parsing for a peer.  After this returns, nothing is added to
+ * peer->ibuf anymore; packets that weren't pre-parsed yet are left on
+ * peer->ibuf_parse.
+ */
+extern void bgp_parse_off(struct peer *peer);
+
+/*
+ * Take the pre-parsed data for pkt, if there is any.  Main pthread only, with
+ * peer->io_mtx held, right after taking pkt off peer->ibuf.
+ */
+extern struct bgp_preparse *bgp_preparse_get(struct peer *peer,
+					     struct stream *pkt);
+
+/*
+ * Find the decoded version of an NLRI section found by bgp_update_receive(),
+ * NULL if it has to be parsed.
+ */
+extern struct bgp_preparse_nlri *
+bgp_preparse_nlri_find(struct peer *peer, struct bgp_preparse *pre,
+		       enum bgp_preparse_nlri_type type,
+		       const struct bgp_nlri *packet);
+
+extern void bgp_preparse_free(struct bgp_preparse *pre);
+
+/* Drop any pre-parsed data and unparsed packets, with peer->io_mtx held. */
+extern void bgp_preparse_clean(struct peer *peer);
+
+#endif /* _FRR_BGP_PARSE_H */
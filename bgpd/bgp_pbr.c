@@ -58,120 +58,82 @@ static int bgp_pbr_match_entry_counter_unique;
 static int bgp_pbr_action_counter_unique;
 static int bgp_pbr_match_iptable_counter_unique;
 
-struct bgp_pbr_match_iptable_unique {
-	uint32_t unique;
-	struct bgp_pbr_match *bpm_found;
-};
+/* Secondary indexes on the self-allocated unique identifiers, used to
+ * find objects back when zebra notifies about their installation.
+ */
+static unsigned int bgp_pbr_rule_unique_hash_key(const void *arg)
+{
+	const struct bgp_pbr_rule *bpr = arg;
 
-struct bgp_pbr_match_entry_unique {
-	uint32_t unique;
-	struct bgp_pbr_match_entry *bpme_found;
-};
+	return jhash_1word(bpr->unique, 0);
+}
 
-struct bgp_pbr_action_unique {
-	uint32_t unique;
-	struct bgp_pbr_action *bpa_found;
-};
+static bool bgp_pbr_rule_unique_hash_equal(const void *arg1,
+					   const void *arg2)
+{
+	const struct bgp_pbr_rule *r1 = arg1, *r2 = arg2;
 
-struct bgp_pbr_rule_unique {
-	uint32_t unique;
-	struct bgp_pbr_rule *bpr_found;
-};
+	return r1->unique == r2->unique;
+}
 
-static int bgp_pbr_rule_walkcb(struct hash_bucket *bucket, void *arg)
+static unsigned int bgp_pbr_action_unique_hash_key(const void *arg)
 {
-	struct bgp_pbr_rule *bpr = (struct bgp_pbr_rule *)bucket->data;
-	struct bgp_pbr_rule_unique *bpru = (struct bgp_pbr_rule_unique *)
-		arg;
-	uint32_t unique = bpru->unique;
+	const struct bgp_pbr_action *bpa = arg;
 
-	if (bpr->unique == unique) {
-		bpru->bpr_found = bpr;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return jhash_1word(bpa->unique, 0);
 }
 
-static int bgp_pbr_action_walkcb(struct hash_bucket *bucket, void *arg)
+static bool bgp_pbr_action_unique_hash_equal(const void *arg1,
+					     const void *arg2)
 {
-	struct bgp_pbr_action *bpa = (struct bgp_pbr_action *)bucket->data;
-	struct bgp_pbr_action_unique *bpau = (struct bgp_pbr_action_unique *)
-		arg;
-	uint32_t unique = bpau->unique;
+	const struct bgp_pbr_action *r1 = arg1, *r2 = arg2;
 
-	if (bpa->unique == unique) {
-		bpau->bpa_found = bpa;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return r1->unique == r2->unique;
 }
 
-static int bgp_pbr_match_entry_walkcb(struct hash_bucket *bucket, void *arg)
+static unsigned int bgp_pbr_match_unique_hash_key(const void *arg)
 {
-	struct bgp_pbr_match_entry *bpme =
-		(struct bgp_pbr_match_entry *)bucket->data;
-	struct bgp_pbr_match_entry_unique *bpmeu =
-		(struct bgp_pbr_match_entry_unique *)arg;
-	uint32_t unique = bpmeu->unique;
-
-	if (bpme->unique == unique) {
-		bpmeu->bpme_found = bpme;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	const struct bgp_pbr_match *bpm = arg;
+
+	return jhash_1word(bpm->unique, 0);
 }
 
-struct bgp_pbr_match_ipsetname {
-	char *ipsetname;
-	struct bgp_pbr_match *bpm_found;
-};
+static bool bgp_pbr_match_unique_hash_equal(const void *arg1,
+					    const void *arg2)
+{
+	const struct bgp_pbr_match *r1 = arg1, *r2 = arg2;
+
+	return r1->unique == r2->unique;
+}
 
-static int bgp_pbr_match_pername_walkcb(struct hash_bucket *bucket, void *arg)
+static unsigned int bgp_pbr_match_iptable_unique_hash_key(const void *arg)
 {
-	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
-	struct bgp_pbr_match_ipsetname *bpmi =
-		(struct bgp_pbr_match_ipsetname *)arg;
-	char *ipset_name = bpmi->ipsetname;
+	const struct bgp_pbr_match *bpm = arg;
 
-	if (!strncmp(ipset_name, bpm->ipset_name,
-		     ZEBRA_IPSET_NAME_SIZE)) {
-		bpmi->bpm_found = bpm;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return jhash_1word(bpm->unique2, 0);
 }
 
-static int bgp_pbr_match_iptable_walkcb(struct hash_bucket *bucket, void *arg)
+static bool bgp_pbr_match_iptable_unique_hash_equal(const void *arg1,
+						    const void *arg2)
 {
-	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
-	struct bgp_pbr_match_iptable_unique *bpmiu =
-		(struct bgp_pbr_match_iptable_unique *)arg;
-	uint32_t unique = bpmiu->unique;
+	const struct bgp_pbr_match *r1 = arg1, *r2 = arg2;
 
-	if (bpm->unique2 == unique) {
-		bpmiu->bpm_found = bpm;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return r1->unique2 == r2->unique2;
 }
 
-struct bgp_pbr_match_unique {
-	uint32_t unique;
-	struct bgp_pbr_match *bpm_found;
-};
+static unsigned int bgp_pbr_match_entry_unique_hash_key(const void *arg)
+{
+	const struct bgp_pbr_match_entry *bpme = arg;
+
+	return jhash_1word(bpme->unique, 0);
+}
 
-static int bgp_pbr_match_walkcb(struct hash_bucket *bucket, void *arg)
+static bool bgp_pbr_match_entry_unique_hash_equal(const void *arg1,
+						  const void *arg2)
 {
-	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
-	struct bgp_pbr_match_unique *bpmu = (struct bgp_pbr_match_unique *)
-		arg;
-	uint32_t unique = bpmu->unique;
+	const struct bgp_pbr_match_entry *r1 = arg1, *r2 = arg2;
 
-	if (bpm->unique == unique) {
-		bpmu->bpm_found = bpm;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
+	return r1->unique == r2->unique;
 }
 
 static int snprintf_bgp_pbr_match_val(char *str, int len,
@@ -1315,42 +1277,36 @@ struct bgp_pbr_rule *bgp_pbr_rule_lookup(vrf_id_t vrf_id,
 					 uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_rule_unique bpru;
+	struct bgp_pbr_rule bpr;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpru.unique = unique;
-	bpru.bpr_found = NULL;
-	hash_walk(bgp->pbr_rule_hash, bgp_pbr_rule_walkcb, &bpru);
-	return bpru.bpr_found;
+	bpr.unique = unique;
+	return hash_lookup(bgp->pbr_rule_unique_hash, &bpr);
 }
 
 struct bgp_pbr_action *bgp_pbr_action_rule_lookup(vrf_id_t vrf_id,
 						  uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_action_unique bpau;
+	struct bgp_pbr_action bpa;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpau.unique = unique;
-	bpau.bpa_found = NULL;
-	hash_walk(bgp->pbr_action_hash, bgp_pbr_action_walkcb, &bpau);
-	return bpau.bpa_found;
+	bpa.unique = unique;
+	return hash_lookup(bgp->pbr_action_unique_hash, &bpa);
 }
 
 struct bgp_pbr_match *bgp_pbr_match_ipset_lookup(vrf_id_t vrf_id,
 						 uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_match_unique bpmu;
+	struct bgp_pbr_match bpm;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpmu.unique = unique;
-	bpmu.bpm_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_match_walkcb, &bpmu);
-	return bpmu.bpm_found;
+	bpm.unique = unique;
+	return hash_lookup(bgp->pbr_match_unique_hash, &bpm);
 }
 
 struct bgp_pbr_match_entry *bgp_pbr_match_ipset_entry_lookup(vrf_id_t vrf_id,
@@ -1358,41 +1314,59 @@ struct bgp_pbr_match_entry *bgp_pbr_match_ipset_entry_lookup(vrf_id_t vrf_id,
 						       uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_match_entry_unique bpmeu;
-	struct bgp_pbr_match_ipsetname bpmi;
+	struct bgp_pbr_match_entry bpme, *found;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpmi.ipsetname = XCALLOC(MTYPE_TMP, ZEBRA_IPSET_NAME_SIZE);
-	snprintf(bpmi.ipsetname, ZEBRA_IPSET_NAME_SIZE, "%s", ipset_name);
-	bpmi.bpm_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_match_pername_walkcb, &bpmi);
-	XFREE(MTYPE_TMP, bpmi.ipsetname);
-	if (!bpmi.bpm_found)
+	bpme.unique = unique;
+	found = hash_lookup(bgp->pbr_match_entry_unique_hash, &bpme);
+	if (!found || !found->backpointer
+	    || strncmp(found->backpointer->ipset_name, ipset_name,
+		       ZEBRA_IPSET_NAME_SIZE))
 		return NULL;
-	bpmeu.bpme_found = NULL;
-	bpmeu.unique = unique;
-	hash_walk(bpmi.bpm_found->entry_hash,
-		  bgp_pbr_match_entry_walkcb, &bpmeu);
-	return bpmeu.bpme_found;
+	return found;
 }
 
 struct bgp_pbr_match *bgp_pbr_match_iptable_lookup(vrf_id_t vrf_id,
 						   uint32_t unique)
 {
 	struct bgp *bgp = bgp_lookup_by_vrf_id(vrf_id);
-	struct bgp_pbr_match_iptable_unique bpmiu;
+	struct bgp_pbr_match bpm;
 
 	if (!bgp || unique == 0)
 		return NULL;
-	bpmiu.unique = unique;
-	bpmiu.bpm_found = NULL;
-	hash_walk(bgp->pbr_match_hash, bgp_pbr_match_iptable_walkcb, &bpmiu);
-	return bpmiu.bpm_found;
+	bpm.unique2 = unique;
+	return hash_lookup(bgp->pbr_match_iptable_unique_hash, &bpm);
 }
 
 void bgp_pbr_cleanup(struct bgp *bgp)
 {
+	/* indexes only, the objects are freed with the main hashes */
+	if (bgp->pbr_match_entry_unique_hash) {
+		hash_clean(bgp->pbr_match_entry_unique_hash, NULL);
+		hash_free(bgp->pbr_match_entry_unique_hash);
+		bgp->pbr_match_entry_unique_hash = NULL;
+	}
+	if (bgp->pbr_match_unique_hash) {
+		hash_clean(bgp->pbr_match_unique_hash, NULL);
+		hash_free(bgp->pbr_match_unique_hash);
+		bgp->pbr_match_unique_hash = NULL;
+	}
+	if (bgp->pbr_match_iptable_unique_hash) {
+		hash_clean(bgp->pbr_match_iptable_unique_hash, NULL);
+		hash_free(bgp->pbr_match_iptable_unique_hash);
+		bgp->pbr_match_iptable_unique_hash = NULL;
+	}
+	if (bgp->pbr_rule_unique_hash) {
+		hash_clean(bgp->pbr_rule_unique_hash, NULL);
+		hash_free(bgp->pbr_rule_unique_hash);
+		bgp->pbr_rule_unique_hash = NULL;
+	}
+	if (bgp->pbr_action_unique_hash) {
+		hash_clean(bgp->pbr_action_unique_hash, NULL);
+		hash_free(bgp->pbr_action_unique_hash);
+		bgp->pbr_action_unique_hash = NULL;
+	}
 	if (bgp->pbr_match_hash) {
 		hash_clean(bgp->pbr_match_hash, bgp_pbr_match_free);
 		hash_free(bgp->pbr_match_hash);
@@ -1431,6 +1405,27 @@ void bgp_pbr_init(struct bgp *bgp)
 				 bgp_pbr_rule_hash_equal,
 				 "Match Rule");
 
+	bgp->pbr_match_unique_hash =
+		hash_create_size(8, bgp_pbr_match_unique_hash_key,
+				 bgp_pbr_match_unique_hash_equal,
+				 "Match Hash by ID");
+	bgp->pbr_match_iptable_unique_hash =
+		hash_create_size(8, bgp_pbr_match_iptable_unique_hash_key,
+				 bgp_pbr_match_iptable_unique_hash_equal,
+				 "Match Hash by iptable ID");
+	bgp->pbr_match_entry_unique_hash =
+		hash_create_size(8, bgp_pbr_match_entry_unique_hash_key,
+				 bgp_pbr_match_entry_unique_hash_equal,
+				 "Match Entry Hash by ID");
+	bgp->pbr_action_unique_hash =
+		hash_create_size(8, bgp_pbr_action_unique_hash_key,
+				 bgp_pbr_action_unique_hash_equal,
+				 "Match Hash Entry by ID");
+	bgp->pbr_rule_unique_hash =
+		hash_create_size(8, bgp_pbr_rule_unique_hash_key,
+				 bgp_pbr_rule_unique_hash_equal,
+				 "Match Rule by ID");
+
 	bgp->bgp_pbr_cfg = XCALLOC(MTYPE_PBR, sizeof(struct bgp_pbr_config));
 	bgp->bgp_pbr_cfg->pbr_interface_any_ipv4 = true;
 }
@@ -1691,6 +1686,7 @@ static void bgp_pbr_flush_iprule(struct bgp *bgp, struct bgp_pbr_action *bpa,
 		}
 	}
 	hash_release(bgp->pbr_rule_hash, bpr);
+	hash_release(bgp->pbr_rule_unique_hash, bpr);
 	if (bpa->refcnt == 0) {
 		if (bpa->installed && bpa->table_id != 0) {
 			bgp_send_pbr_rule_action(bpa, NULL, false);
@@ -1729,6 +1725,7 @@ static void bgp_pbr_flush_entry(struct bgp *bgp, struct bgp_pbr_action *bpa,
 		}
 	}
 	hash_release(bpm->entry_hash, bpme);
+	hash_release(bgp->pbr_match_entry_unique_hash, bpme);
 	if (hashcount(bpm->entry_hash) == 0) {
 		/* delete iptable entry first */
 		/* then delete ipset match */
@@ -1744,6 +1741,8 @@ static void bgp_pbr_flush_entry(struct bgp *bgp, struct bgp_pbr_action *bpa,
 			bpm->action = NULL;
 		}
 		hash_release(bgp->pbr_match_hash, bpm);
+		hash_release(bgp->pbr_match_unique_hash, bpm);
+		hash_release(bgp->pbr_match_iptable_unique_hash, bpm);
 		/* XXX release pbr_match_action if not used
 		 * note that drop does not need to call send_pbr_action
 		 */
@@ -1809,6 +1808,30 @@ static int bgp_pbr_get_same_rule(struct hash_bucket *bucket, void *arg)
 	return HASHWALK_CONTINUE;
 }
 
+/* pbr_rule_hash does not key on the action, so all rules matching the
+ * same traffic share a hash key;  only walk that chain.
+ */
+static struct bgp_pbr_rule *bgp_pbr_rule_find_same(struct bgp *bgp,
+						   struct bgp_pbr_rule *bpr)
+{
+	struct hash *hash = bgp->pbr_rule_hash;
+	struct bgp_pbr_rule_remain bprr;
+	struct hash_bucket *hb;
+	unsigned int key;
+
+	bprr.bpr_to_match = bpr;
+	bprr.bpr_found = NULL;
+
+	key = bgp_pbr_rule_hash_key(bpr);
+	for (hb = hash->index[key & (hash->size - 1)]; hb; hb = hb->next) {
+		if (hb->key != key)
+			continue;
+		if (bgp_pbr_get_same_rule(hb, &bprr) == HASHWALK_ABORT)
+			break;
+	}
+	return bprr.bpr_found;
+}
+
 static int bgp_pbr_get_remaining_entry(struct hash_bucket *bucket, void *arg)
 {
 	struct bgp_pbr_match *bpm = (struct bgp_pbr_match *)bucket->data;
@@ -1889,9 +1912,7 @@ static void bgp_pbr_policyroute_remove_from_zebra_unit(
 		/* A previous entry may already exist
 		 * flush previous entry if necessary
 		 */
-		bprr.bpr_to_match = bpr;
-		bprr.bpr_found = NULL;
-		hash_walk(bgp->pbr_rule_hash, bgp_pbr_get_same_rule, &bprr);
+		bprr.bpr_found = bgp_pbr_rule_find_same(bgp, bpr);
 		if (bprr.bpr_found) {
 			static struct bgp_pbr_rule *local_bpr;
 			static struct bgp_pbr_action *local_bpa;
@@ -2333,6 +2354,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 		bpa->unique = ++bgp_pbr_action_counter_unique;
 		/* 0 value is forbidden */
 		bpa->install_in_progress = false;
+		(void)hash_get(bgp->pbr_action_unique_hash, bpa,
+			       hash_alloc_intern);
 	}
 	if (bpf->type == BGP_PBR_IPRULE) {
 		memset(&pbr_rule, 0, sizeof(pbr_rule));
@@ -2351,6 +2374,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 			       bgp_pbr_rule_alloc_intern);
 		if (bpr && bpr->unique == 0) {
 			bpr->unique = ++bgp_pbr_action_counter_unique;
+			(void)hash_get(bgp->pbr_rule_unique_hash, bpr,
+				       hash_alloc_intern);
 			bpr->installed = false;
 			bpr->install_in_progress = false;
 			/* link bgp info to bpr */
@@ -2384,9 +2409,7 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 		/* A previous entry may already exist
 		 * flush previous entry if necessary
 		 */
-		bprr.bpr_to_match = bpr;
-		bprr.bpr_found = NULL;
-		hash_walk(bgp->pbr_rule_hash, bgp_pbr_get_same_rule, &bprr);
+		bprr.bpr_found = bgp_pbr_rule_find_same(bgp, bpr);
 		if (bprr.bpr_found) {
 			static struct bgp_pbr_rule *local_bpr;
 			static struct bgp_pbr_action *local_bpa;
@@ -2487,6 +2510,10 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 
 		/* unique2 should be updated too */
 		bpm->unique2 = ++bgp_pbr_match_iptable_counter_unique;
+		(void)hash_get(bgp->pbr_match_unique_hash, bpm,
+			       hash_alloc_intern);
+		(void)hash_get(bgp->pbr_match_iptable_unique_hash, bpm,
+			       hash_alloc_intern);
 		bpm->installed_in_iptable = false;
 		bpm->install_in_progress = false;
 		bpm->install_iptable_in_progress = false;
@@ -2511,6 +2538,8 @@ static void bgp_pbr_policyroute_add_to_zebra_unit(struct bgp *bgp,
 	if (bpme->unique == 0) {
 		bpme->unique = ++bgp_pbr_match_entry_counter_unique;
 		/* 0 value is forbidden */
+		(void)hash_get(bgp->pbr_match_entry_unique_hash, bpme,
+			       hash_alloc_intern);
 		bpme->backpointer = bpm;
 		bpme->installed = false;
 		bpme->install_in_progress = false;
@@ -25,6 +25,7 @@
 #include "memory.h"
 #include "queue.h"
 #include "filter.h"
+#include "jhash.h"
 
 #include "bgpd.h"
 #include "bgp_aspath.h"
@@ -35,7 +36,7 @@
 
    (^|[,{}() ]|$) */
 
-regex_t *bgp_regcomp(const char *regstr)
+static char *bgp_regex_magic(const char *regstr)
 {
 	/* Convert _ character to generic regular expression. */
 	int i, j;
@@ -43,8 +44,6 @@ regex_t *bgp_regcomp(const char *regstr)
 	int magic = 0;
 	char *magic_str;
 	char magic_regexp[] = "(^|[,{}() ]|$)";
-	int ret;
-	regex_t *regex;
 
 	len = strlen(regstr);
 	for (i = 0; i < len; i++)
@@ -63,6 +62,17 @@ regex_t *bgp_regcomp(const char *regstr)
 	}
 	magic_str[j] = '\0';
 
+	return magic_str;
+}
+
+regex_t *bgp_regcomp(const char *regstr)
+{
+	char *magic_str;
+	int ret;
+	regex_t *regex;
+
+	magic_str = bgp_regex_magic(regstr);
+
 	regex = XMALLOC(MTYPE_BGP_REGEXP, sizeof(regex_t));
 
 	ret = regcomp(regex, magic_str, REG_EXTENDED | REG_NOSUB);
@@ -87,3 +97,660 @@ void bgp_regex_free(regex_t *regex)
 	regfree(regex);
 	XFREE(MTYPE_BGP_REGEXP, regex);
 }
+
+/*
+ * DFA matcher for AS path regular expressions.
+ *
+ * The expression is expanded exactly like bgp_regcomp() does and parsed as a
+ * POSIX ERE into a Thompson NFA.  The DFA is built from it lazily, one state
+ * per set of NFA states reached while matching, so the work per character is
+ * a table lookup once the DFA has seen paths like the ones it is run on.
+ * Bytes that every bracket expression treats the same are folded into one
+ * input class, which keeps the transition tables small.
+ *
+ * Anything whose meaning differs between the POSIX and PCRE flavours of
+ * regcomp(), or that the parser doesn't know (back-references, collating
+ * elements, ...), isn't compiled; callers keep using regexec() for those.
+ */
+
+#define BGP_DFA_AST_MAX 1024
+#define BGP_DFA_NFA_MAX 4096
+#define BGP_DFA_REPEAT_MAX 255
+#define BGP_DFA_DEPTH_MAX 32
+
+/* all DFA states are dropped when there are more than this */
+#define BGP_DFA_STATES_MAX 512
+
+enum bgp_dfa_ast_type {
+	DFA_AST_SET,
+	DFA_AST_BOL,
+	DFA_AST_EOL,
+	DFA_AST_EMPTY,
+	DFA_AST_CAT,
+	DFA_AST_ALT,
+	DFA_AST_REPEAT,
+};
+
+struct bgp_dfa_ast {
+	enum bgp_dfa_ast_type type;
+	int l, r;
+	/* DFA_AST_REPEAT, max < 0 is unbounded */
+	int min, max;
+	/* DFA_AST_SET */
+	uint8_t set[32];
+};
+
+struct bgp_dfa_parse {
+	const char *p;
+	struct bgp_dfa_ast *ast;
+	int count;
+	int depth;
+	bool fail;
+};
+
+enum bgp_dfa_nfa_type {
+	DFA_NFA_SET,
+	DFA_NFA_SPLIT,
+	DFA_NFA_BOL,
+	DFA_NFA_EOL,
+	DFA_NFA_MATCH,
+};
+
+struct bgp_dfa_nfa {
+	enum bgp_dfa_nfa_type type;
+	uint16_t out, out1;
+	uint8_t set[32];
+};
+
+struct bgp_dfa_state {
+	uint32_t hash;
+	uint16_t nset;
+	bool initial;
+	bool match;
+	bool match_at_end;
+	/* next state by input class, -1 if not known yet */
+	int16_t *next;
+	uint16_t *set;
+};
+
+struct bgp_dfa {
+	struct bgp_dfa_nfa *nfa;
+	unsigned int nnfa;
+	uint16_t start;
+
+	uint8_t cls[256];
+	uint8_t cls_byte[256];
+	unsigned int ncls;
+
+	struct bgp_dfa_state *states;
+	unsigned int nstates, states_alloc;
+	unsigned int flushes;
+	int init;
+
+	/* closure scratch space */
+	uint32_t *mark;
+	uint32_t gen;
+	uint16_t *stack;
+	uint16_t *buf;
+	uint16_t *kernel;
+};
+
+#define DFA_SET_HAS(set, c) ((set)[(uint8_t)(c) >> 3] & (1 << ((c) & 7)))
+#define DFA_SET_ADD(set, c) ((set)[(uint8_t)(c) >> 3] |= (1 << ((c) & 7)))
+
+static int bgp_dfa_parse_alt(struct bgp_dfa_parse *rp);
+
+static int bgp_dfa_ast_new(struct bgp_dfa_parse *rp,
+			   enum bgp_dfa_ast_type type, int l, int r)
+{
+	struct bgp_dfa_ast *node;
+
+	if (rp->fail || rp->count == BGP_DFA_AST_MAX) {
+		rp->fail = true;
+		return -1;
+	}
+
+	node = &rp->ast[rp->count];
+	memset(node, 0, sizeof(*node));
+	node->type = type;
+	node->l = l;
+	node->r = r;
+	return rp->count++;
+}
+
+static int bgp_dfa_parse_bracket(struct bgp_dfa_parse *rp)
+{
+	uint8_t set[32] = {};
+	bool neg = false, first = true;
+	int node;
+
+	if (*rp->p == '^') {
+		neg = true;
+		rp->p++;
+	}
+
+	for (;;) {
+		uint8_t lo = *rp->p, hi;
+
+		if (lo == ']' && !first) {
+			rp->p++;
+			break;
+		}
+		/*
+		 * End of string, collating elements and classes, and
+		 * backslashes (escapes for PCRE, not for POSIX).
+		 */
+		if (lo == '\0' || lo == '\\'
+		    || (lo == '[' && strchr(".=:", rp->p[1]))
+		    || (lo == '-' && !first && rp->p[1] != ']')) {
+			rp->fail = true;
+			return -1;
+		}
+		rp->p++;
+		first = false;
+
+		if (rp->p[0] != '-' || rp->p[1] == ']' || rp->p[1] == '\0') {
+			DFA_SET_ADD(set, lo);
+			continue;
+		}
+
+		hi = rp->p[1];
+		if (hi < lo || hi == '[' || hi == '\\') {
+			rp->fail = true;
+			return -1;
+		}
+		rp->p += 2;
+		for (unsigned int c = lo; c <= hi; c++)
+			DFA_SET_ADD(set, c);
+	}
+
+	if (neg)
+		for (unsigned int i = 0; i < sizeof(set); i++)
+			set[i] = ~set[i];
+
+	node = bgp_dfa_ast_new(rp, DFA_AST_SET, -1, -1);
+	if (node >= 0)
+		memcpy(rp->ast[node].set, set, sizeof(set));
+	return node;
+}
+
+static int bgp_dfa_parse_atom(struct bgp_dfa_parse *rp)
+{
+	uint8_t c = *rp->p++;
+	int node;
+
+	switch (c) {
+	case '(':
+		if (++rp->depth > BGP_DFA_DEPTH_MAX) {
+			rp->fail = true;
+			return -1;
+		}
+		node = bgp_dfa_parse_alt(rp);
+		if (rp->fail || *rp->p != ')') {
+			rp->fail = true;
+			return -1;
+		}
+		rp->p++;
+		rp->depth--;
+		return node;
+	case '[':
+		return bgp_dfa_parse_bracket(rp);
+	case '^':
+		return bgp_dfa_ast_new(rp, DFA_AST_BOL, -1, -1);
+	case '$':
+		return bgp_dfa_ast_new(rp, DFA_AST_EOL, -1, -1);
+	case '.':
+		node = bgp_dfa_ast_new(rp, DFA_AST_SET, -1, -1);
+		if (node >= 0)
+			memset(rp->ast[node].set, 0xff,
+			       sizeof(rp->ast[node].set));
+		return node;
+	case '\\':
+		/* back-references and GNU extensions */
+		c = *rp->p;
+		if (c == '\0' || isalnum(c)) {
+			rp->fail = true;
+			return -1;
+		}
+		rp->p++;
+		break;
+	case ')':
+	case '*':
+	case '+':
+	case '?':
+	case '{':
+		/* unbalanced, or nothing to repeat */
+		rp->fail = true;
+		return -1;
+	}
+
+	node = bgp_dfa_ast_new(rp, DFA_AST_SET, -1, -1);
+	if (node >= 0)
+		DFA_SET_ADD(rp->ast[node].set, c);
+	return node;
+}
+
+static int bgp_dfa_parse_count(struct bgp_dfa_parse *rp)
+{
+	int n = 0;
+
+	if (!isdigit((unsigned char)*rp->p)) {
+		rp->fail = true;
+		return -1;
+	}
+	while (isdigit((unsigned char)*rp->p)) {
+		n = n * 10 + *rp->p++ - '0';
+		if (n > BGP_DFA_REPEAT_MAX) {
+			rp->fail = true;
+			return -1;
+		}
+	}
+	return n;
+}
+
+static int bgp_dfa_parse_piece(struct bgp_dfa_parse *rp)
+{
+	int node = bgp_dfa_parse_atom(rp);
+
+	while (!rp->fail && *rp->p && strchr("*+?{", *rp->p)) {
+		enum bgp_dfa_ast_type type = rp->ast[node].type;
+		int min = 0, max = -1;
+
+		/* repeated anchors aren't treated the same everywhere */
+		if (type == DFA_AST_BOL || type == DFA_AST_EOL) {
+			rp->fail = true;
+			return -1;
+		}
+
+		switch (*rp->p++) {
+		case '+':
+			min = 1;
+			break;
+		case '?':
+			max = 1;
+			break;
+		case '{':
+			min = max = bgp_dfa_parse_count(rp);
+			if (*rp->p == ',') {
+				rp->p++;
+				max = *rp->p == '}' ? -1
+						     : bgp_dfa_parse_count(rp);
+			}
+			if (rp->fail || *rp->p != '}'
+			    || (max >= 0 && max < min)) {
+				rp->fail = true;
+				return -1;
+			}
+			rp->p++;
+			break;
+		}
+
+		node = bgp_dfa_ast_new(rp, DFA_AST_REPEAT, node, -1);
+		if (node >= 0) {
+			rp->ast[node].min = min;
+			rp->ast[node].max = max;
+		}
+	}
+	return rp->fail ? -1 : node;
+}
+
+static int bgp_dfa_parse_branch(struct bgp_dfa_parse *rp)
+{
+	int node = -1;
+
+	while (*rp->p && *rp->p != '|' && !(*rp->p == ')' && rp->depth)) {
+		int piece = bgp_dfa_parse_piece(rp);
+
+		if (rp->fail)
+			return -1;
+		node = node < 0 ? piece
+				: bgp_dfa_ast_new(rp, DFA_AST_CAT, node, piece);
+	}
+
+	if (node < 0)
+		node = bgp_dfa_ast_new(rp, DFA_AST_EMPTY, -1, -1);
+	return node;
+}
+
+static int bgp_dfa_parse_alt(struct bgp_dfa_parse *rp)
+{
+	int node = bgp_dfa_parse_branch(rp);
+
+	while (!rp->fail && *rp->p == '|') {
+		rp->p++;
+		node = bgp_dfa_ast_new(rp, DFA_AST_ALT, node,
+				       bgp_dfa_parse_branch(rp));
+	}
+	return rp->fail ? -1 : node;
+}
+
+static int bgp_dfa_nfa_new(struct bgp_dfa *dfa, enum bgp_dfa_nfa_type type,
+			   int out, int out1)
+{
+	struct bgp_dfa_nfa *n;
+
+	if (out < 0 || out1 < 0 || dfa->nnfa == BGP_DFA_NFA_MAX)
+		return -1;
+
+	n = &dfa->nfa[dfa->nnfa];
+	memset(n, 0, sizeof(*n));
+	n->type = type;
+	n->out = out;
+	n->out1 = out1;
+	return dfa->nnfa++;
+}
+
+/* Emit the NFA for node, continuing with state next; returns its start. */
+static int bgp_dfa_emit(struct bgp_dfa *dfa, struct bgp_dfa_ast *ast, int node,
+			int next)
+{
+	struct bgp_dfa_ast *a = &ast[node];
+	int s, body;
+
+	if (next < 0)
+		return -1;
+
+	switch (a->type) {
+	case DFA_AST_SET:
+		s = bgp_dfa_nfa_new(dfa, DFA_NFA_SET, next, 0);
+		if (s >= 0)
+			memcpy(dfa->nfa[s].set, a->set, sizeof(a->set));
+		return s;
+	case DFA_AST_BOL:
+		return bgp_dfa_nfa_new(dfa, DFA_NFA_BOL, next, 0);
+	case DFA_AST_EOL:
+		return bgp_dfa_nfa_new(dfa, DFA_NFA_EOL, next, 0);
+	case DFA_AST_EMPTY:
+		return next;
+	case DFA_AST_CAT:
+		return bgp_dfa_emit(dfa, ast, a->l,
+				    bgp_dfa_emit(dfa, ast, a->r, next));
+	case DFA_AST_ALT:
+		return bgp_dfa_nfa_new(dfa, DFA_NFA_SPLIT,
+				       bgp_dfa_emit(dfa, ast, a->l, next),
+				       bgp_dfa_emit(dfa, ast, a->r, next));
+	case DFA_AST_REPEAT:
+		if (a->max < 0) {
+			/* loop back through the split to repeat */
+			s = bgp_dfa_nfa_new(dfa, DFA_NFA_SPLIT, next, next);
+			body = bgp_dfa_emit(dfa, ast, a->l, s);
+			if (body < 0)
+				return -1;
+			dfa->nfa[s].out = body;
+			next = s;
+		} else {
+			for (int i = a->min; i < a->max; i++)
+				next = bgp_dfa_nfa_new(
+					dfa, DFA_NFA_SPLIT,
+					bgp_dfa_emit(dfa, ast, a->l, next),
+					next);
+		}
+		for (int i = 0; i < a->min; i++)
+			next = bgp_dfa_emit(dfa, ast, a->l, next);
+		return next;
+	}
+
+	return -1;
+}
+
+/* Split bytes into classes no bracket expression tells apart. */
+static void bgp_dfa_classes(struct bgp_dfa *dfa)
+{
+	int16_t remap[256][2];
+
+	memset(dfa->cls, 0, sizeof(dfa->cls));
+	dfa->ncls = 1;
+
+	for (unsigned int i = 0; i < dfa->nnfa; i++) {
+		struct bgp_dfa_nfa *n = &dfa->nfa[i];
+		unsigned int ncls = 0;
+
+		if (n->type != DFA_NFA_SET)
+			continue;
+
+		memset(remap, 0xff, sizeof(remap));
+		for (unsigned int c = 0; c < 256; c++) {
+			bool member = DFA_SET_HAS(n->set, c);
+			int16_t *to = &remap[dfa->cls[c]][member];
+
+			if (*to < 0)
+				*to = ncls++;
+			dfa->cls[c] = *to;
+		}
+		dfa->ncls = ncls;
+	}
+
+	for (unsigned int c = 256; c-- > 0;)
+		dfa->cls_byte[dfa->cls[c]] = c;
+}
+
+static void bgp_dfa_push(struct bgp_dfa *dfa, unsigned int *sp, uint16_t id)
+{
+	if (dfa->mark[id] == dfa->gen)
+		return;
+	dfa->mark[id] = dfa->gen;
+	dfa->stack[(*sp)++] = id;
+}
+
+static int bgp_dfa_cmp(const void *a, const void *b)
+{
+	return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+/*
+ * Epsilon closure of the n states in kernel, into dfa->buf.  Only states that
+ * consume input, end-of-line assertions that couldn't be followed and the
+ * match state are kept; those are all that matter for what comes next.
+ */
+static unsigned int bgp_dfa_closure(struct bgp_dfa *dfa,
+				    const uint16_t *kernel, unsigned int n,
+				    bool bol, bool eol)
+{
+	unsigned int sp = 0, count = 0;
+
+	if (++dfa->gen == 0) {
+		memset(dfa->mark, 0, dfa->nnfa * sizeof(*dfa->mark));
+		dfa->gen = 1;
+	}
+
+	for (unsigned int i = 0; i < n; i++)
+		bgp_dfa_push(dfa, &sp, kernel[i]);
+
+	while (sp) {
+		uint16_t id = dfa->stack[--sp];
+		struct bgp_dfa_nfa *nfa = &dfa->nfa[id];
+
+		switch (nfa->type) {
+		case DFA_NFA_SET:
+		case DFA_NFA_MATCH:
+			dfa->buf[count++] = id;
+			break;
+		case DFA_NFA_SPLIT:
+			bgp_dfa_push(dfa, &sp, nfa->out1);
+			bgp_dfa_push(dfa, &sp, nfa->out);
+			break;
+		case DFA_NFA_BOL:
+			if (bol)
+				bgp_dfa_push(dfa, &sp, nfa->out);
+			break;
+		case DFA_NFA_EOL:
+			if (eol)
+				bgp_dfa_push(dfa, &sp, nfa->out);
+			else
+				dfa->buf[count++] = id;
+			break;
+		}
+	}
+
+	qsort(dfa->buf, count, sizeof(*dfa->buf), bgp_dfa_cmp);
+	return count;
+}
+
+static bool bgp_dfa_has_match(struct bgp_dfa *dfa, const uint16_t *set,
+			      unsigned int n)
+{
+	for (unsigned int i = 0; i < n; i++)
+		if (dfa->nfa[set[i]].type == DFA_NFA_MATCH)
+			return true;
+	return false;
+}
+
+static void bgp_dfa_flush(struct bgp_dfa *dfa)
+{
+	for (unsigned int i = 0; i < dfa->nstates; i++)
+		XFREE(MTYPE_BGP_REGEXP_DFA, dfa->states[i].next);
+	dfa->nstates = 0;
+	dfa->flushes++;
+	dfa->init = -1;
+}
+
+/* DFA state for the n NFA states in dfa->buf. */
+static int bgp_dfa_state_get(struct bgp_dfa *dfa, unsigned int n, bool initial)
+{
+	struct bgp_dfa_state *st;
+	size_t setsize = n * sizeof(*dfa->buf);
+	uint32_t hash = jhash(dfa->buf, setsize, initial);
+	unsigned int i;
+
+	for (i = 0; i < dfa->nstates; i++) {
+		st = &dfa->states[i];
+		if (st->hash == hash && st->nset == n && st->initial == initial
+		    && !memcmp(st->set, dfa->buf, setsize))
+			return i;
+	}
+
+	if (dfa->nstates == BGP_DFA_STATES_MAX)
+		bgp_dfa_flush(dfa);
+
+	if (dfa->nstates == dfa->states_alloc) {
+		dfa->states_alloc = MAX(dfa->states_alloc * 2, 8);
+		dfa->states = XREALLOC(MTYPE_BGP_REGEXP_DFA, dfa->states,
+				       dfa->states_alloc * sizeof(*dfa->states));
+	}
+
+	i = dfa->nstates++;
+	st = &dfa->states[i];
+	st->hash = hash;
+	st->nset = n;
+	st->initial = initial;
+	st->next = XMALLOC(MTYPE_BGP_REGEXP_DFA,
+			   dfa->ncls * sizeof(*st->next) + setsize);
+	memset(st->next, 0xff, dfa->ncls * sizeof(*st->next));
+	st->set = (uint16_t *)(st->next + dfa->ncls);
+	memcpy(st->set, dfa->buf, setsize);
+
+	st->match = bgp_dfa_has_match(dfa, st->set, n);
+
+	/* at the start, the end of an empty path satisfies ^ as well */
+	n = bgp_dfa_closure(dfa, st->set, n, initial, true);
+	st->match_at_end = bgp_dfa_has_match(dfa, dfa->buf, n);
+
+	return i;
+}
+
+static int bgp_dfa_step(struct bgp_dfa *dfa, int cur, uint8_t c)
+{
+	struct bgp_dfa_state *st = &dfa->states[cur];
+	unsigned int cls = dfa->cls[c], n = 0;
+	unsigned int flushes = dfa->flushes;
+	int next;
+
+	if (st->next[cls] >= 0)
+		return st->next[cls];
+
+	c = dfa->cls_byte[cls];
+	for (unsigned int i = 0; i < st->nset; i++) {
+		struct bgp_dfa_nfa *nfa = &dfa->nfa[st->set[i]];
+
+		if (nfa->type == DFA_NFA_SET && DFA_SET_HAS(nfa->set, c))
+			dfa->kernel[n++] = nfa->out;
+	}
+	/* the match can start anywhere */
+	dfa->kernel[n++] = dfa->start;
+
+	n = bgp_dfa_closure(dfa, dfa->kernel, n, false, false);
+
+	next = bgp_dfa_state_get(dfa, n, false);
+	/* cur is gone if the states were flushed to make room */
+	if (dfa->flushes == flushes)
+		dfa->states[cur].next[cls] = next;
+	return next;
+}
+
+struct bgp_dfa *bgp_dfa_compile(const char *regstr)
+{
+	struct bgp_dfa_parse rp = {};
+	struct bgp_dfa *dfa;
+	char *magic_str;
+	int root, match;
+
+	magic_str = bgp_regex_magic(regstr);
+	rp.p = magic_str;
+	rp.ast = XCALLOC(MTYPE_TMP, BGP_DFA_AST_MAX * sizeof(*rp.ast));
+
+	root = bgp_dfa_parse_alt(&rp);
+
+	dfa = XCALLOC(MTYPE_BGP_REGEXP_DFA, sizeof(*dfa));
+	dfa->nfa = XCALLOC(MTYPE_BGP_REGEXP_DFA,
+			   BGP_DFA_NFA_MAX * sizeof(*dfa->nfa));
+	dfa->init = -1;
+
+	if (!rp.fail) {
+		match = bgp_dfa_nfa_new(dfa, DFA_NFA_MATCH, 0, 0);
+		root = bgp_dfa_emit(dfa, rp.ast, root, match);
+	}
+
+	XFREE(MTYPE_TMP, rp.ast);
+	XFREE(MTYPE_TMP, magic_str);
+
+	if (rp.fail || root < 0) {
+		XFREE(MTYPE_BGP_REGEXP_DFA, dfa->nfa);
+		XFREE(MTYPE_BGP_REGEXP_DFA, dfa);
+		return NULL;
+	}
+
+	dfa->start = root;
+	dfa->nfa = XREALLOC(MTYPE_BGP_REGEXP_DFA, dfa->nfa,
+			    dfa->nnfa * sizeof(*dfa->nfa));
+	bgp_dfa_classes(dfa);
+
+	dfa->mark = XCALLOC(MTYPE_BGP_REGEXP_DFA,
+			    dfa->nnfa * sizeof(*dfa->mark));
+	dfa->stack = XCALLOC(MTYPE_BGP_REGEXP_DFA,
+			     3 * (dfa->nnfa + 1) * sizeof(*dfa->stack));
+	dfa->buf = dfa->stack + dfa->nnfa + 1;
+	dfa->kernel = dfa->buf + dfa->nnfa + 1;
+
+	return dfa;
+}
+
+bool bgp_dfa_exec(struct bgp_dfa *dfa, const char *str)
+{
+	int cur;
+
+	if (dfa->init < 0) {
+		unsigned int n;
+
+		n = bgp_dfa_closure(dfa, &dfa->start, 1, true, false);
+		dfa->init = bgp_dfa_state_get(dfa, n, true);
+	}
+
+	cur = dfa->init;
+	for (; *str; str++) {
+		if (dfa->states[cur].match)
+			return true;
+		cur = bgp_dfa_step(dfa, cur, *str);
+	}
+
+	return dfa->states[cur].match || dfa->states[cur].match_at_end;
+}
+
+void bgp_dfa_free(struct bgp_dfa *dfa)
+{
+	bgp_dfa_flush(dfa);
+	XFREE(MTYPE_BGP_REGEXP_DFA, dfa->states);
+	XFREE(MTYPE_BGP_REGEXP_DFA, dfa->stack);
+	XFREE(MTYPE_BGP_REGEXP_DFA, dfa->mark);
+	XFREE(MTYPE_BGP_REGEXP_DFA, dfa->nfa);
+	XFREE(MTYPE_BGP_REGEXP_DFA, dfa);
+}
@@ -33,4 +33,14 @@ extern void bgp_regex_free(regex_t *regex);
 extern regex_t *bgp_regcomp(const char *str);
 extern int bgp_regexec(regex_t *regex, struct aspath *aspath);
 
+/*
+ * The same expressions as bgp_regcomp(), matched by a lazily built DFA.
+ * Returns NULL for anything it can't compile, bgp_regexec() has to be used
+ * then.  A DFA is extended while it is used, so only one pthread may run it.
+ */
+struct bgp_dfa;
+extern struct bgp_dfa *bgp_dfa_compile(const char *regstr);
+extern bool bgp_dfa_exec(struct bgp_dfa *dfa, const char *str);
+extern void bgp_dfa_free(struct bgp_dfa *dfa);
+
 #endif /* _QUAGGA_BGP_REGEX_H */
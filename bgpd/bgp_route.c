@@ -85,6 +85,9 @@
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_flowspec_util.h"
 #include "bgpd/bgp_pbr.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_select.h"
+#include "bgpd/bgp_conditional_adv.h"
 #include "northbound.h"
 #include "northbound_cli.h"
 #include "bgpd/bgp_nb.h"
@@ -114,11 +117,20 @@ static const struct message bgp_pmsi_tnltype_str[] = {
 
 #define VRFID_NONE_STR "-"
 
+/* IPv4 RIB size at which the first-stride lookup index is built */
+#define BGP_STRIDE_MIN_ROUTES 10000
+
 DEFINE_HOOK(bgp_process,
 	    (struct bgp * bgp, afi_t afi, safi_t safi, struct bgp_dest *bn,
 	     struct peer *peer, bool withdraw),
 	    (bgp, afi, safi, bn, peer, withdraw))
 
+DEFINE_HOOK(bgp_route_update,
+	    (struct bgp * bgp, afi_t afi, safi_t safi, struct bgp_dest *bn,
+	     struct bgp_path_info *old_route,
+	     struct bgp_path_info *new_route),
+	    (bgp, afi, safi, bn, old_route, new_route))
+
 /** Test if path is suppressed. */
 static bool bgp_path_suppressed(struct bgp_path_info *pi)
 {
@@ -151,6 +163,11 @@ struct bgp_dest *bgp_afi_node_get(struct bgp_table *table, afi_t afi,
 
 	dest = bgp_node_get(table, p);
 
+	/* full-table IPv4 RIBs get the first-stride index, see table.h */
+	if (afi == AFI_IP && safi == SAFI_UNICAST && !table->route_table->stride
+	    && route_table_count(table->route_table) >= BGP_STRIDE_MIN_ROUTES)
+		route_table_set_stride(table->route_table, AF_INET, 16);
+
 	if ((safi == SAFI_MPLS_VPN) || (safi == SAFI_ENCAP)
 	    || (safi == SAFI_EVPN))
 		dest->pdest = pdest;
@@ -267,6 +284,7 @@ struct bgp_path_info_extra *bgp_path_info_extra_get(struct bgp_path_info *pi)
 /* Free bgp route information. */
 static void bgp_path_info_free(struct bgp_path_info *path)
 {
+	bgp_path_export_reset(path);
 	bgp_attr_unintern(&path->attr);
 
 	bgp_unlink_nexthop(path);
@@ -389,9 +407,40 @@ static int bgp_dest_set_defer_flag(struct bgp_dest *dest, bool delete)
 	return -1;
 }
 
+/* Only paths received from a peer are linked on that peer's list.  Imported
+ * paths (EVPN, VRF leaking) are cleaned up through their parent path, and
+ * locally originated ones are not cleared per peer.
+ */
+static struct bgp_peer_paths_head *bgp_path_info_peer_list(
+	struct bgp_dest *dest, struct bgp_path_info *pi)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	return &pi->peer->paths[table->afi][table->safi];
+}
+
+static bool bgp_path_info_peer_linkable(struct bgp_dest *dest,
+					struct bgp_path_info *pi)
+{
+	return pi->peer && pi->peer != pi->peer->bgp->peer_self
+	       && pi->sub_type != BGP_ROUTE_IMPORTED
+	       && bgp_dest_table(dest)->bgp == pi->peer->bgp;
+}
+
+static void bgp_path_info_mem_account(struct bgp_dest *dest,
+				      struct bgp_path_info *pi, int delta)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	if (table->bgp)
+		table->bgp->mem_stats[table->afi][table->safi].paths += delta;
+	pi->peer->mem_stats[table->afi][table->safi].paths += delta;
+}
+
 void bgp_path_info_add(struct bgp_dest *dest, struct bgp_path_info *pi)
 {
 	struct bgp_path_info *top;
+	struct bgp_peer_paths_head *paths;
 
 	top = bgp_dest_get_bgp_path_info(dest);
 
@@ -401,6 +450,12 @@ void bgp_path_info_add(struct bgp_dest *dest, struct bgp_path_info *pi)
 		top->prev = pi;
 	bgp_dest_set_bgp_path_info(dest, pi);
 
+	if (bgp_path_info_peer_linkable(dest, pi)) {
+		paths = bgp_path_info_peer_list(dest, pi);
+		bgp_peer_paths_add_tail(paths, pi);
+	}
+	bgp_path_info_mem_account(dest, pi, 1);
+
 	bgp_path_info_lock(pi);
 	bgp_dest_lock_node(dest);
 	peer_lock(pi->peer); /* bgp_path_info peer reference */
@@ -411,6 +466,15 @@ void bgp_path_info_add(struct bgp_dest *dest, struct bgp_path_info *pi)
    completion callback *only* */
 void bgp_path_info_reap(struct bgp_dest *dest, struct bgp_path_info *pi)
 {
+	struct bgp_peer_paths_head *paths;
+
+	/* unlinked items have their list pointers cleared */
+	if (pi->peer_item.di.next) {
+		paths = bgp_path_info_peer_list(dest, pi);
+		bgp_peer_paths_del(paths, pi);
+	}
+	bgp_path_info_mem_account(dest, pi, -1);
+
 	if (pi->next)
 		pi->next->prev = pi->prev;
 	if (pi->prev)
@@ -483,12 +547,16 @@ static int bgp_label_index_differs(struct bgp_path_info *pi1,
 void bgp_path_info_set_flag(struct bgp_dest *dest, struct bgp_path_info *pi,
 			    uint32_t flag)
 {
+	/* addpath peers need to hear of it, see bgp_addpath_path_changed() */
+	if ((pi->flags & flag & BGP_PATH_ADVERTISE_FLAGS)
+	    != (flag & BGP_PATH_ADVERTISE_FLAGS))
+		pi->tx_addpath.dirty = UINT8_MAX;
+
 	SET_FLAG(pi->flags, flag);
 
 	/* early bath if we know it's not a flag that changes countability state
 	 */
-	if (!CHECK_FLAG(flag,
-			BGP_PATH_VALID | BGP_PATH_HISTORY | BGP_PATH_REMOVED))
+	if (!CHECK_FLAG(flag, BGP_PATH_COUNTABLE_FLAGS))
 		return;
 
 	bgp_pcount_adjust(dest, pi);
@@ -497,12 +565,14 @@ void bgp_path_info_set_flag(struct bgp_dest *dest, struct bgp_path_info *pi,
 void bgp_path_info_unset_flag(struct bgp_dest *dest, struct bgp_path_info *pi,
 			      uint32_t flag)
 {
+	if (pi->flags & flag & BGP_PATH_ADVERTISE_FLAGS)
+		pi->tx_addpath.dirty = UINT8_MAX;
+
 	UNSET_FLAG(pi->flags, flag);
 
 	/* early bath if we know it's not a flag that changes countability state
 	 */
-	if (!CHECK_FLAG(flag,
-			BGP_PATH_VALID | BGP_PATH_HISTORY | BGP_PATH_REMOVED))
+	if (!CHECK_FLAG(flag, BGP_PATH_COUNTABLE_FLAGS))
 		return;
 
 	bgp_pcount_adjust(dest, pi);
@@ -613,7 +683,10 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 		 * with the
 		 * sticky flag.
 		 */
-		if (newattr->sticky != existattr->sticky) {
+		uint8_t new_sticky = bgp_attr_get_evpn(newattr)->sticky;
+		uint8_t exist_sticky = bgp_attr_get_evpn(existattr)->sticky;
+
+		if (new_sticky != exist_sticky) {
 			if (!debug) {
 				prefix2str(
 					bgp_dest_get_prefix(new->net), pfx_buf,
@@ -624,7 +697,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 					exist, exist_buf);
 			}
 
-			if (newattr->sticky && !existattr->sticky) {
+			if (new_sticky && !exist_sticky) {
 				*reason = bgp_path_selection_evpn_sticky_mac;
 				if (debug)
 					zlog_debug(
@@ -633,7 +706,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 				return 1;
 			}
 
-			if (!newattr->sticky && existattr->sticky) {
+			if (!new_sticky && exist_sticky) {
 				*reason = bgp_path_selection_evpn_sticky_mac;
 				if (debug)
 					zlog_debug(
@@ -1459,10 +1532,16 @@ static bool bgp_cluster_filter(struct peer *peer, struct attr *attr)
 	return false;
 }
 
+/*
+ * intern, if not NULL, is the interned attribute *attr is an unmodified
+ * copy of; the route-map's match results are then memoized on it, see
+ * route_map_apply_cached().
+ */
 static int bgp_input_modifier(struct peer *peer, const struct prefix *p,
-			      struct attr *attr, afi_t afi, safi_t safi,
-			      const char *rmap_name, mpls_label_t *label,
-			      uint32_t num_labels, struct bgp_dest *dest)
+			      struct attr *attr, const struct attr *intern,
+			      afi_t afi, safi_t safi, const char *rmap_name,
+			      mpls_label_t *label, uint32_t num_labels,
+			      struct bgp_dest *dest)
 {
 	struct bgp_filter *filter;
 	struct bgp_path_info rmap_path = { 0 };
@@ -1507,7 +1586,9 @@ static int bgp_input_modifier(struct peer *peer, const struct prefix *p,
 		SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_IN);
 
 		/* Apply BGP route map to the attribute. */
-		ret = route_map_apply(rmap, p, &rmap_path);
+		ret = route_map_apply_cached(rmap, p, &rmap_path,
+					     intern ? intern->intern_id : 0,
+					     peer);
 
 		peer->rmap_type = 0;
 
@@ -1517,9 +1598,10 @@ static int bgp_input_modifier(struct peer *peer, const struct prefix *p,
 	return RMAP_PERMIT;
 }
 
+/* intern as for bgp_input_modifier() */
 static int bgp_output_modifier(struct peer *peer, const struct prefix *p,
-			       struct attr *attr, afi_t afi, safi_t safi,
-			       const char *rmap_name)
+			       struct attr *attr, const struct attr *intern,
+			       afi_t afi, safi_t safi, const char *rmap_name)
 {
 	struct bgp_path_info rmap_path;
 	route_map_result_t ret;
@@ -1558,7 +1640,8 @@ static int bgp_output_modifier(struct peer *peer, const struct prefix *p,
 	SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_OUT);
 
 	/* Apply BGP route map to the attribute. */
-	ret = route_map_apply(rmap, p, &rmap_path);
+	ret = route_map_apply_cached(rmap, p, &rmap_path,
+				     intern ? intern->intern_id : 0, peer);
 
 	peer->rmap_type = rmap_type;
 
@@ -1668,34 +1751,6 @@ void bgp_attr_add_gshut_community(struct attr *attr)
 	attr->local_pref = BGP_GSHUT_LOCAL_PREF;
 }
 
-
-/* Notify BGP Conditional advertisement scanner process. */
-void bgp_notify_conditional_adv_scanner(struct update_subgroup *subgrp)
-{
-	struct peer *temp_peer;
-	struct peer *peer = SUBGRP_PEER(subgrp);
-	struct listnode *temp_node, *temp_nnode = NULL;
-	afi_t afi = SUBGRP_AFI(subgrp);
-	safi_t safi = SUBGRP_SAFI(subgrp);
-	struct bgp *bgp = SUBGRP_INST(subgrp);
-	struct bgp_filter *filter = &peer->filter[afi][safi];
-
-	if (!ADVERTISE_MAP_NAME(filter))
-		return;
-
-	for (ALL_LIST_ELEMENTS(bgp->peer, temp_node, temp_nnode, temp_peer)) {
-		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
-			continue;
-
-		if (peer != temp_peer)
-			continue;
-
-		temp_peer->advmap_table_change = true;
-		break;
-	}
-}
-
-
 void subgroup_announce_reset_nhop(uint8_t family, struct attr *attr)
 {
 	if (family == AF_INET) {
@@ -1726,6 +1781,7 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 	safi_t safi;
 	int samepeer_safe = 0; /* for synthetic mplsvpns routes */
 	bool nh_reset = false;
+	bool export_cache;
 	uint64_t cum_bw;
 
 	if (DISABLE_BGP_ANNOUNCE)
@@ -1871,11 +1927,26 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 			}
 		}
 
+	/* Route-server clients: the policy of the group denied this path
+	 * before, see update_group_export_deny().
+	 */
+	export_cache = !skip_rmap_check && piattr == pi->attr
+		       && !bgp_path_suppressed(pi);
+	if (export_cache
+	    && update_group_export_denied(subgrp->update_group, pi)) {
+		if (bgp_debug_update(NULL, p, subgrp->update_group, 0))
+			zlog_debug("%s [Update:SEND] %pFX is filtered (cached)",
+				   peer->host, p);
+		return false;
+	}
+
 	/* Output filter check. */
 	if (bgp_output_filter(peer, p, piattr, afi, safi) == FILTER_DENY) {
 		if (bgp_debug_update(NULL, p, subgrp->update_group, 0))
 			zlog_debug("%s [Update:SEND] %pFX is filtered",
 				   peer->host, p);
+		if (export_cache)
+			update_group_export_deny(subgrp->update_group, pi);
 		return false;
 	}
 
@@ -2067,6 +2138,9 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 					peer->host, p);
 
 			bgp_attr_flush(attr);
+			if (export_cache)
+				update_group_export_deny(subgrp->update_group,
+							 pi);
 			return false;
 		}
 	}
@@ -2229,6 +2303,9 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 	return true;
 }
 
+static int bgp_best_path_select_defer_run(struct bgp *bgp, afi_t afi,
+					  safi_t safi, struct thread *thread);
+
 static int bgp_route_select_timer_expire(struct thread *thread)
 {
 	struct afi_safi_info *info;
@@ -2250,13 +2327,20 @@ static int bgp_route_select_timer_expire(struct thread *thread)
 	XFREE(MTYPE_TMP, info);
 
 	/* Best path selection */
-	return bgp_best_path_select_defer(bgp, afi, safi);
+	return bgp_best_path_select_defer_run(bgp, afi, safi, thread);
 }
 
-void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
-			struct bgp_maxpaths_cfg *mpath_cfg,
-			struct bgp_path_info_pair *result, afi_t afi,
-			safi_t safi)
+/*
+ * Compare the paths of a dest and find the best path and multipath
+ * candidates.  With reap false, this only touches the dest and its paths
+ * (see bgp_select.h), and removed paths are left for
+ * bgp_best_selection_reap().
+ */
+static void bgp_best_selection_compute(struct bgp *bgp, struct bgp_dest *dest,
+				       struct bgp_maxpaths_cfg *mpath_cfg,
+				       struct bgp_path_info_pair *result,
+				       struct list *mp_list, afi_t afi,
+				       safi_t safi, bool reap)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
@@ -2265,11 +2349,9 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	struct bgp_path_info *pi2;
 	struct bgp_path_info *nextpi = NULL;
 	int paths_eq, do_mpath, debug;
-	struct list mp_list;
 	char pfx_buf[PREFIX2STR_BUFFER];
 	char path_buf[PATH_ADDPATH_STR_BUFFER];
 
-	bgp_mp_list_init(&mp_list);
 	do_mpath =
 		(mpath_cfg->maxpaths_ebgp > 1 || mpath_cfg->maxpaths_ibgp > 1);
 
@@ -2368,7 +2450,7 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 			/* reap REMOVED routes, if needs be
 			 * selected route must stay for a while longer though
 			 */
-			if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED)
+			if (reap && CHECK_FLAG(pi->flags, BGP_PATH_REMOVED)
 			    && (pi != old_select))
 				bgp_path_info_reap(dest, pi);
 
@@ -2441,7 +2523,7 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					zlog_debug(
 						"%pBD: %s is the bestpath, add to the multipath list",
 						dest, path_buf);
-				bgp_mp_list_add(&mp_list, pi);
+				bgp_mp_list_add(mp_list, pi);
 				continue;
 			}
 
@@ -2471,22 +2553,58 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					zlog_debug(
 						"%pBD: %s is equivalent to the bestpath, add to the multipath list",
 						dest, path_buf);
-				bgp_mp_list_add(&mp_list, pi);
+				bgp_mp_list_add(mp_list, pi);
 			}
 		}
 	}
 
-	bgp_path_info_mpath_update(dest, new_select, old_select, &mp_list,
+	result->old = old_select;
+	result->new = new_select;
+}
+
+/* Reap what bgp_best_selection_compute() left behind. */
+static void bgp_best_selection_reap(struct bgp_dest *dest)
+{
+	struct bgp_path_info *pi;
+	struct bgp_path_info *nextpi = NULL;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest);
+	     (pi != NULL) && (nextpi = pi->next, 1); pi = nextpi) {
+		/* selected route must stay for a while longer though */
+		if (BGP_PATH_HOLDDOWN(pi)
+		    && CHECK_FLAG(pi->flags, BGP_PATH_REMOVED)
+		    && !CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+			bgp_path_info_reap(dest, pi);
+	}
+}
+
+/* Record the outcome of bgp_best_selection_compute(), main pthread only. */
+static void bgp_best_selection_commit(struct bgp *bgp, struct bgp_dest *dest,
+				      struct bgp_maxpaths_cfg *mpath_cfg,
+				      struct bgp_path_info_pair *result,
+				      struct list *mp_list, afi_t afi,
+				      safi_t safi)
+{
+	bgp_path_info_mpath_update(dest, result->new, result->old, mp_list,
 				   mpath_cfg);
-	bgp_path_info_mpath_aggregate_update(new_select, old_select);
-	bgp_mp_list_clear(&mp_list);
+	bgp_path_info_mpath_aggregate_update(result->new, result->old);
+	bgp_mp_list_clear(mp_list);
 
 	bgp_addpath_update_ids(bgp, dest, afi, safi);
+}
 
-	result->old = old_select;
-	result->new = new_select;
+void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
+			struct bgp_maxpaths_cfg *mpath_cfg,
+			struct bgp_path_info_pair *result, afi_t afi,
+			safi_t safi)
+{
+	struct list mp_list;
 
-	return;
+	bgp_mp_list_init(&mp_list);
+	bgp_best_selection_compute(bgp, dest, mpath_cfg, result, &mp_list, afi,
+				   safi, true);
+	bgp_best_selection_commit(bgp, dest, mpath_cfg, result, &mp_list, afi,
+				  safi);
 }
 
 /*
@@ -2564,6 +2682,7 @@ void bgp_zebra_clear_route_change_flags(struct bgp_dest *dest)
 			continue;
 		UNSET_FLAG(pi->flags, BGP_PATH_IGP_CHANGED);
 		UNSET_FLAG(pi->flags, BGP_PATH_ATTR_CHANGED);
+		pi->tx_addpath.dirty = 0;
 	}
 }
 
@@ -2657,6 +2776,22 @@ static void bgp_process_evpn_route_injection(struct bgp *bgp, afi_t afi,
 		bgp_evpn_withdraw_type5_route(bgp, p, afi, safi);
 }
 
+/* Note the receipt of an UPDATE changing dest, see bgp_dest->rx_time */
+static void bgp_dest_rx_stamp(struct bgp_dest *dest)
+{
+	if (!timerisset(&dest->rx_time))
+		monotime(&dest->rx_time);
+}
+
+/* Best path selection for dest is done; unless there's a FIB update
+ * still to go out to zebra, so is the change.
+ */
+static void bgp_dest_rx_done(struct bgp_dest *dest)
+{
+	if (timerisset(&dest->rx_time) && !bgp_zebra_route_queued(dest))
+		timerclear(&dest->rx_time);
+}
+
 /*
  * old_select = The old best path
  * new_select = the new best path
@@ -2677,12 +2812,13 @@ static void bgp_process_evpn_route_injection(struct bgp *bgp, afi_t afi,
  *     is being removed.
  */
 static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
-				 afi_t afi, safi_t safi)
+				 afi_t afi, safi_t safi, struct bgp_select *sel)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
 	struct bgp_path_info_pair old_and_new;
 	int debug = 0;
+	bool announce_all;
 
 	if (CHECK_FLAG(bgp->flags, BGP_FLAG_DELETE_IN_PROGRESS)) {
 		if (dest)
@@ -2725,12 +2861,22 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 		return;
 	}
 
-	/* Best path selection. */
-	bgp_best_selection(bgp, dest, &bgp->maxpaths[afi][safi], &old_and_new,
-			   afi, safi);
+	/* Best path selection, unless done by bgp_process_select() already. */
+	if (sel && CHECK_FLAG(dest->flags, BGP_NODE_SELECT_PENDING)) {
+		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_PENDING);
+		bgp_best_selection_reap(dest);
+		bgp_best_selection_commit(bgp, dest, &bgp->maxpaths[afi][safi],
+					  &sel->result, &sel->mp_list, afi,
+					  safi);
+		old_and_new = sel->result;
+	} else
+		bgp_best_selection(bgp, dest, &bgp->maxpaths[afi][safi],
+				   &old_and_new, afi, safi);
 	old_select = old_and_new.old;
 	new_select = old_and_new.new;
 
+	latency_hist_add_since(&bgp->conv_bestpath, &dest->rx_time);
+
 	/* Do we need to allocate or free labels?
 	 * Right now, since we only deal with per-prefix labels, it is not
 	 * necessary to do this upon changes to best path. Exceptions:
@@ -2778,6 +2924,9 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 			__func__, dest, afi2str(afi), safi2str(safi),
 			old_select, new_select);
 
+	/* Re-evaluate conditional advertisement against this prefix */
+	bgp_conditional_adv_dest_changed(bgp, afi, safi, dest);
+
 	/* If best route remains the same and this is not due to user-initiated
 	 * clear, see exactly what needs to be done.
 	 */
@@ -2798,8 +2947,11 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 					|| new_select->sub_type
 						   == BGP_ROUTE_IMPORTED))
 
-					bgp_zebra_announce(dest, p, old_select,
-							   bgp, afi, safi);
+					/* same path, install only: nothing
+					 * to withdraw first
+					 */
+					bgp_zebra_route_queue(bgp, dest, afi,
+							      safi, NULL);
 			}
 		}
 
@@ -2831,11 +2983,14 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 		UNSET_FLAG(old_select->flags, BGP_PATH_LINK_BW_CHG);
 		bgp_zebra_clear_route_change_flags(dest);
 		UNSET_FLAG(dest->flags, BGP_NODE_PROCESS_SCHEDULED);
+		bgp_dest_rx_done(dest);
 		return;
 	}
 
 	/* If the user did "clear ip bgp prefix x.x.x.x" this flag will be set
 	 */
+	announce_all = CHECK_FLAG(dest->flags, BGP_NODE_USER_CLEAR)
+		       || CHECK_FLAG(dest->flags, BGP_NODE_LABEL_CHANGED);
 	UNSET_FLAG(dest->flags, BGP_NODE_USER_CLEAR);
 
 	/* bestpath has changed; bump version */
@@ -2864,6 +3019,10 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 		UNSET_FLAG(new_select->flags, BGP_PATH_LINK_BW_CHG);
 	}
 
+	if (old_select || new_select)
+		hook_call(bgp_route_update, bgp, afi, safi, dest, old_select,
+			  new_select);
+
 #ifdef ENABLE_BGP_VNC
 	if ((afi == AFI_IP || afi == AFI_IP6) && (safi == SAFI_UNICAST)) {
 		if (old_select != new_select) {
@@ -2881,40 +3040,42 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 	}
 #endif
 
-	group_announce_route(bgp, afi, safi, dest, new_select);
+	if (announce_all) {
+		group_announce_route(bgp, afi, safi, dest, new_select);
 
-	/* unicast routes must also be annouced to labeled-unicast update-groups
-	 */
-	if (safi == SAFI_UNICAST)
-		group_announce_route(bgp, afi, SAFI_LABELED_UNICAST, dest,
-				     new_select);
+		/* unicast routes must also be annouced to labeled-unicast
+		 * update-groups
+		 */
+		if (safi == SAFI_UNICAST)
+			group_announce_route(bgp, afi, SAFI_LABELED_UNICAST,
+					     dest, new_select);
+	} else {
+		group_announce_route_changed(bgp, afi, safi, dest, new_select,
+					     old_select);
+		if (safi == SAFI_UNICAST)
+			group_announce_route_changed(bgp, afi,
+						     SAFI_LABELED_UNICAST, dest,
+						     new_select, old_select);
+	}
 
-	/* FIB update. */
+	/* FIB update.  Queued, and sent to zebra in batches once the
+	 * current round of best path selection is done; a withdraw of an
+	 * evpn imported type-5 prefix ahead of the new route is handled by
+	 * the queue as well.
+	 */
 	if (bgp_fibupd_safi(safi) && (bgp->inst_type != BGP_INSTANCE_TYPE_VIEW)
 	    && !bgp_option_check(BGP_OPT_NO_FIB)) {
 		if (new_select && new_select->type == ZEBRA_ROUTE_BGP
 		    && (new_select->sub_type == BGP_ROUTE_NORMAL
 			|| new_select->sub_type == BGP_ROUTE_AGGREGATE
-			|| new_select->sub_type == BGP_ROUTE_IMPORTED)) {
-
-			/* if this is an evpn imported type-5 prefix,
-			 * we need to withdraw the route first to clear
-			 * the nh neigh and the RMAC entry.
-			 */
-			if (old_select &&
-			    is_route_parent_evpn(old_select))
-				bgp_zebra_withdraw(p, old_select, bgp, safi);
-
-			bgp_zebra_announce(dest, p, new_select, bgp, afi, safi);
-		} else {
+			|| new_select->sub_type == BGP_ROUTE_IMPORTED))
+			bgp_zebra_route_queue(bgp, dest, afi, safi, old_select);
+		else if (old_select && old_select->type == ZEBRA_ROUTE_BGP
+			 && (old_select->sub_type == BGP_ROUTE_NORMAL
+			     || old_select->sub_type == BGP_ROUTE_AGGREGATE
+			     || old_select->sub_type == BGP_ROUTE_IMPORTED))
 			/* Withdraw the route from the kernel. */
-			if (old_select && old_select->type == ZEBRA_ROUTE_BGP
-			    && (old_select->sub_type == BGP_ROUTE_NORMAL
-				|| old_select->sub_type == BGP_ROUTE_AGGREGATE
-				|| old_select->sub_type == BGP_ROUTE_IMPORTED))
-
-				bgp_zebra_withdraw(p, old_select, bgp, safi);
-		}
+			bgp_zebra_route_queue(bgp, dest, afi, safi, old_select);
 	}
 
 	bgp_process_evpn_route_injection(bgp, afi, safi, dest, new_select,
@@ -2928,49 +3089,135 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 		bgp_path_info_reap(dest, old_select);
 
 	UNSET_FLAG(dest->flags, BGP_NODE_PROCESS_SCHEDULED);
+	bgp_dest_rx_done(dest);
 	return;
 }
 
-/* Process the routes with the flag BGP_NODE_SELECT_DEFER set */
-int bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
+static void bgp_process_select(struct bgp *bgp, struct bgp_select *sel);
+
+/*
+ * Select a chunk of deferred dests, starting at *destp.  The best paths are
+ * computed on the selection pthreads like for the process queue, and
+ * *destp is left at the dest after the chunk (locked) or NULL.  The last
+ * dest selected is remembered so a later run can carry on after it.
+ */
+static void bgp_best_path_select_defer_chunk(struct bgp *bgp, afi_t afi,
+					     safi_t safi,
+					     struct bgp_dest **destp)
 {
+	struct graceful_restart_info *gr_info = &bgp->gr_info[afi][safi];
+	struct bgp_select *sels;
+	struct bgp_dest *dest;
+	unsigned int count = 0, i;
+
+	sels = XCALLOC(MTYPE_BGP_PROCESS_SELECT,
+		       gr_info->gr_select_chunk * sizeof(*sels));
+
+	for (dest = *destp; dest && gr_info->gr_deferred != 0
+			    && count < gr_info->gr_select_chunk;
+	     dest = bgp_route_next(dest)) {
+		if (!CHECK_FLAG(dest->flags, BGP_NODE_SELECT_DEFER))
+			continue;
+
+		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_DEFER);
+		gr_info->gr_deferred--;
+		sels[count].dest = bgp_dest_lock_node(dest);
+		bgp_mp_list_init(&sels[count].mp_list);
+		count++;
+	}
+	*destp = dest;
+
+	if (count)
+		prefix_copy(&gr_info->gr_select_next,
+			    bgp_dest_get_prefix(sels[count - 1].dest));
+
+	if (bgp_select_enabled() && count >= BGP_SELECT_BATCH_MIN)
+		bgp_select_run(bgp, sels, count, bgp_process_select);
+
+	for (i = 0; i < count; i++) {
+		dest = sels[i].dest;
+		bgp_process_main_one(bgp, dest, afi, safi, &sels[i]);
+		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_PENDING);
+		bgp_mp_list_clear(&sels[i].mp_list);
+		bgp_dest_unlock_node(dest);
+	}
+	gr_info->gr_selected += count;
+
+	XFREE(MTYPE_BGP_PROCESS_SELECT, sels);
+}
+
+/*
+ * Process the routes with the flag BGP_NODE_SELECT_DEFER set.  Chunks are
+ * selected until the thread has run for long enough; the chunk size follows
+ * how many fit in that time.  A run that isn't a thread of its own does one
+ * chunk and leaves the rest to the route select timer.
+ */
+static int bgp_best_path_select_defer_run(struct bgp *bgp, afi_t afi,
+					  safi_t safi, struct thread *thread)
+{
+	struct graceful_restart_info *gr_info = &bgp->gr_info[afi][safi];
 	struct bgp_dest *dest;
-	int cnt = 0;
 	struct afi_safi_info *thread_info;
+	bool resume = !!thread;
+	unsigned int chunks = 0;
 
-	if (bgp->gr_info[afi][safi].t_route_select) {
-		struct thread *t = bgp->gr_info[afi][safi].t_route_select;
+	if (gr_info->t_route_select) {
+		struct thread *t = gr_info->t_route_select;
 
 		thread_info = THREAD_ARG(t);
 		XFREE(MTYPE_TMP, thread_info);
-		BGP_TIMER_OFF(bgp->gr_info[afi][safi].t_route_select);
+		BGP_TIMER_OFF(gr_info->t_route_select);
 	}
 
 	if (BGP_DEBUG(update, UPDATE_OUT)) {
 		zlog_debug("%s: processing route for %s : cnt %d", __func__,
 			   get_afi_safi_str(afi, safi, false),
-			   bgp->gr_info[afi][safi].gr_deferred);
+			   gr_info->gr_deferred);
+	}
+
+	if (!resume) {
+		gr_info->gr_selected = 0;
+		gr_info->gr_select_total = gr_info->gr_deferred;
+		gr_info->gr_select_start = bgp_clock();
+		gr_info->gr_select_end = 0;
 	}
+	if (!gr_info->gr_select_chunk)
+		gr_info->gr_select_chunk = BGP_MAX_BEST_ROUTE_SELECT;
 
 	/* Process the route list */
-	for (dest = bgp_table_top(bgp->rib[afi][safi]);
-	     dest && bgp->gr_info[afi][safi].gr_deferred != 0;
-	     dest = bgp_route_next(dest)) {
-		if (!CHECK_FLAG(dest->flags, BGP_NODE_SELECT_DEFER))
-			continue;
+	if (resume && gr_info->gr_selected)
+		dest = bgp_table_get_next(bgp->rib[afi][safi],
+					  &gr_info->gr_select_next);
+	else
+		dest = bgp_table_top(bgp->rib[afi][safi]);
 
-		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_DEFER);
-		bgp->gr_info[afi][safi].gr_deferred--;
-		bgp_process_main_one(bgp, dest, afi, safi);
-		cnt++;
-		if (cnt >= BGP_MAX_BEST_ROUTE_SELECT) {
-			bgp_dest_unlock_node(dest);
+	while (dest && gr_info->gr_deferred != 0) {
+		bgp_best_path_select_defer_chunk(bgp, afi, safi, &dest);
+		chunks++;
+
+		if (!thread || thread_should_yield(thread))
 			break;
-		}
+	}
+
+	/*
+	 * Aim for a couple of chunks per run: grow the chunk if there was
+	 * time for more, shrink it if one alone took too long.
+	 */
+	if (thread && dest && gr_info->gr_deferred != 0) {
+		if (chunks == 1
+		    && gr_info->gr_select_chunk > BGP_SELECT_BATCH_MIN * 2)
+			gr_info->gr_select_chunk /= 2;
+		else if (chunks > 2
+			 && gr_info->gr_select_chunk
+				    < BGP_MAX_BEST_ROUTE_SELECT * 8)
+			gr_info->gr_select_chunk *= 2;
 	}
 
 	/* Send EOR message when all routes are processed */
-	if (!bgp->gr_info[afi][safi].gr_deferred) {
+	if (!dest || !gr_info->gr_deferred) {
+		if (dest)
+			bgp_dest_unlock_node(dest);
+		gr_info->gr_select_end = bgp_clock();
 		bgp_send_delayed_eor(bgp);
 		/* Send route processing complete message to RIB */
 		bgp_zebra_update(afi, safi, bgp->vrf_id,
@@ -2978,21 +3225,89 @@ int bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
 		return 0;
 	}
 
+	bgp_dest_unlock_node(dest);
+
 	thread_info = XMALLOC(MTYPE_TMP, sizeof(struct afi_safi_info));
 
 	thread_info->afi = afi;
 	thread_info->safi = safi;
 	thread_info->bgp = bgp;
 
-	/* If there are more routes to be processed, start the
-	 * selection timer
+	/* If there are more routes to be processed, pick them up as soon as
+	 * other work had a chance to run.
 	 */
-	thread_add_timer(bm->master, bgp_route_select_timer_expire, thread_info,
-			BGP_ROUTE_SELECT_DELAY,
-			&bgp->gr_info[afi][safi].t_route_select);
+	thread_add_timer_msec(bm->master, bgp_route_select_timer_expire,
+			      thread_info, 0, &gr_info->t_route_select);
 	return 0;
 }
 
+int bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
+{
+	return bgp_best_path_select_defer_run(bgp, afi, safi, NULL);
+}
+
+/* Runs on the selection pthreads, see bgp_select.h. */
+static void bgp_process_select(struct bgp *bgp, struct bgp_select *sel)
+{
+	struct bgp_dest *dest = sel->dest;
+	struct bgp_table *table = bgp_dest_table(dest);
+
+	/* bgp_process_main_one() won't look at this dest */
+	if (CHECK_FLAG(dest->flags, BGP_NODE_SELECT_DEFER))
+		return;
+
+	bgp_best_selection_compute(bgp, dest,
+				   &bgp->maxpaths[table->afi][table->safi],
+				   &sel->result, &sel->mp_list, table->afi,
+				   table->safi, false);
+	SET_FLAG(dest->flags, BGP_NODE_SELECT_PENDING);
+}
+
+/*
+ * Run best-path selection for the dests queued so far on the selection
+ * pthreads, then process them in order.  bgp_process() drops the result of
+ * any dest that gets changed by processing the ones before it.
+ */
+static void bgp_process_batch(struct bgp *bgp,
+			      struct bgp_process_queue *pqnode)
+{
+	struct bgp_select *sels;
+	struct bgp_table *table;
+	struct bgp_dest *dest;
+	unsigned int count = 0, i;
+
+	STAILQ_FOREACH (dest, &pqnode->pqueue, pq)
+		count++;
+	if (count < BGP_SELECT_BATCH_MIN)
+		return;
+
+	sels = XCALLOC(MTYPE_BGP_PROCESS_SELECT, count * sizeof(*sels));
+	for (i = 0; i < count; i++) {
+		dest = STAILQ_FIRST(&pqnode->pqueue);
+		STAILQ_REMOVE_HEAD(&pqnode->pqueue, pq);
+		STAILQ_NEXT(dest, pq) = NULL; /* complete unlink */
+		sels[i].dest = dest;
+		bgp_mp_list_init(&sels[i].mp_list);
+	}
+
+	bgp_select_run(bgp, sels, count, bgp_process_select);
+
+	for (i = 0; i < count; i++) {
+		dest = sels[i].dest;
+		table = bgp_dest_table(dest);
+		/* note, new DESTs may be added as part of processing */
+		bgp_process_main_one(bgp, dest, table->afi, table->safi,
+				     &sels[i]);
+		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_PENDING);
+		bgp_mp_list_clear(&sels[i].mp_list);
+
+		bgp_dest_unlock_node(dest);
+		bgp_table_unlock(table);
+	}
+
+	XFREE(MTYPE_BGP_PROCESS_SELECT, sels);
+}
+
 static wq_item_status bgp_process_wq(struct work_queue *wq, void *data)
 {
 	struct bgp_process_queue *pqnode = data;
@@ -3002,24 +3317,33 @@ static wq_item_status bgp_process_wq(struct work_queue *wq, void *data)
 
 	/* eoiu marker */
 	if (CHECK_FLAG(pqnode->flags, BGP_PROCESS_QUEUE_EOIU_MARKER)) {
-		bgp_process_main_one(bgp, NULL, 0, 0);
+		bgp_process_main_one(bgp, NULL, 0, 0, NULL);
 		/* should always have dedicated wq call */
 		assert(STAILQ_FIRST(&pqnode->pqueue) == NULL);
 		return WQ_SUCCESS;
 	}
 
+	frrtrace(1, frr_bgp, process_begin, bgp);
+
+	if (bgp_select_enabled()
+	    && !CHECK_FLAG(bgp->flags, BGP_FLAG_DELETE_IN_PROGRESS))
+		bgp_process_batch(bgp, pqnode);
+
+	/* anything bgp_process_batch() left, or that was added meanwhile */
 	while (!STAILQ_EMPTY(&pqnode->pqueue)) {
 		dest = STAILQ_FIRST(&pqnode->pqueue);
 		STAILQ_REMOVE_HEAD(&pqnode->pqueue, pq);
 		STAILQ_NEXT(dest, pq) = NULL; /* complete unlink */
 		table = bgp_dest_table(dest);
 		/* note, new DESTs may be added as part of processing */
-		bgp_process_main_one(bgp, dest, table->afi, table->safi);
+		bgp_process_main_one(bgp, dest, table->afi, table->safi, NULL);
 
 		bgp_dest_unlock_node(dest);
 		bgp_table_unlock(table);
 	}
 
+	frrtrace(1, frr_bgp, process_end, bgp);
+
 	return WQ_SUCCESS;
 }
 
@@ -3070,6 +3394,9 @@ void bgp_process(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, safi_t safi)
 	struct bgp_process_queue *pqnode;
 	int pqnode_reuse = 0;
 
+	/* paths changed since bgp_process_select() looked at them */
+	UNSET_FLAG(dest->flags, BGP_NODE_SELECT_PENDING);
+
 	/* already scheduled for processing? */
 	if (CHECK_FLAG(dest->flags, BGP_NODE_PROCESS_SCHEDULED))
 		return;
@@ -3171,7 +3498,7 @@ static uint32_t bgp_filtered_routes_count(struct peer *peer, afi_t afi,
 				filtered = true;
 
 			if (bgp_input_modifier(
-				    peer, rn_p, &attr, afi, safi,
+				    peer, rn_p, &attr, ain->attr, afi, safi,
 				    ROUTE_MAP_IN_NAME(&peer->filter[afi][safi]),
 				    NULL, 0, NULL)
 			    == RMAP_DENY)
@@ -3515,6 +3842,8 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	struct bgp_path_info *pi;
 	struct bgp_path_info *new;
 	struct bgp_path_info_extra *extra;
+	/* interned copy of *attr, for memoizing route-map matches */
+	const struct attr *attr_intern = NULL;
 	const char *reason;
 	char pfx_buf[BGP_PRD_PATH_STRLEN];
 	int connected = 0;
@@ -3567,10 +3896,12 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 
 	/* When peer's soft reconfiguration enabled.  Record input packet in
 	   Adj-RIBs-In.  */
-	if (!soft_reconfig
-	    && CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG)
-	    && peer != bgp->peer_self)
-		bgp_adj_in_set(dest, peer, attr, addpath_id);
+	if (soft_reconfig)
+		/* attr is the one stored in Adj-RIB-In */
+		attr_intern = attr;
+	else if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG)
+		 && peer != bgp->peer_self)
+		attr_intern = bgp_adj_in_set(dest, peer, attr, addpath_id)->attr;
 
 	/* Check previously received route. */
 	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
@@ -3675,8 +4006,8 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	 * commands, so we need bgp_attr_flush in the error paths, until we
 	 * intern
 	 * the attr (which takes over the memory references) */
-	if (bgp_input_modifier(peer, p, &new_attr, afi, safi, NULL, label,
-			       num_labels, dest)
+	if (bgp_input_modifier(peer, p, &new_attr, attr_intern, afi, safi, NULL,
+			       label, num_labels, dest)
 	    == RMAP_DENY) {
 		peer->stat_pfx_filter++;
 		reason = "route-map;";
@@ -3720,7 +4051,8 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		goto filtered;
 	}
 
-	if (bgp_mac_entry_exists(p) || bgp_mac_exist(&attr->rmac)) {
+	if (bgp_mac_entry_exists(p)
+	    || bgp_mac_exist(&bgp_attr_get_evpn(attr)->rmac)) {
 		peer->stat_pfx_nh_invalid++;
 		reason = "self mac;";
 		goto filtered;
@@ -3775,6 +4107,7 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 				    != BGP_DAMP_SUPPRESSED) {
 					bgp_aggregate_increment(bgp, p, pi, afi,
 								safi);
+					bgp_dest_rx_stamp(dest);
 					bgp_process(bgp, dest, afi, safi);
 				}
 			} else /* Duplicate - odd */
@@ -3803,6 +4136,7 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 					bgp_path_info_unset_flag(
 						dest, pi, BGP_PATH_STALE);
 					bgp_dest_set_defer_flag(dest, false);
+					bgp_dest_rx_stamp(dest);
 					bgp_process(bgp, dest, afi, safi);
 				}
 			}
@@ -4065,6 +4399,7 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		/* Process change. */
 		bgp_aggregate_increment(bgp, p, pi, afi, safi);
 
+		bgp_dest_rx_stamp(dest);
 		bgp_process(bgp, dest, afi, safi);
 		bgp_dest_unlock_node(dest);
 
@@ -4137,11 +4472,6 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		}
 	}
 
-	/* Update Overlay Index */
-	if (afi == AFI_L2VPN) {
-		overlay_index_update(new->attr,
-				     evpn == NULL ? NULL : &evpn->gw_ip);
-	}
 	/* Nexthop reachability check. */
 	if (((afi == AFI_IP || afi == AFI_IP6)
 	    && (safi == SAFI_UNICAST || safi == SAFI_LABELED_UNICAST))
@@ -4211,6 +4541,7 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	hook_call(bgp_process, bgp, afi, safi, dest, peer, false);
 
 	/* Process change. */
+	bgp_dest_rx_stamp(dest);
 	bgp_process(bgp, dest, afi, safi);
 
 	if (SAFI_UNICAST == safi
@@ -4364,6 +4695,7 @@ int bgp_withdraw(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 
 	/* Withdraw specified route from routing table. */
 	if (pi && !CHECK_FLAG(pi->flags, BGP_PATH_HISTORY)) {
+		bgp_dest_rx_stamp(dest);
 		bgp_rib_withdraw(dest, pi, peer, afi, safi, prd);
 		if (SAFI_UNICAST == safi
 		    && (bgp->inst_type == BGP_INSTANCE_TYPE_VRF
@@ -4432,6 +4764,7 @@ static int bgp_announce_route_timer_expired(struct thread *t)
 
 	/* Notify BGP conditional advertisement scanner percess */
 	peer->advmap_config_change[paf->afi][paf->safi] = true;
+	bgp_conditional_adv_schedule(peer->bgp);
 
 	return 0;
 }
@@ -4489,18 +4822,62 @@ void bgp_announce_route_all(struct peer *peer)
 		bgp_announce_route(peer, afi, safi);
 }
 
-static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
+/*
+ * Inbound soft reconfiguration re-runs bgp_update() on every route stored in
+ * adj-in, which can take a long while for a full table.  It is done as a
+ * background job per peer and AFI/SAFI, in slices that give way to other
+ * work, resuming after the last prefix handled.  bgp_update() itself only
+ * hands prefixes whose outcome changed to bgp_process().
+ */
+struct bgp_soft_reconfig {
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	struct thread *t_run;
+
+	/* last RD table and prefix handled, if any */
+	struct prefix rd_pos;
+	struct prefix pos;
+	bool has_rd_pos;
+	bool has_pos;
+
+	/* routes re-evaluated and how many of those changed */
+	uint32_t done;
+	uint32_t changed;
+	time_t start;
+};
+
+static void bgp_soft_reconfig_free(struct bgp_soft_reconfig *job)
+{
+	struct peer *peer = job->peer;
+
+	THREAD_OFF(job->t_run);
+	peer->soft_reconfig[job->afi][job->safi] = NULL;
+	XFREE(MTYPE_BGP_SOFT_RECONFIG, job);
+	peer_unlock(peer);
+}
+
+/*
+ * Re-evaluate the peer's routes in table, carrying on after job->pos.
+ * Returns false if it gave way to other work before reaching the end.
+ */
+static bool bgp_soft_reconfig_table(struct bgp_soft_reconfig *job,
 				    struct bgp_table *table,
-				    struct prefix_rd *prd)
+				    struct prefix_rd *prd,
+				    struct thread *thread)
 {
 	int ret;
+	struct peer *peer = job->peer;
 	struct bgp_dest *dest;
 	struct bgp_adj_in *ain;
 
-	if (!table)
-		table = peer->bgp->rib[afi][safi];
+	if (job->has_pos)
+		dest = bgp_table_get_next(table, &job->pos);
+	else
+		dest = bgp_table_top(table);
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+	for (; dest; dest = bgp_route_next(dest)) {
 		for (ain = dest->adj_in; ain; ain = ain->next) {
 			if (ain->peer != peer)
 				continue;
@@ -4509,6 +4886,7 @@ static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 			uint32_t num_labels = 0;
 			mpls_label_t *label_pnt = NULL;
 			struct bgp_route_evpn evpn;
+			bool scheduled;
 
 			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
 			     pi = pi->next)
@@ -4526,33 +4904,77 @@ static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 			else
 				memset(&evpn, 0, sizeof(evpn));
 
+			scheduled = CHECK_FLAG(dest->flags,
+					       BGP_NODE_PROCESS_SCHEDULED);
+
 			ret = bgp_update(peer, bgp_dest_get_prefix(dest),
-					 ain->addpath_rx_id, ain->attr, afi,
-					 safi, ZEBRA_ROUTE_BGP,
+					 ain->addpath_rx_id, ain->attr,
+					 job->afi, job->safi, ZEBRA_ROUTE_BGP,
 					 BGP_ROUTE_NORMAL, prd, label_pnt,
 					 num_labels, 1, &evpn);
 
 			if (ret < 0) {
+				/* over maximum-prefix, the peer is going down */
 				bgp_dest_unlock_node(dest);
-				return;
+				job->has_pos = false;
+				return true;
 			}
+
+			job->done++;
+			if (!scheduled
+			    && CHECK_FLAG(dest->flags,
+					  BGP_NODE_PROCESS_SCHEDULED))
+				job->changed++;
 		}
+
+		if (thread_should_yield(thread)) {
+			prefix_copy(&job->pos, bgp_dest_get_prefix(dest));
+			job->has_pos = true;
+			bgp_dest_unlock_node(dest);
+			return false;
+		}
+	}
+
+	job->has_pos = false;
+	return true;
 }
 
-void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
+static int bgp_soft_reconfig_run(struct thread *thread)
 {
+	struct bgp_soft_reconfig *job = THREAD_ARG(thread);
+	struct peer *peer = job->peer;
+	afi_t afi = job->afi;
+	safi_t safi = job->safi;
 	struct bgp_dest *dest;
 	struct bgp_table *table;
 
-	if (peer->status != Established)
-		return;
+	if (peer->status != Established) {
+		bgp_soft_reconfig_free(job);
+		return 0;
+	}
 
 	if ((safi != SAFI_MPLS_VPN) && (safi != SAFI_ENCAP)
-	    && (safi != SAFI_EVPN))
-		bgp_soft_reconfig_table(peer, afi, safi, NULL, NULL);
-	else
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest)) {
+	    && (safi != SAFI_EVPN)) {
+		if (!bgp_soft_reconfig_table(job, peer->bgp->rib[afi][safi],
+					     NULL, thread))
+			goto yield;
+	} else {
+		/* carry on in the RD table we were in, if still there */
+		dest = NULL;
+		if (job->has_rd_pos)
+			dest = bgp_node_lookup(peer->bgp->rib[afi][safi],
+					       &job->rd_pos);
+		if (!dest) {
+			job->has_pos = false;
+			if (job->has_rd_pos)
+				dest = bgp_table_get_next(
+					peer->bgp->rib[afi][safi],
+					&job->rd_pos);
+			else
+				dest = bgp_table_top(peer->bgp->rib[afi][safi]);
+		}
+
+		for (; dest; dest = bgp_route_next(dest)) {
 			table = bgp_dest_get_bgp_table_info(dest);
 
 			if (table == NULL)
@@ -4565,75 +4987,186 @@ void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
 			prd.prefixlen = 64;
 			memcpy(&prd.val, p->u.val, 8);
 
-			bgp_soft_reconfig_table(peer, afi, safi, table, &prd);
-		}
-}
+			if (!bgp_soft_reconfig_table(job, table, &prd,
+						     thread)) {
+				prefix_copy(&job->rd_pos, p);
+				job->has_rd_pos = true;
+				bgp_dest_unlock_node(dest);
+				goto yield;
+			}
+		}
+	}
+
+	if (bgp_debug_update(peer, NULL, NULL, 1))
+		zlog_debug(
+			"%s %s soft reconfiguration in done: %u routes, %u changed, %lld seconds",
+			peer->host, get_afi_safi_str(afi, safi, false),
+			job->done, job->changed,
+			(long long)(bgp_clock() - job->start));
+
+	bgp_soft_reconfig_free(job);
+	return 0;
+
+yield:
+	thread_add_event(bm->master, bgp_soft_reconfig_run, job, 0,
+			 &job->t_run);
+	return 0;
+}
+
+void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
+{
+	struct bgp_soft_reconfig *job;
+
+	if (peer->status != Established)
+		return;
+
+	job = peer->soft_reconfig[afi][safi];
+	if (!job) {
+		job = XCALLOC(MTYPE_BGP_SOFT_RECONFIG, sizeof(*job));
+		job->peer = peer_lock(peer);
+		job->afi = afi;
+		job->safi = safi;
+		peer->soft_reconfig[afi][safi] = job;
+	}
+
+	/* policy changed (again), start over from the top */
+	job->has_rd_pos = false;
+	job->has_pos = false;
+	job->done = 0;
+	job->changed = 0;
+	job->start = bgp_clock();
+
+	thread_add_event(bm->master, bgp_soft_reconfig_run, job, 0,
+			 &job->t_run);
+}
+
+/* Called when the peer goes down, there is nothing left to re-evaluate. */
+void bgp_soft_reconfig_in_cancel(struct peer *peer)
+{
+	afi_t afi;
+	safi_t safi;
+
+	FOREACH_AFI_SAFI (afi, safi)
+		if (peer->soft_reconfig[afi][safi])
+			bgp_soft_reconfig_free(peer->soft_reconfig[afi][safi]);
+}
+
+static void bgp_soft_reconfig_show(struct vty *vty, struct bgp *bgp)
+{
+	struct listnode *node;
+	struct peer *peer;
+	struct bgp_soft_reconfig *job;
+	afi_t afi;
+	safi_t safi;
+	unsigned int count = 0;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		FOREACH_AFI_SAFI (afi, safi) {
+			job = peer->soft_reconfig[afi][safi];
+			if (!job)
+				continue;
+
+			if (!count)
+				vty_out(vty, "%-25s %-20s %10s %10s %8s\n",
+					"Neighbor", "AFI/SAFI", "Routes",
+					"Changed", "Seconds");
+			vty_out(vty, "%-25s %-20s %10u %10u %8lld\n",
+				peer->host, get_afi_safi_str(afi, safi, false),
+				job->done, job->changed,
+				(long long)(bgp_clock() - job->start));
+			count++;
+		}
+	}
+
+	if (!count)
+		vty_out(vty, "No soft reconfiguration in progress\n");
+}
+
+DEFUN (show_ip_bgp_soft_reconfig_progress,
+       show_ip_bgp_soft_reconfig_progress_cmd,
+       "show [ip] bgp [<view|vrf> VIEWVRFNAME] soft-reconfig progress",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       BGP_INSTANCE_HELP_STR
+       "Inbound soft reconfiguration\n"
+       "Routes re-evaluated so far by running jobs\n")
+{
+	afi_t afi = AFI_IP6;
+	safi_t safi = SAFI_UNICAST;
+	int idx = 0;
+	struct bgp *bgp = NULL;
+
+	bgp_vty_find_and_parse_afi_safi_bgp(vty, argv, argc, &idx, &afi, &safi,
+					    &bgp, false);
+	if (!idx)
+		return CMD_WARNING;
+
+	bgp_soft_reconfig_show(vty, bgp);
+	return CMD_SUCCESS;
+}
+
+
+struct bgp_clear_node_queue {
+	afi_t afi;
+	safi_t safi;
+};
+
+static void bgp_clear_route_path(struct peer *peer, struct bgp_path_info *pi,
+				 afi_t afi, safi_t safi)
+{
+	struct bgp_dest *dest = pi->net;
+	struct bgp *bgp = peer->bgp;
+
+	/* graceful restart STALE flag set. */
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_NSF_WAIT)
+	    && peer->nsf[afi][safi] && !CHECK_FLAG(pi->flags, BGP_PATH_STALE)
+	    && !CHECK_FLAG(pi->flags, BGP_PATH_UNUSEABLE)) {
+		bgp_path_info_set_flag(dest, pi, BGP_PATH_STALE);
+		return;
+	}
 
+	/* If this is an EVPN route, process for un-import. */
+	if (safi == SAFI_EVPN)
+		bgp_evpn_unimport_route(bgp, afi, safi,
+					bgp_dest_get_prefix(dest), pi);
+	/* Handle withdraw for VRF route-leaking and L3VPN */
+	if (SAFI_UNICAST == safi
+	    && (bgp->inst_type == BGP_INSTANCE_TYPE_VRF
+		|| bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT)) {
+		vpn_leak_from_vrf_withdraw(bgp_get_default(), bgp, pi);
+	}
+	if (SAFI_MPLS_VPN == safi && bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT) {
+		vpn_leak_to_vrf_withdraw(bgp, pi);
+	}
 
-struct bgp_clear_node_queue {
-	struct bgp_dest *dest;
-};
+	bgp_rib_remove(dest, pi, peer, afi, safi);
+}
 
+/* Walk exactly the paths the peer owns in this AFI/SAFI, rather than every
+ * dest of the table.  Removed paths stay on the list until bgp_process
+ * reaps them, which never happens synchronously from here.
+ */
 static wq_item_status bgp_clear_route_node(struct work_queue *wq, void *data)
 {
 	struct bgp_clear_node_queue *cnq = data;
-	struct bgp_dest *dest = cnq->dest;
 	struct peer *peer = wq->spec.data;
 	struct bgp_path_info *pi;
-	struct bgp *bgp;
-	afi_t afi = bgp_dest_table(dest)->afi;
-	safi_t safi = bgp_dest_table(dest)->safi;
 
-	assert(dest && peer);
-	bgp = peer->bgp;
+	assert(peer);
 
-	/* It is possible that we have multiple paths for a prefix from a peer
-	 * if that peer is using AddPath.
-	 */
-	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
-		if (pi->peer != peer)
+	frr_each_safe (bgp_peer_paths, &peer->paths[cnq->afi][cnq->safi], pi) {
+		if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
 			continue;
 
-		/* graceful restart STALE flag set. */
-		if (CHECK_FLAG(peer->sflags, PEER_STATUS_NSF_WAIT)
-		    && peer->nsf[afi][safi]
-		    && !CHECK_FLAG(pi->flags, BGP_PATH_STALE)
-		    && !CHECK_FLAG(pi->flags, BGP_PATH_UNUSEABLE))
-			bgp_path_info_set_flag(dest, pi, BGP_PATH_STALE);
-		else {
-			/* If this is an EVPN route, process for
-			 * un-import. */
-			if (safi == SAFI_EVPN)
-				bgp_evpn_unimport_route(
-					bgp, afi, safi,
-					bgp_dest_get_prefix(dest), pi);
-			/* Handle withdraw for VRF route-leaking and L3VPN */
-			if (SAFI_UNICAST == safi
-			    && (bgp->inst_type == BGP_INSTANCE_TYPE_VRF ||
-				bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT)) {
-				vpn_leak_from_vrf_withdraw(bgp_get_default(),
-							   bgp, pi);
-			}
-			if (SAFI_MPLS_VPN == safi &&
-			    bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT) {
-				vpn_leak_to_vrf_withdraw(bgp, pi);
-			}
-
-			bgp_rib_remove(dest, pi, peer, afi, safi);
-		}
+		bgp_clear_route_path(peer, pi, cnq->afi, cnq->safi);
 	}
 	return WQ_SUCCESS;
 }
 
 static void bgp_clear_node_queue_del(struct work_queue *wq, void *data)
 {
-	struct bgp_clear_node_queue *cnq = data;
-	struct bgp_dest *dest = cnq->dest;
-	struct bgp_table *table = bgp_dest_table(dest);
-
-	bgp_dest_unlock_node(dest);
-	bgp_table_unlock(table);
-	XFREE(MTYPE_BGP_CLEAR_NODE_QUEUE, cnq);
+	XFREE(MTYPE_BGP_CLEAR_NODE_QUEUE, data);
 }
 
 static void bgp_clear_node_complete(struct work_queue *wq)
@@ -4665,59 +5198,14 @@ static void bgp_clear_node_queue_init(struct peer *peer)
 	peer->clear_node_queue->spec.data = peer;
 }
 
-static void bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
-				  struct bgp_table *table)
+/* Drop the peer's adj-in entries, kept only with soft-reconfiguration */
+static void bgp_clear_route_adj_in(struct peer *peer, struct bgp_table *table)
 {
 	struct bgp_dest *dest;
-	int force = peer->bgp->process_queue ? 0 : 1;
-
-	if (!table)
-		table = peer->bgp->rib[afi][safi];
-
-	/* If still no table => afi/safi isn't configured at all or smth. */
-	if (!table)
-		return;
+	struct bgp_adj_in *ain;
+	struct bgp_adj_in *ain_next;
 
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		struct bgp_path_info *pi, *next;
-		struct bgp_adj_in *ain;
-		struct bgp_adj_in *ain_next;
-
-		/* XXX:TODO: This is suboptimal, every non-empty route_node is
-		 * queued for every clearing peer, regardless of whether it is
-		 * relevant to the peer at hand.
-		 *
-		 * Overview: There are 3 different indices which need to be
-		 * scrubbed, potentially, when a peer is removed:
-		 *
-		 * 1 peer's routes visible via the RIB (ie accepted routes)
-		 * 2 peer's routes visible by the (optional) peer's adj-in index
-		 * 3 other routes visible by the peer's adj-out index
-		 *
-		 * 3 there is no hurry in scrubbing, once the struct peer is
-		 * removed from bgp->peer, we could just GC such deleted peer's
-		 * adj-outs at our leisure.
-		 *
-		 * 1 and 2 must be 'scrubbed' in some way, at least made
-		 * invisible via RIB index before peer session is allowed to be
-		 * brought back up. So one needs to know when such a 'search' is
-		 * complete.
-		 *
-		 * Ideally:
-		 *
-		 * - there'd be a single global queue or a single RIB walker
-		 * - rather than tracking which route_nodes still need to be
-		 *   examined on a peer basis, we'd track which peers still
-		 *   aren't cleared
-		 *
-		 * Given that our per-peer prefix-counts now should be reliable,
-		 * this may actually be achievable. It doesn't seem to be a huge
-		 * problem at this time,
-		 *
-		 * It is possible that we have multiple paths for a prefix from
-		 * a peer
-		 * if that peer is using AddPath.
-		 */
 		ain = dest->adj_in;
 		while (ain) {
 			ain_next = ain->next;
@@ -4729,75 +5217,72 @@ static void bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
 
 			ain = ain_next;
 		}
-
-		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = next) {
-			next = pi->next;
-			if (pi->peer != peer)
-				continue;
-
-			if (force)
-				bgp_path_info_reap(dest, pi);
-			else {
-				struct bgp_clear_node_queue *cnq;
-
-				/* both unlocked in bgp_clear_node_queue_del */
-				bgp_table_lock(bgp_dest_table(dest));
-				bgp_dest_lock_node(dest);
-				cnq = XCALLOC(
-					MTYPE_BGP_CLEAR_NODE_QUEUE,
-					sizeof(struct bgp_clear_node_queue));
-				cnq->dest = dest;
-				work_queue_add(peer->clear_node_queue, cnq);
-				break;
-			}
-		}
 	}
-	return;
 }
 
 void bgp_clear_route(struct peer *peer, afi_t afi, safi_t safi)
 {
 	struct bgp_dest *dest;
 	struct bgp_table *table;
+	struct bgp_path_info *pi;
+	struct bgp_clear_node_queue *cnq;
 
 	if (peer->clear_node_queue == NULL)
 		bgp_clear_node_queue_init(peer);
 
+	/* If no table => afi/safi isn't configured at all or smth. */
+	if (!peer->bgp->rib[afi][safi])
+		return;
+
 	/* bgp_fsm.c keeps sessions in state Clearing, not transitioning to
 	 * Idle until it receives a Clearing_Completed event. This protects
 	 * against peers which flap faster than we can we clear, which could
 	 * lead to:
 	 *
 	 * a) race with routes from the new session being installed before
-	 *    clear_route_node visits the node (to delete the route of that
+	 *    clear_route_node visits the paths (to delete the routes of that
 	 *    peer)
 	 * b) resource exhaustion, clear_route_node likely leads to an entry
 	 *    on the process_main queue. Fast-flapping could cause that queue
 	 *    to grow and grow.
 	 */
 
-	/* lock peer in assumption that clear-node-queue will get nodes; if so,
-	 * the unlock will happen upon work-queue completion; other wise, the
-	 * unlock happens at the end of this function.
-	 */
-	if (!peer->clear_node_queue->thread)
-		peer_lock(peer);
+	if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG)) {
+		if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP
+		    && safi != SAFI_EVPN)
+			bgp_clear_route_adj_in(peer, peer->bgp->rib[afi][safi]);
+		else
+			for (dest = bgp_table_top(peer->bgp->rib[afi][safi]);
+			     dest; dest = bgp_route_next(dest)) {
+				table = bgp_dest_get_bgp_table_info(dest);
+				if (!table)
+					continue;
 
-	if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP && safi != SAFI_EVPN)
-		bgp_clear_route_table(peer, afi, safi, NULL);
-	else
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest)) {
-			table = bgp_dest_get_bgp_table_info(dest);
-			if (!table)
-				continue;
+				bgp_clear_route_adj_in(peer, table);
+			}
+	}
 
-			bgp_clear_route_table(peer, afi, safi, table);
-		}
+	if (!bgp_peer_paths_count(&peer->paths[afi][safi]))
+		return;
+
+	/* Without a process queue paths are reaped right away */
+	if (!peer->bgp->process_queue) {
+		frr_each_safe (bgp_peer_paths, &peer->paths[afi][safi], pi)
+			bgp_path_info_reap(pi->net, pi);
+		return;
+	}
 
-	/* unlock if no nodes got added to the clear-node-queue. */
+	/* lock peer while the clear-node-queue has work, the unlock happens
+	 * upon work-queue completion.
+	 */
 	if (!peer->clear_node_queue->thread)
-		peer_unlock(peer);
+		peer_lock(peer);
+
+	cnq = XCALLOC(MTYPE_BGP_CLEAR_NODE_QUEUE,
+		      sizeof(struct bgp_clear_node_queue));
+	cnq->afi = afi;
+	cnq->safi = safi;
+	work_queue_add(peer->clear_node_queue, cnq);
 }
 
 void bgp_clear_route_all(struct peer *peer)
@@ -4843,46 +5328,14 @@ void bgp_clear_adj_in(struct peer *peer, afi_t afi, safi_t safi)
 
 void bgp_clear_stale_route(struct peer *peer, afi_t afi, safi_t safi)
 {
-	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
-	struct bgp_table *table;
-
-	if (safi == SAFI_MPLS_VPN) {
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest)) {
-			struct bgp_dest *rm;
 
-			/* look for neighbor in tables */
-			table = bgp_dest_get_bgp_table_info(dest);
-			if (!table)
-				continue;
-
-			for (rm = bgp_table_top(table); rm;
-			     rm = bgp_route_next(rm))
-				for (pi = bgp_dest_get_bgp_path_info(rm); pi;
-				     pi = pi->next) {
-					if (pi->peer != peer)
-						continue;
-					if (!CHECK_FLAG(pi->flags,
-							BGP_PATH_STALE))
-						break;
+	frr_each_safe (bgp_peer_paths, &peer->paths[afi][safi], pi) {
+		if (!CHECK_FLAG(pi->flags, BGP_PATH_STALE)
+		    || CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+			continue;
 
-					bgp_rib_remove(rm, pi, peer, afi, safi);
-					break;
-				}
-		}
-	} else {
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest))
-			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
-			     pi = pi->next) {
-				if (pi->peer != peer)
-					continue;
-				if (!CHECK_FLAG(pi->flags, BGP_PATH_STALE))
-					break;
-				bgp_rib_remove(dest, pi, peer, afi, safi);
-				break;
-			}
+		bgp_rib_remove(pi->net, pi, peer, afi, safi);
 	}
 }
 
@@ -5005,13 +5458,91 @@ void bgp_reset(void)
 	prefix_list_reset();
 }
 
-static int bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi)
+int bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi)
 {
 	return (CHECK_FLAG(peer->af_cap[afi][safi], PEER_CAP_ADDPATH_AF_RX_ADV)
 		&& CHECK_FLAG(peer->af_cap[afi][safi],
 			      PEER_CAP_ADDPATH_AF_TX_RCV));
 }
 
+/* Check a single syntactically valid IPv4/IPv6 prefix and install or
+   withdraw it.  Withdraw is recognized by NULL attr value. */
+static int bgp_nlri_process_ip(struct peer *peer, struct attr *attr,
+			       afi_t afi, safi_t safi, struct prefix *p,
+			       uint32_t addpath_id)
+{
+	int ret;
+
+	/* Check address. */
+	if (afi == AFI_IP && safi == SAFI_UNICAST) {
+		if (IN_CLASSD(ntohl(p->u.prefix4.s_addr))) {
+			/* From RFC4271 Section 6.3:
+			 *
+			 * If a prefix in the NLRI field is semantically
+			 * incorrect
+			 * (e.g., an unexpected multicast IP address),
+			 * an error SHOULD
+			 * be logged locally, and the prefix SHOULD be
+			 * ignored.
+			 */
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: IPv4 unicast NLRI is multicast address %pI4, ignoring",
+				peer->host, &p->u.prefix4);
+			return BGP_NLRI_PARSE_OK;
+		}
+	}
+
+	/* Check address. */
+	if (afi == AFI_IP6 && safi == SAFI_UNICAST) {
+		if (IN6_IS_ADDR_LINKLOCAL(&p->u.prefix6)) {
+			char buf[BUFSIZ];
+
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: IPv6 unicast NLRI is link-local address %s, ignoring",
+				peer->host,
+				inet_ntop(AF_INET6, &p->u.prefix6, buf,
+					  BUFSIZ));
+
+			return BGP_NLRI_PARSE_OK;
+		}
+		if (IN6_IS_ADDR_MULTICAST(&p->u.prefix6)) {
+			char buf[BUFSIZ];
+
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: IPv6 unicast NLRI is multicast address %s, ignoring",
+				peer->host,
+				inet_ntop(AF_INET6, &p->u.prefix6, buf,
+					  BUFSIZ));
+
+			return BGP_NLRI_PARSE_OK;
+		}
+	}
+
+	/* Normal process. */
+	if (attr)
+		ret = bgp_update(peer, p, addpath_id, attr, afi, safi,
+				 ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL,
+				 0, 0, NULL);
+	else
+		ret = bgp_withdraw(peer, p, addpath_id, attr, afi, safi,
+				   ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL,
+				   NULL, 0, NULL);
+
+	/* Do not send BGP notification twice when maximum-prefix count
+	 * overflow. */
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
+		return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+
+	/* Address family configuration mismatch. */
+	if (ret < 0)
+		return BGP_NLRI_PARSE_ERROR_ADDRESS_FAMILY;
+
+	return BGP_NLRI_PARSE_OK;
+}
+
 /* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
    value. */
 int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
@@ -5092,73 +5623,10 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 		/* Fetch prefix from NLRI packet. */
 		memcpy(p.u.val, pnt, psize);
 
-		/* Check address. */
-		if (afi == AFI_IP && safi == SAFI_UNICAST) {
-			if (IN_CLASSD(ntohl(p.u.prefix4.s_addr))) {
-				/* From RFC4271 Section 6.3:
-				 *
-				 * If a prefix in the NLRI field is semantically
-				 * incorrect
-				 * (e.g., an unexpected multicast IP address),
-				 * an error SHOULD
-				 * be logged locally, and the prefix SHOULD be
-				 * ignored.
-				 */
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv4 unicast NLRI is multicast address %pI4, ignoring",
-					peer->host, &p.u.prefix4);
-				continue;
-			}
-		}
-
-		/* Check address. */
-		if (afi == AFI_IP6 && safi == SAFI_UNICAST) {
-			if (IN6_IS_ADDR_LINKLOCAL(&p.u.prefix6)) {
-				char buf[BUFSIZ];
-
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv6 unicast NLRI is link-local address %s, ignoring",
-					peer->host,
-					inet_ntop(AF_INET6, &p.u.prefix6, buf,
-						  BUFSIZ));
-
-				continue;
-			}
-			if (IN6_IS_ADDR_MULTICAST(&p.u.prefix6)) {
-				char buf[BUFSIZ];
-
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv6 unicast NLRI is multicast address %s, ignoring",
-					peer->host,
-					inet_ntop(AF_INET6, &p.u.prefix6, buf,
-						  BUFSIZ));
-
-				continue;
-			}
-		}
-
-		/* Normal process. */
-		if (attr)
-			ret = bgp_update(peer, &p, addpath_id, attr, afi, safi,
-					 ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
-					 NULL, NULL, 0, 0, NULL);
-		else
-			ret = bgp_withdraw(peer, &p, addpath_id, attr, afi,
-					   safi, ZEBRA_ROUTE_BGP,
-					   BGP_ROUTE_NORMAL, NULL, NULL, 0,
-					   NULL);
-
-		/* Do not send BGP notification twice when maximum-prefix count
-		 * overflow. */
-		if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
-			return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
-
-		/* Address family configuration mismatch. */
-		if (ret < 0)
-			return BGP_NLRI_PARSE_ERROR_ADDRESS_FAMILY;
+		ret = bgp_nlri_process_ip(peer, attr, afi, safi, &p,
+					  addpath_id);
+		if (ret != BGP_NLRI_PARSE_OK)
+			return ret;
 	}
 
 	/* Packet length consistency check. */
@@ -5173,6 +5641,24 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	return BGP_NLRI_PARSE_OK;
 }
 
+/* Same as bgp_nlri_parse_ip(), for NLRI already decoded by the parse
+   pthreads. */
+int bgp_nlri_apply_ip(struct peer *peer, struct attr *attr,
+		      struct bgp_preparse_nlri *nlri)
+{
+	int ret;
+
+	for (uint32_t i = 0; i < nlri->count; i++) {
+		ret = bgp_nlri_process_ip(peer, attr, nlri->afi, nlri->safi,
+					  &nlri->prefixes[i].p,
+					  nlri->prefixes[i].addpath_id);
+		if (ret != BGP_NLRI_PARSE_OK)
+			return ret;
+	}
+
+	return BGP_NLRI_PARSE_OK;
+}
+
 static struct bgp_static *bgp_static_new(void)
 {
 	return XCALLOC(MTYPE_BGP_STATIC, sizeof(struct bgp_static));
@@ -5527,7 +6013,8 @@ static void bgp_static_update_safi(struct bgp *bgp, const struct prefix *p,
 		else if (bgp_static->gatewayIp.family == AF_INET6)
 			memcpy(&(add.ipv6), &(bgp_static->gatewayIp.u.prefix6),
 			       sizeof(struct in6_addr));
-		memcpy(&attr.esi, bgp_static->eth_s_id, sizeof(esi_t));
+		memcpy(&bgp_attr_evpn_modify(&attr)->esi, bgp_static->eth_s_id,
+		       sizeof(esi_t));
 		if (bgp_static->encap_tunneltype == BGP_ENCAP_TYPE_VXLAN) {
 			struct bgp_encap_type_vxlan bet;
 			memset(&bet, 0, sizeof(struct bgp_encap_type_vxlan));
@@ -6609,22 +7096,84 @@ static void bgp_aggregate_install(
  *
  * \returns `true` if the MED matched the others else `false`.
  */
-static bool bgp_aggregate_med_match(struct bgp_aggregate *aggregate,
-				    struct bgp *bgp, struct bgp_path_info *pi)
+/* Number of aggregated routes with a given MED */
+struct bgp_aggregate_med {
+	uint32_t med;
+	unsigned long refcnt;
+};
+
+static unsigned int bgp_aggregate_med_hash_key(const void *arg)
+{
+	const struct bgp_aggregate_med *am = arg;
+
+	return jhash_1word(am->med, 0);
+}
+
+static bool bgp_aggregate_med_hash_cmp(const void *arg1, const void *arg2)
 {
-	uint32_t cur_med = bgp_med_value(pi->attr, bgp);
+	const struct bgp_aggregate_med *am1 = arg1;
+	const struct bgp_aggregate_med *am2 = arg2;
 
-	/* This is the first route being analyzed. */
-	if (!aggregate->med_initialized) {
-		aggregate->med_initialized = true;
-		aggregate->med_mismatched = false;
-		aggregate->med_matched_value = cur_med;
+	return am1->med == am2->med;
+}
+
+static void *bgp_aggregate_med_hash_alloc(void *arg)
+{
+	struct bgp_aggregate_med *ref = arg;
+	struct bgp_aggregate_med *am;
+
+	am = XCALLOC(MTYPE_BGP_AGGREGATE_MED, sizeof(*am));
+	am->med = ref->med;
+	return am;
+}
+
+static void bgp_aggregate_med_hash_free(void *arg)
+{
+	XFREE(MTYPE_BGP_AGGREGATE_MED, arg);
+}
+
+/* Forget all MED values, e.g. before re-walking the aggregated routes. */
+static void bgp_aggregate_med_reset(struct bgp_aggregate *aggregate)
+{
+	if (aggregate->med_hash)
+		hash_clean(aggregate->med_hash, bgp_aggregate_med_hash_free);
+	aggregate->med_mismatched = false;
+}
+
+/**
+ * Account for the MED of a route entering (`is_adding`) or leaving the
+ * aggregate.  MEDs mismatch as long as more than one distinct value is in
+ * use, so this is O(1) regardless of the number of aggregated routes.
+ *
+ * \returns `true` if all MEDs are the same otherwise `false`.
+ */
+static bool bgp_aggregate_med_match(struct bgp_aggregate *aggregate,
+				    struct bgp *bgp, struct bgp_path_info *pi,
+				    bool is_adding)
+{
+	struct bgp_aggregate_med ref, *am;
+
+	if (!aggregate->med_hash)
+		aggregate->med_hash =
+			hash_create(bgp_aggregate_med_hash_key,
+				    bgp_aggregate_med_hash_cmp,
+				    "BGP Aggregator MED hash");
+
+	ref.med = bgp_med_value(pi->attr, bgp);
+	if (is_adding) {
+		am = hash_get(aggregate->med_hash, &ref,
+			      bgp_aggregate_med_hash_alloc);
+		am->refcnt++;
 	} else {
-		/* Check if routes with different MED showed up. */
-		if (cur_med != aggregate->med_matched_value)
-			aggregate->med_mismatched = true;
+		am = hash_lookup(aggregate->med_hash, &ref);
+		if (am && --am->refcnt == 0) {
+			hash_release(aggregate->med_hash, am);
+			bgp_aggregate_med_hash_free(am);
+		}
 	}
 
+	aggregate->med_mismatched = hashcount(aggregate->med_hash) > 1;
+
 	return !aggregate->med_mismatched;
 }
 
@@ -6642,9 +7191,8 @@ static bool bgp_aggregate_test_all_med(struct bgp_aggregate *aggregate,
 	const struct prefix *dest_p;
 	struct bgp_dest *dest, *top;
 	struct bgp_path_info *pi;
-	bool med_matched = true;
 
-	aggregate->med_initialized = false;
+	bgp_aggregate_med_reset(aggregate);
 
 	top = bgp_node_get(table, p);
 	for (dest = bgp_node_get(table, p); dest;
@@ -6658,17 +7206,12 @@ static bool bgp_aggregate_test_all_med(struct bgp_aggregate *aggregate,
 				continue;
 			if (pi->sub_type == BGP_ROUTE_AGGREGATE)
 				continue;
-			if (!bgp_aggregate_med_match(aggregate, bgp, pi)) {
-				med_matched = false;
-				break;
-			}
+			bgp_aggregate_med_match(aggregate, bgp, pi, true);
 		}
-		if (!med_matched)
-			break;
 	}
 	bgp_dest_unlock_node(top);
 
-	return med_matched;
+	return !aggregate->med_mismatched;
 }
 
 /**
@@ -6722,10 +7265,11 @@ void bgp_aggregate_toggle_suppressed(struct bgp_aggregate *aggregate,
 /**
  * Aggregate address MED matching incremental test: this function is called
  * when the initial aggregation occurred and we are only testing a single
- * new path.
+ * path being added or removed.
  *
- * In addition to testing and setting the MED validity it also installs back
- * suppressed routes (if summary is configured).
+ * In addition to testing and setting the MED validity it also suppresses
+ * or installs back routes (if summary is configured) when the MED validity
+ * of the aggregate changes.
  *
  * Must not be called in `bgp_aggregate_route`.
  */
@@ -6734,40 +7278,38 @@ static void bgp_aggregate_med_update(struct bgp_aggregate *aggregate,
 				     afi_t afi, safi_t safi,
 				     struct bgp_path_info *pi, bool is_adding)
 {
+	bool was_mismatched;
+
 	/* MED matching disabled. */
 	if (!aggregate->match_med)
 		return;
 
-	/* Aggregation with different MED, nothing to do. */
-	if (aggregate->med_mismatched)
+	/* Aggregate routes are not accounted for. */
+	if (pi->sub_type == BGP_ROUTE_AGGREGATE)
 		return;
 
-	/*
-	 * Test the current entry:
-	 *
-	 * is_adding == true: if the new entry doesn't match then we must
-	 * install all suppressed routes.
-	 *
-	 * is_adding == false: if the entry being removed was the last
-	 * unmatching entry then we can suppress all routes.
-	 */
-	if (!is_adding) {
-		if (bgp_aggregate_test_all_med(aggregate, bgp, p, afi, safi)
-		    && aggregate->summary_only)
-			bgp_aggregate_toggle_suppressed(aggregate, bgp, p, afi,
-							safi, true);
-	} else
-		bgp_aggregate_med_match(aggregate, bgp, pi);
+	was_mismatched = aggregate->med_mismatched;
+	bgp_aggregate_med_match(aggregate, bgp, pi, is_adding);
 
-	/* No mismatches, just quit. */
-	if (!aggregate->med_mismatched)
+	/* MED validity unchanged, just quit. */
+	if (was_mismatched == aggregate->med_mismatched)
 		return;
 
 	/* Route summarization is disabled. */
 	if (!aggregate->summary_only)
 		return;
 
-	bgp_aggregate_toggle_suppressed(aggregate, bgp, p, afi, safi, false);
+	/*
+	 * is_adding == true: the new entry doesn't match, so we must
+	 * install all suppressed routes.
+	 *
+	 * is_adding == false: the entry being removed was the last
+	 * unmatching one, so we can suppress all routes but that one.
+	 */
+	bgp_aggregate_toggle_suppressed(aggregate, bgp, p, afi, safi,
+					!aggregate->med_mismatched);
+	if (!is_adding)
+		aggr_unsuppress_path(aggregate, pi);
 }
 
 /* Update an aggregate as routes are added/removed from the BGP table */
@@ -7078,6 +7620,8 @@ void bgp_aggregate_delete(struct bgp *bgp, const struct prefix *p, afi_t afi,
 			lcommunity_free(&aggregate->lcommunity);
 	}
 
+	bgp_aggregate_med_reset(aggregate);
+
 	bgp_dest_unlock_node(top);
 }
 
@@ -7231,7 +7775,7 @@ static void bgp_remove_route_from_aggregate(struct bgp *bgp, afi_t afi,
 	 */
 	if (aggregate->match_med)
 		bgp_aggregate_med_update(aggregate, bgp, aggr_p, afi, safi, pi,
-					 true);
+					 false);
 
 	if (aggregate->count > 0)
 		aggregate->count--;
@@ -7475,6 +8019,11 @@ int bgp_aggregate_unset(struct bgp *bgp, struct prefix *prefix, afi_t afi,
 		hash_free(aggregate->aspath_hash);
 	}
 
+	if (aggregate->med_hash) {
+		hash_clean(aggregate->med_hash, bgp_aggregate_med_hash_free);
+		hash_free(aggregate->med_hash);
+	}
+
 	bgp_aggregate_free(aggregate);
 	bgp_dest_unlock_node(dest);
 	bgp_dest_unlock_node(dest);
@@ -8569,9 +9118,9 @@ void route_vty_out(struct vty *vty, const struct prefix *p,
 		vty_out(vty, "%s", bgp_origin_str[attr->origin]);
 
 	if (json_paths) {
-		if (bgp_evpn_is_esi_valid(&attr->esi)) {
+		if (bgp_evpn_is_esi_valid(bgp_evpn_attr_get_esi(attr))) {
 			json_object_string_add(json_path, "esi",
-					esi_to_str(&attr->esi,
+					esi_to_str(bgp_evpn_attr_get_esi(attr),
 					esi_buf, sizeof(esi_buf)));
 		}
 		if (safi == SAFI_EVPN &&
@@ -8625,12 +9174,13 @@ void route_vty_out(struct vty *vty, const struct prefix *p,
 			if (path->extra)
 				path_es_info = path->extra->es_info;
 
-			if (bgp_evpn_is_esi_valid(&attr->esi)) {
+			if (bgp_evpn_is_esi_valid(
+				    bgp_evpn_attr_get_esi(attr))) {
 				/* XXX - add these params to the json out */
 				vty_out(vty, "%*s", 20, " ");
 				vty_out(vty, "ESI:%s",
-					esi_to_str(&attr->esi, esi_buf,
-						   sizeof(esi_buf)));
+					esi_to_str(bgp_evpn_attr_get_esi(attr),
+						   esi_buf, sizeof(esi_buf)));
 				if (path_es_info && path_es_info->es)
 					vty_out(vty, " VNI: %u",
 						path_es_info->vni);
@@ -9316,14 +9866,15 @@ static void route_vty_out_detail_es_info(struct vty *vty,
 					 json_object *json_path)
 {
 	char esi_buf[ESI_STR_LEN];
-	bool es_local = !!CHECK_FLAG(attr->es_flags, ATTR_ES_IS_LOCAL);
-	bool peer_router = !!CHECK_FLAG(attr->es_flags,
+	const struct bgp_attr_evpn *evpn = bgp_attr_get_evpn(attr);
+	bool es_local = !!CHECK_FLAG(evpn->es_flags, ATTR_ES_IS_LOCAL);
+	bool peer_router = !!CHECK_FLAG(evpn->es_flags,
 			ATTR_ES_PEER_ROUTER);
-	bool peer_active = !!CHECK_FLAG(attr->es_flags,
+	bool peer_active = !!CHECK_FLAG(evpn->es_flags,
 			ATTR_ES_PEER_ACTIVE);
-	bool peer_proxy = !!CHECK_FLAG(attr->es_flags,
+	bool peer_proxy = !!CHECK_FLAG(evpn->es_flags,
 			ATTR_ES_PEER_PROXY);
-	esi_to_str(&attr->esi, esi_buf, sizeof(esi_buf));
+	esi_to_str(&evpn->esi, esi_buf, sizeof(esi_buf));
 	if (json_path) {
 		json_object *json_es_info = NULL;
 
@@ -9344,10 +9895,10 @@ static void route_vty_out_detail_es_info(struct vty *vty,
 			if (peer_router)
 				json_object_boolean_true_add(
 						json_es_info, "peerRouter");
-			if (attr->mm_sync_seqnum)
+			if (evpn->mm_sync_seqnum)
 				json_object_int_add(
 						json_es_info, "peerSeq",
-						attr->mm_sync_seqnum);
+						evpn->mm_sync_seqnum);
 			json_object_object_add(
 					json_path, "es_info",
 					json_es_info);
@@ -9361,7 +9912,7 @@ static void route_vty_out_detail_es_info(struct vty *vty,
 					peer_proxy ? "proxy " : "",
 					peer_active ? "active ":"",
 					peer_router ? "router ":"",
-					attr->mm_sync_seqnum);
+					evpn->mm_sync_seqnum);
 		else
 			vty_out(vty, "      ESI %s %s\n",
 					esi_buf,
@@ -9856,7 +10407,7 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp,
 	}
 
 	if (safi == SAFI_EVPN &&
-			bgp_evpn_is_esi_valid(&attr->esi)) {
+			bgp_evpn_is_esi_valid(bgp_evpn_attr_get_esi(attr))) {
 		route_vty_out_detail_es_info(vty, path, attr, json_path);
 	}
 
@@ -10322,7 +10873,7 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 	unsigned long total_count = 0;
 	struct prefix *p;
 	json_object *json_paths = NULL;
-	int first = 1;
+	struct json_stream js;
 	bool use_json = CHECK_FLAG(show_flags, BGP_SHOW_OPT_JSON);
 	bool wide = CHECK_FLAG(show_flags, BGP_SHOW_OPT_WIDE);
 	bool all = CHECK_FLAG(show_flags, BGP_SHOW_OPT_AFI_ALL);
@@ -10358,6 +10909,12 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 		vty_out(vty, " \"%s\" : { ", rd);
 	}
 
+	/* prefixes go into the "routes" (or RD) object opened above, one at
+	 * a time
+	 */
+	if (use_json)
+		json_stream_init(&js, vty);
+
 	/* Start processing of routes. */
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
@@ -10579,7 +11136,7 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 			/* encode prefix */
 			if (dest_p->family == AF_FLOWSPEC) {
 				char retstr[BGP_FLOWSPEC_STRING_DISPLAY_MAX];
-
+				char key[BGP_FLOWSPEC_STRING_DISPLAY_MAX + 8];
 
 				bgp_fs_nlri_get_string(
 					(unsigned char *)
@@ -10588,26 +11145,16 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 					retstr, NLRI_STRING_FORMAT_MIN, NULL,
 					family2afi(dest_p->u
 						   .prefix_flowspec.family));
-				if (first)
-					vty_out(vty, "\"%s/%d\": ", retstr,
-						dest_p->u.prefix_flowspec
-							.prefixlen);
-				else
-					vty_out(vty, ",\"%s/%d\": ", retstr,
-						dest_p->u.prefix_flowspec
-							.prefixlen);
+				snprintf(key, sizeof(key), "%s/%d", retstr,
+					 dest_p->u.prefix_flowspec.prefixlen);
+				json_stream_object_add(&js, key, json_paths);
 			} else {
-				if (first)
-					vty_out(vty, "\"%pFX\": ", dest_p);
-				else
-					vty_out(vty, ",\"%pFX\": ", dest_p);
+				char key[PREFIX_STRLEN];
+
+				snprintfrr(key, sizeof(key), "%pFX", dest_p);
+				json_stream_object_add(&js, key, json_paths);
 			}
-			vty_out(vty, "%s",
-				json_object_to_json_string_ext(
-					json_paths, JSON_C_TO_STRING_PRETTY));
-			json_object_free(json_paths);
 			json_paths = NULL;
-			first = 0;
 		} else
 			json_object_free(json_paths);
 	}
@@ -11429,6 +11976,52 @@ DEFUN(show_ip_bgp_statistics_all, show_ip_bgp_statistics_all_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_ip_bgp_statistics_convergence,
+      show_ip_bgp_statistics_convergence_cmd,
+      "show [ip] bgp [<view|vrf> VIEWVRFNAME] statistics convergence [json]",
+      SHOW_STR IP_STR BGP_STR BGP_INSTANCE_HELP_STR
+      "BGP RIB advertisement statistics\n"
+      "Time from receiving an UPDATE to each processing stage\n" JSON_STR)
+{
+	bool uj = use_json(argc, argv);
+	struct bgp *bgp = NULL;
+	safi_t safi = SAFI_UNICAST;
+	afi_t afi = AFI_IP6;
+	int idx = 0;
+	struct json_object *json;
+
+	bgp_vty_find_and_parse_afi_safi_bgp(vty, argv, argc, &idx, &afi, &safi,
+					    &bgp, false);
+	if (!idx)
+		return CMD_WARNING;
+
+	if (uj) {
+		json = json_object_new_object();
+		json_object_object_add(json, "bestpath",
+				       latency_hist_json(&bgp->conv_bestpath));
+		json_object_object_add(json, "zebra",
+				       latency_hist_json(&bgp->conv_zebra));
+		json_object_object_add(json, "fibInstalled",
+				       latency_hist_json(&bgp->conv_fib));
+		vty_out(vty, "%s\n",
+			json_object_to_json_string_ext(
+				json, JSON_C_TO_STRING_PRETTY));
+		json_object_free(json);
+		return CMD_SUCCESS;
+	}
+
+	vty_out(vty, "BGP instance %s convergence\n\n", bgp->name_pretty);
+	latency_hist_show_header(vty, "UPDATE received to");
+	latency_hist_show(vty, "best path selected", &bgp->conv_bestpath);
+	latency_hist_show(vty, "sent to zebra", &bgp->conv_zebra);
+	latency_hist_show(vty, "installed in FIB", &bgp->conv_fib);
+	if (!BGP_SUPPRESS_FIB_ENABLED(bgp))
+		vty_out(vty,
+			"\nFIB installation is only reported with bgp suppress-fib-pending\n");
+
+	return CMD_SUCCESS;
+}
+
 /* BGP route print out function without JSON */
 DEFUN (show_ip_bgp_l2vpn_evpn_statistics,
        show_ip_bgp_l2vpn_evpn_statistics_cmd,
@@ -12503,6 +13096,36 @@ static int bgp_table_stats_single(struct vty *vty, struct bgp *bgp, afi_t afi,
 		if (!json)
 			vty_out(vty, "\n");
 	}
+
+	/* FIB install queue, see bgp_zebra_route_queue() */
+	if (bgp_fibupd_safi(safi)) {
+		bgp_zebra_fib_rate_update();
+		if (!json) {
+			vty_out(vty, "%-30s: %12" PRIu64 "\n", "FIB installs",
+				bgp->fib_installs[afi][safi]);
+			vty_out(vty, "%-30s: %12" PRIu64 "\n", "FIB withdraws",
+				bgp->fib_withdraws[afi][safi]);
+			vty_out(vty, "%-30s: %12" PRIu64 "\n",
+				"FIB updates coalesced",
+				bgp->fib_coalesced[afi][safi]);
+			vty_out(vty, "%-30s: %12u\n", "FIB updates queued",
+				bgp->fib_queued[afi][safi]);
+			vty_out(vty, "%-30s: %12" PRIu64 "\n",
+				"FIB update rate (per sec)",
+				bgp->fib_rate[afi][safi]);
+		} else {
+			json_object_int_add(json, "fibInstalls",
+					    bgp->fib_installs[afi][safi]);
+			json_object_int_add(json, "fibWithdraws",
+					    bgp->fib_withdraws[afi][safi]);
+			json_object_int_add(json, "fibCoalesced",
+					    bgp->fib_coalesced[afi][safi]);
+			json_object_int_add(json, "fibQueued",
+					    bgp->fib_queued[afi][safi]);
+			json_object_int_add(json, "fibUpdateRate",
+					    bgp->fib_rate[afi][safi]);
+		}
+	}
 end_table_stats:
 	if (json)
 		json_object_array_add(json_array, json);
@@ -13035,9 +13658,10 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 					route_filtered = true;
 
 				/* Filter prefix using route-map */
-				ret = bgp_input_modifier(peer, rn_p, &attr, afi,
-							 safi, rmap_name, NULL,
-							 0, NULL);
+				ret = bgp_input_modifier(peer, rn_p, &attr,
+							 ain->attr, afi, safi,
+							 rmap_name, NULL, 0,
+							 NULL);
 
 				if (type == bgp_show_adj_route_filtered &&
 					!route_filtered && ret != RMAP_DENY) {
@@ -13055,7 +13679,7 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 				output_count++;
 			}
 		} else if (type == bgp_show_adj_route_advertised) {
-			RB_FOREACH (adj, bgp_adj_out_rb, &dest->adj_out)
+			BGP_ADJ_OUT_FOREACH (dest, adj)
 				SUBGRP_FOREACH_PEER (adj->subgroup, paf) {
 					if (paf->peer != peer || !adj->attr)
 						continue;
@@ -13070,8 +13694,8 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 
 					attr = *adj->attr;
 					ret = bgp_output_modifier(
-						peer, rn_p, &attr, afi, safi,
-						rmap_name);
+						peer, rn_p, &attr, adj->attr,
+						afi, safi, rmap_name);
 
 					if (ret != RMAP_DENY) {
 						route_vty_out_tmp(
@@ -14485,6 +15109,8 @@ void bgp_route_init(void)
 	install_element(VIEW_NODE, &show_ip_bgp_route_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_regexp_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_statistics_all_cmd);
+	install_element(VIEW_NODE, &show_ip_bgp_statistics_convergence_cmd);
+	install_element(VIEW_NODE, &show_ip_bgp_soft_reconfig_progress_cmd);
 
 	install_element(VIEW_NODE,
 			&show_ip_bgp_instance_neighbor_advertised_route_cmd);
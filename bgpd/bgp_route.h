@@ -31,6 +31,7 @@
 
 struct bgp_nexthop_cache;
 struct bgp_route_evpn;
+struct bgp_preparse_nlri;
 
 enum bgp_show_type {
 	bgp_show_type_normal,
@@ -210,6 +211,9 @@ struct bgp_path_info {
 	struct bgp_path_info *next;
 	struct bgp_path_info *prev;
 
+	/* Entry on the owning peer's list, see bgp_path_info_add() */
+	struct bgp_peer_paths_item peer_item;
+
 	/* For nexthop linked list */
 	LIST_ENTRY(bgp_path_info) nh_thread;
 
@@ -277,8 +281,17 @@ struct bgp_path_info {
 	/* Addpath identifiers */
 	uint32_t addpath_rx_id;
 	struct bgp_addpath_info_data tx_addpath;
+
+	/* Route-server export policy cache: index into the denial bitmaps
+	 * of the update-groups, and the attributes (referenced) the bits
+	 * were set for.  See update_group_export_deny().
+	 */
+	uint32_t export_id;
+	struct attr *export_attr;
 };
 
+DECLARE_DLIST(bgp_peer_paths, struct bgp_path_info, peer_item);
+
 /* Structure used in BGP path selection */
 struct bgp_path_info_pair {
 	struct bgp_path_info *old;
@@ -398,12 +411,13 @@ struct bgp_aggregate {
 	/** Match only equal MED. */
 	bool match_med;
 	/* MED matching state. */
-	/** Did we get the first MED value? */
-	bool med_initialized;
+	/**
+	 * MED values of the aggregated routes, with the number of routes
+	 * using each (`struct bgp_aggregate_med`).
+	 */
+	struct hash *med_hash;
 	/** Are there MED mismatches? */
 	bool med_mismatched;
-	/** MED value found in current group. */
-	uint32_t med_matched_value;
 
 	/**
 	 * Test if aggregated address MED of all route match, otherwise
@@ -435,6 +449,12 @@ struct bgp_aggregate {
 	(!CHECK_FLAG((BI)->flags, BGP_PATH_HISTORY)                            \
 	 && !CHECK_FLAG((BI)->flags, BGP_PATH_REMOVED))
 
+/* Flags that can change whether a path is counted */
+#define BGP_PATH_COUNTABLE_FLAGS                                               \
+	(BGP_PATH_VALID | BGP_PATH_HISTORY | BGP_PATH_REMOVED)
+/* Flags that can change whether a path is advertised */
+#define BGP_PATH_ADVERTISE_FLAGS (BGP_PATH_COUNTABLE_FLAGS | BGP_PATH_DAMPED)
+
 /* Flags which indicate a route is unuseable in some form */
 #define BGP_PATH_UNUSEABLE                                                     \
 	(BGP_PATH_HISTORY | BGP_PATH_DAMPED | BGP_PATH_REMOVED)
@@ -552,6 +572,13 @@ DECLARE_HOOK(bgp_process,
 	      struct peer *peer, bool withdraw),
 	     (bgp, afi, safi, bn, peer, withdraw))
 
+/* called when the selected path for a dest changes */
+DECLARE_HOOK(bgp_route_update,
+	     (struct bgp * bgp, afi_t afi, safi_t safi, struct bgp_dest *bn,
+	      struct bgp_path_info *old_route,
+	      struct bgp_path_info *new_route),
+	     (bgp, afi, safi, bn, old_route, new_route))
+
 /* BGP show options */
 #define BGP_SHOW_OPT_JSON (1 << 0)
 #define BGP_SHOW_OPT_WIDE (1 << 1)
@@ -571,6 +598,7 @@ extern void bgp_stop_announce_route_timer(struct peer_af *paf);
 extern void bgp_announce_route_all(struct peer *);
 extern void bgp_default_originate(struct peer *, afi_t, safi_t, int);
 extern void bgp_soft_reconfig_in(struct peer *, afi_t, safi_t);
+extern void bgp_soft_reconfig_in_cancel(struct peer *peer);
 extern void bgp_clear_route(struct peer *, afi_t, safi_t);
 extern void bgp_clear_route_all(struct peer *);
 extern void bgp_clear_adj_in(struct peer *, afi_t, safi_t);
@@ -597,7 +625,10 @@ extern void bgp_path_info_unset_flag(struct bgp_dest *dest,
 extern void bgp_path_info_path_with_addpath_rx_str(struct bgp_path_info *pi,
 						   char *buf);
 
+extern int bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi);
 extern int bgp_nlri_parse_ip(struct peer *, struct attr *, struct bgp_nlri *);
+extern int bgp_nlri_apply_ip(struct peer *peer, struct attr *attr,
+			     struct bgp_preparse_nlri *nlri);
 
 extern bool bgp_maximum_prefix_overflow(struct peer *, afi_t, safi_t, int);
 
@@ -693,7 +724,6 @@ extern void route_vty_out_overlay(struct vty *vty, const struct prefix *p,
 				  struct bgp_path_info *path, int display,
 				  json_object *json);
 
-extern void bgp_notify_conditional_adv_scanner(struct update_subgroup *subgrp);
 
 extern void subgroup_process_announce_selected(struct update_subgroup *subgrp,
 					       struct bgp_path_info *selected,
@@ -65,6 +65,7 @@
 #include "bgpd/bgp_flowspec_util.h"
 #include "bgpd/bgp_encap_types.h"
 #include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_conditional_adv.h"
 
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
@@ -334,78 +335,112 @@ static const struct route_map_rule_cmd route_match_peer_cmd = {
 	"peer",
 	route_match_peer,
 	route_match_peer_compile,
-	route_match_peer_free
+	route_match_peer_free,
+	NULL,
+	true, /* no_cache */
 };
 
 #if defined(HAVE_LUA)
+/*
+ * What scripts see as "nexthop": reads come from the path's attributes,
+ * writes go to a staging copy that is only applied if the rule returns
+ * LUA_RM_MATCH_AND_CHANGE.
+ */
+struct bgp_lua_path {
+	const struct bgp_path_info *path;
+	uint32_t med;
+	uint32_t local_pref;
+};
+
+static int bgp_lua_path_index(lua_State *L);
+static int bgp_lua_path_newindex(lua_State *L);
+
+static const struct frrlua_udtype bgp_lua_path_type = {
+	.name = "bgp.path",
+	.index = bgp_lua_path_index,
+	.newindex = bgp_lua_path_newindex,
+};
+
+static int bgp_lua_path_index(lua_State *L)
+{
+	struct bgp_lua_path *lp = frrlua_check_ptr(L, 1, &bgp_lua_path_type);
+	const char *key = luaL_checkstring(L, 2);
+
+	if (!strcmp(key, "metric"))
+		lua_pushinteger(L, lp->med);
+	else if (!strcmp(key, "localpref"))
+		lua_pushinteger(L, lp->local_pref);
+	else if (!strcmp(key, "ifindex"))
+		lua_pushinteger(L, lp->path->attr->nh_ifindex);
+	else if (!strcmp(key, "aspath"))
+		lua_pushstring(L, lp->path->attr->aspath->str);
+	else
+		lua_pushnil(L);
+	return 1;
+}
+
+static int bgp_lua_path_newindex(lua_State *L)
+{
+	struct bgp_lua_path *lp = frrlua_check_ptr(L, 1, &bgp_lua_path_type);
+	const char *key = luaL_checkstring(L, 2);
+
+	if (!strcmp(key, "metric"))
+		lp->med = luaL_checkinteger(L, 3);
+	else if (!strcmp(key, "localpref"))
+		lp->local_pref = luaL_checkinteger(L, 3);
+	else
+		return luaL_error(L, "bgp.path: %s is read-only", key);
+	return 0;
+}
+
 static enum route_map_cmd_result_t
 route_match_command(void *rule, const struct prefix *prefix, void *object)
 {
 	int status = RMAP_NOMATCH;
 	u_int32_t locpref = 0;
-	u_int32_t newlocpref = 0;
 	enum lua_rm_status lrm_status;
 	struct bgp_path_info *path = (struct bgp_path_info *)object;
-	lua_State *L = lua_initialize("/etc/frr/lua.scr");
+	struct bgp_lua_path lp = {
+		.path = path,
+		.med = path->attr->med,
+		.local_pref = path->attr->local_pref,
+	};
+	lua_State *L = frrlua_state_get("/etc/frr/lua.scr");
 
 	if (L == NULL)
 		return status;
 
-	/*
-	 * Setup the prefix information to pass in
-	 */
-	lua_setup_prefix_table(L, prefix);
-
-	zlog_debug("Set up prefix table");
-	/*
-	 * Setup the bgp_path_info information
-	 */
-	lua_newtable(L);
-	lua_pushinteger(L, path->attr->med);
-	lua_setfield(L, -2, "metric");
-	lua_pushinteger(L, path->attr->nh_ifindex);
-	lua_setfield(L, -2, "ifindex");
-	lua_pushstring(L, path->attr->aspath->str);
-	lua_setfield(L, -2, "aspath");
-	lua_pushinteger(L, path->attr->local_pref);
-	lua_setfield(L, -2, "localpref");
-	zlog_debug("%s %d", path->attr->aspath->str, path->attr->nh_ifindex);
+	frrlua_push_ptr(L, &frrlua_prefix_type, prefix);
+	lua_setglobal(L, "prefix");
+	frrlua_push_ptr(L, &bgp_lua_path_type, &lp);
 	lua_setglobal(L, "nexthop");
 
-	zlog_debug("Set up nexthop information");
-	/*
-	 * Run the rule
-	 */
 	lrm_status = lua_run_rm_rule(L, rule);
 	switch (lrm_status) {
 	case LUA_RM_FAILURE:
-		zlog_debug("RM_FAILURE");
-		break;
 	case LUA_RM_NOMATCH:
-		zlog_debug("RM_NOMATCH");
 		break;
 	case LUA_RM_MATCH_AND_CHANGE:
-		zlog_debug("MATCH AND CHANGE");
-		lua_getglobal(L, "nexthop");
-		path->attr->med = get_integer(L, "metric");
+		path->attr->med = lp.med;
 		/*
 		 * This needs to be abstraced with the set function
 		 */
 		if (path->attr->flag & ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF))
 			locpref = path->attr->local_pref;
-		newlocpref = get_integer(L, "localpref");
-		if (newlocpref != locpref) {
+		if (lp.local_pref != locpref) {
 			path->attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF);
-			path->attr->local_pref = newlocpref;
+			path->attr->local_pref = lp.local_pref;
 		}
 		status = RMAP_MATCH;
 		break;
 	case LUA_RM_MATCH:
-		zlog_debug("MATCH ONLY");
 		status = RMAP_MATCH;
 		break;
 	}
-	lua_close(L);
+
+	/* the state outlives this call, don't leave dangling pointers */
+	frrlua_unset_ptr(L, &frrlua_prefix_type);
+	frrlua_unset_ptr(L, &bgp_lua_path_type);
 	return status;
 }
 
@@ -427,7 +462,9 @@ static const struct route_map_rule_cmd route_match_command_cmd = {
 	"command",
 	route_match_command,
 	route_match_command_compile,
-	route_match_command_free
+	route_match_command_free,
+	NULL,
+	true, /* no_cache */
 };
 #endif
 
@@ -935,7 +972,9 @@ static const struct route_map_rule_cmd route_match_evpn_vni_cmd = {
 	"evpn vni",
 	route_match_vni,
 	route_match_vni_compile,
-	route_match_vni_free
+	route_match_vni_free,
+	NULL,
+	true, /* no_cache */
 };
 
 /* `match evpn route-type' */
@@ -1040,7 +1079,9 @@ static const struct route_map_rule_cmd route_match_evpn_rd_cmd = {
 	"evpn rd",
 	route_match_rd,
 	route_match_rd_compile,
-	route_match_rd_free
+	route_match_rd_free,
+	NULL,
+	true, /* no_cache */
 };
 
 /* Route map commands for VRF route leak with source vrf matching */
@@ -1087,7 +1128,9 @@ static const struct route_map_rule_cmd route_match_vrl_source_vrf_cmd = {
 	"source-vrf",
 	route_match_vrl_source_vrf,
 	route_match_vrl_source_vrf_compile,
-	route_match_vrl_source_vrf_free
+	route_match_vrl_source_vrf_free,
+	NULL,
+	true, /* no_cache */
 };
 
 /* `match local-preference LOCAL-PREF' */
@@ -1523,7 +1566,9 @@ static const struct route_map_rule_cmd route_match_probability_cmd = {
 	"probability",
 	route_match_probability,
 	route_match_probability_compile,
-	route_match_probability_free
+	route_match_probability_free,
+	NULL,
+	true, /* no_cache */
 };
 
 /* `match interface IFNAME' */
@@ -1566,7 +1611,9 @@ static const struct route_map_rule_cmd route_match_interface_cmd = {
 	"interface",
 	route_match_interface,
 	route_match_interface_compile,
-	route_match_interface_free
+	route_match_interface_free,
+	NULL,
+	true, /* no_cache */
 };
 
 /* } */
@@ -3537,6 +3584,7 @@ static void bgp_route_map_process_peer(const char *rmap_name,
 
 	/* Notify BGP conditional advertisement scanner percess */
 	peer->advmap_config_change[afi][safi] = true;
+	bgp_conditional_adv_schedule(peer->bgp);
 }
 
 static void bgp_route_map_update_peer_group(const char *rmap_name,
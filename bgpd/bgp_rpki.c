@@ -40,6 +40,7 @@
 #include "memory.h"
 #include "thread.h"
 #include "filter.h"
+#include "table.h"
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
 #include "bgp_advertise.h"
@@ -62,11 +63,18 @@
 
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE, "BGP RPKI Cache server")
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE_GROUP, "BGP RPKI Cache server group")
+DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_VCACHE, "BGP RPKI validation cache")
 
 #define RPKI_VALID      1
 #define RPKI_NOTFOUND   2
 #define RPKI_INVALID    3
 
+/* most records from rtrlib handled per bgpd_sync_callback() run */
+#define RPKI_SYNC_BATCH 128
+
+/* the validation cache is flushed when it gets bigger than this */
+#define RPKI_VCACHE_MAX 262144
+
 #define POLLING_PERIOD_DEFAULT 3600
 #define EXPIRE_INTERVAL_DEFAULT 7200
 #define RETRY_INTERVAL_DEFAULT 600
@@ -129,6 +137,7 @@ static enum route_map_cmd_result_t route_match(void *rule,
 static void *route_match_compile(const char *arg);
 static void revalidate_bgp_node(struct bgp_dest *dest, afi_t afi, safi_t safi);
 static void revalidate_all_routes(void);
+static void rpki_vcache_flush(void);
 
 static struct rtr_mgr_config *rtr_config;
 static struct list *cache_list;
@@ -142,6 +151,21 @@ static unsigned int retry_interval;
 static int rpki_sync_socket_rtr;
 static int rpki_sync_socket_bgpd;
 
+/*
+ * Validation results by prefix and origin AS, so that route-maps matching on
+ * RPKI state don't have to ask rtrlib every time they are evaluated.  Entries
+ * covered by a ROA that changes are dropped before the routes covered by it
+ * are revalidated, and everything is dropped whenever the whole table is.
+ */
+struct rpki_vcache {
+	struct rpki_vcache *next;
+	as_t as;
+	int state;
+};
+
+static struct route_table *rpki_vcache_table[AFI_MAX];
+static unsigned long rpki_vcache_count;
+
 static struct cmd_node rpki_node = {
 	.name = "rpki",
 	.node = RPKI_NODE,
@@ -151,7 +175,7 @@ static struct cmd_node rpki_node = {
 	.node_exit = config_on_exit,
 };
 static const struct route_map_rule_cmd route_match_rpki_cmd = {
-	"rpki", route_match, route_match_compile, route_match_free};
+	"rpki", route_match, route_match_compile, route_match_free, NULL, true};
 
 static void *malloc_wrapper(size_t size)
 {
@@ -356,12 +380,137 @@ static struct prefix *pfx_record_to_prefix(struct pfx_record *record)
 	return prefix;
 }
 
-static int bgpd_sync_callback(struct thread *thread)
+static bool rpki_vcache_lookup(const struct prefix *prefix, as_t as,
+			       int *state)
+{
+	struct route_node *rn;
+	struct rpki_vcache *vc;
+
+	rn = route_node_lookup(rpki_vcache_table[family2afi(prefix->family)],
+			       prefix);
+	if (!rn)
+		return false;
+
+	for (vc = rn->info; vc; vc = vc->next)
+		if (vc->as == as)
+			break;
+	route_unlock_node(rn);
+
+	if (!vc)
+		return false;
+
+	*state = vc->state;
+	return true;
+}
+
+static void rpki_vcache_add(const struct prefix *prefix, as_t as, int state)
+{
+	struct route_node *rn;
+	struct rpki_vcache *vc;
+
+	if (rpki_vcache_count >= RPKI_VCACHE_MAX)
+		rpki_vcache_flush();
+
+	rn = route_node_get(rpki_vcache_table[family2afi(prefix->family)],
+			    prefix);
+	if (rn->info)
+		/* the node is locked once for its info already */
+		route_unlock_node(rn);
+
+	vc = XMALLOC(MTYPE_BGP_RPKI_VCACHE, sizeof(*vc));
+	vc->as = as;
+	vc->state = state;
+	vc->next = rn->info;
+	rn->info = vc;
+	rpki_vcache_count++;
+}
+
+static void rpki_vcache_del(struct route_node *rn)
+{
+	struct rpki_vcache *vc, *next;
+
+	if (!rn->info)
+		return;
+
+	for (vc = rn->info; vc; vc = next) {
+		next = vc->next;
+		XFREE(MTYPE_BGP_RPKI_VCACHE, vc);
+		rpki_vcache_count--;
+	}
+	rn->info = NULL;
+	route_unlock_node(rn);
+}
+
+/* Drops results for prefixes covered by prefix. */
+static void rpki_vcache_invalidate(const struct prefix *prefix)
+{
+	struct route_table *table =
+		rpki_vcache_table[family2afi(prefix->family)];
+	struct route_node *top, *rn;
+
+	if (!rpki_vcache_count)
+		return;
+
+	top = route_node_get(table, prefix);
+	for (rn = top; rn; rn = route_next_until(rn, top))
+		rpki_vcache_del(rn);
+}
+
+static void rpki_vcache_flush(void)
+{
+	struct route_node *rn;
+
+	for (afi_t afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		if (!rpki_vcache_table[afi])
+			continue;
+		for (rn = route_top(rpki_vcache_table[afi]); rn;
+		     rn = route_next(rn))
+			rpki_vcache_del(rn);
+	}
+	assert(rpki_vcache_count == 0);
+}
+
+/*
+ * Revalidates the routes a change to a ROA for prefix can affect: those for
+ * prefix and anything more specific, in every instance.
+ */
+static void revalidate_prefix(const struct prefix *prefix)
 {
 	struct bgp *bgp;
 	struct listnode *node;
-	struct prefix *prefix;
+	afi_t afi = family2afi(prefix->family);
+
+	rpki_vcache_invalidate(prefix);
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		safi_t safi;
+
+		for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
+			if (!bgp->rib[afi][safi])
+				continue;
+
+			struct bgp_dest *match;
+			struct bgp_dest *dest;
+
+			match = bgp_table_subtree_lookup(bgp->rib[afi][safi],
+							 prefix);
+			dest = match;
+
+			while (dest) {
+				if (bgp_dest_has_bgp_path_info_data(dest))
+					revalidate_bgp_node(dest, afi, safi);
+
+				dest = bgp_route_next_until(dest, match);
+			}
+		}
+	}
+}
+
+static int bgpd_sync_callback(struct thread *thread)
+{
+	struct prefix *prefix, *last = NULL;
 	struct pfx_record rec;
+	unsigned int count;
 
 	thread_add_read(bm->master, bgpd_sync_callback, NULL,
 			rpki_sync_socket_bgpd, NULL);
@@ -374,53 +523,38 @@ static int bgpd_sync_callback(struct thread *thread)
 
 		atomic_store_explicit(&rtr_update_overflow, 0,
 				      memory_order_seq_cst);
+		rpki_vcache_flush();
 		revalidate_all_routes();
 		return 0;
 	}
 
-	int retval =
-		read(rpki_sync_socket_bgpd, &rec, sizeof(struct pfx_record));
-	if (retval != sizeof(struct pfx_record)) {
-		RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
-		return retval;
-	}
-	prefix = pfx_record_to_prefix(&rec);
-
-	afi_t afi = (rec.prefix.ver == LRTR_IPV4) ? AFI_IP : AFI_IP6;
-
-	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
-		struct peer *peer;
-		struct listnode *peer_listnode;
-
-		for (ALL_LIST_ELEMENTS_RO(bgp->peer, peer_listnode, peer)) {
-			safi_t safi;
-
-			for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
-				if (!peer->bgp->rib[afi][safi])
-					continue;
-
-				struct bgp_dest *match;
-				struct bgp_dest *node;
-
-				match = bgp_table_subtree_lookup(
-					peer->bgp->rib[afi][safi], prefix);
-				node = match;
-
-				while (node) {
-					if (bgp_dest_has_bgp_path_info_data(
-						    node)) {
-						revalidate_bgp_node(node, afi,
-								    safi);
-					}
+	/*
+	 * Take what rtrlib has queued up in batches; a ROA often comes with
+	 * others for the same prefix (e.g. other origin ASes, or the withdraw
+	 * of the ROA it replaces), the routes are revalidated once for them.
+	 */
+	for (count = 0; count < RPKI_SYNC_BATCH; count++) {
+		int retval = read(rpki_sync_socket_bgpd, &rec,
+				  sizeof(struct pfx_record));
+		if (retval != sizeof(struct pfx_record)) {
+			if (retval != -1 || !ERRNO_IO_RETRY(errno))
+				RPKI_DEBUG(
+					"Could not read from rpki_sync_socket_bgpd");
+			break;
+		}
 
-					node = bgp_route_next_until(node,
-								    match);
-				}
-			}
+		prefix = pfx_record_to_prefix(&rec);
+		if (last && prefix_same(prefix, last)) {
+			prefix_free(&prefix);
+			continue;
 		}
+
+		revalidate_prefix(prefix);
+		prefix_free(&last);
+		last = prefix;
 	}
 
-	prefix_free(&prefix);
+	prefix_free(&last);
 	return 0;
 }
 
@@ -544,6 +678,9 @@ static int bgp_rpki_init(struct thread_master *master)
 	retry_interval = RETRY_INTERVAL_DEFAULT;
 	install_cli_commands();
 	rpki_init_sync_socket();
+
+	rpki_vcache_table[AFI_IP] = route_table_init();
+	rpki_vcache_table[AFI_IP6] = route_table_init();
 	return 0;
 }
 
@@ -552,6 +689,10 @@ static int bgp_rpki_fini(void)
 	stop();
 	list_delete(&cache_list);
 
+	route_table_finish(rpki_vcache_table[AFI_IP]);
+	route_table_finish(rpki_vcache_table[AFI_IP6]);
+	rpki_vcache_table[AFI_IP] = rpki_vcache_table[AFI_IP6] = NULL;
+
 	close(rpki_sync_socket_rtr);
 	close(rpki_sync_socket_bgpd);
 
@@ -615,6 +756,9 @@ static void stop(void)
 		rtr_mgr_free(rtr_config);
 		rtr_is_running = 0;
 	}
+
+	/* the ROAs are gone, so are the results */
+	rpki_vcache_flush();
 }
 
 static int reset(bool force)
@@ -700,6 +844,7 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 	as_t as_number = 0;
 	struct lrtr_ip_addr ip_addr_prefix;
 	enum pfxv_state result;
+	int state;
 
 	if (!is_synchronized())
 		return 0;
@@ -745,6 +890,9 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 		return 0;
 	}
 
+	if (rpki_vcache_lookup(prefix, as_number, &state))
+		return state;
+
 	// Do the actual validation
 	rtr_mgr_validate(rtr_config, as_number, &ip_addr_prefix,
 			 prefix->prefixlen, &result);
@@ -755,24 +903,29 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: VALID",
 			prefix, as_number);
-		return RPKI_VALID;
+		state = RPKI_VALID;
+		break;
 	case BGP_PFXV_STATE_NOT_FOUND:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: NOT FOUND",
 			prefix, as_number);
-		return RPKI_NOTFOUND;
+		state = RPKI_NOTFOUND;
+		break;
 	case BGP_PFXV_STATE_INVALID:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: INVALID",
 			prefix, as_number);
-		return RPKI_INVALID;
+		state = RPKI_INVALID;
+		break;
 	default:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: CANNOT VALIDATE",
 			prefix, as_number);
-		break;
+		return 0;
 	}
-	return 0;
+
+	rpki_vcache_add(prefix, as_number, state);
+	return state;
 }
 
 static int add_cache(struct cache *cache)
@@ -0,0 +1,157 @@
+/* BGP best-path selection pthreads
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "prefix.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_select.h"
+
+/* default pool size is capped, other pthreads need CPUs as well */
+#define BGP_SELECT_THREADS_DEFAULT_MAX 8
+
+static struct frr_pthread *bgp_pth_select[BGP_SELECT_THREADS_MAX];
+static unsigned int bgp_select_count;
+
+/* batch being run, there is only ever one at a time */
+static struct bgp_select_batch {
+	struct bgp *bgp;
+	struct bgp_select *items;
+	unsigned int count;
+	void (*fn)(struct bgp *bgp, struct bgp_select *item);
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int pending;
+} batch = {
+	.mtx = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+/* shard of each pthread, the main pthread has shard 0 */
+static unsigned int bgp_select_shards[BGP_SELECT_THREADS_MAX];
+
+static void bgp_select_shard(unsigned int shard)
+{
+	for (unsigned int i = 0; i < batch.count; i++)
+		if (batch.items[i].shard == shard)
+			batch.fn(batch.bgp, &batch.items[i]);
+}
+
+static int bgp_select_work(struct thread *thread)
+{
+	unsigned int *shard = THREAD_ARG(thread);
+
+	bgp_select_shard(*shard);
+
+	frr_with_mutex (&batch.mtx) {
+		if (--batch.pending == 0)
+			pthread_cond_signal(&batch.cond);
+	}
+	return 0;
+}
+
+void bgp_select_pthreads_init(int count)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	char name[32], os_name[OS_THREAD_NAMELEN];
+
+	if (count < 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		/* the main pthread takes a shard itself */
+		count = MIN(MAX(ncpus - 1, 0), BGP_SELECT_THREADS_DEFAULT_MAX);
+	}
+
+	bgp_select_count = MIN(count, BGP_SELECT_THREADS_MAX);
+
+	for (unsigned int i = 0; i < bgp_select_count; i++) {
+		snprintf(name, sizeof(name), "BGP select thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_select%u", i);
+		bgp_pth_select[i] = frr_pthread_new(&attr, name, os_name);
+		bgp_select_shards[i] = i + 1;
+	}
+}
+
+void bgp_select_pthreads_run(void)
+{
+	for (unsigned int i = 0; i < bgp_select_count; i++)
+		frr_pthread_run(bgp_pth_select[i], NULL);
+	for (unsigned int i = 0; i < bgp_select_count; i++)
+		frr_pthread_wait_running(bgp_pth_select[i]);
+}
+
+bool bgp_select_enabled(void)
+{
+	return bgp_select_count > 0;
+}
+
+void bgp_select_run(struct bgp *bgp, struct bgp_select *items,
+		    unsigned int count,
+		    void (*fn)(struct bgp *bgp, struct bgp_select *item))
+{
+	unsigned int nshards = bgp_select_count + 1;
+	bool dispatched[BGP_SELECT_THREADS_MAX] = {};
+
+	for (unsigned int i = 0; i < count; i++)
+		items[i].shard =
+			prefix_hash_key(bgp_dest_get_prefix(items[i].dest))
+			% nshards;
+
+	batch.bgp = bgp;
+	batch.items = items;
+	batch.count = count;
+	batch.fn = fn;
+	batch.pending = 0;
+
+	frr_with_mutex (&batch.mtx) {
+		for (unsigned int i = 0; i < bgp_select_count; i++) {
+			if (!atomic_load_explicit(&bgp_pth_select[i]->running,
+						  memory_order_relaxed))
+				continue;
+			thread_add_event(bgp_pth_select[i]->master,
+					 bgp_select_work, &bgp_select_shards[i],
+					 0, NULL);
+			dispatched[i] = true;
+			batch.pending++;
+		}
+	}
+
+	bgp_select_shard(0);
+
+	/* shards of pthreads that are gone already (shutdown) */
+	for (unsigned int i = 0; i < bgp_select_count; i++)
+		if (!dispatched[i])
+			bgp_select_shard(bgp_select_shards[i]);
+
+	frr_with_mutex (&batch.mtx) {
+		while (batch.pending)
+			pthread_cond_wait(&batch.cond, &batch.mtx);
+	}
+
+	batch.items = NULL;
+	batch.count = 0;
+}
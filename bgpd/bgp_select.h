@@ -0,0 +1,68 @@
+/* BGP best-path selection pthreads
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_SELECT_H
+#define _FRR_BGP_SELECT_H
+
+#include "linklist.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_route.h"
+
+/*
+ * bgp_process_wq() hands each batch of dests to a pool of pthreads to compare
+ * paths and pick the best path and multipath candidates, sharded by prefix.
+ * The main pthread takes a shard as well and waits for the others, so nothing
+ * else touches the RIB in the meantime.
+ *
+ * Everything with side effects beyond the dest itself (reaping, multipath
+ * and addpath updates, labels, update-groups, zebra, ...) then runs on the
+ * main pthread, one dest at a time and in queue order, exactly as before.
+ */
+
+#define BGP_SELECT_THREADS_MAX 64
+
+/* smaller batches aren't worth waking up the pool */
+#define BGP_SELECT_BATCH_MIN 64
+
+/* One dest of a batch. */
+struct bgp_select {
+	struct bgp_dest *dest;
+
+	/* only valid as long as dest has BGP_NODE_SELECT_PENDING */
+	struct bgp_path_info_pair result;
+	struct list mp_list;
+
+	unsigned int shard;
+};
+
+/* count < 0 picks a number based on the CPUs available, 0 disables this. */
+extern void bgp_select_pthreads_init(int count);
+extern void bgp_select_pthreads_run(void);
+
+extern bool bgp_select_enabled(void);
+
+/*
+ * Call fn on every item, spread over the pool and the calling pthread.  Main
+ * pthread only; returns once all items are done.
+ */
+extern void bgp_select_run(struct bgp *bgp, struct bgp_select *items,
+			   unsigned int count,
+			   void (*fn)(struct bgp *bgp, struct bgp_select *item));
+
+#endif /* _FRR_BGP_SELECT_H */
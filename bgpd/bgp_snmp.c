@@ -649,195 +649,148 @@ static uint8_t *bgpRcvdPathAttrTable(struct variable *v, oid name[],
 	return NULL;
 }
 
-static struct bgp_path_info *bgp4PathAttrLookup(struct variable *v, oid name[],
-						size_t *length, struct bgp *bgp,
-						struct prefix_ipv4 *addr,
-						int exact)
-{
-	oid *offset;
-	int offsetlen;
-	struct bgp_path_info *path;
-	struct bgp_path_info *min;
-	struct bgp_dest *dest;
-	union sockunion su;
-	unsigned int len;
-	struct in_addr paddr;
-
-	sockunion_init(&su);
+/*
+ * bgp4PathAttrTable is served from a snapshot: finding the next path in
+ * (prefix, peer) order from the live RIB costs a table lookup plus a scan
+ * of the paths on every GETNEXT, and a poller walking the table would
+ * keep bgpd busy for the whole walk.
+ */
+#define BGP_SNMP_SNAP_AGE 10
 
 #define BGP_PATHATTR_ENTRY_OFFSET (IN_ADDR_SIZE + 1 + IN_ADDR_SIZE)
 
-	if (exact) {
-		if (*length - v->namelen != BGP_PATHATTR_ENTRY_OFFSET)
-			return NULL;
-
-		/* Set OID offset for prefix. */
-		offset = name + v->namelen;
-		oid2in_addr(offset, IN_ADDR_SIZE, &addr->prefix);
-		offset += IN_ADDR_SIZE;
-
-		/* Prefix length. */
-		addr->prefixlen = *offset;
-		offset++;
-
-		/* Peer address. */
-		su.sin.sin_family = AF_INET;
-		oid2in_addr(offset, IN_ADDR_SIZE, &su.sin.sin_addr);
-
-		/* Lookup node. */
-		dest = bgp_node_lookup(bgp->rib[AFI_IP][SAFI_UNICAST],
-				       (struct prefix *)addr);
-		if (dest) {
-			bgp_dest_unlock_node(dest);
-
-			for (path = bgp_dest_get_bgp_path_info(dest); path;
-			     path = path->next)
-				if (sockunion_same(&path->peer->su, &su))
-					return path;
-		}
-	} else {
-		offset = name + v->namelen;
-		offsetlen = *length - v->namelen;
-		len = offsetlen;
-
-		if (offsetlen == 0)
-			dest = bgp_table_top(bgp->rib[AFI_IP][SAFI_UNICAST]);
-		else {
-			if (len > IN_ADDR_SIZE)
-				len = IN_ADDR_SIZE;
-
-			oid2in_addr(offset, len, &addr->prefix);
+struct bgp_snmp_pathattr {
+	struct snmp_snap_row row;
 
-			offset += IN_ADDR_SIZE;
-			offsetlen -= IN_ADDR_SIZE;
-
-			if (offsetlen > 0)
-				addr->prefixlen = *offset;
-			else
-				addr->prefixlen = len * 8;
-
-			dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST],
-					    (struct prefix *)addr);
+	struct prefix_ipv4 addr;
+	struct in_addr peer;
+	uint8_t origin;
+	struct in_addr nexthop;
+	uint32_t med;
+	uint32_t local_pref;
+	as_t aggregator_as;
+	struct in_addr aggregator_addr;
+	bool best;
+
+	uint8_t *aspath_seg;
+	size_t aspath_seg_len;
+};
 
-			offset++;
-			offsetlen--;
-		}
+static void bgp_snmp_pathattr_build(struct snmp_snap *snap)
+{
+	struct bgp *bgp;
+	struct bgp_dest *dest;
+	struct bgp_path_info *path;
+	struct bgp_snmp_pathattr *row;
+	oid index[BGP_PATHATTR_ENTRY_OFFSET];
+	uint8_t *seg;
 
-		if (offsetlen > 0) {
-			len = offsetlen;
-			if (len > IN_ADDR_SIZE)
-				len = IN_ADDR_SIZE;
+	bgp = bgp_get_default();
+	if (!bgp)
+		return;
 
-			oid2in_addr(offset, len, &paddr);
-		} else
-			paddr.s_addr = INADDR_ANY;
+	for (dest = bgp_table_top(bgp->rib[AFI_IP][SAFI_UNICAST]); dest;
+	     dest = bgp_route_next(dest)) {
+		const struct prefix *rn_p = bgp_dest_get_prefix(dest);
 
-		if (!dest)
-			return NULL;
+		for (path = bgp_dest_get_bgp_path_info(dest); path;
+		     path = path->next) {
+			if (path->peer->su.sin.sin_family != AF_INET)
+				continue;
 
-		do {
-			min = NULL;
-
-			for (path = bgp_dest_get_bgp_path_info(dest); path;
-			     path = path->next) {
-				if (path->peer->su.sin.sin_family == AF_INET
-				    && ntohl(paddr.s_addr)
-					       < ntohl(path->peer->su.sin
-							       .sin_addr
-							       .s_addr)) {
-					if (min) {
-						if (ntohl(path->peer->su.sin
-								  .sin_addr
-								  .s_addr)
-						    < ntohl(min->peer->su.sin
-								    .sin_addr
-								    .s_addr))
-							min = path;
-					} else
-						min = path;
-				}
+			oid_copy_addr(index, &rn_p->u.prefix4, IN_ADDR_SIZE);
+			index[IN_ADDR_SIZE] = rn_p->prefixlen;
+			oid_copy_addr(index + IN_ADDR_SIZE + 1,
+				      &path->peer->su.sin.sin_addr,
+				      IN_ADDR_SIZE);
+
+			row = snmp_snap_add(snap, index, array_size(index));
+			row->addr.family = AF_INET;
+			row->addr.prefix = rn_p->u.prefix4;
+			row->addr.prefixlen = rn_p->prefixlen;
+			row->peer = path->peer->su.sin.sin_addr;
+			row->origin = path->attr->origin;
+			row->nexthop = path->attr->nexthop;
+			row->med = path->attr->med;
+			row->local_pref = path->attr->local_pref;
+			row->aggregator_as = path->attr->aggregator_as;
+			row->aggregator_addr = path->attr->aggregator_addr;
+			row->best = CHECK_FLAG(path->flags, BGP_PATH_SELECTED);
+
+			seg = aspath_snmp_pathseg(path->attr->aspath,
+						  &row->aspath_seg_len);
+			if (row->aspath_seg_len) {
+				row->aspath_seg = XMALLOC(MTYPE_TMP,
+							  row->aspath_seg_len);
+				memcpy(row->aspath_seg, seg,
+				       row->aspath_seg_len);
 			}
+		}
+	}
+}
 
-			if (min) {
-				const struct prefix *rn_p =
-					bgp_dest_get_prefix(dest);
-
-				*length =
-					v->namelen + BGP_PATHATTR_ENTRY_OFFSET;
-
-				offset = name + v->namelen;
-				oid_copy_addr(offset, &rn_p->u.prefix4,
-					      IN_ADDR_SIZE);
-				offset += IN_ADDR_SIZE;
-				*offset = rn_p->prefixlen;
-				offset++;
-				oid_copy_addr(offset,
-					      &min->peer->su.sin.sin_addr,
-					      IN_ADDR_SIZE);
-				addr->prefix = rn_p->u.prefix4;
-				addr->prefixlen = rn_p->prefixlen;
-
-				bgp_dest_unlock_node(dest);
-
-				return min;
-			}
+static void bgp_snmp_pathattr_free(void *arg)
+{
+	struct bgp_snmp_pathattr *row = arg;
 
-			paddr.s_addr = INADDR_ANY;
-		} while ((dest = bgp_route_next(dest)) != NULL);
-	}
-	return NULL;
+	XFREE(MTYPE_TMP, row->aspath_seg);
 }
 
+static struct snmp_snap bgp_snmp_pathattr_snap = {
+	.row_size = sizeof(struct bgp_snmp_pathattr),
+	.max_age = BGP_SNMP_SNAP_AGE,
+	.build = bgp_snmp_pathattr_build,
+	.row_free = bgp_snmp_pathattr_free,
+};
+
 static uint8_t *bgp4PathAttrTable(struct variable *v, oid name[],
 				  size_t *length, int exact, size_t *var_len,
 				  WriteMethod **write_method)
 {
-	struct bgp *bgp;
-	struct bgp_path_info *path;
-	struct prefix_ipv4 addr;
+	const struct bgp_snmp_pathattr *path;
 
-	bgp = bgp_get_default();
-	if (!bgp)
+	if (!bgp_get_default())
 		return NULL;
 
 	if (smux_header_table(v, name, length, exact, var_len, write_method)
 	    == MATCH_FAILED)
 		return NULL;
-	memset(&addr, 0, sizeof(struct prefix_ipv4));
 
-	path = bgp4PathAttrLookup(v, name, length, bgp, &addr, exact);
+	path = snmp_snap_lookup(&bgp_snmp_pathattr_snap, v, name, length,
+				exact);
 	if (!path)
 		return NULL;
 
 	switch (v->magic) {
 	case BGP4PATHATTRPEER: /* 1 */
-		return SNMP_IPADDRESS(path->peer->su.sin.sin_addr);
+		return SNMP_IPADDRESS(path->peer);
 	case BGP4PATHATTRIPADDRPREFIXLEN: /* 2 */
-		return SNMP_INTEGER(addr.prefixlen);
+		return SNMP_INTEGER(path->addr.prefixlen);
 	case BGP4PATHATTRIPADDRPREFIX: /* 3 */
-		return SNMP_IPADDRESS(addr.prefix);
+		return SNMP_IPADDRESS(path->addr.prefix);
 	case BGP4PATHATTRORIGIN: /* 4 */
-		return SNMP_INTEGER(path->attr->origin);
+		return SNMP_INTEGER(path->origin);
 	case BGP4PATHATTRASPATHSEGMENT: /* 5 */
-		return aspath_snmp_pathseg(path->attr->aspath, var_len);
+		*var_len = path->aspath_seg_len;
+		return path->aspath_seg;
 	case BGP4PATHATTRNEXTHOP: /* 6 */
-		return SNMP_IPADDRESS(path->attr->nexthop);
+		return SNMP_IPADDRESS(path->nexthop);
 	case BGP4PATHATTRMULTIEXITDISC: /* 7 */
-		return SNMP_INTEGER(path->attr->med);
+		return SNMP_INTEGER(path->med);
 	case BGP4PATHATTRLOCALPREF: /* 8 */
-		return SNMP_INTEGER(path->attr->local_pref);
+		return SNMP_INTEGER(path->local_pref);
 	case BGP4PATHATTRATOMICAGGREGATE: /* 9 */
 		return SNMP_INTEGER(1);
 	case BGP4PATHATTRAGGREGATORAS: /* 10 */
-		return SNMP_INTEGER(path->attr->aggregator_as);
+		return SNMP_INTEGER(path->aggregator_as);
 	case BGP4PATHATTRAGGREGATORADDR: /* 11 */
-		return SNMP_IPADDRESS(path->attr->aggregator_addr);
+		return SNMP_IPADDRESS(path->aggregator_addr);
 	case BGP4PATHATTRCALCLOCALPREF: /* 12 */
 		return SNMP_INTEGER(-1);
 	case BGP4PATHATTRBEST: /* 13 */
 #define BGP4_PathAttrBest_false 1
 #define BGP4_PathAttrBest_true  2
-		if (CHECK_FLAG(path->flags, BGP_PATH_SELECTED))
+		if (path->best)
 			return SNMP_INTEGER(BGP4_PathAttrBest_true);
 		else
 			return SNMP_INTEGER(BGP4_PathAttrBest_false);
@@ -901,11 +854,18 @@ static int bgp_snmp_init(struct thread_master *tm)
 	return 0;
 }
 
+static int bgp_snmp_fini(void)
+{
+	snmp_snap_reset(&bgp_snmp_pathattr_snap);
+	return 0;
+}
+
 static int bgp_snmp_module_init(void)
 {
 	hook_register(peer_status_changed, bgpTrapEstablished);
 	hook_register(peer_backward_transition, bgpTrapBackwardTransition);
 	hook_register(frr_late_init, bgp_snmp_init);
+	hook_register(frr_fini, bgp_snmp_fini);
 	return 0;
 }
 
@@ -29,6 +29,7 @@
 #include "table.h"
 #include "queue.h"
 #include "linklist.h"
+#include "monotime.h"
 #include "bgpd.h"
 #include "bgp_advertise.h"
 
@@ -84,7 +85,9 @@ struct bgp_node {
 	 */
 	ROUTE_NODE_FIELDS
 
-	struct bgp_adj_out_rb adj_out;
+	/* adj-out entries, sorted by subgroup and addpath ID */
+	struct bgp_adj_out **adj_out;
+	uint32_t adj_out_count;
 
 	struct bgp_adj_in *adj_in;
 
@@ -96,7 +99,7 @@ struct bgp_node {
 
 	mpls_label_t local_label;
 
-	uint8_t flags;
+	uint16_t flags;
 #define BGP_NODE_PROCESS_SCHEDULED	(1 << 0)
 #define BGP_NODE_USER_CLEAR             (1 << 1)
 #define BGP_NODE_LABEL_CHANGED          (1 << 2)
@@ -104,10 +107,17 @@ struct bgp_node {
 #define BGP_NODE_SELECT_DEFER           (1 << 4)
 #define BGP_NODE_FIB_INSTALL_PENDING    (1 << 5)
 #define BGP_NODE_FIB_INSTALLED          (1 << 6)
+#define BGP_NODE_SELECT_PENDING         (1 << 7)
+#define BGP_NODE_FIB_NHG                (1 << 8)
 
 	struct bgp_addpath_node_data tx_addpath;
 
 	enum bgp_path_selection_reason reason;
+
+	/* Receipt of the oldest UPDATE not yet through the pipeline, for the
+	 * convergence statistics.  Cleared once the change is done.
+	 */
+	struct timeval rx_time;
 };
 
 extern void bgp_delete_listnode(struct bgp_dest *dest);
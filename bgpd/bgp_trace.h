@@ -34,6 +34,7 @@
 #include <lttng/tracepoint.h>
 
 #include "bgpd/bgpd.h"
+#include "bgpd/bgp_updgrp.h"
 #include "lib/stream.h"
 
 /* clang-format off */
@@ -122,6 +123,38 @@ TRACEPOINT_EVENT(
 
 TRACEPOINT_LOGLEVEL(frr_bgp, output_filter, TRACE_INFO)
 
+TRACEPOINT_EVENT_CLASS(
+	frr_bgp,
+	process_queue,
+	TP_ARGS(struct bgp *, bgp),
+	TP_FIELDS(
+		ctf_string(bgp, bgp->name_pretty)
+	)
+)
+
+#define PROCESS_QUEUE_TRACEPOINT_INSTANCE(name)                                \
+	TRACEPOINT_EVENT_INSTANCE(                                             \
+		frr_bgp, process_queue, name,                                  \
+		TP_ARGS(struct bgp *, bgp))                                    \
+	TRACEPOINT_LOGLEVEL(frr_bgp, name, TRACE_INFO)
+
+PROCESS_QUEUE_TRACEPOINT_INSTANCE(process_begin)
+PROCESS_QUEUE_TRACEPOINT_INSTANCE(process_end)
+
+TRACEPOINT_EVENT(
+	frr_bgp,
+	update_packet_build,
+	TP_ARGS(struct update_subgroup *, subgrp, int, num_pfx, size_t, len),
+	TP_FIELDS(
+		ctf_integer(uint64_t, update_group, subgrp->update_group->id)
+		ctf_integer(uint64_t, subgroup, subgrp->id)
+		ctf_integer(int, prefixes, num_pfx)
+		ctf_integer(size_t, length, len)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_bgp, update_packet_build, TRACE_INFO)
+
 /* clang-format on */
 
 #include <lttng/tracepoint-event.h>
@@ -43,9 +43,11 @@
 #include "hash.h"
 #include "jhash.h"
 #include "queue.h"
+#include "id_alloc.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
+#include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_fsm.h"
@@ -56,10 +58,22 @@
 #include "bgpd/bgp_filter.h"
 #include "bgpd/bgp_io.h"
 
+DECLARE_DLIST(updgrp_export, struct update_group, export_item);
+
+/* update-groups holding export denials, and the ids handed out to paths */
+static struct updgrp_export_head updgrp_exports = INIT_DLIST(updgrp_exports);
+static struct id_alloc *updgrp_export_ids;
+
 /********************
  * PRIVATE FUNCTIONS
  ********************/
 
+static bool update_group_export_cacheable(struct update_group *updgrp)
+{
+	return CHECK_FLAG(updgrp->conf->af_flags[updgrp->afi][updgrp->safi],
+			  PEER_FLAG_RSERVER_CLIENT);
+}
+
 /**
  * assign a unique ID to update group and subgroup. Mostly for display/
  * debugging purposes. It's a 64-bit space - used leisurely without a
@@ -147,6 +161,7 @@ static void conf_copy(struct peer *dst, struct peer *src, afi_t afi,
 
 	dst->host = XSTRDUP(MTYPE_BGP_PEER_HOST, src->host);
 	dst->cap = src->cap;
+	dst->max_packet_size = src->max_packet_size;
 	dst->af_cap[afi][safi] = src->af_cap[afi][safi];
 	dst->afc_nego[afi][safi] = src->afc_nego[afi][safi];
 	dst->orf_plist[afi][safi] = src->orf_plist[afi][safi];
@@ -613,6 +628,10 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 				   PEER_FLAG_LOCAL_AS_REPLACE_AS)
 				? " replace-as"
 				: "");
+	if (update_group_export_cacheable(updgrp))
+		vty_out(vty,
+			"  Route-server export cache: %u denials, %u hits\n",
+			updgrp->export_denials, updgrp->export_hits);
 
 	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
 		if (ctx->subgrp_id && (ctx->subgrp_id != subgrp->id))
@@ -649,8 +668,27 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 			bpacket_queue_length(SUBGRP_PKTQ(subgrp)));
 		vty_out(vty, "    Total packets enqueued: %u\n",
 			subgroup_total_packets_enqueued(subgrp));
+		if (subgrp->updates_built)
+			vty_out(vty,
+				"    NLRI packing: %" PRIu64
+				" prefixes in %u UPDATEs, %.1f per UPDATE, %.0f%% full\n",
+				subgrp->nlri_packed, subgrp->updates_built,
+				(double)subgrp->nlri_packed
+					/ subgrp->updates_built,
+				100.0 * subgrp->update_bytes
+					/ ((double)subgrp->updates_built
+					   * SUBGRP_PEER(subgrp)
+						     ->max_packet_size));
 		vty_out(vty, "    Packet queue high watermark: %d\n",
 			bpacket_queue_hwm_length(SUBGRP_PKTQ(subgrp)));
+		vty_out(vty,
+			"    Packet queue memory: %zu bytes, high watermark %zu bytes\n",
+			subgrp->pkt_queue.curr_bytes,
+			subgrp->pkt_queue.hwm_bytes);
+		vty_out(vty, "    Packet queue limit reached: %u\n",
+			subgrp->pkt_queue.max_count_reached_count);
+		vty_out(vty, "    Slow peers split out: %u\n",
+			subgrp->slow_peer_splits);
 		vty_out(vty, "    Adj-out list count: %u\n", subgrp->adj_count);
 		vty_out(vty, "    Advertise list: %s\n",
 			advertise_list_is_empty(subgrp) ? "empty"
@@ -752,6 +790,16 @@ static struct update_group *update_group_create(struct peer_af *paf)
 	return updgrp;
 }
 
+static void update_group_export_flush(struct update_group *updgrp)
+{
+	if (!updgrp->export_deny)
+		return;
+
+	updgrp_export_del(&updgrp_exports, updgrp);
+	XFREE(MTYPE_BGP_UPDGRP_EXPORT, updgrp->export_deny);
+	updgrp->export_words = 0;
+}
+
 static void update_group_delete(struct update_group *updgrp)
 {
 	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
@@ -761,6 +809,8 @@ static void update_group_delete(struct update_group *updgrp)
 
 	hash_release(updgrp->bgp->update_groups[updgrp->afid], updgrp);
 	conf_release(updgrp->conf, updgrp->afi, updgrp->safi);
+	bpacket_attr_tmpl_flush(updgrp);
+	update_group_export_flush(updgrp);
 
 	XFREE(MTYPE_BGP_PEER_HOST, updgrp->conf->host);
 
@@ -824,7 +874,9 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 		UPDGRP_INCR_STAT(subgrp->update_group, subgrps_deleted);
 
 	THREAD_OFF(subgrp->t_merge_check);
+	THREAD_OFF(subgrp->t_slow_split);
 	THREAD_OFF(subgrp->t_coalesce);
+	THREAD_OFF(subgrp->t_policy_refresh);
 
 	bpacket_queue_cleanup(SUBGRP_PKTQ(subgrp));
 	subgroup_clear_table(subgrp);
@@ -1183,6 +1235,90 @@ bool update_subgroup_trigger_merge_check(struct update_subgroup *subgrp,
 	return true;
 }
 
+/*
+ * update_subgroup_slow_split_thread_cb
+ *
+ * Packets stay in the queue of a subgroup until every peer has sent them,
+ * so with the queue full, peers that lag behind hold up the others.  If
+ * some peers are waiting for a new packet, the ones still on the oldest
+ * packet get subgroups of their own.  Their packets are then bounded by
+ * the limits of the new subgroups, and an outbound refresh brings them
+ * the advertisements that were not in packets yet.  Once they caught up
+ * they merge back.
+ */
+static int update_subgroup_slow_split_thread_cb(struct thread *thread)
+{
+	struct update_subgroup *subgrp;
+	struct bpacket_queue *q;
+	struct bpacket *head;
+	struct peer_af *paf, **slow;
+	int nslow = 0, i;
+	bool waiting = false;
+
+	subgrp = THREAD_ARG(thread);
+	subgrp->t_slow_split = NULL;
+
+	q = SUBGRP_PKTQ(subgrp);
+	if (subgrp->peer_count < 2
+	    || !bpacket_queue_is_full(SUBGRP_INST(subgrp), q))
+		return 0;
+
+	head = bpacket_queue_first(q);
+	slow = XCALLOC(MTYPE_TMP, subgrp->peer_count * sizeof(*slow));
+	SUBGRP_FOREACH_PEER (subgrp, paf) {
+		if (paf->next_pkt_to_send == head)
+			slow[nslow++] = paf;
+		else if (!paf->next_pkt_to_send
+			 || !paf->next_pkt_to_send->buffer)
+			waiting = true;
+	}
+
+	/* Nobody is held up, or everybody is as slow.  Otherwise split;
+	 * that can merge or delete subgrp, so don't look at it anymore.
+	 */
+	if (!waiting || nslow == subgrp->peer_count)
+		nslow = 0;
+
+	for (i = 0; i < nslow; i++) {
+		paf = slow[i];
+		if (!paf->subgroup || paf->subgroup->peer_count < 2)
+			continue;
+
+		if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
+			zlog_debug("u%" PRIu64 ":s%" PRIu64
+				   " packet queue full, splitting out slow peer %s",
+				   paf->subgroup->update_group->id,
+				   paf->subgroup->id, paf->peer->host);
+
+		SUBGRP_INCR_STAT(paf->subgroup, slow_peer_splits);
+		update_subgroup_split_peer(paf, NULL);
+		subgroup_policy_refresh(paf->subgroup);
+	}
+
+	XFREE(MTYPE_TMP, slow);
+	return 0;
+}
+
+/*
+ * update_subgroup_trigger_slow_split
+ *
+ * The packet queue of the subgroup is full, check for slow peers on a
+ * clean context.
+ */
+void update_subgroup_trigger_slow_split(struct update_subgroup *subgrp)
+{
+	if (subgrp->t_slow_split)
+		return;
+
+	subgrp->pkt_queue.max_count_reached_count++;
+
+	if (subgrp->peer_count < 2)
+		return;
+
+	thread_add_timer_msec(bm->master, update_subgroup_slow_split_thread_cb,
+			      subgrp, 0, &subgrp->t_slow_split);
+}
+
 /*
  * update_subgroup_copy_adj_out
  *
@@ -1387,14 +1523,6 @@ static int updgrp_policy_update_walkcb(struct update_group *updgrp, void *arg)
 	}
 
 	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
-		if (changed) {
-			if (bgp_debug_update(NULL, NULL, updgrp, 0))
-				zlog_debug(
-					"u%" PRIu64 ":s%" PRIu64" announcing routes upon policy %s (type %d) change",
-					updgrp->id, subgrp->id,
-					ctx->policy_name, ctx->policy_type);
-			subgroup_announce_route(subgrp);
-		}
 		if (def_changed) {
 			if (bgp_debug_update(NULL, NULL, updgrp, 0))
 				zlog_debug(
@@ -1403,7 +1531,16 @@ static int updgrp_policy_update_walkcb(struct update_group *updgrp, void *arg)
 					ctx->policy_name);
 			subgroup_default_originate(subgrp, 0);
 		}
-		update_subgroup_set_needs_refresh(subgrp, 0);
+		if (changed) {
+			if (bgp_debug_update(NULL, NULL, updgrp, 0))
+				zlog_debug(
+					"u%" PRIu64 ":s%" PRIu64" announcing changed routes upon policy %s (type %d) change",
+					updgrp->id, subgrp->id,
+					ctx->policy_name, ctx->policy_type);
+			/* clears the needs-refresh bit once done */
+			subgroup_policy_refresh(subgrp);
+		} else
+			update_subgroup_set_needs_refresh(subgrp, 0);
 	}
 	return UPDWALK_CONTINUE;
 }
@@ -1452,6 +1589,14 @@ void update_group_policy_update(struct bgp *bgp, bgp_policy_type_e ptype,
 				int start_event)
 {
 	struct updwalk_context ctx;
+	struct update_group *updgrp;
+
+	/* Policies may reference each other, so don't bother to work out
+	 * which groups the change affects.
+	 */
+	frr_each_safe (updgrp_export, &updgrp_exports, updgrp)
+		if (updgrp->bgp == bgp)
+			update_group_export_flush(updgrp);
 
 	memset(&ctx, 0, sizeof(ctx));
 	ctx.policy_type = ptype;
@@ -1619,6 +1764,105 @@ void update_group_show_stats(struct bgp *bgp, struct vty *vty)
 		bgp->update_group_stats.peer_refreshes_combined);
 	vty_out(vty, "Merge checks triggered: %u\n",
 		bgp->update_group_stats.merge_checks_triggered);
+	vty_out(vty, "Slow peers split out: %u\n",
+		bgp->update_group_stats.slow_peer_splits);
+	vty_out(vty, "Attribute template hits: %u\n",
+		bgp->update_group_stats.attr_tmpl_hits);
+	vty_out(vty, "Attribute template misses: %u\n",
+		bgp->update_group_stats.attr_tmpl_misses);
+	vty_out(vty, "Export policy denials cached: %u\n",
+		bgp->update_group_stats.export_denials);
+	vty_out(vty, "Export policy cache hits: %u\n",
+		bgp->update_group_stats.export_hits);
+}
+
+/*
+ * Was the path denied by the export policy of a route-server client
+ * update-group before?
+ */
+bool update_group_export_denied(struct update_group *updgrp,
+				struct bgp_path_info *pi)
+{
+	uint32_t id = pi->export_id;
+
+	if (!id || !updgrp->export_deny)
+		return false;
+
+	/* The bits were set for attributes the path no longer has */
+	if (pi->export_attr != pi->attr) {
+		bgp_path_export_reset(pi);
+		return false;
+	}
+
+	if (id / 32 >= updgrp->export_words
+	    || !(updgrp->export_deny[id / 32] & (1U << (id % 32))))
+		return false;
+
+	UPDGRP_INCR_STAT(updgrp, export_hits);
+	return true;
+}
+
+/*
+ * Remember that the export policy of a route-server client update-group
+ * denied the path, handing the path an export id on first use.
+ */
+void update_group_export_deny(struct update_group *updgrp,
+			      struct bgp_path_info *pi)
+{
+	uint32_t id, words;
+
+	if (!update_group_export_cacheable(updgrp))
+		return;
+
+	if (pi->export_id && pi->export_attr != pi->attr)
+		bgp_path_export_reset(pi);
+
+	if (!pi->export_id) {
+		if (!updgrp_export_ids)
+			updgrp_export_ids = idalloc_new("BGP export policy cache");
+		id = idalloc_allocate(updgrp_export_ids);
+		if (id == IDALLOC_INVALID)
+			return;
+		pi->export_id = id;
+		pi->export_attr = bgp_attr_intern(pi->attr);
+	}
+
+	id = pi->export_id;
+	if (id / 32 >= updgrp->export_words) {
+		words = MAX(updgrp->export_words * 2, id / 32 + 1);
+		if (!updgrp->export_deny)
+			updgrp_export_add_tail(&updgrp_exports, updgrp);
+		updgrp->export_deny = XREALLOC(MTYPE_BGP_UPDGRP_EXPORT,
+					       updgrp->export_deny,
+					       words * sizeof(uint32_t));
+		memset(updgrp->export_deny + updgrp->export_words, 0,
+		       (words - updgrp->export_words) * sizeof(uint32_t));
+		updgrp->export_words = words;
+	}
+
+	updgrp->export_deny[id / 32] |= 1U << (id % 32);
+	UPDGRP_INCR_STAT(updgrp, export_denials);
+}
+
+/*
+ * Forget all export verdicts on the path, when its attributes change or it
+ * is freed, and release its export id.
+ */
+void bgp_path_export_reset(struct bgp_path_info *pi)
+{
+	struct update_group *updgrp;
+	uint32_t id = pi->export_id;
+
+	if (!id)
+		return;
+
+	frr_each (updgrp_export, &updgrp_exports, updgrp)
+		if (id / 32 < updgrp->export_words)
+			updgrp->export_deny[id / 32] &= ~(1U << (id % 32));
+
+	idalloc_free(updgrp_export_ids, id);
+	pi->export_id = 0;
+	bgp_attr_unintern(&pi->export_attr);
 }
 
 /*
@@ -67,7 +67,9 @@
 	 | PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE                             \
 	 | PEER_FLAG_AS_OVERRIDE)
 
-#define PEER_UPDGRP_CAP_FLAGS (PEER_CAP_AS4_RCV)
+#define PEER_UPDGRP_CAP_FLAGS                                                  \
+	(PEER_CAP_AS4_RCV | PEER_CAP_EXTENDED_MESSAGE_ADV                      \
+	 | PEER_CAP_EXTENDED_MESSAGE_RCV)
 
 #define PEER_UPDGRP_AF_CAP_FLAGS                                               \
 	(PEER_CAP_ORF_PREFIX_SM_RCV | PEER_CAP_ORF_PREFIX_SM_OLD_RCV           \
@@ -106,6 +108,41 @@ struct bpacket {
 	unsigned int ver;
 };
 
+/*
+ * Path attributes as encoded for an UPDATE by one subgroup, kept on the
+ * update-group so its other subgroups can copy them instead of encoding the
+ * same attributes again.  Peers of an update-group agree on everything the
+ * encoding depends on, except for the peer the path was received from,
+ * which is part of the key, and some settings of the BGP instance, which
+ * flush all templates when they change.
+ */
+#define BPACKET_ATTR_TMPL_MAX 4096
+
+struct bpacket_attr_tmpl {
+	/* key; attr is interned and holds a reference */
+	struct attr *attr;
+	struct in_addr from_id;
+	uint8_t from_sort;
+	bool from;
+	bool from_enhe;
+
+	/* vector offsets are relative to the start of data */
+	bpacket_attr_vec_arr vecarr;
+	bgp_size_t len;
+	uint8_t data[];
+};
+
+/* What else templates depend on, see bgp_packet_attribute(). */
+struct bpacket_attr_tmpl_env {
+	struct in_addr router_id;
+	struct in_addr cluster_id;
+	as_t confed_id;
+	as_t local_as;
+	uint32_t maxmed_value;
+	uint16_t config;
+	uint8_t maxmed_active;
+};
+
 struct bpacket_queue {
 	TAILQ_HEAD(pkt_queue, bpacket) pkts;
 
@@ -119,8 +156,24 @@ struct bpacket_queue {
 	unsigned int curr_count;
 	unsigned int hwm_count;
 	unsigned int max_count_reached_count;
+
+	/* memory held by the packets */
+	size_t curr_bytes;
+	size_t hwm_bytes;
 };
 
+/*
+ * Export policy verdicts of a route-server client update-group.  Clients
+ * share the one Loc-RIB, so the policy of the group is all that differs
+ * between them; a path its outbound filters or route-map denied is marked
+ * in a bitmap indexed by the path's export id.  Later walks of the table for
+ * the group, e.g. a client joining or asking for a refresh, skip those paths
+ * without evaluating the policy again.  Bits are set lazily, the first time
+ * the policy denies a path, and are dropped when the path's attributes
+ * change, the path goes away or any policy of the instance changes.
+ */
+PREDECL_DLIST(updgrp_export);
+
 struct update_group {
 	/* back pointer to the BGP instance */
 	struct bgp *bgp;
@@ -147,11 +200,27 @@ struct update_group {
 	uint32_t adj_count;
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
+	uint32_t slow_peer_splits;
 
 	uint32_t subgrps_created;
 	uint32_t subgrps_deleted;
 
+	uint32_t attr_tmpl_hits;
+	uint32_t attr_tmpl_misses;
+
+	uint32_t export_hits;
+	uint32_t export_denials;
+
 	uint32_t num_dbg_en_peers;
+
+	/* encoded attributes, only kept with more than one subgroup */
+	struct hash *attr_tmpls;
+	struct bpacket_attr_tmpl_env attr_tmpl_env;
+
+	/* denied export ids, only kept for route-server client groups */
+	struct updgrp_export_item export_item;
+	uint32_t *export_deny;
+	uint32_t export_words;
 };
 
 /*
@@ -218,6 +287,17 @@ struct update_subgroup {
 
 	struct thread *t_merge_check;
 
+	/* Split out slow peers, see update_subgroup_trigger_slow_split() */
+	struct thread *t_slow_split;
+
+	/* Outbound policy refresh, see subgroup_policy_refresh() */
+	struct thread *t_policy_refresh;
+	struct prefix policy_refresh_rd;
+	struct prefix policy_refresh_pos;
+	bool policy_refresh_has_rd;
+	bool policy_refresh_has_pos;
+	uint8_t policy_refresh_waits;
+
 	/* table version that the subgroup has caught up to. */
 	uint64_t version;
 
@@ -248,6 +328,12 @@ struct update_subgroup {
 	uint32_t adj_count;
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
+	uint32_t slow_peer_splits;
+
+	/* UPDATEs built with NLRI, and the prefixes and bytes they carry */
+	uint32_t updates_built;
+	uint64_t nlri_packed;
+	uint64_t update_bytes;
 
 	uint64_t id;
 
@@ -263,6 +349,13 @@ struct update_subgroup {
  */
 #define SUBGRP_FLAG_NEEDS_REFRESH         (1 << 0)
 
+/*
+ * An outbound policy refresh waits this long for the process queue to drain,
+ * up to this many times in a row, before it runs a slice anyway.
+ */
+#define SUBGRP_POLICY_REFRESH_WAIT_MSEC 100
+#define SUBGRP_POLICY_REFRESH_WAITS 10
+
 #define SUBGRP_STATUS_DEFAULT_ORIGINATE   (1 << 0)
 
 /*
@@ -306,6 +399,10 @@ struct updwalk_context {
 
 #define UPDWALK_FLAGS_ADVQUEUE   (1 << 0)
 #define UPDWALK_FLAGS_ADVERTISED (1 << 1)
+/* addpath subgroups only get the paths that changed, and old_pi */
+#define UPDWALK_FLAGS_CHANGED_ONLY (1 << 2)
+
+	struct bgp_path_info *old_pi;
 };
 
 #define UPDWALK_CONTINUE HASHWALK_CONTINUE
@@ -374,6 +471,7 @@ extern void update_subgroup_remove_peer(struct update_subgroup *,
 extern struct bgp_table *update_subgroup_rib(struct update_subgroup *);
 extern void update_subgroup_split_peer(struct peer_af *, struct update_group *);
 extern bool update_subgroup_check_merge(struct update_subgroup *, const char *);
+extern void update_subgroup_trigger_slow_split(struct update_subgroup *subgrp);
 extern bool update_subgroup_trigger_merge_check(struct update_subgroup *,
 						int force);
 extern void update_group_policy_update(struct bgp *bgp, bgp_policy_type_e ptype,
@@ -389,6 +487,11 @@ extern void update_group_start_advtimer(struct bgp *bgp);
 
 extern void update_subgroup_inherit_info(struct update_subgroup *to,
 					 struct update_subgroup *from);
+extern bool update_group_export_denied(struct update_group *updgrp,
+				       struct bgp_path_info *pi);
+extern void update_group_export_deny(struct update_group *updgrp,
+				     struct bgp_path_info *pi);
+extern void bgp_path_export_reset(struct bgp_path_info *pi);
 
 /* bgp_updgrp_packet.c */
 extern struct bpacket *bpacket_alloc(void);
@@ -413,6 +516,7 @@ extern void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty);
 bool subgroup_packets_to_build(struct update_subgroup *subgrp);
 extern struct bpacket *subgroup_update_packet(struct update_subgroup *s);
 extern struct bpacket *subgroup_withdraw_packet(struct update_subgroup *s);
+extern void bpacket_attr_tmpl_flush(struct update_group *updgrp);
 extern struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 						struct peer_af *paf);
 extern void bpacket_attr_vec_arr_reset(struct bpacket_attr_vec_arr *vecarr);
@@ -437,6 +541,7 @@ extern void update_group_show_packet_queue(struct bgp *bgp, afi_t afi,
 					   safi_t safi, struct vty *vty,
 					   uint64_t id);
 extern void subgroup_announce_route(struct update_subgroup *subgrp);
+extern void subgroup_policy_refresh(struct update_subgroup *subgrp);
 extern void subgroup_announce_all(struct update_subgroup *subgrp);
 
 extern void subgroup_default_originate(struct update_subgroup *subgrp,
@@ -444,6 +549,10 @@ extern void subgroup_default_originate(struct update_subgroup *subgrp,
 extern void group_announce_route(struct bgp *bgp, afi_t afi, safi_t safi,
 				 struct bgp_dest *dest,
 				 struct bgp_path_info *pi);
+extern void group_announce_route_changed(struct bgp *bgp, afi_t afi,
+					 safi_t safi, struct bgp_dest *dest,
+					 struct bgp_path_info *pi,
+					 struct bgp_path_info *old_pi);
 extern void subgroup_clear_table(struct update_subgroup *subgrp);
 extern void update_group_announce(struct bgp *bgp);
 extern void update_group_announce_rrclients(struct bgp *bgp);
@@ -36,6 +36,7 @@
 #include "queue.h"
 #include "routemap.h"
 #include "filter.h"
+#include "workqueue.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -44,6 +45,9 @@
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
@@ -55,53 +59,37 @@
 /********************
  * PRIVATE FUNCTIONS
  ********************/
-static int bgp_adj_out_compare(const struct bgp_adj_out *o1,
-			       const struct bgp_adj_out *o2)
-{
-	if (o1->subgroup < o2->subgroup)
-		return -1;
-
-	if (o1->subgroup > o2->subgroup)
-		return 1;
-
-	if (o1->addpath_tx_id < o2->addpath_tx_id)
-		return -1;
-
-	if (o1->addpath_tx_id > o2->addpath_tx_id)
-		return 1;
-
-	return 0;
-}
-RB_GENERATE(bgp_adj_out_rb, bgp_adj_out, adj_entry, bgp_adj_out_compare);
-
 static inline struct bgp_adj_out *adj_lookup(struct bgp_dest *dest,
 					     struct update_subgroup *subgrp,
 					     uint32_t addpath_tx_id)
 {
-	struct bgp_adj_out lookup;
-
 	if (!dest || !subgrp)
 		return NULL;
 
 	/* update-groups that do not support addpath will pass 0 for
 	 * addpath_tx_id. */
-	lookup.subgroup = subgrp;
-	lookup.addpath_tx_id = addpath_tx_id;
+	return bgp_adj_out_find(dest, subgrp, addpath_tx_id);
+}
+
+static void adj_mem_account(struct update_subgroup *subgrp, int delta)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
 
-	return RB_FIND(bgp_adj_out_rb, &dest->adj_out, &lookup);
+	bgp->mem_stats[SUBGRP_AFI(subgrp)][SUBGRP_SAFI(subgrp)].adj_out += delta;
 }
 
 static void adj_free(struct bgp_adj_out *adj)
 {
 	TAILQ_REMOVE(&(adj->subgroup->adjq), adj, subgrp_adj_train);
 	SUBGRP_DECR_STAT(adj->subgroup, adj_count);
+	adj_mem_account(adj->subgroup, -1);
 	XFREE(MTYPE_BGP_ADJ_OUT, adj);
 }
 
 static void subgrp_withdraw_stale_addpath(struct updwalk_context *ctx,
 					  struct update_subgroup *subgrp)
 {
-	struct bgp_adj_out *adj, *adj_next;
+	struct bgp_adj_out *adj;
 	uint32_t id;
 	struct bgp_path_info *pi;
 	afi_t afi = SUBGRP_AFI(subgrp);
@@ -110,7 +98,7 @@ static void subgrp_withdraw_stale_addpath(struct updwalk_context *ctx,
 
 	/* Look through all of the paths we have advertised for this rn and send
 	 * a withdraw for the ones that are no longer present */
-	RB_FOREACH_SAFE (adj, bgp_adj_out_rb, &ctx->dest->adj_out, adj_next) {
+	BGP_ADJ_OUT_FOREACH_SAFE (ctx->dest, adj) {
 
 		if (adj->subgroup == subgrp) {
 			for (pi = bgp_dest_get_bgp_path_info(ctx->dest); pi;
@@ -140,7 +128,7 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 	afi_t afi;
 	safi_t safi;
 	struct peer *peer;
-	struct bgp_adj_out *adj, *adj_next;
+	struct bgp_adj_out *adj;
 	int addpath_capable;
 
 	afi = UPDGRP_AFI(updgrp);
@@ -171,6 +159,16 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 					if (pi == ctx->pi)
 						continue;
 
+					/* Nothing new to say about this one */
+					if (CHECK_FLAG(ctx->flags,
+						       UPDWALK_FLAGS_CHANGED_ONLY)
+					    && pi != ctx->old_pi
+					    && !bgp_addpath_path_changed(
+						    pi,
+						    peer->addpath_type[afi]
+								      [safi]))
+						continue;
+
 					subgroup_process_announce_selected(
 						subgrp, pi, ctx->dest,
 						bgp_addpath_id_for_peer(
@@ -202,9 +200,8 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 					/* Find the addpath_tx_id of the path we
 					 * had advertised and
 					 * send a withdraw */
-					RB_FOREACH_SAFE (adj, bgp_adj_out_rb,
-							 &ctx->dest->adj_out,
-							 adj_next) {
+					BGP_ADJ_OUT_FOREACH_SAFE (ctx->dest,
+								  adj) {
 						if (adj->subgroup == subgrp) {
 							subgroup_process_announce_selected(
 								subgrp, NULL,
@@ -215,9 +212,6 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 				}
 			}
 		}
-
-		/* Notify BGP Conditional advertisement */
-		bgp_notify_conditional_adv_scanner(subgrp);
 	}
 
 	return UPDWALK_CONTINUE;
@@ -245,7 +239,7 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 
-		RB_FOREACH (adj, bgp_adj_out_rb, &dest->adj_out)
+		BGP_ADJ_OUT_FOREACH (dest, adj)
 			if (adj->subgroup == subgrp) {
 				if (header1) {
 					vty_out(vty,
@@ -403,13 +397,14 @@ struct bgp_adj_out *bgp_adj_out_alloc(struct update_subgroup *subgrp,
 	adj->addpath_tx_id = addpath_tx_id;
 
 	if (dest) {
-		RB_INSERT(bgp_adj_out_rb, &dest->adj_out, adj);
+		bgp_adj_out_link(dest, adj);
 		bgp_dest_lock_node(dest);
 		adj->dest = dest;
 	}
 
 	TAILQ_INSERT_TAIL(&(subgrp->adjq), adj, subgrp_adj_train);
 	SUBGRP_INCR_STAT(subgrp, adj_count);
+	adj_mem_account(subgrp, 1);
 	return adj;
 }
 
@@ -583,7 +578,7 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest,
 				subgroup_trigger_write(subgrp);
 		} else {
 			/* Remove myself from adjacency. */
-			RB_REMOVE(bgp_adj_out_rb, &dest->adj_out, adj);
+			bgp_adj_out_unlink(dest, adj);
 
 			/* Free allocated information.  */
 			adj_free(adj);
@@ -604,7 +599,7 @@ void bgp_adj_out_remove_subgroup(struct bgp_dest *dest, struct bgp_adj_out *adj,
 	if (adj->adv)
 		bgp_advertise_clean_subgroup(subgrp, adj);
 
-	RB_REMOVE(bgp_adj_out_rb, &dest->adj_out, adj);
+	bgp_adj_out_unlink(dest, adj);
 	adj_free(adj);
 }
 
@@ -626,10 +621,54 @@ void subgroup_clear_table(struct update_subgroup *subgrp)
 /*
  * subgroup_announce_table
  */
-void subgroup_announce_table(struct update_subgroup *subgrp,
-			     struct bgp_table *table)
+/*
+ * Would advertising attr change what was last sent for this adj-out?  The
+ * attributes subgroup_announce_check() builds aren't interned, so the parts
+ * a policy may have rebuilt are compared by value.
+ */
+static bool subgroup_adj_out_same(struct bgp_dest *dest,
+				  struct update_subgroup *subgrp,
+				  struct attr *attr, struct bgp_path_info *path)
+{
+	struct bgp_adj_out *adj;
+	struct attr cmp;
+	struct peer *peer = SUBGRP_PEER(subgrp);
+
+	adj = adj_lookup(dest, subgrp,
+			 bgp_addpath_id_for_peer(peer, SUBGRP_AFI(subgrp),
+						 SUBGRP_SAFI(subgrp),
+						 &path->tx_addpath));
+	if (!adj || adj->adv || !adj->attr)
+		return false;
+
+	cmp = *attr;
+	if (cmp.aspath && adj->attr->aspath && cmp.aspath != adj->attr->aspath
+	    && aspath_cmp(cmp.aspath, adj->attr->aspath))
+		cmp.aspath = adj->attr->aspath;
+	if (cmp.community && adj->attr->community
+	    && cmp.community != adj->attr->community
+	    && community_cmp(cmp.community, adj->attr->community))
+		cmp.community = adj->attr->community;
+	if (cmp.ecommunity && adj->attr->ecommunity
+	    && cmp.ecommunity != adj->attr->ecommunity
+	    && ecommunity_cmp(cmp.ecommunity, adj->attr->ecommunity))
+		cmp.ecommunity = adj->attr->ecommunity;
+	if (cmp.lcommunity && adj->attr->lcommunity
+	    && cmp.lcommunity != adj->attr->lcommunity
+	    && lcommunity_cmp(cmp.lcommunity, adj->attr->lcommunity))
+		cmp.lcommunity = adj->attr->lcommunity;
+
+	return attrhash_cmp(&cmp, adj->attr);
+}
+
+/*
+ * Bring the adj-out of one dest in line with the current policy.  With
+ * only_changed, prefixes that would go out with the attributes already sent
+ * are left alone.
+ */
+static void subgroup_announce_dest(struct update_subgroup *subgrp,
+				   struct bgp_dest *dest, bool only_changed)
 {
-	struct bgp_dest *dest;
 	struct bgp_path_info *ri;
 	struct attr attr;
 	struct peer *peer;
@@ -638,6 +677,7 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	int addpath_capable;
 	struct bgp *bgp;
 	bool advertise;
+	const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -648,58 +688,52 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	if (safi == SAFI_LABELED_UNICAST)
 		safi = SAFI_UNICAST;
 
-	if (!table)
-		table = peer->bgp->rib[afi][safi];
-
-	if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP && safi != SAFI_EVPN
-	    && CHECK_FLAG(peer->af_flags[afi][safi],
-			  PEER_FLAG_DEFAULT_ORIGINATE))
-		subgroup_default_originate(subgrp, 0);
+	/* Check if the route can be advertised */
+	advertise = bgp_check_advertise(bgp, dest);
+
+	for (ri = bgp_dest_get_bgp_path_info(dest); ri; ri = ri->next)
+
+		if (CHECK_FLAG(ri->flags, BGP_PATH_SELECTED)
+		    || (addpath_capable
+			&& bgp_addpath_tx_path(peer->addpath_type[afi][safi],
+					       ri))) {
+			if (subgroup_announce_check(dest, ri, subgrp, dest_p,
+						    &attr, false)) {
+				if (only_changed
+				    && subgroup_adj_out_same(dest, subgrp,
+							     &attr, ri)) {
+					bgp_attr_flush(&attr);
+					continue;
+				}
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
+				/* Check if route can be advertised */
+				if (advertise)
+					bgp_adj_out_set_subgroup(dest, subgrp,
+								 &attr, ri);
+			} else {
+				/* If default originate is enabled for
+				 * the peer, do not send explicit
+				 * withdraw. This will prevent deletion
+				 * of default route advertised through
+				 * default originate
+				 */
+				if (CHECK_FLAG(peer->af_flags[afi][safi],
+					       PEER_FLAG_DEFAULT_ORIGINATE)
+				    && is_default_prefix(dest_p))
+					break;
 
-		/* Check if the route can be advertised */
-		advertise = bgp_check_advertise(bgp, dest);
-
-		for (ri = bgp_dest_get_bgp_path_info(dest); ri; ri = ri->next)
-
-			if (CHECK_FLAG(ri->flags, BGP_PATH_SELECTED)
-			    || (addpath_capable
-				&& bgp_addpath_tx_path(
-					   peer->addpath_type[afi][safi],
-					   ri))) {
-				if (subgroup_announce_check(dest, ri, subgrp,
-							    dest_p, &attr,
-							    false)) {
-					/* Check if route can be advertised */
-					if (advertise)
-						bgp_adj_out_set_subgroup(dest,
-									 subgrp,
-									 &attr,
-									 ri);
-				} else {
-					/* If default originate is enabled for
-					 * the peer, do not send explicit
-					 * withdraw. This will prevent deletion
-					 * of default route advertised through
-					 * default originate
-					 */
-					if (CHECK_FLAG(
-						    peer->af_flags[afi][safi],
-						    PEER_FLAG_DEFAULT_ORIGINATE)
-					    && is_default_prefix(bgp_dest_get_prefix(dest)))
-						break;
-
-					bgp_adj_out_unset_subgroup(
-						dest, subgrp, 1,
-						bgp_addpath_id_for_peer(
-							peer, afi, safi,
-							&ri->tx_addpath));
-				}
+				bgp_adj_out_unset_subgroup(
+					dest, subgrp, 1,
+					bgp_addpath_id_for_peer(
+						peer, afi, safi,
+						&ri->tx_addpath));
 			}
-	}
+		}
+}
 
+static void subgroup_announce_table_done(struct update_subgroup *subgrp,
+					 struct bgp_table *table)
+{
 	/*
 	 * We walked through the whole table -- make sure our version number
 	 * is consistent with the one on the table. This should allow
@@ -716,6 +750,64 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	update_subgroup_trigger_merge_check(subgrp, 0);
 }
 
+static void subgroup_announce_default(struct update_subgroup *subgrp)
+{
+	struct peer *peer = SUBGRP_PEER(subgrp);
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP && safi != SAFI_EVPN
+	    && CHECK_FLAG(peer->af_flags[afi][safi],
+			  PEER_FLAG_DEFAULT_ORIGINATE))
+		subgroup_default_originate(subgrp, 0);
+}
+
+/* Labeled-unicast is announced from the unicast table */
+static struct bgp_table *subgroup_announce_rib(struct update_subgroup *subgrp)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	return bgp->rib[SUBGRP_AFI(subgrp)][safi];
+}
+
+void subgroup_announce_table(struct update_subgroup *subgrp,
+			     struct bgp_table *table)
+{
+	struct bgp_dest *dest;
+
+	if (!table)
+		table = subgroup_announce_rib(subgrp);
+
+	subgroup_announce_default(subgrp);
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		subgroup_announce_dest(subgrp, dest, false);
+
+	subgroup_announce_table_done(subgrp, table);
+}
+
+/*
+ * First update is deferred until ORF or ROUTE-REFRESH is received
+ */
+static bool subgroup_announce_deferred(struct update_subgroup *subgrp)
+{
+	struct peer *onlypeer;
+
+	onlypeer = ((SUBGRP_PCOUNT(subgrp) == 1) ? (SUBGRP_PFIRST(subgrp))->peer
+						 : NULL);
+	return onlypeer
+	       && CHECK_FLAG(onlypeer->af_sflags[SUBGRP_AFI(subgrp)]
+						[SUBGRP_SAFI(subgrp)],
+			     PEER_STATUS_ORF_WAIT_REFRESH);
+}
+
 /*
  * subgroup_announce_route
  *
@@ -725,20 +817,15 @@ void subgroup_announce_route(struct update_subgroup *subgrp)
 {
 	struct bgp_dest *dest;
 	struct bgp_table *table;
-	struct peer *onlypeer;
+
+	/* a full refresh covers whatever a policy refresh had left to do */
+	THREAD_OFF(subgrp->t_policy_refresh);
 
 	if (update_subgroup_needs_refresh(subgrp)) {
 		update_subgroup_set_needs_refresh(subgrp, 0);
 	}
 
-	/*
-	 * First update is deferred until ORF or ROUTE-REFRESH is received
-	 */
-	onlypeer = ((SUBGRP_PCOUNT(subgrp) == 1) ? (SUBGRP_PFIRST(subgrp))->peer
-						 : NULL);
-	if (onlypeer && CHECK_FLAG(onlypeer->af_sflags[SUBGRP_AFI(subgrp)]
-						      [SUBGRP_SAFI(subgrp)],
-				   PEER_STATUS_ORF_WAIT_REFRESH))
+	if (subgroup_announce_deferred(subgrp))
 		return;
 
 	if (SUBGRP_SAFI(subgrp) != SAFI_MPLS_VPN
@@ -755,6 +842,139 @@ void subgroup_announce_route(struct update_subgroup *subgrp)
 		}
 }
 
+/*
+ * Re-evaluate table for an outbound policy change, carrying on after the
+ * last prefix handled.  Returns false if it gave way to other work before
+ * reaching the end.
+ */
+static bool subgroup_policy_refresh_table(struct update_subgroup *subgrp,
+					  struct bgp_table *table,
+					  struct thread *thread)
+{
+	struct bgp_dest *dest;
+
+	if (subgrp->policy_refresh_has_pos)
+		dest = bgp_table_get_next(table, &subgrp->policy_refresh_pos);
+	else
+		dest = bgp_table_top(table);
+
+	for (; dest; dest = bgp_route_next(dest)) {
+		subgroup_announce_dest(subgrp, dest, true);
+
+		if (thread_should_yield(thread)) {
+			prefix_copy(&subgrp->policy_refresh_pos,
+				    bgp_dest_get_prefix(dest));
+			subgrp->policy_refresh_has_pos = true;
+			bgp_dest_unlock_node(dest);
+			return false;
+		}
+	}
+
+	subgrp->policy_refresh_has_pos = false;
+	subgroup_announce_table_done(subgrp, table);
+	return true;
+}
+
+static int subgroup_policy_refresh_run(struct thread *thread)
+{
+	struct update_subgroup *subgrp = THREAD_ARG(thread);
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+	struct bgp_table *rib = subgroup_announce_rib(subgrp);
+	struct bgp_table *table;
+	struct bgp_dest *dest;
+
+	/*
+	 * Inbound changes come first; they get announced through the
+	 * regular path anyway.  Don't wait for them forever though.
+	 */
+	if (bgp->process_queue && !work_queue_empty(bgp->process_queue)
+	    && subgrp->policy_refresh_waits < SUBGRP_POLICY_REFRESH_WAITS) {
+		subgrp->policy_refresh_waits++;
+		thread_add_timer_msec(bm->master, subgroup_policy_refresh_run,
+				      subgrp, SUBGRP_POLICY_REFRESH_WAIT_MSEC,
+				      &subgrp->t_policy_refresh);
+		return 0;
+	}
+	subgrp->policy_refresh_waits = 0;
+
+	if (SUBGRP_SAFI(subgrp) != SAFI_MPLS_VPN
+	    && SUBGRP_SAFI(subgrp) != SAFI_ENCAP
+	    && SUBGRP_SAFI(subgrp) != SAFI_EVPN) {
+		if (!subgroup_policy_refresh_table(subgrp, rib, thread))
+			goto yield;
+	} else {
+		/* carry on in the RD table we were in, if still there */
+		dest = NULL;
+		if (subgrp->policy_refresh_has_rd)
+			dest = bgp_node_lookup(rib, &subgrp->policy_refresh_rd);
+		if (!dest) {
+			subgrp->policy_refresh_has_pos = false;
+			if (subgrp->policy_refresh_has_rd)
+				dest = bgp_table_get_next(
+					rib, &subgrp->policy_refresh_rd);
+			else
+				dest = bgp_table_top(rib);
+		}
+
+		for (; dest; dest = bgp_route_next(dest)) {
+			table = bgp_dest_get_bgp_table_info(dest);
+			if (!table)
+				continue;
+
+			if (!subgroup_policy_refresh_table(subgrp, table,
+							   thread)) {
+				prefix_copy(&subgrp->policy_refresh_rd,
+					    bgp_dest_get_prefix(dest));
+				subgrp->policy_refresh_has_rd = true;
+				bgp_dest_unlock_node(dest);
+				goto yield;
+			}
+		}
+	}
+
+	if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " policy refresh done",
+			   subgrp->update_group->id, subgrp->id);
+
+	update_subgroup_set_needs_refresh(subgrp, 0);
+	update_subgroup_trigger_merge_check(subgrp, 0);
+	return 0;
+
+yield:
+	thread_add_event(bm->master, subgroup_policy_refresh_run, subgrp, 0,
+			 &subgrp->t_policy_refresh);
+	return 0;
+}
+
+/*
+ * subgroup_policy_refresh
+ *
+ * Re-announce to a subgroup after its outbound policy changed.  Only the
+ * prefixes for which the outcome differs from the adj-out are sent, and the
+ * table is walked in the background.  The subgroup keeps its needs-refresh
+ * bit, and so won't merge, until the walk is done.
+ */
+void subgroup_policy_refresh(struct update_subgroup *subgrp)
+{
+	if (subgroup_announce_deferred(subgrp)) {
+		update_subgroup_set_needs_refresh(subgrp, 0);
+		return;
+	}
+
+	update_subgroup_set_needs_refresh(subgrp, 1);
+
+	subgroup_announce_default(subgrp);
+
+	/* start over if a walk was under way already */
+	subgrp->policy_refresh_has_rd = false;
+	subgrp->policy_refresh_has_pos = false;
+	subgrp->policy_refresh_waits = 0;
+	THREAD_OFF(subgrp->t_policy_refresh);
+	thread_add_event(bm->master, subgroup_policy_refresh_run, subgrp, 0,
+			 &subgrp->t_policy_refresh);
+}
+
 void subgroup_default_originate(struct update_subgroup *subgrp, int withdraw)
 {
 	struct bgp *bgp;
@@ -909,8 +1129,7 @@ void subgroup_default_originate(struct update_subgroup *subgrp, int withdraw)
 							subgrp, adj);
 
 					/* Remove  from adjacency. */
-					RB_REMOVE(bgp_adj_out_rb,
-						  &dest->adj_out, adj);
+					bgp_adj_out_unlink(dest, adj);
 
 					/* Free allocated information.  */
 					adj_free(adj);
@@ -971,7 +1190,8 @@ void subgroup_announce_all(struct update_subgroup *subgrp)
 void group_announce_route(struct bgp *bgp, afi_t afi, safi_t safi,
 			  struct bgp_dest *dest, struct bgp_path_info *pi)
 {
-	struct updwalk_context ctx;
+	struct updwalk_context ctx = {};
+
 	ctx.pi = pi;
 	ctx.dest = dest;
 
@@ -984,6 +1204,29 @@ void group_announce_route(struct bgp *bgp, afi_t afi, safi_t safi,
 	update_group_af_walk(bgp, afi, safi, group_announce_route_walkcb, &ctx);
 }
 
+/*
+ * Like group_announce_route(), for the end of route processing: addpath
+ * subgroups get the best path, the previous best path and the paths for
+ * which bgp_addpath_path_changed(), instead of all of them again.
+ */
+void group_announce_route_changed(struct bgp *bgp, afi_t afi, safi_t safi,
+				  struct bgp_dest *dest,
+				  struct bgp_path_info *pi,
+				  struct bgp_path_info *old_pi)
+{
+	struct updwalk_context ctx = {};
+
+	ctx.pi = pi;
+	ctx.old_pi = old_pi;
+	ctx.dest = dest;
+	ctx.flags = UPDWALK_FLAGS_CHANGED_ONLY;
+
+	if (!bgp_check_advertise(bgp, dest))
+		return;
+
+	update_group_af_walk(bgp, afi, safi, group_announce_route_walkcb, &ctx);
+}
+
 void update_group_show_adj_queue(struct bgp *bgp, afi_t afi, safi_t safi,
 				 struct vty *vty, uint64_t id)
 {
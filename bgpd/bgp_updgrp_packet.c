@@ -41,6 +41,7 @@
 #include "linklist.h"
 #include "workqueue.h"
 #include "hash.h"
+#include "jhash.h"
 #include "queue.h"
 #include "mpls.h"
 
@@ -57,6 +58,7 @@
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_addpath.h"
+#include "bgpd/bgp_trace.h"
 
 /********************
  * PRIVATE FUNCTIONS
@@ -144,6 +146,18 @@ static void bpacket_queue_add_packet(struct bpacket_queue *q,
 		q->hwm_count = q->curr_count;
 }
 
+/* Account for a packet buffer filled in */
+static void bpacket_queue_add_bytes(struct bpacket_queue *q,
+				    struct stream *s)
+{
+	if (!s)
+		return;
+
+	q->curr_bytes += STREAM_SIZE(s);
+	if (q->hwm_bytes < q->curr_bytes)
+		q->hwm_bytes = q->curr_bytes;
+}
+
 /*
  * Adds a packet to the bpacket_queue.
  *
@@ -162,6 +176,7 @@ struct bpacket *bpacket_queue_add(struct bpacket_queue *q, struct stream *s,
 	if (TAILQ_EMPTY(&(q->pkts))) {
 		pkt->ver = 1;
 		pkt->buffer = s;
+		bpacket_queue_add_bytes(q, s);
 		if (vecarrp)
 			memcpy(&pkt->arr, vecarrp,
 			       sizeof(struct bpacket_attr_vec_arr));
@@ -180,6 +195,7 @@ struct bpacket *bpacket_queue_add(struct bpacket_queue *q, struct stream *s,
 	last_pkt = bpacket_queue_last(q);
 	assert(last_pkt->buffer == NULL);
 	last_pkt->buffer = s;
+	bpacket_queue_add_bytes(q, s);
 	if (vecarrp)
 		memcpy(&last_pkt->arr, vecarrp,
 		       sizeof(struct bpacket_attr_vec_arr));
@@ -212,6 +228,8 @@ struct bpacket *bpacket_queue_remove(struct bpacket_queue *q)
 	if (first) {
 		TAILQ_REMOVE(&(q->pkts), first, pkt_train);
 		q->curr_count--;
+		if (first->buffer)
+			q->curr_bytes -= STREAM_SIZE(first->buffer);
 	}
 	return first;
 }
@@ -230,6 +248,9 @@ bool bpacket_queue_is_full(struct bgp *bgp, struct bpacket_queue *q)
 {
 	if (q->curr_count >= bgp->default_subgroup_pkt_queue_max)
 		return true;
+	if (bgp->subgroup_pkt_queue_mem_max
+	    && q->curr_bytes >= (size_t)bgp->subgroup_pkt_queue_mem_max << 20)
+		return true;
 	return false;
 }
 
@@ -391,13 +412,15 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 	char buf2[BUFSIZ];
 	struct bgp_filter *filter;
 
-	s = stream_dup(pkt->buffer);
 	peer = PAF_PEER(paf);
 
 	vec = &pkt->arr.entries[BGP_ATTR_VEC_NH];
 
+	/* nothing to rewrite, all peers can share the template's bytes */
 	if (!CHECK_FLAG(vec->flags, BPKT_ATTRVEC_FLAGS_UPDATED))
-		return s;
+		return stream_clone(pkt->buffer);
+
+	s = stream_dup(pkt->buffer);
 
 	uint8_t nhlen;
 	afi_t nhafi;
@@ -688,6 +711,142 @@ bool subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return false;
 }
 
+static unsigned int bpacket_attr_tmpl_hash_key(const void *p)
+{
+	const struct bpacket_attr_tmpl *tmpl = p;
+
+	return jhash_3words((uint32_t)(uintptr_t)tmpl->attr,
+			    tmpl->from_id.s_addr,
+			    tmpl->from_sort | tmpl->from << 8
+				    | tmpl->from_enhe << 9,
+			    0);
+}
+
+static bool bpacket_attr_tmpl_hash_cmp(const void *p1, const void *p2)
+{
+	const struct bpacket_attr_tmpl *tmpl1 = p1;
+	const struct bpacket_attr_tmpl *tmpl2 = p2;
+
+	return tmpl1->attr == tmpl2->attr
+	       && tmpl1->from_id.s_addr == tmpl2->from_id.s_addr
+	       && tmpl1->from_sort == tmpl2->from_sort
+	       && tmpl1->from == tmpl2->from
+	       && tmpl1->from_enhe == tmpl2->from_enhe;
+}
+
+static void bpacket_attr_tmpl_free(void *p)
+{
+	struct bpacket_attr_tmpl *tmpl = p;
+
+	bgp_attr_unintern(&tmpl->attr);
+	XFREE(MTYPE_BGP_UPDGRP_ATTR_TMPL, tmpl);
+}
+
+void bpacket_attr_tmpl_flush(struct update_group *updgrp)
+{
+	if (!updgrp->attr_tmpls)
+		return;
+
+	hash_clean(updgrp->attr_tmpls, bpacket_attr_tmpl_free);
+	hash_free(updgrp->attr_tmpls);
+	updgrp->attr_tmpls = NULL;
+}
+
+static void bpacket_attr_tmpl_env_get(struct bpacket_attr_tmpl_env *env,
+				      struct peer *peer)
+{
+	struct bgp *bgp = peer->bgp;
+
+	memset(env, 0, sizeof(*env));
+	env->router_id = bgp->router_id;
+	env->cluster_id = bgp->cluster_id;
+	env->confed_id = bgp->confed_id;
+	env->local_as = peer->local_as;
+	env->maxmed_value = bgp->maxmed_value;
+	env->config = bgp->config;
+	env->maxmed_active = bgp->maxmed_active;
+}
+
+/*
+ * Encode attr the way bgp_packet_attribute() does, reusing what another
+ * subgroup of the update-group encoded for the same attributes if possible.
+ */
+static bgp_size_t subgroup_packet_attribute(struct update_subgroup *subgrp,
+					    struct stream *s, struct attr *attr,
+					    struct bpacket_attr_vec_arr *vecarr,
+					    struct peer *from)
+{
+	struct update_group *updgrp = subgrp->update_group;
+	struct peer *peer = SUBGRP_PEER(subgrp);
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
+	struct bpacket_attr_tmpl_env env;
+	struct bpacket_attr_tmpl key = {}, *tmpl;
+	size_t start = stream_get_endp(s);
+	bgp_size_t len;
+	int i;
+
+	bpacket_attr_tmpl_env_get(&env, peer);
+	if (memcmp(&env, &updgrp->attr_tmpl_env, sizeof(env))) {
+		bpacket_attr_tmpl_flush(updgrp);
+		updgrp->attr_tmpl_env = env;
+	}
+
+	key.attr = attr;
+	if (from) {
+		key.from = true;
+		key.from_id = from->remote_id;
+		key.from_sort = from->sort;
+		key.from_enhe = !!peer_cap_enhe(from, afi, safi);
+	}
+
+	tmpl = updgrp->attr_tmpls ? hash_lookup(updgrp->attr_tmpls, &key)
+				  : NULL;
+	if (tmpl && STREAM_WRITEABLE(s) >= tmpl->len) {
+		stream_put(s, tmpl->data, tmpl->len);
+		for (i = 0; i < BGP_ATTR_VEC_MAX; i++) {
+			if (!tmpl->vecarr.entries[i].flags)
+				continue;
+			vecarr->entries[i].flags = tmpl->vecarr.entries[i].flags;
+			vecarr->entries[i].offset =
+				start + tmpl->vecarr.entries[i].offset;
+		}
+		UPDGRP_INCR_STAT(updgrp, attr_tmpl_hits);
+		return tmpl->len;
+	}
+
+	len = bgp_packet_attribute(NULL, peer, s, attr, vecarr, NULL, afi,
+				   safi, from, NULL, NULL, 0, 0, 0);
+
+	/* nobody else to share with */
+	if (LIST_FIRST(&updgrp->subgrps) == subgrp
+	    && !LIST_NEXT(subgrp, updgrp_train))
+		return len;
+
+	UPDGRP_INCR_STAT(updgrp, attr_tmpl_misses);
+
+	if (!updgrp->attr_tmpls)
+		updgrp->attr_tmpls = hash_create(bpacket_attr_tmpl_hash_key,
+						 bpacket_attr_tmpl_hash_cmp,
+						 "BGP update-group templates");
+	else if (updgrp->attr_tmpls->count >= BPACKET_ATTR_TMPL_MAX)
+		hash_clean(updgrp->attr_tmpls, bpacket_attr_tmpl_free);
+
+	tmpl = XMALLOC(MTYPE_BGP_UPDGRP_ATTR_TMPL, sizeof(*tmpl) + len);
+	*tmpl = key;
+	tmpl->attr = bgp_attr_intern(attr);
+	tmpl->len = len;
+	memcpy(tmpl->data, STREAM_DATA(s) + start, len);
+	for (i = 0; i < BGP_ATTR_VEC_MAX; i++) {
+		tmpl->vecarr.entries[i] = vecarr->entries[i];
+		if (tmpl->vecarr.entries[i].flags)
+			tmpl->vecarr.entries[i].offset -= start;
+	}
+	hash_get(updgrp->attr_tmpls, tmpl, hash_alloc_intern);
+
+	return len;
+}
+
 /* Make BGP update packet.  */
 struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 {
@@ -722,8 +881,10 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	if (!subgrp)
 		return NULL;
 
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp))) {
+		update_subgroup_trigger_slow_split(subgrp);
 		return NULL;
+	}
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -764,8 +925,8 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 			goto next;
 		}
 
-		space_remaining = STREAM_CONCAT_REMAIN(s, snlri, STREAM_SIZE(s))
-				  - BGP_MAX_PACKET_SIZE_OVERFLOW;
+		space_remaining =
+			STREAM_CONCAT_REMAIN(s, snlri, peer->max_packet_size);
 		space_needed =
 			BGP_NLRI_LENGTH + addpath_overhead
 			+ bgp_packet_mpattr_prefix_size(afi, safi, dest_p);
@@ -805,13 +966,11 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 			/* 5: Encode all the attributes, except MP_REACH_NLRI
 			 * attr. */
-			total_attr_len = bgp_packet_attribute(
-				NULL, peer, s, adv->baa->attr, &vecarr, NULL,
-				afi, safi, from, NULL, NULL, 0, 0, 0);
+			total_attr_len = subgroup_packet_attribute(
+				subgrp, s, adv->baa->attr, &vecarr, from);
 
-			space_remaining =
-				STREAM_CONCAT_REMAIN(s, snlri, STREAM_SIZE(s))
-				- BGP_MAX_PACKET_SIZE_OVERFLOW;
+			space_remaining = STREAM_CONCAT_REMAIN(
+				s, snlri, peer->max_packet_size);
 			space_needed = BGP_NLRI_LENGTH + addpath_overhead
 				       + bgp_packet_mpattr_prefix_size(
 					       afi, safi, dest_p);
@@ -905,13 +1064,16 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
-		/* Synchnorize attribute.  */
+		/* Synchnorize attribute.  The advertisement holds the
+		 * attribute interned, and so does every prefix of the run
+		 * after it, no need to look it up again.
+		 */
 		if (adj->attr)
 			bgp_attr_unintern(&adj->attr);
 		else
 			subgrp->scount++;
 
-		adj->attr = bgp_attr_intern(adv->baa->attr);
+		adj->attr = bgp_attr_ref(adv->baa->attr);
 next:
 		adv = bgp_advertise_clean_subgroup(subgrp, adj);
 	}
@@ -931,12 +1093,17 @@ next:
 		} else
 			packet = stream_dup(s);
 		bgp_packet_set_size(packet);
+		subgrp->updates_built++;
+		subgrp->nlri_packed += num_pfx;
+		subgrp->update_bytes += stream_get_endp(packet);
 		if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
 			zlog_debug("u%" PRIu64 ":s%" PRIu64" send UPDATE len %zd numpfx %d",
 				   subgrp->update_group->id, subgrp->id,
 				   (stream_get_endp(packet)
 				    - stream_get_getp(packet)),
 				   num_pfx);
+		frrtrace(3, frr_bgp, update_packet_build, subgrp, num_pfx,
+			 stream_get_endp(packet));
 		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
 		stream_reset(s);
 		stream_reset(snlri);
@@ -983,8 +1150,10 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 	if (!subgrp)
 		return NULL;
 
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp))) {
+		update_subgroup_trigger_slow_split(subgrp);
 		return NULL;
+	}
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -1003,8 +1172,7 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 		dest_p = bgp_dest_get_prefix(dest);
 		addpath_tx_id = adj->addpath_tx_id;
 
-		space_remaining =
-			STREAM_WRITEABLE(s) - BGP_MAX_PACKET_SIZE_OVERFLOW;
+		space_remaining = peer->max_packet_size - stream_get_endp(s);
 		space_needed =
 			BGP_NLRI_LENGTH + addpath_overhead + BGP_TOTAL_ATTR_LEN
 			+ bgp_packet_mpattr_prefix_size(afi, safi, dest_p);
@@ -1160,7 +1328,7 @@ void subgroup_default_update_packet(struct update_subgroup *subgrp,
 			   tx_id_buf, attrstr);
 	}
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
 	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
@@ -1238,7 +1406,7 @@ void subgroup_default_withdraw_packet(struct update_subgroup *subgrp)
 			   tx_id_buf);
 	}
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	s = stream_new(BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
 	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
@@ -101,7 +101,7 @@ int show_adj_route_vpn(struct vty *vty, struct peer *peer,
 			struct attr *attr = NULL;
 			struct peer_af *paf = NULL;
 
-			RB_FOREACH (adj, bgp_adj_out_rb, &rm->adj_out)
+			BGP_ADJ_OUT_FOREACH (rm, adj)
 				SUBGRP_FOREACH_PEER (adj->subgroup, paf) {
 					if (paf->peer != peer || !adj->attr)
 						continue;
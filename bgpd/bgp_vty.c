@@ -46,6 +46,7 @@
 #include "bgpd/bgp_community.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_damp.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_errors.h"
@@ -1527,6 +1528,34 @@ DEFPY (bgp_suppress_fib_pending,
 	return CMD_SUCCESS;
 }
 
+DEFPY (bgp_pic,
+       bgp_pic_cmd,
+       "[no] bgp pic",
+       NO_STR
+       BGP_STR
+       "Install routes with nexthop groups shared per BGP nexthop\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	afi_t afi;
+	safi_t safi;
+
+	if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_PIC) == !no)
+		return CMD_SUCCESS;
+
+	if (no)
+		UNSET_FLAG(bgp->flags, BGP_FLAG_PIC);
+	else
+		SET_FLAG(bgp->flags, BGP_FLAG_PIC);
+
+	/* This config is used in route install, so redo that. */
+	FOREACH_AFI_SAFI (afi, safi) {
+		if (!bgp_fibupd_safi(safi))
+			continue;
+		bgp_zebra_announce_table(bgp, afi, safi);
+	}
+
+	return CMD_SUCCESS;
+}
 
 /* BGP Cluster ID.  */
 DEFUN_YANG(bgp_cluster_id,
@@ -3833,6 +3862,37 @@ void cli_show_router_global_update_group_config_subgroup_pkt_queue_size(
 		yang_dnode_get_uint32(dnode, NULL));
 }
 
+DEFPY (bgp_default_subgroup_pkt_queue_memory,
+       bgp_default_subgroup_pkt_queue_memory_cmd,
+       "bgp default subgroup-pkt-queue-memory (1-4096)$mb",
+       BGP_STR
+       "Configure BGP defaults\n"
+       "Limit the memory held by the packet queue of a subgroup\n"
+       "Limit in megabytes\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	bgp->subgroup_pkt_queue_mem_max = mb;
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_default_subgroup_pkt_queue_memory,
+       no_bgp_default_subgroup_pkt_queue_memory_cmd,
+       "no bgp default subgroup-pkt-queue-memory [(1-4096)]",
+       NO_STR
+       BGP_STR
+       "Configure BGP defaults\n"
+       "Limit the memory held by the packet queue of a subgroup\n"
+       "Limit in megabytes\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	bgp->subgroup_pkt_queue_mem_max = 0;
+
+	return CMD_SUCCESS;
+}
+
 DEFUN_YANG(bgp_rr_allow_outbound_policy,
 	   bgp_rr_allow_outbound_policy_cmd,
 	   "bgp route-reflector allow-outbound-policy",
@@ -10142,6 +10202,8 @@ DEFUN (show_bgp_memory,
 {
 	char memstrbuf[MTYPE_MEMSTR_LEN];
 	unsigned long count;
+	unsigned long attrs;
+	long saved;
 
 	/* RIB related usage stats */
 	count = mtype_stats_alloc(MTYPE_BGP_NODE);
@@ -10175,10 +10237,18 @@ DEFUN (show_bgp_memory,
 		vty_out(vty, "%ld Adj-In entries, using %s of memory\n", count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
 				     count * sizeof(struct bgp_adj_in)));
-	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT)))
+	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT))) {
 		vty_out(vty, "%ld Adj-Out entries, using %s of memory\n", count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
 				     count * sizeof(struct bgp_adj_out)));
+		vty_out(vty,
+			"%zu Adj-Out index slots on %ld prefixes, using %s of memory\n",
+			bgp_adj_out_index_slots(),
+			mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_INDEX),
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     bgp_adj_out_index_slots()
+					     * sizeof(struct bgp_adj_out *)));
+	}
 
 	if ((count = mtype_stats_alloc(MTYPE_BGP_NEXTHOP_CACHE)))
 		vty_out(vty, "%ld Nexthop cache entries, using %s of memory\n",
@@ -10201,6 +10271,23 @@ DEFUN (show_bgp_memory,
 	if ((count = attr_unknown_count()))
 		vty_out(vty, "%ld unknown attributes\n", count);
 
+	/* EVPN fields, kept out of line and shared between attributes */
+	attrs = attr_count();
+	count = attr_evpn_count();
+	vty_out(vty, "%ld BGP attribute EVPN extensions, using %s of memory\n",
+		count,
+		mtype_memstr(memstrbuf, sizeof(memstrbuf),
+			     count * sizeof(struct bgp_attr_evpn)));
+
+	/* compared to every attribute carrying them inline */
+	saved = (long)(attrs * (sizeof(struct bgp_attr_evpn)
+				- offsetof(struct bgp_attr_evpn, overlay)
+				- sizeof(struct bgp_attr_evpn *)))
+		- (long)(count * sizeof(struct bgp_attr_evpn));
+	if (saved > 0)
+		vty_out(vty, "%s saved by keeping EVPN fields out of line\n",
+			mtype_memstr(memstrbuf, sizeof(memstrbuf), saved));
+
 	/* AS_PATH attributes */
 	count = aspath_count();
 	vty_out(vty, "%ld BGP AS-PATH entries, using %s of memory\n", count,
@@ -10251,6 +10338,135 @@ DEFUN (show_bgp_memory,
 	return CMD_SUCCESS;
 }
 
+/* Attributes are shared, so only the references to them are counted. */
+static void bgp_show_mem_stats(struct vty *vty, json_object *json,
+			       afi_t afi, safi_t safi,
+			       const struct bgp_mem_stats *ms)
+{
+	char memstrbuf[MTYPE_MEMSTR_LEN];
+	uint32_t attr_refs = ms->paths + ms->adj_in + ms->adj_out;
+	size_t bytes = ms->paths * sizeof(struct bgp_path_info)
+		       + ms->adj_in * sizeof(struct bgp_adj_in)
+		       + ms->adj_out * sizeof(struct bgp_adj_out);
+	json_object *json_af;
+
+	if (json) {
+		json_af = json_object_new_object();
+		json_object_int_add(json_af, "paths", ms->paths);
+		json_object_int_add(json_af, "adjIn", ms->adj_in);
+		json_object_int_add(json_af, "adjOut", ms->adj_out);
+		json_object_int_add(json_af, "attrRefs", attr_refs);
+		json_object_int_add(json_af, "bytes", bytes);
+		json_object_object_add(json, get_afi_safi_str(afi, safi, true),
+				       json_af);
+		return;
+	}
+
+	vty_out(vty,
+		"    %s: %u paths, %u Adj-In, %u Adj-Out, %u attribute references, using %s\n",
+		get_afi_safi_str(afi, safi, false), ms->paths, ms->adj_in,
+		ms->adj_out, attr_refs,
+		mtype_memstr(memstrbuf, sizeof(memstrbuf), bytes));
+}
+
+static void bgp_show_memory_detail(struct vty *vty, struct bgp *bgp,
+				   json_object *json)
+{
+	json_object *json_bgp = NULL, *json_tables = NULL;
+	json_object *json_peers = NULL, *json_peer = NULL;
+	struct listnode *node;
+	struct peer *peer;
+	struct peer_af *paf;
+	struct bgp_mem_stats ms;
+	bool shown;
+	afi_t afi;
+	safi_t safi;
+
+	if (json) {
+		json_bgp = json_object_new_object();
+		json_tables = json_object_new_object();
+		json_peers = json_object_new_object();
+		json_object_object_add(json_bgp, "tables", json_tables);
+		json_object_object_add(json_bgp, "peers", json_peers);
+		json_object_object_add(json, bgp->name_pretty, json_bgp);
+	} else
+		vty_out(vty, "BGP instance %s:\n  Tables:\n", bgp->name_pretty);
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		ms = bgp->mem_stats[afi][safi];
+		if (ms.paths || ms.adj_in || ms.adj_out)
+			bgp_show_mem_stats(vty, json_tables, afi, safi, &ms);
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		shown = false;
+		json_peer = NULL;
+
+		FOREACH_AFI_SAFI (afi, safi) {
+			/* Adj-Out is shared by the peers of a subgroup */
+			ms = peer->mem_stats[afi][safi];
+			paf = peer_af_find(peer, afi, safi);
+			if (paf && PAF_SUBGRP(paf))
+				ms.adj_out = PAF_SUBGRP(paf)->adj_count;
+			if (!ms.paths && !ms.adj_in && !ms.adj_out)
+				continue;
+
+			if (!shown && json) {
+				json_peer = json_object_new_object();
+				json_object_object_add(json_peers, peer->host,
+						       json_peer);
+			} else if (!shown)
+				vty_out(vty, "  Peer %s:\n", peer->host);
+			shown = true;
+
+			bgp_show_mem_stats(vty, json_peer, afi, safi, &ms);
+		}
+	}
+}
+
+DEFPY (show_bgp_memory_detail,
+       show_bgp_memory_detail_cmd,
+       "show [ip] bgp [<view|vrf> VIEWVRFNAME$vrf] memory detail [json$uj]",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       BGP_INSTANCE_HELP_STR
+       "Global BGP memory statistics\n"
+       "Memory used per table and per peer\n"
+       JSON_STR)
+{
+	json_object *json = NULL;
+	struct listnode *node;
+	struct bgp *bgp;
+
+	if (uj)
+		json = json_object_new_object();
+
+	if (vrf) {
+		bgp = strmatch(vrf, VRF_DEFAULT_NAME) ? bgp_get_default()
+						      : bgp_lookup_by_name(vrf);
+		if (!bgp) {
+			if (json)
+				json_object_free(json);
+			vty_out(vty, "%% No such BGP instance exists\n");
+			return CMD_WARNING;
+		}
+		bgp_show_memory_detail(vty, bgp, json);
+	} else {
+		for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+			bgp_show_memory_detail(vty, bgp, json);
+	}
+
+	if (json) {
+		vty_out(vty, "%s\n",
+			json_object_to_json_string_ext(
+				json, JSON_C_TO_STRING_PRETTY));
+		json_object_free(json);
+	}
+
+	return CMD_SUCCESS;
+}
+
 static void bgp_show_bestpath_json(struct bgp *bgp, json_object *json)
 {
 	json_object *bestpath = json_object_new_object();
@@ -10457,7 +10673,13 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 	if (use_json) {
 		json = json_object_new_object();
 		json_peers = json_object_new_object();
+		/* the counters are collected by the main loop below, this is
+		 * only needed to know up front whether there's anything
+		 * failed to show
+		 */
 		for (ALL_LIST_ELEMENTS(bgp->peer, node, nnode, peer)) {
+			if (!show_failed)
+				break;
 			if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
 				continue;
 
@@ -10532,7 +10754,10 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 		return CMD_SUCCESS;
 	}
 
-	count = 0;		/* Reset the value as its used again */
+	/* Reset the values as they're used again */
+	count = 0;
+	dn_count = 0;
+	failed_count = 0;
 	for (ALL_LIST_ELEMENTS(bgp->peer, node, nnode, peer)) {
 		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
 			continue;
@@ -10753,6 +10978,8 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 		/* Works for both failed & successful cases */
 		if (peer_dynamic_neighbor(peer))
 			dn_count++;
+		if (bgp_has_peer_failed(peer, afi, safi))
+			failed_count++;
 
 		if (use_json) {
 			json_peer = NULL;
@@ -11040,6 +11267,9 @@ static void bgp_show_summary_afi_safi(struct vty *vty, struct bgp *bgp, int afi,
 	int safi_wildcard = (safi == SAFI_MAX);
 	int is_wildcard = (afi_wildcard || safi_wildcard);
 	bool nbr_output = false;
+	bool peer_exists[AFI_MAX][SAFI_MAX];
+
+	bgp_afi_safi_peer_map(bgp, peer_exists);
 
 	if (use_json && is_wildcard)
 		vty_out(vty, "{\n");
@@ -11049,7 +11279,7 @@ static void bgp_show_summary_afi_safi(struct vty *vty, struct bgp *bgp, int afi,
 		if (safi_wildcard)
 			safi = 1; /* SAFI_UNICAST */
 		while (safi < SAFI_MAX) {
-			if (bgp_afi_safi_peer_exists(bgp, afi, safi)) {
+			if (peer_exists[afi][safi]) {
 				nbr_output = true;
 
 				if (is_wildcard) {
@@ -12600,6 +12830,9 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 		json_object_int_add(json_neigh,
 				    "bgpTimerKeepAliveIntervalMsecs",
 				    p->v_keepalive * 1000);
+		json_object_int_add(json_neigh,
+				    "bgpTimerKeepAliveMaxDriftUsecs",
+				    p->v_keepalive_drift);
 		if (CHECK_FLAG(p->flags, PEER_FLAG_TIMER)) {
 			json_object_int_add(json_neigh,
 					    "bgpTimerConfiguredHoldTimeMsecs",
@@ -12667,6 +12900,8 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 		vty_out(vty,
 			"  Hold time is %d, keepalive interval is %d seconds\n",
 			p->v_holdtime, p->v_keepalive);
+		vty_out(vty, "  Keepalives went out up to %u usecs late\n",
+			p->v_keepalive_drift);
 		if (CHECK_FLAG(p->flags, PEER_FLAG_TIMER)) {
 			vty_out(vty, "  Configured hold time is %d",
 				p->holdtime);
@@ -12880,6 +13115,36 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 							"received");
 				}
 
+				/* Extended message */
+				if (CHECK_FLAG(p->cap,
+					       PEER_CAP_EXTENDED_MESSAGE_RCV)
+				    || CHECK_FLAG(p->cap,
+						  PEER_CAP_EXTENDED_MESSAGE_ADV)) {
+					if (CHECK_FLAG(p->cap,
+						       PEER_CAP_EXTENDED_MESSAGE_ADV)
+					    && CHECK_FLAG(
+						    p->cap,
+						    PEER_CAP_EXTENDED_MESSAGE_RCV))
+						json_object_string_add(
+							json_cap,
+							"extendedMessage",
+							"advertisedAndReceived");
+					else if (CHECK_FLAG(
+							 p->cap,
+							 PEER_CAP_EXTENDED_MESSAGE_ADV))
+						json_object_string_add(
+							json_cap,
+							"extendedMessage",
+							"advertised");
+					else if (CHECK_FLAG(
+							 p->cap,
+							 PEER_CAP_EXTENDED_MESSAGE_RCV))
+						json_object_string_add(
+							json_cap,
+							"extendedMessage",
+							"received");
+				}
+
 				/* Extended nexthop */
 				if (CHECK_FLAG(p->cap, PEER_CAP_ENHE_RCV)
 				    || CHECK_FLAG(p->cap, PEER_CAP_ENHE_ADV)) {
@@ -13293,6 +13558,26 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 					vty_out(vty, "\n");
 				}
 
+				/* Extended message */
+				if (CHECK_FLAG(p->cap,
+					       PEER_CAP_EXTENDED_MESSAGE_RCV)
+				    || CHECK_FLAG(p->cap,
+						  PEER_CAP_EXTENDED_MESSAGE_ADV)) {
+					vty_out(vty, "    Extended Message:");
+					if (CHECK_FLAG(p->cap,
+						       PEER_CAP_EXTENDED_MESSAGE_ADV))
+						vty_out(vty, " advertised");
+					if (CHECK_FLAG(p->cap,
+						       PEER_CAP_EXTENDED_MESSAGE_RCV))
+						vty_out(vty, " %sreceived",
+							CHECK_FLAG(
+								p->cap,
+								PEER_CAP_EXTENDED_MESSAGE_ADV)
+								? "and "
+								: "");
+					vty_out(vty, "\n");
+				}
+
 				/* Extended nexthop */
 				if (CHECK_FLAG(p->cap, PEER_CAP_ENHE_RCV)
 				    || CHECK_FLAG(p->cap, PEER_CAP_ENHE_ADV)) {
@@ -13614,6 +13899,12 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 				    (unsigned long)inq_count);
 		json_object_int_add(json_stat, "depthOutq",
 				    (unsigned long)outq_count);
+		json_object_int_add(json_stat, "sendRateBytesPerSec",
+				    atomic_load_explicit(&p->obuf_rate,
+							 memory_order_relaxed));
+		json_object_int_add(json_stat, "writeQuantumBytes",
+				    atomic_load_explicit(&p->wpkt_quantum,
+							 memory_order_relaxed));
 		json_object_int_add(json_stat, "opensSent",
 				    atomic_load_explicit(&p->open_out,
 							 memory_order_relaxed));
@@ -13664,6 +13955,12 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 		vty_out(vty, "  Message statistics:\n");
 		vty_out(vty, "    Inq depth is %zu\n", inq_count);
 		vty_out(vty, "    Outq depth is %zu\n", outq_count);
+		vty_out(vty,
+			"    Send rate is %u bytes/s, write quantum %u bytes\n",
+			atomic_load_explicit(&p->obuf_rate,
+					     memory_order_relaxed),
+			atomic_load_explicit(&p->wpkt_quantum,
+					     memory_order_relaxed));
 		vty_out(vty, "                         Sent       Rcvd\n");
 		vty_out(vty, "    Opens:         %10d %10d\n",
 			atomic_load_explicit(&p->open_out,
@@ -14122,6 +14419,7 @@ static int bgp_show_neighbor(struct vty *vty, struct bgp *bgp,
 	struct peer *peer;
 	int find = 0;
 	bool nbr_output = false;
+	bool done = false;
 	afi_t afi = AFI_MAX;
 	safi_t safi = SAFI_MAX;
 
@@ -14131,7 +14429,28 @@ static int bgp_show_neighbor(struct vty *vty, struct bgp *bgp,
 		afi = AFI_IP6;
 	}
 
+	/* looking for an address, no need to walk all peers */
+	if (!conf_if && (type == show_peer || type == show_ipv4_peer
+			 || type == show_ipv6_peer)) {
+		done = true;
+		peer = peer_lookup(bgp, su);
+
+		if (peer && type != show_peer) {
+			FOREACH_SAFI (safi)
+				if (peer->afc[afi][safi])
+					break;
+			if (safi == SAFI_MAX)
+				peer = NULL;
+		}
+		if (peer) {
+			find = 1;
+			bgp_show_peer(vty, peer, use_json, json);
+		}
+	}
+
 	for (ALL_LIST_ELEMENTS(bgp->peer, node, nnode, peer)) {
+		if (done)
+			break;
 		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
 			continue;
 
@@ -14517,7 +14836,7 @@ static void community_show_all_iterator(struct hash_bucket *bucket,
 	struct community *com;
 
 	com = (struct community *)bucket->data;
-	vty_out(vty, "[%p] (%ld) %s\n", (void *)com, com->refcnt,
+	vty_out(vty, "[%p] (%zu) %s\n", (void *)com, (size_t)com->refcnt,
 		community_str(com, false));
 }
 
@@ -14532,10 +14851,10 @@ DEFUN (show_ip_bgp_community_info,
 {
 	vty_out(vty, "Address Refcnt Community\n");
 
-	hash_iterate(community_hash(),
-		     (void (*)(struct hash_bucket *,
-			       void *))community_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(community_hash(),
+			   (void (*)(struct hash_bucket *,
+				     void *))community_show_all_iterator,
+			   vty);
 
 	return CMD_SUCCESS;
 }
@@ -14546,7 +14865,7 @@ static void lcommunity_show_all_iterator(struct hash_bucket *bucket,
 	struct lcommunity *lcom;
 
 	lcom = (struct lcommunity *)bucket->data;
-	vty_out(vty, "[%p] (%ld) %s\n", (void *)lcom, lcom->refcnt,
+	vty_out(vty, "[%p] (%zu) %s\n", (void *)lcom, (size_t)lcom->refcnt,
 		lcommunity_str(lcom, false));
 }
 
@@ -14561,10 +14880,10 @@ DEFUN (show_ip_bgp_lcommunity_info,
 {
 	vty_out(vty, "Address Refcnt Large-community\n");
 
-	hash_iterate(lcommunity_hash(),
-		     (void (*)(struct hash_bucket *,
-			       void *))lcommunity_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(lcommunity_hash(),
+			   (void (*)(struct hash_bucket *,
+				     void *))lcommunity_show_all_iterator,
+			   vty);
 
 	return CMD_SUCCESS;
 }
@@ -14575,7 +14894,8 @@ static void bgp_show_global_graceful_restart_mode_vty(struct vty *vty,
 						      bool use_json,
 						      json_object *json)
 {
-
+	afi_t afi;
+	safi_t safi;
 
 	vty_out(vty, "\n%s", SHOW_GR_HEADER);
 
@@ -14600,6 +14920,23 @@ static void bgp_show_global_graceful_restart_mode_vty(struct vty *vty,
 			"Global BGP GR Mode  Invalid\n");
 		break;
 	}
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		struct graceful_restart_info *gr_info = &bgp->gr_info[afi][safi];
+
+		if (!gr_info->gr_select_total)
+			continue;
+
+		vty_out(vty, "Deferred route selection for %s : %u of %u done",
+			get_afi_safi_str(afi, safi, false), gr_info->gr_selected,
+			gr_info->gr_select_total);
+		if (gr_info->gr_select_end)
+			vty_out(vty, " in %lld seconds\n",
+				(long long)(gr_info->gr_select_end
+					    - gr_info->gr_select_start));
+		else
+			vty_out(vty, ", %u pending\n", gr_info->gr_deferred);
+	}
 	vty_out(vty, "\n");
 }
 
@@ -16882,6 +17219,10 @@ int bgp_config_write(struct vty *vty)
 		if (CHECK_FLAG(bgp->flags, BGP_FLAG_SUPPRESS_FIB_PENDING))
 			vty_out(vty, " bgp suppress-fib-pending\n");
 
+		/* Shared nexthop groups */
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_PIC))
+			vty_out(vty, " bgp pic\n");
+
 		/* BGP log-neighbor-changes. */
 		if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_LOG_NEIGHBOR_CHANGES)
 		    != SAVE_BGP_LOG_NEIGHBOR_CHANGES)
@@ -16940,6 +17281,12 @@ int bgp_config_write(struct vty *vty)
 			vty_out(vty, " bgp default subgroup-pkt-queue-max %u\n",
 				bgp->default_subgroup_pkt_queue_max);
 
+		/* BGP default subgroup-pkt-queue-memory. */
+		if (bgp->subgroup_pkt_queue_mem_max)
+			vty_out(vty,
+				" bgp default subgroup-pkt-queue-memory %u\n",
+				bgp->subgroup_pkt_queue_mem_max);
+
 		/* BGP client-to-client reflection. */
 		if (CHECK_FLAG(bgp->flags, BGP_FLAG_NO_CLIENT_TO_CLIENT))
 			vty_out(vty, " no bgp client-to-client reflection\n");
@@ -17400,6 +17747,9 @@ void bgp_vty_init(void)
 	/* "bgp suppress-fib-pending" command */
 	install_element(BGP_NODE, &bgp_suppress_fib_pending_cmd);
 
+	/* "bgp pic" command */
+	install_element(BGP_NODE, &bgp_pic_cmd);
+
 	/* "bgp cluster-id" commands. */
 	install_element(BGP_NODE, &bgp_cluster_id_cmd);
 	install_element(BGP_NODE, &no_bgp_cluster_id_cmd);
@@ -17594,6 +17944,10 @@ void bgp_vty_init(void)
 	install_element(BGP_NODE, &bgp_default_subgroup_pkt_queue_max_cmd);
 	install_element(BGP_NODE, &no_bgp_default_subgroup_pkt_queue_max_cmd);
 
+	/* "bgp default subgroup-pkt-queue-memory" commands. */
+	install_element(BGP_NODE, &bgp_default_subgroup_pkt_queue_memory_cmd);
+	install_element(BGP_NODE, &no_bgp_default_subgroup_pkt_queue_memory_cmd);
+
 	/* bgp ibgp-allow-policy-mods command */
 	install_element(BGP_NODE, &bgp_rr_allow_outbound_policy_cmd);
 	install_element(BGP_NODE, &no_bgp_rr_allow_outbound_policy_cmd);
@@ -18626,6 +18980,7 @@ void bgp_vty_init(void)
 
 	/* "show [ip] bgp memory" commands. */
 	install_element(VIEW_NODE, &show_bgp_memory_cmd);
+	install_element(VIEW_NODE, &show_bgp_memory_detail_cmd);
 
 	/* "show bgp martian next-hop" */
 	install_element(VIEW_NODE, &show_bgp_martian_nexthop_db_cmd);
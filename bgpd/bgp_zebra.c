@@ -37,6 +37,8 @@
 #include "mpls.h"
 #include "vxlan.h"
 #include "pbr.h"
+#include "jhash.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_route.h"
@@ -1155,6 +1157,35 @@ static bool bgp_zebra_use_nhop_weighted(struct bgp *bgp, struct attr *attr,
 	return true;
 }
 
+/*
+ * With "bgp pic" a route with a single recursive path is installed with the
+ * NHG of its BGP nexthop, so an IGP change is one NHG update in zebra
+ * rather than one update per prefix.
+ */
+static bool bgp_zebra_use_pic_nhg(struct bgp *bgp, struct bgp_path_info *info,
+				  afi_t afi, safi_t safi, uint32_t *nhg_id)
+{
+	if (!CHECK_FLAG(bgp->flags, BGP_FLAG_PIC))
+		return false;
+
+	if (!info->nexthop || info->sub_type == BGP_ROUTE_AGGREGATE
+	    || is_route_parent_evpn(info))
+		return false;
+
+	/* Labels, leaked nexthops and colors are per route */
+	if (info->extra && (info->extra->num_labels || info->extra->bgp_orig))
+		return false;
+	if (CHECK_FLAG(info->attr->flag, ATTR_FLAG_BIT(BGP_ATTR_SRTE_COLOR)))
+		return false;
+
+	if (bgp_path_info_mpath_next(info) || bgp->table_map[afi][safi].name)
+		return false;
+
+	*nhg_id = bgp_nht_nhg_id(info->nexthop);
+
+	return *nhg_id != 0;
+}
+
 void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 			struct bgp_path_info *info, struct bgp *bgp, afi_t afi,
 			safi_t safi)
@@ -1259,12 +1290,19 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 	if (do_wt_ecmp)
 		cum_bw = bgp_path_info_mpath_cumbw(info);
 
+	UNSET_FLAG(dest->flags, BGP_NODE_FIB_NHG);
+
 	/* EVPN MAC-IP routes are installed with a L3 NHG id */
 	if (bgp_evpn_path_es_use_nhg(bgp, info, &nhg_id)) {
 		mpinfo = NULL;
 		api.nhgid = nhg_id;
 		if (nhg_id)
 			SET_FLAG(api.message, ZAPI_MESSAGE_NHG);
+	} else if (bgp_zebra_use_pic_nhg(bgp, info, afi, safi, &nhg_id)) {
+		mpinfo = NULL;
+		api.nhgid = nhg_id;
+		SET_FLAG(api.message, ZAPI_MESSAGE_NHG);
+		SET_FLAG(dest->flags, BGP_NODE_FIB_NHG);
 	} else {
 		mpinfo = info;
 	}
@@ -1400,7 +1438,7 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 			api_nh->label_num = 1;
 			api_nh->labels[0] = label;
 		}
-		memcpy(&api_nh->rmac, &(mpinfo->attr->rmac),
+		memcpy(&api_nh->rmac, &(bgp_attr_get_evpn(mpinfo->attr)->rmac),
 		       sizeof(struct ethaddr));
 		api_nh->weight = nh_weight;
 
@@ -1523,6 +1561,8 @@ void bgp_zebra_announce_table(struct bgp *bgp, afi_t afi, safi_t safi)
 	if (!table)
 		return;
 
+	/* All of these go out to zebra in one go */
+	zclient_batch_start(zclient);
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
 			if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED) &&
@@ -1534,6 +1574,7 @@ void bgp_zebra_announce_table(struct bgp *bgp, afi_t afi, safi_t safi)
 				bgp_zebra_announce(dest,
 						   bgp_dest_get_prefix(dest),
 						   pi, bgp, afi, safi);
+	zclient_batch_end(zclient);
 }
 
 /* Announce routes of any bgp subtype of a table to zebra */
@@ -1551,6 +1592,8 @@ void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
 	if (!table)
 		return;
 
+	/* All of these go out to zebra in one go */
+	zclient_batch_start(zclient);
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
 			if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED) &&
@@ -1558,6 +1601,7 @@ void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
 				bgp_zebra_announce(dest,
 						   bgp_dest_get_prefix(dest),
 						   pi, bgp, afi, safi);
+	zclient_batch_end(zclient);
 }
 
 void bgp_zebra_withdraw(const struct prefix *p, struct bgp_path_info *info,
@@ -1578,6 +1622,9 @@ void bgp_zebra_withdraw(const struct prefix *p, struct bgp_path_info *info,
 		return;
 	}
 
+	if (info->net)
+		UNSET_FLAG(info->net->flags, BGP_NODE_FIB_NHG);
+
 	memset(&api, 0, sizeof(api));
 	api.vrf_id = bgp->vrf_id;
 	api.type = ZEBRA_ROUTE_BGP;
@@ -1624,6 +1671,266 @@ void bgp_zebra_withdraw_table_all_subtypes(struct bgp *bgp, afi_t afi, safi_t sa
 	}
 }
 
+/*
+ * FIB install pipeline.
+ *
+ * Best path selection does not talk to zebra directly; it queues an intent
+ * for the dest instead.  Intents for the same dest are coalesced, and the
+ * flusher resolves each intent against whatever is selected at flush time
+ * and sends the result to zebra in ZAPI batches.  When the connection to
+ * zebra backs up the flusher stops until zclient reports the write buffer
+ * drained.
+ */
+PREDECL_DLIST(bgp_fib_intent_fifo);
+PREDECL_HASH(bgp_fib_intent_hash);
+
+struct bgp_fib_intent {
+	struct bgp_fib_intent_fifo_item fifo_item;
+	struct bgp_fib_intent_hash_item hash_item;
+
+	struct bgp *bgp;
+	struct bgp_dest *dest;
+	afi_t afi;
+	safi_t safi;
+
+	/* Path installed in zebra when the first intent was queued */
+	struct bgp_path_info *withdraw;
+};
+
+static int bgp_fib_intent_cmp(const struct bgp_fib_intent *a,
+			      const struct bgp_fib_intent *b)
+{
+	if (a->dest != b->dest)
+		return a->dest < b->dest ? -1 : 1;
+	return 0;
+}
+
+static uint32_t bgp_fib_intent_hash_key(const struct bgp_fib_intent *fi)
+{
+	return jhash(&fi->dest, sizeof(fi->dest), 0x46494221);
+}
+
+DECLARE_DLIST(bgp_fib_intent_fifo, struct bgp_fib_intent, fifo_item);
+DECLARE_HASH(bgp_fib_intent_hash, struct bgp_fib_intent, hash_item,
+	     bgp_fib_intent_cmp, bgp_fib_intent_hash_key);
+
+static struct bgp_fib_intent_fifo_head bgp_fib_fifo;
+static struct bgp_fib_intent_hash_head bgp_fib_hash;
+static struct thread *bgp_fib_flush_thread;
+static bool bgp_fib_blocked;
+
+static bool bgp_zebra_fib_eligible(struct bgp_path_info *pi)
+{
+	return pi->type == ZEBRA_ROUTE_BGP
+	       && (pi->sub_type == BGP_ROUTE_NORMAL
+		   || pi->sub_type == BGP_ROUTE_AGGREGATE
+		   || pi->sub_type == BGP_ROUTE_IMPORTED);
+}
+
+static struct bgp_path_info *bgp_zebra_fib_selected(struct bgp_dest *dest)
+{
+	struct bgp_path_info *pi;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED)
+		    && !CHECK_FLAG(pi->flags, BGP_PATH_REMOVED)
+		    && bgp_zebra_fib_eligible(pi))
+			return pi;
+
+	return NULL;
+}
+
+static void bgp_fib_intent_free(struct bgp_fib_intent *fi)
+{
+	fi->bgp->fib_queued[fi->afi][fi->safi]--;
+	if (fi->withdraw)
+		bgp_path_info_unlock(fi->withdraw);
+	bgp_dest_unlock_node(fi->dest);
+	bgp_unlock(fi->bgp);
+	XFREE(MTYPE_BGP_FIB_INTENT, fi);
+}
+
+/* Recompute the install rate of every instance about once a second */
+void bgp_zebra_fib_rate_update(void)
+{
+	struct listnode *node;
+	struct bgp *bgp;
+	int64_t now = monotime(NULL);
+	int64_t elapsed;
+	afi_t afi;
+	safi_t safi;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		elapsed = now - bgp->fib_rate_time;
+		if (elapsed < 1000000)
+			continue;
+
+		FOREACH_AFI_SAFI (afi, safi) {
+			bgp->fib_rate[afi][safi] =
+				(bgp->fib_installs[afi][safi]
+				 + bgp->fib_withdraws[afi][safi]
+				 - bgp->fib_rate_base[afi][safi])
+				* 1000000 / elapsed;
+			bgp->fib_rate_base[afi][safi] =
+				bgp->fib_installs[afi][safi]
+				+ bgp->fib_withdraws[afi][safi];
+		}
+		bgp->fib_rate_time = now;
+	}
+}
+
+static void bgp_zebra_fib_intent_run(struct bgp_fib_intent *fi)
+{
+	struct bgp *bgp = fi->bgp;
+	struct bgp_dest *dest = fi->dest;
+	const struct prefix *p = bgp_dest_get_prefix(dest);
+	struct bgp_path_info *sel;
+
+	if (CHECK_FLAG(bgp->flags, BGP_FLAG_DELETE_IN_PROGRESS))
+		return;
+
+	sel = bgp_zebra_fib_selected(dest);
+	latency_hist_add_since(&bgp->conv_zebra, &dest->rx_time);
+
+	/* An evpn imported type-5 prefix has to be withdrawn first to clear
+	 * the nh neigh and the RMAC entry; a route that moved to another
+	 * table has to be removed from the old one.
+	 */
+	if (fi->withdraw
+	    && (!sel || is_route_parent_evpn(fi->withdraw)
+		|| fi->withdraw->attr->rmap_table_id
+			   != sel->attr->rmap_table_id)) {
+		bgp_zebra_withdraw(p, fi->withdraw, bgp, fi->safi);
+		bgp->fib_withdraws[fi->afi][fi->safi]++;
+	}
+
+	if (sel) {
+		bgp_zebra_announce(dest, p, sel, bgp, fi->afi, fi->safi);
+		bgp->fib_installs[fi->afi][fi->safi]++;
+	}
+
+	/* Wait for zebra to report the route installed, if it will */
+	if (!CHECK_FLAG(dest->flags, BGP_NODE_FIB_INSTALL_PENDING))
+		timerclear(&dest->rx_time);
+}
+
+static int bgp_zebra_fib_flush(struct thread *thread)
+{
+	struct bgp_fib_intent *fi;
+	unsigned int budget = BGP_FIB_INSTALL_BATCH;
+	enum zclient_send_status status;
+
+	zclient_batch_start(zclient);
+	while (budget-- && (fi = bgp_fib_intent_fifo_pop(&bgp_fib_fifo))) {
+		bgp_fib_intent_hash_del(&bgp_fib_hash, fi);
+		bgp_zebra_fib_intent_run(fi);
+		bgp_fib_intent_free(fi);
+	}
+	status = zclient_batch_end(zclient);
+
+	bgp_zebra_fib_rate_update();
+
+	if (!bgp_fib_intent_fifo_count(&bgp_fib_fifo))
+		return 0;
+
+	/* zebra is not keeping up, wait for the write buffer to drain */
+	if (status == ZCLIENT_SEND_BUFFERED) {
+		if (BGP_DEBUG(zebra, ZEBRA))
+			zlog_debug("%s: zebra busy, %zu FIB updates held back",
+				   __func__,
+				   bgp_fib_intent_fifo_count(&bgp_fib_fifo));
+		bgp_fib_blocked = true;
+		return 0;
+	}
+
+	thread_add_event(bm->master, bgp_zebra_fib_flush, NULL, 0,
+			 &bgp_fib_flush_thread);
+	return 0;
+}
+
+static void bgp_zebra_fib_kick(void)
+{
+	if (bgp_fib_blocked)
+		return;
+
+	thread_add_event(bm->master, bgp_zebra_fib_flush, NULL, 0,
+			 &bgp_fib_flush_thread);
+}
+
+static void bgp_zebra_buffer_write_ready(void)
+{
+	if (!bgp_fib_blocked)
+		return;
+
+	bgp_fib_blocked = false;
+	if (bgp_fib_intent_fifo_count(&bgp_fib_fifo))
+		bgp_zebra_fib_kick();
+}
+
+/* Queue a FIB update for dest.  withdraw is the path currently installed
+ * in zebra for this dest, if it may need withdrawing before the new best
+ * path is installed; NULL queues an install only.
+ */
+void bgp_zebra_route_queue(struct bgp *bgp, struct bgp_dest *dest, afi_t afi,
+			   safi_t safi, struct bgp_path_info *withdraw)
+{
+	struct bgp_fib_intent *fi, lookup;
+
+	if (withdraw && !bgp_zebra_fib_eligible(withdraw))
+		withdraw = NULL;
+
+	/* Already queued: the FIB still holds whatever was installed when
+	 * the first intent was queued, so keep that withdraw.  If the first
+	 * intent was install-only, that path is the one being withdrawn now.
+	 */
+	lookup.dest = dest;
+	fi = bgp_fib_intent_hash_find(&bgp_fib_hash, &lookup);
+	if (fi) {
+		if (!fi->withdraw && withdraw)
+			fi->withdraw = bgp_path_info_lock(withdraw);
+		bgp->fib_coalesced[afi][safi]++;
+		return;
+	}
+
+	fi = XCALLOC(MTYPE_BGP_FIB_INTENT, sizeof(*fi));
+	fi->bgp = bgp_lock(bgp);
+	fi->dest = bgp_dest_lock_node(dest);
+	fi->afi = afi;
+	fi->safi = safi;
+	if (withdraw)
+		fi->withdraw = bgp_path_info_lock(withdraw);
+
+	bgp_fib_intent_hash_add(&bgp_fib_hash, fi);
+	bgp_fib_intent_fifo_add_tail(&bgp_fib_fifo, fi);
+	bgp->fib_queued[afi][safi]++;
+
+	bgp_zebra_fib_kick();
+}
+
+/* Whether a FIB update is queued for dest */
+bool bgp_zebra_route_queued(struct bgp_dest *dest)
+{
+	struct bgp_fib_intent lookup;
+
+	lookup.dest = dest;
+	return !!bgp_fib_intent_hash_find(&bgp_fib_hash, &lookup);
+}
+
+/* Drop every queued FIB update of an instance */
+void bgp_zebra_route_queue_purge(struct bgp *bgp)
+{
+	struct bgp_fib_intent *fi;
+
+	frr_each_safe (bgp_fib_intent_fifo, &bgp_fib_fifo, fi) {
+		if (fi->bgp != bgp)
+			continue;
+
+		bgp_fib_intent_fifo_del(&bgp_fib_fifo, fi);
+		bgp_fib_intent_hash_del(&bgp_fib_hash, fi);
+		bgp_fib_intent_free(fi);
+	}
+}
+
 struct bgp_redist *bgp_redist_lookup(struct bgp *bgp, afi_t afi, uint8_t type,
 				     unsigned short instance)
 {
@@ -2442,6 +2749,8 @@ static int bgp_zebra_route_notify_owner(int command, struct zclient *zclient,
 			UNSET_FLAG(dest->flags,
 				   BGP_NODE_FIB_INSTALL_PENDING);
 			SET_FLAG(dest->flags, BGP_NODE_FIB_INSTALLED);
+			latency_hist_add_since(&bgp->conv_fib, &dest->rx_time);
+			timerclear(&dest->rx_time);
 			if (BGP_DEBUG(zebra, ZEBRA))
 				zlog_debug("route %s : INSTALLED", buf);
 			/* Find the best route */
@@ -2474,6 +2783,7 @@ static int bgp_zebra_route_notify_owner(int command, struct zclient *zclient,
 		break;
 	case ZAPI_ROUTE_FAIL_INSTALL:
 		/* Error will be logged by zebra module */
+		timerclear(&dest->rx_time);
 		break;
 	case ZAPI_ROUTE_BETTER_ADMIN_WON:
 		/* No action required */
@@ -2561,6 +2871,55 @@ static void bgp_encode_pbr_ipset_match(struct stream *s,
 		   ZEBRA_IPSET_NAME_SIZE);
 }
 
+/* ipset entry adds and deletes are coalesced into a single zapi message
+ * with an entry count.  The batch is sent at the end of the current event
+ * loop iteration, or before any other PBR message so zebra still sees
+ * everything in order.
+ */
+#define BGP_PBR_ENTRY_BATCH_SIZE (ZEBRA_MAX_PACKET_SIZ - 64)
+#define BGP_PBR_ENTRY_MAX_ENCODED 128
+
+static struct stream *bgp_pbr_entry_batch;
+static uint16_t bgp_pbr_entry_batch_cmd;
+static uint32_t bgp_pbr_entry_batch_count;
+static struct thread *bgp_pbr_entry_batch_thread;
+
+static void bgp_pbr_entry_batch_flush(void)
+{
+	struct stream *s;
+
+	if (!bgp_pbr_entry_batch_count)
+		return;
+
+	THREAD_OFF(bgp_pbr_entry_batch_thread);
+
+	if (zclient) {
+		s = zclient->obuf;
+		stream_reset(s);
+
+		zclient_create_header(s, bgp_pbr_entry_batch_cmd,
+				      VRF_DEFAULT);
+		stream_putl(s, bgp_pbr_entry_batch_count);
+		stream_put(s, STREAM_DATA(bgp_pbr_entry_batch),
+			   stream_get_endp(bgp_pbr_entry_batch));
+
+		stream_putw_at(s, 0, stream_get_endp(s));
+		if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE
+		    && BGP_DEBUG(zebra, ZEBRA))
+			zlog_debug("%s: failed to send %u ipset entries",
+				   __func__, bgp_pbr_entry_batch_count);
+	}
+
+	stream_reset(bgp_pbr_entry_batch);
+	bgp_pbr_entry_batch_count = 0;
+}
+
+static int bgp_pbr_entry_batch_event(struct thread *thread)
+{
+	bgp_pbr_entry_batch_flush();
+	return 0;
+}
+
 static void bgp_encode_pbr_ipset_entry_match(struct stream *s,
 				  struct bgp_pbr_match_entry *pbime)
 {
@@ -2623,6 +2982,9 @@ static void bgp_zebra_connected(struct zclient *zclient)
 
 	zclient_num_connects++; /* increment even if not responding */
 
+	/* a new connection starts with an empty write buffer */
+	bgp_zebra_buffer_write_ready();
+
 	/* At this point, we may or may not have BGP instances configured, but
 	 * we're only interested in the default VRF (others wouldn't have learnt
 	 * the VRF from Zebra yet.)
@@ -2867,11 +3229,9 @@ static int bgp_zebra_process_local_macip(ZAPI_CALLBACK_ARGS)
 			   ipaddr2str(&ip, buf1, sizeof(buf1)), vni, seqnum,
 			   state, esi_to_str(&esi, buf2, sizeof(buf2)));
 
-	if (cmd == ZEBRA_MACIP_ADD)
-		return bgp_evpn_local_macip_add(bgp, vni, &mac, &ip,
-						flags, seqnum, &esi);
-	else
-		return bgp_evpn_local_macip_del(bgp, vni, &mac, &ip, state);
+	return bgp_evpn_local_macip_queue(bgp, vni, cmd == ZEBRA_MACIP_ADD,
+					  &mac, &ip, flags, seqnum, &esi,
+					  state);
 }
 
 static void bgp_zebra_process_local_ip_prefix(ZAPI_CALLBACK_ARGS)
@@ -2979,13 +3339,17 @@ static int bgp_ifp_create(struct interface *ifp)
 
 void bgp_zebra_init(struct thread_master *master, unsigned short instance)
 {
+	/* full table pushes are what the shared-memory ring is for */
+	struct zclient_options opt = zclient_options_default;
+
+	opt.shm_ring = true;
 	zclient_num_connects = 0;
 
 	if_zapi_callbacks(bgp_ifp_create, bgp_ifp_up,
 			  bgp_ifp_down, bgp_ifp_destroy);
 
 	/* Set default values. */
-	zclient = zclient_new(master, &zclient_options_default);
+	zclient = zclient_new(master, &opt);
 	zclient_init(zclient, ZEBRA_ROUTE_BGP, 0, &bgpd_privs);
 	zclient->zebra_connected = bgp_zebra_connected;
 	zclient->router_id_update = bgp_router_id_update;
@@ -3018,11 +3382,33 @@ void bgp_zebra_init(struct thread_master *master, unsigned short instance)
 	zclient->ipset_entry_notify_owner = ipset_entry_notify_owner;
 	zclient->iptable_notify_owner = iptable_notify_owner;
 	zclient->route_notify_owner = bgp_zebra_route_notify_owner;
+	zclient->zebra_buffer_write_ready = bgp_zebra_buffer_write_ready;
 	zclient->instance = instance;
+
+	bgp_fib_intent_fifo_init(&bgp_fib_fifo);
+	bgp_fib_intent_hash_init(&bgp_fib_hash);
 }
 
 void bgp_zebra_destroy(void)
 {
+	struct bgp_fib_intent *fi;
+
+	THREAD_OFF(bgp_fib_flush_thread);
+	while ((fi = bgp_fib_intent_fifo_pop(&bgp_fib_fifo))) {
+		bgp_fib_intent_hash_del(&bgp_fib_hash, fi);
+		bgp_fib_intent_free(fi);
+	}
+	bgp_fib_intent_hash_fini(&bgp_fib_hash);
+	bgp_fib_intent_fifo_fini(&bgp_fib_fifo);
+	bgp_fib_blocked = false;
+
+	THREAD_OFF(bgp_pbr_entry_batch_thread);
+	if (bgp_pbr_entry_batch) {
+		stream_free(bgp_pbr_entry_batch);
+		bgp_pbr_entry_batch = NULL;
+	}
+	bgp_pbr_entry_batch_count = 0;
+
 	if (zclient == NULL)
 		return;
 	zclient_stop(zclient);
@@ -3045,6 +3431,7 @@ void bgp_send_pbr_rule_action(struct bgp_pbr_action *pbra,
 		return;
 	if (pbr && pbr->install_in_progress)
 		return;
+	bgp_pbr_entry_batch_flush();
 	if (BGP_DEBUG(zebra, ZEBRA)) {
 		if (pbr)
 			zlog_debug("%s: table %d (ip rule) %d", __func__,
@@ -3079,6 +3466,7 @@ void bgp_send_pbr_ipset_match(struct bgp_pbr_match *pbrim, bool install)
 
 	if (pbrim->install_in_progress)
 		return;
+	bgp_pbr_entry_batch_flush();
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: name %s type %d %d, ID %u", __func__,
 			   pbrim->ipset_name, pbrim->type, install,
@@ -3103,7 +3491,8 @@ void bgp_send_pbr_ipset_match(struct bgp_pbr_match *pbrim, bool install)
 void bgp_send_pbr_ipset_entry_match(struct bgp_pbr_match_entry *pbrime,
 				    bool install)
 {
-	struct stream *s;
+	uint16_t cmd = install ? ZEBRA_IPSET_ENTRY_ADD
+			       : ZEBRA_IPSET_ENTRY_DELETE;
 
 	if (pbrime->install_in_progress)
 		return;
@@ -3111,21 +3500,24 @@ void bgp_send_pbr_ipset_entry_match(struct bgp_pbr_match_entry *pbrime,
 		zlog_debug("%s: name %s %d %d, ID %u", __func__,
 			   pbrime->backpointer->ipset_name, pbrime->unique,
 			   install, pbrime->unique);
-	s = zclient->obuf;
-	stream_reset(s);
-
-	zclient_create_header(s,
-			      install ? ZEBRA_IPSET_ENTRY_ADD :
-			      ZEBRA_IPSET_ENTRY_DELETE,
-			      VRF_DEFAULT);
 
-	stream_putl(s, 1); /* send one pbr action */
+	if (bgp_pbr_entry_batch_count && bgp_pbr_entry_batch_cmd != cmd)
+		bgp_pbr_entry_batch_flush();
+	if (!bgp_pbr_entry_batch)
+		bgp_pbr_entry_batch = stream_new(BGP_PBR_ENTRY_BATCH_SIZE);
+	else if (STREAM_WRITEABLE(bgp_pbr_entry_batch)
+		 < BGP_PBR_ENTRY_MAX_ENCODED)
+		bgp_pbr_entry_batch_flush();
 
-	bgp_encode_pbr_ipset_entry_match(s, pbrime);
+	bgp_encode_pbr_ipset_entry_match(bgp_pbr_entry_batch, pbrime);
+	bgp_pbr_entry_batch_cmd = cmd;
+	bgp_pbr_entry_batch_count++;
 
-	stream_putw_at(s, 0, stream_get_endp(s));
-	if ((zclient_send_message(zclient) != ZCLIENT_SEND_FAILURE) && install)
+	if (install)
 		pbrime->install_in_progress = true;
+
+	thread_add_event(bm->master, bgp_pbr_entry_batch_event, NULL, 0,
+			 &bgp_pbr_entry_batch_thread);
 }
 
 static void bgp_encode_pbr_interface_list(struct bgp *bgp, struct stream *s,
@@ -3179,6 +3571,7 @@ void bgp_send_pbr_iptable(struct bgp_pbr_action *pba,
 
 	if (pbm->install_iptable_in_progress)
 		return;
+	bgp_pbr_entry_batch_flush();
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: name %s type %d mark %d %d, ID %u", __func__,
 			   pbm->ipset_name, pbm->type, pba->fwmark, install,
@@ -43,6 +43,16 @@ extern void bgp_zebra_withdraw(const struct prefix *p,
 			       struct bgp_path_info *path, struct bgp *bgp,
 			       safi_t safi);
 
+/* Max FIB updates sent to zebra per run of the install queue */
+#define BGP_FIB_INSTALL_BATCH 1000
+
+extern void bgp_zebra_route_queue(struct bgp *bgp, struct bgp_dest *dest,
+				  afi_t afi, safi_t safi,
+				  struct bgp_path_info *withdraw);
+extern void bgp_zebra_route_queue_purge(struct bgp *bgp);
+extern bool bgp_zebra_route_queued(struct bgp_dest *dest);
+extern void bgp_zebra_fib_rate_update(void);
+
 /* Announce routes of any bgp subtype of a table to zebra */
 extern void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
 						  safi_t safi);
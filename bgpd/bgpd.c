@@ -82,6 +82,8 @@
 #include "bgpd/bgp_evpn_vty.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_select.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_labelpool.h"
@@ -1076,6 +1078,9 @@ static void peer_free(struct peer *peer)
 
 	QOBJ_UNREG(peer);
 
+	/* route-map match results are memoized on the peer's address */
+	route_map_cache_invalidate();
+
 	/* this /ought/ to have been done already through bgp_stop earlier,
 	 * but just to be sure..
 	 */
@@ -1130,8 +1135,10 @@ static void peer_free(struct peer *peer)
 
 	bfd_info_free(&(peer->bfd_info));
 
-	FOREACH_AFI_SAFI (afi, safi)
+	FOREACH_AFI_SAFI (afi, safi) {
 		bgp_addpath_set_peer_type(peer, afi, safi, BGP_ADDPATH_NONE);
+		bgp_peer_paths_fini(&peer->paths[afi][safi]);
+	}
 
 	bgp_unlock(peer->bgp);
 
@@ -1315,6 +1322,8 @@ struct peer *peer_new(struct bgp *bgp)
 
 	/* Set default flags. */
 	FOREACH_AFI_SAFI (afi, safi) {
+		bgp_peer_paths_init(&peer->paths[afi][safi]);
+
 		SET_FLAG(peer->af_flags[afi][safi], PEER_FLAG_SEND_COMMUNITY);
 		SET_FLAG(peer->af_flags[afi][safi],
 			 PEER_FLAG_SEND_EXT_COMMUNITY);
@@ -1342,6 +1351,8 @@ struct peer *peer_new(struct bgp *bgp)
 	/* Create buffers.  */
 	peer->ibuf = stream_fifo_new();
 	peer->obuf = stream_fifo_new();
+	peer->ibuf_parse = stream_fifo_new();
+	bgp_preparse_init(&peer->ibuf_pre);
 	pthread_mutex_init(&peer->io_mtx, NULL);
 
 	/* We use a larger buffer for peer->obuf_work in the event that:
@@ -1358,8 +1369,8 @@ struct peer *peer_new(struct bgp *bgp)
 	 */
 	peer->obuf_work =
 		stream_new(BGP_MAX_PACKET_SIZE + BGP_MAX_PACKET_SIZE_OVERFLOW);
-	peer->ibuf_work =
-		ringbuf_new(BGP_MAX_PACKET_SIZE * BGP_READ_PACKET_MAX);
+	peer->ibuf_work = ringbuf_new(BGP_IBUF_WORK_SIZE);
+	peer->max_packet_size = BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE;
 
 	peer->scratch = stream_new(BGP_MAX_PACKET_SIZE);
 
@@ -1761,6 +1772,29 @@ int bgp_afi_safi_peer_exists(struct bgp *bgp, afi_t afi, safi_t safi)
 	return 0;
 }
 
+/*
+ * Same as bgp_afi_safi_peer_exists() for all AFI/SAFIs at once, so code
+ * looping over address families walks the peer list only once.
+ */
+void bgp_afi_safi_peer_map(struct bgp *bgp, bool exists[AFI_MAX][SAFI_MAX])
+{
+	struct listnode *node;
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	memset(exists, 0, sizeof(bool) * AFI_MAX * SAFI_MAX);
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
+			continue;
+
+		FOREACH_AFI_SAFI (afi, safi)
+			if (peer->afc[afi][safi])
+				exists[afi][safi] = true;
+	}
+}
+
 /* Change peer's AS number.  */
 void peer_as_change(struct peer *peer, as_t as, int as_specified)
 {
@@ -2406,6 +2440,13 @@ int peer_delete(struct peer *peer)
 	}
 
 	/* Buffers.  */
+	if (peer->ibuf_parse) {
+		bgp_preparse_clean(peer);
+		bgp_preparse_fini(&peer->ibuf_pre);
+		stream_fifo_free(peer->ibuf_parse);
+		peer->ibuf_parse = NULL;
+	}
+
 	if (peer->ibuf) {
 		stream_fifo_free(peer->ibuf);
 		peer->ibuf = NULL;
@@ -3442,10 +3483,14 @@ int bgp_delete(struct bgp *bgp)
 	THREAD_OFF(bgp->t_maxmed_onstartup);
 	THREAD_OFF(bgp->t_update_delay);
 	THREAD_OFF(bgp->t_establish_wait);
+	THREAD_OFF(bgp->t_nht_pending);
 
 	/* Set flag indicating bgp instance delete in progress */
 	SET_FLAG(bgp->flags, BGP_FLAG_DELETE_IN_PROGRESS);
 
+	/* Routes are withdrawn from zebra below, drop queued FIB updates */
+	bgp_zebra_route_queue_purge(bgp);
+
 	/* Delete the graceful restart info */
 	FOREACH_AFI_SAFI (afi, safi) {
 		struct thread *t;
@@ -3549,6 +3594,7 @@ int bgp_delete(struct bgp *bgp)
 	 * routes to be processed still referencing the struct bgp.
 	 */
 	listnode_delete(bm->bgp, bgp);
+	vpn_leak_rt_index_invalidate();
 
 	/* Free interfaces in this instance. */
 	bgp_if_finish(bgp);
@@ -7316,6 +7362,8 @@ void bgp_master_init(struct thread_master *master, const int buffer_size)
 	bm->v_establish_wait = BGP_UPDATE_DELAY_DEF;
 	bm->terminating = false;
 	bm->socket_buffer = buffer_size;
+	bm->parse_threads = -1;
+	bm->select_threads = -1;
 
 	bgp_mac_init();
 	/* init the rd id space.
@@ -7417,8 +7465,13 @@ static void bgp_pthreads_init(void)
 		.start = bgp_keepalives_start,
 		.stop = bgp_keepalives_stop,
 	};
+
+	bgp_io_init();
 	bgp_pth_io = frr_pthread_new(&io, "BGP I/O thread", "bgpd_io");
 	bgp_pth_ka = frr_pthread_new(&ka, "BGP Keepalives thread", "bgpd_ka");
+
+	bgp_parse_pthreads_init(bm->parse_threads);
+	bgp_select_pthreads_init(bm->select_threads);
 }
 
 void bgp_pthreads_run(void)
@@ -7429,11 +7482,15 @@ void bgp_pthreads_run(void)
 	/* Wait until threads are ready. */
 	frr_pthread_wait_running(bgp_pth_io);
 	frr_pthread_wait_running(bgp_pth_ka);
+
+	bgp_parse_pthreads_run();
+	bgp_select_pthreads_run();
 }
 
 void bgp_pthreads_finish(void)
 {
 	frr_pthread_stop_all();
+	bgp_io_finish();
 }
 
 void bgp_init(unsigned short instance)
@@ -7462,6 +7519,7 @@ void bgp_init(unsigned short instance)
 	bgp_route_init();
 	bgp_route_map_init();
 	bgp_scan_vty_init();
+	bgp_lp_vty_init();
 	bgp_mplsvpn_init();
 #ifdef ENABLE_BGP_VNC
 	rfapi_init();
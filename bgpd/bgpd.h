@@ -39,6 +39,7 @@
 #include "defaults.h"
 #include "bgp_memory.h"
 #include "bitfield.h"
+#include "latency.h"
 #include "vxlan.h"
 #include "bgp_labelpool.h"
 #include "bgp_addpath_types.h"
@@ -110,6 +111,18 @@ enum bgp_af_index {
 extern struct frr_pthread *bgp_pth_io;
 extern struct frr_pthread *bgp_pth_ka;
 
+PREDECL_LIST(bgp_preparse)
+PREDECL_DLIST(bgp_peer_paths)
+
+/* Objects held by a table or received from a peer, counted as they are
+ * created and freed so "show bgp memory detail" needn't walk the tables.
+ */
+struct bgp_mem_stats {
+	uint32_t paths;
+	uint32_t adj_in;
+	uint32_t adj_out;
+};
+
 /* BGP master for system wide configurations and variables.  */
 struct bgp_master {
 	/* BGP instance list.  */
@@ -159,6 +172,12 @@ struct bgp_master {
 	/* How big should we set the socket buffer size */
 	uint32_t socket_buffer;
 
+	/* UPDATE pre-parsing pthreads, < 0 for automatic */
+	int parse_threads;
+
+	/* best-path selection pthreads, < 0 for automatic */
+	int select_threads;
+
 	/* EVPN multihoming */
 	struct bgp_evpn_mh_info *mh_info;
 
@@ -226,6 +245,12 @@ struct vpn_policy {
 	 * vrf names that we are being exported to.
 	 */
 	struct list *export_vrf;
+
+	/* Queued for a walk of the VPN table to import from */
+	bool import_pending;
+
+	/* Last route-target index lookup this instance matched in */
+	uint32_t rt_index_stamp;
 };
 
 /*
@@ -265,6 +290,16 @@ struct graceful_restart_info {
 	uint32_t gr_deferred;
 	/* Best route select */
 	struct thread *t_route_select;
+	/* Deferred dests selected so far, out of how many */
+	uint32_t gr_selected;
+	uint32_t gr_select_total;
+	/* Dests to select before checking whether to yield */
+	uint32_t gr_select_chunk;
+	/* Where the next run picks up, valid while t_route_select is set */
+	struct prefix gr_select_next;
+	/* When the last deferred selection started and finished */
+	time_t gr_select_start;
+	time_t gr_select_end;
 	/* AFI, SAFI enabled */
 	bool af_enabled[AFI_MAX][SAFI_MAX];
 	/* Route update completed */
@@ -351,11 +386,18 @@ struct bgp {
 		uint32_t peer_refreshes_combined;
 		uint32_t adj_count;
 		uint32_t merge_checks_triggered;
+		uint32_t slow_peer_splits;
 
 		uint32_t updgrps_created;
 		uint32_t updgrps_deleted;
 		uint32_t subgrps_created;
 		uint32_t subgrps_deleted;
+
+		uint32_t attr_tmpl_hits;
+		uint32_t attr_tmpl_misses;
+
+		uint32_t export_hits;
+		uint32_t export_denials;
 	} update_group_stats;
 
 	/* BGP configuration.  */
@@ -460,6 +502,7 @@ struct bgp {
 /* This flag is set if the instance is in administrative shutdown */
 #define BGP_FLAG_SHUTDOWN                 (1 << 27)
 #define BGP_FLAG_SUPPRESS_FIB_PENDING     (1 << 28)
+#define BGP_FLAG_PIC                      (1 << 29)
 
 	enum global_mode GLOBAL_GR_FSM[BGP_GLOBAL_GR_MODE]
 				      [BGP_GLOBAL_GR_EVENT_CMD];
@@ -494,6 +537,10 @@ struct bgp {
 	/* Tree for import-check */
 	struct bgp_nexthop_cache_head import_check_table[AFI_MAX];
 
+	/* Nexthops with updates from zebra not yet applied to their paths */
+	struct bgp_nht_pending_head nht_pending;
+	struct thread *t_nht_pending;
+
 	struct bgp_table *connected_table[AFI_MAX];
 
 	struct hash *address_hash;
@@ -541,6 +588,15 @@ struct bgp {
 	struct hash *pbr_rule_hash;
 	struct hash *pbr_action_hash;
 
+	/* the above indexed by their self-allocated unique identifiers,
+	 * for lookups on zebra install notifications
+	 */
+	struct hash *pbr_match_unique_hash;
+	struct hash *pbr_match_iptable_unique_hash;
+	struct hash *pbr_match_entry_unique_hash;
+	struct hash *pbr_rule_unique_hash;
+	struct hash *pbr_action_unique_hash;
+
 	/* timer to re-evaluate neighbor default-originate route-maps */
 	struct thread *t_rmap_def_originate_eval;
 #define RMAP_DEFAULT_ORIGINATE_EVAL_TIMER 5
@@ -556,6 +612,9 @@ struct bgp {
 	/* BGP default subgroup pkt queue max  */
 	uint32_t default_subgroup_pkt_queue_max;
 
+	/* Memory cap of subgroup packet queues, in MB; 0 for none */
+	uint32_t subgroup_pkt_queue_mem_max;
+
 	/* BGP default timer.  */
 	uint32_t default_holdtime;
 	uint32_t default_keepalive;
@@ -689,6 +748,25 @@ struct bgp {
 	uint32_t condition_filter_count;
 	struct thread *t_condition_check;
 
+	/* FIB install queue statistics, see bgp_zebra_route_queue() */
+	uint64_t fib_installs[AFI_MAX][SAFI_MAX];
+	uint64_t fib_withdraws[AFI_MAX][SAFI_MAX];
+	uint64_t fib_coalesced[AFI_MAX][SAFI_MAX];
+	uint32_t fib_queued[AFI_MAX][SAFI_MAX];
+	uint64_t fib_rate_base[AFI_MAX][SAFI_MAX];
+	uint64_t fib_rate[AFI_MAX][SAFI_MAX];
+	int64_t fib_rate_time;
+
+	/* Time from receiving an UPDATE to best path selection, to sending
+	 * the route to zebra and to zebra reporting it installed.
+	 */
+	struct latency_hist conv_bestpath;
+	struct latency_hist conv_zebra;
+	struct latency_hist conv_fib;
+
+	/* Memory accounting per table */
+	struct bgp_mem_stats mem_stats[AFI_MAX][SAFI_MAX];
+
 	QOBJ_FIELDS
 };
 DECLARE_QOBJ_TYPE(bgp)
@@ -820,6 +898,12 @@ struct bgp_filter {
 		struct route_map *cmap;
 
 		enum update_type update_type;
+
+		/* Last condition-map evaluation result, and the prefix that
+		 * satisfied it, used to re-evaluate incrementally.
+		 */
+		bool cmap_present;
+		struct prefix cmap_witness;
 	} advmap;
 };
 
@@ -836,7 +920,9 @@ typedef enum {
 /* BGP message header and packet size.  */
 #define BGP_MARKER_SIZE		                16
 #define BGP_HEADER_SIZE		                19
-#define BGP_MAX_PACKET_SIZE                   4096
+#define BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE  4096
+#define BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE  65535 /* RFC 8654 */
+#define BGP_MAX_PACKET_SIZE                   BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE
 #define BGP_MAX_PACKET_SIZE_OVERFLOW          1024
 
 /*
@@ -969,14 +1055,28 @@ struct peer {
 	struct in_addr local_id;
 
 	/* Packet receive and send buffer. */
-	pthread_mutex_t io_mtx;   // guards ibuf, obuf
+	pthread_mutex_t io_mtx;   // guards ibuf, obuf, ibuf_parse, ibuf_pre
 	struct stream_fifo *ibuf; // packets waiting to be processed
 	struct stream_fifo *obuf; // packets waiting to be written
+	struct stream_fifo *ibuf_parse; // packets waiting to be pre-parsed
+	struct bgp_preparse_head ibuf_pre; // pre-parsed data for ibuf
 
 	struct ringbuf *ibuf_work; // WiP buffer used by bgp_read() only
 	struct stream *obuf_work;  // WiP buffer used to construct packets
 
+	/* biggest message that may be exchanged, see RFC 8654 */
+	uint16_t max_packet_size;
+
+	/* Write scheduling (see bgp_write()), I/O pthread only */
+	uint32_t wpkt_deficit;    // bytes this peer may still write
+	uint64_t obuf_rate_bytes; // bytes written since obuf_rate_time
+	time_t obuf_rate_time;
+	/* for show commands */
+	_Atomic uint32_t wpkt_quantum; // bytes credited per turn, last one
+	_Atomic uint32_t obuf_rate;    // bytes per second written, smoothed
+
 	struct stream *curr; // the current packet being parsed
+	struct bgp_preparse *curr_pre; // pre-parsed data for curr
 
 	/* We use a separate stream to encode MP_REACH_NLRI for efficient
 	 * NLRI packing. peer->obuf_work stores all the other attributes. The
@@ -1054,6 +1154,8 @@ struct peer {
 #define PEER_CAP_ENHE_RCV                   (1U << 14) /* Extended nexthop received */
 #define PEER_CAP_HOSTNAME_ADV               (1U << 15) /* hostname advertised */
 #define PEER_CAP_HOSTNAME_RCV               (1U << 16) /* hostname received */
+#define PEER_CAP_EXTENDED_MESSAGE_ADV       (1U << 17) /* extended message advertised */
+#define PEER_CAP_EXTENDED_MESSAGE_RCV       (1U << 18) /* extended message received */
 
 	/* Capability flags (reset in bgp_stop) */
 	uint32_t af_cap[AFI_MAX][SAFI_MAX];
@@ -1181,6 +1283,8 @@ struct peer {
 
 	/* NSF mode (graceful restart) */
 	uint8_t nsf[AFI_MAX][SAFI_MAX];
+	/* Adj-RIB-In reloaded from the journal, not reconciled yet */
+	bool adj_in_stale[AFI_MAX][SAFI_MAX];
 	/* EOR Send time */
 	time_t eor_stime[AFI_MAX][SAFI_MAX];
 	/* Last update packet sent time */
@@ -1269,6 +1373,9 @@ struct peer {
 	_Atomic uint32_t v_pmax_restart;
 	_Atomic uint32_t v_gr_restart;
 
+	/* most a keepalive went out late, in usecs, see bgp_keepalives.c */
+	_Atomic uint32_t v_keepalive_drift;
+
 	/* Threads. */
 	struct thread *t_read;
 	struct thread *t_write;
@@ -1283,6 +1390,10 @@ struct peer {
 	struct thread *t_gr_stale;
 	struct thread *t_generate_updgrp_packets;
 	struct thread *t_process_packet;
+	struct thread *t_parse;
+
+	/* Running inbound soft reconfiguration, see bgp_route.c */
+	struct bgp_soft_reconfig *soft_reconfig[AFI_MAX][SAFI_MAX];
 
 	/* Thread flags. */
 	_Atomic uint32_t thread_flags;
@@ -1294,6 +1405,12 @@ struct peer {
 	/* workqueues */
 	struct work_queue *clear_node_queue;
 
+	/* bgp_path_info received from this peer, per AFI/SAFI */
+	struct bgp_peer_paths_head paths[AFI_MAX][SAFI_MAX];
+
+	/* Memory accounting; adj_out is kept by the update-groups */
+	struct bgp_mem_stats mem_stats[AFI_MAX][SAFI_MAX];
+
 #define PEER_TOTAL_RX(peer)                                                    \
 	atomic_load_explicit(&peer->open_in, memory_order_relaxed)             \
 		+ atomic_load_explicit(&peer->update_in, memory_order_relaxed) \
@@ -1456,7 +1573,8 @@ struct peer {
 	 */
 
 	size_t last_reset_cause_size;
-	uint8_t last_reset_cause[BGP_MAX_PACKET_SIZE];
+	/* truncated if the packet was an extended message */
+	uint8_t last_reset_cause[BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE];
 
 	/* The kind of route-map Flags.*/
 	uint16_t rmap_type;
@@ -1482,7 +1600,7 @@ struct peer {
 
 	/* Conditional advertisement */
 	bool advmap_config_change[AFI_MAX][SAFI_MAX];
-	bool advmap_table_change;
+	bool advmap_table_change[AFI_MAX][SAFI_MAX];
 
 	QOBJ_FIELDS
 };
@@ -1892,6 +2010,8 @@ extern int bgp_listen_limit_unset(struct bgp *);
 extern bool bgp_update_delay_active(struct bgp *);
 extern bool bgp_update_delay_configured(struct bgp *);
 extern int bgp_afi_safi_peer_exists(struct bgp *bgp, afi_t afi, safi_t safi);
+extern void bgp_afi_safi_peer_map(struct bgp *bgp,
+				  bool exists[AFI_MAX][SAFI_MAX]);
 extern void peer_as_change(struct peer *, as_t, int);
 extern int peer_remote_as(struct bgp *, union sockunion *, const char *, as_t *,
 			  int, afi_t, safi_t);
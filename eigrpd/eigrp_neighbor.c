@@ -182,6 +182,9 @@ void eigrp_nbr_delete(struct eigrp_neighbor *nbr)
 	eigrp_fifo_free(nbr->multicast_queue);
 	eigrp_fifo_free(nbr->retrans_queue);
 	THREAD_OFF(nbr->t_holddown);
+	THREAD_OFF(nbr->t_reply);
+	if (nbr->reply)
+		eigrp_packet_free(nbr->reply);
 
 	if (nbr->ei)
 		listnode_delete(nbr->ei->nbrs, nbr);
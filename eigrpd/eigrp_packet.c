@@ -665,6 +665,10 @@ int eigrp_read(struct thread *thread)
 		}
 	}
 
+	/* All the routing table changes caused by one packet reach zebra in
+	 * as few writes as possible.
+	 */
+	eigrp_zebra_batch_start();
 
 	switch (opcode) {
 	case EIGRP_OPC_HELLO:
@@ -700,6 +704,8 @@ int eigrp_read(struct thread *thread)
 		break;
 	}
 
+	eigrp_zebra_batch_end();
+
 	return 0;
 }
 
@@ -212,6 +212,7 @@ void eigrp_send_query(struct eigrp_interface *ei)
 
 			ep->sequence_number = ei->eigrp->sequence_number;
 			ei->eigrp->sequence_number++;
+			ei->query_out++;
 
 			for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr)) {
 				struct eigrp_packet *dup;
@@ -228,7 +229,7 @@ void eigrp_send_query(struct eigrp_interface *ei)
 			}
 
 			has_tlv = false;
-			length = 0;
+			length = EIGRP_HEADER_LEN;
 			eigrp_packet_free(ep);
 			ep = NULL;
 			new_packet = true;
@@ -252,6 +253,7 @@ void eigrp_send_query(struct eigrp_interface *ei)
 	/*This ack number we await from neighbor*/
 	ep->sequence_number = ei->eigrp->sequence_number;
 	ei->eigrp->sequence_number++;
+	ei->query_out++;
 
 	for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr)) {
 		struct eigrp_packet *dup;
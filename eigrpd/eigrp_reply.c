@@ -61,13 +61,67 @@
 #include "eigrpd/eigrp_memory.h"
 #include "eigrpd/eigrp_errors.h"
 
+/* Finish the reply being built for this neighbor and queue it */
+static void eigrp_reply_finish(struct eigrp_neighbor *nbr)
+{
+	struct eigrp_packet *ep = nbr->reply;
+	struct eigrp_interface *ei = nbr->ei;
+	struct eigrp *eigrp = ei->eigrp;
+	struct eigrp_header *eigrph;
+
+	nbr->reply = NULL;
+	THREAD_OFF(nbr->t_reply);
+
+	/* Other packets may have been sent since the header was written */
+	eigrph = (struct eigrp_header *)STREAM_DATA(ep->s);
+	eigrph->sequence = htonl(eigrp->sequence_number);
+
+	if ((ei->params.auth_type == EIGRP_AUTH_TYPE_MD5)
+	    && (ei->params.auth_keychain != NULL)) {
+		eigrp_make_md5_digest(ei, ep->s, EIGRP_AUTH_UPDATE_FLAG);
+	}
+
+	/* EIGRP Checksum */
+	eigrp_packet_checksum(ei, ep->s, nbr->reply_length);
+
+	ep->length = nbr->reply_length;
+	ep->dst.s_addr = nbr->src.s_addr;
+
+	/*This ack number we await from neighbor*/
+	ep->sequence_number = eigrp->sequence_number;
+	ei->reply_out++;
+
+	/*Put packet to retransmission queue*/
+	eigrp_fifo_push(nbr->retrans_queue, ep);
+
+	if (nbr->retrans_queue->count == 1) {
+		eigrp_send_packet_reliably(nbr);
+	}
+}
+
+static int eigrp_reply_flush(struct thread *thread)
+{
+	struct eigrp_neighbor *nbr = THREAD_ARG(thread);
+
+	if (nbr->reply)
+		eigrp_reply_finish(nbr);
+
+	return 0;
+}
+
+/*
+ * Replies are not sent right away: the TLVs for all the prefixes a
+ * neighbor is owed a reply for are packed into a single packet, which is
+ * sent once the current wave of DUAL events has been processed or when it
+ * is full.
+ */
 void eigrp_send_reply(struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
 {
 	struct eigrp_packet *ep;
-	uint16_t length = EIGRP_HEADER_LEN;
 	struct eigrp_interface *ei = nbr->ei;
 	struct eigrp *eigrp = ei->eigrp;
 	struct eigrp_prefix_entry *pe2;
+	uint16_t eigrp_mtu = EIGRP_PACKET_MTU(ei->ifp->mtu);
 
 	// TODO: Work in progress
 	/* Filtering */
@@ -86,41 +140,29 @@ void eigrp_send_reply(struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
 	 * End of filtering
 	 */
 
-	ep = eigrp_packet_new(EIGRP_PACKET_MTU(ei->ifp->mtu), nbr);
-
-	/* Prepare EIGRP INIT UPDATE header */
-	eigrp_packet_header_init(EIGRP_OPC_REPLY, eigrp, ep->s, 0,
-				 eigrp->sequence_number, 0);
+	if (nbr->reply
+	    && nbr->reply_length + EIGRP_TLV_MAX_IPV4_BYTE > eigrp_mtu)
+		eigrp_reply_finish(nbr);
 
-	// encode Authentication TLV, if needed
-	if (ei->params.auth_type == EIGRP_AUTH_TYPE_MD5
-	    && (ei->params.auth_keychain != NULL)) {
-		length += eigrp_add_authTLV_MD5_to_stream(ep->s, ei);
-	}
+	if (!nbr->reply) {
+		ep = eigrp_packet_new(eigrp_mtu, nbr);
 
+		/* Prepare EIGRP INIT UPDATE header */
+		eigrp_packet_header_init(EIGRP_OPC_REPLY, eigrp, ep->s, 0,
+					 eigrp->sequence_number, 0);
+		nbr->reply_length = EIGRP_HEADER_LEN;
 
-	length += eigrp_add_internalTLV_to_stream(ep->s, pe2);
-
-	if ((ei->params.auth_type == EIGRP_AUTH_TYPE_MD5)
-	    && (ei->params.auth_keychain != NULL)) {
-		eigrp_make_md5_digest(ei, ep->s, EIGRP_AUTH_UPDATE_FLAG);
+		// encode Authentication TLV, if needed
+		if (ei->params.auth_type == EIGRP_AUTH_TYPE_MD5
+		    && (ei->params.auth_keychain != NULL)) {
+			nbr->reply_length +=
+				eigrp_add_authTLV_MD5_to_stream(ep->s, ei);
+		}
+		nbr->reply = ep;
 	}
 
-	/* EIGRP Checksum */
-	eigrp_packet_checksum(ei, ep->s, length);
-
-	ep->length = length;
-	ep->dst.s_addr = nbr->src.s_addr;
-
-	/*This ack number we await from neighbor*/
-	ep->sequence_number = eigrp->sequence_number;
-
-	/*Put packet to retransmission queue*/
-	eigrp_fifo_push(nbr->retrans_queue, ep);
-
-	if (nbr->retrans_queue->count == 1) {
-		eigrp_send_packet_reliably(nbr);
-	}
+	nbr->reply_length += eigrp_add_internalTLV_to_stream(nbr->reply->s, pe2);
+	thread_add_event(master, eigrp_reply_flush, nbr, 0, &nbr->t_reply);
 
 	XFREE(MTYPE_EIGRP_PREFIX_ENTRY, pe2);
 }
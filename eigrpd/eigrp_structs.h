@@ -280,6 +280,11 @@ struct eigrp_neighbor {
 	struct list *nbr_gr_prefixes_send;
 	/* if packet is first or last during Graceful restart */
 	enum Packet_part_type nbr_gr_packet_type;
+
+	/* Reply being filled with TLVs, sent out by t_reply */
+	struct eigrp_packet *reply;
+	uint16_t reply_length;
+	struct thread *t_reply;
 };
 
 //---------------------------------------------------------------------------------------------------------------------------------------------
@@ -492,6 +492,7 @@ void eigrp_topology_neighbor_down(struct eigrp *eigrp,
 	struct eigrp_nexthop_entry *entry;
 	struct route_node *rn;
 
+	eigrp_zebra_batch_start();
 	for (rn = route_top(eigrp->topology_table); rn; rn = route_next(rn)) {
 		pe = rn->info;
 
@@ -515,6 +516,8 @@ void eigrp_topology_neighbor_down(struct eigrp *eigrp,
 		}
 	}
 
+	eigrp_zebra_batch_end();
+
 	eigrp_query_send_all(eigrp);
 	eigrp_update_send_all(eigrp, nbr->ei);
 }
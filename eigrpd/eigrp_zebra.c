@@ -189,6 +189,24 @@ static int eigrp_interface_address_delete(ZAPI_CALLBACK_ARGS)
 	return 0;
 }
 
+/*
+ * Start batching route updates to zebra, see zclient_batch_start().
+ */
+void eigrp_zebra_batch_start(void)
+{
+	if (zclient)
+		zclient_batch_start(zclient);
+}
+
+/*
+ * Flush the route updates batched since eigrp_zebra_batch_start().
+ */
+void eigrp_zebra_batch_end(void)
+{
+	if (zclient)
+		(void)zclient_batch_end(zclient);
+}
+
 void eigrp_zebra_route_add(struct eigrp *eigrp, struct prefix *p,
 			   struct list *successors, uint32_t distance)
 {
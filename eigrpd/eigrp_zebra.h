@@ -33,6 +33,8 @@
 
 extern void eigrp_zebra_init(void);
 
+extern void eigrp_zebra_batch_start(void);
+extern void eigrp_zebra_batch_end(void);
 extern void eigrp_zebra_route_add(struct eigrp *eigrp, struct prefix *p,
 				  struct list *successors, uint32_t distance);
 extern void eigrp_zebra_route_delete(struct eigrp *eigrp, struct prefix *);
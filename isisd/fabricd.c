@@ -32,10 +32,12 @@
 #include "isisd/isis_spf_private.h"
 #include "isisd/isis_tx_queue.h"
 #include "isisd/isis_csm.h"
+#include "skiplist.h"
 
 DEFINE_MTYPE_STATIC(ISISD, FABRICD_STATE, "ISIS OpenFabric")
 DEFINE_MTYPE_STATIC(ISISD, FABRICD_NEIGHBOR, "ISIS OpenFabric Neighbor Entry")
 DEFINE_MTYPE_STATIC(ISISD, FABRICD_FLOODING_INFO, "ISIS OpenFabric Flooding Log")
+DEFINE_MTYPE_STATIC(ISISD, FABRICD_FLOODING_TREE, "ISIS OpenFabric Flooding Tree")
 
 /* Tracks initial synchronization as per section 2.4
  *
@@ -60,6 +62,12 @@ struct fabricd {
 	struct skiplist *neighbors;
 	struct hash *neighbors_neighbors;
 
+	/* Flooding decisions per LSP originator, see fabricd_lsp_flood().
+	 * They are recomputed on first use after the generation changed.
+	 */
+	struct hash *flooding_trees;
+	uint32_t flooding_generation;
+
 	uint8_t tier;
 	uint8_t tier_config;
 	uint8_t tier_pending;
@@ -162,6 +170,73 @@ static struct neighbor_entry *neighbor_entry_lookup_hash(struct hash *hash,
 	return rv;
 }
 
+/* Code related to caching the flooding decisions */
+
+/* What to do with an LSP for one neighbor in NL */
+struct flooding_action {
+	struct neighbor_entry *neighbor;
+	/* on the reverse path to the originator, not flooded to */
+	bool skip;
+	enum isis_tx_type type;
+};
+
+/*
+ * The outcome of the flooding algorithm for the LSPs of one originator.
+ * It only depends on NL, NN, the first hops towards the originator and
+ * the LSPs of the NL members, so it stays valid until one of those
+ * changes.
+ */
+struct flooding_tree {
+	uint8_t id[ISIS_SYS_ID_LEN + 1];
+	uint32_t generation;
+
+	unsigned int count, size;
+	struct flooding_action *actions;
+};
+
+static unsigned flooding_tree_hash_key(const void *tp)
+{
+	const struct flooding_tree *t = tp;
+
+	return jhash(t->id, sizeof(t->id), 0x55aa5a5a);
+}
+
+static bool flooding_tree_hash_cmp(const void *a, const void *b)
+{
+	const struct flooding_tree *ta = a, *tb = b;
+
+	return memcmp(ta->id, tb->id, sizeof(ta->id)) == 0;
+}
+
+static void *flooding_tree_alloc(void *arg)
+{
+	struct flooding_tree *key = arg;
+	struct flooding_tree *rv = XCALLOC(MTYPE_FABRICD_FLOODING_TREE,
+					   sizeof(*rv));
+
+	memcpy(rv->id, key->id, sizeof(rv->id));
+
+	return rv;
+}
+
+static void flooding_tree_del(void *arg)
+{
+	struct flooding_tree *tree = arg;
+
+	XFREE(MTYPE_FABRICD_FLOODING_TREE, tree->actions);
+	XFREE(MTYPE_FABRICD_FLOODING_TREE, tree);
+}
+
+/* The topology changed, all cached decisions are stale */
+static void fabricd_flooding_invalidate(struct fabricd *f)
+{
+	f->flooding_generation++;
+
+	/* never matches a freshly allocated tree */
+	if (!f->flooding_generation)
+		f->flooding_generation++;
+}
+
 static int fabricd_handle_adj_state_change(struct isis_adjacency *arg)
 {
 	struct fabricd *f = arg->circuit->area->fabricd;
@@ -169,6 +244,9 @@ static int fabricd_handle_adj_state_change(struct isis_adjacency *arg)
 	if (!f)
 		return 0;
 
+	/* NL is rebuilt, freeing the entries cached trees point to */
+	fabricd_flooding_invalidate(f);
+
 	while (!skiplist_empty(f->neighbors))
 		skiplist_delete_first(f->neighbors);
 
@@ -212,6 +290,8 @@ static void neighbors_neighbors_update(struct fabricd *f)
 				    hash_alloc_intern);
 		assert(inserted == n);
 	}
+
+	fabricd_flooding_invalidate(f);
 }
 
 struct fabricd *fabricd_new(struct isis_area *area)
@@ -230,6 +310,10 @@ struct fabricd *fabricd_new(struct isis_area *area)
 	rv->neighbors_neighbors = hash_create(neighbor_entry_hash_key,
 					      neighbor_entry_hash_cmp,
 					      "Fabricd Neighbors");
+	rv->flooding_trees = hash_create(flooding_tree_hash_key,
+					 flooding_tree_hash_cmp,
+					 "Fabricd Flooding Trees");
+	rv->flooding_generation = 1;
 
 	rv->tier = rv->tier_config = ISIS_TIER_UNDEFINED;
 
@@ -249,6 +333,8 @@ void fabricd_finish(struct fabricd *f)
 	neighbor_lists_clear(f);
 	skiplist_free(f->neighbors);
 	hash_free(f->neighbors_neighbors);
+	hash_clean(f->flooding_trees, flooding_tree_del);
+	hash_free(f->flooding_trees);
 }
 
 static int fabricd_initial_sync_timeout(struct thread *thread)
@@ -528,8 +614,6 @@ int fabricd_write_settings(struct isis_area *area, struct vty *vty)
 static void move_to_queue(struct isis_lsp *lsp, struct neighbor_entry *n,
 			  enum isis_tx_type type, struct isis_circuit *circuit)
 {
-	n->present = false;
-
 	if (n->adj && n->adj->circuit == circuit)
 		return;
 
@@ -539,8 +623,13 @@ static void move_to_queue(struct isis_lsp *lsp, struct neighbor_entry *n,
 			   (type == TX_LSP_NORMAL) ? "RF" : "DNR");
 	}
 
-	if (n->adj)
+	if (n->adj) {
 		isis_tx_queue_add(n->adj->circuit->tx_queue, lsp, type);
+		if (type == TX_LSP_NORMAL)
+			n->adj->circuit->fabricd_floods++;
+		else
+			n->adj->circuit->fabricd_floods_dnr++;
+	}
 
 	uint8_t *neighbor_id = XMALLOC(MTYPE_FABRICD_FLOODING_INFO,
 				       sizeof(n->id));
@@ -558,8 +647,7 @@ static void mark_neighbor_as_present(struct hash_bucket *bucket, void *arg)
 
 static void handle_firsthops(struct hash_bucket *bucket, void *arg)
 {
-	struct isis_lsp *lsp = arg;
-	struct fabricd *f = lsp->area->fabricd;
+	struct fabricd *f = arg;
 	struct isis_vertex *vertex = bucket->data;
 
 	struct neighbor_entry *n;
@@ -628,16 +716,23 @@ static void fabricd_lsp_reset_flooding_info(struct isis_lsp *lsp,
 	lsp->flooding_circuit_scoped = false;
 }
 
-void fabricd_lsp_flood(struct isis_lsp *lsp, struct isis_circuit *circuit)
+/* Run the flooding algorithm of section 2.3 for the LSPs of tree->id */
+static void flooding_tree_compute(struct fabricd *f,
+				  struct flooding_tree *tree)
 {
-	struct fabricd *f = lsp->area->fabricd;
-	assert(f);
-
-	fabricd_lsp_reset_flooding_info(lsp, circuit);
-
+	unsigned int count = skiplist_count(f->neighbors);
 	void *cursor = NULL;
 	struct neighbor_entry *n;
 
+	if (tree->size < count) {
+		tree->actions = XREALLOC(MTYPE_FABRICD_FLOODING_TREE,
+					 tree->actions,
+					 count * sizeof(*tree->actions));
+		tree->size = count;
+	}
+	tree->count = 0;
+	tree->generation = f->flooding_generation;
+
 	/* Mark all elements in NL as present */
 	while (!skiplist_next(f->neighbors, NULL, (void **)&n, &cursor))
 		n->present = true;
@@ -646,21 +741,26 @@ void fabricd_lsp_flood(struct isis_lsp *lsp, struct isis_circuit *circuit)
 	hash_iterate(f->neighbors_neighbors, mark_neighbor_as_present, NULL);
 
 	struct isis_vertex *originator =
-		isis_find_vertex(&f->spftree->paths,
-				 lsp->hdr.lsp_id,
+		isis_find_vertex(&f->spftree->paths, tree->id,
 				 VTYPE_NONPSEUDO_TE_IS);
 
 	/* Remove all IS from NL and NN in the shortest path
 	 * to the IS that originated the LSP */
 	if (originator)
-		hash_iterate(originator->firsthops, handle_firsthops, lsp);
+		hash_iterate(originator->firsthops, handle_firsthops, f);
 
 	/* Iterate over all remaining IS in NL */
 	cursor = NULL;
 	while (!skiplist_next(f->neighbors, NULL, (void **)&n, &cursor)) {
-		if (!n->present)
+		struct flooding_action *action = &tree->actions[tree->count++];
+
+		action->neighbor = n;
+		action->skip = !n->present;
+		if (action->skip)
 			continue;
 
+		n->present = false;
+
 		struct isis_lsp *nlsp = lsp_for_neighbor(f, n);
 		if (!nlsp || !nlsp->tlvs) {
 			if (IS_DEBUG_FLOODING) {
@@ -668,7 +768,7 @@ void fabricd_lsp_flood(struct isis_lsp *lsp, struct isis_circuit *circuit)
 					   print_sys_hostname(n->id));
 			}
 
-			move_to_queue(lsp, n, TX_LSP_CIRCUIT_SCOPED, circuit);
+			action->type = TX_LSP_CIRCUIT_SCOPED;
 			continue;
 		}
 
@@ -699,9 +799,56 @@ void fabricd_lsp_flood(struct isis_lsp *lsp, struct isis_circuit *circuit)
 			}
 		}
 
-		move_to_queue(lsp, n, need_reflood ?
-			      TX_LSP_NORMAL : TX_LSP_CIRCUIT_SCOPED,
-			      circuit);
+		action->type = need_reflood ? TX_LSP_NORMAL
+					    : TX_LSP_CIRCUIT_SCOPED;
+	}
+}
+
+static struct flooding_tree *flooding_tree_get(struct fabricd *f,
+					       const uint8_t *lsp_id)
+{
+	struct flooding_tree key, *tree;
+
+	memcpy(key.id, lsp_id, sizeof(key.id));
+	tree = hash_get(f->flooding_trees, &key, flooding_tree_alloc);
+
+	if (tree->generation != f->flooding_generation)
+		flooding_tree_compute(f, tree);
+	else if (IS_DEBUG_FLOODING)
+		zlog_debug("OpenFabric: Using cached flooding decision for %s",
+			   print_sys_hostname(lsp_id));
+
+	return tree;
+}
+
+void fabricd_lsp_flood(struct isis_lsp *lsp, struct isis_circuit *circuit)
+{
+	struct fabricd *f = lsp->area->fabricd;
+	assert(f);
+
+	fabricd_lsp_reset_flooding_info(lsp, circuit);
+
+	/* What a neighbor refloods depends on its LSP */
+	struct neighbor_entry key = { {0} }, *n;
+
+	memcpy(key.id, lsp->hdr.lsp_id, sizeof(key.id));
+	if (!skiplist_search(f->neighbors, &key, (void **)&n))
+		fabricd_flooding_invalidate(f);
+
+	struct flooding_tree *tree = flooding_tree_get(f, lsp->hdr.lsp_id);
+
+	for (unsigned int i = 0; i < tree->count; i++) {
+		struct flooding_action *action = &tree->actions[i];
+
+		n = action->neighbor;
+		if (!action->skip) {
+			move_to_queue(lsp, n, action->type, circuit);
+			continue;
+		}
+
+		/* Not sent at all, as the neighbor has it already */
+		if (n->adj && n->adj->circuit != circuit)
+			n->adj->circuit->fabricd_floods_suppressed++;
 	}
 
 	if (IS_DEBUG_FLOODING) {
@@ -992,6 +992,12 @@ void isis_circuit_print_vty(struct isis_circuit *circuit, struct vty *vty,
 						  ip_addr))
 				vty_out(vty, "      %pFX\n", ip_addr);
 		}
+		if (fabricd)
+			vty_out(vty,
+				"    LSPs flooded: %u, do not reflood: %u, suppressed: %u\n",
+				circuit->fabricd_floods,
+				circuit->fabricd_floods_dnr,
+				circuit->fabricd_floods_suppressed);
 
 		vty_out(vty, "\n");
 	}
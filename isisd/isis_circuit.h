@@ -160,6 +160,14 @@ struct isis_circuit {
 	uint32_t max_area_addr_mismatches; /* max-area-addresses-mismatch */
 	uint32_t auth_type_failures; /*authentication-type-fails */
 	uint32_t auth_failures; /* authentication-fails */
+	/*
+	 * OpenFabric flooding reduction: LSPs sent for reflooding, sent
+	 * with do-not-reflood, and not sent as the neighbor is on the
+	 * path they came from
+	 */
+	uint32_t fabricd_floods;
+	uint32_t fabricd_floods_dnr;
+	uint32_t fabricd_floods_suppressed;
 
 	QOBJ_FIELDS
 };
@@ -19,6 +19,8 @@
 
 #include <zebra.h>
 
+#include "frratomic.h"
+#include "frrcu.h"
 #include "linklist.h"
 #include "log.h"
 #include "memory.h"
@@ -387,7 +389,6 @@ static bool lfa_ext_p_space_check(const struct isis_spftree *spftree_pc,
 				  const struct isis_vertex *vertex_dest,
 				  const struct isis_vertex *vertex)
 {
-	struct isis_spftree *spftree_old = spftree_pc->lfa.old.spftree;
 	struct isis_vertex_adj *vadj;
 	struct listnode *node;
 
@@ -403,8 +404,8 @@ static bool lfa_ext_p_space_check(const struct isis_spftree *spftree_pc,
 		struct isis_spf_adj *sadj = vadj->sadj;
 		struct isis_spf_node *adj_node;
 
-		adj_node =
-			isis_spf_node_find(&spftree_old->adj_nodes, sadj->id);
+		adj_node = isis_spf_node_find(&spftree_pc->lfa.adj_p_space,
+					      sadj->id);
 		if (!adj_node)
 			continue;
 
@@ -922,41 +923,42 @@ static void lfa_calc_pq_spaces(struct isis_spftree *spftree_pc,
 
 			/*
 			 * Compute the reverse SPF in the behalf of the node
-			 * adjacent to the failure.
+			 * adjacent to the failure. It doesn't depend on the
+			 * protected resource, so it's shared by all of them.
 			 */
-			adj_node->lfa.spftree_reverse =
-				isis_spf_reverse_run(adj_node->lfa.spftree);
+			if (!adj_node->lfa.spftree_reverse)
+				adj_node->lfa.spftree_reverse =
+					isis_spf_reverse_run(
+						adj_node->lfa.spftree);
 
 			lfa_calc_reach_nodes(adj_node->lfa.spftree_reverse,
 					     spftree_reverse, adj_nodes, false,
 					     resource,
 					     &spftree_pc->lfa.q_space);
 		} else {
+			struct isis_spf_node *adj_p;
+
 			if (IS_DEBUG_TILFA)
 				zlog_debug(
 					"ISIS-TI-LFA: computing P-space (%s)",
 					print_sys_hostname(adj_node->sysid));
+			adj_p = isis_spf_node_new(&spftree_pc->lfa.adj_p_space,
+						  adj_node->sysid);
 			lfa_calc_reach_nodes(adj_node->lfa.spftree, spftree,
 					     adj_nodes, true, resource,
-					     &adj_node->lfa.p_space);
+					     &adj_p->lfa.p_space);
 		}
 	}
 }
 
-/**
- * Compute the TI-LFA backup paths for a given protected interface.
- *
- * @param area		  IS-IS area
- * @param spftree	  IS-IS SPF tree
- * @param spftree_reverse IS-IS Reverse SPF tree
- * @param resource	  Protected resource
- *
- * @return		  Pointer to the post-convergence SPF tree
+/*
+ * Run the post-convergence SPF w.r.t. the given protected resource, computing
+ * the extended P-space and Q-space first.
  */
-struct isis_spftree *isis_tilfa_compute(struct isis_area *area,
-					struct isis_spftree *spftree,
-					struct isis_spftree *spftree_reverse,
-					struct lfa_protected_resource *resource)
+static struct isis_spftree *
+tilfa_spf_run(struct isis_area *area, struct isis_spftree *spftree,
+	      struct isis_spftree *spftree_reverse,
+	      struct lfa_protected_resource *resource, uint8_t flags)
 {
 	struct isis_spftree *spftree_pc;
 	struct isis_spf_node *adj_node;
@@ -979,7 +981,7 @@ struct isis_spftree *isis_tilfa_compute(struct isis_area *area,
 	/* Create post-convergence SPF tree. */
 	spftree_pc = isis_spftree_new(area, spftree->lspdb, spftree->sysid,
 				      spftree->level, spftree->tree_id,
-				      SPF_TYPE_TI_LFA, spftree->flags);
+				      SPF_TYPE_TI_LFA, spftree->flags | flags);
 	spftree_pc->lfa.old.spftree = spftree;
 	spftree_pc->lfa.old.spftree_reverse = spftree_reverse;
 	spftree_pc->lfa.protected_resource = *resource;
@@ -995,13 +997,54 @@ struct isis_spftree *isis_tilfa_compute(struct isis_area *area,
 	/* Re-run SPF in the local node to find the post-convergence paths. */
 	isis_run_spf(spftree_pc);
 
+	return spftree_pc;
+}
+
+static void tilfa_resource_release(struct lfa_protected_resource *resource)
+{
 	/* Clear list of nodes affeted by link failure. */
 	if (resource->type == LFA_NODE_PROTECTION)
 		isis_spf_node_list_clear(&resource->nodes);
+}
+
+/**
+ * Compute the TI-LFA backup paths for a given protected interface.
+ *
+ * @param area		  IS-IS area
+ * @param spftree	  IS-IS SPF tree
+ * @param spftree_reverse IS-IS Reverse SPF tree
+ * @param resource	  Protected resource
+ *
+ * @return		  Pointer to the post-convergence SPF tree
+ */
+struct isis_spftree *isis_tilfa_compute(struct isis_area *area,
+					struct isis_spftree *spftree,
+					struct isis_spftree *spftree_reverse,
+					struct lfa_protected_resource *resource)
+{
+	struct isis_spftree *spftree_pc;
+
+	spftree_pc = tilfa_spf_run(area, spftree, spftree_reverse, resource, 0);
+	tilfa_resource_release(resource);
 
 	return spftree_pc;
 }
 
+/* Compute the SPT on behalf of an adjacent router. */
+static void lfa_spf_run_neighbor(struct isis_spftree *spftree,
+				 struct isis_spf_node *adj_node)
+{
+	if (IS_DEBUG_TILFA)
+		zlog_debug("ISIS-TI-LFA: running SPF on neighbor %s",
+			   print_sys_hostname(adj_node->sysid));
+
+	adj_node->lfa.spftree = isis_spftree_new(
+		spftree->area, spftree->lspdb, adj_node->sysid, spftree->level,
+		spftree->tree_id, SPF_TYPE_FORWARD,
+		F_SPFTREE_NO_ADJACENCIES | F_SPFTREE_NO_ROUTES);
+	isis_run_spf(adj_node->lfa.spftree);
+}
+
 /**
  * Run forward SPF on all adjacent routers.
  *
@@ -1018,22 +1061,163 @@ int isis_spf_run_neighbors(struct isis_spftree *spftree)
 	if (!lsp)
 		return -1;
 
-	RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes) {
-		if (IS_DEBUG_TILFA)
-			zlog_debug("ISIS-TI-LFA: running SPF on neighbor %s",
-				   print_sys_hostname(adj_node->sysid));
-
-		/* Compute the SPT on behalf of the neighbor. */
-		adj_node->lfa.spftree = isis_spftree_new(
-			spftree->area, spftree->lspdb, adj_node->sysid,
-			spftree->level, spftree->tree_id, SPF_TYPE_FORWARD,
-			F_SPFTREE_NO_ADJACENCIES | F_SPFTREE_NO_ROUTES);
-		isis_run_spf(adj_node->lfa.spftree);
-	}
+	RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes)
+		lfa_spf_run_neighbor(spftree, adj_node);
 
 	return 0;
 }
 
+/*
+ * The SPF runs done on behalf of the neighbors and of each protected resource
+ * only read the LSDB and the pre-failure SPTs, and write to their own SPF
+ * tree. They're spread over a few short-lived worker pthreads, while the
+ * main pthread waits for them (and does its share of the work). Everything
+ * that touches shared state (backup routes, Adj-SIDs) is done afterwards on
+ * the main pthread, in the same order as a sequential run would.
+ */
+#define LFA_PARALLEL_MAX_WORKERS 16
+
+struct lfa_parallel {
+	void (*func)(void *arg, size_t idx);
+	void *arg;
+	size_t njobs;
+	atomic_size_t next;
+};
+
+struct lfa_parallel_worker {
+	pthread_t thread;
+	struct rcu_thread *rcu_thread;
+	struct lfa_parallel *par;
+	bool running;
+};
+
+static unsigned int lfa_parallel_workers(void)
+{
+	static long ncpus;
+
+	/* Keep the debug logs readable (and their static buffers sane). */
+	if (IS_DEBUG_TILFA || IS_DEBUG_SPF_EVENTS)
+		return 0;
+
+	/* The main pthread does its share of the work too. */
+	if (!ncpus)
+		ncpus = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+	return MIN(ncpus - 1, LFA_PARALLEL_MAX_WORKERS);
+}
+
+static void lfa_parallel_run_jobs(struct lfa_parallel *par)
+{
+	size_t idx;
+
+	for (;;) {
+		idx = atomic_fetch_add_explicit(&par->next, 1,
+						memory_order_relaxed);
+		if (idx >= par->njobs)
+			return;
+
+		par->func(par->arg, idx);
+	}
+}
+
+static void *lfa_parallel_thread(void *arg)
+{
+	struct lfa_parallel_worker *worker = arg;
+
+	rcu_thread_start(worker->rcu_thread);
+	rcu_read_unlock();
+
+	lfa_parallel_run_jobs(worker->par);
+	return NULL;
+}
+
+/* Run func(arg, 0 .. njobs - 1) and wait for all of them to complete. */
+static void lfa_parallel_process(void (*func)(void *arg, size_t idx),
+				 void *arg, size_t njobs)
+{
+	struct lfa_parallel par = {
+		.func = func,
+		.arg = arg,
+		.njobs = njobs,
+	};
+	struct lfa_parallel_worker workers[LFA_PARALLEL_MAX_WORKERS] = {};
+	unsigned int nworkers = 0;
+	sigset_t oldsigs, blocksigs;
+
+	if (njobs > 1)
+		nworkers = MIN(lfa_parallel_workers(), njobs - 1);
+
+	/* signals are handled on the main pthread */
+	sigfillset(&blocksigs);
+	pthread_sigmask(SIG_BLOCK, &blocksigs, &oldsigs);
+
+	for (unsigned int i = 0; i < nworkers; i++) {
+		struct lfa_parallel_worker *worker = &workers[i];
+
+		worker->par = &par;
+		worker->rcu_thread = rcu_thread_prepare();
+		if (pthread_create(&worker->thread, NULL, lfa_parallel_thread,
+				   worker)) {
+			rcu_thread_unprepare(worker->rcu_thread);
+			break;
+		}
+		worker->running = true;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+	lfa_parallel_run_jobs(&par);
+
+	for (unsigned int i = 0; i < nworkers; i++)
+		if (workers[i].running)
+			pthread_join(workers[i].thread, NULL);
+}
+
+struct tilfa_job {
+	struct lfa_protected_resource resource;
+	struct isis_spftree *spftree_pc;
+};
+
+struct tilfa_run {
+	struct isis_area *area;
+	struct isis_spftree *spftree;
+	struct isis_spftree *spftree_reverse;
+
+	/* Adjacent routers, and whether they're affected by any failure. */
+	struct isis_spf_node **adj_nodes;
+	bool *adj_affected;
+
+	struct tilfa_job *jobs;
+	size_t njobs;
+};
+
+static void tilfa_run_neighbor(void *arg, size_t idx)
+{
+	struct tilfa_run *run = arg;
+	struct isis_spf_node *adj_node = run->adj_nodes[idx];
+
+	lfa_spf_run_neighbor(run->spftree, adj_node);
+
+	/*
+	 * Nodes adjacent to a failure need their reverse SPT for the Q-space,
+	 * which is computed here so that the resource SPF runs don't race on
+	 * it.
+	 */
+	if (run->adj_affected[idx])
+		adj_node->lfa.spftree_reverse =
+			isis_spf_reverse_run(adj_node->lfa.spftree);
+}
+
+static void tilfa_run_resource(void *arg, size_t idx)
+{
+	struct tilfa_run *run = arg;
+	struct tilfa_job *job = &run->jobs[idx];
+
+	job->spftree_pc = tilfa_spf_run(run->area, run->spftree,
+					run->spftree_reverse, &job->resource,
+					F_SPFTREE_DEFER_PATHS);
+}
+
 /**
  * Run the TI-LFA algorithm for all proctected interfaces.
  *
@@ -1042,22 +1226,25 @@ int isis_spf_run_neighbors(struct isis_spftree *spftree)
  */
 void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree)
 {
-	struct isis_spftree *spftree_reverse;
+	struct tilfa_run run = {
+		.area = area,
+		.spftree = spftree,
+	};
+	struct isis_spf_node *adj_node;
 	struct isis_circuit *circuit;
 	struct listnode *node;
+	size_t nadj_nodes = 0;
 
 	/* Run reverse SPF locally. */
-	spftree_reverse = isis_spf_reverse_run(spftree);
+	run.spftree_reverse = isis_spf_reverse_run(spftree);
 
-	/* Run forward SPF on all adjacent routers. */
-	isis_spf_run_neighbors(spftree);
+	run.jobs = XCALLOC(MTYPE_TMP, 2 * listcount(area->circuit_list)
+					      * sizeof(*run.jobs));
 
 	/* Check which interfaces are protected. */
 	for (ALL_LIST_ELEMENTS_RO(area->circuit_list, node, circuit)) {
 		struct lfa_protected_resource resource = {};
 		struct isis_adjacency *adj;
-		struct isis_spftree *spftree_pc_link;
-		struct isis_spftree *spftree_pc_node;
 		static uint8_t null_sysid[ISIS_SYS_ID_LEN + 1];
 
 		if (!(circuit->is_type & spftree->level))
@@ -1096,17 +1283,52 @@ void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree)
 		/* Compute node protecting repair paths first (if necessary). */
 		if (circuit->tilfa_node_protection[spftree->level - 1]) {
 			resource.type = LFA_NODE_PROTECTION;
-			spftree_pc_node = isis_tilfa_compute(
-				area, spftree, spftree_reverse, &resource);
-			isis_spftree_del(spftree_pc_node);
+			run.jobs[run.njobs++].resource = resource;
 		}
 
 		/* Compute link protecting repair paths. */
 		resource.type = LFA_LINK_PROTECTION;
-		spftree_pc_link = isis_tilfa_compute(
-			area, spftree, spftree_reverse, &resource);
-		isis_spftree_del(spftree_pc_link);
+		run.jobs[run.njobs++].resource = resource;
+	}
+
+	/* Run forward (and if needed reverse) SPF on all adjacent routers. */
+	if (isis_root_system_lsp(spftree->lspdb, spftree->sysid)) {
+		RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes)
+			nadj_nodes++;
+		run.adj_nodes = XCALLOC(MTYPE_TMP,
+					nadj_nodes * sizeof(*run.adj_nodes));
+		run.adj_affected = XCALLOC(
+			MTYPE_TMP, nadj_nodes * sizeof(*run.adj_affected));
+
+		nadj_nodes = 0;
+		RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes) {
+			for (size_t i = 0; i < run.njobs; i++)
+				if (spf_adj_node_is_affected(
+					    adj_node, &run.jobs[i].resource,
+					    spftree->sysid))
+					run.adj_affected[nadj_nodes] = true;
+			run.adj_nodes[nadj_nodes++] = adj_node;
+		}
+		lfa_parallel_process(tilfa_run_neighbor, &run, nadj_nodes);
+	}
+
+	/* Run the post-convergence SPFs of all protected resources. */
+	lfa_parallel_process(tilfa_run_resource, &run, run.njobs);
+
+	/*
+	 * Compute the repair paths and install the backup routes. Node
+	 * protection goes first, as link protection skips what it covered.
+	 */
+	for (size_t i = 0; i < run.njobs; i++) {
+		struct tilfa_job *job = &run.jobs[i];
+
+		isis_spf_process_paths(job->spftree_pc);
+		tilfa_resource_release(&job->resource);
+		isis_spftree_del(job->spftree_pc);
 	}
 
-	isis_spftree_del(spftree_reverse);
+	XFREE(MTYPE_TMP, run.adj_affected);
+	XFREE(MTYPE_TMP, run.adj_nodes);
+	XFREE(MTYPE_TMP, run.jobs);
+	isis_spftree_del(run.spftree_reverse);
 }
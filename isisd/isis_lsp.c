@@ -33,6 +33,7 @@
 #include "prefix.h"
 #include "command.h"
 #include "hash.h"
+#include "jhash.h"
 #include "if.h"
 #include "checksum.h"
 #include "md5.h"
@@ -76,6 +77,11 @@ int lspdb_compare(const struct isis_lsp *a, const struct isis_lsp *b)
 	return memcmp(a->hdr.lsp_id, b->hdr.lsp_id, sizeof(a->hdr.lsp_id));
 }
 
+uint32_t lspdb_hash_key(const struct isis_lsp *lsp)
+{
+	return jhash(lsp->hdr.lsp_id, sizeof(lsp->hdr.lsp_id), 0);
+}
+
 void lsp_db_init(struct lspdb_head *head)
 {
 	lspdb_init(head);
@@ -90,6 +96,25 @@ void lsp_db_fini(struct lspdb_head *head)
 	lspdb_fini(head);
 }
 
+/*
+ * Memory accounting: bytes held by the raw PDUs of a level and the number
+ * of LSPs which also carry a decoded copy of their TLVs.
+ */
+void lsp_db_usage(struct lspdb_head *head, size_t *pdu_bytes,
+		  unsigned int *decoded)
+{
+	struct isis_lsp *lsp;
+
+	*pdu_bytes = 0;
+	*decoded = 0;
+	frr_each (lspdb, head, lsp) {
+		if (lsp->pdu)
+			*pdu_bytes += STREAM_SIZE(lsp->pdu);
+		if (lsp->tlvs)
+			(*decoded)++;
+	}
+}
+
 struct isis_lsp *lsp_search(struct lspdb_head *head, const uint8_t *id)
 {
 	struct isis_lsp searchfor;
@@ -103,12 +128,77 @@ static void lsp_clear_data(struct isis_lsp *lsp)
 	if (!lsp)
 		return;
 
+	isis_spf_lsp_edges_free(lsp);
 	isis_free_tlvs(lsp->tlvs);
 	lsp->tlvs = NULL;
 }
 
+/*
+ * Purged LSPs of other systems are neither used by SPF nor needed for
+ * flooding, which goes out of the raw PDU. Don't keep their decoded TLVs
+ * around while they are waiting for ZeroAgeLifetime to expire.
+ */
+static void lsp_compact(struct isis_lsp *lsp)
+{
+	if (lsp->own_lsp || lsp->hdr.rem_lifetime || !lsp->pdu)
+		return;
+
+	lsp_clear_data(lsp);
+}
+
+/* Decode the TLVs of a compacted LSP again from its PDU */
+static struct isis_tlvs *lsp_decode_pdu(struct isis_lsp *lsp)
+{
+	size_t tlv_start = ISIS_FIXED_HDR_LEN + ISIS_LSP_HDR_LEN;
+	size_t getp = stream_get_getp(lsp->pdu);
+	struct isis_tlvs *tlvs;
+	const char *log;
+
+	if (stream_get_endp(lsp->pdu) <= tlv_start)
+		return NULL;
+
+	stream_set_getp(lsp->pdu, tlv_start);
+	if (isis_unpack_tlvs(stream_get_endp(lsp->pdu) - tlv_start, lsp->pdu,
+			     &tlvs, &log)) {
+		isis_free_tlvs(tlvs);
+		tlvs = NULL;
+	}
+	stream_set_getp(lsp->pdu, getp);
+
+	return tlvs;
+}
+
 static void lsp_remove_frags(struct lspdb_head *head, struct list *frags);
 
+static uint32_t lsp_topology_hash(struct isis_lsp *lsp)
+{
+	uint32_t hash;
+
+	if (!lsp->tlvs || !lsp->hdr.seqno || !lsp->hdr.rem_lifetime)
+		return 0;
+
+	hash = isis_tlvs_topology_hash(lsp->tlvs);
+	hash = jhash_1word(lsp->hdr.lsp_bits, hash);
+
+	/* 0 is reserved for LSPs that aren't part of the topology */
+	return hash ? hash : 1;
+}
+
+/*
+ * Schedule an SPF run after the LSP changed. When only its IP reachability
+ * did, the SPT can be kept and only the routes recalculated.
+ */
+static void lsp_spf_schedule(struct isis_lsp *lsp)
+{
+	uint32_t topo_hash = lsp_topology_hash(lsp);
+
+	if (topo_hash && topo_hash == lsp->topo_hash)
+		isis_spf_schedule_prc(lsp->area, lsp->level);
+	else
+		isis_spf_schedule(lsp->area, lsp->level);
+	lsp->topo_hash = topo_hash;
+}
+
 static void lsp_destroy(struct isis_lsp *lsp)
 {
 	struct listnode *cnode;
@@ -309,6 +399,11 @@ static void lsp_pack_pdu(struct isis_lsp *lsp)
 	lsp->hdr.checksum =
 		ntohs(fletcher_checksum(STREAM_DATA(lsp->pdu) + 12,
 					stream_get_endp(lsp->pdu) - 12, 12));
+	lsp->tlvs_hash = jhash(STREAM_DATA(lsp->pdu) + ISIS_FIXED_HDR_LEN
+				       + ISIS_LSP_HDR_LEN,
+			       stream_get_endp(lsp->pdu) - ISIS_FIXED_HDR_LEN
+				       - ISIS_LSP_HDR_LEN,
+			       lsp->hdr.lsp_bits);
 }
 
 void lsp_inc_seqno(struct isis_lsp *lsp, uint32_t seqno)
@@ -332,7 +427,7 @@ void lsp_inc_seqno(struct isis_lsp *lsp, uint32_t seqno)
 	lsp->hdr.seqno = newseq;
 
 	lsp_pack_pdu(lsp);
-	isis_spf_schedule(lsp->area, lsp->level);
+	lsp_spf_schedule(lsp);
 }
 
 static void lsp_purge_add_poi(struct isis_lsp *lsp,
@@ -369,6 +464,7 @@ static void lsp_purge(struct isis_lsp *lsp, int level,
 	lsp_purge_add_poi(lsp, sender);
 
 	lsp_pack_pdu(lsp);
+	lsp_compact(lsp);
 	lsp_flood(lsp, NULL);
 }
 
@@ -442,7 +538,17 @@ static void lsp_update_data(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr,
 					  : IS_LEVEL_1);
 	}
 
-	return;
+	lsp_compact(lsp);
+}
+
+/* Refresh an LSP from a received copy with identical contents */
+void lsp_refresh_from_recv(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr)
+{
+	lsp->hdr.rem_lifetime = hdr->rem_lifetime;
+	lsp->age_out = ZERO_AGE_LIFETIME;
+	lsp->installed = time(NULL);
+	if (lsp->pdu && stream_get_endp(lsp->pdu) >= 12)
+		stream_putw_at(lsp->pdu, 10, lsp->hdr.rem_lifetime);
 }
 
 static void lsp_link_fragment(struct isis_lsp *lsp, struct isis_lsp *lsp0)
@@ -489,7 +595,7 @@ void lsp_update(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr,
 	}
 
 	if (lsp->hdr.seqno)
-		isis_spf_schedule(lsp->area, lsp->level);
+		lsp_spf_schedule(lsp);
 }
 
 /* creation of LSP directly from what we received */
@@ -554,6 +660,7 @@ struct isis_lsp *lsp_new(struct isis_area *area, uint8_t *lsp_id,
 void lsp_insert(struct lspdb_head *head, struct isis_lsp *lsp)
 {
 	lspdb_add(head, lsp);
+	lsp->topo_hash = lsp_topology_hash(lsp);
 	if (lsp->hdr.seqno)
 		isis_spf_schedule(lsp->area, lsp->level);
 }
@@ -668,9 +775,15 @@ void lsp_print(struct isis_lsp *lsp, struct vty *vty, char dynhost,
 void lsp_print_detail(struct isis_lsp *lsp, struct vty *vty, char dynhost,
 		      struct isis *isis)
 {
+	struct isis_tlvs *tlvs = lsp->tlvs;
+
 	lsp_print(lsp, vty, dynhost, isis);
-	if (lsp->tlvs)
-		vty_multiline(vty, "  ", "%s", isis_format_tlvs(lsp->tlvs));
+	if (!tlvs && lsp->pdu)
+		tlvs = lsp_decode_pdu(lsp);
+	if (tlvs)
+		vty_multiline(vty, "  ", "%s", isis_format_tlvs(tlvs));
+	if (tlvs != lsp->tlvs)
+		isis_free_tlvs(tlvs);
 	vty_out(vty, "\n");
 }
 
@@ -1269,7 +1382,22 @@ int lsp_generate(struct isis_area *area, int level)
 }
 
 /*
- * Search own LSPs, update holding time and flood
+ * Repack a rebuilt own LSP fragment with its current header and check
+ * whether it can keep its sequence number: its contents must not have
+ * changed and it must not be due for a refresh before the next one.
+ */
+static bool lsp_own_unchanged(struct isis_lsp *lsp, uint32_t old_hash,
+			      uint16_t refresh_time)
+{
+	lsp_pack_pdu(lsp);
+
+	return lsp->hdr.seqno && lsp->tlvs_hash == old_hash
+	       && lsp->hdr.rem_lifetime > refresh_time + 300;
+}
+
+/*
+ * Search own LSPs, update holding time and flood the fragments which
+ * changed
  */
 static int lsp_regenerate(struct isis_area *area, int level)
 {
@@ -1278,6 +1406,8 @@ static int lsp_regenerate(struct isis_area *area, int level)
 	struct listnode *node;
 	uint8_t lspid[ISIS_SYS_ID_LEN + 2];
 	uint16_t rem_lifetime, refresh_time;
+	uint32_t old_hash;
+	unsigned int updated = 0;
 
 	if ((area == NULL) || (area->is_type & level) != level)
 		return ISIS_ERROR;
@@ -1295,34 +1425,51 @@ static int lsp_regenerate(struct isis_area *area, int level)
 		return ISIS_ERROR;
 	}
 
+	/* lsp_build() repacks the zero LSP to size the fragments */
+	old_hash = lsp->tlvs_hash;
 	lsp_clear_data(lsp);
 	lsp_build(lsp, area);
 	rem_lifetime = lsp_rem_lifetime(area, level);
-	lsp->hdr.rem_lifetime = rem_lifetime;
+	refresh_time = lsp_refresh_time(lsp, rem_lifetime);
 	lsp->last_generated = time(NULL);
-	lsp_flood(lsp, NULL);
 	area->lsp_gen_count[level - 1]++;
+
+	/*
+	 * Only fragments whose contents changed get a new sequence number
+	 * and are flooded, unless they are due for a refresh anyway.
+	 */
+	if (!lsp_own_unchanged(lsp, old_hash, refresh_time)) {
+		lsp->hdr.rem_lifetime = rem_lifetime;
+		lsp_inc_seqno(lsp, 0);
+		lsp_flood(lsp, NULL);
+		updated++;
+	}
 	for (ALL_LIST_ELEMENTS_RO(lsp->lspu.frags, node, frag)) {
 		if (!frag->tlvs) {
 			/* Updating and flooding should only affect fragments
-			 * carrying data
+			 * carrying data, empty ones get purged.
 			 */
+			if (frag->hdr.rem_lifetime)
+				lsp_purge(frag, level, NULL);
 			continue;
 		}
 
+		old_hash = frag->tlvs_hash;
 		frag->hdr.lsp_bits = lsp_bits_generate(
 			level, area->overload_bit, area->attached_bit);
-		/* Set the lifetime values of all the fragments to the same
-		 * value,
-		 * so that no fragment expires before the lsp is refreshed.
+		if (lsp_own_unchanged(frag, old_hash, refresh_time))
+			continue;
+
+		/* Set the lifetime values of all the updated fragments to
+		 * the same value, so that no fragment expires before the lsp
+		 * is refreshed.
 		 */
 		frag->hdr.rem_lifetime = rem_lifetime;
 		frag->age_out = ZERO_AGE_LIFETIME;
+		lsp_inc_seqno(frag, 0);
 		lsp_flood(frag, NULL);
+		updated++;
 	}
-	lsp_seqno_update(lsp);
-
-	refresh_time = lsp_refresh_time(lsp, rem_lifetime);
 	thread_add_timer(master, lsp_refresh,
 			 &area->lsp_refresh_arg[level - 1], refresh_time,
 			 &area->t_lsp_refresh[level - 1]);
@@ -1336,8 +1483,8 @@ static int lsp_regenerate(struct isis_area *area, int level)
 			lsp->hdr.rem_lifetime, refresh_time);
 	}
 	sched_debug(
-		"ISIS (%s): Rebuilt L%d LSP. Set triggered regenerate to non-pending.",
-		area->area_tag, level);
+		"ISIS (%s): Rebuilt L%d LSP, %u fragments updated. Set triggered regenerate to non-pending.",
+		area->area_tag, level, updated);
 
 	return ISIS_OK;
 }
@@ -24,18 +24,31 @@
 #ifndef _ZEBRA_ISIS_LSP_H
 #define _ZEBRA_ISIS_LSP_H
 
+#include "lib/frratomic.h"
 #include "lib/typesafe.h"
 #include "isisd/isis_pdu.h"
 
-PREDECL_RBTREE_UNIQ(lspdb)
+PREDECL_RBTREE_UNIQ(lspdb_tree)
+PREDECL_HASH(lspdb_hash)
+
+/*
+ * The LSPDB keeps its LSPs both in an RB tree, for ordered walks (CSNPs,
+ * show output), and in a hash for lookups by LSP ID.
+ */
+struct lspdb_head {
+	struct lspdb_tree_head tree;
+	struct lspdb_hash_head hash;
+};
 
 struct isis;
+struct isis_spf_edges;
 /* Structure for isis_lsp, this structure will only support the fixed
  * System ID (Currently 6) (atleast for now). In order to support more
  * We will have to split the header into two parts, and for readability
  * sake it should better be avoided */
 struct isis_lsp {
-	struct lspdb_item dbe;
+	struct lspdb_tree_item dbe;
+	struct lspdb_hash_item dbh;
 
 	struct isis_lsp_hdr hdr;
 	struct stream *pdu; /* full pdu lsp */
@@ -53,6 +66,12 @@ struct isis_lsp {
 	int age_out;
 	struct isis_area *area;
 	struct isis_tlvs *tlvs;
+	/* IS reachability decoded for SPF (per MT), dropped with tlvs */
+	struct isis_spf_edges *_Atomic spf_edges;
+	/* topology hash when the last SPF run was scheduled for this LSP */
+	uint32_t topo_hash;
+	/* hash of the TLVs of own LSPs as last packed */
+	uint32_t tlvs_hash;
 
 	time_t flooding_time;
 	struct list *flooding_neighbors[TX_LSP_CIRCUIT_SCOPED + 1];
@@ -61,10 +80,88 @@ struct isis_lsp {
 };
 
 extern int lspdb_compare(const struct isis_lsp *a, const struct isis_lsp *b);
-DECLARE_RBTREE_UNIQ(lspdb, struct isis_lsp, dbe, lspdb_compare)
+extern uint32_t lspdb_hash_key(const struct isis_lsp *lsp);
+DECLARE_RBTREE_UNIQ(lspdb_tree, struct isis_lsp, dbe, lspdb_compare)
+DECLARE_HASH(lspdb_hash, struct isis_lsp, dbh, lspdb_compare, lspdb_hash_key)
+
+static inline void lspdb_init(struct lspdb_head *head)
+{
+	lspdb_tree_init(&head->tree);
+	lspdb_hash_init(&head->hash);
+}
+
+static inline void lspdb_fini(struct lspdb_head *head)
+{
+	lspdb_hash_fini(&head->hash);
+	lspdb_tree_fini(&head->tree);
+}
+
+static inline struct isis_lsp *lspdb_add(struct lspdb_head *head,
+					 struct isis_lsp *lsp)
+{
+	struct isis_lsp *existing;
+
+	existing = lspdb_tree_add(&head->tree, lsp);
+	if (!existing)
+		lspdb_hash_add(&head->hash, lsp);
+	return existing;
+}
+
+static inline struct isis_lsp *lspdb_del(struct lspdb_head *head,
+					 struct isis_lsp *lsp)
+{
+	lspdb_hash_del(&head->hash, lsp);
+	return lspdb_tree_del(&head->tree, lsp);
+}
+
+static inline struct isis_lsp *lspdb_pop(struct lspdb_head *head)
+{
+	struct isis_lsp *lsp;
+
+	lsp = lspdb_tree_pop(&head->tree);
+	if (lsp)
+		lspdb_hash_del(&head->hash, lsp);
+	return lsp;
+}
+
+static inline struct isis_lsp *lspdb_find(struct lspdb_head *head,
+					  const struct isis_lsp *lsp)
+{
+	return lspdb_hash_find(&head->hash, lsp);
+}
+
+static inline struct isis_lsp *lspdb_find_gteq(struct lspdb_head *head,
+					       const struct isis_lsp *lsp)
+{
+	return lspdb_tree_find_gteq(&head->tree, lsp);
+}
+
+static inline struct isis_lsp *lspdb_first(struct lspdb_head *head)
+{
+	return lspdb_tree_first(&head->tree);
+}
+
+static inline struct isis_lsp *lspdb_next(struct lspdb_head *head,
+					  struct isis_lsp *lsp)
+{
+	return lspdb_tree_next(&head->tree, lsp);
+}
+
+static inline struct isis_lsp *lspdb_next_safe(struct lspdb_head *head,
+					       struct isis_lsp *lsp)
+{
+	return lspdb_tree_next_safe(&head->tree, lsp);
+}
+
+static inline size_t lspdb_count(const struct lspdb_head *head)
+{
+	return lspdb_tree_count(&head->tree);
+}
 
 void lsp_db_init(struct lspdb_head *head);
 void lsp_db_fini(struct lspdb_head *head);
+void lsp_db_usage(struct lspdb_head *head, size_t *pdu_bytes,
+		  unsigned int *decoded);
 int lsp_tick(struct thread *thread);
 
 int lsp_generate(struct isis_area *area, int level);
@@ -115,6 +212,7 @@ int lsp_compare(char *areatag, struct isis_lsp *lsp, uint32_t seqno,
 void lsp_update(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr,
 		struct isis_tlvs *tlvs, struct stream *stream,
 		struct isis_area *area, int level, bool confusion);
+void lsp_refresh_from_recv(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr);
 void lsp_inc_seqno(struct isis_lsp *lsp, uint32_t seqno);
 void lspid_print(uint8_t *lsp_id, char *dest, char dynhost, char frag,
 		 struct isis *isis);
@@ -321,12 +321,17 @@ const char *rawlspid_print(const uint8_t *from)
 	return isis_format_id(from, 8);
 }
 
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
 #define FORMAT_ID_SIZE sizeof("0000.0000.0000.00-00")
 const char *isis_format_id(const uint8_t *id, size_t len)
 {
 #define FORMAT_BUF_COUNT 4
-	static char buf_ring[FORMAT_BUF_COUNT][FORMAT_ID_SIZE];
-	static size_t cur_buf = 0;
+	/* per-pthread, SPF runs may log from TI-LFA worker pthreads */
+	static thread_local char buf_ring[FORMAT_BUF_COUNT][FORMAT_ID_SIZE];
+	static thread_local size_t cur_buf = 0;
 
 	char *rv;
 
@@ -800,6 +800,43 @@ static void lsp_flood_or_update(struct isis_lsp *lsp,
  * ISO - 10589
  * Section 7.3.15.1 - Action on receipt of a link state PDU
  */
+static void lsp_unpack_error(struct isis_circuit *circuit,
+			     struct isis_lsp_hdr *hdr, const char *raw_pdu,
+			     const char *error_log)
+{
+	zlog_warn("Something went wrong unpacking the LSP: %s", error_log);
+#ifndef FABRICD
+	/* send northbound notification. Note that the tlv-type and
+	 * offset cannot correctly be set here as they are not returned
+	 * by isis_unpack_tlvs, but in there I cannot fire a
+	 * notification because I have no circuit information. So until
+	 * we change the code above to return those extra fields, we
+	 * will send dummy values which are ignored in the callback
+	 */
+	isis_notif_lsp_error(circuit, rawlspid_print(hdr->lsp_id), raw_pdu, 0,
+			     0);
+#endif /* ifndef FABRICD */
+}
+
+/*
+ * Fully decode the TLVs of a received LSP. This is only done once we know
+ * that the LSP is going to be stored in the LSPDB.
+ */
+static struct isis_tlvs *lsp_view_tlvs(struct isis_circuit *circuit,
+				       struct isis_lsp_hdr *hdr,
+				       struct isis_tlvs_view *view,
+				       const char *raw_pdu)
+{
+	const char *error_log;
+
+	if (isis_tlvs_view_decode_all(view, &error_log)) {
+		lsp_unpack_error(circuit, hdr, raw_pdu, error_log);
+		return NULL;
+	}
+
+	return isis_tlvs_view_take(view);
+}
+
 static int process_lsp(uint8_t pdu_type, struct isis_circuit *circuit,
 		       const uint8_t *ssnpa, uint8_t max_area_addrs)
 {
@@ -915,25 +952,19 @@ static int process_lsp(uint8_t pdu_type, struct isis_circuit *circuit,
 		return ISIS_WARNING;
 	}
 
+	struct isis_tlvs_view view;
 	struct isis_tlvs *tlvs = NULL;
 	int retval = ISIS_WARNING;
 	const char *error_log;
 
-	if (isis_unpack_tlvs(STREAM_READABLE(circuit->rcv_stream),
-			     circuit->rcv_stream, &tlvs, &error_log)) {
-		zlog_warn("Something went wrong unpacking the LSP: %s",
-			  error_log);
-#ifndef FABRICD
-		/* send northbound notification. Note that the tlv-type and
-		 * offset cannot correctly be set here as they are not returned
-		 * by isis_unpack_tlvs, but in there I cannot fire a
-		 * notification because I have no circuit information. So until
-		 * we change the code above to return those extra fields, we
-		 * will send dummy values which are ignored in the callback
-		 */
-		isis_notif_lsp_error(circuit, rawlspid_print(hdr.lsp_id),
-				     raw_pdu, 0, 0);
-#endif /* ifndef FABRICD */
+	/*
+	 * Only validate the TLV structure here. The TLVs are decoded once we
+	 * know the LSP is actually going to be installed, duplicates and
+	 * older LSPs never get decoded at all.
+	 */
+	if (isis_tlvs_view_init(&view, STREAM_READABLE(circuit->rcv_stream),
+				circuit->rcv_stream, &error_log)) {
+		lsp_unpack_error(circuit, &hdr, raw_pdu, error_log);
 		goto out;
 	}
 
@@ -946,7 +977,12 @@ static int process_lsp(uint8_t pdu_type, struct isis_circuit *circuit,
 	struct isis_passwd *passwd = (level == ISIS_LEVEL1)
 					     ? &circuit->area->area_passwd
 					     : &circuit->area->domain_passwd;
-	int auth_code = isis_tlvs_auth_is_valid(tlvs, passwd,
+	if (passwd->type
+	    && isis_tlvs_view_decode(&view, ISIS_TLV_AUTH, &error_log)) {
+		lsp_unpack_error(circuit, &hdr, raw_pdu, error_log);
+		goto out;
+	}
+	int auth_code = isis_tlvs_auth_is_valid(view.tlvs, passwd,
 						circuit->rcv_stream, true);
 	if (auth_code != ISIS_AUTH_OK) {
 		isis_event_auth_failure(circuit->area->area_tag,
@@ -1048,6 +1084,14 @@ dontcheckadj:
 				/* LSP by some other system -> do 7.3.16.4 b) */
 				/* 7.3.16.4 b) 1)  */
 				if (comp == LSP_NEWER) {
+					/* a confused LSP is purged anyway */
+					if (!lsp_confusion) {
+						tlvs = lsp_view_tlvs(
+							circuit, &hdr, &view,
+							raw_pdu);
+						if (!tlvs)
+							goto out;
+					}
 					lsp_update(lsp, &hdr, tlvs,
 						   circuit->rcv_stream,
 						   circuit->area, level,
@@ -1201,6 +1245,10 @@ dontcheckadj:
 					goto out;
 				}
 			}
+			tlvs = lsp_view_tlvs(circuit, &hdr, &view, raw_pdu);
+			if (!tlvs)
+				goto out;
+
 			/* i */
 			if (!lsp) {
 				lsp = lsp_new_from_recv(
@@ -1225,9 +1273,18 @@ dontcheckadj:
 		/* 7.3.15.1 e) 2) LSP equal to the one in db */
 		else if (comp == LSP_EQUAL) {
 			isis_tx_queue_del(circuit->tx_queue, lsp);
-			lsp_update(lsp, &hdr, tlvs, circuit->rcv_stream,
-				   circuit->area, level, false);
-			tlvs = NULL;
+			if (lsp->hdr.pdu_len == hdr.pdu_len) {
+				/* Same contents, don't bother decoding them */
+				lsp_refresh_from_recv(lsp, &hdr);
+			} else {
+				tlvs = lsp_view_tlvs(circuit, &hdr, &view,
+						     raw_pdu);
+				if (!tlvs)
+					goto out;
+				lsp_update(lsp, &hdr, tlvs, circuit->rcv_stream,
+					   circuit->area, level, false);
+				tlvs = NULL;
+			}
 			if (circuit->circ_type != CIRCUIT_T_BROADCAST)
 				ISIS_SET_FLAG(lsp->SSNflags, circuit);
 		}
@@ -1244,6 +1301,7 @@ dontcheckadj:
 out:
 	fabricd_trigger_csnp(circuit->area, circuit_scoped);
 
+	isis_tlvs_view_fini(&view);
 	isis_free_tlvs(tlvs);
 	return retval;
 }
@@ -2261,6 +2319,11 @@ static int send_psnp(int level, struct isis_circuit *circuit)
 	uint16_t num_lsps =
 		get_max_lsp_count(STREAM_WRITEABLE(circuit->snd_stream));
 
+	/* Walk the LSPDB only once, each PSNP picks up where the last one
+	 * stopped.
+	 */
+	struct isis_lsp *next = lspdb_first(&circuit->area->lspdb[level - 1]);
+
 	while (1) {
 		struct isis_lsp *lsp;
 
@@ -2268,7 +2331,8 @@ static int send_psnp(int level, struct isis_circuit *circuit)
 		if (CHECK_FLAG(passwd->snp_auth, SNP_AUTH_SEND))
 			isis_tlvs_add_auth(tlvs, passwd);
 
-		frr_each (lspdb, &circuit->area->lspdb[level - 1], lsp) {
+		frr_each_from (lspdb, &circuit->area->lspdb[level - 1], lsp,
+			       next) {
 			if (ISIS_CHECK_FLAG(lsp->SSNflags, circuit))
 				isis_tlvs_add_lsp_entry(tlvs, lsp);
 
@@ -383,6 +383,7 @@ isis_route_create(struct prefix *prefix, struct prefix_ipv6 *src_p,
 					"ISIS-Rte (%s): route changed: %pFX, change: %s",
 					area->area_tag, prefix, change_buf);
 			rinfo_new->sr_previous = rinfo_old->sr;
+			rinfo_new->sr_hash = rinfo_old->sr_hash;
 			isis_route_info_delete(rinfo_old);
 			route_info = rinfo_new;
 			UNSET_FLAG(route_info->flag,
@@ -489,6 +490,12 @@ static void _isis_route_verify_table(struct isis_area *area,
 	char buff[SRCDEST2STR_BUFFER];
 #endif /* EXTREME_DEBUG */
 
+	/*
+	 * Send all route and label updates resulting from this SPF run to
+	 * zebra in as few writes as possible.
+	 */
+	isis_zebra_batch_start();
+
 	for (rnode = route_top(table); rnode;
 	     rnode = srcdest_route_next(rnode)) {
 		if (rnode->info == NULL)
@@ -570,6 +577,8 @@ static void _isis_route_verify_table(struct isis_area *area,
 
 		isis_route_delete(area, rnode, table);
 	}
+
+	isis_zebra_batch_end();
 }
 
 void isis_route_verify_table(struct isis_area *area, struct route_table *table,
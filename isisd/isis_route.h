@@ -45,6 +45,8 @@ struct isis_route_info {
 	uint32_t depth;
 	struct isis_sr_psid_info sr;
 	struct isis_sr_psid_info sr_previous;
+	/* hash of the Prefix-SID label entry last sent to zebra */
+	uint32_t sr_hash;
 	struct list *nexthops;
 	struct isis_route_info *backup;
 };
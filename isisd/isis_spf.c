@@ -25,6 +25,8 @@
 #include <zebra.h>
 
 #include "thread.h"
+#include "frratomic.h"
+#include "frr_pthread.h"
 #include "linklist.h"
 #include "vty.h"
 #include "log.h"
@@ -57,10 +59,12 @@
 #include "isis_tlvs.h"
 #include "fabricd.h"
 #include "isis_spf_private.h"
+#include "isis_trace.h"
 
 DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_RUN, "ISIS SPF Run Info");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_ADJ, "ISIS SPF Adjacency");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_VERTEX_ADJ, "ISIS SPF Vertex Adjacency");
+DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_EDGES, "ISIS SPF LSP Edges");
 
 static void spf_adj_list_parse_lsp(struct isis_spftree *spftree,
 				   struct list *adj_list, struct isis_lsp *lsp,
@@ -359,6 +363,7 @@ struct isis_spftree *isis_spftree_new(struct isis_area *area,
 	if (tree->type == SPF_TYPE_TI_LFA) {
 		isis_spf_node_list_init(&tree->lfa.p_space);
 		isis_spf_node_list_init(&tree->lfa.q_space);
+		isis_spf_node_list_init(&tree->lfa.adj_p_space);
 	}
 
 	return tree;
@@ -369,6 +374,7 @@ void isis_spftree_del(struct isis_spftree *spftree)
 	hash_clean(spftree->prefix_sids, NULL);
 	hash_free(spftree->prefix_sids);
 	if (spftree->type == SPF_TYPE_TI_LFA) {
+		isis_spf_node_list_clear(&spftree->lfa.adj_p_space);
 		isis_spf_node_list_clear(&spftree->lfa.q_space);
 		isis_spf_node_list_clear(&spftree->lfa.p_space);
 	}
@@ -753,19 +759,144 @@ static void process_N(struct isis_spftree *spftree, enum vertextype vtype,
 	return;
 }
 
+/*
+ * The IS reachability of an LSP fragment, flattened into an array of edges
+ * the first time an SPF run needs it for a given topology. It's shared by
+ * all SPF trees (normal, reverse, TI-LFA, per-MT, neighbors) until the LSP
+ * contents change, and released together with the LSP TLVs.
+ */
+struct isis_spf_edge {
+	uint8_t id[ISIS_SYS_ID_LEN + 1];
+	uint8_t vtype;
+	uint32_t metric;
+};
+
+struct isis_spf_edges {
+	struct isis_spf_edges *next;
+	uint16_t mtid;
+	uint32_t count;
+	struct isis_spf_edge edges[];
+};
+
+/* SPF trees might be computed from the TI-LFA worker pthreads. */
+static pthread_mutex_t spf_edges_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static struct isis_spf_edges *spf_lsp_edges_build(struct isis_lsp *lsp,
+						  uint16_t mtid)
+{
+	bool pseudo_lsp = LSP_PSEUDO_ID(lsp->hdr.lsp_id);
+	static const uint8_t null_sysid[ISIS_SYS_ID_LEN];
+	struct isis_oldstyle_reach *oldstyle = NULL;
+	struct isis_item_list *te_neighs = NULL;
+	struct isis_extended_reach *er;
+	struct isis_oldstyle_reach *r;
+	struct isis_spf_edges *edges;
+	uint32_t count = 0;
+
+	if (lsp->tlvs) {
+		if (pseudo_lsp || mtid == ISIS_MT_IPV4_UNICAST) {
+			if (!fabricd)
+				oldstyle = (struct isis_oldstyle_reach *)
+						   lsp->tlvs->oldstyle_reach.head;
+			te_neighs = &lsp->tlvs->extended_reach;
+		} else
+			te_neighs = isis_lookup_mt_items(&lsp->tlvs->mt_reach,
+							 mtid);
+	}
+
+	for (r = oldstyle; r; r = r->next)
+		count++;
+	for (er = te_neighs ? (struct isis_extended_reach *)te_neighs->head
+			    : NULL;
+	     er; er = er->next)
+		count++;
+
+	edges = XCALLOC(MTYPE_ISIS_SPF_EDGES,
+			sizeof(*edges) + count * sizeof(edges->edges[0]));
+	edges->mtid = mtid;
+
+	for (r = oldstyle; r; r = r->next) {
+		struct isis_spf_edge *edge = &edges->edges[edges->count];
+
+		if (!pseudo_lsp && !memcmp(r->id, null_sysid, ISIS_SYS_ID_LEN))
+			continue;
+		memcpy(edge->id, r->id, sizeof(edge->id));
+		edge->vtype = LSP_PSEUDO_ID(r->id) ? VTYPE_PSEUDO_IS
+						   : VTYPE_NONPSEUDO_IS;
+		edge->metric = r->metric;
+		edges->count++;
+	}
+	for (er = te_neighs ? (struct isis_extended_reach *)te_neighs->head
+			    : NULL;
+	     er; er = er->next) {
+		struct isis_spf_edge *edge = &edges->edges[edges->count];
+
+		if (!pseudo_lsp && !memcmp(er->id, null_sysid, ISIS_SYS_ID_LEN))
+			continue;
+		memcpy(edge->id, er->id, sizeof(edge->id));
+		edge->vtype = LSP_PSEUDO_ID(er->id) ? VTYPE_PSEUDO_TE_IS
+						    : VTYPE_NONPSEUDO_TE_IS;
+		edge->metric = er->metric;
+		edges->count++;
+	}
+
+	return edges;
+}
+
+static const struct isis_spf_edges *spf_lsp_edges(struct isis_lsp *lsp,
+						  uint16_t mtid)
+{
+	struct isis_spf_edges *edges;
+
+	for (edges = atomic_load_explicit(&lsp->spf_edges,
+					  memory_order_acquire);
+	     edges; edges = edges->next)
+		if (edges->mtid == mtid)
+			return edges;
+
+	frr_with_mutex (&spf_edges_mtx) {
+		/* Another pthread might have built them in the meantime. */
+		for (edges = atomic_load_explicit(&lsp->spf_edges,
+						  memory_order_relaxed);
+		     edges; edges = edges->next)
+			if (edges->mtid == mtid)
+				return edges;
+
+		edges = spf_lsp_edges_build(lsp, mtid);
+		edges->next = atomic_load_explicit(&lsp->spf_edges,
+						   memory_order_relaxed);
+		atomic_store_explicit(&lsp->spf_edges, edges,
+				      memory_order_release);
+	}
+
+	return edges;
+}
+
+/* Called whenever the TLVs of the LSP are released or replaced. */
+void isis_spf_lsp_edges_free(struct isis_lsp *lsp)
+{
+	struct isis_spf_edges *edges, *next;
+
+	edges = atomic_load_explicit(&lsp->spf_edges, memory_order_relaxed);
+	atomic_store_explicit(&lsp->spf_edges, NULL, memory_order_relaxed);
+	for (; edges; edges = next) {
+		next = edges->next;
+		XFREE(MTYPE_ISIS_SPF_EDGES, edges);
+	}
+}
+
 /*
  * C.2.6 Step 1
  */
 static int isis_spf_process_lsp(struct isis_spftree *spftree,
 				struct isis_lsp *lsp, uint32_t cost,
 				uint16_t depth, uint8_t *root_sysid,
-				struct isis_vertex *parent)
+				struct isis_vertex *parent, bool prefixes_only)
 {
 	bool pseudo_lsp = LSP_PSEUDO_ID(lsp->hdr.lsp_id);
 	struct listnode *fragnode = NULL;
 	uint32_t dist;
 	enum vertextype vtype;
-	static const uint8_t null_sysid[ISIS_SYS_ID_LEN];
 	struct isis_mt_router_info *mt_router_info = NULL;
 	struct prefix_pair ip_info;
 	bool has_valid_psid;
@@ -809,66 +940,27 @@ lspfragloop:
 		   print_sys_hostname(lsp->hdr.lsp_id));
 #endif /* EXTREME_DEBUG */
 
-	if (no_overload) {
-		if (pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST) {
-			struct isis_oldstyle_reach *r;
-			for (r = (struct isis_oldstyle_reach *)
-					 lsp->tlvs->oldstyle_reach.head;
-			     r; r = r->next) {
-				if (fabricd)
-					continue;
+	if (no_overload && !prefixes_only) {
+		const struct isis_spf_edges *edges;
 
-				/* C.2.6 a) */
-				/* Two way connectivity */
-				if (!LSP_PSEUDO_ID(r->id)
-				    && !memcmp(r->id, root_sysid,
-					       ISIS_SYS_ID_LEN))
-					continue;
-				if (!pseudo_lsp
-				    && !memcmp(r->id, null_sysid,
-					       ISIS_SYS_ID_LEN))
-					continue;
-				dist = cost + r->metric;
-				process_N(spftree,
-					  LSP_PSEUDO_ID(r->id)
-						  ? VTYPE_PSEUDO_IS
-						  : VTYPE_NONPSEUDO_IS,
-					  (void *)r->id, dist, depth + 1, NULL,
-					  parent);
-			}
-		}
+		edges = spf_lsp_edges(lsp, spftree->mtid);
+		for (uint32_t i = 0; i < edges->count; i++) {
+			const struct isis_spf_edge *edge = &edges->edges[i];
 
-		struct isis_item_list *te_neighs = NULL;
-		if (pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST)
-			te_neighs = &lsp->tlvs->extended_reach;
-		else
-			te_neighs = isis_lookup_mt_items(&lsp->tlvs->mt_reach,
-							 spftree->mtid);
-
-		struct isis_extended_reach *er;
-		for (er = te_neighs
-				  ? (struct isis_extended_reach *)
-					    te_neighs->head
-				  : NULL;
-		     er; er = er->next) {
 			/* C.2.6 a) */
 			/* Two way connectivity */
-			if (!LSP_PSEUDO_ID(er->id)
-			    && !memcmp(er->id, root_sysid, ISIS_SYS_ID_LEN))
-				continue;
-			if (!pseudo_lsp
-			    && !memcmp(er->id, null_sysid, ISIS_SYS_ID_LEN))
+			if (!LSP_PSEUDO_ID(edge->id)
+			    && !memcmp(edge->id, root_sysid, ISIS_SYS_ID_LEN))
 				continue;
 			dist = cost
-			       + (CHECK_FLAG(spftree->flags,
-					     F_SPFTREE_HOPCOUNT_METRIC)
+			       + ((edge->vtype == VTYPE_PSEUDO_TE_IS
+				   || edge->vtype == VTYPE_NONPSEUDO_TE_IS)
+					  && CHECK_FLAG(spftree->flags,
+							F_SPFTREE_HOPCOUNT_METRIC)
 					  ? 1
-					  : er->metric);
-			process_N(spftree,
-				  LSP_PSEUDO_ID(er->id) ? VTYPE_PSEUDO_TE_IS
-							: VTYPE_NONPSEUDO_TE_IS,
-				  (void *)er->id, dist, depth + 1, NULL,
-				  parent);
+					  : edge->metric);
+			process_N(spftree, edge->vtype, (void *)edge->id, dist,
+				  depth + 1, NULL, parent);
 		}
 	}
 
@@ -1160,7 +1252,8 @@ static void isis_spf_preload_tent(struct isis_spftree *spftree,
 					   parent);
 		} else if (sadj->lan.lsp_pseudo) {
 			isis_spf_process_lsp(spftree, sadj->lan.lsp_pseudo,
-					     metric, 0, spftree->sysid, parent);
+					     metric, 0, spftree->sysid, parent,
+					     false);
 		}
 	}
 }
@@ -1481,7 +1574,6 @@ static void isis_spf_loop(struct isis_spftree *spftree,
 {
 	struct isis_vertex *vertex;
 	struct isis_lsp *lsp;
-	struct listnode *node;
 
 	while (isis_vertex_queue_count(&spftree->tents)) {
 		vertex = isis_vertex_queue_pop(&spftree->tents);
@@ -1506,10 +1598,20 @@ static void isis_spf_loop(struct isis_spftree *spftree,
 		}
 
 		isis_spf_process_lsp(spftree, lsp, vertex->d_N, vertex->depth,
-				     root_sysid, vertex);
+				     root_sysid, vertex, false);
 	}
+}
+
+/**
+ * Generate the routes (and backup Adj-SIDs) of an SPT once it's formed.
+ *
+ * @param spftree	IS-IS SPF tree
+ */
+void isis_spf_process_paths(struct isis_spftree *spftree)
+{
+	struct isis_vertex *vertex;
+	struct listnode *node;
 
-	/* Generate routes once the SPT is formed. */
 	for (ALL_QUEUE_ELEMENTS_RO(&spftree->paths, node, vertex)) {
 		/* New-style TLVs take precedence over the old-style TLVs. */
 		switch (vertex->type) {
@@ -1560,6 +1662,7 @@ struct isis_spftree *isis_run_hopcount_spf(struct isis_area *area,
 	}
 
 	isis_spf_loop(spftree, sysid);
+	isis_spf_process_paths(spftree);
 
 	return spftree;
 }
@@ -1575,6 +1678,7 @@ void isis_run_spf(struct isis_spftree *spftree)
 
 	/* Get time that can't roll backwards. */
 	monotime(&time_start);
+	frrtrace(1, frr_isis, spf_start, spftree);
 
 	root_lsp = isis_root_system_lsp(spftree->lspdb, spftree->sysid);
 	if (root_lsp == NULL) {
@@ -1625,12 +1729,71 @@ void isis_run_spf(struct isis_spftree *spftree)
 	}
 
 	isis_spf_loop(spftree, spftree->sysid);
+	if (!CHECK_FLAG(spftree->flags, F_SPFTREE_DEFER_PATHS))
+		isis_spf_process_paths(spftree);
 	spftree->runcount++;
 	spftree->last_run_timestamp = time(NULL);
 	spftree->last_run_monotime = monotime(&time_end);
 	spftree->last_run_duration =
 		((time_end.tv_sec - time_start.tv_sec) * 1000000)
 		+ (time_end.tv_usec - time_start.tv_usec);
+	frrtrace(1, frr_isis, spf_end, spftree);
+}
+
+/*
+ * Partial route calculation: keep the SPT (the IS vertices) from the last
+ * run and only recalculate the IP reachability vertices hanging off it.
+ */
+void isis_run_prc(struct isis_spftree *spftree)
+{
+	struct spf_preload_tent_ip_reach_args ip_reach_args;
+	struct isis_vertex *root_vertex;
+	struct isis_vertex *vertex;
+	struct isis_lsp *root_lsp;
+	struct listnode *node, *nnode;
+
+	root_lsp = isis_root_system_lsp(spftree->lspdb, spftree->sysid);
+	if (!root_lsp || !spftree->runcount
+	    || !isis_vertex_queue_count(&spftree->paths)) {
+		isis_run_spf(spftree);
+		return;
+	}
+
+	/* Drop the IP reachability vertices of the last run. */
+	hash_clean(spftree->prefix_sids, NULL);
+	for (ALL_LIST_ELEMENTS(spftree->paths.l.list, node, nnode, vertex)) {
+		if (!VTYPE_IP(vertex->type))
+			continue;
+
+		hash_release(spftree->paths.hash, vertex);
+		list_delete_node(spftree->paths.l.list, node);
+		isis_vertex_del(vertex);
+	}
+
+	/* Re-add the prefixes of the root and of every IS in the SPT. */
+	root_vertex = listnode_head(spftree->paths.l.list);
+	ip_reach_args.spftree = spftree;
+	ip_reach_args.parent = root_vertex;
+	isis_lsp_iterate_ip_reach(root_lsp, spftree->family, spftree->mtid,
+				  isis_spf_preload_tent_ip_reach_cb,
+				  &ip_reach_args);
+
+	for (ALL_QUEUE_ELEMENTS_RO(&spftree->paths, node, vertex)) {
+		struct isis_lsp *lsp;
+
+		if (vertex == root_vertex || !VTYPE_IS(vertex->type))
+			continue;
+
+		lsp = lsp_for_vertex(spftree, vertex);
+		if (!lsp)
+			continue;
+
+		isis_spf_process_lsp(spftree, lsp, vertex->d_N, vertex->depth,
+				     spftree->sysid, vertex, true);
+	}
+
+	isis_spf_loop(spftree, spftree->sysid);
+	isis_spf_process_paths(spftree);
 }
 
 static void isis_run_spf_with_protection(struct isis_area *area,
@@ -1645,6 +1808,15 @@ static void isis_run_spf_with_protection(struct isis_area *area,
 		isis_spf_run_lfa(area, spftree);
 }
 
+static void isis_run_spf_tree(struct isis_area *area,
+			      struct isis_spftree *spftree, bool prc)
+{
+	if (prc)
+		isis_run_prc(spftree);
+	else
+		isis_run_spf_with_protection(area, spftree);
+}
+
 void isis_spf_verify_routes(struct isis_area *area, struct isis_spftree **trees)
 {
 	if (area->is_type == IS_LEVEL_1) {
@@ -1676,6 +1848,7 @@ static int isis_run_spf_cb(struct thread *thread)
 	struct isis_spf_run *run = THREAD_ARG(thread);
 	struct isis_area *area = run->area;
 	int level = run->level;
+	bool prc;
 
 	XFREE(MTYPE_ISIS_SPF_RUN, run);
 	area->spf_timer[level - 1] = NULL;
@@ -1690,19 +1863,29 @@ static int isis_run_spf_cb(struct thread *thread)
 	isis_area_delete_backup_adj_sids(area, level);
 	isis_area_invalidate_routes(area, level);
 
+	/* TI-LFA needs the post-convergence SPTs to be recomputed anyway. */
+	prc = area->spf_prc_pending[level - 1]
+	      && !area->lfa_protected_links[level - 1];
+	area->spf_prc_pending[level - 1] = false;
+
 	if (IS_DEBUG_SPF_EVENTS)
-		zlog_debug("ISIS-SPF (%s) L%d SPF needed, periodic SPF",
-			   area->area_tag, level);
+		zlog_debug("ISIS-SPF (%s) L%d %s needed, periodic SPF",
+			   area->area_tag, level, prc ? "PRC" : "SPF");
+
+	if (prc)
+		area->prc_run_count[level - 1]++;
+	else
+		area->spf_run_count[level - 1]++;
 
 	if (area->ip_circuits)
-		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_IPV4][level - 1]);
+		isis_run_spf_tree(area, area->spftree[SPFTREE_IPV4][level - 1],
+				  prc);
 	if (area->ipv6_circuits)
-		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_IPV6][level - 1]);
+		isis_run_spf_tree(area, area->spftree[SPFTREE_IPV6][level - 1],
+				  prc);
 	if (area->ipv6_circuits && isis_area_ipv6_dstsrc_enabled(area))
-		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_DSTSRC][level - 1]);
+		isis_run_spf_tree(area,
+				  area->spftree[SPFTREE_DSTSRC][level - 1], prc);
 
 	isis_area_verify_routes(area);
 
@@ -1732,7 +1915,7 @@ void isis_spf_timer_free(void *run)
 	XFREE(MTYPE_ISIS_SPF_RUN, run);
 }
 
-int _isis_spf_schedule(struct isis_area *area, int level,
+int _isis_spf_schedule(struct isis_area *area, int level, bool prc,
 		       const char *func, const char *file, int line)
 {
 	struct isis_spftree *spftree = area->spftree[SPFTREE_IPV4][level - 1];
@@ -1745,10 +1928,17 @@ int _isis_spf_schedule(struct isis_area *area, int level,
 	assert(diff >= 0);
 	assert(area->is_type & level);
 
+	/* A pending full SPF run can't be downgraded. */
+	if (!prc)
+		area->spf_prc_pending[level - 1] = false;
+	else if (!area->spf_timer[level - 1])
+		area->spf_prc_pending[level - 1] = true;
+
 	if (IS_DEBUG_SPF_EVENTS) {
 		zlog_debug(
-			"ISIS-SPF (%s) L%d SPF schedule called, lastrun %d sec ago Caller: %s %s:%d",
-			area->area_tag, level, diff, func, file, line);
+			"ISIS-SPF (%s) L%d %s schedule called, lastrun %d sec ago Caller: %s %s:%d",
+			area->area_tag, level, prc ? "PRC" : "SPF", diff, func,
+			file, line);
 	}
 
 	if (area->spf_delay_ietf[level - 1]) {
@@ -64,9 +64,13 @@ void spftree_area_del(struct isis_area *area);
 struct isis_lsp *isis_root_system_lsp(struct lspdb_head *lspdb,
 				      const uint8_t *sysid);
 #define isis_spf_schedule(area, level) \
-	_isis_spf_schedule((area), (level), __func__, \
+	_isis_spf_schedule((area), (level), false, __func__, \
 			   __FILE__, __LINE__)
-int _isis_spf_schedule(struct isis_area *area, int level,
+/* Only IP reachability changed: keep the SPT, recalculate the routes. */
+#define isis_spf_schedule_prc(area, level) \
+	_isis_spf_schedule((area), (level), true, __func__, \
+			   __FILE__, __LINE__)
+int _isis_spf_schedule(struct isis_area *area, int level, bool prc,
 		       const char *func, const char *file, int line);
 void isis_print_spftree(struct vty *vty, struct isis_spftree *spftree);
 void isis_print_routes(struct vty *vty, struct isis_spftree *spftree,
@@ -74,6 +78,9 @@ void isis_print_routes(struct vty *vty, struct isis_spftree *spftree,
 void isis_spf_init(void);
 void isis_spf_print(struct isis_spftree *spftree, struct vty *vty);
 void isis_run_spf(struct isis_spftree *spftree);
+void isis_run_prc(struct isis_spftree *spftree);
+void isis_spf_process_paths(struct isis_spftree *spftree);
+void isis_spf_lsp_edges_free(struct isis_lsp *lsp);
 struct isis_spftree *isis_run_hopcount_spf(struct isis_area *area,
 					   uint8_t *sysid,
 					   struct isis_spftree *spftree);
@@ -25,7 +25,7 @@
 
 #include "hash.h"
 #include "jhash.h"
-#include "skiplist.h"
+#include "typesafe.h"
 #include "lib_errors.h"
 
 enum vertextype {
@@ -56,10 +56,13 @@ struct isis_vertex_adj {
 	struct mpls_label_stack *label_stack;
 };
 
+PREDECL_HEAP(isis_vertex_heap)
+
 /*
  * Triple <N, d(N), {Adj(N)}>
  */
 struct isis_vertex {
+	struct isis_vertex_heap_item tent; /* TENT position */
 	enum vertextype type;
 	union {
 		uint8_t id[ISIS_SYS_ID_LEN + 1];
@@ -80,7 +83,7 @@ struct isis_vertex {
 
 struct isis_vertex_queue {
 	union {
-		struct skiplist *slist;
+		struct isis_vertex_heap_head heap;
 		struct list *list;
 	} l;
 	struct hash *hash;
@@ -127,12 +130,10 @@ static bool isis_vertex_queue_hash_cmp(const void *a, const void *b)
  * Compares vertizes for sorting in the TENT list. Returns true
  * if candidate should be considered before current, false otherwise.
  */
-__attribute__((__unused__)) static int isis_vertex_queue_tent_cmp(const void *a,
-								  const void *b)
+__attribute__((__unused__))
+static int isis_vertex_queue_tent_cmp(const struct isis_vertex *va,
+				      const struct isis_vertex *vb)
 {
-	const struct isis_vertex *va = a;
-	const struct isis_vertex *vb = b;
-
 	if (va->d_N < vb->d_N)
 		return -1;
 
@@ -154,11 +155,8 @@ __attribute__((__unused__)) static int isis_vertex_queue_tent_cmp(const void *a,
 	return 0;
 }
 
-__attribute__((__unused__))
-static struct skiplist *isis_vertex_queue_skiplist(void)
-{
-	return skiplist_new(0, isis_vertex_queue_tent_cmp, NULL);
-}
+DECLARE_HEAP(isis_vertex_heap, struct isis_vertex, tent,
+	     isis_vertex_queue_tent_cmp)
 
 __attribute__((__unused__))
 static void isis_vertex_queue_init(struct isis_vertex_queue *queue,
@@ -166,7 +164,7 @@ static void isis_vertex_queue_init(struct isis_vertex_queue *queue,
 {
 	if (ordered) {
 		queue->insert_counter = 1;
-		queue->l.slist = isis_vertex_queue_skiplist();
+		isis_vertex_heap_init(&queue->l.heap);
 	} else {
 		queue->insert_counter = 0;
 		queue->l.list = list_new();
@@ -201,11 +199,9 @@ static void isis_vertex_queue_clear(struct isis_vertex_queue *queue)
 
 	if (queue->insert_counter) {
 		struct isis_vertex *vertex;
-		while (0 == skiplist_first(queue->l.slist, NULL,
-					   (void **)&vertex)) {
+
+		while ((vertex = isis_vertex_heap_pop(&queue->l.heap)))
 			isis_vertex_del(vertex);
-			skiplist_delete_first(queue->l.slist);
-		}
 		queue->insert_counter = 1;
 	} else {
 		queue->l.list->del = (void (*)(void *))isis_vertex_del;
@@ -222,10 +218,9 @@ static void isis_vertex_queue_free(struct isis_vertex_queue *queue)
 	hash_free(queue->hash);
 	queue->hash = NULL;
 
-	if (queue->insert_counter) {
-		skiplist_free(queue->l.slist);
-		queue->l.slist = NULL;
-	} else
+	if (queue->insert_counter)
+		isis_vertex_heap_fini(&queue->l.heap);
+	else
 		list_delete(&queue->l.list);
 }
 
@@ -268,7 +263,7 @@ static void isis_vertex_queue_insert(struct isis_vertex_queue *queue,
 	vertex->insert_counter = queue->insert_counter++;
 	assert(queue->insert_counter != (uint64_t)-1);
 
-	skiplist_insert(queue->l.slist, vertex, vertex);
+	isis_vertex_heap_add(&queue->l.heap, vertex);
 
 	struct isis_vertex *inserted;
 	inserted = hash_get(queue->hash, vertex, hash_alloc_intern);
@@ -283,10 +278,10 @@ isis_vertex_queue_pop(struct isis_vertex_queue *queue)
 
 	struct isis_vertex *rv;
 
-	if (skiplist_first(queue->l.slist, NULL, (void **)&rv))
+	rv = isis_vertex_heap_pop(&queue->l.heap);
+	if (!rv)
 		return NULL;
 
-	skiplist_delete_first(queue->l.slist);
 	hash_release(queue->hash, rv);
 
 	return rv;
@@ -298,7 +293,7 @@ static void isis_vertex_queue_delete(struct isis_vertex_queue *queue,
 {
 	assert(queue->insert_counter);
 
-	skiplist_delete(queue->l.slist, vertex, vertex);
+	isis_vertex_heap_del(&queue->l.heap, vertex);
 	hash_release(queue->hash, vertex);
 }
 
@@ -341,12 +336,17 @@ struct isis_spftree {
 		/* P-space and Q-space. */
 		struct isis_spf_nodes p_space;
 		struct isis_spf_nodes q_space;
+
+		/* P-space of the unaffected adjacent routers. */
+		struct isis_spf_nodes adj_p_space;
 	} lfa;
 	uint8_t flags;
 };
 #define F_SPFTREE_HOPCOUNT_METRIC 0x01
 #define F_SPFTREE_NO_ROUTES 0x02
 #define F_SPFTREE_NO_ADJACENCIES 0x04
+/* Leave isis_spf_process_paths() to the caller (e.g. a parallel TI-LFA run). */
+#define F_SPFTREE_DEFER_PATHS 0x08
 
 __attribute__((__unused__))
 static void isis_vertex_id_init(struct isis_vertex *vertex, const void *id,
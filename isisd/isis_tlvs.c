@@ -27,6 +27,7 @@
 #ifdef CRYPTO_INTERNAL
 #include "md5.h"
 #endif
+#include "jhash.h"
 #include "memory.h"
 #include "stream.h"
 #include "sbuf.h"
@@ -4099,6 +4100,147 @@ int isis_unpack_tlvs(size_t avail_len, struct stream *stream,
 	return rv;
 }
 
+static struct sbuf view_logbuf;
+
+static void tlvs_view_log_reset(void)
+{
+	if (!sbuf_buf(&view_logbuf))
+		sbuf_init(&view_logbuf, NULL, 0);
+
+	sbuf_reset(&view_logbuf);
+}
+
+#define VIEW_BIT_SET(bits, type) ((bits)[(type) / 32] |= 1U << ((type) % 32))
+#define VIEW_BIT_TEST(bits, type) ((bits)[(type) / 32] & (1U << ((type) % 32)))
+
+/*
+ * Walk the TLV headers of a PDU without decoding anything. The stream is
+ * left positioned after the TLVs, as isis_unpack_tlvs() would.
+ */
+int isis_tlvs_view_init(struct isis_tlvs_view *view, size_t avail_len,
+			struct stream *stream, const char **log)
+{
+	size_t pos = 0;
+
+	memset(view, 0, sizeof(*view));
+	tlvs_view_log_reset();
+	*log = sbuf_buf(&view_logbuf);
+
+	if (avail_len > STREAM_READABLE(stream)) {
+		sbuf_push(&view_logbuf, 0,
+			  "Stream doesn't contain sufficient data. Claimed %zu, available %zu\n",
+			  avail_len, STREAM_READABLE(stream));
+		return 1;
+	}
+
+	view->stream = stream;
+	view->start = stream_get_getp(stream);
+	view->len = avail_len;
+
+	while (pos < avail_len) {
+		uint8_t tlv_type, tlv_len;
+
+		if (avail_len - pos < 2) {
+			sbuf_push(&view_logbuf, 0,
+				  "Available data %zu too short to contain a TLV header.\n",
+				  avail_len - pos);
+			return 1;
+		}
+
+		tlv_type = stream_getc_from(stream, view->start + pos);
+		tlv_len = stream_getc_from(stream, view->start + pos + 1);
+		if (avail_len - pos - 2 < tlv_len) {
+			sbuf_push(&view_logbuf, 0,
+				  "Available data %zu too short for claimed TLV len %hhu.\n",
+				  avail_len - pos - 2, tlv_len);
+			return 1;
+		}
+
+		VIEW_BIT_SET(view->present, tlv_type);
+		pos += 2 + tlv_len;
+	}
+
+	stream_forward_getp(stream, avail_len);
+	return 0;
+}
+
+static int tlvs_view_decode(struct isis_tlvs_view *view, int tlv_type,
+			    const char **log)
+{
+	struct stream *s = view->stream;
+	size_t getp = stream_get_getp(s);
+	size_t pos = 0;
+	int rv = 0;
+
+	tlvs_view_log_reset();
+
+	if (!view->tlvs)
+		view->tlvs = isis_alloc_tlvs();
+
+	while (pos < view->len) {
+		uint8_t type = stream_getc_from(s, view->start + pos);
+		uint8_t len = stream_getc_from(s, view->start + pos + 1);
+
+		if ((tlv_type < 0 || type == tlv_type)
+		    && !VIEW_BIT_TEST(view->decoded, type)) {
+			stream_set_getp(s, view->start + pos);
+			rv = unpack_tlv(ISIS_CONTEXT_LSP, view->len - pos, s,
+					&view_logbuf, view->tlvs, 0, NULL);
+			if (rv)
+				break;
+		}
+
+		pos += 2 + len;
+	}
+
+	if (!rv) {
+		if (tlv_type < 0)
+			memset(view->decoded, 0xff, sizeof(view->decoded));
+		else
+			VIEW_BIT_SET(view->decoded, tlv_type);
+	}
+
+	stream_set_getp(s, getp);
+	*log = sbuf_buf(&view_logbuf);
+	return rv;
+}
+
+/* Decode all TLVs of the given type into view->tlvs */
+int isis_tlvs_view_decode(struct isis_tlvs_view *view, uint8_t tlv_type,
+			  const char **log)
+{
+	if (!VIEW_BIT_TEST(view->present, tlv_type)
+	    || VIEW_BIT_TEST(view->decoded, tlv_type)) {
+		if (!view->tlvs)
+			view->tlvs = isis_alloc_tlvs();
+		*log = NULL;
+		return 0;
+	}
+
+	return tlvs_view_decode(view, tlv_type, log);
+}
+
+/* Decode all TLVs which haven't been decoded yet into view->tlvs */
+int isis_tlvs_view_decode_all(struct isis_tlvs_view *view, const char **log)
+{
+	return tlvs_view_decode(view, -1, log);
+}
+
+/* Hand over the decoded TLVs to the caller */
+struct isis_tlvs *isis_tlvs_view_take(struct isis_tlvs_view *view)
+{
+	struct isis_tlvs *tlvs = view->tlvs;
+
+	view->tlvs = NULL;
+	return tlvs;
+}
+
+void isis_tlvs_view_fini(struct isis_tlvs_view *view)
+{
+	isis_free_tlvs(view->tlvs);
+	view->tlvs = NULL;
+}
+
 #define TLV_OPS(_name_, _desc_)                                                \
 	static const struct tlv_ops tlv_##_name_##_ops = {                     \
 		.name = _desc_, .unpack = unpack_tlv_##_name_,                 \
@@ -4863,6 +5005,52 @@ isis_tlvs_lookup_mt_router_info(struct isis_tlvs *tlvs, uint16_t mtid)
 	return NULL;
 }
 
+static uint32_t isis_is_reach_hash(const struct isis_item_list *l,
+				   uint32_t hash)
+{
+	for (struct isis_extended_reach *r =
+		     (struct isis_extended_reach *)l->head;
+	     r; r = r->next) {
+		hash = jhash(r->id, sizeof(r->id), hash);
+		hash = jhash_1word(r->metric, hash);
+	}
+
+	return hash;
+}
+
+/*
+ * Hash of everything in the TLVs that can change the shape of the SPT (IS
+ * reachability, supported protocols and topologies, per-MT overload). LSP
+ * changes that keep it unchanged only need the routes to be recalculated.
+ */
+uint32_t isis_tlvs_topology_hash(struct isis_tlvs *tlvs)
+{
+	struct isis_item_list *l;
+	uint32_t hash = 0;
+
+	hash = jhash(tlvs->protocols_supported.protocols,
+		     tlvs->protocols_supported.count, hash);
+	hash = jhash_1word(tlvs->mt_router_info_empty, hash);
+	for (struct isis_mt_router_info *info =
+		     (struct isis_mt_router_info *)tlvs->mt_router_info.head;
+	     info; info = info->next)
+		hash = jhash_2words(info->mtid, info->overload, hash);
+
+	for (struct isis_oldstyle_reach *r =
+		     (struct isis_oldstyle_reach *)tlvs->oldstyle_reach.head;
+	     r; r = r->next) {
+		hash = jhash(r->id, sizeof(r->id), hash);
+		hash = jhash_1word(r->metric, hash);
+	}
+	hash = isis_is_reach_hash(&tlvs->extended_reach, hash);
+	RB_FOREACH (l, isis_mt_item_list, &tlvs->mt_reach) {
+		hash = jhash_1word(l->mtid, hash);
+		hash = isis_is_reach_hash(l, hash);
+	}
+
+	return hash;
+}
+
 void isis_tlvs_set_purge_originator(struct isis_tlvs *tlvs,
 				    const uint8_t *generator,
 				    const uint8_t *sender)
@@ -543,6 +543,29 @@ int isis_unpack_tlvs(size_t avail_len, struct stream *stream,
 		     struct isis_tlvs **dest, const char **error_log);
 const char *isis_format_tlvs(struct isis_tlvs *tlvs);
 struct isis_tlvs *isis_copy_tlvs(struct isis_tlvs *tlvs);
+
+/*
+ * Lazily decoded view on the TLVs of a received PDU. Only the TLV headers
+ * are validated up front, the TLV contents are decoded from the receive
+ * stream on demand, one TLV type at a time.
+ */
+struct isis_tlvs_view {
+	struct stream *stream;
+	size_t start;
+	size_t len;
+	uint32_t present[ISIS_TLV_MAX / 32];
+	uint32_t decoded[ISIS_TLV_MAX / 32];
+	struct isis_tlvs *tlvs;
+};
+
+int isis_tlvs_view_init(struct isis_tlvs_view *view, size_t avail_len,
+			struct stream *stream, const char **error_log);
+int isis_tlvs_view_decode(struct isis_tlvs_view *view, uint8_t tlv_type,
+			  const char **error_log);
+int isis_tlvs_view_decode_all(struct isis_tlvs_view *view,
+			      const char **error_log);
+struct isis_tlvs *isis_tlvs_view_take(struct isis_tlvs_view *view);
+void isis_tlvs_view_fini(struct isis_tlvs_view *view);
 struct list *isis_fragment_tlvs(struct isis_tlvs *tlvs, size_t size);
 
 #define ISIS_EXTENDED_IP_REACH_DOWN 0x80
@@ -634,6 +657,8 @@ void isis_tlvs_add_spine_leaf(struct isis_tlvs *tlvs, uint8_t tier,
 struct isis_mt_router_info *
 isis_tlvs_lookup_mt_router_info(struct isis_tlvs *tlvs, uint16_t mtid);
 
+uint32_t isis_tlvs_topology_hash(struct isis_tlvs *tlvs);
+
 void isis_tlvs_set_purge_originator(struct isis_tlvs *tlvs,
 				    const uint8_t *generator,
 				    const uint8_t *sender);
@@ -0,0 +1,76 @@
+/* Tracing for IS-IS
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#if !defined(_ISIS_TRACE_H) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define _ISIS_TRACE_H
+
+#include "lib/trace.h"
+
+#ifdef HAVE_LTTNG
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER frr_isis
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "isisd/isis_trace.h"
+
+#include <lttng/tracepoint.h>
+
+#include "isisd/isisd.h"
+#include "isisd/isis_spf.h"
+#include "isisd/isis_spf_private.h"
+
+/* clang-format off */
+
+TRACEPOINT_EVENT(
+	frr_isis,
+	spf_start,
+	TP_ARGS(struct isis_spftree *, spftree),
+	TP_FIELDS(
+		ctf_array(uint8_t, sysid, spftree->sysid, ISIS_SYS_ID_LEN)
+		ctf_integer(int, level, spftree->level)
+		ctf_integer(int, tree_id, spftree->tree_id)
+		ctf_integer(int, type, spftree->type)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_isis, spf_start, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_isis,
+	spf_end,
+	TP_ARGS(struct isis_spftree *, spftree),
+	TP_FIELDS(
+		ctf_array(uint8_t, sysid, spftree->sysid, ISIS_SYS_ID_LEN)
+		ctf_integer(int, level, spftree->level)
+		ctf_integer(int, tree_id, spftree->tree_id)
+		ctf_integer(int, type, spftree->type)
+		ctf_integer(unsigned int, vertices,
+			    isis_vertex_queue_count(&spftree->paths))
+		ctf_integer(time_t, duration, spftree->last_run_duration)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_isis, spf_end, TRACE_INFO)
+
+/* clang-format on */
+
+#include <lttng/tracepoint-event.h>
+
+#endif /* HAVE_LTTNG */
+
+#endif /* _ISIS_TRACE_H */
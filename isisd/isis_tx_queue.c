@@ -23,6 +23,8 @@
 
 #include "hash.h"
 #include "jhash.h"
+#include "monotime.h"
+#include "typesafe.h"
 
 #include "isisd/isisd.h"
 #include "isisd/isis_memory.h"
@@ -35,21 +37,41 @@
 DEFINE_MTYPE_STATIC(ISISD, TX_QUEUE, "ISIS TX Queue")
 DEFINE_MTYPE_STATIC(ISISD, TX_QUEUE_ENTRY, "ISIS TX Queue Entry")
 
+/* Retransmission interval for LSPs which haven't been acknowledged */
+#define TX_QUEUE_RETRY_INTERVAL 5
+/* Maximum number of LSPs sent per run of the queue */
+#define TX_QUEUE_BATCH 64
+
+PREDECL_DLIST(tx_queue_list)
+
+/*
+ * Each queue is driven by a single thread. LSPs to be sent are kept on the
+ * pending list, LSPs waiting for acknowledgement are kept on the retry list.
+ * As the retransmission interval is fixed, the retry list is ordered by
+ * the time the entries are due.
+ */
 struct isis_tx_queue {
 	struct isis_circuit *circuit;
 	void (*send_event)(struct isis_circuit *circuit,
 			   struct isis_lsp *, enum isis_tx_type);
 	struct hash *hash;
+	struct tx_queue_list_head pending;
+	struct tx_queue_list_head retry;
+	struct thread *thread;
 };
 
 struct isis_tx_queue_entry {
 	struct isis_lsp *lsp;
 	enum isis_tx_type type;
 	bool is_retry;
-	struct thread *retry;
+	struct timeval due;
+	struct tx_queue_list_item item;
+	struct tx_queue_list_head *list;
 	struct isis_tx_queue *queue;
 };
 
+DECLARE_DLIST(tx_queue_list, struct isis_tx_queue_entry, item)
+
 static unsigned tx_queue_hash_key(const void *p)
 {
 	const struct isis_tx_queue_entry *e = p;
@@ -86,22 +108,37 @@ struct isis_tx_queue *isis_tx_queue_new(
 	rv->send_event = send_event;
 
 	rv->hash = hash_create(tx_queue_hash_key, tx_queue_hash_cmp, NULL);
+	tx_queue_list_init(&rv->pending);
+	tx_queue_list_init(&rv->retry);
 	return rv;
 }
 
+static void tx_queue_entry_move(struct isis_tx_queue_entry *e,
+				struct tx_queue_list_head *list)
+{
+	if (e->list)
+		tx_queue_list_del(e->list, e);
+	e->list = list;
+	if (list)
+		tx_queue_list_add_tail(list, e);
+}
+
 static void tx_queue_element_free(void *element)
 {
 	struct isis_tx_queue_entry *e = element;
 
-	thread_cancel(&(e->retry));
+	tx_queue_entry_move(e, NULL);
 
 	XFREE(MTYPE_TX_QUEUE_ENTRY, e);
 }
 
 void isis_tx_queue_free(struct isis_tx_queue *queue)
 {
+	thread_cancel(&queue->thread);
 	hash_clean(queue->hash, tx_queue_element_free);
 	hash_free(queue->hash);
+	tx_queue_list_fini(&queue->pending);
+	tx_queue_list_fini(&queue->retry);
 	XFREE(MTYPE_TX_QUEUE, queue);
 }
 
@@ -115,13 +152,42 @@ static struct isis_tx_queue_entry *tx_queue_find(struct isis_tx_queue *queue,
 	return hash_lookup(queue->hash, &e);
 }
 
-static int tx_queue_send_event(struct thread *thread)
+static int tx_queue_run(struct thread *thread);
+
+static void tx_queue_schedule(struct isis_tx_queue *queue)
+{
+	struct isis_tx_queue_entry *e;
+	struct timeval now, remain;
+
+	thread_cancel(&queue->thread);
+
+	if (tx_queue_list_count(&queue->pending)) {
+		thread_add_event(master, tx_queue_run, queue, 0,
+				 &queue->thread);
+		return;
+	}
+
+	e = tx_queue_list_first(&queue->retry);
+	if (!e)
+		return;
+
+	monotime(&now);
+	if (timercmp(&e->due, &now, >))
+		timersub(&e->due, &now, &remain);
+	else
+		timerclear(&remain);
+	thread_add_timer_tv(master, tx_queue_run, queue, &remain,
+			    &queue->thread);
+}
+
+static void tx_queue_send(struct isis_tx_queue *queue,
+			  struct isis_tx_queue_entry *e,
+			  const struct timeval *now)
 {
-	struct isis_tx_queue_entry *e = THREAD_ARG(thread);
-	struct isis_tx_queue *queue = e->queue;
+	struct timeval interval = {.tv_sec = TX_QUEUE_RETRY_INTERVAL};
 
-	e->retry = NULL;
-	thread_add_timer(master, tx_queue_send_event, e, 5, &e->retry);
+	timeradd(now, &interval, &e->due);
+	tx_queue_entry_move(e, &queue->retry);
 
 	if (e->is_retry)
 		queue->circuit->area->lsp_rxmt_count++;
@@ -130,7 +196,31 @@ static int tx_queue_send_event(struct thread *thread)
 
 	queue->send_event(queue->circuit, e->lsp, e->type);
 	/* Don't access e here anymore, send_event might have destroyed it */
+}
 
+static int tx_queue_run(struct thread *thread)
+{
+	struct isis_tx_queue *queue = THREAD_ARG(thread);
+	struct isis_tx_queue_entry *e;
+	struct timeval now;
+	unsigned int sent = 0;
+
+	queue->thread = NULL;
+	monotime(&now);
+
+	while (sent < TX_QUEUE_BATCH) {
+		e = tx_queue_list_first(&queue->pending);
+		if (!e) {
+			e = tx_queue_list_first(&queue->retry);
+			if (!e || timercmp(&e->due, &now, >))
+				break;
+		}
+
+		tx_queue_send(queue, e, &now);
+		sent++;
+	}
+
+	tx_queue_schedule(queue);
 	return 0;
 }
 
@@ -164,11 +254,15 @@ void _isis_tx_queue_add(struct isis_tx_queue *queue,
 	}
 
 	e->type = type;
+	e->is_retry = false;
 
-	thread_cancel(&(e->retry));
-	thread_add_event(master, tx_queue_send_event, e, 0, &e->retry);
+	if (e->list == &queue->pending)
+		return;
 
-	e->is_retry = false;
+	tx_queue_entry_move(e, &queue->pending);
+	/* A run of the queue is already scheduled otherwise */
+	if (tx_queue_list_count(&queue->pending) == 1)
+		tx_queue_schedule(queue);
 }
 
 void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
@@ -188,10 +282,8 @@ void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
 			   func, file, line);
 	}
 
-	thread_cancel(&(e->retry));
-
 	hash_release(queue->hash, e);
-	XFREE(MTYPE_TX_QUEUE_ENTRY, e);
+	tx_queue_element_free(e);
 }
 
 unsigned long isis_tx_queue_len(struct isis_tx_queue *queue)
@@ -204,5 +296,6 @@ unsigned long isis_tx_queue_len(struct isis_tx_queue *queue)
 
 void isis_tx_queue_clean(struct isis_tx_queue *queue)
 {
+	thread_cancel(&queue->thread);
 	hash_clean(queue->hash, tx_queue_element_free);
 }
@@ -37,6 +37,7 @@
 #include "nexthop.h"
 #include "vrf.h"
 #include "libfrr.h"
+#include "jhash.h"
 
 #include "isisd/isis_constants.h"
 #include "isisd/isis_common.h"
@@ -339,6 +340,7 @@ void isis_zebra_prefix_sid_install(struct isis_area *area,
 				   struct isis_sr_psid_info *psid)
 {
 	struct zapi_labels zl;
+	uint32_t hash;
 	int count = 0;
 
 	sr_debug("ISIS-Sr (%s): update label %u for prefix %pFX",
@@ -389,8 +391,22 @@ void isis_zebra_prefix_sid_install(struct isis_area *area,
 		zl.nexthop_num = count;
 	}
 
+	/*
+	 * Skip label entries identical to the one last sent to zebra, as is
+	 * the case whenever only the IP route changed or the route was merely
+	 * relinked to its backup.
+	 */
+	if (zapi_labels_encode(zclient->obuf, ZEBRA_MPLS_LABELS_REPLACE, &zl)
+	    < 0)
+		return;
+	hash = jhash(STREAM_DATA(zclient->obuf),
+		     stream_get_endp(zclient->obuf), 0);
+	if (hash == rinfo->sr_hash)
+		return;
+
 	/* Send message to zebra. */
-	(void)zebra_send_mpls_labels(zclient, ZEBRA_MPLS_LABELS_REPLACE, &zl);
+	if (zclient_send_message(zclient) != ZCLIENT_SEND_FAILURE)
+		rinfo->sr_hash = hash;
 }
 
 /**
@@ -418,6 +434,25 @@ void isis_zebra_prefix_sid_uninstall(struct isis_area *area,
 
 	/* Send message to zebra. */
 	(void)zebra_send_mpls_labels(zclient, ZEBRA_MPLS_LABELS_DELETE, &zl);
+	rinfo->sr_hash = 0;
+}
+
+/**
+ * Start batching messages to zebra, see zclient_batch_start().
+ */
+void isis_zebra_batch_start(void)
+{
+	if (zclient)
+		zclient_batch_start(zclient);
+}
+
+/**
+ * Flush messages batched since isis_zebra_batch_start().
+ */
+void isis_zebra_batch_end(void)
+{
+	if (zclient)
+		(void)zclient_batch_end(zclient);
 }
 
 /**
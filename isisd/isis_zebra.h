@@ -56,6 +56,8 @@ void isis_zebra_prefix_sid_uninstall(struct isis_area *area,
 				     struct isis_route_info *rinfo,
 				     struct isis_sr_psid_info *psid);
 void isis_zebra_send_adjacency_sid(int cmd, const struct sr_adjacency *sra);
+void isis_zebra_batch_start(void);
+void isis_zebra_batch_end(void);
 int isis_distribute_list_update(int routetype);
 void isis_zebra_redistribute_set(afi_t afi, int type);
 void isis_zebra_redistribute_unset(afi_t afi, int type);
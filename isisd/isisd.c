@@ -1792,6 +1792,11 @@ static void isis_spf_ietf_common(struct vty *vty, struct isis *isis)
 			} else {
 				vty_out(vty, "Not scheduled\n");
 			}
+			vty_out(vty,
+				"    Full SPF runs: %" PRIu64
+				", partial route calculations: %" PRIu64 "\n",
+				area->spf_run_count[level - 1],
+				area->prc_run_count[level - 1]);
 
 			if (area->spf_delay_ietf[level - 1]) {
 				vty_out(vty,
@@ -2041,6 +2046,8 @@ void show_isis_database_lspdb(struct vty *vty, struct isis_area *area,
 {
 	struct isis_lsp *lsp;
 	int lsp_count;
+	size_t pdu_bytes;
+	unsigned int decoded;
 
 	if (lspdb_count(lspdb) > 0) {
 		lsp = lsp_for_arg(lspdb, argv, area->isis);
@@ -2066,7 +2073,11 @@ void show_isis_database_lspdb(struct vty *vty, struct isis_area *area,
 				lsp_print_all(vty, lspdb, ui_level,
 					      area->dynhostname, area->isis);
 
-			vty_out(vty, "    %u LSPs\n\n", lsp_count);
+			lsp_db_usage(lspdb, &pdu_bytes, &decoded);
+			vty_out(vty, "    %u LSPs\n", lsp_count);
+			vty_out(vty,
+				"    %zu bytes of PDUs, %u LSPs decoded\n\n",
+				pdu_bytes, decoded);
 		}
 	}
 }
@@ -200,6 +200,10 @@ struct isis_area {
 							    SPF algo
 							    parameters*/
 	struct thread *spf_timer[ISIS_LEVELS];
+	/* Pending run only needs a partial route calculation. */
+	bool spf_prc_pending[ISIS_LEVELS];
+	uint64_t spf_run_count[ISIS_LEVELS];
+	uint64_t prc_run_count[ISIS_LEVELS];
 
 	struct lsp_refresh_arg lsp_refresh_arg[ISIS_LEVELS];
 
@@ -201,8 +201,11 @@ lde_shutdown(void)
 
 	config_clear(ldeconf);
 
-	if (iev_ldpe)
+	if (iev_ldpe) {
+		imsg_batch_clear(iev_ldpe);
 		free(iev_ldpe);
+	}
+	imsg_batch_clear(iev_main);
 	free(iev_main);
 
 	log_info("label decision engine exiting");
@@ -217,6 +220,16 @@ lde_imsg_compose_parent(int type, pid_t pid, void *data, uint16_t datalen)
 {
 	if (iev_main->ibuf.fd == -1)
 		return (0);
+
+	switch (type) {
+	case IMSG_KLABEL_CHANGE:
+	case IMSG_KLABEL_DELETE:
+		/* kernel label changes go out many per imsg */
+		return (imsg_compose_batch(iev_main, type, 0, data, datalen));
+	default:
+		break;
+	}
+
 	return (imsg_compose_event(iev_main, type, 0, pid, -1, data, datalen));
 }
 
@@ -235,6 +248,19 @@ lde_imsg_compose_ldpe(int type, uint32_t peerid, pid_t pid, void *data,
 {
 	if (iev_ldpe->ibuf.fd == -1)
 		return (0);
+
+	switch (type) {
+	case IMSG_MAPPING_ADD:
+	case IMSG_RELEASE_ADD:
+	case IMSG_REQUEST_ADD:
+	case IMSG_WITHDRAW_ADD:
+		/* several FECs per imsg */
+		return (imsg_compose_batch(iev_ldpe, type, peerid, data,
+		    datalen));
+	default:
+		break;
+	}
+
 	return (imsg_compose_event(iev_ldpe, type, peerid, pid,
 	     -1, data, datalen));
 }
@@ -250,6 +276,7 @@ lde_dispatch_imsg(struct thread *thread)
 	struct map		*map;
 	struct lde_addr		*lde_addr;
 	struct notify_msg	*nm;
+	size_t			 i, nmap;
 	ssize_t			 n;
 	int			 shut = 0;
 
@@ -282,10 +309,12 @@ lde_dispatch_imsg(struct thread *thread)
 		case IMSG_LABEL_RELEASE:
 		case IMSG_LABEL_WITHDRAW:
 		case IMSG_LABEL_ABORT:
-			if (imsg.hdr.len - IMSG_HEADER_SIZE !=
+			/* ldpe packs several FECs per imsg */
+			if ((imsg.hdr.len - IMSG_HEADER_SIZE) %
 			    sizeof(struct map))
 				fatalx("lde_dispatch_imsg: wrong imsg len");
 			map = imsg.data;
+			nmap = (imsg.hdr.len - IMSG_HEADER_SIZE) / sizeof(*map);
 
 			ln = lde_nbr_find(imsg.hdr.peerid);
 			if (ln == NULL) {
@@ -294,22 +323,24 @@ lde_dispatch_imsg(struct thread *thread)
 				break;
 			}
 
-			switch (imsg.hdr.type) {
-			case IMSG_LABEL_MAPPING:
-				lde_check_mapping(map, ln, 1);
-				break;
-			case IMSG_LABEL_REQUEST:
-				lde_check_request(map, ln);
-				break;
-			case IMSG_LABEL_RELEASE:
-				lde_check_release(map, ln);
-				break;
-			case IMSG_LABEL_WITHDRAW:
-				lde_check_withdraw(map, ln);
-				break;
-			case IMSG_LABEL_ABORT:
-				/* not necessary */
-				break;
+			for (i = 0; i < nmap; i++) {
+				switch (imsg.hdr.type) {
+				case IMSG_LABEL_MAPPING:
+					lde_check_mapping(&map[i], ln, 1);
+					break;
+				case IMSG_LABEL_REQUEST:
+					lde_check_request(&map[i], ln);
+					break;
+				case IMSG_LABEL_RELEASE:
+					lde_check_release(&map[i], ln);
+					break;
+				case IMSG_LABEL_WITHDRAW:
+					lde_check_withdraw(&map[i], ln);
+					break;
+				case IMSG_LABEL_ABORT:
+					/* not necessary */
+					break;
+				}
 			}
 			break;
 		case IMSG_ADDRESS_ADD:
@@ -543,7 +574,7 @@ lde_dispatch_parent(struct thread *thread)
 				break;
 			}
 
-			if ((iev_ldpe = malloc(sizeof(struct imsgev))) == NULL)
+			if ((iev_ldpe = calloc(1, sizeof(struct imsgev))) == NULL)
 				fatal(NULL);
 			imsg_init(&iev_ldpe->ibuf, fd);
 			iev_ldpe->handler_read = lde_dispatch_imsg;
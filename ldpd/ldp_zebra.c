@@ -298,6 +298,19 @@ kr_delete(struct kroute *kr)
 	return (ldp_zebra_send_mpls_labels(ZEBRA_MPLS_LABELS_DELETE, kr));
 }
 
+/* write label changes between these two out to zebra together */
+void
+kr_batch_start(void)
+{
+	zclient_batch_start(zclient);
+}
+
+void
+kr_batch_end(void)
+{
+	(void)zclient_batch_end(zclient);
+}
+
 int
 kmpw_add(struct zapi_pw *zpw)
 {
@@ -623,6 +623,8 @@ main_dispatch_lde(struct thread *thread)
 	struct imsgev	*iev = THREAD_ARG(thread);
 	struct imsgbuf	*ibuf = &iev->ibuf;
 	struct imsg	 imsg;
+	struct kroute	*kr;
+	size_t		 i, nkr;
 	ssize_t		 n;
 	int		 shut = 0;
 
@@ -633,6 +635,9 @@ main_dispatch_lde(struct thread *thread)
 	if (n == 0)	/* connection closed */
 		shut = 1;
 
+	/* send all label changes read this time to zebra together */
+	kr_batch_start();
+
 	for (;;) {
 		if ((n = imsg_get(ibuf, &imsg)) == -1)
 			fatal("imsg_get");
@@ -645,18 +650,26 @@ main_dispatch_lde(struct thread *thread)
 			logit(imsg.hdr.pid, "%s", (const char *)imsg.data);
 			break;
 		case IMSG_KLABEL_CHANGE:
-			if (imsg.hdr.len - IMSG_HEADER_SIZE !=
+			if ((imsg.hdr.len - IMSG_HEADER_SIZE) %
 			    sizeof(struct kroute))
 				fatalx("invalid size of IMSG_KLABEL_CHANGE");
-			if (kr_change(imsg.data))
-				log_warnx("%s: error changing route", __func__);
+			kr = imsg.data;
+			nkr = (imsg.hdr.len - IMSG_HEADER_SIZE) / sizeof(*kr);
+			for (i = 0; i < nkr; i++)
+				if (kr_change(&kr[i]))
+					log_warnx("%s: error changing route",
+					    __func__);
 			break;
 		case IMSG_KLABEL_DELETE:
-			if (imsg.hdr.len - IMSG_HEADER_SIZE !=
+			if ((imsg.hdr.len - IMSG_HEADER_SIZE) %
 			    sizeof(struct kroute))
 				fatalx("invalid size of IMSG_KLABEL_DELETE");
-			if (kr_delete(imsg.data))
-				log_warnx("%s: error deleting route", __func__);
+			kr = imsg.data;
+			nkr = (imsg.hdr.len - IMSG_HEADER_SIZE) / sizeof(*kr);
+			for (i = 0; i < nkr; i++)
+				if (kr_delete(&kr[i]))
+					log_warnx("%s: error deleting route",
+					    __func__);
 			break;
 		case IMSG_KPW_ADD:
 		case IMSG_KPW_DELETE:
@@ -698,6 +711,7 @@ main_dispatch_lde(struct thread *thread)
 		}
 		imsg_free(&imsg);
 	}
+	kr_batch_end();
 	if (!shut)
 		imsg_event_add(iev);
 	else {
@@ -782,12 +796,77 @@ imsg_compose_event(struct imsgev *iev, uint16_t type, uint32_t peerid,
 {
 	int	ret;
 
+	/* keep ordering with batched records */
+	imsg_batch_flush(iev);
+
 	if ((ret = imsg_compose(&iev->ibuf, type, peerid,
 	    pid, fd, data, datalen)) != -1)
 		imsg_event_add(iev);
 	return (ret);
 }
 
+static int
+imsg_batch_flush_cb(struct thread *thread)
+{
+	imsg_batch_flush(THREAD_ARG(thread));
+
+	return (0);
+}
+
+/*
+ * Queue a fixed size record for `iev`. Consecutive records of the same
+ * type and peer are packed into a single imsg, which the receiver walks as
+ * an array. The batch goes out when it is full, when anything else is
+ * sent to `iev` and at the latest once the current event is done.
+ */
+int
+imsg_compose_batch(struct imsgev *iev, uint16_t type, uint32_t peerid,
+    void *data, uint16_t datalen)
+{
+	if (iev->batch_len > 0 && (iev->batch_type != type ||
+	    iev->batch_peerid != peerid ||
+	    iev->batch_len + datalen > IMSG_BATCH_SIZE))
+		imsg_batch_flush(iev);
+
+	if (iev->batch_buf == NULL &&
+	    (iev->batch_buf = malloc(IMSG_BATCH_SIZE)) == NULL)
+		fatal(NULL);
+
+	iev->batch_type = type;
+	iev->batch_peerid = peerid;
+	memcpy(iev->batch_buf + iev->batch_len, data, datalen);
+	iev->batch_len += datalen;
+
+	thread_add_event(master, imsg_batch_flush_cb, iev, 0, &iev->ev_batch);
+
+	return (1);
+}
+
+void
+imsg_batch_flush(struct imsgev *iev)
+{
+	uint16_t	 len = iev->batch_len;
+
+	if (len == 0)
+		return;
+
+	iev->batch_len = 0;
+	thread_cancel(&iev->ev_batch);
+
+	if (imsg_compose(&iev->ibuf, iev->batch_type, iev->batch_peerid, 0,
+	    -1, iev->batch_buf, len) != -1)
+		imsg_event_add(iev);
+}
+
+void
+imsg_batch_clear(struct imsgev *iev)
+{
+	thread_cancel(&iev->ev_batch);
+	free(iev->batch_buf);
+	iev->batch_buf = NULL;
+	iev->batch_len = 0;
+}
+
 void
 evbuf_enqueue(struct evbuf *eb, struct ibuf *buf)
 {
@@ -73,8 +73,17 @@ struct imsgev {
 	struct thread		*ev_write;
 	int			(*handler_read)(struct thread *);
 	struct thread		*ev_read;
+
+	/* pending records, see imsg_compose_batch() */
+	uint8_t			*batch_buf;
+	uint16_t		 batch_len;
+	uint16_t		 batch_type;
+	uint32_t		 batch_peerid;
+	struct thread		*ev_batch;
 };
 
+#define IMSG_BATCH_SIZE		(MAX_IMSGSIZE - IMSG_HEADER_SIZE)
+
 enum imsg_type {
 	IMSG_NONE,
 	IMSG_CTL_RELOAD,
@@ -734,6 +743,8 @@ void		 pw2zpw(struct l2vpn_pw *, struct zapi_pw *);
 void		 kif_redistribute(const char *);
 int		 kr_change(struct kroute *);
 int		 kr_delete(struct kroute *);
+void		 kr_batch_start(void);
+void		 kr_batch_end(void);
 int		 kmpw_add(struct zapi_pw *);
 int		 kmpw_del(struct zapi_pw *);
 int		 kmpw_set(struct zapi_pw *);
@@ -773,6 +784,10 @@ int			 main_imsg_compose_both(enum imsg_type, void *,
 void			 imsg_event_add(struct imsgev *);
 int			 imsg_compose_event(struct imsgev *, uint16_t, uint32_t,
 			    pid_t, int, void *, uint16_t);
+int			 imsg_compose_batch(struct imsgev *, uint16_t, uint32_t,
+			    void *, uint16_t);
+void			 imsg_batch_flush(struct imsgev *);
+void			 imsg_batch_clear(struct imsgev *);
 void			 evbuf_enqueue(struct evbuf *, struct ibuf *);
 void			 evbuf_event_add(struct evbuf *);
 void			 evbuf_init(struct evbuf *, int,
@@ -228,8 +228,10 @@ ldpe_shutdown(void)
 	}
 
 	/* clean up */
-	if (iev_lde)
+	if (iev_lde) {
+		imsg_batch_clear(iev_lde);
 		free(iev_lde);
+	}
 	free(iev_main);
 	free(iev_main_sync);
 	free(pkt_ptr);
@@ -265,6 +267,20 @@ ldpe_imsg_compose_lde(int type, uint32_t peerid, pid_t pid, void *data,
 {
 	if (iev_lde->ibuf.fd == -1)
 		return (0);
+
+	switch (type) {
+	case IMSG_LABEL_MAPPING:
+	case IMSG_LABEL_REQUEST:
+	case IMSG_LABEL_WITHDRAW:
+	case IMSG_LABEL_RELEASE:
+	case IMSG_LABEL_ABORT:
+		/* several FECs per imsg */
+		return (imsg_compose_batch(iev_lde, type, peerid, data,
+		    datalen));
+	default:
+		break;
+	}
+
 	return (imsg_compose_event(iev_lde, type, peerid, pid, -1,
 	    data, datalen));
 }
@@ -364,7 +380,7 @@ ldpe_dispatch_main(struct thread *thread)
 				break;
 			}
 
-			if ((iev_lde = malloc(sizeof(struct imsgev))) == NULL)
+			if ((iev_lde = calloc(1, sizeof(struct imsgev))) == NULL)
 				fatal(NULL);
 			imsg_init(&iev_lde->ibuf, fd);
 			iev_lde->handler_read = ldpe_dispatch_lde;
@@ -598,6 +614,7 @@ ldpe_dispatch_lde(struct thread *thread)
 	struct map		*map;
 	struct notify_msg	*nm;
 	struct nbr		*nbr;
+	size_t			 i, nmap;
 	int			 n, shut = 0;
 
 	iev->ev_read = NULL;
@@ -618,10 +635,12 @@ ldpe_dispatch_lde(struct thread *thread)
 		case IMSG_RELEASE_ADD:
 		case IMSG_REQUEST_ADD:
 		case IMSG_WITHDRAW_ADD:
-			if (imsg.hdr.len - IMSG_HEADER_SIZE !=
+			/* lde packs several FECs per imsg */
+			if ((imsg.hdr.len - IMSG_HEADER_SIZE) %
 			    sizeof(struct map))
 				fatalx("invalid size of map request");
 			map = imsg.data;
+			nmap = (imsg.hdr.len - IMSG_HEADER_SIZE) / sizeof(*map);
 
 			nbr = nbr_find_peerid(imsg.hdr.peerid);
 			if (nbr == NULL)
@@ -629,19 +648,25 @@ ldpe_dispatch_lde(struct thread *thread)
 			if (nbr->state != NBR_STA_OPER)
 				break;
 
-			switch (imsg.hdr.type) {
-			case IMSG_MAPPING_ADD:
-				mapping_list_add(&nbr->mapping_list, map);
-				break;
-			case IMSG_RELEASE_ADD:
-				mapping_list_add(&nbr->release_list, map);
-				break;
-			case IMSG_REQUEST_ADD:
-				mapping_list_add(&nbr->request_list, map);
-				break;
-			case IMSG_WITHDRAW_ADD:
-				mapping_list_add(&nbr->withdraw_list, map);
-				break;
+			for (i = 0; i < nmap; i++) {
+				switch (imsg.hdr.type) {
+				case IMSG_MAPPING_ADD:
+					mapping_list_add(&nbr->mapping_list,
+					    &map[i]);
+					break;
+				case IMSG_RELEASE_ADD:
+					mapping_list_add(&nbr->release_list,
+					    &map[i]);
+					break;
+				case IMSG_REQUEST_ADD:
+					mapping_list_add(&nbr->request_list,
+					    &map[i]);
+					break;
+				case IMSG_WITHDRAW_ADD:
+					mapping_list_add(&nbr->withdraw_list,
+					    &map[i]);
+					break;
+				}
 			}
 			break;
 		case IMSG_MAPPING_ADD_END:
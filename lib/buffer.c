@@ -26,6 +26,7 @@
 #include "log.h"
 #include "network.h"
 #include "lib_errors.h"
+#include "printfrr.h"
 
 #include <stddef.h>
 
@@ -40,6 +41,14 @@ struct buffer {
 
 	/* Size of each buffer_data chunk. */
 	size_t size;
+
+	/* Bytes queued and not yet flushed. */
+	size_t length;
+
+	/* One flushed chunk kept for reuse, so a buffer that is steadily
+	 * filled and drained doesn't go to malloc for every chunk.
+	 */
+	struct buffer_data *spare;
 };
 
 /* Data container. */
@@ -62,7 +71,15 @@ struct buffer_data {
    next page boundery. */
 #define BUFFER_SIZE_DEFAULT		4096
 
-#define BUFFER_DATA_FREE(D) XFREE(MTYPE_BUFFER_DATA, (D))
+#define BUFFER_DATA_FREE(D) buffer_data_free(b, (D))
+
+static void buffer_data_free(struct buffer *b, struct buffer_data *d)
+{
+	if (!b->spare)
+		b->spare = d;
+	else
+		XFREE(MTYPE_BUFFER_DATA, d);
+}
 
 /* Make new buffer. */
 struct buffer *buffer_new(size_t size)
@@ -90,6 +107,7 @@ struct buffer *buffer_new(size_t size)
 void buffer_free(struct buffer *b)
 {
 	buffer_reset(b);
+	XFREE(MTYPE_BUFFER_DATA, b->spare);
 	XFREE(MTYPE_BUFFER, b);
 }
 
@@ -125,6 +143,12 @@ void buffer_reset(struct buffer *b)
 		BUFFER_DATA_FREE(data);
 	}
 	b->head = b->tail = NULL;
+	b->length = 0;
+}
+
+size_t buffer_length(struct buffer *b)
+{
+	return b->length;
 }
 
 /* Add buffer_data to the end of buffer. */
@@ -132,8 +156,12 @@ static struct buffer_data *buffer_add(struct buffer *b)
 {
 	struct buffer_data *d;
 
-	d = XMALLOC(MTYPE_BUFFER_DATA,
-		    offsetof(struct buffer_data, data) + b->size);
+	if (b->spare) {
+		d = b->spare;
+		b->spare = NULL;
+	} else
+		d = XMALLOC(MTYPE_BUFFER_DATA,
+			    offsetof(struct buffer_data, data) + b->size);
 	d->cp = d->sp = 0;
 	d->next = NULL;
 
@@ -152,6 +180,8 @@ void buffer_put(struct buffer *b, const void *p, size_t size)
 	struct buffer_data *data = b->tail;
 	const char *ptr = p;
 
+	b->length += size;
+
 	/* We use even last one byte of data buffer. */
 	while (size) {
 		size_t chunk;
@@ -206,6 +236,7 @@ void buffer_put_crlf(struct buffer *b, const void *origp, size_t origsize)
 
 		p += chunk;
 		data->cp += chunk;
+		b->length += chunk;
 
 		if (lf && size <= avail) {
 			/* we just copied up to (including) a '\n' */
@@ -215,6 +246,7 @@ void buffer_put_crlf(struct buffer *b, const void *origp, size_t origsize)
 			if (data->cp == b->size)
 				data = buffer_add(b);
 			data->data[data->cp++] = '\n';
+			b->length += 2;
 
 			p++;
 			lf = memchr(p, '\n', end - p);
@@ -222,6 +254,58 @@ void buffer_put_crlf(struct buffer *b, const void *origp, size_t origsize)
 	}
 }
 
+/* Format straight into the last chunk; only output that doesn't fit into
+   what's left of it goes through a temporary. */
+size_t buffer_vprintf(struct buffer *b, const char *fmt, va_list ap)
+{
+	struct buffer_data *data = b->tail;
+	va_list aq;
+	ssize_t len;
+	char *p;
+
+	for (int i = 0; i < 2; i++) {
+		if (data == NULL || data->cp == b->size)
+			data = buffer_add(b);
+
+		va_copy(aq, ap);
+		len = vsnprintfrr((char *)data->data + data->cp,
+				  b->size - data->cp, fmt, aq);
+		va_end(aq);
+
+		if (len < 0)
+			return 0;
+		/* vsnprintfrr needs room for the terminating NUL */
+		if ((size_t)len < b->size - data->cp) {
+			data->cp += len;
+			b->length += len;
+			return len;
+		}
+		/* retry in a fresh chunk, unless it wouldn't fit there either */
+		if (data->cp == 0 || (size_t)len >= b->size)
+			break;
+		data = NULL;
+	}
+
+	p = XMALLOC(MTYPE_TMP, len + 1);
+	va_copy(aq, ap);
+	vsnprintfrr(p, len + 1, fmt, aq);
+	va_end(aq);
+	buffer_put(b, p, len);
+	XFREE(MTYPE_TMP, p);
+	return len;
+}
+
+size_t buffer_printf(struct buffer *b, const char *fmt, ...)
+{
+	va_list ap;
+	size_t len;
+
+	va_start(ap, fmt);
+	len = buffer_vprintf(b, fmt, ap);
+	va_end(ap);
+	return len;
+}
+
 /* Keep flushing data to the fd until the buffer is empty or an error is
    encountered or the operation would block. */
 buffer_status_t buffer_flush_all(struct buffer *b, int fd)
@@ -314,6 +398,7 @@ buffer_status_t buffer_flush_window(struct buffer *b, int fd, int width,
 		}
 		iov[iov_index].iov_base = (char *)(data->data + data->sp);
 		iov[iov_index++].iov_len = cp - data->sp;
+		b->length -= cp - data->sp;
 		data->sp = cp;
 
 		if (iov_index == iov_alloc)
@@ -436,6 +521,7 @@ in one shot. */
 			 __func__, fd, safe_strerror(errno));
 		return BUFFER_ERROR;
 	}
+	b->length -= written;
 
 	/* Free printed buffer data. */
 	while (written > 0) {
@@ -463,6 +549,33 @@ in one shot. */
 #undef MAX_FLUSH
 }
 
+/* Same as buffer_flush_available, but hands the data to fn instead of an
+   fd.  fn returns how many bytes it took; taking less than offered means
+   it is full and the rest stays queued. */
+buffer_status_t buffer_flush_fn(struct buffer *b,
+				size_t (*fn)(void *arg, const void *p,
+					     size_t size),
+				void *arg)
+{
+	struct buffer_data *d;
+	size_t size, taken;
+
+	while ((d = b->head)) {
+		size = d->cp - d->sp;
+		taken = fn(arg, d->data + d->sp, size);
+		b->length -= taken;
+		if (taken < size) {
+			d->sp += taken;
+			return BUFFER_PENDING;
+		}
+		if (!(b->head = d->next))
+			b->tail = NULL;
+		BUFFER_DATA_FREE(d);
+	}
+
+	return BUFFER_EMPTY;
+}
+
 buffer_status_t buffer_write(struct buffer *b, int fd, const void *p,
 			     size_t size)
 {
@@ -46,6 +46,15 @@ extern void buffer_putc(struct buffer *, uint8_t);
 extern void buffer_putstr(struct buffer *, const char *);
 /* Add given data, inline-expanding \n to \r\n */
 extern void buffer_put_crlf(struct buffer *b, const void *p, size_t size);
+/* Add printfrr() formatted output, written directly into the buffer's
+   chunks where it fits.  Returns the number of bytes added. */
+extern size_t buffer_vprintf(struct buffer *b, const char *fmt, va_list ap)
+	PRINTFRR(2, 0);
+extern size_t buffer_printf(struct buffer *b, const char *fmt, ...)
+	PRINTFRR(2, 3);
+
+/* Number of bytes queued for flushing. */
+extern size_t buffer_length(struct buffer *b);
 
 /* Combine all accumulated (and unflushed) data inside the buffer into a
    single NUL-terminated string allocated using XMALLOC(MTYPE_TMP).  Note
@@ -81,6 +90,13 @@ extern buffer_status_t buffer_write(struct buffer *, int fd, const void *,
    the queued data to the given file descriptor. */
 extern buffer_status_t buffer_flush_available(struct buffer *, int fd);
 
+/* Like buffer_flush_available, for consumers that are not file
+   descriptors.  fn returns the number of bytes it accepted. */
+extern buffer_status_t buffer_flush_fn(struct buffer *b,
+				       size_t (*fn)(void *arg, const void *p,
+						    size_t size),
+				       void *arg);
+
 /* The following 2 functions (buffer_flush_all and buffer_flush_window)
    are for use in lib/vty.c only.  They should not be used elsewhere. */
 
@@ -12,38 +12,49 @@
 int /* return checksum in low-order 16 bits */
 	in_cksum(void *parg, int nbytes)
 {
-	unsigned short *ptr = parg;
-	register long sum; /* assumes long == 32 bits */
-	unsigned short oddbyte;
-	register unsigned short answer; /* assumes unsigned short == 16 bits */
+	const uint8_t *ptr = parg;
+	uint64_t sum, sum0 = 0, sum1 = 0;
+	uint32_t words[4];
+	uint16_t word;
 
 	/*
-	 * Our algorithm is simple, using a 32-bit accumulator (sum),
-	 * we add sequential 16-bit words to it, and at the end, fold back
-	 * all the carry bits from the top 16 bits into the lower 16 bits.
+	 * The ones-complement sum doesn't care how wide the words being added
+	 * are, as long as all carries are folded back in at the end.  So add
+	 * 32-bit words into two 64-bit accumulators (which cannot overflow
+	 * for any int-sized buffer), and only go down to 16 bits at the end.
+	 * memcpy() keeps this safe for unaligned buffers and compiles down to
+	 * plain loads.
 	 */
+	while (nbytes >= (int)sizeof(words)) {
+		memcpy(words, ptr, sizeof(words));
+		sum0 += (uint64_t)words[0] + words[2];
+		sum1 += (uint64_t)words[1] + words[3];
+		ptr += sizeof(words);
+		nbytes -= sizeof(words);
+	}
+	sum = sum0 + sum1;
 
-	sum = 0;
 	while (nbytes > 1) {
-		sum += *ptr++;
-		nbytes -= 2;
+		memcpy(&word, ptr, sizeof(word));
+		sum += word;
+		ptr += sizeof(word);
+		nbytes -= sizeof(word);
 	}
 
 	/* mop up an odd byte, if necessary */
 	if (nbytes == 1) {
-		oddbyte = 0; /* make sure top half is zero */
-		*((uint8_t *)&oddbyte) = *(uint8_t *)ptr; /* one byte only */
-		sum += oddbyte;
+		word = 0; /* make sure top half is zero */
+		*((uint8_t *)&word) = *ptr; /* one byte only */
+		sum += word;
 	}
 
 	/*
-	 * Add back carry outs from top 16 bits to low 16 bits.
+	 * Add back carry outs from top bits to low 16 bits.
 	 */
+	while (sum >> 16)
+		sum = (sum >> 16) + (sum & 0xffff);
 
-	sum = (sum >> 16) + (sum & 0xffff); /* add high-16 to low-16 */
-	sum += (sum >> 16);		    /* add carry */
-	answer = ~sum; /* ones-complement, then truncate to 16 bits */
-	return (answer);
+	return (uint16_t)~sum; /* ones-complement, then truncate to 16 bits */
 }
 
 int in_cksum_with_ph4(struct ipv4_ph *ph, void *data, int nbytes)
@@ -96,7 +107,18 @@ uint16_t fletcher_checksum(uint8_t *buffer, const size_t len,
 	while (left != 0) {
 		partial_len = MIN(left, MODX);
 
-		for (i = 0; i < partial_len; i++) {
+		/* 8 bytes at a time, same sums as the bytewise loop below,
+		 * but without the per-byte dependency on c0
+		 */
+		for (i = 0; i + 8 <= partial_len; i += 8, p += 8) {
+			c1 += 8 * c0 + 8 * p[0] + 7 * p[1] + 6 * p[2]
+			      + 5 * p[3] + 4 * p[4] + 3 * p[5] + 2 * p[6]
+			      + p[7];
+			c0 += p[0] + p[1] + p[2] + p[3] + p[4] + p[5] + p[6]
+			      + p[7];
+		}
+
+		for (; i < partial_len; i++) {
 			c0 = c0 + *(p++);
 			c1 += c0;
 		}
@@ -47,6 +47,7 @@
 #include "hook.h"
 #include "lib_errors.h"
 #include "northbound_cli.h"
+#include "northbound_snapshot.h"
 #include "network.h"
 
 DEFINE_MTYPE_STATIC(LIB, HOST, "Host config")
@@ -317,6 +318,7 @@ void install_element(enum node_type ntype, const struct cmd_element *cmd)
 	cmd_graph_names(graph);
 	cmd_graph_merge(cnode->cmdgraph, graph, +1);
 	graph_delete_graph(graph);
+	command_match_cache_flush();
 
 	vector_set(cnode->cmd_vector, (void *)cmd);
 
@@ -366,6 +368,7 @@ void uninstall_element(enum node_type ntype, const struct cmd_element *cmd)
 	cmd_graph_names(graph);
 	cmd_graph_merge(cnode->cmdgraph, graph, -1);
 	graph_delete_graph(graph);
+	command_match_cache_flush();
 
 	if (ntype == VIEW_NODE)
 		uninstall_element(ENABLE_NODE, cmd);
@@ -1539,6 +1542,35 @@ static int vty_write_config(struct vty *vty)
 	return CMD_SUCCESS;
 }
 
+/* Same as "write terminal", as a string (MTYPE_TMP). */
+static char *vty_write_config_str(void)
+{
+	struct vty *vty;
+	char *str;
+
+	vty = vty_new();
+	vty->type = VTY_FILE;
+	vty_write_config(vty);
+	str = buffer_getstr(vty->obuf);
+	buffer_reset(vty->obuf);
+	vty_close(vty);
+
+	return str;
+}
+
+/* Save a snapshot matching the text configuration with the given digest. */
+static bool file_write_snapshot(const uint8_t *digest)
+{
+	char *config_text;
+	bool ret;
+
+	config_text = vty_write_config_str();
+	ret = nb_snapshot_write(snapshot_default, digest, config_text);
+	XFREE(MTYPE_TMP, config_text);
+
+	return ret;
+}
+
 static int file_write_config(struct vty *vty)
 {
 	int fd, dirfd;
@@ -1548,6 +1580,7 @@ static int file_write_config(struct vty *vty)
 	int ret = CMD_WARNING;
 	struct vty *file_vty;
 	struct stat conf_stat;
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
 
 	if (host.noconfig)
 		return CMD_SUCCESS;
@@ -1638,6 +1671,10 @@ static int file_write_config(struct vty *vty)
 	vty_out(vty, "Configuration saved to %s\n", config_file);
 	ret = CMD_SUCCESS;
 
+	/* Failing this only makes the next startup slower. */
+	if (nb_snapshot_digest_path(config_file, digest))
+		file_write_snapshot(digest);
+
 finished:
 	if (ret != CMD_SUCCESS)
 		unlink(config_file_tmp);
@@ -1690,6 +1727,53 @@ DEFUN (copy_runningconf_startupconf,
 }
 /** -- **/
 
+/*
+ * Configuration snapshots for the integrated configuration: vtysh saves
+ * frr.conf, then tells every daemon its digest so they can save a matching
+ * snapshot.  On "vtysh -b", daemons that manage to load their snapshot are
+ * skipped while the text configuration is replayed.
+ */
+DEFUN_HIDDEN (snapshot_write,
+	      snapshot_write_cmd,
+	      "snapshot_write WORD",
+	      "Save a configuration snapshot\n"
+	      "Digest of the matching text configuration\n")
+{
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
+
+	if (host.noconfig)
+		return CMD_SUCCESS;
+
+	if (!nb_snapshot_str2digest(argv[1]->arg, digest)) {
+		vty_out(vty, "%% Invalid digest\n");
+		return CMD_WARNING;
+	}
+
+	if (!file_write_snapshot(digest)) {
+		vty_out(vty, "%% Can't save configuration snapshot %s\n",
+			snapshot_default);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_HIDDEN (snapshot_load,
+	      snapshot_load_cmd,
+	      "snapshot_load WORD",
+	      "Load the configuration snapshot\n"
+	      "Digest of the text configuration it must match\n")
+{
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
+
+	/* Silently, the text configuration is used instead. */
+	if (host.noconfig || !nb_snapshot_str2digest(argv[1]->arg, digest)
+	    || !vty_read_snapshot(vty->candidate_config, digest))
+		return CMD_WARNING;
+
+	return CMD_SUCCESS;
+}
+
 /* Write startup configuration into the terminal. */
 DEFUN (show_startup_config,
        show_startup_config_cmd,
@@ -2379,6 +2463,8 @@ void cmd_init(int terminal)
 		install_element(ENABLE_NODE, &config_terminal_cmd);
 		install_element(ENABLE_NODE, &copy_runningconf_startupconf_cmd);
 		install_element(ENABLE_NODE, &config_write_cmd);
+		install_element(ENABLE_NODE, &snapshot_write_cmd);
+		install_element(CONFIG_NODE, &snapshot_load_cmd);
 		install_element(ENABLE_NODE, &show_running_config_cmd);
 		install_element(ENABLE_NODE, &config_logmsg_cmd);
 
@@ -2429,6 +2515,8 @@ void cmd_terminate(void)
 	hook_unregister(cmd_execute, handle_pipe_action);
 	hook_unregister(cmd_execute_done, handle_pipe_action_done);
 
+	command_match_cache_flush();
+
 	if (cmdvec) {
 		for (unsigned int i = 0; i < vector_active(cmdvec); i++)
 			if ((cmd_node = vector_slot(cmdvec, i)) != NULL) {
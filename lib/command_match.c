@@ -25,8 +25,11 @@
 
 #include "command_match.h"
 #include "memory.h"
+#include "typesafe.h"
+#include "jhash.h"
 
 DEFINE_MTYPE_STATIC(LIB, CMD_MATCHSTACK, "Command Match Stack")
+DEFINE_MTYPE_STATIC(LIB, CMD_MATCHCACHE, "Command Match Cache")
 
 #ifdef TRACE_MATCHER
 #define TM 1
@@ -40,13 +43,97 @@ DEFINE_MTYPE_STATIC(LIB, CMD_MATCHSTACK, "Command Match Stack")
 			fprintf(stderr, __VA_ARGS__);                          \
 	} while (0);
 
+/*
+ * Input token classes.
+ *
+ * Address and number tokens of an input line are classified once per
+ * command_match() call instead of once for every graph node they are
+ * tried against.  The class is a bitmask with one bit per token type the
+ * input matches exactly, plus CMD_CLASS_NUMBER for decimal integers (which
+ * may or may not fall into a given range).  A zero class means the input
+ * is an ordinary word.
+ */
+#define CMD_CLASS(type) (1U << (type))
+#define CMD_CLASS_NUMBER CMD_CLASS(RANGE_TKN)
+
+/*
+ * Per-call matcher state.
+ *
+ * Besides the input classes this tracks, for each input position, which
+ * graph nodes could have matched some input of the same class.  When only
+ * one such node exists for a position, any other input of that class would
+ * have been matched by the same node or not at all, so the result can be
+ * reused for it.
+ */
+struct cmd_match_ctx {
+	uint32_t cls[CMD_ARGC_MAX + 1];
+	struct graph_node *seen[CMD_ARGC_MAX + 1];
+	bool multiple[CMD_ARGC_MAX + 1];
+};
+
+/*
+ * Match cache.
+ *
+ * Configuration files and frr-reload feed the matcher thousands of lines
+ * that only differ in their addresses and numbers.  Successful matches are
+ * remembered by the "shape" of the input, where classified tokens are
+ * replaced by their class, and reused after checking the cached tokens
+ * against the new input.  Positions where other nodes could have matched
+ * the same class keep their literal input in the entry.
+ */
+PREDECL_HASH(cmd_match_cache);
+
+struct cmd_match_cache_entry {
+	struct cmd_match_cache_item item;
+
+	struct graph *graph;
+	char *shape;
+	uint32_t hash;
+
+	const struct cmd_element *el;
+	/* matched tokens (without ->arg) and literal inputs, per position */
+	unsigned int count;
+	struct cmd_token **tokens;
+	char **literal;
+};
+
+#define CMD_MATCH_CACHE_MAX 4096
+
+static int cmd_match_cache_cmp(const struct cmd_match_cache_entry *a,
+			       const struct cmd_match_cache_entry *b)
+{
+	if (a->graph != b->graph)
+		return a->graph < b->graph ? -1 : 1;
+	return strcmp(a->shape, b->shape);
+}
+
+static uint32_t cmd_match_cache_hash(const struct cmd_match_cache_entry *e)
+{
+	return e->hash;
+}
+
+DECLARE_HASH(cmd_match_cache, struct cmd_match_cache_entry, item,
+	     cmd_match_cache_cmp, cmd_match_cache_hash)
+
+static struct cmd_match_cache_head cmd_match_cache[1] = {
+	INIT_HASH(cmd_match_cache[0]),
+};
+
+static void cmd_match_ctx_init(struct cmd_match_ctx *ctx, vector vvline);
+static bool cmd_match_cache_lookup(struct graph *cmdgraph, vector vvline,
+				   struct cmd_match_ctx *ctx, struct list **argv,
+				   const struct cmd_element **el);
+static void cmd_match_cache_store(struct graph *cmdgraph, vector vvline,
+				  struct cmd_match_ctx *ctx, struct list *argv,
+				  const struct cmd_element *el);
+
 /* matcher helper prototypes */
 static int add_nexthops(struct list *, struct graph_node *,
 			struct graph_node **, size_t);
 
 static enum matcher_rv command_match_r(struct graph_node *, vector,
 				       unsigned int, struct graph_node **,
-				       struct list **);
+				       struct list **, struct cmd_match_ctx *);
 
 static int score_precedence(enum cmd_token_type);
 
@@ -65,6 +152,11 @@ int compare_completions(const void *, const void *);
 /* token matcher prototypes */
 static enum match_type match_token(struct cmd_token *, char *);
 
+static enum match_type match_token_class(struct cmd_token *, char *,
+					 uint32_t);
+
+static bool match_class_possible(struct cmd_token *, uint32_t);
+
 static enum match_type match_ipv4(const char *);
 
 static enum match_type match_ipv4_prefix(const char *);
@@ -83,8 +175,10 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 			      struct list **argv, const struct cmd_element **el)
 {
 	struct graph_node *stack[CMD_ARGC_MAX];
+	struct cmd_match_ctx ctx;
 	enum matcher_rv status;
 	*argv = NULL;
+	*el = NULL;
 
 	// prepend a dummy token to match that pesky start node
 	vector vvline = vector_init(vline->alloced + 1);
@@ -93,8 +187,15 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 	       sizeof(void *) * vline->alloced);
 	vvline->active = vline->active + 1;
 
+	cmd_match_ctx_init(&ctx, vvline);
+	if (cmd_match_cache_lookup(cmdgraph, vvline, &ctx, argv, el)) {
+		XFREE(MTYPE_TMP, vector_slot(vvline, 0));
+		vector_free(vvline);
+		return MATCHER_OK;
+	}
+
 	struct graph_node *start = vector_slot(cmdgraph->nodes, 0);
-	status = command_match_r(start, vvline, 0, stack, argv);
+	status = command_match_r(start, vvline, 0, stack, argv, &ctx);
 	if (status == MATCHER_OK) { // successful match
 		struct listnode *head = listhead(*argv);
 		struct listnode *tail = listtail(*argv);
@@ -114,6 +215,8 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 		// input, with each cmd_token->arg holding the corresponding
 		// input
 		assert(*el);
+
+		cmd_match_cache_store(cmdgraph, vvline, &ctx, *argv, *el);
 	} else if (*argv) {
 		del_arglist(*argv);
 		*argv = NULL;
@@ -134,6 +237,197 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 	return status;
 }
 
+static void cmd_match_cache_entry_free(struct cmd_match_cache_entry *e)
+{
+	for (unsigned int i = 0; i < e->count; i++) {
+		cmd_token_del(e->tokens[i]);
+		XFREE(MTYPE_CMD_MATCHCACHE, e->literal[i]);
+	}
+	XFREE(MTYPE_CMD_MATCHCACHE, e->tokens);
+	XFREE(MTYPE_CMD_MATCHCACHE, e->literal);
+	XFREE(MTYPE_CMD_MATCHCACHE, e->shape);
+	XFREE(MTYPE_CMD_MATCHCACHE, e);
+}
+
+void command_match_cache_flush(void)
+{
+	struct cmd_match_cache_entry *e;
+
+	while ((e = cmd_match_cache_pop(cmd_match_cache)))
+		cmd_match_cache_entry_free(e);
+}
+
+static uint32_t cmd_match_classify(const char *input)
+{
+	const char *p = input;
+	uint32_t cls = 0;
+
+	if (*p == '-' || *p == '+')
+		p++;
+	if (*p && strspn(p, "0123456789") == strlen(p))
+		return CMD_CLASS_NUMBER;
+
+	/* addresses need at least one separator */
+	if (!strpbrk(input, ".:"))
+		return 0;
+
+	if (match_ipv4(input) == exact_match)
+		cls |= CMD_CLASS(IPV4_TKN);
+	if (match_ipv4_prefix(input) == exact_match)
+		cls |= CMD_CLASS(IPV4_PREFIX_TKN);
+	if (match_ipv6_prefix(input, false) == exact_match)
+		cls |= CMD_CLASS(IPV6_TKN);
+	if (match_ipv6_prefix(input, true) == exact_match)
+		cls |= CMD_CLASS(IPV6_PREFIX_TKN);
+	if (match_mac(input, false) == exact_match)
+		cls |= CMD_CLASS(MAC_TKN);
+	if (match_mac(input, true) == exact_match)
+		cls |= CMD_CLASS(MAC_PREFIX_TKN);
+
+	return cls;
+}
+
+static void cmd_match_ctx_init(struct cmd_match_ctx *ctx, vector vvline)
+{
+	unsigned int count = MIN(vector_active(vvline), CMD_ARGC_MAX + 1);
+	const char *input;
+
+	memset(ctx, 0, sizeof(*ctx));
+	/* position 0 is the dummy token for the start node */
+	for (unsigned int i = 1; i < count; i++) {
+		input = vector_slot(vvline, i);
+		if (input)
+			ctx->cls[i] = cmd_match_classify(input);
+	}
+}
+
+/*
+ * Builds the cache key for an input line.  Returns NULL for lines that
+ * can't be cached.
+ */
+static char *cmd_match_cache_shape(vector vvline, struct cmd_match_ctx *ctx)
+{
+	unsigned int count = vector_active(vvline);
+	size_t len = 1, pos = 0;
+	char *shape;
+
+	if (count < 2 || count > CMD_ARGC_MAX)
+		return NULL;
+
+	for (unsigned int i = 1; i < count; i++) {
+		const char *input = vector_slot(vvline, i);
+
+		if (!input)
+			return NULL;
+		len += ctx->cls[i] ? 10 : strlen(input) + 1;
+	}
+
+	shape = XMALLOC(MTYPE_CMD_MATCHCACHE, len);
+	for (unsigned int i = 1; i < count; i++) {
+		const char *input = vector_slot(vvline, i);
+
+		if (ctx->cls[i])
+			pos += snprintf(shape + pos, len - pos, "\x01%08x",
+					ctx->cls[i]);
+		else
+			pos += snprintf(shape + pos, len - pos, "%s ", input);
+	}
+
+	return shape;
+}
+
+static bool cmd_match_cache_lookup(struct graph *cmdgraph, vector vvline,
+				   struct cmd_match_ctx *ctx, struct list **argv,
+				   const struct cmd_element **el)
+{
+	struct cmd_match_cache_entry ref, *e;
+	struct cmd_token *copy;
+	char *input;
+
+	if (cmd_match_cache_count(cmd_match_cache) == 0)
+		return false;
+
+	ref.graph = cmdgraph;
+	ref.shape = cmd_match_cache_shape(vvline, ctx);
+	if (!ref.shape)
+		return false;
+	ref.hash = jhash(ref.shape, strlen(ref.shape),
+			 jhash(&cmdgraph, sizeof(cmdgraph), 0));
+	e = cmd_match_cache_find(cmd_match_cache, &ref);
+	XFREE(MTYPE_CMD_MATCHCACHE, ref.shape);
+	if (!e)
+		return false;
+
+	/* verify the cached tokens against this input */
+	for (unsigned int i = 0; i < e->count; i++) {
+		input = vector_slot(vvline, i + 1);
+		if (e->literal[i] && strcmp(e->literal[i], input))
+			return false;
+		if (match_token_class(e->tokens[i], input, ctx->cls[i + 1])
+		    < min_match_level(e->tokens[i]->type))
+			return false;
+	}
+
+	*argv = list_new();
+	(*argv)->del = (void (*)(void *))cmd_token_del;
+	for (unsigned int i = 0; i < e->count; i++) {
+		copy = cmd_token_dup(e->tokens[i]);
+		copy->arg = XSTRDUP(MTYPE_CMD_ARG, vector_slot(vvline, i + 1));
+		listnode_add(*argv, copy);
+	}
+	*el = e->el;
+
+	return true;
+}
+
+static void cmd_match_cache_store(struct graph *cmdgraph, vector vvline,
+				  struct cmd_match_ctx *ctx, struct list *argv,
+				  const struct cmd_element *el)
+{
+	struct cmd_match_cache_entry *e, *old;
+	struct cmd_token *token;
+	struct listnode *ln;
+	unsigned int i = 0;
+	char *shape;
+
+	shape = cmd_match_cache_shape(vvline, ctx);
+	if (!shape)
+		return;
+	assert(argv->count == vector_active(vvline) - 1);
+
+	if (cmd_match_cache_count(cmd_match_cache) >= CMD_MATCH_CACHE_MAX)
+		command_match_cache_flush();
+
+	e = XCALLOC(MTYPE_CMD_MATCHCACHE, sizeof(*e));
+	e->graph = cmdgraph;
+	e->shape = shape;
+	e->hash = jhash(shape, strlen(shape),
+			jhash(&cmdgraph, sizeof(cmdgraph), 0));
+	e->el = el;
+	e->count = argv->count;
+	e->tokens = XCALLOC(MTYPE_CMD_MATCHCACHE,
+			    sizeof(*e->tokens) * e->count);
+	e->literal = XCALLOC(MTYPE_CMD_MATCHCACHE,
+			     sizeof(*e->literal) * e->count);
+
+	for (ALL_LIST_ELEMENTS_RO(argv, ln, token)) {
+		e->tokens[i] = cmd_token_dup(token);
+		XFREE(MTYPE_CMD_ARG, e->tokens[i]->arg);
+		if (ctx->cls[i + 1] && ctx->multiple[i + 1])
+			e->literal[i] = XSTRDUP(MTYPE_CMD_MATCHCACHE,
+						vector_slot(vvline, i + 1));
+		i++;
+	}
+
+	old = cmd_match_cache_add(cmd_match_cache, e);
+	if (old) {
+		/* same shape, different literals; keep the newer one */
+		cmd_match_cache_del(cmd_match_cache, old);
+		cmd_match_cache_add(cmd_match_cache, e);
+		cmd_match_cache_entry_free(old);
+	}
+}
+
 /**
  * Builds an argument list given a DFA and a matching input line.
  *
@@ -188,7 +482,8 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 				       unsigned int n,
 				       struct graph_node **stack,
-				       struct list **currbest)
+				       struct list **currbest,
+				       struct cmd_match_ctx *ctx)
 {
 	assert(n < vector_active(vline));
 
@@ -210,6 +505,15 @@ static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 
 	// get the current operating input token
 	char *input_token = vector_slot(vline, n);
+	uint32_t cls = ctx->cls[n];
+
+	// remember every node that could take input of this class
+	if (cls && match_class_possible(token, cls)) {
+		if (!ctx->seen[n])
+			ctx->seen[n] = start;
+		else if (ctx->seen[n] != start)
+			ctx->multiple[n] = true;
+	}
 
 #ifdef TRACE_MATCHER
 	fprintf(stdout, "\"%-20s\" matches \"%-30s\" ? ", input_token,
@@ -237,7 +541,7 @@ static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 #endif
 
 	// if we don't match this node, die
-	if (match_token(token, input_token) < minmatch)
+	if (match_token_class(token, input_token, cls) < minmatch)
 		return MATCHER_NO_MATCH;
 
 	stack[n] = start;
@@ -287,7 +591,7 @@ static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 		// else recurse on candidate child node
 		struct list *result = NULL;
 		enum matcher_rv rstat =
-			command_match_r(gn, vline, n + 1, stack, &result);
+			command_match_r(gn, vline, n + 1, stack, &result, ctx);
 
 		// save the best match
 		if (result && *currbest) {
@@ -688,6 +992,61 @@ static enum match_type match_token(struct cmd_token *token, char *input_token)
 	}
 }
 
+/*
+ * Same as match_token(), but address tokens are matched through the
+ * precomputed input class.  Only for use where the minimum match level of
+ * address tokens (exact_match) applies.
+ */
+static enum match_type match_token_class(struct cmd_token *token,
+					 char *input_token, uint32_t cls)
+{
+	switch (token->type) {
+	case IPV4_TKN:
+	case IPV4_PREFIX_TKN:
+	case IPV6_TKN:
+	case IPV6_PREFIX_TKN:
+	case MAC_TKN:
+	case MAC_PREFIX_TKN:
+		if (!input_token)
+			return trivial_match;
+		if (!strpbrk(input_token, ".:"))
+			return no_match;
+		return (cls & CMD_CLASS(token->type)) ? exact_match : no_match;
+	default:
+		return match_token(token, input_token);
+	}
+}
+
+/*
+ * Whether some input of the given class could match this token.  Errs on
+ * the side of true.
+ */
+static bool match_class_possible(struct cmd_token *token, uint32_t cls)
+{
+	switch (token->type) {
+	case WORD_TKN:
+		/* keywords are matched by their prefixes */
+		if (cls & CMD_CLASS_NUMBER)
+			return isdigit((unsigned char)token->text[0])
+			       || token->text[0] == '-'
+			       || token->text[0] == '+';
+		return strpbrk(token->text, ".:/") != NULL;
+	case VARIABLE_TKN:
+		return true;
+	case RANGE_TKN:
+		return !!(cls & CMD_CLASS_NUMBER);
+	case IPV4_TKN:
+	case IPV4_PREFIX_TKN:
+	case IPV6_TKN:
+	case IPV6_PREFIX_TKN:
+	case MAC_TKN:
+	case MAC_PREFIX_TKN:
+		return !!(cls & CMD_CLASS(token->type));
+	default:
+		return false;
+	}
+}
+
 #define IPV4_ADDR_STR   "0123456789."
 #define IPV4_PREFIX_STR "0123456789./"
 
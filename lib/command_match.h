@@ -80,6 +80,14 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 			      struct list **argv,
 			      const struct cmd_element **element);
 
+/**
+ * Drop all cached command matches.
+ *
+ * command_match() remembers successful matches by the shape of their input.
+ * This must be called whenever a command graph passed to it changes.
+ */
+void command_match_cache_flush(void);
+
 /**
  * Compiles possible completions for a given line of user input.
  *
@@ -0,0 +1,234 @@
+/*
+ * Fast non-cryptographic hash for hash table keys
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_FHASH_H
+#define _FRR_FHASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A drop-in replacement for jhash() and friends, built on the wyhash
+ * construction (public domain): the key is consumed 8 or 16 bytes at a
+ * time, each step being one 64x64->128 bit multiply whose halves are
+ * folded together.  That is several times faster than jhash's 12-byte
+ * add/rotate rounds on anything longer than a few words, with equally
+ * good distribution (see tests/lib/test_fhash.c).
+ *
+ * Results are NOT stable across platforms of different endianness and
+ * may change between releases; only use them for in-memory tables.
+ *
+ * fhash()/fhash_Nwords() mirror the jhash API including the 32-bit
+ * seed, so chained "key = fhash_1word(x, key)" code converts 1:1.  For
+ * hashing many fields of a struct, struct fhash_state avoids folding to
+ * 32 bits after each one:
+ *
+ *     struct fhash_state st;
+ *
+ *     fhash_init(&st, 0);
+ *     fhash_add_u32x2(&st, a->type, a->flags);
+ *     fhash_add(&st, &a->addr, sizeof(a->addr));
+ *     return fhash_final(&st);
+ */
+
+static const uint64_t fhash_secret[4] = {
+	0xa0761d6478bd642fULL,
+	0xe7037ed1a0b428dbULL,
+	0x8ebc6af09c88c6e3ULL,
+	0x589965cc75374cc3ULL,
+};
+
+static inline void fhash_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = *a;
+
+	r *= *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32;
+	uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t fhash_mix(uint64_t a, uint64_t b)
+{
+	fhash_mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t fhash_r8(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t fhash_r4(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* 1-3 bytes, reads the first, middle and last one */
+static inline uint64_t fhash_r3(const uint8_t *p, size_t k)
+{
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static inline uint64_t fhash64(const void *key, size_t len, uint64_t seed)
+{
+	const uint8_t *p = key;
+	uint64_t a, b;
+
+	seed ^= fhash_mix(seed ^ fhash_secret[0], fhash_secret[1]);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			size_t off = (len >> 3) << 2;
+
+			a = (fhash_r4(p) << 32) | fhash_r4(p + off);
+			b = (fhash_r4(p + len - 4) << 32)
+			    | fhash_r4(p + len - 4 - off);
+		} else if (len > 0) {
+			a = fhash_r3(p, len);
+			b = 0;
+		} else
+			a = b = 0;
+	} else {
+		size_t i = len;
+
+		if (i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+
+			do {
+				seed = fhash_mix(fhash_r8(p) ^ fhash_secret[1],
+						 fhash_r8(p + 8) ^ seed);
+				see1 = fhash_mix(fhash_r8(p + 16)
+							 ^ fhash_secret[2],
+						 fhash_r8(p + 24) ^ see1);
+				see2 = fhash_mix(fhash_r8(p + 32)
+							 ^ fhash_secret[3],
+						 fhash_r8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = fhash_mix(fhash_r8(p) ^ fhash_secret[1],
+					 fhash_r8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = fhash_r8(p + i - 16);
+		b = fhash_r8(p + i - 8);
+	}
+
+	a ^= fhash_secret[1];
+	b ^= seed;
+	fhash_mum(&a, &b);
+	return fhash_mix(a ^ fhash_secret[0] ^ len, b ^ fhash_secret[1]);
+}
+
+static inline uint32_t fhash_fold(uint64_t h)
+{
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+/* jhash() equivalents */
+static inline uint32_t fhash(const void *key, size_t len, uint32_t seed)
+{
+	return fhash_fold(fhash64(key, len, seed));
+}
+
+static inline uint32_t fhash_3words(uint32_t a, uint32_t b, uint32_t c,
+				    uint32_t seed)
+{
+	return fhash_fold(fhash_mix(((uint64_t)a << 32 | b) ^ fhash_secret[1],
+				    ((uint64_t)c << 32 | seed)
+					    ^ fhash_secret[0]));
+}
+
+static inline uint32_t fhash_2words(uint32_t a, uint32_t b, uint32_t seed)
+{
+	return fhash_3words(a, b, 0, seed);
+}
+
+static inline uint32_t fhash_1word(uint32_t a, uint32_t seed)
+{
+	return fhash_3words(a, 0, 0, seed);
+}
+
+/* incremental hashing of multiple fields */
+struct fhash_state {
+	uint64_t h;
+};
+
+static inline void fhash_init(struct fhash_state *st, uint64_t seed)
+{
+	st->h = seed ^ fhash_secret[0];
+}
+
+static inline void fhash_add(struct fhash_state *st, const void *data,
+			     size_t len)
+{
+	st->h = fhash64(data, len, st->h);
+}
+
+static inline void fhash_add_u64(struct fhash_state *st, uint64_t val)
+{
+	st->h = fhash_mix(st->h ^ fhash_secret[1], val ^ fhash_secret[2]);
+}
+
+static inline void fhash_add_u32x2(struct fhash_state *st, uint32_t a,
+				   uint32_t b)
+{
+	fhash_add_u64(st, (uint64_t)a << 32 | b);
+}
+
+static inline void fhash_add_u32(struct fhash_state *st, uint32_t val)
+{
+	fhash_add_u64(st, val);
+}
+
+static inline uint32_t fhash_final(const struct fhash_state *st)
+{
+	return fhash_fold(fhash_mix(st->h ^ fhash_secret[3], fhash_secret[1]));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_FHASH_H */
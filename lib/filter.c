@@ -30,10 +30,82 @@
 #include "routemap.h"
 #include "libfrr.h"
 #include "northbound_cli.h"
+#include "table.h"
+#include "jhash.h"
+#include "typesafe.h"
 
 DEFINE_MTYPE_STATIC(LIB, ACCESS_LIST, "Access List")
 DEFINE_MTYPE_STATIC(LIB, ACCESS_LIST_STR, "Access List Str")
 DEFINE_MTYPE_STATIC(LIB, ACCESS_FILTER, "Access Filter")
+DEFINE_MTYPE_STATIC(LIB, ACCESS_COMPILED, "Access List compiled")
+
+/*
+ * Access lists with at least this many entries are compiled on first use
+ * instead of being walked entry by entry; see access_list_compile().
+ */
+#define ACCESS_LIST_COMPILE_MIN 8
+
+PREDECL_HASH(acl_cisco_entries)
+
+/* Cisco entries sharing the same wildcards, keyed by the values to match */
+struct acl_cisco_entry {
+	struct acl_cisco_entries_item item;
+
+	uint32_t addr;
+	uint32_t mask;
+
+	/* first filter in list order with these values */
+	unsigned int index;
+	struct filter *filter;
+};
+
+static int acl_cisco_entry_cmp(const struct acl_cisco_entry *a,
+			       const struct acl_cisco_entry *b)
+{
+	if (a->addr != b->addr)
+		return a->addr < b->addr ? -1 : 1;
+	if (a->mask != b->mask)
+		return a->mask < b->mask ? -1 : 1;
+	return 0;
+}
+
+static uint32_t acl_cisco_entry_hash(const struct acl_cisco_entry *e)
+{
+	return jhash_2words(e->addr, e->mask, 0x41434c43);
+}
+
+DECLARE_HASH(acl_cisco_entries, struct acl_cisco_entry, item,
+	     acl_cisco_entry_cmp, acl_cisco_entry_hash)
+
+/* One "tuple" of the tuple space: all entries with the same wildcards */
+struct acl_cisco_group {
+	struct acl_cisco_group *next;
+
+	bool extended;
+	uint32_t addr_mask;
+	uint32_t mask_mask;
+
+	struct acl_cisco_entries_head entries;
+};
+
+/* route_node info for zebra entries: first filter of either kind */
+struct acl_zebra_node {
+	unsigned int index;
+	struct filter *filter;
+	unsigned int exact_index;
+	struct filter *exact;
+};
+
+struct access_list_compiled {
+	/* too small or not compilable, walk the list */
+	bool linear;
+
+	/* zebra entries, in a trie per address family */
+	struct route_table *zebra[2];
+
+	/* cisco entries, as a tuple space */
+	struct acl_cisco_group *cisco;
+};
 
 /* Static structure for mac access_list's master. */
 static struct access_master access_master_mac = {
@@ -139,6 +211,213 @@ static int filter_match_zebra(struct filter *mfilter, const struct prefix *p)
 		return 0;
 }
 
+static struct route_table **
+access_list_compiled_table(struct access_list_compiled *ac, int family)
+{
+	switch (family) {
+	case AF_INET:
+		return &ac->zebra[0];
+	case AF_INET6:
+		return &ac->zebra[1];
+	}
+	return NULL;
+}
+
+static void access_list_compiled_free(struct access_list_compiled *ac)
+{
+	struct acl_cisco_group *group;
+	struct acl_cisco_entry *entry;
+	struct route_node *rn;
+
+	for (size_t i = 0; i < array_size(ac->zebra); i++) {
+		if (!ac->zebra[i])
+			continue;
+		for (rn = route_top(ac->zebra[i]); rn; rn = route_next(rn))
+			XFREE(MTYPE_ACCESS_COMPILED, rn->info);
+		route_table_finish(ac->zebra[i]);
+	}
+
+	while ((group = ac->cisco)) {
+		ac->cisco = group->next;
+		while ((entry = acl_cisco_entries_pop(&group->entries)))
+			XFREE(MTYPE_ACCESS_COMPILED, entry);
+		acl_cisco_entries_fini(&group->entries);
+		XFREE(MTYPE_ACCESS_COMPILED, group);
+	}
+
+	XFREE(MTYPE_ACCESS_COMPILED, ac);
+}
+
+static bool access_list_compile_zebra(struct access_list_compiled *ac,
+				      struct filter *filter, unsigned int index)
+{
+	struct filter_zebra *zfilter = &filter->u.zfilter;
+	struct route_table **table;
+	struct route_node *rn;
+	struct acl_zebra_node *zn;
+
+	table = access_list_compiled_table(ac, zfilter->prefix.family);
+	if (!table)
+		return false;
+	if (!*table)
+		*table = route_table_init();
+
+	rn = route_node_get(*table, &zfilter->prefix);
+	if (!rn->info)
+		rn->info = XCALLOC(MTYPE_ACCESS_COMPILED, sizeof(*zn));
+	else
+		route_unlock_node(rn);
+	zn = rn->info;
+
+	/* entries come in list order, only the first one can ever match */
+	if (zfilter->exact && !zn->exact) {
+		zn->exact = filter;
+		zn->exact_index = index;
+	} else if (!zfilter->exact && !zn->filter) {
+		zn->filter = filter;
+		zn->index = index;
+	}
+	return true;
+}
+
+static void access_list_compile_cisco(struct access_list_compiled *ac,
+				      struct filter *filter, unsigned int index)
+{
+	struct filter_cisco *cfilter = &filter->u.cfilter;
+	struct acl_cisco_group *group;
+	struct acl_cisco_entry *entry;
+	uint32_t mask_mask;
+
+	mask_mask = cfilter->extended ? cfilter->mask_mask.s_addr : 0;
+
+	for (group = ac->cisco; group; group = group->next)
+		if (group->extended == !!cfilter->extended
+		    && group->addr_mask == cfilter->addr_mask.s_addr
+		    && group->mask_mask == mask_mask)
+			break;
+
+	if (!group) {
+		group = XCALLOC(MTYPE_ACCESS_COMPILED, sizeof(*group));
+		group->extended = !!cfilter->extended;
+		group->addr_mask = cfilter->addr_mask.s_addr;
+		group->mask_mask = mask_mask;
+		acl_cisco_entries_init(&group->entries);
+		group->next = ac->cisco;
+		ac->cisco = group;
+	}
+
+	entry = XCALLOC(MTYPE_ACCESS_COMPILED, sizeof(*entry));
+	entry->addr = cfilter->addr.s_addr;
+	entry->mask = cfilter->extended ? cfilter->mask.s_addr : 0;
+	entry->index = index;
+	entry->filter = filter;
+
+	/* an earlier entry with the same values shadows this one */
+	if (acl_cisco_entries_add(&group->entries, entry))
+		XFREE(MTYPE_ACCESS_COMPILED, entry);
+}
+
+/*
+ * Turn the entry list into lookup structures: zebra-style entries go into
+ * a prefix trie per address family, where all candidates for a prefix are
+ * on the path up from its longest match, and cisco-style entries are
+ * grouped by wildcard masks so each group is one hash lookup.  The first
+ * matching entry in list order is found as the lowest index among the
+ * candidates, so the result is the same as walking the list.
+ */
+static void access_list_compile(struct access_list *access)
+{
+	struct access_list_compiled *ac;
+	struct filter *filter;
+	unsigned int index = 0;
+
+	ac = XCALLOC(MTYPE_ACCESS_COMPILED, sizeof(*ac));
+	access->compiled = ac;
+
+	for (filter = access->head; filter; filter = filter->next)
+		index++;
+	if (index < ACCESS_LIST_COMPILE_MIN) {
+		ac->linear = true;
+		return;
+	}
+
+	index = 0;
+	for (filter = access->head; filter; filter = filter->next, index++) {
+		if (filter->cisco)
+			access_list_compile_cisco(ac, filter, index);
+		else if (!access_list_compile_zebra(ac, filter, index)) {
+			access_list_compiled_free(ac);
+			ac = XCALLOC(MTYPE_ACCESS_COMPILED, sizeof(*ac));
+			ac->linear = true;
+			access->compiled = ac;
+			return;
+		}
+	}
+}
+
+/* Drop the compiled form, it is rebuilt on next use. */
+void access_list_invalidate(struct access_list *access)
+{
+	if (!access->compiled)
+		return;
+
+	access_list_compiled_free(access->compiled);
+	access->compiled = NULL;
+}
+
+static enum filter_type
+access_list_compiled_apply(struct access_list_compiled *ac,
+			   const struct prefix *p)
+{
+	struct filter *best = NULL;
+	unsigned int best_index = UINT_MAX;
+	struct route_table **table;
+	struct route_node *rn, *match;
+	struct acl_zebra_node *zn;
+	struct acl_cisco_group *group;
+	struct acl_cisco_entry *entry, ref;
+	struct in_addr mask;
+
+	table = access_list_compiled_table(ac, p->family);
+	if (table && *table) {
+		match = route_node_match(*table, p);
+		for (rn = match; rn; rn = rn->parent) {
+			zn = rn->info;
+			if (!zn)
+				continue;
+
+			if (zn->filter && zn->index < best_index) {
+				best = zn->filter;
+				best_index = zn->index;
+			}
+			if (zn->exact && zn->exact_index < best_index
+			    && rn->p.prefixlen == p->prefixlen) {
+				best = zn->exact;
+				best_index = zn->exact_index;
+			}
+		}
+		if (match)
+			route_unlock_node(match);
+	}
+
+	for (group = ac->cisco; group; group = group->next) {
+		ref.addr = p->u.prefix4.s_addr & ~group->addr_mask;
+		ref.mask = 0;
+		if (group->extended) {
+			masklen2ip(p->prefixlen, &mask);
+			ref.mask = mask.s_addr & ~group->mask_mask;
+		}
+
+		entry = acl_cisco_entries_find(&group->entries, &ref);
+		if (entry && entry->index < best_index) {
+			best = entry->filter;
+			best_index = entry->index;
+		}
+	}
+
+	return best ? best->type : FILTER_DENY;
+}
+
 /* Allocate new access list structure. */
 static struct access_list *access_list_new(void)
 {
@@ -164,6 +443,8 @@ void access_list_delete(struct access_list *access)
 		filter_free(filter);
 	}
 
+	access_list_invalidate(access);
+
 	master = access->master;
 
 	if (access->type == ACCESS_TYPE_NUMBER)
@@ -318,6 +599,11 @@ enum filter_type access_list_apply(struct access_list *access,
 	if (access == NULL)
 		return FILTER_DENY;
 
+	if (!access->compiled)
+		access_list_compile(access);
+	if (!access->compiled->linear)
+		return access_list_compiled_apply(access->compiled, p);
+
 	for (filter = access->head; filter; filter = filter->next) {
 		if (filter->cisco) {
 			if (filter_match_cisco(filter, p))
@@ -398,6 +684,7 @@ void access_list_filter_delete(struct access_list *access,
 		access->head = filter->next;
 
 	filter_free(filter);
+	access_list_invalidate(access);
 
 	route_map_notify_dependencies(access->name, RMAP_EVENT_FILTER_DELETED);
 	/* Run hook function. */
@@ -451,6 +738,8 @@ void access_list_filter_add(struct access_list *access,
 		access->tail = filter;
 	}
 
+	access_list_invalidate(access);
+
 	/* Run hook function. */
 	if (access->master->add_hook)
 		(*access->master->add_hook)(access);
@@ -110,6 +110,9 @@ struct access_list {
 
 	struct filter *head;
 	struct filter *tail;
+
+	/* lookup structures built from the entries, see access_list_apply() */
+	struct access_list_compiled *compiled;
 };
 
 /* List of access_list. */
@@ -142,6 +145,8 @@ extern void access_list_delete_hook(void (*func)(struct access_list *));
 extern struct access_list *access_list_lookup(afi_t, const char *);
 extern enum filter_type access_list_apply(struct access_list *access,
 					  const void *object);
+/* must be called after changing any filter of the access list in place */
+extern void access_list_invalidate(struct access_list *access);
 
 struct access_list *access_list_get(afi_t afi, const char *name);
 void access_list_delete(struct access_list *access);
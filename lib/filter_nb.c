@@ -34,6 +34,8 @@
 /* Helper function. */
 static void acl_notify_route_map(struct access_list *acl, int route_map_event)
 {
+	access_list_invalidate(acl);
+
 	switch (route_map_event) {
 	case RMAP_EVENT_FILTER_ADDED:
 		if (acl->master->add_hook)
@@ -48,29 +50,43 @@ static void acl_notify_route_map(struct access_list *acl, int route_map_event)
 	route_map_notify_dependencies(acl->name, route_map_event);
 }
 
+/* Data paths looked up for every prefix list entry. */
+static struct yang_dpath dp_pl_type = YANG_DPATH_INIT("../../type");
+static struct yang_dpath dp_pl_seq = YANG_DPATH_INIT("./sequence");
+static struct yang_dpath dp_pl_prefix[] = {
+	YANG_DPATH_INIT("../ipv4-prefix"),
+	YANG_DPATH_INIT("../ipv6-prefix"),
+};
+static struct yang_dpath dp_pl_le[] = {
+	YANG_DPATH_INIT("../ipv4-prefix-length-lesser-or-equal"),
+	YANG_DPATH_INIT("../ipv6-prefix-length-lesser-or-equal"),
+};
+static struct yang_dpath dp_pl_ge[] = {
+	YANG_DPATH_INIT("../ipv4-prefix-length-greater-or-equal"),
+	YANG_DPATH_INIT("../ipv6-prefix-length-greater-or-equal"),
+};
+
 static enum nb_error prefix_list_length_validate(struct nb_cb_modify_args *args)
 {
-	int type = yang_dnode_get_enum(args->dnode, "../../type");
-	const char *xpath_le = NULL, *xpath_ge = NULL;
+	int type = yang_dnode_get_enum(
+		yang_dnode_dpath(args->dnode, &dp_pl_type), NULL);
+	const struct lyd_node *dnode_le, *dnode_ge;
+	int afi_idx = (type == YPLT_IPV4) ? 0 : 1;
 	struct prefix p;
 	uint8_t le, ge;
 
-	if (type == YPLT_IPV4) {
-		yang_dnode_get_prefix(&p, args->dnode, "../ipv4-prefix");
-		xpath_le = "../ipv4-prefix-length-lesser-or-equal";
-		xpath_ge = "../ipv4-prefix-length-greater-or-equal";
-	} else {
-		yang_dnode_get_prefix(&p, args->dnode, "../ipv6-prefix");
-		xpath_le = "../ipv6-prefix-length-lesser-or-equal";
-		xpath_ge = "../ipv6-prefix-length-greater-or-equal";
-	}
+	yang_dnode_get_prefix(
+		&p, yang_dnode_dpath(args->dnode, &dp_pl_prefix[afi_idx]),
+		NULL);
+	dnode_le = yang_dnode_dpath(args->dnode, &dp_pl_le[afi_idx]);
+	dnode_ge = yang_dnode_dpath(args->dnode, &dp_pl_ge[afi_idx]);
 
 	/*
 	 * Check rule:
 	 * prefix length <= le.
 	 */
-	if (yang_dnode_exists(args->dnode, xpath_le)) {
-		le = yang_dnode_get_uint8(args->dnode, xpath_le);
+	if (dnode_le) {
+		le = yang_dnode_get_uint8(dnode_le, NULL);
 		if (p.prefixlen > le)
 			goto log_and_fail;
 	}
@@ -79,8 +95,8 @@ static enum nb_error prefix_list_length_validate(struct nb_cb_modify_args *args)
 	 * Check rule:
 	 * prefix length <= ge.
 	 */
-	if (yang_dnode_exists(args->dnode, xpath_ge)) {
-		ge = yang_dnode_get_uint8(args->dnode, xpath_ge);
+	if (dnode_ge) {
+		ge = yang_dnode_get_uint8(dnode_ge, NULL);
 		if (p.prefixlen > ge)
 			goto log_and_fail;
 	}
@@ -89,10 +105,9 @@ static enum nb_error prefix_list_length_validate(struct nb_cb_modify_args *args)
 	 * Check rule:
 	 * ge <= le.
 	 */
-	if (yang_dnode_exists(args->dnode, xpath_le)
-	    && yang_dnode_exists(args->dnode, xpath_ge)) {
-		le = yang_dnode_get_uint8(args->dnode, xpath_le);
-		ge = yang_dnode_get_uint8(args->dnode, xpath_ge);
+	if (dnode_le && dnode_ge) {
+		le = yang_dnode_get_uint8(dnode_le, NULL);
+		ge = yang_dnode_get_uint8(dnode_ge, NULL);
 		if (ge > le)
 			goto log_and_fail;
 	}
@@ -756,7 +771,8 @@ static int lib_prefix_list_entry_create(struct nb_cb_create_args *args)
 	pl = nb_running_get_entry(args->dnode, NULL, true);
 	ple = prefix_list_entry_new();
 	ple->pl = pl;
-	ple->seq = yang_dnode_get_uint32(args->dnode, "./sequence");
+	ple->seq = yang_dnode_get_uint32(
+		yang_dnode_dpath(args->dnode, &dp_pl_seq), NULL);
 	prefix_list_entry_set_empty(ple);
 	nb_running_set_entry(args->dnode, ple);
 
@@ -1044,7 +1060,8 @@ const struct frr_yang_module_info frr_filter_info = {
 			.cbs = {
 				.create = lib_access_list_create,
 				.destroy = lib_access_list_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/remark",
@@ -1052,7 +1069,8 @@ const struct frr_yang_module_info frr_filter_info = {
 				.modify = lib_access_list_remark_modify,
 				.destroy = lib_access_list_remark_destroy,
 				.cli_show = access_list_remark_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry",
@@ -1060,114 +1078,131 @@ const struct frr_yang_module_info frr_filter_info = {
 				.create = lib_access_list_entry_create,
 				.destroy = lib_access_list_entry_destroy,
 				.cli_show = access_list_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/action",
 			.cbs = {
 				.modify = lib_access_list_entry_action_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/ipv4-prefix",
 			.cbs = {
 				.modify = lib_access_list_entry_ipv4_prefix_modify,
 				.destroy = lib_access_list_entry_ipv4_prefix_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/ipv4-exact-match",
 			.cbs = {
 				.modify = lib_access_list_entry_ipv4_exact_match_modify,
 				.destroy = lib_access_list_entry_ipv4_exact_match_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/host",
 			.cbs = {
 				.modify = lib_access_list_entry_host_modify,
 				.destroy = lib_access_list_entry_host_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/network/address",
 			.cbs = {
 				.modify = lib_access_list_entry_network_address_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/network/mask",
 			.cbs = {
 				.modify = lib_access_list_entry_network_mask_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/source-any",
 			.cbs = {
 				.create = lib_access_list_entry_source_any_create,
 				.destroy = lib_access_list_entry_source_any_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/destination-host",
 			.cbs = {
 				.modify = lib_access_list_entry_destination_host_modify,
 				.destroy = lib_access_list_entry_destination_host_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/destination-network/address",
 			.cbs = {
 				.modify = lib_access_list_entry_destination_network_address_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/destination-network/mask",
 			.cbs = {
 				.modify = lib_access_list_entry_destination_network_mask_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/destination-any",
 			.cbs = {
 				.create = lib_access_list_entry_destination_any_create,
 				.destroy = lib_access_list_entry_destination_any_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/ipv6-prefix",
 			.cbs = {
 				.modify = lib_access_list_entry_ipv4_prefix_modify,
 				.destroy = lib_access_list_entry_ipv4_prefix_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/ipv6-exact-match",
 			.cbs = {
 				.modify = lib_access_list_entry_ipv4_exact_match_modify,
 				.destroy = lib_access_list_entry_ipv4_exact_match_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/mac",
 			.cbs = {
 				.modify = lib_access_list_entry_ipv4_prefix_modify,
 				.destroy = lib_access_list_entry_ipv4_prefix_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/access-list/entry/any",
 			.cbs = {
 				.create = lib_access_list_entry_any_create,
 				.destroy = lib_access_list_entry_any_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list",
 			.cbs = {
 				.create = lib_prefix_list_create,
 				.destroy = lib_prefix_list_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/remark",
@@ -1175,7 +1210,8 @@ const struct frr_yang_module_info frr_filter_info = {
 				.modify = lib_prefix_list_remark_modify,
 				.destroy = lib_prefix_list_remark_destroy,
 				.cli_show = prefix_list_remark_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry",
@@ -1183,62 +1219,71 @@ const struct frr_yang_module_info frr_filter_info = {
 				.create = lib_prefix_list_entry_create,
 				.destroy = lib_prefix_list_entry_destroy,
 				.cli_show = prefix_list_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/action",
 			.cbs = {
 				.modify = lib_prefix_list_entry_action_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/ipv4-prefix",
 			.cbs = {
 				.modify = lib_prefix_list_entry_ipv4_prefix_modify,
 				.destroy = lib_prefix_list_entry_ipv4_prefix_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/ipv4-prefix-length-greater-or-equal",
 			.cbs = {
 				.modify = lib_prefix_list_entry_ipv4_prefix_length_greater_or_equal_modify,
 				.destroy = lib_prefix_list_entry_ipv4_prefix_length_greater_or_equal_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/ipv4-prefix-length-lesser-or-equal",
 			.cbs = {
 				.modify = lib_prefix_list_entry_ipv4_prefix_length_lesser_or_equal_modify,
 				.destroy = lib_prefix_list_entry_ipv4_prefix_length_lesser_or_equal_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/ipv6-prefix",
 			.cbs = {
 				.modify = lib_prefix_list_entry_ipv4_prefix_modify,
 				.destroy = lib_prefix_list_entry_ipv4_prefix_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/ipv6-prefix-length-greater-or-equal",
 			.cbs = {
 				.modify = lib_prefix_list_entry_ipv4_prefix_length_greater_or_equal_modify,
 				.destroy = lib_prefix_list_entry_ipv4_prefix_length_greater_or_equal_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/ipv6-prefix-length-lesser-or-equal",
 			.cbs = {
 				.modify = lib_prefix_list_entry_ipv4_prefix_length_lesser_or_equal_modify,
 				.destroy = lib_prefix_list_entry_ipv4_prefix_length_lesser_or_equal_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-filter:lib/prefix-list/entry/any",
 			.cbs = {
 				.create = lib_prefix_list_entry_any_create,
 				.destroy = lib_prefix_list_entry_any_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = NULL,
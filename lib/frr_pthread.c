@@ -23,15 +23,22 @@
 #include <pthread_np.h>
 #endif
 #include <sched.h>
+#ifdef GNU_LINUX
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#endif
 
 #include "frr_pthread.h"
 #include "memory.h"
 #include "linklist.h"
 #include "zlog.h"
 #include "libfrr_trace.h"
+#include "command.h"
+#include "lib_errors.h"
 
 DEFINE_MTYPE_STATIC(LIB, FRR_PTHREAD, "FRR POSIX Thread")
 DEFINE_MTYPE_STATIC(LIB, PTHREAD_PRIM, "POSIX sync primitives")
+DEFINE_MTYPE_STATIC(LIB, PTHREAD_SCHED, "POSIX thread placement")
 
 /* default frr_pthread start/stop routine prototypes */
 static void *fpt_run(void *arg);
@@ -50,6 +57,38 @@ const struct frr_pthread_attr frr_pthread_attr_default = {
 static pthread_mutex_t frr_pthread_list_mtx = PTHREAD_MUTEX_INITIALIZER;
 static struct list *frr_pthread_list;
 
+/*
+ * Configured CPU affinity and priority, by OS thread name.  Kept apart
+ * from the frr_pthreads so configuration can come before a thread is
+ * created (some are started on demand) and survives thread restarts.
+ * Requires: frr_pthread_list_mtx
+ */
+struct frr_pthread_sched {
+	struct frr_pthread_sched *next;
+
+	char name[OS_THREAD_NAMELEN];
+
+	/* CPU list as configured, e.g. "0-3,8" */
+	char *cpus;
+	bool has_prio;
+	int prio;
+
+	/* a thread by this name was seen in this daemon */
+	bool used;
+};
+
+static struct frr_pthread_sched *frr_pthread_scheds;
+
+static struct frr_pthread_sched *frr_pthread_sched_find(const char *name)
+{
+	struct frr_pthread_sched *sched;
+
+	for (sched = frr_pthread_scheds; sched; sched = sched->next)
+		if (strmatch(sched->name, name))
+			return sched;
+	return NULL;
+}
+
 /* ------------------------------------------------------------------------ */
 
 void frr_pthread_init(void)
@@ -105,7 +144,13 @@ struct frr_pthread *frr_pthread_new(const struct frr_pthread_attr *attr,
 	pthread_cond_init(fpt->running_cond, NULL);
 
 	frr_with_mutex(&frr_pthread_list_mtx) {
+		struct frr_pthread_sched *sched;
+
 		listnode_add(frr_pthread_list, fpt);
+
+		sched = frr_pthread_sched_find(fpt->os_name);
+		if (sched)
+			sched->used = true;
 	}
 
 	return fpt;
@@ -149,10 +194,109 @@ int frr_pthread_set_name(struct frr_pthread *fpt)
 	return ret;
 }
 
+#ifdef GNU_LINUX
+/* parse "0-3,8,10-11" */
+static bool frr_pthread_cpus_parse(const char *str, cpu_set_t *cpus)
+{
+	unsigned long first, last;
+	char *end;
+
+	CPU_ZERO(cpus);
+	while (*str) {
+		first = strtoul(str, &end, 10);
+		if (end == str)
+			return false;
+		last = first;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtoul(str, &end, 10);
+			if (end == str || last < first)
+				return false;
+		}
+		if (last >= CPU_SETSIZE)
+			return false;
+		for (; first <= last; first++)
+			CPU_SET(first, cpus);
+
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return false;
+		str = end;
+	}
+	return CPU_COUNT(cpus) > 0;
+}
+
+static void frr_pthread_cpus_format(const cpu_set_t *cpus, char *buf,
+				   size_t size)
+{
+	int cpu, last;
+	size_t len = 0;
+
+	buf[0] = '\0';
+	for (cpu = 0; cpu < CPU_SETSIZE && len < size; cpu++) {
+		if (!CPU_ISSET(cpu, cpus))
+			continue;
+		for (last = cpu; last + 1 < CPU_SETSIZE
+				 && CPU_ISSET(last + 1, cpus);
+		     last++)
+			;
+		if (last == cpu)
+			len += snprintf(buf + len, size - len, "%s%d",
+					len ? "," : "", cpu);
+		else
+			len += snprintf(buf + len, size - len, "%s%d-%d",
+					len ? "," : "", cpu, last);
+		cpu = last;
+	}
+}
+
+/* Requires: frr_pthread_list_mtx */
+static void frr_pthread_sched_apply(struct frr_pthread *fpt,
+				    struct frr_pthread_sched *sched)
+{
+	cpu_set_t cpus;
+	int ret;
+
+	if (sched->cpus && frr_pthread_cpus_parse(sched->cpus, &cpus)) {
+		ret = pthread_setaffinity_np(fpt->thread, sizeof(cpus), &cpus);
+		if (ret)
+			flog_err_sys(EC_LIB_SYSTEM_CALL,
+				     "%s: cannot bind %s to CPUs %s: %s",
+				     __func__, fpt->os_name, sched->cpus,
+				     safe_strerror(ret));
+	}
+
+	if (sched->has_prio && fpt->tid
+	    && setpriority(PRIO_PROCESS, fpt->tid, sched->prio) < 0)
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "%s: cannot set priority of %s to %d: %s",
+			     __func__, fpt->os_name, sched->prio,
+			     safe_strerror(errno));
+}
+#endif
+
 static void *frr_pthread_inner(void *arg)
 {
 	struct frr_pthread *fpt = arg;
 
+#ifdef GNU_LINUX
+	fpt->tid = syscall(__NR_gettid);
+
+	/*
+	 * Placement is applied from within the new thread before it does
+	 * anything, so whatever it allocates is first touched - and thus,
+	 * with the default Linux policy, placed - on its own NUMA node.
+	 */
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		struct frr_pthread_sched *sched;
+
+		sched = frr_pthread_sched_find(fpt->os_name);
+		if (sched)
+			frr_pthread_sched_apply(fpt, sched);
+	}
+#endif
+
 	rcu_thread_start(fpt->rcu_thread);
 	return fpt->attr.start(fpt);
 }
@@ -227,6 +371,271 @@ void frr_pthread_stop_all(void)
 	}
 }
 
+void frr_pthread_stats_reset(struct frr_pthread *fpt)
+{
+	thread_master_stats_reset(fpt->master);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * Placement configuration & display
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef GNU_LINUX
+/* Requires: frr_pthread_list_mtx */
+static void frr_pthread_sched_update(struct frr_pthread_sched *sched)
+{
+	struct listnode *node;
+	struct frr_pthread *fpt;
+
+	for (ALL_LIST_ELEMENTS_RO(frr_pthread_list, node, fpt)) {
+		if (!strmatch(fpt->os_name, sched->name))
+			continue;
+
+		sched->used = true;
+		if (atomic_load_explicit(&fpt->running, memory_order_relaxed))
+			frr_pthread_sched_apply(fpt, sched);
+	}
+}
+
+/* Requires: frr_pthread_list_mtx */
+static struct frr_pthread_sched *frr_pthread_sched_get(const char *name)
+{
+	struct frr_pthread_sched *sched;
+
+	sched = frr_pthread_sched_find(name);
+	if (sched)
+		return sched;
+
+	sched = XCALLOC(MTYPE_PTHREAD_SCHED, sizeof(*sched));
+	strlcpy(sched->name, name, sizeof(sched->name));
+	sched->next = frr_pthread_scheds;
+	frr_pthread_scheds = sched;
+	return sched;
+}
+
+/* Requires: frr_pthread_list_mtx */
+static void frr_pthread_sched_release(struct frr_pthread_sched *sched)
+{
+	struct frr_pthread_sched **prev;
+
+	if (sched->cpus || sched->has_prio)
+		return;
+
+	for (prev = &frr_pthread_scheds; *prev; prev = &(*prev)->next)
+		if (*prev == sched) {
+			*prev = sched->next;
+			break;
+		}
+	XFREE(MTYPE_PTHREAD_SCHED, sched);
+}
+
+DEFUN (pthread_affinity,
+       pthread_affinity_cmd,
+       "pthread WORD affinity CPULIST",
+       "POSIX thread placement\n"
+       "Thread name, as in \"show thread pthreads\"\n"
+       "Bind the thread to a set of CPUs\n"
+       "CPU list, e.g. 0-3,8\n")
+{
+	const char *name = argv[1]->arg;
+	const char *cpulist = argv[3]->arg;
+	struct frr_pthread_sched *sched;
+	cpu_set_t cpus;
+
+	if (strlen(name) >= OS_THREAD_NAMELEN) {
+		vty_out(vty, "%% Thread name too long\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+	if (!frr_pthread_cpus_parse(cpulist, &cpus)) {
+		vty_out(vty, "%% Invalid CPU list %s\n", cpulist);
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		sched = frr_pthread_sched_get(name);
+		XFREE(MTYPE_PTHREAD_SCHED, sched->cpus);
+		sched->cpus = XSTRDUP(MTYPE_PTHREAD_SCHED, cpulist);
+		frr_pthread_sched_update(sched);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_pthread_affinity,
+       no_pthread_affinity_cmd,
+       "no pthread WORD affinity [CPULIST]",
+       NO_STR
+       "POSIX thread placement\n"
+       "Thread name, as in \"show thread pthreads\"\n"
+       "Bind the thread to a set of CPUs\n"
+       "CPU list, e.g. 0-3,8\n")
+{
+	struct frr_pthread_sched *sched;
+
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		sched = frr_pthread_sched_find(argv[2]->arg);
+		if (!sched || !sched->cpus)
+			break;
+
+		/* existing threads keep their binding until restarted */
+		XFREE(MTYPE_PTHREAD_SCHED, sched->cpus);
+		frr_pthread_sched_release(sched);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN (pthread_priority,
+       pthread_priority_cmd,
+       "pthread WORD priority (-20-19)",
+       "POSIX thread placement\n"
+       "Thread name, as in \"show thread pthreads\"\n"
+       "Scheduling priority of the thread\n"
+       "Nice value, lower runs first\n")
+{
+	const char *name = argv[1]->arg;
+	struct frr_pthread_sched *sched;
+
+	if (strlen(name) >= OS_THREAD_NAMELEN) {
+		vty_out(vty, "%% Thread name too long\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		sched = frr_pthread_sched_get(name);
+		sched->has_prio = true;
+		sched->prio = strtol(argv[3]->arg, NULL, 10);
+		frr_pthread_sched_update(sched);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_pthread_priority,
+       no_pthread_priority_cmd,
+       "no pthread WORD priority [(-20-19)]",
+       NO_STR
+       "POSIX thread placement\n"
+       "Thread name, as in \"show thread pthreads\"\n"
+       "Scheduling priority of the thread\n"
+       "Nice value, lower runs first\n")
+{
+	struct frr_pthread_sched *sched;
+
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		sched = frr_pthread_sched_find(argv[2]->arg);
+		if (!sched || !sched->has_prio)
+			break;
+
+		/* likewise for their priority */
+		sched->has_prio = false;
+		sched->prio = 0;
+		frr_pthread_sched_release(sched);
+	}
+	return CMD_SUCCESS;
+}
+
+static void frr_pthread_show_one(struct vty *vty, const char *name, long tid,
+				 pthread_t thread, bool running)
+{
+	char cpubuf[64] = "-";
+	char nicebuf[8] = "-";
+	char timebuf[32] = "-";
+	cpu_set_t cpus;
+	clockid_t clock;
+	struct timespec ts;
+	int nice;
+
+	if (running) {
+		if (!pthread_getaffinity_np(thread, sizeof(cpus), &cpus))
+			frr_pthread_cpus_format(&cpus, cpubuf, sizeof(cpubuf));
+
+		errno = 0;
+		nice = getpriority(PRIO_PROCESS, tid);
+		if (!errno)
+			snprintf(nicebuf, sizeof(nicebuf), "%d", nice);
+
+		if (!pthread_getcpuclockid(thread, &clock)
+		    && !clock_gettime(clock, &ts))
+			snprintf(timebuf, sizeof(timebuf), "%lld.%03ld",
+				 (long long)ts.tv_sec, ts.tv_nsec / 1000000);
+	}
+
+	vty_out(vty, "%-16s %8ld %5s %12s  %s\n", name, tid, nicebuf, timebuf,
+		cpubuf);
+}
+
+DEFUN_NOSH (show_thread_pthreads,
+	    show_thread_pthreads_cmd,
+	    "show thread pthreads",
+	    SHOW_STR
+	    "Thread information\n"
+	    "POSIX threads, their placement and CPU time\n")
+{
+	struct listnode *node;
+	struct frr_pthread *fpt;
+
+	vty_out(vty, "%-16s %8s %5s %12s  %s\n", "Name", "TID", "Nice",
+		"CPU time (s)", "CPUs");
+
+	frr_pthread_show_one(vty, "main", getpid(), pthread_self(), true);
+
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(frr_pthread_list, node, fpt))
+			frr_pthread_show_one(
+				vty, fpt->os_name, fpt->tid, fpt->thread,
+				atomic_load_explicit(&fpt->running,
+						     memory_order_relaxed));
+	}
+	return CMD_SUCCESS;
+}
+
+static int frr_pthread_config_write(struct vty *vty);
+static struct cmd_node frr_pthread_node = {
+	.name = "pthread",
+	.node = PTHREAD_NODE,
+	.prompt = "",
+	.config_write = frr_pthread_config_write,
+};
+
+static int frr_pthread_config_write(struct vty *vty)
+{
+	struct frr_pthread_sched *sched;
+	int written = 0;
+
+	frr_with_mutex(&frr_pthread_list_mtx) {
+		/* only the daemon running a thread owns its configuration */
+		for (sched = frr_pthread_scheds; sched; sched = sched->next) {
+			if (!sched->used)
+				continue;
+			if (sched->cpus)
+				vty_out(vty, "pthread %s affinity %s\n",
+					sched->name, sched->cpus);
+			if (sched->has_prio)
+				vty_out(vty, "pthread %s priority %d\n",
+					sched->name, sched->prio);
+			written++;
+		}
+	}
+	if (written)
+		vty_out(vty, "!\n");
+	return written;
+}
+
+void frr_pthread_cmd_init(void)
+{
+	install_node(&frr_pthread_node);
+	install_element(CONFIG_NODE, &pthread_affinity_cmd);
+	install_element(CONFIG_NODE, &no_pthread_affinity_cmd);
+	install_element(CONFIG_NODE, &pthread_priority_cmd);
+	install_element(CONFIG_NODE, &no_pthread_priority_cmd);
+	install_element(VIEW_NODE, &show_thread_pthreads_cmd);
+}
+#else
+void frr_pthread_cmd_init(void)
+{
+}
+#endif /* GNU_LINUX */
+
 /*
  * ----------------------------------------------------------------------------
  * Default Event Loop
@@ -97,6 +97,9 @@ struct frr_pthread {
 
 	/* Used in pthread_set_name max 16 characters */
 	char os_name[OS_THREAD_NAMELEN];
+
+	/* OS thread id, once running; 0 where not available */
+	long tid;
 };
 
 extern const struct frr_pthread_attr frr_pthread_attr_default;
@@ -108,6 +111,9 @@ extern const struct frr_pthread_attr frr_pthread_attr_default;
  */
 void frr_pthread_init(void);
 
+/* "pthread NAME affinity|priority" and "show thread pthreads" */
+void frr_pthread_cmd_init(void);
+
 /*
  * Uninitializes this module.
  *
@@ -211,6 +217,14 @@ int frr_pthread_stop(struct frr_pthread *fpt, void **result);
 /* Stops all frr_pthread's. */
 void frr_pthread_stop_all(void);
 
+/*
+ * Resets the event loop statistics (show thread cpu / show thread latency)
+ * of the given pthread.
+ *
+ * @param fpt - frr_pthread * whose statistics to reset
+ */
+void frr_pthread_stats_reset(struct frr_pthread *fpt);
+
 #ifndef HAVE_PTHREAD_CONDATTR_SETCLOCK
 #define pthread_condattr_setclock(A, B)
 #endif
@@ -25,8 +25,17 @@
 
 #if defined(HAVE_LUA)
 #include "prefix.h"
+#include "nexthop.h"
 #include "frrlua.h"
 #include "log.h"
+#include "memory.h"
+#include "monotime.h"
+
+DEFINE_MTYPE_STATIC(LIB, FRRLUA_SCRIPT, "Lua script cache entry")
+
+#ifndef thread_local
+#define thread_local __thread
+#endif
 
 static int lua_zlog_debug(lua_State *L)
 {
@@ -81,9 +90,7 @@ lua_State *lua_initialize(const char *file)
 	int status;
 	lua_State *L = lua_newstate(lua_alloc, NULL);
 
-	zlog_debug("Newstate: %p", L);
 	luaL_openlibs(L);
-	zlog_debug("Opened lib");
 	status = luaL_loadfile(L, file);
 	if (status) {
 		zlog_debug("Failure to open %s %d", file, status);
@@ -91,14 +98,209 @@ lua_State *lua_initialize(const char *file)
 		return NULL;
 	}
 
-	lua_pcall(L, 0, LUA_MULTRET, 0);
-	zlog_debug("Setting global function");
+	status = lua_pcall(L, 0, 0, 0);
+	if (status) {
+		zlog_debug("Failure to run %s: %s", file, lua_tostring(L, -1));
+		lua_close(L);
+		return NULL;
+	}
 	lua_pushcfunction(L, lua_zlog_debug);
 	lua_setglobal(L, "zlog_debug");
 
 	return L;
 }
 
+/*
+ * Per-pthread cache of loaded scripts.  Setting up a lua_State and compiling
+ * the file costs far more than running a hook function, so each pthread keeps
+ * one state per file around.  The file's mtime is checked at most once per
+ * second and the state rebuilt when it changed.
+ */
+struct frrlua_script {
+	struct frrlua_script *next;
+
+	char *file;
+	lua_State *L;
+	time_t mtime;
+	time_t checked;
+};
+
+static thread_local struct frrlua_script *frrlua_scripts;
+static thread_local bool frrlua_tls_active;
+
+static pthread_key_t frrlua_tls_key;
+static pthread_once_t frrlua_tls_once = PTHREAD_ONCE_INIT;
+
+static void frrlua_tls_fini(void *arg)
+{
+	struct frrlua_script *script = arg, *next;
+
+	for (; script; script = next) {
+		next = script->next;
+		if (script->L)
+			lua_close(script->L);
+		XFREE(MTYPE_FRRLUA_SCRIPT, script->file);
+		XFREE(MTYPE_FRRLUA_SCRIPT, script);
+	}
+}
+
+static void frrlua_tls_key_create(void)
+{
+	pthread_key_create(&frrlua_tls_key, frrlua_tls_fini);
+}
+
+lua_State *frrlua_state_get(const char *file)
+{
+	struct frrlua_script *script;
+	time_t now = monotime(NULL);
+	struct stat st;
+
+	for (script = frrlua_scripts; script; script = script->next)
+		if (!strcmp(script->file, file))
+			break;
+
+	if (!script) {
+		script = XCALLOC(MTYPE_FRRLUA_SCRIPT, sizeof(*script));
+		script->file = XSTRDUP(MTYPE_FRRLUA_SCRIPT, file);
+		script->mtime = -1;
+		script->checked = now - 1;
+		script->next = frrlua_scripts;
+		frrlua_scripts = script;
+
+		if (!frrlua_tls_active) {
+			pthread_once(&frrlua_tls_once, frrlua_tls_key_create);
+			frrlua_tls_active = true;
+		}
+		pthread_setspecific(frrlua_tls_key, frrlua_scripts);
+	}
+
+	if (script->checked == now)
+		return script->L;
+	script->checked = now;
+
+	if (stat(file, &st))
+		st.st_mtime = -1;
+	if (st.st_mtime == script->mtime)
+		return script->L;
+
+	if (script->L)
+		lua_close(script->L);
+	script->mtime = st.st_mtime;
+	script->L = st.st_mtime == -1 ? NULL : lua_initialize(file);
+	return script->L;
+}
+
+/*
+ * Objects are handed to scripts as a userdata holding just a pointer, with
+ * a per-type metatable doing the field accesses.  There is one such userdata
+ * per type and lua_State, kept in the registry and re-pointed for each call,
+ * so passing an object doesn't allocate anything.
+ */
+static void **frrlua_ptr_slot(lua_State *L, const struct frrlua_udtype *type)
+{
+	void **slot;
+
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, type) != LUA_TNIL)
+		return lua_touserdata(L, -1);
+	lua_pop(L, 1);
+
+	slot = lua_newuserdata(L, sizeof(*slot));
+	if (luaL_newmetatable(L, type->name)) {
+		lua_pushcfunction(L, type->index);
+		lua_setfield(L, -2, "__index");
+		if (type->newindex) {
+			lua_pushcfunction(L, type->newindex);
+			lua_setfield(L, -2, "__newindex");
+		}
+	}
+	lua_setmetatable(L, -2);
+
+	lua_pushvalue(L, -1);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, type);
+	return slot;
+}
+
+void frrlua_push_ptr(lua_State *L, const struct frrlua_udtype *type,
+		     const void *ptr)
+{
+	*frrlua_ptr_slot(L, type) = (void *)ptr;
+}
+
+void frrlua_unset_ptr(lua_State *L, const struct frrlua_udtype *type)
+{
+	*frrlua_ptr_slot(L, type) = NULL;
+	lua_pop(L, 1);
+}
+
+void *frrlua_check_ptr(lua_State *L, int idx, const struct frrlua_udtype *type)
+{
+	void **slot = luaL_checkudata(L, idx, type->name);
+
+	if (!*slot)
+		luaL_error(L, "%s used outside of its hook call", type->name);
+	return *slot;
+}
+
+static int frrlua_prefix_index(lua_State *L)
+{
+	const struct prefix *p = frrlua_check_ptr(L, 1, &frrlua_prefix_type);
+	const char *key = luaL_checkstring(L, 2);
+	char buf[PREFIX_STRLEN];
+
+	if (!strcmp(key, "route"))
+		lua_pushstring(L, prefix2str(p, buf, sizeof(buf)));
+	else if (!strcmp(key, "family"))
+		lua_pushinteger(L, p->family);
+	else if (!strcmp(key, "prefixlen"))
+		lua_pushinteger(L, p->prefixlen);
+	else
+		lua_pushnil(L);
+	return 1;
+}
+
+const struct frrlua_udtype frrlua_prefix_type = {
+	.name = "frr.prefix",
+	.index = frrlua_prefix_index,
+};
+
+static int frrlua_nexthop_index(lua_State *L)
+{
+	const struct nexthop *nh = frrlua_check_ptr(L, 1, &frrlua_nexthop_type);
+	const char *key = luaL_checkstring(L, 2);
+	char buf[INET6_ADDRSTRLEN];
+
+	if (!strcmp(key, "type"))
+		lua_pushinteger(L, nh->type);
+	else if (!strcmp(key, "ifindex"))
+		lua_pushinteger(L, nh->ifindex);
+	else if (!strcmp(key, "vrf_id"))
+		lua_pushinteger(L, nh->vrf_id);
+	else if (!strcmp(key, "gate")) {
+		switch (nh->type) {
+		case NEXTHOP_TYPE_IPV4:
+		case NEXTHOP_TYPE_IPV4_IFINDEX:
+			lua_pushstring(L, inet_ntop(AF_INET, &nh->gate.ipv4,
+						    buf, sizeof(buf)));
+			break;
+		case NEXTHOP_TYPE_IPV6:
+		case NEXTHOP_TYPE_IPV6_IFINDEX:
+			lua_pushstring(L, inet_ntop(AF_INET6, &nh->gate.ipv6,
+						    buf, sizeof(buf)));
+			break;
+		default:
+			lua_pushnil(L);
+			break;
+		}
+	} else
+		lua_pushnil(L);
+	return 1;
+}
+
+const struct frrlua_udtype frrlua_nexthop_type = {
+	.name = "frr.nexthop",
+	.index = frrlua_nexthop_index,
+};
+
 void lua_setup_prefix_table(lua_State *L, const struct prefix *prefix)
 {
 	char buffer[100];
@@ -118,12 +320,15 @@ enum lua_rm_status lua_run_rm_rule(lua_State *L, const char *rule)
 	lua_getglobal(L, rule);
 	status = lua_pcall(L, 0, 1, 0);
 	if (status) {
-		zlog_debug("Executing Failure with function: %s: %d",
-			   rule, status);
+		zlog_debug("Executing Failure with function: %s: %s",
+			   rule, lua_tostring(L, -1));
+		lua_pop(L, 1);
 		return LUA_RM_FAILURE;
 	}
 
+	/* states are reused, don't leave anything on the stack */
 	status = lua_tonumber(L, -1);
+	lua_pop(L, 1);
 	return status;
 }
 #endif
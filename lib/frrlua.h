@@ -68,6 +68,35 @@ enum lua_rm_status {
  */
 lua_State *lua_initialize(const char *file);
 
+/*
+ * Same, but the state is cached for the calling pthread and reused by
+ * later calls for the same file (reloading it if it changed.)  Must not be
+ * lua_close()d.  Returns NULL if the file can't be loaded.
+ */
+lua_State *frrlua_state_get(const char *file);
+
+/*
+ * Passing C objects to scripts without copying them into a table: a type
+ * provides __index (and optionally __newindex) functions that look at the
+ * object through frrlua_check_ptr().  frrlua_push_ptr() pushes the state's
+ * userdata for the type pointed at ptr; call frrlua_unset_ptr() once the
+ * object goes away so scripts holding on to it get an error instead.
+ */
+struct frrlua_udtype {
+	const char *name;
+	lua_CFunction index;
+	lua_CFunction newindex;
+};
+
+extern const struct frrlua_udtype frrlua_prefix_type;
+extern const struct frrlua_udtype frrlua_nexthop_type;
+
+void frrlua_push_ptr(lua_State *L, const struct frrlua_udtype *type,
+		     const void *ptr);
+void frrlua_unset_ptr(lua_State *L, const struct frrlua_udtype *type);
+void *frrlua_check_ptr(lua_State *L, int idx,
+		       const struct frrlua_udtype *type);
+
 void lua_setup_prefix_table(lua_State *L, const struct prefix *prefix);
 
 enum lua_rm_status lua_run_rm_rule(lua_State *L, const char *rule);
@@ -82,6 +82,7 @@ DEFUN (grammar_test,
 
 	cmd_graph_parse(graph, cmd);
 	cmd_graph_merge(nodegraph, graph, +1);
+	command_match_cache_flush();
 
 	return CMD_SUCCESS;
 }
@@ -382,6 +383,7 @@ DEFUN (grammar_findambig,
 	if (scan && nodegraph_free) {
 		graph_delete_graph(nodegraph_free);
 		nodegraph_free = NULL;
+		command_match_cache_flush();
 	}
 
 	if (!scan && !nodegraph) {
@@ -441,6 +443,7 @@ DEFUN (grammar_init_graph,
 	if (nodegraph_free)
 		graph_delete_graph(nodegraph_free);
 	nodegraph_free = NULL;
+	command_match_cache_flush();
 
 	init_cmdgraph(vty, &nodegraph);
 	return CMD_SUCCESS;
@@ -456,6 +459,7 @@ DEFUN (grammar_access,
 	if (nodegraph_free)
 		graph_delete_graph(nodegraph_free);
 	nodegraph_free = NULL;
+	command_match_cache_flush();
 
 	struct cmd_node *cnode;
 
@@ -38,17 +38,14 @@ DEFINE_MTYPE_STATIC(LIB, HASH_INDEX, "Hash Index")
 static pthread_mutex_t _hashes_mtx = PTHREAD_MUTEX_INITIALIZER;
 static struct list *_hashes;
 
-struct hash *hash_create_size(unsigned int size,
-			      unsigned int (*hash_key)(const void *),
-			      bool (*hash_cmp)(const void *, const void *),
-			      const char *name)
+static struct hash *hash_new(unsigned int size,
+			     unsigned int (*hash_key)(const void *),
+			     bool (*hash_cmp)(const void *, const void *),
+			     const char *name)
 {
 	struct hash *hash;
 
-	assert((size & (size - 1)) == 0);
 	hash = XCALLOC(MTYPE_HASH, sizeof(struct hash));
-	hash->index =
-		XCALLOC(MTYPE_HASH_INDEX, sizeof(struct hash_bucket *) * size);
 	hash->size = size;
 	hash->hash_key = hash_key;
 	hash->hash_cmp = hash_cmp;
@@ -66,6 +63,20 @@ struct hash *hash_create_size(unsigned int size,
 	return hash;
 }
 
+struct hash *hash_create_size(unsigned int size,
+			      unsigned int (*hash_key)(const void *),
+			      bool (*hash_cmp)(const void *, const void *),
+			      const char *name)
+{
+	struct hash *hash;
+
+	assert((size & (size - 1)) == 0);
+	hash = hash_new(size, hash_key, hash_cmp, name);
+	hash->index =
+		XCALLOC(MTYPE_HASH_INDEX, sizeof(struct hash_bucket *) * size);
+	return hash;
+}
+
 struct hash *hash_create(unsigned int (*hash_key)(const void *),
 			 bool (*hash_cmp)(const void *, const void *),
 			 const char *name)
@@ -137,11 +148,243 @@ static void hash_expand(struct hash *hash)
 	hash->index = new_index;
 }
 
+/* Open addressing ---------------------------------------------------------
+ *
+ * Linear probing over (key, bucket) slots; the key is compared before
+ * touching the bucket, so a miss costs no extra cache lines.  Deleted slots
+ * are only marked, which keeps hash_iterate() safe against hash_release()
+ * from the callback.  Tables are kept at most 3/4 used (live + deleted).
+ */
+#define HASH_SLOT_DELETED ((struct hash_bucket *)(uintptr_t)1)
+#define HASH_SLOT_LIVE(s) ((s)->hb && (s)->hb != HASH_SLOT_DELETED)
+/* old slots moved per insert while resizing; with the table doubling at 3/4
+ * this finishes long before the new array could fill up
+ */
+#define HASH_MIGRATE_STEP 16
+
+static struct hash_slot *hash_open_find(struct hash_slot *slots,
+					unsigned int size, unsigned int key,
+					bool (*hash_cmp)(const void *,
+							 const void *),
+					void *data)
+{
+	unsigned int mask = size - 1;
+	struct hash_slot *s;
+
+	for (unsigned int i = key & mask;; i = (i + 1) & mask) {
+		s = &slots[i];
+		if (!s->hb)
+			return NULL;
+		if (s->hb != HASH_SLOT_DELETED && s->key == key
+		    && hash_cmp(s->hb->data, data))
+			return s;
+	}
+}
+
+static void hash_open_place(struct hash *hash, struct hash_bucket *hb)
+{
+	unsigned int mask = hash->size - 1;
+	struct hash_slot *s;
+
+	for (unsigned int i = hb->key & mask;; i = (i + 1) & mask) {
+		s = &hash->slots[i];
+		if (!s->hb) {
+			hash->used++;
+			break;
+		}
+		if (s->hb == HASH_SLOT_DELETED)
+			break;
+	}
+	s->key = hb->key;
+	s->hb = hb;
+}
+
+/*
+ * Migration starts at an empty old slot and only stops in front of another
+ * one, i.e. probe clusters are always moved as a whole.  Moved slots can
+ * then simply be emptied: probe chains of the remaining old entries never
+ * cross them, and lookups in old_slots stay as short as before the resize.
+ */
+static void hash_open_migrate(struct hash *hash, unsigned int steps)
+{
+	unsigned int mask = hash->old_size - 1;
+	struct hash_slot *s;
+
+	while (hash->old_slots) {
+		s = &hash->old_slots[hash->migrate_pos];
+		if (!s->hb && !steps)
+			break;
+
+		if (HASH_SLOT_LIVE(s))
+			hash_open_place(hash, s->hb);
+		s->hb = NULL;
+
+		hash->migrate_pos = (hash->migrate_pos + 1) & mask;
+		if (steps)
+			steps--;
+		if (--hash->migrate_left == 0) {
+			XFREE(MTYPE_HASH_INDEX, hash->old_slots);
+			hash->old_size = 0;
+			hash->migrate_pos = 0;
+		}
+	}
+}
+
+static void hash_open_resize(struct hash *hash)
+{
+	unsigned int new_size = hash->size;
+
+	/* one resize at a time */
+	hash_open_migrate(hash, UINT_MAX);
+
+	/* grow if actually full, otherwise just get rid of deleted slots */
+	if (hash->count + 1 > hash->size / 2)
+		new_size *= 2;
+
+	hash->old_slots = hash->slots;
+	hash->old_size = hash->size;
+	hash->migrate_left = hash->size;
+	/* there is always an empty slot since at most 3/4 are used */
+	hash->migrate_pos = 0;
+	while (hash->old_slots[hash->migrate_pos].hb)
+		hash->migrate_pos++;
+
+	hash->slots = XCALLOC(MTYPE_HASH_INDEX, sizeof(struct hash_slot)
+							* new_size);
+	hash->size = new_size;
+	hash->used = 0;
+}
+
+static void *hash_open_get(struct hash *hash, void *data, unsigned int key,
+			   void *(*alloc_func)(void *))
+{
+	struct hash_slot *s;
+	struct hash_bucket *bucket;
+	void *newdata;
+
+	s = hash_open_find(hash->slots, hash->size, key, hash->hash_cmp, data);
+	if (!s && hash->old_slots)
+		s = hash_open_find(hash->old_slots, hash->old_size, key,
+				   hash->hash_cmp, data);
+	if (s)
+		return s->hb->data;
+
+	if (!alloc_func)
+		return NULL;
+
+	newdata = (*alloc_func)(data);
+	if (newdata == NULL)
+		return NULL;
+
+	if ((hash->used + 1) * 4 > hash->size * 3)
+		hash_open_resize(hash);
+
+	bucket = XCALLOC(MTYPE_HASH_BACKET, sizeof(struct hash_bucket));
+	bucket->data = newdata;
+	bucket->key = key;
+	bucket->len = 1;
+	hash_open_place(hash, bucket);
+	hash->count++;
+
+	hash_open_migrate(hash, HASH_MIGRATE_STEP);
+
+	frrtrace(3, frr_libfrr, hash_insert, hash, data, key);
+
+	return bucket->data;
+}
+
+static void *hash_open_release(struct hash *hash, void *data,
+			       unsigned int key)
+{
+	struct hash_slot *s;
+	void *ret;
+
+	s = hash_open_find(hash->slots, hash->size, key, hash->hash_cmp, data);
+	if (!s && hash->old_slots)
+		s = hash_open_find(hash->old_slots, hash->old_size, key,
+				   hash->hash_cmp, data);
+	if (!s)
+		return NULL;
+
+	ret = s->hb->data;
+	XFREE(MTYPE_HASH_BACKET, s->hb);
+	s->hb = HASH_SLOT_DELETED;
+	hash->count--;
+	return ret;
+}
+
+static int hash_open_walk(struct hash *hash,
+			  int (*func)(struct hash_bucket *, void *), void *arg)
+{
+	struct hash_slot *tables[2] = {hash->old_slots, hash->slots};
+	unsigned int sizes[2] = {hash->old_size, hash->size};
+
+	for (unsigned int t = 0; t < 2; t++)
+		for (unsigned int i = 0; tables[t] && i < sizes[t]; i++) {
+			if (!HASH_SLOT_LIVE(&tables[t][i]))
+				continue;
+			if ((*func)(tables[t][i].hb, arg) == HASHWALK_ABORT)
+				return HASHWALK_ABORT;
+		}
+	return HASHWALK_CONTINUE;
+}
+
+static void hash_open_clean(struct hash *hash, void (*free_func)(void *))
+{
+	struct hash_slot *tables[2] = {hash->old_slots, hash->slots};
+	unsigned int sizes[2] = {hash->old_size, hash->size};
+
+	for (unsigned int t = 0; t < 2; t++)
+		for (unsigned int i = 0; tables[t] && i < sizes[t]; i++) {
+			struct hash_slot *s = &tables[t][i];
+
+			if (HASH_SLOT_LIVE(s)) {
+				if (free_func)
+					(*free_func)(s->hb->data);
+				XFREE(MTYPE_HASH_BACKET, s->hb);
+				hash->count--;
+			}
+		}
+
+	XFREE(MTYPE_HASH_INDEX, hash->old_slots);
+	hash->old_size = 0;
+	hash->migrate_pos = 0;
+	hash->migrate_left = 0;
+	memset(hash->slots, 0, sizeof(struct hash_slot) * hash->size);
+	hash->used = 0;
+	hash->stats.empty = hash->size;
+}
+
+struct hash *hash_create_open(unsigned int size,
+			      unsigned int (*hash_key)(const void *),
+			      bool (*hash_cmp)(const void *, const void *),
+			      const char *name)
+{
+	struct hash *hash;
+
+	assert((size & (size - 1)) == 0);
+	/* need at least one free slot to terminate probing */
+	if (size < 4)
+		size = 4;
+	hash = hash_new(size, hash_key, hash_cmp, name);
+	hash->slots = XCALLOC(MTYPE_HASH_INDEX, sizeof(struct hash_slot) * size);
+	return hash;
+}
+
 void *hash_get(struct hash *hash, void *data, void *(*alloc_func)(void *))
+{
+	if (!alloc_func && !hash->count)
+		return NULL;
+
+	return hash_get_with_key(hash, data, (*hash->hash_key)(data),
+				 alloc_func);
+}
+
+void *hash_get_with_key(struct hash *hash, void *data, unsigned int key,
+			void *(*alloc_func)(void *))
 {
 	frrtrace(2, frr_libfrr, hash_get, hash, data);
 
-	unsigned int key;
 	unsigned int index;
 	void *newdata;
 	struct hash_bucket *bucket;
@@ -149,7 +392,9 @@ void *hash_get(struct hash *hash, void *data, void *(*alloc_func)(void *))
 	if (!alloc_func && !hash->count)
 		return NULL;
 
-	key = (*hash->hash_key)(data);
+	if (hash->slots)
+		return hash_open_get(hash, data, key, alloc_func);
+
 	index = key & (hash->size - 1);
 
 	for (bucket = hash->index[index]; bucket != NULL;
@@ -210,14 +455,23 @@ unsigned int string_hash_make(const char *str)
 }
 
 void *hash_release(struct hash *hash, void *data)
+{
+	return hash_release_with_key(hash, data, (*hash->hash_key)(data));
+}
+
+void *hash_release_with_key(struct hash *hash, void *data, unsigned int key)
 {
 	void *ret = NULL;
-	unsigned int key;
 	unsigned int index;
 	struct hash_bucket *bucket;
 	struct hash_bucket *pp;
 
-	key = (*hash->hash_key)(data);
+	if (hash->slots) {
+		ret = hash_open_release(hash, data, key);
+		frrtrace(3, frr_libfrr, hash_release, hash, data, ret);
+		return ret;
+	}
+
 	index = key & (hash->size - 1);
 
 	for (bucket = pp = hash->index[index]; bucket; bucket = bucket->next) {
@@ -258,6 +512,17 @@ void hash_iterate(struct hash *hash, void (*func)(struct hash_bucket *, void *),
 	struct hash_bucket *hb;
 	struct hash_bucket *hbnext;
 
+	if (hash->slots) {
+		struct hash_slot *tables[2] = {hash->old_slots, hash->slots};
+		unsigned int sizes[2] = {hash->old_size, hash->size};
+
+		for (unsigned int t = 0; t < 2; t++)
+			for (i = 0; tables[t] && i < sizes[t]; i++)
+				if (HASH_SLOT_LIVE(&tables[t][i]))
+					(*func)(tables[t][i].hb, arg);
+		return;
+	}
+
 	for (i = 0; i < hash->size; i++)
 		for (hb = hash->index[i]; hb; hb = hbnext) {
 			/* get pointer to next hash bucket here, in case (*func)
@@ -276,6 +541,11 @@ void hash_walk(struct hash *hash, int (*func)(struct hash_bucket *, void *),
 	struct hash_bucket *hbnext;
 	int ret = HASHWALK_CONTINUE;
 
+	if (hash->slots) {
+		hash_open_walk(hash, func, arg);
+		return;
+	}
+
 	for (i = 0; i < hash->size; i++) {
 		for (hb = hash->index[i]; hb; hb = hbnext) {
 			/* get pointer to next hash bucket here, in case (*func)
@@ -295,6 +565,11 @@ void hash_clean(struct hash *hash, void (*free_func)(void *))
 	struct hash_bucket *hb;
 	struct hash_bucket *next;
 
+	if (hash->slots) {
+		hash_open_clean(hash, free_func);
+		return;
+	}
+
 	for (i = 0; i < hash->size; i++) {
 		for (hb = hash->index[i]; hb; hb = next) {
 			next = hb->next;
@@ -341,6 +616,8 @@ void hash_free(struct hash *hash)
 	XFREE(MTYPE_HASH, hash->name);
 
 	XFREE(MTYPE_HASH_INDEX, hash->index);
+	XFREE(MTYPE_HASH_INDEX, hash->slots);
+	XFREE(MTYPE_HASH_INDEX, hash->old_slots);
 	XFREE(MTYPE_HASH, hash);
 }
 
@@ -414,6 +691,12 @@ DEFUN_NOSH(show_hash_stats,
 		if (!h->name)
 			continue;
 
+		if (h->slots) {
+			/* no chains; every entry is its own "bucket" */
+			h->stats.empty = h->size - h->count;
+			h->stats.ssq = h->count;
+		}
+
 		ssq = (long double)h->stats.ssq;
 		x2 = h->count * h->count;
 		ldc = (long double)h->count;
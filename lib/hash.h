@@ -53,6 +53,12 @@ struct hash_bucket {
 	void *data;
 };
 
+/* slot of an open addressing hash, see hash_create_open() */
+struct hash_slot {
+	unsigned int key;
+	struct hash_bucket *hb;
+};
+
 struct hashstats {
 	/* number of empty hash buckets */
 	atomic_uint_fast32_t empty;
@@ -83,6 +89,20 @@ struct hash {
 
 	/* hash name */
 	char *name;
+
+	/*
+	 * Open addressing only (index is NULL then).  While resizing, the
+	 * previous slot array is kept in old_slots and moved over a few slots
+	 * per insert; lookups check both.
+	 */
+	struct hash_slot *slots;
+	struct hash_slot *old_slots;
+	unsigned int old_size;
+	/* next old slot to move, and how many are left */
+	unsigned int migrate_pos;
+	unsigned int migrate_left;
+	/* live + deleted slots in "slots" */
+	unsigned int used;
 };
 
 #define hashcount(X) ((X)->count)
@@ -154,6 +174,24 @@ hash_create_size(unsigned int size, unsigned int (*hash_key)(const void *),
 		 bool (*hash_cmp)(const void *, const void *),
 		 const char *name);
 
+/*
+ * Create an open addressing hash table.
+ *
+ * Same API and semantics as hash_create_size(), but entries are kept in a
+ * flat array of (key, bucket) slots with linear probing, and the table
+ * grows incrementally - a resize moves a few entries on each following
+ * insert rather than rehashing the whole table in one hash_get() call.
+ * Intended for large tables (millions of entries) where that stall matters.
+ *
+ * hash->index is NULL for these tables; code that walks hash->index
+ * directly must use hash_iterate() / hash_walk() instead.  max_size is not
+ * supported.
+ */
+extern struct hash *
+hash_create_open(unsigned int size, unsigned int (*hash_key)(const void *),
+		 bool (*hash_cmp)(const void *, const void *),
+		 const char *name);
+
 /*
  * Retrieve or insert data from / into a hash table.
  *
@@ -189,6 +227,14 @@ hash_create_size(unsigned int size, unsigned int (*hash_key)(const void *),
 extern void *hash_get(struct hash *hash, void *data,
 		      void *(*alloc_func)(void *));
 
+/*
+ * Same as hash_get, for callers that already computed the hash key of data,
+ * e.g. to pick one of several tables.  key must be what the table's hash_key
+ * function returns for data.
+ */
+extern void *hash_get_with_key(struct hash *hash, void *data, unsigned int key,
+			       void *(*alloc_func)(void *));
+
 /*
  * Dummy element allocation function.
  *
@@ -232,6 +278,10 @@ extern void *hash_lookup(struct hash *hash, void *data);
  */
 extern void *hash_release(struct hash *hash, void *data);
 
+/* Same as hash_release, with the hash key computed by the caller. */
+extern void *hash_release_with_key(struct hash *hash, void *data,
+				   unsigned int key);
+
 /*
  * Iterate over the elements in a hash table.
  *
@@ -0,0 +1,171 @@
+/*
+ * Event loop heartbeat, published through shared memory
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+#include <sys/mman.h>
+
+#include "heartbeat.h"
+#include "thread.h"
+#include "lib_errors.h"
+
+/* a reader gives up after this many inconsistent copies */
+#define HEARTBEAT_SNAPSHOT_TRIES 16
+
+static char heartbeat_path[256];
+
+static inline void frr_heartbeat_begin(struct frr_heartbeat *hb)
+{
+	atomic_fetch_add_explicit(&hb->seq, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void frr_heartbeat_end(struct frr_heartbeat *hb)
+{
+	atomic_fetch_add_explicit(&hb->seq, 1, memory_order_release);
+}
+
+void frr_heartbeat_enter(struct frr_heartbeat *hb, const struct thread *thread,
+			 const struct timeval *start)
+{
+	frr_heartbeat_begin(hb);
+	hb->call_us = start->tv_sec * 1000000ULL + start->tv_usec;
+	strlcpy(hb->funcname, thread->funcname, sizeof(hb->funcname));
+	strlcpy(hb->schedfrom, thread->schedfrom, sizeof(hb->schedfrom));
+	hb->schedfrom_line = thread->schedfrom_line;
+	frr_heartbeat_end(hb);
+}
+
+void frr_heartbeat_leave(struct frr_heartbeat *hb, const struct timeval *end)
+{
+	frr_heartbeat_begin(hb);
+	hb->loop_us = end->tv_sec * 1000000ULL + end->tv_usec;
+	hb->call_us = 0;
+	hb->calls++;
+	frr_heartbeat_end(hb);
+}
+
+int frr_heartbeat_start(struct thread_master *m, const char *path)
+{
+	struct frr_heartbeat *hb;
+	int fd;
+
+	if (m->heartbeat)
+		return 0;
+
+	/* never truncate a file a reader might still have mapped */
+	unlink(path);
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+	if (fd < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL, "%s: cannot open %s: %s",
+			     __func__, path, safe_strerror(errno));
+		return -1;
+	}
+
+	if (ftruncate(fd, sizeof(*hb)) < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL, "%s: cannot size %s: %s",
+			     __func__, path, safe_strerror(errno));
+		close(fd);
+		unlink(path);
+		return -1;
+	}
+
+	hb = mmap(NULL, sizeof(*hb), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hb == MAP_FAILED) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL, "%s: cannot map %s: %s",
+			     __func__, path, safe_strerror(errno));
+		unlink(path);
+		return -1;
+	}
+
+	hb->size = sizeof(*hb);
+	hb->pid = getpid();
+	hb->loop_us = frr_heartbeat_now();
+	/* readers check this last, it makes the page valid */
+	atomic_thread_fence(memory_order_release);
+	hb->magic = FRR_HEARTBEAT_MAGIC;
+
+	strlcpy(heartbeat_path, path, sizeof(heartbeat_path));
+	m->heartbeat = hb;
+	return 0;
+}
+
+void frr_heartbeat_stop(struct thread_master *m)
+{
+	if (!m->heartbeat)
+		return;
+
+	munmap(m->heartbeat, sizeof(*m->heartbeat));
+	m->heartbeat = NULL;
+	unlink(heartbeat_path);
+}
+
+struct frr_heartbeat *frr_heartbeat_map(const char *path)
+{
+	struct frr_heartbeat *hb;
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*hb)) {
+		close(fd);
+		return NULL;
+	}
+
+	hb = mmap(NULL, sizeof(*hb), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hb == MAP_FAILED)
+		return NULL;
+
+	if (hb->magic != FRR_HEARTBEAT_MAGIC || hb->size != sizeof(*hb)) {
+		munmap(hb, sizeof(*hb));
+		return NULL;
+	}
+	return hb;
+}
+
+void frr_heartbeat_unmap(struct frr_heartbeat **hb)
+{
+	if (!*hb)
+		return;
+
+	munmap(*hb, sizeof(**hb));
+	*hb = NULL;
+}
+
+bool frr_heartbeat_snapshot(const struct frr_heartbeat *hb,
+			    struct frr_heartbeat *out)
+{
+	uint32_t seq;
+
+	for (int i = 0; i < HEARTBEAT_SNAPSHOT_TRIES; i++) {
+		seq = atomic_load_explicit(&hb->seq, memory_order_acquire);
+		if (seq & 1)
+			continue;
+
+		memcpy(out, hb, sizeof(*out));
+
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&hb->seq, memory_order_relaxed) == seq)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,94 @@
+/*
+ * Event loop heartbeat, published through shared memory
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_HEARTBEAT_H
+#define _FRR_HEARTBEAT_H
+
+#include "frratomic.h"
+#include "monotime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRR_HEARTBEAT_MAGIC 0x46524842 /* "FRHB" */
+
+/*
+ * A daemon's main thread_master writes this on every callback into a file
+ * next to its vty socket (<vtydir>/<daemon>[-<instance>].hb) that is
+ * mmap()ed shared, so watchfrr can tell "busy" from "hung" - and what it
+ * is stuck in - without a round trip through the vty.
+ *
+ * There is a single writer; readers use frr_heartbeat_snapshot() which
+ * retries until it gets a consistent copy (seq is odd while updating).
+ * Timestamps are CLOCK_MONOTONIC usec, which is the same for all
+ * processes on the system.
+ */
+struct frr_heartbeat {
+	uint32_t magic;
+	uint32_t size;
+	int64_t pid;
+
+	_Atomic uint32_t seq;
+
+	/* last time a callback finished */
+	uint64_t loop_us;
+	/* start of the callback currently running, 0 while idle */
+	uint64_t call_us;
+	/* number of callbacks run */
+	uint64_t calls;
+
+	/* current (or last) callback and where it was scheduled from */
+	char funcname[64];
+	char schedfrom[64];
+	uint32_t schedfrom_line;
+};
+
+static inline uint64_t frr_heartbeat_now(void)
+{
+	struct timeval tv;
+
+	monotime(&tv);
+	return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+struct thread;
+
+/* called by thread_call() around each callback */
+extern void frr_heartbeat_enter(struct frr_heartbeat *hb,
+				const struct thread *thread,
+				const struct timeval *start);
+extern void frr_heartbeat_leave(struct frr_heartbeat *hb,
+				const struct timeval *end);
+
+/* writer side: create/remove the file for a thread_master */
+struct thread_master;
+extern int frr_heartbeat_start(struct thread_master *m, const char *path);
+extern void frr_heartbeat_stop(struct thread_master *m);
+
+/* reader side */
+extern struct frr_heartbeat *frr_heartbeat_map(const char *path);
+extern void frr_heartbeat_unmap(struct frr_heartbeat **hb);
+extern bool frr_heartbeat_snapshot(const struct frr_heartbeat *hb,
+				   struct frr_heartbeat *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_HEARTBEAT_H */
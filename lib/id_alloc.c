@@ -26,6 +26,7 @@
 #include "log.h"
 #include "lib_errors.h"
 #include "memory.h"
+#include "frr_pthread.h"
 
 #include <inttypes.h>
 
@@ -116,19 +117,14 @@ static struct id_alloc_page *find_or_create_page(struct id_alloc *alloc,
 }
 
 /*
- * Return an ID number back to the allocator.
- * While this ID can be re-assigned through idalloc_allocate, the underlying
- * memory will not be freed. If this is the first free ID in the page, the page
- * will be added to the allocator's list of pages with free IDs.
+ * Clear an ID's bit in its page (which the caller looked up.)
  */
-void idalloc_free(struct id_alloc *alloc, uint32_t id)
+static void free_id(struct id_alloc *alloc, struct id_alloc_page *page,
+		    uint32_t id)
 {
-	struct id_alloc_page *page = NULL;
-
 	int word, offset;
 	uint32_t old_word, old_word_mask;
 
-	page = find_or_create_page(alloc, id, 0);
 	if (!page) {
 		flog_err(EC_LIB_ID_CONSISTENCY,
 			"ID Allocator %s cannot free #%u. ID Block does not exist.",
@@ -166,6 +162,39 @@ void idalloc_free(struct id_alloc *alloc, uint32_t id)
 	}
 }
 
+/*
+ * Return an ID number back to the allocator.
+ * While this ID can be re-assigned through idalloc_allocate, the underlying
+ * memory will not be freed. If this is the first free ID in the page, the page
+ * will be added to the allocator's list of pages with free IDs.
+ */
+void idalloc_free(struct id_alloc *alloc, uint32_t id)
+{
+	frr_mutex_lock_autounlock(&alloc->mtx);
+
+	free_id(alloc, find_or_create_page(alloc, id, 0), id);
+}
+
+/*
+ * Return a batch of ID numbers.  The page lookup is skipped for consecutive
+ * IDs that fall into the same page, so sorted batches are cheapest.
+ */
+void idalloc_free_n(struct id_alloc *alloc, const uint32_t *ids, uint32_t n)
+{
+	struct id_alloc_page *page = NULL;
+	uint32_t i;
+
+	frr_mutex_lock_autounlock(&alloc->mtx);
+
+	for (i = 0; i < n; i++) {
+		if (!page
+		    || (ids[i] >> FRR_ID_PAGE_SHIFT)
+			       != (page->base_value >> FRR_ID_PAGE_SHIFT))
+			page = find_or_create_page(alloc, ids[i], 0);
+		free_id(alloc, page, ids[i]);
+	}
+}
+
 /*
  * Add a allocation page to the end of the allocator's current range.
  * Returns null if the allocator has had all possible pages allocated already.
@@ -229,6 +258,8 @@ uint32_t idalloc_allocate(struct id_alloc *alloc)
 	int word, offset;
 	uint32_t return_value;
 
+	frr_mutex_lock_autounlock(&alloc->mtx);
+
 	if (alloc->has_free == NULL)
 		create_next_page(alloc);
 
@@ -262,6 +293,61 @@ uint32_t idalloc_allocate(struct id_alloc *alloc)
 	return return_value;
 }
 
+/*
+ * Reserve up to n ID numbers into ids[], returns how many were allocated
+ * (less than n only if the allocator runs out.)  Free bits are taken a whole
+ * 32 bit word at a time, without going through reserve_bit for each ID.
+ */
+uint32_t idalloc_allocate_n(struct id_alloc *alloc, uint32_t *ids, uint32_t n)
+{
+	struct id_alloc_page *page;
+	uint32_t done = 0, avail, base;
+	int word, offset;
+
+	frr_mutex_lock_autounlock(&alloc->mtx);
+
+	while (done < n) {
+		if (alloc->has_free == NULL)
+			create_next_page(alloc);
+
+		if (alloc->has_free == NULL) {
+			flog_err(EC_LIB_ID_EXHAUST,
+				 "ID Allocator %s has run out of IDs.",
+				 alloc->name);
+			break;
+		}
+
+		page = alloc->has_free;
+		word = FFS32(~(page->full_word_mask)) - 1;
+
+		if (word < 0 || word >= 32) {
+			flog_err(EC_LIB_ID_CONSISTENCY,
+				 "ID Allocator %s internal error. Page starting at %d is inconsistent.",
+				 alloc->name, page->base_value);
+			break;
+		}
+
+		base = page->base_value + word * 32;
+		avail = ~page->allocated_mask[word];
+		while (avail && done < n) {
+			offset = FFS32(avail) - 1;
+			avail &= avail - 1;
+			ids[done++] = base + offset;
+			alloc->allocated += 1;
+		}
+		page->allocated_mask[word] = ~avail;
+
+		if (avail)
+			continue;
+
+		/* whole word taken; the page is first in has_free */
+		page->full_word_mask |= ((uint32_t)1) << word;
+		if (page->full_word_mask == UINT32_MAX)
+			alloc->has_free = page->next_has_free;
+	}
+	return done;
+}
+
 /*
  * Tries to allocate a specific ID from the allocator. Returns IDALLOC_INVALID
  * when the ID being "reserved" has allready been assigned/reserved. This should
@@ -273,6 +359,8 @@ uint32_t idalloc_reserve(struct id_alloc *alloc, uint32_t id)
 	struct id_alloc_page *page;
 	int word, offset;
 
+	frr_mutex_lock_autounlock(&alloc->mtx);
+
 	while (alloc->capacity <= id)
 		create_next_page(alloc);
 
@@ -301,6 +389,7 @@ struct id_alloc *idalloc_new(const char *name)
 
 	ret = XCALLOC(MTYPE_IDALLOC_ALLOCATOR, sizeof(*ret));
 	ret->name = XSTRDUP(MTYPE_IDALLOC_ALLOCATOR_NAME, name);
+	pthread_mutex_init(&ret->mtx, NULL);
 
 	idalloc_reserve(ret, IDALLOC_INVALID);
 
@@ -353,6 +442,7 @@ void idalloc_destroy(struct id_alloc *alloc)
 			break;
 	}
 
+	pthread_mutex_destroy(&alloc->mtx);
 	XFREE(MTYPE_IDALLOC_ALLOCATOR_NAME, alloc->name);
 	XFREE(MTYPE_IDALLOC_ALLOCATOR, alloc);
 }
@@ -405,3 +495,45 @@ uint32_t idalloc_allocate_prefer_pool(struct id_alloc *alloc,
 		return idalloc_allocate(alloc);
 	}
 }
+
+/*
+ * Per-thread cache in front of an allocator.  IDs sitting in a cache count
+ * as allocated; they are moved to and from the allocator in batches of
+ * half the cache, so the allocator's mutex is only taken once per
+ * IDALLOC_CACHE_SIZE / 2 operations.
+ */
+void idalloc_cache_init(struct id_alloc_cache *cache, struct id_alloc *alloc)
+{
+	cache->alloc = alloc;
+	cache->count = 0;
+}
+
+uint32_t idalloc_cache_get(struct id_alloc_cache *cache)
+{
+	if (cache->count == 0) {
+		cache->count = idalloc_allocate_n(cache->alloc, cache->ids,
+						  IDALLOC_CACHE_SIZE / 2);
+		if (cache->count == 0)
+			return IDALLOC_INVALID;
+	}
+	return cache->ids[--cache->count];
+}
+
+void idalloc_cache_put(struct id_alloc_cache *cache, uint32_t id)
+{
+	if (cache->count == IDALLOC_CACHE_SIZE) {
+		cache->count = IDALLOC_CACHE_SIZE / 2;
+		idalloc_free_n(cache->alloc, cache->ids + cache->count,
+			       IDALLOC_CACHE_SIZE - cache->count);
+	}
+	cache->ids[cache->count++] = id;
+}
+
+/*
+ * Return all cached IDs to the allocator, e.g. before the thread exits.
+ */
+void idalloc_cache_drain(struct id_alloc_cache *cache)
+{
+	idalloc_free_n(cache->alloc, cache->ids, cache->count);
+	cache->count = 0;
+}
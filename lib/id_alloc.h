@@ -23,6 +23,7 @@
 #include <strings.h>
 #include <limits.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,6 +74,9 @@ struct id_alloc {
 	char *name;
 
 	uint32_t allocated, capacity;
+
+	/* all idalloc_* calls on this allocator take this */
+	pthread_mutex_t mtx;
 };
 
 struct id_alloc_pool {
@@ -88,9 +92,28 @@ uint32_t idalloc_allocate(struct id_alloc *alloc);
 uint32_t idalloc_allocate_prefer_pool(struct id_alloc *alloc,
 				      struct id_alloc_pool **pool_ptr);
 uint32_t idalloc_reserve(struct id_alloc *alloc, uint32_t id);
+uint32_t idalloc_allocate_n(struct id_alloc *alloc, uint32_t *ids, uint32_t n);
+void idalloc_free_n(struct id_alloc *alloc, const uint32_t *ids, uint32_t n);
 struct id_alloc *idalloc_new(const char *name);
 void idalloc_destroy(struct id_alloc *alloc);
 
+/* Lock-free front end for one thread; each thread allocating from the same
+ * id_alloc at a high rate should have its own.  Must be drained before the
+ * allocator is destroyed.
+ */
+#define IDALLOC_CACHE_SIZE 64
+
+struct id_alloc_cache {
+	struct id_alloc *alloc;
+	uint32_t count;
+	uint32_t ids[IDALLOC_CACHE_SIZE];
+};
+
+void idalloc_cache_init(struct id_alloc_cache *cache, struct id_alloc *alloc);
+uint32_t idalloc_cache_get(struct id_alloc_cache *cache);
+void idalloc_cache_put(struct id_alloc_cache *cache, uint32_t id);
+void idalloc_cache_drain(struct id_alloc_cache *cache);
+
 #ifdef __cplusplus
 }
 #endif
@@ -44,6 +44,7 @@ DEFINE_MTYPE_STATIC(LIB, CONNECTED, "Connected")
 DEFINE_MTYPE_STATIC(LIB, NBR_CONNECTED, "Neighbor Connected")
 DEFINE_MTYPE(LIB, CONNECTED_LABEL, "Connected interface label")
 DEFINE_MTYPE_STATIC(LIB, IF_LINK_PARAMS, "Informational Link Parameters")
+DEFINE_MTYPE_STATIC(LIB, IF_ADDR_INDEX, "Interface address index")
 
 static struct interface *if_lookup_by_ifindex(ifindex_t ifindex,
 					      vrf_id_t vrf_id);
@@ -248,6 +249,7 @@ void if_update_to_new_vrf(struct interface *ifp, vrf_id_t vrf_id)
 
 	ifp->vrf_id = vrf_id;
 	vrf = vrf_get(ifp->vrf_id, NULL);
+	if_addr_index_invalidate();
 
 	if (ifp->name[0] != '\0')
 		IFNAME_RB_INSERT(vrf, ifp);
@@ -313,6 +315,7 @@ void if_delete(struct interface **ifp)
 	if_delete_retain(ptr);
 
 	list_delete(&ptr->connected);
+	if_addr_index_invalidate();
 	list_delete(&ptr->nbr_connected);
 
 	if_link_params_free(ptr);
@@ -428,6 +431,172 @@ struct interface *if_lookup_by_index_all_vrf(ifindex_t ifindex)
 	return NULL;
 }
 
+/*
+ * Per-VRF index of connected addresses for the if_lookup_*address()
+ * functions below, which are used in packet receive paths.  Each route
+ * node holds the connected addresses with that key in interface and
+ * connected list order, so the first one is what a walk over all
+ * interfaces would have found first.
+ *
+ * The index is rebuilt on first use after any change of any connected
+ * list (if_addr_index_invalidate() bumps a global generation) rather
+ * than updated in place: connected lists are modified from many places
+ * in zebra and lib, changes are rare compared to lookups, and a rebuild
+ * is a single pass.
+ */
+struct if_addr_entry {
+	struct if_addr_entry *next;
+	struct connected *ifc;
+};
+
+struct if_addr_index {
+	uint32_t gen;
+
+	/* IPv4, IPv6: keyed by host address, for exact address lookups */
+	struct route_table *host[2];
+	/* IPv4, IPv6: keyed by address and prefix length */
+	struct route_table *net[2];
+	/* IPv4: keyed by connected prefix (peer for p2p), longest match */
+	struct route_table *conn;
+};
+
+static uint32_t if_addr_gen = 1;
+
+void if_addr_index_invalidate(void)
+{
+	if_addr_gen++;
+}
+
+static int if_addr_index_afi(int family)
+{
+	switch (family) {
+	case AF_INET:
+		return 0;
+	case AF_INET6:
+		return 1;
+	}
+	return -1;
+}
+
+static void if_addr_index_table_free(struct route_table *table)
+{
+	struct route_node *rn;
+	struct if_addr_entry *entry;
+
+	if (!table)
+		return;
+
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		while ((entry = rn->info)) {
+			rn->info = entry->next;
+			XFREE(MTYPE_IF_ADDR_INDEX, entry);
+		}
+	route_table_finish(table);
+}
+
+static void if_addr_index_free(struct vrf *vrf)
+{
+	struct if_addr_index *idx = vrf->if_addr_index;
+
+	if (!idx)
+		return;
+
+	for (int i = 0; i < 2; i++) {
+		if_addr_index_table_free(idx->host[i]);
+		if_addr_index_table_free(idx->net[i]);
+	}
+	if_addr_index_table_free(idx->conn);
+
+	XFREE(MTYPE_IF_ADDR_INDEX, vrf->if_addr_index);
+}
+
+static void if_addr_index_add(struct route_table *table, const struct prefix *p,
+			      struct connected *ifc)
+{
+	struct route_node *rn;
+	struct if_addr_entry *entry, **tail;
+
+	rn = route_node_get(table, p);
+	if (rn->info)
+		route_unlock_node(rn);
+
+	for (tail = (struct if_addr_entry **)&rn->info; *tail;
+	     tail = &(*tail)->next)
+		;
+
+	entry = XCALLOC(MTYPE_IF_ADDR_INDEX, sizeof(*entry));
+	entry->ifc = ifc;
+	*tail = entry;
+}
+
+static struct if_addr_index *if_addr_index_get(struct vrf *vrf)
+{
+	struct if_addr_index *idx;
+	struct interface *ifp;
+	struct listnode *cnode;
+	struct connected *c;
+	struct prefix host;
+	int i;
+
+	if (!vrf)
+		return NULL;
+
+	idx = vrf->if_addr_index;
+	if (idx && idx->gen == if_addr_gen)
+		return idx;
+
+	if_addr_index_free(vrf);
+
+	idx = XCALLOC(MTYPE_IF_ADDR_INDEX, sizeof(*idx));
+	idx->gen = if_addr_gen;
+	for (i = 0; i < 2; i++) {
+		idx->host[i] = route_table_init();
+		idx->net[i] = route_table_init();
+	}
+	idx->conn = route_table_init();
+
+	FOR_ALL_INTERFACES (vrf, ifp) {
+		for (ALL_LIST_ELEMENTS_RO(ifp->connected, cnode, c)) {
+			if (!c->address)
+				continue;
+
+			i = if_addr_index_afi(c->address->family);
+			if (i < 0)
+				continue;
+
+			prefix_copy(&host, c->address);
+			host.prefixlen = prefix_blen(&host) * 8;
+			if_addr_index_add(idx->host[i], &host, c);
+			if_addr_index_add(idx->net[i], c->address, c);
+
+			/* a /0 never wins in if_lookup_address() */
+			if (c->address->family == AF_INET
+			    && CONNECTED_PREFIX(c)->family == AF_INET
+			    && CONNECTED_PREFIX(c)->prefixlen)
+				if_addr_index_add(idx->conn,
+						  CONNECTED_PREFIX(c), c);
+		}
+	}
+
+	vrf->if_addr_index = idx;
+	return idx;
+}
+
+static struct connected *if_addr_index_lookup(struct route_table *table,
+					      const struct prefix *p)
+{
+	struct route_node *rn;
+	struct if_addr_entry *entry;
+
+	rn = route_node_lookup(table, p);
+	if (!rn)
+		return NULL;
+
+	entry = rn->info;
+	route_unlock_node(rn);
+	return entry->ifc;
+}
+
 /* Lookup interface by IP address. */
 struct interface *if_lookup_exact_address(const void *src, int family,
 					  vrf_id_t vrf_id)
@@ -437,6 +606,24 @@ struct interface *if_lookup_exact_address(const void *src, int family,
 	struct interface *ifp;
 	struct prefix *p;
 	struct connected *c;
+	struct if_addr_index *idx;
+	struct prefix host = {};
+
+	idx = if_addr_index_get(vrf);
+	if (idx && (family == AF_INET || family == AF_INET6)) {
+		host.family = family;
+		if (family == AF_INET) {
+			host.prefixlen = IPV4_MAX_BITLEN;
+			host.u.prefix4 = *(const struct in_addr *)src;
+		} else {
+			host.prefixlen = IPV6_MAX_BITLEN;
+			host.u.prefix6 = *(const struct in6_addr *)src;
+		}
+
+		c = if_addr_index_lookup(idx->host[if_addr_index_afi(family)],
+					 &host);
+		return c ? c->ifp : NULL;
+	}
 
 	FOR_ALL_INTERFACES (vrf, ifp) {
 		for (ALL_LIST_ELEMENTS_RO(ifp->connected, cnode, c)) {
@@ -471,6 +658,8 @@ struct connected *if_lookup_address(const void *matchaddr, int family,
 	struct interface *ifp;
 	struct connected *c;
 	struct connected *match;
+	struct if_addr_index *idx;
+	struct route_node *rn;
 
 	if (family == AF_INET) {
 		addr.family = AF_INET;
@@ -484,6 +673,16 @@ struct connected *if_lookup_address(const void *matchaddr, int family,
 
 	match = NULL;
 
+	idx = if_addr_index_get(vrf);
+	if (idx && family == AF_INET) {
+		rn = route_node_match(idx->conn, &addr);
+		if (rn) {
+			match = ((struct if_addr_entry *)rn->info)->ifc;
+			route_unlock_node(rn);
+		}
+		return match;
+	}
+
 	FOR_ALL_INTERFACES (vrf, ifp) {
 		for (ALL_LIST_ELEMENTS_RO(ifp->connected, cnode, c)) {
 			if (c->address && (c->address->family == AF_INET)
@@ -504,6 +703,15 @@ struct interface *if_lookup_prefix(const struct prefix *prefix, vrf_id_t vrf_id)
 	struct listnode *cnode;
 	struct interface *ifp;
 	struct connected *c;
+	struct if_addr_index *idx;
+	int i;
+
+	idx = if_addr_index_get(vrf);
+	i = if_addr_index_afi(prefix->family);
+	if (idx && i >= 0) {
+		c = if_addr_index_lookup(idx->net[i], prefix);
+		return c ? c->ifp : NULL;
+	}
 
 	FOR_ALL_INTERFACES (vrf, ifp) {
 		for (ALL_LIST_ELEMENTS_RO(ifp->connected, cnode, c)) {
@@ -883,6 +1091,8 @@ void connected_free(struct connected **connected)
 {
 	struct connected *ptr = *connected;
 
+	if_addr_index_invalidate();
+
 	prefix_free(&ptr->address);
 	prefix_free(&ptr->destination);
 
@@ -1018,6 +1228,7 @@ struct connected *connected_delete_by_prefix(struct interface *ifp,
 
 		if (connected_same_prefix(ifc->address, p)) {
 			listnode_delete(ifp->connected, ifc);
+			if_addr_index_invalidate();
 			return ifc;
 		}
 	}
@@ -1067,6 +1278,7 @@ struct connected *connected_add_by_prefix(struct interface *ifp,
 
 	/* Add connected address to the interface. */
 	listnode_add(ifp->connected, ifc);
+	if_addr_index_invalidate();
 	return ifc;
 }
 
@@ -1174,6 +1386,8 @@ void if_terminate(struct vrf *vrf)
 		}
 		if_delete(&ifp);
 	}
+
+	if_addr_index_free(vrf);
 }
 
 const char *if_link_type_str(enum zebra_link_type llt)
@@ -520,6 +520,10 @@ extern struct connected *if_lookup_address(const void *matchaddr, int family,
 					   vrf_id_t vrf_id);
 extern struct interface *if_lookup_prefix(const struct prefix *prefix,
 					  vrf_id_t vrf_id);
+/* must be called whenever an address is added to or removed from any
+ * interface's connected list, or an interface changes VRF
+ */
+extern void if_addr_index_invalidate(void);
 size_t if_lookup_by_hwaddr(const uint8_t *hw_addr, size_t addrsz,
 			   struct interface ***result, vrf_id_t vrf_id);
 
@@ -84,3 +84,109 @@ void json_object_free(struct json_object *obj)
 {
 	json_object_put(obj);
 }
+
+/* flush the vty this often */
+#define JSON_STREAM_FLUSH 65536
+
+static void json_stream_put(struct json_stream *js, const char *s)
+{
+	js->unflushed += vty_out(js->vty, "%s", s);
+	if (js->unflushed >= JSON_STREAM_FLUSH) {
+		if (vty_out_flush(js->vty))
+			js->blocked = true;
+		js->unflushed = 0;
+	}
+}
+
+static void json_stream_quote(struct json_stream *js, const char *s)
+{
+	char buf[256];
+	size_t pos = 0;
+
+	buf[pos++] = '"';
+	for (; *s; s++) {
+		unsigned char c = *s;
+
+		/* room for the longest escape plus the closing quote */
+		if (pos > sizeof(buf) - 8) {
+			buf[pos] = '\0';
+			json_stream_put(js, buf);
+			pos = 0;
+		}
+
+		switch (c) {
+		case '"':
+		case '\\':
+			buf[pos++] = '\\';
+			buf[pos++] = c;
+			break;
+		case '\n':
+			buf[pos++] = '\\';
+			buf[pos++] = 'n';
+			break;
+		case '\t':
+			buf[pos++] = '\\';
+			buf[pos++] = 't';
+			break;
+		default:
+			if (c < 0x20)
+				pos += snprintf(buf + pos, sizeof(buf) - pos,
+						"\\u%04x", c);
+			else
+				buf[pos++] = c;
+			break;
+		}
+	}
+	buf[pos++] = '"';
+	buf[pos] = '\0';
+	json_stream_put(js, buf);
+}
+
+/* comma and key for a new member of the current level */
+static void json_stream_member(struct json_stream *js, const char *key)
+{
+	uint32_t bit = 1U << js->depth;
+
+	if (js->nonempty & bit)
+		json_stream_put(js, ",");
+	js->nonempty |= bit;
+
+	if (key) {
+		json_stream_quote(js, key);
+		json_stream_put(js, ":");
+	}
+}
+
+void json_stream_init(struct json_stream *js, struct vty *vty)
+{
+	memset(js, 0, sizeof(*js));
+	js->vty = vty;
+}
+
+void json_stream_object_open(struct json_stream *js, const char *key)
+{
+	assert(js->depth + 1 < JSON_STREAM_MAXDEPTH);
+
+	json_stream_member(js, key);
+	json_stream_put(js, "{");
+	js->depth++;
+	js->nonempty &= ~(1U << js->depth);
+}
+
+void json_stream_object_add(struct json_stream *js, const char *key,
+			    struct json_object *obj)
+{
+	json_stream_member(js, key);
+	json_stream_put(js, json_object_to_json_string_ext(
+				    obj, JSON_C_TO_STRING_PRETTY));
+	json_object_free(obj);
+}
+
+void json_stream_finish(struct json_stream *js)
+{
+	for (; js->depth; js->depth--)
+		json_stream_put(js, "}");
+	json_stream_put(js, "\n");
+	vty_out_flush(js->vty);
+	js->unflushed = 0;
+}
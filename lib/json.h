@@ -59,6 +59,40 @@ extern struct json_object *json_object_lock(struct json_object *obj);
 extern void json_object_free(struct json_object *obj);
 extern void json_array_string_add(json_object *json, const char *str);
 
+/*
+ * Streaming JSON output, for show commands whose output is too large to
+ * build as one json-c tree.  Members go straight to the vty as they are
+ * added and the vty is flushed every so often, so memory use depends on
+ * the largest single member, not on the whole output.
+ *
+ * Flushing doesn't wait for the client.  Once it couldn't write everything,
+ * "blocked" is set and a command that can continue later should yield with
+ * vty_yield(), keeping the stream for when it resumes.  A stream can also
+ * be used for the members of an object the caller opened itself.
+ */
+#define JSON_STREAM_MAXDEPTH 32
+
+struct json_stream {
+	struct vty *vty;
+	unsigned int depth;
+	/* bit n: level n already has a member, the next needs a comma */
+	uint32_t nonempty;
+	/* bytes written since the last vty_out_flush() */
+	size_t unflushed;
+	/* the client is behind, see vty_out_flush() */
+	bool blocked;
+};
+
+extern void json_stream_init(struct json_stream *js, struct vty *vty);
+extern void json_stream_object_open(struct json_stream *js, const char *key);
+/* Print a json-c (sub)tree and free it, like json_object_object_add()
+ * this takes ownership of obj.
+ */
+extern void json_stream_object_add(struct json_stream *js, const char *key,
+				   struct json_object *obj);
+/* Close whatever is still open, end the line and flush. */
+extern void json_stream_finish(struct json_stream *js);
+
 #define JSON_STR "JavaScript Object Notation\n"
 
 /* NOTE: json-c lib has following commit 316da85 which
@@ -0,0 +1,115 @@
+/*
+ * Latency histograms
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "latency.h"
+#include "vty.h"
+#include "json.h"
+
+static unsigned int latency_bucket(uint64_t usec)
+{
+	unsigned int bucket;
+
+	if (!usec)
+		return 0;
+	bucket = sizeof(unsigned long long) * 8 - __builtin_clzll(usec);
+	return MIN(bucket, LATENCY_BUCKETS - 1);
+}
+
+void latency_hist_add(struct latency_hist *hist, int64_t usec)
+{
+	size_t max;
+
+	if (usec < 0)
+		usec = 0;
+
+	atomic_fetch_add_explicit(&hist->bucket[latency_bucket(usec)], 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+
+	max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+	while ((size_t)usec > max
+	       && !atomic_compare_exchange_weak_explicit(
+		       &hist->max, &max, (size_t)usec, memory_order_relaxed,
+		       memory_order_relaxed))
+		;
+}
+
+void latency_hist_reset(struct latency_hist *hist)
+{
+	for (unsigned int i = 0; i < LATENCY_BUCKETS; i++)
+		atomic_store_explicit(&hist->bucket[i], 0,
+				      memory_order_relaxed);
+	atomic_store_explicit(&hist->count, 0, memory_order_relaxed);
+	atomic_store_explicit(&hist->max, 0, memory_order_relaxed);
+}
+
+uint64_t latency_hist_percentile(struct latency_hist *hist, unsigned int pct)
+{
+	uint64_t count, target, seen = 0, max;
+
+	count = atomic_load_explicit(&hist->count, memory_order_relaxed);
+	max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+	if (!count)
+		return 0;
+
+	target = (count * pct + 99) / 100;
+	for (unsigned int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		seen += atomic_load_explicit(&hist->bucket[i],
+					     memory_order_relaxed);
+		/* report the bucket's upper bound */
+		if (seen >= target)
+			return MIN(1ULL << i, max);
+	}
+	return max;
+}
+
+void latency_hist_show_header(struct vty *vty, const char *title)
+{
+	vty_out(vty, "%-24s %10s %10s %10s %10s %10s\n", title, "Count",
+		"p50(us)", "p90(us)", "p99(us)", "Max(us)");
+}
+
+void latency_hist_show(struct vty *vty, const char *label,
+		       struct latency_hist *hist)
+{
+	vty_out(vty, "%-24s %10zu %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+		     " %10zu\n",
+		label, atomic_load_explicit(&hist->count, memory_order_relaxed),
+		latency_hist_percentile(hist, 50),
+		latency_hist_percentile(hist, 90),
+		latency_hist_percentile(hist, 99),
+		atomic_load_explicit(&hist->max, memory_order_relaxed));
+}
+
+struct json_object *latency_hist_json(struct latency_hist *hist)
+{
+	struct json_object *json = json_object_new_object();
+
+	json_object_int_add(json, "count",
+			    atomic_load_explicit(&hist->count,
+						 memory_order_relaxed));
+	json_object_int_add(json, "p50Usec", latency_hist_percentile(hist, 50));
+	json_object_int_add(json, "p90Usec", latency_hist_percentile(hist, 90));
+	json_object_int_add(json, "p99Usec", latency_hist_percentile(hist, 99));
+	json_object_int_add(json, "maxUsec",
+			    atomic_load_explicit(&hist->max,
+						 memory_order_relaxed));
+	return json;
+}
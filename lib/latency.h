@@ -0,0 +1,73 @@
+/*
+ * Latency histograms
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_LATENCY_H
+#define _FRR_LATENCY_H
+
+#include "frratomic.h"
+#include "monotime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct vty;
+struct json_object;
+
+/* log2 buckets, in usec: [0] is < 1us, [n] is [2^(n-1), 2^n), the last
+ * one collects everything longer (about 1 hour and up).
+ */
+#define LATENCY_BUCKETS 33
+
+/*
+ * A histogram of latencies.  Zero-initialized is empty; samples may be
+ * added from any pthread.  Percentiles are estimated from the buckets and
+ * thus accurate to a factor of 2.
+ */
+struct latency_hist {
+	atomic_size_t count;
+	atomic_size_t max;
+	atomic_size_t bucket[LATENCY_BUCKETS];
+};
+
+extern void latency_hist_add(struct latency_hist *hist, int64_t usec);
+extern void latency_hist_reset(struct latency_hist *hist);
+
+/* Estimated pct-th percentile in usec, 0 if the histogram is empty */
+extern uint64_t latency_hist_percentile(struct latency_hist *hist,
+					unsigned int pct);
+
+/* Add the time elapsed since start, if start is set */
+static inline void latency_hist_add_since(struct latency_hist *hist,
+					  const struct timeval *start)
+{
+	if (timerisset(start))
+		latency_hist_add(hist, monotime_since(start, NULL));
+}
+
+/* A table row with the sample count, p50/p90/p99 and max */
+extern void latency_hist_show_header(struct vty *vty, const char *title);
+extern void latency_hist_show(struct vty *vty, const char *label,
+			      struct latency_hist *hist);
+extern struct json_object *latency_hist_json(struct latency_hist *hist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_LATENCY_H */
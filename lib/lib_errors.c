@@ -164,6 +164,12 @@ static struct log_ref ferr_lib_warn[] = {
 		.description = "The northbound subsystem failed to record a configuration transaction in the northbound database",
 		.suggestion = "Gather log data and open an Issue",
 	},
+	{
+		.code = EC_LIB_NB_SNAPSHOT,
+		.title = "Configuration snapshot unusable",
+		.description = "The configuration snapshot saved along with the configuration file could not be written or loaded, so the text configuration is used instead",
+		.suggestion = "This only affects startup time. Saving the configuration again rewrites the snapshot; if the problem persists, gather log data and open an Issue",
+	},
 	{
 		.code = END_FERR,
 	},
@@ -85,6 +85,7 @@ enum lib_log_refs {
 	EC_LIB_ID_CONSISTENCY,
 	EC_LIB_ID_EXHAUST,
 	EC_LIB_RESOLVER,
+	EC_LIB_NB_SNAPSHOT,
 };
 
 extern void lib_error_init(void);
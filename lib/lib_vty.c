@@ -36,7 +36,10 @@
 #include "memory.h"
 #include "module.h"
 #include "defaults.h"
+#include "libfrr.h"
 #include "lib_vty.h"
+#include "pcounter.h"
+#include "json.h"
 
 /* Looking up memory status from vty interface. */
 #include "vector.h"
@@ -120,6 +123,26 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 	return 0;
 }
 
+static int qmem_slab_walker(void *arg, struct memgroup *mg, struct memtype *mt)
+{
+	struct vty *vty = arg;
+	struct qmem_slab_stats st;
+	size_t n_alloc;
+	char buf[MTYPE_MEMSTR_LEN];
+
+	if (!mt || !qmem_slab_stats(mt, &st))
+		return 0;
+
+	/* n_alloc is updated without the slab lock, clamp */
+	n_alloc = MIN(mt->n_alloc, st.handed);
+
+	vty_out(vty, "%-30s: %6zu %6zu %10s %9zu %9zu %7zu %5zu%%\n",
+		mt->name, st.objsize, st.chunks,
+		mtype_memstr(buf, sizeof(buf), st.bytes),
+		st.capacity, n_alloc, st.handed - n_alloc,
+		st.capacity ? n_alloc * 100 / st.capacity : 0);
+	return 0;
+}
 
 DEFUN_NOSH (show_memory,
 	    show_memory_cmd,
@@ -132,6 +155,11 @@ DEFUN_NOSH (show_memory,
 #endif /* HAVE_MALLINFO */
 
 	qmem_walk(qmem_walker, vty);
+
+	vty_out(vty, "--- qmem slabs ---\n");
+	vty_out(vty, "%-30s: %6s %6s %10s %9s %9s %7s %6s\n", "Type", "Size",
+		"Chunks", "Memory", "Capacity", "Used", "Cached", "Occup.");
+	qmem_walk(qmem_slab_walker, vty);
 	return CMD_SUCCESS;
 }
 
@@ -178,6 +206,28 @@ DEFUN_NOSH (show_modules,
 	return CMD_SUCCESS;
 }
 
+DEFUN_NOSH (show_startup_timings,
+	    show_startup_timings_cmd,
+	    "show startup timings",
+	    SHOW_STR
+	    "Daemon startup\n"
+	    "Time at which each startup phase was reached\n")
+{
+	frr_startup_show(vty);
+	return CMD_SUCCESS;
+}
+
+DEFUN_NOSH (show_counters,
+	    show_counters_cmd,
+	    "show counters [json]",
+	    SHOW_STR
+	    "Event counters\n"
+	    JSON_STR)
+{
+	pcounter_show(vty, use_json(argc, argv));
+	return CMD_SUCCESS;
+}
+
 DEFUN (frr_defaults,
        frr_defaults_cmd,
        "frr defaults PROFILE...",
@@ -248,6 +298,7 @@ DEFUN_HIDDEN (end_config,
 			    sizeof(readin_time_str));
 
 	zlog_info("Configuration Read in Took: %s", readin_time_str);
+	frr_startup_phase("configuration applied");
 
 	if (callback.end_config)
 		(*callback.end_config)();
@@ -285,6 +336,8 @@ void lib_cmd_init(void)
 
 	install_element(VIEW_NODE, &show_memory_cmd);
 	install_element(VIEW_NODE, &show_modules_cmd);
+	install_element(VIEW_NODE, &show_startup_timings_cmd);
+	install_element(VIEW_NODE, &show_counters_cmd);
 
 	install_element(CONFIG_NODE, &start_config_cmd);
 	install_element(CONFIG_NODE, &end_config_cmd);
@@ -43,6 +43,8 @@
 #include "frrcu.h"
 #include "frr_pthread.h"
 #include "defaults.h"
+#include "monotime.h"
+#include "heartbeat.h"
 
 DEFINE_HOOK(frr_late_init, (struct thread_master * tm), (tm))
 DEFINE_HOOK(frr_very_late_init, (struct thread_master * tm), (tm))
@@ -60,6 +62,7 @@ char frr_protoname[256] = "NONE";
 char frr_protonameinst[256] = "NONE";
 
 char config_default[512];
+char snapshot_default[512];
 char frr_zclientpath[256];
 static char pidfile_default[1024];
 #ifdef HAVE_SQLITE3
@@ -100,6 +103,7 @@ static void opt_extend(const struct optspec *os)
 #define OPTION_DB_FILE   1006
 #define OPTION_LOGGING   1007
 #define OPTION_LIMIT_FDS 1008
+#define OPTION_IO_BACKEND 1009
 
 static const struct option lo_always[] = {
 	{"help", no_argument, NULL, 'h'},
@@ -115,6 +119,7 @@ static const struct option lo_always[] = {
 	{"tcli", no_argument, NULL, OPTION_TCLI},
 	{"command-log-always", no_argument, NULL, OPTION_LOGGING},
 	{"limit-fds", required_argument, NULL, OPTION_LIMIT_FDS},
+	{"io-backend", required_argument, NULL, OPTION_IO_BACKEND},
 	{NULL}};
 static const struct optspec os_always = {
 	"hvdM:F:N:",
@@ -129,7 +134,8 @@ static const struct optspec os_always = {
 	"      --log          Set Logging to stdout, syslog, or file:<name>\n"
 	"      --log-level    Set Logging Level to use, debug, info, warn, etc\n"
 	"      --tcli         Use transaction-based CLI\n"
-	"      --limit-fds    Limit number of fds supported\n",
+	"      --limit-fds    Limit number of fds supported\n"
+	"      --io-backend   I/O readiness backend (poll, epoll, kqueue)\n",
 	lo_always};
 
 
@@ -298,8 +304,58 @@ void frr_init_vtydir(void)
 	snprintf(frr_vtydir, sizeof(frr_vtydir), DAEMON_VTY_DIR, "", "");
 }
 
+#define FRR_STARTUP_PHASES 32
+
+static struct timeval startup_time;
+static struct startup_phase {
+	const char *name;
+	int64_t usec;
+} startup_phases[FRR_STARTUP_PHASES];
+static unsigned int startup_phase_count;
+
+void frr_startup_phase(const char *name)
+{
+	struct startup_phase *phase;
+
+	/* The first phase is the reference, logging isn't set up yet */
+	if (!timerisset(&startup_time)) {
+		monotime(&startup_time);
+		startup_phases[startup_phase_count++].name = name;
+		return;
+	}
+
+	for (unsigned int i = 0; i < startup_phase_count; i++)
+		if (strmatch(startup_phases[i].name, name))
+			return;
+	if (startup_phase_count == FRR_STARTUP_PHASES)
+		return;
+
+	phase = &startup_phases[startup_phase_count++];
+	phase->name = name;
+	phase->usec = monotime_since(&startup_time, NULL);
+
+	zlog_info("startup: %s after %" PRId64 " ms", name,
+		  phase->usec / 1000);
+}
+
+void frr_startup_show(struct vty *vty)
+{
+	int64_t prev = 0;
+
+	vty_out(vty, "%-32s %10s %10s\n", "Phase", "Since (ms)", "Took (ms)");
+	for (unsigned int i = 0; i < startup_phase_count; i++) {
+		const struct startup_phase *phase = &startup_phases[i];
+
+		vty_out(vty, "%-32s %10.1f %10.1f\n", phase->name,
+			phase->usec / 1000.0, (phase->usec - prev) / 1000.0);
+		prev = phase->usec;
+	}
+}
+
 void frr_preinit(struct frr_daemon_info *daemon, int argc, char **argv)
 {
+	frr_startup_phase("start");
+
 	di = daemon;
 
 	/* basename(), opencoded. */
@@ -558,6 +614,14 @@ static int frr_opt(int opt)
 	case OPTION_LIMIT_FDS:
 		di->limit_fds = strtoul(optarg, &err, 0);
 		break;
+	case OPTION_IO_BACKEND:
+		if (thread_io_backend_set(optarg)) {
+			fprintf(stderr,
+				"I/O backend \"%s\" is not available on this system\n",
+				optarg);
+			errors++;
+		}
+		break;
 	default:
 		return 1;
 	}
@@ -654,6 +718,8 @@ struct thread_master *frr_init(void)
 
 	snprintf(config_default, sizeof(config_default), "%s%s%s%s.conf",
 		 frr_sysconfdir, p_pathspace, di->name, p_instance);
+	snprintf(snapshot_default, sizeof(snapshot_default), "%s%s%s%s.snap",
+		 frr_sysconfdir, p_pathspace, di->name, p_instance);
 	snprintf(pidfile_default, sizeof(pidfile_default), "%s/%s%s.pid",
 		 frr_vtydir, di->name, p_instance);
 #ifdef HAVE_SQLITE3
@@ -717,6 +783,7 @@ struct thread_master *frr_init(void)
 	lib_cmd_init();
 
 	frr_pthread_init();
+	frr_pthread_cmd_init();
 
 	log_ref_init();
 	log_ref_vty_init();
@@ -732,6 +799,7 @@ struct thread_master *frr_init(void)
 			  "%s: failed to initialize northbound database",
 			  __func__);
 
+	frr_startup_phase("library init");
 	return master;
 }
 
@@ -925,6 +993,7 @@ static int frr_config_read_in(struct thread *t)
 				__func__, nb_err_name(ret), errmsg);
 	}
 
+	frr_startup_phase("config file read");
 	hook_call(frr_very_late_init, master);
 
 	return 0;
@@ -932,7 +1001,9 @@ static int frr_config_read_in(struct thread *t)
 
 void frr_config_fork(void)
 {
+	frr_startup_phase("daemon init");
 	hook_call(frr_late_init, master);
+	frr_startup_phase("late init");
 
 	if (!(di->flags & FRR_NO_CFG_PID_DRY)) {
 		/* Don't start execution if we are in dry-run mode */
@@ -979,6 +1050,20 @@ static void frr_vty_serv(void)
 	vty_serv_sock(di->vty_addr, di->vty_port, di->vty_path);
 }
 
+/* the heartbeat goes next to the vty socket, where watchfrr looks for it */
+static void frr_heartbeat_serv(struct thread_master *master)
+{
+	char path[sizeof(vtypath_default)];
+	size_t len;
+
+	len = strlen(di->vty_path);
+	if (len < 4 || strcmp(di->vty_path + len - 4, ".vty"))
+		return;
+
+	snprintf(path, sizeof(path), "%.*s.hb", (int)(len - 4), di->vty_path);
+	frr_heartbeat_start(master, path);
+}
+
 static void frr_check_detach(void)
 {
 	if (nodetach_term || nodetach_daemon)
@@ -1069,6 +1154,7 @@ void frr_run(struct thread_master *master)
 	char instanceinfo[64] = "";
 
 	frr_vty_serv();
+	frr_heartbeat_serv(master);
 
 	if (di->instance)
 		snprintf(instanceinfo, sizeof(instanceinfo), "instance %u ",
@@ -1105,6 +1191,8 @@ void frr_run(struct thread_master *master)
 	/* end fixed stderr startup logging */
 	zlog_startup_end();
 
+	frr_startup_phase("event loop");
+
 	struct thread thread;
 	while (thread_fetch(master, &thread))
 		thread_call(&thread);
@@ -1134,6 +1222,7 @@ void frr_fini(void)
 	frr_pthread_finish();
 	zprivs_terminate(di->privs);
 	/* signal_init -> nothing needed */
+	frr_heartbeat_stop(master);
 	thread_master_free(master);
 	master = NULL;
 	zlog_tls_buffer_fini();
@@ -146,6 +146,12 @@ extern void frr_config_fork(void);
 extern void frr_run(struct thread_master *master);
 extern void frr_detach(void);
 
+/* Record the time at which a startup phase was reached, only the first
+ * call for a given name counts.  Shown by "show startup timings".
+ */
+extern void frr_startup_phase(const char *name);
+extern void frr_startup_show(struct vty *vty);
+
 extern bool frr_zclient_addr(struct sockaddr_storage *sa, socklen_t *sa_len,
 			     const char *path);
 
@@ -158,6 +164,7 @@ DECLARE_KOOH(frr_fini, (), ())
 extern void frr_fini(void);
 
 extern char config_default[512];
+extern char snapshot_default[512];
 extern char frr_zclientpath[256];
 extern const char frr_sysconfdir[];
 extern char frr_vtydir[256];
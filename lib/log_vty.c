@@ -194,6 +194,25 @@ DEFUN (show_logging,
 	vty_out(vty, "Record priority: %s\n",
 		(zt_file.record_priority ? "enabled" : "disabled"));
 	vty_out(vty, "Timestamp precision: %d\n", zt_file.ts_subsec);
+
+	vty_out(vty, "Asynchronous logging: ");
+	if (zlog_async_get() == ZLOG_ASYNC_OFF)
+		vty_out(vty, "disabled\n");
+	else {
+		struct zlog_async_stats st;
+
+		zlog_async_stats(&st);
+		vty_out(vty, "enabled, overflow %s\n",
+			zlog_async_get() == ZLOG_ASYNC_DROP ? "drop" : "block");
+		vty_out(vty,
+			"  %" PRIu64 " messages, %" PRIu64 " bytes in %" PRIu64
+			" writes, %" PRIu64 " write errors\n",
+			st.msgs, st.bytes, st.writes, st.errors);
+		vty_out(vty,
+			"  %" PRIu64 " messages dropped, %" PRIu64
+			" times blocked, %zu bytes queued in %zu buffers\n",
+			st.dropped, st.blocked, st.queued, st.buffers);
+	}
 	return CMD_SUCCESS;
 }
 
@@ -532,6 +551,36 @@ DEFUN (no_config_log_timestamp_precision,
 	return CMD_SUCCESS;
 }
 
+DEFPY (config_log_async,
+       config_log_async_cmd,
+       "log asynchronous [overflow <block|drop>$overflow]",
+       "Logging control\n"
+       "Write file and stdout logs from a separate pthread\n"
+       "Behaviour when the log buffer is full\n"
+       "Wait for the log writer (default)\n"
+       "Discard messages and count them\n")
+{
+	if (overflow && !strcmp(overflow, "drop"))
+		zlog_async_set(ZLOG_ASYNC_DROP);
+	else
+		zlog_async_set(ZLOG_ASYNC_BLOCK);
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_config_log_async,
+       no_config_log_async_cmd,
+       "no log asynchronous [overflow <block|drop>]",
+       NO_STR
+       "Logging control\n"
+       "Write file and stdout logs from a separate pthread\n"
+       "Behaviour when the log buffer is full\n"
+       "Wait for the log writer (default)\n"
+       "Discard messages and count them\n")
+{
+	zlog_async_set(ZLOG_ASYNC_OFF);
+	return CMD_SUCCESS;
+}
+
 DEFPY (config_log_filterfile,
        config_log_filterfile_cmd,
        "log filtered-file FILENAME [<emergencies|alerts|critical|errors|warnings|notifications|informational|debugging>$levelarg]",
@@ -699,6 +748,11 @@ void log_config_write(struct vty *vty)
 	if (zt_file.ts_subsec > 0)
 		vty_out(vty, "log timestamp precision %d\n",
 			zt_file.ts_subsec);
+
+	if (zlog_async_get() == ZLOG_ASYNC_BLOCK)
+		vty_out(vty, "log asynchronous\n");
+	else if (zlog_async_get() == ZLOG_ASYNC_DROP)
+		vty_out(vty, "log asynchronous overflow drop\n");
 }
 
 static int log_vty_init(const char *progname, const char *protoname,
@@ -737,6 +791,8 @@ void log_cmd_init(void)
 	install_element(CONFIG_NODE, &no_config_log_record_priority_cmd);
 	install_element(CONFIG_NODE, &config_log_timestamp_precision_cmd);
 	install_element(CONFIG_NODE, &no_config_log_timestamp_precision_cmd);
+	install_element(CONFIG_NODE, &config_log_async_cmd);
+	install_element(CONFIG_NODE, &no_config_log_async_cmd);
 
 	install_element(VIEW_NODE, &show_log_filter_cmd);
 	install_element(CONFIG_NODE, &log_filter_cmd);
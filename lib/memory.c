@@ -17,6 +17,8 @@
 #include <zebra.h>
 
 #include <stdlib.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
 #endif
@@ -37,6 +39,302 @@ struct memgroup **mg_insert = &mg_first;
 DEFINE_MGROUP(LIB, "libfrr")
 DEFINE_MTYPE(LIB, TMP, "Temporary memory")
 
+/* Slab allocator ----------------------------------------------------------
+ *
+ * Each slab MTYPE owns a set of SLAB_CHUNK_SIZE chunks, aligned to their
+ * size so the chunk header of any object is found by masking its address.
+ * Free objects are kept on a per-chunk freelist (protected by the slab
+ * mutex), chunks with free objects are on the slab's "partial" list.
+ *
+ * In front of that, each pthread has a small cache of free objects per slab
+ * which is refilled from / flushed to the chunks in batches.  Objects are
+ * taken from chunks on the partial list first, so a long-running daemon
+ * consolidates onto few chunks and empty chunks can be munmap()ed.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define QMEM_NO_SLAB
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define QMEM_NO_SLAB
+#endif
+#endif
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+#define SLAB_CHUNK_SIZE (64 * 1024)
+#define SLAB_ALIGN 16
+#define SLAB_MAX 32
+/* per-pthread cache size, and how many objects are moved at once */
+#define SLAB_CACHE_MAX 64
+#define SLAB_BATCH 32
+
+struct slab_chunk {
+	struct slab_chunk *next, **prevp;
+	void *free;
+	/* objects not on this chunk's freelist */
+	unsigned int inuse;
+	/* objects [0 .. carved) have been handed out at least once */
+	unsigned int carved;
+};
+
+struct memslab {
+	struct memtype *mt;
+	size_t objsize;
+	unsigned int idx;
+	unsigned int nobj;
+	size_t offset;
+
+	pthread_mutex_t mtx;
+	struct slab_chunk *partial;
+	size_t n_partial;
+	size_t chunks;
+	size_t handed;
+};
+
+struct slab_cache {
+	void *head;
+	unsigned int count;
+};
+
+static struct memslab *slabs[SLAB_MAX];
+static unsigned int slab_count;
+
+static thread_local struct slab_cache slab_caches[SLAB_MAX];
+static thread_local bool slab_tls_active;
+static pthread_key_t slab_tls_key;
+static pthread_once_t slab_tls_once = PTHREAD_ONCE_INIT;
+
+#define SLAB_CHUNK(ptr)                                                        \
+	((struct slab_chunk *)((uintptr_t)(ptr)                                \
+			       & ~(uintptr_t)(SLAB_CHUNK_SIZE - 1)))
+
+static void slab_chunk_link(struct memslab *slab, struct slab_chunk *chunk)
+{
+	chunk->next = slab->partial;
+	if (chunk->next)
+		chunk->next->prevp = &chunk->next;
+	chunk->prevp = &slab->partial;
+	slab->partial = chunk;
+	slab->n_partial++;
+}
+
+static void slab_chunk_unlink(struct memslab *slab, struct slab_chunk *chunk)
+{
+	*chunk->prevp = chunk->next;
+	if (chunk->next)
+		chunk->next->prevp = chunk->prevp;
+	chunk->next = NULL;
+	chunk->prevp = NULL;
+	slab->n_partial--;
+}
+
+static struct slab_chunk *slab_chunk_new(struct memslab *slab)
+{
+	uintptr_t base, aligned;
+	char *p;
+
+	/* mmap() only guarantees page alignment, so map twice the size and
+	 * cut off what's not needed; untouched pages cost no RSS either way
+	 */
+	p = mmap(NULL, 2 * SLAB_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	base = (uintptr_t)p;
+	aligned = (base + SLAB_CHUNK_SIZE - 1)
+		  & ~(uintptr_t)(SLAB_CHUNK_SIZE - 1);
+	if (aligned > base)
+		munmap(p, aligned - base);
+	munmap((char *)aligned + SLAB_CHUNK_SIZE,
+	       base + SLAB_CHUNK_SIZE - aligned);
+
+	slab->chunks++;
+	/* fresh anonymous memory is zeroed */
+	return (struct slab_chunk *)aligned;
+}
+
+static void slab_refill(struct memslab *slab, struct slab_cache *cache)
+{
+	struct slab_chunk *chunk;
+	void *obj;
+
+	pthread_mutex_lock(&slab->mtx);
+	while (cache->count < SLAB_BATCH) {
+		chunk = slab->partial;
+		if (!chunk) {
+			chunk = slab_chunk_new(slab);
+			if (!chunk)
+				break;
+			slab_chunk_link(slab, chunk);
+		}
+
+		if (chunk->free) {
+			obj = chunk->free;
+			chunk->free = *(void **)obj;
+		} else
+			obj = (char *)chunk + slab->offset
+			      + chunk->carved++ * slab->objsize;
+
+		chunk->inuse++;
+		slab->handed++;
+		if (chunk->inuse == slab->nobj)
+			slab_chunk_unlink(slab, chunk);
+
+		*(void **)obj = cache->head;
+		cache->head = obj;
+		cache->count++;
+	}
+	pthread_mutex_unlock(&slab->mtx);
+
+	if (!cache->count)
+		memory_oom(slab->objsize, slab->mt->name);
+}
+
+static void slab_flush(struct memslab *slab, struct slab_cache *cache,
+		       unsigned int count)
+{
+	struct slab_chunk *chunk;
+	void *obj;
+
+	pthread_mutex_lock(&slab->mtx);
+	while (count-- && cache->head) {
+		obj = cache->head;
+		cache->head = *(void **)obj;
+		cache->count--;
+
+		chunk = SLAB_CHUNK(obj);
+		if (chunk->inuse == slab->nobj)
+			slab_chunk_link(slab, chunk);
+
+		*(void **)obj = chunk->free;
+		chunk->free = obj;
+		chunk->inuse--;
+		slab->handed--;
+
+		/* keep one chunk around to avoid mmap() churn */
+		if (chunk->inuse == 0 && slab->n_partial > 1) {
+			slab_chunk_unlink(slab, chunk);
+			munmap(chunk, SLAB_CHUNK_SIZE);
+			slab->chunks--;
+		}
+	}
+	pthread_mutex_unlock(&slab->mtx);
+}
+
+/* return a pthread's cached objects when it exits */
+static void slab_tls_fini(void *arg)
+{
+	struct slab_cache *caches = arg;
+
+	for (unsigned int i = 0; i < slab_count; i++)
+		if (caches[i].count)
+			slab_flush(slabs[i], &caches[i], caches[i].count);
+}
+
+static void slab_tls_key_create(void)
+{
+	pthread_key_create(&slab_tls_key, slab_tls_fini);
+}
+
+static struct slab_cache *slab_cache_get(struct memslab *slab)
+{
+	if (__builtin_expect(!slab_tls_active, 0)) {
+		pthread_once(&slab_tls_once, slab_tls_key_create);
+		pthread_setspecific(slab_tls_key, slab_caches);
+		slab_tls_active = true;
+	}
+	return &slab_caches[slab->idx];
+}
+
+static void *slab_alloc(struct memslab *slab)
+{
+	struct slab_cache *cache = slab_cache_get(slab);
+	void *obj;
+
+	if (!cache->head)
+		slab_refill(slab, cache);
+
+	obj = cache->head;
+	cache->head = *(void **)obj;
+	cache->count--;
+	return obj;
+}
+
+static void slab_free(struct memslab *slab, void *obj)
+{
+	struct slab_cache *cache = slab_cache_get(slab);
+
+	if (cache->count >= SLAB_CACHE_MAX)
+		slab_flush(slab, cache, SLAB_BATCH);
+
+	*(void **)obj = cache->head;
+	cache->head = obj;
+	cache->count++;
+}
+
+void qmem_slab_enable(struct memtype *mt, size_t objsize)
+{
+#ifndef QMEM_NO_SLAB
+	struct memslab *slab;
+
+	assert(!mt->slab && !mt->n_alloc);
+	assert(slab_count < SLAB_MAX);
+
+	if (objsize < sizeof(void *))
+		objsize = sizeof(void *);
+	objsize = (objsize + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+	assert(objsize <= SLAB_CHUNK_SIZE / 8);
+
+	/* not counted in an MTYPE, this is part of the allocator itself */
+	slab = calloc(1, sizeof(*slab));
+	if (!slab)
+		memory_oom(sizeof(*slab), mt->name);
+
+	slab->mt = mt;
+	slab->objsize = objsize;
+	slab->offset = (sizeof(struct slab_chunk) + SLAB_ALIGN - 1)
+		       & ~(size_t)(SLAB_ALIGN - 1);
+	slab->nobj = (SLAB_CHUNK_SIZE - slab->offset) / objsize;
+	pthread_mutex_init(&slab->mtx, NULL);
+
+	slab->idx = slab_count;
+	slabs[slab_count++] = slab;
+	mt->slab = slab;
+#endif
+}
+
+bool qmem_slab_stats(struct memtype *mt, struct qmem_slab_stats *st)
+{
+	struct memslab *slab = mt->slab;
+
+	if (!slab)
+		return false;
+
+	pthread_mutex_lock(&slab->mtx);
+	st->objsize = slab->objsize;
+	st->chunks = slab->chunks;
+	st->bytes = slab->chunks * SLAB_CHUNK_SIZE;
+	st->capacity = slab->chunks * slab->nobj;
+	st->handed = slab->handed;
+	pthread_mutex_unlock(&slab->mtx);
+	return true;
+}
+
+#ifdef HAVE_MALLOC_USABLE_SIZE
+static inline size_t mt_usable_size(struct memtype *mt, void *ptr)
+{
+	if (mt->slab)
+		return mt->slab->objsize;
+	return malloc_usable_size(ptr);
+}
+#endif
+
 static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 {
 	size_t current;
@@ -62,7 +360,7 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 				      memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = mt_usable_size(mt, ptr);
 
 	current = mallocsz + atomic_fetch_add_explicit(&mt->total, mallocsz,
 						       memory_order_relaxed);
@@ -84,7 +382,7 @@ static inline void mt_count_free(struct memtype *mt, void *ptr)
 	atomic_fetch_sub_explicit(&mt->n_alloc, 1, memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = mt_usable_size(mt, ptr);
 
 	atomic_fetch_sub_explicit(&mt->total, mallocsz, memory_order_relaxed);
 #endif
@@ -105,25 +403,53 @@ static inline void *mt_checkalloc(struct memtype *mt, void *ptr, size_t size)
 	return ptr;
 }
 
+static void *mt_slab_alloc(struct memtype *mt, size_t size, bool zero)
+{
+	void *ptr;
+
+	/* slab MTYPEs are fixed-size, anything bigger is a coding error */
+	assert(size <= mt->slab->objsize);
+
+	ptr = slab_alloc(mt->slab);
+	if (zero)
+		memset(ptr, 0, size);
+	return mt_checkalloc(mt, ptr, size);
+}
+
 void *qmalloc(struct memtype *mt, size_t size)
 {
+	if (mt->slab)
+		return mt_slab_alloc(mt, size, false);
 	return mt_checkalloc(mt, malloc(size), size);
 }
 
 void *qcalloc(struct memtype *mt, size_t size)
 {
+	if (mt->slab)
+		return mt_slab_alloc(mt, size, true);
 	return mt_checkalloc(mt, calloc(size, 1), size);
 }
 
 void *qrealloc(struct memtype *mt, void *ptr, size_t size)
 {
+	if (mt->slab && !ptr)
+		return mt_slab_alloc(mt, size, false);
 	if (ptr)
 		mt_count_free(mt, ptr);
+	if (mt->slab) {
+		assert(size <= mt->slab->objsize);
+		return mt_checkalloc(mt, ptr, size);
+	}
 	return mt_checkalloc(mt, ptr ? realloc(ptr, size) : malloc(size), size);
 }
 
 void *qstrdup(struct memtype *mt, const char *str)
 {
+	if (str && mt->slab) {
+		size_t len = strlen(str) + 1;
+
+		return memcpy(mt_slab_alloc(mt, len, false), str, len);
+	}
 	return str ? mt_checkalloc(mt, strdup(str), strlen(str) + 1) : NULL;
 }
 
@@ -131,6 +457,10 @@ void qfree(struct memtype *mt, void *ptr)
 {
 	if (ptr)
 		mt_count_free(mt, ptr);
+	if (ptr && mt->slab) {
+		slab_free(mt->slab, ptr);
+		return;
+	}
 	free(ptr);
 }
 
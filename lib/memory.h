@@ -33,6 +33,8 @@ extern "C" {
 #endif
 
 #define SIZE_VAR ~0UL
+struct memslab;
+
 struct memtype {
 	struct memtype *next, **ref;
 	const char *name;
@@ -43,6 +45,8 @@ struct memtype {
 	atomic_size_t total;
 	atomic_size_t max_size;
 #endif
+	/* non-NULL if served from a slab, see qmem_slab_enable() */
+	struct memslab *slab;
 };
 
 struct memgroup {
@@ -179,6 +183,31 @@ static inline size_t mtype_stats_alloc(struct memtype *mt)
 	return mt->n_alloc;
 }
 
+/* Serve a fixed-size MTYPE from a slab allocator instead of malloc().
+ *
+ * Objects are carved from 64kB chunks that hold only this MTYPE, with a
+ * small per-pthread cache in front so the common alloc/free is lock-free.
+ * Chunks that become entirely free are returned to the system.
+ *
+ * Must be called before the first allocation on the MTYPE, and every
+ * allocation on it must be at most objsize bytes.  A no-op in builds with
+ * AddressSanitizer, which would otherwise miss use-after-free on slab
+ * objects.
+ */
+extern void qmem_slab_enable(struct memtype *mt, size_t objsize);
+
+struct qmem_slab_stats {
+	size_t objsize;
+	size_t chunks;
+	size_t bytes;
+	size_t capacity;
+	/* objects taken from chunks, incl. those sitting in pthread caches */
+	size_t handed;
+};
+
+/* returns false if the MTYPE is not served from a slab */
+extern bool qmem_slab_stats(struct memtype *mt, struct qmem_slab_stats *st);
+
 /* NB: calls are ordered by memgroup; and there is a call with mt == NULL for
  * each memgroup (so that a header can be printed, and empty memgroups show)
  *
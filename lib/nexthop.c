@@ -29,7 +29,7 @@
 #include "prefix.h"
 #include "nexthop.h"
 #include "mpls.h"
-#include "jhash.h"
+#include "fhash.h"
 #include "printfrr.h"
 #include "vrf.h"
 #include "nexthop_group.h"
@@ -228,6 +228,11 @@ bool nexthop_labels_match(const struct nexthop *nh1, const struct nexthop *nh2)
 	return true;
 }
 
+void nexthop_slab_enable(void)
+{
+	qmem_slab_enable(MTYPE_NEXTHOP, sizeof(struct nexthop));
+}
+
 struct nexthop *nexthop_new(void)
 {
 	struct nexthop *nh;
@@ -269,6 +274,69 @@ void nexthops_free(struct nexthop *nexthop)
 	}
 }
 
+static bool _nexthop_g_addr_same(enum nexthop_types_t type,
+				 const union g_addr *addr1,
+				 const union g_addr *addr2)
+{
+	switch (type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		return IPV4_ADDR_SAME(&addr1->ipv4, &addr2->ipv4);
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		return IPV6_ADDR_SAME(&addr1->ipv6, &addr2->ipv6);
+	case NEXTHOP_TYPE_IFINDEX:
+	case NEXTHOP_TYPE_BLACKHOLE:
+		break;
+	}
+	return true;
+}
+
+/*
+ * Same result as _nexthop_cmp_no_labels() == 0, but without working out
+ * the order.  Used for NHG dedup & friends where this is called a lot.
+ */
+static bool _nexthop_same_no_labels(const struct nexthop *nh1,
+				    const struct nexthop *nh2)
+{
+	if (nh1->vrf_id != nh2->vrf_id || nh1->type != nh2->type
+	    || nh1->weight != nh2->weight || nh1->srte_color != nh2->srte_color)
+		return false;
+
+	switch (nh1->type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV6:
+		if (!_nexthop_g_addr_same(nh1->type, &nh1->gate, &nh2->gate))
+			return false;
+		break;
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		if (!_nexthop_g_addr_same(nh1->type, &nh1->gate, &nh2->gate))
+			return false;
+		/* Intentional Fall-Through */
+	case NEXTHOP_TYPE_IFINDEX:
+		if (nh1->ifindex != nh2->ifindex)
+			return false;
+		break;
+	case NEXTHOP_TYPE_BLACKHOLE:
+		if (nh1->bh_type != nh2->bh_type)
+			return false;
+		break;
+	}
+
+	if (!_nexthop_g_addr_same(nh1->type, &nh1->src, &nh2->src))
+		return false;
+
+	if (CHECK_FLAG(nh1->flags, NEXTHOP_FLAG_HAS_BACKUP)
+	    != CHECK_FLAG(nh2->flags, NEXTHOP_FLAG_HAS_BACKUP))
+		return false;
+	if (!CHECK_FLAG(nh1->flags, NEXTHOP_FLAG_HAS_BACKUP))
+		return true;
+
+	return nh1->backup_num == nh2->backup_num
+	       && !memcmp(nh1->backup_idx, nh2->backup_idx, nh1->backup_num);
+}
+
 bool nexthop_same(const struct nexthop *nh1, const struct nexthop *nh2)
 {
 	if (nh1 && !nh2)
@@ -280,7 +348,10 @@ bool nexthop_same(const struct nexthop *nh1, const struct nexthop *nh2)
 	if (nh1 == nh2)
 		return true;
 
-	if (nexthop_cmp(nh1, nh2) != 0)
+	if (!_nexthop_same_no_labels(nh1, nh2))
+		return false;
+
+	if (_nexthop_labels_cmp(nh1, nh2) != 0)
 		return false;
 
 	return true;
@@ -298,7 +369,7 @@ bool nexthop_same_no_labels(const struct nexthop *nh1,
 	if (nh1 == nh2)
 		return true;
 
-	if (_nexthop_cmp_no_labels(nh1, nh2) != 0)
+	if (!_nexthop_same_no_labels(nh1, nh2))
 		return false;
 
 	return true;
@@ -504,71 +575,35 @@ unsigned int nexthop_level(const struct nexthop *nexthop)
 	return rv;
 }
 
-/* Only hash word-sized things, let cmp do the rest. */
-uint32_t nexthop_hash_quick(const struct nexthop *nexthop)
+static void nexthop_hash_quick_add(struct fhash_state *st,
+				   const struct nexthop *nexthop)
 {
-	uint32_t key = 0x45afe398;
-	int i;
-
-	key = jhash_3words(nexthop->type, nexthop->vrf_id,
-			   nexthop->nh_label_type, key);
-
-	if (nexthop->nh_label) {
-		int labels = nexthop->nh_label->num_labels;
-
-		i = 0;
-
-		while (labels >= 3) {
-			key = jhash_3words(nexthop->nh_label->label[i],
-					   nexthop->nh_label->label[i + 1],
-					   nexthop->nh_label->label[i + 2],
-					   key);
-			labels -= 3;
-			i += 3;
-		}
+	fhash_add_u32x2(st, nexthop->type, nexthop->vrf_id);
+	fhash_add_u32(st, nexthop->nh_label_type);
 
-		if (labels >= 2) {
-			key = jhash_2words(nexthop->nh_label->label[i],
-					   nexthop->nh_label->label[i + 1],
-					   key);
-			labels -= 2;
-			i += 2;
-		}
-
-		if (labels >= 1)
-			key = jhash_1word(nexthop->nh_label->label[i], key);
-	}
+	if (nexthop->nh_label)
+		fhash_add(st, nexthop->nh_label->label,
+			  nexthop->nh_label->num_labels
+				  * sizeof(nexthop->nh_label->label[0]));
 
-	key = jhash_2words(nexthop->ifindex,
-			   CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ONLINK),
-			   key);
+	fhash_add_u32x2(st, nexthop->ifindex,
+			CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ONLINK));
 
 	/* Include backup nexthops, if present */
-	if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_HAS_BACKUP)) {
-		int backups = nexthop->backup_num;
-
-		i = 0;
-
-		while (backups >= 3) {
-			key = jhash_3words(nexthop->backup_idx[i],
-					   nexthop->backup_idx[i + 1],
-					   nexthop->backup_idx[i + 2], key);
-			backups -= 3;
-			i += 3;
-		}
-
-		while (backups >= 2) {
-			key = jhash_2words(nexthop->backup_idx[i],
-					   nexthop->backup_idx[i + 1], key);
-			backups -= 2;
-			i += 2;
-		}
+	if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_HAS_BACKUP))
+		fhash_add(st, nexthop->backup_idx,
+			  nexthop->backup_num
+				  * sizeof(nexthop->backup_idx[0]));
+}
 
-		if (backups >= 1)
-			key = jhash_1word(nexthop->backup_idx[i], key);
-	}
+/* Only hash word-sized things, let cmp do the rest. */
+uint32_t nexthop_hash_quick(const struct nexthop *nexthop)
+{
+	struct fhash_state st;
 
-	return key;
+	fhash_init(&st, 0x45afe398);
+	nexthop_hash_quick_add(&st, nexthop);
+	return fhash_final(&st);
 }
 
 
@@ -578,8 +613,11 @@ uint32_t nexthop_hash_quick(const struct nexthop *nexthop)
 uint32_t nexthop_hash(const struct nexthop *nexthop)
 {
 	uint32_t gate_src_rmap_raw[GATE_SIZE * 3] = {};
+	struct fhash_state st;
+
 	/* Get all the quick stuff */
-	uint32_t key = nexthop_hash_quick(nexthop);
+	fhash_init(&st, 0x45afe398);
+	nexthop_hash_quick_add(&st, nexthop);
 
 	assert(((sizeof(nexthop->gate) + sizeof(nexthop->src)
 		 + sizeof(nexthop->rmap_src))
@@ -591,9 +629,9 @@ uint32_t nexthop_hash(const struct nexthop *nexthop)
 	memcpy(gate_src_rmap_raw + (2 * GATE_SIZE), &nexthop->rmap_src,
 	       GATE_SIZE);
 
-	key = jhash2(gate_src_rmap_raw, (GATE_SIZE * 3), key);
+	fhash_add(&st, gate_src_rmap_raw, sizeof(gate_src_rmap_raw));
 
-	return key;
+	return fhash_final(&st);
 }
 
 void nexthop_copy_no_recurse(struct nexthop *copy,
@@ -729,6 +767,9 @@ int nexthop_str2backups(const char *str, int *num_backups,
  *	%pNHs
  *		nexthop2str()
  */
+/* "<IPv6 address> if <ifindex>" always fits */
+#define NEXTHOP_STR_FAST (INET6_ADDRSTRLEN + 4 + 10 + 1)
+
 printfrr_ext_autoreg_p("NH", printfrr_nh)
 static ssize_t printfrr_nh(char *buf, size_t bsz, const char *fmt,
 			   int prec, const void *ptr)
@@ -792,6 +833,35 @@ static ssize_t printfrr_nh(char *buf, size_t bsz, const char *fmt,
 		*fb.pos = '\0';
 		return ret;
 	case 's':
+		if (bsz >= NEXTHOP_STR_FAST
+		    && (nexthop->type == NEXTHOP_TYPE_IPV4
+			|| nexthop->type == NEXTHOP_TYPE_IPV4_IFINDEX
+			|| nexthop->type == NEXTHOP_TYPE_IPV6
+			|| nexthop->type == NEXTHOP_TYPE_IPV6_IFINDEX)) {
+			/* same as nexthop2str(), without another trip
+			 * through printfrr
+			 */
+			char digits[10], *o;
+			ifindex_t ifindex = nexthop->ifindex;
+			int n = 0;
+
+			o = frr_inet_ntop_end(
+				(nexthop->type == NEXTHOP_TYPE_IPV4
+				 || nexthop->type == NEXTHOP_TYPE_IPV4_IFINDEX)
+					? AF_INET
+					: AF_INET6,
+				&nexthop->gate, buf);
+			memcpy(o, " if ", 4);
+			o += 4;
+			do {
+				digits[n++] = '0' + (unsigned int)ifindex % 10;
+				ifindex = (unsigned int)ifindex / 10;
+			} while (ifindex);
+			while (n)
+				*o++ = digits[--n];
+			*o = '\0';
+			return 3;
+		}
 		nexthop2str(nexthop, buf, bsz);
 		return 3;
 	}
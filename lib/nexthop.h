@@ -150,6 +150,8 @@ struct nexthop {
 	} while (0)
 
 struct nexthop *nexthop_new(void);
+/* allocate nexthops from a slab, call before the first nexthop_new() */
+void nexthop_slab_enable(void);
 
 void nexthop_free(struct nexthop *nexthop);
 void nexthops_free(struct nexthop *nexthop);
@@ -26,13 +26,14 @@
 #include <nexthop_group_private.h>
 #include <vty.h>
 #include <command.h>
-#include <jhash.h>
+#include <fhash.h>
 
 #ifndef VTYSH_EXTRACT_PL
 #include "lib/nexthop_group_clippy.c"
 #endif
 
 DEFINE_MTYPE_STATIC(LIB, NEXTHOP_GROUP, "Nexthop Group")
+DEFINE_MTYPE_STATIC(LIB, NEXTHOP_GROUP_FLAT, "Nexthop Group flattened")
 
 /*
  * Internal struct used to hold nhg config strings
@@ -132,6 +133,43 @@ nexthop_group_active_nexthop_num_no_recurse(const struct nexthop_group *nhg)
 	return num;
 }
 
+static bool nexthop_is_active_resolved(const struct nexthop *nh)
+{
+	return !CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE)
+	       && CHECK_FLAG(nh->flags, NEXTHOP_FLAG_ACTIVE);
+}
+
+struct nexthop_group_flat *
+nexthop_group_flatten(const struct nexthop_group *nhg)
+{
+	struct nexthop_group_flat *flat;
+	struct nexthop *nhop;
+	uint8_t num = 0;
+
+	for (ALL_NEXTHOPS_PTR(nhg, nhop)) {
+		if (nexthop_is_active_resolved(nhop) && num < UINT8_MAX)
+			num++;
+	}
+
+	flat = XMALLOC(MTYPE_NEXTHOP_GROUP_FLAT,
+		       sizeof(*flat) + num * sizeof(flat->nexthops[0]));
+	flat->num = 0;
+
+	for (ALL_NEXTHOPS_PTR(nhg, nhop)) {
+		if (flat->num == num)
+			break;
+		if (nexthop_is_active_resolved(nhop))
+			flat->nexthops[flat->num++] = nhop;
+	}
+
+	return flat;
+}
+
+void nexthop_group_flat_free(struct nexthop_group_flat **flat)
+{
+	XFREE(MTYPE_NEXTHOP_GROUP_FLAT, *flat);
+}
+
 struct nexthop *nexthop_exists(const struct nexthop_group *nhg,
 			       const struct nexthop *nh)
 {
@@ -456,7 +494,7 @@ uint32_t nexthop_group_hash_no_recurse(const struct nexthop_group *nhg)
 	 * resolved nexthops
 	 */
 	for (nh = nhg->nexthop; nh; nh = nh->next)
-		key = jhash_1word(nexthop_hash(nh), key);
+		key = fhash_1word(nexthop_hash(nh), key);
 
 	return key;
 }
@@ -467,7 +505,7 @@ uint32_t nexthop_group_hash(const struct nexthop_group *nhg)
 	uint32_t key = 0;
 
 	for (ALL_NEXTHOPS_PTR(nhg, nh))
-		key = jhash_1word(nexthop_hash(nh), key);
+		key = fhash_1word(nexthop_hash(nh), key);
 
 	return key;
 }
@@ -81,6 +81,22 @@ void nexthop_group_add_sorted(struct nexthop_group *nhg,
 	(nhop);								\
 	(nhop) = nexthop_next(nhop)
 
+/*
+ * The active, resolved nexthops of a group (those
+ * nexthop_next_active_resolved() visits) as an array, for callers that
+ * walk the same group over and over.  The entries point into the group,
+ * so the array has to be rebuilt whenever the group or the flags of its
+ * nexthops change.
+ */
+struct nexthop_group_flat {
+	uint8_t num;
+	struct nexthop *nexthops[];
+};
+
+extern struct nexthop_group_flat *
+nexthop_group_flatten(const struct nexthop_group *nhg);
+extern void nexthop_group_flat_free(struct nexthop_group_flat **flat);
+
 
 #define NHGC_NAME_SIZE 80
 
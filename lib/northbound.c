@@ -27,6 +27,9 @@
 #include "debug.h"
 #include "db.h"
 #include "frr_pthread.h"
+#include "frrcu.h"
+#include "frratomic.h"
+#include "monotime.h"
 #include "northbound.h"
 #include "northbound_cli.h"
 #include "northbound_db.h"
@@ -35,10 +38,55 @@
 DEFINE_MTYPE_STATIC(LIB, NB_NODE, "Northbound Node")
 DEFINE_MTYPE_STATIC(LIB, NB_CONFIG, "Northbound Configuration")
 DEFINE_MTYPE_STATIC(LIB, NB_CONFIG_ENTRY, "Northbound Configuration Entry")
+DEFINE_MTYPE_STATIC(LIB, NB_CONFIG_EDIT, "Northbound Configuration Edit")
 
 /* Running configuration - shouldn't be modified directly. */
 struct nb_config *running_config;
 
+/* Bumped whenever the running configuration is replaced or merged into. */
+static uint64_t running_config_gen;
+
+/*
+ * Edit log of a candidate configuration: the data paths edited through
+ * nb_candidate_edit() since the candidate was last identical to the running
+ * configuration, so that nb_config_diff() only needs to look at those.
+ */
+PREDECL_DLIST(nb_config_edit_list)
+PREDECL_HASH(nb_config_edit_hash)
+
+struct nb_config_edit {
+	struct nb_config_edit_list_item list_itm;
+	struct nb_config_edit_hash_item hash_itm;
+
+	/* Allocated by libyang. */
+	char *xpath;
+};
+
+static int nb_config_edit_cmp(const struct nb_config_edit *a,
+			      const struct nb_config_edit *b)
+{
+	return strcmp(a->xpath, b->xpath);
+}
+
+static uint32_t nb_config_edit_hash_key(const struct nb_config_edit *edit)
+{
+	return string_hash_make(edit->xpath);
+}
+
+DECLARE_DLIST(nb_config_edit_list, struct nb_config_edit, list_itm)
+DECLARE_HASH(nb_config_edit_hash, struct nb_config_edit, hash_itm,
+	     nb_config_edit_cmp, nb_config_edit_hash_key)
+
+struct nb_config_edits {
+	/* Running configuration the edits were made on top of. */
+	uint64_t base_gen;
+	uint32_t base_version;
+
+	/* Edits in the order they were made. */
+	struct nb_config_edit_list_head list;
+	struct nb_config_edit_hash_head hash;
+};
+
 /* Hash table of user pointers associated with configuration entries. */
 static struct hash *running_config_entries;
 
@@ -65,6 +113,20 @@ static bool nb_db_enabled;
  */
 static bool transaction_in_progress;
 
+/*
+ * Large configurations (e.g. loaded from a file) generate tens of thousands
+ * of changes; nodes that declare their validate/prepare callbacks as
+ * parallel-safe are then spread over a few short-lived worker pthreads.
+ */
+#define NB_PARALLEL_MAX_WORKERS 16
+#define NB_PARALLEL_MIN_CHANGES 256
+#define NB_PARALLEL_CHUNK 64
+
+static unsigned int nb_parallel_workers;
+
+/* Per-phase commit statistics, only touched from the main pthread. */
+static struct nb_phase_stats nb_phase_stats[NB_PHASE_MAX];
+
 static int nb_callback_pre_validate(struct nb_context *context,
 				    const struct nb_node *nb_node,
 				    const struct lyd_node *dnode, char *errmsg,
@@ -283,6 +345,86 @@ static int nb_node_validate(const struct lys_node *snode, void *arg)
 	return YANG_ITER_CONTINUE;
 }
 
+static void nb_config_edits_clear(struct nb_config_edits *edits)
+{
+	struct nb_config_edit *edit;
+
+	while ((edit = nb_config_edit_list_pop(&edits->list))) {
+		nb_config_edit_hash_del(&edits->hash, edit);
+		free(edit->xpath);
+		XFREE(MTYPE_NB_CONFIG_EDIT, edit);
+	}
+}
+
+static void nb_config_edits_stop(struct nb_config *config)
+{
+	if (!config->edits)
+		return;
+
+	nb_config_edits_clear(config->edits);
+	nb_config_edit_list_fini(&config->edits->list);
+	nb_config_edit_hash_fini(&config->edits->hash);
+	XFREE(MTYPE_NB_CONFIG_EDIT, config->edits);
+}
+
+/* The configuration was just made identical to the running configuration. */
+static void nb_config_edits_start(struct nb_config *config)
+{
+	if (config == running_config)
+		return;
+
+	if (config->edits)
+		nb_config_edits_clear(config->edits);
+	else {
+		config->edits =
+			XCALLOC(MTYPE_NB_CONFIG_EDIT, sizeof(*config->edits));
+		nb_config_edit_list_init(&config->edits->list);
+		nb_config_edit_hash_init(&config->edits->hash);
+	}
+	config->edits->base_gen = running_config_gen;
+	config->edits->base_version = running_config->version;
+}
+
+static void nb_config_edits_record(struct nb_config *config,
+				   const struct lyd_node *dnode)
+{
+	struct nb_config_edit *edit;
+
+	if (!config->edits)
+		return;
+
+	edit = XCALLOC(MTYPE_NB_CONFIG_EDIT, sizeof(*edit));
+	edit->xpath = lyd_path(dnode);
+	if (!edit->xpath) {
+		XFREE(MTYPE_NB_CONFIG_EDIT, edit);
+		nb_config_edits_stop(config);
+		return;
+	}
+
+	if (nb_config_edit_hash_add(&config->edits->hash, edit)) {
+		/* Already edited. */
+		free(edit->xpath);
+		XFREE(MTYPE_NB_CONFIG_EDIT, edit);
+		return;
+	}
+	nb_config_edit_list_add_tail(&config->edits->list, edit);
+}
+
+/* Check whether the edit log can stand in for a full diff with running. */
+static bool nb_config_edits_valid(const struct nb_config *config)
+{
+	return config->edits && running_config->dnode && config->dnode
+	       && config->edits->base_gen == running_config_gen
+	       && config->edits->base_version == running_config->version;
+}
+
+/* The running configuration changed under the candidates. */
+static void nb_config_running_changed(struct nb_config *config)
+{
+	if (config == running_config)
+		running_config_gen++;
+}
+
 struct nb_config *nb_config_new(struct lyd_node *dnode)
 {
 	struct nb_config *config;
@@ -299,6 +441,7 @@ struct nb_config *nb_config_new(struct lyd_node *dnode)
 
 void nb_config_free(struct nb_config *config)
 {
+	nb_config_edits_stop(config);
 	if (config->dnode)
 		yang_dnode_free(config->dnode);
 	XFREE(MTYPE_NB_CONFIG, config);
@@ -311,6 +454,8 @@ struct nb_config *nb_config_dup(const struct nb_config *config)
 	dup = XCALLOC(MTYPE_NB_CONFIG, sizeof(*dup));
 	dup->dnode = yang_dnode_dup(config->dnode);
 	dup->version = config->version;
+	if (config == running_config)
+		nb_config_edits_start(dup);
 
 	return dup;
 }
@@ -323,6 +468,8 @@ int nb_config_merge(struct nb_config *config_dst, struct nb_config *config_src,
 	ret = lyd_merge(config_dst->dnode, config_src->dnode, LYD_OPT_EXPLICIT);
 	if (ret != 0)
 		flog_warn(EC_LIB_LIBYANG, "%s: lyd_merge() failed", __func__);
+	nb_config_edits_stop(config_dst);
+	nb_config_running_changed(config_dst);
 
 	if (!preserve_source)
 		nb_config_free(config_src);
@@ -347,6 +494,12 @@ void nb_config_replace(struct nb_config *config_dst,
 		config_src->dnode = NULL;
 		nb_config_free(config_src);
 	}
+
+	nb_config_running_changed(config_dst);
+	if (config_src == running_config)
+		nb_config_edits_start(config_dst);
+	else
+		nb_config_edits_stop(config_dst);
 }
 
 /* Generate the nb_config_cbs tree. */
@@ -484,18 +637,9 @@ static void nb_config_diff_deleted(const struct lyd_node *dnode, uint32_t *seq,
 	}
 }
 
-/* Calculate the delta between two different configurations. */
-static void nb_config_diff(const struct nb_config *config1,
-			   const struct nb_config *config2,
-			   struct nb_config_cbs *changes)
+static void nb_config_diff_process(struct lyd_difflist *diff, uint32_t *seq,
+				   struct nb_config_cbs *changes)
 {
-	struct lyd_difflist *diff;
-	uint32_t seq = 0;
-
-	diff = lyd_diff(config1->dnode, config2->dnode,
-			LYD_DIFFOPT_WITHDEFAULTS);
-	assert(diff);
-
 	for (int i = 0; diff->type[i] != LYD_DIFF_END; i++) {
 		LYD_DIFFTYPE type;
 		struct lyd_node *dnode;
@@ -505,15 +649,15 @@ static void nb_config_diff(const struct nb_config *config1,
 		switch (type) {
 		case LYD_DIFF_CREATED:
 			dnode = diff->second[i];
-			nb_config_diff_created(dnode, &seq, changes);
+			nb_config_diff_created(dnode, seq, changes);
 			break;
 		case LYD_DIFF_DELETED:
 			dnode = diff->first[i];
-			nb_config_diff_deleted(dnode, &seq, changes);
+			nb_config_diff_deleted(dnode, seq, changes);
 			break;
 		case LYD_DIFF_CHANGED:
 			dnode = diff->second[i];
-			nb_config_diff_add_change(changes, NB_OP_MODIFY, &seq,
+			nb_config_diff_add_change(changes, NB_OP_MODIFY, seq,
 						  dnode);
 			break;
 		case LYD_DIFF_MOVEDAFTER1:
@@ -522,7 +666,87 @@ static void nb_config_diff(const struct nb_config *config1,
 			continue;
 		}
 	}
+}
+
+/* Check if an ancestor of the given data node was edited too. */
+static bool nb_config_diff_edit_covered(const struct nb_config_edits *edits,
+					const struct lyd_node *dnode)
+{
+	for (dnode = dnode->parent; dnode; dnode = dnode->parent) {
+		struct nb_config_edit ref;
+		bool found;
+
+		ref.xpath = lyd_path(dnode);
+		if (!ref.xpath)
+			continue;
+		found = nb_config_edit_hash_const_find(&edits->hash, &ref)
+			!= NULL;
+		free(ref.xpath);
+		if (found)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Calculate the delta between the running configuration and a candidate by
+ * only comparing the subtrees it had edited.
+ */
+static void nb_config_diff_edits(const struct nb_config *config1,
+				 const struct nb_config *config2,
+				 struct nb_config_cbs *changes)
+{
+	const struct nb_config_edits *edits = config2->edits;
+	const struct nb_config_edit *edit;
+	uint32_t seq = 0;
+
+	frr_each (nb_config_edit_list_const, &edits->list, edit) {
+		struct lyd_node *dnode1, *dnode2;
+
+		dnode1 = yang_dnode_get(config1->dnode, edit->xpath);
+		dnode2 = yang_dnode_get(config2->dnode, edit->xpath);
+		if (!dnode1 && !dnode2)
+			continue;
+
+		/* Already accounted for by the edit of an ancestor. */
+		if (nb_config_diff_edit_covered(edits,
+						dnode1 ? dnode1 : dnode2))
+			continue;
+
+		if (dnode1 && dnode2) {
+			struct lyd_difflist *diff;
+
+			diff = lyd_diff(dnode1, dnode2,
+					LYD_DIFFOPT_WITHDEFAULTS
+						| LYD_DIFFOPT_NOSIBLINGS);
+			assert(diff);
+			nb_config_diff_process(diff, &seq, changes);
+			lyd_free_diff(diff);
+		} else if (dnode2)
+			nb_config_diff_created(dnode2, &seq, changes);
+		else
+			nb_config_diff_deleted(dnode1, &seq, changes);
+	}
+}
+
+/* Calculate the delta between two different configurations. */
+static void nb_config_diff(const struct nb_config *config1,
+			   const struct nb_config *config2,
+			   struct nb_config_cbs *changes)
+{
+	struct lyd_difflist *diff;
+	uint32_t seq = 0;
+
+	if (config1 == running_config && nb_config_edits_valid(config2)) {
+		nb_config_diff_edits(config1, config2, changes);
+		return;
+	}
 
+	diff = lyd_diff(config1->dnode, config2->dnode,
+			LYD_DIFFOPT_WITHDEFAULTS);
+	assert(diff);
+	nb_config_diff_process(diff, &seq, changes);
 	lyd_free_diff(diff);
 }
 
@@ -554,6 +778,9 @@ int nb_candidate_edit(struct nb_config *candidate,
 				  __func__);
 			return NB_ERR;
 		}
+		/* Top-most node created or updated, if anything changed. */
+		if (dnode)
+			nb_config_edits_record(candidate, dnode);
 		break;
 	case NB_OP_DESTROY:
 		dnode = yang_dnode_get(candidate->dnode, xpath_edit);
@@ -563,6 +790,7 @@ int nb_candidate_edit(struct nb_config *candidate,
 			 * whether to ignore it or not.
 			 */
 			return NB_ERR_NOT_FOUND;
+		nb_config_edits_record(candidate, dnode);
 		lyd_free(dnode);
 		break;
 	case NB_OP_MOVE:
@@ -599,6 +827,223 @@ int nb_candidate_update(struct nb_config *candidate)
 	return NB_OK;
 }
 
+static void nb_phase_record(enum nb_phase phase, const struct timeval *start)
+{
+	struct nb_phase_stats *stats = &nb_phase_stats[phase];
+	uint64_t usec = monotime_since(start, NULL);
+
+	stats->count++;
+	stats->total_usec += usec;
+	stats->last_usec = usec;
+	if (usec > stats->max_usec)
+		stats->max_usec = usec;
+}
+
+struct nb_parallel_job {
+	struct nb_config_change *change;
+	int ret;
+
+	/* Copy of the callback's error message, if it failed. */
+	char *errmsg;
+};
+
+struct nb_parallel {
+	struct nb_context *context;
+	enum nb_event event;
+
+	struct nb_parallel_job *jobs;
+	size_t njobs;
+
+	atomic_size_t next;
+	atomic_bool failed;
+};
+
+struct nb_parallel_worker {
+	pthread_t thread;
+	struct rcu_thread *rcu_thread;
+	struct nb_parallel *par;
+	bool running;
+};
+
+static void nb_parallel_run_jobs(struct nb_parallel *par)
+{
+	char errmsg[BUFSIZ];
+	size_t start, end;
+
+	for (;;) {
+		/* No point in going on once the transaction is doomed. */
+		if (atomic_load_explicit(&par->failed, memory_order_relaxed))
+			return;
+
+		start = atomic_fetch_add_explicit(&par->next, NB_PARALLEL_CHUNK,
+						  memory_order_relaxed);
+		if (start >= par->njobs)
+			return;
+		end = MIN(start + NB_PARALLEL_CHUNK, par->njobs);
+
+		for (size_t i = start; i < end; i++) {
+			struct nb_parallel_job *job = &par->jobs[i];
+
+			errmsg[0] = '\0';
+			job->ret = nb_callback_configuration(par->context,
+							     par->event,
+							     job->change, errmsg,
+							     sizeof(errmsg));
+			if (job->ret == NB_OK) {
+				if (par->event == NB_EV_PREPARE)
+					job->change->prepare_ok = true;
+				continue;
+			}
+
+			job->errmsg = XSTRDUP(MTYPE_TMP, errmsg);
+			atomic_store_explicit(&par->failed, true,
+					      memory_order_relaxed);
+		}
+	}
+}
+
+static void *nb_parallel_thread(void *arg)
+{
+	struct nb_parallel_worker *worker = arg;
+
+	rcu_thread_start(worker->rcu_thread);
+	rcu_read_unlock();
+
+	nb_parallel_run_jobs(worker->par);
+	return NULL;
+}
+
+/*
+ * Run the callbacks of the given changes on the main pthread plus up to
+ * nb_parallel_workers short-lived pthreads.  On failure, the first failed
+ * change (in processing order) is reported, as the serial loop would.
+ */
+static int nb_parallel_process(struct nb_context *context,
+			       enum nb_event event,
+			       struct nb_parallel_job *jobs, size_t njobs,
+			       char *errmsg, size_t errmsg_len)
+{
+	struct nb_parallel par = {
+		.context = context,
+		.event = event,
+		.jobs = jobs,
+		.njobs = njobs,
+	};
+	struct nb_parallel_worker workers[NB_PARALLEL_MAX_WORKERS] = {};
+	unsigned int nworkers;
+	sigset_t oldsigs, blocksigs;
+	int ret = NB_OK;
+
+	nworkers = MIN(nb_parallel_workers, njobs / NB_PARALLEL_CHUNK);
+
+	/* signals are handled on the main pthread */
+	sigfillset(&blocksigs);
+	pthread_sigmask(SIG_BLOCK, &blocksigs, &oldsigs);
+
+	for (unsigned int i = 0; i < nworkers; i++) {
+		struct nb_parallel_worker *worker = &workers[i];
+
+		worker->par = &par;
+		worker->rcu_thread = rcu_thread_prepare();
+		if (pthread_create(&worker->thread, NULL, nb_parallel_thread,
+				   worker)) {
+			rcu_thread_unprepare(worker->rcu_thread);
+			break;
+		}
+		worker->running = true;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+	nb_parallel_run_jobs(&par);
+
+	for (unsigned int i = 0; i < nworkers; i++)
+		if (workers[i].running)
+			pthread_join(workers[i].thread, NULL);
+
+	for (size_t i = 0; i < njobs; i++) {
+		if (!jobs[i].errmsg)
+			continue;
+		if (ret == NB_OK) {
+			ret = jobs[i].ret;
+			strlcpy(errmsg, jobs[i].errmsg, errmsg_len);
+		}
+		XFREE(MTYPE_TMP, jobs[i].errmsg);
+	}
+
+	return ret;
+}
+
+/*
+ * Call the validate or prepare callbacks of all configuration changes,
+ * stopping at the first failure.
+ *
+ * Changes to nodes that aren't parallel-safe are processed first, in order,
+ * on the main pthread; if there are enough of the others, they are then
+ * spread over the worker pthreads.  Small transactions are processed
+ * exactly like before.
+ */
+static int nb_changes_process(struct nb_context *context, enum nb_event event,
+			      struct nb_config_cbs *changes,
+			      enum nb_phase phase, char *errmsg,
+			      size_t errmsg_len)
+{
+	struct nb_phase_stats *stats = &nb_phase_stats[phase];
+	struct nb_parallel_job *jobs;
+	struct nb_config_cb *cb;
+	size_t nchanges = 0, njobs = 0;
+	int ret;
+
+	RB_FOREACH (cb, nb_config_cbs, changes) {
+		nchanges++;
+		if (CHECK_FLAG(cb->nb_node->flags, F_NB_NODE_PARALLEL))
+			njobs++;
+	}
+	stats->changes += nchanges;
+
+	if (!nb_parallel_workers || njobs < NB_PARALLEL_MIN_CHANGES) {
+		RB_FOREACH (cb, nb_config_cbs, changes) {
+			struct nb_config_change *change =
+				(struct nb_config_change *)cb;
+
+			ret = nb_callback_configuration(context, event, change,
+							errmsg, errmsg_len);
+			if (ret != NB_OK)
+				return ret;
+			if (event == NB_EV_PREPARE)
+				change->prepare_ok = true;
+		}
+		return NB_OK;
+	}
+
+	jobs = XCALLOC(MTYPE_TMP, njobs * sizeof(*jobs));
+	njobs = 0;
+	RB_FOREACH (cb, nb_config_cbs, changes) {
+		struct nb_config_change *change = (struct nb_config_change *)cb;
+
+		if (CHECK_FLAG(cb->nb_node->flags, F_NB_NODE_PARALLEL)) {
+			jobs[njobs++].change = change;
+			continue;
+		}
+
+		ret = nb_callback_configuration(context, event, change, errmsg,
+						errmsg_len);
+		if (ret != NB_OK) {
+			XFREE(MTYPE_TMP, jobs);
+			return ret;
+		}
+		if (event == NB_EV_PREPARE)
+			change->prepare_ok = true;
+	}
+
+	stats->parallel += njobs;
+	ret = nb_parallel_process(context, event, jobs, njobs, errmsg,
+				  errmsg_len);
+	XFREE(MTYPE_TMP, jobs);
+
+	return ret;
+}
+
 /*
  * Perform YANG syntactic and semantic validation.
  *
@@ -625,7 +1070,6 @@ static int nb_candidate_validate_code(struct nb_context *context,
 				      struct nb_config_cbs *changes,
 				      char *errmsg, size_t errmsg_len)
 {
-	struct nb_config_cb *cb;
 	struct lyd_node *root, *next, *child;
 	int ret;
 
@@ -649,14 +1093,10 @@ static int nb_candidate_validate_code(struct nb_context *context,
 	}
 
 	/* Now validate the configuration changes. */
-	RB_FOREACH (cb, nb_config_cbs, changes) {
-		struct nb_config_change *change = (struct nb_config_change *)cb;
-
-		ret = nb_callback_configuration(context, NB_EV_VALIDATE, change,
-						errmsg, errmsg_len);
-		if (ret != NB_OK)
-			return NB_ERR_VALIDATION;
-	}
+	ret = nb_changes_process(context, NB_EV_VALIDATE, changes,
+				 NB_PHASE_VALIDATE_CODE, errmsg, errmsg_len);
+	if (ret != NB_OK)
+		return NB_ERR_VALIDATION;
 
 	return NB_OK;
 }
@@ -666,16 +1106,24 @@ int nb_candidate_validate(struct nb_context *context,
 			  size_t errmsg_len)
 {
 	struct nb_config_cbs changes;
+	struct timeval start;
 	int ret;
 
+	monotime(&start);
 	if (nb_candidate_validate_yang(candidate, errmsg, sizeof(errmsg_len))
 	    != NB_OK)
 		return NB_ERR_VALIDATION;
+	nb_phase_record(NB_PHASE_VALIDATE_YANG, &start);
 
+	monotime(&start);
 	RB_INIT(nb_config_cbs, &changes);
 	nb_config_diff(running_config, candidate, &changes);
+	nb_phase_record(NB_PHASE_DIFF, &start);
+
+	monotime(&start);
 	ret = nb_candidate_validate_code(context, candidate, &changes, errmsg,
 					 errmsg_len);
+	nb_phase_record(NB_PHASE_VALIDATE_CODE, &start);
 	nb_config_diff_del_changes(&changes);
 
 	return ret;
@@ -688,7 +1136,10 @@ int nb_candidate_commit_prepare(struct nb_context *context,
 				char *errmsg, size_t errmsg_len)
 {
 	struct nb_config_cbs changes;
+	struct timeval start;
+	int ret;
 
+	monotime(&start);
 	if (nb_candidate_validate_yang(candidate, errmsg, errmsg_len)
 	    != NB_OK) {
 		flog_warn(EC_LIB_NB_CANDIDATE_INVALID,
@@ -696,9 +1147,12 @@ int nb_candidate_commit_prepare(struct nb_context *context,
 			  __func__);
 		return NB_ERR_VALIDATION;
 	}
+	nb_phase_record(NB_PHASE_VALIDATE_YANG, &start);
 
+	monotime(&start);
 	RB_INIT(nb_config_cbs, &changes);
 	nb_config_diff(running_config, candidate, &changes);
+	nb_phase_record(NB_PHASE_DIFF, &start);
 	if (RB_EMPTY(nb_config_cbs, &changes)) {
 		snprintf(
 			errmsg, errmsg_len,
@@ -706,9 +1160,11 @@ int nb_candidate_commit_prepare(struct nb_context *context,
 		return NB_ERR_NO_CHANGES;
 	}
 
-	if (nb_candidate_validate_code(context, candidate, &changes, errmsg,
-				       errmsg_len)
-	    != NB_OK) {
+	monotime(&start);
+	ret = nb_candidate_validate_code(context, candidate, &changes, errmsg,
+					 errmsg_len);
+	nb_phase_record(NB_PHASE_VALIDATE_CODE, &start);
+	if (ret != NB_OK) {
 		flog_warn(EC_LIB_NB_CANDIDATE_INVALID,
 			  "%s: failed to validate candidate configuration",
 			  __func__);
@@ -726,8 +1182,12 @@ int nb_candidate_commit_prepare(struct nb_context *context,
 		return NB_ERR_LOCKED;
 	}
 
-	return nb_transaction_process(NB_EV_PREPARE, *transaction, errmsg,
-				      errmsg_len);
+	monotime(&start);
+	ret = nb_transaction_process(NB_EV_PREPARE, *transaction, errmsg,
+				     errmsg_len);
+	nb_phase_record(NB_PHASE_PREPARE, &start);
+
+	return ret;
 }
 
 void nb_candidate_commit_abort(struct nb_transaction *transaction, char *errmsg,
@@ -742,13 +1202,18 @@ void nb_candidate_commit_apply(struct nb_transaction *transaction,
 			       bool save_transaction, uint32_t *transaction_id,
 			       char *errmsg, size_t errmsg_len)
 {
+	struct timeval start;
+
+	monotime(&start);
 	(void)nb_transaction_process(NB_EV_APPLY, transaction, errmsg,
 				     errmsg_len);
 	nb_transaction_apply_finish(transaction, errmsg, errmsg_len);
+	nb_phase_record(NB_PHASE_APPLY, &start);
 
 	/* Replace running by candidate. */
 	transaction->config->version++;
 	nb_config_replace(running_config, transaction->config, true);
+	nb_config_edits_start(transaction->config);
 
 	/* Record transaction. */
 	if (save_transaction && nb_db_enabled
@@ -1297,40 +1762,33 @@ static int nb_transaction_process(enum nb_event event,
 {
 	struct nb_config_cb *cb;
 
+	if (event == NB_EV_PREPARE)
+		return nb_changes_process(transaction->context, event,
+					  &transaction->changes,
+					  NB_PHASE_PREPARE, errmsg, errmsg_len);
+
 	RB_FOREACH (cb, nb_config_cbs, &transaction->changes) {
 		struct nb_config_change *change = (struct nb_config_change *)cb;
-		int ret;
 
 		/*
 		 * Only try to release resources that were allocated
-		 * successfully.
+		 * successfully.  When the preparation phase ran in parallel,
+		 * those aren't necessarily the first ones.
 		 */
 		if (event == NB_EV_ABORT && !change->prepare_ok)
-			break;
+			continue;
 
-		/* Call the appropriate callback. */
-		ret = nb_callback_configuration(transaction->context, event,
+		/*
+		 * Call the appropriate callback.
+		 *
+		 * At this point it's not possible to reject the transaction
+		 * anymore, so any failure here can lead to inconsistencies and
+		 * should be treated as a bug.  Operations prone to errors, like
+		 * validations and resource allocations, should be performed
+		 * during the 'prepare' phase.
+		 */
+		(void)nb_callback_configuration(transaction->context, event,
 						change, errmsg, errmsg_len);
-		switch (event) {
-		case NB_EV_PREPARE:
-			if (ret != NB_OK)
-				return ret;
-			change->prepare_ok = true;
-			break;
-		case NB_EV_ABORT:
-		case NB_EV_APPLY:
-			/*
-			 * At this point it's not possible to reject the
-			 * transaction anymore, so any failure here can lead to
-			 * inconsistencies and should be treated as a bug.
-			 * Operations prone to errors, like validations and
-			 * resource allocations, should be performed during the
-			 * 'prepare' phase.
-			 */
-			break;
-		default:
-			break;
-		}
 	}
 
 	return NB_OK;
@@ -1546,6 +2004,47 @@ nb_oper_data_iter_leaflist(const struct nb_node *nb_node, const char *xpath,
 	return NB_OK;
 }
 
+static int nb_oper_data_iter_list_entry(const struct nb_node *nb_node,
+					const char *xpath_list,
+					const void *list_entry,
+					uint32_t position,
+					struct yang_list_keys *list_keys,
+					struct yang_translator *translator,
+					uint32_t flags, nb_oper_data_cb cb,
+					void *arg)
+{
+	struct lys_node_list *slist = (struct lys_node_list *)nb_node->snode;
+	char xpath[XPATH_MAXLEN * 2];
+
+	if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST)) {
+		/* Obtain the list entry keys. */
+		if (nb_callback_get_keys(nb_node, list_entry, list_keys)
+		    != NB_OK) {
+			flog_warn(EC_LIB_NB_CB_STATE,
+				  "%s: failed to get list keys", __func__);
+			return NB_ERR;
+		}
+
+		/* Build XPath of the list entry. */
+		strlcpy(xpath, xpath_list, sizeof(xpath));
+		for (unsigned int i = 0; i < list_keys->num; i++) {
+			snprintf(xpath + strlen(xpath),
+				 sizeof(xpath) - strlen(xpath), "[%s='%s']",
+				 slist->keys[i]->name, list_keys->key[i]);
+		}
+	} else {
+		/*
+		 * Keyless list - build XPath using a positional index.
+		 */
+		snprintf(xpath, sizeof(xpath), "%s[%u]", xpath_list, position);
+	}
+
+	/* Iterate over the child nodes. */
+	return nb_oper_data_iter_children(nb_node->snode, xpath, list_entry,
+					  list_keys, translator, false, flags,
+					  cb, arg);
+}
+
 static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 				  const char *xpath_list,
 				  const void *parent_list_entry,
@@ -1553,7 +2052,6 @@ static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 				  struct yang_translator *translator,
 				  uint32_t flags, nb_oper_data_cb cb, void *arg)
 {
-	struct lys_node_list *slist = (struct lys_node_list *)nb_node->snode;
 	const void *list_entry = NULL;
 	uint32_t position = 1;
 
@@ -1563,7 +2061,6 @@ static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 	/* Iterate over all list entries. */
 	do {
 		struct yang_list_keys list_keys;
-		char xpath[XPATH_MAXLEN * 2];
 		int ret;
 
 		/* Obtain list entry. */
@@ -1573,38 +2070,10 @@ static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 			/* End of the list. */
 			break;
 
-		if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST)) {
-			/* Obtain the list entry keys. */
-			if (nb_callback_get_keys(nb_node, list_entry,
-						 &list_keys)
-			    != NB_OK) {
-				flog_warn(EC_LIB_NB_CB_STATE,
-					  "%s: failed to get list keys",
-					  __func__);
-				return NB_ERR;
-			}
-
-			/* Build XPath of the list entry. */
-			strlcpy(xpath, xpath_list, sizeof(xpath));
-			for (unsigned int i = 0; i < list_keys.num; i++) {
-				snprintf(xpath + strlen(xpath),
-					 sizeof(xpath) - strlen(xpath),
-					 "[%s='%s']", slist->keys[i]->name,
-					 list_keys.key[i]);
-			}
-		} else {
-			/*
-			 * Keyless list - build XPath using a positional index.
-			 */
-			snprintf(xpath, sizeof(xpath), "%s[%u]", xpath_list,
-				 position);
-			position++;
-		}
-
-		/* Iterate over the child nodes. */
-		ret = nb_oper_data_iter_children(
-			nb_node->snode, xpath, list_entry, &list_keys,
-			translator, false, flags, cb, arg);
+		ret = nb_oper_data_iter_list_entry(nb_node, xpath_list,
+						   list_entry, position++,
+						   &list_keys, translator,
+						   flags, cb, arg);
 		if (ret != NB_OK)
 			return ret;
 	} while (list_entry);
@@ -1686,32 +2155,22 @@ static int nb_oper_data_iter_node(const struct lys_node *snode,
 	return ret;
 }
 
-int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
-			 uint32_t flags, nb_oper_data_cb cb, void *arg)
+/*
+ * Find the list entry pointer of the innermost list entry given in the XPath
+ * (if any), along with its keys. On success the caller must free the data
+ * tree built from the XPath.
+ */
+static int nb_oper_data_lookup(const char *xpath, struct lyd_node **dnodep,
+			       const void **list_entryp,
+			       struct yang_list_keys *list_keysp)
 {
-	struct nb_node *nb_node;
 	const void *list_entry = NULL;
 	struct yang_list_keys list_keys;
 	struct list *list_dnodes;
 	struct lyd_node *dnode, *dn;
 	struct listnode *ln;
-	int ret;
 
-	nb_node = nb_node_find(xpath);
-	if (!nb_node) {
-		flog_warn(EC_LIB_YANG_UNKNOWN_DATA_PATH,
-			  "%s: unknown data path: %s", __func__, xpath);
-		return NB_ERR;
-	}
-
-	/* For now this function works only with containers and lists. */
-	if (!CHECK_FLAG(nb_node->snode->nodetype, LYS_CONTAINER | LYS_LIST)) {
-		flog_warn(
-			EC_LIB_NB_OPERATIONAL_DATA,
-			"%s: can't iterate over YANG leaf or leaf-list [xpath %s]",
-			__func__, xpath);
-		return NB_ERR;
-	}
+	memset(&list_keys, 0, sizeof(list_keys));
 
 	/*
 	 * Create a data tree from the XPath so that we can parse the keys of
@@ -1774,6 +2233,55 @@ int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
 		}
 	}
 
+	list_delete(&list_dnodes);
+
+	*dnodep = dnode;
+	*list_entryp = list_entry;
+	*list_keysp = list_keys;
+
+	return NB_OK;
+}
+
+static struct nb_node *nb_oper_data_node_find(const char *xpath)
+{
+	struct nb_node *nb_node;
+
+	nb_node = nb_node_find(xpath);
+	if (!nb_node) {
+		flog_warn(EC_LIB_YANG_UNKNOWN_DATA_PATH,
+			  "%s: unknown data path: %s", __func__, xpath);
+		return NULL;
+	}
+
+	/* For now this function works only with containers and lists. */
+	if (!CHECK_FLAG(nb_node->snode->nodetype, LYS_CONTAINER | LYS_LIST)) {
+		flog_warn(
+			EC_LIB_NB_OPERATIONAL_DATA,
+			"%s: can't iterate over YANG leaf or leaf-list [xpath %s]",
+			__func__, xpath);
+		return NULL;
+	}
+
+	return nb_node;
+}
+
+int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
+			 uint32_t flags, nb_oper_data_cb cb, void *arg)
+{
+	struct nb_node *nb_node;
+	const void *list_entry;
+	struct yang_list_keys list_keys;
+	struct lyd_node *dnode;
+	int ret;
+
+	nb_node = nb_oper_data_node_find(xpath);
+	if (!nb_node)
+		return NB_ERR;
+
+	ret = nb_oper_data_lookup(xpath, &dnode, &list_entry, &list_keys);
+	if (ret != NB_OK)
+		return ret;
+
 	/* If a list entry was given, iterate over that list entry only. */
 	if (dnode->schema->nodetype == LYS_LIST && dnode->child)
 		ret = nb_oper_data_iter_children(
@@ -1784,7 +2292,85 @@ int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
 					     &list_keys, translator, true,
 					     flags, cb, arg);
 
-	list_delete(&list_dnodes);
+	yang_dnode_free(dnode);
+
+	return ret;
+}
+
+int nb_oper_data_iterate_page(const char *xpath,
+			      struct yang_translator *translator,
+			      uint32_t flags,
+			      struct nb_oper_data_cursor *cursor,
+			      uint32_t max_entries, nb_oper_data_cb cb,
+			      void *arg)
+{
+	struct nb_node *nb_node;
+	const void *parent_list_entry, *list_entry = NULL;
+	struct yang_list_keys parent_list_keys;
+	struct lyd_node *dnode;
+	int ret = NB_OK;
+
+	nb_node = nb_oper_data_node_find(xpath);
+	if (!nb_node)
+		return NB_ERR;
+
+	ret = nb_oper_data_lookup(xpath, &dnode, &parent_list_entry,
+				  &parent_list_keys);
+	if (ret != NB_OK)
+		return ret;
+
+	/* Only whole YANG lists are paged, return anything else at once. */
+	if (nb_node->snode->nodetype != LYS_LIST || dnode->child
+	    || CHECK_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY)
+	    || max_entries == 0) {
+		yang_dnode_free(dnode);
+		cursor->done = true;
+		return nb_oper_data_iterate(xpath, translator, flags, cb, arg);
+	}
+
+	/* Find the last list entry returned by the previous page. */
+	if (cursor->position) {
+		if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST))
+			list_entry = nb_callback_lookup_entry(
+				nb_node, parent_list_entry, &cursor->keys);
+
+		/*
+		 * It's gone (or the list has no keys), skip as many entries
+		 * as were already returned instead.
+		 */
+		if (!list_entry) {
+			for (uint32_t i = 0; i < cursor->position; i++) {
+				list_entry = nb_callback_get_next(
+					nb_node, parent_list_entry,
+					list_entry);
+				if (!list_entry)
+					break;
+			}
+			if (!list_entry) {
+				cursor->done = true;
+				goto out;
+			}
+		}
+	}
+
+	for (uint32_t count = 0; count < max_entries; count++) {
+		list_entry = nb_callback_get_next(nb_node, parent_list_entry,
+						  list_entry);
+		if (!list_entry) {
+			/* End of the list. */
+			cursor->done = true;
+			break;
+		}
+
+		ret = nb_oper_data_iter_list_entry(
+			nb_node, xpath, list_entry, cursor->position + 1,
+			&cursor->keys, translator, flags, cb, arg);
+		if (ret != NB_OK)
+			break;
+		cursor->position++;
+	}
+
+out:
 	yang_dnode_free(dnode);
 
 	return ret;
@@ -2208,6 +2794,34 @@ const char *nb_client_name(enum nb_client client)
 	}
 }
 
+const char *nb_phase_name(enum nb_phase phase)
+{
+	switch (phase) {
+	case NB_PHASE_VALIDATE_YANG:
+		return "validate (YANG)";
+	case NB_PHASE_DIFF:
+		return "diff";
+	case NB_PHASE_VALIDATE_CODE:
+		return "validate (callbacks)";
+	case NB_PHASE_PREPARE:
+		return "prepare";
+	case NB_PHASE_APPLY:
+		return "apply";
+	default:
+		return "unknown";
+	}
+}
+
+const struct nb_phase_stats *nb_phase_stats_get(enum nb_phase phase)
+{
+	return &nb_phase_stats[phase];
+}
+
+unsigned int nb_parallel_workers_get(void)
+{
+	return nb_parallel_workers;
+}
+
 static void nb_load_callbacks(const struct frr_yang_module_info *module)
 {
 	for (size_t i = 0; module->nodes[i].xpath; i++) {
@@ -2233,6 +2847,8 @@ static void nb_load_callbacks(const struct frr_yang_module_info *module)
 		priority = module->nodes[i].priority;
 		if (priority != 0)
 			nb_node->priority = priority;
+		if (module->nodes[i].parallel_safe)
+			SET_FLAG(nb_node->flags, F_NB_NODE_PARALLEL);
 	}
 }
 
@@ -2266,8 +2882,15 @@ void nb_init(struct thread_master *tm,
 	     const struct frr_yang_module_info *const modules[],
 	     size_t nmodules, bool db_enabled)
 {
+	long ncpus;
+
 	nb_db_enabled = db_enabled;
 
+	/* The main pthread does its share of the work too. */
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus > 1)
+		nb_parallel_workers = MIN(ncpus - 1, NB_PARALLEL_MAX_WORKERS);
+
 	/* Load YANG modules and their corresponding northbound callbacks. */
 	for (size_t i = 0; i < nmodules; i++)
 		nb_load_module(modules[i]);
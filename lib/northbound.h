@@ -546,6 +546,8 @@ struct nb_node {
 #define F_NB_NODE_CONFIG_ONLY 0x01
 /* The YANG list doesn't contain key leafs. */
 #define F_NB_NODE_KEYLESS_LIST 0x02
+/* The validate/prepare callbacks can run on a worker pthread. */
+#define F_NB_NODE_PARALLEL 0x04
 
 /*
  * HACK: old gcc versions (< 5.x) have a bug that prevents C99 flexible arrays
@@ -568,6 +570,15 @@ struct frr_yang_module_info {
 
 		/* Priority - lower priorities are processed first. */
 		uint32_t priority;
+
+		/*
+		 * The NB_EV_VALIDATE and NB_EV_PREPARE callbacks only look at
+		 * the candidate configuration (and allocate resources), so
+		 * they can run concurrently on a worker pthread when a large
+		 * configuration is loaded.  NB_EV_APPLY always runs on the
+		 * main pthread.
+		 */
+		bool parallel_safe;
 #if defined(__GNUC__) && ((__GNUC__ - 0) < 5) && !defined(__clang__)
 	} nodes[YANG_MODULE_MAX_NODES + 1];
 #else
@@ -626,9 +637,14 @@ struct nb_context {
 };
 
 /* Northbound configuration. */
+struct nb_config_edits;
+
 struct nb_config {
 	struct lyd_node *dnode;
 	uint32_t version;
+
+	/* Edits since the configuration was a copy of the running one. */
+	struct nb_config_edits *edits;
 };
 
 /* Northbound configuration callback. */
@@ -665,6 +681,18 @@ typedef int (*nb_oper_data_cb)(const struct lys_node *snode,
 /* Iterate over direct child nodes only. */
 #define NB_OPER_DATA_ITER_NORECURSE 0x0001
 
+/* Position of nb_oper_data_iterate_page() within a YANG list. */
+struct nb_oper_data_cursor {
+	/* Keys of the last list entry returned. */
+	struct yang_list_keys keys;
+
+	/* Number of list entries returned so far. */
+	uint32_t position;
+
+	/* All the list entries were returned. */
+	bool done;
+};
+
 /* Hooks. */
 DECLARE_HOOK(nb_notification_send, (const char *xpath, struct list *arguments),
 	     (xpath, arguments))
@@ -1068,6 +1096,48 @@ extern int nb_oper_data_iterate(const char *xpath,
 				struct yang_translator *translator,
 				uint32_t flags, nb_oper_data_cb cb, void *arg);
 
+/*
+ * Iterate over operational data one page at a time.
+ *
+ * When the XPath points to a YANG list (and not to one of its entries), up to
+ * 'max_entries' list entries are iterated over per call, starting after the
+ * last entry returned by the previous call. Between calls the caller is free
+ * to send the page out and to yield to its event loop, since the position is
+ * kept as the keys of the last list entry. Entries added or removed between
+ * two calls may be missed. Any other XPath is iterated over at once.
+ *
+ * xpath
+ *    Data path of the YANG data we want to iterate over.
+ *
+ * translator
+ *    YANG module translator (might be NULL).
+ *
+ * flags
+ *    NB_OPER_DATA_ITER_ flags to control how the iteration is performed.
+ *
+ * cursor
+ *    Iteration position, zeroed before the first call. 'done' is set once
+ *    there's nothing left to iterate over.
+ *
+ * max_entries
+ *    Number of list entries per page (0 means no limit).
+ *
+ * cb
+ *    Function to call with each data node.
+ *
+ * arg
+ *    Arbitrary argument passed as the fourth parameter in each call to 'cb'.
+ *
+ * Returns:
+ *    NB_OK on success, NB_ERR otherwise.
+ */
+extern int nb_oper_data_iterate_page(const char *xpath,
+				     struct yang_translator *translator,
+				     uint32_t flags,
+				     struct nb_oper_data_cursor *cursor,
+				     uint32_t max_entries, nb_oper_data_cb cb,
+				     void *arg);
+
 /*
  * Validate if the northbound operation is valid for the given node.
  *
@@ -1237,6 +1307,58 @@ extern const char *nb_err_name(enum nb_error error);
  */
 extern const char *nb_client_name(enum nb_client client);
 
+/* Phases of a configuration commit, for statistics. */
+enum nb_phase {
+	NB_PHASE_VALIDATE_YANG = 0,
+	NB_PHASE_DIFF,
+	NB_PHASE_VALIDATE_CODE,
+	NB_PHASE_PREPARE,
+	NB_PHASE_APPLY,
+	NB_PHASE_MAX,
+};
+
+struct nb_phase_stats {
+	/* Number of times this phase ran. */
+	uint64_t count;
+
+	/* Time spent, in microseconds. */
+	uint64_t total_usec;
+	uint64_t max_usec;
+	uint64_t last_usec;
+
+	/* Configuration changes processed, and how many of them on workers. */
+	uint64_t changes;
+	uint64_t parallel;
+};
+
+/*
+ * Get the commit statistics of a given phase.
+ *
+ * phase
+ *    Commit phase.
+ *
+ * Returns:
+ *    Statistics accumulated since startup.
+ */
+extern const struct nb_phase_stats *nb_phase_stats_get(enum nb_phase phase);
+
+/*
+ * Return a human-readable string representing a commit phase.
+ *
+ * phase
+ *    Commit phase.
+ *
+ * Returns:
+ *    String representation of the given commit phase.
+ */
+extern const char *nb_phase_name(enum nb_phase phase);
+
+/*
+ * Number of worker pthreads used to process large configuration changes,
+ * zero if everything runs on the main pthread.
+ */
+extern unsigned int nb_parallel_workers_get(void);
+
 /*
  * Validate all northbound callbacks.
  *
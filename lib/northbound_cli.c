@@ -1656,6 +1656,51 @@ DEFPY (show_yang_module_translator,
 	return CMD_SUCCESS;
 }
 
+DEFPY (show_northbound,
+       show_northbound_cmd,
+       "show northbound",
+       SHOW_STR
+       "Northbound configuration commit statistics\n")
+{
+	struct ttable *tt;
+	char *table;
+
+	/* Prepare table. */
+	tt = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
+	ttable_add_row(tt,
+		       "Phase|Runs|Total (ms)|Max (ms)|Last (ms)|Changes|Parallel");
+	tt->style.cell.rpad = 2;
+	tt->style.corner = '+';
+	ttable_restyle(tt);
+	ttable_rowseps(tt, 0, BOTTOM, true, '-');
+
+	for (enum nb_phase phase = 0; phase < NB_PHASE_MAX; phase++) {
+		const struct nb_phase_stats *stats = nb_phase_stats_get(phase);
+
+		ttable_add_row(tt,
+			       "%s|%" PRIu64 "|%" PRIu64 ".%03" PRIu64
+			       "|%" PRIu64 ".%03" PRIu64 "|%" PRIu64
+			       ".%03" PRIu64 "|%" PRIu64 "|%" PRIu64,
+			       nb_phase_name(phase), stats->count,
+			       stats->total_usec / 1000,
+			       stats->total_usec % 1000,
+			       stats->max_usec / 1000, stats->max_usec % 1000,
+			       stats->last_usec / 1000,
+			       stats->last_usec % 1000, stats->changes,
+			       stats->parallel);
+	}
+
+	/* Dump the generated table. */
+	table = ttable_dump(tt, "\n");
+	vty_out(vty, "%s\n", table);
+	XFREE(MTYPE_TMP, table);
+	ttable_del(tt);
+
+	vty_out(vty, "Worker pthreads: %u\n\n", nb_parallel_workers_get());
+
+	return CMD_SUCCESS;
+}
+
 #ifdef HAVE_CONFIG_ROLLBACKS
 static int nb_cli_rollback_configuration(struct vty *vty,
 					 uint32_t transaction_id)
@@ -1907,6 +1952,7 @@ void nb_cli_init(struct thread_master *tm)
 	install_element(ENABLE_NODE, &show_yang_module_cmd);
 	install_element(ENABLE_NODE, &show_yang_module_detail_cmd);
 	install_element(ENABLE_NODE, &show_yang_module_translator_cmd);
+	install_element(ENABLE_NODE, &show_northbound_cmd);
 	cmd_variable_handler_register(yang_var_handlers);
 }
 
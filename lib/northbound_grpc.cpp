@@ -19,6 +19,7 @@
 
 #include <zebra.h>
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/alarm.h>
 #include "grpc/frr-northbound.grpc.pb.h"
 
 #include "log.h"
@@ -34,9 +35,19 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <chrono>
+#include <mutex>
 
 #define GRPC_DEFAULT_PORT 50051
 
+/* Subscribe() sample interval, in milliseconds */
+#define GRPC_SUBSCRIBE_INTERVAL_DFLT 10000
+#define GRPC_SUBSCRIBE_INTERVAL_MIN 1000
+/* How often subscriptions look for queued YANG notifications */
+#define GRPC_SUBSCRIBE_TICK 100
+/* YANG notifications queued per subscription before dropping new ones */
+#define GRPC_SUBSCRIBE_QUEUE_MAX 1024
+
 static void *grpc_pthread_start(void *arg);
 
 /*
@@ -61,8 +72,47 @@ class RpcStateBase
 {
       public:
 	virtual void doCallback() = 0;
+
+	/* Result of the last completion queue operation */
+	bool cq_ok = true;
+	/* Operations may fail (i.e. the client went away mid-stream) */
+	bool cq_may_fail = false;
+};
+
+/* Subscribe() call state, shared with the YANG notification hook */
+struct subscription {
+	frr::SubscribeRequest_Mode mode;
+	std::chrono::milliseconds interval;
+	std::list<std::string> paths;
+
+	/* Next time the state data is sampled */
+	std::chrono::steady_clock::time_point next_sample;
+	/* Last state data sent, ON_CHANGE mode only */
+	std::map<std::string, std::string> cache;
+	bool synced = false;
+
+	/* Wakes up the call on the gRPC completion queue */
+	grpc::Alarm alarm;
+	bool writing = false;
+
+	/* YANG notifications received from the main pthread */
+	std::mutex mtx;
+	std::list<frr::Notification> notifications;
+	unsigned long notifications_dropped = 0;
 };
 
+/* Get() call state */
+struct get_state {
+	std::list<std::string> paths;
+
+	/* Position within the current path when paging state data */
+	struct nb_oper_data_cursor cursor;
+};
+
+/* Active subscriptions */
+static std::mutex subscriptions_mtx;
+static std::list<struct subscription *> subscriptions;
+
 class NorthboundImpl;
 
 template <typename Q, typename S> class RpcState : RpcStateBase
@@ -157,6 +207,7 @@ class NorthboundImpl
 		REQUEST_RPC(Execute);
 		REQUEST_RPC_STREAMING(Get);
 		REQUEST_RPC_STREAMING(ListTransactions);
+		REQUEST_RPC_STREAMING(Subscribe);
 
 		zlog_notice("gRPC server listening on %s",
 			    server_address.str().c_str());
@@ -166,8 +217,11 @@ class NorthboundImpl
 		bool ok;
 		while (true) {
 			_cq->Next(&tag, &ok);
-			GPR_ASSERT(ok);
-			static_cast<RpcStateBase *>(tag)->doCallback();
+
+			auto rpc = static_cast<RpcStateBase *>(tag);
+			GPR_ASSERT(ok || rpc->cq_may_fail);
+			rpc->cq_ok = ok;
+			rpc->doCallback();
 			tag = nullptr;
 		}
 	}
@@ -223,11 +277,11 @@ class NorthboundImpl
 	{
 		switch (tag->state) {
 		case CREATE: {
-			auto mypaths = new std::list<std::string>();
-			tag->context = mypaths;
+			auto get = new get_state();
+			tag->context = get;
 			auto paths = tag->request.path();
 			for (const std::string &path : paths) {
-				mypaths->push_back(std::string(path));
+				get->paths.push_back(std::string(path));
 			}
 			REQUEST_RPC_STREAMING(Get);
 			tag->state = PROCESS;
@@ -239,14 +293,18 @@ class NorthboundImpl
 			frr::Encoding encoding = tag->request.encoding();
 			// Request: bool with_defaults = 3;
 			bool with_defaults = tag->request.with_defaults();
+			// Request: uint32 page_size = 5;
+			uint32_t page_size = tag->request.page_size();
 
 			if (nb_dbg_client_grpc)
 				zlog_debug(
-					"received RPC Get(type: %u, encoding: %u, with_defaults: %u)",
-					type, encoding, with_defaults);
+					"received RPC Get(type: %u, encoding: %u, with_defaults: %u, page_size: %u)",
+					type, encoding, with_defaults,
+					page_size);
 
-			auto mypaths = static_cast<std::list<std::string> *>(
+			auto get = static_cast<struct get_state *>(
 				tag->context);
+			auto mypaths = &get->paths;
 
 			if (mypaths->empty()) {
 				tag->async_responder.Finish(grpc::Status::OK,
@@ -265,9 +323,20 @@ class NorthboundImpl
 			// Response: DataTree data = 2;
 			auto *data = response.mutable_data();
 			data->set_encoding(tag->request.encoding());
-			status = get_path(data, mypaths->back().c_str(), type,
-					  encoding2lyd_format(encoding),
-					  with_defaults);
+			if (page_size
+			    && type == frr::GetRequest_DataType_STATE)
+				status = get_path_state_page(
+					data, mypaths->back(), &get->cursor,
+					page_size,
+					encoding2lyd_format(encoding),
+					with_defaults);
+			else {
+				status = get_path(data,
+						  mypaths->back().c_str(), type,
+						  encoding2lyd_format(encoding),
+						  with_defaults);
+				get->cursor.done = true;
+			}
 
 			// Something went wrong...
 			if (!status.ok()) {
@@ -278,7 +347,11 @@ class NorthboundImpl
 				return;
 			}
 
-			mypaths->pop_back();
+			// Move on to the next path once this one is complete.
+			if (get->cursor.done) {
+				mypaths->pop_back();
+				memset(&get->cursor, 0, sizeof(get->cursor));
+			}
 
 			tag->async_responder.Write(response, tag);
 
@@ -288,8 +361,7 @@ class NorthboundImpl
 			if (nb_dbg_client_grpc)
 				zlog_debug("received RPC Get() end");
 
-			delete static_cast<std::list<std::string> *>(
-				tag->context);
+			delete static_cast<struct get_state *>(tag->context);
 			delete tag;
 		}
 	}
@@ -1052,6 +1124,94 @@ class NorthboundImpl
 		}
 	}
 
+	void HandleSubscribe(RpcState<frr::SubscribeRequest,
+				      frr::SubscribeResponse> *tag)
+	{
+		auto sub = static_cast<struct subscription *>(tag->context);
+
+		switch (tag->state) {
+		case CREATE: {
+			REQUEST_RPC_STREAMING(Subscribe);
+
+			// Request: Mode mode = 1;
+			frr::SubscribeRequest_Mode mode = tag->request.mode();
+			// Request: uint32 sample_interval = 2;
+			uint32_t interval = tag->request.sample_interval();
+
+			if (nb_dbg_client_grpc)
+				zlog_debug(
+					"received RPC Subscribe(mode: %u, sample_interval: %u)",
+					mode, interval);
+
+			if (interval == 0)
+				interval = GRPC_SUBSCRIBE_INTERVAL_DFLT;
+			else if (interval < GRPC_SUBSCRIBE_INTERVAL_MIN)
+				interval = GRPC_SUBSCRIBE_INTERVAL_MIN;
+
+			sub = new subscription;
+			sub->mode = mode;
+			sub->interval = std::chrono::milliseconds(interval);
+			sub->next_sample = std::chrono::steady_clock::now();
+
+			// Request: repeated string path = 3;
+			for (const std::string &path : tag->request.path())
+				sub->paths.push_back(path);
+
+			tag->context = sub;
+			tag->cq_may_fail = true;
+
+			if (sub->paths.empty()) {
+				tag->async_responder.Finish(
+					grpc::Status(grpc::StatusCode::
+							     INVALID_ARGUMENT,
+						     "No data path given"),
+					tag);
+				tag->state = FINISH;
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(
+					subscriptions_mtx);
+				subscriptions.push_back(sub);
+			}
+
+			tag->state = PROCESS;
+			subscription_update(tag, sub);
+			break;
+		}
+		case PROCESS:
+			// The client went away.
+			if (!tag->cq_ok || tag->ctx.IsCancelled()) {
+				tag->async_responder.Finish(
+					grpc::Status::CANCELLED, tag);
+				tag->state = FINISH;
+				return;
+			}
+
+			// Last update was sent, wait for the next one.
+			if (sub->writing) {
+				sub->writing = false;
+				subscription_wait(tag, sub);
+				return;
+			}
+
+			subscription_update(tag, sub);
+			break;
+		case FINISH:
+			if (nb_dbg_client_grpc)
+				zlog_debug("received RPC Subscribe() end");
+
+			{
+				std::lock_guard<std::mutex> lock(
+					subscriptions_mtx);
+				subscriptions.remove(sub);
+			}
+			delete sub;
+			delete tag;
+		}
+	}
+
       private:
 	frr::Northbound::AsyncService *_service;
 	grpc::ServerCompletionQueue *_cq;
@@ -1120,6 +1280,136 @@ class NorthboundImpl
 		return (ret == 0) ? NB_OK : NB_ERR;
 	}
 
+	static int subscription_sample_cb(const struct lys_node *snode,
+					  struct yang_translator *translator,
+					  struct yang_data *data, void *arg)
+	{
+		auto sample =
+			static_cast<std::map<std::string, std::string> *>(arg);
+
+		(*sample)[data->xpath] = data->value ? data->value : "";
+		yang_data_free(data);
+
+		return NB_OK;
+	}
+
+	void subscription_wait(RpcState<frr::SubscribeRequest,
+					frr::SubscribeResponse> *tag,
+			       struct subscription *sub)
+	{
+		auto deadline = std::chrono::system_clock::now()
+				+ std::chrono::milliseconds(
+					GRPC_SUBSCRIBE_TICK);
+
+		sub->alarm.Set(_cq, deadline, tag);
+	}
+
+	//
+	// Sample the subscribed state data and add it to the response, or
+	// only the differences with the previous sample in ON_CHANGE mode.
+	// Returns whether there's anything to send.
+	//
+	static bool subscription_sample(struct subscription *sub,
+					frr::SubscribeResponse *response)
+	{
+		std::map<std::string, std::string> sample;
+
+		for (const std::string &path : sub->paths) {
+			if (nb_oper_data_iterate(path.c_str(), NULL, 0,
+						 subscription_sample_cb,
+						 &sample)
+			    != NB_OK)
+				flog_warn(EC_LIB_NB_OPERATIONAL_DATA,
+					  "%s: failed to fetch operational data [xpath %s]",
+					  __func__, path.c_str());
+		}
+
+		if (sub->mode == frr::SubscribeRequest_Mode_SAMPLE) {
+			for (auto &it : sample) {
+				frr::PathValue *pv = response->add_update();
+				pv->set_path(it.first);
+				pv->set_value(it.second);
+			}
+			return true;
+		}
+
+		bool changed = false;
+
+		for (auto &it : sample) {
+			auto cached = sub->cache.find(it.first);
+
+			if (cached != sub->cache.end()
+			    && cached->second == it.second)
+				continue;
+
+			frr::PathValue *pv = response->add_update();
+			pv->set_path(it.first);
+			pv->set_value(it.second);
+			changed = true;
+		}
+		for (auto &it : sub->cache) {
+			if (sample.count(it.first))
+				continue;
+
+			response->add_removed(it.first);
+			changed = true;
+		}
+		sub->cache.swap(sample);
+
+		if (!sub->synced) {
+			sub->synced = true;
+			response->set_sync_response(true);
+			return true;
+		}
+
+		return changed;
+	}
+
+	void subscription_update(RpcState<frr::SubscribeRequest,
+					  frr::SubscribeResponse> *tag,
+				 struct subscription *sub)
+	{
+		frr::SubscribeResponse response;
+		auto now = std::chrono::steady_clock::now();
+		bool send = false;
+
+		// Response: repeated Notification notification = 4;
+		{
+			std::lock_guard<std::mutex> lock(sub->mtx);
+
+			for (auto &notification : sub->notifications)
+				*response.add_notification() = notification;
+			send = !sub->notifications.empty();
+			sub->notifications.clear();
+
+			if (sub->notifications_dropped) {
+				zlog_warn("%s: dropped %lu YANG notifications",
+					  __func__, sub->notifications_dropped);
+				sub->notifications_dropped = 0;
+			}
+		}
+
+		// Response: repeated PathValue update = 2;
+		// Response: repeated string removed = 3;
+		// Response: bool sync_response = 5;
+		if (now >= sub->next_sample) {
+			sub->next_sample = now + sub->interval;
+			if (subscription_sample(sub, &response))
+				send = true;
+		}
+
+		if (!send) {
+			subscription_wait(tag, sub);
+			return;
+		}
+
+		// Response: int64 timestamp = 1;
+		response.set_timestamp(time(NULL));
+
+		sub->writing = true;
+		tag->async_responder.Write(response, tag);
+	}
+
 	static void list_transactions_cb(void *arg, int transaction_id,
 					 const char *client_name,
 					 const char *date, const char *comment)
@@ -1278,6 +1568,41 @@ class NorthboundImpl
 		return grpc::Status::OK;
 	}
 
+	//
+	// Fetch one page of the state data of a YANG list, so that large lists
+	// are sent over several responses instead of being dumped at once.
+	//
+	static grpc::Status
+	get_path_state_page(frr::DataTree *dt, const std::string &path,
+			    struct nb_oper_data_cursor *cursor,
+			    uint32_t page_size, LYD_FORMAT lyd_format,
+			    bool with_defaults)
+	{
+		struct lyd_node *dnode;
+
+		dnode = yang_dnode_new(ly_native_ctx, false);
+		if (nb_oper_data_iterate_page(path.c_str(), NULL, 0, cursor,
+					      page_size, get_oper_data_cb,
+					      dnode)
+		    != NB_OK) {
+			yang_dnode_free(dnode);
+			return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+					    "Failed to fetch operational data");
+		}
+
+		lyd_validate(&dnode, LYD_OPT_DATA | LYD_OPT_DATA_NO_YANGLIB,
+			     ly_native_ctx);
+
+		int ret = data_tree_from_dnode(dt, dnode, lyd_format,
+					       with_defaults);
+		yang_dnode_free(dnode);
+		if (ret != 0)
+			return grpc::Status(grpc::StatusCode::INTERNAL,
+					    "Failed to dump data");
+
+		return grpc::Status::OK;
+	}
+
 	struct candidate *create_candidate(void)
 	{
 		uint32_t candidate_id = ++_nextCandidateId;
@@ -1346,6 +1671,54 @@ static int frr_grpc_init(unsigned long *port)
 	return 0;
 }
 
+/*
+ * Queue YANG notifications for the subscriptions covering their YANG module.
+ * Runs in the main pthread, the gRPC pthread sends them out.
+ */
+static int frr_grpc_notification_send(const char *xpath,
+				      struct list *arguments)
+{
+	std::string module(xpath, strcspn(xpath, ":"));
+	std::lock_guard<std::mutex> lock(subscriptions_mtx);
+
+	for (auto sub : subscriptions) {
+		bool match = false;
+
+		for (const std::string &path : sub->paths)
+			if (path.compare(0, path.find(':'), module) == 0) {
+				match = true;
+				break;
+			}
+		if (!match)
+			continue;
+
+		std::lock_guard<std::mutex> sub_lock(sub->mtx);
+
+		if (sub->notifications.size() >= GRPC_SUBSCRIBE_QUEUE_MAX) {
+			sub->notifications_dropped++;
+			continue;
+		}
+
+		frr::Notification notification;
+		notification.set_path(xpath);
+		if (arguments) {
+			struct listnode *node;
+			struct yang_data *data;
+
+			for (ALL_LIST_ELEMENTS_RO(arguments, node, data)) {
+				frr::PathValue *pv =
+					notification.add_arguments();
+				pv->set_path(data->xpath);
+				if (data->value)
+					pv->set_value(data->value);
+			}
+		}
+		sub->notifications.push_back(notification);
+	}
+
+	return 0;
+}
+
 static int frr_grpc_finish(void)
 {
 	if (fpt)
@@ -1399,6 +1772,7 @@ static int frr_grpc_module_late_init(struct thread_master *tm)
 {
 	thread_add_event(tm, frr_grpc_module_very_late_init, NULL, 0, NULL);
 	hook_register(frr_fini, frr_grpc_finish);
+	hook_register(nb_notification_send, frr_grpc_notification_send);
 
 	return 0;
 }
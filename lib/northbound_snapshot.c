@@ -0,0 +1,427 @@
+/*
+ * Binary configuration snapshots
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "log.h"
+#include "lib_errors.h"
+#include "buffer.h"
+#include "hash.h"
+#include "sha256.h"
+#include "vty.h"
+#include "northbound.h"
+#include "northbound_cli.h"
+#include "northbound_snapshot.h"
+
+#define NB_SNAPSHOT_MAGIC 0x46525253 /* "FRRS" */
+#define NB_SNAPSHOT_VERSION 1
+
+/* Nesting of CLI nodes that is tracked to find context lines. */
+#define NB_SNAPSHOT_MAXDEPTH 8
+
+struct nb_snapshot_hdr {
+	uint32_t magic;
+	uint32_t version;
+	char frr_version[32];
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
+
+	/* Followed by the text part, then the LYB data tree. */
+	uint64_t text_len;
+	uint64_t lyb_len;
+};
+
+bool nb_snapshot_digest_file(FILE *fp, uint8_t digest[NB_SNAPSHOT_DIGEST_LEN])
+{
+	SHA256_CTX ctx;
+	char buf[4096];
+	size_t nread;
+
+	SHA256_Init(&ctx);
+	while ((nread = fread(buf, 1, sizeof(buf), fp)) > 0)
+		SHA256_Update(&ctx, buf, nread);
+	SHA256_Final(digest, &ctx);
+
+	if (ferror(fp))
+		return false;
+
+	rewind(fp);
+	return true;
+}
+
+bool nb_snapshot_digest_path(const char *path,
+			     uint8_t digest[NB_SNAPSHOT_DIGEST_LEN])
+{
+	FILE *fp;
+	bool ret;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return false;
+
+	ret = nb_snapshot_digest_file(fp, digest);
+	fclose(fp);
+	return ret;
+}
+
+const char *nb_snapshot_digest2str(const uint8_t *digest, char *buf,
+				   size_t len)
+{
+	assert(len >= NB_SNAPSHOT_DIGEST_STRLEN);
+
+	for (size_t i = 0; i < NB_SNAPSHOT_DIGEST_LEN; i++)
+		snprintf(buf + 2 * i, len - 2 * i, "%02x", digest[i]);
+	return buf;
+}
+
+bool nb_snapshot_str2digest(const char *str,
+			    uint8_t digest[NB_SNAPSHOT_DIGEST_LEN])
+{
+	unsigned int byte;
+
+	if (strlen(str) != 2 * NB_SNAPSHOT_DIGEST_LEN)
+		return false;
+
+	for (size_t i = 0; i < NB_SNAPSHOT_DIGEST_LEN; i++) {
+		if (!isxdigit((unsigned char)str[2 * i])
+		    || !isxdigit((unsigned char)str[2 * i + 1])
+		    || sscanf(str + 2 * i, "%2x", &byte) != 1)
+			return false;
+		digest[i] = byte;
+	}
+	return true;
+}
+
+/*
+ * Finding the commands that aren't northbound-based.
+ *
+ * The text configuration is compared to what the northbound cli_show
+ * callbacks print for the running configuration.  Lines are identified by
+ * their content together with their enclosing node lines (by indentation),
+ * so " network 10.0.0.0/8" under "router rip" doesn't match the same line
+ * under "router ospf".  Lines printed by the northbound are dropped, except
+ * when they open a node that also contains other commands.
+ */
+struct nb_snapshot_parent {
+	const char *line;
+	int indent;
+	bool emitted;
+};
+
+/* Indentation of a line, or -1 if it doesn't carry configuration. */
+static int nb_snapshot_indent(const char *line)
+{
+	int indent = 0;
+
+	while (line[indent] == ' ')
+		indent++;
+	if (line[indent] == '\0' || line[indent] == '!')
+		return -1;
+	return indent;
+}
+
+static char *nb_snapshot_key(const struct nb_snapshot_parent *stack,
+			     int depth, const char *line)
+{
+	size_t len = strlen(line) + 1;
+	char *key, *pos;
+
+	for (int i = 0; i < depth; i++)
+		len += strlen(stack[i].line) + 1;
+
+	pos = key = XMALLOC(MTYPE_TMP, len);
+	for (int i = 0; i < depth; i++)
+		pos += sprintf(pos, "%s\n", stack[i].line);
+	strcpy(pos, line);
+
+	return key;
+}
+
+static unsigned int nb_snapshot_key_hash(const void *arg)
+{
+	return string_hash_make(arg);
+}
+
+static bool nb_snapshot_key_cmp(const void *a, const void *b)
+{
+	return !strcmp(a, b);
+}
+
+static void nb_snapshot_key_free(void *arg)
+{
+	XFREE(MTYPE_TMP, arg);
+}
+
+/*
+ * Walk all lines of text (modified in place).  Without residue, record
+ * them as northbound lines in keys; otherwise, copy everything that isn't
+ * a northbound line to residue.
+ */
+static void nb_snapshot_lines(char *text, struct hash *keys,
+			      struct buffer *residue)
+{
+	struct nb_snapshot_parent stack[NB_SNAPSHOT_MAXDEPTH];
+	int depth = 0;
+	char *line, *next;
+
+	for (line = text; line; line = next) {
+		bool covered;
+		char *key;
+		int indent;
+
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		indent = nb_snapshot_indent(line);
+		if (indent < 0)
+			continue;
+
+		while (depth > 0 && stack[depth - 1].indent >= indent)
+			depth--;
+
+		key = nb_snapshot_key(stack, depth, line);
+		if (!residue) {
+			if (hash_get(keys, key, hash_alloc_intern) != key)
+				XFREE(MTYPE_TMP, key);
+			covered = true;
+		} else {
+			covered = hash_lookup(keys, key) != NULL;
+			XFREE(MTYPE_TMP, key);
+		}
+
+		if (residue && !covered) {
+			for (int i = 0; i < depth; i++) {
+				if (stack[i].emitted)
+					continue;
+				buffer_putstr(residue, stack[i].line);
+				buffer_putc(residue, '\n');
+				stack[i].emitted = true;
+			}
+			buffer_putstr(residue, line);
+			buffer_putc(residue, '\n');
+		}
+
+		if (depth < NB_SNAPSHOT_MAXDEPTH) {
+			stack[depth].line = line;
+			stack[depth].indent = indent;
+			stack[depth].emitted = !covered;
+			depth++;
+		}
+	}
+}
+
+static char *nb_snapshot_residue(const char *config_text)
+{
+	struct hash *keys;
+	struct lyd_node *root;
+	struct buffer *residue;
+	struct vty *vty;
+	char *nb_text, *text, *ret;
+
+	/* What the northbound prints on its own. */
+	vty = vty_new();
+	vty->type = VTY_FILE;
+	LY_TREE_FOR (running_config->dnode, root)
+		nb_cli_show_dnode_cmds(vty, root, false);
+	nb_text = buffer_getstr(vty->obuf);
+	buffer_reset(vty->obuf);
+	vty_close(vty);
+
+	keys = hash_create(nb_snapshot_key_hash, nb_snapshot_key_cmp,
+			   "Configuration snapshot lines");
+	nb_snapshot_lines(nb_text, keys, NULL);
+
+	text = XSTRDUP(MTYPE_TMP, config_text);
+	residue = buffer_new(0);
+	nb_snapshot_lines(text, keys, residue);
+	ret = buffer_getstr(residue);
+
+	buffer_free(residue);
+	XFREE(MTYPE_TMP, text);
+	hash_clean(keys, nb_snapshot_key_free);
+	hash_free(keys);
+	XFREE(MTYPE_TMP, nb_text);
+
+	return ret;
+}
+
+bool nb_snapshot_write(const char *path, const uint8_t *digest,
+		       const char *config_text)
+{
+	struct nb_snapshot_hdr hdr = {};
+	char *text = NULL, *lyb = NULL;
+	char *path_tmp = NULL;
+	size_t path_tmp_sz;
+	int fd = -1;
+	bool ret = false;
+
+	if (!path || !path[0])
+		return false;
+
+	text = nb_snapshot_residue(config_text);
+	if (running_config->dnode
+	    && lyd_print_mem(&lyb, running_config->dnode, LYD_LYB,
+			     LYP_WITHSIBLINGS)
+		       != 0) {
+		flog_warn(EC_LIB_NB_SNAPSHOT,
+			  "%s: failed to encode the running configuration",
+			  __func__);
+		goto out;
+	}
+
+	hdr.magic = NB_SNAPSHOT_MAGIC;
+	hdr.version = NB_SNAPSHOT_VERSION;
+	strlcpy(hdr.frr_version, FRR_VERSION, sizeof(hdr.frr_version));
+	memcpy(hdr.digest, digest, sizeof(hdr.digest));
+	hdr.text_len = strlen(text);
+	hdr.lyb_len = lyb ? lyd_lyb_data_length(lyb) : 0;
+
+	path_tmp_sz = strlen(path) + 8;
+	path_tmp = XMALLOC(MTYPE_TMP, path_tmp_sz);
+	snprintf(path_tmp, path_tmp_sz, "%s.XXXXXX", path);
+
+	fd = mkstemp(path_tmp);
+	if (fd < 0) {
+		flog_warn(EC_LIB_NB_SNAPSHOT, "%s: can't create %s: %s",
+			  __func__, path_tmp, safe_strerror(errno));
+		goto out;
+	}
+
+	if (fchmod(fd, CONFIGFILE_MASK) != 0
+	    || write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+	    || write(fd, text, hdr.text_len) != (ssize_t)hdr.text_len
+	    || write(fd, lyb, hdr.lyb_len) != (ssize_t)hdr.lyb_len
+	    || fsync(fd) != 0) {
+		flog_warn(EC_LIB_NB_SNAPSHOT, "%s: can't write %s: %s",
+			  __func__, path_tmp, safe_strerror(errno));
+		goto out;
+	}
+
+	if (rename(path_tmp, path) != 0) {
+		flog_warn(EC_LIB_NB_SNAPSHOT, "%s: can't rename %s to %s: %s",
+			  __func__, path_tmp, path, safe_strerror(errno));
+		goto out;
+	}
+	ret = true;
+
+out:
+	if (fd >= 0)
+		close(fd);
+	if (!ret) {
+		if (fd >= 0)
+			unlink(path_tmp);
+		/* a stale snapshot is harmless, but don't keep it around */
+		unlink(path);
+	}
+	XFREE(MTYPE_TMP, path_tmp);
+	XFREE(MTYPE_TMP, text);
+	free(lyb);
+
+	return ret;
+}
+
+char *nb_snapshot_read(const char *path, const uint8_t *digest,
+		       struct nb_config *config, size_t *text_len)
+{
+	struct nb_snapshot_hdr *hdr;
+	struct nb_config *loaded, *merged;
+	struct lyd_node *dnode = NULL;
+	struct stat st;
+	uint8_t *data = NULL;
+	char *text = NULL;
+	int fd;
+
+	if (!path || !path[0])
+		return NULL;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			flog_warn(EC_LIB_NB_SNAPSHOT, "%s: can't open %s: %s",
+				  __func__, path, safe_strerror(errno));
+		return NULL;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(*hdr)) {
+		flog_warn(EC_LIB_NB_SNAPSHOT, "%s: %s is truncated", __func__,
+			  path);
+		goto out;
+	}
+
+	data = XMALLOC(MTYPE_TMP, st.st_size);
+	if (read(fd, data, st.st_size) != st.st_size) {
+		flog_warn(EC_LIB_NB_SNAPSHOT, "%s: can't read %s: %s",
+			  __func__, path, safe_strerror(errno));
+		goto out;
+	}
+
+	hdr = (struct nb_snapshot_hdr *)data;
+	if (hdr->magic != NB_SNAPSHOT_MAGIC
+	    || hdr->version != NB_SNAPSHOT_VERSION
+	    || hdr->text_len > (uint64_t)st.st_size
+	    || hdr->lyb_len > (uint64_t)st.st_size
+	    || sizeof(*hdr) + hdr->text_len + hdr->lyb_len
+		       != (uint64_t)st.st_size) {
+		flog_warn(EC_LIB_NB_SNAPSHOT, "%s: %s is invalid", __func__,
+			  path);
+		goto out;
+	}
+
+	/* Not an error, just not what is about to be loaded. */
+	if (strncmp(hdr->frr_version, FRR_VERSION, sizeof(hdr->frr_version))
+	    || memcmp(hdr->digest, digest, sizeof(hdr->digest))) {
+		zlog_info("%s: %s is stale, ignoring it", __func__, path);
+		goto out;
+	}
+
+	if (hdr->lyb_len) {
+		char errmsg[BUFSIZ];
+
+		dnode = lyd_parse_mem(ly_native_ctx,
+				      (char *)data + sizeof(*hdr)
+					      + hdr->text_len,
+				      LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+		if (!dnode) {
+			flog_warn(EC_LIB_NB_SNAPSHOT,
+				  "%s: can't decode %s: %s", __func__, path,
+				  yang_print_errors(ly_native_ctx, errmsg,
+						    sizeof(errmsg)));
+			goto out;
+		}
+
+		/* Merge into a copy so config stays intact on failure. */
+		loaded = nb_config_new(dnode);
+		merged = nb_config_dup(config);
+		if (nb_config_merge(merged, loaded, false) != NB_OK) {
+			nb_config_free(merged);
+			goto out;
+		}
+		nb_config_replace(config, merged, false);
+	}
+
+	*text_len = hdr->text_len;
+	text = XMALLOC(MTYPE_TMP, hdr->text_len + 1);
+	memcpy(text, data + sizeof(*hdr), hdr->text_len);
+	text[hdr->text_len] = '\0';
+
+out:
+	close(fd);
+	XFREE(MTYPE_TMP, data);
+
+	return text;
+}
@@ -0,0 +1,112 @@
+/*
+ * Binary configuration snapshots
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_NORTHBOUND_SNAPSHOT_H_
+#define _FRR_NORTHBOUND_SNAPSHOT_H_
+
+#include "northbound.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A snapshot is written next to the text configuration every time the
+ * latter is saved, and holds the same configuration in a form that is much
+ * cheaper to load:
+ *
+ * - everything managed by the northbound, as a binary (LYB) data tree that
+ *   is merged into the candidate without going through the CLI;
+ *
+ * - the commands that aren't northbound-based, as text that still needs to
+ *   be parsed, along with just enough context lines to enter their nodes.
+ *
+ * A snapshot is tied to the digest of the text configuration it was taken
+ * with and to the FRR version, so a text configuration that was edited by
+ * hand or a software upgrade silently falls back to parsing the text.
+ */
+
+/* SHA-256 */
+#define NB_SNAPSHOT_DIGEST_LEN 32
+#define NB_SNAPSHOT_DIGEST_STRLEN (2 * NB_SNAPSHOT_DIGEST_LEN + 1)
+
+/*
+ * Compute the digest of a text configuration.  nb_snapshot_digest_file()
+ * reads the whole file and rewinds it.
+ *
+ * Returns:
+ *    true on success, false if the file couldn't be read.
+ */
+extern bool nb_snapshot_digest_file(FILE *fp,
+				    uint8_t digest[NB_SNAPSHOT_DIGEST_LEN]);
+extern bool nb_snapshot_digest_path(const char *path,
+				    uint8_t digest[NB_SNAPSHOT_DIGEST_LEN]);
+
+/* Convert a digest to and from hex, to pass it around in CLI commands. */
+extern const char *nb_snapshot_digest2str(const uint8_t *digest, char *buf,
+					  size_t len);
+extern bool nb_snapshot_str2digest(const char *str,
+				   uint8_t digest[NB_SNAPSHOT_DIGEST_LEN]);
+
+/*
+ * Write a snapshot of the running configuration.
+ *
+ * path
+ *    Snapshot file, replaced atomically.
+ *
+ * digest
+ *    Digest of the text configuration this snapshot stands for.
+ *
+ * config_text
+ *    Text configuration as generated by "write terminal", used to determine
+ *    which commands aren't covered by the northbound data.
+ *
+ * Returns:
+ *    true on success.  On failure, any existing snapshot is removed.
+ */
+extern bool nb_snapshot_write(const char *path, const uint8_t *digest,
+			      const char *config_text);
+
+/*
+ * Load a snapshot if it matches the given text configuration digest.
+ *
+ * path
+ *    Snapshot file.
+ *
+ * digest
+ *    Digest of the text configuration that would be loaded otherwise.
+ *
+ * config
+ *    Candidate configuration the northbound data is merged into.
+ *
+ * text_len
+ *    Length of the returned text.
+ *
+ * Returns:
+ *    The commands that still need to be parsed (MTYPE_TMP, possibly empty),
+ *    or NULL if there is no usable snapshot, in which case config is left
+ *    untouched.
+ */
+extern char *nb_snapshot_read(const char *path, const uint8_t *digest,
+			      struct nb_config *config, size_t *text_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_NORTHBOUND_SNAPSHOT_H_ */
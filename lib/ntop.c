@@ -79,20 +79,14 @@ static inline void puthex(uint16_t word, char **posx)
 
 #undef pos
 
-const char *frr_inet_ntop(int af, const void * restrict src,
-			  char * restrict dst, socklen_t size)
-	__attribute__((flatten)) OPTIMIZE;
+/* writes the address and a terminating NUL to o, which must have room for
+ * 8 * "abcd:" (see below), returns a pointer past the NUL
+ */
+static inline char *ntop_raw(int af, const uint8_t *b, char *o)
+	__attribute__((always_inline)) OPTIMIZE;
 
-const char *frr_inet_ntop(int af, const void * restrict src,
-			  char * restrict dst, socklen_t size)
+static inline char *ntop_raw(int af, const uint8_t *b, char *o)
 {
-	const uint8_t *b = src;
-	/* 8 * "abcd:" for IPv6
-	 * note: the IPv4-embedded IPv6 syntax is only used for ::A.B.C.D,
-	 * which isn't longer than 40 chars either.  even with ::ffff:A.B.C.D
-	 * it's shorter.
-	 */
-	char buf[8 * 5], *o = buf;
 	size_t best = 0, bestlen = 0, curlen = 0, i;
 
 	switch (af) {
@@ -153,6 +147,27 @@ inet4:
 	default:
 		return NULL;
 	}
+	return o;
+}
+
+const char *frr_inet_ntop(int af, const void * restrict src,
+			  char * restrict dst, socklen_t size)
+	__attribute__((flatten)) OPTIMIZE;
+
+const char *frr_inet_ntop(int af, const void * restrict src,
+			  char * restrict dst, socklen_t size)
+{
+	/* 8 * "abcd:" for IPv6
+	 * note: the IPv4-embedded IPv6 syntax is only used for ::A.B.C.D,
+	 * which isn't longer than 40 chars either.  even with ::ffff:A.B.C.D
+	 * it's shorter.
+	 */
+	char buf[8 * 5], *o;
+	size_t i;
+
+	o = ntop_raw(af, src, buf);
+	if (!o)
+		return NULL;
 
 	i = o - buf;
 	if (i > size)
@@ -165,6 +180,16 @@ inet4:
 	return dst;
 }
 
+char *frr_inet_ntop_end(int af, const void *src, char *dst)
+	__attribute__((flatten)) OPTIMIZE;
+
+char *frr_inet_ntop_end(int af, const void *src, char *dst)
+{
+	char *o = ntop_raw(af, src, dst);
+
+	return o ? o - 1 : NULL;
+}
+
 #if !defined(INET_NTOP_NO_OVERRIDE) && !defined(__APPLE__)
 /* we want to override libc inet_ntop, but make sure it shows up in backtraces
  * as frr_inet_ntop (to avoid confusion while debugging)
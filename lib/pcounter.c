@@ -0,0 +1,90 @@
+/*
+ * Per-pthread statistics counters
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "pcounter.h"
+#include "vty.h"
+#include "json.h"
+
+DECLARE_DLIST(pcounters, struct pcounter, item);
+
+thread_local unsigned int pcounter_tls_slot;
+
+static atomic_uint_fast32_t pcounter_next_slot;
+
+static struct pcounters_head pcounters = INIT_DLIST(pcounters);
+
+unsigned int pcounter_slot_assign(void)
+{
+	unsigned int slot;
+
+	/* round robin, the first pthread to count (main) gets slot 0 */
+	slot = atomic_fetch_add_explicit(&pcounter_next_slot, 1,
+					 memory_order_relaxed);
+	pcounter_tls_slot = slot % PCOUNTER_SLOTS + 1;
+	return pcounter_tls_slot;
+}
+
+uint64_t pcounter_read(const struct pcounter *pc)
+{
+	uint64_t sum = 0;
+
+	for (unsigned int i = 0; i < PCOUNTER_SLOTS; i++)
+		sum += atomic_load_explicit(&pc->slot[i].val,
+					    memory_order_relaxed);
+	return sum;
+}
+
+void pcounter_register(struct pcounter *pc, const char *name)
+{
+	pc->name = name;
+	pcounters_add_tail(&pcounters, pc);
+}
+
+void pcounter_unregister(struct pcounter *pc)
+{
+	pcounters_del(&pcounters, pc);
+}
+
+void pcounter_show(struct vty *vty, bool json)
+{
+	struct json_object *json_counters = NULL;
+	struct pcounter *pc;
+
+	if (json)
+		json_counters = json_object_new_object();
+	else
+		vty_out(vty, "%-40s %20s\n", "Counter", "Value");
+
+	frr_each (pcounters, &pcounters, pc) {
+		if (json)
+			json_object_int_add(json_counters, pc->name,
+					    pcounter_read(pc));
+		else
+			vty_out(vty, "%-40s %20" PRIu64 "\n", pc->name,
+				pcounter_read(pc));
+	}
+
+	if (json) {
+		vty_out(vty, "%s\n",
+			json_object_to_json_string_ext(
+				json_counters, JSON_C_TO_STRING_PRETTY));
+		json_object_free(json_counters);
+	}
+}
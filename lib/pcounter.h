@@ -0,0 +1,93 @@
+/*
+ * Per-pthread statistics counters
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_PCOUNTER_H
+#define _FRR_PCOUNTER_H
+
+#include "frratomic.h"
+#include "typesafe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+struct vty;
+
+/* pthreads beyond this many share slots, which is still correct */
+#define PCOUNTER_SLOTS 16
+#define PCOUNTER_ALIGN 64
+
+struct pcounter_slot {
+	_Atomic uint64_t val;
+} __attribute__((aligned(PCOUNTER_ALIGN)));
+
+PREDECL_DLIST(pcounters)
+
+/*
+ * An event counter for hot paths that are hit from several pthreads.
+ * Each pthread adds to its own slot, on a cache line of its own, with
+ * relaxed atomics; reading sums up the slots.  Counters are meant to be
+ * static (heap memory does not give the full alignment) and are
+ * zero-initialized.  Once registered with pcounter_register() they are
+ * listed by "show counters".
+ */
+struct pcounter {
+	struct pcounter_slot slot[PCOUNTER_SLOTS];
+
+	const char *name;
+	struct pcounters_item item;
+};
+
+/* Slot of the calling pthread, plus one; 0 until assigned */
+extern thread_local unsigned int pcounter_tls_slot;
+extern unsigned int pcounter_slot_assign(void);
+
+static inline void pcounter_add(struct pcounter *pc, uint64_t n)
+{
+	unsigned int slot = pcounter_tls_slot;
+
+	if (slot == 0)
+		slot = pcounter_slot_assign();
+
+	atomic_fetch_add_explicit(&pc->slot[slot - 1].val, n,
+				  memory_order_relaxed);
+}
+
+static inline void pcounter_inc(struct pcounter *pc)
+{
+	pcounter_add(pc, 1);
+}
+
+/* Sum over all slots; concurrent increments may or may not be seen */
+extern uint64_t pcounter_read(const struct pcounter *pc);
+
+/* (Un)list a counter in "show counters", main pthread only */
+extern void pcounter_register(struct pcounter *pc, const char *name);
+extern void pcounter_unregister(struct pcounter *pc);
+
+extern void pcounter_show(struct vty *vty, bool json);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_PCOUNTER_H */
@@ -28,6 +28,7 @@
 #include "buffer.h"
 #include "log.h"
 #include "routemap.h"
+#include "table.h"
 #include "lib/json.h"
 #include "libfrr.h"
 
@@ -46,10 +47,7 @@ DEFINE_MTYPE_STATIC(LIB, PREFIX_LIST_TRIE, "Prefix List Trie Table")
 #define PLC_MAXLEVEL	4	/* max(v4,v6) */
 
 struct pltrie_entry {
-	union {
-		struct pltrie_table *next_table;
-		struct prefix_list_entry *final_chain;
-	};
+	struct pltrie_table *next_table;
 
 	struct prefix_list_entry *up_chain;
 };
@@ -342,6 +340,8 @@ void prefix_list_delete(struct prefix_list *plist)
 	XFREE(MTYPE_MPREFIX_LIST_STR, plist->name);
 
 	XFREE(MTYPE_PREFIX_LIST_TRIE, plist->trie);
+	if (plist->longer)
+		route_table_finish(plist->longer);
 
 	prefix_list_free(plist);
 }
@@ -435,6 +435,76 @@ prefix_list_entry_lookup(struct prefix_list *plist, struct prefix *prefix,
 	return NULL;
 }
 
+/* Entries longer than trie_depth bytes would all end up in one chain per
+ * last-level trie slot, and with large lists of e.g. /24s that chain gets
+ * long.  So these go into a route_table instead, where the entries that
+ * can match a prefix are all on the path from the root to its longest
+ * match.  rn->info is a chain (linked through next_best) of the entries
+ * with that exact prefix, ordered by sequence number.
+ */
+static bool prefix_list_is_longer(struct prefix_list *plist,
+				  const struct prefix *p)
+{
+	return p->prefixlen > plist->master->trie_depth * PLC_BITS;
+}
+
+static void prefix_list_longer_add(struct prefix_list *plist,
+				   struct prefix_list_entry *pentry)
+{
+	struct prefix_list_entry *prev = NULL, *pos;
+	struct route_node *rn;
+
+	if (!plist->longer)
+		plist->longer = route_table_init();
+
+	rn = route_node_get(plist->longer, &pentry->prefix);
+	if (rn->info)
+		route_unlock_node(rn);
+
+	for (pos = rn->info; pos; prev = pos, pos = pos->next_best) {
+		if (pos == pentry)
+			return;
+		if (pos->seq > pentry->seq)
+			break;
+	}
+
+	pentry->next_best = pos;
+	if (prev)
+		prev->next_best = pentry;
+	else
+		rn->info = pentry;
+}
+
+static void prefix_list_longer_del(struct prefix_list *plist,
+				   struct prefix_list_entry *pentry)
+{
+	struct prefix_list_entry *prev = NULL, *pos;
+	struct route_node *rn;
+
+	if (!plist->longer)
+		return;
+
+	rn = route_node_lookup(plist->longer, &pentry->prefix);
+	if (!rn)
+		return;
+	route_unlock_node(rn);
+
+	for (pos = rn->info; pos; prev = pos, pos = pos->next_best)
+		if (pos == pentry)
+			break;
+	if (!pos)
+		return;
+
+	if (prev)
+		prev->next_best = pentry->next_best;
+	else
+		rn->info = pentry->next_best;
+	pentry->next_best = NULL;
+
+	if (!rn->info)
+		route_unlock_node(rn);
+}
+
 static void trie_walk_affected(size_t validbits, struct pltrie_table *table,
 			       uint8_t byte, struct prefix_list_entry *object,
 			       void (*fn)(struct prefix_list_entry *object,
@@ -443,11 +513,6 @@ static void trie_walk_affected(size_t validbits, struct pltrie_table *table,
 	uint8_t mask;
 	uint16_t bwalk;
 
-	if (validbits > PLC_BITS) {
-		fn(object, &table->entries[byte].final_chain);
-		return;
-	}
-
 	mask = (1 << (8 - validbits)) - 1;
 	for (bwalk = byte & ~mask; bwalk <= byte + mask; bwalk++) {
 		fn(object, &table->entries[bwalk].up_chain);
@@ -481,6 +546,11 @@ static void prefix_list_trie_del(struct prefix_list *plist,
 	size_t validbits = pentry->prefix.prefixlen;
 	struct pltrie_table *table, **tables[PLC_MAXLEVEL];
 
+	if (prefix_list_is_longer(plist, &pentry->prefix)) {
+		prefix_list_longer_del(plist, pentry);
+		return;
+	}
+
 	table = plist->trie;
 	for (depth = 0; validbits > PLC_BITS && depth < maxdepth - 1; depth++) {
 		uint8_t byte = bytes[depth];
@@ -570,6 +640,11 @@ static void prefix_list_trie_add(struct prefix_list *plist,
 	size_t validbits = pentry->prefix.prefixlen;
 	struct pltrie_table *table;
 
+	if (prefix_list_is_longer(plist, &pentry->prefix)) {
+		prefix_list_longer_add(plist, pentry);
+		return;
+	}
+
 	table = plist->trie;
 	while (validbits > PLC_BITS && depth > 1) {
 		if (!table->entries[*bytes].next_table)
@@ -814,6 +889,30 @@ static int prefix_list_entry_match(struct prefix_list_entry *pentry,
 	return 1;
 }
 
+static struct prefix_list_entry *
+prefix_list_longer_match(struct prefix_list *plist, const struct prefix *p,
+			 struct prefix_list_entry *pbest)
+{
+	struct prefix_list_entry *pentry;
+	struct route_node *match, *rn;
+
+	match = route_node_match(plist->longer, p);
+
+	for (rn = match; rn; rn = rn->parent)
+		for (pentry = rn->info; pentry; pentry = pentry->next_best) {
+			if (pbest && pbest->seq < pentry->seq)
+				break;
+			if (prefix_list_entry_match(pentry, p)) {
+				pbest = pentry;
+				break;
+			}
+		}
+
+	if (match)
+		route_unlock_node(match);
+	return pbest;
+}
+
 enum prefix_list_type prefix_list_apply_which_prefix(
 	struct prefix_list *plist,
 	const struct prefix **which,
@@ -862,17 +961,12 @@ enum prefix_list_type prefix_list_apply_which_prefix(
 			byte++;
 			continue;
 		}
-
-		for (pentry = table->entries[*byte].final_chain; pentry;
-		     pentry = pentry->next_best) {
-			if (pbest && pbest->seq < pentry->seq)
-				continue;
-			if (prefix_list_entry_match(pentry, p))
-				pbest = pentry;
-		}
 		break;
 	}
 
+	if (plist->longer && prefix_list_is_longer(plist, p))
+		pbest = prefix_list_longer_match(plist, p, pbest);
+
 	if (which) {
 		if (pbest)
 			*which = &pbest->prefix;
@@ -931,6 +1025,19 @@ prefix_entry_dup_check(struct prefix_list *plist, struct prefix_list_entry *new)
 	else
 		seq = new->seq;
 
+	if (prefix_list_is_longer(plist, &new->prefix)) {
+		struct route_node *rn;
+
+		if (!plist->longer)
+			return NULL;
+		rn = route_node_lookup(plist->longer, &new->prefix);
+		if (!rn)
+			return NULL;
+		route_unlock_node(rn);
+		pentry = rn->info;
+		goto found;
+	}
+
 	table = plist->trie;
 	for (depth = 0; validbits > PLC_BITS && depth < maxdepth - 1; depth++) {
 		byte = bytes[depth];
@@ -942,11 +1049,9 @@ prefix_entry_dup_check(struct prefix_list *plist, struct prefix_list_entry *new)
 	}
 
 	byte = bytes[depth];
-	if (validbits > PLC_BITS)
-		pentry = table->entries[byte].final_chain;
-	else
-		pentry = table->entries[byte].up_chain;
+	pentry = table->entries[byte].up_chain;
 
+found:
 	for (; pentry; pentry = pentry->next_best) {
 		if (prefix_same(&pentry->prefix, &new->prefix)
 		    && pentry->type == new->type && pentry->le == new->le
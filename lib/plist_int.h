@@ -29,6 +29,7 @@ extern "C" {
 enum prefix_name_type { PREFIX_TYPE_STRING, PREFIX_TYPE_NUMBER };
 
 struct pltrie_table;
+struct route_table;
 
 struct prefix_list {
 	char *name;
@@ -45,6 +46,8 @@ struct prefix_list {
 	struct prefix_list_entry *tail;
 
 	struct pltrie_table *trie;
+	/* entries longer than the trie can hold, see prefix_list_longer_add */
+	struct route_table *longer;
 
 	struct prefix_list *next;
 	struct prefix_list *prev;
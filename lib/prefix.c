@@ -27,7 +27,7 @@
 #include "sockunion.h"
 #include "memory.h"
 #include "log.h"
-#include "jhash.h"
+#include "fhash.h"
 #include "lib_errors.h"
 #include "printfrr.h"
 #include "vxlan.h"
@@ -46,6 +46,68 @@ static const uint8_t maskbit[] = {0x00, 0x80, 0xc0, 0xe0, 0xf0,
 
 #define MASKBIT(offset)  ((0xff << (PNBBY - (offset))) & 0xff)
 
+/* Fast paths for IPv4/IPv6 addresses.  These compare network-order 32-bit
+ * words rather than single bytes;  plen must not exceed the address length.
+ */
+static inline uint32_t addr_word(const uint8_t *addr, unsigned int i)
+{
+	uint32_t val;
+
+	memcpy(&val, addr + i * sizeof(val), sizeof(val));
+	return val;
+}
+
+/* network byte order mask for the first 1-31 bits of a word */
+static inline uint32_t addr_word_mask(unsigned int plen)
+{
+	return htonl(0xffffffffU << (32 - plen));
+}
+
+static inline bool addr_bits_same(const uint8_t *a1, const uint8_t *a2,
+				  unsigned int plen)
+{
+	unsigned int i;
+
+	for (i = 0; plen >= 32; i++, plen -= 32)
+		if (addr_word(a1, i) != addr_word(a2, i))
+			return false;
+	if (!plen)
+		return true;
+	return !((addr_word(a1, i) ^ addr_word(a2, i)) & addr_word_mask(plen));
+}
+
+static inline int addr_bits_cmp(const uint8_t *a1, const uint8_t *a2,
+				unsigned int plen)
+{
+	uint32_t w1, w2;
+	unsigned int i;
+
+	for (i = 0; plen >= 32; i++, plen -= 32) {
+		w1 = addr_word(a1, i);
+		w2 = addr_word(a2, i);
+		if (w1 != w2)
+			return numcmp(ntohl(w1), ntohl(w2));
+	}
+	if (!plen)
+		return 0;
+
+	w1 = addr_word(a1, i) & addr_word_mask(plen);
+	w2 = addr_word(a2, i) & addr_word_mask(plen);
+	return numcmp(ntohl(w1), ntohl(w2));
+}
+
+/* address length in bits if the fast paths above can be used, else 0 */
+static inline unsigned int addr_fast_bits(uint8_t family)
+{
+	switch (family) {
+	case AF_INET:
+		return IPV4_MAX_BITLEN;
+	case AF_INET6:
+		return IPV6_MAX_BITLEN;
+	}
+	return 0;
+}
+
 int is_zero_mac(const struct ethaddr *mac)
 {
 	int i = 0;
@@ -187,6 +249,9 @@ int prefix_match(const struct prefix *n, const struct prefix *p)
 	if (n->prefixlen > p->prefixlen)
 		return 0;
 
+	if (n->prefixlen <= addr_fast_bits(n->family))
+		return addr_bits_same(n->u.val, p->u.val, n->prefixlen);
+
 	if (n->family == AF_FLOWSPEC) {
 		/* prefixlen is unused. look at fs prefix len */
 		if (n->u.prefix_flowspec.family !=
@@ -259,6 +324,9 @@ int evpn_type5_prefix_match(const struct prefix *n, const struct prefix *p)
 	if (prefixlen > p->prefixlen)
 		return 0;
 
+	if (prefixlen <= addr_fast_bits(p->family))
+		return addr_bits_same(np, pp, prefixlen);
+
 	offset = prefixlen / PNBBY;
 	shift = prefixlen % PNBBY;
 
@@ -285,6 +353,9 @@ int prefix_match_network_statement(const struct prefix *n,
 	np = n->u.val;
 	pp = p->u.val;
 
+	if (n->prefixlen <= addr_fast_bits(n->family))
+		return addr_bits_same(np, pp, n->prefixlen);
+
 	offset = n->prefixlen / PNBBY;
 	shift = n->prefixlen % PNBBY;
 
@@ -445,6 +516,10 @@ int prefix_cmp(union prefixconstptr up1, union prefixconstptr up2)
 
 	if (p1->prefixlen != p2->prefixlen)
 		return numcmp(p1->prefixlen, p2->prefixlen);
+
+	if (p1->prefixlen <= addr_fast_bits(p1->family))
+		return addr_bits_cmp(pp1, pp2, p1->prefixlen);
+
 	offset = p1->prefixlen / PNBBY;
 	shift = p1->prefixlen % PNBBY;
 
@@ -1025,27 +1100,29 @@ const char *prefix2str(union prefixconstptr pu, char *str, int size)
 	char buf[PREFIX2STR_BUFFER];
 	int byte, tmp, a, b;
 	bool z = false;
-	size_t l;
+	char *o;
 
 	switch (p->family) {
 	case AF_INET:
 	case AF_INET6:
-		inet_ntop(p->family, &p->u.prefix, buf, sizeof(buf));
-		l = strlen(buf);
-		buf[l++] = '/';
+		/* format in place if "<address>/128" is sure to fit */
+		o = (size >= INET6_ADDRSTRLEN + 4) ? str : buf;
+		o = frr_inet_ntop_end(p->family, &p->u.prefix, o);
+		*o++ = '/';
 		byte = p->prefixlen;
 		if ((tmp = p->prefixlen - 100) >= 0) {
-			buf[l++] = '1';
+			*o++ = '1';
 			z = true;
 			byte = tmp;
 		}
 		b = byte % 10;
 		a = byte / 10;
 		if (a || z)
-			buf[l++] = '0' + a;
-		buf[l++] = '0' + b;
-		buf[l] = '\0';
-		strlcpy(str, buf, size);
+			*o++ = '0' + a;
+		*o++ = '0' + b;
+		*o = '\0';
+		if (size < INET6_ADDRSTRLEN + 4)
+			strlcpy(str, buf, size);
 		break;
 
 	case AF_ETHERNET:
@@ -1255,8 +1332,21 @@ char *prefix_mac2str(const struct ethaddr *mac, char *buf, int size)
 
 unsigned prefix_hash_key(const void *pp)
 {
+	const struct prefix *p = pp;
 	struct prefix copy;
 
+	/* the common cases need no scrubbed copy, the address bytes up to
+	 * the prefix length are all that's hashed
+	 */
+	if (p->family == AF_INET || p->family == AF_INET6) {
+		struct fhash_state st;
+
+		fhash_init(&st, 0x55aa5a5a);
+		fhash_add_u32x2(&st, p->family, p->prefixlen);
+		fhash_add(&st, &p->u.prefix, PSIZE(p->prefixlen));
+		return fhash_final(&st);
+	}
+
 	if (((struct prefix *)pp)->family == AF_FLOWSPEC) {
 		uint32_t len;
 		void *temp;
@@ -1267,7 +1357,7 @@ unsigned prefix_hash_key(const void *pp)
 		 */
 		memset(&copy, 0, sizeof(copy));
 		prefix_copy(&copy, (struct prefix *)pp);
-		len = jhash((void *)copy.u.prefix_flowspec.ptr,
+		len = fhash((void *)copy.u.prefix_flowspec.ptr,
 			    copy.u.prefix_flowspec.prefixlen,
 			    0x55aa5a5a);
 		temp = (void *)copy.u.prefix_flowspec.ptr;
@@ -1280,7 +1370,7 @@ unsigned prefix_hash_key(const void *pp)
 	 * padding and unused prefix bytes. */
 	memset(&copy, 0, sizeof(copy));
 	prefix_copy(&copy, (struct prefix *)pp);
-	return jhash(&copy,
+	return fhash(&copy,
 		     offsetof(struct prefix, u.prefix) + PSIZE(copy.prefixlen),
 		     0x55aa5a5a);
 }
@@ -1384,7 +1474,10 @@ printfrr_ext_autoreg_p("I4", printfrr_i4)
 static ssize_t printfrr_i4(char *buf, size_t bsz, const char *fmt,
 			   int prec, const void *ptr)
 {
-	inet_ntop(AF_INET, ptr, buf, bsz);
+	if (bsz >= INET6_ADDRSTRLEN)
+		frr_inet_ntop_end(AF_INET, ptr, buf);
+	else
+		inet_ntop(AF_INET, ptr, buf, bsz);
 	return 2;
 }
 
@@ -1392,7 +1485,10 @@ printfrr_ext_autoreg_p("I6", printfrr_i6)
 static ssize_t printfrr_i6(char *buf, size_t bsz, const char *fmt,
 			   int prec, const void *ptr)
 {
-	inet_ntop(AF_INET6, ptr, buf, bsz);
+	if (bsz >= INET6_ADDRSTRLEN)
+		frr_inet_ntop_end(AF_INET6, ptr, buf);
+	else
+		inet_ntop(AF_INET6, ptr, buf, bsz);
 	return 2;
 }
 
@@ -446,6 +446,12 @@ extern void prefix_mcast_inet4_dump(const char *onfail, struct in_addr addr,
 				char *buf, int buf_size);
 extern const char *prefix_sg2str(const struct prefix_sg *sg, char *str);
 extern const char *prefix2str(union prefixconstptr, char *, int);
+
+/* inet_ntop() for callers that have INET6_ADDRSTRLEN bytes of room: writes
+ * straight to dst, without a size check or intermediate copy, and returns
+ * a pointer to the terminating NUL (or NULL for an unknown family).
+ */
+extern char *frr_inet_ntop_end(int af, const void *src, char *dst);
 extern int evpn_type5_prefix_match(const struct prefix *evpn_pfx,
 				   const struct prefix *match_pfx);
 extern int prefix_match(const struct prefix *, const struct prefix *);
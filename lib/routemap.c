@@ -32,6 +32,7 @@
 #include "libfrr.h"
 #include "lib_errors.h"
 #include "table.h"
+#include "jhash.h"
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP, "Route map")
 DEFINE_MTYPE(LIB, ROUTE_MAP_NAME, "Route map name")
@@ -41,6 +42,7 @@ DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_RULE_STR, "Route map rule str")
 DEFINE_MTYPE(LIB, ROUTE_MAP_COMPILED, "Route map compiled")
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP, "Route map dependency")
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP_DATA, "Route map dependency data")
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_CACHE, "Route map match cache")
 
 DEFINE_QOBJ_TYPE(route_map_index)
 DEFINE_QOBJ_TYPE(route_map)
@@ -68,6 +70,24 @@ static vector route_set_vec;
 static void route_map_pfx_tbl_update(route_map_event_t event,
 				     struct route_map_index *index, afi_t afi,
 				     const char *plist_name);
+
+/* Match results memoized by route_map_apply_cached() are only valid for
+ * the generation they were computed in.  Anything that can change the
+ * outcome of match clauses bumps this, which lazily flushes the caches.
+ */
+static uint64_t route_map_cache_gen;
+
+struct route_map_cache_entry {
+	uint64_t key;
+	const void *src;
+	struct prefix prefix;
+
+	/* first index whose match clauses all matched, NULL if none did */
+	struct route_map_index *index;
+	route_map_result_t ret;
+};
+
+#define ROUTE_MAP_CACHE_MAX 65536
 static void route_map_pfx_table_add_default(afi_t afi,
 					    struct route_map_index *index);
 static void route_map_pfx_table_del_default(afi_t afi,
@@ -565,6 +585,16 @@ static void route_map_rule_delete(struct route_map_rule_list *,
 				  struct route_map_rule *);
 static bool rmap_debug;
 
+static void route_map_cache_entry_free(void *arg)
+{
+	XFREE(MTYPE_ROUTE_MAP_CACHE, arg);
+}
+
+void route_map_cache_invalidate(void)
+{
+	route_map_cache_gen++;
+}
+
 /* New route map allocation. Please note route map's name must be
    specified. */
 static struct route_map *route_map_new(const char *name)
@@ -657,6 +687,10 @@ static void route_map_free_map(struct route_map *map)
 		list->head = map->next;
 
 	hash_release(route_map_master_hash, map);
+	if (map->match_cache) {
+		hash_clean(map->match_cache, route_map_cache_entry_free);
+		hash_free(map->match_cache);
+	}
 	XFREE(MTYPE_ROUTE_MAP_NAME, map->name);
 	XFREE(MTYPE_ROUTE_MAP, map);
 }
@@ -844,6 +878,15 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map)
 		map->optimization_disabled ? "disabled" : "enabled",
 		map->to_be_processed ? "true" : "false");
 
+	if (map->match_cache && map->cache_disabled)
+		vty_out(vty, " Match cache: disabled by match rules\n");
+	else if (map->match_cache)
+		vty_out(vty,
+			" Match cache: %lu entries, %" PRIu64 " hits, %" PRIu64
+			" misses\n",
+			map->match_cache->count, map->cache_hits,
+			map->cache_misses);
+
 	for (index = map->head; index; index = index->next) {
 		vty_out(vty, " %s, sequence %d Invoked %" PRIu64 "\n",
 			route_map_type_str(index->type), index->pref,
@@ -972,6 +1015,7 @@ void route_map_index_delete(struct route_map_index *index, int notify)
 	struct routemap_hook_context *rhc;
 	struct route_map_rule *rule;
 
+	route_map_cache_invalidate();
 	QOBJ_UNREG(index);
 
 	if (rmap_debug)
@@ -1048,6 +1092,8 @@ route_map_index_add(struct route_map *map, enum route_map_type type, int pref)
 	struct route_map_index *index;
 	struct route_map_index *point;
 
+	route_map_cache_invalidate();
+
 	/* Allocate new route map inex. */
 	index = route_map_index_new();
 	index->map = map;
@@ -1292,6 +1338,8 @@ enum rmap_compile_rets route_map_add_match(struct route_map_index *index,
 	int8_t delete_rmap_event_type = 0;
 	const char *rule_key;
 
+	route_map_cache_invalidate();
+
 	/* First lookup rule for add match statement. */
 	cmd = route_map_lookup_match(match_name);
 	if (cmd == NULL)
@@ -1401,6 +1449,8 @@ enum rmap_compile_rets route_map_delete_match(struct route_map_index *index,
 	const struct route_map_rule_cmd *cmd;
 	const char *rule_key;
 
+	route_map_cache_invalidate();
+
 	cmd = route_map_lookup_match(match_name);
 	if (cmd == NULL)
 		return RMAP_RULE_MISSING;
@@ -2298,6 +2348,8 @@ void route_map_notify_pentry_dependencies(const char *affected_name,
 	struct hash *upd8_hash = NULL;
 	struct route_map_pentry_dep pentry_dep;
 
+	route_map_cache_invalidate();
+
 	if (!affected_name || !pentry)
 		return;
 
@@ -2368,15 +2420,168 @@ void route_map_notify_pentry_dependencies(const char *affected_name,
 
    We need to make sure our route-map processing matches the above
 */
+/*
+ * Find the first index whose match clauses all match, i.e. the point where
+ * route_map_apply() starts running set clauses.  Up to there the outcome
+ * only depends on the prefix and on what match clauses look at in the
+ * object, which is what route_map_apply_cached() memoizes.  If no index
+ * matches, NULL is returned and ret holds the final result.
+ */
+static struct route_map_index *
+route_map_find_match(struct route_map *map, const struct prefix *prefix,
+		     void *object, route_map_result_t *ret)
+{
+	enum route_map_cmd_result_t match_ret = RMAP_NOMATCH;
+	struct route_map_index *index;
+
+	if ((!map->optimization_disabled)
+	    && (map->ipv4_prefix_table || map->ipv6_prefix_table)) {
+		index = route_map_get_index(map, prefix, object,
+					    (uint8_t *)&match_ret);
+		if (index) {
+			if (rmap_debug)
+				zlog_debug(
+					"Best match route-map: %s, sequence: %d for pfx: %pFX, result: %s",
+					map->name, index->pref, prefix,
+					route_map_cmd_result_str(match_ret));
+			return index;
+		}
+
+		if (rmap_debug)
+			zlog_debug(
+				"No best match sequence for pfx: %pFX in route-map: %s, result: %s",
+				prefix, map->name,
+				route_map_cmd_result_str(match_ret));
+		/*
+		 * No index matches this prefix. Return deny unless,
+		 * match_ret = RMAP_NOOP.
+		 */
+		if (match_ret == RMAP_NOOP)
+			*ret = RMAP_PERMITMATCH;
+		else
+			*ret = RMAP_DENYMATCH;
+		return NULL;
+	}
+
+	for (index = map->head; index; index = index->next) {
+		index->applied++;
+		/* Apply this index. */
+		match_ret = route_map_apply_match(&index->match_list, prefix,
+						  object);
+		if (rmap_debug) {
+			zlog_debug(
+				"Route-map: %s, sequence: %d, prefix: %pFX, result: %s",
+				map->name, index->pref, prefix,
+				route_map_cmd_result_str(match_ret));
+		}
+
+		if (match_ret == RMAP_MATCH)
+			return index;
+		/*
+		 * RMAP_NOMATCH changes the return value to denymatch, and
+		 * even if we see more noops, we retain it.  RMAP_NOOP keeps
+		 * whatever was there before.
+		 */
+		if (match_ret == RMAP_NOMATCH)
+			*ret = RMAP_DENYMATCH;
+	}
+	return NULL;
+}
+
+static unsigned int route_map_cache_hash_key(const void *arg)
+{
+	const struct route_map_cache_entry *entry = arg;
+
+	return jhash_3words(entry->key, entry->key >> 32,
+			    (uintptr_t)entry->src,
+			    prefix_hash_key(&entry->prefix));
+}
+
+static bool route_map_cache_hash_cmp(const void *a1, const void *a2)
+{
+	const struct route_map_cache_entry *e1 = a1, *e2 = a2;
+
+	return e1->key == e2->key && e1->src == e2->src
+	       && prefix_same(&e1->prefix, &e2->prefix);
+}
+
+/* no_cache match rules make every result of this route-map uncacheable */
+static bool route_map_cache_usable(struct route_map *map)
+{
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+
+	for (index = map->head; index; index = index->next)
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			if (rule->cmd->no_cache)
+				return false;
+	return true;
+}
+
+static struct route_map_index *
+route_map_cache_find_match(struct route_map *map, const struct prefix *prefix,
+			   void *object, uint64_t key, const void *src,
+			   route_map_result_t *ret)
+{
+	struct route_map_cache_entry ref, *entry;
+
+	if (!map->match_cache)
+		map->match_cache = hash_create_size(
+			64, route_map_cache_hash_key, route_map_cache_hash_cmp,
+			"Route-map match cache");
+
+	/* rules only change together with the generation */
+	if (map->cache_gen != route_map_cache_gen) {
+		hash_clean(map->match_cache, route_map_cache_entry_free);
+		map->cache_gen = route_map_cache_gen;
+		map->cache_disabled = !route_map_cache_usable(map);
+	} else if (map->match_cache->count >= ROUTE_MAP_CACHE_MAX)
+		hash_clean(map->match_cache, route_map_cache_entry_free);
+
+	if (map->cache_disabled)
+		return route_map_find_match(map, prefix, object, ret);
+
+	memset(&ref, 0, sizeof(ref));
+	ref.key = key;
+	ref.src = src;
+	prefix_copy(&ref.prefix, prefix);
+
+	entry = hash_lookup(map->match_cache, &ref);
+	if (entry) {
+		map->cache_hits++;
+		*ret = entry->ret;
+		return entry->index;
+	}
+
+	map->cache_misses++;
+	ref.ret = *ret;
+	ref.index = route_map_find_match(map, prefix, object, &ref.ret);
+
+	entry = XMALLOC(MTYPE_ROUTE_MAP_CACHE, sizeof(*entry));
+	*entry = ref;
+	(void)hash_get(map->match_cache, entry, hash_alloc_intern);
+
+	*ret = entry->ret;
+	return entry->index;
+}
+
 route_map_result_t route_map_apply(struct route_map *map,
 				   const struct prefix *prefix, void *object)
+{
+	return route_map_apply_cached(map, prefix, object, 0, NULL);
+}
+
+route_map_result_t route_map_apply_cached(struct route_map *map,
+					  const struct prefix *prefix,
+					  void *object, uint64_t key,
+					  const void *src)
 {
 	static int recursion = 0;
-	enum route_map_cmd_result_t match_ret = RMAP_NOMATCH;
+	enum route_map_cmd_result_t match_ret = RMAP_MATCH;
 	route_map_result_t ret = RMAP_PERMITMATCH;
 	struct route_map_index *index = NULL;
 	struct route_map_rule *set = NULL;
-	bool skip_match_clause = false;
+	bool skip_match_clause = true;
 
 	if (recursion > RMAP_RECURSION_LIMIT) {
 		flog_warn(
@@ -2394,36 +2599,14 @@ route_map_result_t route_map_apply(struct route_map *map,
 
 	map->applied++;
 
-	if ((!map->optimization_disabled)
-	    && (map->ipv4_prefix_table || map->ipv6_prefix_table)) {
-		index = route_map_get_index(map, prefix, object,
-					    (uint8_t *)&match_ret);
-		if (index) {
-			if (rmap_debug)
-				zlog_debug(
-					"Best match route-map: %s, sequence: %d for pfx: %pFX, result: %s",
-					map->name, index->pref, prefix,
-					route_map_cmd_result_str(match_ret));
-		} else {
-			if (rmap_debug)
-				zlog_debug(
-					"No best match sequence for pfx: %pFX in route-map: %s, result: %s",
-					prefix, map->name,
-					route_map_cmd_result_str(match_ret));
-			/*
-			 * No index matches this prefix. Return deny unless,
-			 * match_ret = RMAP_NOOP.
-			 */
-			if (match_ret == RMAP_NOOP)
-				ret = RMAP_PERMITMATCH;
-			else
-				ret = RMAP_DENYMATCH;
-			goto route_map_apply_end;
-		}
-		skip_match_clause = true;
-	} else {
-		index = map->head;
-	}
+	/* Evaluation up to the first matching index; the loop below then
+	 * runs its set clauses and follows its exit policy as usual.
+	 */
+	if (key)
+		index = route_map_cache_find_match(map, prefix, object, key,
+						   src, &ret);
+	else
+		index = route_map_find_match(map, prefix, object, &ret);
 
 	for (; index; index = index->next) {
 		if (!skip_match_clause) {
@@ -2907,6 +3090,8 @@ void route_map_notify_dependencies(const char *affected_name,
 	if (!affected_name)
 		return;
 
+	route_map_cache_invalidate();
+
 	name = XSTRDUP(MTYPE_ROUTE_MAP_NAME, affected_name);
 
 	if ((upd8_hash = route_map_get_dep_hash(event)) == NULL) {
@@ -2938,6 +3123,7 @@ DEFUN(no_routemap_optimization, no_routemap_optimization_cmd,
 	VTY_DECLVAR_CONTEXT(route_map_index, index);
 
 	index->map->optimization_disabled = true;
+	route_map_cache_invalidate();
 	return CMD_SUCCESS;
 }
 
@@ -2949,6 +3135,7 @@ DEFUN(routemap_optimization, routemap_optimization_cmd,
 	VTY_DECLVAR_CONTEXT(route_map_index, index);
 
 	index->map->optimization_disabled = false;
+	route_map_cache_invalidate();
 	return CMD_SUCCESS;
 }
 
@@ -116,6 +116,12 @@ struct route_map_rule_cmd {
 
 	/** To get the rule key after Compilation **/
 	void *(*func_get_rmap_rule_key)(void *val);
+
+	/* func_apply's result can change without the object or anything the
+	 * route-map depends on changing (randomness, external state), so
+	 * route_map_apply_cached() must not memoize it.
+	 */
+	bool no_cache;
 };
 
 /* Route map apply error. */
@@ -225,6 +231,13 @@ struct route_map {
 	struct route_table *ipv4_prefix_table;
 	struct route_table *ipv6_prefix_table;
 
+	/* Memoized match results, see route_map_apply_cached() */
+	struct hash *match_cache;
+	uint64_t cache_gen;
+	bool cache_disabled;
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+
 	QOBJ_FIELDS
 };
 DECLARE_QOBJ_TYPE(route_map)
@@ -289,6 +302,28 @@ extern route_map_result_t route_map_apply(struct route_map *map,
 					  const struct prefix *prefix,
 					  void *object);
 
+/*
+ * Same as route_map_apply(), but remembers which sequence matched for a
+ * given (key, src, prefix), so that applying the route-map again to the
+ * same inputs skips evaluating match clauses.  Set clauses are still run
+ * on the object every time.
+ *
+ * key must identify the contents of the object that match clauses look at
+ * and must never be reused for different contents, e.g. a number handed
+ * out when an attribute is interned; src identifies where the object came
+ * from, e.g. the peer.  key == 0 disables caching, as does any match rule
+ * whose command sets no_cache.  Cached results are dropped whenever the
+ * route-map or anything it depends on changes; caller-side state that
+ * match clauses look at needs a route_map_cache_invalidate() when it
+ * changes.
+ */
+extern route_map_result_t route_map_apply_cached(struct route_map *map,
+						 const struct prefix *prefix,
+						 void *object, uint64_t key,
+						 const void *src);
+
+extern void route_map_cache_invalidate(void);
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
@@ -1133,7 +1133,8 @@ const struct frr_yang_module_info frr_route_map_info = {
 			.cbs = {
 				.create = lib_route_map_create,
 				.destroy = lib_route_map_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry",
@@ -1142,7 +1143,8 @@ const struct frr_yang_module_info frr_route_map_info = {
 				.destroy = lib_route_map_entry_destroy,
 				.cli_show = route_map_instance_show,
 				.cli_show_end = route_map_instance_show_end,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/description",
@@ -1150,13 +1152,15 @@ const struct frr_yang_module_info frr_route_map_info = {
 				.modify = lib_route_map_entry_description_modify,
 				.destroy = lib_route_map_entry_description_destroy,
 				.cli_show = route_map_description_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/action",
 			.cbs = {
 				.modify = lib_route_map_entry_action_modify,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/call",
@@ -1164,21 +1168,24 @@ const struct frr_yang_module_info frr_route_map_info = {
 				.modify = lib_route_map_entry_call_modify,
 				.destroy = lib_route_map_entry_call_destroy,
 				.cli_show = route_map_call_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/exit-policy",
 			.cbs = {
 				.modify = lib_route_map_entry_exit_policy_modify,
 				.cli_show = route_map_exit_policy_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/goto-value",
 			.cbs = {
 				.modify = lib_route_map_entry_goto_value_modify,
 				.destroy = lib_route_map_entry_goto_value_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition",
@@ -1186,49 +1193,56 @@ const struct frr_yang_module_info frr_route_map_info = {
 				.create = lib_route_map_entry_match_condition_create,
 				.destroy = lib_route_map_entry_match_condition_destroy,
 				.cli_show = route_map_condition_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition/interface",
 			.cbs = {
 				.modify = lib_route_map_entry_match_condition_interface_modify,
 				.destroy = lib_route_map_entry_match_condition_interface_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition/list-name",
 			.cbs = {
 				.modify = lib_route_map_entry_match_condition_list_name_modify,
 				.destroy = lib_route_map_entry_match_condition_list_name_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition/ipv4-next-hop-type",
 			.cbs = {
 				.modify = lib_route_map_entry_match_condition_ipv4_next_hop_type_modify,
 				.destroy = lib_route_map_entry_match_condition_ipv4_next_hop_type_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition/ipv6-next-hop-type",
 			.cbs = {
 				.modify = lib_route_map_entry_match_condition_ipv6_next_hop_type_modify,
 				.destroy = lib_route_map_entry_match_condition_ipv6_next_hop_type_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition/metric",
 			.cbs = {
 				.modify = lib_route_map_entry_match_condition_metric_modify,
 				.destroy = lib_route_map_entry_match_condition_metric_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/match-condition/tag",
 			.cbs = {
 				.modify = lib_route_map_entry_match_condition_tag_modify,
 				.destroy = lib_route_map_entry_match_condition_tag_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action",
@@ -1236,70 +1250,80 @@ const struct frr_yang_module_info frr_route_map_info = {
 				.create = lib_route_map_entry_set_action_create,
 				.destroy = lib_route_map_entry_set_action_destroy,
 				.cli_show = route_map_action_show,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/ipv4-address",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_ipv4_address_modify,
 				.destroy = lib_route_map_entry_set_action_ipv4_address_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/ipv6-address",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_ipv6_address_modify,
 				.destroy = lib_route_map_entry_set_action_ipv6_address_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/value",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_value_modify,
 				.destroy = lib_route_map_entry_set_action_value_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/add-metric",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_add_metric_modify,
 				.destroy = lib_route_map_entry_set_action_add_metric_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/subtract-metric",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_subtract_metric_modify,
 				.destroy = lib_route_map_entry_set_action_subtract_metric_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/use-round-trip-time",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_use_round_trip_time_modify,
 				.destroy = lib_route_map_entry_set_action_use_round_trip_time_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/add-round-trip-time",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_add_round_trip_time_modify,
 				.destroy = lib_route_map_entry_set_action_add_round_trip_time_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/subtract-round-trip-time",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_subtract_round_trip_time_modify,
 				.destroy = lib_route_map_entry_set_action_subtract_round_trip_time_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = "/frr-route-map:lib/route-map/entry/set-action/tag",
 			.cbs = {
 				.modify = lib_route_map_entry_set_action_tag_modify,
 				.destroy = lib_route_map_entry_set_action_tag_destroy,
-			}
+			},
+			.parallel_safe = true,
 		},
 		{
 			.xpath = NULL,
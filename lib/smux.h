@@ -107,6 +107,53 @@ extern void oid2in_addr(oid[], int, struct in_addr *);
 extern void *oid_copy(void *, const void *, size_t);
 extern void oid_copy_addr(oid[], const struct in_addr *, int);
 
+/*
+ * Snapshot of a MIB table, for tables where finding the next entry in the
+ * live data is expensive (or not possible in index order at all.)  The
+ * daemon's build callback copies all rows out at once, they get sorted by
+ * index and GET/GETNEXT are answered by binary search on that copy.  A
+ * walk therefore costs O(log n) per request and only touches the live
+ * data when the snapshot is rebuilt, which happens on the next request
+ * after it is older than max_age seconds.
+ *
+ * Rows are user structs starting with a struct snmp_snap_row, allocated
+ * with snmp_snap_add() from the build callback.  row_free is called on
+ * each row when the snapshot is dropped, e.g. to release references.
+ */
+#define SNMP_SNAP_INDEX_MAX 32
+
+struct snmp_snap_row {
+	oid index[SNMP_SNAP_INDEX_MAX];
+	size_t index_len;
+};
+
+struct snmp_snap {
+	size_t row_size;
+	unsigned int max_age;
+	void (*build)(struct snmp_snap *snap);
+	void (*row_free)(void *row);
+
+	/* private */
+	uint8_t *rows;
+	size_t count, alloc;
+	time_t built;
+};
+
+extern void *snmp_snap_add(struct snmp_snap *snap, const oid *index,
+			   size_t index_len);
+extern void snmp_snap_refresh(struct snmp_snap *snap);
+extern void snmp_snap_reset(struct snmp_snap *snap);
+
+/* number of rows, after refreshing if needed */
+extern size_t snmp_snap_count(struct snmp_snap *snap);
+
+/* GET/GETNEXT on the table registered for v: returns the row, and for
+ * GETNEXT updates name/length to its OID.
+ */
+extern const void *snmp_snap_lookup(struct snmp_snap *snap,
+				    struct variable *v, oid *name,
+				    size_t *length, int exact);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,6 +24,10 @@
 #include <net-snmp/net-snmp-includes.h>
 
 #include "smux.h"
+#include "memory.h"
+#include "monotime.h"
+
+DEFINE_MTYPE_STATIC(LIB, SNMP_SNAP, "SNMP table snapshot")
 
 #define min(A,B) ((A) < (B) ? (A) : (B))
 
@@ -120,3 +124,111 @@ int smux_header_table(struct variable *v, oid *name, size_t *length, int exact,
 
 	return MATCH_SUCCEEDED;
 }
+
+static inline struct snmp_snap_row *snmp_snap_row(struct snmp_snap *snap,
+						  size_t i)
+{
+	return (struct snmp_snap_row *)(snap->rows + i * snap->row_size);
+}
+
+static int snmp_snap_row_cmp(const void *a, const void *b)
+{
+	const struct snmp_snap_row *ra = a, *rb = b;
+
+	return oid_compare(ra->index, ra->index_len, rb->index, rb->index_len);
+}
+
+void *snmp_snap_add(struct snmp_snap *snap, const oid *index,
+		    size_t index_len)
+{
+	struct snmp_snap_row *row;
+
+	assert(snap->row_size >= sizeof(*row));
+	assert(index_len <= SNMP_SNAP_INDEX_MAX);
+
+	if (snap->count == snap->alloc) {
+		snap->alloc = snap->alloc ? snap->alloc * 2 : 64;
+		snap->rows = XREALLOC(MTYPE_SNMP_SNAP, snap->rows,
+				      snap->alloc * snap->row_size);
+	}
+
+	row = snmp_snap_row(snap, snap->count++);
+	memset(row, 0, snap->row_size);
+	oid_copy(row->index, index, index_len);
+	row->index_len = index_len;
+	return row;
+}
+
+/* drop all rows, the next request rebuilds the snapshot */
+void snmp_snap_reset(struct snmp_snap *snap)
+{
+	size_t i;
+
+	if (snap->row_free)
+		for (i = 0; i < snap->count; i++)
+			snap->row_free(snmp_snap_row(snap, i));
+
+	XFREE(MTYPE_SNMP_SNAP, snap->rows);
+	snap->count = snap->alloc = 0;
+	snap->built = 0;
+}
+
+void snmp_snap_refresh(struct snmp_snap *snap)
+{
+	time_t now = monotime(NULL);
+
+	if (snap->built && now - snap->built < (time_t)snap->max_age)
+		return;
+
+	snmp_snap_reset(snap);
+	snap->build(snap);
+	if (snap->count)
+		qsort(snap->rows, snap->count, snap->row_size,
+		      snmp_snap_row_cmp);
+	/* 0 means "never built" */
+	snap->built = now ? now : 1;
+}
+
+size_t snmp_snap_count(struct snmp_snap *snap)
+{
+	snmp_snap_refresh(snap);
+	return snap->count;
+}
+
+const void *snmp_snap_lookup(struct snmp_snap *snap, struct variable *v,
+			     oid *name, size_t *length, int exact)
+{
+	const oid *key = name + v->namelen;
+	size_t key_len = *length > v->namelen ? *length - v->namelen : 0;
+	size_t lo = 0, hi, mid;
+	struct snmp_snap_row *row;
+	int cmp;
+
+	snmp_snap_refresh(snap);
+
+	/* first row with index >= key (exact) or > key (next) */
+	hi = snap->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		row = snmp_snap_row(snap, mid);
+		cmp = oid_compare(row->index, row->index_len, key, key_len);
+		if (cmp < 0 || (cmp == 0 && !exact))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == snap->count)
+		return NULL;
+
+	row = snmp_snap_row(snap, lo);
+	if (exact) {
+		if (oid_compare(row->index, row->index_len, key, key_len))
+			return NULL;
+		return row;
+	}
+
+	oid_copy(name + v->namelen, row->index, row->index_len);
+	*length = v->namelen + row->index_len;
+	return row;
+}
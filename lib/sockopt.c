@@ -531,6 +531,29 @@ int sockopt_tcp_rtt(int sock)
 #endif
 }
 
+int sockopt_tcp_send_space(int sock)
+{
+#if defined(FIONSPACE)
+	int space;
+
+	if (ioctl(sock, FIONSPACE, &space) != 0)
+		return -1;
+
+	return space;
+#elif defined(TIOCOUTQ)
+	int sndbuf, queued;
+	socklen_t len = sizeof(sndbuf);
+
+	if (getsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) != 0
+	    || ioctl(sock, TIOCOUTQ, &queued) != 0)
+		return -1;
+
+	return MAX(sndbuf - queued, 0);
+#else
+	return -1;
+#endif
+}
+
 int sockopt_tcp_signature_ext(int sock, union sockunion *su, uint16_t prefixlen,
 			      const char *password)
 {
@@ -97,6 +97,9 @@ extern void sockopt_iphdrincl_swab_systoh(struct ip *iph);
 
 extern int sockopt_tcp_rtt(int);
 
+/* Bytes that can be written to sock without blocking, -1 if unknown. */
+extern int sockopt_tcp_send_space(int sock);
+
 /*
  * TCP MD5 signature option. This option allows TCP MD5 to be enabled on
  * addresses.
@@ -29,8 +29,12 @@
 #include "prefix.h"
 #include "table.h"
 #include "printfrr.h"
+#include "fhash.h"
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_SRC_NODE, "Route source node")
+DEFINE_MTYPE_STATIC(LIB, ROUTE_SRCDEST_INDEX, "Route srcdest index")
+
+PREDECL_HASH(sd_index)
 
 /* ----- functions to manage rnodes _with_ srcdest table ----- */
 struct srcdest_rnode {
@@ -82,6 +86,103 @@ route_table_delegate_t _srcdest_dstnode_delegate = {
 	.create_node = srcdest_rnode_create,
 	.destroy_node = srcdest_rnode_destroy};
 
+/* ----- (dst, src) index for source nodes ----- */
+
+/* Looking up a source route would otherwise take a hash lookup in the
+ * destination table and then another one in that node's src_table.  This
+ * index finds it in one step; it lives in the destination table and exists
+ * only while there are source nodes.  Nodes are added to it when they are
+ * first returned by srcdest_rnode_get(), which is the only way they can get
+ * an info pointer.
+ */
+struct srcdest_srcnode {
+	/* must be first in structure for casting to/from route_node */
+	ROUTE_NODE_FIELDS;
+
+	struct sd_index_item itm;
+	/* prefix of the destination node, NULL while not in the index */
+	const struct prefix *dst_p;
+};
+
+struct srcdest_index {
+	struct sd_index_head nodes;
+};
+
+static int sd_index_cmp(const struct srcdest_srcnode *a,
+			const struct srcdest_srcnode *b)
+{
+	int ret = prefix_cmp(a->dst_p, b->dst_p);
+
+	return ret ? ret : prefix_cmp(&a->p, &b->p);
+}
+
+static uint32_t sd_index_hash(const struct srcdest_srcnode *sn)
+{
+	return fhash_2words(prefix_hash_key(sn->dst_p), prefix_hash_key(&sn->p),
+			    0);
+}
+
+DECLARE_HASH(sd_index, struct srcdest_srcnode, itm, sd_index_cmp,
+	     sd_index_hash)
+
+static void srcdest_index_add(struct route_table *table,
+			      struct route_node *dst_rn, struct route_node *rn)
+{
+	struct srcdest_srcnode *sn = (struct srcdest_srcnode *)rn;
+
+	if (sn->dst_p)
+		return;
+
+	if (!table->srcdest_index) {
+		table->srcdest_index = XCALLOC(MTYPE_ROUTE_SRCDEST_INDEX,
+					       sizeof(*table->srcdest_index));
+		sd_index_init(&table->srcdest_index->nodes);
+	}
+
+	sn->dst_p = &dst_rn->p;
+	sd_index_add(&table->srcdest_index->nodes, sn);
+}
+
+static void srcdest_index_del(struct route_table *table, struct route_node *rn)
+{
+	struct srcdest_srcnode *sn = (struct srcdest_srcnode *)rn;
+	struct srcdest_index *idx = table->srcdest_index;
+
+	if (!sn->dst_p)
+		return;
+
+	sd_index_del(&idx->nodes, sn);
+	sn->dst_p = NULL;
+
+	if (sd_index_count(&idx->nodes))
+		return;
+
+	sd_index_fini(&idx->nodes);
+	XFREE(MTYPE_ROUTE_SRCDEST_INDEX, table->srcdest_index);
+}
+
+static struct route_node *srcdest_index_lookup(struct route_table *table,
+					       const struct prefix *dst_p,
+					       const struct prefix_ipv6 *src_p)
+{
+	struct srcdest_srcnode ref, *sn;
+	struct prefix dst;
+
+	if (!table->srcdest_index)
+		return NULL;
+
+	prefix_copy(&dst, dst_p);
+	apply_mask(&dst);
+	prefix_copy(&ref.p, src_p);
+	apply_mask(&ref.p);
+	ref.dst_p = &dst;
+
+	sn = sd_index_find(&table->srcdest_index->nodes, &ref);
+	if (!sn || !sn->info)
+		return NULL;
+	return route_lock_node((struct route_node *)sn);
+}
+
 /* ----- functions to manage rnodes _in_ srcdest table ----- */
 
 /* node creation / deletion for srcdest source prefix nodes.
@@ -93,7 +194,10 @@ static struct route_node *
 srcdest_srcnode_create(route_table_delegate_t *delegate,
 		       struct route_table *table)
 {
-	return XCALLOC(MTYPE_ROUTE_SRC_NODE, sizeof(struct route_node));
+	struct srcdest_srcnode *sn;
+
+	sn = XCALLOC(MTYPE_ROUTE_SRC_NODE, sizeof(struct srcdest_srcnode));
+	return (struct route_node *)sn;
 }
 
 static void srcdest_srcnode_destroy(route_table_delegate_t *delegate,
@@ -102,9 +206,11 @@ static void srcdest_srcnode_destroy(route_table_delegate_t *delegate,
 {
 	struct srcdest_rnode *srn;
 
+	srn = route_table_get_info(table);
+	srcdest_index_del(srn->table, rn);
+
 	XFREE(MTYPE_ROUTE_SRC_NODE, rn);
 
-	srn = route_table_get_info(table);
 	if (srn->src_table && route_table_count(srn->src_table) == 0) {
 		/* deleting the route_table from inside destroy_node is ONLY
 		 * permitted IF table->count is 0!  see lib/table.c
@@ -131,6 +237,7 @@ static struct route_node *srcdest_srcnode_get(struct route_node *rn,
 					      const struct prefix_ipv6 *src_p)
 {
 	struct srcdest_rnode *srn;
+	struct route_node *src_rn;
 
 	if (!src_p || src_p->prefixlen == 0)
 		return rn;
@@ -159,7 +266,9 @@ static struct route_node *srcdest_srcnode_get(struct route_node *rn,
 		route_unlock_node(rn);
 	}
 
-	return route_node_get(srn->src_table, (const struct prefix *)src_p);
+	src_rn = route_node_get(srn->src_table, (const struct prefix *)src_p);
+	srcdest_index_add(srn->table, rn, src_rn);
+	return src_rn;
 }
 
 static struct route_node *srcdest_srcnode_lookup(
@@ -253,6 +362,9 @@ struct route_node *srcdest_rnode_lookup(struct route_table *table,
 	struct route_node *rn;
 	struct route_node *srn;
 
+	if (src_p && src_p->prefixlen)
+		return srcdest_index_lookup(table, dst_pu.p, src_p);
+
 	rn = route_node_lookup_maynull(table, (const struct prefix *)dst_p);
 	srn = srcdest_srcnode_lookup(rn, src_p);
 
@@ -112,6 +112,9 @@ struct stream *stream_new(size_t size)
 	s->getp = s->endp = 0;
 	s->next = NULL;
 	s->size = size;
+	s->data = (unsigned char *)(s + 1);
+	s->owner = NULL;
+	atomic_store_explicit(&s->refcnt, 1, memory_order_relaxed);
 	return s;
 }
 
@@ -121,7 +124,57 @@ void stream_free(struct stream *s)
 	if (!s)
 		return;
 
-	XFREE(MTYPE_STREAM, s);
+	if (s->owner) {
+		struct stream *owner = s->owner;
+
+		XFREE(MTYPE_STREAM, s);
+		s = owner;
+	}
+
+	/* acq_rel so the last free sees everything others did with it */
+	if (atomic_fetch_sub_explicit(&s->refcnt, 1, memory_order_acq_rel)
+	    == 1)
+		XFREE(MTYPE_STREAM, s);
+}
+
+static struct stream *stream_ref(struct stream *s, size_t offset, size_t len)
+{
+	struct stream *owner = s->owner ? s->owner : s;
+	struct stream *ref;
+
+	STREAM_VERIFY_SANE(s);
+	assert(offset + len <= s->endp);
+
+	atomic_fetch_add_explicit(&owner->refcnt, 1, memory_order_relaxed);
+
+	ref = XMALLOC(MTYPE_STREAM, sizeof(struct stream));
+	ref->next = NULL;
+	ref->data = s->data + offset;
+	/* size == endp, nothing can be appended */
+	ref->size = ref->endp = len;
+	ref->getp = 0;
+	ref->owner = owner;
+	atomic_store_explicit(&ref->refcnt, 1, memory_order_relaxed);
+	return ref;
+}
+
+struct stream *stream_clone(struct stream *s)
+{
+	struct stream *ref = stream_ref(s, 0, s->endp);
+
+	ref->getp = s->getp;
+	return ref;
+}
+
+struct stream *stream_slice(struct stream *s, size_t offset, size_t len)
+{
+	return stream_ref(s, offset, len);
+}
+
+bool stream_is_shared(const struct stream *s)
+{
+	return s->owner
+	       || atomic_load_explicit(&s->refcnt, memory_order_relaxed) > 1;
 }
 
 struct stream *stream_copy(struct stream *dest, const struct stream *src)
@@ -175,10 +228,12 @@ size_t stream_resize_inplace(struct stream **sptr, size_t newsize)
 	struct stream *orig = *sptr;
 
 	STREAM_VERIFY_SANE(orig);
+	assert(!stream_is_shared(orig));
 
 	orig = XREALLOC(MTYPE_STREAM, orig, sizeof(struct stream) + newsize);
 
 	orig->size = newsize;
+	orig->data = (unsigned char *)(orig + 1);
 
 	if (orig->endp > orig->size)
 		orig->endp = orig->size;
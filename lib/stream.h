@@ -96,6 +96,14 @@ extern "C" {
  *
  * Best practice is to use stream_put (<stream *>, NULL, <size>) to zero out
  * any part of a stream which isn't otherwise written to.
+ *
+ * Sharing:
+ * stream_clone() and stream_slice() create additional streams referring to
+ * (a part of) the same data, without copying it.  Each has its own getp and
+ * endp, and its own "next" pointer so it can sit on a separate stream_fifo.
+ * The data is freed when the last stream referring to it is freed, which
+ * may happen on any pthread.  Shared data must not be modified anymore; use
+ * stream_dup() to get a writable copy.
  */
 
 /* Stream buffer. */
@@ -110,7 +118,12 @@ struct stream {
 	size_t getp;	       /* next get position */
 	size_t endp;	       /* last valid data position */
 	size_t size;	       /* size of data segment */
-	unsigned char data[];  /* data pointer */
+	unsigned char *data;   /* data pointer */
+
+	/* stream that holds the data, NULL if it's this one */
+	struct stream *owner;
+	/* number of streams referring to this stream's data */
+	atomic_uint_fast32_t refcnt;
 };
 
 /* First in first out queue structure. */
@@ -155,6 +168,17 @@ extern struct stream *stream_copy(struct stream *dest,
 				  const struct stream *src);
 extern struct stream *stream_dup(const struct stream *s);
 
+/* Zero-copy read-only references to the data in s, see "Sharing" above.
+ * A clone starts with the same getp/endp as s; a slice covers len bytes at
+ * offset (from s's start, not getp), with getp = 0 and endp = len.  Neither
+ * can be written to.
+ */
+extern struct stream *stream_clone(struct stream *s);
+extern struct stream *stream_slice(struct stream *s, size_t offset,
+				   size_t len);
+/* true if the data is also referenced by other streams */
+extern bool stream_is_shared(const struct stream *s);
+
 extern size_t stream_resize_inplace(struct stream **sptr, size_t newsize);
 
 extern size_t stream_get_getp(const struct stream *s);
@@ -304,6 +328,9 @@ void stream_fifo_deinit(struct stream_fifo *fifo);
 /*
  * Push a stream onto a stream_fifo.
  *
+ * A stream can only be on one fifo at a time; to queue the same data on
+ * several, push a stream_clone() onto each.
+ *
  * fifo
  *    the stream_fifo to push onto
  *
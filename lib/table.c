@@ -31,6 +31,7 @@
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE, "Route table")
 DEFINE_MTYPE(LIB, ROUTE_NODE, "Route node")
+DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE_STRIDE, "Route table stride index")
 
 static void route_table_free(struct route_table *);
 
@@ -137,6 +138,7 @@ static void route_table_free(struct route_table *rt)
 
 	assert(rt->count == 0);
 
+	XFREE(MTYPE_ROUTE_TABLE_STRIDE, rt->stride);
 	rn_hash_node_fini(&rt->hash);
 	XFREE(MTYPE_ROUTE_TABLE, rt);
 	return;
@@ -192,6 +194,123 @@ static void set_link(struct route_node *node, struct route_node *new)
 	new->parent = node;
 }
 
+/* Level-compression index ------------------------------------------------ */
+
+struct route_table_stride {
+	uint8_t family;
+	uint8_t bits;
+
+	struct route_node *entry[0];
+};
+
+static inline uint32_t route_stride_key(const struct route_table_stride *st,
+					const struct prefix *p)
+{
+	const uint8_t *pp = &p->u.prefix;
+	uint32_t key = (pp[0] << 16) | (pp[1] << 8) | pp[2];
+
+	return key >> (24 - st->bits);
+}
+
+static inline bool route_stride_covers(const struct route_table_stride *st,
+				       const struct route_node *node)
+{
+	return node->p.family == st->family && node->p.prefixlen <= st->bits;
+}
+
+/* (new) node is now in the tree; it's the deepest for its range unless a
+ * more specific node with prefixlen <= bits exists already.
+ */
+static void route_stride_add(struct route_table *table,
+			     struct route_node *node)
+{
+	struct route_table_stride *st = table->stride;
+	uint32_t base, count;
+
+	if (!st || !route_stride_covers(st, node))
+		return;
+
+	base = route_stride_key(st, &node->p);
+	count = 1U << (st->bits - node->p.prefixlen);
+
+	for (uint32_t i = base; i < base + count; i++)
+		if (!st->entry[i]
+		    || st->entry[i]->p.prefixlen < node->p.prefixlen)
+			st->entry[i] = node;
+}
+
+static void route_stride_del(struct route_table *table,
+			     struct route_node *node,
+			     struct route_node *parent)
+{
+	struct route_table_stride *st = table->stride;
+	uint32_t base, count;
+
+	if (!st || !route_stride_covers(st, node))
+		return;
+
+	base = route_stride_key(st, &node->p);
+	count = 1U << (st->bits - node->p.prefixlen);
+
+	if (parent && !route_stride_covers(st, parent))
+		parent = NULL;
+
+	for (uint32_t i = base; i < base + count; i++)
+		if (st->entry[i] == node)
+			st->entry[i] = parent;
+}
+
+/* where to start walking down the tree for p; NULL for the top */
+static inline struct route_node *
+route_stride_start(const struct route_table *table, const struct prefix *p)
+{
+	const struct route_table_stride *st = table->stride;
+
+	if (!st || p->family != st->family || p->prefixlen < st->bits)
+		return NULL;
+	return st->entry[route_stride_key(st, p)];
+}
+
+void route_table_set_stride(struct route_table *table, uint8_t family,
+			    uint8_t bits)
+{
+	struct route_node *node;
+
+	XFREE(MTYPE_ROUTE_TABLE_STRIDE, table->stride);
+	if (!bits)
+		return;
+
+	assert(family == AF_INET || family == AF_INET6);
+	assert(bits <= ROUTE_TABLE_STRIDE_MAX);
+
+	table->stride = XCALLOC(MTYPE_ROUTE_TABLE_STRIDE,
+				sizeof(*table->stride)
+					+ sizeof(table->stride->entry[0])
+						  * (1U << bits));
+	table->stride->family = family;
+	table->stride->bits = bits;
+
+	/* preorder, so less specific nodes are seen first.  Not using
+	 * route_next() since that would delete unlocked nodes.
+	 */
+	node = table->top;
+	while (node) {
+		route_stride_add(table, node);
+
+		if (node->l_left)
+			node = node->l_left;
+		else if (node->l_right)
+			node = node->l_right;
+		else {
+			while (node->parent
+			       && (node->parent->l_right == node
+				   || !node->parent->l_right))
+				node = node->parent;
+			node = node->parent ? node->parent->l_right : NULL;
+		}
+	}
+}
+
 /* Find matched prefix. */
 struct route_node *route_node_match(struct route_table *table,
 				    union prefixconstptr pu)
@@ -199,9 +318,11 @@ struct route_node *route_node_match(struct route_table *table,
 	const struct prefix *p = pu.p;
 	struct route_node *node;
 	struct route_node *matched;
+	struct route_node *start;
 
 	matched = NULL;
-	node = table->top;
+	start = route_stride_start(table, p);
+	node = start ? start : table->top;
 
 	/* Walk down tree.  If there is matched route then store it to
 	   matched. */
@@ -216,6 +337,12 @@ struct route_node *route_node_match(struct route_table *table,
 		node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
 	}
 
+	/* Started below the top; a less specific match may be further up. */
+	if (!matched && start)
+		for (node = start->parent; node && !matched; node = node->parent)
+			if (node->info)
+				matched = node;
+
 	/* If matched route found, return it. */
 	if (matched)
 		return route_lock_node(matched);
@@ -299,8 +426,13 @@ struct route_node *route_node_get(struct route_table *table,
 	if (node && node->info)
 		return route_lock_node(node);
 
-	match = NULL;
-	node = table->top;
+	node = route_stride_start(table, p);
+	if (node)
+		match = node->parent;
+	else {
+		match = NULL;
+		node = table->top;
+	}
 	while (node && node->p.prefixlen <= prefixlen
 	       && prefix_match(&node->p, p)) {
 		if (node->p.prefixlen == prefixlen)
@@ -316,6 +448,7 @@ struct route_node *route_node_get(struct route_table *table,
 			set_link(match, new);
 		else
 			table->top = new;
+		route_stride_add(table, new);
 	} else {
 		new = route_node_new(table);
 		route_common(&node->p, p, &new->p);
@@ -328,11 +461,13 @@ struct route_node *route_node_get(struct route_table *table,
 			set_link(match, new);
 		else
 			table->top = new;
+		route_stride_add(table, new);
 
 		if (new->p.prefixlen != p->prefixlen) {
 			match = new;
 			new = route_node_set(table, p);
 			set_link(match, new);
+			route_stride_add(table, new);
 			table->count++;
 		}
 	}
@@ -375,6 +510,7 @@ void route_node_delete(struct route_node *node)
 	node->table->count--;
 
 	rn_hash_node_del(&node->table->hash, node);
+	route_stride_del(node->table, node, parent);
 
 	/* WARNING: FRAGILE CODE!
 	 * route_node_free may have the side effect of free'ing the entire
@@ -61,11 +61,20 @@ struct route_table_delegate_t_ {
 
 PREDECL_HASH(rn_hash_node)
 
+struct route_table_stride;
+struct srcdest_index;
+
 /* Routing table top structure. */
 struct route_table {
 	struct route_node *top;
 	struct rn_hash_node_head hash;
 
+	/* optional level-compression index, see route_table_set_stride() */
+	struct route_table_stride *stride;
+
+	/* (dst, src) index of a srcdest table, see lib/srcdest_table.c */
+	struct srcdest_index *srcdest_index;
+
 	/*
 	 * Delegate that performs certain functions for this table.
 	 */
@@ -221,6 +230,18 @@ ext_pure struct route_node *route_node_match_ipv6(struct route_table *table,
 
 ext_pure unsigned long route_table_count(struct route_table *table);
 
+/*
+ * Direct-indexed first level for longest-prefix-match lookups on large
+ * tables.  The first "bits" bits of a "family" address select the deepest
+ * node of prefix length <= bits covering it, so route_node_match() (and
+ * route_node_get()) skip the top of the tree.  Costs 2^bits pointers per
+ * table; meant for full-table RIBs.  bits == 0 removes the index.
+ */
+#define ROUTE_TABLE_STRIDE_MAX 20
+
+extern void route_table_set_stride(struct route_table *table, uint8_t family,
+				   uint8_t bits);
+
 extern struct route_node *route_node_create(route_table_delegate_t *delegate,
 					    struct route_table *table);
 extern void route_node_delete(struct route_node *node);
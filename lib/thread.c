@@ -37,11 +37,14 @@
 #include "lib_errors.h"
 #include "libfrr_trace.h"
 #include "libfrr.h"
+#include "json.h"
+#include "heartbeat.h"
 
 DEFINE_MTYPE_STATIC(LIB, THREAD, "Thread")
 DEFINE_MTYPE_STATIC(LIB, THREAD_MASTER, "Thread master")
 DEFINE_MTYPE_STATIC(LIB, THREAD_POLL, "Thread Poll Info")
 DEFINE_MTYPE_STATIC(LIB, THREAD_STATS, "Thread stats")
+DEFINE_MTYPE_STATIC(LIB, THREAD_WHEEL, "Thread timer wheel")
 
 DECLARE_LIST(thread_list, struct thread, threaditem)
 
@@ -61,17 +64,264 @@ static int thread_timer_cmp(const struct thread *a, const struct thread *b)
 DECLARE_HEAP(thread_timer_list, struct thread, timeritem,
 		thread_timer_cmp)
 
+DECLARE_ATOMLIST(thread_inbox, struct thread, inboxitem)
+
+/*
+ * Hierarchical timing wheel, optional replacement for the timer heap for
+ * longer timers.  TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots
+ * each; level 0 has a resolution of one tick, each higher level one
+ * TIMER_WHEEL_SLOTS-th of that.  Timers on higher levels are moved down
+ * ("cascaded") when their slot comes up.  With 10ms ticks, 8 bits x 4
+ * levels covers ~497 days; anything beyond is cascaded again later.
+ */
+DECLARE_DLIST(thread_wheel_list, struct thread, wheelitem)
+
+#define TIMER_WHEEL_TICK	10000 /* usec */
+#define TIMER_WHEEL_BITS	8
+#define TIMER_WHEEL_SLOTS	(1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS	4
+
+struct thread_timer_wheel {
+	/* last tick that was processed */
+	uint64_t now;
+	size_t count;
+
+	uint64_t occupied[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS / 64];
+	struct thread_wheel_list_head slots[TIMER_WHEEL_LEVELS]
+					   [TIMER_WHEEL_SLOTS];
+};
+
+static uint64_t timer_wheel_tick(const struct timeval *tv, bool roundup)
+{
+	uint64_t tick = (uint64_t)tv->tv_sec * (TIMER_SECOND_MICRO
+						/ TIMER_WHEEL_TICK)
+			+ tv->tv_usec / TIMER_WHEEL_TICK;
+
+	if (roundup && (tv->tv_usec % TIMER_WHEEL_TICK))
+		tick++;
+	return tick;
+}
+
+/* first is the earliest tick the timer may land on; w->now + 1 for new
+ * timers since the current slot has already been processed, w->now while
+ * cascading since level 0 is expired right after that.
+ */
+static void timer_wheel_insert(struct thread_timer_wheel *w,
+			       struct thread *thread, uint64_t first)
+{
+	uint64_t expire = timer_wheel_tick(&thread->u.sands, true);
+	uint64_t delta;
+	unsigned int level, slot;
+
+	if (expire < first)
+		expire = first;
+	delta = expire - w->now;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+		if (delta < (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+			break;
+
+	/* too far out; park on the top level and get cascaded again */
+	if (delta >= (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)))
+		expire = w->now
+			 + (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+	slot = (expire >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+
+	thread_wheel_list_add_tail(&w->slots[level][slot], thread);
+	w->occupied[level][slot / 64] |= 1ULL << (slot % 64);
+	thread->wheelslot = level * TIMER_WHEEL_SLOTS + slot + 1;
+	w->count++;
+}
+
+static void timer_wheel_add(struct thread_timer_wheel *w,
+			    struct thread *thread)
+{
+	timer_wheel_insert(w, thread, w->now + 1);
+}
+
+static void timer_wheel_del(struct thread_timer_wheel *w,
+			    struct thread *thread)
+{
+	unsigned int level = (thread->wheelslot - 1) / TIMER_WHEEL_SLOTS;
+	unsigned int slot = (thread->wheelslot - 1) % TIMER_WHEEL_SLOTS;
+	struct thread_wheel_list_head *head = &w->slots[level][slot];
+
+	thread_wheel_list_del(head, thread);
+	if (!thread_wheel_list_count(head))
+		w->occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+	thread->wheelslot = 0;
+	w->count--;
+}
+
+/* first occupied slot on a level, in the order they will come up */
+static int timer_wheel_next_slot(const uint64_t *occupied, unsigned int pos)
+{
+	unsigned int start = (pos + 1) & TIMER_WHEEL_MASK;
+
+	for (unsigned int i = 0; i <= TIMER_WHEEL_SLOTS / 64; i++) {
+		unsigned int word = ((start / 64) + i) % (TIMER_WHEEL_SLOTS / 64);
+		uint64_t bits = occupied[word];
+
+		/* first word: ignore slots before start; last: only those */
+		if (i == 0)
+			bits &= ~0ULL << (start % 64);
+		else if (i == TIMER_WHEEL_SLOTS / 64)
+			bits &= (start % 64) ? ~(~0ULL << (start % 64)) : 0;
+		if (bits)
+			return word * 64 + __builtin_ctzll(bits);
+	}
+	return -1;
+}
+
+/* next tick at which something needs to be expired or cascaded */
+static bool timer_wheel_next(const struct thread_timer_wheel *w,
+			     uint64_t *tick)
+{
+	bool found = false;
+
+	if (!w->count)
+		return false;
+
+	for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		unsigned int shift = TIMER_WHEEL_BITS * level;
+		uint64_t base = w->now >> shift;
+		unsigned int pos = base & TIMER_WHEEL_MASK;
+		int slot = timer_wheel_next_slot(w->occupied[level], pos);
+		uint64_t when;
+
+		if (slot < 0)
+			continue;
+
+		when = (base + (((unsigned int)slot - pos - 1)
+				& TIMER_WHEEL_MASK) + 1) << shift;
+		if (!found || when < *tick)
+			*tick = when;
+		found = true;
+	}
+	return found;
+}
+
+/* move everything in a slot back onto the wheel relative to w->now */
+static void timer_wheel_cascade(struct thread_timer_wheel *w,
+				unsigned int level, unsigned int slot)
+{
+	struct thread_wheel_list_head tmp;
+	struct thread *thread;
+
+	thread_wheel_list_init(&tmp);
+	while ((thread = thread_wheel_list_first(&w->slots[level][slot]))) {
+		timer_wheel_del(w, thread);
+		thread_wheel_list_add_tail(&tmp, thread);
+	}
+	while ((thread = thread_wheel_list_pop(&tmp)))
+		timer_wheel_insert(w, thread, w->now);
+	thread_wheel_list_fini(&tmp);
+}
+
+static unsigned int timer_wheel_process(struct thread_timer_wheel *w,
+					struct timeval *timenow)
+{
+	uint64_t target = timer_wheel_tick(timenow, false);
+	unsigned int ready = 0;
+	struct thread *thread;
+	uint64_t tick;
+
+	while (timer_wheel_next(w, &tick) && tick <= target) {
+		unsigned int level, slot;
+
+		w->now = tick;
+
+		for (level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+			unsigned int shift = TIMER_WHEEL_BITS * level;
+
+			if (tick & ((1ULL << shift) - 1))
+				continue;
+			timer_wheel_cascade(w, level,
+					    (tick >> shift) & TIMER_WHEEL_MASK);
+		}
+
+		slot = tick & TIMER_WHEEL_MASK;
+		while ((thread = thread_wheel_list_first(&w->slots[0][slot]))) {
+			timer_wheel_del(w, thread);
+			thread->readytime = thread->u.sands;
+			thread->type = THREAD_READY;
+			thread_list_add_tail(&thread->master->ready, thread);
+			ready++;
+		}
+	}
+
+	if (target > w->now)
+		w->now = target;
+	return ready;
+}
+
+static struct thread_timer_wheel *timer_wheel_new(void)
+{
+	struct thread_timer_wheel *w;
+	struct timeval now;
+
+	w = XCALLOC(MTYPE_THREAD_WHEEL, sizeof(*w));
+	for (unsigned int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+		for (unsigned int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+			thread_wheel_list_init(&w->slots[level][slot]);
+
+	monotime(&now);
+	w->now = timer_wheel_tick(&now, false);
+	return w;
+}
+
 #if defined(__APPLE__)
 #include <mach/mach.h>
 #include <mach/mach_time.h>
 #endif
 
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+#ifdef HAVE_KQUEUE
+#include <sys/event.h>
+#endif
+
 #define AWAKEN(m)                                                              \
 	do {                                                                   \
 		const unsigned char wakebyte = 0x01;                           \
 		write(m->io_pipe[1], &wakebyte, 1);                            \
 	} while (0);
 
+/*
+ * The thread_master can use one of several kernel interfaces to wait for
+ * file descriptors to become ready.  poll() is always available and serves
+ * as fallback; epoll and kqueue avoid rebuilding and rescanning the whole
+ * descriptor set on every loop iteration, which matters once a daemon has
+ * a few thousand sockets open.
+ *
+ * All backend methods except ->wait are called with m->mtx held.  ->wait is
+ * called without the lock, from the owning pthread only.
+ */
+struct thread_io_backend {
+	const char *name;
+
+	bool (*init)(struct thread_master *m);
+	void (*fini)(struct thread_master *m);
+
+	/* start / stop watching fd for POLLIN and/or POLLOUT */
+	void (*add)(struct thread_master *m, int fd, short events);
+	void (*cancel)(struct thread_master *m, int fd, short events);
+
+	/* prepare for sleeping, called right before ->wait */
+	void (*prepare)(struct thread_master *m);
+	/* sleep; returns number of ready fds (excluding the pipe poker) */
+	int (*wait)(struct thread_master *m, int timeout, sigset_t *origsigs);
+	/* move threads for ready descriptors onto the ready list */
+	void (*process)(struct thread_master *m, unsigned int num);
+
+	/* number of descriptors with pending I/O threads */
+	nfds_t (*count)(struct thread_master *m);
+	void (*show)(struct vty *vty, struct thread_master *m);
+};
+
 /* control variable for initializer */
 static pthread_once_t init_once = PTHREAD_ONCE_INIT;
 pthread_key_t thread_current;
@@ -80,6 +330,8 @@ static pthread_mutex_t masters_mtx = PTHREAD_MUTEX_INITIALIZER;
 static struct list *masters;
 
 static void thread_free(struct thread_master *master, struct thread *thread);
+static void thread_io_init(struct thread_master *m);
+static void thread_inbox_drain(struct thread_master *m);
 
 /* CLI start ---------------------------------------------------------------- */
 static unsigned int cpu_record_hash_key(const struct cpu_thread_history *a)
@@ -220,6 +472,130 @@ static void cpu_record_print(struct vty *vty, uint8_t filter)
 	if (tmp.total_calls > 0)
 		vty_out_cpu_thread_history(vty, &tmp);
 }
+
+static void hist_copy(size_t *dst, atomic_size_t *src)
+{
+	for (unsigned int i = 0; i < THREAD_HIST_BUCKETS; i++)
+		dst[i] = atomic_load_explicit(&src[i], memory_order_relaxed);
+}
+
+static void vty_out_hist(struct vty *vty, const char *label,
+			 const size_t *hist)
+{
+	vty_out(vty, "  %-12s", label);
+	for (unsigned int i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (i == THREAD_HIST_BUCKETS - 1)
+			vty_out(vty, " >=%lu:%zu", 1UL << (i - 1), hist[i]);
+		else
+			vty_out(vty, " <%lu:%zu", 1UL << i, hist[i]);
+	}
+	vty_out(vty, "\n");
+}
+
+static struct json_object *json_hist(const size_t *hist)
+{
+	struct json_object *json = json_object_new_object();
+	char key[32];
+
+	/* keyed by bucket upper bound in usec */
+	for (unsigned int i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (i == THREAD_HIST_BUCKETS - 1)
+			snprintf(key, sizeof(key), "inf");
+		else
+			snprintf(key, sizeof(key), "%lu", 1UL << i);
+		json_object_int_add(json, key, hist[i]);
+	}
+	return json;
+}
+
+static void cpu_record_hash_print_hist(struct hash_bucket *bucket,
+				       void *args[])
+{
+	struct vty *vty = args[0];
+	uint8_t *filter = args[1];
+	struct json_object *json = args[2];
+	struct cpu_thread_history *a = bucket->data;
+	size_t runtime[THREAD_HIST_BUCKETS], sched[THREAD_HIST_BUCKETS];
+	size_t calls;
+	uint32_t types;
+
+	types = atomic_load_explicit(&a->types, memory_order_seq_cst);
+	calls = atomic_load_explicit(&a->total_calls, memory_order_seq_cst);
+	if (!(types & *filter) || !calls)
+		return;
+
+	hist_copy(runtime, a->runtime_hist);
+	hist_copy(sched, a->sched_hist);
+
+	if (json) {
+		struct json_object *json_func = json_object_new_object();
+
+		json_object_int_add(json_func, "totalCalls", calls);
+		json_object_object_add(json_func, "runtime", json_hist(runtime));
+		json_object_object_add(json_func, "schedDelay",
+				       json_hist(sched));
+		json_object_object_add(json, a->funcname, json_func);
+		return;
+	}
+
+	vty_out(vty, "%s (%zu calls)\n", a->funcname, calls);
+	vty_out_hist(vty, "runtime", runtime);
+	vty_out_hist(vty, "sched delay", sched);
+}
+
+static void cpu_record_print_hist(struct vty *vty, uint8_t filter,
+				  bool use_json)
+{
+	struct json_object *json = NULL, *json_thread;
+	struct thread_master *m;
+	struct listnode *ln;
+
+	if (use_json)
+		json = json_object_new_object();
+
+	frr_with_mutex(&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, ln, m)) {
+			const char *name = m->name ? m->name : "main";
+			void *args[3] = {vty, &filter, NULL};
+
+			if (json) {
+				json_thread = json_object_new_object();
+				json_object_object_add(json, name,
+						       json_thread);
+				args[2] = json_thread;
+			} else {
+				char underline[strlen(name) + 1];
+
+				memset(underline, '-', sizeof(underline));
+				underline[sizeof(underline) - 1] = '\0';
+
+				vty_out(vty, "\n");
+				vty_out(vty,
+					"Showing latency histograms (usec) for pthread %s\n",
+					name);
+				vty_out(vty,
+					"-----------------------------------------------%s\n",
+					underline);
+			}
+
+			hash_iterate(m->cpu_record,
+				     (void (*)(struct hash_bucket *,
+					       void *))cpu_record_hash_print_hist,
+				     args);
+		}
+	}
+
+	if (json) {
+		vty_out(vty, "%s\n",
+			json_object_to_json_string_ext(
+				json, JSON_C_TO_STRING_PRETTY));
+		json_object_free(json);
+	}
+}
 #endif
 
 static void cpu_record_hash_clear(struct hash_bucket *bucket, void *args[])
@@ -255,6 +631,31 @@ static void cpu_record_clear(uint8_t filter)
 	}
 }
 
+static void cpu_record_hash_reset(struct hash_bucket *bucket, void *arg)
+{
+	struct cpu_thread_history *a = bucket->data;
+
+	/* threads in flight keep a pointer to this, so zero it in place */
+	atomic_store_explicit(&a->total_calls, 0, memory_order_seq_cst);
+	atomic_store_explicit(&a->real.total, 0, memory_order_seq_cst);
+	atomic_store_explicit(&a->real.max, 0, memory_order_seq_cst);
+	atomic_store_explicit(&a->cpu.total, 0, memory_order_seq_cst);
+	atomic_store_explicit(&a->cpu.max, 0, memory_order_seq_cst);
+	for (unsigned int i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		atomic_store_explicit(&a->runtime_hist[i], 0,
+				      memory_order_relaxed);
+		atomic_store_explicit(&a->sched_hist[i], 0,
+				      memory_order_relaxed);
+	}
+}
+
+void thread_master_stats_reset(struct thread_master *m)
+{
+	frr_with_mutex(&m->mtx) {
+		hash_iterate(m->cpu_record, cpu_record_hash_reset, NULL);
+	}
+}
+
 static uint8_t parse_filter(const char *filterstr)
 {
 	int i = 0;
@@ -315,47 +716,45 @@ DEFUN (show_thread_cpu,
 	cpu_record_print(vty, filter);
 	return CMD_SUCCESS;
 }
+
+DEFUN (show_thread_latency,
+       show_thread_latency_cmd,
+       "show thread latency [FILTER] [json]",
+       SHOW_STR
+       "Thread information\n"
+       "Thread runtime and scheduling delay histograms\n"
+       "Display filter (rwtex)\n"
+       JSON_STR)
+{
+	uint8_t filter = (uint8_t)-1U;
+	int idx = 0;
+
+	if (argv_find(argv, argc, "FILTER", &idx)) {
+		filter = parse_filter(argv[idx]->arg);
+		if (!filter) {
+			vty_out(vty,
+				"Invalid filter \"%s\" specified; must contain at leastone of 'RWTEXB'\n",
+				argv[idx]->arg);
+			return CMD_WARNING;
+		}
+	}
+
+	cpu_record_print_hist(vty, filter, use_json(argc, argv));
+	return CMD_SUCCESS;
+}
 #endif
 
 static void show_thread_poll_helper(struct vty *vty, struct thread_master *m)
 {
 	const char *name = m->name ? m->name : "main";
 	char underline[strlen(name) + 1];
-	struct thread *thread;
-	uint32_t i;
 
 	memset(underline, '-', sizeof(underline));
 	underline[sizeof(underline) - 1] = '\0';
 
 	vty_out(vty, "\nShowing poll FD's for %s\n", name);
 	vty_out(vty, "----------------------%s\n", underline);
-	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
-		m->fd_limit);
-	for (i = 0; i < m->handler.pfdcount; i++) {
-		vty_out(vty, "\t%6d fd:%6d events:%2d revents:%2d\t\t", i,
-			m->handler.pfds[i].fd, m->handler.pfds[i].events,
-			m->handler.pfds[i].revents);
-
-		if (m->handler.pfds[i].events & POLLIN) {
-			thread = m->read[m->handler.pfds[i].fd];
-
-			if (!thread)
-				vty_out(vty, "ERROR ");
-			else
-				vty_out(vty, "%s ", thread->funcname);
-		} else
-			vty_out(vty, " ");
-
-		if (m->handler.pfds[i].events & POLLOUT) {
-			thread = m->write[m->handler.pfds[i].fd];
-
-			if (!thread)
-				vty_out(vty, "ERROR\n");
-			else
-				vty_out(vty, "%s\n", thread->funcname);
-		} else
-			vty_out(vty, "\n");
-	}
+	m->handler.backend->show(vty, m);
 }
 
 DEFUN (show_thread_poll,
@@ -403,13 +802,45 @@ DEFUN (clear_thread_cpu,
 	return CMD_SUCCESS;
 }
 
+DEFUN (clear_thread_cpu_pthread,
+       clear_thread_cpu_pthread_cmd,
+       "clear thread cpu pthread NAME",
+       "Clear stored data in all pthreads\n"
+       "Thread information\n"
+       "Thread CPU usage\n"
+       "Only clear data for one pthread\n"
+       "pthread name, as shown in \"show thread cpu\"\n")
+{
+	const char *name = argv[4]->arg;
+	struct thread_master *m;
+	struct listnode *ln;
+	bool found = false;
+
+	frr_with_mutex(&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, ln, m)) {
+			if (strcmp(m->name ? m->name : "main", name))
+				continue;
+			thread_master_stats_reset(m);
+			found = true;
+		}
+	}
+
+	if (!found) {
+		vty_out(vty, "%% No pthread named \"%s\"\n", name);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
 void thread_cmd_init(void)
 {
 #ifndef EXCLUDE_CPU_TIME
 	install_element(VIEW_NODE, &show_thread_cpu_cmd);
+	install_element(VIEW_NODE, &show_thread_latency_cmd);
 #endif
 	install_element(VIEW_NODE, &show_thread_poll_cmd);
 	install_element(ENABLE_NODE, &clear_thread_cpu_cmd);
+	install_element(ENABLE_NODE, &clear_thread_cpu_pthread_cmd);
 }
 /* CLI end ------------------------------------------------------------------ */
 
@@ -419,10 +850,30 @@ static void cancelreq_del(void *cr)
 	XFREE(MTYPE_TMP, cr);
 }
 
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+/* kernel event objects must not be shared with (or, for kqueue, are not
+ * even inherited by) a forked child; have each master rebuild its own.
+ */
+static void thread_atfork_child(void)
+{
+	struct thread_master *m;
+	struct listnode *ln;
+
+	if (!masters)
+		return;
+
+	for (ALL_LIST_ELEMENTS_RO(masters, ln, m))
+		m->handler.kfd_stale = true;
+}
+#endif
+
 /* initializer, only ever called once */
 static void initializer(void)
 {
 	pthread_key_create(&thread_current, NULL);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+	pthread_atfork(NULL, NULL, thread_atfork_child);
+#endif
 }
 
 struct thread_master *thread_master_create(const char *name)
@@ -469,6 +920,7 @@ struct thread_master *thread_master_create(const char *name)
 	thread_list_init(&rv->ready);
 	thread_list_init(&rv->unuse);
 	thread_timer_list_init(&rv->timer);
+	thread_inbox_init(&rv->inbox);
 
 	/* Initialize thread_fetch() settings */
 	rv->spin = true;
@@ -485,13 +937,8 @@ struct thread_master *thread_master_create(const char *name)
 	set_nonblocking(rv->io_pipe[0]);
 	set_nonblocking(rv->io_pipe[1]);
 
-	/* Initialize data structures for poll() */
-	rv->handler.pfdsize = rv->fd_limit;
-	rv->handler.pfdcount = 0;
-	rv->handler.pfds = XCALLOC(MTYPE_THREAD_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
-	rv->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
+	/* Initialize data structures for the I/O backend */
+	thread_io_init(rv);
 
 	/* add to list of threadmasters */
 	frr_with_mutex(&masters_mtx) {
@@ -595,6 +1042,20 @@ void thread_master_free(struct thread_master *m)
 	thread_array_free(m, m->write);
 	while ((t = thread_timer_list_pop(&m->timer)))
 		thread_free(m, t);
+	if (m->wheel) {
+		for (unsigned int i = 0;
+		     i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; i++) {
+			struct thread_wheel_list_head *head;
+
+			head = &m->wheel->slots[i / TIMER_WHEEL_SLOTS]
+					       [i % TIMER_WHEEL_SLOTS];
+			while ((t = thread_wheel_list_pop(head)))
+				thread_free(m, t);
+			thread_wheel_list_fini(head);
+		}
+		XFREE(MTYPE_THREAD_WHEEL, m->wheel);
+	}
+	thread_inbox_drain(m);
 	thread_list_free(m, &m->event);
 	thread_list_free(m, &m->ready);
 	thread_list_free(m, &m->unuse);
@@ -610,11 +1071,38 @@ void thread_master_free(struct thread_master *m)
 	m->cpu_record = NULL;
 
 	XFREE(MTYPE_THREAD_MASTER, m->name);
-	XFREE(MTYPE_THREAD_MASTER, m->handler.pfds);
-	XFREE(MTYPE_THREAD_MASTER, m->handler.copy);
+	m->handler.backend->fini(m);
 	XFREE(MTYPE_THREAD_MASTER, m);
 }
 
+void thread_master_set_timer_wheel(struct thread_master *m, bool enable)
+{
+	frr_with_mutex(&m->mtx) {
+		m->wheel_all = enable;
+		if (enable && !m->wheel)
+			m->wheel = timer_wheel_new();
+		else if (!enable && m->wheel) {
+			struct thread_timer_wheel *w = m->wheel;
+			struct thread *t;
+
+			/* move anything still pending over to the heap */
+			for (unsigned int i = 0;
+			     i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; i++) {
+				struct thread_wheel_list_head *head;
+
+				head = &w->slots[i / TIMER_WHEEL_SLOTS]
+						[i % TIMER_WHEEL_SLOTS];
+				while ((t = thread_wheel_list_first(head))) {
+					timer_wheel_del(w, t);
+					thread_timer_list_add(&m->timer, t);
+				}
+				thread_wheel_list_fini(head);
+			}
+			XFREE(MTYPE_THREAD_WHEEL, m->wheel);
+		}
+	}
+}
+
 /* Return remain time in miliseconds. */
 unsigned long thread_timer_remain_msec(struct thread *thread)
 {
@@ -714,32 +1202,911 @@ static struct thread *thread_get(struct thread_master *m, uint8_t type,
 			hash_get(m->cpu_record, &tmp,
 				 (void *(*)(void *))cpu_record_hash_alloc);
 	}
-	thread->hist->total_active++;
-	thread->func = func;
-	thread->funcname = funcname;
-	thread->schedfrom = schedfrom;
-	thread->schedfrom_line = fromln;
+	thread->hist->total_active++;
+	thread->func = func;
+	thread->funcname = funcname;
+	thread->schedfrom = schedfrom;
+	thread->schedfrom_line = fromln;
+
+	return thread;
+}
+
+static void thread_free(struct thread_master *master, struct thread *thread)
+{
+	/* Update statistics. */
+	assert(master->alloc > 0);
+	master->alloc--;
+
+	/* Free allocated resources. */
+	pthread_mutex_destroy(&thread->mtx);
+	XFREE(MTYPE_THREAD, thread);
+}
+
+static void thread_process_io_helper(struct thread_master *m,
+				     struct thread *thread, short state,
+				     short actual_state, int fd);
+
+/* I/O readiness backends -------------------------------------------------- */
+
+/* drain the pipe poker; it's only there to wake us up */
+static void thread_io_pipe_drain(struct thread_master *m)
+{
+	unsigned char trash[64];
+
+	while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
+		;
+}
+
+/* poll() ------------------------------------------------------------------ */
+
+static bool fd_poll_init(struct thread_master *m)
+{
+	m->handler.pfdsize = m->fd_limit;
+	m->handler.pfdcount = 0;
+	m->handler.pfds = XCALLOC(MTYPE_THREAD_MASTER,
+				  sizeof(struct pollfd) * m->handler.pfdsize);
+	m->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
+				  sizeof(struct pollfd) * m->handler.pfdsize);
+	return true;
+}
+
+static void fd_poll_fini(struct thread_master *m)
+{
+	XFREE(MTYPE_THREAD_MASTER, m->handler.pfds);
+	XFREE(MTYPE_THREAD_MASTER, m->handler.copy);
+}
+
+static void fd_poll_add(struct thread_master *m, int fd, short events)
+{
+	/* default to a new pollfd */
+	nfds_t queuepos = m->handler.pfdcount;
+
+	/* if we already have a pollfd for our file descriptor, find and
+	 * use it */
+	for (nfds_t i = 0; i < m->handler.pfdcount; i++)
+		if (m->handler.pfds[i].fd == fd) {
+			queuepos = i;
+			break;
+		}
+
+	/* make sure we have room for this fd + pipe poker fd */
+	assert(queuepos + 1 < m->handler.pfdsize);
+
+	m->handler.pfds[queuepos].fd = fd;
+	m->handler.pfds[queuepos].events |= events;
+
+	if (queuepos == m->handler.pfdcount)
+		m->handler.pfdcount++;
+}
+
+/**
+ * NOT's out the .events field of pollfd corresponding to the given file
+ * descriptor. The event to be NOT'd is passed in the 'state' parameter.
+ *
+ * This needs to happen for both copies of pollfd's. See 'thread_fetch'
+ * implementation for details.
+ *
+ * @param master
+ * @param fd
+ * @param state the event to cancel. One or more (OR'd together) of the
+ * following:
+ *   - POLLIN
+ *   - POLLOUT
+ */
+static void fd_poll_cancel(struct thread_master *master, int fd, short state)
+{
+	bool found = false;
+
+	/* Cancel POLLHUP too just in case some bozo set it */
+	state |= POLLHUP;
+
+	/* find the index of corresponding pollfd */
+	nfds_t i;
+
+	for (i = 0; i < master->handler.pfdcount; i++)
+		if (master->handler.pfds[i].fd == fd) {
+			found = true;
+			break;
+		}
+
+	if (!found) {
+		zlog_debug(
+			"[!] Received cancellation request for nonexistent rw job");
+		zlog_debug("[!] threadmaster: %s | fd: %d",
+			   master->name ? master->name : "", fd);
+		return;
+	}
+
+	/* NOT out event. */
+	master->handler.pfds[i].events &= ~(state);
+
+	/* If all events are canceled, delete / resize the pollfd array. */
+	if (master->handler.pfds[i].events == 0) {
+		memmove(master->handler.pfds + i, master->handler.pfds + i + 1,
+			(master->handler.pfdcount - i - 1)
+				* sizeof(struct pollfd));
+		master->handler.pfdcount--;
+		master->handler.pfds[master->handler.pfdcount].fd = 0;
+		master->handler.pfds[master->handler.pfdcount].events = 0;
+	}
+
+	/* If we have the same pollfd in the copy, perform the same operations,
+	 * otherwise return. */
+	if (i >= master->handler.copycount)
+		return;
+
+	master->handler.copy[i].events &= ~(state);
+
+	if (master->handler.copy[i].events == 0) {
+		memmove(master->handler.copy + i, master->handler.copy + i + 1,
+			(master->handler.copycount - i - 1)
+				* sizeof(struct pollfd));
+		master->handler.copycount--;
+		master->handler.copy[master->handler.copycount].fd = 0;
+	        master->handler.copy[master->handler.copycount].events = 0;
+	}
+}
+
+static void fd_poll_prepare(struct thread_master *m)
+{
+	/*
+	 * Copy pollfd array + # active pollfds in it. Not necessary to
+	 * copy the array size as this is fixed.
+	 */
+	m->handler.copycount = m->handler.pfdcount;
+	memcpy(m->handler.copy, m->handler.pfds,
+	       m->handler.copycount * sizeof(struct pollfd));
+}
+
+static int fd_poll_wait(struct thread_master *m, int timeout,
+			sigset_t *origsigs)
+{
+	nfds_t count = m->handler.copycount;
+	int num;
+
+	/* add poll pipe poker */
+	assert(count + 1 < m->handler.pfdsize);
+	m->handler.copy[count].fd = m->io_pipe[0];
+	m->handler.copy[count].events = POLLIN;
+	m->handler.copy[count].revents = 0x00;
+
+#if defined(HAVE_PPOLL)
+	struct timespec ts, *tsp;
+
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		tsp = &ts;
+	} else
+		tsp = NULL;
+
+	num = ppoll(m->handler.copy, count + 1, tsp, origsigs);
+	pthread_sigmask(SIG_SETMASK, origsigs, NULL);
+#else
+	/* Not ideal - there is a race after we restore the signal mask */
+	pthread_sigmask(SIG_SETMASK, origsigs, NULL);
+	num = poll(m->handler.copy, count + 1, timeout);
+#endif
+
+	if (num > 0 && m->handler.copy[count].revents != 0 && num--)
+		thread_io_pipe_drain(m);
+
+	return num;
+}
+
+/**
+ * Process I/O events.
+ *
+ * Walks through file descriptor array looking for those pollfds whose .revents
+ * field has something interesting. Deletes any invalid file descriptors.
+ *
+ * @param m the thread master
+ * @param num the number of active file descriptors (return value of poll())
+ */
+static void fd_poll_process(struct thread_master *m, unsigned int num)
+{
+	unsigned int ready = 0;
+	struct pollfd *pfds = m->handler.copy;
+
+	for (nfds_t i = 0; i < m->handler.copycount && ready < num; ++i) {
+		/* no event for current fd? immediately continue */
+		if (pfds[i].revents == 0)
+			continue;
+
+		ready++;
+
+		/*
+		 * Unless someone has called thread_cancel from another
+		 * pthread, the only thing that could have changed in
+		 * m->handler.pfds while we were asleep is the .events
+		 * field in a given pollfd. Barring thread_cancel() that
+		 * value should be a superset of the values we have in our
+		 * copy, so there's no need to update it. Similarily,
+		 * barring deletion, the fd should still be a valid index
+		 * into the master's pfds.
+		 *
+		 * We are including POLLERR here to do a READ event
+		 * this is because the read should fail and the
+		 * read function should handle it appropriately
+		 *
+		 * poll() clears the .events field, but the pollfd array we
+		 * pass to poll() is a copy of the one used to schedule
+		 * threads.  We need to synchronize state between the two
+		 * here by applying the same changes poll() made on the copy
+		 * of the "real" pollfd array.
+		 *
+		 * This cleans up a possible infinite loop where we refuse
+		 * to respond to a poll event but poll is insistent that
+		 * we should.
+		 */
+		if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+			m->handler.pfds[i].events &= ~POLLIN;
+			thread_process_io_helper(m, m->read[pfds[i].fd], POLLIN,
+						 pfds[i].revents, pfds[i].fd);
+		}
+		if (pfds[i].revents & POLLOUT) {
+			m->handler.pfds[i].events &= ~POLLOUT;
+			thread_process_io_helper(m, m->write[pfds[i].fd],
+						 POLLOUT, pfds[i].revents,
+						 pfds[i].fd);
+		}
+
+		/* if one of our file descriptors is garbage, remove the same
+		 * from
+		 * both pfds + update sizes and index */
+		if (pfds[i].revents & POLLNVAL) {
+			memmove(m->handler.pfds + i, m->handler.pfds + i + 1,
+				(m->handler.pfdcount - i - 1)
+					* sizeof(struct pollfd));
+			m->handler.pfdcount--;
+			m->handler.pfds[m->handler.pfdcount].fd = 0;
+			m->handler.pfds[m->handler.pfdcount].events = 0;
+
+			memmove(pfds + i, pfds + i + 1,
+				(m->handler.copycount - i - 1)
+					* sizeof(struct pollfd));
+			m->handler.copycount--;
+			m->handler.copy[m->handler.copycount].fd = 0;
+			m->handler.copy[m->handler.copycount].events = 0;
+
+			i--;
+		}
+	}
+}
+
+static nfds_t fd_poll_count(struct thread_master *m)
+{
+	return m->handler.pfdcount;
+}
+
+static void fd_poll_show(struct vty *vty, struct thread_master *m)
+{
+	struct thread *thread;
+	uint32_t i;
+
+	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
+		m->fd_limit);
+	for (i = 0; i < m->handler.pfdcount; i++) {
+		vty_out(vty, "\t%6d fd:%6d events:%2d revents:%2d\t\t", i,
+			m->handler.pfds[i].fd, m->handler.pfds[i].events,
+			m->handler.pfds[i].revents);
+
+		if (m->handler.pfds[i].events & POLLIN) {
+			thread = m->read[m->handler.pfds[i].fd];
+
+			if (!thread)
+				vty_out(vty, "ERROR ");
+			else
+				vty_out(vty, "%s ", thread->funcname);
+		} else
+			vty_out(vty, " ");
+
+		if (m->handler.pfds[i].events & POLLOUT) {
+			thread = m->write[m->handler.pfds[i].fd];
+
+			if (!thread)
+				vty_out(vty, "ERROR\n");
+			else
+				vty_out(vty, "%s\n", thread->funcname);
+		} else
+			vty_out(vty, "\n");
+	}
+}
+
+static const struct thread_io_backend fd_poll_backend = {
+	.name = "poll",
+	.init = fd_poll_init,
+	.fini = fd_poll_fini,
+	.add = fd_poll_add,
+	.cancel = fd_poll_cancel,
+	.prepare = fd_poll_prepare,
+	.wait = fd_poll_wait,
+	.process = fd_poll_process,
+	.count = fd_poll_count,
+	.show = fd_poll_show,
+};
+
+/* common bits for epoll and kqueue ---------------------------------------- */
+
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+
+/* private flags in handler.armed[], on top of POLLIN / POLLOUT */
+#define FD_ARMED_DIRTY		0x4000
+#define FD_ARMED_NOPOLL		0x2000
+#define FD_ARMED_STALE		0x1000
+#define FD_ARMED_EVENTS		(POLLIN | POLLOUT)
+
+/* size of the result buffer handed to the kernel */
+#define FD_KERNEL_EVENTS	1024
+
+static void fd_kernel_alloc(struct thread_master *m, size_t evsize)
+{
+	m->handler.kfd = -1;
+	m->handler.want = XCALLOC(MTYPE_THREAD_POLL,
+				  sizeof(short) * m->fd_limit);
+	m->handler.armed = XCALLOC(MTYPE_THREAD_POLL,
+				   sizeof(short) * m->fd_limit);
+	m->handler.dirty = XCALLOC(MTYPE_THREAD_POLL,
+				   sizeof(int) * m->fd_limit);
+	m->handler.eventsize = MIN(m->fd_limit + 1, FD_KERNEL_EVENTS);
+	m->handler.events = XCALLOC(MTYPE_THREAD_POLL,
+				    evsize * m->handler.eventsize);
+}
+
+static void fd_kernel_free(struct thread_master *m)
+{
+	if (m->handler.kfd >= 0)
+		close(m->handler.kfd);
+	m->handler.kfd = -1;
+
+	XFREE(MTYPE_THREAD_POLL, m->handler.want);
+	XFREE(MTYPE_THREAD_POLL, m->handler.armed);
+	XFREE(MTYPE_THREAD_POLL, m->handler.dirty);
+	XFREE(MTYPE_THREAD_POLL, m->handler.nopoll);
+	XFREE(MTYPE_THREAD_POLL, m->handler.events);
+	XFREE(MTYPE_THREAD_POLL, m->handler.changes);
+}
+
+static void fd_kernel_dirty(struct thread_master *m, int fd)
+{
+	if (m->handler.armed[fd] & FD_ARMED_DIRTY)
+		return;
+	m->handler.armed[fd] |= FD_ARMED_DIRTY;
+	m->handler.dirty[m->handler.dirtycount++] = fd;
+}
+
+static void fd_kernel_add(struct thread_master *m, int fd, short events)
+{
+	if (!m->handler.want[fd])
+		m->handler.wantcount++;
+	m->handler.want[fd] |= events;
+	fd_kernel_dirty(m, fd);
+}
+
+static void fd_kernel_cancel(struct thread_master *m, int fd, short events)
+{
+	if (!m->handler.want[fd]) {
+		zlog_debug(
+			"[!] Received cancellation request for nonexistent rw job");
+		zlog_debug("[!] threadmaster: %s | fd: %d",
+			   m->name ? m->name : "", fd);
+		return;
+	}
+
+	m->handler.want[fd] &= ~events;
+	if (!m->handler.want[fd]) {
+		m->handler.wantcount--;
+		/*
+		 * Until the next prepare the fd may be closed and the number
+		 * reused; close() drops the kernel's registration, so if the
+		 * fd is wanted again by then, it has to be registered anew
+		 * even though want and armed match.
+		 */
+		if (!(m->handler.armed[fd] & FD_ARMED_NOPOLL))
+			m->handler.armed[fd] |= FD_ARMED_STALE;
+	}
+	fd_kernel_dirty(m, fd);
+}
+
+/* the kernel won't watch this fd (e.g. regular file); it's always ready */
+static void fd_kernel_nopoll_add(struct thread_master *m, int fd)
+{
+	if (m->handler.nopollcount == m->handler.nopollsize) {
+		m->handler.nopollsize = MAX(8, m->handler.nopollsize * 2);
+		m->handler.nopoll = XREALLOC(
+			MTYPE_THREAD_POLL, m->handler.nopoll,
+			sizeof(int) * m->handler.nopollsize);
+	}
+	m->handler.nopoll[m->handler.nopollcount++] = fd;
+	m->handler.armed[fd] = FD_ARMED_NOPOLL;
+}
+
+static void fd_kernel_nopoll_del(struct thread_master *m, int fd)
+{
+	for (int i = 0; i < m->handler.nopollcount; i++) {
+		if (m->handler.nopoll[i] != fd)
+			continue;
+		m->handler.nopoll[i] =
+			m->handler.nopoll[--m->handler.nopollcount];
+		break;
+	}
+	m->handler.armed[fd] = 0;
+}
+
+/* after fork(), re-register everything on a fresh kernel object */
+static void fd_kernel_reset(struct thread_master *m)
+{
+	m->handler.kfd_stale = false;
+	if (m->handler.kfd >= 0)
+		close(m->handler.kfd);
+	m->handler.kfd = -1;
+
+	m->handler.dirtycount = 0;
+	m->handler.nopollcount = 0;
+	for (int fd = 0; fd < m->fd_limit; fd++) {
+		m->handler.armed[fd] = 0;
+		if (m->handler.want[fd])
+			fd_kernel_dirty(m, fd);
+	}
+}
+
+static void fd_kernel_dispatch(struct thread_master *m, int fd, short revents)
+{
+	short want = m->handler.want[fd];
+
+	/*
+	 * Same rules as for poll(): errors and hangups go to the reader so
+	 * its read() fails and it cleans up.  A writer is woken up on errors
+	 * too if nobody is reading, otherwise a level-triggered error would
+	 * make us spin.
+	 */
+	if ((want & POLLIN) && (revents & (POLLIN | POLLHUP | POLLERR))) {
+		fd_kernel_cancel(m, fd, POLLIN);
+		thread_process_io_helper(m, m->read[fd], POLLIN, revents, fd);
+	}
+	if ((want & POLLOUT)
+	    && ((revents & POLLOUT)
+		|| ((revents & (POLLHUP | POLLERR)) && !(want & POLLIN)))) {
+		fd_kernel_cancel(m, fd, POLLOUT);
+		thread_process_io_helper(m, m->write[fd], POLLOUT, revents,
+					 fd);
+	}
+}
+
+static void fd_kernel_nopoll_process(struct thread_master *m)
+{
+	for (int i = 0; i < m->handler.nopollcount; i++)
+		fd_kernel_dispatch(m, m->handler.nopoll[i], POLLIN | POLLOUT);
+}
+
+static nfds_t fd_kernel_count(struct thread_master *m)
+{
+	return m->handler.wantcount;
+}
+
+static void fd_kernel_show(struct vty *vty, struct thread_master *m)
+{
+	struct thread *thread;
+	uint32_t i = 0;
+
+	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.wantcount,
+		m->fd_limit);
+	for (int fd = 0; fd < m->fd_limit; fd++) {
+		short want = m->handler.want[fd];
+
+		if (!want)
+			continue;
+
+		vty_out(vty, "\t%6d fd:%6d events:%2d revents:%2d\t\t", i++,
+			fd, want, 0);
+
+		if (want & POLLIN) {
+			thread = m->read[fd];
+
+			if (!thread)
+				vty_out(vty, "ERROR ");
+			else
+				vty_out(vty, "%s ", thread->funcname);
+		} else
+			vty_out(vty, " ");
+
+		if (want & POLLOUT) {
+			thread = m->write[fd];
+
+			if (!thread)
+				vty_out(vty, "ERROR\n");
+			else
+				vty_out(vty, "%s\n", thread->funcname);
+		} else
+			vty_out(vty, "\n");
+	}
+}
+
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+
+/* epoll ------------------------------------------------------------------- */
+
+#ifdef HAVE_EPOLL
+
+static int fd_epoll_open(struct thread_master *m)
+{
+	struct epoll_event ev = {};
+
+	m->handler.kfd = epoll_create1(EPOLL_CLOEXEC);
+	if (m->handler.kfd < 0)
+		return -1;
+
+	ev.events = EPOLLIN;
+	ev.data.fd = m->io_pipe[0];
+	if (epoll_ctl(m->handler.kfd, EPOLL_CTL_ADD, m->io_pipe[0], &ev)) {
+		close(m->handler.kfd);
+		m->handler.kfd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+static bool fd_epoll_init(struct thread_master *m)
+{
+	fd_kernel_alloc(m, sizeof(struct epoll_event));
+	if (fd_epoll_open(m) < 0) {
+		flog_err(EC_LIB_SYSTEM_CALL, "epoll_create1() failed: %s",
+			 safe_strerror(errno));
+		fd_kernel_free(m);
+		return false;
+	}
+	return true;
+}
+
+static void fd_epoll_sync(struct thread_master *m, int fd)
+{
+	short want = m->handler.want[fd];
+	short armed = m->handler.armed[fd];
+	bool stale = armed & FD_ARMED_STALE;
+	struct epoll_event ev = {};
+	int op, ret;
+
+	if (armed & FD_ARMED_NOPOLL) {
+		if (!want)
+			fd_kernel_nopoll_del(m, fd);
+		return;
+	}
+	armed &= FD_ARMED_EVENTS;
+	if (want == armed && !stale)
+		return;
+
+	ev.data.fd = fd;
+	if (want & POLLIN)
+		ev.events |= EPOLLIN;
+	if (want & POLLOUT)
+		ev.events |= EPOLLOUT;
+
+	if (!want)
+		op = EPOLL_CTL_DEL;
+	else if (!armed)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	ret = epoll_ctl(m->handler.kfd, op, fd, &ev);
+	if (ret && errno == ENOENT && op == EPOLL_CTL_MOD)
+		/* fd was closed & reopened behind our back */
+		ret = epoll_ctl(m->handler.kfd, EPOLL_CTL_ADD, fd, &ev);
+	else if (ret && errno == EEXIST && op == EPOLL_CTL_ADD)
+		ret = epoll_ctl(m->handler.kfd, EPOLL_CTL_MOD, fd, &ev);
+
+	if (ret) {
+		if (op == EPOLL_CTL_DEL && (errno == ENOENT || errno == EBADF))
+			/* closed before the thread was cancelled, fine. */
+			ret = 0;
+		else if (errno == EPERM) {
+			fd_kernel_nopoll_add(m, fd);
+			return;
+		} else
+			flog_err(EC_LIB_SYSTEM_CALL,
+				 "epoll_ctl(%d, fd %d) failed: %s", op, fd,
+				 safe_strerror(errno));
+	}
+
+	m->handler.armed[fd] = want;
+}
+
+static void fd_epoll_prepare(struct thread_master *m)
+{
+	if (m->handler.kfd_stale) {
+		fd_kernel_reset(m);
+		if (fd_epoll_open(m) < 0)
+			flog_err(EC_LIB_SYSTEM_CALL,
+				 "epoll_create1() failed: %s",
+				 safe_strerror(errno));
+	}
+
+	for (int i = 0; i < m->handler.dirtycount; i++) {
+		int fd = m->handler.dirty[i];
+
+		m->handler.armed[fd] &= ~FD_ARMED_DIRTY;
+		fd_epoll_sync(m, fd);
+	}
+	m->handler.dirtycount = 0;
+}
+
+static int fd_epoll_wait(struct thread_master *m, int timeout,
+			 sigset_t *origsigs)
+{
+	struct epoll_event *events = m->handler.events;
+	int num;
+
+	if (m->handler.nopollcount)
+		timeout = 0;
+
+	num = epoll_pwait(m->handler.kfd, events, m->handler.eventsize,
+			  timeout, origsigs);
+	pthread_sigmask(SIG_SETMASK, origsigs, NULL);
+
+	m->handler.eventcount = MAX(num, 0);
+	if (num < 0)
+		return num;
+
+	for (int i = 0; i < m->handler.eventcount; i++) {
+		if (events[i].data.fd != m->io_pipe[0])
+			continue;
+		thread_io_pipe_drain(m);
+		events[i].data.fd = -1;
+		num--;
+		break;
+	}
+	return num + m->handler.nopollcount;
+}
+
+static void fd_epoll_process(struct thread_master *m, unsigned int num)
+{
+	struct epoll_event *events = m->handler.events;
+
+	for (int i = 0; i < m->handler.eventcount; i++) {
+		int fd = events[i].data.fd;
+		short revents = 0;
+
+		if (fd < 0)
+			continue;
+
+		if (events[i].events & EPOLLIN)
+			revents |= POLLIN;
+		if (events[i].events & EPOLLOUT)
+			revents |= POLLOUT;
+		if (events[i].events & EPOLLHUP)
+			revents |= POLLHUP;
+		if (events[i].events & EPOLLERR)
+			revents |= POLLERR;
+
+		fd_kernel_dispatch(m, fd, revents);
+	}
+	m->handler.eventcount = 0;
+
+	fd_kernel_nopoll_process(m);
+}
+
+static const struct thread_io_backend fd_epoll_backend = {
+	.name = "epoll",
+	.init = fd_epoll_init,
+	.fini = fd_kernel_free,
+	.add = fd_kernel_add,
+	.cancel = fd_kernel_cancel,
+	.prepare = fd_epoll_prepare,
+	.wait = fd_epoll_wait,
+	.process = fd_epoll_process,
+	.count = fd_kernel_count,
+	.show = fd_kernel_show,
+};
+
+#endif /* HAVE_EPOLL */
+
+/* kqueue ------------------------------------------------------------------ */
+
+#ifdef HAVE_KQUEUE
+
+static int fd_kqueue_open(struct thread_master *m)
+{
+	struct kevent kev;
+
+	m->handler.kfd = kqueue();
+	if (m->handler.kfd < 0)
+		return -1;
+	set_cloexec(m->handler.kfd);
+
+	EV_SET(&kev, m->io_pipe[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+	if (kevent(m->handler.kfd, &kev, 1, NULL, 0, NULL) < 0) {
+		close(m->handler.kfd);
+		m->handler.kfd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+static bool fd_kqueue_init(struct thread_master *m)
+{
+	fd_kernel_alloc(m, sizeof(struct kevent));
+	if (fd_kqueue_open(m) < 0) {
+		flog_err(EC_LIB_SYSTEM_CALL, "kqueue() failed: %s",
+			 safe_strerror(errno));
+		fd_kernel_free(m);
+		return false;
+	}
+	return true;
+}
+
+static void fd_kqueue_change(struct thread_master *m, int fd, short filter,
+			     unsigned short flags)
+{
+	struct kevent *changes;
+
+	if (m->handler.changecount == m->handler.changesize) {
+		m->handler.changesize = MAX(64, m->handler.changesize * 2);
+		m->handler.changes = XREALLOC(
+			MTYPE_THREAD_POLL, m->handler.changes,
+			sizeof(struct kevent) * m->handler.changesize);
+	}
+	changes = m->handler.changes;
+	EV_SET(&changes[m->handler.changecount++], fd, filter, flags, 0, 0,
+	       NULL);
+}
+
+static void fd_kqueue_prepare(struct thread_master *m)
+{
+	if (m->handler.kfd_stale) {
+		/* kqueues are not inherited across fork() */
+		fd_kernel_reset(m);
+		m->handler.changecount = 0;
+		if (fd_kqueue_open(m) < 0)
+			flog_err(EC_LIB_SYSTEM_CALL, "kqueue() failed: %s",
+				 safe_strerror(errno));
+	}
+
+	/* the changelist is submitted with the next kevent() call */
+	for (int i = 0; i < m->handler.dirtycount; i++) {
+		int fd = m->handler.dirty[i];
+		short want = m->handler.want[fd];
+		short armed = m->handler.armed[fd] & FD_ARMED_EVENTS;
+		short diff = want ^ armed;
+
+		/* possibly a new fd by the same number, see fd_kernel_cancel;
+		 * EV_ADD on a registered filter just updates it
+		 */
+		if (m->handler.armed[fd] & FD_ARMED_STALE)
+			diff |= want;
+
+		if (diff & POLLIN)
+			fd_kqueue_change(m, fd, EVFILT_READ,
+					 (want & POLLIN) ? EV_ADD : EV_DELETE);
+		if (diff & POLLOUT)
+			fd_kqueue_change(m, fd, EVFILT_WRITE,
+					 (want & POLLOUT) ? EV_ADD
+							  : EV_DELETE);
+		m->handler.armed[fd] = want;
+	}
+	m->handler.dirtycount = 0;
+}
+
+static int fd_kqueue_wait(struct thread_master *m, int timeout,
+			  sigset_t *origsigs)
+{
+	struct kevent *events = m->handler.events;
+	struct timespec ts, *tsp;
+	int num;
+
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		tsp = &ts;
+	} else
+		tsp = NULL;
+
+	/* Not ideal - there is a race after we restore the signal mask */
+	pthread_sigmask(SIG_SETMASK, origsigs, NULL);
+	num = kevent(m->handler.kfd, m->handler.changes,
+		     m->handler.changecount, events, m->handler.eventsize,
+		     tsp);
+	/* changes are applied even if we got interrupted */
+	m->handler.changecount = 0;
+
+	m->handler.eventcount = MAX(num, 0);
+	if (num < 0)
+		return num;
+
+	for (int i = 0; i < m->handler.eventcount; i++) {
+		if (events[i].flags & EV_ERROR) {
+			/* EV_DELETE on a fd closed before cancellation */
+			events[i].ident = (uintptr_t)-1;
+			num--;
+		} else if ((int)events[i].ident == m->io_pipe[0]) {
+			thread_io_pipe_drain(m);
+			events[i].ident = (uintptr_t)-1;
+			num--;
+		}
+	}
+	return num;
+}
+
+static void fd_kqueue_process(struct thread_master *m, unsigned int num)
+{
+	struct kevent *events = m->handler.events;
+
+	for (int i = 0; i < m->handler.eventcount; i++) {
+		short revents = 0;
+
+		if (events[i].ident == (uintptr_t)-1)
+			continue;
+
+		if (events[i].filter == EVFILT_READ)
+			revents |= POLLIN;
+		else if (events[i].filter == EVFILT_WRITE)
+			revents |= POLLOUT;
+		if (events[i].flags & EV_EOF)
+			revents |= POLLHUP;
+
+		fd_kernel_dispatch(m, (int)events[i].ident, revents);
+	}
+	m->handler.eventcount = 0;
+}
 
-	return thread;
+static const struct thread_io_backend fd_kqueue_backend = {
+	.name = "kqueue",
+	.init = fd_kqueue_init,
+	.fini = fd_kernel_free,
+	.add = fd_kernel_add,
+	.cancel = fd_kernel_cancel,
+	.prepare = fd_kqueue_prepare,
+	.wait = fd_kqueue_wait,
+	.process = fd_kqueue_process,
+	.count = fd_kernel_count,
+	.show = fd_kernel_show,
+};
+
+#endif /* HAVE_KQUEUE */
+
+/* in order of preference */
+static const struct thread_io_backend *const io_backends[] = {
+#ifdef HAVE_EPOLL
+	&fd_epoll_backend,
+#endif
+#ifdef HAVE_KQUEUE
+	&fd_kqueue_backend,
+#endif
+	&fd_poll_backend,
+};
+
+static const struct thread_io_backend *io_backend_default = io_backends[0];
+
+int thread_io_backend_set(const char *name)
+{
+	for (size_t i = 0; i < array_size(io_backends); i++) {
+		if (strcmp(io_backends[i]->name, name))
+			continue;
+		io_backend_default = io_backends[i];
+		return 0;
+	}
+	return -1;
 }
 
-static void thread_free(struct thread_master *master, struct thread *thread)
+const char *thread_io_backend_name(struct thread_master *m)
 {
-	/* Update statistics. */
-	assert(master->alloc > 0);
-	master->alloc--;
+	return m->handler.backend->name;
+}
 
-	/* Free allocated resources. */
-	pthread_mutex_destroy(&thread->mtx);
-	XFREE(MTYPE_THREAD, thread);
+static void thread_io_init(struct thread_master *m)
+{
+	m->handler.backend = io_backend_default;
+	if (m->handler.backend->init(m))
+		return;
+
+	/* poll() can't fail to initialize */
+	m->handler.backend = &fd_poll_backend;
+	m->handler.backend->init(m);
 }
 
 static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 		   bool *eintr_p)
 {
 	sigset_t origsigs;
-	unsigned char trash[64];
-	nfds_t count = m->handler.copycount;
 
 	/*
 	 * If timer_wait is null here, that means poll() should block
@@ -770,12 +2137,6 @@ static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 	rcu_read_unlock();
 	rcu_assert_read_unlocked();
 
-	/* add poll pipe poker */
-	assert(count + 1 < m->handler.pfdsize);
-	m->handler.copy[count].fd = m->io_pipe[0];
-	m->handler.copy[count].events = POLLIN;
-	m->handler.copy[count].revents = 0x00;
-
 	/* We need to deal with a signal-handling race here: we
 	 * don't want to miss a crucial signal, such as SIGTERM or SIGINT,
 	 * that may arrive just before we enter poll(). We will block the
@@ -799,33 +2160,13 @@ static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 		pthread_sigmask(SIG_SETMASK, NULL, &origsigs);
 	}
 
-#if defined(HAVE_PPOLL)
-	struct timespec ts, *tsp;
-
-	if (timeout >= 0) {
-		ts.tv_sec = timeout / 1000;
-		ts.tv_nsec = (timeout % 1000) * 1000000;
-		tsp = &ts;
-	} else
-		tsp = NULL;
-
-	num = ppoll(m->handler.copy, count + 1, tsp, &origsigs);
-	pthread_sigmask(SIG_SETMASK, &origsigs, NULL);
-#else
-	/* Not ideal - there is a race after we restore the signal mask */
-	pthread_sigmask(SIG_SETMASK, &origsigs, NULL);
-	num = poll(m->handler.copy, count + 1, timeout);
-#endif
+	num = m->handler.backend->wait(m, timeout, &origsigs);
 
 done:
 
 	if (num < 0 && errno == EINTR)
 		*eintr_p = true;
 
-	if (num > 0 && m->handler.copy[count].revents != 0 && num--)
-		while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
-			;
-
 	rcu_read_lock();
 
 	return num;
@@ -854,42 +2195,24 @@ struct thread *funcname_thread_add_read_write(int dir, struct thread_master *m,
 			// thread is already scheduled; don't reschedule
 			break;
 
-		/* default to a new pollfd */
-		nfds_t queuepos = m->handler.pfdcount;
-
 		if (dir == THREAD_READ)
 			thread_array = m->read;
 		else
 			thread_array = m->write;
 
-		/* if we already have a pollfd for our file descriptor, find and
-		 * use it */
-		for (nfds_t i = 0; i < m->handler.pfdcount; i++)
-			if (m->handler.pfds[i].fd == fd) {
-				queuepos = i;
-
 #ifdef DEV_BUILD
-				/*
-				 * What happens if we have a thread already
-				 * created for this event?
-				 */
-				if (thread_array[fd])
-					assert(!"Thread already scheduled for file descriptor");
+		/*
+		 * What happens if we have a thread already
+		 * created for this event?
+		 */
+		if (thread_array[fd])
+			assert(!"Thread already scheduled for file descriptor");
 #endif
-				break;
-			}
-
-		/* make sure we have room for this fd + pipe poker fd */
-		assert(queuepos + 1 < m->handler.pfdsize);
 
 		thread = thread_get(m, dir, func, arg, debugargpass);
 
-		m->handler.pfds[queuepos].fd = fd;
-		m->handler.pfds[queuepos].events |=
-			(dir == THREAD_READ ? POLLIN : POLLOUT);
-
-		if (queuepos == m->handler.pfdcount)
-			m->handler.pfdcount++;
+		m->handler.backend->add(m, fd,
+					dir == THREAD_READ ? POLLIN : POLLOUT);
 
 		if (thread) {
 			frr_with_mutex(&thread->mtx) {
@@ -913,7 +2236,8 @@ static struct thread *
 funcname_thread_add_timer_timeval(struct thread_master *m,
 				  int (*func)(struct thread *), int type,
 				  void *arg, struct timeval *time_relative,
-				  struct thread **t_ptr, debugargdef)
+				  bool wheel, struct thread **t_ptr,
+				  debugargdef)
 {
 	struct thread *thread;
 
@@ -936,7 +2260,15 @@ funcname_thread_add_timer_timeval(struct thread_master *m,
 			monotime(&thread->u.sands);
 			timeradd(&thread->u.sands, time_relative,
 				 &thread->u.sands);
-			thread_timer_list_add(&m->timer, thread);
+			if (wheel && !m->wheel)
+				m->wheel = timer_wheel_new();
+			if ((wheel || m->wheel_all)
+			    && time_relative->tv_sec * 1000LL
+					       + time_relative->tv_usec / 1000
+				       >= THREAD_TIMER_WHEEL_MIN)
+				timer_wheel_add(m->wheel, thread);
+			else
+				thread_timer_list_add(&m->timer, thread);
 			if (t_ptr) {
 				*t_ptr = thread;
 				thread->ref = t_ptr;
@@ -964,7 +2296,8 @@ struct thread *funcname_thread_add_timer(struct thread_master *m,
 	trel.tv_usec = 0;
 
 	return funcname_thread_add_timer_timeval(m, func, THREAD_TIMER, arg,
-						 &trel, t_ptr, debugargpass);
+						 &trel, false, t_ptr,
+						 debugargpass);
 }
 
 /* Add timer event thread with "millisecond" resolution */
@@ -982,7 +2315,8 @@ struct thread *funcname_thread_add_timer_msec(struct thread_master *m,
 	trel.tv_usec = 1000 * (timer % 1000);
 
 	return funcname_thread_add_timer_timeval(m, func, THREAD_TIMER, arg,
-						 &trel, t_ptr, debugargpass);
+						 &trel, false, t_ptr,
+						 debugargpass);
 }
 
 /* Add timer event thread with "millisecond" resolution */
@@ -992,10 +2326,87 @@ struct thread *funcname_thread_add_timer_tv(struct thread_master *m,
 					    struct thread **t_ptr, debugargdef)
 {
 	return funcname_thread_add_timer_timeval(m, func, THREAD_TIMER, arg, tv,
-						 t_ptr, debugargpass);
+						 false, t_ptr, debugargpass);
+}
+
+/* Add timer event thread on the timer wheel */
+struct thread *funcname_thread_add_timer_wheel(struct thread_master *m,
+					       int (*func)(struct thread *),
+					       void *arg, long timer,
+					       struct thread **t_ptr,
+					       debugargdef)
+{
+	struct timeval trel;
+
+	assert(m != NULL);
+
+	trel.tv_sec = timer;
+	trel.tv_usec = 0;
+
+	return funcname_thread_add_timer_timeval(m, func, THREAD_TIMER, arg,
+						 &trel, true, t_ptr,
+						 debugargpass);
 }
 
 /* Add simple event thread. */
+/*
+ * Events from pthreads other than the owner skip m->mtx and go through
+ * m->inbox; the thread struct is allocated without touching the unuse list
+ * and the owner finishes setting it up (statistics) when draining.  Only one
+ * pipe write happens per drain cycle however many events are added.
+ *
+ * Events with a t_ptr still take the mutex since *t_ptr is protected by it.
+ */
+static struct thread *thread_inbox_add(struct thread_master *m,
+				       int (*func)(struct thread *),
+				       void *arg, int val, debugargdef)
+{
+	struct thread *thread;
+
+	thread = XCALLOC(MTYPE_THREAD, sizeof(struct thread));
+	pthread_mutex_init(&thread->mtx, NULL);
+	thread->type = THREAD_EVENT;
+	thread->add_type = THREAD_EVENT;
+	thread->master = m;
+	thread->func = func;
+	thread->arg = arg;
+	thread->u.val = val;
+	thread->yield = THREAD_YIELD_TIME_SLOT;
+	thread->funcname = funcname;
+	thread->schedfrom = schedfrom;
+	thread->schedfrom_line = fromln;
+	monotime(&thread->readytime);
+
+	thread_inbox_add_tail(&m->inbox, thread);
+
+	if (!atomic_exchange_explicit(&m->inbox_awake, true,
+				      memory_order_seq_cst))
+		AWAKEN(m);
+
+	return thread;
+}
+
+/* move inbox events to m->event; must hold m->mtx, owner only */
+static void thread_inbox_drain(struct thread_master *m)
+{
+	struct cpu_thread_history tmp;
+	struct thread *thread;
+
+	/* clear first; anything added after this will poke the pipe again */
+	atomic_store_explicit(&m->inbox_awake, false, memory_order_seq_cst);
+
+	while ((thread = thread_inbox_pop(&m->inbox))) {
+		tmp.func = thread->func;
+		tmp.funcname = thread->funcname;
+		thread->hist = hash_get(m->cpu_record, &tmp,
+					(void *(*)(void *))cpu_record_hash_alloc);
+		thread->hist->total_active++;
+		m->alloc++;
+
+		thread_list_add_tail(&m->event, thread);
+	}
+}
+
 struct thread *funcname_thread_add_event(struct thread_master *m,
 					 int (*func)(struct thread *),
 					 void *arg, int val,
@@ -1008,6 +2419,9 @@ struct thread *funcname_thread_add_event(struct thread_master *m,
 
 	assert(m != NULL);
 
+	if (!t_ptr && !pthread_equal(m->owner, pthread_self()))
+		return thread_inbox_add(m, func, arg, val, debugargpass);
+
 	frr_with_mutex(&m->mtx) {
 		if (t_ptr && *t_ptr)
 			/* thread is already scheduled; don't reschedule */
@@ -1016,6 +2430,7 @@ struct thread *funcname_thread_add_event(struct thread_master *m,
 		thread = thread_get(m, THREAD_EVENT, func, arg, debugargpass);
 		frr_with_mutex(&thread->mtx) {
 			thread->u.val = val;
+			monotime(&thread->readytime);
 			thread_list_add_tail(&m->event, thread);
 		}
 
@@ -1032,74 +2447,6 @@ struct thread *funcname_thread_add_event(struct thread_master *m,
 
 /* Thread cancellation ------------------------------------------------------ */
 
-/**
- * NOT's out the .events field of pollfd corresponding to the given file
- * descriptor. The event to be NOT'd is passed in the 'state' parameter.
- *
- * This needs to happen for both copies of pollfd's. See 'thread_fetch'
- * implementation for details.
- *
- * @param master
- * @param fd
- * @param state the event to cancel. One or more (OR'd together) of the
- * following:
- *   - POLLIN
- *   - POLLOUT
- */
-static void thread_cancel_rw(struct thread_master *master, int fd, short state)
-{
-	bool found = false;
-
-	/* Cancel POLLHUP too just in case some bozo set it */
-	state |= POLLHUP;
-
-	/* find the index of corresponding pollfd */
-	nfds_t i;
-
-	for (i = 0; i < master->handler.pfdcount; i++)
-		if (master->handler.pfds[i].fd == fd) {
-			found = true;
-			break;
-		}
-
-	if (!found) {
-		zlog_debug(
-			"[!] Received cancellation request for nonexistent rw job");
-		zlog_debug("[!] threadmaster: %s | fd: %d",
-			   master->name ? master->name : "", fd);
-		return;
-	}
-
-	/* NOT out event. */
-	master->handler.pfds[i].events &= ~(state);
-
-	/* If all events are canceled, delete / resize the pollfd array. */
-	if (master->handler.pfds[i].events == 0) {
-		memmove(master->handler.pfds + i, master->handler.pfds + i + 1,
-			(master->handler.pfdcount - i - 1)
-				* sizeof(struct pollfd));
-		master->handler.pfdcount--;
-		master->handler.pfds[master->handler.pfdcount].fd = 0;
-		master->handler.pfds[master->handler.pfdcount].events = 0;
-	}
-
-	/* If we have the same pollfd in the copy, perform the same operations,
-	 * otherwise return. */
-	if (i >= master->handler.copycount)
-		return;
-
-	master->handler.copy[i].events &= ~(state);
-
-	if (master->handler.copy[i].events == 0) {
-		memmove(master->handler.copy + i, master->handler.copy + i + 1,
-			(master->handler.copycount - i - 1)
-				* sizeof(struct pollfd));
-		master->handler.copycount--;
-		master->handler.copy[master->handler.copycount].fd = 0;
-	        master->handler.copy[master->handler.copycount].events = 0;
-	}
-}
-
 /**
  * Process cancellation requests.
  *
@@ -1116,6 +2463,11 @@ static void do_thread_cancel(struct thread_master *master)
 
 	struct cancel_req *cr;
 	struct listnode *ln;
+
+	/* cancellation may target events that are still in the inbox */
+	if (master->cancel_req->count)
+		thread_inbox_drain(master);
+
 	for (ALL_LIST_ELEMENTS_RO(master->cancel_req, ln, cr)) {
 		/*
 		 * If this is an event object cancellation, linear search
@@ -1160,15 +2512,20 @@ static void do_thread_cancel(struct thread_master *master)
 		/* Determine the appropriate queue to cancel the thread from */
 		switch (thread->type) {
 		case THREAD_READ:
-			thread_cancel_rw(master, thread->u.fd, POLLIN);
+			master->handler.backend->cancel(master, thread->u.fd,
+							POLLIN);
 			thread_array = master->read;
 			break;
 		case THREAD_WRITE:
-			thread_cancel_rw(master, thread->u.fd, POLLOUT);
+			master->handler.backend->cancel(master, thread->u.fd,
+							POLLOUT);
 			thread_array = master->write;
 			break;
 		case THREAD_TIMER:
-			thread_timer_list_del(&master->timer, thread);
+			if (thread->wheelslot)
+				timer_wheel_del(master->wheel, thread);
+			else
+				thread_timer_list_del(&master->timer, thread);
 			break;
 		case THREAD_EVENT:
 			list = &master->event;
@@ -1322,14 +2679,25 @@ void thread_cancel_async(struct thread_master *master, struct thread **thread,
 }
 /* ------------------------------------------------------------------------- */
 
-static struct timeval *thread_timer_wait(struct thread_timer_list_head *timers,
+static struct timeval *thread_timer_wait(struct thread_master *m,
 					 struct timeval *timer_val)
 {
-	if (!thread_timer_list_count(timers))
+	struct thread *next_timer = thread_timer_list_first(&m->timer);
+	struct timeval next;
+	uint64_t tick;
+
+	if (m->wheel && timer_wheel_next(m->wheel, &tick)) {
+		next.tv_sec = tick / (TIMER_SECOND_MICRO / TIMER_WHEEL_TICK);
+		next.tv_usec = (tick % (TIMER_SECOND_MICRO / TIMER_WHEEL_TICK))
+			       * TIMER_WHEEL_TICK;
+		if (next_timer && timercmp(&next_timer->u.sands, &next, <))
+			next = next_timer->u.sands;
+	} else if (next_timer)
+		next = next_timer->u.sands;
+	else
 		return NULL;
 
-	struct thread *next_timer = thread_timer_list_first(timers);
-	monotime_until(&next_timer->u.sands, timer_val);
+	monotime_until(&next, timer_val);
 	return timer_val;
 }
 
@@ -1341,31 +2709,18 @@ static struct thread *thread_run(struct thread_master *m, struct thread *thread,
 	return fetch;
 }
 
-static int thread_process_io_helper(struct thread_master *m,
-				    struct thread *thread, short state,
-				    short actual_state, int pos)
+static void thread_process_io_helper(struct thread_master *m,
+				     struct thread *thread, short state,
+				     short actual_state, int fd)
 {
 	struct thread **thread_array;
 
-	/*
-	 * poll() clears the .events field, but the pollfd array we
-	 * pass to poll() is a copy of the one used to schedule threads.
-	 * We need to synchronize state between the two here by applying
-	 * the same changes poll() made on the copy of the "real" pollfd
-	 * array.
-	 *
-	 * This cleans up a possible infinite loop where we refuse
-	 * to respond to a poll event but poll is insistent that
-	 * we should.
-	 */
-	m->handler.pfds[pos].events &= ~(state);
-
 	if (!thread) {
 		if ((actual_state & (POLLHUP|POLLIN)) != POLLHUP)
 			flog_err(EC_LIB_NO_THREAD,
 				 "Attempting to process an I/O event but for fd: %d(%d) no thread to handle this!\n",
-				 m->handler.pfds[pos].fd, actual_state);
-		return 0;
+				 fd, actual_state);
+		return;
 	}
 
 	if (thread->type == THREAD_READ)
@@ -1374,89 +2729,26 @@ static int thread_process_io_helper(struct thread_master *m,
 		thread_array = m->write;
 
 	thread_array[thread->u.fd] = NULL;
+	thread->readytime = m->polltime;
 	thread_list_add_tail(&m->ready, thread);
 	thread->type = THREAD_READY;
-
-	return 1;
-}
-
-/**
- * Process I/O events.
- *
- * Walks through file descriptor array looking for those pollfds whose .revents
- * field has something interesting. Deletes any invalid file descriptors.
- *
- * @param m the thread master
- * @param num the number of active file descriptors (return value of poll())
- */
-static void thread_process_io(struct thread_master *m, unsigned int num)
-{
-	unsigned int ready = 0;
-	struct pollfd *pfds = m->handler.copy;
-
-	for (nfds_t i = 0; i < m->handler.copycount && ready < num; ++i) {
-		/* no event for current fd? immediately continue */
-		if (pfds[i].revents == 0)
-			continue;
-
-		ready++;
-
-		/*
-		 * Unless someone has called thread_cancel from another
-		 * pthread, the only thing that could have changed in
-		 * m->handler.pfds while we were asleep is the .events
-		 * field in a given pollfd. Barring thread_cancel() that
-		 * value should be a superset of the values we have in our
-		 * copy, so there's no need to update it. Similarily,
-		 * barring deletion, the fd should still be a valid index
-		 * into the master's pfds.
-		 *
-		 * We are including POLLERR here to do a READ event
-		 * this is because the read should fail and the
-		 * read function should handle it appropriately
-		 */
-		if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
-			thread_process_io_helper(m, m->read[pfds[i].fd], POLLIN,
-						 pfds[i].revents, i);
-		}
-		if (pfds[i].revents & POLLOUT)
-			thread_process_io_helper(m, m->write[pfds[i].fd],
-						 POLLOUT, pfds[i].revents, i);
-
-		/* if one of our file descriptors is garbage, remove the same
-		 * from
-		 * both pfds + update sizes and index */
-		if (pfds[i].revents & POLLNVAL) {
-			memmove(m->handler.pfds + i, m->handler.pfds + i + 1,
-				(m->handler.pfdcount - i - 1)
-					* sizeof(struct pollfd));
-			m->handler.pfdcount--;
-			m->handler.pfds[m->handler.pfdcount].fd = 0;
-			m->handler.pfds[m->handler.pfdcount].events = 0;
-
-			memmove(pfds + i, pfds + i + 1,
-				(m->handler.copycount - i - 1)
-					* sizeof(struct pollfd));
-			m->handler.copycount--;
-			m->handler.copy[m->handler.copycount].fd = 0;
-			m->handler.copy[m->handler.copycount].events = 0;
-
-			i--;
-		}
-	}
 }
 
 /* Add all timers that have popped to the ready list. */
-static unsigned int thread_process_timers(struct thread_timer_list_head *timers,
+static unsigned int thread_process_timers(struct thread_master *m,
 					  struct timeval *timenow)
 {
 	struct thread *thread;
 	unsigned int ready = 0;
 
-	while ((thread = thread_timer_list_first(timers))) {
+	if (m->wheel)
+		ready += timer_wheel_process(m->wheel, timenow);
+
+	while ((thread = thread_timer_list_first(&m->timer))) {
 		if (timercmp(timenow, &thread->u.sands, <))
 			return ready;
-		thread_timer_list_pop(timers);
+		thread_timer_list_pop(&m->timer);
+		thread->readytime = thread->u.sands;
 		thread->type = THREAD_READY;
 		thread_list_add_tail(&thread->master->ready, thread);
 		ready++;
@@ -1518,6 +2810,7 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 		 * Post events to ready queue. This must come before the
 		 * following block since events should occur immediately
 		 */
+		thread_inbox_drain(m);
 		thread_process(&m->event);
 
 		/*
@@ -1537,25 +2830,20 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 		 * once per loop to avoid starvation by events
 		 */
 		if (!thread_list_count(&m->ready))
-			tw = thread_timer_wait(&m->timer, &tv);
+			tw = thread_timer_wait(m, &tv);
 
 		if (thread_list_count(&m->ready) ||
 				(tw && !timercmp(tw, &zerotime, >)))
 			tw = &zerotime;
 
-		if (!tw && m->handler.pfdcount == 0) { /* die */
+		if (!tw && m->handler.backend->count(m) == 0
+		    && !thread_inbox_count(&m->inbox)) { /* die */
 			pthread_mutex_unlock(&m->mtx);
 			fetch = NULL;
 			break;
 		}
 
-		/*
-		 * Copy pollfd array + # active pollfds in it. Not necessary to
-		 * copy the array size as this is fixed.
-		 */
-		m->handler.copycount = m->handler.pfdcount;
-		memcpy(m->handler.copy, m->handler.pfds,
-		       m->handler.copycount * sizeof(struct pollfd));
+		m->handler.backend->prepare(m);
 
 		pthread_mutex_unlock(&m->mtx);
 		{
@@ -1582,11 +2870,12 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 
 		/* Post timers to ready queue. */
 		monotime(&now);
-		thread_process_timers(&m->timer, &now);
+		m->polltime = now;
+		thread_process_timers(m, &now);
 
 		/* Post I/O to ready queue. */
 		if (num > 0)
-			thread_process_io(m, num);
+			m->handler.backend->process(m, num);
 
 		pthread_mutex_unlock(&m->mtx);
 
@@ -1610,6 +2899,18 @@ unsigned long thread_consumed_time(RUSAGE_T *now, RUSAGE_T *start,
 	return timeval_elapsed(now->real, start->real);
 }
 
+#ifndef EXCLUDE_CPU_TIME
+static unsigned int thread_hist_bucket(unsigned long usec)
+{
+	unsigned int bucket;
+
+	if (!usec)
+		return 0;
+	bucket = sizeof(unsigned long) * 8 - __builtin_clzl(usec);
+	return MIN(bucket, THREAD_HIST_BUCKETS - 1);
+}
+#endif
+
 /* We should aim to yield after yield milliseconds, which defaults
    to THREAD_YIELD_TIME_SLOT .
    Note: we are using real (wall clock) time for this calculation.
@@ -1677,12 +2978,19 @@ void thread_call(struct thread *thread)
 		 thread->schedfrom, thread->schedfrom_line, NULL, thread->u.fd,
 		 thread->u.val, thread->arg, thread->u.sands.tv_sec);
 
+	if (thread->master->heartbeat)
+		frr_heartbeat_enter(thread->master->heartbeat, thread,
+				    &before.real);
+
 	pthread_setspecific(thread_current, thread);
 	(*thread->func)(thread);
 	pthread_setspecific(thread_current, NULL);
 
 	GETRUSAGE(&after);
 
+	if (thread->master->heartbeat)
+		frr_heartbeat_leave(thread->master->heartbeat, &after.real);
+
 #ifndef EXCLUDE_CPU_TIME
 	realtime = thread_consumed_time(&after, &before, &helper);
 	cputime = helper;
@@ -1714,6 +3022,20 @@ void thread_call(struct thread *thread)
 	atomic_fetch_or_explicit(&thread->hist->types, 1 << thread->add_type,
 				 memory_order_seq_cst);
 
+	atomic_fetch_add_explicit(
+		&thread->hist->runtime_hist[thread_hist_bucket(realtime)], 1,
+		memory_order_relaxed);
+	/* thread_execute() runs directly, it never sits on a queue */
+	if (timerisset(&thread->readytime)
+	    && !timercmp(&before.real, &thread->readytime, <)) {
+		unsigned long delay;
+
+		delay = timeval_elapsed(before.real, thread->readytime);
+		atomic_fetch_add_explicit(
+			&thread->hist->sched_hist[thread_hist_bucket(delay)], 1,
+			memory_order_relaxed);
+	}
+
 #ifdef CONSUMED_TIME_CHECK
 	if (realtime > CONSUMED_TIME_CHECK) {
 		/*
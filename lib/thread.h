@@ -27,6 +27,7 @@
 #include "monotime.h"
 #include "frratomic.h"
 #include "typesafe.h"
+#include "atomlist.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,8 +43,18 @@ struct rusage_t {
 
 PREDECL_LIST(thread_list)
 PREDECL_HEAP(thread_timer_list)
+PREDECL_DLIST(thread_wheel_list)
+PREDECL_ATOMLIST(thread_inbox)
+
+struct thread_timer_wheel;
+struct frr_heartbeat;
+
+struct thread_io_backend;
 
 struct fd_handler {
+	/* I/O readiness backend servicing this thread_master */
+	const struct thread_io_backend *backend;
+
 	/* number of pfd that fit in the allocated space of pfds. This is a
 	 * constant
 	 * and is the same for both pfds and copy. */
@@ -58,6 +69,33 @@ struct fd_handler {
 	struct pollfd *copy;
 	/* number of pollfds stored in copy */
 	nfds_t copycount;
+
+	/*
+	 * epoll / kqueue backends only.  Interest is tracked per fd
+	 * (POLLIN / POLLOUT) in "want", what the kernel currently has
+	 * registered is in "armed".  Changes are queued on "dirty" and
+	 * pushed to the kernel in one go right before sleeping.
+	 */
+	int kfd;
+	bool kfd_stale;
+	short *want;
+	short *armed;
+	int *dirty;
+	int dirtycount;
+	/* number of fds with a nonzero "want" */
+	nfds_t wantcount;
+	/* fds the kernel refused to watch (regular files), always ready */
+	int *nopoll;
+	int nopollcount;
+	int nopollsize;
+
+	/* result (and for kqueue, change) buffers for the kernel call */
+	void *events;
+	int eventsize;
+	int eventcount;
+	void *changes;
+	int changecount;
+	int changesize;
 };
 
 struct cancel_req {
@@ -73,7 +111,17 @@ struct thread_master {
 	struct thread **read;
 	struct thread **write;
 	struct thread_timer_list_head timer;
+	/* optional, see thread_master_set_timer_wheel() and
+	 * thread_add_timer_wheel()
+	 */
+	struct thread_timer_wheel *wheel;
+	bool wheel_all;
 	struct thread_list_head event, ready, unuse;
+	/* last return from fd_poll(), readytime for I/O threads */
+	struct timeval polltime;
+	/* events added from other pthreads, lock-free; drained by owner */
+	struct thread_inbox_head inbox;
+	atomic_bool inbox_awake;
 	struct list *cancel_req;
 	bool canceled;
 	pthread_cond_t cancel_cond;
@@ -85,6 +133,8 @@ struct thread_master {
 	long selectpoll_timeout;
 	bool spin;
 	bool handle_signals;
+	/* optional, see frr_heartbeat_start() */
+	struct frr_heartbeat *heartbeat;
 	pthread_mutex_t mtx;
 	pthread_t owner;
 };
@@ -94,7 +144,12 @@ struct thread {
 	uint8_t type;		  /* thread type */
 	uint8_t add_type;	  /* thread type */
 	struct thread_list_item threaditem;
-	struct thread_timer_list_item timeritem;
+	struct thread_inbox_item inboxitem;
+	union {
+		struct thread_timer_list_item timeritem;
+		struct thread_wheel_list_item wheelitem;
+	};
+	uint16_t wheelslot;	  /* position on m->wheel, 0 if on heap */
 	struct thread **ref;	  /* external reference (if given) */
 	struct thread_master *master; /* pointer to the struct thread_master */
 	int (*func)(struct thread *); /* event function */
@@ -105,6 +160,7 @@ struct thread {
 		struct timeval sands; /* rest of time sands value. */
 	} u;
 	struct timeval real;
+	struct timeval readytime; /* when it became runnable, for histograms */
 	struct cpu_thread_history *hist; /* cache pointer to cpu_history */
 	unsigned long yield;		 /* yield time in microseconds */
 	const char *funcname;		 /* name of thread function */
@@ -113,6 +169,11 @@ struct thread {
 	pthread_mutex_t mtx;   /* mutex for thread.c functions */
 };
 
+/* log2 buckets, in usec: [0] is < 1us, [n] is [2^(n-1), 2^n), the last
+ * one collects everything longer.
+ */
+#define THREAD_HIST_BUCKETS 24
+
 struct cpu_thread_history {
 	int (*func)(struct thread *);
 	atomic_size_t total_calls;
@@ -123,6 +184,10 @@ struct cpu_thread_history {
 	struct time_stats cpu;
 	atomic_uint_fast32_t types;
 	const char *funcname;
+
+	/* wall-clock runtime, and delay between becoming ready and running */
+	atomic_size_t runtime_hist[THREAD_HIST_BUCKETS];
+	atomic_size_t sched_hist[THREAD_HIST_BUCKETS];
 };
 
 /* Struct timeval's tv_usec one second value.  */
@@ -137,6 +202,9 @@ struct cpu_thread_history {
 #define THREAD_UNUSED         5
 #define THREAD_EXECUTE        6
 
+/* Shortest timer (msec) that goes on the timer wheel, if enabled. */
+#define THREAD_TIMER_WHEEL_MIN     100
+
 /* Thread yield time.  */
 #define THREAD_YIELD_TIME_SLOT     10 * 1000L /* 10ms */
 
@@ -163,6 +231,7 @@ struct cpu_thread_history {
 #define thread_add_timer(m,f,a,v,t) funcname_thread_add_timer(m,f,a,v,t,#f,__FILE__,__LINE__)
 #define thread_add_timer_msec(m,f,a,v,t) funcname_thread_add_timer_msec(m,f,a,v,t,#f,__FILE__,__LINE__)
 #define thread_add_timer_tv(m,f,a,v,t) funcname_thread_add_timer_tv(m,f,a,v,t,#f,__FILE__,__LINE__)
+#define thread_add_timer_wheel(m,f,a,v,t) funcname_thread_add_timer_wheel(m,f,a,v,t,#f,__FILE__,__LINE__)
 #define thread_add_event(m,f,a,v,t) funcname_thread_add_event(m,f,a,v,t,#f,__FILE__,__LINE__)
 #define thread_execute(m,f,a,v) funcname_thread_execute(m,f,a,v,#f,__FILE__,__LINE__)
 #define thread_execute_name(m, f, a, v, n)				\
@@ -172,6 +241,13 @@ struct cpu_thread_history {
 extern struct thread_master *thread_master_create(const char *);
 void thread_master_set_name(struct thread_master *master, const char *name);
 extern void thread_master_free(struct thread_master *);
+/* Put all timers of THREAD_TIMER_WHEEL_MIN msec or longer on a
+ * hierarchical timing wheel (10ms resolution, O(1) add/cancel) instead of
+ * the heap.  Timers may fire up to one wheel tick late, never early.
+ * To put only selected timers on the wheel, use thread_add_timer_wheel().
+ */
+extern void thread_master_set_timer_wheel(struct thread_master *m,
+					  bool enable);
 extern void thread_master_free_unused(struct thread_master *);
 
 extern struct thread *
@@ -194,6 +270,15 @@ extern struct thread *funcname_thread_add_timer_tv(struct thread_master *,
 						   struct thread **,
 						   debugargdef);
 
+/* Like thread_add_timer(), but always on the timer wheel (see
+ * thread_master_set_timer_wheel()), which is created on first use.
+ */
+extern struct thread *funcname_thread_add_timer_wheel(struct thread_master *,
+						      int (*)(struct thread *),
+						      void *, long,
+						      struct thread **,
+						      debugargdef);
+
 extern struct thread *funcname_thread_add_event(struct thread_master *,
 						int (*)(struct thread *),
 						void *, int, struct thread **,
@@ -217,6 +302,15 @@ extern int thread_should_yield(struct thread *);
 /* set yield time for thread */
 extern void thread_set_yield_time(struct thread *, unsigned long);
 
+/* I/O readiness backend selection; applies to thread_masters created
+ * afterwards.  Returns -1 if the backend is unknown or not available.
+ */
+extern int thread_io_backend_set(const char *name);
+extern const char *thread_io_backend_name(struct thread_master *m);
+
+/* Reset "show thread cpu" / "show thread latency" data for one master */
+extern void thread_master_stats_reset(struct thread_master *m);
+
 /* Internal libfrr exports */
 extern void thread_getrusage(RUSAGE_T *);
 extern void thread_cmd_init(void);
@@ -28,6 +28,7 @@
 DEFINE_MTYPE_STATIC(LIB, TYPEDHASH_BUCKET, "Typed-hash bucket")
 DEFINE_MTYPE_STATIC(LIB, SKIPLIST_OFLOW, "Skiplist overflow")
 DEFINE_MTYPE_STATIC(LIB, HEAP_ARRAY, "Typed-heap array")
+DEFINE_MTYPE_STATIC(LIB, TYPEDOAHASH, "Typed-hash slots")
 
 #if 0
 static void hash_consistency_check(struct thash_head *head)
@@ -156,6 +157,75 @@ void typesafe_hash_shrink(struct thash_head *head)
 	hash_consistency_check(head);
 }
 
+/* slots appended when a probe sequence runs off the end of the table */
+#define OAHASH_TAIL 16
+
+void typesafe_oahash_extend(struct oahash_head *head)
+{
+	uint32_t size = head->size + OAHASH_TAIL;
+
+	head->entries = XREALLOC(MTYPE_TYPEDOAHASH, head->entries,
+				 sizeof(head->entries[0]) * size);
+	head->hashes = XREALLOC(MTYPE_TYPEDOAHASH, head->hashes,
+				sizeof(head->hashes[0]) * size);
+	memset(head->entries + head->size, 0,
+	       sizeof(head->entries[0]) * OAHASH_TAIL);
+	memset(head->hashes + head->size, 0,
+	       sizeof(head->hashes[0]) * OAHASH_TAIL);
+	head->size = size;
+}
+
+void typesafe_oahash_resize(struct oahash_head *head)
+{
+	struct oahash_item **entries = head->entries;
+	uint32_t *hashes = head->hashes;
+	uint32_t size = head->size, i, j;
+	uint64_t want = (uint64_t)(head->count + 1) * 8;
+	uint8_t newshift = OAHASH_MINSHIFT;
+
+	/* at most 3/8 full afterwards, so it takes a while to come back */
+	while (newshift < 31 && (3ULL << newshift) < want)
+		newshift++;
+
+	head->tabshift = newshift;
+	head->size = (1U << newshift) + OAHASH_TAIL;
+	head->entries = XCALLOC(MTYPE_TYPEDOAHASH,
+				sizeof(head->entries[0]) * head->size);
+	head->hashes = XCALLOC(MTYPE_TYPEDOAHASH,
+			       sizeof(head->hashes[0]) * head->size);
+	head->deleted = 0;
+	head->first = head->size;
+
+	for (i = 0; i < size; i++) {
+		if (!entries[i])
+			continue;
+
+		j = _OAHASH_KEY(newshift, hashes[i]);
+		while (j < head->size && head->entries[j])
+			j++;
+		if (j == head->size)
+			typesafe_oahash_extend(head);
+
+		head->entries[j] = entries[i];
+		head->hashes[j] = hashes[i];
+		entries[i]->index = j;
+		if (j < head->first)
+			head->first = j;
+	}
+
+	XFREE(MTYPE_TYPEDOAHASH, entries);
+	XFREE(MTYPE_TYPEDOAHASH, hashes);
+}
+
+void typesafe_oahash_free(struct oahash_head *head)
+{
+	XFREE(MTYPE_TYPEDOAHASH, head->entries);
+	XFREE(MTYPE_TYPEDOAHASH, head->hashes);
+	head->tabshift = 0;
+	head->size = head->first = 0;
+	head->count = head->deleted = 0;
+}
+
 /* skiplist */
 
 static inline struct sskip_item *sl_level_get(const struct sskip_item *item,
@@ -377,6 +377,13 @@ macro_inline type *prefix ## _pop(struct prefix##_head *h)                     \
 		typesafe_heap_resize(&h->hh, false);                           \
 	return container_of(hitem, type, field.hi);                            \
 }                                                                              \
+/* item's sort key has been lowered in place, move it towards the front */   \
+macro_inline void prefix ## _decrease(struct prefix##_head *h, type *item)    \
+{                                                                              \
+	uint32_t index = item->field.hi.index;                                 \
+	assert(h->hh.array[index] == &item->field.hi);                         \
+	typesafe_heap_pullup(&h->hh, index, &item->field.hi, prefix ## __cmp); \
+}                                                                              \
 macro_pure const type *prefix ## _const_first(const struct prefix##_head *h)   \
 {                                                                              \
 	if (h->hh.count == 0)                                                  \
@@ -736,6 +743,198 @@ macro_pure size_t prefix ## _count(const struct prefix##_head *h)              \
 }                                                                              \
 /* ... */
 
+/* open addressing hash, "sorted" by slot
+ *
+ * Items live directly in the slot array, so a lookup is usually a single
+ * cache line of hash values plus the one item compared.  Linear probing
+ * doesn't wrap around at the end of the table; if a run of collisions
+ * reaches the end, a few more slots are appended instead.
+ *
+ * Deleting leaves a tombstone and never moves other items, so like HASH it
+ * is fine to delete the current item in frr_each_safe().  The table only
+ * shrinks on _add() and _pop().
+ */
+
+/* don't use these structs directly */
+struct oahash_item {
+	uint32_t hashval;
+	uint32_t index;
+};
+
+struct oahash_head {
+	struct oahash_item **entries;
+	/* only meaningful where entries[] is set; for empty slots 0 means
+	 * never used and OAHASH_TOMBSTONE means deleted
+	 */
+	uint32_t *hashes;
+	uint32_t count, deleted;
+	/* slots in use, including the part past the end of the table */
+	uint32_t size;
+	/* no item below this index */
+	uint32_t first;
+
+	uint8_t tabshift;
+};
+
+#define OAHASH_TOMBSTONE	1U
+#define OAHASH_MINSHIFT		3
+#define _OAHASH_KEY(tabshift, val) \
+	((val) >> (32 - (tabshift)))
+#define OAHASH_KEY(head, val) \
+	_OAHASH_KEY((head).tabshift, val)
+/* at most 3/4 filled, counting tombstones; at least 1/8 */
+#define OAHASH_RESIZE_THRESHOLD(head)                                          \
+	(!(head).tabshift                                                      \
+	 || ((head).count + (head).deleted + 1) * 4 >= (3U << (head).tabshift) \
+	 || ((head).tabshift > OAHASH_MINSHIFT                                 \
+	     && (head).count * 8 < (1U << (head).tabshift)))
+
+/* rehash for one more item than is in the table, dropping tombstones */
+extern void typesafe_oahash_resize(struct oahash_head *head);
+/* append slots past the end of the table */
+extern void typesafe_oahash_extend(struct oahash_head *head);
+extern void typesafe_oahash_free(struct oahash_head *head);
+
+/* use as:
+ *
+ * PREDECL_OAHASH(namelist)
+ * struct name {
+ *   struct namelist_item nlitem;
+ * }
+ * DECLARE_OAHASH(namelist, struct name, nlitem, cmpfunc, hashfunc)
+ */
+#define PREDECL_OAHASH(prefix)                                                 \
+struct prefix ## _head { struct oahash_head hh; };                             \
+struct prefix ## _item { struct oahash_item hi; };
+
+#define INIT_OAHASH(var)	{ }
+
+#define DECLARE_OAHASH(prefix, type, field, cmpfn, hashfn)                     \
+                                                                               \
+macro_inline void prefix ## _init(struct prefix##_head *h)                     \
+{                                                                              \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline void prefix ## _fini(struct prefix##_head *h)                     \
+{                                                                              \
+	assert(h->hh.count == 0);                                              \
+	typesafe_oahash_free(&h->hh);                                          \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline type *prefix ## _add(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	uint32_t hval = hashfn(item), i, slot = UINT32_MAX;                    \
+	if (OAHASH_RESIZE_THRESHOLD(h->hh))                                    \
+		typesafe_oahash_resize(&h->hh);                                \
+	for (i = OAHASH_KEY(h->hh, hval); i < h->hh.size; i++) {               \
+		struct oahash_item *hitem = h->hh.entries[i];                  \
+		if (!hitem) {                                                  \
+			if (h->hh.hashes[i] != OAHASH_TOMBSTONE)               \
+				break;                                         \
+			if (slot == UINT32_MAX)                                \
+				slot = i;                                      \
+			continue;                                              \
+		}                                                              \
+		if (h->hh.hashes[i] == hval                                    \
+		    && cmpfn(container_of(hitem, type, field.hi), item) == 0)  \
+			return container_of(hitem, type, field.hi);            \
+	}                                                                      \
+	if (slot != UINT32_MAX)                                                \
+		h->hh.deleted--;                                               \
+	else {                                                                 \
+		if (i == h->hh.size)                                           \
+			typesafe_oahash_extend(&h->hh);                        \
+		slot = i;                                                      \
+	}                                                                      \
+	item->field.hi.hashval = hval;                                         \
+	item->field.hi.index = slot;                                           \
+	h->hh.entries[slot] = &item->field.hi;                                 \
+	h->hh.hashes[slot] = hval;                                             \
+	if (slot < h->hh.first)                                                \
+		h->hh.first = slot;                                            \
+	h->hh.count++;                                                         \
+	return NULL;                                                           \
+}                                                                              \
+macro_inline const type *prefix ## _const_find(const struct prefix##_head *h,  \
+					       const type *item)               \
+{                                                                              \
+	if (!h->hh.tabshift)                                                   \
+		return NULL;                                                   \
+	uint32_t hval = hashfn(item), i;                                       \
+	for (i = OAHASH_KEY(h->hh, hval); i < h->hh.size; i++) {               \
+		const struct oahash_item *hitem = h->hh.entries[i];            \
+		if (!hitem) {                                                  \
+			if (h->hh.hashes[i] != OAHASH_TOMBSTONE)               \
+				break;                                         \
+			continue;                                              \
+		}                                                              \
+		if (h->hh.hashes[i] == hval                                    \
+		    && !cmpfn(container_of(hitem, type, field.hi), item))      \
+			return container_of(hitem, type, field.hi);            \
+	}                                                                      \
+	return NULL;                                                           \
+}                                                                              \
+TYPESAFE_FIND(prefix, type)                                                    \
+macro_inline type *prefix ## _del(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	uint32_t i = item->field.hi.index;                                     \
+	if (i >= h->hh.size || h->hh.entries[i] != &item->field.hi)            \
+		return NULL;                                                   \
+	h->hh.entries[i] = NULL;                                               \
+	h->hh.hashes[i] = OAHASH_TOMBSTONE;                                    \
+	h->hh.count--;                                                         \
+	h->hh.deleted++;                                                       \
+	return item;                                                           \
+}                                                                              \
+macro_inline type *prefix ## _pop(struct prefix##_head *h)                     \
+{                                                                              \
+	uint32_t i;                                                            \
+	for (i = h->hh.first; i < h->hh.size; i++)                             \
+		if (h->hh.entries[i]) {                                        \
+			struct oahash_item *hitem = h->hh.entries[i];          \
+			h->hh.entries[i] = NULL;                               \
+			h->hh.hashes[i] = OAHASH_TOMBSTONE;                    \
+			h->hh.count--;                                         \
+			h->hh.deleted++;                                       \
+			h->hh.first = i + 1;                                   \
+			if (!h->hh.count)                                      \
+				typesafe_oahash_free(&h->hh);                  \
+			else if (OAHASH_RESIZE_THRESHOLD(h->hh))               \
+				typesafe_oahash_resize(&h->hh);                \
+			return container_of(hitem, type, field.hi);            \
+		}                                                              \
+	return NULL;                                                           \
+}                                                                              \
+macro_pure const type *prefix ## _const_first(const struct prefix##_head *h)   \
+{                                                                              \
+	uint32_t i;                                                            \
+	for (i = h->hh.first; i < h->hh.size; i++)                             \
+		if (h->hh.entries[i])                                          \
+			return container_of(h->hh.entries[i], type, field.hi); \
+	return NULL;                                                           \
+}                                                                              \
+macro_pure const type *prefix ## _const_next(const struct prefix##_head *h,    \
+					     const type *item)                 \
+{                                                                              \
+	uint32_t i;                                                            \
+	for (i = item->field.hi.index + 1; i < h->hh.size; i++)                \
+		if (h->hh.entries[i])                                          \
+			return container_of(h->hh.entries[i], type, field.hi); \
+	return NULL;                                                           \
+}                                                                              \
+TYPESAFE_FIRST_NEXT(prefix, type)                                              \
+macro_pure type *prefix ## _next_safe(struct prefix##_head *h, type *item)     \
+{                                                                              \
+	if (!item)                                                             \
+		return NULL;                                                   \
+	return prefix ## _next(h, item);                                       \
+}                                                                              \
+macro_pure size_t prefix ## _count(const struct prefix##_head *h)              \
+{                                                                              \
+	return h->hh.count;                                                    \
+}                                                                              \
+/* ... */
+
 /* skiplist, sorted.
  * can be used as priority queue with add / pop
  */
@@ -92,6 +92,9 @@ struct vrf {
 	/* Back pointer to namespace context */
 	void *ns_ctxt;
 
+	/* Address to interface lookup index, see lib/if.c */
+	struct if_addr_index *if_addr_index;
+
 	QOBJ_FIELDS
 };
 RB_HEAD(vrf_id_head, vrf);
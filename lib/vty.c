@@ -47,6 +47,7 @@
 #include "frrstr.h"
 #include "lib_errors.h"
 #include "northbound_cli.h"
+#include "northbound_snapshot.h"
 #include "printfrr.h"
 
 #include <arpa/telnet.h>
@@ -69,7 +70,8 @@ enum event {
 #ifdef VTYSH
 	VTYSH_SERV,
 	VTYSH_READ,
-	VTYSH_WRITE
+	VTYSH_WRITE,
+	VTYSH_RESUME
 #endif /* VTYSH */
 };
 
@@ -150,6 +152,17 @@ bool vty_set_include(struct vty *vty, const char *regexp)
 	return ret;
 }
 
+/* Chunk size for vty output.  Large so big show commands format into a
+ * few chunks that are flushed with one writev(), rather than into many
+ * small allocations.
+ */
+#define VTY_OBUF_SIZE 65536
+
+/* Output a command may queue before it has to wait for the client to
+ * read some of it, see vty_out_flush().
+ */
+#define VTY_OUT_BACKLOG (16 * VTY_OBUF_SIZE)
+
 /* VTY standard output function. */
 int vty_out(struct vty *vty, const char *format, ...)
 {
@@ -164,6 +177,17 @@ int vty_out(struct vty *vty, const char *format, ...)
 		vty_out(vty, "%s", vty->frame);
 	}
 
+	/* no filtering and no crlf replacement: format straight into obuf */
+	if (!vty->filter && vty->type != VTY_TERM && vty->type != VTY_SHELL) {
+		va_start(args, format);
+		len = buffer_vprintf(vty->obuf, format, args);
+		va_end(args);
+
+		if (buffer_length(vty->obuf) >= VTY_OUT_BACKLOG)
+			vty_out_flush(vty);
+		return len;
+	}
+
 	va_start(args, format);
 	p = vasnprintfrr(MTYPE_VTY_OUT_BUF, buf, sizeof(buf), format, args);
 	va_end(args);
@@ -256,6 +280,9 @@ done:
 	if (p != buf)
 		XFREE(MTYPE_VTY_OUT_BUF, p);
 
+	if (vty->type == VTY_TERM && buffer_length(vty->obuf) >= VTY_OUT_BACKLOG)
+		vty_out_flush(vty);
+
 	return len;
 }
 
@@ -316,6 +343,36 @@ static int vty_log_out(struct vty *vty, const char *level,
 	return 0;
 }
 
+bool vty_out_flush(struct vty *vty)
+{
+	if (vty->type != VTY_SHELL_SERV
+	    && (vty->type != VTY_TERM || vty->lines != 0))
+		return false;
+
+	switch (buffer_flush_available(vty->obuf, vty->wfd)) {
+	case BUFFER_PENDING:
+#ifdef VTYSH
+		if (vty->type == VTY_SHELL_SERV) {
+			vty_event(VTYSH_WRITE, vty->wfd, vty);
+			return true;
+		}
+#endif /* VTYSH */
+		/* the rest goes out after the command */
+		return false;
+	case BUFFER_ERROR:
+		vty->monitor = 0;
+		flog_err(EC_LIB_SOCKET, "%s: write error to fd %d, closing",
+			 __func__, vty->fd);
+		buffer_reset(vty->obuf);
+		/* closed by whoever ran the command */
+		vty->status = VTY_CLOSE;
+		return vty->type == VTY_SHELL_SERV;
+	case BUFFER_EMPTY:
+		break;
+	}
+	return false;
+}
+
 /* Output current time to the vty. */
 void vty_time_print(struct vty *vty, int cr)
 {
@@ -1590,7 +1647,7 @@ struct vty *vty_new(void)
 	new->fd = new->wfd = -1;
 	new->of = stdout;
 	new->lbuf = buffer_new(0);
-	new->obuf = buffer_new(0); /* Use default buffer size. */
+	new->obuf = buffer_new(VTY_OBUF_SIZE);
 	new->buf = XCALLOC(MTYPE_VTY, VTY_BUFSIZ);
 	new->max = VTY_BUFSIZ;
 
@@ -2063,6 +2120,9 @@ static int vtysh_flush(struct vty *vty)
 		vty_close(vty);
 		return -1;
 	case BUFFER_EMPTY:
+		/* the client caught up, continue a yielded command */
+		if (vty->resume)
+			vty_event(VTYSH_RESUME, vty->wfd, vty);
 		break;
 	}
 	return 0;
@@ -2163,6 +2223,59 @@ static int vtysh_write(struct thread *thread)
 	return 0;
 }
 
+int vty_yield(struct vty *vty, int (*resume)(struct vty *vty, void *arg),
+	      void (*cancel)(void *arg), void *arg)
+{
+	assert(vty->type == VTY_SHELL_SERV);
+
+	vty->resume = resume;
+	vty->resume_cancel = cancel;
+	vty->resume_arg = arg;
+
+	/* vty_out_flush() has scheduled the write, which resumes us */
+	if (buffer_empty(vty->obuf))
+		vty_event(VTYSH_RESUME, vty->wfd, vty);
+	return CMD_SUSPEND;
+}
+
+static int vty_resume(struct thread *thread)
+{
+	struct vty *vty = THREAD_ARG(thread);
+	int (*resume)(struct vty *vty, void *arg) = vty->resume;
+	uint8_t header[4] = {0, 0, 0, 0};
+	int ret;
+
+	/* vty_close() cancels the command */
+	if (vty->status == VTY_CLOSE) {
+		vty_close(vty);
+		return 0;
+	}
+
+	/* vty_yield() sets these again if the command yields once more */
+	vty->resume = NULL;
+	vty->resume_cancel = NULL;
+
+	ret = resume(vty, vty->resume_arg);
+	if (ret != CMD_SUSPEND) {
+		/* finish the command like vtysh_read() does */
+		header[3] = ret;
+		buffer_put(vty->obuf, header, 4);
+		if (!vty->t_write && vtysh_flush(vty) < 0)
+			return 0;
+	}
+
+	if (vty->status == VTY_CLOSE)
+		vty_close(vty);
+	return 0;
+}
+#else
+int vty_yield(struct vty *vty, int (*resume)(struct vty *vty, void *arg),
+	      void (*cancel)(void *arg), void *arg)
+{
+	/* vty_out_flush() never asks a command to yield without vtysh */
+	assert(0);
+	return CMD_WARNING;
+}
 #endif /* VTYSH */
 
 /* Determine address family to bind. */
@@ -2200,6 +2313,11 @@ void vty_close(struct vty *vty)
 	THREAD_OFF(vty->t_read);
 	THREAD_OFF(vty->t_write);
 	THREAD_OFF(vty->t_timeout);
+	THREAD_OFF(vty->t_resume);
+
+	/* A yielded command won't be resumed. */
+	if (vty->resume_cancel)
+		vty->resume_cancel(vty->resume_arg);
 
 	/* Flush buffer. */
 	buffer_flush_all(vty->obuf, vty->wfd);
@@ -2360,6 +2478,63 @@ static void vty_read_file(struct nb_config *config, FILE *confp)
 	vty_close(vty);
 }
 
+bool vty_read_snapshot(struct nb_config *config, const uint8_t *digest)
+{
+	struct nb_config *saved;
+	size_t text_len;
+	char *text;
+	FILE *confp;
+
+	saved = nb_config_dup(config);
+	text = nb_snapshot_read(snapshot_default, digest, config, &text_len);
+	if (!text) {
+		nb_config_free(saved);
+		return false;
+	}
+
+	/* fmemopen() doesn't like empty buffers */
+	confp = fmemopen(text, text_len ? text_len : 1, "r");
+	if (!confp) {
+		nb_config_replace(config, saved, false);
+		XFREE(MTYPE_TMP, text);
+		return false;
+	}
+
+	/*
+	 * In the classic CLI mode every command commits on its own, so do the
+	 * same for the northbound data before the rest of the commands are
+	 * applied: they may refer to it.
+	 */
+	if (frr_get_cli_mode() == FRR_CLI_CLASSIC) {
+		struct nb_context context = {};
+		char errmsg[BUFSIZ] = {0};
+		int ret;
+
+		context.client = NB_CLIENT_CLI;
+		ret = nb_candidate_commit(&context, config, true,
+					  "Read configuration snapshot", NULL,
+					  errmsg, sizeof(errmsg));
+		if (ret != NB_OK && ret != NB_ERR_NO_CHANGES) {
+			flog_warn(EC_LIB_NB_SNAPSHOT,
+				  "%s: failed to commit configuration snapshot: %s (%s)",
+				  __func__, nb_err_name(ret), errmsg);
+			nb_config_replace(config, saved, false);
+			fclose(confp);
+			XFREE(MTYPE_TMP, text);
+			return false;
+		}
+	}
+	nb_config_free(saved);
+
+	if (text_len)
+		vty_read_file(config, confp);
+	fclose(confp);
+	XFREE(MTYPE_TMP, text);
+
+	zlog_info("Configuration read from snapshot %s", snapshot_default);
+	return true;
+}
+
 static FILE *vty_use_backup_config(const char *fullpath)
 {
 	char *fullpath_sav, *fullpath_tmp;
@@ -2420,6 +2595,7 @@ bool vty_read_config(struct nb_config *config, const char *config_file,
 		     char *config_default_dir)
 {
 	char cwd[MAXPATHLEN];
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
 	FILE *confp = NULL;
 	const char *fullpath;
 	char *tmp = NULL;
@@ -2517,7 +2693,9 @@ bool vty_read_config(struct nb_config *config, const char *config_file,
 			fullpath = config_default_dir;
 	}
 
-	vty_read_file(config, confp);
+	if (!config || !nb_snapshot_digest_file(confp, digest)
+	    || !vty_read_snapshot(config, digest))
+		vty_read_file(config, confp);
 	read_success = true;
 
 	fclose(confp);
@@ -2681,6 +2859,10 @@ static void vty_event(enum event event, int sock, struct vty *vty)
 		thread_add_write(vty_master, vtysh_write, vty, sock,
 				 &vty->t_write);
 		break;
+	case VTYSH_RESUME:
+		thread_add_event(vty_master, vty_resume, vty, 0,
+				 &vty->t_resume);
+		break;
 #endif /* VTYSH */
 	case VTY_READ:
 		thread_add_read(vty_master, vty_read, vty, sock, &vty->t_read);
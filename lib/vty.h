@@ -192,6 +192,12 @@ struct vty {
 	unsigned long v_timeout;
 	struct thread *t_timeout;
 
+	/* Command that yielded until the client reads its output. */
+	int (*resume)(struct vty *vty, void *arg);
+	void (*resume_cancel)(void *arg);
+	void *resume_arg;
+	struct thread *t_resume;
+
 	/* What address is this vty comming from. */
 	char address[SU_ADDRSTRLEN];
 
@@ -318,10 +324,31 @@ extern struct vty *vty_stdio(void (*atclose)(int isexit));
 extern int vty_out(struct vty *, const char *, ...) PRINTFRR(2, 3);
 extern void vty_frame(struct vty *, const char *, ...) PRINTFRR(2, 3);
 extern void vty_endframe(struct vty *, const char *);
+/* Write out what a long-running command has printed so far, as far as the
+ * client takes it without waiting.  Only where that can't interfere with
+ * --More-- paging.  vty_out() calls this by itself once enough output is
+ * queued.
+ *
+ * Returns true if a vtysh client is behind.  A command that can continue
+ * later should then save its position and return vty_yield().
+ */
+extern bool vty_out_flush(struct vty *vty);
+/* Suspend the running command until the client has read its output; it
+ * continues in resume(), which returns the command's result or yields
+ * again.  If the vty closes first, cancel() frees arg instead.  Returns
+ * CMD_SUSPEND, for the command to return.
+ */
+extern int vty_yield(struct vty *vty, int (*resume)(struct vty *vty, void *arg),
+		     void (*cancel)(void *arg), void *arg);
 bool vty_set_include(struct vty *vty, const char *regexp);
 
 extern bool vty_read_config(struct nb_config *config, const char *config_file,
 			    char *config_default_dir);
+/* Load the configuration from the snapshot saved along with the text
+ * configuration that has the given digest, see northbound_snapshot.h.
+ * Returns false, without side effects, if there is no usable snapshot.
+ */
+extern bool vty_read_snapshot(struct nb_config *config, const uint8_t *digest);
 extern void vty_time_print(struct vty *, int);
 extern void vty_serv_sock(const char *, unsigned short, const char *);
 extern void vty_close(struct vty *);
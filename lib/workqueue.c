@@ -27,10 +27,46 @@
 #include "linklist.h"
 #include "command.h"
 #include "log.h"
+#include "frr_pthread.h"
 
 DEFINE_MTYPE(LIB, WORK_QUEUE, "Work queue")
 DEFINE_MTYPE_STATIC(LIB, WORK_QUEUE_ITEM, "Work queue item")
 DEFINE_MTYPE_STATIC(LIB, WORK_QUEUE_NAME, "Work queue name string")
+DEFINE_MTYPE_STATIC(LIB, WORK_QUEUE_PARALLEL, "Work queue pthread pool")
+
+/* parallel mode item states */
+#define WQ_ITEM_QUEUED	0 /* on par->pending */
+#define WQ_ITEM_RUNNING	1 /* handed to a shard pthread */
+#define WQ_ITEM_DONE	2 /* ran, waiting for the owner to pick it up */
+
+struct wq_shard {
+	struct work_queue_parallel *par;
+	struct frr_pthread *fpt;
+	struct thread *t_run;
+	bool kick;
+
+	/* Requires: par->mtx */
+	STAILQ_HEAD(wq_shard_items, work_queue_item) items;
+};
+
+struct work_queue_parallel {
+	struct work_queue *wq;
+
+	/* protects shard lists and item state/ret */
+	pthread_mutex_t mtx;
+
+	/* work_queue_collect() on the owner */
+	struct thread *t_done;
+
+	/* owner only, items not handed to a shard yet */
+	struct wq_shard_items pending;
+
+	unsigned int next;
+	unsigned int nshards;
+	struct wq_shard shards[0];
+};
+
+static void work_queue_parallel_stop(struct work_queue *wq);
 
 /* master list of work_queues */
 static struct list _work_queues;
@@ -106,6 +142,8 @@ void work_queue_free_and_null(struct work_queue **wqp)
 	if (wq->thread != NULL)
 		thread_cancel(&(wq->thread));
 
+	work_queue_parallel_stop(wq);
+
 	while (!work_queue_empty(wq)) {
 		struct work_queue_item *item = work_queue_last_item(wq);
 
@@ -160,6 +198,8 @@ void work_queue_add(struct work_queue *wq, void *data)
 
 	item->data = data;
 	work_queue_item_enqueue(wq, item);
+	if (wq->par)
+		STAILQ_INSERT_TAIL(&wq->par->pending, item, shard);
 
 	work_queue_schedule(wq, wq->spec.hold);
 
@@ -233,6 +273,226 @@ void work_queue_unplug(struct work_queue *wq)
 	work_queue_schedule(wq, wq->spec.hold);
 }
 
+/* Parallel mode
+ *
+ * Items stay on wq->items in the order they were added.  work_queue_run()
+ * hands pending items to their shard's pthread, which runs workfunc on
+ * them and marks them done.  work_queue_collect() then runs on the owner
+ * and finishes items from the head of wq->items for as long as they are
+ * done, so everything the owner sees happens in the original order.
+ */
+static int work_queue_shard_run(struct thread *thread);
+static int work_queue_collect(struct thread *thread);
+
+void work_queue_set_parallel(struct work_queue *wq, unsigned int nthreads)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct work_queue_parallel *par;
+	char name[64], os_name[OS_THREAD_NAMELEN];
+	unsigned int i;
+
+	assert(work_queue_empty(wq));
+
+	work_queue_parallel_stop(wq);
+	if (!nthreads)
+		return;
+
+	par = XCALLOC(MTYPE_WORK_QUEUE_PARALLEL,
+		      sizeof(*par) + nthreads * sizeof(par->shards[0]));
+	par->wq = wq;
+	par->nshards = nthreads;
+	pthread_mutex_init(&par->mtx, NULL);
+	STAILQ_INIT(&par->pending);
+
+	for (i = 0; i < nthreads; i++) {
+		struct wq_shard *shard = &par->shards[i];
+
+		shard->par = par;
+		STAILQ_INIT(&shard->items);
+
+		snprintf(name, sizeof(name), "%s worker %u", wq->name, i);
+		snprintf(os_name, sizeof(os_name), "wq_worker%u", i);
+		shard->fpt = frr_pthread_new(&attr, name, os_name);
+		frr_pthread_run(shard->fpt, NULL);
+		frr_pthread_wait_running(shard->fpt);
+	}
+
+	wq->par = par;
+}
+
+static void work_queue_parallel_stop(struct work_queue *wq)
+{
+	struct work_queue_parallel *par = wq->par;
+	unsigned int i;
+
+	if (!par)
+		return;
+
+	/* items that didn't start yet are simply dropped, they are still on
+	 * wq->items for the caller to clean up
+	 */
+	frr_with_mutex(&par->mtx) {
+		for (i = 0; i < par->nshards; i++)
+			STAILQ_INIT(&par->shards[i].items);
+	}
+
+	for (i = 0; i < par->nshards; i++) {
+		frr_pthread_stop(par->shards[i].fpt, NULL);
+		frr_pthread_destroy(par->shards[i].fpt);
+	}
+
+	thread_cancel(&par->t_done);
+	pthread_mutex_destroy(&par->mtx);
+	XFREE(MTYPE_WORK_QUEUE_PARALLEL, wq->par);
+}
+
+static void work_queue_dispatch(struct work_queue *wq)
+{
+	struct work_queue_parallel *par = wq->par;
+	struct work_queue_item *item;
+	struct wq_shard *shard;
+	unsigned int i, cycles = 0;
+
+	while ((item = STAILQ_FIRST(&par->pending))) {
+		STAILQ_REMOVE_HEAD(&par->pending, shard);
+
+		/* dont run items which are past their allowed retries */
+		if (item->ran > wq->spec.max_retries) {
+			/* run error handler, if any */
+			if (wq->spec.errorfunc)
+				wq->spec.errorfunc(wq, item);
+			work_queue_item_remove(wq, item);
+			continue;
+		}
+
+		if (wq->spec.shardfunc)
+			i = wq->spec.shardfunc(wq, item->data);
+		else
+			i = par->next++;
+		shard = &par->shards[i % par->nshards];
+
+		frr_with_mutex(&par->mtx) {
+			item->state = WQ_ITEM_RUNNING;
+			STAILQ_INSERT_TAIL(&shard->items, item, shard);
+		}
+		shard->kick = true;
+		cycles++;
+	}
+
+	for (i = 0; i < par->nshards; i++) {
+		shard = &par->shards[i];
+		if (!shard->kick)
+			continue;
+
+		shard->kick = false;
+		thread_add_event(shard->fpt->master, work_queue_shard_run,
+				 shard, 0, &shard->t_run);
+	}
+
+	wq->runs++;
+	wq->cycles.total += cycles;
+}
+
+/* runs on the shard's pthread */
+static int work_queue_shard_run(struct thread *thread)
+{
+	struct wq_shard *shard = THREAD_ARG(thread);
+	struct work_queue_parallel *par = shard->par;
+	struct work_queue *wq = par->wq;
+	struct work_queue_item *item;
+	wq_item_status ret;
+
+	while (true) {
+		frr_with_mutex(&par->mtx) {
+			item = STAILQ_FIRST(&shard->items);
+			if (item)
+				STAILQ_REMOVE_HEAD(&shard->items, shard);
+		}
+		if (!item)
+			break;
+
+		do {
+			ret = wq->spec.workfunc(wq, item->data);
+			item->ran++;
+		} while ((ret == WQ_RETRY_NOW)
+			 && (item->ran < wq->spec.max_retries));
+
+		frr_with_mutex(&par->mtx) {
+			item->ret = ret;
+			item->state = WQ_ITEM_DONE;
+		}
+		thread_add_event(wq->master, work_queue_collect, wq, 0,
+				 &par->t_done);
+	}
+	return 0;
+}
+
+static int work_queue_collect(struct thread *thread)
+{
+	struct work_queue *wq = THREAD_ARG(thread);
+	struct work_queue_parallel *par = wq->par;
+	struct work_queue_item *item, *titem;
+	unsigned int delay = 0;
+	wq_item_status ret;
+	uint8_t state;
+
+	STAILQ_FOREACH_SAFE (item, &wq->items, wq, titem) {
+		frr_with_mutex(&par->mtx) {
+			state = item->state;
+			ret = item->ret;
+		}
+		if (state != WQ_ITEM_DONE)
+			break;
+
+		switch (ret) {
+		case WQ_QUEUE_BLOCKED:
+			/* not an item specific error, see work_queue_run() */
+			item->ran--;
+			/* fallthru */
+		case WQ_RETRY_LATER:
+			/* keep the item at the head and retry the queue */
+			frr_with_mutex(&par->mtx) {
+				item->state = WQ_ITEM_QUEUED;
+			}
+			STAILQ_INSERT_HEAD(&par->pending, item, shard);
+			delay = wq->spec.retry;
+			goto out;
+		case WQ_REQUEUE:
+			item->ran--;
+			frr_with_mutex(&par->mtx) {
+				item->state = WQ_ITEM_QUEUED;
+			}
+			STAILQ_INSERT_TAIL(&par->pending, item, shard);
+			work_queue_item_requeue(wq, item);
+			break;
+		case WQ_RETRY_NOW:
+		/* a RETRY_NOW that gets here has exceeded max_tries, same as
+		 * ERROR */
+		case WQ_ERROR:
+			if (wq->spec.errorfunc)
+				wq->spec.errorfunc(wq, item);
+			work_queue_item_remove(wq, item);
+			break;
+		case WQ_SUCCESS:
+		default:
+			if (wq->spec.donefunc)
+				wq->spec.donefunc(wq, item->data);
+			work_queue_item_remove(wq, item);
+			break;
+		}
+	}
+
+out:
+	if (!STAILQ_EMPTY(&par->pending))
+		work_queue_schedule(wq, delay);
+	else if (work_queue_empty(wq) && wq->spec.completion_func)
+		wq->spec.completion_func(wq);
+	return 0;
+}
+
 /* timer thread to process a work queue
  * will reschedule itself if required,
  * otherwise work_queue_item_add
@@ -251,6 +511,11 @@ int work_queue_run(struct thread *thread)
 
 	wq->thread = NULL;
 
+	if (wq->par) {
+		work_queue_dispatch(wq);
+		return 0;
+	}
+
 	/* calculate cycle granularity:
 	 * list iteration == 1 run
 	 * listnode processing == 1 cycle
@@ -55,8 +55,15 @@ struct work_queue_item {
 	STAILQ_ENTRY(work_queue_item) wq;
 	void *data;	 /* opaque data */
 	unsigned short ran; /* # of times item has been run */
+
+	/* parallel mode only, protected by the queue's pthread mutex */
+	STAILQ_ENTRY(work_queue_item) shard;
+	wq_item_status ret;
+	uint8_t state;
 };
 
+struct work_queue_parallel;
+
 #define WQ_UNPLUGGED	(1 << 0) /* available for draining */
 
 struct work_queue {
@@ -91,6 +98,20 @@ struct work_queue {
 		 */
 		void (*completion_func)(struct work_queue *);
 
+		/* parallel mode only (see work_queue_set_parallel()):
+		 *
+		 * shardfunc maps item data to a shard, optional.  Items on
+		 * the same shard are run in order, on the same pthread.
+		 * Items that must not be processed concurrently need to map
+		 * to the same shard.
+		 *
+		 * donefunc is called on the queue's thread_master for each
+		 * item that workfunc completed successfully, in the order
+		 * the items were added, optional.
+		 */
+		unsigned int (*shardfunc)(struct work_queue *, void *);
+		void (*donefunc)(struct work_queue *, void *);
+
 		/* max number of retries to make for item that errors */
 		unsigned int max_retries;
 
@@ -117,6 +138,8 @@ struct work_queue {
 
 	/* private state */
 	uint16_t flags; /* user set flag */
+
+	struct work_queue_parallel *par;
 };
 
 /* User API */
@@ -166,6 +189,15 @@ extern struct work_queue *work_queue_new(struct thread_master *, const char *);
  */
 extern void work_queue_free_and_null(struct work_queue **wqp);
 
+/* Run items on a pool of nthreads pthreads rather than on the queue's
+ * thread_master.  workfunc is then called on those pthreads and must only
+ * touch per-item state (or state private to its shard);  errorfunc,
+ * donefunc, del_item_data and completion_func are still called on the
+ * queue's thread_master.  Must be called while the queue is empty.
+ */
+extern void work_queue_set_parallel(struct work_queue *wq,
+				    unsigned int nthreads);
+
 /* Add the supplied data as an item onto the workqueue */
 extern void work_queue_add(struct work_queue *wq, void *item);
 
@@ -397,18 +397,115 @@ const char *yang_dnode_get_schema_name(const struct lyd_node *dnode,
 	return dnode->schema->name;
 }
 
-struct lyd_node *yang_dnode_get(const struct lyd_node *dnode,
-				const char *xpath_fmt, ...)
+/*
+ * Split a relative data path made only of "." and ".." steps and plain node
+ * names into steps. Anything else (absolute paths, prefixes, predicates,
+ * wildcards...) is left to the libyang XPath engine.
+ */
+static void yang_dpath_compile(struct yang_dpath *dpath)
+{
+	const char *p = dpath->xpath;
+
+	dpath->compiled = true;
+	dpath->fallback = true;
+	dpath->num = 0;
+
+	if (*p == '\0' || *p == '/' || strpbrk(p, "[]:*()=|@ \"'"))
+		return;
+
+	while (*p) {
+		const char *end = strchr(p, '/');
+		size_t len = end ? (size_t)(end - p) : strlen(p);
+
+		if (len == 0 || len > UINT8_MAX)
+			return;
+
+		if (len == 2 && p[0] == '.' && p[1] == '.') {
+			if (dpath->num == YANG_DPATH_MAXSTEPS)
+				return;
+			dpath->step[dpath->num].name = NULL;
+			dpath->step[dpath->num].len = 0;
+			dpath->step[dpath->num].snode = NULL;
+			dpath->num++;
+		} else if (len != 1 || p[0] != '.') {
+			if (dpath->num == YANG_DPATH_MAXSTEPS)
+				return;
+			dpath->step[dpath->num].name = p;
+			dpath->step[dpath->num].len = len;
+			dpath->step[dpath->num].snode = NULL;
+			dpath->num++;
+		}
+
+		p += len;
+		if (*p == '/')
+			p++;
+	}
+
+	dpath->fallback = false;
+}
+
+/*
+ * Walk the data tree along a compiled data path. Returns false when the
+ * result is ambiguous without the libyang XPath engine (i.e. the path goes
+ * through a list or leaf-list, or through another module's node).
+ */
+static bool yang_dpath_walk(const struct lyd_node *dnode,
+			    struct yang_dpath *dpath, struct lyd_node **found)
+{
+	for (unsigned int i = 0; i < dpath->num; i++) {
+		struct yang_dpath_step *step = &dpath->step[i];
+		const struct lyd_node *child, *next = NULL;
+
+		if (!step->name) {
+			if (!dnode->parent)
+				return false;
+			dnode = dnode->parent;
+			continue;
+		}
+
+		if (!CHECK_FLAG(dnode->schema->nodetype,
+				LYS_CONTAINER | LYS_LIST)) {
+			*found = NULL;
+			return true;
+		}
+
+		LY_TREE_FOR (dnode->child, child) {
+			/* Schema node seen last time, no need to compare. */
+			if (child->schema == step->snode) {
+				next = child;
+				break;
+			}
+			if (strncmp(child->schema->name, step->name, step->len)
+			    || child->schema->name[step->len] != '\0')
+				continue;
+			if (lys_node_module(child->schema)
+			    != lys_node_module(dnode->schema))
+				return false;
+
+			step->snode = child->schema;
+			next = child;
+			break;
+		}
+		if (!next) {
+			*found = NULL;
+			return true;
+		}
+		if (CHECK_FLAG(next->schema->nodetype, LYS_LIST | LYS_LEAFLIST))
+			return false;
+
+		dnode = next;
+	}
+
+	*found = (struct lyd_node *)dnode;
+	return true;
+}
+
+static struct lyd_node *yang_dnode_find_path(const struct lyd_node *dnode,
+					     const char *xpath)
 {
-	va_list ap;
-	char xpath[XPATH_MAXLEN];
 	struct ly_set *set;
 	struct lyd_node *dnode_ret = NULL;
 
-	va_start(ap, xpath_fmt);
-	vsnprintf(xpath, sizeof(xpath), xpath_fmt, ap);
-	va_end(ap);
-
 	set = lyd_find_path(dnode, xpath);
 	assert(set);
 	if (set->number == 0)
@@ -429,10 +526,40 @@ exit:
 	return dnode_ret;
 }
 
+struct lyd_node *yang_dnode_dpath(const struct lyd_node *dnode,
+				  struct yang_dpath *dpath)
+{
+	struct lyd_node *found;
+
+	if (!dpath->compiled)
+		yang_dpath_compile(dpath);
+
+	if (!dpath->fallback && yang_dpath_walk(dnode, dpath, &found))
+		return found;
+
+	return yang_dnode_find_path(dnode, dpath->xpath);
+}
+
+struct lyd_node *yang_dnode_get(const struct lyd_node *dnode,
+				const char *xpath_fmt, ...)
+{
+	va_list ap;
+	char xpath[XPATH_MAXLEN];
+	struct yang_dpath dpath = {.xpath = xpath};
+
+	va_start(ap, xpath_fmt);
+	vsnprintf(xpath, sizeof(xpath), xpath_fmt, ap);
+	va_end(ap);
+
+	return yang_dnode_dpath(dnode, &dpath);
+}
+
 bool yang_dnode_exists(const struct lyd_node *dnode, const char *xpath_fmt, ...)
 {
 	va_list ap;
 	char xpath[XPATH_MAXLEN];
+	struct yang_dpath dpath = {.xpath = xpath};
+	struct lyd_node *dnode_found;
 	struct ly_set *set;
 	bool found;
 
@@ -440,6 +567,10 @@ bool yang_dnode_exists(const struct lyd_node *dnode, const char *xpath_fmt, ...)
 	vsnprintf(xpath, sizeof(xpath), xpath_fmt, ap);
 	va_end(ap);
 
+	yang_dpath_compile(&dpath);
+	if (!dpath.fallback && yang_dpath_walk(dnode, &dpath, &dnode_found))
+		return dnode_found != NULL;
+
 	set = lyd_find_path(dnode, xpath);
 	assert(set);
 	found = (set->number > 0);
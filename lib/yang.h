@@ -331,6 +331,58 @@ extern const char *yang_dnode_get_schema_name(const struct lyd_node *dnode,
 extern struct lyd_node *yang_dnode_get(const struct lyd_node *dnode,
 				       const char *xpath_fmt, ...);
 
+/* Maximum number of steps of a compiled data path. */
+#define YANG_DPATH_MAXSTEPS 8
+
+/*
+ * Relative data path parsed once and reused across lookups, meant to be
+ * declared as a static variable next to the callback doing the lookups:
+ *
+ *    static struct yang_dpath dp_seq = YANG_DPATH_INIT("./sequence");
+ *
+ *    seq = yang_dnode_get_uint32(yang_dnode_dpath(dnode, &dp_seq), NULL);
+ *
+ * Paths made only of "." and ".." steps and unprefixed node names are
+ * resolved by walking the data tree, comparing the schema nodes found by the
+ * previous lookup before falling back to a name comparison. Other paths are
+ * handed to the libyang XPath engine as usual. Not thread-safe.
+ */
+struct yang_dpath_step {
+	/* Node name (not NUL terminated), NULL for the parent node. */
+	const char *name;
+	uint8_t len;
+
+	/* Schema node matched by the last lookup. */
+	const struct lys_node *snode;
+};
+
+struct yang_dpath {
+	const char *xpath;
+
+	/* Set on first use. */
+	bool compiled;
+	bool fallback;
+	uint8_t num;
+	struct yang_dpath_step step[YANG_DPATH_MAXSTEPS];
+};
+
+#define YANG_DPATH_INIT(path) {.xpath = (path)}
+
+/*
+ * Find a libyang data node by a compiled data path.
+ *
+ * dnode
+ *    Base libyang data node to operate on.
+ *
+ * dpath
+ *    Compiled data path (relative or absolute).
+ *
+ * Returns:
+ *    The libyang data node if found, or NULL if not found.
+ */
+extern struct lyd_node *yang_dnode_dpath(const struct lyd_node *dnode,
+					 struct yang_dpath *dpath);
+
 /*
  * Check if a libyang data node exists.
  *
@@ -40,6 +40,8 @@
 #include "nexthop_group.h"
 #include "lib_errors.h"
 #include "srte.h"
+#include "zring.h"
+#include "libfrr.h"
 
 DEFINE_MTYPE_STATIC(LIB, ZCLIENT, "Zclient")
 DEFINE_MTYPE_STATIC(LIB, REDIST_INST, "Redistribution instance IDs")
@@ -79,6 +81,7 @@ struct zclient *zclient_new(struct thread_master *master,
 
 	zclient->receive_notify = opt->receive_notify;
 	zclient->synchronous = opt->synchronous;
+	zclient->shm_ring = opt->shm_ring;
 
 	return zclient;
 }
@@ -178,6 +181,10 @@ void zclient_stop(struct zclient *zclient)
 
 	/* Empty the write buffer. */
 	buffer_reset(zclient->wb);
+	zclient->batch_bytes = 0;
+
+	zring_free(zclient->ring);
+	zclient->ring = NULL;
 
 	/* Close socket. */
 	if (zclient->sock >= 0) {
@@ -284,16 +291,201 @@ static int zclient_flush_data(struct thread *thread)
 	return 0;
 }
 
+static size_t zclient_ring_put(void *arg, const void *p, size_t size)
+{
+	return zring_write(arg, p, size);
+}
+
+/* zebra made room in the ring */
+static int zclient_ring_flush(struct thread *thread)
+{
+	struct zclient *zclient = THREAD_ARG(thread);
+
+	zclient->t_write = NULL;
+	zring_ack(zclient->ring);
+
+	switch (buffer_flush_fn(zclient->wb, zclient_ring_put, zclient->ring)) {
+	case BUFFER_PENDING:
+		thread_add_read(zclient->master, zclient_ring_flush, zclient,
+				zring_fd(zclient->ring), &zclient->t_write);
+		break;
+	case BUFFER_ERROR:
+	case BUFFER_EMPTY:
+		break;
+	}
+	zring_notify(zclient->ring);
+
+	if (!zclient->t_write && zclient->zebra_buffer_write_ready)
+		(*zclient->zebra_buffer_write_ready)();
+	return 0;
+}
+
+static enum zclient_send_status zclient_ring_send(struct zclient *zclient)
+{
+	const uint8_t *data = STREAM_DATA(zclient->obuf);
+	size_t len = stream_get_endp(zclient->obuf), n = 0;
+
+	/* queue behind whatever did not fit earlier */
+	if (!zclient->t_write)
+		n = zring_write(zclient->ring, data, len);
+	if (n < len) {
+		buffer_put(zclient->wb, data + n, len - n);
+		thread_add_read(zclient->master, zclient_ring_flush, zclient,
+				zring_fd(zclient->ring), &zclient->t_write);
+	}
+
+	/* batches wake zebra up once, at the end */
+	if (!zclient->batch)
+		zring_notify(zclient->ring);
+
+	return zclient->t_write ? ZCLIENT_SEND_BUFFERED : ZCLIENT_SEND_SUCCESS;
+}
+
+/*
+ * Wait until everything queued for the ring is in it, for requests that
+ * read their response synchronously: zebra won't answer what it didn't
+ * get.  Fails if zebra goes away meanwhile.
+ */
+static int zclient_ring_drain(struct zclient *zclient)
+{
+	struct pollfd pfd[2] = {
+		{.fd = zring_fd(zclient->ring), .events = POLLIN},
+		{.fd = zclient->sock, .events = 0},
+	};
+
+	zring_notify(zclient->ring);
+
+	while (!buffer_empty(zclient->wb)) {
+		if (poll(pfd, array_size(pfd), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (pfd[1].revents & (POLLHUP | POLLERR | POLLNVAL))
+			return -1;
+		if (!(pfd[0].revents & POLLIN))
+			continue;
+
+		zring_ack(zclient->ring);
+		if (buffer_flush_fn(zclient->wb, zclient_ring_put,
+				    zclient->ring)
+		    == BUFFER_ERROR)
+			return -1;
+		zring_notify(zclient->ring);
+	}
+
+	if (zclient->t_write) {
+		THREAD_OFF(zclient->t_write);
+		if (zclient->zebra_buffer_write_ready)
+			(*zclient->zebra_buffer_write_ready)();
+	}
+	return 0;
+}
+
+/*
+ * Send a request whose response is read right away with
+ * zclient_read_sync_response().  Goes through the ring if there is one,
+ * zebra treats anything on the socket as an error then.
+ */
+static int zclient_send_sync(struct zclient *zclient, const char *what)
+{
+	int ret;
+
+	if (zclient->ring) {
+		if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE
+		    || zclient_ring_drain(zclient) < 0) {
+			flog_err(EC_LIB_ZAPI_SOCKET, "%s: can't send %s",
+				 __func__, what);
+			return -1;
+		}
+		return 0;
+	}
+
+	ret = writen(zclient->sock, STREAM_DATA(zclient->obuf),
+		     stream_get_endp(zclient->obuf));
+	if (ret <= 0) {
+		flog_err(EC_LIB_ZAPI_SOCKET, "%s: can't send %s: %s", __func__,
+			 what, ret ? safe_strerror(errno) : "socket closed");
+		close(zclient->sock);
+		zclient->sock = -1;
+		return -1;
+	}
+	return 0;
+}
+
 /*
  * Returns:
  * ZCLIENT_SEND_FAILED   - is a failure
  * ZCLIENT_SEND_SUCCESS  - means we sent data to zebra
  * ZCLIENT_SEND_BUFFERED - means we are buffering
  */
+static enum zclient_send_status zclient_batch_flush(struct zclient *zclient)
+{
+	zclient->batch_bytes = 0;
+
+	if (zclient->ring) {
+		zring_notify(zclient->ring);
+		return zclient->t_write ? ZCLIENT_SEND_BUFFERED
+					: ZCLIENT_SEND_SUCCESS;
+	}
+
+	/* already waiting for the socket, zclient_flush_data takes it */
+	if (zclient->t_write)
+		return ZCLIENT_SEND_BUFFERED;
+
+	switch (buffer_flush_all(zclient->wb, zclient->sock)) {
+	case BUFFER_ERROR:
+		flog_err(EC_LIB_ZAPI_SOCKET,
+			 "%s: buffer_flush_all failed to zclient fd %d, closing",
+			 __func__, zclient->sock);
+		return zclient_failed(zclient);
+	case BUFFER_EMPTY:
+		return ZCLIENT_SEND_SUCCESS;
+	case BUFFER_PENDING:
+		thread_add_write(zclient->master, zclient_flush_data, zclient,
+				 zclient->sock, &zclient->t_write);
+		return ZCLIENT_SEND_BUFFERED;
+	}
+
+	/* should not get here */
+	return ZCLIENT_SEND_SUCCESS;
+}
+
+void zclient_batch_start(struct zclient *zclient)
+{
+	zclient->batch++;
+}
+
+enum zclient_send_status zclient_batch_end(struct zclient *zclient)
+{
+	assert(zclient->batch > 0);
+
+	if (--zclient->batch)
+		return ZCLIENT_SEND_SUCCESS;
+	if (zclient->sock < 0)
+		return ZCLIENT_SEND_FAILURE;
+	return zclient_batch_flush(zclient);
+}
+
 enum zclient_send_status zclient_send_message(struct zclient *zclient)
 {
 	if (zclient->sock < 0)
 		return ZCLIENT_SEND_FAILURE;
+
+	if (zclient->ring)
+		return zclient_ring_send(zclient);
+
+	if (zclient->batch) {
+		buffer_put(zclient->wb, STREAM_DATA(zclient->obuf),
+			   stream_get_endp(zclient->obuf));
+		zclient->batch_bytes += stream_get_endp(zclient->obuf);
+
+		if (zclient->batch_bytes >= ZCLIENT_BATCH_MAX)
+			return zclient_batch_flush(zclient);
+		return zclient->t_write ? ZCLIENT_SEND_BUFFERED
+					: ZCLIENT_SEND_SUCCESS;
+	}
+
 	switch (buffer_write(zclient->wb, zclient->sock,
 			     STREAM_DATA(zclient->obuf),
 			     stream_get_endp(zclient->obuf))) {
@@ -387,6 +579,47 @@ static enum zclient_send_status zebra_message_send(struct zclient *zclient,
 	return zclient_send_message(zclient);
 }
 
+/*
+ * The ring's fds ride along with HELLO, which is the first message on a new
+ * connection; zebra switches to reading the ring right after it.  Anything
+ * that goes wrong before the fds are out (no memfd, zebra on a TCP socket)
+ * just leaves us on the socket.
+ */
+static enum zclient_send_status
+zclient_send_hello_ring(struct zclient *zclient)
+{
+	size_t len = stream_get_endp(zclient->obuf);
+	ssize_t nb = -1;
+
+	if (zclient->ring)
+		return zclient_send_message(zclient);
+
+	if (buffer_empty(zclient->wb))
+		zclient->ring = zring_new(ZRING_SIZE_DEFAULT);
+	if (zclient->ring)
+		nb = zring_send(zclient->sock, zclient->ring,
+				STREAM_DATA(zclient->obuf), len);
+
+	if (nb < 0) {
+		zring_free(zclient->ring);
+		zclient->ring = NULL;
+		return zclient_send_message(zclient);
+	}
+
+	if ((size_t)nb < len) {
+		/* the rest would have to go on the socket, after zebra
+		 * already switched to the ring; start over instead
+		 */
+		flog_err(EC_LIB_ZAPI_SOCKET, "%s: short HELLO write on fd %d",
+			 __func__, zclient->sock);
+		return zclient_failed(zclient);
+	}
+
+	if (zclient_debug)
+		zlog_debug("zclient %p using shared-memory ring", zclient);
+	return ZCLIENT_SEND_SUCCESS;
+}
+
 enum zclient_send_status zclient_send_hello(struct zclient *zclient)
 {
 	struct stream *s;
@@ -410,6 +643,9 @@ enum zclient_send_status zclient_send_hello(struct zclient *zclient)
 			stream_putc(s, 0);
 
 		stream_putw_at(s, 0, stream_get_endp(s));
+
+		if (zclient->shm_ring)
+			return zclient_send_hello_ring(zclient);
 		return zclient_send_message(zclient);
 	}
 
@@ -448,6 +684,8 @@ void zclient_send_reg_requests(struct zclient *zclient, vrf_id_t vrf_id)
 		zlog_debug("%s: send register messages for VRF %u", __func__,
 			   vrf_id);
 
+	zclient_batch_start(zclient);
+
 	/* We need router-id information. */
 	zclient_send_router_id_update(zclient, ZEBRA_ROUTER_ID_ADD, AFI_IP,
 				      vrf_id);
@@ -500,6 +738,8 @@ void zclient_send_reg_requests(struct zclient *zclient, vrf_id_t vrf_id)
 				ZEBRA_REDISTRIBUTE_DEFAULT_ADD, zclient, afi,
 				vrf_id);
 	}
+
+	zclient_batch_end(zclient);
 }
 
 /* Send unregister requests to zebra daemon for the information in a VRF. */
@@ -516,6 +756,8 @@ void zclient_send_dereg_requests(struct zclient *zclient, vrf_id_t vrf_id)
 		zlog_debug("%s: send deregister messages for VRF %u", __func__,
 			   vrf_id);
 
+	zclient_batch_start(zclient);
+
 	/* We need router-id information. */
 	zclient_send_router_id_update(zclient, ZEBRA_ROUTER_ID_DELETE, AFI_IP,
 				      vrf_id);
@@ -567,6 +809,8 @@ void zclient_send_dereg_requests(struct zclient *zclient, vrf_id_t vrf_id)
 				ZEBRA_REDISTRIBUTE_DEFAULT_DELETE, zclient, afi,
 				vrf_id);
 	}
+
+	zclient_batch_end(zclient);
 }
 
 enum zclient_send_status
@@ -664,6 +908,8 @@ int zclient_start(struct zclient *zclient)
 	/* Create read thread. */
 	zclient_event(ZCLIENT_READ, zclient);
 
+	frr_startup_phase("zebra connected");
+
 	zclient_send_hello(zclient);
 
 	zebra_message_send(zclient, ZEBRA_INTERFACE_ADD, VRF_DEFAULT);
@@ -2490,7 +2736,6 @@ static int zclient_read_sync_response(struct zclient *zclient,
  */
 int lm_label_manager_connect(struct zclient *zclient, int async)
 {
-	int ret;
 	struct stream *s;
 	uint8_t result;
 	uint16_t cmd = async ? ZEBRA_LABEL_MANAGER_CONNECT_ASYNC :
@@ -2517,21 +2762,11 @@ int lm_label_manager_connect(struct zclient *zclient, int async)
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = writen(zclient->sock, s->data, stream_get_endp(s));
-	if (ret < 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "Can't write to zclient sock");
-		close(zclient->sock);
-		zclient->sock = -1;
+	if (zclient_send_sync(zclient, "LM connect request") < 0)
 		return -1;
-	}
-	if (ret == 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "Zclient sock closed");
-		close(zclient->sock);
-		zclient->sock = -1;
-		return -1;
-	}
 	if (zclient_debug)
-		zlog_debug("LM connect request sent (%d bytes)", ret);
+		zlog_debug("LM connect request sent (%zu bytes)",
+			   stream_get_endp(s));
 
 	if (async)
 		return 0;
@@ -2613,6 +2848,43 @@ enum zclient_send_status zclient_send_get_label_chunk(struct zclient *zclient,
 	return zclient_send_message(zclient);
 }
 
+/*
+ * Asynchronous label chunk release
+ *
+ * @param zclient Zclient used to connect to label manager (zebra)
+ * @param start First label of chunk
+ * @param end Last label of chunk
+ * @result 0 on success, -1 otherwise
+ */
+enum zclient_send_status
+zclient_send_release_label_chunk(struct zclient *zclient, uint32_t start,
+				 uint32_t end)
+{
+	struct stream *s;
+
+	if (zclient_debug)
+		zlog_debug("Releasing Label Chunk %u - %u", start, end);
+
+	if (zclient->sock < 0)
+		return ZCLIENT_SEND_FAILURE;
+
+	s = zclient->obuf;
+	stream_reset(s);
+
+	zclient_create_header(s, ZEBRA_RELEASE_LABEL_CHUNK, VRF_DEFAULT);
+	/* proto */
+	stream_putc(s, zclient->redist_default);
+	/* instance */
+	stream_putw(s, zclient->instance);
+	stream_putl(s, start);
+	stream_putl(s, end);
+
+	/* Put length at the first point of the stream. */
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	return zclient_send_message(zclient);
+}
+
 /**
  * Function to request a label chunk in a syncronous way
  *
@@ -2629,7 +2901,6 @@ enum zclient_send_status zclient_send_get_label_chunk(struct zclient *zclient,
 int lm_get_label_chunk(struct zclient *zclient, uint8_t keep, uint32_t base,
 		       uint32_t chunk_size, uint32_t *start, uint32_t *end)
 {
-	int ret;
 	struct stream *s;
 	uint8_t response_keep;
 
@@ -2656,21 +2927,11 @@ int lm_get_label_chunk(struct zclient *zclient, uint8_t keep, uint32_t base,
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = writen(zclient->sock, s->data, stream_get_endp(s));
-	if (ret < 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "Can't write to zclient sock");
-		close(zclient->sock);
-		zclient->sock = -1;
+	if (zclient_send_sync(zclient, "label chunk request") < 0)
 		return -1;
-	}
-	if (ret == 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "Zclient sock closed");
-		close(zclient->sock);
-		zclient->sock = -1;
-		return -1;
-	}
 	if (zclient_debug)
-		zlog_debug("Label chunk request (%d bytes) sent", ret);
+		zlog_debug("Label chunk request (%zu bytes) sent",
+			   stream_get_endp(s));
 
 	/* read response */
 	if (zclient_read_sync_response(zclient, ZEBRA_GET_LABEL_CHUNK) != 0)
@@ -2747,7 +3008,6 @@ stream_failure:
 int lm_release_label_chunk(struct zclient *zclient, uint32_t start,
 			   uint32_t end)
 {
-	int ret;
 	struct stream *s;
 
 	if (zclient_debug)
@@ -2773,19 +3033,8 @@ int lm_release_label_chunk(struct zclient *zclient, uint32_t start,
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = writen(zclient->sock, s->data, stream_get_endp(s));
-	if (ret < 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "Can't write to zclient sock");
-		close(zclient->sock);
-		zclient->sock = -1;
-		return -1;
-	}
-	if (ret == 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "Zclient sock connection closed");
-		close(zclient->sock);
-		zclient->sock = -1;
+	if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE)
 		return -1;
-	}
 
 	return 0;
 }
@@ -2801,7 +3050,6 @@ int lm_release_label_chunk(struct zclient *zclient, uint32_t start,
  */
 int tm_table_manager_connect(struct zclient *zclient)
 {
-	int ret;
 	struct stream *s;
 	uint8_t result;
 
@@ -2824,8 +3072,7 @@ int tm_table_manager_connect(struct zclient *zclient)
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = zclient_send_message(zclient);
-	if (ret == ZCLIENT_SEND_FAILURE)
+	if (zclient_send_sync(zclient, "table manager connect request") < 0)
 		return -1;
 
 	if (zclient_debug)
@@ -2864,7 +3111,6 @@ stream_failure:
 int tm_get_table_chunk(struct zclient *zclient, uint32_t chunk_size,
 		       uint32_t *start, uint32_t *end)
 {
-	int ret;
 	struct stream *s;
 
 	if (zclient_debug)
@@ -2882,24 +3128,11 @@ int tm_get_table_chunk(struct zclient *zclient, uint32_t chunk_size,
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = writen(zclient->sock, s->data, stream_get_endp(s));
-	if (ret < 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET, "%s: can't write to zclient->sock",
-			 __func__);
-		close(zclient->sock);
-		zclient->sock = -1;
+	if (zclient_send_sync(zclient, "table chunk request") < 0)
 		return -1;
-	}
-	if (ret == 0) {
-		flog_err(EC_LIB_ZAPI_SOCKET,
-			 "%s: zclient->sock connection closed", __func__);
-		close(zclient->sock);
-		zclient->sock = -1;
-		return -1;
-	}
 	if (zclient_debug)
-		zlog_debug("%s: Table chunk request (%d bytes) sent", __func__,
-			   ret);
+		zlog_debug("%s: Table chunk request (%zu bytes) sent",
+			   __func__, stream_get_endp(s));
 
 	/* read response */
 	if (zclient_read_sync_response(zclient, ZEBRA_GET_TABLE_CHUNK) != 0)
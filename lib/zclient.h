@@ -306,6 +306,16 @@ struct zclient {
 	/* Thread to write buffered data to zebra. */
 	struct thread *t_write;
 
+	/* Batching state, see zclient_batch_start() */
+	unsigned int batch;
+	size_t batch_bytes;
+
+	/* Shared-memory ring to zebra, set up with the HELLO message if
+	 * shm_ring is enabled.  Replaces the socket for messages to zebra.
+	 */
+	bool shm_ring;
+	struct zring *ring;
+
 	/* Redistribute information. */
 	uint8_t redist_default; /* clients protocol */
 	unsigned short instance;
@@ -728,6 +738,7 @@ enum zebra_neigh_state { ZEBRA_NEIGH_INACTIVE = 0, ZEBRA_NEIGH_ACTIVE = 1 };
 struct zclient_options {
 	bool receive_notify;
 	bool synchronous;
+	bool shm_ring;
 };
 
 extern struct zclient_options zclient_options_default;
@@ -828,6 +839,23 @@ extern void zclient_redistribute_default(int command, struct zclient *,
  */
 extern enum zclient_send_status zclient_send_message(struct zclient *);
 
+/*
+ * Batch up messages to zebra.  Between zclient_batch_start() and
+ * zclient_batch_end(), zclient_send_message() only appends to the write
+ * buffer, and the accumulated messages are written out together with as
+ * few writev() calls as possible - when the batch ends, or whenever
+ * ZCLIENT_BATCH_MAX bytes have piled up.  Batches may be nested, only the
+ * outermost zclient_batch_end() flushes.
+ *
+ * Return values are as for zclient_send_message();  within a batch,
+ * ZCLIENT_SEND_BUFFERED is only returned when the socket to zebra is
+ * backed up.
+ */
+#define ZCLIENT_BATCH_MAX (256 * 1024)
+
+extern void zclient_batch_start(struct zclient *zclient);
+extern enum zclient_send_status zclient_batch_end(struct zclient *zclient);
+
 /* create header for command, length to be filled in by user later */
 extern void zclient_create_header(struct stream *, uint16_t, vrf_id_t);
 /*
@@ -903,6 +931,9 @@ extern size_t zebra_interface_link_params_write(struct stream *,
 extern enum zclient_send_status
 zclient_send_get_label_chunk(struct zclient *zclient, uint8_t keep,
 			     uint32_t chunk_size, uint32_t base);
+extern enum zclient_send_status
+zclient_send_release_label_chunk(struct zclient *zclient, uint32_t start,
+				 uint32_t end);
 
 extern int lm_label_manager_connect(struct zclient *zclient, int async);
 extern int lm_get_label_chunk(struct zclient *zclient, uint8_t keep,
@@ -38,6 +38,7 @@ DEFINE_MTYPE_STATIC(LOG, LOG_FD,        "log file target")
 DEFINE_MTYPE_STATIC(LOG, LOG_FD_NAME,   "log file name")
 DEFINE_MTYPE_STATIC(LOG, LOG_FD_ROTATE, "log file rotate helper")
 DEFINE_MTYPE_STATIC(LOG, LOG_SYSL,      "syslog target")
+DEFINE_MTYPE_STATIC(LOG, LOG_RING,      "log writer buffer")
 
 struct zlt_fd {
 	struct zlog_target zt;
@@ -47,9 +48,524 @@ struct zlt_fd {
 	char ts_subsec;
 	bool record_priority;
 
+	/* NULL for the fixed targets, these never go through the log writer
+	 * pthread
+	 */
+	struct zlog_cfg_file *zcf;
+
 	struct rcu_head_close head_close;
 };
 
+/* asynchronous log writer
+ *
+ * Each pthread that logs gets its own single-producer/single-consumer ring
+ * buffer.  zlog_fd() formats messages on the calling pthread like before,
+ * but instead of calling writev() there, the result is copied into the ring
+ * and a separate pthread collects everything and writes it out, batching
+ * as many records as it can into each writev().
+ *
+ * Records reference the zlog_cfg_file rather than the zlt_fd since the
+ * latter may be replaced and freed while records are still queued.  The
+ * writer looks up the currently active fd when writing.
+ *
+ * Messages from the same pthread stay in order, messages from distinct
+ * pthreads may be reordered slightly relative to each other.  Anything still
+ * queued when the process crashes is lost, but crash logging & the signal
+ * handler paths (logfn_sigsafe) never go through this.
+ */
+
+#define ZLOG_RING_SIZE	(64 * 1024)
+#define ZLOG_RING_MASK	(ZLOG_RING_SIZE - 1)
+#define ZLOG_REC_ALIGN	16
+#define ZLOG_REC_SPAN(len)                                                     \
+	(((len) + ZLOG_REC_ALIGN + ZLOG_REC_ALIGN - 1) & ~(ZLOG_REC_ALIGN - 1))
+
+/* zcf == NULL is padding to wrap around to the start of the buffer */
+struct zlog_rec {
+	uint32_t len;
+	uint32_t nmsgs;
+	struct zlog_cfg_file *zcf;
+};
+
+PREDECL_ATOMLIST(zlog_rings)
+struct zlog_ring {
+	struct zlog_rings_item item;
+
+	/* head is only written by the log writer, tail by the owning pthread */
+	_Atomic size_t head;
+	_Atomic size_t tail;
+
+	/* owning pthread has exited, free once empty */
+	atomic_bool dead;
+
+	_Atomic uint64_t dropped;
+	_Atomic uint64_t blocked;
+
+	struct rcu_head rcu_head;
+
+	uint8_t buf[ZLOG_RING_SIZE] __attribute__((aligned(ZLOG_REC_ALIGN)));
+};
+DECLARE_ATOMLIST(zlog_rings, struct zlog_ring, item)
+
+static struct zlog_rings_head zlog_rings;
+static pthread_key_t zlog_ring_key;
+static pthread_once_t zlog_ring_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t zlog_async_mtx = PTHREAD_MUTEX_INITIALIZER;
+/* writer waits on wake, producers & zlog_async_drain() wait on progress */
+static pthread_cond_t zlog_async_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t zlog_async_progress = PTHREAD_COND_INITIALIZER;
+static pthread_t zlog_async_thread;
+/* Requires: zlog_async_mtx */
+static bool zlog_async_running;
+static uint64_t zlog_async_passes;
+static unsigned int zlog_async_waiters;
+
+static atomic_bool zlog_async_active;
+static atomic_bool zlog_async_sleeping;
+static _Atomic uint32_t zlog_async_mode;
+
+/* only updated by the log writer */
+static _Atomic uint64_t zlog_async_msgs, zlog_async_bytes, zlog_async_writes;
+static _Atomic uint64_t zlog_async_errors;
+/* counters of rings that have been freed */
+static _Atomic uint64_t zlog_async_dropped, zlog_async_blocked;
+
+static void zlog_ring_exit(void *arg)
+{
+	struct zlog_ring *ring = arg;
+
+	atomic_store_explicit(&ring->dead, true, memory_order_release);
+}
+
+static void zlog_ring_key_init(void)
+{
+	pthread_key_create(&zlog_ring_key, zlog_ring_exit);
+}
+
+static struct zlog_ring *zlog_ring_get(void)
+{
+	struct zlog_ring *ring;
+
+	pthread_once(&zlog_ring_once, zlog_ring_key_init);
+
+	ring = pthread_getspecific(zlog_ring_key);
+	if (ring)
+		return ring;
+
+	ring = XCALLOC(MTYPE_LOG_RING, sizeof(*ring));
+	pthread_setspecific(zlog_ring_key, ring);
+	zlog_rings_add_head(&zlog_rings, ring);
+	return ring;
+}
+
+static bool zlog_ring_put(struct zlog_ring *ring, struct zlog_cfg_file *zcf,
+			  const struct iovec *iov, int iovcnt, size_t len,
+			  size_t nmsgs)
+{
+	size_t head, tail, idx, span, needed;
+	struct zlog_rec *rec;
+	uint8_t *pos;
+	int i;
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	idx = tail & ZLOG_RING_MASK;
+	span = ZLOG_REC_SPAN(len);
+	needed = span;
+	if (span > ZLOG_RING_SIZE - idx)
+		needed += ZLOG_RING_SIZE - idx;
+
+	if (ZLOG_RING_SIZE - (tail - head) < needed)
+		return false;
+
+	if (needed > span) {
+		rec = (struct zlog_rec *)&ring->buf[idx];
+		rec->zcf = NULL;
+		rec->len = ZLOG_RING_SIZE - idx - ZLOG_REC_ALIGN;
+		tail += ZLOG_RING_SIZE - idx;
+		idx = 0;
+	}
+
+	rec = (struct zlog_rec *)&ring->buf[idx];
+	rec->zcf = zcf;
+	rec->len = len;
+	rec->nmsgs = nmsgs;
+
+	pos = &ring->buf[idx + ZLOG_REC_ALIGN];
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+
+	atomic_store_explicit(&ring->tail, tail + span, memory_order_release);
+	return true;
+}
+
+static bool zlog_async_pending(void)
+{
+	struct zlog_ring *ring;
+
+	frr_each (zlog_rings, &zlog_rings, ring)
+		if (atomic_load_explicit(&ring->head, memory_order_relaxed)
+		    != atomic_load_explicit(&ring->tail, memory_order_acquire))
+			return true;
+	return false;
+}
+
+static void zlog_async_flush(struct zlog_cfg_file *zcf, struct iovec *iov,
+			     int iovcnt, size_t nmsgs)
+{
+	struct zlt_fd *zte;
+	ssize_t ret;
+	size_t len = 0;
+	int fd = -1;
+
+	frr_with_mutex(&zcf->cfg_mtx) {
+		zte = zcf->active;
+		if (zte)
+			fd = atomic_load_explicit(&zte->fd,
+						  memory_order_relaxed);
+	}
+
+	for (int i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+
+	/* the fd is closed through RCU, and we're in rcu_read_lock() here.
+	 * Can't log anything about errors, we'd end up writing to ourselves.
+	 */
+	ret = fd >= 0 ? writev(fd, iov, iovcnt) : -1;
+	if (ret < 0 || (size_t)ret != len)
+		atomic_fetch_add_explicit(&zlog_async_errors, 1,
+					  memory_order_relaxed);
+
+	atomic_fetch_add_explicit(&zlog_async_writes, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&zlog_async_msgs, nmsgs,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&zlog_async_bytes, len,
+				  memory_order_relaxed);
+}
+
+/* one pass over all rings, returns whether anything was written */
+static bool zlog_async_pass(void)
+{
+	struct zlog_ring *ring;
+	struct zlog_rec *rec;
+	struct zlog_cfg_file *zcf;
+	struct iovec iov[64];
+	size_t head, tail, nmsgs;
+	bool work = false;
+	int iovcnt;
+
+	frr_each_safe (zlog_rings, &zlog_rings, ring) {
+		head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+		if (head == tail) {
+			if (!atomic_load_explicit(&ring->dead,
+						  memory_order_acquire))
+				continue;
+			/* tail may have moved right before the exit */
+			if (head != atomic_load_explicit(&ring->tail,
+							 memory_order_acquire))
+				continue;
+
+			atomic_fetch_add_explicit(
+				&zlog_async_dropped,
+				atomic_load_explicit(&ring->dropped,
+						     memory_order_relaxed),
+				memory_order_relaxed);
+			atomic_fetch_add_explicit(
+				&zlog_async_blocked,
+				atomic_load_explicit(&ring->blocked,
+						     memory_order_relaxed),
+				memory_order_relaxed);
+			zlog_rings_del(&zlog_rings, ring);
+			rcu_free(MTYPE_LOG_RING, ring, rcu_head);
+			continue;
+		}
+
+		work = true;
+		zcf = NULL;
+		iovcnt = 0;
+		nmsgs = 0;
+
+		while (head != tail) {
+			rec = (struct zlog_rec *)&ring->buf[head
+							    & ZLOG_RING_MASK];
+			if (!rec->zcf) {
+				head += rec->len + ZLOG_REC_ALIGN;
+				continue;
+			}
+
+			if (iovcnt && (rec->zcf != zcf
+				       || iovcnt == (int)array_size(iov))) {
+				zlog_async_flush(zcf, iov, iovcnt, nmsgs);
+				iovcnt = 0;
+				nmsgs = 0;
+			}
+
+			zcf = rec->zcf;
+			iov[iovcnt].iov_base = (uint8_t *)rec + ZLOG_REC_ALIGN;
+			iov[iovcnt].iov_len = rec->len;
+			iovcnt++;
+			nmsgs += rec->nmsgs;
+			head += ZLOG_REC_SPAN(rec->len);
+		}
+
+		if (iovcnt)
+			zlog_async_flush(zcf, iov, iovcnt, nmsgs);
+
+		atomic_store_explicit(&ring->head, head, memory_order_release);
+	}
+	return work;
+}
+
+static void *zlog_async_run(void *arg)
+{
+	struct timespec deadline;
+	bool work;
+
+	rcu_thread_start(arg);
+
+	/* new pthreads start with rcu_read_lock() held */
+	while (true) {
+		work = zlog_async_pass();
+		rcu_read_unlock();
+
+		pthread_mutex_lock(&zlog_async_mtx);
+		zlog_async_passes++;
+		pthread_cond_broadcast(&zlog_async_progress);
+
+		if (!work) {
+			if (!zlog_async_running) {
+				pthread_mutex_unlock(&zlog_async_mtx);
+				break;
+			}
+
+			/* cf. zlog_async_wakeup() */
+			atomic_store_explicit(&zlog_async_sleeping, true,
+					      memory_order_seq_cst);
+			if (!zlog_async_waiters && !zlog_async_pending()) {
+				clock_gettime(CLOCK_REALTIME, &deadline);
+				deadline.tv_sec++;
+				pthread_cond_timedwait(&zlog_async_wake,
+						       &zlog_async_mtx,
+						       &deadline);
+			}
+			atomic_store_explicit(&zlog_async_sleeping, false,
+					      memory_order_relaxed);
+		}
+		pthread_mutex_unlock(&zlog_async_mtx);
+
+		rcu_read_lock();
+	}
+	return NULL;
+}
+
+static void zlog_async_wakeup(void)
+{
+	/* pairs with the writer setting sleeping before checking the rings */
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!atomic_load_explicit(&zlog_async_sleeping, memory_order_relaxed))
+		return;
+
+	frr_with_mutex(&zlog_async_mtx) {
+		pthread_cond_signal(&zlog_async_wake);
+	}
+}
+
+/* wait for the writer to make progress;  returns false if it's not running
+ * (anymore), in which case the caller should write things itself.
+ */
+static bool zlog_async_wait(uint64_t passes)
+{
+	struct timespec deadline;
+
+	frr_with_mutex(&zlog_async_mtx) {
+		pthread_cond_signal(&zlog_async_wake);
+
+		zlog_async_waiters++;
+		while (zlog_async_running && zlog_async_passes < passes) {
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_sec++;
+			pthread_cond_timedwait(&zlog_async_progress,
+					       &zlog_async_mtx, &deadline);
+		}
+		zlog_async_waiters--;
+		return zlog_async_running;
+	}
+	assert(0);
+}
+
+static uint64_t zlog_async_get_passes(void)
+{
+	frr_with_mutex(&zlog_async_mtx) {
+		return zlog_async_passes;
+	}
+	assert(0);
+}
+
+void zlog_async_drain(void)
+{
+	/* a pass that is already in progress may have missed our records,
+	 * the one after that will pick them up
+	 */
+	if (atomic_load_explicit(&zlog_async_active, memory_order_acquire))
+		zlog_async_wait(zlog_async_get_passes() + 2);
+}
+
+static void zlt_fd_writev(struct zlt_fd *zte, int fd, struct iovec *iov,
+			  int iovcnt, size_t nmsgs)
+{
+	struct zlog_ring *ring;
+	size_t len = 0;
+	bool blocked = false;
+
+	if (!zte->zcf
+	    || !atomic_load_explicit(&zlog_async_active, memory_order_acquire)) {
+		writev(fd, iov, iovcnt);
+		return;
+	}
+
+	for (int i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+
+	ring = zlog_ring_get();
+
+	/* doesn't fit, write it ourselves after anything that's queued */
+	if (ZLOG_REC_SPAN(len) > ZLOG_RING_SIZE / 2) {
+		while (atomic_load_explicit(&ring->head, memory_order_acquire)
+		       != atomic_load_explicit(&ring->tail,
+					       memory_order_relaxed))
+			if (!zlog_async_wait(zlog_async_get_passes() + 1))
+				break;
+		writev(fd, iov, iovcnt);
+		return;
+	}
+
+	while (!zlog_ring_put(ring, zte->zcf, iov, iovcnt, len, nmsgs)) {
+		if (atomic_load_explicit(&zlog_async_mode, memory_order_relaxed)
+		    == ZLOG_ASYNC_DROP) {
+			atomic_fetch_add_explicit(&ring->dropped, nmsgs,
+						  memory_order_relaxed);
+			return;
+		}
+
+		if (!blocked)
+			atomic_fetch_add_explicit(&ring->blocked, 1,
+						  memory_order_relaxed);
+		blocked = true;
+
+		if (!zlog_async_wait(zlog_async_get_passes() + 1)) {
+			writev(fd, iov, iovcnt);
+			return;
+		}
+	}
+
+	zlog_async_wakeup();
+}
+
+static void zlog_async_stop(void)
+{
+	frr_with_mutex(&zlog_async_mtx) {
+		if (!zlog_async_running)
+			return;
+		zlog_async_running = false;
+		pthread_cond_signal(&zlog_async_wake);
+	}
+
+	pthread_join(zlog_async_thread, NULL);
+
+	/* anything that was queued after the writer's final pass */
+	atomic_store_explicit(&zlog_async_active, false, memory_order_release);
+	rcu_read_lock();
+	zlog_async_pass();
+	rcu_read_unlock();
+}
+
+static void zlog_async_start(void)
+{
+	struct rcu_thread *rcu_thread;
+	sigset_t oldsigs, blocksigs;
+	int ret;
+
+	frr_with_mutex(&zlog_async_mtx) {
+		if (zlog_async_running)
+			return;
+
+		/* signals are handled on the main pthread */
+		sigfillset(&blocksigs);
+		pthread_sigmask(SIG_BLOCK, &blocksigs, &oldsigs);
+
+		rcu_thread = rcu_thread_prepare();
+		ret = pthread_create(&zlog_async_thread, NULL, zlog_async_run,
+				     rcu_thread);
+
+		pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+		if (ret) {
+			rcu_thread_unprepare(rcu_thread);
+			return;
+		}
+		zlog_async_running = true;
+	}
+
+#ifdef HAVE_PTHREAD_SETNAME_NP
+	pthread_setname_np(zlog_async_thread, "zlog_writer");
+#endif
+	atomic_store_explicit(&zlog_async_active, true, memory_order_release);
+}
+
+void zlog_async_set(enum zlog_async_mode mode)
+{
+	atomic_store_explicit(&zlog_async_mode, mode, memory_order_relaxed);
+
+	if (mode == ZLOG_ASYNC_OFF)
+		zlog_async_stop();
+	else
+		zlog_async_start();
+}
+
+enum zlog_async_mode zlog_async_get(void)
+{
+	return atomic_load_explicit(&zlog_async_mode, memory_order_relaxed);
+}
+
+void zlog_async_stats(struct zlog_async_stats *st)
+{
+	struct zlog_ring *ring;
+
+	memset(st, 0, sizeof(*st));
+
+	st->msgs = atomic_load_explicit(&zlog_async_msgs, memory_order_relaxed);
+	st->bytes = atomic_load_explicit(&zlog_async_bytes,
+					 memory_order_relaxed);
+	st->writes = atomic_load_explicit(&zlog_async_writes,
+					  memory_order_relaxed);
+	st->errors = atomic_load_explicit(&zlog_async_errors,
+					  memory_order_relaxed);
+	st->dropped = atomic_load_explicit(&zlog_async_dropped,
+					   memory_order_relaxed);
+	st->blocked = atomic_load_explicit(&zlog_async_blocked,
+					   memory_order_relaxed);
+
+	rcu_read_lock();
+	frr_each (zlog_rings, &zlog_rings, ring) {
+		st->dropped += atomic_load_explicit(&ring->dropped,
+						    memory_order_relaxed);
+		st->blocked += atomic_load_explicit(&ring->blocked,
+						    memory_order_relaxed);
+		st->queued += atomic_load_explicit(&ring->tail,
+						   memory_order_relaxed)
+			      - atomic_load_explicit(&ring->head,
+						     memory_order_relaxed);
+		st->buffers++;
+	}
+	rcu_read_unlock();
+}
+
 static const char * const prionames[] = {
 	[LOG_EMERG] =	"emergencies: ",
 	[LOG_ALERT] =	"alerts: ",
@@ -71,6 +587,7 @@ void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[], size_t nmsgs)
 	/* "\nYYYY-MM-DD HH:MM:SS.NNNNNNNNN+ZZ:ZZ " = 37 chars */
 #define TS_LEN 40
 	char ts_buf[TS_LEN * nmsgs], *ts_pos = ts_buf;
+	size_t batch = 0;
 
 	fd = atomic_load_explicit(&zte->fd, memory_order_relaxed);
 
@@ -108,6 +625,7 @@ void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[], size_t nmsgs)
 		iov[iovpos].iov_len = textlen;
 
 		iovpos++;
+		batch++;
 
 		if (ts_buf + sizeof(ts_buf) - ts_pos < TS_LEN
 		    || i + 1 == nmsgs
@@ -117,9 +635,10 @@ void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[], size_t nmsgs)
 
 			iovpos++;
 
-			writev(fd, iov, iovpos);
+			zlt_fd_writev(zte, fd, iov, iovpos, batch);
 
 			iovpos = 0;
+			batch = 0;
 			ts_pos = ts_buf;
 		}
 	}
@@ -174,6 +693,8 @@ static void zlog_file_target_free(struct zlt_fd *zlt)
 
 void zlog_file_fini(struct zlog_cfg_file *zcf)
 {
+	zlog_async_drain();
+
 	if (zcf->active) {
 		struct zlt_fd *ztf;
 		struct zlog_target *zt;
@@ -220,6 +741,8 @@ static bool zlog_file_cycle(struct zlog_cfg_file *zcf)
 		zlt->record_priority = zcf->record_priority;
 		zlt->ts_subsec = zcf->ts_subsec;
 
+		zlt->zcf = zcf;
+
 		zlt->zt.prio_min = zcf->prio_min;
 		zlt->zt.logfn = zcf->zlog_wrap ? zcf->zlog_wrap : zlog_fd;
 		zlt->zt.logfn_sigsafe = zlog_fd_sigsafe;
@@ -236,6 +759,9 @@ static bool zlog_file_cycle(struct zlog_cfg_file *zcf)
 
 void zlog_file_set_other(struct zlog_cfg_file *zcf)
 {
+	/* queued messages go to whatever target is active when written */
+	zlog_async_drain();
+
 	frr_with_mutex(&zcf->cfg_mtx) {
 		zlog_file_cycle(zcf);
 	}
@@ -243,6 +769,8 @@ void zlog_file_set_other(struct zlog_cfg_file *zcf)
 
 bool zlog_file_set_filename(struct zlog_cfg_file *zcf, const char *filename)
 {
+	zlog_async_drain();
+
 	frr_with_mutex(&zcf->cfg_mtx) {
 		XFREE(MTYPE_LOG_FD_NAME, zcf->filename);
 		zcf->filename = XSTRDUP(MTYPE_LOG_FD_NAME, filename);
@@ -255,6 +783,8 @@ bool zlog_file_set_filename(struct zlog_cfg_file *zcf, const char *filename)
 
 bool zlog_file_set_fd(struct zlog_cfg_file *zcf, int fd)
 {
+	zlog_async_drain();
+
 	frr_with_mutex(&zcf->cfg_mtx) {
 		if (zcf->fd == fd)
 			return true;
@@ -379,6 +909,7 @@ static int zlt_init(const char *progname, const char *protoname,
 
 static int zlt_fini(void)
 {
+	zlog_async_stop();
 	closelog();
 	return 0;
 }
@@ -58,6 +58,29 @@ extern bool zlog_file_rotate(struct zlog_cfg_file *zcf);
 extern void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[],
 		    size_t nmsgs);
 
+/* file & stdout targets can be written from a separate pthread; when the
+ * per-pthread buffer is full, ZLOG_ASYNC_BLOCK waits for the log writer
+ * while ZLOG_ASYNC_DROP discards (and counts) the messages.
+ */
+enum zlog_async_mode {
+	ZLOG_ASYNC_OFF = 0,
+	ZLOG_ASYNC_BLOCK,
+	ZLOG_ASYNC_DROP,
+};
+
+struct zlog_async_stats {
+	uint64_t msgs, bytes, writes, errors;
+	uint64_t dropped, blocked;
+	/* bytes currently queued, and number of per-pthread buffers */
+	size_t queued, buffers;
+};
+
+extern void zlog_async_set(enum zlog_async_mode mode);
+extern enum zlog_async_mode zlog_async_get(void);
+extern void zlog_async_stats(struct zlog_async_stats *st);
+/* wait until everything queued so far has been written */
+extern void zlog_async_drain(void);
+
 /* syslog is always limited to one target */
 
 extern void zlog_syslog_set_facility(int facility);
@@ -0,0 +1,382 @@
+/*
+ * ZAPI shared-memory ring
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "zring.h"
+#include "memory.h"
+#include "network.h"
+#include "frratomic.h"
+#include "lib_errors.h"
+
+#ifdef HAVE_ZRING
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#endif
+
+DEFINE_MTYPE_STATIC(LIB, ZRING, "ZAPI shared-memory ring")
+
+#define ZRING_MAGIC 0x5a52494eU
+
+enum zring_fd_index {
+	ZRING_FD_MEM = 0,
+	ZRING_FD_DATA,
+	ZRING_FD_SPACE,
+};
+
+/* Layout of the shared area.  head and the producer's sleep flag are only
+ * written by the producer, tail and the consumer's sleep flag (mostly) by
+ * the consumer; keep them on separate cache lines.
+ */
+struct zring_shm {
+	uint32_t magic;
+	uint32_t size;
+
+	_Atomic uint32_t head __attribute__((aligned(64)));
+	/* producer is waiting for space */
+	_Atomic uint32_t wsleep;
+
+	_Atomic uint32_t tail __attribute__((aligned(64)));
+	/* consumer is waiting for data */
+	_Atomic uint32_t rsleep;
+
+	uint8_t data[] __attribute__((aligned(64)));
+};
+
+struct zring {
+	struct zring_shm *shm;
+	size_t maplen;
+
+	/* trusted copies; the peer can scribble over the shared ones */
+	uint32_t size;
+	uint32_t pos;
+
+	bool producer;
+	int fds[ZRING_NFDS];
+};
+
+static void zring_kick(int fd)
+{
+	uint64_t one = 1;
+
+	/* EAGAIN means the counter is already non-zero, good enough */
+	if (write(fd, &one, sizeof(one)) < 0 && !ERRNO_IO_RETRY(errno))
+		flog_err(EC_LIB_SYSTEM_CALL, "%s: eventfd write failed: %s",
+			 __func__, safe_strerror(errno));
+}
+
+int zring_fd(struct zring *ring)
+{
+	return ring->fds[ring->producer ? ZRING_FD_SPACE : ZRING_FD_DATA];
+}
+
+void zring_ack(struct zring *ring)
+{
+	uint64_t cnt;
+
+	if (read(zring_fd(ring), &cnt, sizeof(cnt)) < 0
+	    && !ERRNO_IO_RETRY(errno))
+		flog_err(EC_LIB_SYSTEM_CALL, "%s: eventfd read failed: %s",
+			 __func__, safe_strerror(errno));
+}
+
+void zring_free(struct zring *ring)
+{
+	if (!ring)
+		return;
+
+#ifdef HAVE_ZRING
+	if (ring->shm)
+		munmap(ring->shm, ring->maplen);
+#endif
+	for (int i = 0; i < ZRING_NFDS; i++)
+		if (ring->fds[i] >= 0)
+			close(ring->fds[i]);
+	XFREE(MTYPE_ZRING, ring);
+}
+
+static struct zring *zring_alloc(bool producer)
+{
+	struct zring *ring = XCALLOC(MTYPE_ZRING, sizeof(*ring));
+
+	ring->producer = producer;
+	for (int i = 0; i < ZRING_NFDS; i++)
+		ring->fds[i] = -1;
+	return ring;
+}
+
+#ifdef HAVE_ZRING
+
+struct zring *zring_new(uint32_t size)
+{
+	struct zring *ring;
+	int fd;
+
+	assert(size && !(size & (size - 1)));
+
+	ring = zring_alloc(true);
+	ring->size = size;
+	ring->maplen = sizeof(struct zring_shm) + size;
+
+	fd = memfd_create("zapi-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	ring->fds[ZRING_FD_MEM] = fd;
+	if (fd < 0 || ftruncate(fd, ring->maplen) < 0
+	    || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+		       < 0)
+		goto fail;
+
+	ring->shm = mmap(NULL, ring->maplen, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, fd, 0);
+	if (ring->shm == MAP_FAILED) {
+		ring->shm = NULL;
+		goto fail;
+	}
+
+	ring->fds[ZRING_FD_DATA] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	ring->fds[ZRING_FD_SPACE] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (ring->fds[ZRING_FD_DATA] < 0 || ring->fds[ZRING_FD_SPACE] < 0)
+		goto fail;
+
+	ring->shm->magic = ZRING_MAGIC;
+	ring->shm->size = size;
+	return ring;
+
+fail:
+	flog_err(EC_LIB_SYSTEM_CALL, "%s: cannot set up ring: %s", __func__,
+		 safe_strerror(errno));
+	zring_free(ring);
+	return NULL;
+}
+
+struct zring *zring_attach(int fds[ZRING_NFDS])
+{
+	struct zring *ring;
+	struct stat st;
+	int seals;
+
+	ring = zring_alloc(false);
+	for (int i = 0; i < ZRING_NFDS; i++) {
+		ring->fds[i] = fds[i];
+		fds[i] = -1;
+		if (ring->fds[i] < 0)
+			goto fail;
+	}
+
+	/* the producer must not be able to truncate it under our feet */
+	seals = fcntl(ring->fds[ZRING_FD_MEM], F_GET_SEALS);
+	if (seals < 0 || !(seals & F_SEAL_SHRINK)
+	    || fstat(ring->fds[ZRING_FD_MEM], &st) < 0
+	    || (size_t)st.st_size <= sizeof(struct zring_shm))
+		goto fail;
+
+	ring->maplen = st.st_size;
+	ring->size = ring->maplen - sizeof(struct zring_shm);
+	if (ring->size & (ring->size - 1))
+		goto fail;
+
+	ring->shm = mmap(NULL, ring->maplen, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, ring->fds[ZRING_FD_MEM], 0);
+	if (ring->shm == MAP_FAILED) {
+		ring->shm = NULL;
+		goto fail;
+	}
+	if (ring->shm->magic != ZRING_MAGIC || ring->shm->size != ring->size)
+		goto fail;
+
+	set_nonblocking(ring->fds[ZRING_FD_DATA]);
+	set_nonblocking(ring->fds[ZRING_FD_SPACE]);
+	ring->pos = atomic_load_explicit(&ring->shm->tail,
+					 memory_order_acquire);
+	return ring;
+
+fail:
+	flog_err(EC_LIB_DEVELOPMENT, "%s: invalid ring from peer", __func__);
+	zring_free(ring);
+	return NULL;
+}
+
+#else /* !HAVE_ZRING */
+
+struct zring *zring_new(uint32_t size)
+{
+	return NULL;
+}
+
+struct zring *zring_attach(int fds[ZRING_NFDS])
+{
+	for (int i = 0; i < ZRING_NFDS; i++)
+		if (fds[i] >= 0) {
+			close(fds[i]);
+			fds[i] = -1;
+		}
+	return NULL;
+}
+
+#endif /* !HAVE_ZRING */
+
+/*
+ * The sleep flags follow the usual pattern: the waiting side sets its flag,
+ * then looks at the other side's index again; the other side publishes its
+ * index, then checks the flag.  With both in seq_cst order, at least one of
+ * them sees the other's store, so no wakeup is lost.
+ */
+size_t zring_write(struct zring *ring, const void *p, size_t len)
+{
+	struct zring_shm *shm = ring->shm;
+	uint32_t tail, room, off, first;
+
+	tail = atomic_load_explicit(&shm->tail, memory_order_acquire);
+	room = ring->size - (ring->pos - tail);
+	if (room > ring->size)
+		room = 0;
+
+	if (len > room) {
+		atomic_store_explicit(&shm->wsleep, 1, memory_order_seq_cst);
+		tail = atomic_load_explicit(&shm->tail, memory_order_seq_cst);
+		room = ring->size - (ring->pos - tail);
+		if (room > ring->size)
+			room = 0;
+	}
+	if (len > room)
+		len = room;
+	if (!len)
+		return 0;
+
+	off = ring->pos & (ring->size - 1);
+	first = MIN(len, ring->size - off);
+	memcpy(shm->data + off, p, first);
+	memcpy(shm->data, (const uint8_t *)p + first, len - first);
+
+	ring->pos += len;
+	atomic_store_explicit(&shm->head, ring->pos, memory_order_seq_cst);
+	return len;
+}
+
+void zring_notify(struct zring *ring)
+{
+	if (atomic_load_explicit(&ring->shm->rsleep, memory_order_seq_cst)
+	    && atomic_exchange_explicit(&ring->shm->rsleep, 0,
+					memory_order_seq_cst))
+		zring_kick(ring->fds[ZRING_FD_DATA]);
+}
+
+ssize_t zring_read(struct zring *ring, void *p, size_t len)
+{
+	struct zring_shm *shm = ring->shm;
+	uint32_t head, avail, off, first;
+
+	head = atomic_load_explicit(&shm->head, memory_order_acquire);
+	avail = head - ring->pos;
+	if (!avail) {
+		atomic_store_explicit(&shm->rsleep, 1, memory_order_seq_cst);
+		head = atomic_load_explicit(&shm->head, memory_order_seq_cst);
+		avail = head - ring->pos;
+		if (!avail)
+			return -2;
+	}
+	if (avail > ring->size)
+		return -1;
+
+	if (len > avail)
+		len = avail;
+
+	off = ring->pos & (ring->size - 1);
+	first = MIN(len, ring->size - off);
+	memcpy(p, shm->data + off, first);
+	memcpy((uint8_t *)p + first, shm->data, len - first);
+
+	ring->pos += len;
+	atomic_store_explicit(&shm->tail, ring->pos, memory_order_seq_cst);
+
+	if (atomic_load_explicit(&shm->wsleep, memory_order_seq_cst)
+	    && atomic_exchange_explicit(&shm->wsleep, 0, memory_order_seq_cst))
+		zring_kick(ring->fds[ZRING_FD_SPACE]);
+	return len;
+}
+
+ssize_t zring_send(int sock, struct zring *ring, const void *p, size_t len)
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * ZRING_NFDS)];
+		struct cmsghdr align;
+	} cmsgbuf;
+	struct iovec iov = {.iov_base = (void *)p, .iov_len = len};
+	struct msghdr msg = {};
+	struct cmsghdr *cmsg;
+
+	memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * ZRING_NFDS);
+	memcpy(CMSG_DATA(cmsg), ring->fds, sizeof(int) * ZRING_NFDS);
+
+	return sendmsg(sock, &msg, 0);
+}
+
+ssize_t zring_recv(int sock, void *p, size_t len, int fds[ZRING_NFDS])
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * ZRING_NFDS)];
+		struct cmsghdr align;
+	} cmsgbuf;
+	struct iovec iov = {.iov_base = p, .iov_len = len};
+	struct msghdr msg = {};
+	struct cmsghdr *cmsg;
+	ssize_t nb;
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+#ifdef MSG_CMSG_CLOEXEC
+	nb = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+#else
+	nb = recvmsg(sock, &msg, 0);
+#endif
+	if (nb < 0)
+		return ERRNO_IO_RETRY(errno) ? -2 : -1;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		int rfds[ZRING_NFDS];
+		size_t n;
+
+		if (cmsg->cmsg_level != SOL_SOCKET
+		    || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		n = MIN((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int),
+			(size_t)ZRING_NFDS);
+		memcpy(rfds, CMSG_DATA(cmsg), n * sizeof(int));
+		for (size_t i = 0; i < n; i++) {
+			if (n == ZRING_NFDS && fds[0] < 0)
+				continue;
+			close(rfds[i]);
+			rfds[i] = -1;
+		}
+		if (rfds[0] >= 0)
+			memcpy(fds, rfds, sizeof(rfds));
+	}
+	return nb;
+}
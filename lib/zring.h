@@ -0,0 +1,93 @@
+/*
+ * ZAPI shared-memory ring
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_ZRING_H
+#define _FRR_ZRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A zring is a single-producer, single-consumer byte ring in a memfd shared
+ * between a zclient (producer) and zebra (consumer).  It carries the same
+ * byte stream the unix socket would, so ZAPI framing is unchanged; the
+ * socket stays up for the other direction and to detect the peer going away.
+ *
+ * The ring is handed to zebra as file descriptors attached to the HELLO
+ * message, see zring_send() / zring_recv().  Wakeups go through eventfds and
+ * are only signalled when the other side is actually waiting, so a busy
+ * producer and consumer exchange no syscalls at all.
+ */
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_EVENTFD)
+#define HAVE_ZRING 1
+#endif
+
+/* memfd, data eventfd (wakes the consumer), space eventfd (wakes the
+ * producer), in that order on the wire
+ */
+#define ZRING_NFDS 3
+
+#define ZRING_SIZE_DEFAULT (1U << 22)
+
+struct zring;
+
+/* Producer: create a ring of the given size (a power of 2).  Returns NULL
+ * if shared memory rings are not available on this system.
+ */
+extern struct zring *zring_new(uint32_t size);
+
+/* Consumer: map a ring from file descriptors received with zring_recv().
+ * Takes ownership of the fds in any case; everything in the shared area
+ * is validated since it is under control of the peer.
+ */
+extern struct zring *zring_attach(int fds[ZRING_NFDS]);
+
+extern void zring_free(struct zring *ring);
+
+/* fd to poll for readability: new data for the consumer, free space for
+ * the producer.  Call zring_ack() when it fires.
+ */
+extern int zring_fd(struct zring *ring);
+extern void zring_ack(struct zring *ring);
+
+/* Copy as much as fits, returns the number of bytes written.  Writing less
+ * than len arms the space wakeup.  Data becomes visible to the consumer
+ * right away, but it is only woken up by zring_notify().
+ */
+extern size_t zring_write(struct zring *ring, const void *p, size_t len);
+extern void zring_notify(struct zring *ring);
+
+/* Same convention as stream_read_try(): bytes read, -2 if the ring is empty
+ * (which arms the data wakeup) or -1 if the producer corrupted it.
+ */
+extern ssize_t zring_read(struct zring *ring, void *p, size_t len);
+
+/* Send data over a unix socket with the ring's fds attached, and receive
+ * it on the other end.  zring_recv() leaves fds alone if none were sent and
+ * closes any it cannot fit.
+ */
+extern ssize_t zring_send(int sock, struct zring *ring, const void *p,
+			  size_t len);
+extern ssize_t zring_recv(int sock, void *p, size_t len,
+			  int fds[ZRING_NFDS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_ZRING_H */
@@ -19,43 +19,172 @@
 #include <linux/netfilter/nfnetlink_log.h>
 
 #include "thread.h"
+#include "memory.h"
+#include "jhash.h"
+#include "typesafe.h"
 #include "nhrpd.h"
 #include "netlink.h"
 #include "znl.h"
 
+DEFINE_MTYPE_STATIC(NHRPD, NHRP_NEIGH_UPDATE, "NHRP neighbor update")
+
+/* Room for one neighbor update: header, ndmsg and two IPv6 attributes */
+#define NETLINK_NEIGH_MSG_SIZE 128
+
 int netlink_req_fd = -1;
 int netlink_nflog_group;
 static int netlink_log_fd = -1;
 static struct thread *netlink_log_thread;
 static int netlink_listen_fd = -1;
 
+/*
+ * Neighbor updates are queued and sent to the kernel in batches from an
+ * event, on a socket of their own so that the errors the kernel reports
+ * do not get in the way of the synchronous requests on netlink_req_fd.
+ * Only the last update queued for a given neighbor is sent.
+ */
+PREDECL_HASH(netlink_neighs)
+
+struct netlink_neigh {
+	struct netlink_neighs_item item;
+
+	ifindex_t ifindex;
+	union sockunion proto;
+	/* AF_UNSPEC to delete the neighbor */
+	union sockunion nbma;
+};
+
+static int netlink_neigh_cmp(const struct netlink_neigh *a,
+			     const struct netlink_neigh *b)
+{
+	if (a->ifindex != b->ifindex)
+		return a->ifindex < b->ifindex ? -1 : 1;
+	return sockunion_cmp(&a->proto, &b->proto);
+}
+
+static uint32_t netlink_neigh_hash(const struct netlink_neigh *n)
+{
+	return jhash_1word(n->ifindex, sockunion_hash(&n->proto));
+}
+
+DECLARE_HASH(netlink_neighs, struct netlink_neigh, item, netlink_neigh_cmp,
+	     netlink_neigh_hash)
+
+static struct netlink_neighs_head netlink_neigh_queue;
+static struct thread *netlink_neigh_thread;
+static struct thread *netlink_neigh_recv_thread;
+static int netlink_neigh_fd = -1;
+
 typedef void (*netlink_dispatch_f)(struct nlmsghdr *msg, struct zbuf *zb);
 
-void netlink_update_binding(struct interface *ifp, union sockunion *proto,
-			    union sockunion *nbma)
+static void netlink_neigh_push(struct zbuf *zb, struct netlink_neigh *neigh)
 {
 	struct nlmsghdr *n;
 	struct ndmsg *ndm;
-	struct zbuf *zb = zbuf_alloc(512);
+	bool add = sockunion_family(&neigh->nbma) != AF_UNSPEC;
 
-	n = znl_nlmsg_push(zb, nbma ? RTM_NEWNEIGH : RTM_DELNEIGH,
+	n = znl_nlmsg_push(zb, add ? RTM_NEWNEIGH : RTM_DELNEIGH,
 			   NLM_F_REQUEST | NLM_F_REPLACE | NLM_F_CREATE);
 	ndm = znl_push(zb, sizeof(*ndm));
 	*ndm = (struct ndmsg){
-		.ndm_family = sockunion_family(proto),
-		.ndm_ifindex = ifp->ifindex,
+		.ndm_family = sockunion_family(&neigh->proto),
+		.ndm_ifindex = neigh->ifindex,
 		.ndm_type = RTN_UNICAST,
-		.ndm_state = nbma ? NUD_REACHABLE : NUD_FAILED,
+		.ndm_state = add ? NUD_REACHABLE : NUD_FAILED,
 	};
-	znl_rta_push(zb, NDA_DST, sockunion_get_addr(proto),
-		     family2addrsize(sockunion_family(proto)));
-	if (nbma)
-		znl_rta_push(zb, NDA_LLADDR, sockunion_get_addr(nbma),
-			     family2addrsize(sockunion_family(nbma)));
+	znl_rta_push(zb, NDA_DST, sockunion_get_addr(&neigh->proto),
+		     family2addrsize(sockunion_family(&neigh->proto)));
+	if (add)
+		znl_rta_push(zb, NDA_LLADDR, sockunion_get_addr(&neigh->nbma),
+			     family2addrsize(sockunion_family(&neigh->nbma)));
 	znl_nlmsg_complete(zb, n);
-	zbuf_send(zb, netlink_req_fd);
-	zbuf_recv(zb, netlink_req_fd);
+}
+
+static void netlink_neigh_send(struct zbuf *zb)
+{
+	if (zbuf_send(zb, netlink_neigh_fd) < 0) {
+		debugf(NHRP_DEBUG_KERNEL,
+		       "Netlink: failed to send neighbor updates: %s",
+		       safe_strerror(errno));
+		zbuf_reset(zb);
+	}
+}
+
+static int netlink_neigh_flush(struct thread *t)
+{
+	struct netlink_neigh *neigh;
+	struct zbuf *zb = zbuf_alloc(ZNL_BUFFER_SIZE);
+	unsigned int count = 0;
+
+	while ((neigh = netlink_neighs_pop(&netlink_neigh_queue))) {
+		if (zbuf_tailroom(zb) < NETLINK_NEIGH_MSG_SIZE)
+			netlink_neigh_send(zb);
+		netlink_neigh_push(zb, neigh);
+		XFREE(MTYPE_NHRP_NEIGH_UPDATE, neigh);
+		count++;
+	}
+	if (zbuf_used(zb))
+		netlink_neigh_send(zb);
 	zbuf_free(zb);
+
+	debugf(NHRP_DEBUG_KERNEL, "Netlink: sent %u neighbor updates", count);
+
+	return 0;
+}
+
+/* Errors for the neighbor updates, the kernel does not ack successes */
+static int netlink_neigh_recv(struct thread *t)
+{
+	uint8_t buf[ZNL_BUFFER_SIZE];
+	int fd = THREAD_FD(t);
+	struct zbuf payload, zb;
+	struct nlmsghdr *n;
+	struct nlmsgerr *err;
+
+	zbuf_init(&zb, buf, sizeof(buf), 0);
+	while (zbuf_recv(&zb, fd) > 0) {
+		while ((n = znl_nlmsg_pull(&zb, &payload)) != NULL) {
+			if (n->nlmsg_type != NLMSG_ERROR)
+				continue;
+			err = znl_pull(&payload, sizeof(*err));
+			if (err && err->error)
+				debugf(NHRP_DEBUG_KERNEL,
+				       "Netlink: neighbor update failed: %s",
+				       safe_strerror(-err->error));
+		}
+	}
+
+	thread_add_read(master, netlink_neigh_recv, 0, fd,
+			&netlink_neigh_recv_thread);
+
+	return 0;
+}
+
+void netlink_update_binding(struct interface *ifp, union sockunion *proto,
+			    union sockunion *nbma)
+{
+	struct netlink_neigh ref, *neigh;
+
+	if (netlink_neigh_fd < 0)
+		return;
+
+	ref.ifindex = ifp->ifindex;
+	ref.proto = *proto;
+	neigh = netlink_neighs_find(&netlink_neigh_queue, &ref);
+	if (!neigh) {
+		neigh = XCALLOC(MTYPE_NHRP_NEIGH_UPDATE, sizeof(*neigh));
+		neigh->ifindex = ifp->ifindex;
+		neigh->proto = *proto;
+		netlink_neighs_add(&netlink_neigh_queue, neigh);
+	}
+
+	if (nbma)
+		neigh->nbma = *nbma;
+	else
+		memset(&neigh->nbma, 0, sizeof(neigh->nbma));
+
+	thread_add_event(master, netlink_neigh_flush, NULL, 0,
+			 &netlink_neigh_thread);
 }
 
 static void netlink_neigh_msg(struct nlmsghdr *msg, struct zbuf *zb)
@@ -140,6 +269,7 @@ static int netlink_route_recv(struct thread *t)
 	struct nlmsghdr *n;
 
 	zbuf_init(&zb, buf, sizeof(buf), 0);
+	nhrp_zebra_batch_start();
 	while (zbuf_recv(&zb, fd) > 0) {
 		while ((n = znl_nlmsg_pull(&zb, &payload)) != NULL) {
 			debugf(NHRP_DEBUG_KERNEL,
@@ -154,6 +284,7 @@ static int netlink_route_recv(struct thread *t)
 			}
 		}
 	}
+	nhrp_zebra_batch_end();
 
 	thread_add_read(master, netlink_route_recv, 0, fd, NULL);
 
@@ -279,6 +410,13 @@ void netlink_init(void)
 	if (netlink_req_fd < 0)
 		return;
 
+	netlink_neighs_init(&netlink_neigh_queue);
+	netlink_neigh_fd = znl_open(NETLINK_ROUTE, 0);
+	if (netlink_neigh_fd < 0)
+		return;
+	thread_add_read(master, netlink_neigh_recv, 0, netlink_neigh_fd,
+			&netlink_neigh_recv_thread);
+
 	netlink_listen_fd = znl_open(NETLINK_ROUTE, RTMGRP_NEIGH);
 	if (netlink_listen_fd < 0)
 		return;
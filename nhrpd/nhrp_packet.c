@@ -329,7 +329,12 @@ static int nhrp_packet_recvraw(struct thread *t)
 	if (!p)
 		goto err;
 
+	/* A registration or resolution may update many cache entries and
+	 * their routes, send those to zebra together.
+	 */
+	nhrp_zebra_batch_start();
 	nhrp_peer_recv(p, zb);
+	nhrp_zebra_batch_end();
 	nhrp_peer_unref(p);
 	return 0;
 
@@ -335,6 +335,20 @@ static void nhrp_zebra_connected(struct zclient *zclient)
 				ZEBRA_ROUTE_ALL, 0, VRF_DEFAULT);
 }
 
+/* Start batching route updates to zebra, see zclient_batch_start() */
+void nhrp_zebra_batch_start(void)
+{
+	if (zclient)
+		zclient_batch_start(zclient);
+}
+
+/* Flush the route updates batched since nhrp_zebra_batch_start() */
+void nhrp_zebra_batch_end(void)
+{
+	if (zclient)
+		(void)zclient_batch_end(zclient);
+}
+
 void nhrp_zebra_init(void)
 {
 	zebra_rib[AFI_IP] = route_table_init();
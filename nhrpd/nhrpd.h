@@ -88,6 +88,8 @@ static inline int notifier_active(struct notifier_list *l)
 
 void nhrp_zebra_init(void);
 void nhrp_zebra_terminate(void);
+void nhrp_zebra_batch_start(void);
+void nhrp_zebra_batch_end(void);
 
 struct zbuf;
 struct nhrp_vc;
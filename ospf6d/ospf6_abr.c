@@ -512,16 +512,22 @@ int ospf6_abr_originate_summary_to_area(struct ospf6_route *route,
 	return 1;
 }
 
+void ospf6_abr_area_range_reset_cost(struct ospf6_area *oa)
+{
+	struct ospf6_route *range;
+
+	for (range = ospf6_route_head(oa->range_table); range;
+	     range = ospf6_route_next(range))
+		OSPF6_ABR_RANGE_CLEAR_COST(range);
+}
+
 void ospf6_abr_range_reset_cost(struct ospf6 *ospf6)
 {
 	struct listnode *node, *nnode;
 	struct ospf6_area *oa;
-	struct ospf6_route *range;
 
 	for (ALL_LIST_ELEMENTS(ospf6->area_list, node, nnode, oa))
-		for (range = ospf6_route_head(oa->range_table); range;
-		     range = ospf6_route_next(range))
-			OSPF6_ABR_RANGE_CLEAR_COST(range);
+		ospf6_abr_area_range_reset_cost(oa);
 }
 
 static inline uint32_t ospf6_abr_range_compute_cost(struct ospf6_route *range,
@@ -74,6 +74,7 @@ extern void ospf6_abr_examin_brouter(uint32_t router_id,
 				     struct ospf6 *ospf6);
 extern void ospf6_abr_reimport(struct ospf6_area *oa);
 extern void ospf6_abr_range_reset_cost(struct ospf6 *ospf6);
+extern void ospf6_abr_area_range_reset_cost(struct ospf6_area *oa);
 extern void ospf6_abr_prefix_resummarize(struct ospf6 *ospf6);
 
 extern int config_write_ospf6_debug_abr(struct vty *vty);
@@ -65,9 +65,8 @@ static void ospf6_area_lsdb_hook_add(struct ospf6_lsa *lsa)
 			zlog_debug(" Schedule SPF Calculation for %s",
 				   OSPF6_AREA(lsa->lsdb->data)->name);
 		}
-		ospf6_spf_schedule(
-			OSPF6_PROCESS(OSPF6_AREA(lsa->lsdb->data)->ospf6),
-			ospf6_lsadd_to_spf_reason(lsa));
+		ospf6_area_spf_schedule(OSPF6_AREA(lsa->lsdb->data),
+					ospf6_lsadd_to_spf_reason(lsa));
 		break;
 
 	case OSPF6_LSTYPE_INTRA_PREFIX:
@@ -95,9 +94,8 @@ static void ospf6_area_lsdb_hook_remove(struct ospf6_lsa *lsa)
 			zlog_debug("Schedule SPF Calculation for %s",
 				   OSPF6_AREA(lsa->lsdb->data)->name);
 		}
-		ospf6_spf_schedule(
-			OSPF6_PROCESS(OSPF6_AREA(lsa->lsdb->data)->ospf6),
-			ospf6_lsremove_to_spf_reason(lsa));
+		ospf6_area_spf_schedule(OSPF6_AREA(lsa->lsdb->data),
+					ospf6_lsremove_to_spf_reason(lsa));
 		break;
 
 	case OSPF6_LSTYPE_INTRA_PREFIX:
@@ -227,6 +225,7 @@ struct ospf6_area *ospf6_area_create(uint32_t area_id, struct ospf6 *o, int df)
 
 	oa->spf_table = OSPF6_ROUTE_TABLE_CREATE(AREA, SPF_RESULTS);
 	oa->spf_table->scope = oa;
+	oa->spf_pending = true;
 	oa->route_table = OSPF6_ROUTE_TABLE_CREATE(AREA, ROUTES);
 	oa->route_table->scope = oa;
 	oa->route_table->hook_add = ospf6_area_route_hook_add;
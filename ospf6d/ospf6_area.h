@@ -65,6 +65,7 @@ struct ospf6_area {
 	struct ospf6_route_table *route_table;
 
 	uint32_t spf_calculation; /* SPF calculation count */
+	bool spf_pending;	  /* LSDB changed since the last SPF */
 
 	struct thread *thread_router_lsa;
 	struct thread *thread_intra_prefix_lsa;
@@ -86,7 +86,7 @@ static void ospf6_interface_lsdb_hook(struct ospf6_lsa *lsa,
 		if (oi->state == OSPF6_INTERFACE_DR)
 			OSPF6_INTRA_PREFIX_LSA_SCHEDULE_TRANSIT(oi);
 		if (oi->area)
-			ospf6_spf_schedule(oi->area->ospf6, reason);
+			ospf6_area_spf_schedule(oi->area, reason);
 		break;
 
 	default:
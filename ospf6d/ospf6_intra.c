@@ -383,8 +383,8 @@ int ospf6_router_lsa_originate(struct thread *thread)
 	 * helps convergence with inter-area routes.
 	 */
 	if (count && !link_state_id)
-		ospf6_spf_schedule(oa->ospf6,
-				   OSPF6_SPF_FLAGS_ROUTER_LSA_ORIGINATED);
+		ospf6_area_spf_schedule(oa,
+					OSPF6_SPF_FLAGS_ROUTER_LSA_ORIGINATED);
 
 	return 0;
 }
@@ -484,8 +484,8 @@ int ospf6_network_lsa_originate(struct thread *thread)
 			 * database to
 			 * trigger SPF delays network convergence.
 			 */
-			ospf6_spf_schedule(
-				oi->area->ospf6,
+			ospf6_area_spf_schedule(
+				oi->area,
 				OSPF6_SPF_FLAGS_NETWORK_LSA_ORIGINATED);
 		}
 		return 0;
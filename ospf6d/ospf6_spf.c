@@ -604,14 +604,21 @@ static int ospf6_spf_calculation_thread(struct thread *t)
 	monotime(&start);
 	ospf6->ts_spf = start;
 
-	if (ospf6_is_router_abr(ospf6))
-		ospf6_abr_range_reset_cost(ospf6);
-
 	for (ALL_LIST_ELEMENTS_RO(ospf6->area_list, node, oa)) {
 
 		if (oa == ospf6->backbone)
 			continue;
 
+		/* The SPF tree and intra-area routes of an area depend only
+		 * on its own LSDB, so areas without changes keep theirs.
+		 */
+		if (!oa->spf_pending)
+			continue;
+		oa->spf_pending = false;
+
+		if (ospf6_is_router_abr(ospf6))
+			ospf6_abr_area_range_reset_cost(oa);
+
 		monotime(&oa->ts_spf);
 		if (IS_OSPF6_DEBUG_SPF(PROCESS))
 			zlog_debug("SPF calculation for Area %s", oa->name);
@@ -625,7 +632,12 @@ static int ospf6_spf_calculation_thread(struct thread *t)
 		areas_processed++;
 	}
 
-	if (ospf6->backbone) {
+	if (ospf6->backbone && ospf6->backbone->spf_pending) {
+		ospf6->backbone->spf_pending = false;
+
+		if (ospf6_is_router_abr(ospf6))
+			ospf6_abr_area_range_reset_cost(ospf6->backbone);
+
 		monotime(&ospf6->backbone->ts_spf);
 		if (IS_OSPF6_DEBUG_SPF(PROCESS))
 			zlog_debug("SPF calculation for Backbone area %s",
@@ -668,7 +680,7 @@ static int ospf6_spf_calculation_thread(struct thread *t)
 
 /* Add schedule for SPF calculation.  To avoid frequenst SPF calc, we
    set timer for SPF calc. */
-void ospf6_spf_schedule(struct ospf6 *ospf6, unsigned int reason)
+static void ospf6_spf_schedule_timer(struct ospf6 *ospf6, unsigned int reason)
 {
 	unsigned long delay, elapsed, ht;
 
@@ -730,6 +742,29 @@ void ospf6_spf_schedule(struct ospf6 *ospf6, unsigned int reason)
 			      delay, &ospf6->t_spf_calc);
 }
 
+/* Schedule SPF calculation for one area whose LSDB changed. */
+void ospf6_area_spf_schedule(struct ospf6_area *oa, unsigned int reason)
+{
+	oa->spf_pending = true;
+	ospf6_spf_schedule_timer(oa->ospf6, reason);
+}
+
+/* Schedule SPF calculation for all areas. */
+void ospf6_spf_schedule(struct ospf6 *ospf6, unsigned int reason)
+{
+	struct listnode *node;
+	struct ospf6_area *oa;
+
+	/* OSPF instance does not exist. */
+	if (ospf6 == NULL)
+		return;
+
+	for (ALL_LIST_ELEMENTS_RO(ospf6->area_list, node, oa))
+		oa->spf_pending = true;
+
+	ospf6_spf_schedule_timer(ospf6, reason);
+}
+
 void ospf6_spf_display_subtree(struct vty *vty, const char *prefix, int rest,
 			       struct ospf6_vertex *v)
 {
@@ -145,6 +145,8 @@ extern void ospf6_spf_calculation(uint32_t router_id,
 				  struct ospf6_route_table *result_table,
 				  struct ospf6_area *oa);
 extern void ospf6_spf_schedule(struct ospf6 *ospf, unsigned int reason);
+extern void ospf6_area_spf_schedule(struct ospf6_area *oa,
+				    unsigned int reason);
 
 extern void ospf6_spf_display_subtree(struct vty *vty, const char *prefix,
 				      int rest, struct ospf6_vertex *v);
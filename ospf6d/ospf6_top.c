@@ -264,6 +264,7 @@ static struct ospf6 *ospf6_create(const char *name)
 	o->ref_bandwidth = OSPF6_REFERENCE_BANDWIDTH;
 
 	o->distance_table = route_table_init();
+	o->zebra_pending = route_table_init();
 	o->fd = -1;
 
 	QOBJ_REG(o, ospf6);
@@ -310,6 +311,7 @@ void ospf6_delete(struct ospf6 *o)
 	ospf6_lsdb_delete(o->lsdb);
 	ospf6_lsdb_delete(o->lsdb_self);
 
+	ospf6_zebra_route_flush(o);
 	ospf6_route_table_delete(o->route_table, o);
 	ospf6_route_table_delete(o->brouter_table, o);
 
@@ -318,6 +320,7 @@ void ospf6_delete(struct ospf6 *o)
 
 	ospf6_distance_reset(o);
 	route_table_finish(o->distance_table);
+	route_table_finish(o->zebra_pending);
 
 	XFREE(MTYPE_OSPF6_TOP, o->name);
 	XFREE(MTYPE_OSPF6_TOP, o);
@@ -340,6 +343,7 @@ static void ospf6_disable(struct ospf6 *o)
 		ospf6_lsdb_remove_all(o->lsdb);
 		ospf6_route_remove_all(o->route_table, o);
 		ospf6_route_remove_all(o->brouter_table, o);
+		ospf6_zebra_route_flush(o);
 
 		THREAD_OFF(o->maxage_remover);
 		THREAD_OFF(o->t_spf_calc);
@@ -966,6 +970,10 @@ static void ospf6_show(struct vty *vty, struct ospf6 *o, json_object *json,
 	char buf[32], rbuf[32];
 	json_object *json_areas = NULL;
 	const char *adjacency;
+	long long zebra_batch_usec;
+
+	zebra_batch_usec = (long long)o->ts_zebra_flush_duration.tv_sec * 1000000
+			   + o->ts_zebra_flush_duration.tv_usec;
 
 	if (use_json) {
 		json_areas = json_object_new_object();
@@ -1030,6 +1038,17 @@ static void ospf6_show(struct vty *vty, struct ospf6 *o, json_object *json,
 		} else
 			json_object_boolean_false_add(json, "spfTimerActive");
 
+		json_object_int_add(json, "zebraRouteAdds",
+				    o->zebra_route_adds);
+		json_object_int_add(json, "zebraRouteDeletes",
+				    o->zebra_route_dels);
+		json_object_int_add(json, "zebraRouteBatches",
+				    o->zebra_flushes);
+		json_object_int_add(json, "zebraLastBatchRoutes",
+				    o->zebra_last_flush_count);
+		json_object_int_add(json, "zebraLastBatchUsecs",
+				    zebra_batch_usec);
+
 		json_object_boolean_add(json, "routerIsStubRouter",
 					CHECK_FLAG(o->flag, OSPF6_STUB_ROUTER));
 
@@ -1105,6 +1124,19 @@ static void ospf6_show(struct vty *vty, struct ospf6 *o, json_object *json,
 		vty_out(vty, " SPF timer %s%s\n",
 			(o->t_spf_calc ? "due in " : "is "), buf);
 
+		vty_out(vty,
+			" Zebra route updates: %u adds, %u deletes in %u batches\n",
+			o->zebra_route_adds, o->zebra_route_dels,
+			o->zebra_flushes);
+		if (o->zebra_flushes)
+			vty_out(vty,
+				" Last batch %u routes in %lld usec (%lld routes/sec)\n",
+				o->zebra_last_flush_count, zebra_batch_usec,
+				zebra_batch_usec
+					? (long long)o->zebra_last_flush_count
+						  * 1000000 / zebra_batch_usec
+					: 0);
+
 		if (CHECK_FLAG(o->flag, OSPF6_STUB_ROUTER))
 			vty_out(vty, " Router Is Stub Router\n");
 
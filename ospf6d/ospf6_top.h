@@ -104,6 +104,18 @@ struct ospf6 {
 	struct thread *maxage_remover;
 	struct thread *t_distribute_update; /* Distirbute update timer. */
 	struct thread *t_ospf6_receive; /* OSPF6 receive timer */
+	struct thread *t_zebra_flush;   /* Send pending routes to zebra */
+
+	/* Prefixes whose routes changed since the last zebra flush. */
+	struct route_table *zebra_pending;
+	uint32_t zebra_pending_count;
+
+	/* Zebra route install statistics */
+	uint32_t zebra_route_adds;
+	uint32_t zebra_route_dels;
+	uint32_t zebra_flushes;
+	uint32_t zebra_last_flush_count;
+	struct timeval ts_zebra_flush_duration;
 
 	uint32_t ref_bandwidth;
 
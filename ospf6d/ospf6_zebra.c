@@ -43,6 +43,7 @@
 #include "lib/json.h"
 
 DEFINE_MTYPE_STATIC(OSPF6D, OSPF6_DISTANCE, "OSPF6 distance")
+DEFINE_MTYPE_STATIC(OSPF6D, OSPF6_ZEBRA_PENDING, "OSPF6 zebra pending route")
 
 unsigned char conf_debug_ospf6_zebra = 0;
 
@@ -283,92 +284,199 @@ DEFUN(show_zebra,
 
 #define ADD    0
 #define REM    1
-static void ospf6_zebra_route_update(int type, struct ospf6_route *request,
-				     struct ospf6 *ospf6)
-{
-	struct zapi_route api;
-	int nhcount;
-	int ret = 0;
-	struct prefix *dest;
 
-	if (IS_OSPF6_DEBUG_ZEBRA(SEND))
-		zlog_debug("Send %s route: %pFX",
-			   (type == REM ? "remove" : "add"), &request->prefix);
+/*
+ * Route table hooks do not talk to zebra directly. Changed prefixes are
+ * collected in ospf6->zebra_pending and the final state of each is sent
+ * from a single event once the SPF/ASE run that changed them is over, so
+ * a prefix that flaps within one run costs at most one message.
+ */
+struct ospf6_zebra_pending {
+	/* a route for this prefix was removed, zebra may hold a stale one */
+	bool removed;
+};
 
-	if (zclient->sock < 0) {
-		if (IS_OSPF6_DEBUG_ZEBRA(SEND))
-			zlog_debug("  Not connected to Zebra");
-		return;
-	}
+static int ospf6_zebra_route_flush_thread(struct thread *thread);
 
-	if (request->path.origin.adv_router == ospf6->router_id
-	    && (request->path.type == OSPF6_PATH_TYPE_EXTERNAL1
-		|| request->path.type == OSPF6_PATH_TYPE_EXTERNAL2)) {
-		if (IS_OSPF6_DEBUG_ZEBRA(SEND))
-			zlog_debug("  Ignore self-originated external route");
-		return;
-	}
+/* Find the route for a prefix that would be sent to zebra, if any. */
+static struct ospf6_route *ospf6_zebra_route_best(struct prefix *prefix,
+						  struct ospf6 *ospf6)
+{
+	struct ospf6_route *route;
+
+	for (route = ospf6_route_lookup(prefix, ospf6->route_table);
+	     route && prefix_same(&route->prefix, prefix);
+	     route = route->next) {
+		if (!ospf6_route_is_best(route))
+			continue;
+
+		if (route->path.origin.adv_router == ospf6->router_id
+		    && (route->path.type == OSPF6_PATH_TYPE_EXTERNAL1
+			|| route->path.type == OSPF6_PATH_TYPE_EXTERNAL2)) {
+			if (IS_OSPF6_DEBUG_ZEBRA(SEND))
+				zlog_debug(
+					"  Ignore self-originated external route");
+			return NULL;
+		}
 
-	/* If removing is the best path and if there's another path,
-	   treat this request as add the secondary path */
-	if (type == REM && ospf6_route_is_best(request) && request->next
-	    && ospf6_route_is_same(request, request->next)) {
-		if (IS_OSPF6_DEBUG_ZEBRA(SEND))
-			zlog_debug(
-				"  Best-path removal resulted Secondary addition");
-		type = ADD;
-		request = request->next;
-	}
+		if (ospf6_route_num_nexthops(route) == 0) {
+			if (IS_OSPF6_DEBUG_ZEBRA(SEND))
+				zlog_debug("  No nexthop, ignore");
+			return NULL;
+		}
 
-	/* Only the best path will be sent to zebra. */
-	if (!ospf6_route_is_best(request)) {
-		/* this is not preferred best route, ignore */
-		if (IS_OSPF6_DEBUG_ZEBRA(SEND))
-			zlog_debug("  Ignore non-best route");
-		return;
+		return route;
 	}
 
-	nhcount = ospf6_route_num_nexthops(request);
-	if (nhcount == 0) {
-		if (IS_OSPF6_DEBUG_ZEBRA(SEND))
-			zlog_debug("  No nexthop, ignore");
-		return;
-	}
+	return NULL;
+}
+
+static void ospf6_zebra_route_send(int type, struct prefix *dest,
+				   struct ospf6_route *request,
+				   struct ospf6 *ospf6)
+{
+	struct zapi_route api;
+	int nhcount;
+	int ret = 0;
 
-	dest = &request->prefix;
+	if (IS_OSPF6_DEBUG_ZEBRA(SEND))
+		zlog_debug("Send %s route: %pFX",
+			   (type == REM ? "remove" : "add"), dest);
 
 	memset(&api, 0, sizeof(api));
 	api.vrf_id = ospf6->vrf_id;
 	api.type = ZEBRA_ROUTE_OSPF6;
 	api.safi = SAFI_UNICAST;
 	api.prefix = *dest;
-	SET_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP);
-	api.nexthop_num = MIN(nhcount, MULTIPATH_NUM);
-	ospf6_route_zebra_copy_nexthops(request, api.nexthops, api.nexthop_num);
-	SET_FLAG(api.message, ZAPI_MESSAGE_METRIC);
-	api.metric = (request->path.metric_type == 2 ? request->path.u.cost_e2
-						     : request->path.cost);
-	if (request->path.tag) {
-		SET_FLAG(api.message, ZAPI_MESSAGE_TAG);
-		api.tag = request->path.tag;
-	}
 
-	SET_FLAG(api.message, ZAPI_MESSAGE_DISTANCE);
-	api.distance = ospf6_distance_apply((struct prefix_ipv6 *)dest, request,
-					    ospf6);
+	if (type == ADD) {
+		nhcount = ospf6_route_num_nexthops(request);
+		SET_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP);
+		api.nexthop_num = MIN(nhcount, MULTIPATH_NUM);
+		ospf6_route_zebra_copy_nexthops(request, api.nexthops,
+						api.nexthop_num);
+		SET_FLAG(api.message, ZAPI_MESSAGE_METRIC);
+		api.metric = (request->path.metric_type == 2
+				      ? request->path.u.cost_e2
+				      : request->path.cost);
+		if (request->path.tag) {
+			SET_FLAG(api.message, ZAPI_MESSAGE_TAG);
+			api.tag = request->path.tag;
+		}
 
-	if (type == REM)
+		SET_FLAG(api.message, ZAPI_MESSAGE_DISTANCE);
+		api.distance = ospf6_distance_apply((struct prefix_ipv6 *)dest,
+						    request, ospf6);
+	}
+
+	if (type == REM) {
 		ret = zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
-	else
+		ospf6->zebra_route_dels++;
+	} else {
 		ret = zclient_route_send(ZEBRA_ROUTE_ADD, zclient, &api);
+		ospf6->zebra_route_adds++;
+	}
 
 	if (ret == ZCLIENT_SEND_FAILURE)
 		flog_err(EC_LIB_ZAPI_SOCKET,
 			 "zclient_route_send() %s failed: %s",
 			 (type == REM ? "delete" : "add"),
 			 safe_strerror(errno));
+}
+
+static void ospf6_zebra_route_update(int type, struct ospf6_route *request,
+				     struct ospf6 *ospf6)
+{
+	struct route_node *rn;
+	struct ospf6_zebra_pending *pending;
+
+	rn = route_node_get(ospf6->zebra_pending, &request->prefix);
+	if (rn->info) {
+		route_unlock_node(rn);
+		pending = rn->info;
+	} else {
+		pending = XCALLOC(MTYPE_OSPF6_ZEBRA_PENDING,
+				  sizeof(struct ospf6_zebra_pending));
+		rn->info = pending;
+		ospf6->zebra_pending_count++;
+	}
+
+	if (type == REM)
+		pending->removed = true;
+
+	thread_add_event(master, ospf6_zebra_route_flush_thread, ospf6, 0,
+			 &ospf6->t_zebra_flush);
+}
+
+/* Send the current state of every pending prefix to zebra. */
+void ospf6_zebra_route_flush(struct ospf6 *ospf6)
+{
+	struct route_node *rn;
+	struct ospf6_zebra_pending *pending;
+	struct ospf6_route *route;
+	struct timeval start, end;
+	uint32_t count = 0;
+	bool connected;
+
+	THREAD_OFF(ospf6->t_zebra_flush);
+
+	if (!ospf6->zebra_pending_count)
+		return;
+
+	connected = zclient->sock >= 0;
+	if (!connected && IS_OSPF6_DEBUG_ZEBRA(SEND))
+		zlog_debug("%s: Not connected to Zebra, dropping %u routes",
+			   __func__, ospf6->zebra_pending_count);
+
+	monotime(&start);
+
+	for (rn = route_top(ospf6->zebra_pending); rn; rn = route_next(rn)) {
+		pending = rn->info;
+		if (!pending)
+			continue;
+
+		if (connected) {
+			route = ospf6_zebra_route_best(&rn->p, ospf6);
+			if (route) {
+				ospf6_zebra_route_send(ADD, &rn->p, route,
+						       ospf6);
+				count++;
+			} else if (pending->removed) {
+				ospf6_zebra_route_send(REM, &rn->p, NULL,
+						       ospf6);
+				count++;
+			}
+		}
+
+		XFREE(MTYPE_OSPF6_ZEBRA_PENDING, pending);
+		rn->info = NULL;
+		route_unlock_node(rn);
+	}
+	ospf6->zebra_pending_count = 0;
 
-	return;
+	if (!count)
+		return;
+
+	monotime(&end);
+	timersub(&end, &start, &ospf6->ts_zebra_flush_duration);
+	ospf6->zebra_last_flush_count = count;
+	ospf6->zebra_flushes++;
+
+	if (IS_OSPF6_DEBUG_ZEBRA(SEND))
+		zlog_debug("%s: %u route updates sent in %lld sec %lld usec",
+			   __func__, count,
+			   (long long)ospf6->ts_zebra_flush_duration.tv_sec,
+			   (long long)ospf6->ts_zebra_flush_duration.tv_usec);
+}
+
+static int ospf6_zebra_route_flush_thread(struct thread *thread)
+{
+	struct ospf6 *ospf6 = THREAD_ARG(thread);
+
+	ospf6->t_zebra_flush = NULL;
+	ospf6_zebra_route_flush(ospf6);
+
+	return 0;
 }
 
 void ospf6_zebra_route_update_add(struct ospf6_route *request,
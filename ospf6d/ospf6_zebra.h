@@ -47,6 +47,7 @@ extern void ospf6_zebra_route_update_add(struct ospf6_route *request,
 					 struct ospf6 *ospf6);
 extern void ospf6_zebra_route_update_remove(struct ospf6_route *request,
 					    struct ospf6 *ospf6);
+extern void ospf6_zebra_route_flush(struct ospf6 *ospf6);
 
 extern void ospf6_zebra_redistribute(int, vrf_id_t vrf_id);
 extern void ospf6_zebra_no_redistribute(int, vrf_id_t vrf_id);
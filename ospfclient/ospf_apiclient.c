@@ -332,6 +332,14 @@ static int ospf_apiclient_send_request(struct ospf_apiclient *oclient,
 
 	msgreply = (struct msg_reply *)STREAM_DATA(msg->s);
 	rc = msgreply->errcode;
+
+	/* Replies to LSDB syncs tell where we are in sync */
+	if (ntohs(msg->hdr.msglen) >= sizeof(struct msg_reply_sync)) {
+		struct msg_reply_sync *sreply = (void *)msgreply;
+
+		oclient->lsdb_epoch = ntohl(sreply->epoch);
+		oclient->lsdb_gen = ntohl(sreply->gen);
+	}
 	msg_free(msg);
 
 	return rc;
@@ -389,7 +397,9 @@ int ospf_apiclient_register_opaque_type(struct ospf_apiclient *cl,
  * Two steps required: register_event in order to get
  * dynamic updates and LSDB_Sync.
  */
-int ospf_apiclient_sync_lsdb(struct ospf_apiclient *oclient)
+static int ospf_apiclient_sync_lsdb_since(struct ospf_apiclient *oclient,
+					  bool incremental, uint32_t epoch,
+					  uint32_t gen)
 {
 	struct msg *msg;
 	int rc;
@@ -409,7 +419,11 @@ int ospf_apiclient_sync_lsdb(struct ospf_apiclient *oclient)
 	if (rc != 0)
 		goto out;
 
-	msg = new_msg_sync_lsdb(ospf_apiclient_get_seqnr(), &filter);
+	if (incremental)
+		msg = new_msg_sync_lsdb_since(ospf_apiclient_get_seqnr(), epoch,
+					      gen, &filter);
+	else
+		msg = new_msg_sync_lsdb(ospf_apiclient_get_seqnr(), &filter);
 	if (!msg) {
 		fprintf(stderr, "new_msg_sync_lsdb failed\n");
 		return -1;
@@ -420,6 +434,20 @@ out:
 	return rc;
 }
 
+int ospf_apiclient_sync_lsdb(struct ospf_apiclient *oclient)
+{
+	return ospf_apiclient_sync_lsdb_since(oclient, false, 0, 0);
+}
+
+/*
+ * Synchronous request to catch up with OSPF's LSDB after a reconnect.
+ */
+int ospf_apiclient_resync_lsdb(struct ospf_apiclient *oclient, uint32_t epoch,
+			       uint32_t gen)
+{
+	return ospf_apiclient_sync_lsdb_since(oclient, true, epoch, gen);
+}
+
 /*
  * Synchronous request to originate or update an LSA.
  */
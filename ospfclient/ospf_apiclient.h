@@ -29,6 +29,10 @@ struct ospf_apiclient {
 	int fd_sync;
 	int fd_async;
 
+	/* LSDB position as of the last sync, for ospf_apiclient_resync_lsdb */
+	uint32_t lsdb_epoch;
+	uint32_t lsdb_gen;
+
 	/* Pointer to callback functions */
 	void (*ready_notify)(uint8_t lsa_type, uint8_t opaque_type,
 			     struct in_addr addr);
@@ -83,6 +87,12 @@ void ospf_apiclient_register_callback(
 /* Synchronous request to synchronize LSDB. */
 int ospf_apiclient_sync_lsdb(struct ospf_apiclient *oclient);
 
+/* Same, but only get what changed since an earlier sync (as saved from
+   lsdb_epoch/lsdb_gen of a previous connection).  The daemon falls back
+   to a full sync if it cannot tell. */
+int ospf_apiclient_resync_lsdb(struct ospf_apiclient *oclient, uint32_t epoch,
+			       uint32_t gen);
+
 /* Synchronous request to originate or update opaque LSA. */
 int ospf_apiclient_lsa_originate(struct ospf_apiclient *oclient,
 				 struct in_addr ifaddr, struct in_addr area_id,
@@ -148,6 +148,9 @@ const char *ospf_api_typename(int msgtype)
 		{
 			MSG_DELETE_REQUEST, "Delete request",
 		},
+		{
+			MSG_SYNC_LSDB_SINCE, "Sync LSDB since",
+		},
 		{
 			MSG_REPLY, "Reply",
 		},
@@ -436,6 +439,49 @@ int msg_write(int fd, struct msg *msg)
 	return 0;
 }
 
+/* Write out up to max queued messages. They are packed back to back
+   into one buffer so that a burst of notifications (e.g. an LSDB sync)
+   costs one write() per buffer rather than one per message. Returns the
+   number of messages written and freed, -1 on error. */
+int msg_fifo_write(int fd, struct msg_fifo *fifo, unsigned int max)
+{
+	static uint8_t buf[OSPF_API_MAX_MSG_SIZE * 16];
+	struct msg *msg;
+	unsigned int n = 0;
+	size_t len = 0, l;
+	int wlen;
+
+	while (n < max && (msg = msg_fifo_head(fifo))) {
+		l = sizeof(struct apimsghdr) + ntohs(msg->hdr.msglen);
+		if (len + l > sizeof(buf))
+			break;
+
+		memcpy(buf + len, &msg->hdr, sizeof(struct apimsghdr));
+		memcpy(buf + len + sizeof(struct apimsghdr),
+		       STREAM_DATA(msg->s), ntohs(msg->hdr.msglen));
+		len += l;
+		n++;
+
+		msg_free(msg_fifo_pop(fifo));
+	}
+
+	if (!len)
+		return 0;
+
+	wlen = writen(fd, buf, len);
+	if (wlen < 0) {
+		zlog_warn("msg_fifo_write: writen %s", safe_strerror(errno));
+		return -1;
+	} else if (wlen == 0) {
+		zlog_warn("msg_fifo_write: Connection closed by peer");
+		return -1;
+	} else if ((size_t)wlen != len) {
+		zlog_warn("msg_fifo_write: Cannot write API messages");
+		return -1;
+	}
+	return n;
+}
+
 /* -----------------------------------------------------------
  * Specific messages
  * -----------------------------------------------------------
@@ -491,6 +537,28 @@ struct msg *new_msg_sync_lsdb(uint32_t seqnum, struct lsa_filter_type *filter)
 	return msg_new(MSG_SYNC_LSDB, smsg, seqnum, len);
 }
 
+struct msg *new_msg_sync_lsdb_since(uint32_t seqnum, uint32_t epoch,
+				    uint32_t since,
+				    struct lsa_filter_type *filter)
+{
+	uint8_t buf[OSPF_API_MAX_MSG_SIZE];
+	struct msg_sync_lsdb_since *smsg;
+	unsigned int len;
+
+	smsg = (struct msg_sync_lsdb_since *)buf;
+	len = sizeof(struct msg_sync_lsdb_since)
+	      + filter->num_areas * sizeof(struct in_addr);
+	smsg->epoch = htonl(epoch);
+	smsg->since = htonl(since);
+	smsg->filter.typemask = htons(filter->typemask);
+	smsg->filter.origin = filter->origin;
+	smsg->filter.num_areas = filter->num_areas;
+	if (len > sizeof(buf))
+		len = sizeof(buf);
+	memcpy(smsg + 1, filter + 1, len - sizeof(struct msg_sync_lsdb_since));
+	return msg_new(MSG_SYNC_LSDB_SINCE, smsg, seqnum, len);
+}
+
 
 struct msg *new_msg_originate_request(uint32_t seqnum, struct in_addr ifaddr,
 				      struct in_addr area_id,
@@ -547,6 +615,19 @@ struct msg *new_msg_reply(uint32_t seqnr, uint8_t rc)
 	return msg;
 }
 
+struct msg *new_msg_reply_sync(uint32_t seqnr, uint8_t rc, uint32_t epoch,
+			       uint32_t gen)
+{
+	struct msg_reply_sync rmsg;
+
+	rmsg.reply.errcode = rc;
+	memset(&rmsg.reply.pad, 0, sizeof(rmsg.reply.pad));
+	rmsg.epoch = htonl(epoch);
+	rmsg.gen = htonl(gen);
+
+	return msg_new(MSG_REPLY, &rmsg, seqnr, sizeof(struct msg_reply_sync));
+}
+
 struct msg *new_msg_ready_notify(uint32_t seqnr, uint8_t lsa_type,
 				 uint8_t opaque_type, struct in_addr addr)
 {
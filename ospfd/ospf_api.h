@@ -98,6 +98,7 @@ extern void msg_fifo_push(struct msg_fifo *, struct msg *msg);
 extern struct msg *msg_fifo_pop(struct msg_fifo *fifo);
 extern struct msg *msg_fifo_head(struct msg_fifo *fifo);
 extern void msg_fifo_flush(struct msg_fifo *fifo);
+extern int msg_fifo_write(int fd, struct msg_fifo *fifo, unsigned int max);
 extern void msg_fifo_free(struct msg_fifo *fifo);
 
 /* -----------------------------------------------------------
@@ -112,6 +113,7 @@ extern void msg_fifo_free(struct msg_fifo *fifo);
 #define MSG_SYNC_LSDB             4
 #define MSG_ORIGINATE_REQUEST     5
 #define MSG_DELETE_REQUEST        6
+#define MSG_SYNC_LSDB_SINCE       7
 
 /* Messages from OSPF daemon. */
 #define MSG_REPLY                10
@@ -164,6 +166,15 @@ struct msg_sync_lsdb {
 	struct lsa_filter_type filter;
 };
 
+/* Incremental LSDB sync: only LSAs installed or deleted after the point
+   (epoch, since) returned in the reply to an earlier sync are sent. The
+   daemon falls back to a full sync if it cannot tell what changed. */
+struct msg_sync_lsdb_since {
+	uint32_t epoch;
+	uint32_t since;
+	struct lsa_filter_type filter;
+};
+
 struct msg_originate_request {
 	/* Used for LSA type 9 otherwise ignored */
 	struct in_addr ifaddr;
@@ -199,6 +210,14 @@ struct msg_reply {
 	uint8_t pad[3]; /* padding to four byte alignment */
 };
 
+/* Reply to MSG_SYNC_LSDB(_SINCE), the LSDB position the client is now
+   in sync with. Older clients only look at the leading msg_reply. */
+struct msg_reply_sync {
+	struct msg_reply reply;
+	uint32_t epoch;
+	uint32_t gen;
+};
+
 /* Message to tell client application that it ospf daemon is
  * ready to accept opaque LSAs for a given interface or area. */
 
@@ -256,9 +275,11 @@ struct apimsg {
 		struct msg_register_opaque_type register_opaque_type;
 		struct msg_register_event register_event;
 		struct msg_sync_lsdb sync_lsdb;
+		struct msg_sync_lsdb_since sync_lsdb_since;
 		struct msg_originate_request originate_request;
 		struct msg_delete_request delete_request;
 		struct msg_reply reply;
+		struct msg_reply_sync reply_sync;
 		struct msg_ready_notify ready_notify;
 		struct msg_new_if new_if;
 		struct msg_del_if del_if;
@@ -285,6 +306,9 @@ extern struct msg *new_msg_register_event(uint32_t seqnum,
 					  struct lsa_filter_type *filter);
 extern struct msg *new_msg_sync_lsdb(uint32_t seqnum,
 				     struct lsa_filter_type *filter);
+extern struct msg *new_msg_sync_lsdb_since(uint32_t seqnum, uint32_t epoch,
+					   uint32_t since,
+					   struct lsa_filter_type *filter);
 extern struct msg *new_msg_originate_request(uint32_t seqnum,
 					     struct in_addr ifaddr,
 					     struct in_addr area_id,
@@ -296,6 +320,8 @@ extern struct msg *new_msg_delete_request(uint32_t seqnum,
 
 /* Messages sent by OSPF daemon */
 extern struct msg *new_msg_reply(uint32_t seqnum, uint8_t rc);
+extern struct msg *new_msg_reply_sync(uint32_t seqnum, uint8_t rc,
+				      uint32_t epoch, uint32_t gen);
 
 extern struct msg *new_msg_ready_notify(uint32_t seqnr, uint8_t lsa_type,
 					uint8_t opaque_type,
@@ -72,6 +72,33 @@
 /* List of all active connections. */
 struct list *apiserver_list;
 
+/*
+ * LSDB change log for incremental sync (MSG_SYNC_LSDB_SINCE).  Every LSA
+ * installed gets the next generation number; deletions are kept in a
+ * ring of tombstones.  A client that was in sync at generation "since"
+ * only needs the tombstones and the LSAs with a newer generation.  If
+ * tombstones it would need were overwritten, or the daemon restarted
+ * (different epoch), it gets a full sync instead.
+ */
+struct apiserver_tomb {
+	uint32_t gen;
+	struct in_addr ifaddr;
+	struct in_addr area_id;
+	uint8_t is_self;
+	struct lsa_header hdr;
+};
+
+static struct {
+	uint32_t epoch;
+	uint32_t gen;
+	/* newest generation whose tombstone was overwritten */
+	uint32_t lost;
+
+	struct apiserver_tomb *tombs;
+	unsigned int head; /* next slot to write */
+	unsigned int count;
+} apiserver_log;
+
 /* -----------------------------------------------------------
  * Functions to lookup interfaces
  * -----------------------------------------------------------
@@ -142,6 +169,11 @@ int ospf_apiserver_init(void)
 	/* Initialize list that keeps track of all connections. */
 	apiserver_list = list_new();
 
+	apiserver_log.epoch = (uint32_t)time(NULL);
+	apiserver_log.tombs =
+		XCALLOC(MTYPE_OSPF_APISERVER,
+			OSPF_APISERVER_TOMBS * sizeof(struct apiserver_tomb));
+
 	/* Register opaque-independent call back functions. These functions
 	   are invoked on ISM, NSM changes and LSA update and LSA deletes */
 	rc = ospf_register_opaque_functab(
@@ -184,6 +216,8 @@ void ospf_apiserver_term(void)
 	if (apiserver_list)
 		list_delete(&apiserver_list);
 
+	XFREE(MTYPE_OSPF_APISERVER, apiserver_log.tombs);
+
 	/* Free wildcard list */
 	/* XXX  */
 }
@@ -426,10 +460,19 @@ out:
 	return rc;
 }
 
+static void apiserver_fifo_print(struct msg_fifo *fifo)
+{
+	struct msg *msg;
+	unsigned int n = 0;
+
+	for (msg = msg_fifo_head(fifo); msg && n < OSPF_APISERVER_WRITE_BATCH;
+	     msg = msg->next, n++)
+		msg_print(msg);
+}
+
 int ospf_apiserver_sync_write(struct thread *thread)
 {
 	struct ospf_apiserver *apiserv;
-	struct msg *msg;
 	int fd;
 	int rc = -1;
 
@@ -450,27 +493,22 @@ int ospf_apiserver_sync_write(struct thread *thread)
 			   &apiserv->peer_sync.sin_addr,
 			   ntohs(apiserv->peer_sync.sin_port));
 
-	/* Check whether there is really a message in the fifo. */
-	msg = msg_fifo_pop(apiserv->out_sync_fifo);
-	if (!msg) {
-		zlog_warn(
-			"API: ospf_apiserver_sync_write: No message in Sync-FIFO?");
-		return 0;
-	}
-
 	if (IS_DEBUG_OSPF_EVENT)
-		msg_print(msg);
-
-	rc = msg_write(fd, msg);
-
-	/* Once a message is dequeued, it should be freed anyway. */
-	msg_free(msg);
+		apiserver_fifo_print(apiserv->out_sync_fifo);
 
+	/* Write out as much as fits in one go, messages are freed. */
+	rc = msg_fifo_write(fd, apiserv->out_sync_fifo,
+			    OSPF_APISERVER_WRITE_BATCH);
 	if (rc < 0) {
 		zlog_warn("ospf_apiserver_sync_write: write failed on fd=%d",
 			  fd);
 		goto out;
 	}
+	if (rc == 0) {
+		zlog_warn(
+			"API: ospf_apiserver_sync_write: No message in Sync-FIFO?");
+		return 0;
+	}
 
 
 	/* If more messages are in sync message fifo, schedule write thread. */
@@ -493,7 +531,6 @@ out:
 int ospf_apiserver_async_write(struct thread *thread)
 {
 	struct ospf_apiserver *apiserv;
-	struct msg *msg;
 	int fd;
 	int rc = -1;
 
@@ -514,27 +551,22 @@ int ospf_apiserver_async_write(struct thread *thread)
 			   &apiserv->peer_async.sin_addr,
 			   ntohs(apiserv->peer_async.sin_port));
 
-	/* Check whether there is really a message in the fifo. */
-	msg = msg_fifo_pop(apiserv->out_async_fifo);
-	if (!msg) {
-		zlog_warn(
-			"API: ospf_apiserver_async_write: No message in Async-FIFO?");
-		return 0;
-	}
-
 	if (IS_DEBUG_OSPF_EVENT)
-		msg_print(msg);
-
-	rc = msg_write(fd, msg);
-
-	/* Once a message is dequeued, it should be freed anyway. */
-	msg_free(msg);
+		apiserver_fifo_print(apiserv->out_async_fifo);
 
+	/* Write out as much as fits in one go, messages are freed. */
+	rc = msg_fifo_write(fd, apiserv->out_async_fifo,
+			    OSPF_APISERVER_WRITE_BATCH);
 	if (rc < 0) {
 		zlog_warn("ospf_apiserver_async_write: write failed on fd=%d",
 			  fd);
 		goto out;
 	}
+	if (rc == 0) {
+		zlog_warn(
+			"API: ospf_apiserver_async_write: No message in Async-FIFO?");
+		return 0;
+	}
 
 
 	/* If more messages are in async message fifo, schedule write thread. */
@@ -715,11 +747,11 @@ int ospf_apiserver_accept(struct thread *thread)
  * -----------------------------------------------------------
  */
 
-static int ospf_apiserver_send_msg(struct ospf_apiserver *apiserv,
-				   struct msg *msg)
+/* Queue a message for the client, takes ownership of msg. */
+static int apiserver_queue_msg(struct ospf_apiserver *apiserv,
+			       struct msg *msg)
 {
 	struct msg_fifo *fifo;
-	struct msg *msg2;
 	enum event event;
 	int fd;
 
@@ -743,22 +775,26 @@ static int ospf_apiserver_send_msg(struct ospf_apiserver *apiserv,
 	default:
 		zlog_warn("ospf_apiserver_send_msg: Unknown message type %d",
 			  msg->hdr.msgtype);
+		msg_free(msg);
 		return -1;
 	}
 
-	/* Make a copy of the message and put in the fifo. Once the fifo
+	/* Enqueue message into corresponding fifo queue. Once the fifo
 	   gets drained by the write thread, the message will be freed. */
-	/* NB: Given "msg" is untouched in this function. */
-	msg2 = msg_dup(msg);
-
-	/* Enqueue message into corresponding fifo queue */
-	msg_fifo_push(fifo, msg2);
+	msg_fifo_push(fifo, msg);
 
 	/* Schedule write thread */
 	ospf_apiserver_event(event, fd, apiserv);
 	return 0;
 }
 
+static int ospf_apiserver_send_msg(struct ospf_apiserver *apiserv,
+				   struct msg *msg)
+{
+	/* NB: Given "msg" is untouched in this function. */
+	return apiserver_queue_msg(apiserv, msg_dup(msg));
+}
+
 int ospf_apiserver_send_reply(struct ospf_apiserver *apiserv, uint32_t seqnr,
 			      uint8_t rc)
 {
@@ -801,6 +837,7 @@ int ospf_apiserver_handle_msg(struct ospf_apiserver *apiserv, struct msg *msg)
 		rc = ospf_apiserver_handle_register_event(apiserv, msg);
 		break;
 	case MSG_SYNC_LSDB:
+	case MSG_SYNC_LSDB_SINCE:
 		rc = ospf_apiserver_handle_sync_lsdb(apiserv, msg);
 		break;
 	case MSG_ORIGINATE_REQUEST:
@@ -1184,42 +1221,55 @@ int ospf_apiserver_handle_register_event(struct ospf_apiserver *apiserv,
  * -----------------------------------------------------------
  */
 
+struct apiserver_sync_param {
+	struct ospf_apiserver *apiserv;
+	struct lsa_filter_type *filter;
+	uint32_t since;
+};
+
+/* Scope of an LSA as reported in change notifications */
+static void apiserver_lsa_scope(struct ospf_lsa *lsa, struct in_addr *area_id,
+				struct in_addr *ifaddr)
+{
+	/* Default area for AS-External and Opaque11 LSAs */
+	area_id->s_addr = 0L;
+
+	/* Default interface for non Opaque9 LSAs */
+	ifaddr->s_addr = 0L;
+
+	if (lsa->area)
+		*area_id = lsa->area->area_id;
+	if (lsa->data->type == OSPF_OPAQUE_LINK_LSA)
+		*ifaddr = lsa->oi->address->u.prefix4;
+}
+
 static int apiserver_sync_callback(struct ospf_lsa *lsa, void *p_arg,
 				   int int_arg)
 {
 	struct ospf_apiserver *apiserv;
 	int seqnum;
 	struct msg *msg;
-	struct param_t {
-		struct ospf_apiserver *apiserv;
-		struct lsa_filter_type *filter;
-	} * param;
+	struct apiserver_sync_param *param;
 	int rc = -1;
 
 	/* Sanity check */
 	assert(lsa->data);
 	assert(p_arg);
 
-	param = (struct param_t *)p_arg;
+	param = (struct apiserver_sync_param *)p_arg;
 	apiserv = param->apiserv;
 	seqnum = (uint32_t)int_arg;
 
+	/* Client already has this one. */
+	if (param->since && lsa->api_gen <= param->since)
+		return 0;
+
 	/* Check origin in filter. */
 	if ((param->filter->origin == ANY_ORIGIN)
 	    || (param->filter->origin == (lsa->flags & OSPF_LSA_SELF))) {
+		struct in_addr area_id, ifaddr;
 
-		/* Default area for AS-External and Opaque11 LSAs */
-		struct in_addr area_id = {.s_addr = 0L};
-
-		/* Default interface for non Opaque9 LSAs */
-		struct in_addr ifaddr = {.s_addr = 0L};
-
-		if (lsa->area) {
-			area_id = lsa->area->area_id;
-		}
-		if (lsa->data->type == OSPF_OPAQUE_LINK_LSA) {
-			ifaddr = lsa->oi->address->u.prefix4;
-		}
+		apiserver_lsa_scope(lsa, &area_id, &ifaddr);
 
 		msg = new_msg_lsa_change_notify(
 			MSG_LSA_UPDATE_NOTIFY, seqnum, ifaddr, area_id,
@@ -1236,9 +1286,8 @@ static int apiserver_sync_callback(struct ospf_lsa *lsa, void *p_arg,
 			goto out;
 		}
 
-		/* Send LSA */
-		ospf_apiserver_send_msg(apiserv, msg);
-		msg_free(msg);
+		/* Send LSA, the fifo takes the message as is. */
+		apiserver_queue_msg(apiserv, msg);
 	}
 	rc = 0;
 
@@ -1246,86 +1295,145 @@ out:
 	return rc;
 }
 
+/* Is area_id in the area list of the sync filter (or is there none)? */
+static bool apiserver_sync_area_match(struct lsa_filter_type *filter,
+				      struct in_addr area_id)
+{
+	uint32_t *area = (uint32_t *)(filter + 1);
+	int i;
+
+	if (filter->num_areas == 0)
+		return true;
+
+	/* The list of area IDs is at the end of the filter. */
+	for (i = 0; i < filter->num_areas; i++)
+		if (area[i] == area_id.s_addr)
+			return true;
+	return false;
+}
+
+/* Replay deletions after "since" that match the filter. */
+static void apiserver_sync_tombs(struct apiserver_sync_param *param,
+				 uint32_t seqnum)
+{
+	struct lsa_filter_type *filter = param->filter;
+	uint16_t mask = ntohs(filter->typemask);
+	unsigned int i, idx;
+
+	idx = (apiserver_log.head + OSPF_APISERVER_TOMBS - apiserver_log.count)
+	      % OSPF_APISERVER_TOMBS;
+
+	for (i = 0; i < apiserver_log.count;
+	     i++, idx = (idx + 1) % OSPF_APISERVER_TOMBS) {
+		struct apiserver_tomb *tomb = &apiserver_log.tombs[idx];
+		struct msg *msg;
+
+		if (tomb->gen <= param->since)
+			continue;
+		if (!(mask & Power2[tomb->hdr.type]))
+			continue;
+		if (filter->origin != ANY_ORIGIN
+		    && filter->origin != tomb->is_self)
+			continue;
+		if (tomb->hdr.type != OSPF_AS_EXTERNAL_LSA
+		    && tomb->hdr.type != OSPF_OPAQUE_AS_LSA
+		    && !apiserver_sync_area_match(filter, tomb->area_id))
+			continue;
+
+		msg = new_msg_lsa_change_notify(MSG_LSA_DELETE_NOTIFY, seqnum,
+						tomb->ifaddr, tomb->area_id,
+						tomb->is_self, &tomb->hdr);
+		if (msg)
+			apiserver_queue_msg(param->apiserv, msg);
+	}
+}
+
 int ospf_apiserver_handle_sync_lsdb(struct ospf_apiserver *apiserv,
 				    struct msg *msg)
 {
 	struct listnode *node, *nnode;
 	uint32_t seqnum;
 	int rc = 0;
-	struct msg_sync_lsdb *smsg;
-	struct ospf_apiserver_param_t {
-		struct ospf_apiserver *apiserv;
-		struct lsa_filter_type *filter;
-	} param;
+	struct lsa_filter_type *filter;
+	struct apiserver_sync_param param;
 	uint16_t mask;
 	struct route_node *rn;
 	struct ospf_lsa *lsa;
 	struct ospf *ospf;
 	struct ospf_area *area;
+	struct msg *reply;
 
 	ospf = ospf_lookup_by_vrf_id(VRF_DEFAULT);
 
 	/* Get request sequence number */
 	seqnum = msg_get_seq(msg);
-	/* Set sync msg. */
-	smsg = (struct msg_sync_lsdb *)STREAM_DATA(msg->s);
 
 	/* Set parameter struct. */
 	param.apiserv = apiserv;
-	param.filter = &smsg->filter;
+	param.since = 0;
+
+	if (msg->hdr.msgtype == MSG_SYNC_LSDB_SINCE) {
+		struct msg_sync_lsdb_since *smsg;
+		uint32_t since;
+
+		smsg = (struct msg_sync_lsdb_since *)STREAM_DATA(msg->s);
+		filter = &smsg->filter;
+		since = ntohl(smsg->since);
+
+		/* Only go incremental if nothing the client needs was lost. */
+		if (ntohl(smsg->epoch) == apiserver_log.epoch
+		    && since <= apiserver_log.gen && since >= apiserver_log.lost)
+			param.since = since;
+
+		if (IS_DEBUG_OSPF_EVENT)
+			zlog_debug("API: sync since %u/%u: %s", ntohl(smsg->epoch),
+				   since, param.since ? "incremental" : "full");
+	} else {
+		struct msg_sync_lsdb *smsg;
+
+		smsg = (struct msg_sync_lsdb *)STREAM_DATA(msg->s);
+		filter = &smsg->filter;
+	}
+	param.filter = filter;
 
 	/* Remember mask. */
-	mask = ntohs(smsg->filter.typemask);
+	mask = ntohs(filter->typemask);
+
+	/* Deletions first, LSAs reinstalled since then are sent below. */
+	if (param.since)
+		apiserver_sync_tombs(&param, seqnum);
 
 	/* Iterate over all areas. */
 	for (ALL_LIST_ELEMENTS(ospf->areas, node, nnode, area)) {
-		int i;
-		uint32_t *area_id = NULL;
-
 		/* Compare area_id with area_ids in sync request. */
-		if ((i = smsg->filter.num_areas) > 0) {
-			/* Let area_id point to the list of area IDs,
-			 * which is at the end of smsg->filter. */
-			area_id = (uint32_t *)(&smsg->filter + 1);
-			while (i) {
-				if (*area_id == area->area_id.s_addr) {
-					break;
-				}
-				i--;
-				area_id++;
-			}
-		} else {
-			i = 1;
-		}
+		if (!apiserver_sync_area_match(filter, area->area_id))
+			continue;
 
-		/* If area was found, then i>0 here. */
-		if (i) {
-			/* Check msg type. */
-			if (mask & Power2[OSPF_ROUTER_LSA])
-				LSDB_LOOP (ROUTER_LSDB(area), rn, lsa)
-					apiserver_sync_callback(
-						lsa, (void *)&param, seqnum);
-			if (mask & Power2[OSPF_NETWORK_LSA])
-				LSDB_LOOP (NETWORK_LSDB(area), rn, lsa)
-					apiserver_sync_callback(
-						lsa, (void *)&param, seqnum);
-			if (mask & Power2[OSPF_SUMMARY_LSA])
-				LSDB_LOOP (SUMMARY_LSDB(area), rn, lsa)
-					apiserver_sync_callback(
-						lsa, (void *)&param, seqnum);
-			if (mask & Power2[OSPF_ASBR_SUMMARY_LSA])
-				LSDB_LOOP (ASBR_SUMMARY_LSDB(area), rn, lsa)
-					apiserver_sync_callback(
-						lsa, (void *)&param, seqnum);
-			if (mask & Power2[OSPF_OPAQUE_LINK_LSA])
-				LSDB_LOOP (OPAQUE_LINK_LSDB(area), rn, lsa)
-					apiserver_sync_callback(
-						lsa, (void *)&param, seqnum);
-			if (mask & Power2[OSPF_OPAQUE_AREA_LSA])
-				LSDB_LOOP (OPAQUE_AREA_LSDB(area), rn, lsa)
-					apiserver_sync_callback(
-						lsa, (void *)&param, seqnum);
-		}
+		/* Check msg type. */
+		if (mask & Power2[OSPF_ROUTER_LSA])
+			LSDB_LOOP (ROUTER_LSDB(area), rn, lsa)
+				apiserver_sync_callback(lsa, (void *)&param,
+							seqnum);
+		if (mask & Power2[OSPF_NETWORK_LSA])
+			LSDB_LOOP (NETWORK_LSDB(area), rn, lsa)
+				apiserver_sync_callback(lsa, (void *)&param,
+							seqnum);
+		if (mask & Power2[OSPF_SUMMARY_LSA])
+			LSDB_LOOP (SUMMARY_LSDB(area), rn, lsa)
+				apiserver_sync_callback(lsa, (void *)&param,
+							seqnum);
+		if (mask & Power2[OSPF_ASBR_SUMMARY_LSA])
+			LSDB_LOOP (ASBR_SUMMARY_LSDB(area), rn, lsa)
+				apiserver_sync_callback(lsa, (void *)&param,
+							seqnum);
+		if (mask & Power2[OSPF_OPAQUE_LINK_LSA])
+			LSDB_LOOP (OPAQUE_LINK_LSDB(area), rn, lsa)
+				apiserver_sync_callback(lsa, (void *)&param,
+							seqnum);
+		if (mask & Power2[OSPF_OPAQUE_AREA_LSA])
+			LSDB_LOOP (OPAQUE_AREA_LSDB(area), rn, lsa)
+				apiserver_sync_callback(lsa, (void *)&param,
+							seqnum);
 	}
 
 	/* For AS-external LSAs */
@@ -1344,9 +1452,15 @@ int ospf_apiserver_handle_sync_lsdb(struct ospf_apiserver *apiserv,
 							seqnum);
 	}
 
-	/* Send a reply back to client with return code */
-	rc = ospf_apiserver_send_reply(apiserv, seqnum, rc);
-	return rc;
+	/* Send a reply back to client with return code and the point in
+	   the change log it is now in sync with. */
+	reply = new_msg_reply_sync(seqnum, rc, apiserver_log.epoch,
+				   apiserver_log.gen);
+	if (!reply) {
+		zlog_warn("ospf_apiserver_handle_sync_lsdb: msg_new failed");
+		return -1;
+	}
+	return apiserver_queue_msg(apiserv, reply);
 }
 
 
@@ -2427,11 +2541,7 @@ static void apiserver_clients_lsa_change_notify(uint8_t msgtype,
 static int apiserver_notify_clients_lsa(uint8_t msgtype, struct ospf_lsa *lsa)
 {
 	struct msg *msg;
-	/* default area for AS-External and Opaque11 LSAs */
-	struct in_addr area_id = {.s_addr = 0L};
-
-	/* default interface for non Opaque9 LSAs */
-	struct in_addr ifaddr = {.s_addr = 0L};
+	struct in_addr area_id, ifaddr;
 
 	/* Only notify this update if the LSA's age is smaller than
 	   MAXAGE. Otherwise clients would see LSA updates with max age just
@@ -2441,12 +2551,7 @@ static int apiserver_notify_clients_lsa(uint8_t msgtype, struct ospf_lsa *lsa)
 		return 0;
 	}
 
-	if (lsa->area) {
-		area_id = lsa->area->area_id;
-	}
-	if (lsa->data->type == OSPF_OPAQUE_LINK_LSA) {
-		ifaddr = lsa->oi->address->u.prefix4;
-	}
+	apiserver_lsa_scope(lsa, &area_id, &ifaddr);
 	msg = new_msg_lsa_change_notify(msgtype, 0L, /* no sequence number */
 					ifaddr, area_id,
 					lsa->flags & OSPF_LSA_SELF, lsa->data);
@@ -2463,13 +2568,88 @@ static int apiserver_notify_clients_lsa(uint8_t msgtype, struct ospf_lsa *lsa)
 	return 0;
 }
 
+static void apiserver_log_next_gen(void)
+{
+	if (++apiserver_log.gen != 0)
+		return;
+
+	/* Wrapped: nobody can sync incrementally across this. */
+	apiserver_log.epoch++;
+	apiserver_log.gen = 1;
+	apiserver_log.lost = 0;
+	apiserver_log.count = 0;
+}
+
+static bool apiserver_tomb_is(struct apiserver_tomb *tomb,
+			      struct ospf_lsa *lsa)
+{
+	struct in_addr area_id, ifaddr;
+
+	apiserver_lsa_scope(lsa, &area_id, &ifaddr);
+	return tomb->hdr.type == lsa->data->type
+	       && tomb->hdr.id.s_addr == lsa->data->id.s_addr
+	       && tomb->hdr.adv_router.s_addr == lsa->data->adv_router.s_addr
+	       && tomb->area_id.s_addr == area_id.s_addr
+	       && tomb->ifaddr.s_addr == ifaddr.s_addr;
+}
+
+static void apiserver_log_update(struct ospf_lsa *lsa)
+{
+	struct apiserver_tomb *last;
+
+	apiserver_log_next_gen();
+	lsa->api_gen = apiserver_log.gen;
+
+	/*
+	 * The LSDB replaces an LSA instance by deleting the old one right
+	 * before adding the new one.  That is not a deletion as far as a
+	 * syncing client is concerned, and keeping it would fill the ring
+	 * with refreshes.
+	 */
+	if (!apiserver_log.count)
+		return;
+	last = &apiserver_log.tombs[(apiserver_log.head + OSPF_APISERVER_TOMBS
+				     - 1) % OSPF_APISERVER_TOMBS];
+	if (last->gen == lsa->api_gen - 1 && apiserver_tomb_is(last, lsa)) {
+		apiserver_log.head = (apiserver_log.head + OSPF_APISERVER_TOMBS
+				      - 1) % OSPF_APISERVER_TOMBS;
+		apiserver_log.count--;
+	}
+}
+
+static void apiserver_log_delete(struct ospf_lsa *lsa)
+{
+	struct apiserver_tomb *tomb;
+
+	if (!apiserver_log.tombs)
+		return;
+
+	apiserver_log_next_gen();
+
+	tomb = &apiserver_log.tombs[apiserver_log.head];
+	if (apiserver_log.count == OSPF_APISERVER_TOMBS)
+		apiserver_log.lost = tomb->gen;
+	else
+		apiserver_log.count++;
+	apiserver_log.head = (apiserver_log.head + 1) % OSPF_APISERVER_TOMBS;
+
+	tomb->gen = apiserver_log.gen;
+	apiserver_lsa_scope(lsa, &tomb->area_id, &tomb->ifaddr);
+	tomb->is_self = lsa->flags & OSPF_LSA_SELF;
+	/* header only, that is all a client needs to identify it */
+	tomb->hdr = *lsa->data;
+	tomb->hdr.length = htons(sizeof(struct lsa_header));
+}
+
 int ospf_apiserver_lsa_update(struct ospf_lsa *lsa)
 {
+	apiserver_log_update(lsa);
 	return apiserver_notify_clients_lsa(MSG_LSA_UPDATE_NOTIFY, lsa);
 }
 
 int ospf_apiserver_lsa_delete(struct ospf_lsa *lsa)
 {
+	apiserver_log_delete(lsa);
 	return apiserver_notify_clients_lsa(MSG_LSA_DELETE_NOTIFY, lsa);
 }
 
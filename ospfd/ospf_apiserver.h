@@ -26,6 +26,12 @@
 #define MTYPE_OSPF_APISERVER MTYPE_TMP
 #define MTYPE_OSPF_APISERVER_MSGFILTER MTYPE_TMP
 
+/* Deleted LSAs remembered for incremental LSDB sync */
+#define OSPF_APISERVER_TOMBS 16384
+
+/* Max. number of messages written out per write event */
+#define OSPF_APISERVER_WRITE_BATCH 256
+
 /* List of opaque types that application registered */
 struct registered_opaque_type {
 	uint8_t lsa_type;
@@ -729,6 +729,9 @@ void ospf_ase_register_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
 	/* We assume that if LSA is deleted from DB
 	   is is also deleted from this RT */
 	listnode_add(lst, ospf_lsa_lock(lsa)); /* external_lsas lst */
+
+	if (al->e[0].fwd_addr.s_addr != INADDR_ANY)
+		top->ase_fwd_lsa_count++;
 }
 
 void ospf_ase_unregister_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
@@ -748,6 +751,9 @@ void ospf_ase_unregister_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
 
 	if (rn) {
 		lst = rn->info;
+		if (listnode_lookup(lst, lsa)
+		    && al->e[0].fwd_addr.s_addr != INADDR_ANY)
+			top->ase_fwd_lsa_count--;
 		listnode_delete(lst, lsa);
 		ospf_lsa_unlock(&lsa); /* external_lsas list */
 		route_unlock_node(rn);
@@ -23,6 +23,9 @@
 
 #include "monotime.h"
 #include "linklist.h"
+#include "hash.h"
+#include "jhash.h"
+#include "vector.h"
 #include "prefix.h"
 #include "if.h"
 #include "command.h"
@@ -50,6 +53,145 @@
 
 extern struct zclient *zclient;
 
+DEFINE_MTYPE_STATIC(OSPFD, OSPF_RXMT_INDEX, "OSPF retransmit index")
+
+/*
+ * Neighbors having some instance of an LSA on their retransmit list, by LSA
+ * key.  Each neighbor of an instance owns a bit number, so flushing an LSA
+ * from the retransmit lists only visits the neighbors that may hold it,
+ * rather than every neighbor on every interface.
+ */
+struct ospf_rxmt_index {
+	uint8_t type;
+	struct in_addr id;
+	struct in_addr adv_router;
+
+	/* Number of bits set in nbrs */
+	uint32_t count;
+	uint32_t nwords;
+	uint64_t *nbrs;
+};
+
+static unsigned int ospf_rxmt_index_key(const void *arg)
+{
+	const struct ospf_rxmt_index *ri = arg;
+
+	return jhash_3words(ri->type, ri->id.s_addr, ri->adv_router.s_addr,
+			    0x8a2ef5c3);
+}
+
+static bool ospf_rxmt_index_cmp(const void *a, const void *b)
+{
+	const struct ospf_rxmt_index *ra = a, *rb = b;
+
+	return ra->type == rb->type && ra->id.s_addr == rb->id.s_addr
+	       && ra->adv_router.s_addr == rb->adv_router.s_addr;
+}
+
+static void *ospf_rxmt_index_alloc(void *arg)
+{
+	const struct ospf_rxmt_index *key = arg;
+	struct ospf_rxmt_index *ri;
+
+	ri = XCALLOC(MTYPE_OSPF_RXMT_INDEX, sizeof(*ri));
+	ri->type = key->type;
+	ri->id = key->id;
+	ri->adv_router = key->adv_router;
+
+	return ri;
+}
+
+static void ospf_rxmt_index_free(void *arg)
+{
+	struct ospf_rxmt_index *ri = arg;
+
+	XFREE(MTYPE_OSPF_RXMT_INDEX, ri->nbrs);
+	XFREE(MTYPE_OSPF_RXMT_INDEX, ri);
+}
+
+static void ospf_rxmt_index_key_set(struct ospf_rxmt_index *key,
+				    struct ospf_lsa *lsa)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = lsa->data->type;
+	key->id = lsa->data->id;
+	key->adv_router = lsa->data->adv_router;
+}
+
+static void ospf_rxmt_index_set(struct ospf_neighbor *nbr,
+				struct ospf_lsa *lsa)
+{
+	struct ospf *ospf = nbr->oi->ospf;
+	struct ospf_rxmt_index key, *ri;
+	uint32_t word = nbr->rxmt_bit / 64;
+	uint64_t mask = 1ULL << (nbr->rxmt_bit % 64);
+
+	ospf_rxmt_index_key_set(&key, lsa);
+	ri = hash_get(ospf->rxmt_index, &key, ospf_rxmt_index_alloc);
+
+	if (word >= ri->nwords) {
+		ri->nbrs = XREALLOC(MTYPE_OSPF_RXMT_INDEX, ri->nbrs,
+				    (word + 1) * sizeof(uint64_t));
+		memset(ri->nbrs + ri->nwords, 0,
+		       (word + 1 - ri->nwords) * sizeof(uint64_t));
+		ri->nwords = word + 1;
+	}
+
+	if (!(ri->nbrs[word] & mask)) {
+		ri->nbrs[word] |= mask;
+		ri->count++;
+	}
+}
+
+static void ospf_rxmt_index_unset(struct ospf_neighbor *nbr,
+				  struct ospf_lsa *lsa)
+{
+	struct ospf *ospf = nbr->oi->ospf;
+	struct ospf_rxmt_index key, *ri;
+	uint32_t word = nbr->rxmt_bit / 64;
+	uint64_t mask = 1ULL << (nbr->rxmt_bit % 64);
+
+	ospf_rxmt_index_key_set(&key, lsa);
+	ri = hash_lookup(ospf->rxmt_index, &key);
+	if (!ri || word >= ri->nwords || !(ri->nbrs[word] & mask))
+		return;
+
+	ri->nbrs[word] &= ~mask;
+	if (--ri->count == 0) {
+		hash_release(ospf->rxmt_index, ri);
+		ospf_rxmt_index_free(ri);
+	}
+}
+
+void ospf_ls_retransmit_index_init(struct ospf *ospf)
+{
+	ospf->rxmt_index = hash_create_size(1024, ospf_rxmt_index_key,
+					    ospf_rxmt_index_cmp,
+					    "OSPF retransmit index");
+	ospf->rxmt_nbrs = vector_init(VECTOR_MIN_SIZE);
+}
+
+void ospf_ls_retransmit_index_finish(struct ospf *ospf)
+{
+	hash_clean(ospf->rxmt_index, ospf_rxmt_index_free);
+	hash_free(ospf->rxmt_index);
+	ospf->rxmt_index = NULL;
+	vector_free(ospf->rxmt_nbrs);
+	ospf->rxmt_nbrs = NULL;
+}
+
+/* Give a new neighbor its bit number in the retransmit index. */
+void ospf_ls_retransmit_index_nbr_add(struct ospf_neighbor *nbr)
+{
+	nbr->rxmt_bit = vector_set(nbr->oi->ospf->rxmt_nbrs, nbr);
+}
+
+/* Neighbor's retransmit list must have been cleared already. */
+void ospf_ls_retransmit_index_nbr_del(struct ospf_neighbor *nbr)
+{
+	vector_unset(nbr->oi->ospf->rxmt_nbrs, nbr->rxmt_bit);
+}
+
 /* Do the LSA acking specified in table 19, Section 13.5, row 2
  * This get called from ospf_flood_out_interface. Declared inline
  * for speed. */
@@ -931,6 +1073,7 @@ void ospf_ls_retransmit_add(struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 				   ospf_get_name(nbr->oi->ospf),
 				   dump_lsa_key(lsa));
 		ospf_lsdb_add(&nbr->ls_rxmt, lsa);
+		ospf_rxmt_index_set(nbr, lsa);
 	}
 }
 
@@ -946,6 +1089,7 @@ void ospf_ls_retransmit_delete(struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 				   ospf_get_name(nbr->oi->ospf),
 				   dump_lsa_key(lsa));
 		ospf_lsdb_delete(&nbr->ls_rxmt, lsa);
+		ospf_rxmt_index_unset(nbr, lsa);
 	}
 }
 
@@ -978,45 +1122,62 @@ struct ospf_lsa *ospf_ls_retransmit_lookup(struct ospf_neighbor *nbr,
 	return ospf_lsdb_lookup(&nbr->ls_rxmt, lsa);
 }
 
-static void ospf_ls_retransmit_delete_nbr_if(struct ospf_interface *oi,
-					     struct ospf_lsa *lsa)
+/*
+ * Remove this instance of the LSA from the retransmit list of the neighbors
+ * in the area, or in the whole instance if area is NULL.
+ */
+static void ospf_ls_retransmit_delete_nbr_scope(struct ospf *ospf,
+						struct ospf_area *area,
+						struct ospf_lsa *lsa)
 {
-	struct route_node *rn;
+	struct ospf_rxmt_index key, *ri;
 	struct ospf_neighbor *nbr;
 	struct ospf_lsa *lsr;
+	uint64_t bits;
+	uint32_t word;
+	bool last;
 
-	if (ospf_if_is_enable(oi))
-		for (rn = route_top(oi->nbrs); rn; rn = route_next(rn))
-			/* If LSA find in LS-retransmit list, then remove it. */
-			if ((nbr = rn->info) != NULL) {
-				lsr = ospf_ls_retransmit_lookup(nbr, lsa);
+	ospf_rxmt_index_key_set(&key, lsa);
+	ri = hash_lookup(ospf->rxmt_index, &key);
+	if (!ri)
+		return;
 
-				/* If LSA find in ls-retransmit list, remove it.
-				 */
-				if (lsr != NULL
-				    && lsr->data->ls_seqnum
-					       == lsa->data->ls_seqnum)
-					ospf_ls_retransmit_delete(nbr, lsr);
-			}
+	for (word = 0; word < ri->nwords; word++) {
+		bits = ri->nbrs[word];
+
+		while (bits) {
+			nbr = vector_lookup(ospf->rxmt_nbrs,
+					    word * 64 + __builtin_ctzll(bits));
+			bits &= bits - 1;
+
+			if (!nbr || (area && nbr->oi->area != area)
+			    || !ospf_if_is_enable(nbr->oi))
+				continue;
+
+			/* If LSA find in ls-retransmit list, remove it. */
+			lsr = ospf_ls_retransmit_lookup(nbr, lsa);
+			if (lsr == NULL
+			    || lsr->data->ls_seqnum != lsa->data->ls_seqnum)
+				continue;
+
+			/* The index entry goes away with its last neighbor. */
+			last = (ri->count == 1);
+			ospf_ls_retransmit_delete(nbr, lsr);
+			if (last)
+				return;
+		}
+	}
 }
 
 void ospf_ls_retransmit_delete_nbr_area(struct ospf_area *area,
 					struct ospf_lsa *lsa)
 {
-	struct listnode *node, *nnode;
-	struct ospf_interface *oi;
-
-	for (ALL_LIST_ELEMENTS(area->oiflist, node, nnode, oi))
-		ospf_ls_retransmit_delete_nbr_if(oi, lsa);
+	ospf_ls_retransmit_delete_nbr_scope(area->ospf, area, lsa);
 }
 
 void ospf_ls_retransmit_delete_nbr_as(struct ospf *ospf, struct ospf_lsa *lsa)
 {
-	struct listnode *node, *nnode;
-	struct ospf_interface *oi;
-
-	for (ALL_LIST_ELEMENTS(ospf->oiflist, node, nnode, oi))
-		ospf_ls_retransmit_delete_nbr_if(oi, lsa);
+	ospf_ls_retransmit_delete_nbr_scope(ospf, NULL, lsa);
 }
 
 
@@ -55,6 +55,10 @@ extern void ospf_ls_retransmit_delete_nbr_area(struct ospf_area *,
 extern void ospf_ls_retransmit_delete_nbr_as(struct ospf *, struct ospf_lsa *);
 extern void ospf_ls_retransmit_add_nbr_all(struct ospf_interface *,
 					   struct ospf_lsa *);
+extern void ospf_ls_retransmit_index_init(struct ospf *ospf);
+extern void ospf_ls_retransmit_index_finish(struct ospf *ospf);
+extern void ospf_ls_retransmit_index_nbr_add(struct ospf_neighbor *nbr);
+extern void ospf_ls_retransmit_index_nbr_del(struct ospf_neighbor *nbr);
 
 extern void ospf_flood_lsa_area(struct ospf_lsa *, struct ospf_area *);
 extern void ospf_flood_lsa_as(struct ospf_lsa *);
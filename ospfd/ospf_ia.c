@@ -44,6 +44,7 @@
 #include "ospfd/ospf_abr.h"
 #include "ospfd/ospf_ia.h"
 #include "ospfd/ospf_dump.h"
+#include "ospfd/ospf_zebra.h"
 
 static struct ospf_route *ospf_find_abr_route(struct route_table *rtrs,
 					      struct prefix_ipv4 *abr,
@@ -690,3 +691,111 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 			OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs);
 	}
 }
+
+/*
+ * Partial route calculation for a changed summary-LSA: recompute the route
+ * to the one prefix it describes from all summary-LSAs for that prefix,
+ * instead of running the whole SPF and inter-area calculation.
+ *
+ * Only done where the inter-area route to a prefix depends on nothing but
+ * its summary-LSAs and the routes to their ABRs: on a non-ABR, for a
+ * prefix with neither an intra-area route nor an AS-external-LSA.  Returns
+ * -1 if the caller must schedule a full calculation instead.
+ */
+int ospf_ia_incremental_update(struct ospf *ospf, struct ospf_lsa *lsa)
+{
+	struct summary_lsa *sl = (struct summary_lsa *)lsa->data;
+	struct route_table *tmp;
+	struct route_node *rn, *start, *lsa_rn;
+	struct ospf_route *old_or, *new_or;
+	struct ospf_area *area;
+	struct listnode *node;
+	struct prefix_ipv4 p;
+	struct prefix_ls lp;
+
+	if (sl->header.type != OSPF_SUMMARY_LSA || IS_OSPF_ABR(ospf))
+		return -1;
+
+	/* Nothing computed yet, or a full calculation is on its way */
+	if (!ospf->new_table || !ospf->new_rtrs || ospf->t_spf_calc)
+		return -1;
+
+	p.family = AF_INET;
+	p.prefix = sl->header.id;
+	p.prefixlen = ip_masklen(sl->mask);
+	apply_mask_ipv4(&p);
+
+	rn = route_node_lookup(ospf->external_lsas, (struct prefix *)&p);
+	if (rn) {
+		route_unlock_node(rn);
+		if (rn->info && listcount((struct list *)rn->info))
+			return -1;
+	}
+
+	old_or = NULL;
+	rn = route_node_lookup(ospf->new_table, (struct prefix *)&p);
+	if (rn) {
+		route_unlock_node(rn);
+		old_or = rn->info;
+		/* Intra-area routes take precedence, nothing to do */
+		if (old_or && old_or->path_type == OSPF_PATH_INTRA_AREA)
+			return 0;
+	}
+
+	/* Rebuild the route from every summary-LSA with the same LS ID */
+	tmp = route_table_init();
+	memset(&lp, 0, sizeof(lp));
+	lp.prefixlen = 32;
+	lp.id = sl->header.id;
+
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area)) {
+		start = route_node_get(SUMMARY_LSDB(area), (struct prefix *)&lp);
+		for (lsa_rn = route_lock_node(start); lsa_rn;
+		     lsa_rn = route_next_until(lsa_rn, start))
+			if (lsa_rn->info)
+				process_summary_lsa(area, tmp, ospf->new_rtrs,
+						    lsa_rn->info);
+		route_unlock_node(start);
+	}
+
+	new_or = NULL;
+	rn = route_node_lookup(tmp, (struct prefix *)&p);
+	if (rn) {
+		new_or = rn->info;
+		rn->info = NULL;
+		route_unlock_node(rn);
+		route_unlock_node(rn);
+	}
+	ospf_route_table_free(tmp);
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("%s: summary-LSA for %pFX, route %s", __func__, &p,
+			   new_or ? (old_or ? "updated" : "added")
+				  : (old_or ? "removed" : "unreachable"));
+
+	if (new_or) {
+		if (!ospf_route_match_same(ospf->new_table, &p, new_or))
+			ospf_zebra_add(ospf, &p, new_or);
+	} else if (old_or)
+		ospf_zebra_delete(ospf, &p, old_or);
+
+	/* Swap the route in the current routing table */
+	if (old_or)
+		ospf_route_free(old_or);
+	rn = route_node_get(ospf->new_table, (struct prefix *)&p);
+	if (rn->info)
+		route_unlock_node(rn);
+	rn->info = new_or;
+	if (!new_or)
+		route_unlock_node(rn);
+
+	/* External routes may resolve their forwarding address through it */
+	if (ospf->ase_fwd_lsa_count) {
+		ospf_ase_calculate_schedule(ospf);
+		ospf_ase_calculate_timer_add(ospf);
+	}
+
+	ospf->ia_incremental_runs++;
+
+	return 0;
+}
@@ -226,8 +226,11 @@ struct ospf_interface {
 	/* Timer values. */
 	uint32_t v_ls_ack; /* Delayed Link State Acknowledgment */
 
+	/* Hello schedule entry, see ospf_hello_timer_on(). */
+	struct ospf_hello_sched_item hello_item;
+	int64_t hello_due; /* monotime, 0 if not scheduled */
+
 	/* Threads. */
-	struct thread *t_hello;		  /* timer */
 	struct thread *t_wait;		  /* timer */
 	struct thread *t_ls_ack;	  /* timer */
 	struct thread *t_ls_ack_direct;   /* event */
@@ -254,6 +257,16 @@ struct ospf_interface {
 
 	QOBJ_FIELDS
 };
+
+static inline int ospf_hello_sched_cmp(const struct ospf_interface *a,
+				       const struct ospf_interface *b)
+{
+	return numcmp(a->hello_due, b->hello_due);
+}
+
+DECLARE_HEAP(ospf_hello_sched, struct ospf_interface, hello_item,
+	     ospf_hello_sched_cmp)
+
 DECLARE_QOBJ_TYPE(ospf_interface)
 
 /* Prototypes. */
@@ -248,25 +248,108 @@ int ospf_dr_election(struct ospf_interface *oi)
 }
 
 
-int ospf_hello_timer(struct thread *thread)
+/*
+ * Hello transmission. Rather than one timer per interface, every interface
+ * sits on a per-instance heap ordered by the time its next Hello is due,
+ * and a single timer sends all Hellos due within OSPF_HELLO_BATCH_SLACK of
+ * each other. Second-granularity Hello intervals are additionally aligned
+ * to whole seconds so that interfaces sharing an interval stay in the same
+ * batch.
+ */
+#define OSPF_HELLO_BATCH_SLACK 10000 /* usec */
+
+static int ospf_hello_timer(struct thread *thread);
+
+static int64_t ospf_hello_next(struct ospf_interface *oi, int64_t now)
+{
+	if (OSPF_IF_PARAM(oi, fast_hello))
+		return now + (1000 / OSPF_IF_PARAM(oi, fast_hello)) * 1000;
+
+	now = (now + OSPF_HELLO_BATCH_SLACK) / 1000000 * 1000000;
+	return now + (int64_t)OSPF_IF_PARAM(oi, v_hello) * 1000000;
+}
+
+static void ospf_hello_sched_arm(struct ospf *ospf)
 {
 	struct ospf_interface *oi;
+	int64_t delay;
 
-	oi = THREAD_ARG(thread);
-	oi->t_hello = NULL;
+	oi = ospf_hello_sched_first(&ospf->hello_sched);
+	if (!oi) {
+		thread_cancel(&ospf->t_hello);
+		return;
+	}
 
-	if (IS_DEBUG_OSPF(ism, ISM_TIMERS))
-		zlog_debug("ISM[%s]: Timer (Hello timer expire)", IF_NAME(oi));
+	delay = oi->hello_due - monotime(NULL);
+	delay = delay > 0 ? (delay + 999) / 1000 : 0;
+
+	if (ospf->t_hello) {
+		if ((int64_t)thread_timer_remain_msec(ospf->t_hello) <= delay)
+			return;
+		thread_cancel(&ospf->t_hello);
+	}
+	thread_add_timer_msec(master, ospf_hello_timer, ospf, delay,
+			      &ospf->t_hello);
+}
+
+static int ospf_hello_timer(struct thread *thread)
+{
+	struct ospf *ospf;
+	struct ospf_interface *oi;
+	int64_t now;
 
-	/* Sending hello packet. */
-	ospf_hello_send(oi);
+	ospf = THREAD_ARG(thread);
+	ospf->t_hello = NULL;
 
-	/* Hello timer set. */
-	OSPF_HELLO_TIMER_ON(oi);
+	now = monotime(NULL);
+	while ((oi = ospf_hello_sched_first(&ospf->hello_sched))
+	       && oi->hello_due <= now + OSPF_HELLO_BATCH_SLACK) {
+		ospf_hello_sched_pop(&ospf->hello_sched);
+
+		if (IS_DEBUG_OSPF(ism, ISM_TIMERS))
+			zlog_debug("ISM[%s]: Timer (Hello timer expire)",
+				   IF_NAME(oi));
+
+		/* Sending hello packet. */
+		ospf_hello_send(oi);
+
+		/* Hello timer set. */
+		oi->hello_due = ospf_hello_next(oi, now);
+		ospf_hello_sched_add(&ospf->hello_sched, oi);
+	}
+
+	ospf_hello_sched_arm(ospf);
 
 	return 0;
 }
 
+/* Schedule the next Hello on an interface, or send the first one right
+ * away. Like thread_add_timer(), leaves an already pending Hello alone. */
+void ospf_hello_timer_on(struct ospf_interface *oi, bool immediate)
+{
+	int64_t now = monotime(NULL);
+
+	if (oi->hello_due)
+		return;
+
+	oi->hello_due = immediate ? now : ospf_hello_next(oi, now);
+	ospf_hello_sched_add(&oi->ospf->hello_sched, oi);
+
+	ospf_hello_sched_arm(oi->ospf);
+}
+
+void ospf_hello_timer_off(struct ospf_interface *oi)
+{
+	if (!oi->hello_due)
+		return;
+
+	ospf_hello_sched_del(&oi->ospf->hello_sched, oi);
+	oi->hello_due = 0;
+
+	if (!ospf_hello_sched_count(&oi->ospf->hello_sched))
+		thread_cancel(&oi->ospf->t_hello);
+}
+
 static int ospf_wait_timer(struct thread *thread)
 {
 	struct ospf_interface *oi;
@@ -294,14 +377,14 @@ static void ism_timer_set(struct ospf_interface *oi)
 		   interface parameters must be set to initial values, and
 		   timers are
 		   reset also. */
-		OSPF_ISM_TIMER_OFF(oi->t_hello);
+		ospf_hello_timer_off(oi);
 		OSPF_ISM_TIMER_OFF(oi->t_wait);
 		OSPF_ISM_TIMER_OFF(oi->t_ls_ack);
 		break;
 	case ISM_Loopback:
 		/* In this state, the interface may be looped back and will be
 		   unavailable for regular data traffic. */
-		OSPF_ISM_TIMER_OFF(oi->t_hello);
+		ospf_hello_timer_off(oi);
 		OSPF_ISM_TIMER_OFF(oi->t_wait);
 		OSPF_ISM_TIMER_OFF(oi->t_ls_ack);
 		break;
@@ -310,7 +393,7 @@ static void ism_timer_set(struct ospf_interface *oi)
 		   BDRouter. The router begin to receive and send Hello Packets.
 		   */
 		/* send first hello immediately */
-		OSPF_ISM_TIMER_MSEC_ON(oi->t_hello, ospf_hello_timer, 1);
+		ospf_hello_timer_on(oi, true);
 		OSPF_ISM_TIMER_ON(oi->t_wait, ospf_wait_timer,
 				  OSPF_IF_PARAM(oi, v_wait));
 		OSPF_ISM_TIMER_OFF(oi->t_ls_ack);
@@ -321,7 +404,7 @@ static void ism_timer_set(struct ospf_interface *oi)
 		   virtual link. The router attempts to form an adjacency with
 		   neighboring router. Hello packets are also sent. */
 		/* send first hello immediately */
-		OSPF_ISM_TIMER_MSEC_ON(oi->t_hello, ospf_hello_timer, 1);
+		ospf_hello_timer_on(oi, true);
 		OSPF_ISM_TIMER_OFF(oi->t_wait);
 		OSPF_ISM_TIMER_ON(oi->t_ls_ack, ospf_ls_ack_timer,
 				  oi->v_ls_ack);
@@ -331,7 +414,7 @@ static void ism_timer_set(struct ospf_interface *oi)
 		   network,
 		   and the router itself is neither Designated Router nor
 		   Backup Designated Router. */
-		OSPF_HELLO_TIMER_ON(oi);
+		ospf_hello_timer_on(oi, false);
 		OSPF_ISM_TIMER_OFF(oi->t_wait);
 		OSPF_ISM_TIMER_ON(oi->t_ls_ack, ospf_ls_ack_timer,
 				  oi->v_ls_ack);
@@ -340,7 +423,7 @@ static void ism_timer_set(struct ospf_interface *oi)
 		/* The network type of the interface is broadcast os NBMA
 		   network,
 		   and the router is Backup Designated Router. */
-		OSPF_HELLO_TIMER_ON(oi);
+		ospf_hello_timer_on(oi, false);
 		OSPF_ISM_TIMER_OFF(oi->t_wait);
 		OSPF_ISM_TIMER_ON(oi->t_ls_ack, ospf_ls_ack_timer,
 				  oi->v_ls_ack);
@@ -349,7 +432,7 @@ static void ism_timer_set(struct ospf_interface *oi)
 		/* The network type of the interface is broadcast or NBMA
 		   network,
 		   and the router is Designated Router. */
-		OSPF_HELLO_TIMER_ON(oi);
+		ospf_hello_timer_on(oi, false);
 		OSPF_ISM_TIMER_OFF(oi->t_wait);
 		OSPF_ISM_TIMER_ON(oi->t_ls_ack, ospf_ls_ack_timer,
 				  oi->v_ls_ack);
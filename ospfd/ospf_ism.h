@@ -64,20 +64,6 @@
 #define OSPF_ISM_TIMER_MSEC_ON(T, F, V)                                        \
 	thread_add_timer_msec(master, (F), oi, (V), &(T))
 
-/* convenience macro to set hello timer correctly, according to
- * whether fast-hello is set or not
- */
-#define OSPF_HELLO_TIMER_ON(O)                                                 \
-	do {                                                                   \
-		if (OSPF_IF_PARAM((O), fast_hello))                            \
-			OSPF_ISM_TIMER_MSEC_ON(                                \
-				(O)->t_hello, ospf_hello_timer,                \
-				1000 / OSPF_IF_PARAM((O), fast_hello));        \
-		else                                                           \
-			OSPF_ISM_TIMER_ON((O)->t_hello, ospf_hello_timer,      \
-					  OSPF_IF_PARAM((O), v_hello));        \
-	} while (0)
-
 /* Macro for OSPF ISM timer turn off. */
 #define OSPF_ISM_TIMER_OFF(X) thread_cancel(&(X))
 
@@ -92,7 +78,8 @@
 /* Prototypes. */
 extern int ospf_ism_event(struct thread *);
 extern void ism_change_status(struct ospf_interface *, int);
-extern int ospf_hello_timer(struct thread *thread);
+extern void ospf_hello_timer_on(struct ospf_interface *oi, bool immediate);
+extern void ospf_hello_timer_off(struct ospf_interface *oi);
 extern int ospf_dr_election(struct ospf_interface *oi);
 
 DECLARE_HOOK(ospf_ism_change,
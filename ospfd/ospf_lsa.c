@@ -50,6 +50,7 @@
 #include "ospfd/ospf_route.h"
 #include "ospfd/ospf_ase.h"
 #include "ospfd/ospf_zebra.h"
+#include "ospfd/ospf_ia.h"
 #include "ospfd/ospf_abr.h"
 #include "ospfd/ospf_errors.h"
 
@@ -2364,9 +2365,72 @@ struct ospf_lsa *ospf_external_lsa_refresh(struct ospf *ospf,
 
 /* LSA installation functions. */
 
+/*
+ * Return true if the only difference between two instances of a router-LSA
+ * is in their stub links, i.e. the shortest-path tree built from them is
+ * the same and only the stub networks hanging off it change.
+ */
+static bool ospf_router_lsa_stub_change(struct ospf_lsa *old,
+					struct ospf_lsa *new)
+{
+	struct router_lsa *rl1, *rl2;
+	struct router_lsa_link *l1, *l2;
+	uint8_t *p1, *p2, *lim1, *lim2;
+	size_t len;
+
+	if (IS_LSA_MAXAGE(old) || IS_LSA_MAXAGE(new))
+		return false;
+
+	if (old->data->options != new->data->options)
+		return false;
+
+	rl1 = (struct router_lsa *)old->data;
+	rl2 = (struct router_lsa *)new->data;
+	if (rl1->flags != rl2->flags)
+		return false;
+
+	p1 = ((uint8_t *)old->data) + OSPF_LSA_HEADER_SIZE + 4;
+	lim1 = ((uint8_t *)old->data) + ntohs(old->data->length);
+	p2 = ((uint8_t *)new->data) + OSPF_LSA_HEADER_SIZE + 4;
+	lim2 = ((uint8_t *)new->data) + ntohs(new->data->length);
+
+	for (;;) {
+		l1 = NULL;
+		while (p1 < lim1) {
+			l1 = (struct router_lsa_link *)p1;
+			p1 += OSPF_ROUTER_LSA_LINK_SIZE
+			      + (l1->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE);
+			if (l1->m[0].type != LSA_LINK_TYPE_STUB)
+				break;
+			l1 = NULL;
+		}
+
+		l2 = NULL;
+		while (p2 < lim2) {
+			l2 = (struct router_lsa_link *)p2;
+			p2 += OSPF_ROUTER_LSA_LINK_SIZE
+			      + (l2->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE);
+			if (l2->m[0].type != LSA_LINK_TYPE_STUB)
+				break;
+			l2 = NULL;
+		}
+
+		if (!l1 || !l2)
+			return !l1 && !l2;
+
+		len = OSPF_ROUTER_LSA_LINK_SIZE
+		      + (l1->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE);
+		if (l1->m[0].tos_count != l2->m[0].tos_count
+		    || (uint8_t *)l1 + len > lim1 || (uint8_t *)l2 + len > lim2
+		    || memcmp(l1, l2, len))
+			return false;
+	}
+}
+
 /* Install router-LSA to an area. */
 static struct ospf_lsa *
-ospf_router_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc)
+ospf_router_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc,
+			bool stub_change)
 {
 	struct ospf_area *area = new->area;
 
@@ -2391,7 +2455,13 @@ ospf_router_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc)
 
 		ospf_refresher_register_lsa(ospf, new);
 	}
-	if (rt_recalc)
+	/*
+	 * A change limited to another router's stub links leaves the
+	 * shortest-path tree as it is: only the stub routes need recomputing.
+	 */
+	if (rt_recalc && stub_change && !IS_LSA_SELF(new))
+		ospf_spf_calculate_schedule(ospf, SPF_FLAG_ROUTER_LSA_STUB_CHANGE);
+	else if (rt_recalc)
 		ospf_spf_calculate_schedule(ospf, SPF_FLAG_ROUTER_LSA_INSTALL);
 	return new;
 }
@@ -2443,12 +2513,9 @@ ospf_summary_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc)
    necessary to re-examine all the AS-external-LSAs.
 */
 
-#if 0
-      /* This doesn't exist yet... */
-      ospf_summary_incremental_update(new); */
-#else /* #if 0 */
-		ospf_spf_calculate_schedule(ospf, SPF_FLAG_SUMMARY_LSA_INSTALL);
-#endif /* #if 0 */
+		if (ospf_ia_incremental_update(ospf, new) < 0)
+			ospf_spf_calculate_schedule(
+				ospf, SPF_FLAG_SUMMARY_LSA_INSTALL);
 	}
 
 	if (IS_LSA_SELF(new))
@@ -2575,6 +2642,7 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 	struct ospf_lsa *old = NULL;
 	struct ospf_lsdb *lsdb = NULL;
 	int rt_recalc;
+	bool stub_change;
 
 	/* Set LSDB. */
 	switch (lsa->data->type) {
@@ -2625,6 +2693,7 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 
 	/* Do comparision and record if recalc needed. */
 	rt_recalc = 0;
+	stub_change = false;
 	if (old == NULL || ospf_lsa_different(old, lsa)) {
 		/* Ref rfc3623 section 3.2.3
 		 * Installing new lsa or change in the existing LSA
@@ -2637,6 +2706,9 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 			ospf_helper_handle_topo_chg(ospf, lsa);
 
 		rt_recalc = 1;
+
+		if (old && lsa->data->type == OSPF_ROUTER_LSA)
+			stub_change = ospf_router_lsa_stub_change(old, lsa);
 	}
 
 	/*
@@ -2689,7 +2761,8 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 	/* Do LSA specific installation process. */
 	switch (lsa->data->type) {
 	case OSPF_ROUTER_LSA:
-		new = ospf_router_lsa_install(ospf, lsa, rt_recalc);
+		new = ospf_router_lsa_install(ospf, lsa, rt_recalc,
+					      stub_change);
 		break;
 	case OSPF_NETWORK_LSA:
 		assert(oi);
@@ -2986,6 +3059,11 @@ static int ospf_lsa_maxage_walker_remover(struct ospf *ospf,
 			case OSPF_AS_NSSA_LSA:
 				ospf_ase_incremental_update(ospf, lsa);
 				break;
+			case OSPF_SUMMARY_LSA:
+				if (ospf_ia_incremental_update(ospf, lsa) < 0)
+					ospf_spf_calculate_schedule(
+						ospf, SPF_FLAG_MAXAGE);
+				break;
 			default:
 				ospf_spf_calculate_schedule(ospf,
 							    SPF_FLAG_MAXAGE);
@@ -3100,21 +3178,11 @@ struct ospf_lsa *ospf_lsa_lookup(struct ospf *ospf, struct ospf_area *area,
 struct ospf_lsa *ospf_lsa_lookup_by_id(struct ospf_area *area, uint32_t type,
 				       struct in_addr id)
 {
-	struct ospf_lsa *lsa;
-	struct route_node *rn;
-
 	switch (type) {
 	case OSPF_ROUTER_LSA:
 		return ospf_lsdb_lookup_by_id(area->lsdb, type, id, id);
 	case OSPF_NETWORK_LSA:
-		for (rn = route_top(NETWORK_LSDB(area)); rn;
-		     rn = route_next(rn))
-			if ((lsa = rn->info))
-				if (IPV4_ADDR_SAME(&lsa->data->id, &id)) {
-					route_unlock_node(rn);
-					return lsa;
-				}
-		break;
+		return ospf_lsdb_lookup_by_id_only(area->lsdb, type, id);
 	case OSPF_SUMMARY_LSA:
 	case OSPF_ASBR_SUMMARY_LSA:
 		/* Currently not used. */
@@ -3579,6 +3647,9 @@ void ospf_refresher_register_lsa(struct ospf *ospf, struct ospf_lsa *lsa)
 		int min_delay =
 			OSPF_LS_REFRESH_TIME - (2 * OSPF_LS_REFRESH_JITTER);
 		int max_delay = OSPF_LS_REFRESH_TIME - OSPF_LS_REFRESH_JITTER;
+		int nslots, first, i;
+		uint16_t slot;
+		unsigned int load, min_load = UINT_MAX;
 
 		/* We want to refresh the LSA within OSPF_LS_REFRESH_TIME which
 		 * is
@@ -3596,6 +3667,29 @@ void ospf_refresher_register_lsa(struct ospf *ospf, struct ospf_lsa *lsa)
 		index = (current_index + delay / OSPF_LSA_REFRESHER_GRANULARITY)
 			% (OSPF_LSA_REFRESHER_SLOTS);
 
+		/* Mass origination (e.g. redistributing a large table) would
+		 * otherwise pile up in the few slots of the jitter window.
+		 * Starting from the random slot, take the least loaded slot
+		 * of the window so that refreshes spread evenly.
+		 */
+		nslots = (max_delay - min_delay)
+			 / OSPF_LSA_REFRESHER_GRANULARITY;
+		first = (delay - min_delay) / OSPF_LSA_REFRESHER_GRANULARITY;
+		for (i = 0; i < nslots && min_load; i++) {
+			struct list *qs;
+
+			slot = (current_index
+				+ min_delay / OSPF_LSA_REFRESHER_GRANULARITY
+				+ (first + i) % nslots)
+			       % OSPF_LSA_REFRESHER_SLOTS;
+			qs = ospf->lsa_refresh_queue.qs[slot];
+			load = qs ? listcount(qs) : 0;
+			if (load < min_load) {
+				min_load = load;
+				index = slot;
+			}
+		}
+
 		if (IS_DEBUG_OSPF(lsa, LSA_REFRESH))
 			zlog_debug(
 				"LSA[Refresh:Type%d:%pI4]: age %d, added to index %d",
@@ -3608,6 +3702,7 @@ void ospf_refresher_register_lsa(struct ospf *ospf, struct ospf_lsa *lsa)
 		listnode_add(ospf->lsa_refresh_queue.qs[index],
 			     ospf_lsa_lock(lsa)); /* lsa_refresh_queue */
 		lsa->refresh_list = index;
+		ospf->lsa_refresh_queue.count++;
 
 		if (IS_DEBUG_OSPF(lsa, LSA_REFRESH))
 			zlog_debug(
@@ -3630,6 +3725,7 @@ void ospf_refresher_unregister_lsa(struct ospf *ospf, struct ospf_lsa *lsa)
 			ospf->lsa_refresh_queue.qs[lsa->refresh_list] = NULL;
 		}
 		lsa->refresh_list = -1;
+		ospf->lsa_refresh_queue.count--;
 		ospf_lsa_unlock(&lsa); /* lsa_refresh_queue */
 	}
 }
@@ -3642,6 +3738,9 @@ int ospf_lsa_refresh_walker(struct thread *t)
 	struct ospf_lsa *lsa;
 	int i;
 	struct list *lsa_to_refresh = list_new();
+	struct list *deferred;
+	uint32_t budget;
+	int nslots;
 
 	if (IS_DEBUG_OSPF(lsa, LSA_REFRESH))
 		zlog_debug("LSA[Refresh]: ospf_lsa_refresh_walker(): start");
@@ -3665,6 +3764,21 @@ int ospf_lsa_refresh_walker(struct thread *t)
 			"LSA[Refresh]: ospf_lsa_refresh_walker(): next index %d",
 			ospf->lsa_refresh_queue.index);
 
+	/*
+	 * Refresh at most twice the share of the queued LSAs that an even
+	 * spread over OSPF_LS_REFRESH_TIME would give the slots walked now.
+	 * The rest is deferred to the next run, which evens out bursts
+	 * within one refresh cycle. LSAs getting close to MaxAge are always
+	 * refreshed.
+	 */
+	nslots = (ospf->lsa_refresh_queue.index - i + OSPF_LSA_REFRESHER_SLOTS)
+		 % OSPF_LSA_REFRESHER_SLOTS;
+	budget = MAX(OSPF_LSA_REFRESH_BURST_MIN,
+		     (uint64_t)ospf->lsa_refresh_queue.count * 2 * nslots
+			     * OSPF_LSA_REFRESHER_GRANULARITY
+			     / OSPF_LS_REFRESH_TIME);
+	deferred = ospf->lsa_refresh_queue.qs[ospf->lsa_refresh_queue.index];
+
 	for (; i != ospf->lsa_refresh_queue.index;
 	     i = (i + 1) % OSPF_LSA_REFRESHER_SLOTS) {
 		if (IS_DEBUG_OSPF(lsa, LSA_REFRESH))
@@ -3690,13 +3804,30 @@ int ospf_lsa_refresh_walker(struct thread *t)
 
 				assert(lsa->lock > 0);
 				list_delete_node(refresh_list, node);
+
+				if (listcount(lsa_to_refresh) >= budget
+				    && LS_AGE(lsa) < OSPF_LS_REFRESH_DEADLINE) {
+					if (!deferred)
+						deferred = list_new();
+					listnode_add(deferred, lsa);
+					lsa->refresh_list =
+						ospf->lsa_refresh_queue.index;
+					ospf->lsa_refresh_queue.deferred++;
+					continue;
+				}
+
 				lsa->refresh_list = -1;
+				ospf->lsa_refresh_queue.count--;
 				listnode_add(lsa_to_refresh, lsa);
 			}
 			list_delete(&refresh_list);
 		}
 	}
 
+	ospf->lsa_refresh_queue.qs[ospf->lsa_refresh_queue.index] = deferred;
+	ospf->lsa_refresh_queue.last_refreshed = listcount(lsa_to_refresh);
+	ospf->lsa_refresh_queue.refreshed += listcount(lsa_to_refresh);
+
 	ospf->t_lsa_refresher = NULL;
 	thread_add_timer(master, ospf_lsa_refresh_walker, ospf,
 			 ospf->lsa_refresh_interval, &ospf->t_lsa_refresher);
@@ -122,6 +122,9 @@ struct ospf_lsa {
 
 	/*For topo chg detection in HELPER role*/
 	bool to_be_acknowledged;
+
+	/* Change generation when installed, for API incremental sync */
+	uint32_t api_gen;
 };
 
 /* OSPF LSA Link Type. */
@@ -169,15 +169,33 @@ void ospf_lsdb_delete_all(struct ospf_lsdb *lsdb)
 	}
 }
 
+/*
+ * Exact match lookups are served by the route table's node hash, the radix
+ * tree itself only provides the ordering for iteration.
+ */
 struct ospf_lsa *ospf_lsdb_lookup(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
+{
+	return ospf_lsdb_lookup_by_id(lsdb, lsa->data->type, lsa->data->id,
+				      lsa->data->adv_router);
+}
+
+struct ospf_lsa *ospf_lsdb_lookup_by_id(struct ospf_lsdb *lsdb, uint8_t type,
+					struct in_addr id,
+					struct in_addr adv_router)
 {
 	struct route_table *table;
 	struct prefix_ls lp;
 	struct route_node *rn;
 	struct ospf_lsa *find;
 
-	table = lsdb->type[lsa->data->type].db;
-	ls_prefix_set(&lp, lsa);
+	table = lsdb->type[type].db;
+
+	memset(&lp, 0, sizeof(struct prefix_ls));
+	lp.family = 0;
+	lp.prefixlen = 64;
+	lp.id = id;
+	lp.adv_router = adv_router;
+
 	rn = route_node_lookup(table, (struct prefix *)&lp);
 	if (rn) {
 		find = rn->info;
@@ -187,12 +205,16 @@ struct ospf_lsa *ospf_lsdb_lookup(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 	return NULL;
 }
 
-struct ospf_lsa *ospf_lsdb_lookup_by_id(struct ospf_lsdb *lsdb, uint8_t type,
-					struct in_addr id,
-					struct in_addr adv_router)
+/*
+ * Lookup an LSA by link state id alone, whatever its advertising router.
+ * Entries are keyed id first, so all candidates sit in the subtree of the
+ * 32 bit id prefix and only that subtree is visited.
+ */
+struct ospf_lsa *ospf_lsdb_lookup_by_id_only(struct ospf_lsdb *lsdb,
+					     uint8_t type, struct in_addr id)
 {
 	struct route_table *table;
-	struct prefix_ls lp;
+	struct prefix_ls lp, *np;
 	struct route_node *rn;
 	struct ospf_lsa *find;
 
@@ -200,16 +222,25 @@ struct ospf_lsa *ospf_lsdb_lookup_by_id(struct ospf_lsdb *lsdb, uint8_t type,
 
 	memset(&lp, 0, sizeof(struct prefix_ls));
 	lp.family = 0;
-	lp.prefixlen = 64;
+	lp.prefixlen = IPV4_MAX_BITLEN;
 	lp.id = id;
-	lp.adv_router = adv_router;
 
-	rn = route_node_lookup(table, (struct prefix *)&lp);
-	if (rn) {
-		find = rn->info;
-		route_unlock_node(rn);
-		return find;
+	for (rn = route_table_get_next(table, (struct prefix *)&lp); rn;
+	     rn = route_next(rn)) {
+		np = (struct prefix_ls *)&rn->p;
+		if (np->prefixlen < IPV4_MAX_BITLEN
+		    || !IPV4_ADDR_SAME(&np->id, &id))
+			break;
+
+		if (rn->info) {
+			find = rn->info;
+			route_unlock_node(rn);
+			return find;
+		}
 	}
+
+	if (rn)
+		route_unlock_node(rn);
 	return NULL;
 }
 
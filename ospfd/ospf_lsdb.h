@@ -70,6 +70,9 @@ extern void ospf_lsdb_delete_all(struct ospf_lsdb *);
 extern struct ospf_lsa *ospf_lsdb_lookup(struct ospf_lsdb *, struct ospf_lsa *);
 extern struct ospf_lsa *ospf_lsdb_lookup_by_id(struct ospf_lsdb *, uint8_t,
 					       struct in_addr, struct in_addr);
+extern struct ospf_lsa *ospf_lsdb_lookup_by_id_only(struct ospf_lsdb *lsdb,
+						    uint8_t type,
+						    struct in_addr id);
 extern struct ospf_lsa *ospf_lsdb_lookup_by_id_next(struct ospf_lsdb *, uint8_t,
 						    struct in_addr,
 						    struct in_addr, int);
@@ -50,6 +50,7 @@
 #include "ospfd/ospf_neighbor.h"
 #include "ospfd/ospf_dump.h"
 #include "ospfd/ospf_route.h"
+#include "ospfd/ospf_packet.h"
 #include "ospfd/ospf_zebra.h"
 #include "ospfd/ospf_vty.h"
 #include "ospfd/ospf_bfd.h"
@@ -239,6 +240,7 @@ int main(int argc, char **argv)
 	}
 
 	frr_config_fork();
+	ospf_rx_pthread_run();
 	frr_run(master);
 
 	/* Not reached. */
@@ -40,9 +40,7 @@ DEFINE_MTYPE(OSPFD, OSPF_LSA_DATA, "OSPF LSA data")
 DEFINE_MTYPE(OSPFD, OSPF_LSDB, "OSPF LSDB")
 DEFINE_MTYPE(OSPFD, OSPF_PACKET, "OSPF packet")
 DEFINE_MTYPE(OSPFD, OSPF_FIFO, "OSPF FIFO queue")
-DEFINE_MTYPE(OSPFD, OSPF_VERTEX, "OSPF vertex")
-DEFINE_MTYPE(OSPFD, OSPF_VERTEX_PARENT, "OSPF vertex parent")
-DEFINE_MTYPE(OSPFD, OSPF_NEXTHOP, "OSPF nexthop")
+DEFINE_MTYPE(OSPFD, OSPF_SPF_CHUNK, "OSPF SPF tree chunk")
 DEFINE_MTYPE(OSPFD, OSPF_PATH, "OSPF path")
 DEFINE_MTYPE(OSPFD, OSPF_VL_DATA, "OSPF VL data")
 DEFINE_MTYPE(OSPFD, OSPF_CRYPT_KEY, "OSPF crypt key")
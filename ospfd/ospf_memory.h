@@ -39,9 +39,7 @@ DECLARE_MTYPE(OSPF_LSA_DATA)
 DECLARE_MTYPE(OSPF_LSDB)
 DECLARE_MTYPE(OSPF_PACKET)
 DECLARE_MTYPE(OSPF_FIFO)
-DECLARE_MTYPE(OSPF_VERTEX)
-DECLARE_MTYPE(OSPF_VERTEX_PARENT)
-DECLARE_MTYPE(OSPF_NEXTHOP)
+DECLARE_MTYPE(OSPF_SPF_CHUNK)
 DECLARE_MTYPE(OSPF_PATH)
 DECLARE_MTYPE(OSPF_VL_DATA)
 DECLARE_MTYPE(OSPF_CRYPT_KEY)
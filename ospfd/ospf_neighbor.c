@@ -96,6 +96,7 @@ struct ospf_neighbor *ospf_nbr_new(struct ospf_interface *oi)
 	ospf_lsdb_init(&nbr->db_sum);
 	ospf_lsdb_init(&nbr->ls_rxmt);
 	ospf_lsdb_init(&nbr->ls_req);
+	ospf_ls_retransmit_index_nbr_add(nbr);
 
 	nbr->crypt_seqnum = 0;
 
@@ -125,6 +126,7 @@ void ospf_nbr_free(struct ospf_neighbor *nbr)
 	/* Free retransmit list. */
 	if (ospf_ls_retransmit_count(nbr))
 		ospf_ls_retransmit_clear(nbr);
+	ospf_ls_retransmit_index_nbr_del(nbr);
 
 	/* Cleanup LSDBs. */
 	ospf_lsdb_cleanup(&nbr->db_sum);
@@ -59,6 +59,8 @@ struct ospf_neighbor {
 
 	/* LSA data. */
 	struct ospf_lsdb ls_rxmt;
+	/* Bit number in the instance's retransmit index */
+	uint32_t rxmt_bit;
 	struct ospf_lsdb db_sum;
 	struct ospf_lsdb ls_req;
 	struct ospf_lsa *ls_req_last;
@@ -38,6 +38,7 @@
 #endif
 #include "vrf.h"
 #include "lib_errors.h"
+#include "frr_pthread.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_network.h"
@@ -114,7 +115,7 @@ static const uint16_t ospf_lsa_minlen[] = {
 };
 
 /* for ospf_check_auth() */
-static int ospf_check_sum(struct ospf_header *);
+static int ospf_check_sum(struct ospf_header *, uint16_t);
 
 /* OSPF authentication checking function */
 static int ospf_auth_type(struct ospf_interface *oi)
@@ -2286,13 +2287,12 @@ static void ospf_ls_ack(struct ip *iph, struct ospf_header *ospfh,
 }
 
 static struct stream *ospf_recv_packet(struct ospf *ospf, int fd,
-				       struct interface **ifp,
+				       ifindex_t *ifindex,
 				       struct stream *ibuf)
 {
 	int ret;
 	struct ip *iph;
 	uint16_t ip_len;
-	ifindex_t ifindex = 0;
 	struct iovec iov;
 	/* Header and data both require alignment. */
 	char buff[CMSG_SPACE(SOPT_SIZE_CMSG_IFINDEX_IPV4())];
@@ -2354,9 +2354,7 @@ static struct stream *ospf_recv_packet(struct ospf *ospf, int fd,
 	ip_len = ntohs(iph->ip_len) + (iph->ip_hl << 2);
 #endif
 
-	ifindex = getsockopt_ifindex(AF_INET, &msgh);
-
-	*ifp = if_lookup_by_index(ifindex, ospf->vrf_id);
+	*ifindex = getsockopt_ifindex(AF_INET, &msgh);
 
 	if (ret != ip_len) {
 		flog_warn(
@@ -2366,10 +2364,6 @@ static struct stream *ospf_recv_packet(struct ospf *ospf, int fd,
 		return NULL;
 	}
 
-	if (IS_DEBUG_OSPF_PACKET(0, RECV))
-		zlog_debug("%s: fd %d(%s) on interface %d(%s)", __func__, fd,
-			   ospf_get_name(ospf), ifindex,
-			   *ifp ? (*ifp)->name : "Unknown");
 	return ibuf;
 }
 
@@ -2459,7 +2453,8 @@ static int ospf_check_network_mask(struct ospf_interface *oi,
 /* Return 1, if the packet is properly authenticated and checksummed,
    0 otherwise. In particular, check that AuType header field is valid and
    matches the locally configured AuType, and that D.5 requirements are met. */
-static int ospf_check_auth(struct ospf_interface *oi, struct ospf_header *ospfh)
+static int ospf_check_auth(struct ospf_interface *oi, struct ospf_header *ospfh,
+			   uint16_t cksum)
 {
 	struct crypt_key *ck;
 	uint16_t iface_auth_type;
@@ -2477,7 +2472,7 @@ static int ospf_check_auth(struct ospf_interface *oi, struct ospf_header *ospfh)
 						   iface_auth_type, NULL));
 			return 0;
 		}
-		if (!ospf_check_sum(ospfh)) {
+		if (!ospf_check_sum(ospfh, cksum)) {
 			if (IS_DEBUG_OSPF_PACKET(ospfh->type - 1, RECV))
 				flog_warn(
 					EC_OSPF_PACKET,
@@ -2507,7 +2502,7 @@ static int ospf_check_auth(struct ospf_interface *oi, struct ospf_header *ospfh)
 					  IF_NAME(oi));
 			return 0;
 		}
-		if (!ospf_check_sum(ospfh)) {
+		if (!ospf_check_sum(ospfh, cksum)) {
 			if (IS_DEBUG_OSPF_PACKET(ospfh->type - 1, RECV))
 				flog_warn(
 					EC_OSPF_PACKET,
@@ -2563,24 +2558,44 @@ static int ospf_check_auth(struct ospf_interface *oi, struct ospf_header *ospfh)
 	}
 }
 
-static int ospf_check_sum(struct ospf_header *ospfh)
+/* Compute the header checksum of a received packet, leaving the packet
+ * untouched. Runs on the receive pthread.
+ */
+static uint16_t ospf_packet_cksum(struct ospf_header *ospfh)
+{
+	uint8_t auth_data[OSPF_AUTH_SIMPLE_SIZE];
+	uint16_t sum;
+	uint16_t ret;
+
+	/* clear auth_data and checksum for the calculation. */
+	memcpy(auth_data, ospfh->u.auth_data, OSPF_AUTH_SIMPLE_SIZE);
+	memset(ospfh->u.auth_data, 0, OSPF_AUTH_SIMPLE_SIZE);
+	sum = ospfh->checksum;
+	ospfh->checksum = 0;
+
+	ret = in_cksum(ospfh, ntohs(ospfh->length));
+
+	memcpy(ospfh->u.auth_data, auth_data, OSPF_AUTH_SIMPLE_SIZE);
+	ospfh->checksum = sum;
+
+	return ret;
+}
+
+static int ospf_check_sum(struct ospf_header *ospfh, uint16_t cksum)
 {
-	uint32_t ret;
 	uint16_t sum;
 
-	/* clear auth_data for checksum. */
+	/* clear auth_data. */
 	memset(ospfh->u.auth_data, 0, OSPF_AUTH_SIMPLE_SIZE);
 
 	/* keep checksum and clear. */
 	sum = ospfh->checksum;
 	memset(&ospfh->checksum, 0, sizeof(uint16_t));
 
-	/* calculate checksum. */
-	ret = in_cksum(ospfh, ntohs(ospfh->length));
-
-	if (ret != sum) {
+	/* compare with the checksum computed by the receive pthread. */
+	if (cksum != sum) {
 		zlog_info("ospf_check_sum(): checksum mismatch, my %X, his %X",
-			  ret, sum);
+			  cksum, sum);
 		return 0;
 	}
 
@@ -2907,7 +2922,8 @@ static unsigned ospf_packet_examin(struct ospf_header *oh,
 
 /* OSPF Header verification. */
 static int ospf_verify_header(struct stream *ibuf, struct ospf_interface *oi,
-			      struct ip *iph, struct ospf_header *ospfh)
+			      struct ip *iph, struct ospf_header *ospfh,
+			      uint16_t cksum)
 {
 	/* Check Area ID. */
 	if (!ospf_check_area_id(oi, ospfh)) {
@@ -2928,32 +2944,27 @@ static int ospf_verify_header(struct stream *ibuf, struct ospf_interface *oi,
 
 	/* Check authentication. The function handles logging actions, where
 	 * required. */
-	if (!ospf_check_auth(oi, ospfh))
+	if (!ospf_check_auth(oi, ospfh, cksum))
 		return -1;
 
 	return 0;
 }
 
-enum ospf_read_return_enum {
-	OSPF_READ_ERROR,
-	OSPF_READ_CONTINUE,
-};
+/* Receive pthread. */
+static struct frr_pthread *ospf_pth_rx;
 
-static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
+/*
+ * Structural validation of a packet freshly read into the receive buffer,
+ * done on the receive pthread. Nothing here may touch interface, area or
+ * neighbor state; packets that pass are copied out and queued for
+ * ospf_read() on the main pthread.
+ */
+static struct ospf_packet *ospf_rx_examin(struct stream *ibuf,
+					  ifindex_t ifindex)
 {
-	int ret;
-	struct stream *ibuf;
-	struct ospf_interface *oi;
+	struct ospf_packet *op;
 	struct ip *iph;
 	struct ospf_header *ospfh;
-	uint16_t length;
-	struct connected *c;
-	struct interface *ifp = NULL;
-
-	stream_reset(ospf->ibuf);
-	ibuf = ospf_recv_packet(ospf, ospf->fd, &ifp, ospf->ibuf);
-	if (ibuf == NULL)
-		return OSPF_READ_ERROR;
 
 	/*
 	 * This raw packet is known to be at least as big as its
@@ -2962,6 +2973,149 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 	 * stream data buffer.
 	 */
 	iph = (struct ip *)STREAM_DATA(ibuf);
+
+	/* Check that we have enough for an IP header */
+	if ((unsigned int)(iph->ip_hl << 2) >= STREAM_READABLE(ibuf)) {
+		if ((unsigned int)(iph->ip_hl << 2) == STREAM_READABLE(ibuf)) {
+			flog_warn(
+				EC_OSPF_PACKET,
+				"Rx'd IP packet with OSPF protocol number but no payload");
+		} else {
+			flog_warn(
+				EC_OSPF_PACKET,
+				"IP header length field claims header is %u bytes, but we only have %zu",
+				(unsigned int)(iph->ip_hl << 2),
+				STREAM_READABLE(ibuf));
+		}
+
+		return NULL;
+	}
+	stream_forward_getp(ibuf, iph->ip_hl << 2);
+
+	ospfh = (struct ospf_header *)stream_pnt(ibuf);
+	if (MSG_OK
+	    != ospf_packet_examin(ospfh, stream_get_endp(ibuf)
+						 - stream_get_getp(ibuf)))
+		return NULL;
+
+	op = ospf_packet_new(stream_get_endp(ibuf));
+	stream_put(op->s, STREAM_DATA(ibuf), stream_get_endp(ibuf));
+	op->length = stream_get_endp(ibuf);
+	op->ifindex = ifindex;
+
+	/* Crypto auth carries no checksum, see ospf_check_auth(). */
+	if (ntohs(ospfh->auth_type) != OSPF_AUTH_CRYPTOGRAPHIC)
+		op->cksum = ospf_packet_cksum(ospfh);
+
+	return op;
+}
+
+/* Socket read task, runs on the receive pthread. */
+static int ospf_rx_read(struct thread *thread)
+{
+	struct ospf *ospf;
+	struct ospf_packet *op;
+	ifindex_t ifindex = 0;
+	int32_t count = 0;
+	bool queued = false;
+
+	ospf = THREAD_ARG(thread);
+
+	/* prepare for next packet. */
+	thread_add_read(ospf_pth_rx->master, ospf_rx_read, ospf, ospf->fd,
+			&ospf->t_rx);
+
+	while (count < ospf->write_oi_count) {
+		count++;
+		stream_reset(ospf->ibuf);
+		if (ospf_recv_packet(ospf, ospf->fd, &ifindex, ospf->ibuf)
+		    == NULL)
+			break;
+
+		op = ospf_rx_examin(ospf->ibuf, ifindex);
+		if (op == NULL)
+			continue;
+
+		frr_with_mutex(&ospf->rx_mtx) {
+			ospf_fifo_push(ospf->rx_fifo, op);
+		}
+		queued = true;
+	}
+
+	if (queued)
+		thread_add_event(master, ospf_read, ospf, 0, &ospf->t_read);
+
+	return 0;
+}
+
+void ospf_rx_pthread_init(void)
+{
+	struct frr_pthread_attr rx = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+
+	assert(!ospf_pth_rx);
+	ospf_pth_rx = frr_pthread_new(&rx, "OSPF Rx thread", "ospfd_rx");
+}
+
+void ospf_rx_pthread_run(void)
+{
+	frr_pthread_run(ospf_pth_rx, NULL);
+
+	/* Wait until thread is ready. */
+	frr_pthread_wait_running(ospf_pth_rx);
+}
+
+/* Start reading from the instance socket. */
+void ospf_rx_on(struct ospf *ospf)
+{
+	if (ospf->fd < 0)
+		return;
+
+	thread_add_read(ospf_pth_rx->master, ospf_rx_read, ospf, ospf->fd,
+			&ospf->t_rx);
+}
+
+/*
+ * Stop reading from the instance socket and drop anything still queued.
+ * Must be called before the socket is closed.
+ */
+void ospf_rx_off(struct ospf *ospf)
+{
+	if (atomic_load_explicit(&ospf_pth_rx->running, memory_order_relaxed))
+		thread_cancel_async(ospf_pth_rx->master, &ospf->t_rx, NULL);
+	else
+		thread_cancel(&ospf->t_rx);
+
+	thread_cancel(&ospf->t_read);
+
+	frr_with_mutex(&ospf->rx_mtx) {
+		ospf_fifo_flush(ospf->rx_fifo);
+	}
+}
+
+static void ospf_read_helper(struct ospf *ospf, struct ospf_packet *op)
+{
+	int ret;
+	struct stream *ibuf;
+	struct ospf_interface *oi;
+	struct ip *iph;
+	struct ospf_header *ospfh;
+	uint16_t length;
+	struct connected *c;
+	struct interface *ifp;
+
+	ibuf = op->s;
+	iph = (struct ip *)STREAM_DATA(ibuf);
+
+	ifp = if_lookup_by_index(op->ifindex, ospf->vrf_id);
+
+	if (IS_DEBUG_OSPF_PACKET(0, RECV))
+		zlog_debug("%s: fd %d(%s) on interface %d(%s)", __func__,
+			   ospf->fd, ospf_get_name(ospf), op->ifindex,
+			   ifp ? ifp->name : "Unknown");
+
 	/*
 	 * Note that sockopt_iphdrincl_swab_systoh was called in
 	 * ospf_recv_packet.
@@ -2983,7 +3137,7 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 					"%s: Unable to determine incoming interface from: %pI4(%s)",
 					__func__, &iph->ip_src,
 					ospf_get_name(ospf));
-			return OSPF_READ_CONTINUE;
+			return;
 		}
 	}
 
@@ -2994,32 +3148,13 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 				"ospf_read[%pI4]: Dropping self-originated packet",
 				&iph->ip_src);
 		}
-		return OSPF_READ_CONTINUE;
+		return;
 	}
 
-	/* Check that we have enough for an IP header */
-	if ((unsigned int)(iph->ip_hl << 2) >= STREAM_READABLE(ibuf)) {
-		if ((unsigned int)(iph->ip_hl << 2) == STREAM_READABLE(ibuf)) {
-			flog_warn(
-				EC_OSPF_PACKET,
-				"Rx'd IP packet with OSPF protocol number but no payload");
-		} else {
-			flog_warn(
-				EC_OSPF_PACKET,
-				"IP header length field claims header is %u bytes, but we only have %zu",
-				(unsigned int)(iph->ip_hl << 2),
-				STREAM_READABLE(ibuf));
-		}
-
-		return OSPF_READ_ERROR;
-	}
 	stream_forward_getp(ibuf, iph->ip_hl << 2);
 
+	/* ospf_packet_examin() was run by the receive pthread. */
 	ospfh = (struct ospf_header *)stream_pnt(ibuf);
-	if (MSG_OK
-	    != ospf_packet_examin(ospfh, stream_get_endp(ibuf)
-						 - stream_get_getp(ibuf)))
-		return OSPF_READ_CONTINUE;
 	/* Now it is safe to access all fields of OSPF packet header. */
 
 	/* associate packet with ospf interface */
@@ -3055,7 +3190,7 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 			OI_MEMBER_JOINED(oi, MEMBER_ALLROUTERS);
 			ospf_if_set_multicast(oi);
 		}
-		return OSPF_READ_CONTINUE;
+		return;
 	}
 
 
@@ -3072,7 +3207,7 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 				zlog_debug(
 					"Packet from [%pI4] received on link %s but no ospf_interface",
 					&iph->ip_src, ifp->name);
-			return OSPF_READ_CONTINUE;
+			return;
 		}
 	}
 
@@ -3085,7 +3220,7 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 			flog_warn(EC_OSPF_PACKET,
 				  "Packet from [%pI4] received on wrong link %s",
 				  &iph->ip_src, ifp->name);
-		return OSPF_READ_CONTINUE;
+		return;
 	} else if (oi->state == ISM_Down) {
 		char buf[2][INET_ADDRSTRLEN];
 
@@ -3104,7 +3239,7 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 			OI_MEMBER_JOINED(oi, MEMBER_DROUTERS);
 		if (oi->multicast_memberships)
 			ospf_if_set_multicast(oi);
-		return OSPF_READ_CONTINUE;
+		return;
 	}
 
 	/*
@@ -3124,17 +3259,17 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 		/* Try to fix multicast membership. */
 		SET_FLAG(oi->multicast_memberships, MEMBER_DROUTERS);
 		ospf_if_set_multicast(oi);
-		return OSPF_READ_CONTINUE;
+		return;
 	}
 
 	/* Verify more OSPF header fields. */
-	ret = ospf_verify_header(ibuf, oi, iph, ospfh);
+	ret = ospf_verify_header(ibuf, oi, iph, ospfh, op->cksum);
 	if (ret < 0) {
 		if (IS_DEBUG_OSPF_PACKET(0, RECV))
 			zlog_debug(
 				"ospf_read[%pI4]: Header check failed, dropping.",
 				&iph->ip_src);
-		return OSPF_READ_CONTINUE;
+		return;
 	}
 
 	/* Show debug receiving packet. */
@@ -3186,34 +3321,38 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 			IF_NAME(oi), ospf_get_name(ospf), ospfh->type);
 		break;
 	}
-
-	return OSPF_READ_CONTINUE;
 }
 
 /* Starting point of packet process function. */
 int ospf_read(struct thread *thread)
 {
 	struct ospf *ospf;
+	struct ospf_packet *op;
 	int32_t count = 0;
-	enum ospf_read_return_enum ret;
+	unsigned long pending;
 
-	/* first of all get interface pointer. */
 	ospf = THREAD_ARG(thread);
 
-	/* prepare for next packet. */
-	thread_add_read(master, ospf_read, ospf, ospf->fd, &ospf->t_read);
-
 	while (count < ospf->write_oi_count) {
-		count++;
-		ret = ospf_read_helper(ospf);
-		switch (ret) {
-		case OSPF_READ_ERROR:
-			return -1;
-		case OSPF_READ_CONTINUE:
-			break;
+		frr_with_mutex(&ospf->rx_mtx) {
+			op = ospf_fifo_pop(ospf->rx_fifo);
 		}
+		if (op == NULL)
+			break;
+
+		count++;
+		ospf_read_helper(ospf, op);
+		ospf_packet_free(op);
+	}
+
+	frr_with_mutex(&ospf->rx_mtx) {
+		pending = ospf->rx_fifo->count;
 	}
 
+	/* Yield to other events, come back for the rest. */
+	if (pending)
+		thread_add_event(master, ospf_read, ospf, 0, &ospf->t_read);
+
 	return 0;
 }
 
@@ -3654,7 +3793,9 @@ static int ospf_make_ls_ack(struct ospf_interface *oi, struct list *ack,
 	return length;
 }
 
-static void ospf_hello_send_sub(struct ospf_interface *oi, in_addr_t addr)
+/* Build a Hello for the interface, ready to be queued to any destination.
+ * Returns NULL if it would overshoot the MTU. */
+static struct ospf_packet *ospf_hello_make(struct ospf_interface *oi)
 {
 	struct ospf_packet *op;
 	uint16_t length = OSPF_HEADER_SIZE;
@@ -3669,7 +3810,7 @@ static void ospf_hello_send_sub(struct ospf_interface *oi, in_addr_t addr)
 	if (length == OSPF_HEADER_SIZE) {
 		/* Hello overshooting MTU */
 		ospf_packet_free(op);
-		return;
+		return NULL;
 	}
 
 	/* Fill OSPF header. */
@@ -3678,6 +3819,12 @@ static void ospf_hello_send_sub(struct ospf_interface *oi, in_addr_t addr)
 	/* Set packet length. */
 	op->length = length;
 
+	return op;
+}
+
+static void ospf_hello_queue(struct ospf_interface *oi, struct ospf_packet *op,
+			     in_addr_t addr)
+{
 	op->dst.s_addr = addr;
 
 	if (IS_DEBUG_OSPF_EVENT) {
@@ -3697,6 +3844,15 @@ static void ospf_hello_send_sub(struct ospf_interface *oi, in_addr_t addr)
 	OSPF_ISM_WRITE_ON(oi->ospf);
 }
 
+static void ospf_hello_send_sub(struct ospf_interface *oi, in_addr_t addr)
+{
+	struct ospf_packet *op;
+
+	op = ospf_hello_make(oi);
+	if (op)
+		ospf_hello_queue(oi, op, addr);
+}
+
 static void ospf_poll_send(struct ospf_nbr_nbma *nbr_nbma)
 {
 	struct ospf_interface *oi;
@@ -3771,6 +3927,8 @@ void ospf_hello_send(struct ospf_interface *oi)
 	if (oi->type == OSPF_IFTYPE_NBMA) {
 		struct ospf_neighbor *nbr;
 		struct route_node *rn;
+		struct ospf_packet *hello = NULL;
+		bool made = false;
 
 		for (rn = route_top(oi->nbrs); rn; rn = route_next(rn))
 			if ((nbr = rn->info))
@@ -3815,11 +3973,27 @@ void ospf_hello_send(struct ospf_interface *oi)
 							continue;
 						/* if oi->state == Waiting, send
 						 * hello to all neighbors */
-						ospf_hello_send_sub(
-							oi,
-							nbr->address.u.prefix4
-								.s_addr);
+
+						/* The Hello does not depend on
+						 * the destination, build it
+						 * once and copy it per
+						 * neighbor. */
+						if (!made) {
+							hello = ospf_hello_make(
+								oi);
+							made = true;
+						}
+						if (hello)
+							ospf_hello_queue(
+								oi,
+								ospf_packet_dup(
+									hello),
+								nbr->address.u
+									.prefix4
+									.s_addr);
 					}
+		if (hello)
+			ospf_packet_free(hello);
 	} else {
 		/* Decide destination address. */
 		if (oi->type == OSPF_IFTYPE_VIRTUALLINK)
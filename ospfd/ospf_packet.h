@@ -60,6 +60,11 @@ struct ospf_packet {
 
 	/* OSPF packet length. */
 	uint16_t length;
+
+	/* Receive side: incoming ifindex and header checksum as computed
+	 * by the receive pthread (unused for cryptographic auth). */
+	ifindex_t ifindex;
+	uint16_t cksum;
 };
 
 /* OSPF packet queue structure. */
@@ -140,6 +145,10 @@ extern void ospf_fifo_flush(struct ospf_fifo *);
 extern void ospf_fifo_free(struct ospf_fifo *);
 
 extern int ospf_read(struct thread *);
+extern void ospf_rx_pthread_init(void);
+extern void ospf_rx_pthread_run(void);
+extern void ospf_rx_on(struct ospf *ospf);
+extern void ospf_rx_off(struct ospf *ospf);
 extern void ospf_hello_send(struct ospf_interface *);
 extern void ospf_db_desc_send(struct ospf_neighbor *);
 extern void ospf_db_desc_resend(struct ospf_neighbor *);
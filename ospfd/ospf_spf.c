@@ -47,6 +47,7 @@
 #include "ospfd/ospf_dump.h"
 #include "ospfd/ospf_sr.h"
 #include "ospfd/ospf_errors.h"
+#include "ospfd/ospf_trace.h"
 
 /* Variables to ensure a SPF scheduled log message is printed only once */
 
@@ -62,6 +63,12 @@ static void ospf_clear_spf_reason_flags(void)
 	spf_reason_flags = 0;
 }
 
+/* Reasons for which the previous shortest-path trees remain valid */
+#define SPF_PARTIAL_REASONS                                                    \
+	((1 << SPF_FLAG_ROUTER_LSA_STUB_CHANGE)                                \
+	 | (1 << SPF_FLAG_SUMMARY_LSA_INSTALL)                                 \
+	 | (1 << SPF_FLAG_ASBR_SUMMARY_LSA_INSTALL))
+
 static void ospf_spf_set_reason(ospf_spf_reason_t reason)
 {
 	spf_reason_flags |= 1 << reason;
@@ -88,7 +95,7 @@ static int vertex_cmp(const struct vertex *v1, const struct vertex *v2)
 	}
 	return 0;
 }
-DECLARE_SKIPLIST_NONUNIQ(vertex_pqueue, struct vertex, pqi, vertex_cmp)
+DECLARE_HEAP(vertex_pqueue, struct vertex, pqi, vertex_cmp)
 
 static void lsdb_clean_stat(struct ospf_lsdb *lsdb)
 {
@@ -105,60 +112,70 @@ static void lsdb_clean_stat(struct ospf_lsdb *lsdb)
 	}
 }
 
-static struct vertex_nexthop *vertex_nexthop_new(void)
-{
-	return XCALLOC(MTYPE_OSPF_NEXTHOP, sizeof(struct vertex_nexthop));
-}
+/*
+ * Vertices, parents and nexthops of an area's shortest-path tree are carved
+ * out of chunks hanging off the area, and are all released at once together
+ * with the tree.  Parents flushed in favour of a better path, and nexthops
+ * shared between parents, simply stay in the chunk until then.
+ */
+#define OSPF_SPF_CHUNK_SIZE 16384
+
+struct ospf_spf_chunk {
+	struct ospf_spf_chunk *next;
+	size_t used, size;
+	uint64_t data[];
+};
 
-static void vertex_nexthop_free(struct vertex_nexthop *nh)
+static void *ospf_spf_alloc(struct ospf_area *area, size_t size)
 {
-	XFREE(MTYPE_OSPF_NEXTHOP, nh);
+	struct ospf_spf_chunk *chunk = area->spf_chunks;
+	void *p;
+
+	size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+	if (!chunk || chunk->used + size > chunk->size) {
+		size_t len = MAX(size, OSPF_SPF_CHUNK_SIZE - sizeof(*chunk));
+
+		chunk = XMALLOC(MTYPE_OSPF_SPF_CHUNK, sizeof(*chunk) + len);
+		chunk->used = 0;
+		chunk->size = len;
+		chunk->next = area->spf_chunks;
+		area->spf_chunks = chunk;
+	}
+
+	p = (uint8_t *)chunk->data + chunk->used;
+	chunk->used += size;
+	memset(p, 0, size);
+
+	return p;
 }
 
-/*
- * Free the canonical nexthop objects for an area, ie the nexthop objects
- * attached to the first-hop router vertices, and any intervening network
- * vertices.
- */
-static void ospf_canonical_nexthops_free(struct vertex *root)
+static void ospf_spf_chunks_free(struct ospf_area *area)
 {
-	struct listnode *node, *nnode;
-	struct vertex *child;
-
-	for (ALL_LIST_ELEMENTS(root->children, node, nnode, child)) {
-		struct listnode *n2, *nn2;
-		struct vertex_parent *vp;
+	struct ospf_spf_chunk *chunk;
 
-		/*
-		 * router vertices through an attached network each
-		 * have a distinct (canonical / not inherited) nexthop
-		 * which must be freed.
-		 *
-		 * A network vertex can only have router vertices as its
-		 * children, so only one level of recursion is possible.
-		 */
-		if (child->type == OSPF_VERTEX_NETWORK)
-			ospf_canonical_nexthops_free(child);
-
-		/* Free child nexthops pointing back to this root vertex */
-		for (ALL_LIST_ELEMENTS(child->parents, n2, nn2, vp))
-			if (vp->parent == root && vp->nexthop) {
-				vertex_nexthop_free(vp->nexthop);
-				vp->nexthop = NULL;
-			}
+	while ((chunk = area->spf_chunks)) {
+		area->spf_chunks = chunk->next;
+		XFREE(MTYPE_OSPF_SPF_CHUNK, chunk);
 	}
 }
 
+static struct vertex_nexthop *vertex_nexthop_new(struct ospf_area *area)
+{
+	return ospf_spf_alloc(area, sizeof(struct vertex_nexthop));
+}
+
 /*
  * TODO: Parent list should be excised, in favour of maintaining only
  * vertex_nexthop, with refcounts.
  */
-static struct vertex_parent *vertex_parent_new(struct vertex *v, int backlink,
+static struct vertex_parent *vertex_parent_new(struct ospf_area *area,
+					       struct vertex *v, int backlink,
 					       struct vertex_nexthop *hop)
 {
 	struct vertex_parent *new;
 
-	new = XMALLOC(MTYPE_OSPF_VERTEX_PARENT, sizeof(struct vertex_parent));
+	new = ospf_spf_alloc(area, sizeof(struct vertex_parent));
 
 	new->parent = v;
 	new->backlink = backlink;
@@ -167,11 +184,6 @@ static struct vertex_parent *vertex_parent_new(struct vertex *v, int backlink,
 	return new;
 }
 
-static void vertex_parent_free(void *p)
-{
-	XFREE(MTYPE_OSPF_VERTEX_PARENT, p);
-}
-
 static int vertex_parent_cmp(void *aa, void *bb)
 {
 	struct vertex_parent *a = aa, *b = bb;
@@ -183,7 +195,7 @@ static struct vertex *ospf_vertex_new(struct ospf_area *area,
 {
 	struct vertex *new;
 
-	new = XCALLOC(MTYPE_OSPF_VERTEX, sizeof(struct vertex));
+	new = ospf_spf_alloc(area, sizeof(struct vertex));
 
 	new->flags = 0;
 	new->type = lsa->data->type;
@@ -191,7 +203,6 @@ static struct vertex *ospf_vertex_new(struct ospf_area *area,
 	new->lsa = lsa->data;
 	new->children = list_new();
 	new->parents = list_new();
-	new->parents->del = vertex_parent_free;
 	new->parents->cmp = vertex_parent_cmp;
 	new->lsa_p = lsa;
 
@@ -215,7 +226,7 @@ static void ospf_vertex_free(void *data)
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug("%s: Free %s vertex %pI4", __func__,
 			   v->type == OSPF_VERTEX_ROUTER ? "Router" : "Network",
-			   &v->lsa->id);
+			   &v->id);
 
 	if (v->children)
 		list_delete(&v->children);
@@ -224,8 +235,6 @@ static void ospf_vertex_free(void *data)
 		list_delete(&v->parents);
 
 	v->lsa = NULL;
-
-	XFREE(MTYPE_OSPF_VERTEX, v);
 }
 
 static void ospf_vertex_dump(const char *msg, struct vertex *v,
@@ -294,6 +303,7 @@ static void ospf_spf_init(struct ospf_area *area, struct ospf_lsa *root_lsa,
 	vertex_list = list_new();
 	vertex_list->del = ospf_vertex_free;
 	area->spf_vertex_list = vertex_list;
+	area->spf_vertex_order = list_new();
 
 	/* Create root node. */
 	v = ospf_vertex_new(area, root_lsa);
@@ -411,21 +421,16 @@ ospf_get_next_link(struct vertex *v, struct vertex *w,
 
 static void ospf_spf_flush_parents(struct vertex *w)
 {
-	struct vertex_parent *vp;
-	struct listnode *ln, *nn;
-
 	/* delete the existing nexthops */
-	for (ALL_LIST_ELEMENTS(w->parents, ln, nn, vp)) {
-		list_delete_node(w->parents, ln);
-		vertex_parent_free(vp);
-	}
+	list_delete_all_node(w->parents);
 }
 
 /*
  * Consider supplied next-hop for inclusion to the supplied list of
  * equal-cost next-hops, adjust list as neccessary.
  */
-static void ospf_spf_add_parent(struct vertex *v, struct vertex *w,
+static void ospf_spf_add_parent(struct ospf_area *area, struct vertex *v,
+				struct vertex *w,
 				struct vertex_nexthop *newhop,
 				unsigned int distance)
 {
@@ -482,7 +487,8 @@ static void ospf_spf_add_parent(struct vertex *v, struct vertex *w,
 		}
 	}
 
-	vp = vertex_parent_new(v, ospf_lsa_has_link(w->lsa, v->lsa), newhop);
+	vp = vertex_parent_new(area, v, ospf_lsa_has_link(w->lsa, v->lsa),
+			       newhop);
 	listnode_add_sort(w->parents, vp);
 
 	return;
@@ -665,10 +671,10 @@ static unsigned int ospf_nexthop_calculation(struct ospf_area *area,
 				}
 
 				if (added) {
-					nh = vertex_nexthop_new();
+					nh = vertex_nexthop_new(area);
 					nh->router = nexthop;
 					nh->lsa_pos = lsa_pos;
-					ospf_spf_add_parent(v, w, nh, distance);
+					ospf_spf_add_parent(area, v, w, nh, distance);
 					return 1;
 				} else
 					zlog_info(
@@ -695,10 +701,10 @@ static unsigned int ospf_nexthop_calculation(struct ospf_area *area,
 				if (vl_data
 				    && CHECK_FLAG(vl_data->flags,
 						  OSPF_VL_FLAG_APPROVED)) {
-					nh = vertex_nexthop_new();
+					nh = vertex_nexthop_new(area);
 					nh->router = vl_data->nexthop.router;
 					nh->lsa_pos = vl_data->nexthop.lsa_pos;
-					ospf_spf_add_parent(v, w, nh, distance);
+					ospf_spf_add_parent(area, v, w, nh, distance);
 					return 1;
 				} else
 					zlog_info(
@@ -709,10 +715,10 @@ static unsigned int ospf_nexthop_calculation(struct ospf_area *area,
 		else {
 			assert(w->type == OSPF_VERTEX_NETWORK);
 
-			nh = vertex_nexthop_new();
+			nh = vertex_nexthop_new(area);
 			nh->router.s_addr = 0; /* Nexthop not required */
 			nh->lsa_pos = lsa_pos;
-			ospf_spf_add_parent(v, w, nh, distance);
+			ospf_spf_add_parent(area, v, w, nh, distance);
 			return 1;
 		}
 	} /* end V is the root */
@@ -742,11 +748,11 @@ static unsigned int ospf_nexthop_calculation(struct ospf_area *area,
 					 * hop IP address (or it can be
 					 * inherited from the parent network).
 					 */
-					nh = vertex_nexthop_new();
+					nh = vertex_nexthop_new(area);
 					nh->router = l->link_data;
 					nh->lsa_pos = vp->nexthop->lsa_pos;
 					added = 1;
-					ospf_spf_add_parent(v, w, nh, distance);
+					ospf_spf_add_parent(area, v, w, nh, distance);
 				}
 				/*
 				 * Note lack of return is deliberate. See next
@@ -794,7 +800,7 @@ static unsigned int ospf_nexthop_calculation(struct ospf_area *area,
 
 	for (ALL_LIST_ELEMENTS(v->parents, node, nnode, vp)) {
 		added = 1;
-		ospf_spf_add_parent(v, w, vp->nexthop, distance);
+		ospf_spf_add_parent(area, v, w, vp->nexthop, distance);
 	}
 
 	return added;
@@ -986,10 +992,9 @@ static void ospf_spf_next(struct vertex *v, struct ospf_area *area,
 				 * spf_add_parents, which will flush the old
 				 * parents.
 				 */
-				vertex_pqueue_del(candidate, w);
 				ospf_nexthop_calculation(area, v, w, l,
 							 distance, lsa_pos);
-				vertex_pqueue_add(candidate, w);
+				vertex_pqueue_decrease(candidate, w);
 			}
 		} /* end W is already on the candidate list */
 	}	 /* end loop over the links in V's LSA */
@@ -1148,19 +1153,6 @@ void ospf_rtrs_free(struct route_table *rtrs)
 	route_table_finish(rtrs);
 }
 
-void ospf_spf_cleanup(struct vertex *spf, struct list *vertex_list)
-{
-	/*
-	 * Free nexthop information, canonical versions of which are
-	 * attached the first level of router vertices attached to the
-	 * root vertex, see ospf_nexthop_calculation.
-	 */
-	ospf_canonical_nexthops_free(spf);
-
-	/* Free SPF vertices list with deconstructor ospf_vertex_free. */
-	list_delete(&vertex_list);
-}
-
 #if 0
 static void
 ospf_rtrs_print (struct route_table *rtrs)
@@ -1238,6 +1230,10 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 			   &area->area_id);
 	}
 
+	/* Drop the tree kept from the previous calculation, if any. */
+	if (!is_dry_run)
+		ospf_spf_tree_free(area);
+
 	/*
 	 * If the router LSA of the root is not yet allocated, return this
 	 * area's calculation. In the 'usual' case the root_lsa is the
@@ -1292,6 +1288,7 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 		v->lsa_p->stat = LSA_SPF_IN_SPFTREE;
 
 		ospf_vertex_add_parent(v);
+		listnode_add(area->spf_vertex_order, v);
 
 		/* RFC2328 16.1. (4). */
 		if (v->type == OSPF_VERTEX_ROUTER)
@@ -1322,12 +1319,126 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 	area->ts_spf = area->ospf->ts_spf;
 
 	if (IS_DEBUG_OSPF_EVENT)
-		zlog_debug("ospf_spf_calculate: Stop. %zd vertices",
-			   mtype_stats_alloc(MTYPE_OSPF_VERTEX));
+		zlog_debug("ospf_spf_calculate: Stop. %u vertices",
+			   listcount(area->spf_vertex_list));
+
+	/*
+	 * The tree is kept in place until the next full calculation: a dry
+	 * run's caller consumes it, otherwise partial route calculations
+	 * replay it, see ospf_spf_partial_areas().
+	 */
+}
+
+/* Free the shortest-path tree kept for an area. */
+void ospf_spf_tree_free(struct ospf_area *area)
+{
+	if (!area->spf_vertex_list)
+		return;
+
+	/* Free SPF vertices list with deconstructor ospf_vertex_free. */
+	list_delete(&area->spf_vertex_list);
+	area->spf = NULL;
+	list_delete(&area->spf_vertex_order);
+
+	/* The vertices, parents and nexthops themselves live in the chunks. */
+	ospf_spf_chunks_free(area);
+}
+
+/*
+ * Point the vertices of a kept tree at the current instance of their LSA.
+ * Fails if one of them has gone away, the tree must then be rebuilt.
+ */
+static bool ospf_spf_tree_refresh(struct ospf_area *area)
+{
+	struct listnode *node;
+	struct vertex *v;
+	struct ospf_lsa *lsa;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		if (v == area->spf)
+			lsa = area->router_lsa_self;
+		else
+			lsa = ospf_lsa_lookup_by_id(area,
+						    v->type == OSPF_VERTEX_ROUTER
+							    ? OSPF_ROUTER_LSA
+							    : OSPF_NETWORK_LSA,
+						    v->id);
+		if (!lsa || IS_LSA_MAXAGE(lsa))
+			return false;
+
+		v->lsa_p = lsa;
+		v->lsa = lsa->data;
+		UNSET_FLAG(v->flags, OSPF_VERTEX_PROCESSED);
+	}
 
-	/* If this is a dry run then keep the SPF data in place */
-	if (!area->spf_dry_run)
-		ospf_spf_cleanup(area->spf, area->spf_vertex_list);
+	return true;
+}
+
+/*
+ * Rebuild the intra-area routes of an area from its kept shortest-path
+ * tree, adding vertices in the order Dijkstra originally added them.
+ */
+static void ospf_spf_replay(struct ospf_area *area,
+			    struct route_table *new_table,
+			    struct route_table *new_rtrs)
+{
+	struct listnode *node;
+	struct vertex *v;
+
+	area->shortcut_capability = 1;
+	area->abr_count = 0;
+	area->asbr_count = 0;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_order, node, v)) {
+		if (v->type == OSPF_VERTEX_ROUTER)
+			ospf_intra_add_router(new_rtrs, v, area);
+		else
+			ospf_intra_add_transit(new_table, v, area);
+	}
+
+	ospf_spf_process_stubs(area, area->spf, new_table, 0);
+
+	area->spf_calculation++;
+}
+
+/*
+ * Partial route calculation: when only stub links, summary-LSAs or
+ * ASBR-summary-LSAs changed, the shortest-path trees of the last full
+ * calculation are still valid and only the routes derived from them are
+ * recomputed.  Returns -1 if a tree is missing or stale and a full
+ * calculation is needed.
+ */
+static int ospf_spf_partial_areas(struct ospf *ospf,
+				  struct route_table *new_table,
+				  struct route_table *new_rtrs)
+{
+	struct ospf_area *area;
+	struct listnode *node;
+	int areas_processed = 0;
+
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area)) {
+		if (!area->router_lsa_self != !area->spf_vertex_list)
+			return -1;
+		if (area->spf_vertex_list && !ospf_spf_tree_refresh(area))
+			return -1;
+	}
+
+	/* Same order as ospf_spf_calculate_areas(), backbone last */
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area)) {
+		if (ospf->backbone == area || !area->spf_vertex_list)
+			continue;
+		ospf_spf_replay(area, new_table, new_rtrs);
+		areas_processed++;
+	}
+
+	if (ospf->backbone && ospf->backbone->spf_vertex_list) {
+		ospf_spf_replay(ospf->backbone, new_table, new_rtrs);
+		areas_processed++;
+	}
+
+	monotime(&ospf->ts_spf);
+
+	return areas_processed;
 }
 
 int ospf_spf_calculate_areas(struct ospf *ospf, struct route_table *new_table,
@@ -1370,7 +1481,7 @@ static int ospf_spf_calculate_schedule_worker(struct thread *thread)
 	int areas_processed;
 	unsigned long ia_time, prune_time, rt_time;
 	unsigned long abr_time, total_spf_time, spf_time;
-	char rbuf[32]; /* reason_buf */
+	char rbuf[48]; /* reason_buf */
 
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug("SPF: Timer (SPF calculation expire)");
@@ -1381,10 +1492,23 @@ static int ospf_spf_calculate_schedule_worker(struct thread *thread)
 
 	/* Execute SPF for each area including backbone, see RFC 2328 16.1. */
 	monotime(&spf_start_time);
+	frrtrace(2, frr_ospf, spf_start, ospf, spf_reason_flags);
 	new_table = route_table_init(); /* routing table */
 	new_rtrs = route_table_init();  /* ABR/ASBR routing table */
-	areas_processed = ospf_spf_calculate_areas(ospf, new_table, new_rtrs,
-						   false, true);
+
+	areas_processed = -1;
+	if (spf_reason_flags && !(spf_reason_flags & ~SPF_PARTIAL_REASONS))
+		areas_processed =
+			ospf_spf_partial_areas(ospf, new_table, new_rtrs);
+
+	ospf->spf_last_partial = (areas_processed >= 0);
+	if (ospf->spf_last_partial)
+		ospf->spf_partial_runs++;
+	else {
+		areas_processed = ospf_spf_calculate_areas(
+			ospf, new_table, new_rtrs, false, true);
+		ospf->spf_full_runs++;
+	}
 	spf_time = monotime_since(&spf_start_time, NULL);
 
 	ospf_vl_shut_unapproved(ospf);
@@ -1444,23 +1568,28 @@ static int ospf_spf_calculate_schedule_worker(struct thread *thread)
 
 	total_spf_time =
 		monotime_since(&spf_start_time, &ospf->ts_spf_duration);
+	frrtrace(3, frr_ospf, spf_end, ospf, areas_processed, total_spf_time);
 
 	rbuf[0] = '\0';
 	if (spf_reason_flags) {
-		if (spf_reason_flags & SPF_FLAG_ROUTER_LSA_INSTALL)
+		if (spf_reason_flags & (1 << SPF_FLAG_ROUTER_LSA_INSTALL))
 			strlcat(rbuf, "R, ", sizeof(rbuf));
-		if (spf_reason_flags & SPF_FLAG_NETWORK_LSA_INSTALL)
+		if (spf_reason_flags & (1 << SPF_FLAG_ROUTER_LSA_STUB_CHANGE))
+			strlcat(rbuf, "RS, ", sizeof(rbuf));
+		if (spf_reason_flags & (1 << SPF_FLAG_NETWORK_LSA_INSTALL))
 			strlcat(rbuf, "N, ", sizeof(rbuf));
-		if (spf_reason_flags & SPF_FLAG_SUMMARY_LSA_INSTALL)
+		if (spf_reason_flags & (1 << SPF_FLAG_SUMMARY_LSA_INSTALL))
 			strlcat(rbuf, "S, ", sizeof(rbuf));
-		if (spf_reason_flags & SPF_FLAG_ASBR_SUMMARY_LSA_INSTALL)
+		if (spf_reason_flags & (1 << SPF_FLAG_ASBR_SUMMARY_LSA_INSTALL))
 			strlcat(rbuf, "AS, ", sizeof(rbuf));
-		if (spf_reason_flags & SPF_FLAG_ABR_STATUS_CHANGE)
+		if (spf_reason_flags & (1 << SPF_FLAG_ABR_STATUS_CHANGE))
 			strlcat(rbuf, "ABR, ", sizeof(rbuf));
-		if (spf_reason_flags & SPF_FLAG_ASBR_STATUS_CHANGE)
+		if (spf_reason_flags & (1 << SPF_FLAG_ASBR_STATUS_CHANGE))
 			strlcat(rbuf, "ASBR, ",	sizeof(rbuf));
-		if (spf_reason_flags & SPF_FLAG_MAXAGE)
+		if (spf_reason_flags & (1 << SPF_FLAG_MAXAGE))
 			strlcat(rbuf, "M, ", sizeof(rbuf));
+		if (spf_reason_flags & (1 << SPF_FLAG_CONFIG_CHANGE))
+			strlcat(rbuf, "C, ", sizeof(rbuf));
 
 		size_t rbuflen = strlen(rbuf);
 		if (rbuflen >= 2)
@@ -1471,6 +1600,8 @@ static int ospf_spf_calculate_schedule_worker(struct thread *thread)
 
 	if (IS_DEBUG_OSPF_EVENT) {
 		zlog_info("SPF Processing Time(usecs): %ld", total_spf_time);
+		zlog_info("            SPF Mode: %s",
+			  ospf->spf_last_partial ? "partial" : "full");
 		zlog_info("            SPF Time: %ld", spf_time);
 		zlog_info("           InterArea: %ld", ia_time);
 		zlog_info("               Prune: %ld", prune_time);
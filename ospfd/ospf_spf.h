@@ -33,7 +33,7 @@
 
 /* The "root" is the node running the SPF calculation */
 
-PREDECL_SKIPLIST_NONUNIQ(vertex_pqueue)
+PREDECL_HEAP(vertex_pqueue)
 /* A router or network in an area */
 struct vertex {
 	struct vertex_pqueue_item pqi;
@@ -69,6 +69,8 @@ typedef enum {
 	SPF_FLAG_ABR_STATUS_CHANGE,
 	SPF_FLAG_ASBR_STATUS_CHANGE,
 	SPF_FLAG_CONFIG_CHANGE,
+	/* Router-LSA of another router changed in its stub links only */
+	SPF_FLAG_ROUTER_LSA_STUB_CHANGE,
 } ospf_spf_reason_t;
 
 extern void ospf_spf_calculate_schedule(struct ospf *, ospf_spf_reason_t);
@@ -77,12 +79,12 @@ extern void ospf_spf_calculate(struct ospf_area *area,
 			       struct route_table *new_table,
 			       struct route_table *new_rtrs, bool is_dry_run,
 			       bool is_root_node);
+extern void ospf_spf_tree_free(struct ospf_area *area);
 extern int ospf_spf_calculate_areas(struct ospf *ospf,
 				    struct route_table *new_table,
 				    struct route_table *new_rtrs,
 				    bool is_dry_run, bool is_root_node);
 extern void ospf_rtrs_free(struct route_table *);
-extern void ospf_spf_cleanup(struct vertex *spf, struct list *vertex_list);
 
 extern void ospf_spf_print(struct vty *vty, struct vertex *v, int i);
 
@@ -1894,9 +1894,12 @@ void ospf_sr_update_task(struct ospf *ospf)
 
 	osr_debug("SR (%s): Start SPF update", __func__);
 
+	/* Send all label changes of this SPF run to zebra in one go */
+	zclient_batch_start(zclient);
 	hash_iterate(OspfSR.neighbors, (void (*)(struct hash_bucket *,
 						 void *))ospf_sr_nhlfe_update,
 		     NULL);
+	zclient_batch_end(zclient);
 
 	monotime(&stop_time);
 
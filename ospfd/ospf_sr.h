@@ -329,6 +329,9 @@ struct sr_prefix {
 	/* Back pointer to OSPF Route for remote prefix */
 	struct ospf_route *route;
 
+	/* Hash of the label entry last sent to zebra, 0 if none */
+	uint32_t zhash;
+
 	/* NHLFE for local prefix */
 	struct sr_nhlfe nhlfe;
 
@@ -0,0 +1,69 @@
+/* Tracing for OSPFv2
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#if !defined(_OSPF_TRACE_H) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define _OSPF_TRACE_H
+
+#include "lib/trace.h"
+
+#ifdef HAVE_LTTNG
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER frr_ospf
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "ospfd/ospf_trace.h"
+
+#include <lttng/tracepoint.h>
+
+#include "ospfd/ospfd.h"
+
+/* clang-format off */
+
+TRACEPOINT_EVENT(
+	frr_ospf,
+	spf_start,
+	TP_ARGS(struct ospf *, ospf, unsigned int, reason),
+	TP_FIELDS(
+		ctf_integer(vrf_id_t, vrf_id, ospf->vrf_id)
+		ctf_integer_hex(unsigned int, reason, reason)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_ospf, spf_start, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_ospf,
+	spf_end,
+	TP_ARGS(struct ospf *, ospf, int, areas, unsigned long, usec),
+	TP_FIELDS(
+		ctf_integer(vrf_id_t, vrf_id, ospf->vrf_id)
+		ctf_integer(int, areas, areas)
+		ctf_integer(bool, partial, ospf->spf_last_partial)
+		ctf_integer(unsigned long, duration_usec, usec)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_ospf, spf_end, TRACE_INFO)
+
+/* clang-format on */
+
+#include <lttng/tracepoint-event.h>
+
+#endif /* HAVE_LTTNG */
+
+#endif /* _OSPF_TRACE_H */
@@ -3070,6 +3070,16 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 				     + (ospf->ts_spf_duration.tv_usec / 1000);
 			json_object_int_add(json_vrf, "spfLastDurationMsecs",
 					    time_store);
+			json_object_string_add(json_vrf, "spfLastMode",
+					       ospf->spf_last_partial
+						       ? "partial"
+						       : "full");
+			json_object_int_add(json_vrf, "spfFullRuns",
+					    ospf->spf_full_runs);
+			json_object_int_add(json_vrf, "spfPartialRuns",
+					    ospf->spf_partial_runs);
+			json_object_int_add(json_vrf, "iaIncrementalUpdates",
+					    ospf->ia_incremental_runs);
 		} else
 			json_object_boolean_true_add(json_vrf, "spfHasNotRun");
 	} else {
@@ -3082,6 +3092,13 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 			vty_out(vty, " Last SPF duration %s\n",
 				ospf_timeval_dump(&ospf->ts_spf_duration,
 						  timebuf, sizeof(timebuf)));
+			vty_out(vty,
+				" Last SPF mode %s, %u full and %u partial runs\n",
+				ospf->spf_last_partial ? "partial" : "full",
+				ospf->spf_full_runs, ospf->spf_partial_runs);
+			vty_out(vty,
+				" %u inter-area routes updated incrementally\n",
+				ospf->ia_incremental_runs);
 		} else
 			vty_out(vty, "has not been run\n");
 	}
@@ -3106,6 +3123,14 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 		/* Show refresh parameters. */
 		json_object_int_add(json_vrf, "refreshTimerMsecs",
 				    ospf->lsa_refresh_interval * 1000);
+		json_object_int_add(json_vrf, "refreshQueueCount",
+				    ospf->lsa_refresh_queue.count);
+		json_object_int_add(json_vrf, "refreshLastRunCount",
+				    ospf->lsa_refresh_queue.last_refreshed);
+		json_object_int_add(json_vrf, "refreshTotalCount",
+				    ospf->lsa_refresh_queue.refreshed);
+		json_object_int_add(json_vrf, "refreshDeferredCount",
+				    ospf->lsa_refresh_queue.deferred);
 	} else {
 		vty_out(vty, " SPF timer %s%s\n",
 			(ospf->t_spf_calc ? "due in " : "is "),
@@ -3124,6 +3149,16 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 		/* Show refresh parameters. */
 		vty_out(vty, " Refresh timer %d secs\n",
 			ospf->lsa_refresh_interval);
+		vty_out(vty,
+			" Refresh queue %u LSAs, %u refreshed in last run (%.1f/sec)\n",
+			ospf->lsa_refresh_queue.count,
+			ospf->lsa_refresh_queue.last_refreshed,
+			(double)ospf->lsa_refresh_queue.last_refreshed
+				/ ospf->lsa_refresh_interval);
+		vty_out(vty, " Refreshed %" PRIu64 " LSAs, %" PRIu64
+			     " refreshes deferred by rate limit\n",
+			ospf->lsa_refresh_queue.refreshed,
+			ospf->lsa_refresh_queue.deferred);
 	}
 
 	/* Show ABR/ASBR flags. */
@@ -3641,21 +3676,24 @@ static void show_ip_ospf_interface_sub(struct vty *vty, struct ospf *ospf,
 
 		if (OSPF_IF_PASSIVE_STATUS(oi) == OSPF_IF_ACTIVE) {
 			char timebuf[OSPF_TIME_DUMP_SIZE];
+			struct timeval hello_in;
+			int64_t remain = 0;
+
+			if (oi->hello_due)
+				remain = MAX(oi->hello_due - monotime(NULL), 0);
+			hello_in.tv_sec = remain / 1000000;
+			hello_in.tv_usec = remain % 1000000;
+
 			if (use_json) {
-				long time_store = 0;
-				if (oi->t_hello)
-					time_store =
-						monotime_until(
-							&oi->t_hello->u.sands,
-							NULL)
-						/ 1000LL;
 				json_object_int_add(json_interface_sub,
 						    "timerHelloInMsecs",
-						    time_store);
+						    remain / 1000LL);
 			} else
 				vty_out(vty, "    Hello due in %s\n",
-					ospf_timer_dump(oi->t_hello, timebuf,
-							sizeof(timebuf)));
+					ospf_timeval_dump(
+						oi->hello_due ? &hello_in
+							      : NULL,
+						timebuf, sizeof(timebuf)));
 		} else /* passive-interface is set */
 		{
 			if (use_json)
@@ -30,6 +30,7 @@
 #include "stream.h"
 #include "memory.h"
 #include "zclient.h"
+#include "jhash.h"
 #include "filter.h"
 #include "plist.h"
 #include "log.h"
@@ -497,12 +498,14 @@ void ospf_external_del(struct ospf *ospf, uint8_t type, unsigned short instance)
 }
 
 /* Update NHLFE for Prefix SID */
-void ospf_zebra_update_prefix_sid(const struct sr_prefix *srp)
+void ospf_zebra_update_prefix_sid(struct sr_prefix *srp)
 {
 	struct zapi_labels zl;
 	struct zapi_nexthop *znh;
 	struct listnode *node;
 	struct ospf_path *path;
+	uint32_t seed = 0;
+	uint32_t hash;
 
 	osr_debug("SR (%s): Update Labels %u for Prefix %pFX", __func__,
 		  srp->label_in, (struct prefix *)&srp->prefv4);
@@ -535,6 +538,12 @@ void ospf_zebra_update_prefix_sid(const struct sr_prefix *srp)
 		if (srp->route == NULL) {
 			return;
 		}
+		/*
+		 * The labels are attached to the RIB route, which loses them
+		 * whenever OSPF reinstalls it: make sure they are resent then.
+		 */
+		seed = jhash_3words(srp->route->cost, srp->route->path_type,
+				    srp->route->u.ext.type2_cost, 0);
 		for (ALL_LIST_ELEMENTS_RO(srp->route->paths, node, path)) {
 			if (path->srni.label_out == MPLS_INVALID_LABEL)
 				continue;
@@ -554,12 +563,22 @@ void ospf_zebra_update_prefix_sid(const struct sr_prefix *srp)
 		return;
 	}
 
+	/* Skip label entries identical to the one last sent to zebra */
+	if (zapi_labels_encode(zclient->obuf, ZEBRA_MPLS_LABELS_REPLACE, &zl)
+	    < 0)
+		return;
+	hash = jhash(STREAM_DATA(zclient->obuf),
+		     stream_get_endp(zclient->obuf), seed);
+	if (hash == srp->zhash)
+		return;
+
 	/* Finally, send message to zebra. */
-	(void)zebra_send_mpls_labels(zclient, ZEBRA_MPLS_LABELS_REPLACE, &zl);
+	if (zclient_send_message(zclient) != ZCLIENT_SEND_FAILURE)
+		srp->zhash = hash;
 }
 
 /* Remove NHLFE for Prefix-SID */
-void ospf_zebra_delete_prefix_sid(const struct sr_prefix *srp)
+void ospf_zebra_delete_prefix_sid(struct sr_prefix *srp)
 {
 	struct zapi_labels zl;
 
@@ -583,6 +602,7 @@ void ospf_zebra_delete_prefix_sid(const struct sr_prefix *srp)
 
 	/* Send message to zebra. */
 	(void)zebra_send_mpls_labels(zclient, ZEBRA_MPLS_LABELS_DELETE, &zl);
+	srp->zhash = 0;
 }
 
 /* Send MPLS Label entry to Zebra for installation or deletion */
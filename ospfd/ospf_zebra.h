@@ -67,8 +67,8 @@ extern struct ospf_external *ospf_external_add(struct ospf *, uint8_t,
 
 struct sr_prefix;
 struct sr_nhlfe;
-extern void ospf_zebra_update_prefix_sid(const struct sr_prefix *srp);
-extern void ospf_zebra_delete_prefix_sid(const struct sr_prefix *srp);
+extern void ospf_zebra_update_prefix_sid(struct sr_prefix *srp);
+extern void ospf_zebra_delete_prefix_sid(struct sr_prefix *srp);
 extern void ospf_zebra_send_adjacency_sid(int cmd, struct sr_nhlfe nhlfe);
 
 extern void ospf_external_del(struct ospf *, uint8_t, unsigned short);
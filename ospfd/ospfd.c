@@ -288,6 +288,7 @@ static struct ospf *ospf_new(unsigned short instance, const char *name)
 	/* MaxAge init. */
 	new->maxage_delay = OSPF_LSA_MAXAGE_REMOVE_DELAY_DEFAULT;
 	new->maxage_lsa = route_table_init();
+	ospf_ls_retransmit_index_init(new);
 	new->t_maxage_walker = NULL;
 	thread_add_timer(master, ospf_lsa_maxage_walker, new,
 			 OSPF_LSA_MAXAGE_CHECK_INTERVAL, &new->t_maxage_walker);
@@ -304,7 +305,12 @@ static struct ospf *ospf_new(unsigned short instance, const char *name)
 
 	new->ibuf = stream_new(OSPF_MAX_PACKET_SIZE + 1);
 
+	ospf_hello_sched_init(&new->hello_sched);
+
 	new->t_read = NULL;
+	new->t_rx = NULL;
+	pthread_mutex_init(&new->rx_mtx, NULL);
+	new->rx_fifo = ospf_fifo_new();
 	new->oi_write_q = list_new();
 	new->write_oi_count = OSPF_WRITE_INTERFACE_COUNT_DEFAULT;
 
@@ -325,7 +331,7 @@ static struct ospf *ospf_new(unsigned short instance, const char *name)
 				__func__);
 		return new;
 	}
-	thread_add_read(master, ospf_read, new, new->fd, &new->t_read);
+	ospf_rx_on(new);
 
 	return new;
 }
@@ -705,13 +711,14 @@ static void ospf_finish_final(struct ospf *ospf)
 	}
 
 	/* Cancel all timers. */
-	OSPF_TIMER_OFF(ospf->t_read);
+	ospf_rx_off(ospf);
 	OSPF_TIMER_OFF(ospf->t_write);
 	OSPF_TIMER_OFF(ospf->t_spf_calc);
 	OSPF_TIMER_OFF(ospf->t_ase_calc);
 	OSPF_TIMER_OFF(ospf->t_maxage);
 	OSPF_TIMER_OFF(ospf->t_maxage_walker);
 	OSPF_TIMER_OFF(ospf->t_abr_task);
+	OSPF_TIMER_OFF(ospf->t_hello);
 	OSPF_TIMER_OFF(ospf->t_asbr_check);
 	OSPF_TIMER_OFF(ospf->t_distribute_update);
 	OSPF_TIMER_OFF(ospf->t_lsa_refresher);
@@ -736,6 +743,7 @@ static void ospf_finish_final(struct ospf *ospf)
 		route_unlock_node(rn);
 	}
 	route_table_finish(ospf->maxage_lsa);
+	ospf_ls_retransmit_index_finish(ospf);
 
 	if (ospf->old_table)
 		ospf_route_table_free(ospf->old_table);
@@ -805,12 +813,15 @@ static void ospf_finish_final(struct ospf *ospf)
 
 	list_delete(&ospf->areas);
 	list_delete(&ospf->oi_write_q);
+	ospf_hello_sched_fini(&ospf->hello_sched);
 
 	/* Reset GR helper data structers */
 	ospf_gr_helper_stop(ospf);
 
 	close(ospf->fd);
 	stream_free(ospf->ibuf);
+	ospf_fifo_free(ospf->rx_fifo);
+	pthread_mutex_destroy(&ospf->rx_mtx);
 	ospf->fd = -1;
 	ospf_delete(ospf);
 
@@ -871,6 +882,9 @@ static void ospf_area_free(struct ospf_area *area)
 
 	ospf_opaque_type10_lsa_term(area);
 
+	/* Free the shortest-path tree kept from the last calculation. */
+	ospf_spf_tree_free(area);
+
 	/* Free LSDBs. */
 	LSDB_LOOP (ROUTER_LSDB(area), rn, lsa)
 		ospf_discard_from_db(area->ospf, area->lsdb, lsa);
@@ -2049,6 +2063,8 @@ void ospf_master_init(struct thread_master *master)
 	om = &ospf_master;
 	om->ospf = list_new();
 	om->master = master;
+
+	ospf_rx_pthread_init();
 }
 
 /* Link OSPF instance to VRF. */
@@ -2144,8 +2160,7 @@ static int ospf_vrf_enable(struct vrf *vrf)
 			}
 			if (ret < 0 || ospf->fd <= 0)
 				return 0;
-			thread_add_read(master, ospf_read, ospf, ospf->fd,
-					&ospf->t_read);
+			ospf_rx_on(ospf);
 			ospf->oi_running = 1;
 			ospf_router_id_update(ospf);
 		}
@@ -2179,7 +2194,7 @@ static int ospf_vrf_disable(struct vrf *vrf)
 		if (IS_DEBUG_OSPF_EVENT)
 			zlog_debug("%s: ospf old_vrf_id %d unlinked", __func__,
 				   old_vrf_id);
-		thread_cancel(&ospf->t_read);
+		ospf_rx_off(ospf);
 		close(ospf->fd);
 		ospf->fd = -1;
 	}
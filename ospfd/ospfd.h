@@ -30,10 +30,14 @@
 #include "filter.h"
 #include "log.h"
 #include "vrf.h"
+#include "vector.h"
+#include "typesafe.h"
 
 #include "ospf_memory.h"
 #include "ospf_dump_api.h"
 
+PREDECL_HEAP(ospf_hello_sched)
+
 #define OSPF_VERSION            2
 
 /* VTY port number. */
@@ -80,6 +84,9 @@
 
 #define OSPF_LS_REFRESH_SHIFT       (60 * 15)
 #define OSPF_LS_REFRESH_JITTER      60
+/* Refreshes are rate limited, but never past this age. */
+#define OSPF_LS_REFRESH_DEADLINE                                               \
+	((OSPF_LS_REFRESH_TIME + OSPF_LSA_MAXAGE) / 2)
 
 struct ospf_external {
 	unsigned short instance;
@@ -223,12 +230,31 @@ struct ospf {
 
 	struct route_table *external_lsas; /* Database of external LSAs,
 					      prefix is LSA's adv. network*/
+	/* Number of those with a non-zero forwarding address */
+	uint32_t ase_fwd_lsa_count;
 
 	/* Time stamps */
 	struct timeval ts_spf;		/* SPF calculation time stamp. */
 	struct timeval ts_spf_duration; /* Execution time of last SPF */
 
+	/*
+	 * SPF runs by mode: full runs Dijkstra in every area, partial reuses
+	 * the previous shortest-path trees and only recomputes routes.
+	 */
+	uint32_t spf_full_runs;
+	uint32_t spf_partial_runs;
+	bool spf_last_partial;
+
+	/* Inter-area routes recomputed alone after a summary-LSA change */
+	uint32_t ia_incremental_runs;
+
 	struct route_table *maxage_lsa; /* List of MaxAge LSA for deletion. */
+
+	/* Neighbors holding an LSA on their retransmit list, by LSA key */
+	struct hash *rxmt_index;
+	/* Neighbors by their bit number in rxmt_index */
+	vector rxmt_nbrs;
+
 	int redistribute;		/* Num of redistributed protocols. */
 
 	/* Threads. */
@@ -245,6 +271,11 @@ struct ospf {
 	struct thread *t_maxage;	/* MaxAge LSA remover timer. */
 	struct thread *t_maxage_walker; /* MaxAge LSA checking timer. */
 
+	/* Hello transmission for all interfaces, ordered by due time and
+	 * driven by a single timer. */
+	struct ospf_hello_sched_head hello_sched;
+	struct thread *t_hello;
+
 	struct thread
 		*t_deferred_shutdown; /* deferred/stub-router shutdown timer*/
 
@@ -256,6 +287,14 @@ struct ospf {
 	struct thread *t_read;
 	int fd;
 	struct stream *ibuf;
+
+	/* Receive pthread state. t_rx lives on the receive pthread, which
+	 * reads into ibuf and queues validated packets on rx_fifo for
+	 * t_read to process.
+	 */
+	struct thread *t_rx;
+	pthread_mutex_t rx_mtx;
+	struct ospf_fifo *rx_fifo;
 	struct list *oi_write_q;
 
 	/* Distribute lists out of other route sources. */
@@ -276,6 +315,7 @@ struct ospf {
 	int default_metric; /* Default metric for redistribute. */
 
 #define OSPF_LSA_REFRESHER_GRANULARITY 10
+#define OSPF_LSA_REFRESH_BURST_MIN 100
 #define OSPF_LSA_REFRESHER_SLOTS                                               \
 	((OSPF_LS_REFRESH_TIME + OSPF_LS_REFRESH_SHIFT)                        \
 		 / OSPF_LSA_REFRESHER_GRANULARITY                              \
@@ -283,6 +323,12 @@ struct ospf {
 	struct {
 		uint16_t index;
 		struct list *qs[OSPF_LSA_REFRESHER_SLOTS];
+
+		/* LSAs on the queue, and refresh statistics. */
+		uint32_t count;
+		uint32_t last_refreshed;
+		uint64_t refreshed;
+		uint64_t deferred;
 	} lsa_refresh_queue;
 
 	struct thread *t_lsa_refresher;
@@ -469,6 +515,13 @@ struct ospf_area {
 	/* Shortest Path Tree. */
 	struct vertex *spf;
 	struct list *spf_vertex_list;
+	/*
+	 * Vertices in the order they were added to the tree, kept with the
+	 * tree between runs for partial route calculations.
+	 */
+	struct list *spf_vertex_order;
+	/* Storage for the tree's vertices, parents and nexthops. */
+	struct ospf_spf_chunk *spf_chunks;
 
 	bool spf_dry_run;   /* flag for checking if the SPF calculation is
 			       intended for the local RIB */
@@ -46,6 +46,20 @@ DEFINE_MTYPE_STATIC(PBRD, PBR_INTERFACE, "PBR Interface")
 /* Zebra structure to hold current status. */
 struct zclient *zclient;
 
+/*
+ * Rule installs and removals are not sent one by one: they are queued up
+ * in pbr_rules and go out as ZEBRA_RULE_ADD/ZEBRA_RULE_DELETE messages
+ * carrying as many rules as fit, once the current event is done.
+ */
+static struct stream *pbr_rules;
+static uint16_t pbr_rules_cmd;
+static uint32_t pbr_rules_count;
+static struct thread *t_pbr_rules;
+
+/* Largest possible encoding of a single rule, see pbr_encode_pbr_map_sequence */
+#define PBR_RULE_MAX_SIZE                                                      \
+	(3 * 4 + 2 * (1 + 1 + 16 + 2) + 1 + 4 + 4 + INTERFACE_NAMSIZ)
+
 struct pbr_interface *pbr_if_new(struct interface *ifp)
 {
 	struct pbr_interface *pbr_ifp;
@@ -441,6 +455,8 @@ void pbr_zebra_init(void)
 	zclient->route_notify_owner = route_notify_owner;
 	zclient->rule_notify_owner = rule_notify_owner;
 	zclient->nexthop_update = pbr_zebra_nexthop_update;
+
+	pbr_rules = stream_new(ZEBRA_MAX_PACKET_SIZ);
 }
 
 void pbr_send_rnh(struct nexthop *nhop, bool reg)
@@ -499,7 +515,7 @@ static void pbr_encode_pbr_map_sequence_prefix(struct stream *s,
 	stream_put(s, &p->u.prefix, prefix_blen(p));
 }
 
-static void
+static bool
 pbr_encode_pbr_map_sequence_vrf(struct stream *s,
 				const struct pbr_map_sequence *pbrms,
 				const struct interface *ifp)
@@ -513,13 +529,14 @@ pbr_encode_pbr_map_sequence_vrf(struct stream *s,
 
 	if (!pbr_vrf) {
 		DEBUGD(&pbr_dbg_zebra, "%s: VRF not found", __func__);
-		return;
+		return false;
 	}
 
 	stream_putl(s, pbr_vrf->vrf->data.l.table_id);
+	return true;
 }
 
-static void pbr_encode_pbr_map_sequence(struct stream *s,
+static bool pbr_encode_pbr_map_sequence(struct stream *s,
 					struct pbr_map_sequence *pbrms,
 					struct interface *ifp)
 {
@@ -539,13 +556,41 @@ static void pbr_encode_pbr_map_sequence(struct stream *s,
 	stream_putc(s, pbrms->dsfield);
 	stream_putl(s, pbrms->mark);
 
-	if (pbrms->vrf_unchanged || pbrms->vrf_lookup)
-		pbr_encode_pbr_map_sequence_vrf(s, pbrms, ifp);
-	else if (pbrms->nhgrp_name)
+	if (pbrms->vrf_unchanged || pbrms->vrf_lookup) {
+		if (!pbr_encode_pbr_map_sequence_vrf(s, pbrms, ifp))
+			return false;
+	} else if (pbrms->nhgrp_name)
 		stream_putl(s, pbr_nht_get_table(pbrms->nhgrp_name));
 	else if (pbrms->nhg)
 		stream_putl(s, pbr_nht_get_table(pbrms->internal_nhg_name));
 	stream_put(s, ifp->name, INTERFACE_NAMSIZ);
+
+	return true;
+}
+
+static void pbr_rules_flush(void)
+{
+	if (!pbr_rules_count)
+		return;
+
+	DEBUGD(&pbr_dbg_zebra, "%s: sending %u rule %s(s)", __func__,
+	       pbr_rules_count,
+	       pbr_rules_cmd == ZEBRA_RULE_ADD ? "install" : "removal");
+
+	stream_putl_at(pbr_rules, ZEBRA_HEADER_SIZE, pbr_rules_count);
+	stream_putw_at(pbr_rules, 0, stream_get_endp(pbr_rules));
+
+	stream_copy(zclient->obuf, pbr_rules);
+	zclient_send_message(zclient);
+
+	stream_reset(pbr_rules);
+	pbr_rules_count = 0;
+}
+
+static int pbr_rules_flush_event(struct thread *thread)
+{
+	pbr_rules_flush();
+	return 0;
 }
 
 bool pbr_send_pbr_map(struct pbr_map_sequence *pbrms,
@@ -553,6 +598,8 @@ bool pbr_send_pbr_map(struct pbr_map_sequence *pbrms,
 {
 	struct pbr_map *pbrm = pbrms->parent;
 	struct stream *s;
+	uint16_t cmd;
+	size_t start;
 	uint64_t is_installed = (uint64_t)1 << pmi->install_bit;
 
 	is_installed &= pbrms->installed;
@@ -573,27 +620,39 @@ bool pbr_send_pbr_map(struct pbr_map_sequence *pbrms,
 	if (!install && !is_installed)
 		return false;
 
-	s = zclient->obuf;
-	stream_reset(s);
-
-	zclient_create_header(s,
-			      install ? ZEBRA_RULE_ADD : ZEBRA_RULE_DELETE,
-			      VRF_DEFAULT);
-
 	/*
-	 * We are sending one item at a time at the moment
+	 * Rules are queued in order, a change of command or a full message
+	 * sends out what we have so far.
 	 */
-	stream_putl(s, 1);
+	cmd = install ? ZEBRA_RULE_ADD : ZEBRA_RULE_DELETE;
+	if (pbr_rules_count
+	    && (pbr_rules_cmd != cmd
+		|| STREAM_WRITEABLE(pbr_rules) < PBR_RULE_MAX_SIZE))
+		pbr_rules_flush();
+
+	s = pbr_rules;
+	if (!pbr_rules_count) {
+		zclient_create_header(s, cmd, VRF_DEFAULT);
+		/* Number of rules, filled in by pbr_rules_flush() */
+		stream_putl(s, 0);
+		pbr_rules_cmd = cmd;
+	}
 
 	DEBUGD(&pbr_dbg_zebra, "%s: \t%s %s seq %u %d %s %u", __func__,
 	       install ? "Installing" : "Deleting", pbrm->name, pbrms->seqno,
 	       install, pmi->ifp->name, pmi->delete);
 
-	pbr_encode_pbr_map_sequence(s, pbrms, pmi->ifp);
-
-	stream_putw_at(s, 0, stream_get_endp(s));
+	start = stream_get_endp(s);
+	if (!pbr_encode_pbr_map_sequence(s, pbrms, pmi->ifp)) {
+		if (pbr_rules_count)
+			stream_set_endp(s, start);
+		else
+			stream_reset(s);
+		return false;
+	}
 
-	zclient_send_message(zclient);
+	pbr_rules_count++;
+	thread_add_event(master, pbr_rules_flush_event, NULL, 0, &t_pbr_rules);
 
 	return true;
 }
@@ -2806,6 +2806,8 @@ static void show_scan_oil_stats(struct pim_instance *pim, struct vty *vty,
 	char uptime_scan_oil[10];
 	char uptime_mroute_add[10];
 	char uptime_mroute_del[10];
+	int64_t add_calls, del_calls;
+	int64_t upcall_received, upcall_dedup, upcall_dropped;
 
 	pim_time_uptime_begin(uptime_scan_oil, sizeof(uptime_scan_oil), now,
 			      pim->scan_oil_last);
@@ -2814,13 +2816,32 @@ static void show_scan_oil_stats(struct pim_instance *pim, struct vty *vty,
 	pim_time_uptime_begin(uptime_mroute_del, sizeof(uptime_mroute_del), now,
 			      pim->mroute_del_last);
 
+	add_calls = pim->mroute_add_kernel;
+	del_calls = pim->mroute_del_kernel;
+
+	frr_with_mutex(&pim->upcall_mtx) {
+		upcall_received = pim->upcall_received;
+		upcall_dedup = pim->upcall_dedup;
+		upcall_dropped = pim->upcall_dropped;
+	}
+
 	vty_out(vty,
 		"Scan OIL - Last: %s  Events: %lld\n"
-		"MFC Add  - Last: %s  Events: %lld\n"
-		"MFC Del  - Last: %s  Events: %lld\n",
+		"MFC Add  - Last: %s  Events: %lld  Unchanged: %lld\n"
+		"MFC Del  - Last: %s  Events: %lld\n"
+		"MFC Add  - Latency avg: %lld usec  max: %lld usec\n"
+		"MFC Del  - Latency avg: %lld usec  max: %lld usec\n"
+		"Upcalls  - Received: %lld  Deduplicated: %lld  Dropped: %lld\n",
 		uptime_scan_oil, (long long)pim->scan_oil_events,
 		uptime_mroute_add, (long long)pim->mroute_add_events,
-		uptime_mroute_del, (long long)pim->mroute_del_events);
+		(long long)pim->mroute_add_unchanged,
+		uptime_mroute_del, (long long)pim->mroute_del_events,
+		(long long)(add_calls ? pim->mroute_add_usec / add_calls : 0),
+		(long long)pim->mroute_add_usec_max,
+		(long long)(del_calls ? pim->mroute_del_usec / del_calls : 0),
+		(long long)pim->mroute_del_usec_max,
+		(long long)upcall_received, (long long)upcall_dedup,
+		(long long)upcall_dropped);
 }
 
 static void pim_show_rpf(struct pim_instance *pim, struct vty *vty, bool uj)
@@ -4315,6 +4336,8 @@ DEFUN (show_ip_pim_mlag_summary,
 				router->mlag_stats.msg.mroute_del_rx);
 		json_object_int_add(json_stat, "mrouteDelTx",
 				router->mlag_stats.msg.mroute_del_tx);
+		json_object_int_add(json_stat, "mrouteCoalesced",
+				router->mlag_stats.msg.mroute_coalesced);
 		json_object_int_add(json_stat, "mlagStatusUpdates",
 				router->mlag_stats.msg.mlag_status_updates);
 		json_object_int_add(json_stat, "peerZebraStatusUpdates",
@@ -4360,6 +4383,8 @@ DEFUN (show_ip_pim_mlag_summary,
 	vty_out(vty, "  mroute dels: rx: %d, tx: %d\n",
 			router->mlag_stats.msg.mroute_del_rx,
 			router->mlag_stats.msg.mroute_del_tx);
+	vty_out(vty, "  mroute updates coalesced: %d\n",
+			router->mlag_stats.msg.mroute_coalesced);
 	vty_out(vty, "  peer zebra status updates: %d\n",
 			router->mlag_stats.msg.peer_zebra_status_updates);
 	vty_out(vty, "  PIM status updates: %d\n",
@@ -10457,7 +10482,6 @@ DEFUN (show_ip_msdp_peer_detail_vrf_all,
 
 static void ip_msdp_show_sa(struct pim_instance *pim, struct vty *vty, bool uj)
 {
-	struct listnode *sanode;
 	struct pim_msdp_sa *sa;
 	char src_str[INET_ADDRSTRLEN];
 	char grp_str[INET_ADDRSTRLEN];
@@ -10477,7 +10501,7 @@ static void ip_msdp_show_sa(struct pim_instance *pim, struct vty *vty, bool uj)
 			"Source                     Group               RP  Local  SPT    Uptime\n");
 	}
 
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
+	frr_each (pim_msdp_sa_list, &pim->msdp.sa_list, sa) {
 		now = pim_time_monotonic_sec();
 		pim_time_uptime(timebuf, sizeof(timebuf), now - sa->uptime);
 		pim_inet4_dump("<src?>", sa->sg.src, src_str, sizeof(src_str));
@@ -10598,7 +10622,6 @@ static void ip_msdp_show_sa_entry_detail(struct pim_msdp_sa *sa,
 static void ip_msdp_show_sa_detail(struct pim_instance *pim, struct vty *vty,
 				   bool uj)
 {
-	struct listnode *sanode;
 	struct pim_msdp_sa *sa;
 	char src_str[INET_ADDRSTRLEN];
 	char grp_str[INET_ADDRSTRLEN];
@@ -10608,7 +10631,7 @@ static void ip_msdp_show_sa_detail(struct pim_instance *pim, struct vty *vty,
 		json = json_object_new_object();
 	}
 
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
+	frr_each (pim_msdp_sa_list, &pim->msdp.sa_list, sa) {
 		pim_inet4_dump("<src?>", sa->sg.src, src_str, sizeof(src_str));
 		pim_inet4_dump("<grp?>", sa->sg.grp, grp_str, sizeof(grp_str));
 		ip_msdp_show_sa_entry_detail(sa, src_str, grp_str, vty, uj,
@@ -10681,7 +10704,6 @@ DEFUN (show_ip_msdp_sa_detail_vrf_all,
 static void ip_msdp_show_sa_addr(struct pim_instance *pim, struct vty *vty,
 				 const char *addr, bool uj)
 {
-	struct listnode *sanode;
 	struct pim_msdp_sa *sa;
 	char src_str[INET_ADDRSTRLEN];
 	char grp_str[INET_ADDRSTRLEN];
@@ -10691,7 +10713,7 @@ static void ip_msdp_show_sa_addr(struct pim_instance *pim, struct vty *vty,
 		json = json_object_new_object();
 	}
 
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
+	frr_each (pim_msdp_sa_list, &pim->msdp.sa_list, sa) {
 		pim_inet4_dump("<src?>", sa->sg.src, src_str, sizeof(src_str));
 		pim_inet4_dump("<grp?>", sa->sg.grp, grp_str, sizeof(grp_str));
 		if (!strcmp(addr, src_str) || !strcmp(addr, grp_str)) {
@@ -10710,7 +10732,6 @@ static void ip_msdp_show_sa_addr(struct pim_instance *pim, struct vty *vty,
 static void ip_msdp_show_sa_sg(struct pim_instance *pim, struct vty *vty,
 			       const char *src, const char *grp, bool uj)
 {
-	struct listnode *sanode;
 	struct pim_msdp_sa *sa;
 	char src_str[INET_ADDRSTRLEN];
 	char grp_str[INET_ADDRSTRLEN];
@@ -10720,7 +10741,7 @@ static void ip_msdp_show_sa_sg(struct pim_instance *pim, struct vty *vty,
 		json = json_object_new_object();
 	}
 
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
+	frr_each (pim_msdp_sa_list, &pim->msdp.sa_list, sa) {
 		pim_inet4_dump("<src?>", sa->sg.src, src_str, sizeof(src_str));
 		pim_inet4_dump("<grp?>", sa->sg.grp, grp_str, sizeof(grp_str));
 		if (!strcmp(src, src_str) && !strcmp(grp, grp_str)) {
@@ -765,6 +765,9 @@ void igmp_startup_mode_on(struct igmp_sock *igmp)
 
 static void igmp_group_free(struct igmp_group *group)
 {
+	while (igmp_source_hash_pop(&group->group_source_hash))
+		;
+	igmp_source_hash_fini(&group->group_source_hash);
 	list_delete(&group->group_source_list);
 
 	XFREE(MTYPE_PIM_IGMP_GROUP, group);
@@ -1193,6 +1196,7 @@ struct igmp_group *igmp_add_group_by_addr(struct igmp_sock *igmp,
 
 	group->group_source_list = list_new();
 	group->group_source_list->del = (void (*)(void *))igmp_source_free;
+	igmp_source_hash_init(&group->group_source_hash);
 
 	group->t_group_timer = NULL;
 	group->t_group_query_retransmit_timer = NULL;
@@ -25,6 +25,8 @@
 #include <zebra.h>
 #include "vty.h"
 #include "linklist.h"
+#include "typesafe.h"
+#include "jhash.h"
 #include "pim_igmp_stats.h"
 
 /*
@@ -137,8 +139,13 @@ int igmp_validate_checksum(char *igmp_msg, int igmp_msg_len);
 #define IGMP_SOURCE_DONT_DELETE(flags)     ((flags) &= ~IGMP_SOURCE_MASK_DELETE)
 #define IGMP_SOURCE_DONT_SEND(flags)       ((flags) &= ~IGMP_SOURCE_MASK_SEND)
 
+PREDECL_HASH(igmp_source_hash);
+
 struct igmp_source {
 	struct in_addr source_addr;
+	/* on group_source_hash, and our node on group_source_list */
+	struct igmp_source_hash_item source_hash_item;
+	struct listnode *source_node;
 	struct thread *t_source_timer;
 	struct igmp_group *source_group; /* back pointer */
 	time_t source_creation;
@@ -152,6 +159,21 @@ struct igmp_source {
 	int source_query_retransmit_count;
 };
 
+static inline int igmp_source_hash_cmp(const struct igmp_source *a,
+				       const struct igmp_source *b)
+{
+	return (a->source_addr.s_addr > b->source_addr.s_addr)
+	       - (a->source_addr.s_addr < b->source_addr.s_addr);
+}
+
+static inline uint32_t igmp_source_hash_key(const struct igmp_source *src)
+{
+	return jhash_1word(src->source_addr.s_addr, 0);
+}
+
+DECLARE_HASH(igmp_source_hash, struct igmp_source, source_hash_item,
+	     igmp_source_hash_cmp, igmp_source_hash_key)
+
 struct igmp_group {
 	/*
 	  RFC 3376: 6.2.2. Definition of Group Timers
@@ -177,6 +199,8 @@ struct igmp_group {
 	struct in_addr group_addr;
 	int group_filtermode_isexcl;    /* 0=INCLUDE, 1=EXCLUDE */
 	struct list *group_source_list; /* list of struct igmp_source */
+	/* group_source_list indexed by source address */
+	struct igmp_source_hash_head group_source_hash;
 	time_t group_creation;
 	struct igmp_sock *group_igmp_sock; /* back pointer */
 	int64_t last_igmp_v1_report_dsec;
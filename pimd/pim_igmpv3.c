@@ -390,7 +390,8 @@ void igmp_source_delete(struct igmp_source *source)
 	  into igmp_source_free() because the later is
 	  called by list_delete_all_node()
 	*/
-	listnode_delete(group->group_source_list, source);
+	list_delete_node(group->group_source_list, source->source_node);
+	igmp_source_hash_del(&group->group_source_hash, source);
 
 	src.s_addr = source->source_addr.s_addr;
 	igmp_source_free(source);
@@ -429,14 +430,10 @@ void igmp_source_delete_expired(struct list *source_list)
 struct igmp_source *igmp_find_source_by_addr(struct igmp_group *group,
 					     struct in_addr src_addr)
 {
-	struct listnode *src_node;
-	struct igmp_source *src;
+	struct igmp_source lookup;
 
-	for (ALL_LIST_ELEMENTS_RO(group->group_source_list, src_node, src))
-		if (src_addr.s_addr == src->source_addr.s_addr)
-			return src;
-
-	return 0;
+	lookup.source_addr = src_addr;
+	return igmp_source_hash_find(&group->group_source_hash, &lookup);
 }
 
 struct igmp_source *source_new(struct igmp_group *group,
@@ -467,7 +464,8 @@ struct igmp_source *source_new(struct igmp_group *group,
 	src->source_query_retransmit_count = 0;
 	src->source_channel_oil = NULL;
 
-	listnode_add(group->group_source_list, src);
+	src->source_node = listnode_add(group->group_source_list, src);
+	igmp_source_hash_add(&group->group_source_hash, src);
 
 	/* Any source (*,G) is forwarded only if mode is EXCLUDE {empty} */
 	igmp_anysource_forward_stop(group);
@@ -67,6 +67,8 @@ static void pim_instance_terminate(struct pim_instance *pim)
 
 	pim_oil_terminate(pim);
 
+	pim_mroute_upcall_fini(pim);
+
 	pim_msdp_exit(pim);
 
 	XFREE(MTYPE_PIM_PLIST_NAME, pim->spt.plist);
@@ -123,6 +125,8 @@ static struct pim_instance *pim_instance_init(struct vrf *vrf)
 
 	pim_instance_mlag_init(pim);
 
+	pim_mroute_upcall_init(pim);
+
 	pim->last_route_change_time = -1;
 	return pim;
 }
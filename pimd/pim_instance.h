@@ -22,6 +22,7 @@
 #define __PIM_INSTANCE_H__
 
 #include <mlag.h>
+#include "typesafe.h"
 
 #include "pim_str.h"
 #include "pim_msdp.h"
@@ -43,6 +44,9 @@
 #endif
 #endif
 
+PREDECL_DLIST(pim_mlag_pend_list);
+PREDECL_HASH(pim_mlag_pend_hash);
+
 enum pim_spt_switchover {
 	PIM_SPT_IMMEDIATE,
 	PIM_SPT_INFINITY,
@@ -56,6 +60,8 @@ struct pim_mlag_msg_stats {
 	uint32_t mroute_add_tx;
 	uint32_t mroute_del_rx;
 	uint32_t mroute_del_tx;
+	/* local updates replaced by a newer one before being sent */
+	uint32_t mroute_coalesced;
 	uint32_t mlag_status_updates;
 	uint32_t pim_status_updates;
 	uint32_t vxlan_updates;
@@ -113,8 +119,12 @@ struct pim_router {
 	 * with the peer MLAG process
 	 */
 	bool connected_to_mlag;
-	/* Holds the client data(unencoded) that need to be pushed to MCLAGD*/
-	struct stream_fifo *mlag_fifo;
+	/* Local mroute updates (unencoded) that need to be pushed to MCLAGD,
+	 * in order, and indexed by (vrf, S, G) so that a newer update for
+	 * the same entry replaces the one still waiting.
+	 */
+	struct pim_mlag_pend_list_head mlag_pend_list;
+	struct pim_mlag_pend_hash_head mlag_pend_hash;
 	struct stream *mlag_stream;
 	struct thread *zpthread_mlag_write;
 	struct in_addr anycast_vtep_ip;
@@ -144,13 +154,29 @@ struct pim_instance {
 
 	int send_v6_secondary;
 
+	/* Socket read task, runs on the upcall pthread */
 	struct thread *thread;
+	/* Main thread event draining upcall_queue */
+	struct thread *t_upcall;
+	pthread_mutex_t upcall_mtx;
+	struct pim_upcall_queue_head upcall_queue;
+	struct pim_upcall_hash_head upcall_hash;
+	int64_t upcall_received;
+	int64_t upcall_dedup;
+	int64_t upcall_dropped;
 	int mroute_socket;
 	int64_t mroute_socket_creation;
 	int64_t mroute_add_events;
 	int64_t mroute_add_last;
+	int64_t mroute_add_unchanged;
+	int64_t mroute_add_kernel;
+	int64_t mroute_add_usec;
+	int64_t mroute_add_usec_max;
 	int64_t mroute_del_events;
 	int64_t mroute_del_last;
+	int64_t mroute_del_kernel;
+	int64_t mroute_del_usec;
+	int64_t mroute_del_usec_max;
 
 	struct interface *regiface;
 
@@ -159,6 +185,13 @@ struct pim_instance {
 
 	// Upstream vrf specific information
 	struct rb_pim_upstream_head upstream_head;
+	/*
+	 * Secondary indexes: (*,G) entries, so that RP changes don't need to
+	 * walk all (S,G) state, and entries without RPF neighbor, which are
+	 * the only ones a new neighbor can affect.
+	 */
+	struct pim_upstream_wc_head upstream_wc;
+	struct pim_upstream_norpf_head upstream_norpf;
 	struct timer_wheel *upstream_sg_wheel;
 
 	/*
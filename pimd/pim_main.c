@@ -120,6 +120,7 @@ int main(int argc, char **argv, char **envp)
 	}
 
 	pim_router_init();
+	pim_upcall_pthread_init();
 
 	/*
 	 * Initializations
@@ -147,6 +148,7 @@ int main(int argc, char **argv, char **envp)
 		      routing_control_plane_protocols_name_validate);
 
 	frr_config_fork();
+	pim_upcall_pthread_run();
 
 #ifdef PIM_DEBUG_BYDEFAULT
 	zlog_notice("PIM_DEBUG_BYDEFAULT: Enabling all debug commands");
@@ -52,5 +52,6 @@ DECLARE_MTYPE(PIM_NEXTHOP_CACHE)
 DECLARE_MTYPE(PIM_SSM_INFO)
 DECLARE_MTYPE(PIM_PLIST_NAME);
 DECLARE_MTYPE(PIM_VXLAN_SG)
+DECLARE_MTYPE(PIM_UPCALL)
 
 #endif /* _QUAGGA_PIM_MEMORY_H */
@@ -23,6 +23,8 @@
  */
 #include <zebra.h>
 
+#include "jhash.h"
+
 #include "pimd.h"
 #include "pim_mlag.h"
 #include "pim_upstream.h"
@@ -415,6 +417,89 @@ static void pim_mlag_up_peer_del_all(void)
 	list_delete(&temp);
 }
 
+DEFINE_MTYPE_STATIC(PIMD, PIM_MLAG_PEND, "PIM MLAG pending update");
+
+/* a local mroute update waiting to be written to zebra */
+struct pim_mlag_pend {
+	struct pim_mlag_pend_list_item list;
+	struct pim_mlag_pend_hash_item hash;
+
+	char vrf_name[VRF_NAMSIZ];
+	struct prefix_sg sg;
+	struct stream *s;
+};
+
+static int pim_mlag_pend_cmp(const struct pim_mlag_pend *a,
+			     const struct pim_mlag_pend *b)
+{
+	int ret;
+
+	ret = strcmp(a->vrf_name, b->vrf_name);
+	if (ret)
+		return ret;
+	if (a->sg.src.s_addr != b->sg.src.s_addr)
+		return numcmp(ntohl(a->sg.src.s_addr), ntohl(b->sg.src.s_addr));
+	return numcmp(ntohl(a->sg.grp.s_addr), ntohl(b->sg.grp.s_addr));
+}
+
+static uint32_t pim_mlag_pend_hashfn(const struct pim_mlag_pend *p)
+{
+	return jhash_2words(p->sg.src.s_addr, p->sg.grp.s_addr,
+			    string_hash_make(p->vrf_name));
+}
+
+DECLARE_DLIST(pim_mlag_pend_list, struct pim_mlag_pend, list);
+DECLARE_HASH(pim_mlag_pend_hash, struct pim_mlag_pend, hash,
+	     pim_mlag_pend_cmp, pim_mlag_pend_hashfn);
+
+/* Queue an mroute add/del for the zebra write handler.  If an update for
+ * the same entry hasn't been written yet, it is replaced (keeping its
+ * place in the queue): only the latest state needs to reach the peer.
+ */
+static void pim_mlag_up_local_queue(struct pim_instance *pim,
+				    struct pim_upstream *up, struct stream *s)
+{
+	struct pim_mlag_pend key = {}, *pend;
+
+	strlcpy(key.vrf_name, pim->vrf->name, sizeof(key.vrf_name));
+	key.sg = up->sg;
+
+	pend = pim_mlag_pend_hash_find(&router->mlag_pend_hash, &key);
+	if (pend) {
+		stream_free(pend->s);
+		++router->mlag_stats.msg.mroute_coalesced;
+	} else {
+		pend = XCALLOC(MTYPE_PIM_MLAG_PEND, sizeof(*pend));
+		strlcpy(pend->vrf_name, key.vrf_name, sizeof(pend->vrf_name));
+		pend->sg = key.sg;
+		pim_mlag_pend_hash_add(&router->mlag_pend_hash, pend);
+		pim_mlag_pend_list_add_tail(&router->mlag_pend_list, pend);
+	}
+	pend->s = s;
+
+	pim_mlag_signal_zpthread();
+}
+
+size_t pim_mlag_pend_count(void)
+{
+	return pim_mlag_pend_list_count(&router->mlag_pend_list);
+}
+
+struct stream *pim_mlag_pend_pop(void)
+{
+	struct pim_mlag_pend *pend;
+	struct stream *s;
+
+	pend = pim_mlag_pend_list_pop(&router->mlag_pend_list);
+	if (!pend)
+		return NULL;
+
+	pim_mlag_pend_hash_del(&router->mlag_pend_hash, pend);
+	s = pend->s;
+	XFREE(MTYPE_PIM_MLAG_PEND, pend);
+	return s;
+}
+
 /* Send upstream entry to the local MLAG daemon (which will subsequently
  * send it to the peer MLAG switch).
  */
@@ -452,8 +537,7 @@ static void pim_mlag_up_local_add_send(struct pim_instance *pim,
 	/* XXX - this field is a No-op for VXLAN*/
 	stream_put(s, NULL, INTERFACE_NAMSIZ);
 
-	stream_fifo_push_safe(router->mlag_fifo, s);
-	pim_mlag_signal_zpthread();
+	pim_mlag_up_local_queue(pim, up, s);
 }
 
 static void pim_mlag_up_local_del_send(struct pim_instance *pim,
@@ -485,9 +569,7 @@ static void pim_mlag_up_local_del_send(struct pim_instance *pim,
 	/* XXX - this field is a No-op for VXLAN */
 	stream_put(s, NULL, INTERFACE_NAMSIZ);
 
-	/* XXX - is this the the most optimal way to do things */
-	stream_fifo_push_safe(router->mlag_fifo, s);
-	pim_mlag_signal_zpthread();
+	pim_mlag_up_local_queue(pim, up, s);
 }
 
 
@@ -496,7 +578,6 @@ void pim_mlag_up_local_add(struct pim_instance *pim,
 		struct pim_upstream *up)
 {
 	pim_mlag_up_df_role_elect(pim, up);
-	/* XXX - need to add some dup checks here */
 	pim_mlag_up_local_add_send(pim, up);
 }
 
@@ -1084,10 +1165,14 @@ void pim_instance_mlag_terminate(struct pim_instance *pim)
 
 void pim_mlag_terminate(void)
 {
+	struct stream *s;
+
 	stream_free(router->mlag_stream);
 	router->mlag_stream = NULL;
-	stream_fifo_free(router->mlag_fifo);
-	router->mlag_fifo = NULL;
+	while ((s = pim_mlag_pend_pop()))
+		stream_free(s);
+	pim_mlag_pend_hash_fini(&router->mlag_pend_hash);
+	pim_mlag_pend_list_fini(&router->mlag_pend_list);
 }
 
 void pim_mlag_init(void)
@@ -1095,7 +1180,8 @@ void pim_mlag_init(void)
 	pim_mlag_param_reset();
 	router->pim_mlag_intf_cnt = 0;
 	router->connected_to_mlag = false;
-	router->mlag_fifo = stream_fifo_new();
+	pim_mlag_pend_list_init(&router->mlag_pend_list);
+	pim_mlag_pend_hash_init(&router->mlag_pend_hash);
 	router->zpthread_mlag_write = NULL;
 	router->mlag_stream = stream_new(MLAG_BUF_LIMIT);
 }
@@ -37,6 +37,9 @@ extern int pim_zebra_mlag_process_up(void);
 extern int pim_zebra_mlag_process_down(void);
 extern int pim_zebra_mlag_handle_msg(struct stream *msg, int len);
 
+extern size_t pim_mlag_pend_count(void);
+extern struct stream *pim_mlag_pend_pop(void);
+
 /* pm_zpthread.c */
 extern int pim_mlag_signal_zpthread(void);
 extern void pim_zpthread_init(void);
@@ -26,6 +26,9 @@
 #include "plist.h"
 #include "sockopt.h"
 #include "lib_errors.h"
+#include "monotime.h"
+#include "jhash.h"
+#include "frr_pthread.h"
 
 #include "pimd.h"
 #include "pim_rpf.h"
@@ -43,6 +46,7 @@
 #include "pim_ssm.h"
 #include "pim_sock.h"
 #include "pim_vxlan.h"
+#include "pim_memory.h"
 
 static void mroute_read_on(struct pim_instance *pim);
 
@@ -689,18 +693,165 @@ static int pim_mroute_msg(struct pim_instance *pim, const char *buf,
 	return 0;
 }
 
+/* Upcall pthread, reads the mroute sockets of all instances */
+static struct frr_pthread *pim_pth_upcall;
+
+struct pim_upcall {
+	struct pim_upcall_queue_item queue_item;
+	struct pim_upcall_hash_item hash_item;
+	bool hashed;
+
+	/* Dedup key, only valid when hashed */
+	uint8_t type;
+	uint8_t vif;
+	struct in_addr src;
+	struct in_addr grp;
+
+	ifindex_t ifindex;
+	int len;
+	char buf[];
+};
+
+static int pim_upcall_cmp(const struct pim_upcall *a,
+			  const struct pim_upcall *b)
+{
+	if (a->type != b->type)
+		return a->type - b->type;
+	if (a->vif != b->vif)
+		return a->vif - b->vif;
+	if (a->src.s_addr != b->src.s_addr)
+		return ntohl(a->src.s_addr) < ntohl(b->src.s_addr) ? -1 : 1;
+	if (a->grp.s_addr != b->grp.s_addr)
+		return ntohl(a->grp.s_addr) < ntohl(b->grp.s_addr) ? -1 : 1;
+	return 0;
+}
+
+static uint32_t pim_upcall_hash_key(const struct pim_upcall *a)
+{
+	return jhash_3words(a->src.s_addr, a->grp.s_addr,
+			    (a->type << 8) | a->vif, 0);
+}
+
+DECLARE_DLIST(pim_upcall_queue, struct pim_upcall, queue_item);
+DECLARE_HASH(pim_upcall_hash, struct pim_upcall, hash_item, pim_upcall_cmp,
+	     pim_upcall_hash_key);
+
+/*
+ * Copy a message read on the upcall pthread onto the instance queue.
+ * Returns false if it was dropped, either as a duplicate of a pending
+ * upcall or because the queue is full.
+ */
+static bool mroute_upcall_enqueue(struct pim_instance *pim, const char *buf,
+				  int len, ifindex_t ifindex)
+{
+	const struct ip *ip_hdr = (const struct ip *)buf;
+	const struct igmpmsg *msg = (const struct igmpmsg *)buf;
+	struct pim_upcall *upcall;
+	bool upcall_msg = false;
+	bool queued = false;
+
+	upcall = XCALLOC(MTYPE_PIM_UPCALL, sizeof(*upcall) + len);
+	upcall->ifindex = ifindex;
+	upcall->len = len;
+	memcpy(upcall->buf, buf, len);
+
+	/* Kernel upcalls have a zero protocol field, see pim_mroute_msg() */
+	if (len >= (int)sizeof(*msg) && ip_hdr->ip_p == 0) {
+		upcall_msg = true;
+		if (msg->im_msgtype == IGMPMSG_NOCACHE
+		    || msg->im_msgtype == IGMPMSG_WRONGVIF) {
+			upcall->hashed = true;
+			upcall->type = msg->im_msgtype;
+			upcall->vif = msg->im_vif;
+			upcall->src = msg->im_src;
+			upcall->grp = msg->im_dst;
+		}
+	}
+
+	frr_with_mutex(&pim->upcall_mtx) {
+		pim->upcall_received++;
+
+		if (upcall->hashed
+		    && pim_upcall_hash_find(&pim->upcall_hash, upcall)) {
+			pim->upcall_dedup++;
+			break;
+		}
+
+		if (upcall_msg && pim_upcall_queue_count(&pim->upcall_queue)
+					  >= PIM_UPCALL_QUEUE_MAX) {
+			pim->upcall_dropped++;
+			break;
+		}
+
+		if (upcall->hashed)
+			pim_upcall_hash_add(&pim->upcall_hash, upcall);
+		pim_upcall_queue_add_tail(&pim->upcall_queue, upcall);
+		queued = true;
+	}
+
+	if (!queued)
+		XFREE(MTYPE_PIM_UPCALL, upcall);
+
+	return queued;
+}
+
+static struct pim_upcall *mroute_upcall_dequeue(struct pim_instance *pim)
+{
+	struct pim_upcall *upcall;
+
+	frr_with_mutex(&pim->upcall_mtx) {
+		upcall = pim_upcall_queue_pop(&pim->upcall_queue);
+		if (upcall && upcall->hashed)
+			pim_upcall_hash_del(&pim->upcall_hash, upcall);
+	}
+
+	return upcall;
+}
+
+static void mroute_upcall_flush(struct pim_instance *pim)
+{
+	struct pim_upcall *upcall;
+
+	while ((upcall = mroute_upcall_dequeue(pim)))
+		XFREE(MTYPE_PIM_UPCALL, upcall);
+}
+
+/* Main thread, hand queued messages to the regular handlers */
+static int mroute_upcall_process(struct thread *t)
+{
+	struct pim_instance *pim = THREAD_ARG(t);
+	struct pim_upcall *upcall;
+	int count = 0;
+
+	while (count < router->packet_process) {
+		upcall = mroute_upcall_dequeue(pim);
+		if (!upcall)
+			return 0;
+
+		pim_mroute_msg(pim, upcall->buf, upcall->len, upcall->ifindex);
+		XFREE(MTYPE_PIM_UPCALL, upcall);
+		count++;
+	}
+
+	/* Yield, there may be more */
+	thread_add_event(router->master, mroute_upcall_process, pim, 0,
+			 &pim->t_upcall);
+
+	return 0;
+}
+
+/* Socket read task, runs on the upcall pthread */
 static int mroute_read(struct thread *t)
 {
 	struct pim_instance *pim;
-	static long long count;
 	char buf[10000];
-	int result = 0;
-	int cont = 1;
+	bool queued = false;
+	int count = 0;
 	int rd;
 	ifindex_t ifindex;
 	pim = THREAD_ARG(t);
 
-	while (cont) {
+	while (count < router->packet_process) {
 		rd = pim_socket_recvfromto(pim->mroute_socket, (uint8_t *)buf,
 					   sizeof(buf), NULL, NULL, NULL, NULL,
 					   &ifindex);
@@ -714,31 +865,76 @@ static int mroute_read(struct thread *t)
 				"%s: failure reading rd=%d: fd=%d: errno=%d: %s",
 				__func__, rd, pim->mroute_socket, errno,
 				safe_strerror(errno));
-			goto done;
+			break;
 		}
 
-		result = pim_mroute_msg(pim, buf, rd, ifindex);
-
+		if (mroute_upcall_enqueue(pim, buf, rd, ifindex))
+			queued = true;
 		count++;
-		if (count % router->packet_process == 0)
-			cont = 0;
 	}
-/* Keep reading */
-done:
+
+	if (queued)
+		thread_add_event(router->master, mroute_upcall_process, pim, 0,
+				 &pim->t_upcall);
+
+	/* Keep reading */
 	mroute_read_on(pim);
 
-	return result;
+	return 0;
 }
 
 static void mroute_read_on(struct pim_instance *pim)
 {
-	thread_add_read(router->master, mroute_read, pim, pim->mroute_socket,
-			&pim->thread);
+	thread_add_read(pim_pth_upcall->master, mroute_read, pim,
+			pim->mroute_socket, &pim->thread);
 }
 
+/* Stop reading and drop anything queued, before the socket is closed */
 static void mroute_read_off(struct pim_instance *pim)
 {
-	THREAD_OFF(pim->thread);
+	if (atomic_load_explicit(&pim_pth_upcall->running,
+				 memory_order_relaxed))
+		thread_cancel_async(pim_pth_upcall->master, &pim->thread, NULL);
+	else
+		thread_cancel(&pim->thread);
+
+	THREAD_OFF(pim->t_upcall);
+	mroute_upcall_flush(pim);
+}
+
+void pim_upcall_pthread_init(void)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+
+	assert(!pim_pth_upcall);
+	pim_pth_upcall =
+		frr_pthread_new(&attr, "PIM upcall thread", "pimd_upcall");
+}
+
+void pim_upcall_pthread_run(void)
+{
+	frr_pthread_run(pim_pth_upcall, NULL);
+
+	/* Wait until thread is ready. */
+	frr_pthread_wait_running(pim_pth_upcall);
+}
+
+void pim_mroute_upcall_init(struct pim_instance *pim)
+{
+	pthread_mutex_init(&pim->upcall_mtx, NULL);
+	pim_upcall_queue_init(&pim->upcall_queue);
+	pim_upcall_hash_init(&pim->upcall_hash);
+}
+
+void pim_mroute_upcall_fini(struct pim_instance *pim)
+{
+	mroute_read_off(pim);
+	pim_upcall_queue_fini(&pim->upcall_queue);
+	pim_upcall_hash_fini(&pim->upcall_hash);
+	pthread_mutex_destroy(&pim->upcall_mtx);
 }
 
 int pim_mroute_socket_enable(struct pim_instance *pim)
@@ -795,13 +991,14 @@ int pim_mroute_socket_disable(struct pim_instance *pim)
 		return -2;
 	}
 
+	mroute_read_off(pim);
+
 	if (close(pim->mroute_socket)) {
 		zlog_warn("Failure closing mroute socket: fd=%d errno=%d: %s",
 			  pim->mroute_socket, errno, safe_strerror(errno));
 		return -3;
 	}
 
-	mroute_read_off(pim);
 	pim->mroute_socket = -1;
 
 	return 0;
@@ -963,6 +1160,8 @@ static int pim_mroute_add(struct channel_oil *c_oil, const char *name)
 {
 	struct pim_instance *pim = c_oil->pim;
 	struct mfcctl tmp_oil = { {0} };
+	struct timeval start;
+	int64_t usec;
 	int err;
 
 	pim->mroute_add_last = pim_time_monotonic_sec();
@@ -992,6 +1191,19 @@ static int pim_mroute_add(struct channel_oil *c_oil, const char *name)
 	    && c_oil->oil.mfcc_parent != 0) {
 		tmp_oil.mfcc_parent = 0;
 	}
+
+	/*
+	 * State changes like RP or interface events re-add lots of entries
+	 * whose forwarding state ends up unchanged, don't bother the kernel
+	 * with those.
+	 */
+	if (c_oil->installed
+	    && !memcmp(&tmp_oil, &c_oil->oil_installed, sizeof(tmp_oil))) {
+		++pim->mroute_add_unchanged;
+		return 0;
+	}
+
+	monotime(&start);
 	err = setsockopt(pim->mroute_socket, IPPROTO_IP, MRT_ADD_MFC,
 			 &tmp_oil, sizeof(tmp_oil));
 
@@ -1003,6 +1215,11 @@ static int pim_mroute_add(struct channel_oil *c_oil, const char *name)
 				 &tmp_oil, sizeof(tmp_oil));
 	}
 
+	usec = monotime_since(&start, NULL);
+	++pim->mroute_add_kernel;
+	pim->mroute_add_usec += usec;
+	pim->mroute_add_usec_max = MAX(pim->mroute_add_usec_max, usec);
+
 	if (err) {
 		zlog_warn(
 			"%s %s: failure: setsockopt(fd=%d,IPPROTO_IP,MRT_ADD_MFC): errno=%d: %s",
@@ -1022,6 +1239,7 @@ static int pim_mroute_add(struct channel_oil *c_oil, const char *name)
 		c_oil->installed = 1;
 		c_oil->mroute_creation = pim_time_monotonic_sec();
 	}
+	c_oil->oil_installed = tmp_oil;
 
 	return 0;
 }
@@ -1165,6 +1383,8 @@ void pim_static_mroute_iif_update(struct channel_oil *c_oil,
 int pim_mroute_del(struct channel_oil *c_oil, const char *name)
 {
 	struct pim_instance *pim = c_oil->pim;
+	struct timeval start;
+	int64_t usec;
 	int err;
 
 	pim->mroute_del_last = pim_time_monotonic_sec();
@@ -1181,8 +1401,13 @@ int pim_mroute_del(struct channel_oil *c_oil, const char *name)
 		return -2;
 	}
 
+	monotime(&start);
 	err = setsockopt(pim->mroute_socket, IPPROTO_IP, MRT_DEL_MFC,
 			 &c_oil->oil, sizeof(c_oil->oil));
+	usec = monotime_since(&start, NULL);
+	++pim->mroute_del_kernel;
+	pim->mroute_del_usec += usec;
+	pim->mroute_del_usec_max = MAX(pim->mroute_del_usec_max, usec);
 	if (err) {
 		if (PIM_DEBUG_MROUTE)
 			zlog_warn(
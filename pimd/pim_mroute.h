@@ -35,8 +35,13 @@
 #include <netinet/ip_mroute.h>
 #endif
 
+#include "typesafe.h"
+
 #define PIM_MROUTE_MIN_TTL (1)
 
+/* Kernel upcalls waiting on the main thread, beyond this they are dropped */
+#define PIM_UPCALL_QUEUE_MAX (4096)
+
 #if defined(HAVE_LINUX_MROUTE_H)
 #include <linux/mroute.h>
 #else
@@ -167,6 +172,20 @@ struct igmpmsg {
   Above: from <linux/mroute.h>
 */
 
+/*
+ * Messages read from the mroute socket by the upcall pthread, queued for
+ * pim_mroute_msg() on the main thread. NOCACHE and WRONGVIF upcalls are
+ * also hashed by (type, vif, S, G) so repeats are dropped while one is
+ * still pending.
+ */
+PREDECL_DLIST(pim_upcall_queue);
+PREDECL_HASH(pim_upcall_hash);
+
+void pim_upcall_pthread_init(void);
+void pim_upcall_pthread_run(void);
+void pim_mroute_upcall_init(struct pim_instance *pim);
+void pim_mroute_upcall_fini(struct pim_instance *pim);
+
 int pim_mroute_socket_enable(struct pim_instance *pim);
 int pim_mroute_socket_disable(struct pim_instance *pim);
 
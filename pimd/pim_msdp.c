@@ -254,7 +254,7 @@ static struct pim_msdp_sa *pim_msdp_sa_new(struct pim_instance *pim,
 
 	/* insert into misc tables for easy access */
 	sa = hash_get(pim->msdp.sa_hash, sa, hash_alloc_intern);
-	listnode_add_sort(pim->msdp.sa_list, sa);
+	pim_msdp_sa_list_add(&pim->msdp.sa_list, sa);
 
 	if (PIM_DEBUG_MSDP_EVENTS) {
 		zlog_debug("MSDP SA %s created", sa->sg_str);
@@ -296,7 +296,7 @@ static void pim_msdp_sa_del(struct pim_msdp_sa *sa)
 	pim_msdp_sa_state_timer_setup(sa, false /* start */);
 
 	/* remove the entry from various tables */
-	listnode_delete(sa->pim->msdp.sa_list, sa);
+	pim_msdp_sa_list_del(&sa->pim->msdp.sa_list, sa);
 	hash_release(sa->pim->msdp.sa_hash, sa);
 
 	if (PIM_DEBUG_MSDP_EVENTS) {
@@ -354,8 +354,8 @@ static void pim_msdp_sa_deref(struct pim_msdp_sa *sa,
 				zlog_debug("MSDP SA %s local reference removed",
 					   sa->sg_str);
 			}
-			if (sa->pim->msdp.local_cnt)
-				--sa->pim->msdp.local_cnt;
+			pim_msdp_local_sa_del(&sa->pim->msdp.local_sa, sa);
+			pim_msdp_pkt_sa_cache_invalidate(sa->pim);
 		}
 	}
 
@@ -417,7 +417,7 @@ void pim_msdp_sa_ref(struct pim_instance *pim, struct pim_msdp_peer *mp,
 	} else {
 		if (!(sa->flags & PIM_MSDP_SAF_LOCAL)) {
 			sa->flags |= PIM_MSDP_SAF_LOCAL;
-			++sa->pim->msdp.local_cnt;
+			pim_msdp_local_sa_add_tail(&pim->msdp.local_sa, sa);
 			if (PIM_DEBUG_MSDP_EVENTS) {
 				zlog_debug("MSDP SA %s added locally",
 					   sa->sg_str);
@@ -425,6 +425,7 @@ void pim_msdp_sa_ref(struct pim_instance *pim, struct pim_msdp_peer *mp,
 			/* send an immediate SA update to peers */
 			sa->rp = pim->msdp.originator_id;
 			pim_msdp_pkt_sa_tx_one(sa);
+			pim_msdp_pkt_sa_cache_add(sa);
 		}
 		sa->flags &= ~PIM_MSDP_SAF_STALE;
 	}
@@ -574,8 +575,6 @@ static void pim_msdp_sa_local_setup(struct pim_instance *pim)
 /* XXX: needs to be tested */
 void pim_msdp_i_am_rp_changed(struct pim_instance *pim)
 {
-	struct listnode *sanode;
-	struct listnode *nextnode;
 	struct pim_msdp_sa *sa;
 
 	if (!(pim->msdp.flags & PIM_MSDPF_ENABLE)) {
@@ -588,16 +587,13 @@ void pim_msdp_i_am_rp_changed(struct pim_instance *pim)
 	}
 
 	/* mark all local entries as stale */
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
-		if (sa->flags & PIM_MSDP_SAF_LOCAL) {
-			sa->flags |= PIM_MSDP_SAF_STALE;
-		}
-	}
+	frr_each (pim_msdp_local_sa, &pim->msdp.local_sa, sa)
+		sa->flags |= PIM_MSDP_SAF_STALE;
 
 	/* re-setup local SA entries */
 	pim_msdp_sa_local_setup(pim);
 
-	for (ALL_LIST_ELEMENTS(pim->msdp.sa_list, sanode, nextnode, sa)) {
+	frr_each_safe (pim_msdp_sa_list, &pim->msdp.sa_list, sa) {
 		/* purge stale SA entries */
 		if (sa->flags & PIM_MSDP_SAF_STALE) {
 			/* clear the stale flag; the entry may be kept even
@@ -622,8 +618,7 @@ void pim_msdp_i_am_rp_changed(struct pim_instance *pim)
 void pim_msdp_up_join_state_changed(struct pim_instance *pim,
 				    struct pim_upstream *xg_up)
 {
-	struct listnode *sanode;
-	struct pim_msdp_sa *sa;
+	struct pim_msdp_sa *sa, *next, lookup;
 
 	if (PIM_DEBUG_MSDP_INTERNAL) {
 		zlog_debug("MSDP join state changed for %s", xg_up->sg_str);
@@ -635,20 +630,20 @@ void pim_msdp_up_join_state_changed(struct pim_instance *pim,
 		return;
 	}
 
-	/* XXX: Need to maintain SAs per-group to avoid all this unnecessary
-	 * walking */
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
-		if (sa->sg.grp.s_addr != xg_up->sg.grp.s_addr) {
-			continue;
-		}
+	/* The SA cache is sorted by group, start at the first source */
+	lookup.sg.grp = xg_up->sg.grp;
+	lookup.sg.src.s_addr = INADDR_ANY;
+	next = pim_msdp_sa_list_find_gteq(&pim->msdp.sa_list, &lookup);
+	frr_each_from (pim_msdp_sa_list, &pim->msdp.sa_list, sa, next) {
+		if (sa->sg.grp.s_addr != xg_up->sg.grp.s_addr)
+			break;
 		pim_msdp_sa_upstream_update(sa, xg_up, "up-jp-change");
 	}
 }
 
 static void pim_msdp_up_xg_del(struct pim_instance *pim, struct prefix_sg *sg)
 {
-	struct listnode *sanode;
-	struct pim_msdp_sa *sa;
+	struct pim_msdp_sa *sa, *next, lookup;
 
 	if (PIM_DEBUG_MSDP_INTERNAL) {
 		zlog_debug("MSDP %s del", pim_str_sg_dump(sg));
@@ -659,12 +654,13 @@ static void pim_msdp_up_xg_del(struct pim_instance *pim, struct prefix_sg *sg)
 		return;
 	}
 
-	/* XXX: Need to maintain SAs per-group to avoid all this unnecessary
-	 * walking */
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
-		if (sa->sg.grp.s_addr != sg->grp.s_addr) {
-			continue;
-		}
+	/* The SA cache is sorted by group, start at the first source */
+	lookup.sg.grp = sg->grp;
+	lookup.sg.src.s_addr = INADDR_ANY;
+	next = pim_msdp_sa_list_find_gteq(&pim->msdp.sa_list, &lookup);
+	frr_each_from (pim_msdp_sa_list, &pim->msdp.sa_list, sa, next) {
+		if (sa->sg.grp.s_addr != sg->grp.s_addr)
+			break;
 		pim_msdp_sa_upstream_update(sa, NULL /* xg */, "up-jp-change");
 	}
 }
@@ -698,26 +694,6 @@ static bool pim_msdp_sa_hash_eq(const void *p1, const void *p2)
 		&& (sa1->sg.grp.s_addr == sa2->sg.grp.s_addr));
 }
 
-static int pim_msdp_sa_comp(const void *p1, const void *p2)
-{
-	const struct pim_msdp_sa *sa1 = p1;
-	const struct pim_msdp_sa *sa2 = p2;
-
-	if (ntohl(sa1->sg.grp.s_addr) < ntohl(sa2->sg.grp.s_addr))
-		return -1;
-
-	if (ntohl(sa1->sg.grp.s_addr) > ntohl(sa2->sg.grp.s_addr))
-		return 1;
-
-	if (ntohl(sa1->sg.src.s_addr) < ntohl(sa2->sg.src.s_addr))
-		return -1;
-
-	if (ntohl(sa1->sg.src.s_addr) > ntohl(sa2->sg.src.s_addr))
-		return 1;
-
-	return 0;
-}
-
 /* RFC-3618:Sec-10.1.3 - Peer-RPF forwarding */
 /* XXX: this can use a bit of refining and extensions */
 bool pim_msdp_peer_rpf_check(struct pim_msdp_peer *mp, struct in_addr rp)
@@ -1083,7 +1059,10 @@ static enum pim_msdp_err pim_msdp_peer_new(struct pim_instance *pim,
 	pim_msdp_addr2su(&mp->su_peer, mp->peer);
 	mp->local = local_addr;
 	/* XXX: originator_id setting needs to move to the mesh group */
-	pim->msdp.originator_id = local_addr;
+	if (pim->msdp.originator_id.s_addr != local_addr.s_addr) {
+		pim->msdp.originator_id = local_addr;
+		pim_msdp_pkt_sa_cache_invalidate(pim);
+	}
 	pim_msdp_addr2su(&mp->su_local, mp->local);
 	mp->mesh_group_name = XSTRDUP(MTYPE_PIM_MSDP_MG_NAME, mesh_group_name);
 	mp->state = PIM_MSDP_INACTIVE;
@@ -1595,14 +1574,17 @@ void pim_msdp_init(struct pim_instance *pim, struct thread_master *master)
 		 pim->vrf->name);
 	pim->msdp.sa_hash = hash_create(pim_msdp_sa_hash_key_make,
 					pim_msdp_sa_hash_eq, hash_name);
-	pim->msdp.sa_list = list_new();
-	pim->msdp.sa_list->del = (void (*)(void *))pim_msdp_sa_free;
-	pim->msdp.sa_list->cmp = (int (*)(void *, void *))pim_msdp_sa_comp;
+	pim_msdp_sa_list_init(&pim->msdp.sa_list);
+	pim_msdp_local_sa_init(&pim->msdp.local_sa);
+	pim->msdp.sa_adv_cache = stream_fifo_new();
+	pim->msdp.sa_adv_dirty = true;
 }
 
 /* counterpart to MSDP init; XXX: unused currently */
 void pim_msdp_exit(struct pim_instance *pim)
 {
+	struct pim_msdp_sa *sa;
+
 	pim_msdp_sa_adv_timer_setup(pim, false);
 
 	/* XXX: stop listener and delete all peer sessions */
@@ -1625,9 +1607,17 @@ void pim_msdp_exit(struct pim_instance *pim)
 		pim->msdp.sa_hash = NULL;
 	}
 
-	if (pim->msdp.sa_list) {
-		list_delete(&pim->msdp.sa_list);
-	}
+	while (pim_msdp_local_sa_pop(&pim->msdp.local_sa))
+		;
+	pim_msdp_local_sa_fini(&pim->msdp.local_sa);
+
+	while ((sa = pim_msdp_sa_list_pop(&pim->msdp.sa_list)))
+		pim_msdp_sa_free(sa);
+	pim_msdp_sa_list_fini(&pim->msdp.sa_list);
+
+	if (pim->msdp.sa_adv_cache)
+		stream_fifo_free(pim->msdp.sa_adv_cache);
+	pim->msdp.sa_adv_cache = NULL;
 
 	if (pim->msdp.work_obuf)
 		stream_free(pim->msdp.work_obuf);
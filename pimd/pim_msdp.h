@@ -19,6 +19,8 @@
 #ifndef PIM_MSDP_H
 #define PIM_MSDP_H
 
+#include "typesafe.h"
+
 enum pim_msdp_peer_state {
 	PIM_MSDP_DISABLED,
 	PIM_MSDP_INACTIVE,
@@ -73,8 +75,14 @@ enum pim_msdp_sa_flags {
 	PIM_MSDP_SAF_UP_DEL_IN_PROG = (1 << 3)
 };
 
+/* SA cache sorted by (G, S), and the subset of it originated locally */
+PREDECL_RBTREE_UNIQ(pim_msdp_sa_list);
+PREDECL_DLIST(pim_msdp_local_sa);
+
 struct pim_msdp_sa {
 	struct pim_instance *pim;
+	struct pim_msdp_sa_list_item list_item;
+	struct pim_msdp_local_sa_item local_item;
 
 	struct prefix_sg sg;
 	char sg_str[PIM_SG_LEN];
@@ -91,6 +99,28 @@ struct pim_msdp_sa {
 	struct pim_upstream *up;
 };
 
+static inline int pim_msdp_sa_cmp(const struct pim_msdp_sa *sa1,
+				  const struct pim_msdp_sa *sa2)
+{
+	if (ntohl(sa1->sg.grp.s_addr) < ntohl(sa2->sg.grp.s_addr))
+		return -1;
+
+	if (ntohl(sa1->sg.grp.s_addr) > ntohl(sa2->sg.grp.s_addr))
+		return 1;
+
+	if (ntohl(sa1->sg.src.s_addr) < ntohl(sa2->sg.src.s_addr))
+		return -1;
+
+	if (ntohl(sa1->sg.src.s_addr) > ntohl(sa2->sg.src.s_addr))
+		return 1;
+
+	return 0;
+}
+
+DECLARE_RBTREE_UNIQ(pim_msdp_sa_list, struct pim_msdp_sa, list_item,
+		    pim_msdp_sa_cmp);
+DECLARE_DLIST(pim_msdp_local_sa, struct pim_msdp_sa, local_item);
+
 enum pim_msdp_peer_flags {
 	PIM_MSDP_PEERF_NONE = 0,
 	PIM_MSDP_PEERF_LISTENER = (1 << 0),
@@ -188,12 +218,19 @@ struct pim_msdp {
 #define PIM_MSDP_SA_ADVERTISMENT_TIME 60
 	struct thread *sa_adv_timer; // 5.6
 	struct hash *sa_hash;
-	struct list *sa_list;
-	uint32_t local_cnt;
+	struct pim_msdp_sa_list_head sa_list;
+	struct pim_msdp_local_sa_head local_sa;
 
 	/* keep a scratch pad for building SA TLVs */
 	struct stream *work_obuf;
 
+	/* SA TLVs for all local SAs, encoded once and copied to each peer on
+	 * every advertisement. New local SAs are appended, anything else
+	 * sets sa_adv_dirty and the cache is rebuilt on next use.
+	 */
+	struct stream_fifo *sa_adv_cache;
+	bool sa_adv_dirty;
+
 	struct in_addr originator_id;
 
 	/* currently only one mesh-group is supported - so just stash it here */
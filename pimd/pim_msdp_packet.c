@@ -313,8 +313,8 @@ void pim_msdp_pkt_ka_tx(struct pim_msdp_peer *mp)
 	pim_msdp_pkt_send(mp, s);
 }
 
-static void pim_msdp_pkt_sa_push_to_one_peer(struct pim_instance *pim,
-					     struct pim_msdp_peer *mp)
+static void pim_msdp_pkt_sa_push_to_one_peer(struct pim_msdp_peer *mp,
+					     struct stream *obuf)
 {
 	struct stream *s;
 
@@ -322,7 +322,7 @@ static void pim_msdp_pkt_sa_push_to_one_peer(struct pim_instance *pim,
 		/* don't tx anything unless a session is established */
 		return;
 	}
-	s = stream_dup(pim->msdp.work_obuf);
+	s = stream_dup(obuf);
 	if (s) {
 		pim_msdp_pkt_send(mp, s);
 		mp->flags |= PIM_MSDP_PEERF_SA_JUST_SENT;
@@ -331,94 +331,106 @@ static void pim_msdp_pkt_sa_push_to_one_peer(struct pim_instance *pim,
 
 /* push the stream into the obuf fifo of all the peers */
 static void pim_msdp_pkt_sa_push(struct pim_instance *pim,
-				 struct pim_msdp_peer *mp)
+				 struct pim_msdp_peer *mp, struct stream *obuf)
 {
 	struct listnode *mpnode;
 
 	if (mp) {
-		pim_msdp_pkt_sa_push_to_one_peer(pim, mp);
+		pim_msdp_pkt_sa_push_to_one_peer(mp, obuf);
 	} else {
 		for (ALL_LIST_ELEMENTS_RO(pim->msdp.peer_list, mpnode, mp)) {
 			if (PIM_DEBUG_MSDP_INTERNAL) {
 				zlog_debug("MSDP peer %s pim_msdp_pkt_sa_push",
 					   mp->key_str);
 			}
-			pim_msdp_pkt_sa_push_to_one_peer(pim, mp);
+			pim_msdp_pkt_sa_push_to_one_peer(mp, obuf);
 		}
 	}
 }
 
-static int pim_msdp_pkt_sa_fill_hdr(struct pim_instance *pim, int local_cnt,
-				    struct in_addr rp)
+static void pim_msdp_pkt_sa_fill_hdr(struct stream *s, int cnt,
+				     struct in_addr rp)
 {
-	int curr_tlv_ecnt;
-
-	stream_reset(pim->msdp.work_obuf);
-	curr_tlv_ecnt = local_cnt > PIM_MSDP_SA_MAX_ENTRY_CNT
-				? PIM_MSDP_SA_MAX_ENTRY_CNT
-				: local_cnt;
-	local_cnt -= curr_tlv_ecnt;
-	stream_putc(pim->msdp.work_obuf, PIM_MSDP_V4_SOURCE_ACTIVE);
-	stream_putw(pim->msdp.work_obuf,
-		    PIM_MSDP_SA_ENTRY_CNT2SIZE(curr_tlv_ecnt));
-	stream_putc(pim->msdp.work_obuf, curr_tlv_ecnt);
-	stream_put_ipv4(pim->msdp.work_obuf, rp.s_addr);
+	stream_reset(s);
+	stream_putc(s, PIM_MSDP_V4_SOURCE_ACTIVE);
+	stream_putw(s, PIM_MSDP_SA_ENTRY_CNT2SIZE(cnt));
+	stream_putc(s, cnt);
+	stream_put_ipv4(s, rp.s_addr);
+}
 
-	return local_cnt;
+static void pim_msdp_pkt_sa_fill_one(struct stream *s, struct pim_msdp_sa *sa)
+{
+	stream_put3(s, 0 /* reserved */);
+	stream_putc(s, 32 /* sprefix len */);
+	stream_put_ipv4(s, sa->sg.grp.s_addr);
+	stream_put_ipv4(s, sa->sg.src.s_addr);
 }
 
-static void pim_msdp_pkt_sa_fill_one(struct pim_msdp_sa *sa)
+/* Append a local SA to the last cached TLV, or start a new one */
+static void pim_msdp_pkt_sa_cache_append(struct pim_instance *pim,
+					 struct pim_msdp_sa *sa)
 {
-	stream_put3(sa->pim->msdp.work_obuf, 0 /* reserved */);
-	stream_putc(sa->pim->msdp.work_obuf, 32 /* sprefix len */);
-	stream_put_ipv4(sa->pim->msdp.work_obuf, sa->sg.grp.s_addr);
-	stream_put_ipv4(sa->pim->msdp.work_obuf, sa->sg.src.s_addr);
+	struct stream *s = pim->msdp.sa_adv_cache->tail;
+	uint8_t cnt = 0;
+
+	if (s)
+		cnt = stream_getc_from(s, 3);
+
+	if (!s || cnt >= PIM_MSDP_SA_MAX_ENTRY_CNT) {
+		s = stream_new(PIM_MSDP_SA_TLV_MAX_SIZE);
+		pim_msdp_pkt_sa_fill_hdr(s, 0, pim->msdp.originator_id);
+		stream_fifo_push(pim->msdp.sa_adv_cache, s);
+		cnt = 0;
+	}
+
+	pim_msdp_pkt_sa_fill_one(s, sa);
+	++cnt;
+	stream_putw_at(s, 1, PIM_MSDP_SA_ENTRY_CNT2SIZE(cnt));
+	stream_putc_at(s, 3, cnt);
 }
 
-static void pim_msdp_pkt_sa_gen(struct pim_instance *pim,
-				struct pim_msdp_peer *mp)
+static void pim_msdp_pkt_sa_cache_build(struct pim_instance *pim)
 {
-	struct listnode *sanode;
 	struct pim_msdp_sa *sa;
-	int sa_count;
-	int local_cnt = pim->msdp.local_cnt;
 
-	sa_count = 0;
-	if (PIM_DEBUG_MSDP_INTERNAL) {
-		zlog_debug("  sa gen  %d", local_cnt);
-	}
+	if (PIM_DEBUG_MSDP_INTERNAL)
+		zlog_debug("  sa cache build %zu",
+			   pim_msdp_local_sa_count(&pim->msdp.local_sa));
 
-	local_cnt = pim_msdp_pkt_sa_fill_hdr(pim, local_cnt,
-					     pim->msdp.originator_id);
+	stream_fifo_clean(pim->msdp.sa_adv_cache);
 
-	for (ALL_LIST_ELEMENTS_RO(pim->msdp.sa_list, sanode, sa)) {
-		if (!(sa->flags & PIM_MSDP_SAF_LOCAL)) {
-			/* current implementation of MSDP is for anycast i.e.
-			 * full mesh. so
-			 * no re-forwarding of SAs that we learnt from other
-			 * peers */
-			continue;
-		}
-		/* add sa into scratch pad */
-		pim_msdp_pkt_sa_fill_one(sa);
-		++sa_count;
-		if (sa_count >= PIM_MSDP_SA_MAX_ENTRY_CNT) {
-			pim_msdp_pkt_sa_push(pim, mp);
-			/* reset headers */
-			sa_count = 0;
-			if (PIM_DEBUG_MSDP_INTERNAL) {
-				zlog_debug("  sa gen for remainder %d",
-					   local_cnt);
-			}
-			local_cnt = pim_msdp_pkt_sa_fill_hdr(
-				pim, local_cnt, pim->msdp.originator_id);
-		}
-	}
+	/* current implementation of MSDP is for anycast i.e. full mesh. so
+	 * no re-forwarding of SAs that we learnt from other peers */
+	frr_each (pim_msdp_local_sa, &pim->msdp.local_sa, sa)
+		pim_msdp_pkt_sa_cache_append(pim, sa);
 
-	if (sa_count) {
-		pim_msdp_pkt_sa_push(pim, mp);
-	}
-	return;
+	pim->msdp.sa_adv_dirty = false;
+}
+
+void pim_msdp_pkt_sa_cache_add(struct pim_msdp_sa *sa)
+{
+	/* a pending rebuild will pick it up */
+	if (sa->pim->msdp.sa_adv_dirty)
+		return;
+
+	pim_msdp_pkt_sa_cache_append(sa->pim, sa);
+}
+
+void pim_msdp_pkt_sa_cache_invalidate(struct pim_instance *pim)
+{
+	pim->msdp.sa_adv_dirty = true;
+}
+
+static void pim_msdp_pkt_sa_gen(struct pim_instance *pim,
+				struct pim_msdp_peer *mp)
+{
+	struct stream *s;
+
+	if (pim->msdp.sa_adv_dirty)
+		pim_msdp_pkt_sa_cache_build(pim);
+
+	for (s = stream_fifo_head(pim->msdp.sa_adv_cache); s; s = s->next)
+		pim_msdp_pkt_sa_push(pim, mp, s);
 }
 
 static void pim_msdp_pkt_sa_tx_done(struct pim_instance *pim)
@@ -444,9 +456,11 @@ void pim_msdp_pkt_sa_tx(struct pim_instance *pim)
 
 void pim_msdp_pkt_sa_tx_one(struct pim_msdp_sa *sa)
 {
-	pim_msdp_pkt_sa_fill_hdr(sa->pim, 1 /* cnt */, sa->rp);
-	pim_msdp_pkt_sa_fill_one(sa);
-	pim_msdp_pkt_sa_push(sa->pim, NULL);
+	struct stream *s = sa->pim->msdp.work_obuf;
+
+	pim_msdp_pkt_sa_fill_hdr(s, 1 /* cnt */, sa->rp);
+	pim_msdp_pkt_sa_fill_one(s, sa);
+	pim_msdp_pkt_sa_push(sa->pim, NULL, s);
 	pim_msdp_pkt_sa_tx_done(sa->pim);
 }
 
@@ -461,17 +475,18 @@ void pim_msdp_pkt_sa_tx_one_to_one_peer(struct pim_msdp_peer *mp,
 					struct in_addr rp, struct prefix_sg sg)
 {
 	struct pim_msdp_sa sa;
+	struct stream *s = mp->pim->msdp.work_obuf;
 
 	/* Fills the SA header. */
-	pim_msdp_pkt_sa_fill_hdr(mp->pim, 1, rp);
+	pim_msdp_pkt_sa_fill_hdr(s, 1, rp);
 
 	/* Fills the message contents. */
 	sa.pim = mp->pim;
 	sa.sg = sg;
-	pim_msdp_pkt_sa_fill_one(&sa);
+	pim_msdp_pkt_sa_fill_one(s, &sa);
 
 	/* Pushes the message. */
-	pim_msdp_pkt_sa_push(sa.pim, mp);
+	pim_msdp_pkt_sa_push(sa.pim, mp, s);
 	pim_msdp_pkt_sa_tx_done(sa.pim);
 }
 
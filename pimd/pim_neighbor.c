@@ -26,6 +26,7 @@
 #include "vty.h"
 #include "plist.h"
 #include "lib_errors.h"
+#include "network.h"
 
 #include "pimd.h"
 #include "pim_neighbor.h"
@@ -272,6 +273,7 @@ static int on_neighbor_jp_timer(struct thread *t)
 {
 	struct pim_neighbor *neigh = THREAD_ARG(t);
 	struct pim_rpf rpf;
+	long period_msec;
 
 	if (PIM_DEBUG_PIM_TRACE) {
 		char src_str[INET_ADDRSTRLEN];
@@ -286,17 +288,31 @@ static int on_neighbor_jp_timer(struct thread *t)
 	rpf.rpf_addr.u.prefix4 = neigh->source_addr;
 	pim_joinprune_send(&rpf, neigh->upstream_jp_agg);
 
-	thread_add_timer(router->master, on_neighbor_jp_timer, neigh,
-			 router->t_periodic, &neigh->jp_timer);
+	/*
+	 * Jitter the period by up to 10% so that the refreshes of
+	 * neighbors that came up together drift apart.
+	 */
+	period_msec = router->t_periodic * 1000;
+	period_msec -= frr_weak_random() % (period_msec / 10 + 1);
+	thread_add_timer_msec(router->master, on_neighbor_jp_timer, neigh,
+			      period_msec, &neigh->jp_timer);
 
 	return 0;
 }
 
 static void pim_neighbor_start_jp_timer(struct pim_neighbor *neigh)
 {
+	long period_msec = router->t_periodic * 1000;
+
+	/*
+	 * Spread the first refresh over a whole period, so that the
+	 * aggregated J/P of all neighbors (e.g. after a restart) isn't sent
+	 * in a single burst.
+	 */
 	THREAD_OFF(neigh->jp_timer);
-	thread_add_timer(router->master, on_neighbor_jp_timer, neigh,
-			 router->t_periodic, &neigh->jp_timer);
+	thread_add_timer_msec(router->master, on_neighbor_jp_timer, neigh,
+			      frr_weak_random() % (period_msec + 1),
+			      &neigh->jp_timer);
 }
 
 static struct pim_neighbor *
@@ -98,6 +98,8 @@ struct channel_oil {
 	struct rb_pim_oil_item oil_rb;
 
 	struct mfcctl oil;
+	/* MFC entry as last handed to the kernel, valid if installed */
+	struct mfcctl oil_installed;
 	int installed;
 	int oil_inherited_rescan;
 	int oil_size;
@@ -511,7 +511,7 @@ int pim_rp_new(struct pim_instance *pim, struct in_addr rp_addr,
 					"%s: NHT Register rp_all addr %pFX grp %pFX ",
 					__func__, &nht_p, &rp_all->group);
 
-			frr_each (rb_pim_upstream, &pim->upstream_head, up) {
+			frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 				/* Find (*, G) upstream whose RP is not
 				 * configured yet
 				 */
@@ -602,7 +602,7 @@ int pim_rp_new(struct pim_instance *pim, struct in_addr rp_addr,
 			   rp_info, &rp_info->group,
 			   route_node_get_lock_count(rn));
 
-	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
+	frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 		if (up->sg.src.s_addr == INADDR_ANY) {
 			struct prefix grp;
 			struct rp_info *trp_info;
@@ -743,7 +743,7 @@ int pim_rp_del(struct pim_instance *pim, struct in_addr rp_addr,
 	rp_all = pim_rp_find_match_group(pim, &g_all);
 
 	if (rp_all == rp_info) {
-		frr_each (rb_pim_upstream, &pim->upstream_head, up) {
+		frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 			/* Find the upstream (*, G) whose upstream address is
 			 * same as the deleted RP
 			 */
@@ -791,7 +791,7 @@ int pim_rp_del(struct pim_instance *pim, struct in_addr rp_addr,
 
 	pim_rp_refresh_group_to_rp_mapping(pim);
 
-	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
+	frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 		/* Find the upstream (*, G) whose upstream address is same as
 		 * the deleted RP
 		 */
@@ -876,7 +876,7 @@ int pim_rp_change(struct pim_instance *pim, struct in_addr new_rp_addr,
 
 	listnode_add_sort(pim->rp_list, rp_info);
 
-	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
+	frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 		if (up->sg.src.s_addr == INADDR_ANY) {
 			struct prefix grp;
 			struct rp_info *trp_info;
@@ -272,6 +272,7 @@ enum pim_rpf_result pim_rpf_update(struct pim_instance *pim,
 
 	rpf->rpf_addr.family = AF_INET;
 	rpf->rpf_addr.u.prefix4 = pim_rpf_find_rpf_addr(up);
+	pim_upstream_norpf_track(up);
 	if (pim_rpf_addr_is_inaddr_any(rpf) && PIM_DEBUG_ZEBRA) {
 		/* RPF'(S,G) not found */
 		zlog_debug("%s(%s): RPF'%s not found: won't send join upstream",
@@ -355,6 +356,7 @@ void pim_upstream_rpf_clear(struct pim_instance *pim,
 		up->rpf.source_nexthop.mrib_route_metric =
 			router->infinite_assert_metric.route_metric;
 		up->rpf.rpf_addr.u.prefix4.s_addr = PIM_NET_INADDR_ANY;
+		pim_upstream_norpf_track(up);
 		pim_upstream_mroute_iif_update(up->channel_oil, __func__);
 	}
 }
@@ -109,10 +109,11 @@ static void pim_upstream_find_new_children(struct pim_instance *pim,
 	    && (up->sg.grp.s_addr == INADDR_ANY))
 		return;
 
-	frr_each (rb_pim_upstream, &pim->upstream_head, child) {
-		if ((up->sg.grp.s_addr != INADDR_ANY)
-		    && (child->sg.grp.s_addr == up->sg.grp.s_addr)
-		    && (child != up)) {
+	/* Entries are sorted by group, (*,G) first */
+	frr_each_from (rb_pim_upstream, &pim->upstream_head, child, up) {
+		if (child->sg.grp.s_addr != up->sg.grp.s_addr)
+			break;
+		if (up->sg.grp.s_addr != INADDR_ANY && child != up) {
 			child->parent = up;
 			listnode_add_sort(up->sources, child);
 			if (PIM_UPSTREAM_FLAG_TEST_USE_RPT(child->flags))
@@ -251,6 +252,10 @@ struct pim_upstream *pim_upstream_del(struct pim_instance *pim,
 	up->parent = NULL;
 
 	rb_pim_upstream_del(&pim->upstream_head, up);
+	if (up->sg.src.s_addr == INADDR_ANY)
+		pim_upstream_wc_del(&pim->upstream_wc, up);
+	if (up->norpf_listed)
+		pim_upstream_norpf_del(&pim->upstream_norpf, up);
 
 	if (notify_msdp) {
 		pim_msdp_up_del(pim, &up->sg);
@@ -372,7 +377,15 @@ void join_timer_start(struct pim_upstream *up)
 
 	if (nbr)
 		pim_jp_agg_add_group(nbr->upstream_jp_agg, up, 1, nbr);
-	else {
+	else if (pim_rpf_addr_is_inaddr_any(&up->rpf)) {
+		/*
+		 * Nobody to send the join to.  The upstream is on the
+		 * upstream_norpf list and will move to the neighbor's periodic
+		 * J/P once RPF'(S,G) resolves, so don't keep a timer per
+		 * upstream around in the meantime.
+		 */
+		THREAD_OFF(up->t_join_timer);
+	} else {
 		THREAD_OFF(up->t_join_timer);
 		thread_add_timer(router->master, on_join_timer, up,
 				 router->t_periodic, &up->t_join_timer);
@@ -628,8 +641,8 @@ void pim_upstream_register_reevaluate(struct pim_instance *pim)
  * This macro is a slight deviation on the RFC and uses "traffic-agnostic"
  * criteria to decide between using the RPT vs. SPT for forwarding.
  */
-void pim_upstream_update_use_rpt(struct pim_upstream *up,
-			bool update_mroute)
+static void pim_upstream_update_use_rpt_rp(struct pim_upstream *up,
+					   bool update_mroute, bool i_am_rp)
 {
 	bool old_use_rpt;
 	bool new_use_rpt;
@@ -652,10 +665,7 @@ void pim_upstream_update_use_rpt(struct pim_upstream *up,
 			pim_if_connected_to_source(
 				up->rpf.source_nexthop.interface,
 				up->sg.src) ||
-			/* XXX - need to switch this to a more efficient
-			 * lookup API
-			 */
-			I_am_RP(up->pim, up->sg.grp))
+			i_am_rp)
 		/* use SPT */
 		PIM_UPSTREAM_FLAG_UNSET_USE_RPT(up->flags);
 	else
@@ -674,18 +684,38 @@ void pim_upstream_update_use_rpt(struct pim_upstream *up,
 	}
 }
 
+void pim_upstream_update_use_rpt(struct pim_upstream *up,
+			bool update_mroute)
+{
+	if (up->sg.src.s_addr == INADDR_ANY)
+		return;
+
+	pim_upstream_update_use_rpt_rp(up, update_mroute,
+				       I_am_RP(up->pim, up->sg.grp));
+}
+
 /* some events like RP change require re-evaluation of SGrpt across
  * all groups
  */
 void pim_upstream_reeval_use_rpt(struct pim_instance *pim)
 {
 	struct pim_upstream *up;
+	struct in_addr grp = {.s_addr = INADDR_ANY};
+	bool i_am_rp = false;
 
+	/* Entries are sorted by group, look up the RP once per group */
 	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
 		if (up->sg.src.s_addr == INADDR_ANY)
 			continue;
 
-		pim_upstream_update_use_rpt(up, true /*update_mroute*/);
+		if (up->sg.grp.s_addr != grp.s_addr
+		    || grp.s_addr == INADDR_ANY) {
+			grp = up->sg.grp;
+			i_am_rp = I_am_RP(pim, grp);
+		}
+
+		pim_upstream_update_use_rpt_rp(up, true /*update_mroute*/,
+					       i_am_rp);
 	}
 }
 
@@ -828,7 +858,22 @@ void pim_upstream_fill_static_iif(struct pim_upstream *up,
 	up->rpf.source_nexthop.mrib_route_metric = 0;
 	up->rpf.rpf_addr.family = AF_INET;
 	up->rpf.rpf_addr.u.prefix4.s_addr = PIM_NET_INADDR_ANY;
+	pim_upstream_norpf_track(up);
+}
+
+/*
+ * Put the upstream on the list of entries without RPF neighbor if
+ * RPF'(S,G) is unresolved.  Called whenever RPF'(S,G) is recomputed;
+ * entries are only taken off the list again by pim_upstream_find_new_rpf()
+ * or on deletion, so the list may hold resolved entries as well.
+ */
+void pim_upstream_norpf_track(struct pim_upstream *up)
+{
+	if (up->norpf_listed || !pim_rpf_addr_is_inaddr_any(&up->rpf))
+		return;
 
+	pim_upstream_norpf_add_tail(&up->pim->upstream_norpf, up);
+	up->norpf_listed = true;
 }
 
 static struct pim_upstream *pim_upstream_new(struct pim_instance *pim,
@@ -850,6 +895,8 @@ static struct pim_upstream *pim_upstream_new(struct pim_instance *pim,
 		ch->upstream = up;
 
 	rb_pim_upstream_add(&pim->upstream_head, up);
+	if (up->sg.src.s_addr == INADDR_ANY)
+		pim_upstream_wc_add_tail(&pim->upstream_wc, up);
 	/* Set up->upstream_addr as INADDR_ANY, if RP is not
 	 * configured and retain the upstream data structure
 	 */
@@ -891,6 +938,7 @@ static struct pim_upstream *pim_upstream_new(struct pim_instance *pim,
 		router->infinite_assert_metric.route_metric;
 	up->rpf.rpf_addr.family = AF_INET;
 	up->rpf.rpf_addr.u.prefix4.s_addr = PIM_NET_INADDR_ANY;
+	pim_upstream_norpf_track(up);
 
 	up->ifchannels = list_new();
 	up->ifchannels->cmp = (int (*)(void *, void *))pim_ifchannel_compare;
@@ -1896,9 +1944,16 @@ void pim_upstream_find_new_rpf(struct pim_instance *pim)
 	enum pim_rpf_result rpf_result;
 
 	/*
-	 * Scan all (S,G) upstreams searching for RPF'(S,G)=neigh_addr
+	 * Scan the (S,G) upstreams without RPF neighbor searching for
+	 * RPF'(S,G)=neigh_addr
 	 */
-	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
+	frr_each_safe (pim_upstream_norpf, &pim->upstream_norpf, up) {
+		if (!pim_rpf_addr_is_inaddr_any(&up->rpf)) {
+			pim_upstream_norpf_del(&pim->upstream_norpf, up);
+			up->norpf_listed = false;
+			continue;
+		}
+
 		if (up->upstream_addr.s_addr == INADDR_ANY) {
 			if (PIM_DEBUG_PIM_TRACE)
 				zlog_debug(
@@ -1919,6 +1974,11 @@ void pim_upstream_find_new_rpf(struct pim_instance *pim)
 					(rpf_result == PIM_RPF_FAILURE &&
 					 old.source_nexthop.interface))
 				pim_zebra_upstream_rpf_changed(pim, up, &old);
+			if (!pim_rpf_addr_is_inaddr_any(&up->rpf)) {
+				pim_upstream_norpf_del(&pim->upstream_norpf,
+						       up);
+				up->norpf_listed = false;
+			}
 			/* update kernel multicast forwarding cache (MFC) */
 			pim_upstream_mroute_iif_update(up->channel_oil,
 					__func__);
@@ -1943,6 +2003,8 @@ void pim_upstream_terminate(struct pim_instance *pim)
 	}
 
 	rb_pim_upstream_fini(&pim->upstream_head);
+	pim_upstream_wc_fini(&pim->upstream_wc);
+	pim_upstream_norpf_fini(&pim->upstream_norpf);
 
 	if (pim->upstream_sg_wheel)
 		wheel_delete(pim->upstream_sg_wheel);
@@ -2100,10 +2162,7 @@ void pim_upstream_add_lhr_star_pimreg(struct pim_instance *pim)
 {
 	struct pim_upstream *up;
 
-	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
-		if (up->sg.src.s_addr != INADDR_ANY)
-			continue;
-
+	frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 		if (!PIM_UPSTREAM_FLAG_TEST_CAN_BE_LHR(up->flags))
 			continue;
 
@@ -2147,10 +2206,7 @@ void pim_upstream_remove_lhr_star_pimreg(struct pim_instance *pim,
 	g.family = AF_INET;
 	g.prefixlen = IPV4_MAX_PREFIXLEN;
 
-	frr_each (rb_pim_upstream, &pim->upstream_head, up) {
-		if (up->sg.src.s_addr != INADDR_ANY)
-			continue;
-
+	frr_each (pim_upstream_wc, &pim->upstream_wc, up) {
 		if (!PIM_UPSTREAM_FLAG_TEST_CAN_BE_LHR(up->flags))
 			continue;
 
@@ -2181,4 +2237,6 @@ void pim_upstream_init(struct pim_instance *pim)
 			   pim_upstream_sg_running, name);
 
 	rb_pim_upstream_init(&pim->upstream_head);
+	pim_upstream_wc_init(&pim->upstream_wc);
+	pim_upstream_norpf_init(&pim->upstream_norpf);
 }
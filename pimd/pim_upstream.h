@@ -198,6 +198,8 @@ struct pim_up_mlag {
 };
 
 PREDECL_RBTREE_UNIQ(rb_pim_upstream);
+PREDECL_DLIST(pim_upstream_wc);
+PREDECL_DLIST(pim_upstream_norpf);
 /*
   Upstream (S,G) channel in Joined state
   (S,G) in the "Not Joined" state is not represented
@@ -228,6 +230,11 @@ PREDECL_RBTREE_UNIQ(rb_pim_upstream);
 struct pim_upstream {
 	struct pim_instance *pim;
 	struct rb_pim_upstream_item upstream_rb;
+	/* (*,G) entries only, on pim->upstream_wc */
+	struct pim_upstream_wc_item wc_item;
+	/* On pim->upstream_norpf if RPF'(S,G) may be unresolved */
+	struct pim_upstream_norpf_item norpf_item;
+	bool norpf_listed;
 	struct pim_upstream *parent;
 	struct in_addr upstream_addr;     /* Who we are talking to */
 	struct in_addr upstream_register; /*Who we received a register from*/
@@ -374,6 +381,10 @@ int pim_upstream_compare(const struct pim_upstream *up1,
 			 const struct pim_upstream *up2);
 DECLARE_RBTREE_UNIQ(rb_pim_upstream, struct pim_upstream, upstream_rb,
 		    pim_upstream_compare)
+DECLARE_DLIST(pim_upstream_wc, struct pim_upstream, wc_item)
+DECLARE_DLIST(pim_upstream_norpf, struct pim_upstream, norpf_item)
+
+void pim_upstream_norpf_track(struct pim_upstream *up);
 
 void pim_upstream_register_reevaluate(struct pim_instance *pim);
 
@@ -469,6 +469,8 @@ static void rip_interface_clean(struct rip_interface *ri)
 	ri->running = 0;
 
 	thread_cancel(&ri->t_wakeup);
+	thread_cancel(&ri->t_update);
+	rip_update_cache_free(ri);
 }
 
 void rip_interfaces_clean(struct rip *rip)
@@ -599,9 +601,15 @@ int rip_interface_address_add(ZAPI_CALLBACK_ARGS)
 	p = ifc->address;
 
 	if (p->family == AF_INET) {
+		struct rip_interface *ri = ifc->ifp->info;
+
 		if (IS_RIP_DEBUG_ZEBRA)
 			zlog_debug("connected address %pFX is added", p);
 
+		/* Split horizon depends on the interface addresses */
+		if (ri->rip)
+			ri->rip->output_gen++;
+
 		rip_enable_apply(ifc->ifp);
 		/* Check if this prefix needs to be redistributed */
 		rip_apply_address_add(ifc);
@@ -648,10 +656,15 @@ int rip_interface_address_delete(ZAPI_CALLBACK_ARGS)
 	if (ifc) {
 		p = ifc->address;
 		if (p->family == AF_INET) {
+			struct rip_interface *ri = ifc->ifp->info;
+
 			if (IS_RIP_DEBUG_ZEBRA)
 				zlog_debug("connected address %pFX is deleted",
 					   p);
 
+			if (ri->rip)
+				ri->rip->output_gen++;
+
 			hook_call(rip_ifaddr_del, ifc);
 
 			/* Chech wether this prefix needs to be removed */
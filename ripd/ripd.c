@@ -61,6 +61,7 @@ DEFINE_MTYPE_STATIC(RIPD, RIP, "RIP structure")
 DEFINE_MTYPE_STATIC(RIPD, RIP_VRF_NAME, "RIP VRF name")
 DEFINE_MTYPE_STATIC(RIPD, RIP_INFO, "RIP route info")
 DEFINE_MTYPE_STATIC(RIPD, RIP_DISTANCE, "RIP distance")
+DEFINE_MTYPE_STATIC(RIPD, RIP_UPDATE_CACHE, "RIP update cache")
 
 /* Prototypes. */
 static void rip_output_process(struct connected *, struct sockaddr_in *, int,
@@ -152,6 +153,7 @@ static int rip_garbage_collect(struct thread *t)
 
 	/* Unlock route_node. */
 	listnode_delete(rp->info, rinfo);
+	rip_info_get_instance(rinfo)->output_gen++;
 	if (list_isempty((struct list *)rp->info)) {
 		list_delete((struct list **)&rp->info);
 		route_unlock_node(rp);
@@ -2048,77 +2050,111 @@ static int rip_write_rte(int num, struct stream *s, struct prefix_ipv4 *p,
 	return ++num;
 }
 
-/* Send update to the ifp or spcified neighbor. */
-void rip_output_process(struct connected *ifc, struct sockaddr_in *to,
-			int route_type, uint8_t version)
+/* Encoded RTEs of a periodic update, see rip_output_process(). */
+struct rip_update_cache {
+	/* Output interface address and version the RTEs were built for. */
+	struct prefix address;
+	uint8_t version;
+
+	/* Routing table and configuration the RTEs were built from. */
+	uint32_t output_gen;
+	uint32_t config_version;
+
+	int num;
+	struct stream *rtes;
+};
+
+static void rip_update_cache_del(void *arg)
+{
+	struct rip_update_cache *uc = arg;
+
+	stream_free(uc->rtes);
+	XFREE(MTYPE_RIP_UPDATE_CACHE, uc);
+}
+
+/* Drop the periodic updates cached for the interface. */
+void rip_update_cache_free(struct rip_interface *ri)
+{
+	if (ri->update_cache)
+		list_delete(&ri->update_cache);
+}
+
+/*
+ * Find the cached RTEs of the periodic update sent with the given version
+ * from the given interface address.  The whole cache is dropped once the
+ * routing table or the configuration changed since it was filled.
+ */
+static struct rip_update_cache *rip_update_cache_lookup(struct rip *rip,
+							 struct connected *ifc,
+							 uint8_t version)
+{
+	struct rip_interface *ri = ifc->ifp->info;
+	struct rip_update_cache *uc;
+	struct listnode *node;
+
+	if (!ri->update_cache)
+		return NULL;
+
+	uc = listgetdata(listhead(ri->update_cache));
+	if (uc && (uc->output_gen != rip->output_gen
+		   || uc->config_version != running_config->version)) {
+		list_delete_all_node(ri->update_cache);
+		return NULL;
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(ri->update_cache, node, uc))
+		if (uc->version == version
+		    && prefix_same(&uc->address, ifc->address))
+			return uc;
+
+	return NULL;
+}
+
+static struct rip_update_cache *rip_update_cache_add(struct rip *rip,
+						      struct connected *ifc,
+						      uint8_t version,
+						      struct stream *rtes,
+						      int num)
+{
+	struct rip_interface *ri = ifc->ifp->info;
+	struct rip_update_cache *uc;
+
+	if (!ri->update_cache) {
+		ri->update_cache = list_new();
+		ri->update_cache->del = rip_update_cache_del;
+	}
+
+	uc = XCALLOC(MTYPE_RIP_UPDATE_CACHE, sizeof(*uc));
+	prefix_copy(&uc->address, ifc->address);
+	uc->version = version;
+	uc->output_gen = rip->output_gen;
+	uc->config_version = running_config->version;
+	uc->num = num;
+	/* Only keep as much memory as the RTEs need */
+	uc->rtes = stream_dup(rtes);
+	listnode_add(ri->update_cache, uc);
+
+	return uc;
+}
+
+/* Apply output policy to the routing table and write the RTEs to send on
+   the interface to the stream.  Return the number of RTEs written. */
+static int rip_output_rtes(struct rip *rip, struct connected *ifc,
+			   int route_type, uint8_t version,
+			   struct stream *rtes)
 {
-	struct rip *rip;
 	int ret;
-	struct stream *s;
 	struct route_node *rp;
 	struct rip_info *rinfo;
-	struct rip_interface *ri;
+	struct rip_interface *ri = ifc->ifp->info;
 	struct prefix_ipv4 *p;
 	struct prefix_ipv4 classfull;
 	struct prefix_ipv4 ifaddrclass;
-	struct key *key = NULL;
-	/* this might need to made dynamic if RIP ever supported auth methods
-	   with larger key string sizes */
-	char auth_str[RIP_AUTH_SIMPLE_SIZE];
-	size_t doff = 0; /* offset of digest offset field */
 	int num = 0;
-	int rtemax;
 	int subnetted = 0;
 	struct list *list = NULL;
 	struct listnode *listnode = NULL;
 
-	/* Logging output event. */
-	if (IS_RIP_DEBUG_EVENT) {
-		if (to)
-			zlog_debug("update routes to neighbor %pI4",
-				   &to->sin_addr);
-		else
-			zlog_debug("update routes on interface %s ifindex %d",
-				   ifc->ifp->name, ifc->ifp->ifindex);
-	}
-
-	/* Get RIP interface. */
-	ri = ifc->ifp->info;
-	rip = ri->rip;
-
-	/* Set output stream. */
-	s = rip->obuf;
-
-	/* Reset stream and RTE counter. */
-	stream_reset(s);
-	rtemax = RIP_MAX_RTE;
-
-	/* If output interface is in simple password authentication mode, we
-	   need space for authentication data.  */
-	if (ri->auth_type == RIP_AUTH_SIMPLE_PASSWORD)
-		rtemax -= 1;
-
-	/* If output interface is in MD5 authentication mode, we need space
-	   for authentication header and data. */
-	if (ri->auth_type == RIP_AUTH_MD5)
-		rtemax -= 2;
-
-	/* If output interface is in simple password authentication mode
-	   and string or keychain is specified we need space for auth. data */
-	if (ri->auth_type != RIP_NO_AUTH) {
-		if (ri->key_chain) {
-			struct keychain *keychain;
-
-			keychain = keychain_lookup(ri->key_chain);
-			if (keychain)
-				key = key_lookup_for_send(keychain);
-		}
-		/* to be passed to auth functions later */
-		rip_auth_prepare_str_send(ri, key, auth_str, sizeof(auth_str));
-		if (strlen(auth_str) == 0)
-			return;
-	}
-
 	if (version == RIPv1) {
 		memcpy(&ifaddrclass, ifc->address, sizeof(struct prefix_ipv4));
 		apply_classful_mask_ipv4(&ifaddrclass);
@@ -2355,44 +2391,41 @@ void rip_output_process(struct connected *ifc, struct sockaddr_in *to,
 				}
 			}
 
-			/* Prepare preamble, auth headers, if needs be */
-			if (num == 0) {
-				stream_putc(s, RIP_RESPONSE);
-				stream_putc(s, version);
-				stream_putw(s, 0);
-
-				/* auth header for !v1 && !no_auth */
-				if ((ri->auth_type != RIP_NO_AUTH)
-				    && (version != RIPv1))
-					doff = rip_auth_header_write(
-						s, ri, key, auth_str,
-						RIP_AUTH_SIMPLE_SIZE);
-			}
-
 			/* Write RTE to the stream. */
-			num = rip_write_rte(num, s, p, version, rinfo);
-			if (num == rtemax) {
-				if (version == RIPv2
-				    && ri->auth_type == RIP_AUTH_MD5)
-					rip_auth_md5_set(s, ri, doff, auth_str,
-							 RIP_AUTH_SIMPLE_SIZE);
-
-				ret = rip_send_packet(STREAM_DATA(s),
-						      stream_get_endp(s), to,
-						      ifc);
-
-				if (ret >= 0 && IS_RIP_DEBUG_SEND)
-					rip_packet_dump((struct rip_packet *)
-								STREAM_DATA(s),
-							stream_get_endp(s),
-							"SEND");
-				num = 0;
-				stream_reset(s);
-			}
+			num = rip_write_rte(num, rtes, p, version, rinfo);
 		}
 
-	/* Flush unwritten RTE. */
-	if (num != 0) {
+	return num;
+}
+
+/* Send the RTEs in as many packets as needed. */
+static void rip_output_send(struct connected *ifc, struct sockaddr_in *to,
+			    uint8_t version, struct key *key, char *auth_str,
+			    int rtemax, struct stream *rtes, int num)
+{
+	struct rip_interface *ri = ifc->ifp->info;
+	struct stream *s = ri->rip->obuf;
+	size_t doff = 0; /* offset of digest offset field */
+	int ret;
+	int i, count;
+
+	for (i = 0; i < num; i += count) {
+		count = MIN(num - i, rtemax);
+
+		/* Prepare preamble, auth headers, if needs be */
+		stream_reset(s);
+		stream_putc(s, RIP_RESPONSE);
+		stream_putc(s, version);
+		stream_putw(s, 0);
+
+		/* auth header for !v1 && !no_auth */
+		if ((ri->auth_type != RIP_NO_AUTH) && (version != RIPv1))
+			doff = rip_auth_header_write(s, ri, key, auth_str,
+						     RIP_AUTH_SIMPLE_SIZE);
+
+		stream_put(s, STREAM_DATA(rtes) + i * RIP_RTE_SIZE,
+			   count * RIP_RTE_SIZE);
+
 		if (version == RIPv2 && ri->auth_type == RIP_AUTH_MD5)
 			rip_auth_md5_set(s, ri, doff, auth_str,
 					 RIP_AUTH_SIMPLE_SIZE);
@@ -2403,7 +2436,90 @@ void rip_output_process(struct connected *ifc, struct sockaddr_in *to,
 		if (ret >= 0 && IS_RIP_DEBUG_SEND)
 			rip_packet_dump((struct rip_packet *)STREAM_DATA(s),
 					stream_get_endp(s), "SEND");
-		stream_reset(s);
+	}
+	stream_reset(s);
+}
+
+/*
+ * Send update to the ifp or spcified neighbor.
+ *
+ * Full updates only depend on the routing table, the configuration, the
+ * output interface address and the version, so their RTEs are cached per
+ * interface and reused by the next periodic updates and requests until
+ * something changes.
+ */
+void rip_output_process(struct connected *ifc, struct sockaddr_in *to,
+			int route_type, uint8_t version)
+{
+	struct rip *rip;
+	struct rip_interface *ri;
+	struct rip_update_cache *uc = NULL;
+	struct stream *rtes;
+	struct key *key = NULL;
+	/* this might need to made dynamic if RIP ever supported auth methods
+	   with larger key string sizes */
+	char auth_str[RIP_AUTH_SIMPLE_SIZE];
+	int num;
+	int rtemax;
+
+	/* Logging output event. */
+	if (IS_RIP_DEBUG_EVENT) {
+		if (to)
+			zlog_debug("update routes to neighbor %pI4",
+				   &to->sin_addr);
+		else
+			zlog_debug("update routes on interface %s ifindex %d",
+				   ifc->ifp->name, ifc->ifp->ifindex);
+	}
+
+	/* Get RIP interface. */
+	ri = ifc->ifp->info;
+	rip = ri->rip;
+
+	/* Reset RTE counter. */
+	rtemax = RIP_MAX_RTE;
+
+	/* If output interface is in simple password authentication mode, we
+	   need space for authentication data.  */
+	if (ri->auth_type == RIP_AUTH_SIMPLE_PASSWORD)
+		rtemax -= 1;
+
+	/* If output interface is in MD5 authentication mode, we need space
+	   for authentication header and data. */
+	if (ri->auth_type == RIP_AUTH_MD5)
+		rtemax -= 2;
+
+	/* If output interface is in simple password authentication mode
+	   and string or keychain is specified we need space for auth. data */
+	if (ri->auth_type != RIP_NO_AUTH) {
+		if (ri->key_chain) {
+			struct keychain *keychain;
+
+			keychain = keychain_lookup(ri->key_chain);
+			if (keychain)
+				key = key_lookup_for_send(keychain);
+		}
+		/* to be passed to auth functions later */
+		rip_auth_prepare_str_send(ri, key, auth_str, sizeof(auth_str));
+		if (strlen(auth_str) == 0)
+			return;
+	}
+
+	if (route_type == rip_all_route)
+		uc = rip_update_cache_lookup(rip, ifc, version);
+
+	if (uc) {
+		rip_output_send(ifc, to, version, key, auth_str, rtemax,
+				uc->rtes, uc->num);
+	} else {
+		rtes = stream_new(MAX(route_table_count(rip->table), 1)
+				  * RIP_RTE_SIZE);
+		num = rip_output_rtes(rip, ifc, route_type, version, rtes);
+		rip_output_send(ifc, to, version, key, auth_str, rtemax, rtes,
+				num);
+		if (route_type == rip_all_route)
+			rip_update_cache_add(rip, ifc, version, rtes, num);
+		stream_free(rtes);
 	}
 
 	/* Statistics updates. */
@@ -2458,62 +2574,95 @@ static void rip_update_interface(struct connected *ifc, uint8_t version,
 	}
 }
 
+/* Send update on each connected network of the interface. */
+static void rip_update_ifp(struct interface *ifp, int route_type)
+{
+	struct listnode *ifnode, *ifnnode;
+	struct connected *connected;
+	struct rip_interface *ri = ifp->info;
+	struct rip *rip = ri->rip;
+	int vsend;
+
+	if (if_is_loopback(ifp))
+		return;
+
+	if (!if_is_operative(ifp))
+		return;
+
+	/* When passive interface is specified, suppress announce to the
+	   interface. */
+	if (ri->passive)
+		return;
+
+	if (!ri->running)
+		return;
+
+	/*
+	 * If there is no version configuration in the
+	 * interface,
+	 * use rip's version setting.
+	 */
+	vsend = ((ri->ri_send == RI_RIP_UNSPEC) ? rip->version_send
+						 : ri->ri_send);
+
+	if (IS_RIP_DEBUG_EVENT)
+		zlog_debug("SEND UPDATE to %s ifindex %d", ifp->name,
+			   ifp->ifindex);
+
+	/* send update on each connected network */
+	for (ALL_LIST_ELEMENTS(ifp->connected, ifnode, ifnnode, connected)) {
+		if (connected->address->family == AF_INET) {
+			if (vsend & RIPv1)
+				rip_update_interface(connected, RIPv1,
+						     route_type);
+			if ((vsend & RIPv2) && if_is_multicast(ifp))
+				rip_update_interface(connected, RIPv2,
+						     route_type);
+		}
+	}
+}
+
+static int rip_update_ifp_timer(struct thread *t)
+{
+	struct interface *ifp = THREAD_ARG(t);
+	struct rip_interface *ri = ifp->info;
+
+	if (ri->rip)
+		rip_update_ifp(ifp, rip_all_route);
+
+	return 0;
+}
+
 /* Update send to all interface and neighbor. */
 static void rip_update_process(struct rip *rip, int route_type)
 {
-	struct listnode *ifnode, *ifnnode;
 	struct connected *connected;
 	struct interface *ifp;
 	struct rip_interface *ri;
 	struct route_node *rp;
 	struct sockaddr_in to;
 	struct prefix *p;
+	unsigned int count = 0, i = 0;
 
-	/* Send RIP update to each interface. */
-	FOR_ALL_INTERFACES (rip->vrf, ifp) {
-		if (if_is_loopback(ifp))
-			continue;
-
-		if (!if_is_operative(ifp))
-			continue;
-
-		/* Fetch RIP interface information. */
-		ri = ifp->info;
-
-		/* When passive interface is specified, suppress announce to the
-		   interface. */
-		if (ri->passive)
-			continue;
-
-		if (ri->running) {
-			/*
-			 * If there is no version configuration in the
-			 * interface,
-			 * use rip's version setting.
-			 */
-			int vsend = ((ri->ri_send == RI_RIP_UNSPEC)
-					     ? rip->version_send
-					     : ri->ri_send);
+	/* Triggered updates go out right away on each interface. */
+	if (route_type == rip_changed_route) {
+		FOR_ALL_INTERFACES (rip->vrf, ifp)
+			rip_update_ifp(ifp, route_type);
+	} else {
+		/* Regular updates to all the interfaces at once burn CPU
+		 * and bandwidth in bursts, spread them over the first
+		 * RIP_UPDATE_SPREAD of the update interval instead.
+		 */
+		FOR_ALL_INTERFACES (rip->vrf, ifp)
+			count++;
 
-			if (IS_RIP_DEBUG_EVENT)
-				zlog_debug("SEND UPDATE to %s ifindex %d",
-					   ifp->name, ifp->ifindex);
-
-			/* send update on each connected network */
-			for (ALL_LIST_ELEMENTS(ifp->connected, ifnode, ifnnode,
-					       connected)) {
-				if (connected->address->family == AF_INET) {
-					if (vsend & RIPv1)
-						rip_update_interface(
-							connected, RIPv1,
-							route_type);
-					if ((vsend & RIPv2)
-					    && if_is_multicast(ifp))
-						rip_update_interface(
-							connected, RIPv2,
-							route_type);
-				}
-			}
+		FOR_ALL_INTERFACES (rip->vrf, ifp) {
+			ri = ifp->info;
+			thread_add_timer_msec(master, rip_update_ifp_timer, ifp,
+					      (uint64_t)i++ * rip->update_time
+						      * 1000 / RIP_UPDATE_SPREAD
+						      / count,
+					      &ri->t_update);
 		}
 	}
 
@@ -2847,6 +2996,7 @@ void rip_event(struct rip *rip, enum rip_event event, int sock)
 				 &rip->t_update);
 		break;
 	case RIP_TRIGGERED_UPDATE:
+		rip->output_gen++;
 		if (rip->t_triggered_interval)
 			rip->trigger = 1;
 		else
@@ -3333,6 +3483,8 @@ static void rip_distribute_update(struct distribute_ctx *ctx,
 		return;
 
 	ri = ifp->info;
+	if (ri->rip)
+		ri->rip->output_gen++;
 
 	if (dist->list[DISTRIBUTE_V4_IN]) {
 		alist = access_list_lookup(AFI_IP,
@@ -3394,6 +3546,11 @@ static void rip_distribute_update_all(struct prefix_list *notused)
 {
 	struct vrf *vrf = vrf_lookup_by_id(VRF_DEFAULT);
 	struct interface *ifp;
+	struct rip *rip;
+
+	/* Offset lists and route-maps may use the list too */
+	RB_FOREACH (rip, rip_instance_head, &rip_instances)
+		rip->output_gen++;
 
 	FOR_ALL_INTERFACES (vrf, ifp)
 		rip_distribute_update_interface(ifp);
@@ -3511,6 +3668,9 @@ static void rip_routemap_update(const char *notused)
 	FOR_ALL_INTERFACES (vrf, ifp)
 		rip_if_rmap_update_interface(ifp);
 
+	RB_FOREACH (rip, rip_instance_head, &rip_instances)
+		rip->output_gen++;
+
 	rip = vrf->info;
 	if (rip)
 		rip_routemap_update_redistribute(rip);
@@ -63,6 +63,9 @@
 /* RIP peer timeout value. */
 #define RIP_PEER_TIMER_DEFAULT         180
 
+/* Periodic updates are spread over 1/RIP_UPDATE_SPREAD of the interval */
+#define RIP_UPDATE_SPREAD                4
+
 /* RIP port number. */
 #define RIP_PORT_DEFAULT               520
 #define RIP_VTY_PORT                  2602
@@ -137,6 +140,11 @@ struct rip {
 	/* Update and garbage timer. */
 	struct thread *t_update;
 
+	/* Bumped on every routing table or output policy change, to
+	 * invalidate the cached periodic updates.
+	 */
+	uint32_t output_gen;
+
 	/* Triggered update hack. */
 	int trigger;
 	struct thread *t_triggered_update;
@@ -326,6 +334,12 @@ struct rip_interface {
 	/* Wake up thread. */
 	struct thread *t_wakeup;
 
+	/* Periodic update, spread across the update interval. */
+	struct thread *t_update;
+
+	/* Cached periodic updates, see rip_output_process(). */
+	struct list *update_cache;
+
 	/* Interface statistics. */
 	int recv_badpackets;
 	int recv_badroutes;
@@ -474,6 +488,7 @@ extern void rip_zebra_ipv4_add(struct rip *rip, struct route_node *rp);
 extern void rip_zebra_ipv4_delete(struct rip *rip, struct route_node *rp);
 extern void rip_interface_multicast_set(int, struct connected *);
 extern void rip_distribute_update_interface(struct interface *);
+extern void rip_update_cache_free(struct rip_interface *ri);
 extern void rip_if_rmap_update_interface(struct interface *ifp);
 
 extern int rip_show_network_config(struct vty *vty, struct rip *rip);
@@ -22,6 +22,8 @@
 #ifndef __SHARP_GLOBAL_H__
 #define __SHARP_GLOBAL_H__
 
+#include "lib/latency.h"
+
 DECLARE_MGROUP(SHARPD)
 
 struct sharp_routes {
@@ -45,6 +47,26 @@ struct sharp_routes {
 
 	struct timeval t_start;
 	struct timeval t_end;
+
+	/* Routes sent to zebra but not acknowledged yet are limited to the
+	 * window, 0 means no limit.
+	 */
+	uint32_t window;
+	uint32_t acked_routes;
+
+	/* When the last route of the run was handed to zapi */
+	struct timeval t_sent;
+
+	/* Measurement mode: the send time of each route (usec since
+	 * t_start), indexed by its offset from the first prefix, and the
+	 * resulting latencies.
+	 */
+	bool measure;
+	struct prefix measure_base;
+	int64_t *sent_usec;
+	uint32_t sent_alloc;
+	struct latency_hist install_lat;
+	struct latency_hist remove_lat;
 };
 
 struct sharp_global {
@@ -139,6 +139,26 @@ DEFPY(sharp_nht_data_dump,
 	return CMD_SUCCESS;
 }
 
+static void sharp_rate_show(struct vty *vty, const char *what,
+			    uint32_t routes, const struct timeval *r)
+{
+	double secs = r->tv_sec + r->tv_usec / 1000000.0;
+
+	vty_out(vty, "%s: %u routes in %.3fs, %.0f routes/s\n", what, routes,
+		secs, secs > 0 ? routes / secs : 0.0);
+}
+
+/* Set up the inflight window and latency measurement for a new run */
+static void sharp_measure_set(uint32_t window, bool measure)
+{
+	sg.r.window = window;
+	sg.r.measure = measure;
+	if (measure) {
+		latency_hist_reset(&sg.r.install_lat);
+		latency_hist_reset(&sg.r.remove_lat);
+	}
+}
+
 DEFPY (install_routes_data_dump,
        install_routes_data_dump_cmd,
        "sharp data route",
@@ -153,6 +173,27 @@ DEFPY (install_routes_data_dump,
 		&sg.r.orig_prefix, sg.r.total_routes, sg.r.installed_routes,
 		sg.r.removed_routes, (intmax_t)r.tv_sec, (long)r.tv_usec);
 
+	if (sg.r.window)
+		vty_out(vty, "Window: %u, acknowledged: %u\n", sg.r.window,
+			sg.r.acked_routes);
+
+	/* Rate at which zapi took the routes, and zebra reported them done */
+	if (timerisset(&sg.r.t_sent)) {
+		timersub(&sg.r.t_sent, &sg.r.t_start, &r);
+		sharp_rate_show(vty, "Sent to zebra", sg.r.total_routes, &r);
+	}
+	if (timercmp(&sg.r.t_end, &sg.r.t_start, >)) {
+		timersub(&sg.r.t_end, &sg.r.t_start, &r);
+		sharp_rate_show(vty, "Acknowledged", sg.r.total_routes, &r);
+	}
+
+	if (sg.r.measure) {
+		vty_out(vty, "\n");
+		latency_hist_show_header(vty, "Route sent to");
+		latency_hist_show(vty, "installed", &sg.r.install_lat);
+		latency_hist_show(vty, "removed", &sg.r.remove_lat);
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -163,7 +204,8 @@ DEFPY (install_routes,
 	  <nexthop <A.B.C.D$nexthop4|X:X::X:X$nexthop6>|\
 	   nexthop-group NHGNAME$nexthop_group>\
 	  [backup$backup <A.B.C.D$backup_nexthop4|X:X::X:X$backup_nexthop6>] \
-	  (1-1000000)$routes [instance (0-255)$instance] [repeat (2-1000)$rpt]",
+	  (1-1000000)$routes [instance (0-255)$instance] [repeat (2-1000)$rpt]\
+	  [window (1-1000000)$window] [measure$measure]",
        "Sharp routing Protocol\n"
        "install some routes\n"
        "Routes to install\n"
@@ -183,7 +225,10 @@ DEFPY (install_routes,
        "Instance to use\n"
        "Instance\n"
        "Should we repeat this command\n"
-       "How many times to repeat this command\n")
+       "How many times to repeat this command\n"
+       "Limit the routes sent but not acknowledged by zebra\n"
+       "Number of routes\n"
+       "Record the install latency of each route\n")
 {
 	struct vrf *vrf;
 	struct prefix prefix;
@@ -192,6 +237,7 @@ DEFPY (install_routes,
 
 	sg.r.total_routes = routes;
 	sg.r.installed_routes = 0;
+	sharp_measure_set(window, !!measure);
 
 	if (rpt >= 2)
 		sg.r.repeat = rpt * 2;
@@ -334,7 +380,7 @@ DEFPY(vrf_label, vrf_label_cmd,
 
 DEFPY (remove_routes,
        remove_routes_cmd,
-       "sharp remove routes [vrf NAME$vrf_name] <A.B.C.D$start4|X:X::X:X$start6> (1-1000000)$routes [instance (0-255)$instance]",
+       "sharp remove routes [vrf NAME$vrf_name] <A.B.C.D$start4|X:X::X:X$start6> (1-1000000)$routes [instance (0-255)$instance] [window (1-1000000)$window] [measure$measure]",
        "Sharp Routing Protocol\n"
        "Remove some routes\n"
        "Routes to remove\n"
@@ -344,7 +390,10 @@ DEFPY (remove_routes,
        "v6 Starting spot\n"
        "Routes to uninstall\n"
        "instance to use\n"
-       "Value of instance\n")
+       "Value of instance\n"
+       "Limit the routes sent but not acknowledged by zebra\n"
+       "Number of routes\n"
+       "Record the removal latency of each route\n")
 {
 	struct vrf *vrf;
 	struct prefix prefix;
@@ -353,6 +402,8 @@ DEFPY (remove_routes,
 	sg.r.removed_routes = 0;
 	uint32_t rts;
 
+	sharp_measure_set(window, !!measure);
+
 	memset(&prefix, 0, sizeof(prefix));
 
 	if (start4.s_addr != 0) {
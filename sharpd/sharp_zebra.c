@@ -45,6 +45,7 @@ extern struct thread_master *master;
 extern struct zebra_privs_t sharp_privs;
 
 DEFINE_MTYPE_STATIC(SHARPD, ZC, "Test zclients");
+DEFINE_MTYPE_STATIC(SHARPD, SEND_TIMES, "Route send times");
 
 /* Struct to hold list of test zclients */
 struct sharp_zclient {
@@ -232,8 +233,87 @@ struct buffer_delay {
 	const struct nexthop_group *nhg;
 	const struct nexthop_group *backup_nhg;
 	enum where_to_restart restart;
+
+	/* Stopped on the inflight window rather than the zapi buffer */
+	bool window_wait;
 } wb;
 
+static void sharp_zclient_buffer_ready(void);
+
+static inline uint32_t sharp_prefix_offset(const struct prefix *p)
+{
+	const struct prefix *base = &sg.r.measure_base;
+
+	if (p->family == AF_INET)
+		return ntohl(p->u.prefix4.s_addr)
+		       - ntohl(base->u.prefix4.s_addr);
+	return ntohl(p->u.val32[3]) - ntohl(base->u.val32[3]);
+}
+
+/* Start a run of route installs or removals */
+static void sharp_routes_start(const struct prefix *p, uint32_t routes)
+{
+	monotime(&sg.r.t_start);
+	timerclear(&sg.r.t_sent);
+	sg.r.acked_routes = 0;
+	wb.window_wait = false;
+
+	if (!sg.r.measure)
+		return;
+
+	sg.r.measure_base = *p;
+	if (sg.r.sent_alloc < routes) {
+		sg.r.sent_usec = XREALLOC(MTYPE_SEND_TIMES, sg.r.sent_usec,
+					  routes * sizeof(*sg.r.sent_usec));
+		sg.r.sent_alloc = routes;
+	}
+	for (uint32_t i = 0; i < routes; i++)
+		sg.r.sent_usec[i] = -1;
+}
+
+static inline void sharp_route_sent(const struct prefix *p)
+{
+	uint32_t offset;
+
+	if (!sg.r.measure)
+		return;
+
+	offset = sharp_prefix_offset(p);
+	if (offset < sg.r.sent_alloc)
+		sg.r.sent_usec[offset] = monotime_since(&sg.r.t_start, NULL);
+}
+
+/* zebra acknowledged a route of the current run */
+static void sharp_route_acked(const struct prefix *p,
+			      struct latency_hist *hist)
+{
+	uint32_t offset;
+
+	sg.r.acked_routes++;
+
+	if (sg.r.measure) {
+		offset = sharp_prefix_offset(p);
+		if (offset < sg.r.sent_alloc && sg.r.sent_usec[offset] >= 0) {
+			latency_hist_add(hist,
+					 monotime_since(&sg.r.t_start, NULL)
+						 - sg.r.sent_usec[offset]);
+			sg.r.sent_usec[offset] = -1;
+		}
+	}
+
+	/* Resume sending once the window opens up again */
+	if (wb.window_wait && wb.count - sg.r.acked_routes < sg.r.window) {
+		wb.window_wait = false;
+		sharp_zclient_buffer_ready();
+	}
+}
+
+/* Whether the inflight window is full after sending count routes */
+static inline bool sharp_window_full(uint32_t count)
+{
+	return sg.r.window && count - sg.r.acked_routes >= sg.r.window;
+}
+
 /*
  * route_add - Encodes a route to zebra
  *
@@ -337,17 +417,24 @@ static void sharp_install_routes_restart(struct prefix *p, uint32_t count,
 	} else
 		temp = ntohl(p->u.val32[3]);
 
+	/* Send as many routes per write to zebra as possible */
+	zclient_batch_start(zclient);
 	for (i = count; i < routes; i++) {
-		bool buffered = route_add(p, vrf_id, (uint8_t)instance, nhgid,
-					  nhg, backup_nhg);
-		if (v4)
-			p->u.prefix4.s_addr = htonl(++temp);
-		else
-			p->u.val32[3] = htonl(++temp);
+		bool buffered = false, full = sharp_window_full(i);
+
+		if (!full) {
+			sharp_route_sent(p);
+			buffered = route_add(p, vrf_id, (uint8_t)instance,
+					     nhgid, nhg, backup_nhg);
+			if (v4)
+				p->u.prefix4.s_addr = htonl(++temp);
+			else
+				p->u.val32[3] = htonl(++temp);
+		}
 
-		if (buffered) {
+		if (full || buffered) {
 			wb.p = *p;
-			wb.count = i+1;
+			wb.count = full ? i : i + 1;
 			wb.routes = routes;
 			wb.vrf_id = vrf_id;
 			wb.instance = instance;
@@ -355,10 +442,13 @@ static void sharp_install_routes_restart(struct prefix *p, uint32_t count,
 			wb.nhg = nhg;
 			wb.backup_nhg = backup_nhg;
 			wb.restart = SHARP_INSTALL_ROUTES_RESTART;
-
-			return;
+			wb.window_wait = full;
+			break;
 		}
 	}
+	if (i == routes && !timerisset(&sg.r.t_sent))
+		monotime(&sg.r.t_sent);
+	zclient_batch_end(zclient);
 }
 
 void sharp_install_routes_helper(struct prefix *p, vrf_id_t vrf_id,
@@ -373,7 +463,7 @@ void sharp_install_routes_helper(struct prefix *p, vrf_id_t vrf_id,
 	if (backup_nhg && (backup_nhg->nexthop == NULL))
 		backup_nhg = NULL;
 
-	monotime(&sg.r.t_start);
+	sharp_routes_start(p, routes);
 	sharp_install_routes_restart(p, 0, vrf_id, instance, nhgid, nhg,
 				     backup_nhg, routes);
 }
@@ -391,25 +481,33 @@ static void sharp_remove_routes_restart(struct prefix *p, uint32_t count,
 	} else
 		temp = ntohl(p->u.val32[3]);
 
+	zclient_batch_start(zclient);
 	for (i = count; i < routes; i++) {
-		bool buffered = route_delete(p, vrf_id, (uint8_t)instance);
-
-		if (v4)
-			p->u.prefix4.s_addr = htonl(++temp);
-		else
-			p->u.val32[3] = htonl(++temp);
+		bool buffered = false, full = sharp_window_full(i);
+
+		if (!full) {
+			sharp_route_sent(p);
+			buffered = route_delete(p, vrf_id, (uint8_t)instance);
+			if (v4)
+				p->u.prefix4.s_addr = htonl(++temp);
+			else
+				p->u.val32[3] = htonl(++temp);
+		}
 
-		if (buffered) {
+		if (full || buffered) {
 			wb.p = *p;
-			wb.count = i + 1;
+			wb.count = full ? i : i + 1;
 			wb.vrf_id = vrf_id;
 			wb.instance = instance;
 			wb.routes = routes;
 			wb.restart = SHARP_DELETE_ROUTES_RESTART;
-
-			return;
+			wb.window_wait = full;
+			break;
 		}
 	}
+	if (i == routes && !timerisset(&sg.r.t_sent))
+		monotime(&sg.r.t_sent);
+	zclient_batch_end(zclient);
 }
 
 void sharp_remove_routes_helper(struct prefix *p, vrf_id_t vrf_id,
@@ -417,8 +515,7 @@ void sharp_remove_routes_helper(struct prefix *p, vrf_id_t vrf_id,
 {
 	zlog_debug("Removing %u routes", routes);
 
-	monotime(&sg.r.t_start);
-
+	sharp_routes_start(p, routes);
 	sharp_remove_routes_restart(p, 0, vrf_id, instance, routes);
 }
 
@@ -473,6 +570,7 @@ static int route_notify_owner(ZAPI_CALLBACK_ARGS)
 
 	switch (note) {
 	case ZAPI_ROUTE_INSTALLED:
+		sharp_route_acked(&p, &sg.r.install_lat);
 		sg.r.installed_routes++;
 		if (sg.r.total_routes == sg.r.installed_routes) {
 			monotime(&sg.r.t_end);
@@ -483,12 +581,15 @@ static int route_notify_owner(ZAPI_CALLBACK_ARGS)
 		}
 		break;
 	case ZAPI_ROUTE_FAIL_INSTALL:
+		sharp_route_acked(&p, &sg.r.install_lat);
 		zlog_debug("Failed install of route");
 		break;
 	case ZAPI_ROUTE_BETTER_ADMIN_WON:
+		sharp_route_acked(&p, &sg.r.install_lat);
 		zlog_debug("Better Admin Distance won over us");
 		break;
 	case ZAPI_ROUTE_REMOVED:
+		sharp_route_acked(&p, &sg.r.remove_lat);
 		sg.r.removed_routes++;
 		if (sg.r.total_routes == sg.r.removed_routes) {
 			monotime(&sg.r.t_end);
@@ -499,6 +600,7 @@ static int route_notify_owner(ZAPI_CALLBACK_ARGS)
 		}
 		break;
 	case ZAPI_ROUTE_REMOVE_FAIL:
+		sharp_route_acked(&p, &sg.r.remove_lat);
 		zlog_debug("Route removal Failure");
 		break;
 	}
@@ -212,6 +212,28 @@ static int static_zebra_nexthop_update(ZAPI_CALLBACK_ARGS)
 	return 1;
 }
 
+/*
+ * Route and nexthop registration messages are batched until the current
+ * event loop iteration is done: a northbound commit, a nexthop update or
+ * a VRF/interface change all end up in a single write to zebra.
+ */
+static struct thread *t_batch;
+
+static int static_zebra_batch_flush(struct thread *thread)
+{
+	(void)zclient_batch_end(zclient);
+	return 0;
+}
+
+static void static_zebra_batch_defer(void)
+{
+	if (!zclient || t_batch)
+		return;
+
+	zclient_batch_start(zclient);
+	thread_add_event(master, static_zebra_batch_flush, NULL, 0, &t_batch);
+}
+
 static void static_zebra_capabilities(struct zclient_capabilities *cap)
 {
 	mpls_enabled = cap->mpls_enabled;
@@ -331,6 +353,7 @@ void static_zebra_nht_register(struct route_node *rn, struct static_nexthop *nh,
 		static_nht_hash_free(nhtd);
 	}
 
+	static_zebra_batch_defer();
 	if (zclient_send_rnh(zclient, cmd, &p, false, nh->nh_vrf_id)
 	    == ZCLIENT_SEND_FAILURE)
 		zlog_warn("%s: Failure to send nexthop to zebra", __func__);
@@ -502,6 +525,7 @@ extern void static_zebra_route_add(struct route_node *rn,
 	if (!nh_num && install)
 		install = false;
 
+	static_zebra_batch_defer();
 	zclient_route_send(install ?
 			   ZEBRA_ROUTE_ADD : ZEBRA_ROUTE_DELETE,
 			   zclient, &api);
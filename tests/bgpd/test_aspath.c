@@ -860,6 +860,25 @@ static struct aspath *make_aspath(const uint8_t *data, size_t len, int use32bit)
 	return as;
 }
 
+/* same, decoding first and interning later like the UPDATE parse pthreads */
+static struct aspath *make_aspath_new(const uint8_t *data, size_t len,
+				      int use32bit)
+{
+	struct stream *s = NULL;
+	struct aspath *as;
+
+	if (len) {
+		s = stream_new(len);
+		stream_put(s, data, len);
+	}
+	as = aspath_parse_new(s, len, use32bit);
+
+	if (s)
+		stream_free(s);
+
+	return as ? aspath_intern(as) : NULL;
+}
+
 static void printbytes(const uint8_t *bytes, int len)
 {
 	int i = 0;
@@ -880,7 +899,7 @@ static int validate(struct aspath *as, const struct test_spec *sp)
 	int fails = 0;
 	const uint8_t *out;
 	static struct stream *s;
-	struct aspath *asinout, *asconfeddel, *asstr, *as4;
+	struct aspath *asinout, *asconfeddel, *asstr, *as4, *asnew;
 
 	if (as == NULL && sp->shouldbe == NULL) {
 		printf("Correctly failed to parse\n");
@@ -895,6 +914,7 @@ static int validate(struct aspath *as, const struct test_spec *sp)
 		s = stream_new(4096);
 	bytes4 = aspath_put(s, as, 1);
 	as4 = make_aspath(STREAM_DATA(s), bytes4, 1);
+	asnew = make_aspath_new(STREAM_DATA(s), bytes4, 1);
 
 	asstr = aspath_str2aspath(sp->shouldbe);
 
@@ -932,6 +952,8 @@ static int validate(struct aspath *as, const struct test_spec *sp)
 	    || strcmp(aspath_print(asinout), sp->shouldbe)
 	    /* By 4-byte parsing */
 	    || strcmp(aspath_print(as4), sp->shouldbe)
+	    /* decoded and interned separately */
+	    || asnew != as4
 	    /* by various path counts */
 	    || (aspath_count_hops(as) != sp->hops)
 	    || (aspath_count_confeds(as) != sp->confeds)
@@ -992,6 +1014,7 @@ static int validate(struct aspath *as, const struct test_spec *sp)
 	}
 	aspath_unintern(&asinout);
 	aspath_unintern(&as4);
+	aspath_unintern(&asnew);
 
 	aspath_free(asconfeddel);
 	aspath_free(asstr);
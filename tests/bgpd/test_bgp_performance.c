@@ -0,0 +1,398 @@
+/*
+ * Benchmark the bgpd route hot path
+ *
+ * Drives a synthetic IPv4 table from several peers through the attribute
+ * parser, bgp_update(), best path selection and update-group packet
+ * generation, and reports the throughput of each stage together with the
+ * memory used per path.  The rate AS paths and communities are interned at
+ * is measured separately.
+ *
+ * Usage: test_bgp_performance [prefixes]
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+/* malloc.h is generally obsolete, however GNU Libc mallinfo wants it. */
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "zclient.h"
+#include "monotime.h"
+#include "workqueue.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_vty.h"
+
+#define NPREFIXES 200000
+#define NPEERS	  2
+#define NASPATHS  1024
+#define ROUNDS	  200000
+
+/* prefixes per UPDATE, about what fits in 4096 bytes */
+#define NLRI_CHUNK 1000
+
+/* need these to link in libbgp */
+struct thread_master *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+static struct bgp *bgp;
+static as_t asn = 65000;
+static struct peer *peers[NPEERS];
+static unsigned int nprefixes = NPREFIXES;
+static bool drained;
+
+static void report(const char *name, unsigned long count, struct timeval *start)
+{
+	int64_t us = monotime_since(start, NULL);
+
+	printf("%-20s %8lu: %6lld ms %12.0f/s\n", name, count,
+	       (long long)us / 1000, us ? count * 1000000.0 / us : 0.0);
+}
+
+static size_t heap_used(void)
+{
+#ifdef HAVE_MALLINFO
+	struct mallinfo minfo = mallinfo();
+
+	return (size_t)minfo.uordblks + (size_t)minfo.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static struct peer *bench_peer_new(as_t as, unsigned int idx)
+{
+	struct peer *peer;
+	char host[32];
+
+	snprintf(host, sizeof(host), "10.0.%u.2", idx);
+
+	peer = peer_create_accept(bgp);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, host);
+	str2sockunion(host, &peer->su);
+	peer->as = as;
+	peer->local_as = asn;
+	peer->sort = peer_sort(peer);
+	peer->status = Established;
+	peer->curr = stream_new(BGP_MAX_PACKET_SIZE);
+	SET_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE);
+	SET_FLAG(peer->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+	peer->afc[AFI_IP][SAFI_UNICAST] = 1;
+	peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+	peer_af_create(peer, AFI_IP, SAFI_UNICAST);
+
+	return peer;
+}
+
+/* ORIGIN, AS_PATH, NEXT_HOP and MED; the AS_PATH and MED vary with the
+ * variant so the table holds NASPATHS distinct attribute sets per peer.
+ */
+static size_t attr_build(uint8_t *buf, unsigned int idx, unsigned int variant)
+{
+	unsigned int hops = 2 + idx + variant % 3;
+	uint8_t *p = buf;
+
+	*p++ = BGP_ATTR_FLAG_TRANS;
+	*p++ = BGP_ATTR_ORIGIN;
+	*p++ = 1;
+	*p++ = BGP_ORIGIN_IGP;
+
+	*p++ = BGP_ATTR_FLAG_TRANS;
+	*p++ = BGP_ATTR_AS_PATH;
+	*p++ = 2 + 4 * hops;
+	*p++ = AS_SEQUENCE;
+	*p++ = hops;
+	for (unsigned int i = 0; i < hops; i++) {
+		uint32_t as = i ? 100 + variant * 7 + i : peers[idx]->as;
+
+		as = htonl(as);
+		memcpy(p, &as, 4);
+		p += 4;
+	}
+
+	*p++ = BGP_ATTR_FLAG_TRANS;
+	*p++ = BGP_ATTR_NEXT_HOP;
+	*p++ = 4;
+	*p++ = 10;
+	*p++ = 0;
+	*p++ = idx;
+	*p++ = 1;
+
+	*p++ = BGP_ATTR_FLAG_OPTIONAL;
+	*p++ = BGP_ATTR_MULTI_EXIT_DISC;
+	*p++ = 4;
+	*p++ = 0;
+	*p++ = 0;
+	*p++ = variant >> 8;
+	*p++ = variant;
+
+	return p - buf;
+}
+
+static void attr_parse(struct peer *peer, struct attr *attr, uint8_t *buf,
+		       size_t len)
+{
+	struct bgp_nlri mp_update = {0}, mp_withdraw = {0};
+	bgp_attr_parse_ret_t ret;
+
+	stream_reset(peer->curr);
+	stream_put(peer->curr, buf, len);
+
+	memset(attr, 0, sizeof(*attr));
+	ret = bgp_attr_parse(peer, attr, len, &mp_update, &mp_withdraw);
+	assert(ret == BGP_ATTR_PARSE_PROCEED);
+}
+
+static void bench_attr_parse(void)
+{
+	struct timeval start;
+	struct attr attr;
+	uint8_t buf[256];
+	size_t len;
+
+	monotime(&start);
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		len = attr_build(buf, 0, i % NASPATHS);
+		attr_parse(peers[0], &attr, buf, len);
+		bgp_attr_unintern_sub(&attr);
+	}
+	report("attr parse", ROUNDS, &start);
+}
+
+/*
+ * Intern values that are mostly interned already, as with a feed where many
+ * routes carry the same communities: every round is a lookup hit.
+ */
+#define NCOMMS 16
+
+static void bench_intern(void)
+{
+	struct timeval start;
+	struct aspath *aspaths[NASPATHS], *aspath;
+	struct community *coms[NASPATHS], *com;
+	struct lcommunity *lcoms[NASPATHS], *lcom;
+	uint32_t cbuf[NCOMMS], lbuf[NCOMMS * 3];
+	struct stream *s = stream_new(BGP_MAX_PACKET_SIZE);
+	unsigned int i, j, v;
+
+	for (i = 0; i < NASPATHS + ROUNDS; i++) {
+		v = i % NASPATHS;
+		stream_reset(s);
+		stream_putc(s, AS_SEQUENCE);
+		stream_putc(s, NCOMMS);
+		for (j = 0; j < NCOMMS; j++)
+			stream_putl(s, 64512 + v * NCOMMS + j);
+
+		if (i == NASPATHS)
+			monotime(&start);
+		aspath = aspath_parse(s, stream_get_endp(s), 1);
+		if (i < NASPATHS)
+			aspaths[v] = aspath;
+		else
+			aspath_unintern(&aspath);
+	}
+	report("aspath intern", ROUNDS, &start);
+
+	for (i = 0; i < NASPATHS + ROUNDS; i++) {
+		v = i % NASPATHS;
+		for (j = 0; j < NCOMMS; j++)
+			cbuf[j] = htonl((65000U << 16) + v * NCOMMS + j);
+
+		if (i == NASPATHS)
+			monotime(&start);
+		com = community_parse(cbuf, sizeof(cbuf));
+		if (i < NASPATHS)
+			coms[v] = com;
+		else
+			community_unintern(&com);
+	}
+	report("community intern", ROUNDS, &start);
+
+	for (i = 0; i < NASPATHS + ROUNDS; i++) {
+		v = i % NASPATHS;
+		for (j = 0; j < NCOMMS; j++) {
+			lbuf[j * 3] = htonl(4200000000U);
+			lbuf[j * 3 + 1] = htonl(v);
+			lbuf[j * 3 + 2] = htonl(j);
+		}
+
+		if (i == NASPATHS)
+			monotime(&start);
+		lcom = lcommunity_parse((uint8_t *)lbuf, sizeof(lbuf));
+		if (i < NASPATHS)
+			lcoms[v] = lcom;
+		else
+			lcommunity_unintern(&lcom);
+	}
+	report("lcommunity intern", ROUNDS, &start);
+
+	for (v = 0; v < NASPATHS; v++) {
+		aspath_unintern(&aspaths[v]);
+		community_unintern(&coms[v]);
+		lcommunity_unintern(&lcoms[v]);
+	}
+	stream_free(s);
+}
+
+/* Feed the table in UPDATE sized chunks, one attribute set per chunk */
+static void bench_update(void)
+{
+	struct timeval start;
+	struct bgp_nlri nlri;
+	struct attr attr;
+	uint8_t abuf[256], nbuf[NLRI_CHUNK * 4];
+	size_t alen;
+
+	monotime(&start);
+	for (unsigned int idx = 0; idx < NPEERS; idx++)
+		for (unsigned int i = 0; i < nprefixes; i += NLRI_CHUNK) {
+			uint8_t *p = nbuf;
+
+			for (unsigned int j = i;
+			     j < nprefixes && j < i + NLRI_CHUNK; j++) {
+				*p++ = 24;
+				*p++ = 1 + (j >> 16);
+				*p++ = j >> 8;
+				*p++ = j;
+			}
+
+			alen = attr_build(abuf, idx, (i / NLRI_CHUNK) % NASPATHS);
+			attr_parse(peers[idx], &attr, abuf, alen);
+
+			nlri.afi = AFI_IP;
+			nlri.safi = SAFI_UNICAST;
+			nlri.nlri = nbuf;
+			nlri.length = p - nbuf;
+			bgp_nlri_parse(peers[idx], &attr, &nlri, 0);
+
+			bgp_attr_unintern_sub(&attr);
+		}
+	report("bgp_update", (unsigned long)nprefixes * NPEERS, &start);
+}
+
+static int drain_check(struct thread *thread)
+{
+	if (work_queue_empty(bgp->process_queue)) {
+		drained = true;
+		return 0;
+	}
+
+	thread_add_timer_msec(master, drain_check, NULL, 1, NULL);
+	return 0;
+}
+
+/* Run the event loop until the route process queue is empty */
+static void bench_bestpath(void)
+{
+	struct timeval start;
+	struct thread thread;
+
+	drained = false;
+	thread_add_timer_msec(master, drain_check, NULL, 1, NULL);
+
+	monotime(&start);
+	while (!drained && thread_fetch(master, &thread))
+		thread_call(&thread);
+	report("best path", nprefixes, &start);
+}
+
+static void bench_updgrp(void)
+{
+	struct timeval start;
+	struct peer *peer;
+	struct peer_af *paf;
+	struct update_subgroup *subgrp;
+	struct bpacket *pkt;
+	unsigned long npkts = 0, bytes = 0;
+
+	peer = bench_peer_new(65100, 255);
+	update_group_adjust_peer_afs(peer);
+	paf = peer_af_find(peer, AFI_IP, SAFI_UNICAST);
+	subgrp = PAF_SUBGRP(paf);
+	assert(subgrp);
+
+	monotime(&start);
+	subgroup_announce_table(subgrp, NULL);
+	while ((pkt = subgroup_update_packet(subgrp))) {
+		npkts++;
+		bytes += stream_get_endp(pkt->buffer);
+		bpacket_queue_advance_peer(paf);
+	}
+	report("update-group", nprefixes, &start);
+	printf("%-20s %8lu: %6lu bytes\n", "  packets", npkts, bytes);
+}
+
+int main(int argc, char **argv)
+{
+	size_t heap;
+
+	if (argc > 1)
+		nprefixes = strtoul(argv[1], NULL, 0);
+
+	qobj_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = thread_master_create("test bgp performance");
+	zclient = zclient_new(master, &zclient_options_default);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE);
+	vrf_init(NULL, NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_option_set(BGP_OPT_NO_FIB);
+	bgp_attr_init();
+
+	/* a view treats every nexthop as resolved, no zebra needed */
+	if (bgp_get(&bgp, &asn, "bench", BGP_INSTANCE_TYPE_VIEW) < 0)
+		return 1;
+
+	for (unsigned int idx = 0; idx < NPEERS; idx++)
+		peers[idx] = bench_peer_new(65001 + idx, idx);
+
+	printf("%u prefixes from %u peers\n", nprefixes, NPEERS);
+
+	bench_attr_parse();
+	bench_intern();
+
+	heap = heap_used();
+	bench_update();
+	bench_bestpath();
+	if (heap)
+		printf("%-20s %8lu: %6zu bytes\n", "memory per path",
+		       (unsigned long)nprefixes * NPEERS,
+		       (heap_used() - heap) / ((size_t)nprefixes * NPEERS));
+
+	bench_updgrp();
+
+	return 0;
+}
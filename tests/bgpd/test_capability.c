@@ -649,6 +649,13 @@ static struct test_segment misc_segments[] =
 			2,
 			SHOULD_PARSE,
 		},
+		{
+			"ExtMsg",
+			"Extended Message capability",
+			{CAPABILITY_CODE_EXT_MESSAGE, 0x0},
+			2,
+			SHOULD_PARSE,
+		},
 		{NULL, NULL, {0}, 0, 0}};
 
 /* DYNAMIC message */
@@ -36,6 +36,7 @@ TestCapability.okfail("ORF-empty: ORF capability, but empty.")
 TestCapability.okfail("AS4-empty: AS4 capability, but empty.")
 TestCapability.okfail("dyn-empty: Dynamic capability, but empty.")
 TestCapability.okfail("dyn-old: Dynamic capability (deprecated version)")
+TestCapability.okfail("ExtMsg: Extended Message capability")
 TestCapability.okfail("Cap-singlets: One capability per Optional-Param")
 TestCapability.okfail("Cap-series: Series of capability, one Optional-Param")
 TestCapability.okfail("AS4more: AS4 capability after other caps (singlets)")
@@ -0,0 +1,138 @@
+/*
+ * Concurrent interning of BGP attribute parts
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <zebra.h>
+
+#include <pthread.h>
+
+#include "privs.h"
+#include "memory.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define NTHREADS 8
+#define NVALUES 16
+#define NROUNDS 20000
+
+/* interned by the main pthread, the others must get the same objects */
+static struct community *coms[NVALUES];
+static struct aspath *paths[NVALUES];
+
+static struct community *make_com(unsigned int i)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%u:%u", 65000 + i, i);
+	return community_str2com(buf);
+}
+
+static struct aspath *make_path(unsigned int i)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%u %u", 64512 + i, 65000 - i);
+	return aspath_str2aspath(buf);
+}
+
+static void *worker(void *arg)
+{
+	uintptr_t failed = 0;
+	unsigned int seed = (uintptr_t)arg;
+
+	for (unsigned int n = 0; n < NROUNDS; n++) {
+		unsigned int i = rand_r(&seed) % NVALUES;
+		struct community *com = community_intern(make_com(i));
+		struct aspath *path = aspath_intern(make_path(i));
+
+		if (com != coms[i] || path != paths[i])
+			failed++;
+
+		community_unintern(&com);
+		aspath_unintern(&path);
+	}
+	return (void *)failed;
+}
+
+/* values nobody else holds come and go while the other pthreads look */
+static void *churn(void *arg)
+{
+	uintptr_t failed = 0;
+
+	for (unsigned int n = 0; n < NROUNDS; n++) {
+		unsigned int i = NVALUES + n % NVALUES;
+		struct community *com = community_intern(make_com(i));
+		struct community *com2 = community_intern(make_com(i));
+
+		if (com != com2 || com->refcnt < 2)
+			failed++;
+
+		community_unintern(&com);
+		community_unintern(&com2);
+	}
+	return (void *)failed;
+}
+
+int main(void)
+{
+	pthread_t threads[NTHREADS + 1];
+	uintptr_t failed = 0;
+	void *ret;
+
+	aspath_init();
+	community_init();
+
+	for (unsigned int i = 0; i < NVALUES; i++) {
+		coms[i] = community_intern(make_com(i));
+		paths[i] = aspath_intern(make_path(i));
+	}
+
+	for (unsigned int i = 0; i < NTHREADS; i++)
+		pthread_create(&threads[i], NULL, worker,
+			       (void *)(uintptr_t)(i + 1));
+	pthread_create(&threads[NTHREADS], NULL, churn, NULL);
+
+	for (unsigned int i = 0; i <= NTHREADS; i++) {
+		pthread_join(threads[i], &ret);
+		failed += (uintptr_t)ret;
+	}
+
+	for (unsigned int i = 0; i < NVALUES; i++) {
+		if (coms[i]->refcnt != 1 || paths[i]->refcnt != 1)
+			failed++;
+		community_unintern(&coms[i]);
+		aspath_unintern(&paths[i]);
+	}
+
+	if (community_count() != 0 || aspath_count() != 0)
+		failed++;
+
+	aspath_finish();
+	community_finish();
+
+	if (failed) {
+		printf("failures: %lu\n", (unsigned long)failed);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
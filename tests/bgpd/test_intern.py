@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestIntern(frrtest.TestMultiOut):
+    program = "./test_intern"
+
+
+TestIntern.onesimple("OK")
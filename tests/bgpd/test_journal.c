@@ -0,0 +1,182 @@
+/*
+ * Adj-RIB-In journal reconciliation test
+ *
+ * Routes reloaded from the journal are stale until the peer sends them
+ * again; on End-of-RIB everything still stale is removed.  Check that a
+ * route re-advertised with identical attributes, which interns to the same
+ * attr as the reloaded one, survives that.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_journal.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct thread_master *master = NULL;
+extern struct zclient *zclient;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+enum {
+	/* sent again as the same interned attr */
+	ROUTE_SAME_ATTR,
+	/* sent again, identical attributes parsed into a fresh attr */
+	ROUTE_SAME_CONTENT,
+	/* sent again with a different MED */
+	ROUTE_CHANGED,
+	/* not sent again */
+	ROUTE_WITHDRAWN,
+	NROUTES,
+};
+
+static struct bgp *bgp;
+static as_t asn = 65000;
+
+static struct peer *test_peer_new(void)
+{
+	struct peer *peer;
+
+	peer = peer_create_accept(bgp);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "10.0.0.2");
+	str2sockunion(peer->host, &peer->su);
+	peer->as = 65001;
+	peer->local_as = asn;
+	peer->sort = peer_sort(peer);
+	peer->status = Established;
+	SET_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE);
+	peer->afc[AFI_IP][SAFI_UNICAST] = 1;
+	peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+	peer_af_create(peer, AFI_IP, SAFI_UNICAST);
+
+	return peer;
+}
+
+static void attr_make(struct attr *attr, uint32_t med)
+{
+	memset(attr, 0, sizeof(*attr));
+	bgp_attr_default_set(attr, BGP_ORIGIN_IGP);
+	attr->nexthop.s_addr = htonl(0x0a000002);
+	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP);
+	attr->med = med;
+	attr->flag |= ATTR_FLAG_BIT(BGP_ATTR_MULTI_EXIT_DISC);
+}
+
+static struct bgp_adj_in *adj_find(struct bgp_dest *dest, struct peer *peer)
+{
+	struct bgp_adj_in *adj;
+
+	for (adj = dest->adj_in; adj; adj = adj->next)
+		if (adj->peer == peer)
+			return adj;
+	return NULL;
+}
+
+int main(void)
+{
+	struct bgp_dest *dests[NROUTES];
+	struct bgp_adj_in *adj;
+	struct peer *peer;
+	struct prefix p;
+	struct attr attr;
+	unsigned long failed = 0;
+
+	qobj_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = thread_master_create("test journal");
+	zclient = zclient_new(master, &zclient_options_default);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE);
+	vrf_init(NULL, NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_option_set(BGP_OPT_NO_FIB);
+	bgp_attr_init();
+
+	if (bgp_get(&bgp, &asn, "journal", BGP_INSTANCE_TYPE_VIEW) < 0)
+		return 1;
+	peer = test_peer_new();
+
+	/* what bgp_journal_load() leaves behind: reloaded, then marked */
+	for (unsigned int i = 0; i < NROUTES; i++) {
+		str2prefix("192.0.2.0/32", &p);
+		p.u.prefix4.s_addr = htonl(ntohl(p.u.prefix4.s_addr) + i);
+		dests[i] = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+
+		attr_make(&attr, 100);
+		bgp_adj_in_set(dests[i], peer, &attr, 0);
+		adj_find(dests[i], peer)->stale = true;
+	}
+	peer->adj_in_stale[AFI_IP][SAFI_UNICAST] = true;
+
+	/* the peer comes back */
+	adj = adj_find(dests[ROUTE_SAME_ATTR], peer);
+	bgp_adj_in_set(dests[ROUTE_SAME_ATTR], peer, adj->attr, 0);
+
+	attr_make(&attr, 100);
+	bgp_adj_in_set(dests[ROUTE_SAME_CONTENT], peer, &attr, 0);
+
+	attr_make(&attr, 200);
+	bgp_adj_in_set(dests[ROUTE_CHANGED], peer, &attr, 0);
+
+	/* End-of-RIB */
+	bgp_journal_reconcile(peer, AFI_IP, SAFI_UNICAST);
+
+	for (unsigned int i = 0; i < NROUTES; i++) {
+		adj = adj_find(dests[i], peer);
+
+		if (i == ROUTE_WITHDRAWN) {
+			if (adj) {
+				printf("route %u not removed\n", i);
+				failed++;
+			}
+		} else if (!adj) {
+			printf("route %u removed\n", i);
+			failed++;
+		} else if (adj->stale) {
+			printf("route %u still stale\n", i);
+			failed++;
+		}
+	}
+
+	if (peer->adj_in_stale[AFI_IP][SAFI_UNICAST]) {
+		printf("peer still has stale routes\n");
+		failed++;
+	}
+
+	if (failed) {
+		printf("failures: %lu\n", failed);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
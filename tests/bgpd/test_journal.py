@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestJournal(frrtest.TestMultiOut):
+    program = "./test_journal"
+
+
+TestJournal.onesimple("OK")
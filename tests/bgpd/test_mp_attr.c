@@ -27,9 +27,11 @@
 #include "memory.h"
 #include "queue.h"
 #include "filter.h"
+#include "monotime.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_open.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_route.h"
@@ -1064,10 +1066,55 @@ static void parse_test(struct peer *peer, struct test_segment *t, int type)
 	handle_result(peer, t, parse_ret, nlri_ret);
 }
 
+/* ORIGIN, AS_PATH, NEXT_HOP, MED, LOCAL_PREF and COMMUNITIES */
+static const uint8_t bench_attrs[] = {
+	BGP_ATTR_FLAG_TRANS, BGP_ATTR_ORIGIN, 1, BGP_ORIGIN_IGP,
+	BGP_ATTR_FLAG_TRANS, BGP_ATTR_AS_PATH, 8,
+	AS_SEQUENCE, 3, 0xfd, 0xe8, 0xfd, 0xe9, 0xfd, 0xea,
+	BGP_ATTR_FLAG_TRANS, BGP_ATTR_NEXT_HOP, 4, 10, 0, 0, 1,
+	BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_MULTI_EXIT_DISC, 4, 0, 0, 0, 100,
+	BGP_ATTR_FLAG_TRANS, BGP_ATTR_LOCAL_PREF, 4, 0, 0, 0, 200,
+	BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS, BGP_ATTR_COMMUNITIES, 8,
+	0xfd, 0xe8, 0x00, 0x01, 0xfd, 0xe8, 0x00, 0x02,
+};
+
+/* bgp_attr_parse() throughput on a typical attribute set, not run by
+ * "make check": test_mp_attr bench [rounds]
+ */
+static void parse_bench(struct peer *peer, unsigned int rounds)
+{
+	struct bgp_nlri mp_update, mp_withdraw;
+	struct timeval start;
+	struct attr attr;
+	int64_t us;
+
+	monotime(&start);
+	for (unsigned int i = 0; i < rounds; i++) {
+		stream_reset(peer->curr);
+		stream_put(peer->curr, bench_attrs, sizeof(bench_attrs));
+
+		memset(&attr, 0, sizeof(attr));
+		memset(&mp_update, 0, sizeof(mp_update));
+		memset(&mp_withdraw, 0, sizeof(mp_withdraw));
+		if (bgp_attr_parse(peer, &attr, sizeof(bench_attrs),
+				   &mp_update, &mp_withdraw)
+		    != BGP_ATTR_PARSE_PROCEED) {
+			printf("attribute parse failed\n");
+			failed++;
+			return;
+		}
+		bgp_attr_unintern_sub(&attr);
+	}
+	us = monotime_since(&start, NULL);
+
+	printf("%u attribute sets in %" PRId64 " us, %.1f ns each\n", rounds,
+	       us, us * 1000.0 / rounds);
+}
+
 static struct bgp *bgp;
 static as_t asn = 100;
 
-int main(void)
+int main(int argc, char **argv)
 {
 	struct interface ifp;
 	struct peer *peer;
@@ -1111,6 +1158,15 @@ int main(void)
 			peer->afc_adv[i][j] = 1;
 		}
 
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		/* no debug logs in the timed loop */
+		conf_bgp_debug_packet = term_bgp_debug_packet = 0;
+		conf_bgp_debug_as4 = term_bgp_debug_as4 = 0;
+		parse_bench(peer, argc > 2 ? strtoul(argv[2], NULL, 0)
+					   : 1000000);
+		return failed;
+	}
+
 	i = 0;
 	while (mp_reach_segments[i].name)
 		parse_test(peer, &mp_reach_segments[i++],
@@ -111,6 +111,25 @@ static int test(FILE *input, FILE *output)
 	const char *s_tlvs = isis_format_tlvs(tlvs);
 	fprintf(output, "Unpacked TLVs:\n%s", s_tlvs);
 
+	/* Decoding lazily through a view has to give the very same TLVs */
+	struct isis_tlvs_view view;
+	char *unpacked_tlvs = XSTRDUP(MTYPE_TMP, s_tlvs);
+
+	stream_set_getp(s, 0);
+	if (isis_tlvs_view_init(&view, STREAM_READABLE(s), s, &log)
+	    || isis_tlvs_view_decode(&view, ISIS_TLV_AUTH, &log)
+	    || isis_tlvs_view_decode_all(&view, &log)) {
+		fprintf(output, "Could not decode TLV view:\n%s\n", log);
+		assert(0);
+	}
+	if (strcmp(unpacked_tlvs, isis_format_tlvs(view.tlvs))) {
+		fprintf(output, "Lazily decoded TLVs differ:\n%s",
+			isis_format_tlvs(view.tlvs));
+		assert(0);
+	}
+	isis_tlvs_view_fini(&view);
+	XFREE(MTYPE_TMP, unpacked_tlvs);
+
 	struct isis_item *orig_auth = tlvs->isis_auth.head;
 	tlvs->isis_auth.head = NULL;
 	s_tlvs = isis_format_tlvs(tlvs);
@@ -106,7 +106,7 @@ static void test_run_ti_lfa(struct vty *vty,
 	RB_FOREACH (node, isis_spf_nodes, &spftree_pc->lfa.p_space)
 		vty_out(vty, " %s\n", print_sys_hostname(node->sysid));
 	vty_out(vty, "\n");
-	RB_FOREACH (spf_node, isis_spf_nodes, &spftree_self->adj_nodes) {
+	RB_FOREACH (spf_node, isis_spf_nodes, &spftree_pc->lfa.adj_p_space) {
 		if (RB_EMPTY(isis_spf_nodes, &spf_node->lfa.p_space))
 			continue;
 		vty_out(vty, "P-space (%s):\n",
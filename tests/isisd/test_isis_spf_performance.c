@@ -0,0 +1,328 @@
+/*
+ * Benchmark the isisd SPF code on synthetic topologies
+ *
+ * Builds a level-2 LSPDB for a grid, a 2-tier Clos fabric or a random
+ * topology and times the forward SPF, the reverse SPF, a partial route
+ * calculation and the TI-LFA computation for every link of the root,
+ * reporting the time per run together with the heap held by the resulting
+ * SPF trees.
+ *
+ * Usage: test_isis_spf_performance [grid|clos|random] [nodes]
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+/* malloc.h is generally obsolete, however GNU Libc mallinfo wants it. */
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+
+#include "thread.h"
+#include "vty.h"
+#include "command.h"
+#include "log.h"
+#include "vrf.h"
+#include "yang.h"
+#include "monotime.h"
+
+#include "isisd/isisd.h"
+#include "isisd/isis_lsp.h"
+#include "isisd/isis_mt.h"
+#include "isisd/isis_spf.h"
+#include "isisd/isis_spf_private.h"
+#include "isisd/isis_lfa.h"
+
+#include "test_common.h"
+
+#define NNODES 2500
+#define ROUNDS 10
+#define LEVEL ISIS_LEVEL2
+
+/* Random topologies get this many links per node on average */
+#define RANDOM_DEGREE 4
+/* Leaves per spine in Clos topologies */
+#define CLOS_RATIO 32
+
+struct bench_node {
+	uint8_t sysid[ISIS_SYS_ID_LEN];
+	struct isis_lsp *lsp;
+};
+
+static struct isis *isis;
+static struct bench_node *nodes;
+static unsigned int nnodes;
+static unsigned int nlinks;
+
+static size_t heap_used(void)
+{
+#ifdef HAVE_MALLINFO
+	struct mallinfo minfo = mallinfo();
+
+	return (size_t)minfo.uordblks + (size_t)minfo.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static void report(const char *name, unsigned long count,
+		   struct timeval *start, size_t heap)
+{
+	int64_t us = monotime_since(start, NULL);
+
+	printf("%-20s %6lu: %8.2f ms/run", name, count,
+	       count ? us / 1000.0 / count : 0.0);
+	if (heap)
+		printf(" %10zu bytes", heap_used() - heap);
+	printf("\n");
+}
+
+static void bench_node_add(struct isis_area *area, unsigned int idx)
+{
+	struct bench_node *node = &nodes[idx];
+	uint8_t lspid[ISIS_SYS_ID_LEN + 2] = {};
+	struct nlpids nlpids = {.count = 1, .nlpids = {NLPID_IP}};
+	struct prefix_ipv4 loopback = {
+		.family = AF_INET,
+		.prefixlen = IPV4_MAX_BITLEN,
+		.prefix.s_addr = htonl(0x0a000000 | (idx + 1)),
+	};
+
+	node->sysid[0] = 0x10;
+	node->sysid[2] = (idx + 1) >> 24;
+	node->sysid[3] = (idx + 1) >> 16;
+	node->sysid[4] = (idx + 1) >> 8;
+	node->sysid[5] = idx + 1;
+
+	memcpy(lspid, node->sysid, ISIS_SYS_ID_LEN);
+	node->lsp = lsp_new(area, lspid, 6000, 1, 0, 0, NULL, LEVEL);
+	node->lsp->tlvs = isis_alloc_tlvs();
+	isis_tlvs_set_protocols_supported(node->lsp->tlvs, &nlpids);
+	isis_tlvs_add_extended_ip_reach(node->lsp->tlvs, &loopback, 0, false,
+					NULL);
+	lspdb_add(&area->lspdb[LEVEL - 1], node->lsp);
+}
+
+static void bench_link(unsigned int a, unsigned int b, uint32_t metric)
+{
+	uint8_t id[ISIS_SYS_ID_LEN + 1] = {};
+
+	memcpy(id, nodes[b].sysid, ISIS_SYS_ID_LEN);
+	isis_tlvs_add_extended_reach(nodes[a].lsp->tlvs, ISIS_MT_IPV4_UNICAST,
+				     id, metric, NULL);
+	memcpy(id, nodes[a].sysid, ISIS_SYS_ID_LEN);
+	isis_tlvs_add_extended_reach(nodes[b].lsp->tlvs, ISIS_MT_IPV4_UNICAST,
+				     id, metric, NULL);
+	nlinks++;
+}
+
+static unsigned int grid_side(unsigned int size)
+{
+	unsigned int side = 1;
+
+	while ((side + 1) * (side + 1) <= size)
+		side++;
+
+	return side;
+}
+
+/* Square grid, the root sits in a corner */
+static unsigned int build_grid(void)
+{
+	unsigned int side = grid_side(nnodes);
+
+	for (unsigned int row = 0; row < side; row++)
+		for (unsigned int col = 0; col < side; col++) {
+			unsigned int idx = row * side + col;
+
+			if (col + 1 < side)
+				bench_link(idx, idx + 1, 10);
+			if (row + 1 < side)
+				bench_link(idx, idx + side, 10);
+		}
+
+	return 0;
+}
+
+/* Leaf-spine fabric, every leaf connects to every spine; the root is a leaf */
+static unsigned int build_clos(void)
+{
+	unsigned int nspines = MAX(nnodes / (CLOS_RATIO + 1), 2U);
+
+	for (unsigned int leaf = nspines; leaf < nnodes; leaf++)
+		for (unsigned int spine = 0; spine < nspines; spine++)
+			bench_link(leaf, spine, 10);
+
+	return nspines;
+}
+
+/* A ring to keep it connected plus random chords with random metrics */
+static unsigned int build_random(void)
+{
+	srandom(1);
+	for (unsigned int idx = 0; idx < nnodes; idx++)
+		bench_link(idx, (idx + 1) % nnodes, 1 + random() % 63);
+	for (unsigned int i = nnodes; i < nnodes * RANDOM_DEGREE / 2; i++) {
+		unsigned int a = random() % nnodes;
+		unsigned int b = random() % nnodes;
+
+		if (a != b)
+			bench_link(a, b, 1 + random() % 63);
+	}
+
+	return 0;
+}
+
+static struct isis_spftree *bench_spftree_new(struct isis_area *area,
+					      const uint8_t *sysid)
+{
+	return isis_spftree_new(area, &area->lspdb[LEVEL - 1], sysid, LEVEL,
+				SPFTREE_IPV4, SPF_TYPE_FORWARD,
+				F_SPFTREE_NO_ADJACENCIES);
+}
+
+static void bench_spf(struct isis_area *area, const uint8_t *root)
+{
+	struct isis_spftree *spftree = NULL, *spftree_reverse;
+	struct isis_spf_node *adj_node;
+	struct timeval start;
+	unsigned long count = 0;
+	size_t heap;
+
+	/* Forward SPF, keep the tree of the last run around */
+	heap = heap_used();
+	monotime(&start);
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		if (spftree)
+			isis_spftree_del(spftree);
+		spftree = bench_spftree_new(area, root);
+		isis_run_spf(spftree);
+	}
+	report("spf", ROUNDS, &start, heap);
+	printf("%-20s %6u\n", "vertices",
+	       isis_vertex_queue_count(&spftree->paths));
+
+	/* Partial route calculation on top of the last SPT */
+	monotime(&start);
+	for (unsigned int i = 0; i < ROUNDS; i++)
+		isis_run_prc(spftree);
+	report("prc", ROUNDS, &start, 0);
+
+	/* Reverse SPF */
+	heap = heap_used();
+	monotime(&start);
+	spftree_reverse = isis_spf_reverse_run(spftree);
+	report("reverse-spf", 1, &start, heap);
+
+	/* Forward SPF on behalf of all neighbors */
+	heap = heap_used();
+	monotime(&start);
+	isis_spf_run_neighbors(spftree);
+	RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes)
+		count++;
+	report("neighbor-spf", count, &start, heap);
+
+	/* TI-LFA link protection for each link of the root */
+	count = 0;
+	heap = heap_used();
+	monotime(&start);
+	RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes) {
+		struct lfa_protected_resource resource = {
+			.type = LFA_LINK_PROTECTION,
+		};
+		struct isis_spftree *spftree_pc;
+
+		memcpy(resource.adjacency, adj_node->sysid, ISIS_SYS_ID_LEN);
+		spftree_pc = isis_tilfa_compute(area, spftree, spftree_reverse,
+						&resource);
+		isis_spftree_del(spftree_pc);
+		count++;
+	}
+	report("ti-lfa", count, &start, heap);
+
+	isis_spftree_del(spftree_reverse);
+	isis_spftree_del(spftree);
+}
+
+static void bench_topology(const char *name)
+{
+	struct isis_area *area;
+	struct timeval start;
+	unsigned int root;
+	size_t heap;
+
+	nlinks = 0;
+	if (strmatch(name, "grid"))
+		nnodes = grid_side(nnodes) * grid_side(nnodes);
+	nodes = XCALLOC(MTYPE_TMP, sizeof(*nodes) * nnodes);
+
+	area = isis_area_create("bench", NULL);
+
+	heap = heap_used();
+	monotime(&start);
+	for (unsigned int idx = 0; idx < nnodes; idx++)
+		bench_node_add(area, idx);
+	if (strmatch(name, "grid"))
+		root = build_grid();
+	else if (strmatch(name, "clos"))
+		root = build_clos();
+	else
+		root = build_random();
+
+	printf("%s: %u nodes, %u links\n", name, nnodes, nlinks);
+	report("lspdb", 1, &start, heap);
+
+	memcpy(isis->sysid, nodes[root].sysid, ISIS_SYS_ID_LEN);
+	bench_spf(area, nodes[root].sysid);
+	printf("\n");
+
+	isis_area_destroy(area);
+	XFREE(MTYPE_TMP, nodes);
+}
+
+int main(int argc, char **argv)
+{
+	const char *topologies[] = {"grid", "clos", "random"};
+	unsigned int size = NNODES;
+
+	if (argc > 2)
+		size = strtoul(argv[2], NULL, 0);
+	if (size < 4)
+		size = 4;
+
+	master = thread_master_create(NULL);
+	isis_master_init(master);
+	cmd_init(1);
+	cmd_hostname_set("test");
+	vty_init(master, false);
+	yang_init(true);
+	zlog_aux_init("NONE: ", ZLOG_DISABLED);
+
+	yang_module_load("frr-isisd");
+	isis = isis_new(VRF_DEFAULT_NAME);
+	listnode_add(im->isis, isis);
+	SET_FLAG(im->options, F_ISIS_UNIT_TEST);
+
+	for (size_t i = 0; i < array_size(topologies); i++) {
+		if (argc > 1 && !strmatch(argv[1], topologies[i]))
+			continue;
+
+		nnodes = size;
+		bench_topology(topologies[i]);
+	}
+
+	isis_finish(isis);
+	return 0;
+}
@@ -53,5 +53,27 @@ int main(int argc, char **argv)
 	}
 	buffer_free(b1);
 	buffer_free(b2);
+
+	/* formatted output must come out the same whether it fits into the
+	 * current chunk, needs a fresh one or is larger than a chunk
+	 */
+	b1 = buffer_new(16);
+	buffer_printf(b1, "%s-%d", "abc", 42);
+	buffer_printf(b1, "%s", "0123456789");
+	buffer_printf(b1, "%s%s", "0123456789", "0123456789abcdef");
+	buffer_putstr(b1, "!");
+	{
+		const char *want =
+			"abc-420123456789"
+			"01234567890123456789abcdef!";
+		char *got = buffer_getstr(b1);
+
+		assert(strcmp(got, want) == 0);
+		assert(buffer_length(b1) == strlen(want));
+		XFREE(MTYPE_TMP, got);
+	}
+	buffer_reset(b1);
+	assert(buffer_length(b1) == 0);
+	buffer_free(b1);
 	return 0;
 }
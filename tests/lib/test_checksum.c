@@ -24,6 +24,7 @@
 
 #include "checksum.h"
 #include "network.h"
+#include "monotime.h"
 
 struct thread_master *master;
 
@@ -459,6 +460,46 @@ static int /* return checksum in low-order 16 bits */
 	return ~sum;
 }
 
+/* compare against the plain loops above, on typical packet / LSP sizes */
+static void bench(void)
+{
+	static const int sizes[] = {64, 1492, 65535};
+	static uint8_t data[65536 + 1];
+	struct timeval start;
+	int64_t us_lib, us_ref;
+	unsigned int acc = 0;
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = frr_weak_random();
+
+	for (size_t s = 0; s < array_size(sizes); s++) {
+		int len = sizes[s], rounds = (64 << 20) / len;
+
+		monotime(&start);
+		for (int r = 0; r < rounds; r++)
+			acc += in_cksum(data + (r & 1), len);
+		us_lib = monotime_since(&start, NULL);
+		monotime(&start);
+		for (int r = 0; r < rounds; r++)
+			acc += in_cksum_rfc(data + (r & 1), len);
+		us_ref = monotime_since(&start, NULL);
+		printf("in_cksum %5d bytes: %6lld us (rfc1071: %6lld us)\n", len,
+		       (long long)us_lib, (long long)us_ref);
+
+		monotime(&start);
+		for (int r = 0; r < rounds; r++)
+			acc += fletcher_checksum(data, len,
+						 FLETCHER_CHECKSUM_VALIDATE);
+		us_lib = monotime_since(&start, NULL);
+		monotime(&start);
+		for (int r = 0; r < rounds; r++)
+			acc += ospfd_checksum(data, len, len - 2);
+		us_ref = monotime_since(&start, NULL);
+		printf("fletcher %5d bytes: %6lld us (ospfd:   %6lld us)\n", len,
+		       (long long)us_lib, (long long)us_ref);
+	}
+	printf("(%u)\n", acc);
+}
 
 int main(int argc, char **argv)
 {
@@ -470,6 +511,8 @@ int main(int argc, char **argv)
 #define EXERCISESTEP 257
 	srandom(time(NULL));
 
+	bench();
+
 	while (1) {
 		uint16_t ospfd, isisd, lib, in_csum, in_csum_res, in_csum_rfc;
 		int i, j;
@@ -492,6 +535,14 @@ int main(int argc, char **argv)
 			printf("verify: in_chksum failed in_csum:%x, in_csum_res:%x,in_csum_rfc %x, len:%d\n",
 			       in_csum, in_csum_res, in_csum_rfc, exercise);
 
+		/* in_cksum reads in words, make sure alignment doesn't matter */
+		memmove(buffer + 1, buffer, exercise);
+		in_csum_res = in_cksum(buffer + 1, exercise);
+		memmove(buffer, buffer + 1, exercise);
+		if (in_csum_res != in_csum)
+			printf("verify: unaligned in_chksum failed in_csum:%x, in_csum_res:%x, len:%d\n",
+			       in_csum, in_csum_res, exercise);
+
 		ospfd = ospfd_checksum(buffer, exercise + sizeof(uint16_t),
 				       exercise);
 		if (verify(buffer, exercise + sizeof(uint16_t)))
@@ -0,0 +1,163 @@
+/*
+ * Compare jhash and fhash speed and distribution
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+
+#include "jhash.h"
+#include "fhash.h"
+#include "monotime.h"
+#include "prng.h"
+
+#define ROUNDS 2000000
+#define BUCKET_BITS 16
+#define BUCKETS (1U << BUCKET_BITS)
+#define KEYS (BUCKETS * 4)
+#define MAXLEN 256
+
+struct thread_master *master;
+
+typedef uint32_t (*hashfn)(const void *key, size_t len, uint32_t seed);
+
+static uint32_t do_jhash(const void *key, size_t len, uint32_t seed)
+{
+	return jhash(key, len, seed);
+}
+
+static uint32_t do_fhash(const void *key, size_t len, uint32_t seed)
+{
+	return fhash(key, len, seed);
+}
+
+static const struct {
+	const char *name;
+	hashfn fn;
+} funcs[] = {
+	{"jhash", do_jhash},
+	{"fhash", do_fhash},
+};
+
+static uint8_t buf[MAXLEN];
+
+/* ns per hash, chaining the result back in so nothing gets optimized out */
+static double speed(hashfn fn, size_t len)
+{
+	struct timeval start;
+	uint32_t key = 0;
+
+	monotime(&start);
+	for (int i = 0; i < ROUNDS; i++) {
+		memcpy(buf, &key, sizeof(key));
+		key = fn(buf, len, key);
+	}
+	return monotime_since(&start, NULL) * 1000.0 / ROUNDS;
+}
+
+/*
+ * Sequential counters in the middle of otherwise constant keys, the
+ * typical shape of structs that differ in one field.  Returns the
+ * chi-square of the bucket fill divided by its expected value (~1.0
+ * for a uniform hash).
+ */
+static double distribution(hashfn fn, size_t len)
+{
+	static unsigned int fill[BUCKETS];
+	double chi = 0, expect = (double)KEYS / BUCKETS;
+	uint32_t ctr;
+
+	memset(fill, 0, sizeof(fill));
+	memset(buf, 0x5a, sizeof(buf));
+	for (ctr = 0; ctr < KEYS; ctr++) {
+		memcpy(buf + (len - sizeof(ctr)) / 2, &ctr, sizeof(ctr));
+		fill[fn(buf, len, 0) & (BUCKETS - 1)]++;
+	}
+
+	for (unsigned int i = 0; i < BUCKETS; i++)
+		chi += (fill[i] - expect) * (fill[i] - expect) / expect;
+	return chi / (BUCKETS - 1);
+}
+
+/* average number of output bits changed by flipping one input bit */
+static double avalanche(hashfn fn, size_t len, struct prng *prng)
+{
+	unsigned long flips = 0, tests = 0;
+
+	for (int round = 0; round < 64; round++) {
+		uint32_t base;
+
+		for (size_t i = 0; i < len; i++)
+			buf[i] = prng_rand(prng);
+		base = fn(buf, len, 0);
+
+		for (size_t bit = 0; bit < len * 8; bit++) {
+			buf[bit / 8] ^= 1 << (bit % 8);
+			flips += __builtin_popcount(base ^ fn(buf, len, 0));
+			buf[bit / 8] ^= 1 << (bit % 8);
+			tests++;
+		}
+	}
+	return (double)flips / tests;
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t lens[] = {4, 6, 16, 20, 40, 64, 256};
+	struct prng *prng = prng_new(0);
+	struct fhash_state st1, st2;
+	uint32_t words[3] = {1, 2, 3};
+
+	printf("%-6s %4s %10s %10s %10s\n", "hash", "len", "ns/hash",
+	       "chi2/df", "avalanche");
+	for (size_t l = 0; l < array_size(lens); l++)
+		for (size_t f = 0; f < array_size(funcs); f++) {
+			double chi = distribution(funcs[f].fn, lens[l]);
+			double av = avalanche(funcs[f].fn, lens[l], prng);
+
+			printf("%-6s %4zu %10.2f %10.3f %10.2f\n",
+			       funcs[f].name, lens[l],
+			       speed(funcs[f].fn, lens[l]), chi, av);
+
+			if (funcs[f].fn == do_fhash) {
+				assert(chi < 1.2);
+				assert(av > 15.0 && av < 17.0);
+			}
+		}
+
+	/* the incremental API and the word helpers must be deterministic
+	 * and sensitive to order
+	 */
+	fhash_init(&st1, 0);
+	fhash_add_u32x2(&st1, 1, 2);
+	fhash_add(&st1, words, sizeof(words));
+	fhash_init(&st2, 0);
+	fhash_add_u32x2(&st2, 1, 2);
+	fhash_add(&st2, words, sizeof(words));
+	assert(fhash_final(&st1) == fhash_final(&st2));
+
+	fhash_init(&st2, 0);
+	fhash_add_u32x2(&st2, 2, 1);
+	fhash_add(&st2, words, sizeof(words));
+	assert(fhash_final(&st1) != fhash_final(&st2));
+
+	assert(fhash_3words(1, 2, 3, 0) != fhash_3words(3, 2, 1, 0));
+	assert(fhash_1word(1, 0) != fhash_1word(1, 1));
+
+	prng_free(prng);
+	return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Compare chained and open addressing hash tables
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+
+#include "hash.h"
+#include "jhash.h"
+#include "monotime.h"
+#include "prng.h"
+
+#define ITEMS 2000000
+
+struct item {
+	uint32_t val;
+};
+
+struct thread_master *master;
+
+static struct item *items;
+
+static unsigned int item_key(const void *arg)
+{
+	const struct item *item = arg;
+
+	return jhash_1word(item->val, 0);
+}
+
+static bool item_cmp(const void *a, const void *b)
+{
+	const struct item *ia = a, *ib = b;
+
+	return ia->val == ib->val;
+}
+
+static void count_iter(struct hash_bucket *hb, void *arg)
+{
+	unsigned long *count = arg;
+
+	(*count)++;
+}
+
+static void run(const char *name, struct hash *hash)
+{
+	struct timeval start;
+	int64_t t_insert, t_lookup, t_release, worst = 0, elapsed;
+	struct item key;
+	unsigned long walked = 0;
+
+	monotime(&start);
+	for (int i = 0; i < ITEMS; i++) {
+		struct timeval one;
+
+		monotime(&one);
+		assert(hash_get(hash, &items[i], hash_alloc_intern)
+		       == &items[i]);
+		elapsed = monotime_since(&one, NULL);
+		if (elapsed > worst)
+			worst = elapsed;
+	}
+	t_insert = monotime_since(&start, NULL);
+	assert(hashcount(hash) == ITEMS);
+
+	monotime(&start);
+	for (int i = 0; i < ITEMS; i++) {
+		/* every other lookup misses */
+		key.val = items[i / 2].val + (i & 1) * ITEMS * 2;
+		if (i & 1)
+			assert(!hash_lookup(hash, &key));
+		else
+			assert(hash_lookup(hash, &key) == &items[i / 2]);
+	}
+	t_lookup = monotime_since(&start, NULL);
+
+	hash_iterate(hash, count_iter, &walked);
+	assert(walked == ITEMS);
+
+	monotime(&start);
+	for (int i = 0; i < ITEMS; i += 2)
+		assert(hash_release(hash, &items[i]) == &items[i]);
+	t_release = monotime_since(&start, NULL);
+	assert(hashcount(hash) == ITEMS / 2);
+	for (int i = 0; i < ITEMS; i++)
+		assert(!hash_lookup(hash, &items[i]) == !(i & 1));
+
+	hash_clean(hash, NULL);
+	assert(hashcount(hash) == 0);
+	hash_free(hash);
+
+	printf("%-8s insert %d: %4lld ms (worst single insert %lld us)\n",
+	       name, ITEMS, (long long)t_insert / 1000, (long long)worst);
+	printf("%-8s lookup %d: %4lld ms\n", name, ITEMS,
+	       (long long)t_lookup / 1000);
+	printf("%-8s release %d: %4lld ms\n", name, ITEMS / 2,
+	       (long long)t_release / 1000);
+}
+
+int main(int argc, char **argv)
+{
+	struct prng *prng = prng_new(0);
+
+	/* values in [0, 2 * ITEMS) are unique; misses are shifted beyond */
+	items = calloc(ITEMS, sizeof(*items));
+	for (int i = 0; i < ITEMS; i++)
+		items[i].val = i * 2 + (prng_rand(prng) & 1);
+	prng_free(prng);
+
+	run("chained", hash_create(item_key, item_cmp, "chained"));
+	run("open", hash_create_open(HASH_INITIAL_SIZE, item_key, item_cmp,
+				     "open"));
+
+	free(items);
+	return 0;
+}
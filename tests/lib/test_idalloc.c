@@ -3,20 +3,104 @@
 #endif
 
 #include "id_alloc.h"
+#include "monotime.h"
 
 #include <inttypes.h>
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #define IDS_PER_PAGE (1<<(IDALLOC_OFFSET_BITS + IDALLOC_WORD_BITS))
 char allocated_markers[IDS_PER_PAGE*3];
 
+#define BENCH_IDS 1000000
+#define BENCH_BATCH 64
+#define BENCH_THREADS 4
+
+static uint32_t bench_ids[BENCH_THREADS][BENCH_IDS / BENCH_THREADS];
+
+/* allocate and free everything, one at a time, in batches or via a cache */
+enum bench_mode {
+	BENCH_SINGLE,
+	BENCH_BULK,
+	BENCH_CACHE,
+};
+
+struct bench {
+	struct id_alloc *a;
+	enum bench_mode mode;
+	uint32_t *ids;
+	uint32_t n;
+};
+
+static void *bench_run(void *arg)
+{
+	struct bench *b = arg;
+	struct id_alloc_cache cache;
+	uint32_t i;
+
+	switch (b->mode) {
+	case BENCH_SINGLE:
+		for (i = 0; i < b->n; i++)
+			b->ids[i] = idalloc_allocate(b->a);
+		for (i = 0; i < b->n; i++)
+			idalloc_free(b->a, b->ids[i]);
+		break;
+	case BENCH_BULK:
+		for (i = 0; i < b->n; i += BENCH_BATCH)
+			assert(idalloc_allocate_n(b->a, b->ids + i, BENCH_BATCH)
+			       == BENCH_BATCH);
+		for (i = 0; i < b->n; i += BENCH_BATCH)
+			idalloc_free_n(b->a, b->ids + i, BENCH_BATCH);
+		break;
+	case BENCH_CACHE:
+		idalloc_cache_init(&cache, b->a);
+		for (i = 0; i < b->n; i++)
+			b->ids[i] = idalloc_cache_get(&cache);
+		for (i = 0; i < b->n; i++)
+			idalloc_cache_put(&cache, b->ids[i]);
+		idalloc_cache_drain(&cache);
+		break;
+	}
+	return NULL;
+}
+
+static void bench(const char *name, enum bench_mode mode, int threads)
+{
+	struct bench b[BENCH_THREADS];
+	pthread_t tids[BENCH_THREADS];
+	struct timeval start;
+	struct id_alloc *a;
+	int i;
+
+	a = idalloc_new(name);
+	monotime(&start);
+	for (i = 0; i < threads; i++) {
+		b[i].a = a;
+		b[i].mode = mode;
+		b[i].ids = bench_ids[i];
+		b[i].n = BENCH_IDS / threads;
+		pthread_create(&tids[i], NULL, bench_run, &b[i]);
+	}
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	printf("%-8s %d thread(s): %6.1f ns per alloc+free\n", name, threads,
+	       monotime_since(&start, NULL) * 1000.0 / BENCH_IDS);
+
+	/* only the reserved 0 is left */
+	assert(a->allocated == 1);
+	idalloc_destroy(a);
+}
+
 int main(int argc, char **argv)
 {
 	int i, val;
 	uint32_t pg;
 	struct id_alloc *a;
+	struct id_alloc_cache cache;
+	uint32_t ids[IDS_PER_PAGE];
 
 	/* 1. Rattle test, shake it a little and make sure it doesn't make any
 	 * noise :)
@@ -192,6 +276,77 @@ int main(int argc, char **argv)
 	}
 	idalloc_destroy(a);
 
+	/* 6. Bulk allocation: must hand out the same IDs as one at a time,
+	 * crossing word and page boundaries, and skip reserved ones.
+	 */
+	memset(allocated_markers, 0, sizeof(allocated_markers));
+	allocated_markers[IDALLOC_INVALID] = 1;
+
+	a = idalloc_new("Bulk");
+	assert(idalloc_reserve(a, 40) == 40);
+	allocated_markers[40] = 1;
+
+	assert(idalloc_allocate_n(a, ids, 3) == 3);
+	assert(ids[0] == 1 && ids[1] == 2 && ids[2] == 3);
+	for (i = 0; i < 3; i++)
+		allocated_markers[ids[i]] = 1;
+
+	assert(idalloc_allocate_n(a, ids, IDS_PER_PAGE) == IDS_PER_PAGE);
+	for (i = 0; i < IDS_PER_PAGE; i++) {
+		assert(ids[i] < 2 * IDS_PER_PAGE);
+		assert(allocated_markers[ids[i]] == 0);
+		allocated_markers[ids[i]] = 1;
+		if (i)
+			assert(ids[i] > ids[i - 1]);
+	}
+	assert(a->capacity == 2 * IDS_PER_PAGE);
+	assert(a->allocated == IDS_PER_PAGE + 5);
+
+	/* give back every other one, then take them again one at a time */
+	for (i = 0; i < IDS_PER_PAGE / 2; i++)
+		ids[i] = ids[2 * i];
+	idalloc_free_n(a, ids, IDS_PER_PAGE / 2);
+	for (i = 0; i < IDS_PER_PAGE / 2; i++)
+		allocated_markers[ids[i]] = 0;
+	assert(a->allocated == IDS_PER_PAGE / 2 + 5);
+
+	for (i = 0; i < IDS_PER_PAGE / 2; i++) {
+		val = idalloc_allocate(a);
+		assert(allocated_markers[val] == 0);
+		allocated_markers[val] = 1;
+	}
+	assert(a->capacity == 2 * IDS_PER_PAGE);
+	idalloc_destroy(a);
+
+	/* 7. Caches: IDs come from the allocator in batches and go back on
+	 * overflow and drain.
+	 */
+	a = idalloc_new("Cache");
+	idalloc_cache_init(&cache, a);
+
+	val = idalloc_cache_get(&cache);
+	assert(val != IDALLOC_INVALID);
+	assert(a->allocated == IDALLOC_CACHE_SIZE / 2 + 1);
+
+	for (i = 0; i < IDALLOC_CACHE_SIZE * 2; i++)
+		ids[i] = idalloc_cache_get(&cache);
+	for (i = 0; i < IDALLOC_CACHE_SIZE * 2; i++)
+		idalloc_cache_put(&cache, ids[i]);
+	assert(cache.count <= IDALLOC_CACHE_SIZE);
+
+	idalloc_cache_put(&cache, val);
+	idalloc_cache_drain(&cache);
+	assert(cache.count == 0);
+	assert(a->allocated == 1);
+	idalloc_destroy(a);
+
+	/* 8. Throughput */
+	bench("single", BENCH_SINGLE, 1);
+	bench("bulk", BENCH_BULK, 1);
+	bench("cache", BENCH_CACHE, 1);
+	bench("single", BENCH_SINGLE, BENCH_THREADS);
+	bench("cache", BENCH_CACHE, BENCH_THREADS);
+
 	puts("ID Allocator test successful.\n");
 	return 0;
 }
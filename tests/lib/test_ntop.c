@@ -22,6 +22,7 @@
 #endif
 
 #include <assert.h>
+#include <time.h>
 
 #include "tests/helpers/c/prng.h"
 
@@ -30,6 +31,51 @@
 #define INET_NTOP_NO_OVERRIDE
 #include "lib/ntop.c"
 
+#define BENCH_ROUNDS 1000000
+
+static double bench_ns(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - start->tv_sec) * 1e9
+		+ (now.tv_nsec - start->tv_nsec))
+	       / BENCH_ROUNDS;
+}
+
+/* "test_ntop bench": FRR vs. libc, and the no-copy variant */
+static void bench(void)
+{
+	struct in6_addr i6;
+	struct timespec start;
+	char buf[64];
+	int afs[] = {AF_INET, AF_INET6};
+
+	inet_pton(AF_INET6, "2001:db8:1234:5678:9abc::1", &i6);
+
+	for (size_t a = 0; a < 2; a++) {
+		const char *name = afs[a] == AF_INET ? "v4" : "v6";
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < BENCH_ROUNDS; i++)
+			inet_ntop(afs[a], &i6, buf, sizeof(buf));
+		printf("%s libc inet_ntop      %6.1f ns\n", name,
+		       bench_ns(&start));
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < BENCH_ROUNDS; i++)
+			frr_inet_ntop(afs[a], &i6, buf, sizeof(buf));
+		printf("%s frr_inet_ntop       %6.1f ns\n", name,
+		       bench_ns(&start));
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < BENCH_ROUNDS; i++)
+			frr_inet_ntop_end(afs[a], &i6, buf);
+		printf("%s frr_inet_ntop_end   %6.1f ns\n", name,
+		       bench_ns(&start));
+	}
+}
+
 int main(int argc, char **argv)
 {
 	size_t i, j, k, l;
@@ -81,6 +127,14 @@ int main(int argc, char **argv)
 
 		assert(inet_pton(AF_INET6, buf1, &i6check));
 		assert(!memcmp(&i6, &i6check, sizeof(i6)));
+
+		/* in-place variant must agree and point at the NUL */
+		memset(buf2, 0xcc, sizeof(buf2));
+		rv = frr_inet_ntop_end(AF_INET6, &i6, buf2);
+		assert(rv == buf2 + strlen(buf1) && !strcmp(buf1, buf2));
 	}
+
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		bench();
 	return 0;
 }
@@ -0,0 +1,177 @@
+/*
+ * Benchmark & cross-check prefix comparison primitives
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+
+#include "prefix.h"
+#include "nexthop.h"
+#include "monotime.h"
+#include "prng.h"
+
+#define NPREFIXES 4096
+#define ROUNDS	  2000
+
+struct thread_master *master;
+
+static struct prefix prefixes[NPREFIXES];
+
+static const uint8_t maskbit[] = {0x00, 0x80, 0xc0, 0xe0, 0xf0,
+				  0xf8, 0xfc, 0xfe, 0xff};
+
+/* byte-at-a-time versions, as lib/prefix.c used to have them */
+static int ref_match(const struct prefix *n, const struct prefix *p)
+{
+	int offset = n->prefixlen / 8, shift = n->prefixlen % 8;
+
+	if (n->prefixlen > p->prefixlen)
+		return 0;
+	if (shift && (maskbit[shift] & (n->u.val[offset] ^ p->u.val[offset])))
+		return 0;
+	while (offset--)
+		if (n->u.val[offset] != p->u.val[offset])
+			return 0;
+	return 1;
+}
+
+static int ref_cmp(const struct prefix *p1, const struct prefix *p2)
+{
+	int offset = p1->prefixlen / 8, shift = p1->prefixlen % 8, i;
+
+	if (p1->family != p2->family)
+		return numcmp(p1->family, p2->family);
+	if (p1->prefixlen != p2->prefixlen)
+		return numcmp(p1->prefixlen, p2->prefixlen);
+	i = memcmp(p1->u.val, p2->u.val, offset);
+	if (i)
+		return i;
+	if (shift)
+		return numcmp(p1->u.val[offset] & maskbit[shift],
+			      p2->u.val[offset] & maskbit[shift]);
+	return 0;
+}
+
+static int sign(int v)
+{
+	return (v > 0) - (v < 0);
+}
+
+/* lots of shared leading bits & lengths, like in a real table */
+static void random_prefix(struct prng *prng, struct prefix *p)
+{
+	uint32_t r = prng_rand(prng);
+
+	memset(p, 0, sizeof(*p));
+	if (r & 1) {
+		p->family = AF_INET;
+		p->prefixlen = 16 + (r >> 1) % 17;
+		p->u.prefix4.s_addr = htonl(0x0a000000 | (prng_rand(prng) & 0x3ff00)
+					    | (prng_rand(prng) & 0x3));
+	} else {
+		p->family = AF_INET6;
+		p->prefixlen = 32 + (r >> 1) % 97;
+		p->u.prefix6.s6_addr[0] = 0x20;
+		p->u.prefix6.s6_addr[1] = 0x01;
+		p->u.prefix6.s6_addr[6] = prng_rand(prng) & 0x3;
+		p->u.prefix6.s6_addr[7] = prng_rand(prng);
+		p->u.prefix6.s6_addr[15] = prng_rand(prng) & 0x1;
+	}
+}
+
+static void check(void)
+{
+	for (int i = 0; i < NPREFIXES; i++)
+		for (int j = 0; j < 64; j++) {
+			const struct prefix *p1 = &prefixes[i];
+			const struct prefix *p2 = &prefixes[(i + j) % NPREFIXES];
+
+			assert(sign(prefix_cmp(p1, p2)) == sign(ref_cmp(p1, p2)));
+			if (p1->family == p2->family)
+				assert(prefix_match(p1, p2) == ref_match(p1, p2));
+		}
+}
+
+static void bench(const char *name, int (*fn)(const struct prefix *,
+					      const struct prefix *))
+{
+	struct timeval start;
+	unsigned long hits = 0;
+
+	monotime(&start);
+	for (int r = 0; r < ROUNDS; r++)
+		for (int i = 0; i < NPREFIXES; i++)
+			hits += !!fn(&prefixes[i],
+				     &prefixes[(i + r) % NPREFIXES]);
+
+	printf("%-12s %d: %4lld ms (%lu)\n", name, ROUNDS * NPREFIXES,
+	       (long long)monotime_since(&start, NULL) / 1000, hits);
+}
+
+static int lib_cmp(const struct prefix *p1, const struct prefix *p2)
+{
+	return prefix_cmp(p1, p2);
+}
+
+static void bench_nexthop(void)
+{
+	struct nexthop *nhs[64];
+	struct timeval start;
+	unsigned long hits = 0;
+
+	for (int i = 0; i < 64; i++) {
+		nhs[i] = nexthop_new();
+		nhs[i]->type = (i & 1) ? NEXTHOP_TYPE_IPV6_IFINDEX
+				       : NEXTHOP_TYPE_IPV4_IFINDEX;
+		nhs[i]->ifindex = 1 + (i & 2);
+		nhs[i]->gate.ipv6 = prefixes[i & 0x1c].u.prefix6;
+	}
+
+	for (int i = 0; i < 64; i++)
+		for (int j = 0; j < 64; j++)
+			assert(nexthop_same(nhs[i], nhs[j])
+			       == !nexthop_cmp(nhs[i], nhs[j]));
+
+	monotime(&start);
+	for (int r = 0; r < ROUNDS * 64; r++)
+		for (int i = 0; i < 64; i++)
+			hits += nexthop_same(nhs[i], nhs[(i + r) & 63]);
+	printf("%-12s %d: %4lld ms (%lu)\n", "nexthop_same", ROUNDS * 64 * 64,
+	       (long long)monotime_since(&start, NULL) / 1000, hits);
+
+	for (int i = 0; i < 64; i++)
+		nexthop_free(nhs[i]);
+}
+
+int main(int argc, char **argv)
+{
+	struct prng *prng = prng_new(0);
+
+	for (int i = 0; i < NPREFIXES; i++)
+		random_prefix(prng, &prefixes[i]);
+	prng_free(prng);
+
+	check();
+
+	bench("reference", ref_cmp);
+	bench("prefix_cmp", lib_cmp);
+	bench("ref_match", ref_match);
+	bench("prefix_match", prefix_match);
+	bench_nexthop();
+	return 0;
+}
@@ -24,6 +24,8 @@
 #include "lib/printfrr.h"
 #include "lib/memory.h"
 #include "lib/prefix.h"
+#include "lib/nexthop.h"
+#include "lib/monotime.h"
 
 static int errors;
 
@@ -76,6 +78,47 @@ static void printchk(const char *ref, const char *fmt, ...)
 		errors++;
 }
 
+#define BENCH_ROUNDS 1000000
+
+/* "test_printfrr bench": time the address/prefix extensions */
+static void bench(void)
+{
+	struct prefix p4, p6;
+	struct nexthop nh = {.type = NEXTHOP_TYPE_IPV6_IFINDEX, .ifindex = 42};
+	struct timeval start;
+	char buf[PREFIX_STRLEN];
+	const struct {
+		const char *name;
+		const char *fmt;
+		const void *arg;
+	} cases[] = {
+		{"%pI4", "%pI4", &p4.u.prefix4},
+		{"%pI6", "%pI6", &p6.u.prefix6},
+		{"%pFX v4", "%pFX", &p4},
+		{"%pFX v6", "%pFX", &p6},
+		{"%pNHs", "%pNHs", &nh},
+	};
+
+	str2prefix("192.168.123.0/24", &p4);
+	str2prefix("2001:db8:1234:5678::/64", &p6);
+	inet_pton(AF_INET6, "fe80::1234:5678", &nh.gate.ipv6);
+
+	for (size_t c = 0; c < array_size(cases); c++) {
+		monotime(&start);
+		for (int i = 0; i < BENCH_ROUNDS; i++)
+			snprintfrr(buf, sizeof(buf), cases[c].fmt,
+				   cases[c].arg);
+		printf("%-10s %8.1f ns\n", cases[c].name,
+		       monotime_since(&start, NULL) * 1000.0 / BENCH_ROUNDS);
+	}
+
+	monotime(&start);
+	for (int i = 0; i < BENCH_ROUNDS; i++)
+		prefix2str(&p6, buf, sizeof(buf));
+	printf("%-10s %8.1f ns\n", "prefix2str",
+	       monotime_since(&start, NULL) * 1000.0 / BENCH_ROUNDS);
+}
+
 int main(int argc, char **argv)
 {
 	size_t i;
@@ -146,5 +189,31 @@ int main(int argc, char **argv)
 	sg.src.s_addr = INADDR_ANY;
 	printchk("(*,224.1.2.3)", "%pSG4", &sg);
 
+	struct prefix pfx;
+	struct nexthop nh = {.type = NEXTHOP_TYPE_IPV6_IFINDEX, .ifindex = 7};
+
+	str2prefix("192.168.1.0/24", &pfx);
+	printchk("192.168.1.0/24", "%pFX", &pfx);
+	str2prefix("2001:db8::/128", &pfx);
+	printchk("2001:db8::/128", "%pFX", &pfx);
+	printchk("2001:db8::", "%pI6", &pfx.u.prefix6);
+	printchk("[2001:db8::/128]", "[%pFX]", &pfx);
+
+	/* short buffers take the slow path and must truncate the same way */
+	snprintfrr(buf, 8, "%pFX", &pfx);
+	assert(strcmp(buf, "2001:db") == 0);
+	prefix2str(&pfx, buf, 8);
+	assert(strcmp(buf, "2001:db") == 0);
+
+	inet_pton(AF_INET6, "fe80::1", &nh.gate.ipv6);
+	printchk("fe80::1 if 7", "%pNHs", &nh);
+	nh.type = NEXTHOP_TYPE_IPV4;
+	nh.ifindex = 4000000000U;
+	inet_aton("10.0.0.1", &nh.gate.ipv4);
+	printchk("10.0.0.1 if 4000000000", "%pNHs", &nh);
+
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		bench();
+
 	return !!errors;
 }
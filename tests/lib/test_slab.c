@@ -0,0 +1,126 @@
+/*
+ * Test slab-backed MTYPEs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+#include <pthread.h>
+
+#include "memory.h"
+
+DEFINE_MGROUP(TEST_SLAB, "slab test")
+DEFINE_MTYPE_STATIC(TEST_SLAB, SLABOBJ, "slab object")
+
+#define NTHREADS 4
+#define NOBJS	 100000
+
+struct obj {
+	unsigned int owner;
+	unsigned int seq;
+	char pad[40];
+};
+
+static struct obj *objs[NTHREADS][NOBJS];
+
+/* each thread allocates its objects, then frees those of its neighbour,
+ * so objects routinely go back to a different pthread's cache
+ */
+static pthread_barrier_t barrier;
+
+static void *worker(void *arg)
+{
+	unsigned int me = (uintptr_t)arg;
+	unsigned int other = (me + 1) % NTHREADS;
+
+	for (unsigned int i = 0; i < NOBJS; i++) {
+		objs[me][i] = XCALLOC(MTYPE_SLABOBJ, sizeof(struct obj));
+		assert(objs[me][i]->owner == 0 && objs[me][i]->seq == 0);
+		objs[me][i]->owner = me;
+		objs[me][i]->seq = i;
+	}
+
+	pthread_barrier_wait(&barrier);
+
+	for (unsigned int i = 0; i < NOBJS; i++) {
+		assert(objs[other][i]->owner == other);
+		assert(objs[other][i]->seq == i);
+		XFREE(MTYPE_SLABOBJ, objs[other][i]);
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t threads[NTHREADS];
+	struct qmem_slab_stats st;
+	size_t peak;
+	char *str;
+
+	qmem_slab_enable(MTYPE_SLABOBJ, sizeof(struct obj));
+	if (!qmem_slab_stats(MTYPE_SLABOBJ, &st)) {
+		/* sanitizer build */
+		printf("slab disabled\nOK\n");
+		return 0;
+	}
+	assert(st.objsize >= sizeof(struct obj) && st.chunks == 0);
+
+	pthread_barrier_init(&barrier, NULL, NTHREADS);
+	for (uintptr_t i = 0; i < NTHREADS; i++)
+		pthread_create(&threads[i], NULL, worker, (void *)i);
+	for (unsigned int i = 0; i < NTHREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	/* exiting pthreads return their caches, so everything is free again
+	 * and all but one chunk has been released
+	 */
+	assert(mtype_stats_alloc(MTYPE_SLABOBJ) == 0);
+	assert(qmem_slab_stats(MTYPE_SLABOBJ, &st));
+	assert(st.handed == 0);
+	assert(st.chunks <= 1);
+
+	/* single-threaded reuse, chunks must be filled before new ones */
+	for (unsigned int i = 0; i < NOBJS; i++)
+		objs[0][i] = XMALLOC(MTYPE_SLABOBJ, sizeof(struct obj));
+	assert(qmem_slab_stats(MTYPE_SLABOBJ, &st));
+	peak = st.chunks;
+	assert(st.capacity - NOBJS < 2 * (st.capacity / st.chunks));
+
+	for (unsigned int i = 0; i < NOBJS; i += 2)
+		XFREE(MTYPE_SLABOBJ, objs[0][i]);
+	for (unsigned int i = 0; i < NOBJS; i += 2)
+		objs[0][i] = XMALLOC(MTYPE_SLABOBJ, sizeof(struct obj));
+	assert(qmem_slab_stats(MTYPE_SLABOBJ, &st));
+	assert(st.chunks == peak);
+
+	for (unsigned int i = 0; i < NOBJS; i++)
+		XFREE(MTYPE_SLABOBJ, objs[0][i]);
+
+	/* small strdup/realloc on a slab type stay within the object */
+	str = XSTRDUP(MTYPE_SLABOBJ, "slab");
+	str = XREALLOC(MTYPE_SLABOBJ, str, sizeof(struct obj));
+	assert(!strcmp(str, "slab"));
+	XFREE(MTYPE_SLABOBJ, str);
+
+	assert(mtype_stats_alloc(MTYPE_SLABOBJ) == 0);
+	assert(qmem_slab_stats(MTYPE_SLABOBJ, &st));
+	/* the main pthread still caches some, but at most a cache's worth */
+	assert(st.chunks <= 2);
+
+	printf("OK\n");
+	return 0;
+}
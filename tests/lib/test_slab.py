@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestSlab(frrtest.TestMultiOut):
+    program = "./test_slab"
+
+
+TestSlab.onesimple("OK")
@@ -25,6 +25,7 @@
 
 #include "hash.h"
 #include "memory.h"
+#include "monotime.h"
 #include "prefix.h"
 #include "prng.h"
 #include "srcdest_table.h"
@@ -428,9 +429,102 @@ static void run_prng_test(void)
 	test_state_free(test);
 }
 
+#define BENCH_DSTS 10000
+#define BENCH_SRCS 16
+
+/* the lookup as it was done before the (dst, src) index */
+static struct route_node *lookup_twostep(struct route_table *table,
+					 const struct prefix_ipv6 *dst_p,
+					 const struct prefix_ipv6 *src_p)
+{
+	struct route_node *rn;
+	struct route_table *src_table;
+
+	rn = route_node_lookup_maynull(table, dst_p);
+	if (!rn)
+		return NULL;
+	route_unlock_node(rn);
+
+	src_table = srcdest_srcnode_table(rn);
+	if (!src_table)
+		return NULL;
+	return route_node_lookup(src_table, src_p);
+}
+
+static void run_bench(void)
+{
+	struct route_table *table = srcdest_table_init();
+	struct prng *prng = prng_new(0);
+	struct prefix_ipv6 *dsts, *srcs;
+	struct route_node *rn;
+	struct timeval start;
+	uint32_t *order, tmp;
+	unsigned int i, j, k;
+	int64_t t_twostep, t_index;
+
+	dsts = XCALLOC(MTYPE_TMP, BENCH_DSTS * sizeof(*dsts));
+	srcs = XCALLOC(MTYPE_TMP, BENCH_SRCS * sizeof(*srcs));
+	order = XCALLOC(MTYPE_TMP, BENCH_DSTS * BENCH_SRCS * sizeof(*order));
+
+	for (j = 0; j < BENCH_SRCS; j++) {
+		str2prefix_ipv6("2001:db8:ffff::/64", &srcs[j]);
+		srcs[j].prefix.s6_addr[5] = j;
+	}
+	for (i = 0; i < BENCH_DSTS; i++) {
+		str2prefix_ipv6("fc00::/48", &dsts[i]);
+		dsts[i].prefix.s6_addr[4] = i >> 8;
+		dsts[i].prefix.s6_addr[5] = i;
+
+		for (j = 0; j < BENCH_SRCS; j++) {
+			rn = srcdest_rnode_get(table, &dsts[i], &srcs[j]);
+			rn->info = (void *)0xdeadbeef;
+		}
+	}
+
+	/* look routes up in random order, like route updates arrive */
+	for (k = 0; k < BENCH_DSTS * BENCH_SRCS; k++)
+		order[k] = k;
+	for (k = BENCH_DSTS * BENCH_SRCS - 1; k > 0; k--) {
+		j = prng_rand(prng) % (k + 1);
+		tmp = order[k];
+		order[k] = order[j];
+		order[j] = tmp;
+	}
+
+	monotime(&start);
+	for (k = 0; k < BENCH_DSTS * BENCH_SRCS; k++) {
+		i = order[k] / BENCH_SRCS;
+		j = order[k] % BENCH_SRCS;
+		rn = lookup_twostep(table, &dsts[i], &srcs[j]);
+		assert(rn);
+		route_unlock_node(rn);
+	}
+	t_twostep = monotime_since(&start, NULL);
+
+	monotime(&start);
+	for (k = 0; k < BENCH_DSTS * BENCH_SRCS; k++) {
+		i = order[k] / BENCH_SRCS;
+		j = order[k] % BENCH_SRCS;
+		rn = srcdest_rnode_lookup(table, &dsts[i], &srcs[j]);
+		assert(rn);
+		route_unlock_node(rn);
+	}
+	t_index = monotime_since(&start, NULL);
+
+	printf("%u routes: lookup %" PRId64 "us (two-step %" PRId64 "us)\n",
+	       BENCH_DSTS * BENCH_SRCS, t_index, t_twostep);
+
+	route_table_finish(table);
+	prng_free(prng);
+	XFREE(MTYPE_TMP, order);
+	XFREE(MTYPE_TMP, dsts);
+	XFREE(MTYPE_TMP, srcs);
+}
+
 int main(int argc, char *argv[])
 {
 	run_prng_test();
 	printf("PRNG Test successful.\n");
+	run_bench();
 	return 0;
 }
@@ -48,7 +48,7 @@ static void print_stream(struct stream *s)
 
 int main(void)
 {
-	struct stream *s;
+	struct stream *s, *clone, *slice;
 
 	s = stream_new(1024);
 
@@ -68,5 +68,23 @@ int main(void)
 	printfrr("l: 0x%x\n", stream_getl(s));
 	printfrr("q: 0x%" PRIx64 "\n", stream_getq(s));
 
+	/* zero-copy references keep the data alive after the original is
+	 * freed, and have their own getp/endp
+	 */
+	assert(!stream_is_shared(s));
+	clone = stream_clone(s);
+	slice = stream_slice(s, 3, 4);
+	assert(stream_is_shared(s) && stream_is_shared(clone));
+	assert(STREAM_DATA(clone) == STREAM_DATA(s));
+	stream_free(s);
+
+	stream_set_getp(clone, 0);
+	print_stream(clone);
+	print_stream(slice);
+	printfrr("slice l: 0x%x\n", stream_getl(slice));
+
+	stream_free(clone);
+	stream_free(slice);
+
 	return 0;
 }
@@ -23,6 +23,8 @@
 
 #include "prefix.h"
 #include "table.h"
+#include "monotime.h"
+#include "prng.h"
 
 /*
  * test_node_t
@@ -490,6 +492,187 @@ static void test_iter_pause(void)
 	route_table_finish(table);
 }
 
+#define STRIDE_PREFIXES 200000
+#define STRIDE_LOOKUPS	 1000000
+
+static void stride_random_prefix(struct prng *prng, struct prefix_ipv4 *p)
+{
+	unsigned int len = prng_rand(prng) % 100;
+
+	/* roughly the shape of a DFZ table: mostly /24, some shorter */
+	if (len < 60)
+		len = 24;
+	else if (len < 95)
+		len = 16 + len % 8;
+	else
+		len = 8 + len % 25;
+
+	memset(p, 0, sizeof(*p));
+	p->family = AF_INET;
+	p->prefixlen = len;
+	p->prefix.s_addr = htonl(prng_rand(prng));
+	apply_mask_ipv4(p);
+}
+
+static void stride_fill(struct route_table *table, struct prng *prng)
+{
+	struct prefix_ipv4 p;
+	struct route_node *rn;
+
+	for (int i = 0; i < STRIDE_PREFIXES; i++) {
+		stride_random_prefix(prng, &p);
+		rn = route_node_get(table, (struct prefix *)&p);
+		if (rn->info)
+			route_unlock_node(rn);
+		else
+			rn->info = rn;
+	}
+}
+
+static void stride_remove(struct route_table *table, struct prng *prng)
+{
+	struct prefix_ipv4 p;
+	struct route_node *rn;
+
+	for (int i = 0; i < STRIDE_PREFIXES / 2; i++) {
+		stride_random_prefix(prng, &p);
+		rn = route_node_lookup(table, (struct prefix *)&p);
+		if (!rn)
+			continue;
+		rn->info = NULL;
+		route_unlock_node(rn);
+		route_unlock_node(rn);
+	}
+}
+
+static unsigned long stride_usec(struct timeval *start)
+{
+	return monotime_since(start, NULL);
+}
+
+/*
+ * Build the same table with and without a stride index, compare lookup
+ * results and print timings.
+ */
+static void test_stride(void)
+{
+	struct route_table *plain, *indexed;
+	struct prng *prng;
+	struct timeval start;
+	struct route_node *a, *b, *rn;
+	unsigned long t_insert[2], t_lookup[2], t_walk[2];
+	struct in_addr addr;
+	unsigned int walked;
+
+	printf("\n\nTesting route table stride index\n");
+
+	plain = route_table_init();
+	indexed = route_table_init();
+	/* index an empty table, fill the other one before indexing it */
+	route_table_set_stride(indexed, AF_INET, 16);
+
+	prng = prng_new(0);
+	monotime(&start);
+	stride_fill(plain, prng);
+	t_insert[0] = stride_usec(&start);
+	prng_free(prng);
+
+	prng = prng_new(0);
+	monotime(&start);
+	stride_fill(indexed, prng);
+	t_insert[1] = stride_usec(&start);
+	prng_free(prng);
+
+	assert(route_table_count(plain) == route_table_count(indexed));
+	printf("  insert %d: %lu.%03lums plain, %lu.%03lums indexed\n",
+	       STRIDE_PREFIXES, t_insert[0] / 1000, t_insert[0] % 1000,
+	       t_insert[1] / 1000, t_insert[1] % 1000);
+
+	for (int pass = 0; pass < 2; pass++) {
+		printf("Verifying stride index (pass %d)\n", pass);
+
+		prng = prng_new(1);
+		monotime(&start);
+		for (int i = 0; i < STRIDE_LOOKUPS; i++) {
+			addr.s_addr = prng_rand(prng);
+			a = route_node_match_ipv4(plain, &addr);
+			if (a)
+				route_unlock_node(a);
+		}
+		t_lookup[0] = stride_usec(&start);
+		prng_free(prng);
+
+		prng = prng_new(1);
+		monotime(&start);
+		for (int i = 0; i < STRIDE_LOOKUPS; i++) {
+			addr.s_addr = prng_rand(prng);
+			b = route_node_match_ipv4(indexed, &addr);
+			if (b)
+				route_unlock_node(b);
+		}
+		t_lookup[1] = stride_usec(&start);
+		prng_free(prng);
+
+		prng = prng_new(2);
+		for (int i = 0; i < STRIDE_LOOKUPS / 10; i++) {
+			addr.s_addr = prng_rand(prng);
+			a = route_node_match_ipv4(plain, &addr);
+			b = route_node_match_ipv4(indexed, &addr);
+			assert(!a == !b);
+			if (!a)
+				continue;
+			assert(!prefix_cmp(&a->p, &b->p));
+			route_unlock_node(a);
+			route_unlock_node(b);
+		}
+		prng_free(prng);
+
+		monotime(&start);
+		walked = 0;
+		for (rn = route_top(indexed); rn; rn = route_next(rn))
+			walked++;
+		t_walk[1] = stride_usec(&start);
+		monotime(&start);
+		for (rn = route_top(plain); rn; rn = route_next(rn))
+			walked--;
+		t_walk[0] = stride_usec(&start);
+		assert(walked == 0);
+
+		printf("  lookup %d: %lu.%03lums plain, %lu.%03lums indexed\n",
+		       STRIDE_LOOKUPS, t_lookup[0] / 1000, t_lookup[0] % 1000,
+		       t_lookup[1] / 1000, t_lookup[1] % 1000);
+		printf("  walk: %lu.%03lums plain, %lu.%03lums indexed\n",
+		       t_walk[0] / 1000, t_walk[0] % 1000, t_walk[1] / 1000,
+		       t_walk[1] % 1000);
+
+		/* second pass: after deleting half, and reindexed from scratch
+		 * on top of the incrementally maintained one
+		 */
+		prng = prng_new(3);
+		stride_remove(plain, prng);
+		prng_free(prng);
+		prng = prng_new(3);
+		stride_remove(indexed, prng);
+		prng_free(prng);
+		if (!pass)
+			route_table_set_stride(indexed, AF_INET, 16);
+	}
+	printf("Verified stride index\n");
+
+	for (rn = route_top(plain); rn; rn = route_next(rn))
+		if (rn->info) {
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+	for (rn = route_top(indexed); rn; rn = route_next(rn))
+		if (rn->info) {
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+	route_table_finish(plain);
+	route_table_finish(indexed);
+}
+
 /*
  * run_tests
  */
@@ -498,6 +681,7 @@ static void run_tests(void)
 	test_prefix_iter_cmp();
 	test_get_next();
 	test_iter_pause();
+	test_stride();
 }
 
 /*
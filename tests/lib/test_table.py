@@ -10,3 +10,6 @@ for i in range(6):
 for i in range(11):
     TestTable.onesimple("Verifying successor")
 TestTable.onesimple("Verified pausing")
+for i in range(2):
+    TestTable.onesimple("Verifying stride index")
+TestTable.onesimple("Verified stride index")
@@ -0,0 +1,119 @@
+/*
+ * Test cross-pthread event injection into a thread_master
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+#include <pthread.h>
+
+#include "memory.h"
+#include "thread.h"
+
+#define NPRODUCERS 4
+#define NEVENTS	   20000
+
+struct thread_master *master;
+
+static unsigned int received[NPRODUCERS];
+static unsigned int total;
+static int cancelme;
+
+static int event_func(struct thread *t)
+{
+	int producer = THREAD_VAL(t);
+
+	/* events from one producer must arrive in order */
+	assert((intptr_t)THREAD_ARG(t) == received[producer]);
+	received[producer]++;
+	total++;
+	return 0;
+}
+
+static int keepalive_func(struct thread *t)
+{
+	assert(!"test timed out");
+	return 0;
+}
+
+static int cancelled_func(struct thread *t)
+{
+	assert(!"cancelled event was run");
+	return 0;
+}
+
+static void *producer(void *arg)
+{
+	int id = (intptr_t)arg;
+
+	for (intptr_t i = 0; i < NEVENTS; i++) {
+		thread_add_event(master, event_func, (void *)i, id, NULL);
+		if (i % 4096 == 0)
+			usleep(100);
+	}
+	return NULL;
+}
+
+static void *cancel_producer(void *arg)
+{
+	thread_add_event(master, cancelled_func, &cancelme, 0, NULL);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t producers[NPRODUCERS];
+	pthread_t canceller;
+	struct thread thread;
+	struct thread *t_keepalive = NULL;
+
+	master = thread_master_create(NULL);
+
+	/* keeps thread_fetch() from returning while nothing is pending */
+	thread_add_timer(master, keepalive_func, NULL, 60, &t_keepalive);
+
+	for (int i = 0; i < NPRODUCERS; i++)
+		assert(!pthread_create(&producers[i], NULL, producer,
+				       (void *)(intptr_t)i));
+
+	while (total < NPRODUCERS * NEVENTS) {
+		assert(thread_fetch(master, &thread));
+		thread_call(&thread);
+	}
+
+	for (int i = 0; i < NPRODUCERS; i++) {
+		pthread_join(producers[i], NULL);
+		assert(received[i] == NEVENTS);
+	}
+
+	/* an event still sitting in the inbox can be cancelled by arg */
+	assert(!pthread_create(&canceller, NULL, cancel_producer, NULL));
+	pthread_join(canceller, NULL);
+	thread_cancel_event(master, &cancelme);
+
+	thread_add_event(master, event_func, (void *)(intptr_t)NEVENTS, 0,
+			 NULL);
+	while (total < NPRODUCERS * NEVENTS + 1) {
+		assert(thread_fetch(master, &thread));
+		thread_call(&thread);
+	}
+
+	thread_cancel(&t_keepalive);
+	printf("OK\n");
+	thread_master_free(master);
+	return 0;
+}
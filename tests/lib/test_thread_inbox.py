@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestThreadInbox(frrtest.TestMultiOut):
+    program = "./test_thread_inbox"
+
+
+TestThreadInbox.onesimple("OK")
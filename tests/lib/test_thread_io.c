@@ -0,0 +1,187 @@
+/*
+ * Test I/O readiness backends of the thread library
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+
+#include "memory.h"
+#include "thread.h"
+#include "network.h"
+
+#define NPAIRS 64
+
+struct thread_master *master;
+
+static int pairs[NPAIRS][2];
+static struct thread *t_read[NPAIRS], *t_write[NPAIRS];
+static struct thread *t_null;
+static unsigned int nread, nwrite, nnull;
+
+static int reopen[2];
+static struct thread *t_reopen, *t_watchdog;
+static unsigned int nreopen;
+
+static int pair_read(struct thread *t)
+{
+	int i = (intptr_t)THREAD_ARG(t);
+	char c;
+
+	assert(read(pairs[i][0], &c, 1) == 1);
+	assert(c == (char)i);
+	nread++;
+	return 0;
+}
+
+static int pair_write(struct thread *t)
+{
+	int i = (intptr_t)THREAD_ARG(t);
+	char c = i;
+
+	assert(write(pairs[i][1], &c, 1) == 1);
+	nwrite++;
+	return 0;
+}
+
+static int null_read(struct thread *t)
+{
+	/* not pollable with epoll, must still be reported as ready */
+	if (++nnull < 3)
+		thread_add_read(master, null_read, NULL, THREAD_FD(t), &t_null);
+	return 0;
+}
+
+/*
+ * Close the fd and get a new socket by the same number, all within one
+ * loop iteration.  The kernel dropped the registration of the old one, so
+ * the new one must be registered again although nothing changed on our
+ * side.
+ */
+static int reopen_read(struct thread *t)
+{
+	int fd = THREAD_FD(t), sv[2], tmp;
+	char c;
+
+	assert(read(fd, &c, 1) == 1);
+	if (++nreopen == 2)
+		return 0;
+
+	close(reopen[0]);
+	close(reopen[1]);
+	assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+	if (sv[1] == fd) {
+		tmp = sv[0];
+		sv[0] = sv[1];
+		sv[1] = tmp;
+	}
+	if (sv[0] != fd) {
+		assert(dup2(sv[0], fd) == fd);
+		close(sv[0]);
+	}
+	reopen[0] = fd;
+	reopen[1] = sv[1];
+
+	thread_add_read(master, reopen_read, NULL, fd, &t_reopen);
+	assert(write(reopen[1], "x", 1) == 1);
+	return 0;
+}
+
+static int watchdog(struct thread *t)
+{
+	assert(!"lost wakeup");
+	return 0;
+}
+
+static void run(void)
+{
+	struct thread thread;
+
+	/* poll() keeps drained fds in its array, so thread_fetch() may not
+	 * return NULL by itself; stop once everything has fired.
+	 */
+	while (nread < NPAIRS / 2 || nwrite < NPAIRS / 2 || nnull < 3
+	       || nreopen < 2) {
+		assert(thread_fetch(master, &thread));
+		thread_call(&thread);
+	}
+}
+
+static void test_backend(const char *name)
+{
+	int nullfd;
+
+	if (thread_io_backend_set(name)) {
+		printf("%s: not available\n", name);
+		return;
+	}
+
+	master = thread_master_create(NULL);
+	assert(!strcmp(thread_io_backend_name(master), name));
+
+	nread = nwrite = nnull = nreopen = 0;
+	for (int i = 0; i < NPAIRS; i++) {
+		assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i]));
+		set_nonblocking(pairs[i][0]);
+		set_nonblocking(pairs[i][1]);
+		thread_add_read(master, pair_read, (void *)(intptr_t)i,
+				pairs[i][0], &t_read[i]);
+	}
+
+	/* every other pair gets written to, the rest is cancelled */
+	for (int i = 0; i < NPAIRS; i += 2)
+		thread_add_write(master, pair_write, (void *)(intptr_t)i,
+				 pairs[i][1], &t_write[i]);
+	for (int i = 1; i < NPAIRS; i += 2)
+		thread_cancel(&t_read[i]);
+
+	nullfd = open("/dev/null", O_RDONLY);
+	assert(nullfd >= 0);
+	thread_add_read(master, null_read, NULL, nullfd, &t_null);
+
+	assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, reopen));
+	thread_add_read(master, reopen_read, NULL, reopen[0], &t_reopen);
+	assert(write(reopen[1], "x", 1) == 1);
+	thread_add_timer(master, watchdog, NULL, 5, &t_watchdog);
+
+	run();
+	thread_cancel(&t_watchdog);
+
+	assert(nwrite == NPAIRS / 2);
+	assert(nread == NPAIRS / 2);
+	assert(nnull == 3);
+
+	for (int i = 0; i < NPAIRS; i++) {
+		assert(!t_read[i] && !t_write[i]);
+		close(pairs[i][0]);
+		close(pairs[i][1]);
+	}
+	close(nullfd);
+	close(reopen[0]);
+	close(reopen[1]);
+
+	thread_master_free(master);
+	printf("%s: OK\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	test_backend("poll");
+	test_backend("epoll");
+	test_backend("kqueue");
+	return 0;
+}
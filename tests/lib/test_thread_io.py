@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestThreadIO(frrtest.TestMultiOut):
+    program = "./test_thread_io"
+
+
+TestThreadIO.exit_cleanly()
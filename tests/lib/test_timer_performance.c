@@ -40,7 +40,7 @@ static int dummy_func(struct thread *thread)
 	return 0;
 }
 
-int main(int argc, char **argv)
+static void run(const char *name, bool wheel)
 {
 	struct prng *prng;
 	int i;
@@ -49,6 +49,7 @@ int main(int argc, char **argv)
 	unsigned long t_schedule, t_remove;
 
 	master = thread_master_create(NULL);
+	thread_master_set_timer_wheel(master, wheel);
 	prng = prng_new(0);
 	timers = calloc(SCHEDULE_TIMERS, sizeof(*timers));
 
@@ -90,14 +91,20 @@ int main(int argc, char **argv)
 	t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
 	t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
 
-	printf("Scheduling %d random timers took %lu.%03lu seconds.\n",
-	       SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
-	printf("Removing %d random timers took %lu.%03lu seconds.\n",
-	       REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
+	printf("%s: Scheduling %d random timers took %lu.%03lu seconds.\n",
+	       name, SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
+	printf("%s: Removing %d random timers took %lu.%03lu seconds.\n",
+	       name, REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
 	fflush(stdout);
 
 	free(timers);
 	thread_master_free(master);
 	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	run("heap", false);
+	run("wheel", true);
 	return 0;
 }
@@ -66,6 +66,7 @@
 #define _T_SORTLIST_UNIQ	(T_SORTED | T_UNIQ)
 #define _T_SORTLIST_NONUNIQ	(T_SORTED)
 #define _T_HASH			(T_SORTED | T_UNIQ | T_HASH)
+#define _T_OAHASH		(T_SORTED | T_UNIQ | T_HASH)
 #define _T_SKIPLIST_UNIQ	(T_SORTED | T_UNIQ)
 #define _T_SKIPLIST_NONUNIQ	(T_SORTED)
 #define _T_RBTREE_UNIQ		(T_SORTED | T_UNIQ)
@@ -128,6 +129,15 @@ static void ts_end(void)
 #include "test_typelist.h"
 #undef SHITTY_HASH
 
+#define TYPE OAHASH
+#include "test_typelist.h"
+
+#define TYPE OAHASH_collisions
+#define REALTYPE OAHASH
+#define SHITTY_HASH
+#include "test_typelist.h"
+#undef SHITTY_HASH
+
 #define TYPE SKIPLIST_UNIQ
 #include "test_typelist.h"
 
@@ -158,6 +168,8 @@ int main(int argc, char **argv)
 	test_SORTLIST_NONUNIQ();
 	test_HASH();
 	test_HASH_collisions();
+	test_OAHASH();
+	test_OAHASH_collisions();
 	test_SKIPLIST_UNIQ();
 	test_SKIPLIST_NONUNIQ();
 	test_RBTREE_UNIQ();
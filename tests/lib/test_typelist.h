@@ -40,6 +40,7 @@
 #define list_find_gteq	concat(TYPE, _find_gteq)
 #define list_del	concat(TYPE, _del)
 #define list_pop	concat(TYPE, _pop)
+#define list_decrease	concat(TYPE, _decrease)
 
 #define ts_hash		concat(ts_hash_, TYPE)
 
@@ -242,6 +243,25 @@ static void concat(test_, TYPE)(void)
 	}
 	ts_hash("pop", NULL);
 
+	/* decrease-key: pull some items ahead of the current minimum, they
+	 * must come out first and in order.  Put them back as they were.
+	 */
+	l = 0;
+	for (i = 0; i < NITEM && l < prev->val; i++) {
+		if (!itm[i].scratchpad || i % 64)
+			continue;
+		itm[i].val = l++;
+		list_decrease(&head, &itm[i]);
+	}
+	for (j = 0; j < l; j++) {
+		item = list_pop(&head);
+		assert(item->val == j);
+		item->val = item - itm;
+		list_add(&head, item);
+	}
+	assert(list_count(&head) == k);
+	ts_hash("decrease", NULL);
+
 #else /* !IS_UNIQ(REALTYPE) && !IS_HEAP(REALTYPE) */
 	for (i = 0; i < NITEM; i++) {
 		j = prng_rand(prng) % NITEM;
@@ -571,6 +591,7 @@ static void concat(test_, TYPE)(void)
 #undef list_find_gteq
 #undef list_del
 #undef list_pop
+#undef list_decrease
 
 #undef REALTYPE
 #undef TYPE
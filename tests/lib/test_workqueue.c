@@ -0,0 +1,149 @@
+/*
+ * Test parallel work queues
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+
+#include "memory.h"
+#include "thread.h"
+#include "workqueue.h"
+#include "frr_pthread.h"
+
+#define NTHREADS 4
+#define NSHARDS	 16
+#define NITEMS	 100000
+
+struct thread_master *master;
+
+static struct work_queue *wq;
+static pthread_t owner;
+
+/* only touched by the pthread running the respective shard */
+static unsigned int shard_last[NSHARDS];
+static _Atomic unsigned int ran;
+
+static bool done;
+static unsigned int next_done, nerror, nsuccess;
+
+static unsigned int item_shard(struct work_queue *wq, void *data)
+{
+	return (uintptr_t)data % NSHARDS;
+}
+
+static wq_item_status item_work(struct work_queue *wq, void *data)
+{
+	unsigned int val = (uintptr_t)data;
+
+	assert(!pthread_equal(pthread_self(), owner));
+	assert(val > shard_last[val % NSHARDS]);
+	shard_last[val % NSHARDS] = val;
+	atomic_fetch_add(&ran, 1);
+
+	return (val % 97) ? WQ_SUCCESS : WQ_ERROR;
+}
+
+/* completions must happen on the owner, in the order items were added */
+static void item_complete(unsigned int val)
+{
+	assert(pthread_equal(pthread_self(), owner));
+	assert(val == next_done + 1);
+	next_done = val;
+}
+
+static void item_done(struct work_queue *wq, void *data)
+{
+	assert((uintptr_t)data % 97);
+	item_complete((uintptr_t)data);
+	nsuccess++;
+}
+
+static void item_error(struct work_queue *wq, struct work_queue_item *item)
+{
+	assert((uintptr_t)item->data % 97 == 0);
+	item_complete((uintptr_t)item->data);
+	nerror++;
+}
+
+/* may also run in between batches, when the queue happens to drain */
+static void queue_complete(struct work_queue *wq)
+{
+	assert(pthread_equal(pthread_self(), owner));
+	assert(work_queue_empty(wq));
+	done = (next_done == NITEMS);
+}
+
+static int add_items(struct thread *t)
+{
+	unsigned int base = (uintptr_t)THREAD_ARG(t);
+
+	/* several batches, so that items get added while others run */
+	for (unsigned int i = 1; i <= NITEMS / 4; i++)
+		work_queue_add(wq, (void *)(uintptr_t)(base + i));
+	if (base + NITEMS / 4 < NITEMS)
+		thread_add_event(master, add_items,
+				 (void *)(uintptr_t)(base + NITEMS / 4), 0,
+				 NULL);
+	return 0;
+}
+
+/* thread_fetch() gives up when nothing is scheduled on the master, even
+ * though the workers will post results to it later
+ */
+static int keepalive(struct thread *t)
+{
+	if (!done)
+		thread_add_timer_msec(master, keepalive, NULL, 10, NULL);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct thread t;
+
+	owner = pthread_self();
+	frr_pthread_init();
+	master = thread_master_create(NULL);
+
+	wq = work_queue_new(master, "test queue");
+	wq->spec.workfunc = item_work;
+	wq->spec.shardfunc = item_shard;
+	wq->spec.donefunc = item_done;
+	wq->spec.errorfunc = item_error;
+	wq->spec.completion_func = queue_complete;
+	wq->spec.hold = 0;
+	work_queue_set_parallel(wq, NTHREADS);
+
+	thread_add_event(master, add_items, (void *)0, 0, NULL);
+	thread_add_timer_msec(master, keepalive, NULL, 10, NULL);
+	while (!done && thread_fetch(master, &t))
+		thread_call(&t);
+
+	assert(ran == NITEMS);
+	assert(next_done == NITEMS);
+	assert(nerror == NITEMS / 97);
+	assert(nsuccess + nerror == NITEMS);
+	assert(work_queue_empty(wq));
+
+	work_queue_free_and_null(&wq);
+	thread_master_free(master);
+	frr_pthread_finish();
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Test asynchronous log writer
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+#include <pthread.h>
+
+#include "frrcu.h"
+#include "zlog.h"
+#include "zlog_targets.h"
+
+#define NTHREADS 4
+#define NMSGS	 20000
+
+static struct zlog_cfg_file zcf;
+
+struct wargs {
+	struct rcu_thread *rcu_thread;
+	unsigned int id;
+};
+
+static void *log_worker(void *arg)
+{
+	struct wargs *wa = arg;
+
+	rcu_thread_start(wa->rcu_thread);
+	rcu_read_unlock();
+
+	for (unsigned int i = 0; i < NMSGS; i++)
+		zlog_info("thread %u message %u", wa->id, i);
+	return NULL;
+}
+
+static void run(void)
+{
+	pthread_t threads[NTHREADS];
+	struct wargs wa[NTHREADS];
+
+	for (unsigned int i = 0; i < NTHREADS; i++) {
+		wa[i].id = i;
+		wa[i].rcu_thread = rcu_thread_prepare();
+		assert(!pthread_create(&threads[i], NULL, log_worker, &wa[i]));
+	}
+	for (unsigned int i = 0; i < NTHREADS; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/* every message must be there at most once, in order for each pthread */
+static unsigned int check(const char *path, bool gaps)
+{
+	unsigned int next[NTHREADS] = {};
+	unsigned int id, seq, total = 0;
+	char line[256], *pos;
+	FILE *fd;
+
+	fd = fopen(path, "r");
+	assert(fd);
+	while (fgets(line, sizeof(line), fd)) {
+		pos = strstr(line, "thread ");
+		assert(pos);
+		assert(sscanf(pos, "thread %u message %u", &id, &seq) == 2);
+		assert(id < NTHREADS);
+		assert(seq >= next[id]);
+		assert(gaps || seq == next[id]);
+		next[id] = seq + 1;
+		total++;
+	}
+	fclose(fd);
+	return total;
+}
+
+int main(int argc, char **argv)
+{
+	struct zlog_async_stats st;
+	char path[] = "/tmp/test_zlog_async.XXXXXX";
+	unsigned int total;
+	int fd;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+
+	zlog_aux_init("NONE: ", ZLOG_DISABLED);
+	zlog_file_init(&zcf);
+	zcf.prio_min = LOG_DEBUG;
+	assert(zlog_file_set_filename(&zcf, path));
+
+	/* lossless */
+	zlog_async_set(ZLOG_ASYNC_BLOCK);
+	run();
+	zlog_async_drain();
+	zlog_async_stats(&st);
+	assert(st.msgs == NTHREADS * NMSGS);
+	assert(st.dropped == 0 && st.errors == 0);
+	assert(st.writes <= st.msgs);
+	assert(check(path, false) == NTHREADS * NMSGS);
+	printf("block: %" PRIu64 " messages in %" PRIu64 " writes\n", st.msgs,
+	       st.writes);
+
+	/* pthreads are gone, so are their buffers after another pass */
+	zlog_async_drain();
+	zlog_async_stats(&st);
+	assert(st.buffers == 0 && st.queued == 0);
+
+	assert(truncate(path, 0) == 0);
+	assert(zlog_file_set_filename(&zcf, path));
+
+	/* whatever isn't written must be counted */
+	zlog_async_set(ZLOG_ASYNC_DROP);
+	run();
+	zlog_async_set(ZLOG_ASYNC_OFF);
+	zlog_async_stats(&st);
+	total = check(path, true);
+	assert(st.msgs - NTHREADS * NMSGS == total);
+	assert(total + st.dropped == NTHREADS * NMSGS);
+	printf("drop: %u written, %" PRIu64 " dropped\n", total, st.dropped);
+
+	zlog_file_fini(&zcf);
+	unlink(path);
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,10 @@
+import frrtest
+
+
+class TestZlogAsync(frrtest.TestMultiOut):
+    program = "./test_zlog_async"
+
+
+TestZlogAsync.onesimple("block: ")
+TestZlogAsync.onesimple("drop: ")
+TestZlogAsync.onesimple("OK")
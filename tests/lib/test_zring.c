@@ -0,0 +1,209 @@
+/*
+ * Test ZAPI shared-memory ring
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include "zring.h"
+#include "prng.h"
+#include "stream.h"
+#include "zclient.h"
+
+#ifdef HAVE_ZRING
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#endif
+
+#define RINGSIZE 4096
+#define NBYTES	 (64 * 1024 * 1024)
+
+struct thread_master *master;
+
+/* a lost wakeup shows up as a timeout */
+static void wait_fd(struct zring *ring)
+{
+	struct pollfd pfd = {.fd = zring_fd(ring), .events = POLLIN};
+
+	assert(poll(&pfd, 1, 5000) == 1);
+	zring_ack(ring);
+}
+
+static void *consumer(void *arg)
+{
+	struct zring *ring = arg;
+	uint8_t buf[1500];
+	size_t total = 0;
+	ssize_t nb;
+
+	while (total < NBYTES) {
+		nb = zring_read(ring, buf, sizeof(buf));
+		if (nb == -2) {
+			wait_fd(ring);
+			continue;
+		}
+		assert(nb > 0);
+		for (ssize_t i = 0; i < nb; i++)
+			assert(buf[i] == (uint8_t)((total + i) % 251));
+		total += nb;
+	}
+	return NULL;
+}
+
+/* the next message is cmd, in the ring, and the socket stayed quiet */
+static void assert_ring_msg(struct zring *cons, int sock, uint16_t cmd)
+{
+	uint8_t buf[256];
+	struct zmsghdr hdr;
+	struct stream *s;
+	ssize_t nb;
+
+	assert(recv(sock, buf, sizeof(buf), MSG_DONTWAIT) == -1
+	       && errno == EAGAIN);
+
+	nb = zring_read(cons, buf, sizeof(buf));
+	assert(nb >= ZEBRA_HEADER_SIZE);
+
+	s = stream_new(sizeof(buf));
+	stream_put(s, buf, nb);
+	assert(zapi_parse_header(s, &hdr));
+	assert(hdr.command == cmd && hdr.length == nb);
+	stream_free(s);
+}
+
+/* Label manager requests on a zclient that switched to its ring; zebra
+ * drops clients that still write to the socket.
+ */
+static void test_label_manager(void)
+{
+	struct zclient_options opt = zclient_options_default;
+	struct zclient *zclient;
+	struct zring *cons;
+	struct stream *s;
+	int sv[2], fds[ZRING_NFDS] = {-1, -1, -1};
+	uint8_t buf[256];
+
+	opt.shm_ring = true;
+	zclient = zclient_new(master, &opt);
+	zclient->redist_default = ZEBRA_ROUTE_BGP;
+
+	assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+	zclient->sock = sv[0];
+
+	assert(zclient_send_hello(zclient) == ZCLIENT_SEND_SUCCESS);
+	assert(zclient->ring);
+	assert(zring_recv(sv[1], buf, sizeof(buf), fds) > 0);
+	cons = zring_attach(fds);
+	assert(cons);
+
+	assert(lm_label_manager_connect(zclient, 1) == 0);
+	assert_ring_msg(cons, sv[1], ZEBRA_LABEL_MANAGER_CONNECT_ASYNC);
+
+	/* synchronous, with zebra's answer waiting on the socket */
+	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	zclient_create_header(s, ZEBRA_LABEL_MANAGER_CONNECT, VRF_DEFAULT);
+	stream_putc(s, ZEBRA_ROUTE_BGP);
+	stream_putw(s, 0);
+	stream_putc(s, 0);
+	stream_putw_at(s, 0, stream_get_endp(s));
+	assert(write(sv[1], STREAM_DATA(s), stream_get_endp(s))
+	       == (ssize_t)stream_get_endp(s));
+	stream_free(s);
+
+	assert(lm_label_manager_connect(zclient, 0) == 0);
+	assert_ring_msg(cons, sv[1], ZEBRA_LABEL_MANAGER_CONNECT);
+
+	assert(lm_release_label_chunk(zclient, 16, 31) == 0);
+	assert_ring_msg(cons, sv[1], ZEBRA_RELEASE_LABEL_CHUNK);
+
+	zclient_stop(zclient);
+	zclient_free(zclient);
+	zring_free(cons);
+	close(sv[1]);
+}
+
+int main(int argc, char **argv)
+{
+	struct zring *prod, *cons;
+	struct prng *prng;
+	pthread_t thread;
+	int sv[2], fds[ZRING_NFDS] = {-1, -1, -1};
+	uint8_t buf[2000];
+	char hello[8];
+	size_t total = 0, len, n;
+
+	prod = zring_new(RINGSIZE);
+	if (!prod) {
+		printf("no shared-memory rings\nOK\n");
+		return 0;
+	}
+
+	/* hand the ring over like zclient does with HELLO */
+	assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+	assert(zring_send(sv[0], prod, "HELLO", 5) == 5);
+	assert(zring_recv(sv[1], hello, sizeof(hello), fds) == 5);
+	assert(!memcmp(hello, "HELLO", 5));
+	cons = zring_attach(fds);
+	assert(cons);
+	assert(fds[0] == -1);
+
+	/* nothing there yet */
+	assert(zring_read(cons, buf, sizeof(buf)) == -2);
+
+	assert(!pthread_create(&thread, NULL, consumer, cons));
+
+	prng = prng_new(0);
+	while (total < NBYTES) {
+		len = MIN(1 + prng_rand(prng) % sizeof(buf), NBYTES - total);
+		for (size_t i = 0; i < len; i++)
+			buf[i] = (total + i) % 251;
+
+		for (size_t done = 0; done < len; done += n) {
+			n = zring_write(prod, buf + done, len - done);
+			zring_notify(prod);
+			if (!n)
+				wait_fd(prod);
+		}
+		total += len;
+	}
+	prng_free(prng);
+
+	pthread_join(thread, NULL);
+
+	close(sv[0]);
+	close(sv[1]);
+	zring_free(prod);
+	zring_free(cons);
+
+#ifdef HAVE_ZRING
+	/* zebra would get SIGBUS if the client could shrink the memfd */
+	fds[0] = memfd_create("test", 0);
+	assert(fds[0] >= 0 && !ftruncate(fds[0], 2 * RINGSIZE));
+	fds[1] = eventfd(0, 0);
+	fds[2] = eventfd(0, 0);
+	assert(!zring_attach(fds));
+	assert(fds[0] == -1 && fds[1] == -1 && fds[2] == -1);
+#endif
+
+	test_label_manager();
+
+	printf("OK\n");
+	return 0;
+}
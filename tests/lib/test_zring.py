@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestZRing(frrtest.TestMultiOut):
+    program = "./test_zring"
+
+
+TestZRing.onesimple("OK")
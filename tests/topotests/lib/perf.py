@@ -0,0 +1,198 @@
+#
+# perf.py
+# Library of helper functions for performance/scale topology tests
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+Helpers for the perf-* scale and convergence tests.
+
+A test creates one PerfRecorder, times its convergence steps with
+`measure()` and samples per-daemon resource usage with `sample()`. The
+results are logged and, if `perf_results_dir` is set in pytest.ini (or
+TOPOTESTS_PERF_RESULTS in the environment), written to
+`<dir>/<test module>.json` so they can be compared between builds:
+
+    {
+      "test": "test_perf_bgp_full_table",
+      "version": "7.6-dev",
+      "time": 1617180000,
+      "params": {"peers": 4, "prefixes": 10000},
+      "results": [
+        {"step": "initial", "metric": "convergence", "value": 3.21,
+         "unit": "s"},
+        {"step": "initial", "router": "r1", "daemon": "bgpd",
+         "metric": "peak_rss", "value": 84512, "unit": "KiB"},
+        ...
+      ]
+    }
+
+Scale parameters come from `scale_param()` so a small default keeps the
+tests cheap in CI, while e.g. TOPOTESTS_PERF_PREFIXES=1000000 turns them
+into a full-table run.
+"""
+
+import json
+import os
+import time
+
+from lib import topotest
+from lib.topogen import get_topogen
+from lib.topolog import logger
+
+
+def scale_param(name, default):
+    "Integer scale knob, overridden by TOPOTESTS_PERF_<NAME> if set."
+    return int(os.environ.get("TOPOTESTS_PERF_{}".format(name.upper()), default))
+
+
+def daemon_pid(router, daemon):
+    "Returns the pid of `daemon` on `router`, or None if it is not running."
+    output = router.run(
+        "cat /var/run/{}/{}.pid 2>/dev/null".format(router.routertype, daemon)
+    ).strip()
+    if output.isdigit():
+        return int(output)
+    return None
+
+
+def daemon_usage(pid):
+    """
+    Returns a dict with the peak and current RSS (KiB) and consumed user
+    and system CPU time (seconds) of a process.
+    """
+    usage = {}
+    with open("/proc/{}/status".format(pid)) as status:
+        for line in status:
+            key, _, value = line.partition(":")
+            if key == "VmHWM":
+                usage["peak_rss"] = int(value.split()[0])
+            elif key == "VmRSS":
+                usage["rss"] = int(value.split()[0])
+
+    with open("/proc/{}/stat".format(pid)) as stat:
+        # skip "pid (comm)", comm may contain spaces
+        fields = stat.read().rsplit(")", 1)[1].split()
+    ticks = os.sysconf(os.sysconf_names["SC_CLK_TCK"])
+    usage["cpu_user"] = float(fields[11]) / ticks
+    usage["cpu_sys"] = float(fields[12]) / ticks
+    return usage
+
+
+class PerfRecorder(object):
+    "Collects and reports the results of one performance test module."
+
+    UNITS = {
+        "peak_rss": "KiB",
+        "rss": "KiB",
+        "cpu_user": "s",
+        "cpu_sys": "s",
+    }
+
+    def __init__(self, testname, params=None):
+        self.testname = testname
+        self.params = params or {}
+        self.results = []
+
+        tgen = get_topogen()
+        self.path = os.environ.get("TOPOTESTS_PERF_RESULTS") or tgen.config.get(
+            tgen.CONFIG_SECTION, "perf_results_dir"
+        )
+
+    def record(self, step, metric, value, unit, **labels):
+        "Records one result."
+        result = {"step": step, "metric": metric, "value": value, "unit": unit}
+        result.update(labels)
+        self.results.append(result)
+        logger.info(
+            "perf {}: {} {}{} = {} {}".format(
+                self.testname,
+                step,
+                metric,
+                "".join(" {}={}".format(k, v) for k, v in sorted(labels.items())),
+                value,
+                unit,
+            )
+        )
+
+    def measure(self, step, func, count=600, wait=0.5, start=None):
+        """
+        Records the time it takes from now (or `start`, a time.time() value)
+        until `func` returns None (see topotest.run_and_expect) and returns
+        whether it did at all.
+        """
+        if start is None:
+            start = time.time()
+        success, result = topotest.run_and_expect(func, None, count, wait)
+        if success:
+            self.record(step, "convergence", round(time.time() - start, 3), "s")
+        else:
+            logger.info(
+                "perf {}: {} did not converge: {}".format(self.testname, step, result)
+            )
+        return success
+
+    def sample(self, step, routers=None):
+        "Records resource usage of every running daemon."
+        tgen = get_topogen()
+        if routers is None:
+            routers = tgen.routers().values()
+
+        for router in routers:
+            for daemon in tgen.net[router.name].listDaemons() or []:
+                pid = daemon_pid(router, daemon)
+                if pid is None:
+                    continue
+                try:
+                    usage = daemon_usage(pid)
+                except (IOError, OSError, IndexError):
+                    continue
+                for metric, value in sorted(usage.items()):
+                    self.record(
+                        step,
+                        metric,
+                        value,
+                        self.UNITS[metric],
+                        router=router.name,
+                        daemon=daemon,
+                    )
+
+    def write(self):
+        "Writes the results file, if a results directory is configured."
+        if not self.path:
+            return
+
+        tgen = get_topogen()
+        routers = list(tgen.routers().values())
+        version = routers[0].version_info()["version"] if routers else None
+
+        if not os.path.isdir(self.path):
+            os.makedirs(self.path)
+        filename = os.path.join(self.path, "{}.json".format(self.testname))
+        with open(filename, "w") as output:
+            json.dump(
+                {
+                    "test": self.testname,
+                    "version": version,
+                    "time": int(time.time()),
+                    "params": self.params,
+                    "results": self.results,
+                },
+                output,
+                indent=2,
+                sort_keys=True,
+            )
+        logger.info("perf results written to {}".format(filename))
@@ -99,6 +99,7 @@ tgen_defaults = {
     "frrdir": "/usr/lib/frr",
     "routertype": "frr",
     "memleak_path": "",
+    "perf_results_dir": "",
 }
 
 
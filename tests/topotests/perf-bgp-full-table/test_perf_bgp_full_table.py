@@ -0,0 +1,249 @@
+#!/usr/bin/env python
+
+#
+# test_perf_bgp_full_table.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_perf_bgp_full_table.py: BGP full table convergence with N peers
+
+r1 (the device under test) has one eBGP session to each of
+TOPOTESTS_PERF_PEERS peers, which all advertise the same
+TOPOTESTS_PERF_PREFIXES prefixes (installed with sharpd and redistributed).
+Records the time to converge initially, after a session reset and after a
+full withdraw, plus per-daemon peak RSS and CPU (see lib/perf.py).
+"""
+
+import os
+import sys
+import pytest
+from functools import partial
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+from lib.topolog import logger
+from lib.perf import PerfRecorder, scale_param
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+PEERS = scale_param("peers", 4)
+PREFIXES = scale_param("prefixes", 10000)
+
+perf = None
+
+#####################################################
+##
+##   Network Topology Definition
+##
+#####################################################
+
+
+class NetworkTopo(Topo):
+    "BGP full table topology"
+
+    def build(self, **_opts):
+        "Build function"
+
+        tgen = get_topogen(self)
+
+        tgen.add_router("r1")
+        for peern in range(1, PEERS + 1):
+            peer = tgen.add_router("peer{}".format(peern))
+            switch = tgen.add_switch("s{}".format(peern))
+            switch.add_link(tgen.gears["r1"])
+            switch.add_link(peer)
+
+
+def write_config(router, daemon, lines):
+    "Writes a generated configuration file and loads it."
+    filename = os.path.join(router.logdir, router.name, "{}.conf".format(daemon))
+    with open(filename, "w") as conf:
+        conf.write("\n".join(lines) + "\n")
+    return filename
+
+
+def r1_config(r1):
+    zebra = []
+    bgpd = [
+        "router bgp 65000",
+        " no bgp ebgp-requires-policy",
+        " no bgp network import-check",
+    ]
+    for peern in range(1, PEERS + 1):
+        zebra += [
+            "interface r1-eth{}".format(peern - 1),
+            " ip address 10.0.{}.1/24".format(peern),
+            "!",
+        ]
+        bgpd.append(" neighbor 10.0.{}.2 remote-as {}".format(peern, 65000 + peern))
+
+    r1.load_config(TopoRouter.RD_ZEBRA, write_config(r1, "zebra", zebra))
+    r1.load_config(TopoRouter.RD_BGP, write_config(r1, "bgpd", bgpd))
+
+
+def peer_config(peer, peern):
+    zebra = [
+        "interface {}-eth0".format(peer.name),
+        " ip address 10.0.{}.2/24".format(peern),
+    ]
+    bgpd = [
+        "router bgp {}".format(65000 + peern),
+        " no bgp ebgp-requires-policy",
+        " neighbor 10.0.{}.1 remote-as 65000".format(peern),
+        " address-family ipv4 unicast",
+        "  redistribute sharp",
+        " exit-address-family",
+    ]
+
+    peer.load_config(TopoRouter.RD_ZEBRA, write_config(peer, "zebra", zebra))
+    peer.load_config(TopoRouter.RD_SHARP, write_config(peer, "sharpd", []))
+    peer.load_config(TopoRouter.RD_BGP, write_config(peer, "bgpd", bgpd))
+
+
+def setup_module(module):
+    "Setup topology"
+    global perf
+
+    tgen = Topogen(NetworkTopo, module.__name__)
+    tgen.start_topology()
+
+    for rname, router in tgen.routers().items():
+        if rname == "r1":
+            r1_config(router)
+        else:
+            peer_config(router, int(rname[4:]))
+
+    tgen.start_router()
+
+    perf = PerfRecorder(
+        "test_perf_bgp_full_table", {"peers": PEERS, "prefixes": PREFIXES}
+    )
+
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+
+    perf.write()
+
+    # This function tears down the whole topology.
+    tgen.stop_topology()
+
+
+def expect_r1(prefixes, state="Established"):
+    "Returns a function checking what r1 learned from every peer."
+    r1 = get_topogen().gears["r1"]
+    peers = {}
+    for peern in range(1, PEERS + 1):
+        peers["10.0.{}.2".format(peern)] = {"state": state, "pfxRcd": prefixes}
+
+    bgp = partial(
+        topotest.router_json_cmp,
+        r1,
+        "show bgp ipv4 unicast summary json",
+        {"peers": peers},
+    )
+    if not prefixes:
+        return bgp
+
+    rib = partial(
+        topotest.router_json_cmp,
+        r1,
+        "show ip route summary json",
+        {"routes": [{"type": "ebgp", "rib": prefixes, "fib": prefixes}]},
+    )
+    return lambda: bgp() or rib()
+
+
+def test_bgp_sessions():
+    "Wait for all sessions to come up"
+
+    tgen = get_topogen()
+    # Don't run this test if we have any failure.
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    assert perf.measure("sessions", expect_r1(0)), "BGP sessions did not come up"
+
+
+def test_bgp_initial_table():
+    "Peers announce the full table at once"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    logger.info("{} peers announcing {} prefixes".format(PEERS, PREFIXES))
+    for peern in range(1, PEERS + 1):
+        tgen.gears["peer{}".format(peern)].vtysh_cmd(
+            "sharp install routes 100.0.0.0 nexthop 10.0.{}.1 {}".format(
+                peern, PREFIXES
+            )
+        )
+
+    assert perf.measure("initial", expect_r1(PREFIXES)), "r1 did not converge"
+    perf.sample("initial")
+
+
+def test_bgp_session_reset():
+    "Hard reset of all sessions on r1"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    tgen.gears["r1"].vtysh_cmd("clear bgp ipv4 unicast *")
+
+    assert perf.measure("reset", expect_r1(PREFIXES)), "r1 did not reconverge"
+    perf.sample("reset")
+
+
+def test_bgp_withdraw():
+    "Peers withdraw the full table at once"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    for peern in range(1, PEERS + 1):
+        tgen.gears["peer{}".format(peern)].vtysh_cmd(
+            "sharp remove routes 100.0.0.0 {}".format(PREFIXES)
+        )
+
+    assert perf.measure("withdraw", expect_r1(0)), "r1 did not withdraw"
+    perf.sample("withdraw")
+
+
+# Mem leak testcase
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip("Memory leak test/report is disabled")
+    tgen.report_memory_leaks()
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
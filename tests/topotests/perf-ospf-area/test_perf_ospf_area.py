@@ -0,0 +1,237 @@
+#!/usr/bin/env python
+
+#
+# test_perf_ospf_area.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_perf_ospf_area.py: OSPF convergence in a single large area
+
+TOPOTESTS_PERF_GRID x TOPOTESTS_PERF_GRID routers are connected as a grid,
+all in area 0, each with a loopback and TOPOTESTS_PERF_STUBS extra stub
+networks. Records the time until r1 (a corner) has a route to everything,
+to reconverge after one of its links goes down and comes back, plus
+per-daemon peak RSS and CPU (see lib/perf.py).
+"""
+
+import os
+import sys
+import pytest
+from functools import partial
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+from lib.topolog import logger
+from lib.perf import PerfRecorder, scale_param
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+GRID = scale_param("grid", 3)
+STUBS = scale_param("stubs", 10)
+ROUTERS = GRID * GRID
+
+perf = None
+
+
+def grid_links():
+    "Returns the grid links as (router number, router number) pairs."
+    links = []
+    for row in range(GRID):
+        for col in range(GRID):
+            rn = row * GRID + col + 1
+            if col + 1 < GRID:
+                links.append((rn, rn + 1))
+            if row + 1 < GRID:
+                links.append((rn, rn + GRID))
+    return links
+
+
+LINKS = grid_links()
+
+
+def link_subnet(linkn):
+    return "10.{}.{}".format(linkn // 256, linkn % 256)
+
+
+#####################################################
+##
+##   Network Topology Definition
+##
+#####################################################
+
+
+class NetworkTopo(Topo):
+    "OSPF grid topology"
+
+    def build(self, **_opts):
+        "Build function"
+
+        tgen = get_topogen(self)
+
+        for rn in range(1, ROUTERS + 1):
+            tgen.add_router("r{}".format(rn))
+
+        for linkn, (a, b) in enumerate(LINKS):
+            switch = tgen.add_switch("s{}".format(linkn))
+            switch.add_link(tgen.gears["r{}".format(a)])
+            switch.add_link(tgen.gears["r{}".format(b)])
+
+
+def write_config(router, daemon, lines):
+    "Writes a generated configuration file and loads it."
+    filename = os.path.join(router.logdir, router.name, "{}.conf".format(daemon))
+    with open(filename, "w") as conf:
+        conf.write("\n".join(lines) + "\n")
+    return filename
+
+
+def router_config(router, rn):
+    zebra = ["interface lo", " ip address 10.255.0.{}/32".format(rn)]
+    for stub in range(STUBS):
+        zebra.append(" ip address 172.{}.{}.1/24".format(16 + rn // 256, stub))
+    zebra.append("!")
+
+    # interfaces are numbered in the order the links were added
+    ifn = 0
+    for linkn, (a, b) in enumerate(LINKS):
+        if rn not in (a, b):
+            continue
+        zebra += [
+            "interface {}-eth{}".format(router.name, ifn),
+            " ip address {}.{}/24".format(link_subnet(linkn), 1 if rn == a else 2),
+            "!",
+        ]
+        ifn += 1
+
+    ospfd = [
+        "router ospf",
+        " ospf router-id 10.255.0.{}".format(rn),
+        " network 0.0.0.0/0 area 0",
+        " timers throttle spf 0 50 5000",
+    ]
+
+    router.load_config(TopoRouter.RD_ZEBRA, write_config(router, "zebra", zebra))
+    router.load_config(TopoRouter.RD_OSPF, write_config(router, "ospfd", ospfd))
+
+
+def r1_degree():
+    return sum(1 for link in LINKS if 1 in link)
+
+
+def expect_r1(down_links=0):
+    """
+    Returns a function checking r1's OSPF routes: every loopback, stub and
+    link subnet that is not directly connected.
+    """
+    r1 = get_topogen().gears["r1"]
+    routes = (ROUTERS - 1) * (1 + STUBS) + len(LINKS) - r1_degree() + down_links
+
+    return partial(
+        topotest.router_json_cmp,
+        r1,
+        "show ip route summary json",
+        {"routes": [{"type": "ospf", "fib": routes}]},
+    )
+
+
+def setup_module(module):
+    "Setup topology"
+    global perf
+
+    tgen = Topogen(NetworkTopo, module.__name__)
+    tgen.start_topology()
+
+    for rname, router in tgen.routers().items():
+        router_config(router, int(rname[1:]))
+
+    tgen.start_router()
+
+    perf = PerfRecorder(
+        "test_perf_ospf_area",
+        {"routers": ROUTERS, "links": len(LINKS), "stubs": STUBS},
+    )
+
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+
+    perf.write()
+
+    # This function tears down the whole topology.
+    tgen.stop_topology()
+
+
+def test_ospf_initial():
+    "Wait for the whole area to converge"
+
+    tgen = get_topogen()
+    # Don't run this test if we have any failure.
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    logger.info("{} routers, {} links".format(ROUTERS, len(LINKS)))
+    assert perf.measure("initial", expect_r1()), "r1 did not converge"
+    perf.sample("initial")
+
+
+def test_ospf_link_down():
+    "One of r1's links goes down"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    # the far end still advertises the subnet, which r1 now learns
+    tgen.gears["r1"].vtysh_cmd("configure terminal\ninterface r1-eth0\nshutdown")
+
+    assert perf.measure("link-down", expect_r1(1)), "r1 did not reconverge"
+    perf.sample("link-down")
+
+
+def test_ospf_link_up():
+    "The link comes back"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    tgen.gears["r1"].vtysh_cmd("configure terminal\ninterface r1-eth0\nno shutdown")
+
+    assert perf.measure("link-up", expect_r1()), "r1 did not reconverge"
+    perf.sample("link-up")
+
+
+# Mem leak testcase
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip("Memory leak test/report is disabled")
+    tgen.report_memory_leaks()
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -0,0 +1,243 @@
+#!/usr/bin/env python
+
+#
+# test_perf_vrf_scale.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_perf_vrf_scale.py: zebra with many VRFs
+
+Creates TOPOTESTS_PERF_VRFS VRFs in the kernel while zebra runs, installs
+TOPOTESTS_PERF_ROUTES sharp routes into each, then removes the routes and
+the VRFs again. Records the time until zebra and the kernel reflect each
+step, plus per-daemon peak RSS and CPU (see lib/perf.py).
+"""
+
+import os
+import sys
+import time
+import platform
+import pytest
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+from lib.topolog import logger
+from lib.perf import PerfRecorder, scale_param
+
+# Required to instantiate the topology builder class.
+from mininet.topo import Topo
+
+VRFS = scale_param("vrfs", 50)
+ROUTES = scale_param("routes", 1000)
+
+# zebra/rt_netlink.h
+RTPROT_SHARP = 194
+
+perf = None
+
+#####################################################
+##
+##   Network Topology Definition
+##
+#####################################################
+
+
+class NetworkTopo(Topo):
+    "VRF scale topology"
+
+    def build(self, **_opts):
+        "Build function"
+
+        tgen = get_topogen(self)
+
+        tgen.add_router("r1")
+
+
+def write_config(router, daemon, lines):
+    "Writes a generated configuration file and loads it."
+    filename = os.path.join(router.logdir, router.name, "{}.conf".format(daemon))
+    with open(filename, "w") as conf:
+        conf.write("\n".join(lines) + "\n")
+    return filename
+
+
+def setup_module(module):
+    "Setup topology"
+    global perf
+
+    tgen = Topogen(NetworkTopo, module.__name__)
+    tgen.start_topology()
+
+    krel = platform.release()
+    if topotest.version_cmp(krel, "4.5") < 0:
+        tgen.errors = "Linux kernel version of at least 4.5 needed for VRF tests"
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears["r1"]
+    r1.load_config(TopoRouter.RD_ZEBRA, write_config(r1, "zebra", ["!"]))
+    r1.load_config(TopoRouter.RD_SHARP, write_config(r1, "sharpd", ["!"]))
+
+    tgen.start_router()
+
+    perf = PerfRecorder("test_perf_vrf_scale", {"vrfs": VRFS, "routes": ROUTES})
+
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+    tgen = get_topogen()
+
+    perf.write()
+
+    # This function tears down the whole topology.
+    tgen.stop_topology()
+
+
+def expect_vrfs(count):
+    "Returns a function checking the number of active VRFs in zebra."
+    r1 = get_topogen().gears["r1"]
+
+    def check():
+        output = r1.vtysh_cmd("show vrf")
+        found = len(
+            [l for l in output.splitlines() if l.startswith("vrf ") and " id " in l]
+        )
+        if found != count:
+            return "{} VRFs, expected {}".format(found, count)
+        return None
+
+    return check
+
+
+def expect_kernel_routes(count):
+    "Returns a function checking the number of sharp routes in the kernel."
+    r1 = get_topogen().gears["r1"]
+
+    def check():
+        output = r1.run(
+            "ip -4 route show table all proto {} | wc -l".format(RTPROT_SHARP)
+        )
+        found = int(output.strip() or 0)
+        if found != count:
+            return "{} kernel routes, expected {}".format(found, count)
+        return None
+
+    return check
+
+
+def test_vrf_add():
+    "Create all VRFs in the kernel"
+
+    tgen = get_topogen()
+    # Don't run this test if we have any failure.
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears["r1"]
+    logger.info("creating {} VRFs".format(VRFS))
+
+    start = time.time()
+    for vrfn in range(1, VRFS + 1):
+        r1.run("ip link add vrf{0} type vrf table {1}".format(vrfn, 1000 + vrfn))
+        r1.run("ip link set vrf{} up".format(vrfn))
+        r1.run("ip link add dum{} type dummy".format(vrfn))
+        r1.run("ip link set dum{0} master vrf{0} up".format(vrfn))
+        r1.run("ip addr add 192.168.0.1/24 dev dum{}".format(vrfn))
+
+    assert perf.measure("vrf-add", expect_vrfs(VRFS), start=start), "VRFs missing"
+    perf.sample("vrf-add")
+
+
+def test_vrf_routes_install():
+    "Install routes into every VRF"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears["r1"]
+
+    start = time.time()
+    for vrfn in range(1, VRFS + 1):
+        r1.vtysh_cmd(
+            "sharp install routes vrf vrf{} 10.0.0.0 nexthop 192.168.0.2 {}".format(
+                vrfn, ROUTES
+            )
+        )
+
+    assert perf.measure(
+        "routes-install", expect_kernel_routes(VRFS * ROUTES), start=start
+    ), "routes not installed"
+    perf.sample("routes-install")
+
+
+def test_vrf_routes_remove():
+    "Remove the routes from every VRF"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears["r1"]
+
+    start = time.time()
+    for vrfn in range(1, VRFS + 1):
+        r1.vtysh_cmd(
+            "sharp remove routes vrf vrf{} 10.0.0.0 {}".format(vrfn, ROUTES)
+        )
+
+    assert perf.measure(
+        "routes-remove", expect_kernel_routes(0), start=start
+    ), "routes not removed"
+    perf.sample("routes-remove")
+
+
+def test_vrf_delete():
+    "Delete all VRFs from the kernel"
+
+    tgen = get_topogen()
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears["r1"]
+
+    start = time.time()
+    for vrfn in range(1, VRFS + 1):
+        r1.run("ip link del dum{}".format(vrfn))
+        r1.run("ip link del vrf{}".format(vrfn))
+
+    assert perf.measure("vrf-delete", expect_vrfs(0), start=start), "VRFs left"
+    perf.sample("vrf-delete")
+
+
+# Mem leak testcase
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip("Memory leak test/report is disabled")
+    tgen.report_memory_leaks()
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -437,6 +437,7 @@ int vrrp_add_ip(struct vrrp_vrouter *vr, struct ipaddr *ip)
 
 	*new = *ip;
 	listnode_add(r->addrs, new);
+	vrrp_adver_invalidate(r);
 
 	if (r->fsm.state == VRRP_STATE_MASTER) {
 		switch (r->family) {
@@ -486,6 +487,7 @@ int vrrp_del_ip(struct vrrp_vrouter *vr, struct ipaddr *ip)
 	for (ALL_LIST_ELEMENTS(r->addrs, ln, nn, iter))
 		if (!memcmp(&iter->ip, &ip->ip, IPADDRSZ(ip)))
 			list_delete_node(r->addrs, ln);
+	vrrp_adver_invalidate(r);
 
 	/*
 	 * NB: Deleting the last address and then issuing a shutdown will cause
@@ -625,6 +627,7 @@ static void vrrp_router_destroy(struct vrrp_router *r)
 
 	/* FIXME: also delete list elements */
 	list_delete(&r->addrs);
+	vrrp_adver_invalidate(r);
 	XFREE(MTYPE_VRRP_RTR, r);
 }
 
@@ -769,39 +772,78 @@ static int vrrp_bind_to_primary_connected(struct vrrp_router *r)
 
 
 /*
- * Create and multicast a VRRP ADVERTISEMENT message.
+ * Build the VRRP ADVERTISEMENT message for this router, or reuse the last one
+ * if none of its fields changed.
+ *
+ * r
+ *    VRRP Router for which to build ADVERTISEMENT
+ *
+ * Returns:
+ *    the size of r->adver_pkt
+ */
+static ssize_t vrrp_adver_build(struct vrrp_router *r)
+{
+	struct ipaddr *addrs[r->addrs->count];
+
+	if (r->adver_pkt && r->adver_version == r->vr->version
+	    && r->adver_priority == r->priority
+	    && r->adver_interval == r->vr->advertisement_interval
+	    && !memcmp(&r->adver_src, &r->src, sizeof(r->src)))
+		return r->adver_pktsz;
+
+	vrrp_adver_invalidate(r);
+
+	list_to_array(r->addrs, (void **)addrs, r->addrs->count);
+
+	r->adver_pktsz = vrrp_pkt_adver_build(
+		&r->adver_pkt, &r->src, r->vr->version, r->vr->vrid,
+		r->priority, r->vr->advertisement_interval, r->addrs->count,
+		(struct ipaddr **)&addrs);
+	r->adver_src = r->src;
+	r->adver_version = r->vr->version;
+	r->adver_priority = r->priority;
+	r->adver_interval = r->vr->advertisement_interval;
+
+	return r->adver_pktsz;
+}
+
+void vrrp_adver_invalidate(struct vrrp_router *r)
+{
+	if (r->adver_pkt)
+		vrrp_pkt_free(r->adver_pkt);
+	r->adver_pkt = NULL;
+	r->adver_pktsz = 0;
+}
+
+/*
+ * Multicast a VRRP ADVERTISEMENT message.
  *
  * r
  *    VRRP Router for which to send ADVERTISEMENT
  */
 static void vrrp_send_advertisement(struct vrrp_router *r)
 {
-	struct vrrp_pkt *pkt;
+	static union sockunion dest4, dest6;
 	ssize_t pktsz;
-	struct ipaddr *addrs[r->addrs->count];
-	union sockunion dest;
+	union sockunion *dest;
 
 	if (r->src.ipa_type == IPADDR_NONE
 	    && vrrp_bind_to_primary_connected(r) < 0)
 		return;
 
-	list_to_array(r->addrs, (void **)addrs, r->addrs->count);
-
-	pktsz = vrrp_pkt_adver_build(&pkt, &r->src, r->vr->version, r->vr->vrid,
-				     r->priority, r->vr->advertisement_interval,
-				     r->addrs->count, (struct ipaddr **)&addrs);
+	pktsz = vrrp_adver_build(r);
 
 	if (DEBUG_MODE_CHECK(&vrrp_dbg_pkt, DEBUG_MODE_ALL))
-		zlog_hexdump(pkt, (size_t)pktsz);
-
-	const char *group = r->family == AF_INET ? VRRP_MCASTV4_GROUP_STR
-						 : VRRP_MCASTV6_GROUP_STR;
-	(void)str2sockunion(group, &dest);
+		zlog_hexdump(r->adver_pkt, (size_t)pktsz);
 
-	ssize_t sent = sendto(r->sock_tx, pkt, (size_t)pktsz, 0, &dest.sa,
-			      sockunion_sizeof(&dest));
+	if (sockunion_family(&dest4) == AF_UNSPEC) {
+		(void)str2sockunion(VRRP_MCASTV4_GROUP_STR, &dest4);
+		(void)str2sockunion(VRRP_MCASTV6_GROUP_STR, &dest6);
+	}
+	dest = r->family == AF_INET ? &dest4 : &dest6;
 
-	vrrp_pkt_free(pkt);
+	ssize_t sent = sendto(r->sock_tx, r->adver_pkt, (size_t)pktsz, 0,
+			      &dest->sa, sockunion_sizeof(dest));
 
 	if (sent < 0) {
 		zlog_warn(VRRP_LOGPFX VRRP_LOGPFX_VRID VRRP_LOGPFX_FAM
@@ -813,6 +855,42 @@ static void vrrp_send_advertisement(struct vrrp_router *r)
 	}
 }
 
+/*
+ * Arm the Master_Down_Timer.
+ *
+ * Backups restart this timer on every ADVERTISEMENT they receive. With
+ * thousands of Virtual Routers that is a lot of timer churn, so only the
+ * deadline is moved when a timer expiring no later than the new deadline is
+ * already running; vrrp_master_down_timer_expire() rearms it for the
+ * remaining time.
+ *
+ * r
+ *    VRRP Router to arm the timer for
+ *
+ * msec
+ *    Time until the timer expires, in milliseconds
+ */
+static void vrrp_master_down_timer_set(struct vrrp_router *r,
+				       unsigned long msec)
+{
+	struct timeval interval = {
+		.tv_sec = msec / 1000,
+		.tv_usec = (msec % 1000) * 1000,
+	};
+	struct timeval now;
+
+	monotime(&now);
+	timeradd(&now, &interval, &r->master_down_deadline);
+
+	if (r->t_master_down_timer
+	    && thread_timer_remain_msec(r->t_master_down_timer) <= msec)
+		return;
+
+	THREAD_OFF(r->t_master_down_timer);
+	thread_add_timer_msec(master, vrrp_master_down_timer_expire, r, msec,
+			      &r->t_master_down_timer);
+}
+
 /*
  * Receive and parse VRRP advertisement.
  *
@@ -926,11 +1004,8 @@ static int vrrp_recv_advertisement(struct vrrp_router *r, struct ipaddr *src,
 					htons(pkt->hdr.v3.adver_int);
 			}
 			vrrp_recalculate_timers(r);
-			THREAD_OFF(r->t_master_down_timer);
-			thread_add_timer_msec(master,
-					      vrrp_master_down_timer_expire, r,
-					      r->master_down_interval * CS2MS,
-					      &r->t_master_down_timer);
+			vrrp_master_down_timer_set(
+				r, r->master_down_interval * CS2MS);
 			vrrp_change_state(r, VRRP_STATE_BACKUP);
 		} else {
 			/* Discard advertisement */
@@ -943,10 +1018,7 @@ static int vrrp_recv_advertisement(struct vrrp_router *r, struct ipaddr *src,
 		break;
 	case VRRP_STATE_BACKUP:
 		if (pkt->hdr.priority == 0) {
-			THREAD_OFF(r->t_master_down_timer);
-			thread_add_timer_msec(
-				master, vrrp_master_down_timer_expire, r,
-				r->skew_time * CS2MS, &r->t_master_down_timer);
+			vrrp_master_down_timer_set(r, r->skew_time * CS2MS);
 		} else if (!r->vr->preempt_mode
 			   || pkt->hdr.priority >= r->priority) {
 			if (r->vr->version == 3) {
@@ -954,11 +1026,8 @@ static int vrrp_recv_advertisement(struct vrrp_router *r, struct ipaddr *src,
 					ntohs(pkt->hdr.v3.adver_int);
 			}
 			vrrp_recalculate_timers(r);
-			THREAD_OFF(r->t_master_down_timer);
-			thread_add_timer_msec(master,
-					      vrrp_master_down_timer_expire, r,
-					      r->master_down_interval * CS2MS,
-					      &r->t_master_down_timer);
+			vrrp_master_down_timer_set(
+				r, r->master_down_interval * CS2MS);
 		} else if (r->vr->preempt_mode
 			   && pkt->hdr.priority < r->priority) {
 			/* Discard advertisement */
@@ -1513,6 +1582,16 @@ static int vrrp_adver_timer_expire(struct thread *thread)
 static int vrrp_master_down_timer_expire(struct thread *thread)
 {
 	struct vrrp_router *r = thread->arg;
+	struct timeval now, remain;
+
+	/* The deadline was pushed back since the timer was armed */
+	monotime(&now);
+	if (timercmp(&now, &r->master_down_deadline, <)) {
+		timersub(&r->master_down_deadline, &now, &remain);
+		thread_add_timer_tv(master, vrrp_master_down_timer_expire, r,
+				    &remain, &r->t_master_down_timer);
+		return 0;
+	}
 
 	zlog_info(VRRP_LOGPFX VRRP_LOGPFX_VRID VRRP_LOGPFX_FAM
 		  "Master_Down_Timer expired",
@@ -1601,9 +1680,7 @@ static int vrrp_startup(struct vrrp_router *r)
 	} else {
 		r->master_adver_interval = r->vr->advertisement_interval;
 		vrrp_recalculate_timers(r);
-		thread_add_timer_msec(master, vrrp_master_down_timer_expire, r,
-				      r->master_down_interval * CS2MS,
-				      &r->t_master_down_timer);
+		vrrp_master_down_timer_set(r, r->master_down_interval * CS2MS);
 		vrrp_change_state(r, VRRP_STATE_BACKUP);
 	}
 
@@ -84,6 +84,8 @@ extern struct zebra_privs_t vrrp_privs;
 /* Global hash of all Virtual Routers */
 extern struct hash *vrrp_vrouters_hash;
 
+struct vrrp_pkt;
+
 /*
  * VRRP Router.
  *
@@ -204,6 +206,24 @@ struct vrrp_router {
 		uint32_t trans_cnt;
 	} stats;
 
+	/*
+	 * Last ADVERTISEMENT built, sent again as long as the fields it was
+	 * built from do not change.
+	 */
+	struct vrrp_pkt *adver_pkt;
+	ssize_t adver_pktsz;
+	struct ipaddr adver_src;
+	uint8_t adver_version;
+	uint8_t adver_priority;
+	uint16_t adver_interval;
+
+	/*
+	 * When the Master_Down_Timer really expires. Receiving an
+	 * ADVERTISEMENT only pushes this back, the timer is rearmed for the
+	 * remaining time when it fires early.
+	 */
+	struct timeval master_down_deadline;
+
 	struct thread *t_master_down_timer;
 	struct thread *t_adver_timer;
 	struct thread *t_read;
@@ -344,6 +364,15 @@ void vrrp_set_priority(struct vrrp_vrouter *vr, uint8_t priority);
 void vrrp_set_advertisement_interval(struct vrrp_vrouter *vr,
 				     uint16_t advertisement_interval);
 
+/*
+ * Drop the cached ADVERTISEMENT of a VRRP Router, so that the next one sent is
+ * built from scratch.
+ *
+ * r
+ *    VRRP Router whose ADVERTISEMENT changed
+ */
+void vrrp_adver_invalidate(struct vrrp_router *r);
+
 /*
  * Add an IPvX address to a VRRP Virtual Router.
  *
@@ -30,6 +30,7 @@
 #include <readline/history.h>
 
 #include <dirent.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -47,8 +48,16 @@
 #include "frrstr.h"
 #include "json.h"
 #include "ferr.h"
+#include "northbound_snapshot.h"
 
 DEFINE_MTYPE_STATIC(MVTYSH, VTYSH_CMD, "Vtysh cmd copy")
+DEFINE_MTYPE_STATIC(MVTYSH, VTYSH_RXBUF, "Vtysh receive buffer")
+
+/* Initial size of the per-daemon receive buffers */
+#define VTYSH_RXBUF_SIZE 65536
+
+/* Maximum number of instances of a multi-instance daemon */
+#define MAXIMUM_INSTANCES 10
 
 /* Struct VTY. */
 struct vty *vty;
@@ -63,6 +72,11 @@ struct vtysh_client {
 	int flag;
 	char path[MAXPATHLEN];
 	struct vtysh_client *next;
+
+	/* Receive buffer, kept across commands. */
+	char *rxbuf;
+	size_t rxbufsz;
+	size_t rxlen;
 };
 
 /* Some utility functions for working on vtysh-specific vty tasks */
@@ -174,6 +188,152 @@ static void vclient_close(struct vtysh_client *vclient)
 	}
 }
 
+/* Send a CLI command to a client, reconnecting if needed. */
+static int vtysh_client_send(struct vtysh_client *vclient, const char *line)
+{
+	int ret;
+
+	/* vclinet was previously active, try to reconnect */
+	if (vclient->fd == VTYSH_WAS_ACTIVE) {
+		ret = vtysh_reconnect(vclient);
+		if (ret < 0)
+			return -1;
+	}
+
+	if (vclient->fd < 0)
+		return 0;
+
+	ret = write(vclient->fd, line, strlen(line) + 1);
+	if (ret <= 0) {
+		/* close connection and try to reconnect */
+		vclient_close(vclient);
+		ret = vtysh_reconnect(vclient);
+		if (ret < 0)
+			return -1;
+		/* retry line */
+		ret = write(vclient->fd, line, strlen(line) + 1);
+		if (ret <= 0)
+			return -1;
+	}
+
+	vclient->rxlen = 0;
+	return 0;
+}
+
+/*
+ * Read whatever a client has sent so far into its receive buffer, which is
+ * kept across commands and grows as needed.
+ */
+static int vclient_read(struct vtysh_client *vclient)
+{
+	ssize_t nread;
+
+	/* Keep room for one more read plus a null terminator. */
+	if (vclient->rxbufsz - vclient->rxlen < 2) {
+		vclient->rxbufsz = vclient->rxbufsz ? vclient->rxbufsz * 2
+						    : VTYSH_RXBUF_SIZE;
+		vclient->rxbuf = XREALLOC(MTYPE_VTYSH_RXBUF, vclient->rxbuf,
+					  vclient->rxbufsz);
+	}
+
+	nread = read(vclient->fd, vclient->rxbuf + vclient->rxlen,
+		     vclient->rxbufsz - vclient->rxlen - 1);
+	if (nread < 0 && (errno == EINTR || errno == EAGAIN))
+		return 0;
+
+	if (nread <= 0) {
+		if (vty->of)
+			vty_out(vty, "vtysh: error reading from %s: %s (%d)",
+				vclient->name, safe_strerror(errno), errno);
+		return -1;
+	}
+
+	vclient->rxlen += nread;
+
+	/* Null terminate so we may pass this to *printf later. */
+	vclient->rxbuf[vclient->rxlen] = '\0';
+
+	return 0;
+}
+
+/* Check if the whole reply, terminator included, was received. */
+static bool vclient_reply_complete(const struct vtysh_client *vclient)
+{
+	const char *end;
+
+	/*
+	 * We expect string output from daemons, so the first null byte is
+	 * the start of the 3 null bytes + return code terminator.
+	 */
+	end = memchr(vclient->rxbuf, '\0', vclient->rxlen);
+	return end && vclient->rxbuf + vclient->rxlen - end >= 4;
+}
+
+/*
+ * Consume the output received so far from a client: it's printed to vty->of
+ * and, if there's a callback, fed to it line by line.
+ *
+ * Returns true once the whole reply was consumed, with the return code of the
+ * command in 'ret'.
+ */
+static bool vclient_process(struct vtysh_client *vclient,
+			    void (*callback)(void *, const char *),
+			    void *cbarg, int *ret)
+{
+	char terminator[3] = {0, 0, 0};
+	char *buf = vclient->rxbuf;
+	char *bufvalid = buf + vclient->rxlen;
+	char *pos = buf;
+	char *end, *limit;
+
+	if (!vclient->rxlen)
+		return false;
+
+	end = memchr(buf, '\0', vclient->rxlen);
+	limit = end ? end : bufvalid;
+
+	if (callback) {
+		while (pos < limit) {
+			char *eol = memchr(pos, '\n', limit - pos);
+
+			if (!eol) {
+				/* Partial line, wait for the rest. */
+				if (!end)
+					break;
+				/* no nl, end of input, but some text left */
+				eol = limit;
+			}
+			*eol = '\0';
+
+			if (vty->of)
+				vty_out(vty, "%s\n", pos);
+
+			callback(cbarg, pos);
+
+			pos = (eol == limit) ? limit : eol + 1;
+		}
+	} else if (limit > pos) {
+		/* else if no callback, dump raw */
+		if (vty->of)
+			vty_out(vty, "%s", pos);
+		pos = limit;
+	}
+
+	/* shift back data */
+	memmove(buf, pos, bufvalid - pos);
+	vclient->rxlen -= pos - buf;
+
+	/* if we have the terminator, we're done */
+	if (end && vclient->rxlen >= 4) {
+		assert(!memcmp(buf, terminator, 3));
+		*ret = buf[3];
+		vclient->rxlen = 0;
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * Send a CLI command to a client and read the response.
  *
@@ -200,168 +360,131 @@ static int vtysh_client_run(struct vtysh_client *vclient, const char *line,
 			    void (*callback)(void *, const char *), void *cbarg)
 {
 	int ret;
-	char stackbuf[4096];
-	char *buf = stackbuf;
-	size_t bufsz = sizeof(stackbuf);
-	char *bufvalid, *end = NULL;
-	char terminator[3] = {0, 0, 0};
 
-	/* vclinet was previously active, try to reconnect */
-	if (vclient->fd == VTYSH_WAS_ACTIVE) {
-		ret = vtysh_reconnect(vclient);
-		if (ret < 0)
-			goto out_err;
-	}
+	if (vtysh_client_send(vclient, line) < 0)
+		goto out_err;
 
 	if (vclient->fd < 0)
 		return CMD_SUCCESS;
 
-	ret = write(vclient->fd, line, strlen(line) + 1);
-	if (ret <= 0) {
-		/* close connection and try to reconnect */
-		vclient_close(vclient);
-		ret = vtysh_reconnect(vclient);
-		if (ret < 0)
-			goto out_err;
-		/* retry line */
-		ret = write(vclient->fd, line, strlen(line) + 1);
-		if (ret <= 0)
-			goto out_err;
-	}
-
-	bufvalid = buf;
-	do {
-		ssize_t nread =
-			read(vclient->fd, bufvalid, buf + bufsz - bufvalid - 1);
-
-		if (nread < 0 && (errno == EINTR || errno == EAGAIN))
-			continue;
-
-		if (nread <= 0) {
-			if (vty->of)
-				vty_out(vty,
-					"vtysh: error reading from %s: %s (%d)",
-					vclient->name, safe_strerror(errno),
-					errno);
+	while (!vclient_process(vclient, callback, cbarg, &ret))
+		if (vclient_read(vclient) < 0)
 			goto out_err;
-		}
 
-		bufvalid += nread;
-
-		/* Null terminate so we may pass this to *printf later. */
-		bufvalid[0] = '\0';
+	return ret;
 
-		/*
-		 * We expect string output from daemons, so instead of looking
-		 * for the full 3 null bytes of the terminator, we check for
-		 * just one instead and assume it is the first byte of the
-		 * terminator. The presence of the full terminator is checked
-		 * later.
-		 */
-		if (bufvalid - buf >= 4)
-			end = memmem(bufvalid - 4, 4, "\0", 1);
+out_err:
+	vclient_close(vclient);
+	return CMD_SUCCESS;
+}
 
-		/*
-		 * calculate # bytes we have, up to & not including the
-		 * terminator if present
-		 */
-		size_t textlen = (end ? end : bufvalid) - buf;
-		bool b = false;
-
-		/* feed line processing callback if present */
-		while (callback && bufvalid > buf && (end > buf || !end)) {
-			textlen = (end ? end : bufvalid) - buf;
-			char *eol = memchr(buf, '\n', textlen);
-			if (eol)
-				/* line break */
-				*eol++ = '\0';
-			else if (end == buf)
-				/*
-				 * no line break, end of input, no text left
-				 * before end; nothing to write
-				 */
-				b = true;
-			else if (end)
-				/* no nl, end of input, but some text left */
-				eol = end;
-			else if (bufvalid == buf + bufsz - 1) {
-				/*
-				 * no nl, no end of input, no buffer space;
-				 * realloc
-				 */
-				char *new;
-
-				bufsz *= 2;
-				if (buf == stackbuf) {
-					new = XMALLOC(MTYPE_TMP, bufsz);
-					memcpy(new, stackbuf, sizeof(stackbuf));
-				} else
-					new = XREALLOC(MTYPE_TMP, buf, bufsz);
-
-				bufvalid = bufvalid - buf + new;
-				buf = new;
-				/* if end != NULL, we won't be reading more
-				 * data... */
-				assert(end == NULL);
-				b = true;
-			} else
-				b = true;
-
-			if (b)
-				break;
+/*
+ * Send a CLI command to several daemons (and all their instances) at once and
+ * read the responses as they arrive.
+ *
+ * Output is kept in the order of 'heads': the reply of the first daemon that
+ * isn't done yet is printed as it comes in, the others are buffered until
+ * it's their turn. Daemons that are slow to answer thus don't hold up the
+ * others, and the total time is that of the slowest daemon rather than the
+ * sum of all of them.
+ *
+ * heads
+ *    daemons to send the command to
+ *
+ * num
+ *    number of daemons
+ *
+ * line
+ *    the command to send
+ *
+ * headline
+ *    if non-null, format string printed with the daemon name before its
+ *    output, which is then followed by an empty line
+ *
+ * callback, cbarg
+ *    see vtysh_client_run()
+ *
+ * Returns:
+ *    a status code
+ */
+static int vtysh_client_run_parallel(struct vtysh_client **heads, size_t num,
+				     const char *line, const char *headline,
+				     void (*callback)(void *, const char *),
+				     void *cbarg)
+{
+	if (num == 0)
+		return CMD_SUCCESS;
 
-			/* eol is at line end now, either \n => \0 or \0\0\0 */
-			assert(eol && eol <= bufvalid);
+	struct vtysh_client *clients[num * (MAXIMUM_INSTANCES + 1)];
+	bool first[num * (MAXIMUM_INSTANCES + 1)];
+	bool last[num * (MAXIMUM_INSTANCES + 1)];
+	struct pollfd pfds[num * (MAXIMUM_INSTANCES + 1)];
+	size_t nclients = 0, head = 0;
+	int rc_all = CMD_SUCCESS;
+
+	/* Send the command to everyone first. */
+	for (size_t i = 0; i < num; i++) {
+		for (struct vtysh_client *vc = heads[i]; vc; vc = vc->next) {
+			if (vtysh_client_send(vc, line) < 0)
+				vclient_close(vc);
+
+			clients[nclients] = vc;
+			first[nclients] = (vc == heads[i]);
+			last[nclients] = (vc->next == NULL);
+			nclients++;
+		}
+	}
 
-			if (vty->of)
-				vty_out(vty, "%s\n", buf);
+	while (head < nclients) {
+		struct vtysh_client *vc = clients[head];
+		size_t npfds = 0;
+		int rc = CMD_SUCCESS;
 
-			callback(cbarg, buf);
+		if (first[head] && headline) {
+			vty_out(vty, headline, vc->name);
+			first[head] = false;
+		}
 
-			/* shift back data and adjust bufvalid */
-			memmove(buf, eol, bufvalid - eol);
-			bufvalid -= eol - buf;
-			if (end)
-				end -= eol - buf;
+		/* Print the reply at the head of the line as it comes in. */
+		if (vc->fd < 0 || vclient_process(vc, callback, cbarg, &rc)) {
+			if (vc->fd >= 0 && rc != CMD_SUCCESS
+			    && rc != CMD_NOT_MY_INSTANCE)
+				rc_all = rc;
+			if (last[head] && headline)
+				vty_out(vty, "\n");
+			head++;
+			continue;
 		}
 
-		/* else if no callback, dump raw */
-		if (!callback) {
-			if (vty->of)
-				vty_out(vty, "%s", buf);
-			memmove(buf, buf + textlen, bufvalid - buf - textlen);
-			bufvalid -= textlen;
-			if (end)
-				end -= textlen;
-
-			/*
-			 * ----------------------------------------------------
-			 * At this point `buf` should be in one of two states:
-			 * - Empty (i.e. buf == bufvalid)
-			 * - Contains up to 4 bytes of the terminator
-			 * ----------------------------------------------------
-			 */
-			assert(((buf == bufvalid)
-				|| (bufvalid - buf <= 4 && buf[0] == 0x00)));
+		/* Wait for more data from everyone still sending some. */
+		for (size_t i = head; i < nclients; i++) {
+			if (clients[i]->fd < 0
+			    || vclient_reply_complete(clients[i]))
+				continue;
+			pfds[npfds].fd = clients[i]->fd;
+			pfds[npfds].events = POLLIN;
+			pfds[npfds].revents = 0;
+			npfds++;
 		}
+		if (npfds == 0)
+			continue;
 
-		/* if we have the terminator, break */
-		if (end && bufvalid - buf == 4) {
-			assert(!memcmp(buf, terminator, 3));
-			ret = buf[3];
+		if (poll(pfds, npfds, -1) < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
 			break;
 		}
 
-	} while (true);
-	goto out;
+		for (size_t i = head, j = 0; i < nclients && j < npfds; i++) {
+			if (clients[i]->fd != pfds[j].fd)
+				continue;
+			if (pfds[j].revents && vclient_read(clients[i]) < 0)
+				vclient_close(clients[i]);
+			j++;
+		}
+	}
 
-out_err:
-	vclient_close(vclient);
-	ret = CMD_SUCCESS;
-out:
-	if (buf != stackbuf)
-		XFREE(MTYPE_TMP, buf);
-	return ret;
+	return rc_all;
 }
 
 static int vtysh_client_run_all(struct vtysh_client *head_client,
@@ -435,26 +558,35 @@ static int vtysh_client_execute_name(const char *name, const char *line)
  * Retrieve all running config from daemons and parse it with the vtysh config
  * parser. Returned output is not displayed to the user.
  *
- * head_client
- *    where to start walking in the daemon list
+ * name
+ *    daemon to retrieve the config from, or NULL for all daemons
  *
  * line
  *    the specific command to execute
  */
-static void vtysh_client_config(struct vtysh_client *head_client, char *line)
+static void vtysh_client_config(const char *name, char *line)
 {
-	/* watchfrr currently doesn't load any config, and has some hardcoded
-	 * settings that show up in "show run".  skip it here (for now at
-	 * least) so we don't get that mangled up in config-write.
-	 */
-	if (head_client->flag == VTYSH_WATCHFRR)
-		return;
+	struct vtysh_client *heads[array_size(vtysh_client)];
+	size_t num = 0;
+
+	for (unsigned int i = 0; i < array_size(vtysh_client); i++) {
+		/* watchfrr currently doesn't load any config, and has some
+		 * hardcoded settings that show up in "show run".  skip it here
+		 * (for now at least) so we don't get that mangled up in
+		 * config-write.
+		 */
+		if (vtysh_client[i].flag == VTYSH_WATCHFRR)
+			continue;
+		if (name && !strmatch(vtysh_client[i].name, name))
+			continue;
+		heads[num++] = &vtysh_client[i];
+	}
 
 	/* suppress output to user */
 	vty->of_saved = vty->of;
 	vty->of = NULL;
-	vtysh_client_run_all(head_client, line, 1, vtysh_config_parse_line,
-			     NULL);
+	vtysh_client_run_parallel(heads, num, line, NULL,
+				  vtysh_config_parse_line, NULL);
 	vty->of = vty->of_saved;
 }
 
@@ -889,6 +1021,57 @@ int vtysh_mark_file(const char *filename)
 	return 0;
 }
 
+/* Daemons that loaded a configuration snapshot during boot. */
+static int vtysh_snapshot_mask;
+
+void vtysh_snapshot_load(FILE *fp)
+{
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
+	char buf[NB_SNAPSHOT_DIGEST_STRLEN];
+	char line[sizeof(buf) + 32];
+
+	vtysh_snapshot_mask = 0;
+	if (!nb_snapshot_digest_file(fp, digest))
+		return;
+
+	snprintf(line, sizeof(line), "snapshot_load %s",
+		 nb_snapshot_digest2str(digest, buf, sizeof(buf)));
+
+	for (unsigned int i = 0; i < array_size(vtysh_client); i++) {
+		struct vtysh_client *vc;
+		bool running = false;
+
+		for (vc = &vtysh_client[i]; vc; vc = vc->next)
+			running = running || (vc->fd > 0);
+		if (!running)
+			continue;
+
+		if (vtysh_client_execute(&vtysh_client[i], line) == CMD_SUCCESS)
+			vtysh_snapshot_mask |= vtysh_client[i].flag;
+	}
+}
+
+void vtysh_snapshot_done(void)
+{
+	vtysh_snapshot_mask = 0;
+}
+
+static void vtysh_snapshot_write(void)
+{
+	uint8_t digest[NB_SNAPSHOT_DIGEST_LEN];
+	char buf[NB_SNAPSHOT_DIGEST_STRLEN];
+	char line[sizeof(buf) + 32];
+
+	if (!nb_snapshot_digest_path(frr_config, digest))
+		return;
+
+	snprintf(line, sizeof(line), "do snapshot_write %s",
+		 nb_snapshot_digest2str(digest, buf, sizeof(buf)));
+
+	for (unsigned int i = 0; i < array_size(vtysh_client); i++)
+		vtysh_client_execute(&vtysh_client[i], line);
+}
+
 /* Configration make from file. */
 int vtysh_config_from_file(struct vty *vty, FILE *fp)
 {
@@ -934,6 +1117,8 @@ int vtysh_config_from_file(struct vty *vty, FILE *fp)
 			int cmd_stat = CMD_SUCCESS;
 
 			for (i = 0; i < array_size(vtysh_client); i++) {
+				if (vtysh_client[i].flag & vtysh_snapshot_mask)
+					continue;
 				if (cmd->daemon & vtysh_client[i].flag) {
 					cmd_stat = vtysh_client_execute(
 						&vtysh_client[i], vty->buf);
@@ -2471,16 +2656,17 @@ static char *do_prepend(struct vty *vty, struct cmd_token **argv, int argc)
 static int show_per_daemon(struct vty *vty, struct cmd_token **argv, int argc,
 			   const char *headline)
 {
-	unsigned int i;
-	int ret = CMD_SUCCESS;
+	struct vtysh_client *heads[array_size(vtysh_client)];
+	size_t num = 0;
+	int ret;
 	char *line = do_prepend(vty, argv, argc);
 
-	for (i = 0; i < array_size(vtysh_client); i++)
-		if (vtysh_client[i].fd >= 0) {
-			vty_out(vty, headline, vtysh_client[i].name);
-			ret = vtysh_client_execute(&vtysh_client[i], line);
-			vty_out(vty, "\n");
-		}
+	for (unsigned int i = 0; i < array_size(vtysh_client); i++)
+		if (vtysh_client[i].fd >= 0)
+			heads[num++] = &vtysh_client[i];
+
+	ret = vtysh_client_run_parallel(heads, num, line, headline, NULL,
+					NULL);
 
 	XFREE(MTYPE_TMP, line);
 
@@ -2510,6 +2696,16 @@ DEFUN (vtysh_show_poll,
 	return show_per_daemon(vty, argv, argc, "Thread statistics for %s:\n");
 }
 
+DEFUN (vtysh_show_thread_pthreads,
+       vtysh_show_thread_pthreads_cmd,
+       "show thread pthreads",
+       SHOW_STR
+       "Thread information\n"
+       "POSIX threads, their placement and CPU time\n")
+{
+	return show_per_daemon(vty, argv, argc, "Threads of %s:\n");
+}
+
 #ifndef EXCLUDE_CPU_TIME
 DEFUN (vtysh_show_thread,
        vtysh_show_thread_cmd,
@@ -2688,6 +2884,16 @@ DEFUN (vtysh_show_memory,
 	return show_per_daemon(vty, argv, argc, "Memory statistics for %s:\n");
 }
 
+DEFUN (vtysh_show_counters,
+       vtysh_show_counters_cmd,
+       "show counters [json]",
+       SHOW_STR
+       "Event counters\n"
+       JSON_STR)
+{
+	return show_per_daemon(vty, argv, argc, "Event counters for %s:\n");
+}
+
 DEFUN (vtysh_show_modules,
        vtysh_show_modules_cmd,
        "show modules",
@@ -2920,7 +3126,6 @@ DEFUN (vtysh_write_terminal,
        DAEMONS_STR
        "Skip \"Building configuration...\" header\n")
 {
-	unsigned int i;
 	char line[] = "do write terminal\n";
 
 	if (!strcmp(argv[argc - 1]->arg, "no-header"))
@@ -2931,10 +3136,7 @@ DEFUN (vtysh_write_terminal,
 		vty_out(vty, "!\n");
 	}
 
-	for (i = 0; i < array_size(vtysh_client); i++)
-		if ((argc < 3)
-		    || (strmatch(vtysh_client[i].name, argv[2]->text)))
-			vtysh_client_config(&vtysh_client[i], line);
+	vtysh_client_config(argc < 3 ? NULL : argv[2]->text, line);
 
 	/* Integrate vtysh specific configuration. */
 	vty_open_pager(vty);
@@ -2999,7 +3201,6 @@ static void backup_config_file(const char *fbackup)
 
 int vtysh_write_config_integrated(void)
 {
-	unsigned int i;
 	char line[] = "do write terminal\n";
 	FILE *fp;
 	int fd;
@@ -3026,8 +3227,7 @@ int vtysh_write_config_integrated(void)
 	}
 	fd = fileno(fp);
 
-	for (i = 0; i < array_size(vtysh_client); i++)
-		vtysh_client_config(&vtysh_client[i], line);
+	vtysh_client_config(NULL, line);
 
 	vtysh_config_write();
 	vty->of_saved = vty->of;
@@ -3080,6 +3280,8 @@ int vtysh_write_config_integrated(void)
 
 	fclose(fp);
 
+	vtysh_snapshot_write();
+
 	printf("Integrated configuration saved to %s\n", frr_config);
 	if (err)
 		return CMD_WARNING;
@@ -3679,8 +3881,6 @@ static void vtysh_client_sorted_insert(struct vtysh_client *head_client,
 	prev_node->next = client;
 }
 
-#define MAXIMUM_INSTANCES 10
-
 static void vtysh_update_all_instances(struct vtysh_client *head_client)
 {
 	struct vtysh_client *client;
@@ -3703,8 +3903,8 @@ static void vtysh_update_all_instances(struct vtysh_client *head_client)
 						vtydir, n);
 					break;
 				}
-				client = (struct vtysh_client *)malloc(
-					sizeof(struct vtysh_client));
+				client = (struct vtysh_client *)calloc(
+					1, sizeof(struct vtysh_client));
 				client->fd = -1;
 				client->name = "ospfd";
 				client->flag = VTYSH_OSPFD;
@@ -4274,12 +4474,14 @@ void vtysh_init_vty(void)
 	/* misc lib show commands */
 	install_element(VIEW_NODE, &vtysh_show_memory_cmd);
 	install_element(VIEW_NODE, &vtysh_show_modules_cmd);
+	install_element(VIEW_NODE, &vtysh_show_counters_cmd);
 	install_element(VIEW_NODE, &vtysh_show_work_queues_cmd);
 	install_element(VIEW_NODE, &vtysh_show_work_queues_daemon_cmd);
 #ifndef EXCLUDE_CPU_TIME
 	install_element(VIEW_NODE, &vtysh_show_thread_cmd);
 #endif
 	install_element(VIEW_NODE, &vtysh_show_poll_cmd);
+	install_element(VIEW_NODE, &vtysh_show_thread_pthreads_cmd);
 
 	/* Logging */
 	install_element(VIEW_NODE, &vtysh_show_logging_cmd);
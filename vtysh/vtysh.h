@@ -93,8 +93,15 @@ void config_add_line(struct list *, const char *);
 int vtysh_mark_file(const char *filename);
 
 int vtysh_read_config(const char *);
+int vtysh_boot_config(const char *);
 int vtysh_write_config_integrated(void);
 
+/* Have daemons load the snapshot matching the configuration file about to
+ * be read, and skip them while it's read.
+ */
+void vtysh_snapshot_load(FILE *fp);
+void vtysh_snapshot_done(void);
+
 void vtysh_config_parse_line(void *, const char *);
 
 void vtysh_config_dump(void);
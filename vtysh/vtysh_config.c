@@ -513,7 +513,7 @@ void vtysh_config_dump(void)
 }
 
 /* Read up configuration file from file_name. */
-static int vtysh_read_file(FILE *confp)
+static int vtysh_read_file(FILE *confp, bool boot)
 {
 	struct vty *vty;
 	int ret;
@@ -528,9 +528,15 @@ static int vtysh_read_file(FILE *confp)
 
 	vtysh_execute_no_pager("start_configuration");
 
+	if (boot)
+		vtysh_snapshot_load(confp);
+
 	/* Execute configuration file. */
 	ret = vtysh_config_from_file(vty, confp);
 
+	if (boot)
+		vtysh_snapshot_done();
+
 	vtysh_execute_no_pager("end_configuration");
 
 	vtysh_execute_no_pager("end");
@@ -541,8 +547,7 @@ static int vtysh_read_file(FILE *confp)
 	return (ret);
 }
 
-/* Read up configuration file from config_default_dir. */
-int vtysh_read_config(const char *config_default_dir)
+static int vtysh_read_config_file(const char *config_default_dir, bool boot)
 {
 	FILE *confp = NULL;
 	int ret;
@@ -555,12 +560,27 @@ int vtysh_read_config(const char *config_default_dir)
 		return CMD_ERR_NO_FILE;
 	}
 
-	ret = vtysh_read_file(confp);
+	ret = vtysh_read_file(confp, boot);
 	fclose(confp);
 
 	return (ret);
 }
 
+/* Read up configuration file from config_default_dir. */
+int vtysh_read_config(const char *config_default_dir)
+{
+	return vtysh_read_config_file(config_default_dir, false);
+}
+
+/*
+ * Same, at boot: daemons that can load a configuration snapshot matching
+ * the file don't get sent its contents.
+ */
+int vtysh_boot_config(const char *config_default_dir)
+{
+	return vtysh_read_config_file(config_default_dir, true);
+}
+
 /* We don't write vtysh specific into file from vtysh. vtysh.conf should
  * be edited by hand. So, we handle only "write terminal" case here and
  * integrate vtysh specific conf with conf from daemons.
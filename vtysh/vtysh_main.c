@@ -669,7 +669,7 @@ int main(int argc, char **argv, char **env)
 	/* Boot startup configuration file. */
 	if (boot_flag) {
 		vtysh_flock_config(frr_config);
-		ret = vtysh_read_config(frr_config);
+		ret = vtysh_boot_config(frr_config);
 		vtysh_unflock_config();
 		if (ret) {
 			fprintf(stderr,
@@ -30,6 +30,7 @@
 #include "zlog_targets.h"
 #include "network.h"
 #include "printfrr.h"
+#include "heartbeat.h"
 
 #include <getopt.h>
 #include <sys/un.h>
@@ -55,6 +56,12 @@
 #define DEFAULT_MIN_RESTART	60
 #define DEFAULT_MAX_RESTART	600
 
+/*
+ * A daemon whose heartbeat shows its event loop is still making progress
+ * is busy rather than hung, and gets this many times the timeout to answer.
+ */
+#define BUSY_TIMEOUT_FACTOR	4
+
 #define DEFAULT_RESTART_CMD	WATCHFRR_SH_PATH " restart %s"
 #define DEFAULT_START_CMD	WATCHFRR_SH_PATH " start %s"
 #define DEFAULT_STOP_CMD	WATCHFRR_SH_PATH " stop %s"
@@ -156,6 +163,9 @@ struct daemon {
 	int fd;
 	struct timeval echo_sent;
 	unsigned int connect_tries;
+	/* shared heartbeat page, see lib/heartbeat.h */
+	struct frr_heartbeat *hb;
+	uint64_t hb_calls;
 	struct thread *t_wakeup;
 	struct thread *t_read;
 	struct thread *t_write;
@@ -591,6 +601,31 @@ static void restart_done(struct daemon *dmn)
 		SET_WAKEUP_DOWN(dmn);
 }
 
+/*
+ * Get a consistent copy of the daemon's heartbeat, mapping it on first
+ * use.  A page left behind by a daemon that is gone is ignored.
+ */
+static bool daemon_heartbeat(struct daemon *dmn, struct frr_heartbeat *hb)
+{
+	char path[512];
+
+	if (!dmn->hb) {
+		snprintf(path, sizeof(path), "%s/%s.hb", gs.vtydir, dmn->name);
+		dmn->hb = frr_heartbeat_map(path);
+		if (!dmn->hb)
+			return false;
+	}
+
+	if (!frr_heartbeat_snapshot(dmn->hb, hb))
+		return false;
+
+	if (kill((pid_t)hb->pid, 0) < 0 && errno == ESRCH) {
+		frr_heartbeat_unmap(&dmn->hb);
+		return false;
+	}
+	return true;
+}
+
 static void daemon_down(struct daemon *dmn, const char *why)
 {
 	if (IS_UP(dmn) || (dmn->state == DAEMON_INIT))
@@ -608,6 +643,7 @@ static void daemon_down(struct daemon *dmn, const char *why)
 	THREAD_OFF(dmn->t_read);
 	THREAD_OFF(dmn->t_write);
 	THREAD_OFF(dmn->t_wakeup);
+	frr_heartbeat_unmap(&dmn->hb);
 	if (try_connect(dmn) < 0)
 		SET_WAKEUP_DOWN(dmn);
 	phase_check();
@@ -994,17 +1030,61 @@ static int wakeup_unresponsive(struct thread *t_wakeup)
 	return 0;
 }
 
+/*
+ * Runs every period while an echo is outstanding.  The heartbeat tells a
+ * daemon stuck in one callback (unresponsive once that callback has run
+ * for the timeout, however recently the echo went out) from one that is
+ * busy but still going around its event loop (given BUSY_TIMEOUT_FACTOR
+ * times the timeout to answer).  Without a heartbeat, only the echo counts.
+ */
 static int wakeup_no_answer(struct thread *t_wakeup)
 {
 	struct daemon *dmn = THREAD_ARG(t_wakeup);
+	struct frr_heartbeat hb;
+	struct timeval delay;
+	long timeout = gs.timeout;
+	uint64_t stalled;
 
 	dmn->t_wakeup = NULL;
+
+	if (daemon_heartbeat(dmn, &hb)) {
+		stalled = hb.call_us ? frr_heartbeat_now() - hb.call_us : 0;
+
+		if (stalled >= (uint64_t)gs.timeout * 1000000) {
+			dmn->state = DAEMON_UNRESPONSIVE;
+			if (dmn->ignore_timeout)
+				return 0;
+			flog_err(EC_WATCHFRR_CONNECTION,
+				 "%s state -> unresponsive : stuck in %s (scheduled from %s:%u) for %" PRIu64
+				 " seconds",
+				 dmn->name, hb.funcname, hb.schedfrom,
+				 hb.schedfrom_line, stalled / 1000000);
+			SET_WAKEUP_UNRESPONSIVE(dmn);
+			try_restart(dmn);
+			return 0;
+		}
+
+		if (hb.calls != dmn->hb_calls) {
+			dmn->hb_calls = hb.calls;
+			timeout *= BUSY_TIMEOUT_FACTOR;
+		}
+	}
+
+	time_elapsed(&delay, &dmn->echo_sent);
+	if (delay.tv_sec < timeout) {
+		thread_add_timer_msec(master, wakeup_no_answer, dmn,
+				      MIN(gs.period,
+					  (timeout - delay.tv_sec) * 1000),
+				      &dmn->t_wakeup);
+		return 0;
+	}
+
 	dmn->state = DAEMON_UNRESPONSIVE;
 	if (dmn->ignore_timeout)
 		return 0;
 	flog_err(EC_WATCHFRR_CONNECTION,
 		 "%s state -> unresponsive : no response yet to ping sent %ld seconds ago",
-		 dmn->name, gs.timeout);
+		 dmn->name, (long)delay.tv_sec);
 	SET_WAKEUP_UNRESPONSIVE(dmn);
 	try_restart(dmn);
 	return 0;
@@ -1015,6 +1095,7 @@ static int wakeup_send_echo(struct thread *t_wakeup)
 	static const char echocmd[] = "echo " PING_TOKEN;
 	ssize_t rc;
 	struct daemon *dmn = THREAD_ARG(t_wakeup);
+	struct frr_heartbeat hb;
 
 	dmn->t_wakeup = NULL;
 	if (((rc = write(dmn->fd, echocmd, sizeof(echocmd))) < 0)
@@ -1026,9 +1107,12 @@ static int wakeup_send_echo(struct thread *t_wakeup)
 		daemon_down(dmn, why);
 	} else {
 		gettimeofday(&dmn->echo_sent, NULL);
+		if (daemon_heartbeat(dmn, &hb))
+			dmn->hb_calls = hb.calls;
 		dmn->t_wakeup = NULL;
-		thread_add_timer(master, wakeup_no_answer, dmn, gs.timeout,
-				 &dmn->t_wakeup);
+		thread_add_timer_msec(master, wakeup_no_answer, dmn,
+				      MIN(gs.period, gs.timeout * 1000),
+				      &dmn->t_wakeup);
 	}
 	return 0;
 }
@@ -1047,6 +1131,7 @@ void watchfrr_status(struct vty *vty)
 {
 	struct daemon *dmn;
 	struct timeval delay;
+	struct frr_heartbeat hb;
 
 	vty_out(vty, "watchfrr global phase: %s\n", phase_str[gs.phase]);
 	if (gs.restart.pid)
@@ -1066,6 +1151,18 @@ void watchfrr_status(struct vty *vty)
 				(intmax_t)dmn->restart.interval
 					- (intmax_t)delay.tv_sec,
 				(intmax_t)dmn->restart.interval);
+
+		if (!IS_UP(dmn) || !daemon_heartbeat(dmn, &hb))
+			continue;
+		if (hb.call_us)
+			vty_out(vty, "      running %s (scheduled from %s:%u) for %" PRIu64 " ms\n",
+				hb.funcname, hb.schedfrom, hb.schedfrom_line,
+				(frr_heartbeat_now() - hb.call_us) / 1000);
+		else
+			vty_out(vty, "      idle, last ran %s %" PRIu64 " ms ago (%" PRIu64 " callbacks)\n",
+				hb.funcname,
+				(frr_heartbeat_now() - hb.loop_us) / 1000,
+				hb.calls);
 	}
 }
 
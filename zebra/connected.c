@@ -84,6 +84,7 @@ static void connected_announce(struct interface *ifp, struct connected *ifc)
 	}
 
 	listnode_add(ifp->connected, ifc);
+	if_addr_index_invalidate();
 
 	/* Update interface address information to protocol daemon. */
 	if (ifc->address->family == AF_INET)
@@ -67,6 +67,26 @@
  */
 #define FPM_HEADER_SIZE 4
 
+/*
+ * RIB replay after a (re)connection is done in slices of
+ * FPM_REPLAY_SLICE_MSEC on the main pthread, sending at most
+ * FPM_REPLAY_SLICE_MAX routes per slice when no rate is configured.
+ */
+#define FPM_REPLAY_SLICE_MSEC 100
+#define FPM_REPLAY_SLICE_MAX 10000
+
+/*
+ * Resumable RIB replay position: the table being walked and where in it.
+ * While 'retry' is set the walk stopped on a full buffer and iter still
+ * holds (and locks) the node to send first on the next slice.
+ */
+struct fpm_rib_walk {
+	rib_tables_iter_t tables;
+	struct route_table *table;
+	route_table_iter_t iter;
+	bool retry;
+};
+
 static const char *prov_name = "dplane_fpm_nl";
 
 struct fpm_nl_ctx {
@@ -80,6 +100,10 @@ struct fpm_nl_ctx {
 	bool use_nhg;
 	struct sockaddr_storage addr;
 
+	/* RIB replay: routes per second (0 for unlimited) and position. */
+	uint32_t replay_rate;
+	struct fpm_rib_walk ribwalk;
+
 	/* data plane buffers. */
 	struct stream *ibuf;
 	struct stream *obuf;
@@ -140,6 +164,9 @@ struct fpm_nl_ctx {
 
 		/* Amount of buffer full events. */
 		_Atomic uint32_t buffer_full;
+
+		/* Amount of routes sent by RIB replays. */
+		_Atomic uint32_t replay_routes;
 	} counters;
 } *gfnc;
 
@@ -313,6 +340,27 @@ DEFUN(no_fpm_use_nhg, no_fpm_use_nhg_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(fpm_replay_rate, fpm_replay_rate_cmd,
+      "fpm replay-rate (1-10000000)",
+      FPM_STR
+      "Rate at which the RIB is sent after a connection\n"
+      "Routes per second\n")
+{
+	gfnc->replay_rate = strtoul(argv[2]->arg, NULL, 10);
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_replay_rate, no_fpm_replay_rate_cmd,
+      "no fpm replay-rate [(1-10000000)]",
+      NO_STR
+      FPM_STR
+      "Rate at which the RIB is sent after a connection\n"
+      "Routes per second\n")
+{
+	gfnc->replay_rate = 0;
+	return CMD_SUCCESS;
+}
+
 DEFUN(fpm_reset_counters, fpm_reset_counters_cmd,
       "clear fpm counters",
       CLEAR_STR
@@ -339,6 +387,7 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
 	SHOW_COUNTER("Output bytes", gfnc->counters.bytes_sent);
 	SHOW_COUNTER("Output buffer current size", gfnc->counters.obuf_bytes);
 	SHOW_COUNTER("Output buffer peak size", gfnc->counters.obuf_peak);
+	SHOW_COUNTER("RIB replayed routes", gfnc->counters.replay_routes);
 	SHOW_COUNTER("Connection closes", gfnc->counters.connection_closes);
 	SHOW_COUNTER("Connection errors", gfnc->counters.connection_errors);
 	SHOW_COUNTER("Data plane items processed",
@@ -370,6 +419,8 @@ DEFUN(fpm_show_counters_json, fpm_show_counters_json_cmd,
 	json_object_int_add(jo, "bytes-sent", gfnc->counters.bytes_sent);
 	json_object_int_add(jo, "obuf-bytes", gfnc->counters.obuf_bytes);
 	json_object_int_add(jo, "obuf-bytes-peak", gfnc->counters.obuf_peak);
+	json_object_int_add(jo, "rib-replay-routes",
+			    gfnc->counters.replay_routes);
 	json_object_int_add(jo, "connection-closes",
 			    gfnc->counters.connection_closes);
 	json_object_int_add(jo, "connection-errors",
@@ -431,6 +482,11 @@ static int fpm_write_config(struct vty *vty)
 		written = 1;
 	}
 
+	if (gfnc->replay_rate) {
+		vty_out(vty, "fpm replay-rate %u\n", gfnc->replay_rate);
+		written = 1;
+	}
+
 	return written;
 }
 
@@ -698,8 +754,9 @@ static int fpm_connect(struct thread *t)
  */
 static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 {
-	uint8_t nl_buf[NL_PKT_BUF_SIZE];
+	uint8_t *nl_buf;
 	size_t nl_buf_len;
+	const size_t nl_buf_size = NL_PKT_BUF_SIZE;
 	ssize_t rv;
 	uint64_t obytes, obytes_peak;
 	enum dplane_op_e op = dplane_ctx_get_op(ctx);
@@ -717,11 +774,30 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
 
+	/*
+	 * Messages are encoded straight into the output buffer, leaving room
+	 * for the FPM header in front.  A message (or a delete/install pair)
+	 * never takes more than NL_PKT_BUF_SIZE, so require that much space.
+	 */
+	if (STREAM_WRITEABLE(fnc->obuf) < (nl_buf_size + FPM_HEADER_SIZE)) {
+		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
+					  memory_order_relaxed);
+
+		if (IS_ZEBRA_DEBUG_FPM)
+			zlog_debug("%s: buffer full: has %zu", __func__,
+				   STREAM_WRITEABLE(fnc->obuf));
+
+		return -1;
+	}
+
+	nl_buf = STREAM_DATA(fnc->obuf) + stream_get_endp(fnc->obuf)
+		 + FPM_HEADER_SIZE;
+
 	switch (op) {
 	case DPLANE_OP_ROUTE_UPDATE:
 	case DPLANE_OP_ROUTE_DELETE:
 		rv = netlink_route_multipath_msg_encode(RTM_DELROUTE, ctx,
-							nl_buf, sizeof(nl_buf),
+							nl_buf, nl_buf_size,
 							true, fnc->use_nhg);
 		if (rv <= 0) {
 			zlog_err(
@@ -740,7 +816,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_ROUTE_INSTALL:
 		rv = netlink_route_multipath_msg_encode(
 			RTM_NEWROUTE, ctx, &nl_buf[nl_buf_len],
-			sizeof(nl_buf) - nl_buf_len, true, fnc->use_nhg);
+			nl_buf_size - nl_buf_len, true, fnc->use_nhg);
 		if (rv <= 0) {
 			zlog_err(
 				"%s: netlink_route_multipath_msg_encode failed",
@@ -753,7 +829,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_MAC_INSTALL:
 	case DPLANE_OP_MAC_DELETE:
-		rv = netlink_macfdb_update_ctx(ctx, nl_buf, sizeof(nl_buf));
+		rv = netlink_macfdb_update_ctx(ctx, nl_buf, nl_buf_size);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_macfdb_update_ctx failed",
 				 __func__);
@@ -765,7 +841,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_NH_DELETE:
 		rv = netlink_nexthop_msg_encode(RTM_DELNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf));
+						nl_buf_size);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -777,7 +853,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NH_INSTALL:
 	case DPLANE_OP_NH_UPDATE:
 		rv = netlink_nexthop_msg_encode(RTM_NEWNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf));
+						nl_buf_size);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -821,20 +897,6 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	/* We must know if someday a message goes beyond 65KiB. */
 	assert((nl_buf_len + FPM_HEADER_SIZE) <= UINT16_MAX);
 
-	/* Check if we have enough buffer space. */
-	if (STREAM_WRITEABLE(fnc->obuf) < (nl_buf_len + FPM_HEADER_SIZE)) {
-		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
-					  memory_order_relaxed);
-
-		if (IS_ZEBRA_DEBUG_FPM)
-			zlog_debug(
-				"%s: buffer full: wants to write %zu but has %zu",
-				__func__, nl_buf_len + FPM_HEADER_SIZE,
-				STREAM_WRITEABLE(fnc->obuf));
-
-		return -1;
-	}
-
 	/*
 	 * Fill in the FPM header information.
 	 *
@@ -844,8 +906,8 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	stream_putc(fnc->obuf, 1);
 	stream_putw(fnc->obuf, nl_buf_len + FPM_HEADER_SIZE);
 
-	/* Write current data. */
-	stream_write(fnc->obuf, nl_buf, (size_t)nl_buf_len);
+	/* The message itself was encoded in place. */
+	stream_forward_endp(fnc->obuf, nl_buf_len);
 
 	/* Account number of bytes waiting to be written. */
 	atomic_fetch_add_explicit(&fnc->counters.obuf_bytes,
@@ -926,51 +988,172 @@ static int fpm_nhg_send(struct thread *t)
 	return 0;
 }
 
+/*
+ * Return the table the RIB replay is on, moving to the next one when the
+ * current table is done or has gone away since the last slice.
+ */
+static struct route_table *fpm_rib_walk_table(struct fpm_rib_walk *walk)
+{
+	rib_tables_iter_t tables;
+
+	if (walk->table) {
+		/* Look the table up again: its VRF may have been deleted. */
+		tables = walk->tables;
+		tables.afi_safi_ix--;
+		if (rib_tables_iter_next(&tables) != walk->table
+		    || tables.vrf_id != walk->tables.vrf_id
+		    || tables.afi_safi_ix != walk->tables.afi_safi_ix) {
+			/* Its nodes are gone, don't touch them. */
+			walk->iter.current = NULL;
+			walk->iter.state = RT_ITER_STATE_DONE;
+			walk->retry = false;
+		}
+
+		if (!route_table_iter_is_done(&walk->iter))
+			return walk->table;
+
+		walk->table = NULL;
+	}
+
+	walk->table = rib_tables_iter_next(&walk->tables);
+	if (walk->table)
+		route_table_iter_init(&walk->iter, walk->table);
+
+	return walk->table;
+}
+
+static void fpm_rib_walk_reset(struct fpm_rib_walk *walk)
+{
+	/* Release the node held by the iterator, if its table is alive. */
+	if (fpm_rib_walk_table(walk))
+		route_table_iter_cleanup(&walk->iter);
+
+	memset(walk, 0, sizeof(*walk));
+	rib_tables_iter_init(&walk->tables);
+}
+
+/* Send one route node, false if the output buffer is full. */
+static bool fpm_rib_send_node(struct fpm_nl_ctx *fnc,
+			      struct zebra_dplane_ctx *ctx,
+			      struct route_node *rn, uint32_t *sent)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+
+	/* Skip bad route entries. */
+	if (dest == NULL || dest->selected_fib == NULL)
+		return true;
+
+	/* Check for already sent routes. */
+	if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
+		return true;
+
+	/* Enqueue route install. */
+	dplane_ctx_reset(ctx);
+	dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
+			      dest->selected_fib);
+	if (fpm_nl_enqueue(fnc, ctx) == -1)
+		return false;
+
+	/* Mark as sent. */
+	SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+	(*sent)++;
+
+	return true;
+}
+
+/* Send a destination node and the source-specific routes below it. */
+static bool fpm_rib_send_dst(struct fpm_nl_ctx *fnc,
+			     struct zebra_dplane_ctx *ctx,
+			     struct route_node *rn, uint32_t *sent)
+{
+	struct route_table *src_table;
+	struct route_node *srn;
+
+	if (!fpm_rib_send_node(fnc, ctx, rn, sent))
+		return false;
+
+	src_table = srcdest_srcnode_table(rn);
+	if (!src_table)
+		return true;
+
+	for (srn = route_top(src_table); srn; srn = route_next(srn)) {
+		if (!fpm_rib_send_node(fnc, ctx, srn, sent)) {
+			route_unlock_node(srn);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * Send all RIB installed routes to the connected data plane.
+ *
+ * The walk is resumable: each run sends one slice, bounded by the
+ * configured replay rate, and picks up where the previous one stopped, so
+ * a reconnecting FPM server never holds the main pthread for a full RIB
+ * walk.
  */
 static int fpm_rib_send(struct thread *t)
 {
 	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
-	rib_dest_t *dest;
+	struct fpm_rib_walk *walk = &fnc->ribwalk;
 	struct route_node *rn;
 	struct route_table *rt;
 	struct zebra_dplane_ctx *ctx;
-	rib_tables_iter_t rt_iter;
+	uint32_t budget, sent = 0;
+
+	if (fnc->replay_rate)
+		budget = MAX(fnc->replay_rate * FPM_REPLAY_SLICE_MSEC / 1000,
+			     1U);
+	else
+		budget = FPM_REPLAY_SLICE_MAX;
 
 	/* Allocate temporary context for all transactions. */
 	ctx = dplane_ctx_alloc();
 
-	rt_iter.state = RIB_TABLES_ITER_S_INIT;
-	while ((rt = rib_tables_iter_next(&rt_iter))) {
-		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
-			dest = rib_dest_from_rnode(rn);
-			/* Skip bad route entries. */
-			if (dest == NULL || dest->selected_fib == NULL)
-				continue;
+	while ((rt = fpm_rib_walk_table(walk))) {
+		if (walk->retry) {
+			rn = walk->iter.current;
+			walk->retry = false;
+		} else
+			rn = route_table_iter_next(&walk->iter);
 
-			/* Check for already sent routes. */
-			if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
-				continue;
+		if (!rn)
+			continue;
 
-			/* Enqueue route install. */
-			dplane_ctx_reset(ctx);
-			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
-					      dest->selected_fib);
-			if (fpm_nl_enqueue(fnc, ctx) == -1) {
-				/* Free the temporary allocated context. */
-				dplane_ctx_fini(&ctx);
-
-				thread_add_timer(zrouter.master, fpm_rib_send,
-						 fnc, 1, &fnc->t_ribwalk);
-				return 0;
-			}
-
-			/* Mark as sent. */
-			SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+		if (!fpm_rib_send_dst(fnc, ctx, rn, &sent)) {
+			atomic_fetch_add_explicit(&fnc->counters.replay_routes,
+						  sent, memory_order_relaxed);
+
+			/* Free the temporary allocated context. */
+			dplane_ctx_fini(&ctx);
+
+			/* Retry this node once the buffer drains. */
+			walk->retry = true;
+			thread_add_timer(zrouter.master, fpm_rib_send, fnc, 1,
+					 &fnc->t_ribwalk);
+			return 0;
+		}
+
+		if (sent >= budget) {
+			atomic_fetch_add_explicit(&fnc->counters.replay_routes,
+						  sent, memory_order_relaxed);
+			dplane_ctx_fini(&ctx);
+
+			route_table_iter_pause(&walk->iter);
+			thread_add_timer_msec(zrouter.master, fpm_rib_send, fnc,
+					      fnc->replay_rate
+						      ? FPM_REPLAY_SLICE_MSEC
+						      : 0,
+					      &fnc->t_ribwalk);
+			return 0;
 		}
 	}
 
+	atomic_fetch_add_explicit(&fnc->counters.replay_routes, sent,
+				  memory_order_relaxed);
+
 	/* Free the temporary allocated context. */
 	dplane_ctx_fini(&ctx);
 
@@ -1088,6 +1271,7 @@ static int fpm_rib_reset(struct thread *t)
 	rib_tables_iter_t rt_iter;
 
 	fnc->rib_complete = false;
+	fpm_rib_walk_reset(&fnc->ribwalk);
 
 	rt_iter.state = RIB_TABLES_ITER_S_INIT;
 	while ((rt = rib_tables_iter_next(&rt_iter))) {
@@ -1147,7 +1331,8 @@ static int fpm_process_queue(struct thread *t)
 
 	while (true) {
 		/* No space available yet. */
-		if (STREAM_WRITEABLE(fnc->obuf) < NL_PKT_BUF_SIZE)
+		if (STREAM_WRITEABLE(fnc->obuf)
+		    < NL_PKT_BUF_SIZE + FPM_HEADER_SIZE)
 			break;
 
 		/* Dequeue next item or quit processing. */
@@ -1394,6 +1579,8 @@ static int fpm_nl_new(struct thread_master *tm)
 	install_element(CONFIG_NODE, &no_fpm_set_address_cmd);
 	install_element(CONFIG_NODE, &fpm_use_nhg_cmd);
 	install_element(CONFIG_NODE, &no_fpm_use_nhg_cmd);
+	install_element(CONFIG_NODE, &fpm_replay_rate_cmd);
+	install_element(CONFIG_NODE, &no_fpm_replay_rate_cmd);
 
 	return 0;
 }
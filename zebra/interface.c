@@ -2951,6 +2951,7 @@ int if_ip_address_install(struct interface *ifp, struct prefix *prefix,
 
 		/* Add to linked list. */
 		listnode_add(ifp->connected, ifc);
+		if_addr_index_invalidate();
 	}
 
 	/* This address is configured from zebra. */
@@ -3046,6 +3047,7 @@ static int ip_address_install(struct vty *vty, struct interface *ifp,
 
 		/* Add to linked list. */
 		listnode_add(ifp->connected, ifc);
+		if_addr_index_invalidate();
 	}
 
 	/* This address is configured from zebra. */
@@ -3309,6 +3311,7 @@ int if_ipv6_address_install(struct interface *ifp, struct prefix *prefix,
 
 		/* Add to linked list. */
 		listnode_add(ifp->connected, ifc);
+		if_addr_index_invalidate();
 	}
 
 	/* This address is configured from zebra. */
@@ -3382,6 +3385,7 @@ static int ipv6_address_install(struct vty *vty, struct interface *ifp,
 
 		/* Add to linked list. */
 		listnode_add(ifp->connected, ifc);
+		if_addr_index_invalidate();
 	}
 
 	/* This address is configured from zebra. */
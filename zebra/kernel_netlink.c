@@ -37,6 +37,8 @@
 #include "vrf.h"
 #include "mpls.h"
 #include "lib_errors.h"
+#include "jhash.h"
+#include "typesafe.h"
 
 //#include "zebra/zserv.h"
 #include "zebra/zebra_router.h"
@@ -49,6 +51,7 @@
 #include "zebra/if_netlink.h"
 #include "zebra/rule_netlink.h"
 #include "zebra/zebra_errors.h"
+#include "zebra/zebra_trace.h"
 
 #ifndef SO_RCVBUFFORCE
 #define SO_RCVBUFFORCE  (33)
@@ -92,6 +95,31 @@
 
 #define NL_BATCH_RX_BUFSIZE NL_RCV_PKT_BUF_SIZE
 
+/*
+ * Route messages are sent without NLM_F_ACK, so the kernel only answers the
+ * ones that failed, and it does so while processing the sendmsg() call.
+ * Several batches are therefore sent before the socket is drained for
+ * errors; the amount sent in between is capped at a fraction of the
+ * receive buffer so that a window full of errors can't overrun it.
+ */
+#define NL_BATCH_WINDOW_FRACTION 4
+
+/*
+ * The send threshold adapts to how long the kernel takes to process a
+ * batch: it shrinks when a send takes longer than the target, so that the
+ * dataplane keeps returning results at a steady pace, and grows back up
+ * to the configured threshold while sends are quick.
+ */
+#define NL_BATCH_TARGET_USEC 2000
+#define NL_BATCH_MIN_THRESHOLD NL_PKT_BUF_SIZE
+
+/*
+ * Notifications are read NL_RECV_BATCH buffers per recvmmsg() call, and up
+ * to NL_RECV_ROUNDS calls are made each time the socket is readable.
+ */
+#define NL_RECV_BATCH 8
+#define NL_RECV_ROUNDS 5
+
 static const struct message nlmsg_str[] = {{RTM_NEWROUTE, "RTM_NEWROUTE"},
 					   {RTM_DELROUTE, "RTM_DELROUTE"},
 					   {RTM_GETROUTE, "RTM_GETROUTE"},
@@ -160,6 +188,7 @@ extern uint32_t nl_rcvbufsize;
 extern struct zebra_privs_t zserv_privs;
 
 DEFINE_MTYPE_STATIC(ZEBRA, NL_BUF, "Zebra Netlink buffers")
+DEFINE_MTYPE_STATIC(ZEBRA, NL_NEIGH_DEFER, "Zebra Netlink deferred neighbor")
 
 size_t nl_batch_tx_bufsize;
 char *nl_batch_tx_buf;
@@ -169,6 +198,13 @@ char nl_batch_rx_buf[NL_BATCH_RX_BUFSIZE];
 _Atomic uint32_t nl_batch_bufsize = NL_DEFAULT_BATCH_BUFSIZE;
 _Atomic uint32_t nl_batch_send_threshold = NL_DEFAULT_BATCH_SEND_THRESHOLD;
 
+/*
+ * Current adaptive send threshold.  Only the "Kernel" dplane provider
+ * reaches the batching code (kernel_update_multi()), so this, like the tx
+ * buffer above, is owned by that provider's "Zebra dplane Kernel" pthread.
+ */
+static size_t nl_batch_adaptive_limit;
+
 struct nl_batch {
 	void *buf;
 	size_t bufsiz;
@@ -182,6 +218,12 @@ struct nl_batch {
 
 	struct dplane_ctx_q ctx_list;
 
+	/* Sent, not yet checked for error responses */
+	struct dplane_ctx_q ctx_sent;
+	const struct zebra_dplane_info *sent_zns;
+	size_t sent_len;
+	size_t window;
+
 	/*
 	 * Pointer to the queue of completed contexts outbound back
 	 * towards the dataplane module.
@@ -391,6 +433,222 @@ static int netlink_information_fetch(struct nlmsghdr *h, ns_id_t ns_id,
 	return 0;
 }
 
+/*
+ * Neighbor (ARP/ND) and FDB notifications arrive in storms on EVPN
+ * leaves, often several for the same entry.  Rather than handling each one
+ * as it is parsed, they are set aside while a batch of buffers is read and
+ * only the last notification per entry is handed to netlink_neigh_change()
+ * once the batch is done.  Everything else is dispatched in order.
+ */
+struct nl_neigh_key {
+	ns_id_t ns_id;
+	int ifindex;
+	uint16_t vlan;
+	uint8_t family;
+	uint8_t dst_len;
+	uint8_t lladdr_len;
+	uint8_t dst[16];
+	uint8_t lladdr[ETH_ALEN];
+};
+
+PREDECL_HASH(nl_neigh_defer_hash)
+PREDECL_LIST(nl_neigh_defer_list)
+
+struct nl_neigh_defer {
+	struct nl_neigh_key key;
+	struct nlmsghdr *h;
+
+	struct nl_neigh_defer_hash_item hitem;
+	struct nl_neigh_defer_list_item litem;
+};
+
+static int nl_neigh_defer_cmp(const struct nl_neigh_defer *a,
+			      const struct nl_neigh_defer *b)
+{
+	return memcmp(&a->key, &b->key, sizeof(a->key));
+}
+
+static uint32_t nl_neigh_defer_hkey(const struct nl_neigh_defer *d)
+{
+	return jhash(&d->key, sizeof(d->key), 0x4e656967);
+}
+
+DECLARE_HASH(nl_neigh_defer_hash, struct nl_neigh_defer, hitem,
+	     nl_neigh_defer_cmp, nl_neigh_defer_hkey)
+DECLARE_LIST(nl_neigh_defer_list, struct nl_neigh_defer, litem)
+
+static struct nl_neigh_defer_hash_head nl_neigh_deferred_hash;
+static struct nl_neigh_defer_list_head nl_neigh_deferred =
+	INIT_LIST(nl_neigh_deferred);
+static uint32_t nl_neigh_coalesced;
+
+/*
+ * Set aside a neighbor notification, replacing any earlier one for the
+ * same entry.  Returns false if the message can't be keyed, in which case
+ * the caller handles it right away.
+ */
+static bool netlink_neigh_defer(struct nlmsghdr *h, ns_id_t ns_id)
+{
+	struct ndmsg *ndm = NLMSG_DATA(h);
+	struct rtattr *tb[NDA_MAX + 1];
+	struct nl_neigh_defer lookup = {}, *d;
+	int len;
+
+	len = h->nlmsg_len - NLMSG_LENGTH(sizeof(struct ndmsg));
+	if (len < 0)
+		return false;
+
+	memset(tb, 0, sizeof(tb));
+	netlink_parse_rtattr(tb, NDA_MAX,
+			     (struct rtattr *)((char *)ndm
+					       + NLMSG_ALIGN(sizeof(*ndm))),
+			     len);
+
+	lookup.key.ns_id = ns_id;
+	lookup.key.ifindex = ndm->ndm_ifindex;
+	lookup.key.family = ndm->ndm_family;
+	if (tb[NDA_DST]) {
+		if (RTA_PAYLOAD(tb[NDA_DST]) > sizeof(lookup.key.dst))
+			return false;
+		lookup.key.dst_len = RTA_PAYLOAD(tb[NDA_DST]);
+		memcpy(lookup.key.dst, RTA_DATA(tb[NDA_DST]),
+		       lookup.key.dst_len);
+	}
+	if (ndm->ndm_family == AF_BRIDGE) {
+		/* FDB entries are keyed by MAC and VLAN as well */
+		if (!tb[NDA_LLADDR]
+		    || RTA_PAYLOAD(tb[NDA_LLADDR]) > sizeof(lookup.key.lladdr))
+			return false;
+		lookup.key.lladdr_len = RTA_PAYLOAD(tb[NDA_LLADDR]);
+		memcpy(lookup.key.lladdr, RTA_DATA(tb[NDA_LLADDR]),
+		       lookup.key.lladdr_len);
+		if (tb[NDA_VLAN])
+			lookup.key.vlan = *(uint16_t *)RTA_DATA(tb[NDA_VLAN]);
+	} else if (!tb[NDA_DST])
+		return false;
+
+	d = nl_neigh_defer_hash_find(&nl_neigh_deferred_hash, &lookup);
+	if (d) {
+		XFREE(MTYPE_NL_BUF, d->h);
+		nl_neigh_coalesced++;
+	} else {
+		d = XCALLOC(MTYPE_NL_NEIGH_DEFER, sizeof(*d));
+		d->key = lookup.key;
+		nl_neigh_defer_hash_add(&nl_neigh_deferred_hash, d);
+		nl_neigh_defer_list_add_tail(&nl_neigh_deferred, d);
+	}
+	d->h = XMALLOC(MTYPE_NL_BUF, h->nlmsg_len);
+	memcpy(d->h, h, h->nlmsg_len);
+
+	return true;
+}
+
+static void netlink_neigh_defer_flush(void)
+{
+	struct nl_neigh_defer *d;
+
+	if (IS_ZEBRA_DEBUG_KERNEL && nl_neigh_coalesced)
+		zlog_debug("Coalesced %u neighbor notifications",
+			   nl_neigh_coalesced);
+	nl_neigh_coalesced = 0;
+
+	while ((d = nl_neigh_defer_list_pop(&nl_neigh_deferred))) {
+		nl_neigh_defer_hash_del(&nl_neigh_deferred_hash, d);
+		netlink_neigh_change(d->h, d->key.ns_id);
+		XFREE(MTYPE_NL_BUF, d->h);
+		XFREE(MTYPE_NL_NEIGH_DEFER, d);
+	}
+}
+
+static int netlink_information_classify(struct nlmsghdr *h, ns_id_t ns_id,
+					int startup)
+{
+	if ((h->nlmsg_type == RTM_NEWNEIGH || h->nlmsg_type == RTM_DELNEIGH)
+	    && netlink_neigh_defer(h, ns_id))
+		return 0;
+
+	return netlink_information_fetch(h, ns_id, startup);
+}
+
+static bool netlink_parse_buf(int (*filter)(struct nlmsghdr *, ns_id_t, int),
+			      const struct nlsock *nl,
+			      const struct zebra_dplane_info *zns, char *buf,
+			      int status, int msg_flags, uint32_t pid,
+			      int startup, int *ret);
+
+#ifdef HAVE_RECVMMSG
+/*
+ * Read up to rounds * NL_RECV_BATCH buffers off a notification socket,
+ * NL_RECV_BATCH at a time with recvmmsg(), and parse them.
+ */
+static char nl_recv_bufs[NL_RECV_BATCH][NL_RCV_PKT_BUF_SIZE];
+
+static void netlink_read_batch(int (*filter)(struct nlmsghdr *, ns_id_t, int),
+			       const struct nlsock *nl,
+			       const struct zebra_dplane_info *zns, int rounds)
+{
+	struct mmsghdr msgs[NL_RECV_BATCH];
+	struct iovec iov[NL_RECV_BATCH];
+	struct sockaddr_nl snl[NL_RECV_BATCH];
+	int i, n, ret;
+
+	while (rounds--) {
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < NL_RECV_BATCH; i++) {
+			iov[i].iov_base = nl_recv_bufs[i];
+			iov[i].iov_len = sizeof(nl_recv_bufs[i]);
+			msgs[i].msg_hdr.msg_name = &snl[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(snl[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		do {
+			n = recvmmsg(nl->sock, msgs, NL_RECV_BATCH,
+				     MSG_DONTWAIT, NULL);
+		} while (n == -1 && errno == EINTR);
+
+		if (n == -1) {
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return;
+			flog_err(EC_ZEBRA_RECVMSG_OVERRUN,
+				 "%s recvmsg overrun: %s", nl->name,
+				 safe_strerror(errno));
+			/* See netlink_recv_msg() */
+			exit(-1);
+		}
+
+		for (i = 0; i < n; i++) {
+			if (msgs[i].msg_len == 0) {
+				flog_err_sys(EC_LIB_SOCKET, "%s EOF", nl->name);
+				return;
+			}
+			if (msgs[i].msg_hdr.msg_namelen != sizeof(snl[i])) {
+				flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+					 "%s sender address length error: length %d",
+					 nl->name, msgs[i].msg_hdr.msg_namelen);
+				continue;
+			}
+			if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV) {
+				zlog_debug("%s: << netlink message dump [recv]",
+					   __func__);
+				zlog_hexdump(nl_recv_bufs[i], msgs[i].msg_len);
+			}
+
+			ret = 0;
+			netlink_parse_buf(filter, nl, zns, nl_recv_bufs[i],
+					  msgs[i].msg_len,
+					  msgs[i].msg_hdr.msg_flags,
+					  snl[i].nl_pid, 0, &ret);
+		}
+
+		/* Socket drained */
+		if (n < NL_RECV_BATCH)
+			return;
+	}
+}
+#endif /* HAVE_RECVMMSG */
+
 static int kernel_read(struct thread *thread)
 {
 	struct zebra_ns *zns = (struct zebra_ns *)THREAD_ARG(thread);
@@ -399,8 +657,15 @@ static int kernel_read(struct thread *thread)
 	/* Capture key info from ns struct */
 	zebra_dplane_info_from_zns(&dp_info, zns, false);
 
-	netlink_parse_info(netlink_information_fetch, &zns->netlink, &dp_info,
-			   5, 0);
+#ifdef HAVE_RECVMMSG
+	netlink_read_batch(netlink_information_classify, &zns->netlink,
+			   &dp_info, NL_RECV_ROUNDS);
+#else
+	netlink_parse_info(netlink_information_classify, &zns->netlink,
+			   &dp_info, 5, 0);
+#endif
+	netlink_neigh_defer_flush();
+
 	zns->t_netlink = NULL;
 	thread_add_read(zrouter.master, kernel_read, zns, zns->netlink.sock,
 			&zns->t_netlink);
@@ -859,6 +1124,84 @@ static int netlink_parse_error(const struct nlsock *nl, struct nlmsghdr *h,
 	return -1;
 }
 
+/*
+ * Walk one buffer received from a netlink socket and hand each message to
+ * the filter.  Returns true when parsing of the reply is complete, with
+ * the final result stored in *ret; false means more data should be read.
+ */
+static bool netlink_parse_buf(int (*filter)(struct nlmsghdr *, ns_id_t, int),
+			      const struct nlsock *nl,
+			      const struct zebra_dplane_info *zns, char *buf,
+			      int status, int msg_flags, uint32_t pid,
+			      int startup, int *ret)
+{
+	struct nlmsghdr *h;
+	int error;
+
+	for (h = (struct nlmsghdr *)buf;
+	     (status >= 0 && NLMSG_OK(h, (unsigned int)status));
+	     h = NLMSG_NEXT(h, status)) {
+		/* Finish of reading. */
+		if (h->nlmsg_type == NLMSG_DONE)
+			return true;
+
+		/* Error handling. */
+		if (h->nlmsg_type == NLMSG_ERROR) {
+			int err = netlink_parse_error(nl, h, zns, startup);
+
+			if (err == 1) {
+				if (!(h->nlmsg_flags & NLM_F_MULTI)) {
+					*ret = 0;
+					return true;
+				}
+				continue;
+			}
+
+			*ret = err;
+			return true;
+		}
+
+		/* OK we got netlink message. */
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug(
+				"netlink_parse_info: %s type %s(%u), len=%d, seq=%u, pid=%u",
+				nl->name, nl_msg_type_to_str(h->nlmsg_type),
+				h->nlmsg_type, h->nlmsg_len, h->nlmsg_seq,
+				h->nlmsg_pid);
+
+
+		/*
+		 * Ignore messages that maybe sent from
+		 * other actors besides the kernel
+		 */
+		if (pid != 0) {
+			zlog_debug("Ignoring message from pid %u", pid);
+			continue;
+		}
+
+		error = (*filter)(h, zns->ns_id, startup);
+		if (error < 0) {
+			zlog_debug("%s filter function error", nl->name);
+			*ret = error;
+		}
+	}
+
+	/* After error care. */
+	if (msg_flags & MSG_TRUNC) {
+		flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+			 "%s error: message truncated", nl->name);
+		return false;
+	}
+	if (status) {
+		flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+			 "%s error: data remnant size %d", nl->name, status);
+		*ret = -1;
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * netlink_parse_info
  *
@@ -879,7 +1222,6 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 {
 	int status;
 	int ret = 0;
-	int error;
 	int read_in = 0;
 
 	while (1) {
@@ -887,7 +1229,6 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 		struct sockaddr_nl snl;
 		struct msghdr msg = {.msg_name = (void *)&snl,
 				     .msg_namelen = sizeof(snl)};
-		struct nlmsghdr *h;
 
 		if (count && read_in >= count)
 			return 0;
@@ -899,66 +1240,179 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 			break;
 
 		read_in++;
-		for (h = (struct nlmsghdr *)buf;
-		     (status >= 0 && NLMSG_OK(h, (unsigned int)status));
-		     h = NLMSG_NEXT(h, status)) {
-			/* Finish of reading. */
-			if (h->nlmsg_type == NLMSG_DONE)
-				return ret;
-
-			/* Error handling. */
-			if (h->nlmsg_type == NLMSG_ERROR) {
-				int err = netlink_parse_error(nl, h, zns,
-							      startup);
-				if (err == 1) {
-					if (!(h->nlmsg_flags & NLM_F_MULTI))
-						return 0;
-					continue;
-				} else
-					return err;
-			}
+		if (netlink_parse_buf(filter, nl, zns, buf, status,
+				      msg.msg_flags, snl.nl_pid, startup, &ret))
+			return ret;
+	}
+	return ret;
+}
+
+/*
+ * Kernel dump prefetch.
+ *
+ * Large dumps (the routing tables at startup) are bounded by how fast we
+ * both pull buffers out of the socket and run the filters over them.  A
+ * reader pthread keeps receiving the next buffers of the dump while the
+ * main pthread parses the previous ones, so the kernel building the dump
+ * and zebra installing it into the RIB overlap.  The filters themselves
+ * still run on the main pthread only.
+ */
+#define NL_DUMP_PREFETCH_MAX 64
 
-			/* OK we got netlink message. */
-			if (IS_ZEBRA_DEBUG_KERNEL)
-				zlog_debug(
-					"netlink_parse_info: %s type %s(%u), len=%d, seq=%u, pid=%u",
-					nl->name,
-					nl_msg_type_to_str(h->nlmsg_type),
-					h->nlmsg_type, h->nlmsg_len,
-					h->nlmsg_seq, h->nlmsg_pid);
+struct nl_dump_buf {
+	struct nl_dump_buf *next;
 
+	int status;
+	int msg_flags;
+	uint32_t pid;
 
-			/*
-			 * Ignore messages that maybe sent from
-			 * other actors besides the kernel
-			 */
-			if (snl.nl_pid != 0) {
-				zlog_debug("Ignoring message from pid %u",
-					   snl.nl_pid);
-				continue;
-			}
+	char buf[NL_RCV_PKT_BUF_SIZE];
+};
 
-			error = (*filter)(h, zns->ns_id, startup);
-			if (error < 0) {
-				zlog_debug("%s filter function error",
-					   nl->name);
-				ret = error;
-			}
-		}
+struct nl_dump {
+	const struct nlsock *nl;
 
-		/* After error care. */
-		if (msg.msg_flags & MSG_TRUNC) {
-			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
-				 "%s error: message truncated", nl->name);
-			continue;
+	pthread_mutex_t mtx;
+	pthread_cond_t ready;
+	pthread_cond_t space;
+
+	struct nl_dump_buf *head, **tail;
+	int depth;
+	bool stop;
+};
+
+/* Does this buffer carry the end of the dump? */
+static bool nl_dump_buf_last(const struct nl_dump_buf *b)
+{
+	const struct nlmsghdr *h;
+	int status = b->status;
+
+	if (status <= 0)
+		return true;
+
+	for (h = (const struct nlmsghdr *)b->buf;
+	     NLMSG_OK(h, (unsigned int)status); h = NLMSG_NEXT(h, status)) {
+		if (h->nlmsg_type == NLMSG_DONE)
+			return true;
+		if (h->nlmsg_type == NLMSG_ERROR) {
+			const struct nlmsgerr *err = NLMSG_DATA(h);
+
+			if (err->error != 0 || !(h->nlmsg_flags & NLM_F_MULTI))
+				return true;
 		}
-		if (status) {
-			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
-				 "%s error: data remnant size %d", nl->name,
-				 status);
-			return -1;
+	}
+
+	return false;
+}
+
+static void *nl_dump_reader(void *arg)
+{
+	struct nl_dump *dump = arg;
+	struct nl_dump_buf *b;
+	bool last = false;
+
+	while (!last) {
+		struct sockaddr_nl snl;
+		struct msghdr msg = {.msg_name = (void *)&snl,
+				     .msg_namelen = sizeof(snl)};
+
+		b = XMALLOC(MTYPE_NL_BUF, sizeof(*b));
+		b->next = NULL;
+		b->status = netlink_recv_msg(dump->nl, msg, b->buf,
+					     sizeof(b->buf));
+		b->msg_flags = msg.msg_flags;
+		b->pid = snl.nl_pid;
+		last = nl_dump_buf_last(b);
+
+		pthread_mutex_lock(&dump->mtx);
+		while (dump->depth >= NL_DUMP_PREFETCH_MAX && !dump->stop)
+			pthread_cond_wait(&dump->space, &dump->mtx);
+		if (dump->stop) {
+			pthread_mutex_unlock(&dump->mtx);
+			XFREE(MTYPE_NL_BUF, b);
+			break;
 		}
+		*dump->tail = b;
+		dump->tail = &b->next;
+		dump->depth++;
+		pthread_cond_signal(&dump->ready);
+		pthread_mutex_unlock(&dump->mtx);
+	}
+
+	return NULL;
+}
+
+/*
+ * netlink_parse_dump
+ *
+ * Same as netlink_parse_info() with count == 0, for replies to dump
+ * requests, but with reception of the dump handed off to a reader
+ * pthread.  Falls back to netlink_parse_info() if the thread can't be
+ * started.
+ */
+int netlink_parse_dump(int (*filter)(struct nlmsghdr *, ns_id_t, int),
+		       const struct nlsock *nl,
+		       const struct zebra_dplane_info *zns, int startup)
+{
+	struct nl_dump dump = {};
+	struct nl_dump_buf *b;
+	pthread_t reader;
+	int ret = 0;
+	bool done = false;
+
+	dump.nl = nl;
+	dump.tail = &dump.head;
+	pthread_mutex_init(&dump.mtx, NULL);
+	pthread_cond_init(&dump.ready, NULL);
+	pthread_cond_init(&dump.space, NULL);
+
+	if (pthread_create(&reader, NULL, nl_dump_reader, &dump)) {
+		zlog_warn("%s: unable to start dump reader, reading inline",
+			  nl->name);
+		ret = netlink_parse_info(filter, nl, zns, 0, startup);
+		goto out;
 	}
+
+	while (!done) {
+		pthread_mutex_lock(&dump.mtx);
+		while (!dump.head)
+			pthread_cond_wait(&dump.ready, &dump.mtx);
+		b = dump.head;
+		dump.head = b->next;
+		if (!dump.head)
+			dump.tail = &dump.head;
+		dump.depth--;
+		pthread_cond_signal(&dump.space);
+		pthread_mutex_unlock(&dump.mtx);
+
+		if (b->status == -1) {
+			ret = -1;
+			done = true;
+		} else if (b->status == 0)
+			done = true;
+		else
+			done = netlink_parse_buf(filter, nl, zns, b->buf,
+						 b->status, b->msg_flags,
+						 b->pid, startup, &ret);
+
+		XFREE(MTYPE_NL_BUF, b);
+	}
+
+	pthread_mutex_lock(&dump.mtx);
+	dump.stop = true;
+	pthread_cond_broadcast(&dump.space);
+	pthread_mutex_unlock(&dump.mtx);
+	pthread_join(reader, NULL);
+
+	while ((b = dump.head)) {
+		dump.head = b->next;
+		XFREE(MTYPE_NL_BUF, b);
+	}
+
+out:
+	pthread_cond_destroy(&dump.space);
+	pthread_cond_destroy(&dump.ready);
+	pthread_mutex_destroy(&dump.mtx);
 	return ret;
 }
 
@@ -1057,7 +1511,7 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 	struct zebra_dplane_ctx *ctx;
 	bool ignore_msg;
 
-	nl = &(bth->zns->nls);
+	nl = &(bth->sent_zns->nls);
 
 	msg.msg_name = (void *)&snl;
 	msg.msg_namelen = sizeof(snl);
@@ -1082,7 +1536,7 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 		 * requests at same time.
 		 */
 		while (true) {
-			ctx = dplane_ctx_dequeue(&(bth->ctx_list));
+			ctx = dplane_ctx_dequeue(&(bth->ctx_sent));
 			if (ctx == NULL)
 				break;
 
@@ -1117,12 +1571,12 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 		if (ctx == NULL) {
 			zlog_debug(
 				"%s: skipping unassociated response, seq number %d NS %u",
-				__func__, h->nlmsg_seq, bth->zns->ns_id);
+				__func__, h->nlmsg_seq, bth->sent_zns->ns_id);
 			continue;
 		}
 
 		if (h->nlmsg_type == NLMSG_ERROR) {
-			int err = netlink_parse_error(nl, h, bth->zns, 0);
+			int err = netlink_parse_error(nl, h, bth->sent_zns, 0);
 
 			if (err == -1)
 				dplane_ctx_set_status(
@@ -1140,7 +1594,8 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 		 */
 		zlog_debug("%s: ignoring message type 0x%04x(%s) NS %u",
 			   __func__, h->nlmsg_type,
-			   nl_msg_type_to_str(h->nlmsg_type), bth->zns->ns_id);
+			   nl_msg_type_to_str(h->nlmsg_type),
+			   bth->sent_zns->ns_id);
 	}
 
 	return 0;
@@ -1158,6 +1613,8 @@ static void nl_batch_reset(struct nl_batch *bth)
 
 static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
 {
+	size_t threshold;
+
 	/*
 	 * If the size of the buffer has changed, free and then allocate a new
 	 * one.
@@ -1174,51 +1631,129 @@ static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
 
 	bth->buf = nl_batch_tx_buf;
 	bth->bufsiz = bufsize;
-	bth->limit = atomic_load_explicit(&nl_batch_send_threshold,
-					  memory_order_relaxed);
+
+	threshold = atomic_load_explicit(&nl_batch_send_threshold,
+					 memory_order_relaxed);
+	if (nl_batch_adaptive_limit == 0 || nl_batch_adaptive_limit > threshold)
+		nl_batch_adaptive_limit = threshold;
+	bth->limit = nl_batch_adaptive_limit;
 
 	bth->ctx_out_q = ctx_out_q;
 
+	TAILQ_INIT(&(bth->ctx_sent));
+	bth->sent_zns = NULL;
+	bth->sent_len = 0;
+	bth->window = nl_rcvbufsize / NL_BATCH_WINDOW_FRACTION;
+
 	nl_batch_reset(bth);
 }
 
-static void nl_batch_send(struct nl_batch *bth)
+/* Move contexts to the outbound queue, optionally marking them failed */
+static void nl_batch_complete(struct nl_batch *bth, struct dplane_ctx_q *list,
+			      bool err)
 {
 	struct zebra_dplane_ctx *ctx;
+
+	while (true) {
+		ctx = dplane_ctx_dequeue(list);
+		if (ctx == NULL)
+			break;
+
+		if (err)
+			dplane_ctx_set_status(ctx,
+					      ZEBRA_DPLANE_REQUEST_FAILURE);
+		else
+			dplane_ctx_latency_ack(ctx);
+
+		dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
+	}
+}
+
+/* Collect the error responses for everything sent so far */
+static void nl_batch_read_window(struct nl_batch *bth)
+{
 	bool err = false;
 
+	if (bth->sent_zns != NULL && nl_batch_read_resp(bth) == -1)
+		err = true;
+	if (bth->sent_zns != NULL)
+		frrtrace(3, frr_zebra, netlink_batch_ack,
+			 bth->sent_zns->nls.name, bth->sent_len, err);
+
+	/* Whatever wasn't answered succeeded */
+	nl_batch_complete(bth, &(bth->ctx_sent), err);
+
+	bth->sent_zns = NULL;
+	bth->sent_len = 0;
+}
+
+static void nl_batch_adapt(struct nl_batch *bth, int64_t usec)
+{
+	size_t threshold = atomic_load_explicit(&nl_batch_send_threshold,
+						memory_order_relaxed);
+	size_t limit = nl_batch_adaptive_limit;
+
+	if (usec > NL_BATCH_TARGET_USEC)
+		limit = MAX(limit / 2, NL_BATCH_MIN_THRESHOLD);
+	else if (usec < NL_BATCH_TARGET_USEC / 2)
+		limit = MIN(limit + limit / 4, threshold);
+
+	if (limit != nl_batch_adaptive_limit && IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug("%s: send took %" PRId64
+			   "us, batch threshold %zu -> %zu",
+			   __func__, usec, nl_batch_adaptive_limit, limit);
+
+	nl_batch_adaptive_limit = limit;
+	bth->limit = limit;
+}
+
+static void nl_batch_send(struct nl_batch *bth)
+{
+	struct timeval start;
+
 	if (bth->curlen != 0 && bth->zns != NULL) {
 		if (IS_ZEBRA_DEBUG_KERNEL)
 			zlog_debug("%s: %s, batch size=%zu, msg cnt=%zu",
 				   __func__, bth->zns->nls.name, bth->curlen,
 				   bth->msgcnt);
 
-		if (netlink_send_msg(&(bth->zns->nls), bth->buf, bth->curlen)
-		    == -1)
-			err = true;
+		/* Responses can only be matched within one namespace */
+		if (bth->sent_zns != NULL
+		    && bth->sent_zns->ns_id != bth->zns->ns_id)
+			nl_batch_read_window(bth);
 
-		if (!err) {
-			if (nl_batch_read_resp(bth) == -1)
-				err = true;
+		frrtrace(3, frr_zebra, netlink_batch_send, bth->zns->nls.name,
+			 bth->curlen, bth->msgcnt);
+
+		monotime(&start);
+		if (netlink_send_msg(&(bth->zns->nls), bth->buf, bth->curlen)
+		    == -1) {
+			nl_batch_complete(bth, &(bth->ctx_list), true);
+			nl_batch_reset(bth);
+			return;
 		}
-	}
+		nl_batch_adapt(bth, monotime_since(&start, NULL));
 
-	/* Move remaining contexts to the outbound queue. */
-	while (true) {
-		ctx = dplane_ctx_dequeue(&(bth->ctx_list));
-		if (ctx == NULL)
-			break;
+		bth->sent_zns = bth->zns;
+		bth->sent_len += bth->curlen;
+	}
 
-		if (err)
-			dplane_ctx_set_status(ctx,
-					      ZEBRA_DPLANE_REQUEST_FAILURE);
+	/* Sent, or never needed sending: wait for possible errors */
+	dplane_ctx_list_append(&(bth->ctx_sent), &(bth->ctx_list));
 
-		dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
-	}
+	if (bth->sent_len >= bth->window)
+		nl_batch_read_window(bth);
 
 	nl_batch_reset(bth);
 }
 
+/* Send what is queued and collect every outstanding response */
+static void nl_batch_flush(struct nl_batch *bth)
+{
+	nl_batch_send(bth);
+	nl_batch_read_window(bth);
+}
+
 enum netlink_msg_status netlink_batch_add_msg(
 	struct nl_batch *bth, struct zebra_dplane_ctx *ctx,
 	ssize_t (*msg_encoder)(struct zebra_dplane_ctx *, void *, size_t),
@@ -1348,7 +1883,7 @@ void kernel_update_multi(struct dplane_ctx_q *ctx_list)
 
 		if (batch.zns != NULL
 		    && batch.zns->ns_id != dplane_ctx_get_ns(ctx)->ns_id)
-			nl_batch_send(&batch);
+			nl_batch_flush(&batch);
 
 		/*
 		 * Assume all messages will succeed and then mark only the ones
@@ -1367,7 +1902,7 @@ void kernel_update_multi(struct dplane_ctx_q *ctx_list)
 			nl_batch_send(&batch);
 	}
 
-	nl_batch_send(&batch);
+	nl_batch_flush(&batch);
 
 	TAILQ_INIT(ctx_list);
 	dplane_ctx_list_append(ctx_list, &handled_list);
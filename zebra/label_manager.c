@@ -48,6 +48,38 @@ struct label_manager lbl_mgr;
 DEFINE_MGROUP(LBL_MGR, "Label Manager");
 DEFINE_MTYPE_STATIC(LBL_MGR, LM_CHUNK, "Label Manager Chunk");
 
+static int lm_chunk_cmp(const struct label_manager_chunk *a,
+			const struct label_manager_chunk *b)
+{
+	return numcmp(a->start, b->start);
+}
+
+DECLARE_RBTREE_UNIQ(lm_chunk_tree, struct label_manager_chunk, item,
+		    lm_chunk_cmp);
+
+/* smallest first, lowest start among those of equal size */
+static int lm_free_cmp(const struct label_manager_chunk *a,
+		       const struct label_manager_chunk *b)
+{
+	if (a->end - a->start != b->end - b->start)
+		return numcmp(a->end - a->start, b->end - b->start);
+	return numcmp(a->start, b->start);
+}
+
+DECLARE_RBTREE_UNIQ(lm_free_tree, struct label_manager_chunk, free_item,
+		    lm_free_cmp);
+
+static int lm_gap_cmp(const struct label_manager_chunk *a,
+		      const struct label_manager_chunk *b)
+{
+	if (a->gap != b->gap)
+		return numcmp(a->gap, b->gap);
+	return numcmp(a->start, b->start);
+}
+
+DECLARE_RBTREE_UNIQ(lm_gap_tree, struct label_manager_chunk, gap_item,
+		    lm_gap_cmp);
+
 /* define hooks for the basic API, so that it can be specialized or served
  * externally
  */
@@ -97,6 +129,72 @@ void delete_label_chunk(void *val)
 	XFREE(MTYPE_LM_CHUNK, val);
 }
 
+/* recompute the unassigned range in front of a chunk after its
+ * predecessor changed
+ */
+static void lm_chunk_regap(struct label_manager_chunk *lmc)
+{
+	const struct label_manager_chunk *prev;
+	uint32_t from;
+
+	if (lmc->gap)
+		lm_gap_tree_del(&lbl_mgr.gaps, lmc);
+
+	prev = lm_chunk_tree_find_lt(&lbl_mgr.chunks, lmc);
+	from = prev ? prev->end + 1 : MPLS_LABEL_UNRESERVED_MIN;
+	lmc->gap = lmc->start > from ? lmc->start - from : 0;
+
+	if (lmc->gap)
+		lm_gap_tree_add(&lbl_mgr.gaps, lmc);
+}
+
+static void lm_chunk_insert(struct label_manager_chunk *lmc)
+{
+	struct label_manager_chunk *next;
+
+	lmc->gap = 0;
+	lm_chunk_tree_add(&lbl_mgr.chunks, lmc);
+	if (lmc->proto == NO_PROTO)
+		lm_free_tree_add(&lbl_mgr.free, lmc);
+
+	lm_chunk_regap(lmc);
+	next = lm_chunk_tree_next(&lbl_mgr.chunks, lmc);
+	if (next)
+		lm_chunk_regap(next);
+}
+
+static void lm_chunk_remove(struct label_manager_chunk *lmc)
+{
+	struct label_manager_chunk *next;
+
+	next = lm_chunk_tree_next(&lbl_mgr.chunks, lmc);
+	lm_chunk_tree_del(&lbl_mgr.chunks, lmc);
+	if (lmc->proto == NO_PROTO)
+		lm_free_tree_del(&lbl_mgr.free, lmc);
+	if (lmc->gap)
+		lm_gap_tree_del(&lbl_mgr.gaps, lmc);
+
+	if (next)
+		lm_chunk_regap(next);
+}
+
+/* change the owner of a chunk that is in the label manager */
+static void lm_chunk_set_owner(struct label_manager_chunk *lmc, uint8_t proto,
+			       unsigned short instance, uint32_t session_id,
+			       uint8_t keep)
+{
+	if (lmc->proto == NO_PROTO)
+		lm_free_tree_del(&lbl_mgr.free, lmc);
+
+	lmc->proto = proto;
+	lmc->instance = instance;
+	lmc->session_id = session_id;
+	lmc->keep = keep;
+
+	if (lmc->proto == NO_PROTO)
+		lm_free_tree_add(&lbl_mgr.free, lmc);
+}
+
 /**
  * Release label chunks from a client.
  *
@@ -109,25 +207,20 @@ void delete_label_chunk(void *val)
  */
 int release_daemon_label_chunks(struct zserv *client)
 {
-	struct listnode *node;
 	struct label_manager_chunk *lmc;
 	int count = 0;
-	int ret;
 
 	if (IS_ZEBRA_DEBUG_PACKET)
 		zlog_debug("%s: Releasing chunks for client proto %s, instance %d, session %u",
 			   __func__, zebra_route_string(client->proto),
 			   client->instance, client->session_id);
 
-	for (ALL_LIST_ELEMENTS_RO(lbl_mgr.lc_list, node, lmc)) {
+	frr_each (lm_chunk_tree, &lbl_mgr.chunks, lmc) {
 		if (lmc->proto == client->proto &&
 		    lmc->instance == client->instance &&
 		    lmc->session_id == client->session_id && lmc->keep == 0) {
-			ret = release_label_chunk(lmc->proto, lmc->instance,
-						  lmc->session_id,
-						  lmc->start, lmc->end);
-			if (ret == 0)
-				count++;
+			lm_chunk_set_owner(lmc, NO_PROTO, 0, 0, 0);
+			count++;
 		}
 	}
 
@@ -163,8 +256,9 @@ void lm_hooks_unregister(void)
  */
 void label_manager_init(void)
 {
-	lbl_mgr.lc_list = list_new();
-	lbl_mgr.lc_list->del = delete_label_chunk;
+	lm_chunk_tree_init(&lbl_mgr.chunks);
+	lm_free_tree_init(&lbl_mgr.free);
+	lm_gap_tree_init(&lbl_mgr.gaps);
 	hook_register(zserv_client_close, lm_client_disconnect_cb);
 
 	/* register default hooks for the label manager actions */
@@ -201,11 +295,8 @@ assign_specific_label_chunk(uint8_t proto, unsigned short instance,
 			    uint32_t session_id, uint8_t keep, uint32_t size,
 			    uint32_t base)
 {
-	struct label_manager_chunk *lmc;
-	struct listnode *node, *next = NULL;
-	struct listnode *first_node = NULL;
-	struct listnode *last_node = NULL;
-	struct listnode *insert_node = NULL;
+	struct label_manager_chunk *lmc, *next;
+	struct label_manager_chunk key = {};
 
 	/* precompute last label from base and size */
 	uint32_t end = base + size - 1;
@@ -218,82 +309,41 @@ assign_specific_label_chunk(uint8_t proto, unsigned short instance,
 		return NULL;
 	}
 
-	/* Scan the existing chunks to see if the requested range of labels
-	 * falls inside any of such chunks */
-	for (ALL_LIST_ELEMENTS_RO(lbl_mgr.lc_list, node, lmc)) {
-
-		/* skip chunks for labels < base */
-		if (base > lmc->end)
-			continue;
-
-		/* requested range is not covered by any existing, free chunk.
-		 * Therefore, need to insert a chunk */
-		if ((end < lmc->start) && !first_node) {
-			insert_node = node;
-			break;
-		}
-
-		if (!first_node)
-			first_node = node;
+	/* first chunk overlapping the requested range, if any */
+	key.start = base + 1;
+	lmc = lm_chunk_tree_find_lt(&lbl_mgr.chunks, &key);
+	if (!lmc || lmc->end < base) {
+		key.start = base;
+		lmc = lm_chunk_tree_find_gteq(&lbl_mgr.chunks, &key);
+	}
 
-		/* if chunk is used, cannot honor request */
-		if (lmc->proto != NO_PROTO)
+	/* if any of the overlapping chunks is used, cannot honor request */
+	for (next = lmc; next && next->start <= end;
+	     next = lm_chunk_tree_next(&lbl_mgr.chunks, next))
+		if (next->proto != NO_PROTO)
 			return NULL;
 
-		if (end <= lmc->end) {
-			last_node = node;
-			break;
-		}
-	}
-
-	/* insert chunk between existing chunks */
-	if (insert_node) {
-		lmc = create_label_chunk(proto, instance, session_id, keep,
-					 base, end);
-		listnode_add_before(lbl_mgr.lc_list, insert_node, lmc);
-		return lmc;
+	/* all of them are free, replace them with the new chunk; whatever
+	 * they covered outside of the request becomes a gap
+	 */
+	while (lmc && lmc->start <= end) {
+		next = lm_chunk_tree_next(&lbl_mgr.chunks, lmc);
+		lm_chunk_remove(lmc);
+		delete_label_chunk(lmc);
+		lmc = next;
 	}
 
-	if (first_node) {
-		/* get node past the last one, if there */
-		if (last_node)
-			last_node = listnextnode(last_node);
-
-		/* delete node coming after the above chunk whose labels are
-		 * included in the previous one */
-		for (node = first_node; node && (node != last_node);
-		     node = next) {
-			struct label_manager_chunk *death;
-
-			next = listnextnode(node);
-			death = listgetdata(node);
-			list_delete_node(lbl_mgr.lc_list, node);
-			delete_label_chunk(death);
-		}
-
-		lmc = create_label_chunk(proto, instance, session_id, keep,
-					 base, end);
-		if (last_node)
-			listnode_add_before(lbl_mgr.lc_list, last_node, lmc);
-		else
-			listnode_add(lbl_mgr.lc_list, lmc);
-
-		return lmc;
-	} else {
-		/* create a new chunk past all the existing ones and link at
-		 * tail */
-		lmc = create_label_chunk(proto, instance, session_id, keep,
-					 base, end);
-		listnode_add(lbl_mgr.lc_list, lmc);
-		return lmc;
-	}
+	lmc = create_label_chunk(proto, instance, session_id, keep, base, end);
+	lm_chunk_insert(lmc);
+	return lmc;
 }
 
 /**
  * Core function, assigns label chunks
  *
- * It first searches through the list to check if there's one available
- * (previously released). Otherwise it creates and assigns a new one
+ * It first checks if there's a previously released chunk of the requested
+ * size, then for unassigned space between existing chunks.  Otherwise it
+ * creates and assigns a new one after the last chunk.
  *
  * @param proto Daemon protocol of client, to identify the owner
  * @param instance Instance, to identify the owner
@@ -309,49 +359,41 @@ struct label_manager_chunk *assign_label_chunk(uint8_t proto,
 					       uint32_t base)
 {
 	struct label_manager_chunk *lmc;
-	struct listnode *node;
-	uint32_t prev_end = 0;
+	struct label_manager_chunk key = {};
+	uint32_t start_free;
+
+	if (size == 0)
+		return NULL;
 
 	/* handle chunks request with a specific base label */
 	if (base != MPLS_LABEL_BASE_ANY)
 		return assign_specific_label_chunk(proto, instance, session_id,
 						   keep, size, base);
 
-	/* appease scan-build, who gets confused by the use of macros */
-	assert(lbl_mgr.lc_list);
-
-	/* first check if there's one available */
-	for (ALL_LIST_ELEMENTS_RO(lbl_mgr.lc_list, node, lmc)) {
-		if (lmc->proto == NO_PROTO
-		    && lmc->end - lmc->start + 1 == size) {
-			lmc->proto = proto;
-			lmc->instance = instance;
-			lmc->session_id = session_id;
-			lmc->keep = keep;
-			return lmc;
-		}
-		/* check if we hadve a "hole" behind us that we can squeeze into
-		 */
-		if ((lmc->start > prev_end)
-		    && (lmc->start - prev_end >= size)) {
-			lmc = create_label_chunk(proto, instance, session_id,
-						 keep, prev_end + 1,
-						 prev_end + size);
-			listnode_add_before(lbl_mgr.lc_list, node, lmc);
-			return lmc;
-		}
-		prev_end = lmc->end;
+	/* first check if there's a released one of the same size */
+	key.start = 0;
+	key.end = size - 1;
+	lmc = lm_free_tree_find_gteq(&lbl_mgr.free, &key);
+	if (lmc && lmc->end - lmc->start + 1 == size) {
+		lm_chunk_set_owner(lmc, proto, instance, session_id, keep);
+		return lmc;
 	}
-	/* otherwise create a new one */
-	uint32_t start_free;
 
-	if (list_isempty(lbl_mgr.lc_list))
-		start_free = MPLS_LABEL_UNRESERVED_MIN;
-	else
-		start_free = ((struct label_manager_chunk *)listgetdata(
-				      listtail(lbl_mgr.lc_list)))
-				     ->end
-			     + 1;
+	/* then squeeze into the smallest "hole" that fits */
+	key.gap = size;
+	lmc = lm_gap_tree_find_gteq(&lbl_mgr.gaps, &key);
+	if (lmc) {
+		start_free = lmc->start - lmc->gap;
+		lmc = create_label_chunk(proto, instance, session_id, keep,
+					 start_free, start_free + size - 1);
+		lm_chunk_insert(lmc);
+		return lmc;
+	}
+
+	/* otherwise create a new one past the last chunk */
+	key.start = UINT32_MAX;
+	lmc = lm_chunk_tree_find_lt(&lbl_mgr.chunks, &key);
+	start_free = lmc ? lmc->end + 1 : MPLS_LABEL_UNRESERVED_MIN;
 
 	if (start_free > MPLS_LABEL_UNRESERVED_MAX - size + 1) {
 		flog_err(EC_ZEBRA_LM_EXHAUSTED_LABELS,
@@ -360,10 +402,9 @@ struct label_manager_chunk *assign_label_chunk(uint8_t proto,
 		return NULL;
 	}
 
-	/* create chunk and link at tail */
 	lmc = create_label_chunk(proto, instance, session_id, keep, start_free,
 				 start_free + size - 1);
-	listnode_add(lbl_mgr.lc_list, lmc);
+	lm_chunk_insert(lmc);
 	return lmc;
 }
 
@@ -397,31 +438,24 @@ static int label_manager_release_label_chunk(struct zserv *client,
 int release_label_chunk(uint8_t proto, unsigned short instance,
 			uint32_t session_id, uint32_t start, uint32_t end)
 {
-	struct listnode *node;
 	struct label_manager_chunk *lmc;
+	struct label_manager_chunk key = {};
 	int ret = -1;
 
-	/* check that size matches */
 	if (IS_ZEBRA_DEBUG_PACKET)
 		zlog_debug("Releasing label chunk: %u - %u", start, end);
-	/* find chunk and disown */
-	for (ALL_LIST_ELEMENTS_RO(lbl_mgr.lc_list, node, lmc)) {
-		if (lmc->start != start)
-			continue;
-		if (lmc->end != end)
-			continue;
+	/* find chunk, check that size matches, and disown */
+	key.start = start;
+	lmc = lm_chunk_tree_find(&lbl_mgr.chunks, &key);
+	if (lmc && lmc->end == end) {
 		if (lmc->proto != proto || lmc->instance != instance ||
-		    lmc->session_id != session_id) {
+		    lmc->session_id != session_id)
 			flog_err(EC_ZEBRA_LM_DAEMON_MISMATCH,
 				 "%s: Daemon mismatch!!", __func__);
-			continue;
+		else {
+			lm_chunk_set_owner(lmc, NO_PROTO, 0, 0, 0);
+			ret = 0;
 		}
-		lmc->proto = NO_PROTO;
-		lmc->instance = 0;
-		lmc->session_id = 0;
-		lmc->keep = 0;
-		ret = 0;
-		break;
 	}
 	if (ret != 0)
 		flog_err(EC_ZEBRA_LM_UNRELEASED_CHUNK,
@@ -489,5 +523,11 @@ int lm_get_chunk_response(struct label_manager_chunk *lmc, struct zserv *client,
 
 void label_manager_close(void)
 {
-	list_delete(&lbl_mgr.lc_list);
+	struct label_manager_chunk *lmc;
+
+	lm_free_tree_fini(&lbl_mgr.free);
+	lm_gap_tree_fini(&lbl_mgr.gaps);
+	while ((lmc = lm_chunk_tree_pop(&lbl_mgr.chunks)))
+		delete_label_chunk(lmc);
+	lm_chunk_tree_fini(&lbl_mgr.chunks);
 }
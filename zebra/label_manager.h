@@ -29,6 +29,7 @@
 #include "lib/linklist.h"
 #include "lib/thread.h"
 #include "lib/hook.h"
+#include "lib/typesafe.h"
 
 #include "zebra/zserv.h"
 
@@ -38,6 +39,10 @@ extern "C" {
 
 #define NO_PROTO 0
 
+PREDECL_RBTREE_UNIQ(lm_chunk_tree);
+PREDECL_RBTREE_UNIQ(lm_free_tree);
+PREDECL_RBTREE_UNIQ(lm_gap_tree);
+
 /*
  * Label chunk struct
  * Client daemon which the chunk belongs to can be identified by a tuple of:
@@ -57,6 +62,15 @@ struct label_manager_chunk {
 	uint8_t keep;
 	uint32_t start; /* First label of the chunk */
 	uint32_t end;   /* Last label of the chunk */
+
+	/* indexes kept by the label manager, unused on chunks handed in
+	 * by an external one through lm_get_chunk_response()
+	 */
+	struct lm_chunk_tree_item item;
+	struct lm_free_tree_item free_item;
+	struct lm_gap_tree_item gap_item;
+	/* number of unassigned labels right before start */
+	uint32_t gap;
 };
 
 /* declare hooks for the basic API, so that it can be specialized or served
@@ -108,10 +122,14 @@ void lm_hooks_unregister(void);
 
 /*
  * Main label manager struct
- * Holds a linked list of label chunks.
+ * Holds all label chunks sorted by start, plus two indexes so that
+ * requests don't need to walk them: unowned chunks by size, and chunks
+ * with unassigned labels in front of them by the size of that gap.
  */
 struct label_manager {
-	struct list *lc_list;
+	struct lm_chunk_tree_head chunks;
+	struct lm_free_tree_head free;
+	struct lm_gap_tree_head gaps;
 };
 
 void label_manager_init(void);
@@ -58,6 +58,7 @@
 #include "zebra/zebra_nb.h"
 #include "zebra/zebra_opaque.h"
 #include "zebra/zebra_srte.h"
+#include "zebra/zebra_rib_journal.h"
 
 #define ZEBRA_PTM_SUPPORT
 
@@ -84,6 +85,7 @@ uint32_t nl_rcvbufsize = 4194304;
 
 #define OPTION_V6_RR_SEMANTICS 2000
 #define OPTION_ASIC_OFFLOAD    2001
+#define OPTION_RIB_JOURNAL     2002
 
 /* Command line options. */
 const struct option longopts[] = {
@@ -95,6 +97,7 @@ const struct option longopts[] = {
 	{"vrfdefaultname", required_argument, NULL, 'o'},
 	{"graceful_restart", required_argument, NULL, 'K'},
 	{"asic-offload", optional_argument, NULL, OPTION_ASIC_OFFLOAD},
+	{"rib-journal", required_argument, NULL, OPTION_RIB_JOURNAL},
 #ifdef HAVE_NETLINK
 	{"vrfwnetns", no_argument, NULL, 'n'},
 	{"nl-bufsize", required_argument, NULL, 's'},
@@ -173,6 +176,8 @@ static void sigint(void)
 
 	zebra_ptm_finish();
 
+	zebra_rib_journal_finish(retain_mode);
+
 	if (retain_mode) {
 		zebra_nhg_mark_keep();
 		RB_FOREACH (vrf, vrf_name_head, &vrfs_by_name) {
@@ -290,6 +295,10 @@ int main(int argc, char **argv)
 	graceful_restart = 0;
 	vrf_configure_backend(VRF_BACKEND_VRF_LITE);
 
+	/* route churn allocates and frees these by the million */
+	qmem_slab_enable(MTYPE_RE, sizeof(struct route_entry));
+	nexthop_slab_enable();
+
 	frr_preinit(&zebra_di, argc, argv);
 
 	frr_opt_add(
@@ -307,6 +316,7 @@ int main(int argc, char **argv)
 		"  -o, --vrfdefaultname     Set default VRF name.\n"
 		"  -K, --graceful_restart   Graceful restart at the kernel level, timer in seconds for expiration\n"
 		"  -A, --asic-offload       FRR is interacting with an asic underneath the linux kernel\n"
+		"      --rib-journal        Keep a journal of the RIB in this file for warm restart\n"
 #ifdef HAVE_NETLINK
 		"  -n, --vrfwnetns          Use NetNS as VRF backend\n"
 		"  -s, --nl-bufsize         Set netlink receive buffer size\n"
@@ -362,6 +372,9 @@ int main(int argc, char **argv)
 		case 'K':
 			graceful_restart = atoi(optarg);
 			break;
+		case OPTION_RIB_JOURNAL:
+			rib_journal_path = optarg;
+			break;
 #ifdef HAVE_NETLINK
 		case 's':
 			nl_rcvbufsize = atoi(optarg);
@@ -399,6 +412,7 @@ int main(int argc, char **argv)
 	 * Initialize NS( and implicitly the VRF module), and make kernel
 	 * routing socket. */
 	zebra_ns_init((const char *)vrf_default_name_configured);
+	frr_startup_phase("kernel state read");
 	router_id_cmd_init();
 	zebra_vty_init();
 	access_list_init();
@@ -437,7 +451,10 @@ int main(int argc, char **argv)
 	*  immediately, so originating PID in notifications from kernel
 	*  will be equal to the current getpid(). To know about such routes,
 	* we have to have route_read() called before.
+	*  With a RIB journal, the routes zebra had before it went away are
+	*  loaded first; the ones nobody refreshes are swept like the rest.
 	*/
+	zebra_rib_journal_init(graceful_restart > 0);
 	zrouter.startup_time = monotime(NULL);
 	thread_add_timer(zrouter.master, rib_sweep_route,
 			 NULL, graceful_restart, NULL);
@@ -459,6 +476,7 @@ int main(int argc, char **argv)
 
 	/* RNH init */
 	zebra_rnh_init();
+	zebra_redistribute_init();
 
 	/* Config handler Init */
 	zebra_evpn_init();
@@ -52,6 +52,20 @@
 static int zebra_import_table_used[AFI_MAX][ZEBRA_KERNEL_TABLE_MAX];
 static uint32_t zebra_import_table_distance[AFI_MAX][ZEBRA_KERNEL_TABLE_MAX];
 
+/*
+ * Redistribution subscription index: for each afi and route type the
+ * clients subscribed to it in some VRF or instance, and for each afi the
+ * clients subscribed to the default route.  A route change is then only
+ * checked against the clients that could want it instead of every
+ * connected client.
+ */
+static struct list *redist_clients[AFI_MAX][ZEBRA_ROUTE_MAX];
+static struct list *redist_default_clients[AFI_MAX];
+
+/* Scratch list of candidate clients for the route being redistributed */
+static struct list *redist_candidates;
+static uint32_t redist_candidates_walk;
+
 int is_zebra_import_table_enabled(afi_t afi, vrf_id_t vrf_id, uint32_t table_id)
 {
 	/*
@@ -149,6 +163,111 @@ static void zebra_redistribute(struct zserv *client, int type,
 		}
 }
 
+static bool redist_bitmap_any(vrf_bitmap_t bmap)
+{
+	struct vrf *vrf;
+
+	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id)
+		if (vrf_bitmap_check(bmap, vrf->vrf_id))
+			return true;
+
+	return false;
+}
+
+static void redist_index_set(struct list **clients, struct zserv *client,
+			     bool subscribed)
+{
+	if (!*clients)
+		*clients = list_new();
+
+	if (!subscribed)
+		listnode_delete(*clients, client);
+	else if (!listnode_lookup(*clients, client))
+		listnode_add(*clients, client);
+}
+
+/* Bring the subscription index in line with the client's flags */
+void zebra_redistribute_index_update(struct zserv *client)
+{
+	afi_t afi;
+	int type;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+			redist_index_set(
+				&redist_clients[afi][type], client,
+				client->mi_redist[afi][type].enabled
+					|| redist_bitmap_any(
+						client->redist[afi][type]));
+
+		redist_index_set(&redist_default_clients[afi], client,
+				 redist_bitmap_any(
+					 client->redist_default[afi]));
+	}
+}
+
+static int zebra_redistribute_index_remove(struct zserv *client)
+{
+	afi_t afi;
+	int type;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+			redist_index_set(&redist_clients[afi][type], client,
+					 false);
+
+		redist_index_set(&redist_default_clients[afi], client, false);
+	}
+
+	return 0;
+}
+
+static void redist_candidates_add(struct list *clients)
+{
+	struct listnode *node;
+	struct zserv *client;
+
+	if (!clients)
+		return;
+
+	for (ALL_LIST_ELEMENTS_RO(clients, node, client)) {
+		if (client->redist_walk == redist_candidates_walk)
+			continue;
+
+		client->redist_walk = redist_candidates_walk;
+		listnode_add(redist_candidates, client);
+	}
+}
+
+/*
+ * Collect the clients that may want to hear about 're' or 'prev_re' at p:
+ * those subscribed to either route's type, to all types, or to the
+ * default route.
+ */
+static struct list *redist_candidates_get(const struct prefix *p, afi_t afi,
+					  const struct route_entry *re,
+					  const struct route_entry *prev_re)
+{
+	list_delete_all_node(redist_candidates);
+	redist_candidates_walk++;
+
+	redist_candidates_add(redist_clients[afi][ZEBRA_ROUTE_ALL]);
+	if (re)
+		redist_candidates_add(redist_clients[afi][re->type]);
+	if (prev_re)
+		redist_candidates_add(redist_clients[afi][prev_re->type]);
+	if (is_default_prefix(p))
+		redist_candidates_add(redist_default_clients[afi]);
+
+	return redist_candidates;
+}
+
+void zebra_redistribute_init(void)
+{
+	redist_candidates = list_new();
+	hook_register(zserv_client_close, zebra_redistribute_index_remove);
+}
+
 /*
  * Function to check if prefix is candidate for
  * redistribute.
@@ -192,8 +311,9 @@ void redistribute_update(const struct prefix *p, const struct prefix *src_p,
 			 const struct route_entry *re,
 			 const struct route_entry *prev_re)
 {
-	struct listnode *node, *nnode;
+	struct listnode *node;
 	struct zserv *client;
+	struct list *clients;
 	int afi;
 
 	if (IS_ZEBRA_DEBUG_RIB)
@@ -215,8 +335,9 @@ void redistribute_update(const struct prefix *p, const struct prefix *src_p,
 		return;
 	}
 
+	clients = redist_candidates_get(p, afi, re, prev_re);
 
-	for (ALL_LIST_ELEMENTS(zrouter.client_list, node, nnode, client)) {
+	for (ALL_LIST_ELEMENTS_RO(clients, node, client)) {
 		if (zebra_redistribute_check(re, client, p, afi)) {
 			if (IS_ZEBRA_DEBUG_RIB) {
 				zlog_debug(
@@ -246,8 +367,9 @@ void redistribute_delete(const struct prefix *p, const struct prefix *src_p,
 			 const struct route_entry *old_re,
 			 const struct route_entry *new_re)
 {
-	struct listnode *node, *nnode;
+	struct listnode *node;
 	struct zserv *client;
+	struct list *clients;
 	int afi;
 	vrf_id_t vrfid;
 
@@ -291,7 +413,9 @@ void redistribute_delete(const struct prefix *p, const struct prefix *src_p,
 		return;
 	}
 
-	for (ALL_LIST_ELEMENTS(zrouter.client_list, node, nnode, client)) {
+	clients = redist_candidates_get(p, afi, old_re, new_re);
+
+	for (ALL_LIST_ELEMENTS_RO(clients, node, client)) {
 		/* Do not send unsolicited messages to synchronous clients. */
 		if (client->synchronous)
 			continue;
@@ -361,6 +485,8 @@ void zebra_redistribute_add(ZAPI_HANDLER_ARGS)
 		}
 	}
 
+	redist_index_set(&redist_clients[afi][type], client, true);
+
 stream_failure:
 	return;
 }
@@ -398,6 +524,8 @@ void zebra_redistribute_delete(ZAPI_HANDLER_ARGS)
 	else
 		vrf_bitmap_unset(client->redist[afi][type], zvrf_id(zvrf));
 
+	zebra_redistribute_index_update(client);
+
 stream_failure:
 	return;
 }
@@ -415,6 +543,7 @@ void zebra_redistribute_default_add(ZAPI_HANDLER_ARGS)
 	}
 
 	vrf_bitmap_set(client->redist_default[afi], zvrf_id(zvrf));
+	redist_index_set(&redist_default_clients[afi], client, true);
 	zebra_redistribute_default(client, zvrf_id(zvrf));
 
 stream_failure:
@@ -434,6 +563,7 @@ void zebra_redistribute_default_delete(ZAPI_HANDLER_ARGS)
 	}
 
 	vrf_bitmap_unset(client->redist_default[afi], zvrf_id(zvrf));
+	zebra_redistribute_index_update(client);
 
 stream_failure:
 	return;
@@ -33,6 +33,9 @@
 extern "C" {
 #endif
 
+extern void zebra_redistribute_init(void);
+extern void zebra_redistribute_index_update(struct zserv *client);
+
 /* ZAPI command handlers */
 extern void zebra_redistribute_add(ZAPI_HANDLER_ARGS);
 extern void zebra_redistribute_delete(ZAPI_HANDLER_ARGS);
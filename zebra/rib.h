@@ -83,11 +83,16 @@ struct rnh {
 #define ZEBRA_KERNEL_TABLE_MAX 252 /* support for no more than this rt tables */
 
 PREDECL_LIST(re_list)
+PREDECL_LIST(re_nh_deps)
+PREDECL_DLIST(rib_nh_dependents)
 
 struct route_entry {
 	/* Link list. */
 	struct re_list_item next;
 
+	/* Route nodes our recursive nexthops resolved through */
+	struct re_nh_deps_head nh_deps;
+
 	/* Nexthop group, shared/refcounted, based on the nexthop(s)
 	 * provided by the owner of the route
 	 */
@@ -100,18 +105,21 @@ struct route_entry {
 	struct nexthop_group fib_ng;
 	struct nexthop_group fib_backup_ng;
 
+	/* Uptime. */
+	time_t uptime;
+
+	/*
+	 * Fields below are ordered by size so the structure carries no
+	 * padding; keep it that way when adding members, there is one of
+	 * these for every route zebra holds.
+	 */
+
 	/* Nexthop group hash entry ID */
 	uint32_t nhe_id;
 
 	/* Tag */
 	route_tag_t tag;
 
-	/* Uptime. */
-	time_t uptime;
-
-	/* Type of this route. */
-	int type;
-
 	/* VRF identifier. */
 	vrf_id_t vrf_id;
 
@@ -155,6 +163,9 @@ struct route_entry {
 	/* Source protocol instance */
 	uint16_t instance;
 
+	/* Type of this route, ZEBRA_ROUTE_* (always < ZEBRA_ROUTE_MAX). */
+	uint8_t type;
+
 	/* Distance. */
 	uint8_t distance;
 };
@@ -174,9 +185,54 @@ struct route_entry {
  *              don't generate routes
  */
 #define MQ_SIZE 7
+
+/*
+ * Route sub-queues are sharded per VRF: every route node is queued into
+ * the shard of the VRF owning its table.  Within one sub-queue priority
+ * the shards with pending work are served round-robin, so a burst of
+ * updates in one VRF cannot starve route processing in the others.
+ * Nexthop group objects are global and stay in a single sub-queue that
+ * is always drained first.
+ */
+PREDECL_DLIST(mq_runq)
+
+struct meta_queue_shard;
+
+struct meta_queue_subq {
+	struct meta_queue_shard *shard;
+	struct list *nodes;
+	struct mq_runq_item runq_item;
+};
+
+struct meta_queue_shard {
+	struct zebra_vrf *zvrf;
+	struct meta_queue_subq subq[MQ_SIZE];
+	uint32_t size; /* sum of lengths of all subqueues of this shard */
+	uint32_t max_size;
+	uint64_t processed;
+};
+
+/*
+ * A route node is queued at most once: requeueing it while it waits
+ * only moves it up to a better sub-queue if needed.  Nodes that have
+ * waited longer than MQ_AGE_USEC are served ahead of higher priority
+ * sub-queues, so IGP churn cannot starve BGP indefinitely.
+ */
+#define MQ_AGE_USEC (1000 * 1000)
+
+/* Dwell time histogram: < 1ms, < 10ms, < 100ms, < 1s, < 10s, more */
+#define MQ_DWELL_BUCKETS 6
+
 struct meta_queue {
-	struct list *subq[MQ_SIZE];
+	struct list *nhg_subq;
+	/* per priority, subqueues with pending work in service order */
+	struct mq_runq_head runq[MQ_SIZE];
 	uint32_t size; /* sum of lengths of all subqueues */
+
+	uint64_t coalesced;
+	uint64_t promoted;
+	uint64_t aged;
+	uint64_t dwell[MQ_DWELL_BUCKETS];
 };
 
 /*
@@ -197,11 +253,6 @@ typedef struct rib_dest_t_ {
 
 	struct route_entry *selected_fib;
 
-	/*
-	 * Flags, see below.
-	 */
-	uint32_t flags;
-
 	/*
 	 * The list of nht prefixes that have ended up
 	 * depending on this route node.
@@ -211,6 +262,26 @@ typedef struct rib_dest_t_ {
 	 */
 	struct rnh_list_head nht;
 
+	/*
+	 * Route entries elsewhere whose recursive nexthops resolved
+	 * through this destination, see struct rib_nh_dep.
+	 */
+	struct rib_nh_dependents_head nh_dependents;
+
+	/*
+	 * Meta-queue record while this destination waits to be processed:
+	 * the sub-queue it is in and when it was first queued.
+	 */
+	struct listnode *mq_node;
+	struct timeval mq_queued;
+
+	/*
+	 * Flags, see below.
+	 */
+	uint32_t flags;
+
+	uint8_t mq_qindex;
+
 	/*
 	 * Linkage to put dest on the FPM processing queue.
 	 */
@@ -218,12 +289,31 @@ typedef struct rib_dest_t_ {
 
 } rib_dest_t;
 
+/*
+ * Recursive resolution dependency: a nexthop of route entry 're' (on
+ * 're_node') looking for 'addr' resolved through 'resolver'.  When the
+ * route at the resolver, or a more specific one covering 'addr', changes,
+ * only the route entries indexed here are re-resolved.
+ */
+struct rib_nh_dep {
+	struct route_entry *re;
+	struct route_node *re_node;
+	rib_dest_t *resolver;
+	struct prefix addr;
+
+	struct re_nh_deps_item re_item;
+	struct rib_nh_dependents_item resolver_item;
+};
+
 DECLARE_LIST(rnh_list, struct rnh, rnh_list_item);
 DECLARE_LIST(re_list, struct route_entry, next);
+DECLARE_LIST(re_nh_deps, struct rib_nh_dep, re_item);
+DECLARE_DLIST(rib_nh_dependents, struct rib_nh_dep, resolver_item);
+DECLARE_DLIST(mq_runq, struct meta_queue_subq, runq_item);
 
 #define RIB_ROUTE_QUEUED(x)	(1 << (x))
 // If MQ_SIZE is modified this value needs to be updated.
-#define RIB_ROUTE_ANY_QUEUED 0x3F
+#define RIB_ROUTE_ANY_QUEUED 0x7F
 
 /*
  * The maximum qindex that can be used.
@@ -303,6 +393,13 @@ struct rib_table_info {
 	afi_t afi;
 	safi_t safi;
 	uint32_t table_id;
+
+	/*
+	 * Number of rib_dest_t and route entries hanging off the table,
+	 * used to account its memory footprint.
+	 */
+	uint32_t dest_count;
+	uint32_t re_count;
 };
 
 enum rib_tables_iter_state {
@@ -399,6 +496,7 @@ extern struct route_entry *rib_lookup_ipv4(struct prefix_ipv4 *p,
 					   vrf_id_t vrf_id);
 
 extern void rib_update(enum rib_update_event event);
+extern void rib_update_debounce(enum rib_update_event event);
 extern void rib_update_vrf(vrf_id_t vrf_id, enum rib_update_event event);
 extern void rib_update_table(struct route_table *table,
 			     enum rib_update_event event);
@@ -417,7 +515,14 @@ struct nhg_ctx; /* Forward declaration */
 
 extern int rib_queue_nhg_add(struct nhg_ctx *ctx);
 
+extern void rib_nh_dep_add(struct route_entry *re, struct route_node *re_node,
+			   struct route_node *resolver,
+			   const struct prefix *addr);
+extern void rib_nh_deps_clear(struct route_entry *re);
+
 extern void meta_queue_free(struct meta_queue *mq);
+extern void meta_queue_vrf_flush(struct meta_queue *mq,
+				struct zebra_vrf *zvrf);
 extern int zebra_rib_labeled_unicast(struct route_entry *re);
 extern struct route_table *rib_table_ipv6;
 
@@ -441,6 +546,18 @@ static inline struct rib_table_info *rib_table_info(struct route_table *table)
 	return (struct rib_table_info *)route_table_get_info(table);
 }
 
+/*
+ * rib_rnode_table_info
+ *
+ * Table info of the main table a (possibly source-specific) route node
+ * belongs to.
+ */
+static inline struct rib_table_info *
+rib_rnode_table_info(struct route_node *rn)
+{
+	return (struct rib_table_info *)srcdest_rnode_table_info(rn);
+}
+
 /*
  * rib_dest_from_rnode
  */
@@ -1068,8 +1068,8 @@ int netlink_route_read(struct zebra_ns *zns)
 	ret = netlink_request_route(zns, AF_INET, RTM_GETROUTE);
 	if (ret < 0)
 		return ret;
-	ret = netlink_parse_info(netlink_route_change_read_unicast,
-				 &zns->netlink_cmd, &dp_info, 0, 1);
+	ret = netlink_parse_dump(netlink_route_change_read_unicast,
+				 &zns->netlink_cmd, &dp_info, 1);
 	if (ret < 0)
 		return ret;
 
@@ -1077,8 +1077,8 @@ int netlink_route_read(struct zebra_ns *zns)
 	ret = netlink_request_route(zns, AF_INET6, RTM_GETROUTE);
 	if (ret < 0)
 		return ret;
-	ret = netlink_parse_info(netlink_route_change_read_unicast,
-				 &zns->netlink_cmd, &dp_info, 0, 1);
+	ret = netlink_parse_dump(netlink_route_change_read_unicast,
+				 &zns->netlink_cmd, &dp_info, 1);
 	if (ret < 0)
 		return ret;
 
@@ -3493,8 +3493,8 @@ int netlink_neigh_read(struct zebra_ns *zns)
 				    0);
 	if (ret < 0)
 		return ret;
-	ret = netlink_parse_info(netlink_neigh_table, &zns->netlink_cmd,
-				 &dp_info, 0, 1);
+	ret = netlink_parse_dump(netlink_neigh_table, &zns->netlink_cmd,
+				 &dp_info, 1);
 
 	return ret;
 }
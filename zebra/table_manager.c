@@ -60,11 +60,26 @@ struct table_manager tbl_mgr;
 DEFINE_MGROUP(TABLE_MGR, "Table Manager");
 DEFINE_MTYPE_STATIC(TABLE_MGR, TM_CHUNK, "Table Manager Chunk");
 
-static void delete_table_chunk(void *val)
+static int tm_chunk_cmp(const struct table_manager_chunk *a,
+			const struct table_manager_chunk *b)
 {
-	XFREE(MTYPE_TM_CHUNK, val);
+	return numcmp(a->start, b->start);
 }
 
+DECLARE_RBTREE_UNIQ(tm_chunk_tree, struct table_manager_chunk, item,
+		    tm_chunk_cmp);
+
+static int tm_free_cmp(const struct table_manager_chunk *a,
+		       const struct table_manager_chunk *b)
+{
+	if (a->end - a->start != b->end - b->start)
+		return numcmp(a->end - a->start, b->end - b->start);
+	return numcmp(a->start, b->start);
+}
+
+DECLARE_RBTREE_UNIQ(tm_free_tree, struct table_manager_chunk, free_item,
+		    tm_free_cmp);
+
 /**
  * Init table manager
  */
@@ -72,16 +87,17 @@ void table_manager_enable(ns_id_t ns_id)
 {
 	if (ns_id != NS_DEFAULT)
 		return;
-	tbl_mgr.lc_list = list_new();
-	tbl_mgr.lc_list->del = delete_table_chunk;
+	tm_chunk_tree_init(&tbl_mgr.chunks);
+	tm_free_tree_init(&tbl_mgr.free);
+	tbl_mgr.last = NULL;
 	hook_register(zserv_client_close, release_daemon_table_chunks);
 }
 
 /**
  * Core function, assigns table chunks
  *
- * It first searches through the list to check if there's one available
- * (previously released). Otherwise it creates and assigns a new one
+ * It first checks if there's a previously released chunk of the requested
+ * size. Otherwise it creates and assigns a new one
  *
  * @param proto Daemon protocol of client, to identify the owner
  * @param instance Instance, to identify the owner
@@ -92,22 +108,31 @@ struct table_manager_chunk *assign_table_chunk(uint8_t proto, uint16_t instance,
 					       uint32_t size)
 {
 	struct table_manager_chunk *tmc;
-	struct listnode *node;
+	struct table_manager_chunk key = {};
 	uint32_t start;
 
+	if (size == 0)
+		return NULL;
+
 	/* first check if there's one available */
-	for (ALL_LIST_ELEMENTS_RO(tbl_mgr.lc_list, node, tmc)) {
-		if (tmc->proto == NO_PROTO
-		    && tmc->end - tmc->start + 1 == size) {
-			tmc->proto = proto;
-			tmc->instance = instance;
-			return tmc;
-		}
+	key.start = 0;
+	key.end = size - 1;
+	tmc = tm_free_tree_find_gteq(&tbl_mgr.free, &key);
+	if (tmc && tmc->end - tmc->start + 1 == size) {
+		tm_free_tree_del(&tbl_mgr.free, tmc);
+		tmc->proto = proto;
+		tmc->instance = instance;
+		return tmc;
 	}
+
+	if (tbl_mgr.last && tbl_mgr.last->end == RT_TABLE_ID_UNRESERVED_MAX) {
+		flog_err(EC_ZEBRA_TM_EXHAUSTED_IDS,
+			 "Reached max table id. Size %u", size);
+		return NULL;
+	}
+
 	/* otherwise create a new one */
 	tmc = XCALLOC(MTYPE_TM_CHUNK, sizeof(struct table_manager_chunk));
-	if (!tmc)
-		return NULL;
 
 	/* table RT IDs range are [1;252] and [256;0xffffffff]
 	 * - check if the requested range can be within the first range,
@@ -115,11 +140,10 @@ struct table_manager_chunk *assign_table_chunk(uint8_t proto, uint16_t instance,
 	 * - TODO : vrf-lites have their own table identifier.
 	 * In that case, table_id should be removed from the table range.
 	 */
-	if (list_isempty(tbl_mgr.lc_list))
+	if (!tbl_mgr.last)
 		start = RT_TABLE_ID_UNRESERVED_MIN;
 	else
-		start = ((struct table_manager_chunk *)listgetdata(
-			   listtail(tbl_mgr.lc_list)))->end + 1;
+		start = tbl_mgr.last->end + 1;
 
 #if !defined(GNU_LINUX)
 /* BSD systems
@@ -145,7 +169,8 @@ struct table_manager_chunk *assign_table_chunk(uint8_t proto, uint16_t instance,
 	tmc->end = tmc->start + size - 1;
 	tmc->proto = proto;
 	tmc->instance = instance;
-	listnode_add(tbl_mgr.lc_list, tmc);
+	tm_chunk_tree_add(&tbl_mgr.chunks, tmc);
+	tbl_mgr.last = tmc;
 
 	return tmc;
 }
@@ -162,27 +187,24 @@ struct table_manager_chunk *assign_table_chunk(uint8_t proto, uint16_t instance,
 int release_table_chunk(uint8_t proto, uint16_t instance, uint32_t start,
 			uint32_t end)
 {
-	struct listnode *node;
 	struct table_manager_chunk *tmc;
+	struct table_manager_chunk key = {};
 	int ret = -1;
 
-	/* check that size matches */
 	zlog_debug("Releasing table chunk: %u - %u", start, end);
-	/* find chunk and disown */
-	for (ALL_LIST_ELEMENTS_RO(tbl_mgr.lc_list, node, tmc)) {
-		if (tmc->start != start)
-			continue;
-		if (tmc->end != end)
-			continue;
-		if (tmc->proto != proto || tmc->instance != instance) {
+	/* find chunk, check that size matches, and disown */
+	key.start = start;
+	tmc = tm_chunk_tree_find(&tbl_mgr.chunks, &key);
+	if (tmc && tmc->end == end && tmc->proto != NO_PROTO) {
+		if (tmc->proto != proto || tmc->instance != instance)
 			flog_err(EC_ZEBRA_TM_DAEMON_MISMATCH,
 				 "%s: Daemon mismatch!!", __func__);
-			continue;
+		else {
+			tmc->proto = NO_PROTO;
+			tmc->instance = 0;
+			tm_free_tree_add(&tbl_mgr.free, tmc);
+			ret = 0;
 		}
-		tmc->proto = NO_PROTO;
-		tmc->instance = 0;
-		ret = 0;
-		break;
 	}
 	if (ret != 0)
 		flog_err(EC_ZEBRA_TM_UNRELEASED_CHUNK,
@@ -204,12 +226,11 @@ int release_daemon_table_chunks(struct zserv *client)
 {
 	uint8_t proto = client->proto;
 	uint16_t instance = client->instance;
-	struct listnode *node;
 	struct table_manager_chunk *tmc;
 	int count = 0;
 	int ret;
 
-	for (ALL_LIST_ELEMENTS_RO(tbl_mgr.lc_list, node, tmc)) {
+	frr_each (tm_chunk_tree, &tbl_mgr.chunks, tmc) {
 		if (tmc->proto == proto && tmc->instance == instance) {
 			ret = release_table_chunk(tmc->proto, tmc->instance,
 						  tmc->start, tmc->end);
@@ -227,5 +248,11 @@ void table_manager_disable(ns_id_t ns_id)
 {
 	if (ns_id != NS_DEFAULT)
 		return;
-	list_delete(&tbl_mgr.lc_list);
+	struct table_manager_chunk *tmc;
+
+	tm_free_tree_fini(&tbl_mgr.free);
+	while ((tmc = tm_chunk_tree_pop(&tbl_mgr.chunks)))
+		XFREE(MTYPE_TM_CHUNK, tmc);
+	tm_chunk_tree_fini(&tbl_mgr.chunks);
+	tbl_mgr.last = NULL;
 }
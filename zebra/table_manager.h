@@ -24,6 +24,7 @@
 #include "lib/linklist.h"
 #include "lib/thread.h"
 #include "lib/ns.h"
+#include "lib/typesafe.h"
 
 #include "zebra/zserv.h"
 
@@ -31,6 +32,9 @@
 extern "C" {
 #endif
 
+PREDECL_RBTREE_UNIQ(tm_chunk_tree);
+PREDECL_RBTREE_UNIQ(tm_free_tree);
+
 /*
  * Table chunk struct
  * Client daemon which the chunk belongs to can be identified by either
@@ -49,14 +53,20 @@ struct table_manager_chunk {
 	uint16_t instance;
 	uint32_t start; /* First table RT ID of the chunk */
 	uint32_t end;   /* Last table RT ID of the chunk */
+
+	struct tm_chunk_tree_item item;
+	struct tm_free_tree_item free_item;
 };
 
 /*
  * Main table manager struct
- * Holds a linked list of table chunks.
+ * Holds all table chunks sorted by start, the unowned ones indexed by
+ * size, and the last one (new chunks are always appended).
  */
 struct table_manager {
-	struct list *lc_list;
+	struct tm_chunk_tree_head chunks;
+	struct tm_free_tree_head free;
+	struct table_manager_chunk *last;
 };
 
 void table_manager_enable(ns_id_t ns_id);
@@ -117,6 +117,10 @@ static void zserv_encode_vrf(struct stream *s, struct zebra_vrf *zvrf)
 	stream_putw_at(s, 0, stream_get_endp(s));
 }
 
+/* VRF messages are sized exactly, there may be thousands of them queued */
+#define ZSERV_VRF_MSG_SIZE                                                     \
+	(ZEBRA_HEADER_SIZE + sizeof(struct vrf_data) + VRF_NAMSIZ)
+
 static int zserv_encode_nexthop(struct stream *s, struct nexthop *nexthop)
 {
 	stream_putl(s, nexthop->vrf_id);
@@ -184,7 +188,7 @@ int zsend_interface_add(struct zserv *client, struct interface *ifp)
 	zserv_encode_interface(s, ifp);
 
 	client->ifadd_cnt++;
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 /* Interface deletion from zebra daemon. */
@@ -196,31 +200,35 @@ int zsend_interface_delete(struct zserv *client, struct interface *ifp)
 	zserv_encode_interface(s, ifp);
 
 	client->ifdel_cnt++;
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
+/*
+ * VRF add and delete messages come in bursts when many VRFs are set up or
+ * a client connects, defer the write so that they go out together.
+ */
 int zsend_vrf_add(struct zserv *client, struct zebra_vrf *zvrf)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new(ZSERV_VRF_MSG_SIZE);
 
 	zclient_create_header(s, ZEBRA_VRF_ADD, zvrf_id(zvrf));
 	zserv_encode_vrf(s, zvrf);
 
 	client->vrfadd_cnt++;
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 /* VRF deletion from zebra daemon. */
 int zsend_vrf_delete(struct zserv *client, struct zebra_vrf *zvrf)
 
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new(ZSERV_VRF_MSG_SIZE);
 
 	zclient_create_header(s, ZEBRA_VRF_DELETE, zvrf_id(zvrf));
 	zserv_encode_vrf(s, zvrf);
 
 	client->vrfdel_cnt++;
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 int zsend_interface_link_params(struct zserv *client, struct interface *ifp)
@@ -246,7 +254,7 @@ int zsend_interface_link_params(struct zserv *client, struct interface *ifp)
 	/* Write packet size. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 /* Interface address is added/deleted. Send ZEBRA_INTERFACE_ADDRESS_ADD or
@@ -325,7 +333,7 @@ int zsend_interface_address(int cmd, struct zserv *client,
 	stream_putw_at(s, 0, stream_get_endp(s));
 
 	client->connected_rt_add_cnt++;
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 static int zsend_interface_nbr_address(int cmd, struct zserv *client,
@@ -356,7 +364,7 @@ static int zsend_interface_nbr_address(int cmd, struct zserv *client,
 	/* Write packet size. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 /* Interface address addition. */
@@ -464,7 +472,7 @@ int zsend_interface_vrf_update(struct zserv *client, struct interface *ifp,
 	stream_putw_at(s, 0, stream_get_endp(s));
 
 	client->if_vrfchg_cnt++;
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 /* Add new nbr connected IPv6 address */
@@ -537,7 +545,7 @@ int zsend_interface_update(int cmd, struct zserv *client, struct interface *ifp)
 	else
 		client->ifdown_cnt++;
 
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 int zsend_redistribute_route(int cmd, struct zserv *client,
@@ -650,7 +658,7 @@ int zsend_redistribute_route(int cmd, struct zserv *client,
 			   zebra_route_string(client->proto),
 			   zebra_route_string(api.type), api.vrf_id,
 			   &api.prefix);
-	return zserv_send_message(client, s);
+	return zserv_send_message_deferred(client, s);
 }
 
 /*
@@ -995,7 +1003,6 @@ int zsend_pw_update(struct zserv *client, struct zebra_pw *pw)
 int zsend_assign_label_chunk_response(struct zserv *client, vrf_id_t vrf_id,
 				      struct label_manager_chunk *lmc)
 {
-	int ret;
 	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_GET_LABEL_CHUNK, vrf_id);
@@ -1015,16 +1022,13 @@ int zsend_assign_label_chunk_response(struct zserv *client, vrf_id_t vrf_id,
 	/* Write packet size. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = writen(client->sock, s->data, stream_get_endp(s));
-	stream_free(s);
-	return ret;
+	return zserv_send_message(client, s);
 }
 
 /* Send response to a label manager connect request to client */
 int zsend_label_manager_connect_response(struct zserv *client, vrf_id_t vrf_id,
 					 unsigned short result)
 {
-	int ret;
 	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_LABEL_MANAGER_CONNECT, vrf_id);
@@ -1041,10 +1045,7 @@ int zsend_label_manager_connect_response(struct zserv *client, vrf_id_t vrf_id,
 	/* Write packet size. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	ret = writen(client->sock, s->data, stream_get_endp(s));
-	stream_free(s);
-
-	return ret;
+	return zserv_send_message(client, s);
 }
 
 /* Send response to a get table chunk request to client */
@@ -2242,6 +2243,8 @@ static void zread_vrf_unregister(ZAPI_HANDLER_ARGS)
 		vrf_bitmap_unset(client->redist_default[afi], zvrf_id(zvrf));
 		vrf_bitmap_unset(client->ridinfo[afi], zvrf_id(zvrf));
 	}
+
+	zebra_redistribute_index_update(client);
 }
 
 /*
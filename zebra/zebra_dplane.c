@@ -24,9 +24,12 @@
 #include "lib/libfrr.h"
 #include "lib/debug.h"
 #include "lib/frratomic.h"
+#include "lib/latency.h"
+#include "lib/pcounter.h"
 #include "lib/frr_pthread.h"
 #include "lib/memory.h"
 #include "lib/queue.h"
+#include "lib/fhash.h"
 #include "lib/zebra.h"
 #include "zebra/zebra_memory.h"
 #include "zebra/zebra_router.h"
@@ -36,6 +39,7 @@
 #include "zebra/rt.h"
 #include "zebra/debug.h"
 #include "zebra/zebra_pbr.h"
+#include "zebra/zebra_trace.h"
 #include "printfrr.h"
 
 /* Memory type for context blocks */
@@ -61,6 +65,11 @@ const uint32_t DPLANE_DEFAULT_MAX_QUEUED = 200;
 /* Default value for new work per cycle */
 const uint32_t DPLANE_DEFAULT_NEW_WORK = 100;
 
+/* Work waiting in provider queues, as a multiple of the incoming limit,
+ * beyond which zebra stops handing new work to the dataplane.
+ */
+#define DPLANE_BACKLOG_FACTOR 10
+
 /* Validation check macro for context blocks */
 /* #define DPLANE_DEBUG 1 */
 
@@ -258,6 +267,8 @@ struct dplane_rule_info {
 	struct dplane_ctx_rule old;
 };
 
+PREDECL_HASH(dplane_l2_pending);
+
 /*
  * The context block used to exchange info about route updates across
  * the boundary between the zebra main context (and pthread) and the
@@ -274,6 +285,17 @@ struct zebra_dplane_ctx {
 	/* Dplane provider id */
 	uint32_t zd_provider;
 
+	/* When the context was allocated */
+	struct timeval zd_alloc_time;
+
+	/* When the route was queued for rib processing, and when the
+	 * context was handed to the dataplane pthread; for the latency
+	 * histograms.
+	 */
+	struct timeval zd_rib_time;
+	struct timeval zd_enqueue_time;
+	struct timeval zd_ack_time;
+
 	/* Flags - used by providers, e.g. */
 	int zd_flags;
 
@@ -314,8 +336,88 @@ struct zebra_dplane_ctx {
 
 	/* Embedded list linkage */
 	TAILQ_ENTRY(zebra_dplane_ctx) zd_q_entries;
+
+	/* Linkage in the pending MAC/neighbor/VTEP update hash */
+	struct dplane_l2_pending_item zd_l2_item;
+};
+
+/*
+ * MAC, neighbor and VTEP flood-list updates that are still waiting in the
+ * incoming queue are indexed by the entry they change, so a newer update
+ * for the same entry replaces the queued one instead of being programmed
+ * right after it.  Installs and deletes of the same kind of entry
+ * supersede each other; neighbor state updates and discovery probes are
+ * never coalesced.
+ */
+enum dplane_l2_class {
+	DPLANE_L2_NONE = 0,
+	DPLANE_L2_MAC,
+	DPLANE_L2_NEIGH,
+	DPLANE_L2_VTEP,
 };
 
+static enum dplane_l2_class
+dplane_ctx_l2_class(const struct zebra_dplane_ctx *ctx)
+{
+	switch (ctx->zd_op) {
+	case DPLANE_OP_MAC_INSTALL:
+	case DPLANE_OP_MAC_DELETE:
+		return DPLANE_L2_MAC;
+	case DPLANE_OP_NEIGH_INSTALL:
+	case DPLANE_OP_NEIGH_DELETE:
+		return DPLANE_L2_NEIGH;
+	case DPLANE_OP_VTEP_ADD:
+	case DPLANE_OP_VTEP_DELETE:
+		return DPLANE_L2_VTEP;
+	default:
+		return DPLANE_L2_NONE;
+	}
+}
+
+static int dplane_l2_pending_cmp(const struct zebra_dplane_ctx *a,
+				 const struct zebra_dplane_ctx *b)
+{
+	enum dplane_l2_class cls = dplane_ctx_l2_class(a);
+
+	if (cls != dplane_ctx_l2_class(b))
+		return numcmp(cls, dplane_ctx_l2_class(b));
+	if (a->zd_ns_info.ns_id != b->zd_ns_info.ns_id)
+		return numcmp(a->zd_ns_info.ns_id, b->zd_ns_info.ns_id);
+	if (a->zd_ifindex != b->zd_ifindex)
+		return numcmp(a->zd_ifindex, b->zd_ifindex);
+
+	if (cls == DPLANE_L2_MAC) {
+		if (a->u.macinfo.vid != b->u.macinfo.vid)
+			return numcmp(a->u.macinfo.vid, b->u.macinfo.vid);
+		return memcmp(&a->u.macinfo.mac, &b->u.macinfo.mac, ETH_ALEN);
+	}
+	return ipaddr_cmp(&a->u.neigh.ip_addr, &b->u.neigh.ip_addr);
+}
+
+static uint32_t dplane_l2_pending_hash(const struct zebra_dplane_ctx *ctx)
+{
+	enum dplane_l2_class cls = dplane_ctx_l2_class(ctx);
+	const struct ipaddr *ip = &ctx->u.neigh.ip_addr;
+	struct fhash_state st;
+
+	fhash_init(&st, 0);
+	fhash_add_u32x2(&st, cls, ctx->zd_ns_info.ns_id);
+	fhash_add_u32(&st, ctx->zd_ifindex);
+
+	if (cls == DPLANE_L2_MAC) {
+		fhash_add_u32(&st, ctx->u.macinfo.vid);
+		fhash_add(&st, &ctx->u.macinfo.mac, ETH_ALEN);
+	} else if (IS_IPADDR_V4(ip))
+		fhash_add(&st, &ip->ipaddr_v4, sizeof(ip->ipaddr_v4));
+	else if (IS_IPADDR_V6(ip))
+		fhash_add(&st, &ip->ipaddr_v6, sizeof(ip->ipaddr_v6));
+
+	return fhash_final(&st);
+}
+
+DECLARE_HASH(dplane_l2_pending, struct zebra_dplane_ctx, zd_l2_item,
+	     dplane_l2_pending_cmp, dplane_l2_pending_hash);
+
 /* Flag that can be set by a pre-kernel provider as a signal that an update
  * should bypass the kernel.
  */
@@ -358,6 +460,11 @@ struct zebra_dplane_provider {
 	_Atomic uint32_t dp_out_max;
 	_Atomic uint32_t dp_error_counter;
 
+	/* Dedicated pthread, for providers with the PTHREAD flag */
+	struct frr_pthread *dp_pthread;
+	struct thread *dp_t_work;
+	_Atomic bool dp_running;
+
 	/* Queue of contexts inbound to the provider */
 	struct dplane_ctx_q dp_ctx_in_q;
 
@@ -389,6 +496,9 @@ static struct zebra_dplane_globals {
 	/* Update context queue inbound to the dataplane */
 	TAILQ_HEAD(zdg_ctx_q, zebra_dplane_ctx) dg_update_ctx_q;
 
+	/* MAC/neighbor/VTEP updates in dg_update_ctx_q, by entry */
+	struct dplane_l2_pending_head dg_l2_pending;
+
 	/* Ordered list of providers */
 	TAILQ_HEAD(zdg_prov_q, zebra_dplane_provider) dg_providers_q;
 
@@ -406,37 +516,52 @@ static struct zebra_dplane_globals {
 	 */
 	uint32_t dg_updates_per_cycle;
 
-	_Atomic uint32_t dg_routes_in;
+	struct pcounter dg_routes_in;
 	_Atomic uint32_t dg_routes_queued;
 	_Atomic uint32_t dg_routes_queued_max;
-	_Atomic uint32_t dg_route_errors;
-	_Atomic uint32_t dg_other_errors;
 
-	_Atomic uint32_t dg_nexthops_in;
-	_Atomic uint32_t dg_nexthop_errors;
+	/* Route update latencies: rib queue to dataplane, dataplane to
+	 * kernel ack, kernel ack to result processing, and end to end.
+	 */
+	struct latency_hist dg_lat_rib;
+	struct latency_hist dg_lat_kernel;
+	struct latency_hist dg_lat_result;
+	struct latency_hist dg_lat_total;
+	struct pcounter dg_route_errors;
+	struct pcounter dg_other_errors;
+
+	struct pcounter dg_nexthops_in;
+	struct pcounter dg_nexthop_errors;
+
+	struct pcounter dg_lsps_in;
+	struct pcounter dg_lsp_errors;
 
-	_Atomic uint32_t dg_lsps_in;
-	_Atomic uint32_t dg_lsp_errors;
+	struct pcounter dg_pws_in;
+	struct pcounter dg_pw_errors;
 
-	_Atomic uint32_t dg_pws_in;
-	_Atomic uint32_t dg_pw_errors;
+	struct pcounter dg_br_port_in;
+	struct pcounter dg_br_port_errors;
 
-	_Atomic uint32_t dg_br_port_in;
-	_Atomic uint32_t dg_br_port_errors;
+	struct pcounter dg_intf_addrs_in;
+	struct pcounter dg_intf_addr_errors;
 
-	_Atomic uint32_t dg_intf_addrs_in;
-	_Atomic uint32_t dg_intf_addr_errors;
+	struct pcounter dg_macs_in;
+	struct pcounter dg_mac_errors;
 
-	_Atomic uint32_t dg_macs_in;
-	_Atomic uint32_t dg_mac_errors;
+	struct pcounter dg_neighs_in;
+	struct pcounter dg_neigh_errors;
 
-	_Atomic uint32_t dg_neighs_in;
-	_Atomic uint32_t dg_neigh_errors;
+	/* MAC/neighbor/VTEP updates replaced by a newer one while queued */
+	struct pcounter dg_l2_coalesced;
 
-	_Atomic uint32_t dg_rules_in;
-	_Atomic uint32_t dg_rule_errors;
+	struct pcounter dg_rules_in;
+	struct pcounter dg_rule_errors;
 
-	_Atomic uint32_t dg_update_yields;
+	struct pcounter dg_update_yields;
+
+	/* Contexts waiting in provider inbound queues */
+	_Atomic uint32_t dg_prov_backlog;
+	struct pcounter dg_backlog_stalls;
 
 	/* Dataplane pthread */
 	struct frr_pthread *dg_pthread;
@@ -452,6 +577,35 @@ static struct zebra_dplane_globals {
 
 } zdplane_info;
 
+/* Event counters listed by "show counters" */
+static const struct {
+	struct pcounter *pc;
+	const char *name;
+} dplane_counters[] = {
+	{ &zdplane_info.dg_routes_in, "dplane route updates" },
+	{ &zdplane_info.dg_route_errors, "dplane route errors" },
+	{ &zdplane_info.dg_other_errors, "dplane other errors" },
+	{ &zdplane_info.dg_nexthops_in, "dplane nexthop updates" },
+	{ &zdplane_info.dg_nexthop_errors, "dplane nexthop errors" },
+	{ &zdplane_info.dg_lsps_in, "dplane LSP updates" },
+	{ &zdplane_info.dg_lsp_errors, "dplane LSP errors" },
+	{ &zdplane_info.dg_pws_in, "dplane PW updates" },
+	{ &zdplane_info.dg_pw_errors, "dplane PW errors" },
+	{ &zdplane_info.dg_br_port_in, "dplane bridge port updates" },
+	{ &zdplane_info.dg_br_port_errors, "dplane bridge port errors" },
+	{ &zdplane_info.dg_intf_addrs_in, "dplane intf addr updates" },
+	{ &zdplane_info.dg_intf_addr_errors, "dplane intf addr errors" },
+	{ &zdplane_info.dg_macs_in, "dplane EVPN MAC updates" },
+	{ &zdplane_info.dg_mac_errors, "dplane EVPN MAC errors" },
+	{ &zdplane_info.dg_neighs_in, "dplane EVPN neigh updates" },
+	{ &zdplane_info.dg_neigh_errors, "dplane EVPN neigh errors" },
+	{ &zdplane_info.dg_l2_coalesced, "dplane EVPN updates coalesced" },
+	{ &zdplane_info.dg_rules_in, "dplane rule updates" },
+	{ &zdplane_info.dg_rule_errors, "dplane rule errors" },
+	{ &zdplane_info.dg_update_yields, "dplane update yields" },
+	{ &zdplane_info.dg_backlog_stalls, "dplane backlog stalls" },
+};
+
 /*
  * Lock and unlock for interactions with the zebra 'core' pthread
  */
@@ -467,6 +621,7 @@ static struct zebra_dplane_globals {
 
 /* Prototypes */
 static int dplane_thread_loop(struct thread *event);
+static int dplane_provider_thread(struct thread *event);
 static void dplane_info_from_zns(struct zebra_dplane_info *ns_info,
 				 struct zebra_ns *zns);
 static enum zebra_dplane_result lsp_update_internal(zebra_lsp_t *lsp,
@@ -510,6 +665,7 @@ struct zebra_dplane_ctx *dplane_ctx_alloc(void)
 	 * a pool
 	 */
 	p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+	monotime(&p->zd_alloc_time);
 
 	return p;
 }
@@ -742,6 +898,33 @@ enum zebra_dplane_result dplane_ctx_get_status(
 	return ctx->zd_status;
 }
 
+/* Time since the context was allocated, in microseconds */
+uint64_t dplane_ctx_get_age_usec(const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	return monotime_since(&ctx->zd_alloc_time, NULL);
+}
+
+/* The kernel acknowledged the update, called from the dataplane pthread */
+void dplane_ctx_latency_ack(struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	monotime(&ctx->zd_ack_time);
+	latency_hist_add_since(&zdplane_info.dg_lat_kernel,
+			       &ctx->zd_enqueue_time);
+}
+
+/* The zebra main pthread is done with the result of a route update */
+void dplane_ctx_latency_done(struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	latency_hist_add_since(&zdplane_info.dg_lat_result, &ctx->zd_ack_time);
+	latency_hist_add_since(&zdplane_info.dg_lat_total, &ctx->zd_rib_time);
+}
+
 void dplane_ctx_set_status(struct zebra_dplane_ctx *ctx,
 			   enum zebra_dplane_result status)
 {
@@ -1918,6 +2101,25 @@ uint32_t dplane_get_in_queue_len(void)
 				    memory_order_seq_cst);
 }
 
+/*
+ * Check whether the provider pipeline is backed up
+ */
+bool dplane_is_backlogged(void)
+{
+	uint32_t backlog, limit;
+
+	backlog = atomic_load_explicit(&zdplane_info.dg_prov_backlog,
+				       memory_order_relaxed);
+	limit = atomic_load_explicit(&zdplane_info.dg_max_queued_updates,
+				     memory_order_relaxed);
+
+	if (backlog <= limit * DPLANE_BACKLOG_FACTOR)
+		return false;
+
+	pcounter_inc(&zdplane_info.dg_backlog_stalls);
+	return true;
+}
+
 /*
  * Common dataplane context init with zebra namespace info.
  */
@@ -1964,6 +2166,7 @@ int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 
 	ctx->zd_op = op;
 	ctx->zd_status = ZEBRA_DPLANE_REQUEST_SUCCESS;
+	ctx->zd_rib_time = rib_dest_from_rnode(rn)->mq_queued;
 
 	ctx->u.rinfo.zd_type = re->type;
 	ctx->u.rinfo.zd_old_type = re->type;
@@ -2060,7 +2263,8 @@ int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 
 #ifdef HAVE_NETLINK
 	{
-		struct nhg_hash_entry *nhe = zebra_nhg_resolve(re->nhe);
+		struct nhg_hash_entry *nhe =
+			zebra_nhg_kernel_nhe(zebra_nhg_resolve(re->nhe));
 
 		ctx->u.rinfo.nhe.id = nhe->id;
 		ctx->u.rinfo.nhe.old_id = 0;
@@ -2406,21 +2610,56 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 {
 	int ret = EINVAL;
 	uint32_t high, curr;
+	struct zebra_dplane_ctx *old = NULL;
 
-	/* Enqueue for processing by the dataplane pthread */
+	monotime(&ctx->zd_enqueue_time);
+	latency_hist_add_since(&zdplane_info.dg_lat_rib, &ctx->zd_rib_time);
+
+	/* Enqueue for processing by the dataplane pthread; a queued update
+	 * for the same L2 entry is dropped, the new one goes to the tail so
+	 * it is still ordered after everything enqueued before it.
+	 */
 	DPLANE_LOCK();
 	{
+		if (dplane_ctx_l2_class(ctx) != DPLANE_L2_NONE) {
+			old = dplane_l2_pending_find(
+				&zdplane_info.dg_l2_pending, ctx);
+			if (old) {
+				dplane_l2_pending_del(
+					&zdplane_info.dg_l2_pending, old);
+				TAILQ_REMOVE(&zdplane_info.dg_update_ctx_q,
+					     old, zd_q_entries);
+			}
+			dplane_l2_pending_add(&zdplane_info.dg_l2_pending,
+					      ctx);
+		}
+
 		TAILQ_INSERT_TAIL(&zdplane_info.dg_update_ctx_q, ctx,
 				  zd_q_entries);
 	}
 	DPLANE_UNLOCK();
 
+	if (old) {
+		if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+			zlog_debug("dplane: %s replaces queued %s on %s",
+				   dplane_op2str(ctx->zd_op),
+				   dplane_op2str(old->zd_op), ctx->zd_ifname);
+
+		pcounter_inc(&zdplane_info.dg_l2_coalesced);
+		dplane_ctx_free(&old);
+
+		/* The queue depth didn't change */
+		return dplane_provider_work_ready();
+	}
+
 	curr = atomic_fetch_add_explicit(
 		&(zdplane_info.dg_routes_queued),
 		1, memory_order_seq_cst);
 
 	curr++;	/* We got the pre-incremented value */
 
+	frrtrace(2, frr_zebra, dplane_enqueue, ctx, curr);
+
 	/* Maybe update high-water counter also */
 	high = atomic_load_explicit(&zdplane_info.dg_routes_queued_max,
 				    memory_order_seq_cst);
@@ -2535,14 +2774,12 @@ dplane_route_update_internal(struct route_node *rn,
 	}
 
 	/* Update counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_routes_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_routes_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
-		atomic_fetch_add_explicit(&zdplane_info.dg_route_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_route_errors);
 		if (ctx)
 			dplane_ctx_free(&ctx);
 	}
@@ -2578,14 +2815,12 @@ dplane_nexthop_update_internal(struct nhg_hash_entry *nhe, enum dplane_op_e op)
 
 done:
 	/* Update counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_nexthops_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_nexthops_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
-		atomic_fetch_add_explicit(&zdplane_info.dg_nexthop_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_nexthop_errors);
 		if (ctx)
 			dplane_ctx_free(&ctx);
 	}
@@ -2883,14 +3118,12 @@ dplane_lsp_notif_update(zebra_lsp_t *lsp,
 
 done:
 	/* Update counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_lsps_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_lsps_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
-		atomic_fetch_add_explicit(&zdplane_info.dg_lsp_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_lsp_errors);
 		if (ctx)
 			dplane_ctx_free(&ctx);
 	}
@@ -2934,14 +3167,12 @@ static enum zebra_dplane_result lsp_update_internal(zebra_lsp_t *lsp,
 
 done:
 	/* Update counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_lsps_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_lsps_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
-		atomic_fetch_add_explicit(&zdplane_info.dg_lsp_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_lsp_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -2968,14 +3199,12 @@ static enum zebra_dplane_result pw_update_internal(struct zebra_pw *pw,
 
 done:
 	/* Update counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_pws_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_pws_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
-		atomic_fetch_add_explicit(&zdplane_info.dg_pw_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_pw_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -3041,15 +3270,13 @@ dplane_br_port_update(const struct interface *ifp, bool non_df,
 	ret = dplane_update_enqueue(ctx);
 
 	/* Increment counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_br_port_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_br_port_in);
 
 	if (ret == AOK) {
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	} else {
 		/* Error counter */
-		atomic_fetch_add_explicit(&zdplane_info.dg_br_port_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_br_port_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -3160,15 +3387,13 @@ static enum zebra_dplane_result intf_addr_update_internal(
 	ret = dplane_update_enqueue(ctx);
 
 	/* Increment counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_intf_addrs_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_intf_addrs_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
 		/* Error counter */
-		atomic_fetch_add_explicit(&zdplane_info.dg_intf_addr_errors,
-					  1, memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_intf_addr_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -3326,15 +3551,13 @@ mac_update_common(enum dplane_op_e op,
 	ret = dplane_update_enqueue(ctx);
 
 	/* Increment counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_macs_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_macs_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
 		/* Error counter */
-		atomic_fetch_add_explicit(&zdplane_info.dg_mac_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_mac_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -3526,15 +3749,13 @@ neigh_update_internal(enum dplane_op_e op,
 	ret = dplane_update_enqueue(ctx);
 
 	/* Increment counter */
-	atomic_fetch_add_explicit(&zdplane_info.dg_neighs_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_neighs_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
 		/* Error counter */
-		atomic_fetch_add_explicit(&zdplane_info.dg_neigh_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_neigh_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -3561,14 +3782,12 @@ rule_update_internal(enum dplane_op_e op, struct zebra_pbr_rule *new_rule,
 	ret = dplane_update_enqueue(ctx);
 
 done:
-	atomic_fetch_add_explicit(&zdplane_info.dg_rules_in, 1,
-				  memory_order_relaxed);
+	pcounter_inc(&zdplane_info.dg_rules_in);
 
 	if (ret == AOK)
 		result = ZEBRA_DPLANE_REQUEST_QUEUED;
 	else {
-		atomic_fetch_add_explicit(&zdplane_info.dg_rule_errors, 1,
-					  memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_rule_errors);
 		dplane_ctx_free(&ctx);
 	}
 
@@ -3600,22 +3819,18 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 		other_errs;
 
 	/* Using atomics because counters are being changed in different
-	 * pthread contexts.
+	 * pthread contexts; the event counters are per-pthread.
 	 */
-	incoming = atomic_load_explicit(&zdplane_info.dg_routes_in,
-					memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_routes_in);
 	limit = atomic_load_explicit(&zdplane_info.dg_max_queued_updates,
 				     memory_order_relaxed);
 	queued = atomic_load_explicit(&zdplane_info.dg_routes_queued,
 				      memory_order_relaxed);
 	queue_max = atomic_load_explicit(&zdplane_info.dg_routes_queued_max,
 					 memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_route_errors,
-				    memory_order_relaxed);
-	yields = atomic_load_explicit(&zdplane_info.dg_update_yields,
-				      memory_order_relaxed);
-	other_errs = atomic_load_explicit(&zdplane_info.dg_other_errors,
-					  memory_order_relaxed);
+	errs = pcounter_read(&zdplane_info.dg_route_errors);
+	yields = pcounter_read(&zdplane_info.dg_update_yields);
+	other_errs = pcounter_read(&zdplane_info.dg_other_errors);
 
 	vty_out(vty, "Zebra dataplane:\nRoute updates:            %"PRIu64"\n",
 		incoming);
@@ -3626,55 +3841,63 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 	vty_out(vty, "Route update queue max:   %"PRIu64"\n", queue_max);
 	vty_out(vty, "Dplane update yields:     %"PRIu64"\n", yields);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_lsps_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_lsp_errors,
-				    memory_order_relaxed);
+	queued = atomic_load_explicit(&zdplane_info.dg_prov_backlog,
+				      memory_order_relaxed);
+	errs = pcounter_read(&zdplane_info.dg_backlog_stalls);
+	vty_out(vty, "Provider backlog:         %"PRIu64"\n", queued);
+	vty_out(vty, "Backlog stalls:           %"PRIu64"\n", errs);
+
+	incoming = pcounter_read(&zdplane_info.dg_lsps_in);
+	errs = pcounter_read(&zdplane_info.dg_lsp_errors);
 	vty_out(vty, "LSP updates:              %"PRIu64"\n", incoming);
 	vty_out(vty, "LSP update errors:        %"PRIu64"\n", errs);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_pws_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_pw_errors,
-				    memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_pws_in);
+	errs = pcounter_read(&zdplane_info.dg_pw_errors);
 	vty_out(vty, "PW updates:               %"PRIu64"\n", incoming);
 	vty_out(vty, "PW update errors:         %"PRIu64"\n", errs);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_intf_addrs_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_intf_addr_errors,
-				    memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_intf_addrs_in);
+	errs = pcounter_read(&zdplane_info.dg_intf_addr_errors);
 	vty_out(vty, "Intf addr updates:        %"PRIu64"\n", incoming);
 	vty_out(vty, "Intf addr errors:         %"PRIu64"\n", errs);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_macs_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_mac_errors,
-				    memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_macs_in);
+	errs = pcounter_read(&zdplane_info.dg_mac_errors);
 	vty_out(vty, "EVPN MAC updates:         %"PRIu64"\n", incoming);
 	vty_out(vty, "EVPN MAC errors:          %"PRIu64"\n", errs);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_neighs_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_neigh_errors,
-				    memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_neighs_in);
+	errs = pcounter_read(&zdplane_info.dg_neigh_errors);
 	vty_out(vty, "EVPN neigh updates:       %"PRIu64"\n", incoming);
 	vty_out(vty, "EVPN neigh errors:        %"PRIu64"\n", errs);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_rules_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_rule_errors,
-				    memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_l2_coalesced);
+	vty_out(vty, "EVPN updates coalesced:   %"PRIu64"\n", incoming);
+
+	incoming = pcounter_read(&zdplane_info.dg_rules_in);
+	errs = pcounter_read(&zdplane_info.dg_rule_errors);
 	vty_out(vty, "Rule updates:             %" PRIu64 "\n", incoming);
 	vty_out(vty, "Rule errors:              %" PRIu64 "\n", errs);
 
-	incoming = atomic_load_explicit(&zdplane_info.dg_br_port_in,
-					memory_order_relaxed);
-	errs = atomic_load_explicit(&zdplane_info.dg_br_port_errors,
-				    memory_order_relaxed);
+	incoming = pcounter_read(&zdplane_info.dg_br_port_in);
+	errs = pcounter_read(&zdplane_info.dg_br_port_errors);
 	vty_out(vty, "Bridge port updates:      %" PRIu64 "\n", incoming);
 	vty_out(vty, "Bridge port errors:       %" PRIu64 "\n", errs);
 
+	if (detailed) {
+		vty_out(vty, "\n");
+		latency_hist_show_header(vty, "Route update latency");
+		latency_hist_show(vty, "rib queue to dplane",
+				  &zdplane_info.dg_lat_rib);
+		latency_hist_show(vty, "dplane to kernel ack",
+				  &zdplane_info.dg_lat_kernel);
+		latency_hist_show(vty, "kernel ack to result",
+				  &zdplane_info.dg_lat_result);
+		latency_hist_show(vty, "rib queue to result",
+				  &zdplane_info.dg_lat_total);
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -3706,8 +3929,9 @@ int dplane_show_provs_helper(struct vty *vty, bool detailed)
 
 		vty_out(vty,
 			"%s (%u): in: %" PRIu64 ", q_max: %" PRIu64
-			", out: %" PRIu64 ", q_max: %" PRIu64 "\n",
-			prov->dp_name, prov->dp_id, in, in_max, out, out_max);
+			", out: %" PRIu64 ", q_max: %" PRIu64 "%s\n",
+			prov->dp_name, prov->dp_id, in, in_max, out, out_max,
+			prov->dp_pthread ? ", own pthread" : "");
 
 		DPLANE_LOCK();
 		prov = TAILQ_NEXT(prov, dp_prov_link);
@@ -3860,6 +4084,8 @@ struct zebra_dplane_ctx *dplane_provider_dequeue_in_ctx(
 
 		atomic_fetch_sub_explicit(&prov->dp_in_queued, 1,
 					  memory_order_relaxed);
+		atomic_fetch_sub_explicit(&zdplane_info.dg_prov_backlog, 1,
+					  memory_order_relaxed);
 	}
 
 	dplane_provider_unlock(prov);
@@ -3891,9 +4117,12 @@ int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
 		}
 	}
 
-	if (ret > 0)
+	if (ret > 0) {
 		atomic_fetch_sub_explicit(&prov->dp_in_queued, ret,
 					  memory_order_relaxed);
+		atomic_fetch_sub_explicit(&zdplane_info.dg_prov_backlog, ret,
+					  memory_order_relaxed);
+	}
 
 	dplane_provider_unlock(prov);
 
@@ -3922,7 +4151,8 @@ void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
  */
 bool dplane_provider_is_threaded(const struct zebra_dplane_provider *prov)
 {
-	return (prov->dp_flags & DPLANE_PROV_FLAG_THREADED);
+	return (prov->dp_flags
+		& (DPLANE_PROV_FLAG_THREADED | DPLANE_PROV_FLAG_PTHREAD));
 }
 
 /*
@@ -4076,8 +4306,7 @@ static void kernel_dplane_handle_result(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_ROUTE_UPDATE:
 	case DPLANE_OP_ROUTE_DELETE:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_route_errors,
-						  1, memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_route_errors);
 
 		if ((dplane_ctx_get_op(ctx) != DPLANE_OP_ROUTE_DELETE)
 		    && (res == ZEBRA_DPLANE_REQUEST_SUCCESS)) {
@@ -4105,39 +4334,32 @@ static void kernel_dplane_handle_result(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NH_UPDATE:
 	case DPLANE_OP_NH_DELETE:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(
-				&zdplane_info.dg_nexthop_errors, 1,
-				memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_nexthop_errors);
 		break;
 
 	case DPLANE_OP_LSP_INSTALL:
 	case DPLANE_OP_LSP_UPDATE:
 	case DPLANE_OP_LSP_DELETE:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_lsp_errors,
-						  1, memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_lsp_errors);
 		break;
 
 	case DPLANE_OP_PW_INSTALL:
 	case DPLANE_OP_PW_UNINSTALL:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_pw_errors, 1,
-						  memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_pw_errors);
 		break;
 
 	case DPLANE_OP_ADDR_INSTALL:
 	case DPLANE_OP_ADDR_UNINSTALL:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(
-				&zdplane_info.dg_intf_addr_errors, 1,
-				memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_intf_addr_errors);
 		break;
 
 	case DPLANE_OP_MAC_INSTALL:
 	case DPLANE_OP_MAC_DELETE:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_mac_errors,
-						  1, memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_mac_errors);
 		break;
 
 	case DPLANE_OP_NEIGH_INSTALL:
@@ -4147,16 +4369,14 @@ static void kernel_dplane_handle_result(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_VTEP_DELETE:
 	case DPLANE_OP_NEIGH_DISCOVER:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_neigh_errors,
-						  1, memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_neigh_errors);
 		break;
 
 	case DPLANE_OP_RULE_ADD:
 	case DPLANE_OP_RULE_DELETE:
 	case DPLANE_OP_RULE_UPDATE:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_rule_errors,
-						  1, memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_rule_errors);
 		break;
 
 	/* Ignore 'notifications' - no-op */
@@ -4169,8 +4389,7 @@ static void kernel_dplane_handle_result(struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_NONE:
 		if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-			atomic_fetch_add_explicit(&zdplane_info.dg_other_errors,
-						  1, memory_order_relaxed);
+			pcounter_inc(&zdplane_info.dg_other_errors);
 		break;
 	}
 }
@@ -4220,8 +4439,7 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 			zlog_debug("dplane provider '%s' reached max updates %d",
 				   dplane_provider_get_name(prov), counter);
 
-		atomic_fetch_add_explicit(&zdplane_info.dg_update_yields,
-					  1, memory_order_relaxed);
+		pcounter_inc(&zdplane_info.dg_update_yields);
 
 		dplane_provider_work_ready();
 	}
@@ -4303,7 +4521,7 @@ static void dplane_provider_init(void)
 
 	ret = dplane_provider_register("Kernel",
 				       DPLANE_PRIO_KERNEL,
-				       DPLANE_PROV_FLAGS_DEFAULT, NULL,
+				       DPLANE_PROV_FLAG_PTHREAD, NULL,
 				       kernel_dplane_process_func,
 				       NULL,
 				       NULL, NULL);
@@ -4406,6 +4624,12 @@ static bool dplane_work_pending(void)
 		if (ctx != NULL)
 			break;
 
+		if (atomic_load_explicit(&prov->dp_running,
+					 memory_order_relaxed)) {
+			ret = true;
+			goto done;
+		}
+
 		DPLANE_LOCK();
 		prov = TAILQ_NEXT(prov, dp_prov_link);
 		DPLANE_UNLOCK();
@@ -4469,6 +4693,40 @@ void zebra_dplane_finish(void)
 			 &zdplane_info.dg_t_shutdown_check);
 }
 
+/*
+ * Work callback for a provider running on its own pthread. Completed work
+ * is picked up by the main dataplane loop, which is woken for it.
+ */
+static int dplane_provider_thread(struct thread *event)
+{
+	struct zebra_dplane_provider *prov = THREAD_ARG(event);
+	bool done;
+
+	if (!zdplane_info.dg_run)
+		return 0;
+
+	atomic_store_explicit(&prov->dp_running, true, memory_order_relaxed);
+
+	(*prov->dp_fp)(prov);
+
+	dplane_provider_lock(prov);
+	done = (TAILQ_FIRST(&(prov->dp_ctx_out_q)) != NULL);
+	dplane_provider_unlock(prov);
+
+	atomic_store_explicit(&prov->dp_running, false, memory_order_relaxed);
+
+	if (done)
+		dplane_provider_work_ready();
+
+	/* More than one cycle's worth was waiting: keep going */
+	if (atomic_load_explicit(&prov->dp_in_queued, memory_order_relaxed))
+		thread_add_event(prov->dp_pthread->master,
+				 dplane_provider_thread, prov, 0,
+				 &prov->dp_t_work);
+
+	return 0;
+}
+
 /*
  * Main dataplane pthread event loop. The thread takes new incoming work
  * and offers it to the first provider. It then iterates through the
@@ -4515,6 +4773,9 @@ static int dplane_thread_loop(struct thread *event)
 		if (ctx) {
 			TAILQ_REMOVE(&zdplane_info.dg_update_ctx_q, ctx,
 				     zd_q_entries);
+			if (dplane_ctx_l2_class(ctx) != DPLANE_L2_NONE)
+				dplane_l2_pending_del(
+					&zdplane_info.dg_l2_pending, ctx);
 
 			ctx->zd_provider = prov->dp_id;
 
@@ -4580,6 +4841,8 @@ static int dplane_thread_loop(struct thread *event)
 					  memory_order_relaxed);
 		atomic_fetch_add_explicit(&prov->dp_in_queued, counter,
 					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&zdplane_info.dg_prov_backlog,
+					  counter, memory_order_relaxed);
 		curr = atomic_load_explicit(&prov->dp_in_queued,
 					    memory_order_relaxed);
 		high = atomic_load_explicit(&prov->dp_in_max,
@@ -4598,9 +4861,15 @@ static int dplane_thread_loop(struct thread *event)
 
 		/* Call into the provider code. Note that this is
 		 * unconditional: we offer to do work even if we don't enqueue
-		 * any _new_ work.
+		 * any _new_ work. Providers with their own pthread are kicked
+		 * and their results collected on a later pass.
 		 */
-		(*prov->dp_fp)(prov);
+		if (prov->dp_pthread)
+			thread_add_event(prov->dp_pthread->master,
+					 dplane_provider_thread, prov, 0,
+					 &prov->dp_t_work);
+		else
+			(*prov->dp_fp)(prov);
 
 		/* Check for zebra shutdown */
 		if (!zdplane_info.dg_run)
@@ -4686,6 +4955,19 @@ void zebra_dplane_shutdown(void)
 	zdplane_info.dg_pthread = NULL;
 	zdplane_info.dg_master = NULL;
 
+	/* And the providers' own pthreads */
+	TAILQ_FOREACH(dp, &zdplane_info.dg_providers_q, dp_prov_link) {
+		if (dp->dp_pthread == NULL)
+			continue;
+
+		if (dp->dp_t_work)
+			thread_cancel_async(dp->dp_pthread->master,
+					    &dp->dp_t_work, NULL);
+		frr_pthread_stop(dp->dp_pthread, NULL);
+		frr_pthread_destroy(dp->dp_pthread);
+		dp->dp_pthread = NULL;
+	}
+
 	/* Notify provider(s) of final shutdown.
 	 * Note that this call is in the main pthread, so providers must
 	 * be prepared for that.
@@ -4697,6 +4979,9 @@ void zebra_dplane_shutdown(void)
 		dp->dp_fini(dp, false);
 	}
 
+	for (unsigned int i = 0; i < array_size(dplane_counters); i++)
+		pcounter_unregister(dplane_counters[i].pc);
+
 	/* TODO -- Clean-up provider objects */
 
 	/* TODO -- Clean queue(s), free memory */
@@ -4709,19 +4994,46 @@ static void zebra_dplane_init_internal(void)
 {
 	memset(&zdplane_info, 0, sizeof(zdplane_info));
 
+	/* one per route update */
+	qmem_slab_enable(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+
 	pthread_mutex_init(&zdplane_info.dg_mutex, NULL);
 
 	TAILQ_INIT(&zdplane_info.dg_update_ctx_q);
+	dplane_l2_pending_init(&zdplane_info.dg_l2_pending);
 	TAILQ_INIT(&zdplane_info.dg_providers_q);
 
 	zdplane_info.dg_updates_per_cycle = DPLANE_DEFAULT_NEW_WORK;
 
 	zdplane_info.dg_max_queued_updates = DPLANE_DEFAULT_MAX_QUEUED;
 
+	for (unsigned int i = 0; i < array_size(dplane_counters); i++)
+		pcounter_register(dplane_counters[i].pc,
+				  dplane_counters[i].name);
+
 	/* Register default kernel 'provider' during init */
 	dplane_provider_init();
 }
 
+/*
+ * Create and run the dedicated pthread of a provider
+ */
+static void dplane_provider_pthread_start(struct zebra_dplane_provider *prov)
+{
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop
+	};
+	char name[DPLANE_PROVIDER_NAMELEN + 16];
+	char os_name[OS_THREAD_NAMELEN];
+
+	snprintf(name, sizeof(name), "Zebra dplane %s", prov->dp_name);
+	snprintf(os_name, sizeof(os_name), "zebra_dp_%u", prov->dp_id);
+
+	prov->dp_pthread = frr_pthread_new(&pattr, name, os_name);
+	frr_pthread_run(prov->dp_pthread, NULL);
+}
+
 /*
  * Start the dataplane pthread. This step needs to be run later than the
  * 'init' step, in case zebra has fork-ed.
@@ -4755,6 +5067,9 @@ void zebra_dplane_start(void)
 
 	while (prov) {
 
+		if (prov->dp_flags & DPLANE_PROV_FLAG_PTHREAD)
+			dplane_provider_pthread_start(prov);
+
 		if (prov->dp_start)
 			(prov->dp_start)(prov);
 
@@ -243,6 +243,9 @@ enum zebra_dplane_result dplane_ctx_get_status(
 	const struct zebra_dplane_ctx *ctx);
 void dplane_ctx_set_status(struct zebra_dplane_ctx *ctx,
 			   enum zebra_dplane_result status);
+uint64_t dplane_ctx_get_age_usec(const struct zebra_dplane_ctx *ctx);
+void dplane_ctx_latency_ack(struct zebra_dplane_ctx *ctx);
+void dplane_ctx_latency_done(struct zebra_dplane_ctx *ctx);
 const char *dplane_res2str(enum zebra_dplane_result res);
 
 enum dplane_op_e dplane_ctx_get_op(const struct zebra_dplane_ctx *ctx);
@@ -654,6 +657,11 @@ void dplane_set_in_queue_limit(uint32_t limit, bool set);
 /* Retrieve the current queue depth of incoming, unprocessed updates */
 uint32_t dplane_get_in_queue_len(void);
 
+/* True if the providers have fallen far enough behind that no new work
+ * should be queued to the dataplane.
+ */
+bool dplane_is_backlogged(void);
+
 /*
  * Vty/cli apis
  */
@@ -690,6 +698,12 @@ enum dplane_provider_prio {
 /* Provider will be spawning its own worker thread */
 #define DPLANE_PROV_FLAG_THREADED  0x1
 
+/* Dataplane runs the provider's work callback on a dedicated pthread, so
+ * that it overlaps with the other providers; implies THREADED locking of
+ * the provider queues.
+ */
+#define DPLANE_PROV_FLAG_PTHREAD   0x2
+
 /* Provider registration: ordering or priority value, callbacks, and optional
  * opaque data value. If 'prov_p', return the newly-allocated provider object
  * on success.
@@ -25,6 +25,7 @@
 #include "hash.h"
 #include "interface.h"
 #include "jhash.h"
+#include "fhash.h"
 #include "memory.h"
 #include "prefix.h"
 #include "vlan.h"
@@ -42,6 +43,70 @@
 #include "zebra/zebra_evpn_neigh.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, MAC, "EVPN MAC");
+DEFINE_MTYPE_STATIC(ZEBRA, MACIP_UPDATE, "EVPN MACIP update");
+
+/*
+ * MACIP adds/deletes for BGP are held for a short window, so that a burst
+ * of local learning (or a flap) reaches BGP as one batch with at most one
+ * message per MAC/IP - the latest one.
+ */
+#define ZEBRA_MACIP_UPDATE_WINDOW_MSEC 10
+
+PREDECL_HASH(macip_updates)
+PREDECL_DLIST(macip_updates_order)
+
+struct macip_update {
+	struct zserv *client;
+	vni_t vni;
+	struct ethaddr mac;
+	struct ipaddr ip;
+
+	/* Most recent encoding of the update */
+	struct stream *s;
+
+	struct macip_updates_item item;
+	struct macip_updates_order_item oitem;
+};
+
+static int macip_update_cmp(const struct macip_update *a,
+			    const struct macip_update *b)
+{
+	if (a->client != b->client)
+		return a->client < b->client ? -1 : 1;
+	if (a->vni != b->vni)
+		return a->vni < b->vni ? -1 : 1;
+	if (memcmp(&a->mac, &b->mac, ETH_ALEN))
+		return memcmp(&a->mac, &b->mac, ETH_ALEN);
+
+	return ipaddr_cmp(&a->ip, &b->ip);
+}
+
+static uint32_t macip_update_hash(const struct macip_update *upd)
+{
+	uint32_t key;
+
+	key = jhash(upd->mac.octet, ETH_ALEN, upd->vni);
+	if (upd->ip.ipa_type != IPADDR_NONE)
+		key = jhash(&upd->ip.ip.addr,
+			    IS_IPADDR_V4(&upd->ip) ? IPV4_MAX_BYTELEN
+						   : IPV6_MAX_BYTELEN,
+			    key);
+
+	return key;
+}
+
+DECLARE_HASH(macip_updates, struct macip_update, item, macip_update_cmp,
+	     macip_update_hash)
+DECLARE_DLIST(macip_updates_order, struct macip_update, oitem)
+
+static struct macip_updates_head macip_updates_pending;
+static struct macip_updates_order_head macip_updates_fifo =
+	INIT_DLIST(macip_updates_fifo);
+static struct thread *t_macip_updates;
+
+static uint64_t macip_updates_queued;
+static uint64_t macip_updates_coalesced;
+static uint64_t macip_updates_batches;
 
 /*
  * Return number of valid MACs in an EVPN's MAC hash table - all
@@ -461,10 +526,11 @@ static void zebra_evpn_dup_addr_detect_for_mac(struct zebra_vrf *zvrf,
 						       sizeof(buf)),
 					mac->flags, zvrf->dad_freeze_time);
 
-			thread_add_timer(zrouter.master,
-					 zebra_evpn_dad_mac_auto_recovery_exp,
-					 mac, zvrf->dad_freeze_time,
-					 &mac->dad_mac_auto_recovery_timer);
+			thread_add_timer_wheel(
+				zrouter.master,
+				zebra_evpn_dad_mac_auto_recovery_exp,
+				mac, zvrf->dad_freeze_time,
+				&mac->dad_mac_auto_recovery_timer);
 		}
 
 		/* In case of local update, do not inform to client (BGPd),
@@ -854,6 +920,116 @@ void zebra_evpn_print_mac_hash_detail(struct hash_bucket *bucket, void *ctxt)
 	zebra_evpn_print_mac(mac, vty, json_mac_hdr);
 }
 
+static void macip_update_free(struct macip_update *upd)
+{
+	stream_free(upd->s);
+	XFREE(MTYPE_MACIP_UPDATE, upd);
+}
+
+/* Send the MACIP updates held for the current window as one batch */
+static int zebra_evpn_macip_flush(struct thread *thread)
+{
+	struct macip_update *upd;
+	struct zserv *client = NULL;
+	struct stream_fifo fifo;
+
+	stream_fifo_init(&fifo);
+
+	while ((upd = macip_updates_order_pop(&macip_updates_fifo))) {
+		macip_updates_del(&macip_updates_pending, upd);
+
+		if (client && upd->client != client) {
+			zserv_send_batch(client, &fifo);
+			macip_updates_batches++;
+		}
+		client = upd->client;
+
+		stream_fifo_push(&fifo, upd->s);
+		upd->s = NULL;
+		macip_update_free(upd);
+	}
+
+	if (client && stream_fifo_count_safe(&fifo)) {
+		if (IS_ZEBRA_DEBUG_VXLAN)
+			zlog_debug("%s: sending %zu MACIP updates to %s",
+				   __func__, stream_fifo_count_safe(&fifo),
+				   zebra_route_string(client->proto));
+		zserv_send_batch(client, &fifo);
+		macip_updates_batches++;
+	}
+
+	stream_fifo_deinit(&fifo);
+	return 0;
+}
+
+/*
+ * Queue an encoded MACIP message for client, replacing any message for the
+ * same VNI/MAC/IP that is still waiting to be sent.  The replacement moves
+ * to the back of the queue so messages still go out in the order of the
+ * latest change.
+ */
+static void zebra_evpn_macip_queue(struct zserv *client, vni_t vni,
+				   struct ethaddr *macaddr, struct ipaddr *ip,
+				   struct stream *s)
+{
+	struct macip_update key = {};
+	struct macip_update *upd;
+
+	key.client = client;
+	key.vni = vni;
+	memcpy(&key.mac, macaddr, sizeof(key.mac));
+	if (ip)
+		memcpy(&key.ip, ip, sizeof(key.ip));
+
+	macip_updates_queued++;
+	upd = macip_updates_find(&macip_updates_pending, &key);
+	if (upd) {
+		stream_free(upd->s);
+		macip_updates_order_del(&macip_updates_fifo, upd);
+		macip_updates_coalesced++;
+	} else {
+		upd = XCALLOC(MTYPE_MACIP_UPDATE, sizeof(*upd));
+		upd->client = client;
+		upd->vni = vni;
+		upd->mac = key.mac;
+		upd->ip = key.ip;
+		macip_updates_add(&macip_updates_pending, upd);
+	}
+	upd->s = s;
+	macip_updates_order_add_tail(&macip_updates_fifo, upd);
+
+	thread_add_timer_msec(zrouter.master, zebra_evpn_macip_flush, NULL,
+			      ZEBRA_MACIP_UPDATE_WINDOW_MSEC,
+			      &t_macip_updates);
+}
+
+/* Drop the MACIP updates still queued for a client that is going away */
+void zebra_evpn_macip_updates_drop(struct zserv *client)
+{
+	struct macip_update *upd;
+
+	frr_each_safe (macip_updates_order, &macip_updates_fifo, upd) {
+		if (upd->client != client)
+			continue;
+
+		macip_updates_order_del(&macip_updates_fifo, upd);
+		macip_updates_del(&macip_updates_pending, upd);
+		macip_update_free(upd);
+	}
+
+	if (!macip_updates_order_count(&macip_updates_fifo))
+		THREAD_OFF(t_macip_updates);
+}
+
+void zebra_evpn_macip_updates_show(struct vty *vty)
+{
+	vty_out(vty, "EVPN MACIP updates: %" PRIu64 " queued, %" PRIu64
+		" coalesced, %" PRIu64 " batches, %zu pending\n",
+		macip_updates_queued, macip_updates_coalesced,
+		macip_updates_batches,
+		macip_updates_count(&macip_updates_pending));
+}
+
 /*
  * Inform BGP about local MACIP.
  */
@@ -918,7 +1094,8 @@ int zebra_evpn_macip_send_msg_to_client(vni_t vni, struct ethaddr *macaddr,
 	else
 		client->macipdel_cnt++;
 
-	return zserv_send_message(client, s);
+	zebra_evpn_macip_queue(client, vni, macaddr, ip, s);
+	return 0;
 }
 
 static unsigned int mac_hash_keymake(const void *p)
@@ -926,7 +1103,7 @@ static unsigned int mac_hash_keymake(const void *p)
 	const zebra_mac_t *pmac = p;
 	const void *pnt = (void *)pmac->macaddr.octet;
 
-	return jhash(pnt, ETH_ALEN, 0xa5a5a55a);
+	return fhash(pnt, ETH_ALEN, 0xa5a5a55a);
 }
 
 /*
@@ -1318,8 +1495,8 @@ static inline void zebra_evpn_mac_start_hold_timer(zebra_mac_t *mac)
 			mac->zevpn->vni,
 			prefix_mac2str(&mac->macaddr, macbuf, sizeof(macbuf)),
 			mac->es ? mac->es->esi_str : "-", mac->flags);
-	thread_add_timer(zrouter.master, zebra_evpn_mac_hold_exp_cb, mac,
-			 zmh_info->mac_hold_time, &mac->hold_timer);
+	thread_add_timer_wheel(zrouter.master, zebra_evpn_mac_hold_exp_cb, mac,
+			       zmh_info->mac_hold_time, &mac->hold_timer);
 }
 
 void zebra_evpn_mac_stop_hold_timer(zebra_mac_t *mac)
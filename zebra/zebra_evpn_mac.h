@@ -53,8 +53,36 @@ RB_PROTOTYPE(host_rb_tree_entry, host_rb_entry, hl_entry,
  * the mapping (of VLAN to VNI).
  */
 struct zebra_mac_t_ {
-	/* MAC address. */
-	struct ethaddr macaddr;
+	/*
+	 * There can be a very large number of these; members are grouped by
+	 * size so that the structure carries no padding.
+	 */
+
+	/* back pointer to zevpn */
+	zebra_evpn_t *zevpn;
+
+	/* Local or remote ES */
+	struct zebra_evpn_es *es;
+	/* memory used to link the mac to the es */
+	struct listnode es_listnode;
+
+	/* List of neigh associated with this mac */
+	struct list *neigh_list;
+
+	/* list of hosts pointing to this remote RMAC */
+	struct host_rb_tree_entry host_rb;
+
+	/* Duplicate mac detection */
+	struct thread *dad_mac_auto_recovery_timer;
+
+	struct timeval detect_start_time;
+
+	time_t dad_dup_detect_time;
+
+	/* used for ageing out the PEER_ACTIVE flag */
+	struct thread *hold_timer;
+
+	time_t uptime;
 
 	uint32_t flags;
 #define ZEBRA_MAC_LOCAL 0x01
@@ -84,53 +112,31 @@ struct zebra_mac_t_ {
 #define ZEBRA_MAC_ALL_PEER_FLAGS                                               \
 	(ZEBRA_MAC_ES_PEER_PROXY | ZEBRA_MAC_ES_PEER_ACTIVE)
 
-	/* back pointer to zevpn */
-	zebra_evpn_t *zevpn;
-
-	/* Local or remote info. */
-	union {
-		struct {
-			ifindex_t ifindex;
-			ns_id_t ns_id;
-			vlanid_t vid;
-		} local;
-
-		struct in_addr r_vtep_ip;
-	} fwd_info;
-
-	/* Local or remote ES */
-	struct zebra_evpn_es *es;
-	/* memory used to link the mac to the es */
-	struct listnode es_listnode;
-
 	/* Mobility sequence numbers associated with this entry. */
 	uint32_t rem_seq;
 	uint32_t loc_seq;
 
-	/* List of neigh associated with this mac */
-	struct list *neigh_list;
-
-	/* list of hosts pointing to this remote RMAC */
-	struct host_rb_tree_entry host_rb;
-
 	/* Duplicate mac detection */
 	uint32_t dad_count;
 
-	struct thread *dad_mac_auto_recovery_timer;
-
-	struct timeval detect_start_time;
-
-	time_t dad_dup_detect_time;
-
-	/* used for ageing out the PEER_ACTIVE flag */
-	struct thread *hold_timer;
-
 	/* number of neigh entries (using this mac) that have
 	 * ZEBRA_MAC_ES_PEER_ACTIVE or ZEBRA_NEIGH_ES_PEER_PROXY
 	 */
 	uint32_t sync_neigh_cnt;
 
-	time_t uptime;
+	/* Local or remote info. */
+	union {
+		struct {
+			ifindex_t ifindex;
+			ns_id_t ns_id;
+			vlanid_t vid;
+		} local;
+
+		struct in_addr r_vtep_ip;
+	} fwd_info;
+
+	/* MAC address. */
+	struct ethaddr macaddr;
 };
 
 /*
@@ -215,6 +221,8 @@ int zebra_evpn_macip_send_msg_to_client(uint32_t id, struct ethaddr *macaddr,
 					struct ipaddr *ip, uint8_t flags,
 					uint32_t seq, int state,
 					struct zebra_evpn_es *es, uint16_t cmd);
+void zebra_evpn_macip_updates_drop(struct zserv *client);
+void zebra_evpn_macip_updates_show(struct vty *vty);
 void zebra_evpn_print_mac(zebra_mac_t *mac, void *ctxt, json_object *json);
 void zebra_evpn_print_mac_hash(struct hash_bucket *bucket, void *ctxt);
 void zebra_evpn_print_mac_hash_detail(struct hash_bucket *bucket, void *ctxt);
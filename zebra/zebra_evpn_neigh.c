@@ -487,8 +487,8 @@ static inline void zebra_evpn_neigh_start_hold_timer(zebra_neigh_t *n)
 			   ipaddr2str(&n->ip, ipbuf, sizeof(ipbuf)),
 			   prefix_mac2str(&n->emac, macbuf, sizeof(macbuf)),
 			   n->flags);
-	thread_add_timer(zrouter.master, zebra_evpn_neigh_hold_exp_cb, n,
-			 zmh_info->neigh_hold_time, &n->hold_timer);
+	thread_add_timer_wheel(zrouter.master, zebra_evpn_neigh_hold_exp_cb, n,
+			       zmh_info->neigh_hold_time, &n->hold_timer);
 }
 
 static void zebra_evpn_local_neigh_deref_mac(zebra_neigh_t *n,
@@ -1311,10 +1311,11 @@ zebra_evpn_dup_addr_detect_for_neigh(struct zebra_vrf *zvrf, zebra_neigh_t *nbr,
 						   sizeof(buf1)),
 					nbr->flags, zvrf->dad_freeze_time);
 
-			thread_add_timer(zrouter.master,
-					 zebra_evpn_dad_ip_auto_recovery_exp,
-					 nbr, zvrf->dad_freeze_time,
-					 &nbr->dad_ip_auto_recovery_timer);
+			thread_add_timer_wheel(
+				zrouter.master,
+				zebra_evpn_dad_ip_auto_recovery_exp,
+				nbr, zvrf->dad_freeze_time,
+				&nbr->dad_ip_auto_recovery_timer);
 		}
 		if (zvrf->dad_freeze)
 			*is_dup_detect = true;
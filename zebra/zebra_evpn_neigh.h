@@ -51,20 +51,37 @@ typedef struct zebra_neigh_t_ zebra_neigh_t;
  * VNI will be obtained as zebra maintains the mapping (of VLAN to VNI).
  */
 struct zebra_neigh_t_ {
-	/* IP address. */
-	struct ipaddr ip;
-
-	/* MAC address. */
-	struct ethaddr emac;
+	/*
+	 * There can be a very large number of these; members are grouped by
+	 * size so that the structure carries no padding.
+	 */
 
 	/* Back pointer to MAC. Only applicable to hosts in a L2-VNI. */
 	zebra_mac_t *mac;
 
+	zebra_evpn_t *zevpn;
+
+	/* list of hosts pointing to this remote NH entry */
+	struct host_rb_tree_entry host_rb;
+
+	/* Duplicate ip detection */
+	struct thread *dad_ip_auto_recovery_timer;
+
+	struct timeval detect_start_time;
+
+	time_t dad_dup_detect_time;
+
+	time_t uptime;
+
+	/* used for ageing out the PEER_ACTIVE flag */
+	struct thread *hold_timer;
+
+	/* IP address. */
+	struct ipaddr ip;
+
 	/* Underlying interface. */
 	ifindex_t ifindex;
 
-	zebra_evpn_t *zevpn;
-
 	uint32_t flags;
 #define ZEBRA_NEIGH_LOCAL 0x01
 #define ZEBRA_NEIGH_REMOTE 0x02
@@ -101,22 +118,11 @@ struct zebra_neigh_t_ {
 	uint32_t rem_seq;
 	uint32_t loc_seq;
 
-	/* list of hosts pointing to this remote NH entry */
-	struct host_rb_tree_entry host_rb;
-
 	/* Duplicate ip detection */
 	uint32_t dad_count;
 
-	struct thread *dad_ip_auto_recovery_timer;
-
-	struct timeval detect_start_time;
-
-	time_t dad_dup_detect_time;
-
-	time_t uptime;
-
-	/* used for ageing out the PEER_ACTIVE flag */
-	struct thread *hold_timer;
+	/* MAC address. */
+	struct ethaddr emac;
 };
 
 /*
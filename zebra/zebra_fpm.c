@@ -99,6 +99,7 @@ struct zfpm_stats {
 	unsigned long nop_deletes_skipped;
 	unsigned long route_adds;
 	unsigned long route_dels;
+	unsigned long route_batches;
 
 	unsigned long updates_triggered;
 	unsigned long redundant_triggers;
@@ -172,6 +173,11 @@ struct zfpm_glob {
 	 */
 	enum zfpm_msg_format message_format;
 
+	/*
+	 * Protobuf only: carry several routes per FPM message.
+	 */
+	bool protobuf_batch;
+
 	struct thread_master *master;
 
 	enum zfpm_state state;
@@ -931,6 +937,117 @@ enum {
 
 #define FPM_QUEUE_PROCESS_LIMIT 10000
 
+/*
+ * zfpm_route_update_done
+ *
+ * Take a dest off the queue once its update has been written (or skipped).
+ */
+static void zfpm_route_update_done(rib_dest_t *dest, int is_add)
+{
+	/*
+	 * Remove the dest from the queue, and reset the flag.
+	 */
+	UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+	TAILQ_REMOVE(&zfpm_g->dest_q, dest, fpm_q_entries);
+
+	if (is_add) {
+		SET_FLAG(dest->flags, RIB_DEST_SENT_TO_FPM);
+	} else {
+		UNSET_FLAG(dest->flags, RIB_DEST_SENT_TO_FPM);
+	}
+
+	/*
+	 * Delete the destination if necessary.
+	 */
+	if (rib_gc_dest(dest->rnode))
+		zfpm_g->stats.dests_del_after_update++;
+}
+
+#ifdef HAVE_PROTOBUF
+/*
+ * zfpm_build_route_batches
+ *
+ * Like zfpm_build_route_updates(), but pack as many route updates as fit
+ * into each FPM message.
+ */
+static int zfpm_build_route_batches(void)
+{
+	struct stream *s;
+	rib_dest_t *dest;
+	unsigned char *data;
+	size_t msg_len, data_len, max_len;
+	fpm_msg_hdr_t *hdr;
+	struct route_entry *re;
+	int is_add, count;
+	uint16_t q_limit;
+
+	if (TAILQ_EMPTY(&zfpm_g->dest_q))
+		return FPM_GOTO_NEXT_Q;
+
+	s = zfpm_g->obuf;
+	q_limit = FPM_QUEUE_PROCESS_LIMIT;
+
+	do {
+		/*
+		 * Make sure there is enough space to write another message.
+		 */
+		if (STREAM_WRITEABLE(s) < FPM_MAX_MSG_LEN)
+			return FPM_WRITE_STOP;
+
+		hdr = (fpm_msg_hdr_t *)(STREAM_DATA(s) + stream_get_endp(s));
+		hdr->version = FPM_PROTO_VERSION;
+		data = fpm_msg_data(hdr);
+		max_len = FPM_MAX_MSG_LEN - FPM_MSG_HDR_LEN;
+
+		zfpm_protobuf_batch_start();
+		count = 0;
+
+		while (q_limit && (dest = TAILQ_FIRST(&zfpm_g->dest_q))) {
+			assert(CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM));
+
+			re = zfpm_route_for_update(dest);
+			is_add = re ? 1 : 0;
+
+			if (!is_add
+			    && !CHECK_FLAG(dest->flags, RIB_DEST_SENT_TO_FPM)) {
+				zfpm_g->stats.nop_deletes_skipped++;
+			} else if (zfpm_protobuf_batch_add(dest, re, max_len)) {
+				count++;
+				if (is_add)
+					zfpm_g->stats.route_adds++;
+				else
+					zfpm_g->stats.route_dels++;
+			} else if (count) {
+				/* Frame is full, send this dest in the next */
+				break;
+			} else {
+				/* Can not happen: a route alone always fits */
+				assert(0);
+			}
+
+			zfpm_route_update_done(dest, is_add);
+			q_limit--;
+		}
+
+		if (count) {
+			data_len = zfpm_protobuf_batch_encode(data, max_len);
+			hdr->msg_type = FPM_MSG_TYPE_PROTOBUF;
+			msg_len = fpm_data_len_to_msg_len(data_len);
+			hdr->msg_len = htons(msg_len);
+			stream_forward_endp(s, msg_len);
+			zfpm_g->stats.route_batches++;
+		}
+
+		/*
+		 * We have processed enough updates in this queue, or it is
+		 * empty.  Yield for other queues.
+		 */
+		if (!q_limit || TAILQ_EMPTY(&zfpm_g->dest_q))
+			return FPM_GOTO_NEXT_Q;
+	} while (true);
+}
+#endif /* HAVE_PROTOBUF */
+
 /*
  * zfpm_build_route_updates
  *
@@ -949,6 +1066,12 @@ static int zfpm_build_route_updates(void)
 	fpm_msg_type_e msg_type;
 	uint16_t q_limit;
 
+#ifdef HAVE_PROTOBUF
+	if (zfpm_g->message_format == ZFPM_MSG_FORMAT_PROTOBUF
+	    && zfpm_g->protobuf_batch)
+		return zfpm_build_route_batches();
+#endif
+
 	if (TAILQ_EMPTY(&zfpm_g->dest_q))
 		return FPM_GOTO_NEXT_Q;
 
@@ -1009,23 +1132,7 @@ static int zfpm_build_route_updates(void)
 			}
 		}
 
-		/*
-		 * Remove the dest from the queue, and reset the flag.
-		 */
-		UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
-		TAILQ_REMOVE(&zfpm_g->dest_q, dest, fpm_q_entries);
-
-		if (is_add) {
-			SET_FLAG(dest->flags, RIB_DEST_SENT_TO_FPM);
-		} else {
-			UNSET_FLAG(dest->flags, RIB_DEST_SENT_TO_FPM);
-		}
-
-		/*
-		 * Delete the destination if necessary.
-		 */
-		if (rib_gc_dest(dest->rnode))
-			zfpm_g->stats.dests_del_after_update++;
+		zfpm_route_update_done(dest, is_add);
 
 		q_limit--;
 		if (q_limit == 0) {
@@ -1738,6 +1845,7 @@ static void zfpm_show_stats(struct vty *vty)
 	ZFPM_SHOW_STAT(nop_deletes_skipped);
 	ZFPM_SHOW_STAT(route_adds);
 	ZFPM_SHOW_STAT(route_dels);
+	ZFPM_SHOW_STAT(route_batches);
 	ZFPM_SHOW_STAT(updates_triggered);
 	ZFPM_SHOW_STAT(redundant_triggers);
 	ZFPM_SHOW_STAT(dests_del_after_update);
@@ -1899,7 +2007,7 @@ static inline void zfpm_init_message_format(const char *format)
 		return;
 	}
 
-	if (!strcmp("protobuf", format)) {
+	if (!strcmp("protobuf", format) || !strcmp("protobuf-batch", format)) {
 		if (!have_protobuf) {
 			flog_err(
 				EC_ZEBRA_PROTOBUF_NOT_AVAILABLE,
@@ -1909,6 +2017,7 @@ static inline void zfpm_init_message_format(const char *format)
 		flog_warn(EC_ZEBRA_PROTOBUF_NOT_AVAILABLE,
 			  "FPM protobuf message format is deprecated and scheduled to be removed. Please convert to using netlink format or contact dev@lists.frrouting.org with your use case.");
 		zfpm_g->message_format = ZFPM_MSG_FORMAT_PROTOBUF;
+		zfpm_g->protobuf_batch = !strcmp("protobuf-batch", format);
 		return;
 	}
 
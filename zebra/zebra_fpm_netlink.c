@@ -233,6 +233,31 @@ static uint8_t netlink_proto_from_route_type(int type)
 	}
 }
 
+/*
+ * netlink_route_info_set_bh_type
+ *
+ * A blackhole nexthop determines the type of the route.
+ */
+static void netlink_route_info_set_bh_type(struct netlink_route_info *ri,
+					   const struct nexthop *nexthop)
+{
+	if (nexthop->type != NEXTHOP_TYPE_BLACKHOLE)
+		return;
+
+	switch (nexthop->bh_type) {
+	case BLACKHOLE_ADMINPROHIB:
+		ri->rtm_type = RTN_PROHIBIT;
+		break;
+	case BLACKHOLE_REJECT:
+		ri->rtm_type = RTN_UNREACHABLE;
+		break;
+	case BLACKHOLE_NULL:
+	default:
+		ri->rtm_type = RTN_BLACKHOLE;
+		break;
+	}
+}
+
 /*
  * netlink_route_info_fill
  *
@@ -244,6 +269,7 @@ static int netlink_route_info_fill(struct netlink_route_info *ri, int cmd,
 				   rib_dest_t *dest, struct route_entry *re)
 {
 	struct nexthop *nexthop;
+	unsigned int i;
 
 	memset(ri, 0, sizeof(*ri));
 
@@ -270,33 +296,29 @@ static int netlink_route_info_fill(struct netlink_route_info *ri, int cmd,
 	ri->rtm_type = RTN_UNICAST;
 	ri->metric = &re->metric;
 
-	for (ALL_NEXTHOPS(re->nhe->nhg, nexthop)) {
-		if (ri->num_nhs >= zrouter.multipath_num)
-			break;
-
-		if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
-			continue;
+	if (cmd == RTM_NEWROUTE) {
+		/* Only the active, resolved nexthops are sent */
+		const struct nexthop_group_flat *flat = zebra_nhg_flat(re->nhe);
 
-		if (nexthop->type == NEXTHOP_TYPE_BLACKHOLE) {
-			switch (nexthop->bh_type) {
-			case BLACKHOLE_ADMINPROHIB:
-				ri->rtm_type = RTN_PROHIBIT;
-				break;
-			case BLACKHOLE_REJECT:
-				ri->rtm_type = RTN_UNREACHABLE;
-				break;
-			case BLACKHOLE_NULL:
-			default:
-				ri->rtm_type = RTN_BLACKHOLE;
+		for (i = 0; i < flat->num; i++) {
+			if (ri->num_nhs >= zrouter.multipath_num)
 				break;
-			}
+
+			netlink_route_info_set_bh_type(ri, flat->nexthops[i]);
+			netlink_route_info_add_nh(ri, flat->nexthops[i], re);
 		}
+	} else {
+		for (ALL_NEXTHOPS(re->nhe->nhg, nexthop)) {
+			if (ri->num_nhs >= zrouter.multipath_num)
+				break;
+
+			if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
+				continue;
+
+			netlink_route_info_set_bh_type(ri, nexthop);
 
-		if ((cmd == RTM_NEWROUTE
-		     && CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE))
-		    || (cmd == RTM_DELROUTE
-			&& CHECK_FLAG(re->status, ROUTE_ENTRY_INSTALLED))) {
-			netlink_route_info_add_nh(ri, nexthop, re);
+			if (CHECK_FLAG(re->status, ROUTE_ENTRY_INSTALLED))
+				netlink_route_info_add_nh(ri, nexthop, re);
 		}
 	}
 
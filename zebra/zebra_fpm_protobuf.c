@@ -270,6 +270,98 @@ static Fpm__Message *create_route_message(qpb_allocator_t *allocator,
 	return msg;
 }
 
+/*
+ * Batched encoding: route messages for one FPM frame are built in a
+ * static arena that is reset per frame, and packed as the 'messages' of
+ * a single BATCH message.  The arena holds ZFPM_PROTOBUF_BATCH_MAX times
+ * the space a single route gets in zfpm_protobuf_encode_route(), so
+ * building a full batch can not run out of memory.
+ */
+#define ZFPM_PROTOBUF_BATCH_MAX 64
+#define ZFPM_PROTOBUF_ROUTE_ARENA 4096
+
+static struct {
+	qpb_allocator_t allocator;
+	linear_allocator_t lin;
+	uint64_t buf[ZFPM_PROTOBUF_BATCH_MAX * ZFPM_PROTOBUF_ROUTE_ARENA
+		     / sizeof(uint64_t)];
+
+	Fpm__Message msg;
+	Fpm__Message *msgs[ZFPM_PROTOBUF_BATCH_MAX];
+} zfpm_pb_batch;
+
+/*
+ * zfpm_protobuf_batch_start
+ *
+ * Start a new batch, releasing everything built for the previous one.
+ */
+void zfpm_protobuf_batch_start(void)
+{
+	if (!zfpm_pb_batch.lin.buf) {
+		linear_allocator_init(&zfpm_pb_batch.lin,
+				      (char *)zfpm_pb_batch.buf,
+				      sizeof(zfpm_pb_batch.buf));
+		qpb_allocator_init_linear(&zfpm_pb_batch.allocator,
+					  &zfpm_pb_batch.lin);
+	} else
+		linear_allocator_reset(&zfpm_pb_batch.lin);
+
+	fpm__message__init(&zfpm_pb_batch.msg);
+	zfpm_pb_batch.msg.has_type = 1;
+	zfpm_pb_batch.msg.type = FPM__MESSAGE__TYPE__BATCH;
+	zfpm_pb_batch.msg.messages = zfpm_pb_batch.msgs;
+}
+
+/*
+ * zfpm_protobuf_batch_add
+ *
+ * Add the given route to the current batch if the packed batch still fits
+ * in max_len bytes.
+ *
+ * Returns true if the route was added.
+ */
+bool zfpm_protobuf_batch_add(rib_dest_t *dest, struct route_entry *re,
+			     size_t max_len)
+{
+	Fpm__Message *msg;
+
+	if (zfpm_pb_batch.msg.n_messages >= ZFPM_PROTOBUF_BATCH_MAX)
+		return false;
+
+	msg = create_route_message(&zfpm_pb_batch.allocator, dest, re);
+	if (!msg)
+		return false;
+
+	zfpm_pb_batch.msgs[zfpm_pb_batch.msg.n_messages++] = msg;
+	if (fpm__message__get_packed_size(&zfpm_pb_batch.msg) > max_len) {
+		zfpm_pb_batch.msg.n_messages--;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * zfpm_protobuf_batch_encode
+ *
+ * Pack the current batch into the given buffer.
+ *
+ * Returns the number of bytes written to the buffer, 0 if the batch is
+ * empty.
+ */
+int zfpm_protobuf_batch_encode(uint8_t *in_buf, size_t in_buf_len)
+{
+	size_t len;
+
+	if (!zfpm_pb_batch.msg.n_messages)
+		return 0;
+
+	len = fpm__message__pack(&zfpm_pb_batch.msg, in_buf);
+	assert(len <= in_buf_len);
+
+	return len;
+}
+
 /*
  * zfpm_protobuf_encode_route
  *
@@ -42,17 +42,31 @@
 #include "lib/libfrr.h"
 #include "lib/sockopt.h"
 
+#include "lib/srcdest_table.h"
+
 #include "zebra/zebra_router.h"
 #include "zebra/debug.h"
 #include "zebra/zapi_msg.h"
 
+/*
+ * Stale routes are collected and swept in slices; how long a slice runs
+ * is checked every this many route nodes.
+ */
+#define ZEBRA_GR_STALE_YIELD_CHECK 256
+
 
 /*
  * Forward declaration.
  */
 static struct zserv *zebra_gr_find_stale_client(struct zserv *client);
 static int32_t zebra_gr_route_stale_delete_timer_expiry(struct thread *thread);
-static int32_t zebra_gr_delete_stale_routes(struct client_gr_info *info);
+static int32_t zebra_gr_delete_stale_routes(struct client_gr_info *info,
+					    struct thread *thread);
+static int zebra_gr_stale_collect_event(struct thread *thread);
+static void zebra_gr_stale_reset(struct client_gr_info *info,
+				 bool tables_alive);
+static bool zebra_gr_stale_tables_valid(struct client_gr_info *info,
+					struct zebra_vrf *zvrf);
 static void zebra_gr_process_client_stale_routes(struct zserv *client,
 						 vrf_id_t vrf_id);
 
@@ -126,15 +140,14 @@ static void zebra_gr_client_info_delte(struct zserv *client,
 	TAILQ_REMOVE(&(client->gr_info_queue), info, gr_info);
 
 	THREAD_OFF(info->t_stale_removal);
-
-	XFREE(MTYPE_TMP, info->current_prefix);
+	THREAD_OFF(info->t_stale_collect);
 
 	LOG_GR("%s: Instance info is being deleted for client %s", __func__,
 	       zebra_route_string(client->proto));
 
 	/* Delete all the stale routes. */
 	info->do_delete = true;
-	zebra_gr_delete_stale_routes(info);
+	zebra_gr_delete_stale_routes(info, NULL);
 
 	XFREE(MTYPE_TMP, info);
 }
@@ -147,6 +160,7 @@ int32_t zebra_gr_client_disconnect(struct zserv *client)
 	struct zserv *stale_client;
 	struct timeval tv;
 	struct client_gr_info *info = NULL;
+	struct zebra_vrf *zvrf;
 
 	/* Find the stale client */
 	stale_client = zebra_gr_find_stale_client(client);
@@ -171,9 +185,18 @@ int32_t zebra_gr_client_disconnect(struct zserv *client)
 				zebra_gr_route_stale_delete_timer_expiry, info,
 				info->stale_removal_time,
 				&info->t_stale_removal);
-			info->current_afi = AFI_IP;
 			info->stale_client_ptr = client;
 			info->stale_client = true;
+
+			/* Start collecting the client's routes */
+			THREAD_OFF(info->t_stale_collect);
+			zvrf = vrf_info_lookup(info->vrf_id);
+			zebra_gr_stale_reset(
+				info,
+				zvrf && zebra_gr_stale_tables_valid(info, zvrf));
+			thread_add_event(zrouter.master,
+					 zebra_gr_stale_collect_event, info, 0,
+					 &info->t_stale_collect);
 			LOG_GR("%s: Client %s Stale timer update to %d",
 			       __func__, zebra_route_string(client->proto),
 			       info->stale_removal_time);
@@ -458,23 +481,25 @@ static int32_t zebra_gr_route_stale_delete_timer_expiry(struct thread *thread)
 	if (thread->u.val == 1)
 		info->do_delete = true;
 
-	cnt = zebra_gr_delete_stale_routes(info);
+	/* The sweep finishes the collection if it is still running */
+	THREAD_OFF(info->t_stale_collect);
 
-	/* Retsart the timer */
+	cnt = zebra_gr_delete_stale_routes(info,
+					   info->do_delete ? NULL : thread);
+
+	/* Continue in the next slice */
 	if (cnt > 0) {
-		LOG_GR("%s: Client %s processed %d routes. Start timer again",
+		LOG_GR("%s: Client %s processed %d routes, continuing",
 		       __func__, zebra_route_string(client->proto), cnt);
 
-		thread_add_timer(zrouter.master,
+		thread_add_event(zrouter.master,
 				 zebra_gr_route_stale_delete_timer_expiry, info,
-				 ZEBRA_DEFAULT_STALE_UPDATE_DELAY,
-				 &info->t_stale_removal);
+				 0, &info->t_stale_removal);
 	} else {
 		/* No routes to delete for the VRF */
-		LOG_GR("%s: Client %s all starle routes processed", __func__,
-		       zebra_route_string(client->proto));
+		LOG_GR("%s: Client %s all stale routes processed", __func__,
+		       client ? zebra_route_string(client->proto) : "-");
 
-		XFREE(MTYPE_TMP, info->current_prefix);
 		info->current_afi = 0;
 		zebra_gr_delete_stale_client(info);
 	}
@@ -504,129 +529,226 @@ static void zebra_gr_process_route_entry(struct zserv *client,
 }
 
 /*
- * This function walks through the route table for all vrf and deletes
- * the stale routes for the restarted client specified by the protocol
- * type
+ * Are the tables the stale list was collected from still those of the
+ * VRF?  If not they (and the nodes on the list) have been freed.
  */
-static int32_t zebra_gr_delete_stale_route(struct client_gr_info *info,
-					   struct zebra_vrf *zvrf)
+static bool zebra_gr_stale_tables_valid(struct client_gr_info *info,
+					struct zebra_vrf *zvrf)
+{
+	afi_t afi;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++)
+		if (info->stale_tables[afi]
+		    && info->stale_tables[afi] != zvrf->table[afi][SAFI_UNICAST])
+			return false;
+
+	return true;
+}
+
+/* Drop the stale list, releasing its nodes if their tables are alive. */
+static void zebra_gr_stale_reset(struct client_gr_info *info,
+				 bool tables_alive)
+{
+	uint32_t i;
+
+	if (tables_alive)
+		for (i = info->stale_next; i < info->stale_count; i++)
+			route_unlock_node(info->stale_nodes[i]);
+
+	XFREE(MTYPE_TMP, info->stale_nodes);
+	info->stale_count = 0;
+	info->stale_size = 0;
+	info->stale_next = 0;
+	info->stale_collected = false;
+	memset(&info->stale_iter, 0, sizeof(info->stale_iter));
+	memset(info->stale_tables, 0, sizeof(info->stale_tables));
+	info->current_afi = AFI_IP;
+}
+
+/* Put rn on the stale list if it holds a route of the client. */
+static void zebra_gr_stale_add(struct client_gr_info *info,
+			       struct zserv *client, struct route_node *rn)
 {
-	struct route_node *rn, *curr;
 	struct route_entry *re;
-	struct route_entry *next;
-	struct route_table *table;
-	int32_t n = 0;
-	afi_t afi, curr_afi;
-	uint8_t proto;
-	uint16_t instance;
-	struct zserv *s_client;
 
-	if ((info == NULL) || (zvrf == NULL))
-		return -1;
+	RNODE_FOREACH_RE (rn, re) {
+		if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+			continue;
+		if (re->type != client->proto
+		    || re->instance != client->instance)
+			continue;
+
+		if (info->stale_count == info->stale_size) {
+			info->stale_size = MAX(info->stale_size * 2, 1024);
+			info->stale_nodes = XREALLOC(
+				MTYPE_TMP, info->stale_nodes,
+				info->stale_size * sizeof(*info->stale_nodes));
+		}
+		info->stale_nodes[info->stale_count++] = route_lock_node(rn);
+		return;
+	}
+}
 
-	s_client = info->stale_client_ptr;
-	if (s_client == NULL) {
-		LOG_GR("%s: Stale client not present", __func__);
-		return -1;
+/*
+ * Collect the route nodes holding routes of the client.  This runs in the
+ * background from the time the client goes away, so that when the stale
+ * timer fires only those nodes need to be looked at.  Returns true if it
+ * yielded before being done.
+ */
+static bool zebra_gr_stale_collect(struct client_gr_info *info,
+				   struct zebra_vrf *zvrf,
+				   struct thread *thread)
+{
+	struct zserv *client = info->stale_client_ptr;
+	struct route_table *table, *src_table;
+	struct route_node *rn, *srn;
+	uint32_t n = 0;
+
+	if (client == NULL) {
+		info->stale_collected = true;
+		return false;
 	}
 
-	proto = s_client->proto;
-	instance = s_client->instance;
-	curr_afi = info->current_afi;
+	for (; info->current_afi < AFI_MAX; info->current_afi++) {
+		table = zvrf->table[info->current_afi][SAFI_UNICAST];
+		if (table == NULL)
+			continue;
 
-	LOG_GR("%s: Client %s stale routes are being deleted", __func__,
-	       zebra_route_string(proto));
-
-	/* Process routes for all AFI */
-	for (afi = curr_afi; afi < AFI_MAX; afi++) {
-		table = zvrf->table[afi][SAFI_UNICAST];
-
-		if (table) {
-			/*
-			 * If the current prefix is NULL then get the first
-			 * route entry in the table
-			 */
-			if (info->current_prefix == NULL) {
-				rn = route_top(table);
-				if (rn == NULL)
-					continue;
-				curr = rn;
-			} else
-				/* Get the next route entry */
-				curr = route_table_get_next(
-					table, info->current_prefix);
-
-			for (rn = curr; rn; rn = srcdest_route_next(rn)) {
-				RNODE_FOREACH_RE_SAFE (rn, re, next) {
-					if (CHECK_FLAG(re->status,
-						       ROUTE_ENTRY_REMOVED))
-						continue;
-					/* If the route refresh is received
-					 * after restart then do not delete
-					 * the route
-					 */
-					if (re->type == proto
-					    && re->instance == instance) {
-						zebra_gr_process_route_entry(
-							s_client, rn, re);
-						n++;
-					}
-
-					/* If the max route count is reached
-					 * then timer thread will be restarted
-					 * Store the current prefix and afi
-					 */
-					if ((n >= ZEBRA_MAX_STALE_ROUTE_COUNT)
-					    && (info->do_delete == false)) {
-						info->current_afi = afi;
-						info->current_prefix = XCALLOC(
-							MTYPE_TMP,
-							sizeof(struct prefix));
-						prefix_copy(
-							info->current_prefix,
-							&rn->p);
-						return n;
-					}
-				}
+		if (info->stale_tables[info->current_afi] != table) {
+			info->stale_tables[info->current_afi] = table;
+			route_table_iter_init(&info->stale_iter, table);
+		}
+
+		while ((rn = route_table_iter_next(&info->stale_iter))) {
+			zebra_gr_stale_add(info, client, rn);
+
+			src_table = srcdest_srcnode_table(rn);
+			if (src_table)
+				for (srn = route_top(src_table); srn;
+				     srn = route_next(srn))
+					zebra_gr_stale_add(info, client, srn);
+
+			if (thread && (++n % ZEBRA_GR_STALE_YIELD_CHECK) == 0
+			    && thread_should_yield(thread)) {
+				route_table_iter_pause(&info->stale_iter);
+				return true;
 			}
 		}
-		/*
-		 * Reset the current prefix to indicate processing completion
-		 * of the current AFI
-		 */
-		XFREE(MTYPE_TMP, info->current_prefix);
+		route_table_iter_cleanup(&info->stale_iter);
+	}
+
+	info->stale_collected = true;
+	return false;
+}
+
+/*
+ * Delete the routes of the client on the stale list that have not been
+ * refreshed since it restarted.  Returns the number of nodes handled if it
+ * yielded before being done, 0 otherwise.
+ */
+static int32_t zebra_gr_stale_sweep(struct client_gr_info *info,
+				    struct thread *thread)
+{
+	struct zserv *client = info->stale_client_ptr;
+	struct route_node *rn;
+	struct route_entry *re, *next;
+	int32_t n = 0;
+
+	while (info->stale_next < info->stale_count) {
+		rn = info->stale_nodes[info->stale_next++];
+
+		RNODE_FOREACH_RE_SAFE (rn, re, next) {
+			if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+				continue;
+			if (re->type != client->proto
+			    || re->instance != client->instance)
+				continue;
+
+			zebra_gr_process_route_entry(client, rn, re);
+		}
+		route_unlock_node(rn);
+
+		if (thread && (++n % ZEBRA_GR_STALE_YIELD_CHECK) == 0
+		    && thread_should_yield(thread))
+			return n;
 	}
+
+	zebra_gr_stale_reset(info, true);
 	return 0;
 }
 
 /*
  * Delete the stale routes when client is restarted and routes are not
- * refreshed within the stale timeout
+ * refreshed within the stale timeout.  Without a thread (do_delete) this
+ * runs to completion, otherwise it yields when the thread has run long
+ * enough and returns a positive count to be called again.
  */
-static int32_t zebra_gr_delete_stale_routes(struct client_gr_info *info)
+static int32_t zebra_gr_delete_stale_routes(struct client_gr_info *info,
+					    struct thread *thread)
 {
 	struct vrf *vrf;
 	struct zebra_vrf *zvrf;
-	uint64_t cnt = 0;
 
 	if (info == NULL)
 		return -1;
 
+	if (info->stale_client_ptr == NULL) {
+		LOG_GR("%s: Stale client not present", __func__);
+		zebra_gr_stale_reset(info, false);
+		return -1;
+	}
+
 	/* Get the current VRF */
 	vrf = vrf_lookup_by_id(info->vrf_id);
 	if (vrf == NULL) {
 		LOG_GR("%s: Invalid VRF %d", __func__, info->vrf_id);
+		zebra_gr_stale_reset(info, false);
 		return -1;
 	}
 
 	zvrf = vrf->info;
 	if (zvrf == NULL) {
 		LOG_GR("%s: Invalid VRF entry %d", __func__, info->vrf_id);
+		zebra_gr_stale_reset(info, false);
 		return -1;
 	}
 
-	cnt = zebra_gr_delete_stale_route(info, zvrf);
-	return cnt;
+	if (!zebra_gr_stale_tables_valid(info, zvrf)) {
+		LOG_GR("%s: VRF %d tables changed, collecting stale routes again",
+		       __func__, info->vrf_id);
+		zebra_gr_stale_reset(info, false);
+	}
+
+	LOG_GR("%s: Client %s stale routes are being deleted", __func__,
+	       zebra_route_string(
+		       ((struct zserv *)info->stale_client_ptr)->proto));
+
+	if (!info->stale_collected && zebra_gr_stale_collect(info, zvrf, thread))
+		return 1;
+
+	return zebra_gr_stale_sweep(info, thread);
+}
+
+/* Background collection of the stale list, see zebra_gr_stale_collect() */
+static int zebra_gr_stale_collect_event(struct thread *thread)
+{
+	struct client_gr_info *info = THREAD_ARG(thread);
+	struct zebra_vrf *zvrf;
+
+	info->t_stale_collect = NULL;
+
+	zvrf = vrf_info_lookup(info->vrf_id);
+	if (zvrf == NULL)
+		return 0;
+
+	if (!zebra_gr_stale_tables_valid(info, zvrf))
+		zebra_gr_stale_reset(info, false);
+
+	if (zebra_gr_stale_collect(info, zvrf, thread))
+		thread_add_event(zrouter.master, zebra_gr_stale_collect_event,
+				 info, 0, &info->t_stale_collect);
+
+	return 0;
 }
 
 /*
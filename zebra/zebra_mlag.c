@@ -112,6 +112,11 @@ void zebra_mlag_process_mlag_data(uint8_t *data, uint32_t len)
 	struct stream *s = NULL;
 	int msg_type = 0;
 
+	atomic_fetch_add_explicit(&zrouter.mlag_info.rx_msgs, 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&zrouter.mlag_info.rx_bytes, len,
+				  memory_order_relaxed);
+
 	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
 	/*
 	 * Place holder we need the message type first
@@ -184,6 +189,21 @@ static int zebra_mlag_client_msg_handler(struct thread *event)
 			hook_call(zebra_mlag_private_write_data,
 				  mlag_wr_buffer, len);
 
+			atomic_fetch_add_explicit(&zrouter.mlag_info.tx_msgs, 1,
+						  memory_order_relaxed);
+			atomic_fetch_add_explicit(&zrouter.mlag_info.tx_bytes,
+						  len, memory_order_relaxed);
+			/* bulk messages carry their entry count in the
+			 * header
+			 */
+			atomic_fetch_add_explicit(
+				&zrouter.mlag_info.tx_entries,
+				(msg_type == MLAG_MROUTE_ADD_BULK
+				 || msg_type == MLAG_MROUTE_DEL_BULK)
+					? stream_getw_from(s, 6)
+					: 1,
+				memory_order_relaxed);
+
 			/*
 			 * If message type is De-register, send a signal to main
 			 * thread, so that necessary cleanup will be done by
@@ -44,6 +44,24 @@ DEFUN_HIDDEN (show_mlag,
 
 	vty_out(vty, "MLag is configured to: %s\n",
 		mlag_role2str(zrouter.mlag_info.role, buf, sizeof(buf)));
+	vty_out(vty, "MLag daemon connection: %s\n",
+		zrouter.mlag_info.connected ? "up" : "down");
+	vty_out(vty, "Messages to MLag daemon: %" PRIu64 " (%" PRIu64
+		     " entries, %" PRIu64 " bytes)\n",
+		atomic_load_explicit(&zrouter.mlag_info.tx_msgs,
+				     memory_order_relaxed),
+		atomic_load_explicit(&zrouter.mlag_info.tx_entries,
+				     memory_order_relaxed),
+		atomic_load_explicit(&zrouter.mlag_info.tx_bytes,
+				     memory_order_relaxed));
+	vty_out(vty, "Messages from MLag daemon: %" PRIu64 " (%" PRIu64
+		     " bytes)\n",
+		atomic_load_explicit(&zrouter.mlag_info.rx_msgs,
+				     memory_order_relaxed),
+		atomic_load_explicit(&zrouter.mlag_info.rx_bytes,
+				     memory_order_relaxed));
+	vty_out(vty, "Messages waiting to be sent: %zu\n",
+		stream_fifo_count_safe(zrouter.mlag_info.mlag_fifo));
 
 	return CMD_SUCCESS;
 }
@@ -53,9 +53,38 @@
 DEFINE_MTYPE_STATIC(ZEBRA, LSP, "MPLS LSP object")
 DEFINE_MTYPE_STATIC(ZEBRA, FEC, "MPLS FEC object")
 DEFINE_MTYPE_STATIC(ZEBRA, NHLFE, "MPLS nexthop object")
+DEFINE_MTYPE_STATIC(ZEBRA, LSP_INDEX, "MPLS LSP label index")
 
 int mpls_enabled;
 
+/*
+ * LSPs indexed by incoming label, next to the lsp_table hash (which is
+ * still used for walks).  The 20-bit label space is split into chunks of
+ * ZEBRA_LSP_INDEX_CHUNK labels that are allocated on first use, so a lookup
+ * is two array accesses and unused label ranges cost nothing.
+ */
+#define ZEBRA_LSP_INDEX_SHIFT 10
+#define ZEBRA_LSP_INDEX_CHUNK (1 << ZEBRA_LSP_INDEX_SHIFT)
+#define ZEBRA_LSP_INDEX_CHUNKS ((MPLS_LABEL_MAX + 1) >> ZEBRA_LSP_INDEX_SHIFT)
+
+struct zebra_lsp_index {
+	zebra_lsp_t **chunk[ZEBRA_LSP_INDEX_CHUNKS];
+	uint16_t used[ZEBRA_LSP_INDEX_CHUNKS];
+	uint32_t chunks;
+};
+
+/* Dataplane latency of LSP operations, from context allocation to result */
+struct lsp_op_stats {
+	uint64_t count;
+	uint64_t failures;
+	uint64_t total_usec;
+	uint64_t max_usec;
+};
+
+enum lsp_op_stat { LSP_OP_INSTALL, LSP_OP_UPDATE, LSP_OP_DELETE, LSP_OP_MAX };
+
+static struct lsp_op_stats lsp_op_stats[LSP_OP_MAX];
+
 /* static function declarations */
 
 static void fec_evaluate(struct zebra_vrf *zvrf);
@@ -93,10 +122,10 @@ static int lsp_processq_add(zebra_lsp_t *lsp);
 static void *lsp_alloc(void *p);
 
 /* Check whether lsp can be freed - no nhlfes, e.g., and call free api */
-static void lsp_check_free(struct hash *lsp_table, zebra_lsp_t **plsp);
+static void lsp_check_free(struct zebra_vrf *zvrf, zebra_lsp_t **plsp);
 
 /* Free lsp; sets caller's pointer to NULL */
-static void lsp_free(struct hash *lsp_table, zebra_lsp_t **plsp);
+static void lsp_free(struct zebra_vrf *zvrf, zebra_lsp_t **plsp);
 
 static char *nhlfe2str(const zebra_nhlfe_t *nhlfe, char *buf, int size);
 static char *nhlfe_config_str(const zebra_nhlfe_t *nhlfe, char *buf, int size);
@@ -115,7 +144,7 @@ static int nhlfe_del(zebra_nhlfe_t *nhlfe);
 static void nhlfe_free(zebra_nhlfe_t *nhlfe);
 static void nhlfe_out_label_update(zebra_nhlfe_t *nhlfe,
 				   struct mpls_label_stack *nh_label);
-static int mpls_lsp_uninstall_all(struct hash *lsp_table, zebra_lsp_t *lsp,
+static int mpls_lsp_uninstall_all(struct zebra_vrf *zvrf, zebra_lsp_t *lsp,
 				  enum lsp_types_t type);
 static int mpls_static_lsp_uninstall_all(struct zebra_vrf *zvrf,
 					 mpls_label_t in_label);
@@ -132,6 +161,125 @@ static int lsp_backup_znh_install(zebra_lsp_t *lsp, enum lsp_types_t type,
 
 /* Static functions */
 
+static void lsp_index_set(struct zebra_lsp_index *idx, mpls_label_t label,
+			  zebra_lsp_t *lsp)
+{
+	uint32_t c = label >> ZEBRA_LSP_INDEX_SHIFT;
+	uint32_t i = label & (ZEBRA_LSP_INDEX_CHUNK - 1);
+
+	if (!idx || label > MPLS_LABEL_MAX)
+		return;
+
+	if (!idx->chunk[c]) {
+		if (!lsp)
+			return;
+		idx->chunk[c] = XCALLOC(MTYPE_LSP_INDEX,
+					ZEBRA_LSP_INDEX_CHUNK
+						* sizeof(zebra_lsp_t *));
+		idx->chunks++;
+	}
+
+	if (!idx->chunk[c][i] && lsp)
+		idx->used[c]++;
+	else if (idx->chunk[c][i] && !lsp)
+		idx->used[c]--;
+	idx->chunk[c][i] = lsp;
+
+	if (!idx->used[c]) {
+		XFREE(MTYPE_LSP_INDEX, idx->chunk[c]);
+		idx->chunks--;
+	}
+}
+
+static void lsp_index_free(struct zebra_lsp_index **pidx)
+{
+	struct zebra_lsp_index *idx = *pidx;
+	uint32_t c;
+
+	if (!idx)
+		return;
+
+	for (c = 0; c < ZEBRA_LSP_INDEX_CHUNKS; c++)
+		XFREE(MTYPE_LSP_INDEX, idx->chunk[c]);
+	XFREE(MTYPE_LSP_INDEX, *pidx);
+}
+
+/* Find the LSP for an incoming label */
+static zebra_lsp_t *lsp_lookup(struct zebra_vrf *zvrf, mpls_label_t label)
+{
+	struct zebra_lsp_index *idx = zvrf->lsp_index;
+	zebra_lsp_t **chunk;
+	zebra_ile_t tmp_ile;
+
+	if (!idx || label > MPLS_LABEL_MAX) {
+		tmp_ile.in_label = label;
+		return hash_lookup(zvrf->lsp_table, &tmp_ile);
+	}
+
+	chunk = idx->chunk[label >> ZEBRA_LSP_INDEX_SHIFT];
+	return chunk ? chunk[label & (ZEBRA_LSP_INDEX_CHUNK - 1)] : NULL;
+}
+
+/* Find or create the LSP for an incoming label */
+static zebra_lsp_t *lsp_get(struct zebra_vrf *zvrf, mpls_label_t label)
+{
+	zebra_ile_t tmp_ile;
+	zebra_lsp_t *lsp;
+
+	lsp = lsp_lookup(zvrf, label);
+	if (lsp)
+		return lsp;
+
+	tmp_ile.in_label = label;
+	lsp = hash_get(zvrf->lsp_table, &tmp_ile, lsp_alloc);
+	if (lsp)
+		lsp_index_set(zvrf->lsp_index, label, lsp);
+
+	return lsp;
+}
+
+static void lsp_op_stats_update(struct zebra_dplane_ctx *ctx,
+				enum lsp_op_stat op)
+{
+	struct lsp_op_stats *st = &lsp_op_stats[op];
+	uint64_t usec = dplane_ctx_get_age_usec(ctx);
+
+	st->count++;
+	if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+		st->failures++;
+	st->total_usec += usec;
+	if (usec > st->max_usec)
+		st->max_usec = usec;
+}
+
+void zebra_mpls_lsp_stats_show(struct vty *vty)
+{
+	static const char *const names[LSP_OP_MAX] = {
+		[LSP_OP_INSTALL] = "Install",
+		[LSP_OP_UPDATE] = "Update",
+		[LSP_OP_DELETE] = "Delete",
+	};
+	struct zebra_vrf *zvrf = vrf_info_lookup(VRF_DEFAULT);
+	int op;
+
+	if (zvrf && zvrf->lsp_table)
+		vty_out(vty, "LSPs: %lu, label index chunks: %u\n",
+			zvrf->lsp_table->count,
+			zvrf->lsp_index ? zvrf->lsp_index->chunks : 0);
+
+	vty_out(vty, "%-8s %12s %10s %12s %12s\n", "LSP op", "Count",
+		"Failed", "Avg (usec)", "Max (usec)");
+	for (op = 0; op < LSP_OP_MAX; op++) {
+		struct lsp_op_stats *st = &lsp_op_stats[op];
+
+		vty_out(vty, "%-8s %12" PRIu64 " %10" PRIu64 " %12" PRIu64
+			" %12" PRIu64 "\n",
+			names[op], st->count, st->failures,
+			st->count ? st->total_usec / st->count : 0,
+			st->max_usec);
+	}
+}
+
 /*
  * Handle failure in LSP install, clear flags for NHLFE.
  */
@@ -184,7 +332,7 @@ static int lsp_install(struct zebra_vrf *zvrf, mpls_label_t label,
 
 	/* Locate or allocate LSP entry. */
 	tmp_ile.in_label = label;
-	lsp = hash_get(lsp_table, &tmp_ile, lsp_alloc);
+	lsp = lsp_get(zvrf, tmp_ile.in_label);
 	if (!lsp)
 		return -1;
 
@@ -258,7 +406,7 @@ static int lsp_install(struct zebra_vrf *zvrf, mpls_label_t label,
 		if (lsp_processq_add(lsp))
 			return -1;
 	} else {
-		lsp_check_free(lsp_table, &lsp);
+		lsp_check_free(zvrf, &lsp);
 	}
 
 	return 0;
@@ -283,7 +431,7 @@ static int lsp_uninstall(struct zebra_vrf *zvrf, mpls_label_t label)
 
 	/* If entry is not present, exit. */
 	tmp_ile.in_label = label;
-	lsp = hash_lookup(lsp_table, &tmp_ile);
+	lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 	if (!lsp || (nhlfe_list_first(&lsp->nhlfe_list) == NULL))
 		return 0;
 
@@ -314,7 +462,7 @@ static int lsp_uninstall(struct zebra_vrf *zvrf, mpls_label_t label)
 		if (lsp_processq_add(lsp))
 			return -1;
 	} else {
-		lsp_check_free(lsp_table, &lsp);
+		lsp_check_free(zvrf, &lsp);
 	}
 
 	return 0;
@@ -1046,7 +1194,7 @@ static void lsp_processq_del(struct work_queue *wq, void *data)
 			nhlfe_del(nhlfe);
 	}
 
-	lsp_check_free(lsp_table, &lsp);
+	lsp_check_free(zvrf, &lsp);
 }
 
 /*
@@ -1100,7 +1248,7 @@ static void *lsp_alloc(void *p)
 /*
  * Check whether lsp can be freed - no nhlfes, e.g., and call free api
  */
-static void lsp_check_free(struct hash *lsp_table, zebra_lsp_t **plsp)
+static void lsp_check_free(struct zebra_vrf *zvrf, zebra_lsp_t **plsp)
 {
 	zebra_lsp_t *lsp;
 
@@ -1112,14 +1260,14 @@ static void lsp_check_free(struct hash *lsp_table, zebra_lsp_t **plsp)
 	if ((nhlfe_list_first(&lsp->nhlfe_list) == NULL) &&
 	    (nhlfe_list_first(&lsp->backup_nhlfe_list) == NULL) &&
 	    !CHECK_FLAG(lsp->flags, LSP_FLAG_SCHEDULED))
-		lsp_free(lsp_table, plsp);
+		lsp_free(zvrf, plsp);
 }
 
 /*
  * Dtor for an LSP: remove from ile hash, release any internal allocations,
  * free LSP object.
  */
-static void lsp_free(struct hash *lsp_table, zebra_lsp_t **plsp)
+static void lsp_free(struct zebra_vrf *zvrf, zebra_lsp_t **plsp)
 {
 	zebra_lsp_t *lsp;
 	zebra_nhlfe_t *nhlfe;
@@ -1141,7 +1289,8 @@ static void lsp_free(struct hash *lsp_table, zebra_lsp_t **plsp)
 	frr_each_safe(nhlfe_list, &lsp->backup_nhlfe_list, nhlfe)
 		nhlfe_del(nhlfe);
 
-	hash_release(lsp_table, &lsp->ile);
+	lsp_index_set(zvrf->lsp_index, lsp->ile.in_label, NULL);
+	hash_release(zvrf->lsp_table, &lsp->ile);
 	XFREE(MTYPE_LSP, lsp);
 
 	*plsp = NULL;
@@ -1374,7 +1523,7 @@ static void nhlfe_out_label_update(zebra_nhlfe_t *nhlfe,
 	nhlfe->nexthop->nh_label->label[0] = nh_label->label[0];
 }
 
-static int mpls_lsp_uninstall_all(struct hash *lsp_table, zebra_lsp_t *lsp,
+static int mpls_lsp_uninstall_all(struct zebra_vrf *zvrf, zebra_lsp_t *lsp,
 				  enum lsp_types_t type)
 {
 	zebra_nhlfe_t *nhlfe;
@@ -1436,7 +1585,7 @@ static int mpls_lsp_uninstall_all(struct hash *lsp_table, zebra_lsp_t *lsp,
 		if (lsp_processq_add(lsp))
 			return -1;
 	} else {
-		lsp_check_free(lsp_table, &lsp);
+		lsp_check_free(zvrf, &lsp);
 	}
 
 	return 0;
@@ -1460,11 +1609,11 @@ static int mpls_static_lsp_uninstall_all(struct zebra_vrf *zvrf,
 
 	/* If entry is not present, exit. */
 	tmp_ile.in_label = in_label;
-	lsp = hash_lookup(lsp_table, &tmp_ile);
+	lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 	if (!lsp || (nhlfe_list_first(&lsp->nhlfe_list) == NULL))
 		return 0;
 
-	return mpls_lsp_uninstall_all(lsp_table, lsp, ZEBRA_LSP_STATIC);
+	return mpls_lsp_uninstall_all(zvrf, lsp, ZEBRA_LSP_STATIC);
 }
 
 static json_object *nhlfe_json(zebra_nhlfe_t *nhlfe)
@@ -1719,7 +1868,6 @@ void zebra_mpls_lsp_dplane_result(struct zebra_dplane_ctx *ctx)
 	struct zebra_vrf *zvrf;
 	mpls_label_t label;
 	zebra_ile_t tmp_ile;
-	struct hash *lsp_table;
 	zebra_lsp_t *lsp;
 	zebra_nhlfe_t *nhlfe;
 	struct nexthop *nexthop;
@@ -1738,6 +1886,20 @@ void zebra_mpls_lsp_dplane_result(struct zebra_dplane_ctx *ctx)
 
 	label = dplane_ctx_get_in_label(ctx);
 
+	switch (op) {
+	case DPLANE_OP_LSP_INSTALL:
+		lsp_op_stats_update(ctx, LSP_OP_INSTALL);
+		break;
+	case DPLANE_OP_LSP_UPDATE:
+		lsp_op_stats_update(ctx, LSP_OP_UPDATE);
+		break;
+	case DPLANE_OP_LSP_DELETE:
+		lsp_op_stats_update(ctx, LSP_OP_DELETE);
+		break;
+	default:
+		break;
+	}
+
 	switch (op) {
 	case DPLANE_OP_LSP_INSTALL:
 	case DPLANE_OP_LSP_UPDATE:
@@ -1746,10 +1908,8 @@ void zebra_mpls_lsp_dplane_result(struct zebra_dplane_ctx *ctx)
 		if (zvrf == NULL)
 			break;
 
-		lsp_table = zvrf->lsp_table;
-
 		tmp_ile.in_label = label;
-		lsp = hash_lookup(lsp_table, &tmp_ile);
+		lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 		if (lsp == NULL) {
 			if (IS_ZEBRA_DEBUG_DPLANE)
 				zlog_debug("LSP ctx %p: in-label %u not found",
@@ -1997,7 +2157,6 @@ void zebra_mpls_process_dplane_notify(struct zebra_dplane_ctx *ctx)
 {
 	struct zebra_vrf *zvrf;
 	zebra_ile_t tmp_ile;
-	struct hash *lsp_table;
 	zebra_lsp_t *lsp;
 	const struct nhlfe_list_head *ctx_list;
 	int start_count = 0, end_count = 0; /* Installed counts */
@@ -2013,10 +2172,8 @@ void zebra_mpls_process_dplane_notify(struct zebra_dplane_ctx *ctx)
 	if (zvrf == NULL)
 		goto done;
 
-	lsp_table = zvrf->lsp_table;
-
 	tmp_ile.in_label = dplane_ctx_get_in_label(ctx);
-	lsp = hash_lookup(lsp_table, &tmp_ile);
+	lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 	if (lsp == NULL) {
 		if (is_debug)
 			zlog_debug("dplane LSP notif: in-label %u not found",
@@ -2416,7 +2573,7 @@ static int zebra_mpls_cleanup_fecs_for_client(struct zserv *client)
 }
 
 struct lsp_uninstall_args {
-	struct hash *lsp_table;
+	struct zebra_vrf *zvrf;
 	enum lsp_types_t type;
 };
 
@@ -2436,7 +2593,7 @@ static int zebra_mpls_cleanup_zclient_labels(struct zserv *client)
 			continue;
 
 		/* Cleanup LSPs. */
-		args.lsp_table = zvrf->lsp_table;
+		args.zvrf = zvrf;
 		args.type = lsp_type_from_re_type(client->proto);
 		hash_iterate(zvrf->lsp_table, mpls_lsp_uninstall_all_type,
 			     &args);
@@ -2845,7 +3002,7 @@ int mpls_zapi_labels_process(bool add_p, struct zebra_vrf *zvrf,
 
 		/* Find or create LSP object */
 		tmp_ile.in_label = zl->local_label;
-		lsp = hash_get(lsp_table, &tmp_ile, lsp_alloc);
+		lsp = lsp_get(zvrf, tmp_ile.in_label);
 		if (!lsp)
 			return -1;
 	}
@@ -3124,7 +3281,7 @@ int mpls_lsp_install(struct zebra_vrf *zvrf, enum lsp_types_t type,
 
 	/* Find or create LSP object */
 	tmp_ile.in_label = in_label;
-	lsp = hash_get(lsp_table, &tmp_ile, lsp_alloc);
+	lsp = lsp_get(zvrf, tmp_ile.in_label);
 	if (!lsp)
 		return -1;
 
@@ -3215,7 +3372,7 @@ zebra_lsp_t *mpls_lsp_find(struct zebra_vrf *zvrf, mpls_label_t in_label)
 
 	/* If entry is not present, exit. */
 	tmp_ile.in_label = in_label;
-	return hash_lookup(lsp_table, &tmp_ile);
+	return lsp_lookup(zvrf, tmp_ile.in_label);
 }
 
 /*
@@ -3241,7 +3398,7 @@ int mpls_lsp_uninstall(struct zebra_vrf *zvrf, enum lsp_types_t type,
 
 	/* If entry is not present, exit. */
 	tmp_ile.in_label = in_label;
-	lsp = hash_lookup(lsp_table, &tmp_ile);
+	lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 	if (!lsp)
 		return 0;
 
@@ -3278,7 +3435,7 @@ int mpls_lsp_uninstall(struct zebra_vrf *zvrf, enum lsp_types_t type,
 		nhlfe_del(nhlfe);
 
 		/* Free LSP entry if no other NHLFEs and not scheduled. */
-		lsp_check_free(lsp_table, &lsp);
+		lsp_check_free(zvrf, &lsp);
 	}
 	return 0;
 }
@@ -3297,11 +3454,11 @@ int mpls_lsp_uninstall_all_vrf(struct zebra_vrf *zvrf, enum lsp_types_t type,
 
 	/* If entry is not present, exit. */
 	tmp_ile.in_label = in_label;
-	lsp = hash_lookup(lsp_table, &tmp_ile);
+	lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 	if (!lsp)
 		return 0;
 
-	return mpls_lsp_uninstall_all(lsp_table, lsp, type);
+	return mpls_lsp_uninstall_all(zvrf, lsp, type);
 }
 
 /*
@@ -3312,17 +3469,12 @@ static void mpls_lsp_uninstall_all_type(struct hash_bucket *bucket, void *ctxt)
 {
 	struct lsp_uninstall_args *args = ctxt;
 	zebra_lsp_t *lsp;
-	struct hash *lsp_table;
 
 	lsp = (zebra_lsp_t *)bucket->data;
 	if (nhlfe_list_first(&lsp->nhlfe_list) == NULL)
 		return;
 
-	lsp_table = args->lsp_table;
-	if (!lsp_table)
-		return;
-
-	mpls_lsp_uninstall_all(lsp_table, lsp, args->type);
+	mpls_lsp_uninstall_all(args->zvrf, lsp, args->type);
 }
 
 /*
@@ -3645,7 +3797,7 @@ void zebra_mpls_print_lsp(struct vty *vty, struct zebra_vrf *zvrf,
 
 	/* If entry is not present, exit. */
 	tmp_ile.in_label = label;
-	lsp = hash_lookup(lsp_table, &tmp_ile);
+	lsp = lsp_lookup(zvrf, tmp_ile.in_label);
 	if (!lsp)
 		return;
 
@@ -3913,6 +4065,7 @@ void zebra_mpls_close_tables(struct zebra_vrf *zvrf)
 	hash_iterate(zvrf->lsp_table, lsp_uninstall_from_kernel, NULL);
 	hash_clean(zvrf->lsp_table, NULL);
 	hash_free(zvrf->lsp_table);
+	lsp_index_free(&zvrf->lsp_index);
 	hash_clean(zvrf->slsp_table, NULL);
 	hash_free(zvrf->slsp_table);
 	route_table_finish(zvrf->fec_table[AFI_IP]);
@@ -3930,6 +4083,7 @@ void zebra_mpls_init_tables(struct zebra_vrf *zvrf)
 	zvrf->slsp_table =
 		hash_create(label_hash, label_cmp, "ZEBRA SLSP table");
 	zvrf->lsp_table = hash_create(label_hash, label_cmp, "ZEBRA LSP table");
+	zvrf->lsp_index = XCALLOC(MTYPE_LSP_INDEX, sizeof(*zvrf->lsp_index));
 	zvrf->fec_table[AFI_IP] = route_table_init();
 	zvrf->fec_table[AFI_IP6] = route_table_init();
 	zvrf->mpls_flags = 0;
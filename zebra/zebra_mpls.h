@@ -374,6 +374,11 @@ void zebra_mpls_lsp_schedule(struct zebra_vrf *zvrf);
 void zebra_mpls_print_lsp(struct vty *vty, struct zebra_vrf *zvrf,
 			  mpls_label_t label, bool use_json);
 
+/*
+ * Display LSP table size and dataplane latency of LSP operations.
+ */
+void zebra_mpls_lsp_stats_show(struct vty *vty);
+
 /*
  * Display MPLS label forwarding table (VTY command handler).
  */
@@ -375,6 +375,7 @@ DEFUN (show_mpls_status,
 	vty_out(vty, "MPLS support enabled: %s\n",
 		(mpls_enabled) ? "yes"
 			       : "no (mpls kernel extensions not detected)");
+	zebra_mpls_lsp_stats_show(vty);
 	return CMD_SUCCESS;
 }
 
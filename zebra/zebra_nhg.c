@@ -47,10 +47,33 @@
 DEFINE_MTYPE_STATIC(ZEBRA, NHG, "Nexthop Group Entry");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CONNECTED, "Nexthop Group Connected");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CTX, "Nexthop Group Context");
+DEFINE_MTYPE_STATIC(ZEBRA, NHG_KERNEL, "Nexthop Group Kernel Object");
 
 /* id counter to keep in sync with kernel */
 uint32_t id_counter;
 
+/*
+ * Resolved form of a group installed in the kernel: the flattened list of
+ * singleton ids and weights that makes up the kernel nexthop object.
+ */
+struct nhg_kernel_obj {
+	struct nhg_hash_entry *nhe;
+	uint8_t count;
+	struct nh_grp grp[MULTIPATH_NUM];
+};
+
+static struct hash *nhg_kernel_objs;
+static uint32_t nhg_kernel_shared;
+
+static void zebra_nhg_kernel_obj_free(struct nhg_hash_entry *nhe)
+{
+	if (!nhe->kernel_obj)
+		return;
+
+	hash_release(nhg_kernel_objs, nhe->kernel_obj);
+	XFREE(MTYPE_NHG_KERNEL, nhe->kernel_obj);
+}
+
 /*  */
 static bool g_nexthops_enabled = true;
 static bool proto_nexthops_only;
@@ -1538,6 +1561,19 @@ struct nexthop_group *zebra_nhg_get_backup_nhg(struct nhg_hash_entry *nhe)
 	return p;
 }
 
+const struct nexthop_group_flat *zebra_nhg_flat(struct nhg_hash_entry *nhe)
+{
+	if (!nhe->flat)
+		nhe->flat = nexthop_group_flatten(&nhe->nhg);
+
+	return nhe->flat;
+}
+
+void zebra_nhg_flat_invalidate(struct nhg_hash_entry *nhe)
+{
+	nexthop_group_flat_free(&nhe->flat);
+}
+
 /*
  * Helper to return a copy of a backup_info - note that this is a shallow
  * copy, meant to be used when creating a new nhe from info passed in with
@@ -1558,6 +1594,7 @@ nhg_backup_copy(const struct nhg_backup_info *orig)
 
 static void zebra_nhg_free_members(struct nhg_hash_entry *nhe)
 {
+	zebra_nhg_flat_invalidate(nhe);
 	nexthops_free(nhe->nhg.nexthop);
 
 	zebra_nhg_backup_free(&nhe->backup_info);
@@ -1584,6 +1621,7 @@ void zebra_nhg_free(struct nhg_hash_entry *nhe)
 	if (nhe->refcnt)
 		zlog_debug("nhe_id=%u hash refcnt=%d", nhe->id, nhe->refcnt);
 
+	zebra_nhg_kernel_obj_free(nhe);
 	zebra_nhg_free_members(nhe);
 
 	XFREE(MTYPE_NHG, nhe);
@@ -2013,6 +2051,7 @@ static int nexthop_active(afi_t afi, struct route_entry *re,
 					   __func__, match,
 					   match->nhe->id, newhop);
 
+			rib_nh_dep_add(re, top, rn, &p);
 			return 1;
 		} else if (CHECK_FLAG(re->flags, ZEBRA_FLAG_ALLOW_RECURSION)) {
 			struct nexthop_group *nhg;
@@ -2074,9 +2113,10 @@ static int nexthop_active(afi_t afi, struct route_entry *re,
 				resolved = 1;
 			}
 done_with_match:
-			if (resolved)
+			if (resolved) {
 				re->nexthop_mtu = match->mtu;
-			else if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+				rib_nh_dep_add(re, top, rn, &p);
+			} else if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 				zlog_debug(
 					"        %s: Recursion failed to find",
 					__func__);
@@ -2363,13 +2403,19 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re)
 	struct nhg_hash_entry *curr_nhe;
 	uint32_t curr_active = 0, backup_active = 0;
 
-	if (re->nhe->id >= ZEBRA_NHG_PROTO_LOWER)
+	if (re->nhe->id >= ZEBRA_NHG_PROTO_LOWER) {
+		/* flags of the shared entry are set in place */
+		zebra_nhg_flat_invalidate(re->nhe);
 		return proto_nhg_nexthop_active_update(&re->nhe->nhg);
+	}
 
 	afi_t rt_afi = family2afi(rn->p.family);
 
 	UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
 
+	/* Resolution below records where the nexthops resolve now */
+	rib_nh_deps_clear(re);
+
 	/* Make a local copy of the existing nhe, so we don't work on/modify
 	 * the shared nhe.
 	 */
@@ -2555,6 +2601,115 @@ uint8_t zebra_nhg_nhe2grp(struct nh_grp *grp, struct nhg_hash_entry *nhe,
 	return zebra_nhg_nhe2grp_internal(grp, 0, nhe, max_num);
 }
 
+static unsigned int nhg_kernel_obj_key(const void *arg)
+{
+	const struct nhg_kernel_obj *obj = arg;
+	uint32_t key = 0x7b3a5c1d;
+	int i;
+
+	for (i = 0; i < obj->count; i++)
+		key = jhash_2words(obj->grp[i].id, obj->grp[i].weight, key);
+
+	return key;
+}
+
+static bool nhg_kernel_obj_equal(const void *arg1, const void *arg2)
+{
+	const struct nhg_kernel_obj *obj1 = arg1;
+	const struct nhg_kernel_obj *obj2 = arg2;
+	int i;
+
+	if (obj1->count != obj2->count)
+		return false;
+
+	for (i = 0; i < obj1->count; i++)
+		if (obj1->grp[i].id != obj2->grp[i].id
+		    || obj1->grp[i].weight != obj2->grp[i].weight)
+			return false;
+
+	return true;
+}
+
+static void *nhg_kernel_obj_alloc(void *arg)
+{
+	struct nhg_kernel_obj *obj;
+
+	obj = XMALLOC(MTYPE_NHG_KERNEL, sizeof(*obj));
+	memcpy(obj, arg, sizeof(*obj));
+
+	return obj;
+}
+
+/* Forget the kernel object this nhe owns or shares */
+static void zebra_nhg_kernel_release(struct nhg_hash_entry *nhe)
+{
+	struct nhg_hash_entry *owner = nhe->kernel_nhe;
+
+	zebra_nhg_kernel_obj_free(nhe);
+
+	if (owner) {
+		nhe->kernel_nhe = NULL;
+		nhg_kernel_shared--;
+		zebra_nhg_decrement_ref(owner);
+	}
+}
+
+/*
+ * Look for a group already handed to the kernel with the same resolved
+ * form as this one; if there is one, point at it instead of installing a
+ * copy. Otherwise record this group as the owner of its resolved form.
+ * Only zebra's own groups take part: protocol groups have fixed ids.
+ */
+static bool zebra_nhg_kernel_share(struct nhg_hash_entry *nhe)
+{
+	struct nhg_kernel_obj lookup = {};
+	struct nhg_kernel_obj *obj;
+
+	if (!zebra_nhg_kernel_nexthops_enabled()
+	    || zebra_nhg_depends_is_empty(nhe)
+	    || nhe->id >= ZEBRA_NHG_PROTO_LOWER || nhe->kernel_obj)
+		return false;
+
+	lookup.count = zebra_nhg_nhe2grp(lookup.grp, nhe, MULTIPATH_NUM);
+	if (lookup.count == 0)
+		return false;
+
+	if (!nhg_kernel_objs)
+		nhg_kernel_objs = hash_create_size(
+			1024, nhg_kernel_obj_key, nhg_kernel_obj_equal,
+			"Nexthop Group Kernel Objects");
+
+	obj = hash_lookup(nhg_kernel_objs, &lookup);
+	if (obj) {
+		zebra_nhg_increment_ref(obj->nhe);
+		nhe->kernel_nhe = obj->nhe;
+		nhg_kernel_shared++;
+
+		if (IS_ZEBRA_DEBUG_NHG_DETAIL)
+			zlog_debug("%s: nhe %p (%u) shares kernel object of %u",
+				   __func__, nhe, nhe->id, obj->nhe->id);
+
+		SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+		zebra_nhg_handle_install(nhe);
+		return true;
+	}
+
+	lookup.nhe = nhe;
+	nhe->kernel_obj = hash_get(nhg_kernel_objs, &lookup,
+				   nhg_kernel_obj_alloc);
+	return false;
+}
+
+struct nhg_hash_entry *zebra_nhg_kernel_nhe(struct nhg_hash_entry *nhe)
+{
+	return nhe->kernel_nhe ? nhe->kernel_nhe : nhe;
+}
+
+uint32_t zebra_nhg_kernel_shared_count(void)
+{
+	return nhg_kernel_shared;
+}
+
 void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 {
 	struct nhg_connected *rb_node_dep = NULL;
@@ -2574,6 +2729,9 @@ void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 		if (!ZEBRA_NHG_CREATED(nhe))
 			nhe->type = ZEBRA_ROUTE_NHG;
 
+		if (zebra_nhg_kernel_share(nhe))
+			return;
+
 		int ret = dplane_nexthop_add(nhe);
 
 		switch (ret) {
@@ -2596,6 +2754,11 @@ void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 
 void zebra_nhg_uninstall_kernel(struct nhg_hash_entry *nhe)
 {
+	/* Nothing of our own in the kernel, just let go of the owner */
+	if (nhe->kernel_nhe)
+		UNSET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+	zebra_nhg_kernel_release(nhe);
+
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED)) {
 		int ret = dplane_nexthop_delete(nhe);
 
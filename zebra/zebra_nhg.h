@@ -80,6 +80,18 @@ struct nhg_hash_entry {
 	 */
 	struct nhg_connected_tree_head nhg_depends, nhg_dependents;
 
+	/*
+	 * Kernel object sharing: a group whose resolved form matches a
+	 * group already handed to the kernel reuses that object, and
+	 * holds a reference on its owner through kernel_nhe. An owner
+	 * keeps its resolved form in kernel_obj so others can find it.
+	 */
+	struct nhg_hash_entry *kernel_nhe;
+	struct nhg_kernel_obj *kernel_obj;
+
+	/* Active, resolved nexthops of nhg; see zebra_nhg_flat() */
+	struct nexthop_group_flat *flat;
+
 /*
  * Is this nexthop group valid, ie all nexthops are fully resolved.
  * What is fully resolved?  It's a nexthop that is either self contained
@@ -225,6 +237,14 @@ void zebra_nhg_backup_free(struct nhg_backup_info **p);
 
 struct nexthop_group *zebra_nhg_get_backup_nhg(struct nhg_hash_entry *nhe);
 
+/*
+ * The active, resolved nexthops of the group as an array, built on first
+ * use and kept until the nexthop flags of the entry change.
+ */
+extern const struct nexthop_group_flat *
+zebra_nhg_flat(struct nhg_hash_entry *nhe);
+extern void zebra_nhg_flat_invalidate(struct nhg_hash_entry *nhe);
+
 extern struct nhg_hash_entry *zebra_nhg_resolve(struct nhg_hash_entry *nhe);
 
 extern unsigned int zebra_nhg_depends_count(const struct nhg_hash_entry *nhe);
@@ -317,6 +337,12 @@ extern uint8_t zebra_nhg_nhe2grp(struct nh_grp *grp, struct nhg_hash_entry *nhe,
 
 /* Dataplane install/uninstall */
 extern void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe);
+
+/* The nhe whose kernel object a route using this nhe should point at */
+extern struct nhg_hash_entry *zebra_nhg_kernel_nhe(struct nhg_hash_entry *nhe);
+
+/* Number of groups currently reusing another group's kernel object */
+extern uint32_t zebra_nhg_kernel_shared_count(void);
 extern void zebra_nhg_uninstall_kernel(struct nhg_hash_entry *nhe);
 
 /* Forward ref of dplane update context type */
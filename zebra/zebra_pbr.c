@@ -222,40 +222,56 @@ bool zebra_pbr_rules_hash_equal(const void *arg1, const void *arg2)
 	return true;
 }
 
-struct pbr_rule_unique_lookup {
-	struct zebra_pbr_rule *rule;
-	uint32_t unique;
-	char ifname[INTERFACE_NAMSIZ + 1];
-	vrf_id_t vrf_id;
-};
+/*
+ * Secondary index of the rules hash keyed by what a client uses to name a
+ * rule: its unique id and interface within a vrf.  Updates coming from
+ * flowspec look the previous version of a rule up through it instead of
+ * walking every installed rule.
+ */
+uint32_t zebra_pbr_rules_unique_hash_key(const void *arg)
+{
+	const struct zebra_pbr_rule *rule = arg;
+	uint32_t key;
+
+	key = jhash(rule->rule.ifname,
+		    strnlen(rule->rule.ifname, INTERFACE_NAMSIZ), 0x2f5b93c1);
 
-static int pbr_rule_lookup_unique_walker(struct hash_bucket *b, void *data)
+	return jhash_2words(rule->rule.unique, rule->vrf_id, key);
+}
+
+bool zebra_pbr_rules_unique_hash_equal(const void *arg1, const void *arg2)
 {
-	struct pbr_rule_unique_lookup *pul = data;
-	struct zebra_pbr_rule *rule = b->data;
+	const struct zebra_pbr_rule *r1 = arg1, *r2 = arg2;
 
-	if (pul->unique == rule->rule.unique
-	    && strncmp(pul->ifname, rule->rule.ifname, INTERFACE_NAMSIZ) == 0
-	    && pul->vrf_id == rule->vrf_id) {
-		pul->rule = rule;
-		return HASHWALK_ABORT;
-	}
+	return r1->rule.unique == r2->rule.unique && r1->vrf_id == r2->vrf_id
+	       && strncmp(r1->rule.ifname, r2->rule.ifname, INTERFACE_NAMSIZ)
+			  == 0;
+}
 
-	return HASHWALK_CONTINUE;
+static void pbr_rule_index_add(struct zebra_pbr_rule *rule)
+{
+	struct zebra_pbr_rule *old;
+
+	old = hash_lookup(zrouter.rules_unique_hash, rule);
+	if (old == rule)
+		return;
+	if (old)
+		hash_release(zrouter.rules_unique_hash, old);
+
+	(void)hash_get(zrouter.rules_unique_hash, rule, hash_alloc_intern);
+}
+
+static void pbr_rule_index_del(struct zebra_pbr_rule *rule)
+{
+	/* Only drop the index entry if it still refers to this rule */
+	if (hash_lookup(zrouter.rules_unique_hash, rule) == rule)
+		hash_release(zrouter.rules_unique_hash, rule);
 }
 
 static struct zebra_pbr_rule *
 pbr_rule_lookup_unique(struct zebra_pbr_rule *zrule)
 {
-	struct pbr_rule_unique_lookup pul;
-
-	pul.unique = zrule->rule.unique;
-	strlcpy(pul.ifname, zrule->rule.ifname, INTERFACE_NAMSIZ);
-	pul.rule = NULL;
-	pul.vrf_id = zrule->vrf_id;
-	hash_walk(zrouter.rules_hash, &pbr_rule_lookup_unique_walker, &pul);
-
-	return pul.rule;
+	return hash_lookup(zrouter.rules_unique_hash, zrule);
 }
 
 void zebra_pbr_ipset_free(void *arg)
@@ -300,6 +316,46 @@ bool zebra_pbr_ipset_hash_equal(const void *arg1, const void *arg2)
 	return true;
 }
 
+/*
+ * Secondary index of the ipset hash by name, ipset entries and iptables
+ * received from clients refer to their ipset that way.
+ */
+uint32_t zebra_pbr_ipset_name_hash_key(const void *arg)
+{
+	const struct zebra_pbr_ipset *ipset = arg;
+
+	return jhash(ipset->ipset_name,
+		     strnlen(ipset->ipset_name, ZEBRA_IPSET_NAME_SIZE),
+		     0x7c1a04e9);
+}
+
+bool zebra_pbr_ipset_name_hash_equal(const void *arg1, const void *arg2)
+{
+	const struct zebra_pbr_ipset *r1 = arg1, *r2 = arg2;
+
+	return strncmp(r1->ipset_name, r2->ipset_name, ZEBRA_IPSET_NAME_SIZE)
+	       == 0;
+}
+
+static void pbr_ipset_index_add(struct zebra_pbr_ipset *ipset)
+{
+	struct zebra_pbr_ipset *old;
+
+	old = hash_lookup(zrouter.ipset_name_hash, ipset);
+	if (old == ipset)
+		return;
+	if (old)
+		hash_release(zrouter.ipset_name_hash, old);
+
+	(void)hash_get(zrouter.ipset_name_hash, ipset, hash_alloc_intern);
+}
+
+static void pbr_ipset_index_del(struct zebra_pbr_ipset *ipset)
+{
+	if (hash_lookup(zrouter.ipset_name_hash, ipset) == ipset)
+		hash_release(zrouter.ipset_name_hash, ipset);
+}
+
 void zebra_pbr_ipset_entry_free(void *arg)
 {
 	struct zebra_pbr_ipset_entry *ipset;
@@ -484,6 +540,7 @@ static int pbr_rule_release(struct zebra_pbr_rule *rule)
 		return -ENOENT;
 
 	hash_release(zrouter.rules_hash, lookup);
+	pbr_rule_index_del(lookup);
 	XFREE(MTYPE_TMP, lookup);
 
 	return 0;
@@ -491,15 +548,16 @@ static int pbr_rule_release(struct zebra_pbr_rule *rule)
 
 void zebra_pbr_add_rule(struct zebra_pbr_rule *rule)
 {
-	struct zebra_pbr_rule *found;
+	struct zebra_pbr_rule *found, *new;
 
 	/**
-	 * Check if we already have it (this checks via a unique ID, walking
-	 * over the hash table, not via a hash operation).
+	 * Check if we already have it (this checks via a unique ID, through
+	 * the secondary index rather than the rules hash key).
 	 */
 	found = pbr_rule_lookup_unique(rule);
 
-	(void)hash_get(zrouter.rules_hash, rule, pbr_rule_alloc_intern);
+	new = hash_get(zrouter.rules_hash, rule, pbr_rule_alloc_intern);
+	pbr_rule_index_add(new);
 
 	/* If found, this is an update */
 	if (found) {
@@ -530,6 +588,7 @@ static void zebra_pbr_cleanup_rules(struct hash_bucket *b, void *data)
 
 	if (rule->sock == *sock) {
 		(void)dplane_pbr_rule_delete(rule);
+		pbr_rule_index_del(rule);
 		if (hash_release(zrouter.rules_hash, rule))
 			XFREE(MTYPE_TMP, rule);
 		else
@@ -545,6 +604,7 @@ static void zebra_pbr_cleanup_ipset(struct hash_bucket *b, void *data)
 	int *sock = data;
 
 	if (ipset->sock == *sock) {
+		pbr_ipset_index_del(ipset);
 		if (hash_release(zrouter.ipset_hash, ipset))
 			zebra_pbr_ipset_free(ipset);
 		else
@@ -613,9 +673,11 @@ static void *pbr_ipset_alloc_intern(void *arg)
 
 void zebra_pbr_create_ipset(struct zebra_pbr_ipset *ipset)
 {
+	struct zebra_pbr_ipset *new;
 	int ret;
 
-	(void)hash_get(zrouter.ipset_hash, ipset, pbr_ipset_alloc_intern);
+	new = hash_get(zrouter.ipset_hash, ipset, pbr_ipset_alloc_intern);
+	pbr_ipset_index_add(new);
 	ret = hook_call(zebra_pbr_ipset_update, 1, ipset);
 	kernel_pbr_ipset_add_del_status(ipset,
 					ret ? ZEBRA_DPLANE_INSTALL_SUCCESS
@@ -630,6 +692,7 @@ void zebra_pbr_destroy_ipset(struct zebra_pbr_ipset *ipset)
 	hook_call(zebra_pbr_ipset_update, 0, ipset);
 	if (lookup) {
 		hash_release(zrouter.ipset_hash, lookup);
+		pbr_ipset_index_del(lookup);
 		XFREE(MTYPE_TMP, lookup);
 	} else
 		zlog_debug(
@@ -637,43 +700,21 @@ void zebra_pbr_destroy_ipset(struct zebra_pbr_ipset *ipset)
 			__func__);
 }
 
-struct pbr_ipset_name_lookup {
-	struct zebra_pbr_ipset *ipset;
-	char ipset_name[ZEBRA_IPSET_NAME_SIZE];
-};
-
 const char *zebra_pbr_ipset_type2str(uint32_t type)
 {
 	return lookup_msg(ipset_type_msg, type,
 			  "Unrecognized IPset Type");
 }
 
-static int zebra_pbr_ipset_pername_walkcb(struct hash_bucket *bucket, void *arg)
-{
-	struct pbr_ipset_name_lookup *pinl =
-		(struct pbr_ipset_name_lookup *)arg;
-	struct zebra_pbr_ipset *zpi = (struct zebra_pbr_ipset *)bucket->data;
-
-	if (!strncmp(pinl->ipset_name, zpi->ipset_name,
-		     ZEBRA_IPSET_NAME_SIZE)) {
-		pinl->ipset = zpi;
-		return HASHWALK_ABORT;
-	}
-	return HASHWALK_CONTINUE;
-}
-
 struct zebra_pbr_ipset *zebra_pbr_lookup_ipset_pername(char *ipsetname)
 {
-	struct pbr_ipset_name_lookup pinl;
-	struct pbr_ipset_name_lookup *ptr = &pinl;
+	struct zebra_pbr_ipset lookup;
 
 	if (!ipsetname)
 		return NULL;
-	memset(ptr, 0, sizeof(struct pbr_ipset_name_lookup));
-	snprintf((char *)ptr->ipset_name, ZEBRA_IPSET_NAME_SIZE, "%s",
-		ipsetname);
-	hash_walk(zrouter.ipset_hash, zebra_pbr_ipset_pername_walkcb, ptr);
-	return ptr->ipset;
+	memset(&lookup, 0, sizeof(lookup));
+	strlcpy(lookup.ipset_name, ipsetname, sizeof(lookup.ipset_name));
+	return hash_lookup(zrouter.ipset_name_hash, &lookup);
 }
 
 static void *pbr_ipset_entry_alloc_intern(void *arg)
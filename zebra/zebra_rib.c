@@ -56,8 +56,12 @@
 #include "zebra/zebra_vxlan.h"
 #include "zebra/zapi_msg.h"
 #include "zebra/zebra_dplane.h"
+#include "zebra/zebra_trace.h"
+#include "zebra/zebra_rib_journal.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, RIB_UPDATE_CTX, "Rib update context object");
+DEFINE_MTYPE_STATIC(ZEBRA, RIB_MQ_SHARD, "Rib meta-queue shard");
+DEFINE_MTYPE_STATIC(ZEBRA, RIB_NH_DEP, "Rib nexthop dependency");
 
 /*
  * Event, list, and mutex for delivery of dataplane results
@@ -69,6 +73,9 @@ static struct dplane_ctx_q rib_dplane_q;
 DEFINE_HOOK(rib_update, (struct route_node * rn, const char *reason),
 	    (rn, reason))
 
+/* IPv4 table size at which the first-stride lookup index is built */
+#define RIB_STRIDE_MIN_ROUTES 10000
+
 /* Should we allow non Quagga processes to delete our routes */
 extern int allow_delete;
 
@@ -652,11 +659,88 @@ static int rib_can_delete_dest(rib_dest_t *dest)
 	return 1;
 }
 
+/* Record that a recursive nexthop of 're' resolved through 'resolver' */
+void rib_nh_dep_add(struct route_entry *re, struct route_node *re_node,
+		    struct route_node *resolver, const struct prefix *addr)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(resolver);
+	struct rib_nh_dep *dep;
+
+	if (!dest)
+		return;
+
+	frr_each (re_nh_deps, &re->nh_deps, dep)
+		if (dep->resolver == dest && prefix_same(&dep->addr, addr))
+			return;
+
+	dep = XCALLOC(MTYPE_RIB_NH_DEP, sizeof(*dep));
+	dep->re = re;
+	dep->re_node = re_node;
+	dep->resolver = dest;
+	prefix_copy(&dep->addr, addr);
+
+	re_nh_deps_add_head(&re->nh_deps, dep);
+	rib_nh_dependents_add_tail(&dest->nh_dependents, dep);
+}
+
+/* Forget where the nexthops of 're' resolved, before resolving again */
+void rib_nh_deps_clear(struct route_entry *re)
+{
+	struct rib_nh_dep *dep;
+
+	while ((dep = re_nh_deps_pop(&re->nh_deps))) {
+		rib_nh_dependents_del(&dep->resolver->nh_dependents, dep);
+		XFREE(MTYPE_RIB_NH_DEP, dep);
+	}
+}
+
+static void rib_nh_deps_release(rib_dest_t *dest)
+{
+	struct rib_nh_dep *dep;
+
+	while ((dep = rib_nh_dependents_pop(&dest->nh_dependents))) {
+		re_nh_deps_del(&dep->re->nh_deps, dep);
+		XFREE(MTYPE_RIB_NH_DEP, dep);
+	}
+}
+
+/*
+ * The route at rn changed: requeue the route entries whose recursive
+ * nexthops resolved through rn, and those that resolved through a less
+ * specific node but look for an address rn now covers.
+ */
+static void rib_nh_deps_evaluate(struct route_node *rn)
+{
+	struct route_node *node;
+	struct rib_nh_dep *dep;
+	rib_dest_t *dest;
+
+	for (node = rn; node; node = node->parent) {
+		dest = rib_dest_from_rnode(node);
+		if (!dest)
+			continue;
+
+		frr_each (rib_nh_dependents, &dest->nh_dependents, dep) {
+			if (node != rn && !prefix_match(&rn->p, &dep->addr))
+				continue;
+
+			if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+				zlog_debug("%s: %pRN changed, re-resolving %pRN",
+					   __func__, rn, dep->re_node);
+
+			SET_FLAG(dep->re->status, ROUTE_ENTRY_CHANGED);
+			rib_queue_add(dep->re_node);
+		}
+	}
+}
+
 void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq)
 {
 	rib_dest_t *dest = rib_dest_from_rnode(rn);
 	struct rnh *rnh;
 
+	rib_nh_deps_evaluate(rn);
+
 	/*
 	 * We are storing the rnh's associated withb
 	 * the tracked nexthop as a list of the rn's.
@@ -765,8 +849,11 @@ int rib_gc_dest(struct route_node *rn)
 
 	dest->rnode = NULL;
 	rnh_list_fini(&dest->nht);
+	rib_nh_deps_release(dest);
+	rib_nh_dependents_fini(&dest->nh_dependents);
 	XFREE(MTYPE_RIB_DEST, dest);
 	rn->info = NULL;
+	rib_rnode_table_info(rn)->dest_count--;
 
 	/*
 	 * Release the one reference that we keep on the route node.
@@ -782,7 +869,7 @@ static void rib_process_add_fib(struct zebra_vrf *zvrf, struct route_node *rn,
 
 	/* Update real nexthop. This may actually determine if nexthop is active
 	 * or not. */
-	if (!nexthop_group_active_nexthop_num(&(new->nhe->nhg))) {
+	if (!zebra_nhg_flat(new->nhe)->num) {
 		UNSET_FLAG(new->status, ROUTE_ENTRY_CHANGED);
 		return;
 	}
@@ -851,7 +938,7 @@ static void rib_process_update_fib(struct zebra_vrf *zvrf,
 
 		/* Update the nexthop; we could determine here that nexthop is
 		 * inactive. */
-		if (nexthop_group_active_nexthop_num(&(new->nhe->nhg)))
+		if (zebra_nhg_flat(new->nhe)->num)
 			nh_active = 1;
 
 		/* If nexthop is active, install the selected route, if
@@ -1145,7 +1232,7 @@ static void rib_process(struct route_node *rn)
 			 * for consideration, as that the route will just
 			 * not install if it is selected.
 			 */
-			if (!nexthop_group_active_nexthop_num(&re->nhe->nhg))
+			if (!zebra_nhg_flat(re->nhe)->num)
 				continue;
 		}
 
@@ -2245,13 +2332,11 @@ static void process_subq_nhg(struct listnode *lnode)
 	rib_nhg_process(ctx);
 }
 
-static void process_subq_route(struct listnode *lnode, uint8_t qindex)
+static void process_subq_route(struct route_node *rnode, uint8_t qindex)
 {
-	struct route_node *rnode = NULL;
 	rib_dest_t *dest = NULL;
 	struct zebra_vrf *zvrf = NULL;
 
-	rnode = listgetdata(lnode);
 	dest = rib_dest_from_rnode(rnode);
 	assert(dest);
 
@@ -2293,42 +2378,67 @@ static void process_subq_route(struct listnode *lnode, uint8_t qindex)
 	route_unlock_node(rnode);
 }
 
-/* Take a list of route_node structs and return 1, if there was a record
- * picked from it and processed by rib_process(). Don't process more,
- * than one RN record; operate only in the specified sub-queue.
+static void meta_queue_dwell(struct meta_queue *mq, int64_t usec)
+{
+	unsigned i;
+	int64_t limit = 1000;
+
+	for (i = 0; i < MQ_DWELL_BUCKETS - 1; i++, limit *= 10)
+		if (usec < limit)
+			break;
+	mq->dwell[i]++;
+}
+
+/* Pick the route sub-queue to serve next: the best priority with work
+ * pending, unless a lower priority one has a node that aged past
+ * MQ_AGE_USEC.  Returns MQ_SIZE if there is nothing to do.
  */
-static unsigned int process_subq(struct list *subq, uint8_t qindex)
+static unsigned meta_queue_pick(struct meta_queue *mq)
 {
-	struct listnode *lnode = listhead(subq);
+	struct meta_queue_subq *sq;
+	rib_dest_t *dest;
+	unsigned i, pick = MQ_SIZE;
 
-	if (!lnode)
-		return 0;
+	for (i = 0; i < MQ_SIZE; i++) {
+		sq = mq_runq_first(&mq->runq[i]);
+		if (!sq)
+			continue;
 
-	if (qindex == route_info[ZEBRA_ROUTE_NHG].meta_q_map)
-		process_subq_nhg(lnode);
-	else
-		process_subq_route(lnode, qindex);
+		if (pick == MQ_SIZE) {
+			pick = i;
+			continue;
+		}
 
-	list_delete_node(subq, lnode);
+		dest = rib_dest_from_rnode(listgetdata(listhead(sq->nodes)));
+		if (monotime_since(&dest->mq_queued, NULL) > MQ_AGE_USEC) {
+			mq->aged++;
+			return i;
+		}
+	}
 
-	return 1;
+	return pick;
 }
 
 /* Dispatch the meta queue by picking, processing and unlocking the next RN from
- * a non-empty sub-queue with lowest priority. wq is equal to zebra->ribq and
- * data
+ * a non-empty sub-queue with lowest priority. Shards waiting on the same
+ * sub-queue are served round-robin. wq is equal to zebra->ribq and data
  * is pointed to the meta queue structure.
  */
 static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 {
 	struct meta_queue *mq = data;
+	struct meta_queue_subq *sq;
+	struct listnode *lnode;
+	struct route_node *rnode;
+	rib_dest_t *dest;
 	unsigned i;
 	uint32_t queue_len, queue_limit;
+	int64_t dwell;
 
 	/* Ensure there's room for more dataplane updates */
 	queue_limit = dplane_get_in_queue_limit();
 	queue_len = dplane_get_in_queue_len();
-	if (queue_len > queue_limit) {
+	if (queue_len > queue_limit || dplane_is_backlogged()) {
 		if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 			zlog_debug("rib queue: dplane queue len %u, limit %u, retrying",
 				   queue_len, queue_limit);
@@ -2340,39 +2450,113 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 		return WQ_QUEUE_BLOCKED;
 	}
 
-	for (i = 0; i < MQ_SIZE; i++)
-		if (process_subq(mq->subq[i], i)) {
-			mq->size--;
-			break;
-		}
+	/* NHGs first, routes may depend on them */
+	lnode = listhead(mq->nhg_subq);
+	if (lnode) {
+		process_subq_nhg(lnode);
+		list_delete_node(mq->nhg_subq, lnode);
+		mq->size--;
+		return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
+	}
+
+	i = meta_queue_pick(mq);
+	if (i < MQ_SIZE) {
+		sq = mq_runq_pop(&mq->runq[i]);
+		lnode = listhead(sq->nodes);
+		rnode = listgetdata(lnode);
+		list_delete_node(sq->nodes, lnode);
+
+		dest = rib_dest_from_rnode(rnode);
+		dest->mq_node = NULL;
+		dwell = monotime_since(&dest->mq_queued, NULL);
+		meta_queue_dwell(mq, dwell);
+		frrtrace(3, frr_zebra, meta_queue_dequeue, rnode, i, dwell);
+
+		sq->shard->size--;
+		sq->shard->processed++;
+		mq->size--;
+
+		/* Back of the line for this shard */
+		if (listcount(sq->nodes))
+			mq_runq_add_tail(&mq->runq[i], sq);
+
+		process_subq_route(rnode, i);
+	}
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
+static struct meta_queue_shard *meta_queue_shard_get(struct zebra_vrf *zvrf)
+{
+	struct meta_queue_shard *shard;
+	unsigned i;
+
+	if (zvrf->mq_shard)
+		return zvrf->mq_shard;
+
+	shard = XCALLOC(MTYPE_RIB_MQ_SHARD, sizeof(*shard));
+	shard->zvrf = zvrf;
+	for (i = 0; i < MQ_SIZE; i++) {
+		shard->subq[i].shard = shard;
+		shard->subq[i].nodes = list_new();
+	}
+
+	zvrf->mq_shard = shard;
+	return shard;
+}
+
+/* Drop everything queued for a VRF that is going away */
+void meta_queue_vrf_flush(struct meta_queue *mq, struct zebra_vrf *zvrf)
+{
+	struct meta_queue_shard *shard = zvrf->mq_shard;
+	struct meta_queue_subq *sq;
+	struct listnode *lnode, *nnode;
+	struct route_node *rnode;
+	rib_dest_t *dest;
+	unsigned i;
+
+	if (!shard)
+		return;
+
+	for (i = 0; i < MQ_SIZE; i++) {
+		sq = &shard->subq[i];
+
+		if (listcount(sq->nodes))
+			mq_runq_del(&mq->runq[i], sq);
+
+		for (ALL_LIST_ELEMENTS(sq->nodes, lnode, nnode, rnode)) {
+			dest = rib_dest_from_rnode(rnode);
+			if (dest)
+				dest->mq_node = NULL;
+			route_unlock_node(rnode);
+			list_delete_node(sq->nodes, lnode);
+			mq->size--;
+		}
+		list_delete(&sq->nodes);
+	}
+
+	zvrf->mq_shard = NULL;
+	XFREE(MTYPE_RIB_MQ_SHARD, shard);
+}
 
 /*
  * Look into the RN and queue it into the highest priority queue
  * at this point in time for processing.
  *
- * We will enqueue a route node only once per invocation.
- *
- * There are two possibilities here that should be kept in mind.
- * If the original invocation has not been pulled off for processing
- * yet, A subsuquent invocation can have a route entry with a better
- * meta queue index value and we can have a situation where
- * we might have the same node enqueued 2 times.  Not necessarily
- * an optimal situation but it should be ok.
- *
- * The other possibility is that the original invocation has not
- * been pulled off for processing yet, A subsusquent invocation
- * doesn't have a route_entry with a better meta-queue and the
- * original metaqueue index value will win and we'll end up with
- * the route node enqueued once.
+ * A route node is held in the meta-queue at most once.  If it is
+ * already waiting, the new event is coalesced into that record: the
+ * node is moved up if the new event calls for a better sub-queue and
+ * otherwise left where it is, since rib_process() looks at every
+ * route entry of the node anyway.  The time it was first queued is
+ * kept so that aging and the dwell statistics see the whole wait.
  */
 static int rib_meta_queue_add(struct meta_queue *mq, void *data)
 {
 	struct route_node *rn = NULL;
 	struct route_entry *re = NULL, *curr_re = NULL;
 	uint8_t qindex = MQ_SIZE, curr_qindex = MQ_SIZE;
+	struct meta_queue_shard *shard;
+	struct meta_queue_subq *sq;
+	rib_dest_t *dest;
 
 	rn = (struct route_node *)data;
 
@@ -2389,19 +2573,53 @@ static int rib_meta_queue_add(struct meta_queue *mq, void *data)
 		return -1;
 
 	/* Invariant: at this point we always have rn->info set. */
-	if (CHECK_FLAG(rib_dest_from_rnode(rn)->flags,
-		       RIB_ROUTE_QUEUED(qindex))) {
-		if (IS_ZEBRA_DEBUG_RIB_DETAILED)
-			rnode_debug(rn, re->vrf_id,
-				    "rn %p is already queued in sub-queue %u",
-				    (void *)rn, qindex);
-		return -1;
+	dest = rib_dest_from_rnode(rn);
+	shard = meta_queue_shard_get(rib_dest_vrf(dest));
+
+	if (dest->mq_node) {
+		mq->coalesced++;
+
+		if (qindex >= dest->mq_qindex) {
+			if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+				rnode_debug(rn, re->vrf_id,
+					    "rn %p is already queued in sub-queue %u",
+					    (void *)rn, dest->mq_qindex);
+			return -1;
+		}
+
+		sq = &shard->subq[dest->mq_qindex];
+		list_delete_node(sq->nodes, dest->mq_node);
+		if (!listcount(sq->nodes))
+			mq_runq_del(&mq->runq[dest->mq_qindex], sq);
+		UNSET_FLAG(dest->flags, RIB_ROUTE_QUEUED(dest->mq_qindex));
+		mq->promoted++;
+	} else {
+		/* Being processed right now and requeued at the same level */
+		if (CHECK_FLAG(dest->flags, RIB_ROUTE_QUEUED(qindex))) {
+			if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+				rnode_debug(rn, re->vrf_id,
+					    "rn %p is already queued in sub-queue %u",
+					    (void *)rn, qindex);
+			return -1;
+		}
+
+		route_lock_node(rn);
+		monotime(&dest->mq_queued);
+		mq->size++;
+
+		shard->size++;
+		if (shard->size > shard->max_size)
+			shard->max_size = shard->size;
 	}
 
-	SET_FLAG(rib_dest_from_rnode(rn)->flags, RIB_ROUTE_QUEUED(qindex));
-	listnode_add(mq->subq[qindex], rn);
-	route_lock_node(rn);
-	mq->size++;
+	sq = &shard->subq[qindex];
+
+	SET_FLAG(dest->flags, RIB_ROUTE_QUEUED(qindex));
+	dest->mq_node = listnode_add(sq->nodes, rn);
+	dest->mq_qindex = qindex;
+	frrtrace(3, frr_zebra, meta_queue_enqueue, rn, re->vrf_id, qindex);
+	if (listcount(sq->nodes) == 1)
+		mq_runq_add_tail(&mq->runq[qindex], sq);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 		rnode_debug(rn, re->vrf_id, "queued rn %p into sub-queue %u",
@@ -2420,7 +2638,7 @@ static int rib_meta_queue_nhg_add(struct meta_queue *mq, void *data)
 	if (!ctx)
 		return -1;
 
-	listnode_add(mq->subq[qindex], ctx);
+	listnode_add(mq->nhg_subq, ctx);
 	mq->size++;
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
@@ -2487,20 +2705,21 @@ static struct meta_queue *meta_queue_new(void)
 
 	new = XCALLOC(MTYPE_WORK_QUEUE, sizeof(struct meta_queue));
 
-	for (i = 0; i < MQ_SIZE; i++) {
-		new->subq[i] = list_new();
-		assert(new->subq[i]);
-	}
+	new->nhg_subq = list_new();
+	for (i = 0; i < MQ_SIZE; i++)
+		mq_runq_init(&new->runq[i]);
 
 	return new;
 }
 
+/* Shards are owned by their VRF and released in meta_queue_vrf_flush() */
 void meta_queue_free(struct meta_queue *mq)
 {
 	unsigned i;
 
+	list_delete(&mq->nhg_subq);
 	for (i = 0; i < MQ_SIZE; i++)
-		list_delete(&mq->subq[i]);
+		mq_runq_fini(&mq->runq[i]);
 
 	XFREE(MTYPE_WORK_QUEUE, mq);
 }
@@ -2539,9 +2758,11 @@ rib_dest_t *zebra_rib_create_dest(struct route_node *rn)
 	dest = XCALLOC(MTYPE_RIB_DEST, sizeof(rib_dest_t));
 	rnh_list_init(&dest->nht);
 	re_list_init(&dest->routes);
+	rib_nh_dependents_init(&dest->nh_dependents);
 	route_lock_node(rn); /* rn route table reference */
 	rn->info = dest;
 	dest->rnode = rn;
+	rib_rnode_table_info(rn)->dest_count++;
 
 	return dest;
 }
@@ -2601,6 +2822,7 @@ static void rib_link(struct route_node *rn, struct route_entry *re, int process)
 	}
 
 	re_list_add_head(&dest->routes, re);
+	rib_rnode_table_info(rn)->re_count++;
 
 	afi = (rn->p.family == AF_INET)
 		      ? AFI_IP
@@ -2653,6 +2875,7 @@ void rib_unlink(struct route_node *rn, struct route_entry *re)
 	dest = rib_dest_from_rnode(rn);
 
 	re_list_del(&dest->routes, re);
+	rib_rnode_table_info(rn)->re_count--;
 
 	if (dest->selected_fib == re)
 		dest->selected_fib = NULL;
@@ -2665,6 +2888,8 @@ void rib_unlink(struct route_node *rn, struct route_entry *re)
 
 	nexthops_free(re->fib_ng.nexthop);
 
+	rib_nh_deps_clear(re);
+
 	XFREE(MTYPE_RE, re);
 }
 
@@ -2676,6 +2901,7 @@ void rib_delnode(struct route_node *rn, struct route_entry *re)
 		rnode_debug(rn, re->vrf_id, "rn %p, re %p, removing",
 			    (void *)rn, (void *)re);
 	SET_FLAG(re->status, ROUTE_ENTRY_REMOVED);
+	zebra_rib_journal_del(rn, re);
 
 	afi = (rn->p.family == AF_INET)
 		      ? AFI_IP
@@ -2996,6 +3222,16 @@ int rib_add_multipath_nhe(afi_t afi, safi_t safi, struct prefix *p,
 	/* Lookup route node.*/
 	rn = srcdest_rnode_get(table, p, src_p);
 
+	/*
+	 * Once an IPv4 table is full-table sized, index its first 16 bits:
+	 * nexthop resolution does a route_node_match() per recursive
+	 * nexthop and that skips most of the tree with it.  Smaller tables
+	 * (most VRFs) are not worth the 512KB.
+	 */
+	if (afi == AFI_IP && safi == SAFI_UNICAST && !table->stride
+	    && route_table_count(table) >= RIB_STRIDE_MIN_ROUTES)
+		route_table_set_stride(table, AF_INET, 16);
+
 	/*
 	 * If same type of route are installed, treat it as a implicit
 	 * withdraw. If the user has specified the No route replace semantics
@@ -3034,6 +3270,8 @@ int rib_add_multipath_nhe(afi_t afi, safi_t safi, struct prefix *p,
 	if (same)
 		rib_delnode(rn, same);
 
+	zebra_rib_journal_add(rn, re);
+
 	route_unlock_node(rn);
 	return ret;
 }
@@ -3546,6 +3784,35 @@ void rib_update(enum rib_update_event event)
 			   rib_update_event2str(event));
 }
 
+/*
+ * Interface and address events arrive in storms (thousands of
+ * sub-interfaces coming up or going down at once); the RIB walk they
+ * trigger is delayed a little so that the whole storm is folded into a
+ * single pass over each table.
+ */
+#define RIB_UPDATE_DEBOUNCE_MSEC 50
+
+static struct thread *t_rib_update_debounce[RIB_UPDATE_MAX];
+
+/* Schedule a delayed RIB update event for all vrfs */
+void rib_update_debounce(enum rib_update_event event)
+{
+	struct rib_update_ctx *ctx;
+
+	ctx = rib_update_ctx_init(0, event);
+
+	ctx->vrf_all = true;
+
+	if (!thread_add_timer_msec(zrouter.master, rib_update_handler, ctx,
+				   RIB_UPDATE_DEBOUNCE_MSEC,
+				   &t_rib_update_debounce[event]))
+		rib_update_ctx_fini(&ctx); /* Already scheduled */
+	else if (IS_ZEBRA_DEBUG_EVENT)
+		zlog_debug("%s: Scheduled VRF (ALL) in %ums, event %s",
+			   __func__, RIB_UPDATE_DEBOUNCE_MSEC,
+			   rib_update_event2str(event));
+}
+
 /* Delete self installed routes after zebra is relaunched.  */
 void rib_sweep_table(struct route_table *table)
 {
@@ -3777,6 +4044,8 @@ static int rib_process_dplane_results(struct thread *thread)
 		}
 
 		while (ctx) {
+			frrtrace(1, frr_zebra, dplane_complete, ctx);
+
 			switch (dplane_ctx_get_op(ctx)) {
 			case DPLANE_OP_ROUTE_INSTALL:
 			case DPLANE_OP_ROUTE_UPDATE:
@@ -3787,9 +4056,10 @@ static int rib_process_dplane_results(struct thread *thread)
 				 * we don't want to continue processing these
 				 * in the rib.
 				 */
-				if (dplane_ctx_get_notif_provider(ctx) == 0)
+				if (dplane_ctx_get_notif_provider(ctx) == 0) {
+					dplane_ctx_latency_done(ctx);
 					rib_process_result(ctx);
-				else
+				} else
 					dplane_ctx_fini(&ctx);
 			}
 			break;
@@ -0,0 +1,587 @@
+/*
+ * Zebra RIB journal for warm restart
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <sys/mman.h>
+
+#include "frratomic.h"
+#include "lib_errors.h"
+#include "log.h"
+#include "memory.h"
+#include "nexthop.h"
+#include "nexthop_group.h"
+#include "srcdest_table.h"
+#include "vrf.h"
+
+#include "zebra/debug.h"
+#include "zebra/rib.h"
+#include "zebra/rt.h"
+#include "zebra/zebra_memory.h"
+#include "zebra/zebra_router.h"
+#include "zebra/zebra_vrf.h"
+#include "zebra/zebra_rib_journal.h"
+
+#define RIB_JOURNAL_MAGIC 0x5a524a31 /* "ZRJ1" */
+#define RIB_JOURNAL_VERSION 1
+
+enum rib_journal_op {
+	RIB_JOURNAL_ADD = 1,
+	RIB_JOURNAL_DEL = 2,
+};
+
+/* File layout: header, then records up to `used` */
+struct rib_journal_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;
+	uint64_t used;
+};
+
+struct rib_journal_nh {
+	vrf_id_t vrf_id;
+	ifindex_t ifindex;
+	union g_addr gate;
+	union g_addr src;
+	uint8_t type;
+	uint8_t flags;
+	uint8_t bh_type;
+	uint8_t weight;
+	uint8_t label_type;
+	uint8_t label_num;
+	uint8_t pad[2];
+	mpls_label_t labels[MPLS_MAX_LABELS];
+};
+
+struct rib_journal_rec {
+	uint32_t len;
+	uint8_t op;
+	uint8_t afi;
+	uint8_t safi;
+	uint8_t type;
+	uint16_t instance;
+	uint8_t distance;
+	uint8_t nexthop_num;
+	vrf_id_t vrf_id;
+	uint32_t table_id;
+	uint32_t flags;
+	uint32_t metric;
+	uint32_t mtu;
+	route_tag_t tag;
+	uint8_t family;
+	uint8_t prefixlen;
+	uint8_t src_prefixlen;
+	uint8_t pad;
+	struct in6_addr prefix;
+	struct in6_addr src;
+	struct rib_journal_nh nh[];
+};
+
+/* Only the top level nexthops are journaled */
+#define RIB_JOURNAL_MAX_NH MIN(MULTIPATH_NUM, UINT8_MAX)
+#define RIB_JOURNAL_REC_MAX                                                    \
+	(sizeof(struct rib_journal_rec)                                        \
+	 + RIB_JOURNAL_MAX_NH * sizeof(struct rib_journal_nh))
+
+const char *rib_journal_path;
+
+static struct rib_journal {
+	int fd;
+	struct rib_journal_hdr *hdr;
+	size_t size;
+
+	/* Don't journal the RIB changes the replay itself makes */
+	bool replaying;
+} journal = {.fd = -1};
+
+static union {
+	struct rib_journal_rec rec;
+	uint8_t buf[RIB_JOURNAL_REC_MAX];
+} rec_buf;
+
+static size_t rib_journal_encode(struct rib_journal_rec *rec, uint8_t op,
+				 struct route_node *rn, struct route_entry *re)
+{
+	struct rib_table_info *info = rib_rnode_table_info(rn);
+	const struct prefix *p, *src_p;
+	struct nexthop *nexthop;
+	struct rib_journal_nh *jnh;
+
+	srcdest_rnode_prefixes(rn, &p, &src_p);
+
+	memset(rec, 0, sizeof(*rec));
+	rec->op = op;
+	rec->afi = info->afi;
+	rec->safi = info->safi;
+	rec->type = re->type;
+	rec->instance = re->instance;
+	rec->distance = re->distance;
+	rec->vrf_id = re->vrf_id;
+	rec->table_id = re->table;
+	rec->flags = re->flags & ~ZEBRA_FLAG_SELFROUTE;
+	rec->metric = re->metric;
+	rec->mtu = re->mtu;
+	rec->tag = re->tag;
+	rec->family = p->family;
+	rec->prefixlen = p->prefixlen;
+	memcpy(&rec->prefix, &p->u.prefix, prefix_blen(p));
+	if (src_p && src_p->prefixlen) {
+		rec->src_prefixlen = src_p->prefixlen;
+		memcpy(&rec->src, &src_p->u.prefix6, sizeof(rec->src));
+	}
+
+	if (op == RIB_JOURNAL_ADD && re->nhe) {
+		for (nexthop = re->nhe->nhg.nexthop; nexthop;
+		     nexthop = nexthop->next) {
+			if (rec->nexthop_num == RIB_JOURNAL_MAX_NH)
+				break;
+
+			jnh = &rec->nh[rec->nexthop_num++];
+			memset(jnh, 0, sizeof(*jnh));
+			jnh->vrf_id = nexthop->vrf_id;
+			jnh->ifindex = nexthop->ifindex;
+			jnh->type = nexthop->type;
+			jnh->flags = nexthop->flags & NEXTHOP_FLAG_ONLINK;
+			if (nexthop->type == NEXTHOP_TYPE_BLACKHOLE)
+				jnh->bh_type = nexthop->bh_type;
+			else
+				jnh->gate = nexthop->gate;
+			jnh->src = nexthop->src;
+			jnh->weight = nexthop->weight;
+			if (nexthop->nh_label) {
+				jnh->label_type = nexthop->nh_label_type;
+				jnh->label_num = MIN(nexthop->nh_label->num_labels,
+						     MPLS_MAX_LABELS);
+				memcpy(jnh->labels, nexthop->nh_label->label,
+				       jnh->label_num * sizeof(mpls_label_t));
+			}
+		}
+	}
+
+	rec->len = sizeof(*rec) + rec->nexthop_num * sizeof(rec->nh[0]);
+	return rec->len;
+}
+
+static bool rib_journal_route(struct route_node *rn, struct route_entry *re)
+{
+	if (RIB_SYSTEM_ROUTE(re))
+		return false;
+
+	return rib_rnode_table_info(rn)->safi == SAFI_UNICAST;
+}
+
+static void rib_journal_hdr_init(struct rib_journal_hdr *hdr, size_t size)
+{
+	hdr->magic = RIB_JOURNAL_MAGIC;
+	hdr->version = RIB_JOURNAL_VERSION;
+	hdr->size = size;
+	hdr->used = sizeof(*hdr);
+}
+
+static void rib_journal_write(struct rib_journal_hdr *hdr,
+			      const struct rib_journal_rec *rec)
+{
+	memcpy((uint8_t *)hdr + hdr->used, rec, rec->len);
+
+	/* the record must be complete before `used` covers it */
+	atomic_thread_fence(memory_order_release);
+	hdr->used += rec->len;
+}
+
+/*
+ * Write every journaled route of `table` to `hdr`, or if that is NULL,
+ * only add up the space needed.
+ */
+static size_t rib_journal_snapshot_table(struct rib_journal_hdr *hdr,
+					 struct route_table *table)
+{
+	struct route_node *rn;
+	struct route_entry *re;
+	size_t len = 0;
+
+	if (!table)
+		return 0;
+
+	for (rn = route_top(table); rn; rn = srcdest_route_next(rn)) {
+		RNODE_FOREACH_RE (rn, re) {
+			if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+				continue;
+			if (!rib_journal_route(rn, re))
+				continue;
+
+			len += rib_journal_encode(&rec_buf.rec, RIB_JOURNAL_ADD,
+						  rn, re);
+			if (hdr)
+				rib_journal_write(hdr, &rec_buf.rec);
+		}
+	}
+
+	return len;
+}
+
+static size_t rib_journal_snapshot(struct rib_journal_hdr *hdr)
+{
+	struct vrf *vrf;
+	struct zebra_vrf *zvrf;
+	struct other_route_table *ort;
+	size_t len = sizeof(struct rib_journal_hdr);
+
+	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id) {
+		zvrf = vrf->info;
+		if (!zvrf)
+			continue;
+
+		len += rib_journal_snapshot_table(
+			hdr, zvrf->table[AFI_IP][SAFI_UNICAST]);
+		len += rib_journal_snapshot_table(
+			hdr, zvrf->table[AFI_IP6][SAFI_UNICAST]);
+
+		frr_each (otable, &zvrf->other_tables, ort)
+			if (ort->safi == SAFI_UNICAST)
+				len += rib_journal_snapshot_table(hdr,
+								  ort->table);
+	}
+
+	return len;
+}
+
+static struct rib_journal_hdr *rib_journal_mmap(int fd, size_t size)
+{
+	void *map;
+
+	if (ftruncate(fd, size) < 0)
+		return NULL;
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	return map;
+}
+
+static void rib_journal_close(void)
+{
+	if (journal.hdr)
+		munmap(journal.hdr, journal.size);
+	if (journal.fd >= 0)
+		close(journal.fd);
+
+	journal.hdr = NULL;
+	journal.fd = -1;
+	journal.size = 0;
+}
+
+/*
+ * Replace the journal with a snapshot of the RIB, written to a temporary
+ * file first so a crash never leaves a partial journal behind.  The file
+ * grows so that at least half of it is free afterwards.
+ */
+static void rib_journal_compact(void)
+{
+	char tmp[MAXPATHLEN];
+	struct rib_journal_hdr *hdr;
+	size_t needed, size;
+	int fd;
+
+	needed = rib_journal_snapshot(NULL);
+	size = journal.size;
+	while (size < needed * 2)
+		size *= 2;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", rib_journal_path);
+	fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "RIB journal: can't create %s: %s", tmp,
+			     safe_strerror(errno));
+		rib_journal_close();
+		return;
+	}
+
+	hdr = rib_journal_mmap(fd, size);
+	if (!hdr) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL, "RIB journal: can't map %s: %s",
+			     tmp, safe_strerror(errno));
+		close(fd);
+		unlink(tmp);
+		rib_journal_close();
+		return;
+	}
+
+	rib_journal_hdr_init(hdr, size);
+	rib_journal_snapshot(hdr);
+	msync(hdr, hdr->used, MS_ASYNC);
+
+	if (rename(tmp, rib_journal_path) < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "RIB journal: can't rename %s: %s", tmp,
+			     safe_strerror(errno));
+		munmap(hdr, size);
+		close(fd);
+		unlink(tmp);
+		rib_journal_close();
+		return;
+	}
+
+	if (IS_ZEBRA_DEBUG_RIB)
+		zlog_debug("RIB journal: compacted to %zu of %zu bytes", needed,
+			   size);
+
+	rib_journal_close();
+	journal.fd = fd;
+	journal.hdr = hdr;
+	journal.size = size;
+}
+
+static void rib_journal_append(uint8_t op, struct route_node *rn,
+			       struct route_entry *re)
+{
+	if (!journal.hdr || journal.replaying)
+		return;
+
+	if (atomic_load_explicit(&zrouter.in_shutdown, memory_order_relaxed))
+		return;
+
+	if (!rib_journal_route(rn, re))
+		return;
+
+	rib_journal_encode(&rec_buf.rec, op, rn, re);
+
+	/*
+	 * The change is already reflected in the RIB (an added route is
+	 * linked, a deleted one marked removed), so the snapshot covers it.
+	 */
+	if (journal.hdr->used + rec_buf.rec.len > journal.size) {
+		rib_journal_compact();
+		return;
+	}
+
+	rib_journal_write(journal.hdr, &rec_buf.rec);
+}
+
+void zebra_rib_journal_add(struct route_node *rn, struct route_entry *re)
+{
+	rib_journal_append(RIB_JOURNAL_ADD, rn, re);
+}
+
+void zebra_rib_journal_del(struct route_node *rn, struct route_entry *re)
+{
+	rib_journal_append(RIB_JOURNAL_DEL, rn, re);
+}
+
+static void rib_journal_rec_prefixes(const struct rib_journal_rec *rec,
+				     struct prefix *p,
+				     struct prefix_ipv6 *src_p)
+{
+	memset(p, 0, sizeof(*p));
+	p->family = rec->family;
+	p->prefixlen = rec->prefixlen;
+	memcpy(&p->u.prefix, &rec->prefix, prefix_blen(p));
+
+	memset(src_p, 0, sizeof(*src_p));
+	src_p->family = AF_INET6;
+	src_p->prefixlen = rec->src_prefixlen;
+	src_p->prefix = rec->src;
+}
+
+static void rib_journal_replay_add(const struct rib_journal_rec *rec)
+{
+	const struct rib_journal_nh *jnh;
+	struct route_entry *re;
+	struct nexthop_group *ng;
+	struct nexthop *nexthop;
+	struct prefix p;
+	struct prefix_ipv6 src_p;
+	int i;
+
+	if (!rec->nexthop_num)
+		return;
+
+	rib_journal_rec_prefixes(rec, &p, &src_p);
+
+	re = XCALLOC(MTYPE_RE, sizeof(struct route_entry));
+	re->type = rec->type;
+	re->instance = rec->instance;
+	/* mark it ours, so the sweep removes it unless refreshed */
+	re->flags = rec->flags | ZEBRA_FLAG_SELFROUTE;
+	re->uptime = monotime(NULL);
+	re->vrf_id = rec->vrf_id;
+	re->table = rec->table_id;
+	re->distance = rec->distance;
+	re->metric = rec->metric;
+	re->mtu = rec->mtu;
+	re->tag = rec->tag;
+
+	ng = nexthop_group_new();
+	for (i = 0; i < rec->nexthop_num; i++) {
+		jnh = &rec->nh[i];
+
+		nexthop = nexthop_new();
+		nexthop->vrf_id = jnh->vrf_id;
+		nexthop->ifindex = jnh->ifindex;
+		nexthop->type = jnh->type;
+		nexthop->flags = jnh->flags;
+		if (jnh->type == NEXTHOP_TYPE_BLACKHOLE)
+			nexthop->bh_type = jnh->bh_type;
+		else
+			nexthop->gate = jnh->gate;
+		nexthop->src = jnh->src;
+		nexthop->weight = jnh->weight;
+		if (jnh->label_num)
+			nexthop_add_labels(nexthop, jnh->label_type,
+					   jnh->label_num, jnh->labels);
+
+		nexthop_group_add_sorted(ng, nexthop);
+	}
+
+	rib_add_multipath(rec->afi, rec->safi, &p,
+			  rec->src_prefixlen ? &src_p : NULL, re, ng);
+}
+
+static void rib_journal_replay_del(const struct rib_journal_rec *rec)
+{
+	struct route_table *table;
+	struct route_node *rn;
+	struct route_entry *re;
+	struct prefix p;
+	struct prefix_ipv6 src_p;
+
+	rib_journal_rec_prefixes(rec, &p, &src_p);
+
+	table = zebra_vrf_lookup_table_with_table_id(rec->afi, rec->safi,
+						     rec->vrf_id, rec->table_id);
+	if (!table)
+		return;
+
+	rn = srcdest_rnode_lookup(table, &p,
+				  rec->src_prefixlen ? &src_p : NULL);
+	if (!rn)
+		return;
+
+	RNODE_FOREACH_RE (rn, re) {
+		if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+			continue;
+		if (re->type != rec->type || re->instance != rec->instance)
+			continue;
+		if (CHECK_FLAG(rec->flags, ZEBRA_FLAG_RR_USE_DISTANCE)
+		    && re->distance != rec->distance)
+			continue;
+
+		rib_delnode(rn, re);
+		break;
+	}
+
+	route_unlock_node(rn);
+}
+
+static void rib_journal_replay(void)
+{
+	const uint8_t *base = (const uint8_t *)journal.hdr;
+	const struct rib_journal_rec *rec;
+	size_t off = sizeof(struct rib_journal_hdr);
+	unsigned int count = 0;
+
+	journal.replaying = true;
+
+	while (off + sizeof(*rec) <= journal.hdr->used) {
+		rec = (const struct rib_journal_rec *)(base + off);
+
+		/* a torn or damaged tail ends the replay */
+		if (rec->nexthop_num > RIB_JOURNAL_MAX_NH
+		    || rec->len != sizeof(*rec)
+					   + rec->nexthop_num
+						     * sizeof(rec->nh[0])
+		    || off + rec->len > journal.hdr->used)
+			break;
+
+		if (rec->afi == AFI_IP || rec->afi == AFI_IP6) {
+			if (rec->op == RIB_JOURNAL_ADD)
+				rib_journal_replay_add(rec);
+			else if (rec->op == RIB_JOURNAL_DEL)
+				rib_journal_replay_del(rec);
+		}
+
+		off += rec->len;
+		count++;
+	}
+
+	journal.replaying = false;
+
+	zlog_info("RIB journal: replayed %u records from %s", count,
+		  rib_journal_path);
+}
+
+void zebra_rib_journal_init(bool replay)
+{
+	struct rib_journal_hdr *hdr;
+	struct stat st;
+	size_t size;
+	int fd;
+
+	if (!rib_journal_path)
+		return;
+
+	fd = open(rib_journal_path, O_RDWR | O_CREAT, 0600);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL, "RIB journal: can't open %s: %s",
+			     rib_journal_path, safe_strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+
+	size = st.st_size;
+	if (size < RIB_JOURNAL_SIZE_DEFAULT)
+		size = RIB_JOURNAL_SIZE_DEFAULT;
+
+	hdr = rib_journal_mmap(fd, size);
+	if (!hdr) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL, "RIB journal: can't map %s: %s",
+			     rib_journal_path, safe_strerror(errno));
+		close(fd);
+		return;
+	}
+
+	journal.fd = fd;
+	journal.hdr = hdr;
+	journal.size = size;
+
+	if (hdr->magic != RIB_JOURNAL_MAGIC
+	    || hdr->version != RIB_JOURNAL_VERSION || hdr->size != size
+	    || hdr->used < sizeof(*hdr) || hdr->used > size) {
+		if (replay && (size_t)st.st_size >= sizeof(*hdr))
+			zlog_warn("RIB journal: %s is not valid, ignoring it",
+				  rib_journal_path);
+		rib_journal_hdr_init(hdr, size);
+	} else if (replay)
+		rib_journal_replay();
+
+	/* start from the state we actually have */
+	rib_journal_compact();
+}
+
+void zebra_rib_journal_finish(bool keep)
+{
+	if (!journal.hdr)
+		return;
+
+	if (!keep)
+		journal.hdr->used = sizeof(struct rib_journal_hdr);
+
+	rib_journal_close();
+}
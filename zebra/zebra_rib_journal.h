@@ -0,0 +1,69 @@
+/*
+ * Zebra RIB journal for warm restart
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _ZEBRA_RIB_JOURNAL_H
+#define _ZEBRA_RIB_JOURNAL_H
+
+#include "zebra/rib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The journal is an append-only log of protocol route adds and deletes,
+ * kept in a memory-mapped file.  Records are copied into the mapping as
+ * they happen, so the page cache holds an up to date copy of the RIB
+ * even if zebra is killed.  On the next start (with -K) the log is
+ * replayed into the RIB before the daemons reconnect; routes the daemons
+ * do not refresh are swept by the usual graceful restart timer.
+ *
+ * When the file fills up it is compacted: the live RIB is written to a
+ * new file that then replaces the old one.
+ */
+
+/* Initial file size */
+#define RIB_JOURNAL_SIZE_DEFAULT (4 * 1024 * 1024)
+
+/* Path given with --rib-journal, NULL if disabled */
+extern const char *rib_journal_path;
+
+/*
+ * Map the journal and, if `replay` is set, load its routes into the RIB.
+ * Must run after the kernel routes were read and before the sweep timer
+ * is started.
+ */
+extern void zebra_rib_journal_init(bool replay);
+
+/*
+ * Unmap the journal.  Unless `keep` is set (route retain mode) the log
+ * is emptied, as the routes it describes are removed from the kernel.
+ */
+extern void zebra_rib_journal_finish(bool keep);
+
+/* Record a route that was just linked into / removed from the RIB */
+extern void zebra_rib_journal_add(struct route_node *rn,
+				  struct route_entry *re);
+extern void zebra_rib_journal_del(struct route_node *rn,
+				  struct route_entry *re);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ZEBRA_RIB_JOURNAL_H */
@@ -35,6 +35,7 @@
 #include "stream.h"
 #include "nexthop.h"
 #include "vrf.h"
+#include "jhash.h"
 
 #include "zebra/zebra_router.h"
 #include "zebra/rib.h"
@@ -52,6 +53,65 @@
 #include "zebra/zebra_errors.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, RNH, "Nexthop tracking object")
+DEFINE_MTYPE_STATIC(ZEBRA, RNH_UPDATE, "Nexthop tracking update")
+
+/*
+ * Nexthop updates produced while evaluating rnhs are held for a short
+ * window so that a burst of changes (e.g. an IGP reconverging) sends each
+ * client at most one update per nexthop, as a single batch.
+ */
+#define ZEBRA_RNH_UPDATE_WINDOW_MSEC 10
+
+PREDECL_HASH(rnh_updates)
+
+struct rnh_update {
+	struct zserv *client;
+	vrf_id_t vrf_id;
+	int cmd;
+	uint32_t srte_color;
+	struct prefix p;
+
+	/* Most recent encoding of the update */
+	struct stream *s;
+
+	struct rnh_updates_item item;
+};
+
+static int rnh_update_cmp(const struct rnh_update *a,
+			  const struct rnh_update *b)
+{
+	if (a->client != b->client)
+		return a->client < b->client ? -1 : 1;
+	if (a->vrf_id != b->vrf_id)
+		return a->vrf_id < b->vrf_id ? -1 : 1;
+	if (a->cmd != b->cmd)
+		return a->cmd < b->cmd ? -1 : 1;
+	if (a->srte_color != b->srte_color)
+		return a->srte_color < b->srte_color ? -1 : 1;
+
+	return prefix_cmp(&a->p, &b->p);
+}
+
+static uint32_t rnh_update_hash(const struct rnh_update *upd)
+{
+	uint32_t key;
+
+	key = jhash_2words((uint32_t)(uintptr_t)upd->client, upd->vrf_id,
+			   upd->cmd);
+	key = jhash_1word(upd->srte_color, key);
+
+	return jhash_1word(prefix_hash_key(&upd->p), key);
+}
+
+DECLARE_HASH(rnh_updates, struct rnh_update, item, rnh_update_cmp,
+	     rnh_update_hash)
+
+static struct rnh_updates_head rnh_updates_pending;
+static struct thread *t_rnh_updates;
+
+static uint64_t rnh_updates_queued;
+static uint64_t rnh_updates_coalesced;
+static uint64_t rnh_updates_batches;
 
 static void free_state(vrf_id_t vrf_id, struct route_entry *re,
 		       struct route_node *rn);
@@ -63,25 +123,19 @@ static int zebra_client_cleanup_rnh(struct zserv *client);
 
 void zebra_rnh_init(void)
 {
+	rnh_updates_init(&rnh_updates_pending);
 	hook_register(zserv_client_close, zebra_client_cleanup_rnh);
 }
 
 static inline struct route_table *get_rnh_table(vrf_id_t vrfid, afi_t afi,
-						enum rnh_type type)
+						enum rnh_type type, bool create)
 {
 	struct zebra_vrf *zvrf;
 	struct route_table *t = NULL;
 
 	zvrf = zebra_vrf_lookup_by_id(vrfid);
 	if (zvrf)
-		switch (type) {
-		case RNH_NEXTHOP_TYPE:
-			t = zvrf->rnh_table[afi];
-			break;
-		case RNH_IMPORT_CHECK_TYPE:
-			t = zvrf->import_check_table[afi];
-			break;
-		}
+		t = zebra_vrf_rnh_table(zvrf, afi, type, create);
 
 	return t;
 }
@@ -145,7 +199,7 @@ struct rnh *zebra_add_rnh(struct prefix *p, vrf_id_t vrfid, enum rnh_type type,
 		zlog_debug("%s(%u): Add RNH %pFX type %s", VRF_LOGNAME(vrf),
 			   vrfid, p, rnh_type2str(type));
 	}
-	table = get_rnh_table(vrfid, afi, type);
+	table = get_rnh_table(vrfid, afi, type, true);
 	if (!table) {
 		struct vrf *vrf = vrf_lookup_by_id(vrfid);
 
@@ -197,7 +251,8 @@ struct rnh *zebra_lookup_rnh(struct prefix *p, vrf_id_t vrfid,
 	struct route_table *table;
 	struct route_node *rn;
 
-	table = get_rnh_table(vrfid, family2afi(PREFIX_FAMILY(p)), type);
+	table = get_rnh_table(vrfid, family2afi(PREFIX_FAMILY(p)), type,
+			      false);
 	if (!table)
 		return NULL;
 
@@ -512,9 +567,9 @@ static void zebra_rnh_eval_import_check_entry(struct zebra_vrf *zvrf, afi_t afi,
 				   state_changed ? "(state changed)" : "");
 		/* state changed, notify clients */
 		for (ALL_LIST_ELEMENTS_RO(rnh->client_list, node, client)) {
-			zebra_send_rnh_update(rnh, client,
-					      RNH_IMPORT_CHECK_TYPE,
-					      zvrf->vrf->vrf_id, 0);
+			zebra_queue_rnh_update(rnh, client,
+					       RNH_IMPORT_CHECK_TYPE,
+					       zvrf->vrf->vrf_id);
 		}
 	}
 }
@@ -576,8 +631,8 @@ static void zebra_rnh_notify_protocol_clients(struct zebra_vrf *zvrf, afi_t afi,
 					zebra_route_string(client->proto));
 		}
 
-		zebra_send_rnh_update(rnh, client, RNH_NEXTHOP_TYPE,
-				      zvrf->vrf->vrf_id, 0);
+		zebra_queue_rnh_update(rnh, client, RNH_NEXTHOP_TYPE,
+				       zvrf->vrf->vrf_id);
 	}
 
 	if (re)
@@ -865,8 +920,8 @@ void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 	struct route_table *rnh_table;
 	struct route_node *nrn;
 
-	rnh_table = get_rnh_table(zvrf->vrf->vrf_id, afi, type);
-	if (!rnh_table) // unexpected
+	rnh_table = get_rnh_table(zvrf->vrf->vrf_id, afi, type, false);
+	if (!rnh_table) /* nothing tracked yet */
 		return;
 
 	if (p) {
@@ -901,7 +956,7 @@ void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, struct vty *vty,
 	struct route_table *table;
 	struct route_node *rn;
 
-	table = get_rnh_table(vrfid, afi, type);
+	table = get_rnh_table(vrfid, afi, type, false);
 	if (!table) {
 		if (IS_ZEBRA_DEBUG_NHT)
 			zlog_debug("print_rnhs: rnh table not found");
@@ -1084,9 +1139,9 @@ static int compare_state(struct route_entry *r1, struct route_entry *r2)
 	return 0;
 }
 
-int zebra_send_rnh_update(struct rnh *rnh, struct zserv *client,
-			  enum rnh_type type, vrf_id_t vrf_id,
-			  uint32_t srte_color)
+static struct stream *zebra_rnh_encode_update(struct rnh *rnh, int cmd,
+					      vrf_id_t vrf_id,
+					      uint32_t srte_color)
 {
 	struct stream *s = NULL;
 	struct route_entry *re;
@@ -1096,8 +1151,6 @@ int zebra_send_rnh_update(struct rnh *rnh, struct zserv *client,
 	struct route_node *rn;
 	int ret;
 	uint32_t message = 0;
-	int cmd = (type == RNH_IMPORT_CHECK_TYPE) ? ZEBRA_IMPORT_CHECK_UPDATE
-						  : ZEBRA_NEXTHOP_UPDATE;
 
 	rn = rnh->node;
 	re = rnh->state;
@@ -1179,14 +1232,150 @@ int zebra_send_rnh_update(struct rnh *rnh, struct zserv *client,
 	}
 	stream_putw_at(s, 0, stream_get_endp(s));
 
-	client->nh_last_upd_time = monotime(NULL);
-	client->last_write_cmd = cmd;
-	return zserv_send_message(client, s);
+	return s;
 
 failure:
 
 	stream_free(s);
-	return -1;
+	return NULL;
+}
+
+static void rnh_update_free(struct rnh_update *upd)
+{
+	stream_free(upd->s);
+	XFREE(MTYPE_RNH_UPDATE, upd);
+}
+
+/* Send the updates held for the current window, one batch per client */
+static int zebra_rnh_updates_flush(struct thread *thread)
+{
+	struct listnode *node;
+	struct zserv *client;
+	struct rnh_update *upd;
+	struct stream_fifo fifo;
+	int cmd = 0;
+
+	stream_fifo_init(&fifo);
+
+	for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client)) {
+		frr_each_safe (rnh_updates, &rnh_updates_pending, upd) {
+			if (upd->client != client)
+				continue;
+
+			rnh_updates_del(&rnh_updates_pending, upd);
+			stream_fifo_push(&fifo, upd->s);
+			cmd = upd->cmd;
+			upd->s = NULL;
+			rnh_update_free(upd);
+		}
+
+		if (!stream_fifo_count_safe(&fifo))
+			continue;
+
+		if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+			zlog_debug("%s: sending %zu nexthop updates to %s",
+				   __func__, stream_fifo_count_safe(&fifo),
+				   zebra_route_string(client->proto));
+
+		client->nh_last_upd_time = monotime(NULL);
+		client->last_write_cmd = cmd;
+		zserv_send_batch(client, &fifo);
+		rnh_updates_batches++;
+	}
+
+	stream_fifo_deinit(&fifo);
+
+	/* Anything left belongs to a client that has gone away */
+	while ((upd = rnh_updates_pop(&rnh_updates_pending)))
+		rnh_update_free(upd);
+
+	return 0;
+}
+
+static void zebra_rnh_updates_drop(struct rnh_update *key)
+{
+	struct rnh_update *upd;
+
+	upd = rnh_updates_find(&rnh_updates_pending, key);
+	if (upd) {
+		rnh_updates_del(&rnh_updates_pending, upd);
+		rnh_update_free(upd);
+	}
+}
+
+/*
+ * Queue an update about rnh for client, replacing any update for the same
+ * nexthop that is still waiting to be sent.
+ */
+void zebra_queue_rnh_update(struct rnh *rnh, struct zserv *client,
+			    enum rnh_type type, vrf_id_t vrf_id)
+{
+	struct rnh_update key = {};
+	struct rnh_update *upd;
+	struct stream *s;
+
+	key.client = client;
+	key.vrf_id = vrf_id;
+	key.cmd = (type == RNH_IMPORT_CHECK_TYPE) ? ZEBRA_IMPORT_CHECK_UPDATE
+						  : ZEBRA_NEXTHOP_UPDATE;
+	prefix_copy(&key.p, &rnh->node->p);
+
+	s = zebra_rnh_encode_update(rnh, key.cmd, vrf_id, 0);
+	if (!s)
+		return;
+
+	rnh_updates_queued++;
+
+	upd = rnh_updates_find(&rnh_updates_pending, &key);
+	if (upd) {
+		stream_free(upd->s);
+		upd->s = s;
+		rnh_updates_coalesced++;
+		return;
+	}
+
+	upd = XCALLOC(MTYPE_RNH_UPDATE, sizeof(*upd));
+	*upd = key;
+	upd->s = s;
+	rnh_updates_add(&rnh_updates_pending, upd);
+
+	thread_add_timer_msec(zrouter.master, zebra_rnh_updates_flush, NULL,
+			      ZEBRA_RNH_UPDATE_WINDOW_MSEC, &t_rnh_updates);
+}
+
+int zebra_send_rnh_update(struct rnh *rnh, struct zserv *client,
+			  enum rnh_type type, vrf_id_t vrf_id,
+			  uint32_t srte_color)
+{
+	struct rnh_update key = {};
+	struct stream *s;
+
+	key.client = client;
+	key.vrf_id = vrf_id;
+	key.cmd = (type == RNH_IMPORT_CHECK_TYPE) ? ZEBRA_IMPORT_CHECK_UPDATE
+						  : ZEBRA_NEXTHOP_UPDATE;
+	key.srte_color = srte_color;
+	prefix_copy(&key.p, &rnh->node->p);
+
+	s = zebra_rnh_encode_update(rnh, key.cmd, vrf_id, srte_color);
+	if (!s)
+		return -1;
+
+	/* Whatever was queued is older than what we are sending now */
+	zebra_rnh_updates_drop(&key);
+
+	client->nh_last_upd_time = monotime(NULL);
+	client->last_write_cmd = key.cmd;
+	return zserv_send_message(client, s);
+}
+
+void zebra_rnh_updates_show(struct vty *vty)
+{
+	vty_out(vty,
+		"\nNexthop tracking updates: %" PRIu64 " queued, %" PRIu64
+		" coalesced, %" PRIu64 " batches, %zu pending\n",
+		rnh_updates_queued, rnh_updates_coalesced, rnh_updates_batches,
+		rnh_updates_count(&rnh_updates_pending));
 }
 
 static void print_nh(struct nexthop *nexthop, struct vty *vty)
@@ -1275,11 +1464,10 @@ static int zebra_cleanup_rnh_client(vrf_id_t vrf_id, afi_t afi,
 			rnh_type2str(type));
 	}
 
-	ntable = get_rnh_table(vrf_id, afi, type);
-	if (!ntable) {
-		zlog_debug("cleanup_rnh_client: rnh table not found");
-		return -1;
-	}
+	/* Not allocated until something is tracked in the VRF */
+	ntable = get_rnh_table(vrf_id, afi, type, false);
+	if (!ntable)
+		return 0;
 
 	for (nrn = route_top(ntable); nrn; nrn = route_next(nrn)) {
 		if (!nrn->info)
@@ -1296,6 +1484,15 @@ static int zebra_client_cleanup_rnh(struct zserv *client)
 {
 	struct vrf *vrf;
 	struct zebra_vrf *zvrf;
+	struct rnh_update *upd;
+
+	frr_each_safe (rnh_updates, &rnh_updates_pending, upd) {
+		if (upd->client != client)
+			continue;
+
+		rnh_updates_del(&rnh_updates_pending, upd);
+		rnh_update_free(upd);
+	}
 
 	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id) {
 		zvrf = vrf->info;
@@ -53,6 +53,9 @@ extern void zebra_add_rnh_client(struct rnh *rnh, struct zserv *client,
 extern int zebra_send_rnh_update(struct rnh *rnh, struct zserv *client,
 				 enum rnh_type type, vrf_id_t vrf_id,
 				 uint32_t srte_color);
+extern void zebra_queue_rnh_update(struct rnh *rnh, struct zserv *client,
+				   enum rnh_type type, vrf_id_t vrf_id);
+extern void zebra_rnh_updates_show(struct vty *vty);
 extern void zebra_register_rnh_pseudowire(vrf_id_t, struct zebra_pw *, bool *);
 extern void zebra_deregister_rnh_pseudowire(vrf_id_t, struct zebra_pw *);
 extern void zebra_remove_rnh_client(struct rnh *rnh, struct zserv *client,
@@ -64,6 +67,11 @@ extern void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, struct vty *vty,
 
 extern int rnh_resolve_via_default(struct zebra_vrf *zvrf, int family);
 
+/* In zebra_vrf.c; NULL unless create is set or something is tracked */
+extern struct route_table *zebra_vrf_rnh_table(struct zebra_vrf *zvrf,
+					       afi_t afi, enum rnh_type type,
+					       bool create);
+
 #ifdef __cplusplus
 }
 #endif
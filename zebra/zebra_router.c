@@ -141,23 +141,41 @@ struct route_table *zebra_router_get_table(struct zebra_vrf *zvrf,
 	return zrt->table;
 }
 
+/*
+ * Rough memory footprint of a rib table: its route nodes, the rib_dest_t
+ * hung off them and the route entries.  Nexthop groups are shared across
+ * tables and accounted in the nexthop-group hash instead.
+ */
+static size_t zebra_router_table_memory(struct route_table *table,
+					struct rib_table_info *info)
+{
+	return table->count * sizeof(struct route_node)
+	       + info->dest_count * sizeof(rib_dest_t)
+	       + info->re_count * sizeof(struct route_entry);
+}
+
 void zebra_router_show_table_summary(struct vty *vty)
 {
 	struct zebra_router_table *zrt;
+	size_t total = 0;
 
 	vty_out(vty,
-		"VRF             NS ID    VRF ID     AFI            SAFI    Table      Count\n");
+		"VRF             NS ID    VRF ID     AFI            SAFI    Table      Count     Routes   Memory(KiB)\n");
 	vty_out(vty,
-		"---------------------------------------------------------------------------\n");
+		"-----------------------------------------------------------------------------------------------------\n");
 	RB_FOREACH (zrt, zebra_router_table_head, &zrouter.tables) {
 		struct rib_table_info *info = route_table_get_info(zrt->table);
-
-		vty_out(vty, "%-16s%5d %9d %7s %15s %8d %10lu\n", info->zvrf->vrf->name,
-			zrt->ns_id, info->zvrf->vrf->vrf_id,
-			afi2str(zrt->afi), safi2str(zrt->safi),
-			zrt->tableid,
-			zrt->table->count);
+		size_t mem = zebra_router_table_memory(zrt->table, info);
+
+		total += mem;
+		vty_out(vty, "%-16s%5d %9d %7s %15s %8d %10lu %10u %13zu\n",
+			info->zvrf->vrf->name, zrt->ns_id,
+			info->zvrf->vrf->vrf_id, afi2str(zrt->afi),
+			safi2str(zrt->safi), zrt->tableid, zrt->table->count,
+			info->re_count, mem / 1024);
 	}
+	vty_out(vty, "Total table memory: %zu KiB (route entry %zu bytes, dest %zu bytes)\n",
+		total / 1024, sizeof(struct route_entry), sizeof(rib_dest_t));
 }
 
 void zebra_router_sweep_route(void)
@@ -246,9 +264,13 @@ void zebra_router_terminate(void)
 	hash_clean(zrouter.nhgs, NULL);
 	hash_free(zrouter.nhgs);
 
+	hash_clean(zrouter.rules_unique_hash, NULL);
+	hash_free(zrouter.rules_unique_hash);
 	hash_clean(zrouter.rules_hash, zebra_pbr_rules_free);
 	hash_free(zrouter.rules_hash);
 
+	hash_clean(zrouter.ipset_name_hash, NULL);
+	hash_free(zrouter.ipset_name_hash);
 	hash_clean(zrouter.ipset_entry_hash, zebra_pbr_ipset_entry_free),
 		hash_clean(zrouter.ipset_hash, zebra_pbr_ipset_free);
 	hash_free(zrouter.ipset_hash);
@@ -276,10 +298,18 @@ void zebra_router_init(bool asic_offload, bool notify_on_ack)
 	zrouter.rules_hash = hash_create_size(8, zebra_pbr_rules_hash_key,
 					      zebra_pbr_rules_hash_equal,
 					      "Rules Hash");
+	zrouter.rules_unique_hash =
+		hash_create_size(8, zebra_pbr_rules_unique_hash_key,
+				 zebra_pbr_rules_unique_hash_equal,
+				 "Rules Hash unique index");
 
 	zrouter.ipset_hash =
 		hash_create_size(8, zebra_pbr_ipset_hash_key,
 				 zebra_pbr_ipset_hash_equal, "IPset Hash");
+	zrouter.ipset_name_hash =
+		hash_create_size(8, zebra_pbr_ipset_name_hash_key,
+				 zebra_pbr_ipset_name_hash_equal,
+				 "IPset Hash name index");
 
 	zrouter.ipset_entry_hash = hash_create_size(
 		8, zebra_pbr_ipset_entry_hash_key,
@@ -290,7 +320,7 @@ void zebra_router_init(bool asic_offload, bool notify_on_ack)
 						"IPtable Hash Entry");
 
 	zrouter.nhgs =
-		hash_create_size(8, zebra_nhg_hash_key, zebra_nhg_hash_equal,
+		hash_create_open(8, zebra_nhg_hash_key, zebra_nhg_hash_equal,
 				 "Zebra Router Nexthop Groups");
 	zrouter.nhgs_id =
 		hash_create_size(8, zebra_nhg_id_key, zebra_nhg_hash_id_equal,
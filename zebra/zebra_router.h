@@ -129,6 +129,17 @@ struct zebra_mlag_info {
 	struct thread *t_read;
 	/* Event for MLAG write */
 	struct thread *t_write;
+
+	/*
+	 * Throughput counters, updated from the MLAG pthread: messages and
+	 * bytes written to / read from MCLAGD, and the number of entries
+	 * carried by the (possibly bulk) messages written.
+	 */
+	_Atomic uint64_t tx_msgs;
+	_Atomic uint64_t tx_entries;
+	_Atomic uint64_t tx_bytes;
+	_Atomic uint64_t rx_msgs;
+	_Atomic uint64_t rx_bytes;
 };
 
 struct zebra_router {
@@ -155,8 +166,12 @@ struct zebra_router {
 	struct hash *evpn_vlan_table;
 
 	struct hash *rules_hash;
+	/* rules_hash indexed by unique id, interface and vrf */
+	struct hash *rules_unique_hash;
 
 	struct hash *ipset_hash;
+	/* ipset_hash indexed by ipset name */
+	struct hash *ipset_name_hash;
 
 	struct hash *ipset_entry_hash;
 
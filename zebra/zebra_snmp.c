@@ -134,30 +134,44 @@ static struct variable zebra_variables[] = {
 	{IPCIDRROUTESTATUS, ROWSTATUS, RONLY, ipCidrTable, 3, {4, 1, 16}}};
 
 
+/*
+ * The forwarding table is served from a snapshot, as the live RIB can't be
+ * walked in the MIB's index order: finding the next entry would mean
+ * scanning the whole table on each GETNEXT.
+ */
+#define ZEBRA_SNMP_SNAP_AGE 10
+
+#define IPFW_ENTRY_OFFSET 10
+
+struct zebra_snmp_fwentry {
+	struct snmp_snap_row row;
+
+	struct in_addr dest;
+	uint8_t prefixlen;
+	int proto;
+	struct in_addr nexthop;
+	int ifindex;
+	int type;
+};
+
+static struct snmp_snap zebra_snmp_fw_snap;
+
 static uint8_t *ipFwNumber(struct variable *v, oid objid[], size_t *objid_len,
 			   int exact, size_t *val_len,
 			   WriteMethod **write_method)
 {
 	static int result;
-	struct route_table *table;
-	struct route_node *rn;
-	struct route_entry *re;
 
 	if (smux_header_generic(v, objid, objid_len, exact, val_len,
 				write_method)
 	    == MATCH_FAILED)
 		return NULL;
 
-	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
-	if (!table)
+	if (!zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT))
 		return NULL;
 
 	/* Return number of routing entries. */
-	result = 0;
-	for (rn = route_top(table); rn; rn = route_next(rn))
-		RNODE_FOREACH_RE (rn, re) {
-			result++;
-		}
+	result = snmp_snap_count(&zebra_snmp_fw_snap);
 
 	return (uint8_t *)&result;
 }
@@ -167,68 +181,21 @@ static uint8_t *ipCidrNumber(struct variable *v, oid objid[], size_t *objid_len,
 			     WriteMethod **write_method)
 {
 	static int result;
-	struct route_table *table;
-	struct route_node *rn;
-	struct route_entry *re;
 
 	if (smux_header_generic(v, objid, objid_len, exact, val_len,
 				write_method)
 	    == MATCH_FAILED)
 		return NULL;
 
-	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
-	if (!table)
+	if (!zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT))
 		return 0;
 
 	/* Return number of routing entries. */
-	result = 0;
-	for (rn = route_top(table); rn; rn = route_next(rn))
-		RNODE_FOREACH_RE (rn, re) {
-			result++;
-		}
+	result = snmp_snap_count(&zebra_snmp_fw_snap);
 
 	return (uint8_t *)&result;
 }
 
-static int in_addr_cmp(uint8_t *p1, uint8_t *p2)
-{
-	int i;
-
-	for (i = 0; i < 4; i++) {
-		if (*p1 < *p2)
-			return -1;
-		if (*p1 > *p2)
-			return 1;
-		p1++;
-		p2++;
-	}
-	return 0;
-}
-
-static int in_addr_add(uint8_t *p, int num)
-{
-	int i, ip0;
-
-	ip0 = *p;
-	p += 4;
-	for (i = 3; 0 <= i; i--) {
-		p--;
-		if (*p + num > 255) {
-			*p += num;
-			num = 1;
-		} else {
-			*p += num;
-			return 1;
-		}
-	}
-	if (ip0 > *p) {
-		/* ip + num > 0xffffffff */
-		return 0;
-	}
-
-	return 1;
-}
-
 static int proto_trans(int type)
 {
 	switch (type) {
@@ -255,223 +222,80 @@ static int proto_trans(int type)
 	}
 }
 
-static void check_replace(struct route_node *np2, struct route_entry *re2,
-			  struct route_node **np, struct route_entry **re)
+static void zebra_snmp_fw_build(struct snmp_snap *snap)
 {
-	int proto, proto2;
-
-	if (!*np) {
-		*np = np2;
-		*re = re2;
-		return;
-	}
-
-	if (prefix_cmp(&(*np)->p, &np2->p) < 0)
-		return;
-	if (prefix_cmp(&(*np)->p, &np2->p) > 0) {
-		*np = np2;
-		*re = re2;
-		return;
-	}
-
-	proto = proto_trans((*re)->type);
-	proto2 = proto_trans(re2->type);
-
-	if (proto2 > proto)
-		return;
-	if (proto2 < proto) {
-		*np = np2;
-		*re = re2;
-		return;
-	}
-
-	if (in_addr_cmp((uint8_t *)&(*re)->nhe->nhg.nexthop->gate.ipv4,
-			(uint8_t *)&re2->nhe->nhg.nexthop->gate.ipv4)
-	    <= 0)
-		return;
-
-	*np = np2;
-	*re = re2;
-	return;
-}
-
-static void get_fwtable_route_node(struct variable *v, oid objid[],
-				   size_t *objid_len, int exact,
-				   struct route_node **np,
-				   struct route_entry **re)
-{
-	struct in_addr dest;
 	struct route_table *table;
-	struct route_node *np2;
-	struct route_entry *re2;
-	int proto;
-	int policy;
-	struct in_addr nexthop;
-	uint8_t *pnt;
-	int i;
-
-	/* Init index variables */
-
-	pnt = (uint8_t *)&dest;
-	for (i = 0; i < 4; i++)
-		*pnt++ = 0;
-
-	pnt = (uint8_t *)&nexthop;
-	for (i = 0; i < 4; i++)
-		*pnt++ = 0;
-
-	proto = 0;
-	policy = 0;
-
-	/* Init return variables */
-
-	*np = NULL;
-	*re = NULL;
-
-	/* Short circuit exact matches of wrong length */
-
-	if (exact && (*objid_len != (unsigned)v->namelen + 10))
-		return;
+	struct route_node *rn;
+	struct route_entry *re;
+	struct nexthop *nexthop;
+	struct zebra_snmp_fwentry *ent;
+	oid index[IPFW_ENTRY_OFFSET];
 
 	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
 	if (!table)
 		return;
 
-	/* Get INDEX information out of OID.
-	 * ipForwardDest, ipForwardProto, ipForwardPolicy, ipForwardNextHop
+	/* INDEX { ipForwardDest, ipForwardProto, ipForwardPolicy,
+	 *         ipForwardNextHop }
 	 */
-
-	if (*objid_len > (unsigned)v->namelen)
-		oid2in_addr(objid + v->namelen,
-			    MIN(4U, *objid_len - v->namelen), &dest);
-
-	if (*objid_len > (unsigned)v->namelen + 4)
-		proto = objid[v->namelen + 4];
-
-	if (*objid_len > (unsigned)v->namelen + 5)
-		policy = objid[v->namelen + 5];
-
-	if (*objid_len > (unsigned)v->namelen + 6)
-		oid2in_addr(objid + v->namelen + 6,
-			    MIN(4U, *objid_len - v->namelen - 6), &nexthop);
-
-	/* Apply GETNEXT on not exact search */
-
-	if (!exact && (*objid_len >= (unsigned)v->namelen + 10)) {
-		if (!in_addr_add((uint8_t *)&nexthop, 1))
-			return;
-	}
-
-	/* For exact: search matching entry in rib table. */
-
-	if (exact) {
-		if (policy) /* Not supported (yet?) */
-			return;
-		for (*np = route_top(table); *np; *np = route_next(*np)) {
-			if (!in_addr_cmp(&(*np)->p.u.prefix,
-					 (uint8_t *)&dest)) {
-				RNODE_FOREACH_RE (*np, *re) {
-					if (!in_addr_cmp((uint8_t *)&(*re)->nhe
-							 ->nhg.nexthop
-							 ->gate.ipv4,
-							 (uint8_t *)&nexthop))
-						if (proto
-						    == proto_trans((*re)->type))
-							return;
-				}
-			}
-		}
-		return;
-	}
-
-	/* Search next best entry */
-
-	for (np2 = route_top(table); np2; np2 = route_next(np2)) {
-
-		/* Check destination first */
-		if (in_addr_cmp(&np2->p.u.prefix, (uint8_t *)&dest) > 0)
-			RNODE_FOREACH_RE (np2, re2) {
-				check_replace(np2, re2, np, re);
-			}
-
-		if (in_addr_cmp(&np2->p.u.prefix, (uint8_t *)&dest)
-		    == 0) { /* have to look at each re individually */
-			RNODE_FOREACH_RE (np2, re2) {
-				int proto2, policy2;
-
-				proto2 = proto_trans(re2->type);
-				policy2 = 0;
-
-				if ((policy < policy2)
-				    || ((policy == policy2) && (proto < proto2))
-				    || ((policy == policy2) && (proto == proto2)
-					&& (in_addr_cmp(
-						    (uint8_t *)&re2->nhe
-						    ->nhg.nexthop->gate.ipv4,
-						    (uint8_t *)&nexthop)
-					    >= 0)))
-					check_replace(np2, re2, np, re);
-			}
-		}
-	}
-
-	if (!*re)
-		return;
-
-	policy = 0;
-	proto = proto_trans((*re)->type);
-
-	*objid_len = v->namelen + 10;
-	pnt = (uint8_t *)&(*np)->p.u.prefix;
-	for (i = 0; i < 4; i++)
-		objid[v->namelen + i] = *pnt++;
-
-	objid[v->namelen + 4] = proto;
-	objid[v->namelen + 5] = policy;
-
-	{
-		struct nexthop *nexthop;
-
-		nexthop = (*re)->nhe->nhg.nexthop;
-		if (nexthop) {
-			pnt = (uint8_t *)&nexthop->gate.ipv4;
-			for (i = 0; i < 4; i++)
-				objid[i + v->namelen + 6] = *pnt++;
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		RNODE_FOREACH_RE (rn, re) {
+			nexthop = re->nhe->nhg.nexthop;
+			if (!nexthop)
+				continue;
+
+			oid_copy_addr(index, &rn->p.u.prefix4, IN_ADDR_SIZE);
+			index[4] = proto_trans(re->type);
+			index[5] = 0;
+			oid_copy_addr(index + 6, &nexthop->gate.ipv4,
+				      IN_ADDR_SIZE);
+
+			ent = snmp_snap_add(snap, index, array_size(index));
+			ent->dest = rn->p.u.prefix4;
+			ent->prefixlen = rn->p.prefixlen;
+			ent->proto = index[4];
+			ent->nexthop = nexthop->gate.ipv4;
+			ent->ifindex = nexthop->ifindex;
+			ent->type = nexthop->type == NEXTHOP_TYPE_IFINDEX ? 3 : 4;
 		}
-	}
-
-	return;
 }
 
+static struct snmp_snap zebra_snmp_fw_snap = {
+	.row_size = sizeof(struct zebra_snmp_fwentry),
+	.max_age = ZEBRA_SNMP_SNAP_AGE,
+	.build = zebra_snmp_fw_build,
+};
+
 static uint8_t *ipFwTable(struct variable *v, oid objid[], size_t *objid_len,
 			  int exact, size_t *val_len,
 			  WriteMethod **write_method)
 {
-	struct route_node *np;
-	struct route_entry *re;
+	const struct zebra_snmp_fwentry *ent;
 	static int result;
 	static int resarr[2];
 	static struct in_addr netmask;
-	struct nexthop *nexthop;
+	static struct in_addr addr;
 
 	if (smux_header_table(v, objid, objid_len, exact, val_len, write_method)
 	    == MATCH_FAILED)
 		return NULL;
 
-	get_fwtable_route_node(v, objid, objid_len, exact, &np, &re);
-	if (!np)
+	if (!zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT))
 		return NULL;
 
-	nexthop = re->nhe->nhg.nexthop;
-	if (!nexthop)
+	/* policy is always 0, not supported (yet?) */
+	ent = snmp_snap_lookup(&zebra_snmp_fw_snap, v, objid, objid_len,
+			       exact);
+	if (!ent)
 		return NULL;
 
 	switch (v->magic) {
 	case IPFORWARDDEST:
+		addr = ent->dest;
 		*val_len = 4;
-		return &np->p.u.prefix;
+		return (uint8_t *)&addr;
 	case IPFORWARDMASK:
-		masklen2ip(np->p.prefixlen, &netmask);
+		masklen2ip(ent->prefixlen, &netmask);
 		*val_len = 4;
 		return (uint8_t *)&netmask;
 	case IPFORWARDPOLICY:
@@ -479,20 +303,19 @@ static uint8_t *ipFwTable(struct variable *v, oid objid[], size_t *objid_len,
 		*val_len = sizeof(int);
 		return (uint8_t *)&result;
 	case IPFORWARDNEXTHOP:
+		addr = ent->nexthop;
 		*val_len = 4;
-		return (uint8_t *)&nexthop->gate.ipv4;
+		return (uint8_t *)&addr;
 	case IPFORWARDIFINDEX:
+		result = ent->ifindex;
 		*val_len = sizeof(int);
-		return (uint8_t *)&nexthop->ifindex;
+		return (uint8_t *)&result;
 	case IPFORWARDTYPE:
-		if (nexthop->type == NEXTHOP_TYPE_IFINDEX)
-			result = 3;
-		else
-			result = 4;
+		result = ent->type;
 		*val_len = sizeof(int);
 		return (uint8_t *)&result;
 	case IPFORWARDPROTO:
-		result = proto_trans(re->type);
+		result = ent->proto;
 		*val_len = sizeof(int);
 		return (uint8_t *)&result;
 	case IPFORWARDAGE:
@@ -558,9 +381,16 @@ static int zebra_snmp_init(struct thread_master *tm)
 	return 0;
 }
 
+static int zebra_snmp_fini(void)
+{
+	snmp_snap_reset(&zebra_snmp_fw_snap);
+	return 0;
+}
+
 static int zebra_snmp_module_init(void)
 {
 	hook_register(frr_late_init, zebra_snmp_init);
+	hook_register(frr_fini, zebra_snmp_fini);
 	return 0;
 }
 
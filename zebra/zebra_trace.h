@@ -0,0 +1,128 @@
+/* Tracing for zebra
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#if !defined(_ZEBRA_TRACE_H) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define _ZEBRA_TRACE_H
+
+#include "lib/trace.h"
+
+#ifdef HAVE_LTTNG
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER frr_zebra
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "zebra/zebra_trace.h"
+
+#include <lttng/tracepoint.h>
+
+#include "lib/table.h"
+#include "zebra/zebra_dplane.h"
+
+/* clang-format off */
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	meta_queue_enqueue,
+	TP_ARGS(struct route_node *, rn, vrf_id_t, vrf_id, uint8_t, qindex),
+	TP_FIELDS(
+		ctf_integer_hex(intptr_t, rn, rn)
+		ctf_integer(uint8_t, family, rn->p.family)
+		ctf_integer(uint8_t, prefixlen, rn->p.prefixlen)
+		ctf_array(unsigned char, prefix, &rn->p.u.prefix6, 16)
+		ctf_integer(vrf_id_t, vrf_id, vrf_id)
+		ctf_integer(uint8_t, qindex, qindex)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_zebra, meta_queue_enqueue, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	meta_queue_dequeue,
+	TP_ARGS(struct route_node *, rn, uint8_t, qindex, int64_t, dwell),
+	TP_FIELDS(
+		ctf_integer_hex(intptr_t, rn, rn)
+		ctf_integer(uint8_t, family, rn->p.family)
+		ctf_integer(uint8_t, prefixlen, rn->p.prefixlen)
+		ctf_array(unsigned char, prefix, &rn->p.u.prefix6, 16)
+		ctf_integer(uint8_t, qindex, qindex)
+		ctf_integer(int64_t, dwell_usec, dwell)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_zebra, meta_queue_dequeue, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	dplane_enqueue,
+	TP_ARGS(struct zebra_dplane_ctx *, ctx, uint32_t, queued),
+	TP_FIELDS(
+		ctf_integer_hex(intptr_t, ctx, ctx)
+		ctf_string(op, dplane_op2str(dplane_ctx_get_op(ctx)))
+		ctf_integer(uint32_t, queued, queued)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_zebra, dplane_enqueue, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	dplane_complete,
+	TP_ARGS(struct zebra_dplane_ctx *, ctx),
+	TP_FIELDS(
+		ctf_integer_hex(intptr_t, ctx, ctx)
+		ctf_string(op, dplane_op2str(dplane_ctx_get_op(ctx)))
+		ctf_string(status, dplane_res2str(dplane_ctx_get_status(ctx)))
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_zebra, dplane_complete, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	netlink_batch_send,
+	TP_ARGS(const char *, nls, size_t, len, size_t, msgcnt),
+	TP_FIELDS(
+		ctf_string(nls, nls)
+		ctf_integer(size_t, len, len)
+		ctf_integer(size_t, msgcnt, msgcnt)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_zebra, netlink_batch_send, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	netlink_batch_ack,
+	TP_ARGS(const char *, nls, size_t, len, bool, err),
+	TP_FIELDS(
+		ctf_string(nls, nls)
+		ctf_integer(size_t, len, len)
+		ctf_integer(bool, error, err)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_zebra, netlink_batch_ack, TRACE_INFO)
+
+/* clang-format on */
+
+#include <lttng/tracepoint-event.h>
+
+#endif /* HAVE_LTTNG */
+
+#endif /* _ZEBRA_TRACE_H */
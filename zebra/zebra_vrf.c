@@ -96,6 +96,34 @@ void zebra_vrf_update_all(struct zserv *client)
 	}
 }
 
+/*
+ * Nexthop tracking tables are allocated when the first nexthop is
+ * registered in the VRF, most VRFs of a large setup never see one.
+ */
+struct route_table *zebra_vrf_rnh_table(struct zebra_vrf *zvrf, afi_t afi,
+					enum rnh_type type, bool create)
+{
+	struct route_table **tablep;
+
+	switch (type) {
+	case RNH_NEXTHOP_TYPE:
+		tablep = &zvrf->rnh_table[afi];
+		break;
+	case RNH_IMPORT_CHECK_TYPE:
+		tablep = &zvrf->import_check_table[afi];
+		break;
+	default:
+		return NULL;
+	}
+
+	if (!*tablep && create) {
+		*tablep = route_table_init();
+		(*tablep)->cleanup = zebra_rnhtable_node_cleanup;
+	}
+
+	return *tablep;
+}
+
 /* Callback upon creating a new VRF. */
 static int zebra_vrf_new(struct vrf *vrf)
 {
@@ -118,7 +146,6 @@ static int zebra_vrf_new(struct vrf *vrf)
 static int zebra_vrf_enable(struct vrf *vrf)
 {
 	struct zebra_vrf *zvrf = vrf->info;
-	struct route_table *table;
 	afi_t afi;
 	safi_t safi;
 
@@ -140,20 +167,11 @@ static int zebra_vrf_enable(struct vrf *vrf)
 	 */
 
 	zebra_vrf_add_update(zvrf);
-	/* Allocate tables */
-	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+	/* Allocate tables, the NHT ones are created on demand */
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
 		for (safi = SAFI_UNICAST; safi <= SAFI_MULTICAST; safi++)
 			zebra_vrf_table_create(zvrf, afi, safi);
 
-		table = route_table_init();
-		table->cleanup = zebra_rnhtable_node_cleanup;
-		zvrf->rnh_table[afi] = table;
-
-		table = route_table_init();
-		table->cleanup = zebra_rnhtable_node_cleanup;
-		zvrf->import_check_table[afi] = table;
-	}
-
 	/* Kick off any VxLAN-EVPN processing. */
 	zebra_vxlan_vrf_enable(zvrf);
 
@@ -167,7 +185,6 @@ static int zebra_vrf_disable(struct vrf *vrf)
 	struct interface *ifp;
 	afi_t afi;
 	safi_t safi;
-	unsigned i;
 
 	assert(zvrf);
 	if (IS_ZEBRA_DEBUG_EVENT)
@@ -212,21 +229,7 @@ static int zebra_vrf_disable(struct vrf *vrf)
 		if_nbr_ipv6ll_to_ipv4ll_neigh_del_all(ifp);
 
 	/* clean-up work queues */
-	for (i = 0; i < MQ_SIZE; i++) {
-		struct listnode *lnode, *nnode;
-		struct route_node *rnode;
-		rib_dest_t *dest;
-
-		for (ALL_LIST_ELEMENTS(zrouter.mq->subq[i], lnode, nnode,
-				       rnode)) {
-			dest = rib_dest_from_rnode(rnode);
-			if (dest && rib_dest_vrf(dest) == zvrf) {
-				route_unlock_node(rnode);
-				list_delete_node(zrouter.mq->subq[i], lnode);
-				zrouter.mq->size--;
-			}
-		}
-	}
+	meta_queue_vrf_flush(zrouter.mq, zvrf);
 
 	/* Cleanup (free) routing tables and NHT tables. */
 	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
@@ -255,7 +258,6 @@ static int zebra_vrf_delete(struct vrf *vrf)
 	struct route_table *table;
 	afi_t afi;
 	safi_t safi;
-	unsigned i;
 
 	assert(zvrf);
 	if (IS_ZEBRA_DEBUG_EVENT)
@@ -263,21 +265,7 @@ static int zebra_vrf_delete(struct vrf *vrf)
 			   zvrf_id(zvrf));
 
 	/* clean-up work queues */
-	for (i = 0; i < MQ_SIZE; i++) {
-		struct listnode *lnode, *nnode;
-		struct route_node *rnode;
-		rib_dest_t *dest;
-
-		for (ALL_LIST_ELEMENTS(zrouter.mq->subq[i], lnode, nnode,
-				       rnode)) {
-			dest = rib_dest_from_rnode(rnode);
-			if (dest && rib_dest_vrf(dest) == zvrf) {
-				route_unlock_node(rnode);
-				list_delete_node(zrouter.mq->subq[i], lnode);
-				zrouter.mq->size--;
-			}
-		}
-	}
+	meta_queue_vrf_flush(zrouter.mq, zvrf);
 
 	/* Free Vxlan and MPLS. */
 	zebra_vxlan_close_tables(zvrf);
@@ -425,6 +413,7 @@ void zebra_rtable_node_cleanup(struct route_table *table,
 
 		rnh_list_fini(&dest->nht);
 		XFREE(MTYPE_RIB_DEST, node->info);
+		rib_rnode_table_info(node)->dest_count--;
 	}
 }
 
@@ -111,6 +111,8 @@ struct zebra_vrf {
 
 	/* MPLS label forwarding table */
 	struct hash *lsp_table;
+	/* ... and its index by incoming label */
+	struct zebra_lsp_index *lsp_index;
 
 	/* MPLS FEC binding table */
 	struct route_table *fec_table[AFI_MAX];
@@ -176,6 +178,9 @@ struct zebra_vrf {
 	uint64_t lsp_installs;
 	uint64_t lsp_removals;
 
+	/* Meta-queue shard holding this VRF's queued route nodes */
+	struct meta_queue_shard *mq_shard;
+
 #if defined(HAVE_RTADV)
 	struct rtadv rtadv;
 #endif /* HAVE_RTADV */
@@ -44,6 +44,8 @@
 #include "zebra/zebra_routemap.h"
 #include "lib/json.h"
 #include "zebra/zebra_vxlan.h"
+#include "zebra/zebra_evpn.h"
+#include "zebra/zebra_evpn_mac.h"
 #include "zebra/zebra_evpn_mh.h"
 #ifndef VTYSH_EXTRACT_PL
 #include "zebra/zebra_vty_clippy.c"
@@ -62,10 +64,37 @@
 
 extern int allow_delete;
 
+DEFINE_MTYPE_STATIC(ZEBRA, ROUTE_SHOW_WALK, "Route show walk");
+
+struct route_show_walk;
+
 /* context to manage dumps in multiple tables or vrfs */
 struct route_show_ctx {
 	bool multi;       /* dump multiple tables or vrf */
 	bool header_done; /* common header already displayed */
+	struct route_show_walk *walk; /* resuming a yielded json dump */
+};
+
+/*
+ * A single table json dump that yielded to let vtysh read its output.  It
+ * continues by prefix, so the table may change or go away meanwhile.
+ */
+struct route_show_walk {
+	vrf_id_t vrf_id;
+	afi_t afi;
+	safi_t safi;
+	uint32_t tableid;
+	bool use_fib;
+	route_tag_t tag;
+	bool longer_prefix;
+	struct prefix longer_prefix_p;
+	bool supernets_only;
+	int type;
+	unsigned short ospf_instance_id;
+
+	struct json_stream js;
+	/* first top level node not shown yet */
+	struct prefix next;
 };
 
 static int do_show_ip_route(struct vty *vty, const char *vrf_name, afi_t afi,
@@ -1047,19 +1076,27 @@ static void vty_show_ip_route_detail_json(struct vty *vty,
 	json_object_free(json);
 }
 
-static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
-				 struct route_table *table, afi_t afi,
-				 bool use_fib, route_tag_t tag,
-				 const struct prefix *longer_prefix_p,
-				 bool supernets_only, int type,
-				 unsigned short ospf_instance_id, bool use_json,
-				 uint32_t tableid, struct route_show_ctx *ctx)
+static int do_show_route_resume(struct vty *vty, void *arg);
+
+static void do_show_route_cancel(void *arg)
+{
+	XFREE(MTYPE_ROUTE_SHOW_WALK, arg);
+}
+
+static int do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
+				struct route_table *table, afi_t afi,
+				safi_t safi, bool use_fib, route_tag_t tag,
+				const struct prefix *longer_prefix_p,
+				bool supernets_only, int type,
+				unsigned short ospf_instance_id, bool use_json,
+				uint32_t tableid, struct route_show_ctx *ctx)
 {
+	struct route_show_walk *walk = ctx->walk;
 	struct route_node *rn;
 	struct route_entry *re;
 	int first = 1;
 	rib_dest_t *dest;
-	json_object *json = NULL;
+	struct json_stream js;
 	json_object *json_prefix = NULL;
 	uint32_t addr;
 	char buf[BUFSIZ];
@@ -1075,11 +1112,57 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 	 *   => display the VRF and table if specific
 	 */
 
-	if (use_json)
-		json = json_object_new_object();
+	/* Only one prefix' worth of routes is ever held in memory, with
+	 * full tables anything else takes gigabytes.
+	 */
+	if (walk) {
+		js = walk->js;
+		js.vty = vty;
+		js.blocked = false;
+		rn = route_node_lookup_maynull(table, &walk->next);
+		if (!rn)
+			rn = route_table_get_next(table, &walk->next);
+	} else {
+		if (use_json) {
+			json_stream_init(&js, vty);
+			json_stream_object_open(&js, NULL);
+		}
+		rn = route_top(table);
+	}
 
 	/* Show all routes. */
-	for (rn = route_top(table); rn; rn = srcdest_route_next(rn)) {
+	for (; rn; rn = srcdest_route_next(rn)) {
+		/*
+		 * Let vtysh catch up before a top level node, the walk can
+		 * continue from there by prefix.
+		 */
+		if (use_json && js.blocked && !ctx->multi
+		    && rn->table == table) {
+			if (!walk) {
+				walk = XCALLOC(MTYPE_ROUTE_SHOW_WALK,
+					       sizeof(*walk));
+				walk->vrf_id = zvrf_id(zvrf);
+				walk->afi = afi;
+				walk->safi = safi;
+				walk->tableid = tableid;
+				walk->use_fib = use_fib;
+				walk->tag = tag;
+				if (longer_prefix_p) {
+					walk->longer_prefix = true;
+					prefix_copy(&walk->longer_prefix_p,
+						    longer_prefix_p);
+				}
+				walk->supernets_only = supernets_only;
+				walk->type = type;
+				walk->ospf_instance_id = ospf_instance_id;
+			}
+			walk->js = js;
+			prefix_copy(&walk->next, &rn->p);
+			route_unlock_node(rn);
+			return vty_yield(vty, do_show_route_resume,
+					 do_show_route_cancel, walk);
+		}
+
 		dest = rib_dest_from_rnode(rn);
 
 		RNODE_FOREACH_RE (rn, re) {
@@ -1149,16 +1232,49 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 
 		if (json_prefix) {
 			prefix2str(&rn->p, buf, sizeof(buf));
-			json_object_object_add(json, buf, json_prefix);
+			json_stream_object_add(&js, buf, json_prefix);
 			json_prefix = NULL;
 		}
 	}
 
-	if (use_json) {
-		vty_out(vty, "%s\n", json_object_to_json_string_ext(json,
-						JSON_C_TO_STRING_PRETTY));
-		json_object_free(json);
+	if (use_json)
+		json_stream_finish(&js);
+	return CMD_SUCCESS;
+}
+
+static int do_show_route_resume(struct vty *vty, void *arg)
+{
+	struct route_show_walk *walk = arg;
+	struct route_show_ctx ctx = {
+		.walk = walk,
+	};
+	struct zebra_vrf *zvrf;
+	struct route_table *table = NULL;
+	int ret;
+
+	zvrf = zebra_vrf_lookup_by_id(walk->vrf_id);
+	if (zvrf && walk->tableid)
+		table = zebra_router_find_table(zvrf, walk->tableid, walk->afi,
+						SAFI_UNICAST);
+	else if (zvrf)
+		table = zebra_vrf_table(walk->afi, walk->safi, walk->vrf_id);
+
+	if (!table) {
+		/* gone while vtysh was reading, end what was shown */
+		walk->js.vty = vty;
+		json_stream_finish(&walk->js);
+		XFREE(MTYPE_ROUTE_SHOW_WALK, walk);
+		return CMD_SUCCESS;
 	}
+
+	ret = do_show_route_helper(
+		vty, zvrf, table, walk->afi, walk->safi, walk->use_fib,
+		walk->tag, walk->longer_prefix ? &walk->longer_prefix_p : NULL,
+		walk->supernets_only, walk->type, walk->ospf_instance_id, true,
+		walk->tableid, &ctx);
+	if (ret != CMD_SUSPEND)
+		XFREE(MTYPE_ROUTE_SHOW_WALK, walk);
+	return ret;
 }
 
 static void do_show_ip_route_all(struct vty *vty, struct zebra_vrf *zvrf,
@@ -1226,11 +1342,9 @@ static int do_show_ip_route(struct vty *vty, const char *vrf_name, afi_t afi,
 		return CMD_SUCCESS;
 	}
 
-	do_show_route_helper(vty, zvrf, table, afi, use_fib, tag,
-			     longer_prefix_p, supernets_only, type,
-			     ospf_instance_id, use_json, tableid, ctx);
-
-	return CMD_SUCCESS;
+	return do_show_route_helper(vty, zvrf, table, afi, safi, use_fib, tag,
+				    longer_prefix_p, supernets_only, type,
+				    ospf_instance_id, use_json, tableid, ctx);
 }
 
 DEFPY (show_ip_nht,
@@ -1321,6 +1435,9 @@ static void show_nexthop_group_out(struct vty *vty, struct nhg_hash_entry *nhe)
 			vty_out(vty, ", Installed");
 		vty_out(vty, "\n");
 	}
+	if (nhe->kernel_nhe)
+		vty_out(vty, "     Kernel object shared with ID: %u\n",
+			nhe->kernel_nhe->id);
 	if (nhe->ifp)
 		vty_out(vty, "     Interface Index: %d\n", nhe->ifp->ifindex);
 
@@ -1789,11 +1906,11 @@ DEFPY (show_route,
 					     !!supernets_only, type,
 					     ospf_instance_id, &ctx);
 		else
-			do_show_ip_route(vty, vrf->name, afi, SAFI_UNICAST,
-					 !!fib, !!json, tag,
-					 prefix_str ? prefix : NULL,
-					 !!supernets_only, type,
-					 ospf_instance_id, table, &ctx);
+			return do_show_ip_route(vty, vrf->name, afi,
+						SAFI_UNICAST, !!fib, !!json,
+						tag, prefix_str ? prefix : NULL,
+						!!supernets_only, type,
+						ospf_instance_id, table, &ctx);
 	}
 
 	return CMD_SUCCESS;
@@ -3588,6 +3705,38 @@ DEFUN (show_zebra,
 			zvrf->lsp_removals);
 	}
 
+	vty_out(vty, "\nRIB meta-queue: %u queued, %u nexthop groups\n",
+		zrouter.mq->size, listcount(zrouter.mq->nhg_subq));
+	vty_out(vty,
+		"  Coalesced %" PRIu64 " (promoted %" PRIu64
+		"), aged %" PRIu64 "\n",
+		zrouter.mq->coalesced, zrouter.mq->promoted, zrouter.mq->aged);
+	vty_out(vty,
+		"  Dwell <1ms %" PRIu64 ", <10ms %" PRIu64 ", <100ms %" PRIu64
+		", <1s %" PRIu64 ", <10s %" PRIu64 ", >=10s %" PRIu64 "\n",
+		zrouter.mq->dwell[0], zrouter.mq->dwell[1],
+		zrouter.mq->dwell[2], zrouter.mq->dwell[3],
+		zrouter.mq->dwell[4], zrouter.mq->dwell[5]);
+	vty_out(vty,
+		"VRF                           Queued   Max Queued  Processed\n");
+
+	RB_FOREACH (vrf, vrf_name_head, &vrfs_by_name) {
+		struct zebra_vrf *zvrf = vrf->info;
+		struct meta_queue_shard *shard = zvrf->mq_shard;
+
+		if (!shard)
+			continue;
+
+		vty_out(vty, "%-25s %10u %12u %10" PRIu64 "\n", vrf->name,
+			shard->size, shard->max_size, shard->processed);
+	}
+
+	vty_out(vty, "\nNexthop groups sharing a kernel object: %u\n",
+		zebra_nhg_kernel_shared_count());
+
+	zebra_rnh_updates_show(vty);
+	zebra_evpn_macip_updates_show(vty);
+
 	return CMD_SUCCESS;
 }
 
@@ -6007,8 +6007,10 @@ static int zebra_evpn_pim_cfg_clean_up(struct zserv *client)
 
 static int zebra_evpn_cfg_clean_up(struct zserv *client)
 {
-	if (client->proto == ZEBRA_ROUTE_BGP)
+	if (client->proto == ZEBRA_ROUTE_BGP) {
+		zebra_evpn_macip_updates_drop(client);
 		return zebra_evpn_bgp_cfg_clean_up(client);
+	}
 
 	if (client->proto == ZEBRA_ROUTE_PIM)
 		return zebra_evpn_pim_cfg_clean_up(client);
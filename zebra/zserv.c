@@ -55,6 +55,7 @@
 #include "lib/frr_pthread.h"      /* for frr_pthread_new, frr_pthread_stop... */
 #include "lib/frratomic.h"        /* for atomic_load_explicit, atomic_stor... */
 #include "lib/lib_errors.h"       /* for generic ferr ids */
+#include "lib/zring.h"            /* for zring_read, zring_recv */
 
 #include "zebra/debug.h"          /* for various debugging macros */
 #include "zebra/rib.h"            /* for rib_score_proto */
@@ -193,6 +194,7 @@ static void zserv_client_fail(struct zserv *client)
 
 	THREAD_OFF(client->t_read);
 	THREAD_OFF(client->t_write);
+	THREAD_OFF(client->t_ring_hup);
 	zserv_event(client, ZSERV_HANDLE_CLIENT_FAIL);
 }
 
@@ -297,134 +299,185 @@ zwrite_fail:
  * onto the input queue and then notify the main thread that there is new data
  * available.
  *
- * This function first looks for any data in the client structure's working
- * input buffer. If data is present, it is assumed that reading stopped in a
- * previous invocation of this task and needs to be resumed to finish a message.
- * Otherwise, the socket data stream is assumed to be at the beginning of a new
- * ZAPI message (specifically at the header). The header is read and validated.
- * If the header passed validation then the length field found in the header is
- * used to compute the total length of the message. That much data is read (but
- * not inspected), appended to the header, placed into a stream and pushed onto
- * the client's input queue. A task is then scheduled on the main thread to
- * process the client's input queue. Finally, if all of this was successful,
- * this task reschedules itself.
+ * Data is read into the client structure's working input buffer in chunks as
+ * large as the buffer allows, which with clients pushing routes in bulk
+ * typically covers many ZAPI messages with a single read().  All complete
+ * messages in the buffer are then split off:  each header is validated, and
+ * if the whole message is there it is copied into its own stream and pushed
+ * onto the client's input queue.  A trailing partial message is moved to the
+ * front of the buffer to be completed by the next read.  A task is then
+ * scheduled on the main thread to process the client's input queue.
+ * Finally, if all of this was successful, this task reschedules itself.
  *
  * Any failure in any of these actions is handled by terminating the client.
  */
 static int zserv_read(struct thread *thread)
 {
 	struct zserv *client = THREAD_ARG(thread);
+	struct stream *ibuf = client->ibuf_work;
 	int sock;
-	size_t already;
 	struct stream_fifo *cache;
 	uint32_t p2p_orig;
 
 	uint32_t p2p;
 	struct zmsghdr hdr;
+	bool drained = false, pending = false, waiting = false;
 
 	p2p_orig = atomic_load_explicit(&zrouter.packets_to_process,
 					memory_order_relaxed);
 	cache = stream_fifo_new();
 	p2p = p2p_orig;
-	sock = THREAD_FD(thread);
+	sock = client->sock;
+
+	if (client->ring)
+		zring_ack(client->ring);
 
 	while (p2p) {
 		ssize_t nb;
+		size_t start, avail, left;
 		bool hdrvalid;
 		char errmsg[256];
 
-		already = stream_get_endp(client->ibuf_work);
+		/* Split off every complete message we have. */
+		while (p2p && STREAM_READABLE(ibuf) >= ZEBRA_HEADER_SIZE) {
+			start = stream_get_getp(ibuf);
+			avail = STREAM_READABLE(ibuf);
 
-		/* Read length and command (if we don't have it already). */
-		if (already < ZEBRA_HEADER_SIZE) {
-			nb = stream_read_try(client->ibuf_work, sock,
-					     ZEBRA_HEADER_SIZE - already);
-			if ((nb == 0 || nb == -1)) {
-				if (IS_ZEBRA_DEBUG_EVENT)
-					zlog_debug("connection closed socket [%d]",
-						   sock);
+			/* Fetch header values */
+			hdrvalid = zapi_parse_header(ibuf, &hdr);
+			stream_set_getp(ibuf, start);
+
+			if (!hdrvalid) {
+				snprintf(errmsg, sizeof(errmsg),
+					 "%s: Message has corrupt header",
+					 __func__);
+				zserv_log_message(errmsg, ibuf, NULL);
 				goto zread_fail;
 			}
-			if (nb != (ssize_t)(ZEBRA_HEADER_SIZE - already)) {
-				/* Try again later. */
-				break;
+
+			/* Validate header */
+			if (hdr.marker != ZEBRA_HEADER_MARKER
+			    || hdr.version != ZSERV_VERSION) {
+				snprintf(
+					errmsg, sizeof(errmsg),
+					"Message has corrupt header\n%s: socket %d version mismatch, marker %d, version %d",
+					__func__, sock, hdr.marker,
+					hdr.version);
+				zserv_log_message(errmsg, ibuf, &hdr);
+				goto zread_fail;
+			}
+			if (hdr.length < ZEBRA_HEADER_SIZE) {
+				snprintf(
+					errmsg, sizeof(errmsg),
+					"Message has corrupt header\n%s: socket %d message length %u is less than header size %d",
+					__func__, sock, hdr.length,
+					ZEBRA_HEADER_SIZE);
+				zserv_log_message(errmsg, ibuf, &hdr);
+				goto zread_fail;
+			}
+			if (hdr.length > STREAM_SIZE(ibuf)) {
+				snprintf(
+					errmsg, sizeof(errmsg),
+					"Message has corrupt header\n%s: socket %d message length %u exceeds buffer size %lu",
+					__func__, sock, hdr.length,
+					(unsigned long)STREAM_SIZE(ibuf));
+				zserv_log_message(errmsg, ibuf, &hdr);
+				goto zread_fail;
 			}
-			already = ZEBRA_HEADER_SIZE;
-		}
 
-		/* Reset to read from the beginning of the incoming packet. */
-		stream_set_getp(client->ibuf_work, 0);
+			/* Rest of the message not read yet. */
+			if (avail < hdr.length)
+				break;
 
-		/* Fetch header values */
-		hdrvalid = zapi_parse_header(client->ibuf_work, &hdr);
+			/* Debug packet information. */
+			if (IS_ZEBRA_DEBUG_PACKET)
+				zlog_debug("zebra message[%s:%u:%u] comes from socket [%d]",
+					   zserv_command_string(hdr.command),
+					   hdr.vrf_id, hdr.length,
+					   sock);
 
-		if (!hdrvalid) {
-			snprintf(errmsg, sizeof(errmsg),
-				 "%s: Message has corrupt header", __func__);
-			zserv_log_message(errmsg, client->ibuf_work, NULL);
-			goto zread_fail;
-		}
+			struct stream *msg = stream_new(hdr.length);
 
-		/* Validate header */
-		if (hdr.marker != ZEBRA_HEADER_MARKER
-		    || hdr.version != ZSERV_VERSION) {
-			snprintf(
-				errmsg, sizeof(errmsg),
-				"Message has corrupt header\n%s: socket %d version mismatch, marker %d, version %d",
-				__func__, sock, hdr.marker, hdr.version);
-			zserv_log_message(errmsg, client->ibuf_work, &hdr);
-			goto zread_fail;
-		}
-		if (hdr.length < ZEBRA_HEADER_SIZE) {
-			snprintf(
-				errmsg, sizeof(errmsg),
-				"Message has corrupt header\n%s: socket %d message length %u is less than header size %d",
-				__func__, sock, hdr.length, ZEBRA_HEADER_SIZE);
-			zserv_log_message(errmsg, client->ibuf_work, &hdr);
-			goto zread_fail;
-		}
-		if (hdr.length > STREAM_SIZE(client->ibuf_work)) {
-			snprintf(
-				errmsg, sizeof(errmsg),
-				"Message has corrupt header\n%s: socket %d message length %u exceeds buffer size %lu",
-				__func__, sock, hdr.length,
-				(unsigned long)STREAM_SIZE(client->ibuf_work));
-			zserv_log_message(errmsg, client->ibuf_work, &hdr);
-			goto zread_fail;
-		}
+			stream_put(msg, STREAM_DATA(ibuf) + start, hdr.length);
+			stream_forward_getp(ibuf, hdr.length);
 
-		/* Read rest of data. */
-		if (already < hdr.length) {
-			nb = stream_read_try(client->ibuf_work, sock,
-					     hdr.length - already);
-			if ((nb == 0 || nb == -1)) {
+			stream_fifo_push(cache, msg);
+			p2p--;
+
+			/* Everything after HELLO comes through the ring */
+			if (hdr.command == ZEBRA_HELLO && !client->ring
+			    && client->ring_fds[0] >= 0) {
+				client->ring = zring_attach(client->ring_fds);
+				if (!client->ring) {
+					zlog_warn("%s: socket %d sent an unusable ring",
+						  __func__, sock);
+					goto zread_fail;
+				}
 				if (IS_ZEBRA_DEBUG_EVENT)
-					zlog_debug(
-						   "connection closed [%d] when reading zebra data",
+					zlog_debug("client on socket [%d] switched to shared-memory ring",
 						   sock);
-				goto zread_fail;
 			}
-			if (nb != (ssize_t)(hdr.length - already)) {
-				/* Try again later. */
+		}
+
+		if (!p2p || drained)
+			break;
+
+		/* Move what's left of a partial message to the front. */
+		left = STREAM_READABLE(ibuf);
+		if (left)
+			memmove(STREAM_DATA(ibuf),
+				STREAM_DATA(ibuf) + stream_get_getp(ibuf),
+				left);
+		stream_set_getp(ibuf, 0);
+		stream_set_endp(ibuf, left);
+
+		/* Read as much as we can fit. */
+		avail = STREAM_WRITEABLE(ibuf);
+		if (client->ring) {
+			nb = zring_read(client->ring, STREAM_DATA(ibuf) + left,
+					avail);
+			if (nb == -2) {
+				/* empty, and the client knows to wake us */
+				waiting = true;
 				break;
 			}
+			if (nb == -1) {
+				zlog_warn("client on socket [%d] corrupted its ring",
+					  sock);
+				goto zread_fail;
+			}
+			stream_set_endp(ibuf, left + nb);
+			continue;
 		}
 
-		/* Debug packet information. */
-		if (IS_ZEBRA_DEBUG_PACKET)
-			zlog_debug("zebra message[%s:%u:%u] comes from socket [%d]",
-				   zserv_command_string(hdr.command),
-				   hdr.vrf_id, hdr.length,
-				   sock);
-
-		stream_set_getp(client->ibuf_work, 0);
-		struct stream *msg = stream_dup(client->ibuf_work);
+		nb = zring_recv(sock, STREAM_DATA(ibuf) + left, avail,
+				client->ring_fds);
+		if (nb > 0)
+			stream_set_endp(ibuf, left + nb);
+		if (nb == 0 || nb == -1) {
+			if (IS_ZEBRA_DEBUG_EVENT)
+				zlog_debug("connection closed socket [%d]",
+					   sock);
+			goto zread_fail;
+		}
+		if (nb < 0)
+			/* Try again later. */
+			break;
 
-		stream_fifo_push(cache, msg);
-		stream_reset(client->ibuf_work);
-		p2p--;
+		/* Short read, the socket has nothing more for now. */
+		if ((size_t)nb < avail)
+			drained = true;
 	}
 
+	/* Complete messages still in the buffer won't make the socket
+	 * readable again, so come back for them right away.  Same for the
+	 * ring until it's been seen empty, only then will the client kick us.
+	 */
+	if (!p2p && STREAM_READABLE(ibuf) >= ZEBRA_HEADER_SIZE)
+		pending = true;
+	if (client->ring && !waiting)
+		pending = true;
+
 	if (p2p < p2p_orig) {
 		/* update session statistics */
 		atomic_store_explicit(&client->last_read_time, monotime(NULL),
@@ -449,7 +502,11 @@ static int zserv_read(struct thread *thread)
 			   zebra_route_string(client->proto));
 
 	/* Reschedule ourselves */
-	zserv_client_event(client, ZSERV_CLIENT_READ);
+	if (pending)
+		thread_add_event(client->pthread->master, zserv_read, client,
+				 0, &client->t_read);
+	else
+		zserv_client_event(client, ZSERV_CLIENT_READ);
 
 	stream_fifo_free(cache);
 
@@ -461,11 +518,47 @@ zread_fail:
 	return -1;
 }
 
+/*
+ * With a ring, the socket only carries data towards the client.  Reading
+ * from it just tells us when the client goes away.
+ */
+static int zserv_ring_hup(struct thread *thread)
+{
+	struct zserv *client = THREAD_ARG(thread);
+	char buf[64];
+	ssize_t nb;
+
+	nb = read(client->sock, buf, sizeof(buf));
+	if (nb < 0 && ERRNO_IO_RETRY(errno)) {
+		thread_add_read(client->pthread->master, zserv_ring_hup, client,
+				client->sock, &client->t_ring_hup);
+		return 0;
+	}
+
+	if (nb > 0)
+		zlog_warn("client on socket [%d] wrote to the socket after switching to its ring",
+			  client->sock);
+	else if (IS_ZEBRA_DEBUG_EVENT)
+		zlog_debug("connection closed socket [%d]", client->sock);
+
+	zserv_client_fail(client);
+	return -1;
+}
+
 static void zserv_client_event(struct zserv *client,
 			       enum zserv_client_event event)
 {
 	switch (event) {
 	case ZSERV_CLIENT_READ:
+		if (client->ring) {
+			thread_add_read(client->pthread->master, zserv_read,
+					client, zring_fd(client->ring),
+					&client->t_read);
+			thread_add_read(client->pthread->master, zserv_ring_hup,
+					client, client->sock,
+					&client->t_ring_hup);
+			break;
+		}
 		thread_add_read(client->pthread->master, zserv_read, client,
 				client->sock, &client->t_read);
 		break;
@@ -478,6 +571,35 @@ static void zserv_client_event(struct zserv *client,
 
 /* Main thread lifecycle ---------------------------------------------------- */
 
+/*
+ * Target main pthread time for one batch of client messages, and how far
+ * above zrouter.packets_to_process the per-client batch size may grow.
+ */
+#define ZSERV_PROCESS_TARGET_USEC 10000
+#define ZSERV_PROCESS_CAP_FACTOR 4
+
+/*
+ * Size the client's next batch from how long this one took: halve it when
+ * the batch overran the target, double it when the batch finished well
+ * within the target and more messages are waiting.
+ */
+static void zserv_process_adapt(struct zserv *client, uint32_t count,
+				int64_t usec, bool need_resched)
+{
+	uint32_t max = zrouter.packets_to_process * ZSERV_PROCESS_CAP_FACTOR;
+
+	client->process_batches++;
+	client->process_msgs += count;
+	client->process_usec += usec;
+	if (usec > client->process_max_usec)
+		client->process_max_usec = usec;
+
+	if (usec > ZSERV_PROCESS_TARGET_USEC)
+		client->process_cap = MAX(client->process_cap / 2, 1U);
+	else if (need_resched && usec < ZSERV_PROCESS_TARGET_USEC / 2)
+		client->process_cap = MIN(client->process_cap * 2, max);
+}
+
 /*
  * Read and process messages from a client.
  *
@@ -485,15 +607,15 @@ static void zserv_client_event(struct zserv *client,
  * they have new messages available on their input queues. The client is passed
  * as the task argument.
  *
- * Each message is popped off the client's input queue and the action associated
- * with the message is executed. This proceeds until there are no more messages,
- * an error occurs, or the processing limit is reached.
+ * Up to client->process_cap messages are popped off the client's input queue
+ * as one batch and the action associated with each message is executed. If
+ * messages remain, the task requeues itself behind the other clients' pending
+ * events, so busy clients are served round-robin.
  *
  * The client's I/O thread can push at most zrouter.packets_to_process messages
- * onto the input buffer before notifying us there are packets to read. As long
- * as we always process zrouter.packets_to_process messages here, then we can
- * rely on the read thread to handle queuing this task enough times to process
- * everything on the input queue.
+ * onto the input buffer before notifying us there are packets to read; since
+ * we reschedule ourselves while the input queue is non-empty, the batch size
+ * may be smaller or larger than that.
  */
 static int zserv_process_messages(struct thread *thread)
 {
@@ -501,14 +623,23 @@ static int zserv_process_messages(struct thread *thread)
 	struct stream *msg;
 	struct stream_fifo *cache = stream_fifo_new();
 	uint32_t p2p = zrouter.packets_to_process;
+	uint32_t count = 0;
 	bool need_resched = false;
+	struct timeval start;
+
+	if (!client->process_cap
+	    || client->process_cap > p2p * ZSERV_PROCESS_CAP_FACTOR)
+		client->process_cap = p2p;
 
 	frr_with_mutex(&client->ibuf_mtx) {
-		uint32_t i;
-		for (i = 0; i < p2p && stream_fifo_head(client->ibuf_fifo);
-		     ++i) {
+		if (client->ibuf_fifo->count > client->process_max_depth)
+			client->process_max_depth = client->ibuf_fifo->count;
+
+		while (count < client->process_cap
+		       && stream_fifo_head(client->ibuf_fifo)) {
 			msg = stream_fifo_pop(client->ibuf_fifo);
 			stream_fifo_push(cache, msg);
+			count++;
 		}
 
 		msg = NULL;
@@ -521,8 +652,12 @@ static int zserv_process_messages(struct thread *thread)
 	}
 
 	/* Process the batch of messages */
-	if (stream_fifo_head(cache))
+	if (stream_fifo_head(cache)) {
+		monotime(&start);
 		zserv_handle_commands(client, cache);
+		zserv_process_adapt(client, count, monotime_since(&start, NULL),
+				    need_resched);
+	}
 
 	stream_fifo_free(cache);
 
@@ -544,6 +679,39 @@ int zserv_send_message(struct zserv *client, struct stream *msg)
 	return 0;
 }
 
+static struct thread *t_deferred_write;
+
+static int zserv_deferred_write(struct thread *thread)
+{
+	struct listnode *node;
+	struct zserv *client;
+
+	frr_with_mutex(&client_mutex) {
+		for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client)) {
+			if (!client->write_deferred)
+				continue;
+
+			client->write_deferred = false;
+			zserv_client_event(client, ZSERV_CLIENT_WRITE);
+		}
+	}
+
+	return 0;
+}
+
+int zserv_send_message_deferred(struct zserv *client, struct stream *msg)
+{
+	frr_with_mutex(&client->obuf_mtx) {
+		stream_fifo_push(client->obuf_fifo, msg);
+	}
+
+	client->write_deferred = true;
+	thread_add_event(zrouter.master, zserv_deferred_write, NULL, 0,
+			 &t_deferred_write);
+
+	return 0;
+}
+
 /*
  * Send a batch of messages to a connected Zebra API client.
  */
@@ -624,6 +792,11 @@ static void zserv_client_free(struct zserv *client)
 	if (client->wb)
 		buffer_free(client->wb);
 
+	zring_free(client->ring);
+	for (int i = 0; i < ZRING_NFDS; i++)
+		if (client->ring_fds[i] >= 0)
+			close(client->ring_fds[i]);
+
 	/* Free buffer mutexes */
 	pthread_mutex_destroy(&client->obuf_mtx);
 	pthread_mutex_destroy(&client->ibuf_mtx);
@@ -748,6 +921,8 @@ static struct zserv *zserv_client_create(int sock)
 	pthread_mutex_init(&client->ibuf_mtx, NULL);
 	pthread_mutex_init(&client->obuf_mtx, NULL);
 	client->wb = buffer_new(0);
+	for (i = 0; i < ZRING_NFDS; i++)
+		client->ring_fds[i] = -1;
 	TAILQ_INIT(&(client->gr_info_queue));
 
 	atomic_store_explicit(&client->connect_time, (uint32_t) monotime(NULL),
@@ -1004,6 +1179,7 @@ static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 	time_t connect_time, last_read_time, last_write_time;
 	uint32_t last_read_cmd, last_write_cmd;
 	struct client_gr_info *info = NULL;
+	size_t depth;
 
 	vty_out(vty, "Client: %s", zebra_route_string(client->proto));
 	if (client->instance)
@@ -1106,6 +1282,20 @@ static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 		}
 	}
 
+	frr_with_mutex(&client->ibuf_mtx) {
+		depth = client->ibuf_fifo->count;
+	}
+	vty_out(vty, "Input Queue: %zu (max %zu), Batch Size: %u\n", depth,
+		client->process_max_depth, client->process_cap);
+	vty_out(vty,
+		"Batches: %" PRIu64 ", Messages: %" PRIu64
+		", Avg Batch Time: %" PRIu64 " usec, Max: %u usec\n",
+		client->process_batches, client->process_msgs,
+		client->process_batches
+			? client->process_usec / client->process_batches
+			: 0,
+		client->process_max_usec);
+
 #if defined DEV_BUILD
 	vty_out(vty, "Input Fifo: %zu:%zu Output Fifo: %zu:%zu\n",
 		client->ibuf_fifo->count, client->ibuf_fifo->max_count,
@@ -1172,9 +1362,13 @@ static void zebra_show_stale_client_detail(struct vty *vty,
 				}
 			}
 			vty_out(vty, "Current AFI : %d\n", info->current_afi);
-			if (info->current_prefix)
-				vty_out(vty, "Current prefix : %pFX\n",
-					info->current_prefix);
+			if (info->stale_count)
+				vty_out(vty,
+					"Stale route nodes : %u (%u swept)%s\n",
+					info->stale_count, info->stale_next,
+					info->stale_collected
+						? ""
+						: ", collecting");
 		}
 	}
 	vty_out(vty, "\n");
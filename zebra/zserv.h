@@ -36,6 +36,8 @@
 #include "lib/linklist.h"     /* for list */
 #include "lib/workqueue.h"    /* for work_queue */
 #include "lib/hook.h"         /* for DECLARE_HOOK, DECLARE_KOOH */
+#include "lib/table.h"        /* for route_table_iter_t */
+#include "lib/zring.h"        /* for ZRING_NFDS */
 
 #include "zebra/zebra_vrf.h"  /* for zebra_vrf */
 /* clang-format on */
@@ -53,12 +55,6 @@ extern "C" {
 #define ZEBRA_RMAP_DEFAULT_UPDATE_TIMER 5 /* disabled by default */
 
 
-/* Stale route marker timer */
-#define ZEBRA_DEFAULT_STALE_UPDATE_DELAY 1
-
-/* Count of stale routes processed in timer context */
-#define ZEBRA_MAX_STALE_ROUTE_COUNT 50000
-
 /* Graceful Restart information */
 struct client_gr_info {
 	/* VRF for which GR enabled */
@@ -81,10 +77,23 @@ struct client_gr_info {
 	bool route_sync[AFI_MAX][SAFI_MAX];
 
 	/* Book keeping */
-	struct prefix *current_prefix;
 	void *stale_client_ptr;
 	struct thread *t_stale_removal;
 
+	/*
+	 * Route nodes (locked) that held routes of the client when it went
+	 * away, collected in the background and swept in slices once the
+	 * stale timer fires.
+	 */
+	struct route_node **stale_nodes;
+	uint32_t stale_count;
+	uint32_t stale_size;
+	uint32_t stale_next;
+	bool stale_collected;
+	route_table_iter_t stale_iter;
+	struct route_table *stale_tables[AFI_MAX];
+	struct thread *t_stale_collect;
+
 	TAILQ_ENTRY(client_gr_info) gr_info;
 };
 
@@ -121,12 +130,37 @@ struct zserv {
 	struct thread *t_read;
 	struct thread *t_write;
 
+	/* Shared-memory ring the client writes to instead of the socket,
+	 * and the fds for it received ahead of the HELLO message.  With a
+	 * ring, t_ring_hup watches the socket for the client going away.
+	 */
+	struct zring *ring;
+	int ring_fds[ZRING_NFDS];
+	struct thread *t_ring_hup;
+
 	/* Event for message processing, for the main pthread */
 	struct thread *t_process;
 
+	/*
+	 * Messages taken off the input queue per processing event.  Adapts
+	 * between 1 and a multiple of zrouter.packets_to_process so that a
+	 * batch stays close to ZSERV_PROCESS_TARGET_USEC on the main pthread.
+	 */
+	uint32_t process_cap;
+
+	/* Input processing statistics, main pthread only */
+	size_t process_max_depth;
+	uint64_t process_batches;
+	uint64_t process_msgs;
+	uint64_t process_usec;
+	uint32_t process_max_usec;
+
 	/* Event for the main pthread */
 	struct thread *t_cleanup;
 
+	/* Set when messages were queued without waking the write thread */
+	bool write_deferred;
+
 	/* This client's redistribute flag. */
 	struct redist_proto mi_redist[AFI_MAX][ZEBRA_ROUTE_MAX];
 	vrf_bitmap_t redist[AFI_MAX][ZEBRA_ROUTE_MAX];
@@ -134,6 +168,9 @@ struct zserv {
 	/* Redistribute default route flag. */
 	vrf_bitmap_t redist_default[AFI_MAX];
 
+	/* Last redistribution candidate walk this client was collected in */
+	uint32_t redist_walk;
+
 	/* Router-id information. */
 	vrf_bitmap_t ridinfo[AFI_MAX];
 
@@ -285,6 +322,21 @@ extern void zserv_start(char *path);
  */
 extern int zserv_send_message(struct zserv *client, struct stream *msg);
 
+/*
+ * Queue a message for a connected Zebra API client without waking its
+ * write thread straight away.  Messages queued this way during one event on
+ * the main pthread are written out together once that event completes.
+ * Main pthread only.
+ *
+ * client
+ *    the client to send to
+ *
+ * msg
+ *    the message to send
+ */
+extern int zserv_send_message_deferred(struct zserv *client,
+				       struct stream *msg);
+
 /*
  * Send a batch of messages to a connected Zebra API client.
  *